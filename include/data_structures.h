@@ -100,6 +100,11 @@ struct SensorData {
     float current;
     float power;
     float energy;
+
+    // Pulse inputs (hardware/input_capture.h)
+    uint32_t inputPulses[8];
+    float inputFrequencyHz[8];
+    float rpm;
     
     // Status
     bool isValid;
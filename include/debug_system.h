@@ -31,20 +31,114 @@ void set_log_level(LogLevel level);
 // Function to get the current log level
 LogLevel get_log_level();
 
+// Asynchronous serial sink. LOG_MACRO formats on the caller and copies the line
+// into a bounded RAM ring; a low-priority task writes the ring to Serial, so a
+// log call never waits for the UART. Until that task runs, lines go out directly.
+#ifndef DEBUG_SINK_SLOTS
+#define DEBUG_SINK_SLOTS 32
+#endif
+#ifndef DEBUG_SINK_LINE_BYTES
+#define DEBUG_SINK_LINE_BYTES 160
+#endif
+
+typedef enum {
+    DEBUG_SINK_DROP_NEWEST,    // full ring: the new line is dropped (default)
+    DEBUG_SINK_KEEP_NEWEST     // full ring: the oldest queued line is overwritten
+} DebugSinkMode;
+
+void debug_sink_write(const char* line, size_t len);
+void debug_sink_set_mode(DebugSinkMode mode);
+uint32_t debug_sink_dropped();
+extern "C" void vTaskDebugSink(void* pvParameters);
+
 // Main logging macro
 #if ENABLE_DEBUG_SYSTEM
     #define LOG_MACRO(level, fmt, ...) \
         do { \
             if (get_log_level() >= level) { \
-                char buf[256]; \
-                snprintf(buf, sizeof(buf), "[%s] " fmt, __func__, ##__VA_ARGS__); \
-                Serial.println(buf); \
+                char buf[DEBUG_SINK_LINE_BYTES]; \
+                int n = snprintf(buf, sizeof(buf), "[%s] " fmt, __func__, ##__VA_ARGS__); \
+                if (n > 0) debug_sink_write(buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1); \
             } \
         } while(0)
 #else
     #define LOG_MACRO(level, fmt, ...) do {} while(0)
 #endif
 
+// Per-module tags. Each tag has a compile-time floor (LOG_TAG_MIN_<TAG>, calls
+// above it are compiled out) and a runtime threshold (changed from the settings
+// page or the log_levels shared attribute). A call below the floor costs one
+// compare of a byte against a constant.
+typedef enum {
+    LOG_TAG_CATM,
+    LOG_TAG_GNSS,
+    LOG_TAG_STORAGE,
+    LOG_TAG_UI,
+    LOG_TAG_PLC,
+    LOG_TAG_CAN,
+    LOG_TAG_SCHED,
+    LOG_TAG_COUNT
+} LogTag;
+
+#if PRODUCTION_BUILD
+#define LOG_TAG_MIN_DEFAULT DEBUG_LOG_LEVEL_INFO
+#else
+#define LOG_TAG_MIN_DEFAULT DEBUG_LOG_LEVEL_VERBOSE
+#endif
+#ifndef LOG_TAG_MIN_CATM
+#define LOG_TAG_MIN_CATM DEBUG_LOG_LEVEL_VERBOSE   // field debugging of the modem stays possible
+#endif
+#ifndef LOG_TAG_MIN_GNSS
+#define LOG_TAG_MIN_GNSS LOG_TAG_MIN_DEFAULT
+#endif
+#ifndef LOG_TAG_MIN_STORAGE
+#define LOG_TAG_MIN_STORAGE LOG_TAG_MIN_DEFAULT
+#endif
+#ifndef LOG_TAG_MIN_UI
+#define LOG_TAG_MIN_UI LOG_TAG_MIN_DEFAULT
+#endif
+#ifndef LOG_TAG_MIN_PLC
+#define LOG_TAG_MIN_PLC LOG_TAG_MIN_DEFAULT
+#endif
+#ifndef LOG_TAG_MIN_CAN
+#define LOG_TAG_MIN_CAN LOG_TAG_MIN_DEFAULT
+#endif
+#ifndef LOG_TAG_MIN_SCHED
+#define LOG_TAG_MIN_SCHED LOG_TAG_MIN_DEFAULT
+#endif
+
+extern uint8_t g_logTagLevel[LOG_TAG_COUNT];   // runtime thresholds (LogLevel)
+
+void log_tag_set_level(LogTag tag, LogLevel level);
+LogLevel log_tag_get_level(LogTag tag);
+const char* log_tag_name(LogTag tag);
+// Case-insensitive name lookups over len bytes of s; levels also accept 0-5
+bool log_tag_parse(const char* s, size_t len, LogTag& out);
+bool log_level_parse(const char* s, size_t len, LogLevel& out);
+// Applies "CATM=5,UI=1" (levels as numbers or NONE/ERROR/WARN/INFO/DEBUG/VERBOSE);
+// unknown tags are skipped. Returns the number of tags changed.
+int log_tag_apply(const char* spec);
+
+// Formats a tagged line and hands it to the serial sink and the log uplink
+void log_tag_write(LogTag tag, LogLevel level, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#if ENABLE_DEBUG_SYSTEM || LOG_UPLINK_ENABLE
+    #define LOGT_MACRO(tag, level, fmt, ...) \
+        do { \
+            if ((level) <= LOG_TAG_MIN_##tag && g_logTagLevel[LOG_TAG_##tag] >= (level)) { \
+                log_tag_write(LOG_TAG_##tag, level, "[" #tag "] [%s] " fmt, __func__, ##__VA_ARGS__); \
+            } \
+        } while(0)
+#else
+    #define LOGT_MACRO(tag, level, fmt, ...) do {} while(0)
+#endif
+
+#define LOGT_ERROR(tag, fmt, ...)   LOGT_MACRO(tag, DEBUG_LOG_LEVEL_ERROR,   "ERROR: " fmt, ##__VA_ARGS__)
+#define LOGT_WARN(tag, fmt, ...)    LOGT_MACRO(tag, DEBUG_LOG_LEVEL_WARN,    "WARN: " fmt, ##__VA_ARGS__)
+#define LOGT_INFO(tag, fmt, ...)    LOGT_MACRO(tag, DEBUG_LOG_LEVEL_INFO,    "INFO: " fmt, ##__VA_ARGS__)
+#define LOGT_DEBUG(tag, fmt, ...)   LOGT_MACRO(tag, DEBUG_LOG_LEVEL_DEBUG,   "DEBUG: " fmt, ##__VA_ARGS__)
+#define LOGT_VERBOSE(tag, fmt, ...) LOGT_MACRO(tag, DEBUG_LOG_LEVEL_VERBOSE, "VERBOSE: " fmt, ##__VA_ARGS__)
+
 // Specific-level log macros
 #define LOG_ERROR(fmt, ...)   LOG_MACRO(DEBUG_LOG_LEVEL_ERROR,   "ERROR: " fmt, ##__VA_ARGS__)
 #define LOG_WARN(fmt, ...)    LOG_MACRO(DEBUG_LOG_LEVEL_WARN,    "WARN: " fmt, ##__VA_ARGS__)
@@ -71,6 +165,6 @@ LogLevel get_log_level();
 // Legacy debug macros - map to new system
 #define DEBUG_LOG_TASK_START(name) LOG_INFO("Task %s starting...", name)
 #define DEBUG_LOG_HEAP(label)      LOG_DEBUG("Heap at %s: %u bytes", label, ESP.getFreeHeap())
-#define DEBUG_LOG_BUTTON_PRESS(btn, action) LOG_DEBUG("Button %s pressed: %s", btn, action)
+#define DEBUG_LOG_BUTTON_PRESS(btn, action) LOGT_DEBUG(UI, "Button %s pressed: %s", btn, action)
 
 #endif // DEBUG_SYSTEM_H
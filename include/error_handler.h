@@ -1,6 +1,8 @@
 /*
  * Advanced Error Handling System
- * Centralized error management with recovery strategies
+ * Centralized error management with recovery strategies.
+ * Occurrences are kept per (code, category) in the lock-free error ring
+ * (system/error_ring.h), which also rate-limits the console output.
  */
 
 #ifndef ERROR_HANDLER_H
@@ -45,15 +47,24 @@ enum class ErrorCategory {
 // ============================================================================
 // ERROR EVENT STRUCTURE
 // ============================================================================
+#ifndef ERROR_TEXT_BYTES
+#define ERROR_TEXT_BYTES 80
+#endif
+#ifndef ERROR_CONTEXT_BYTES
+#define ERROR_CONTEXT_BYTES 32
+#endif
+
+// One (code, category) key: timestamp is the last occurrence, severity the worst
 struct ErrorEvent {
     uint32_t timestamp;
     ErrorCode code;
     ErrorSeverity severity;
     ErrorCategory category;
     TaskHandle_t taskHandle;
-    char description[128];
-    char context[256];
+    char description[ERROR_TEXT_BYTES];     // latest emitted occurrence
+    char context[ERROR_CONTEXT_BYTES];
     uint32_t count;
+    uint32_t suppressed;                    // rate-limited: counted, not logged
     uint32_t firstOccurrence;
     RecoveryAction recommendedAction;
     bool recoveryAttempted;
@@ -67,20 +78,10 @@ class ErrorHandler {
 private:
     static ErrorHandler* instance;
     
-    // Error storage
-    ErrorEvent errorLog[50]; // Store last 50 error events
-    uint8_t errorCount;
-    uint8_t currentIndex;
-    
     // Statistics
-    uint32_t totalErrors;
-    uint32_t criticalErrors;
     uint32_t recoveryAttempts;
     uint32_t successfulRecoveries;
     
-    // Mutex for thread safety
-    SemaphoreHandle_t errorMutex;
-    
     // Error recovery functions
     bool recoverFromHardwareError(const ErrorEvent& error);
     bool recoverFromCommunicationError(const ErrorEvent& error);
@@ -89,8 +90,6 @@ private:
     bool recoverFromSystemError(const ErrorEvent& error);
     
     // Internal helper methods
-    const char* severityToString(ErrorSeverity severity) const;
-    const char* categoryToString(ErrorCategory category) const;
     const char* recoveryActionToString(RecoveryAction action) const;
     void logError(const ErrorEvent& error);
     void updateStatistics(const ErrorEvent& error);
@@ -112,12 +111,12 @@ public:
     bool attemptRecovery(ErrorEvent& error);
     bool attemptAutomaticRecovery(ErrorCode code, ErrorCategory category);
     
-    // Error querying
-    ErrorEvent* getLastError();
-    ErrorEvent* getErrorByCode(ErrorCode code);
-    uint8_t getErrorCount() const { return errorCount; }
-    uint32_t getTotalErrors() const { return totalErrors; }
-    uint32_t getCriticalErrors() const { return criticalErrors; }
+    // Error querying (copies; the ring keeps updating)
+    bool getLastError(ErrorEvent& out) const;
+    bool getErrorByCode(ErrorCode code, ErrorEvent& out) const;
+    uint8_t getErrorCount() const;
+    uint32_t getTotalErrors() const;
+    uint32_t getCriticalErrors() const;
     uint32_t getRecoverySuccessRate() const;
     
     // Error management
@@ -134,6 +133,9 @@ public:
     bool isSystemHealthy() const;
     ErrorSeverity getHighestSeverity() const;
     ErrorCategory getMostProblematicCategory() const;
+
+    static const char* severityToString(ErrorSeverity severity);
+    static const char* categoryToString(ErrorCategory category);
     
     // Destructor
     ~ErrorHandler();
@@ -15,6 +15,8 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 
+struct ObjectPoolStats;
+
 // ============================================================================
 // MEMORY MONITOR CONFIGURATION
 // ============================================================================
@@ -22,6 +24,8 @@
 #define MEMORY_LOW_THRESHOLD_PERCENT 20
 #define MEMORY_CRITICAL_THRESHOLD_PERCENT 10
 #define MEMORY_HISTORY_SIZE 10
+#define MEMORY_MONITOR_MAX_POOLS 8     // ObjectPools reported by printStats()
+#define MEMORY_MONITOR_JOB_BUDGET_US 5000   // service job run-time budget
 
 // ============================================================================
 // MEMORY STATUS LEVELS
@@ -51,12 +55,12 @@ struct MemoryStats {
 class MemoryMonitor {
 private:
     MemoryStats stats;
-    TaskHandle_t monitorTaskHandle;
+    int serviceJob;
     SemaphoreHandle_t mutex;
     bool isRunning;
     
     // Private methods
-    static void monitorTask(void* pvParameters);
+    static void monitorJob(void* ctx);
     void updateStats();
     void checkThresholds();
     void addToHistory(uint32_t freeHeap);
@@ -89,6 +93,10 @@ public:
     // Threshold management
     void setLowThreshold(uint8_t percent);
     void setCriticalThreshold(uint8_t percent);
+
+    // Object pools (object_pool.h) to include in the report. Static storage, so it
+    // is safe to call from other globals' constructors.
+    static bool registerPool(const ObjectPoolStats* pool);
     
     // Cleanup
     void cleanup();
@@ -107,10 +115,4 @@ extern MemoryMonitor g_memoryMonitor;
 #define MEMORY_GET_FREE() g_memoryMonitor.getFreeHeap()
 #define MEMORY_GET_STATUS() g_memoryMonitor.getStatus()
 
-// ============================================================================
-// MEMORY MONITORING TASK PRIORITY
-// ============================================================================
-#define MEMORY_MONITOR_TASK_PRIORITY TASK_PRIORITY_SYSTEM_MONITOR
-#define MEMORY_MONITOR_TASK_STACK_SIZE 2048
-
 #endif // MEMORY_MONITOR_H
@@ -2,6 +2,12 @@
  * Memory Pool Manager
  * Efficient memory allocation for embedded systems
  * Prevents heap fragmentation and stack overflows
+ *
+ * Fixed-size blocks in build-time size classes. Each class keeps a free bitmap
+ * (first free block by count-trailing-zeros) under a short spinlock, and each
+ * core keeps a small magazine of free block indices per class, so most
+ * allocate/deallocate pairs only touch the local core's magazine. Requests
+ * larger than the biggest class fall back to the heap.
  */
 
 #ifndef MEMORY_POOL_H
@@ -10,28 +16,52 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <atomic>
 
 // ============================================================================
 // MEMORY POOL CONFIGURATION (Optimized for no-PSRAM StampS3A)
 // ============================================================================
+#ifndef MEMORY_POOL_SMALL_BLOCKS
 #define MEMORY_POOL_SMALL_BLOCKS   8     // Number of small blocks (32 bytes each)
+#endif
+#ifndef MEMORY_POOL_MEDIUM_BLOCKS
 #define MEMORY_POOL_MEDIUM_BLOCKS  4     // Number of medium blocks (128 bytes each)
+#endif
+#ifndef MEMORY_POOL_LARGE_BLOCKS
 #define MEMORY_POOL_LARGE_BLOCKS   2     // Number of large blocks (512 bytes each)
+#endif
 
+#ifndef MEMORY_POOL_SMALL_SIZE
 #define MEMORY_POOL_SMALL_SIZE    32
+#endif
+#ifndef MEMORY_POOL_MEDIUM_SIZE
 #define MEMORY_POOL_MEDIUM_SIZE   128
+#endif
+#ifndef MEMORY_POOL_LARGE_SIZE
 #define MEMORY_POOL_LARGE_SIZE   512
+#endif
 
-// ============================================================================
-// MEMORY BLOCK STRUCTURE
-// ============================================================================
-struct MemoryBlock {
-    bool inUse;
-    size_t size;
-    void* data;
-    TaskHandle_t owner;
-    uint32_t timestamp;
-};
+// Size classes, smallest first, as X(blockBytes, blockCount). Override the whole
+// list to add or reshape classes; block sizes must be multiples of 8.
+#ifndef MEMORY_POOL_CLASSES
+#define MEMORY_POOL_CLASSES(X)                                  \
+    X(MEMORY_POOL_SMALL_SIZE, MEMORY_POOL_SMALL_BLOCKS)         \
+    X(MEMORY_POOL_MEDIUM_SIZE, MEMORY_POOL_MEDIUM_BLOCKS)       \
+    X(MEMORY_POOL_LARGE_SIZE, MEMORY_POOL_LARGE_BLOCKS)
+#endif
+
+#ifndef MEMORY_POOL_MAGAZINE_SIZE
+#define MEMORY_POOL_MAGAZINE_SIZE 4      // cached free blocks per core and class (at most)
+#endif
+
+// Poison freed blocks, check the poison on allocate and catch double frees
+#ifndef MEMORY_POOL_DEBUG
+#define MEMORY_POOL_DEBUG 0
+#endif
+#define MEMORY_POOL_POISON 0xA5
+
+#define MEMORY_POOL_CLASS_ONE(size, count) +1
+#define MEMORY_POOL_CLASS_COUNT (0 MEMORY_POOL_CLASSES(MEMORY_POOL_CLASS_ONE))
 
 // ============================================================================
 // MEMORY POOL CLASS
@@ -39,49 +69,77 @@ struct MemoryBlock {
 class MemoryPool {
 private:
     static MemoryPool* instance;
-    
-    // Memory pools
-    MemoryBlock smallBlocks[MEMORY_POOL_SMALL_BLOCKS];
-    MemoryBlock mediumBlocks[MEMORY_POOL_MEDIUM_BLOCKS];
-    MemoryBlock largeBlocks[MEMORY_POOL_LARGE_BLOCKS];
-    
+
+    static constexpr size_t kClassCount = MEMORY_POOL_CLASS_COUNT;
+    static constexpr size_t kCores = portNUM_PROCESSORS;
+    static constexpr size_t kMaxWords = 4;          // free bitmap words: up to 128 blocks per class
+
+    struct SizeClass {
+        uint8_t* base;
+        uint16_t blockSize;
+        uint16_t blockCount;
+        uint8_t magazineCap;                        // 0 = class too small to cache per core
+        uint32_t freeMap[kMaxWords];                // bit set = free, under classMux
+        std::atomic<uint16_t> inUse;
+        uint16_t peakInUse;
+#if MEMORY_POOL_DEBUG
+        std::atomic<uint32_t> liveMap[kMaxWords];   // bit set = handed out
+#endif
+    };
+
+    struct Magazine {
+        portMUX_TYPE mux;
+        uint8_t count;
+        uint8_t slots[MEMORY_POOL_MAGAZINE_SIZE];
+    };
+
+    SizeClass classes[kClassCount];
+    Magazine magazines[kCores][kClassCount];
+    portMUX_TYPE classMux;
+
     // Pool statistics
-    size_t totalAllocated;
-    size_t peakUsage;
-    uint32_t allocCount;
-    uint32_t freeCount;
-    uint32_t fragmentationCount;
-    
-    // Mutex for thread safety
-    SemaphoreHandle_t poolMutex;
-    
+    std::atomic<size_t> totalAllocated;
+    std::atomic<size_t> peakUsage;
+    std::atomic<uint32_t> allocCount;
+    std::atomic<uint32_t> freeCount;
+    std::atomic<uint32_t> fragmentationCount;    // heap fallbacks and failed allocations
+
     MemoryPool();
-    
+
+    int classOf(const void* ptr, uint16_t& index) const;
+    int takeBlock(size_t cls);
+    void returnBlock(size_t cls, uint16_t index);
+    int popFreeLocked(SizeClass& c);
+    void releaseLocked(SizeClass& c, uint16_t index);
+    void drainMagazine(size_t core, size_t cls);
+
 public:
     // Singleton access
     static MemoryPool* getInstance();
-    
+
     // Memory allocation
     void* allocate(size_t size);
     void deallocate(void* ptr);
-    
+
     // Pool management
     void initialize();
-    void cleanup();
-    void defragment();
-    
+    void cleanup();        // marks every block free; only safe with nothing outstanding
+    void defragment();     // returns the per-core cached blocks to the shared bitmaps
+
     // Statistics
     size_t getAllocatedSize() const { return totalAllocated; }
     size_t getPeakUsage() const { return peakUsage; }
     uint32_t getAllocationCount() const { return allocCount; }
     uint32_t getFreeCount() const { return freeCount; }
     uint32_t getFragmentationCount() const { return fragmentationCount; }
-    
+
     // Diagnostics
     void printStatistics() const;
     void printPoolStatus() const;
+    // True for a pointer to the start of a pool block; with MEMORY_POOL_DEBUG also
+    // requires the block to be allocated
     bool isValidPointer(void* ptr) const;
-    
+
     // Destructor
     ~MemoryPool();
 };
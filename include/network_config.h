@@ -136,16 +136,33 @@ struct BufferEntry {
     uint16_t size;
     char* data;
     bool is_compressed;
+    uint16_t next;               // next slot in its priority queue or the free list
 };
 
+#define NETWORK_BUFFER_PRIORITIES 4
+#define BUFFER_SLOT_NONE 0xFFFF
+
+struct BufferQueue {
+    uint16_t head;               // oldest entry, flushed or evicted first
+    uint16_t tail;               // newest entry
+};
+
+// One slot array shared by a FIFO queue per priority and a free list, all
+// linked through BufferEntry::next: enqueue, flush and evicting the oldest
+// entry of the lowest priority are O(1), with no scans or compaction however
+// full the buffer gets.
 struct NetworkBuffer {
-    BufferEntry* entries;
+    BufferEntry* entries;        // allocated on first use
     uint16_t capacity;
     uint16_t count;
+    uint16_t free_head;
+    BufferQueue queues[NETWORK_BUFFER_PRIORITIES];  // Indexed by BufferPriority
     uint32_t total_size;
     uint32_t max_size;
-    uint8_t priority_levels[4];  // Count per priority level
-    bool overflow;
+    uint16_t priority_levels[NETWORK_BUFFER_PRIORITIES];  // Count per priority level
+    bool overflow;               // data dropped since the buffer last drained
+    uint32_t evicted;            // older entries dropped to make room
+    uint32_t rejected;           // refused, buffer full of more important data
 };
 
 // ============================================================================
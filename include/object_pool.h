@@ -0,0 +1,177 @@
+/*
+ * Typed Object Pool
+ * Statically sized storage for N objects of one type, for structs created and
+ * destroyed on hot paths. Objects are placement-constructed in the pool's own
+ * array, so nothing touches the heap and nothing rounds up to a MemoryPool
+ * bucket. The free set is a bitmap (first free slot by count-trailing-zeros)
+ * under a spinlock held only for the bit update.
+ *
+ * Each pool publishes ObjectPoolStats; MemoryMonitor::registerPool() adds it to
+ * the monitor's report (in use, high-water mark, exhausted count).
+ *
+ *   static ObjectPool<Job, 8> s_jobs("jobs");
+ *   auto job = s_jobs.make(args...);   // Handle; destroyed when it goes out of scope
+ *   if (!job) { ... pool exhausted ... }
+ */
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <new>
+#include <utility>
+
+struct ObjectPoolStats {
+    const char* name;
+    uint16_t objectSize;
+    uint16_t capacity;
+    volatile uint16_t inUse;
+    volatile uint16_t highWater;
+    volatile uint32_t exhausted;   // create() calls that found the pool full
+};
+
+template <typename T, size_t N>
+class ObjectPool {
+    static_assert(N > 0 && N <= 256, "ObjectPool holds 1-256 objects");
+
+public:
+    // RAII owner of one pooled object; the typed counterpart of MemoryGuard.
+    // Movable, not copyable.
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(ObjectPool* pool, T* obj) : pool_(pool), obj_(obj) {}
+        Handle(Handle&& other) : pool_(other.pool_), obj_(other.obj_) { other.obj_ = nullptr; }
+        Handle& operator=(Handle&& other) {
+            if (this != &other) {
+                reset();
+                pool_ = other.pool_;
+                obj_ = other.obj_;
+                other.obj_ = nullptr;
+            }
+            return *this;
+        }
+        ~Handle() { reset(); }
+
+        T* get() const { return obj_; }
+        T* operator->() const { return obj_; }
+        T& operator*() const { return *obj_; }
+        explicit operator bool() const { return obj_ != nullptr; }
+
+        // Gives up ownership; the caller must hand the object to pool->destroy()
+        T* release() {
+            T* temp = obj_;
+            obj_ = nullptr;
+            return temp;
+        }
+
+        void reset() {
+            if (obj_) {
+                pool_->destroy(obj_);
+                obj_ = nullptr;
+            }
+        }
+
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+    private:
+        ObjectPool* pool_ = nullptr;
+        T* obj_ = nullptr;
+    };
+
+    explicit ObjectPool(const char* name) : mux_(portMUX_INITIALIZER_UNLOCKED) {
+        stats_.name = name;
+        stats_.objectSize = static_cast<uint16_t>(sizeof(T));
+        stats_.capacity = static_cast<uint16_t>(N);
+        stats_.inUse = 0;
+        stats_.highWater = 0;
+        stats_.exhausted = 0;
+        for (size_t w = 0; w < kWords; w++) {
+            const size_t bits = N - w * 32;
+            freeMap_[w] = bits >= 32 ? 0xFFFFFFFFu : ((1u << bits) - 1);
+        }
+    }
+
+    ~ObjectPool() = default;   // objects still alive are not destroyed
+
+    // Constructs a T in a free slot; nullptr when all N are in use
+    template <typename... Args>
+    T* create(Args&&... args) {
+        int slot = -1;
+        portENTER_CRITICAL(&mux_);
+        for (size_t w = 0; w < kWords; w++) {
+            if (freeMap_[w]) {
+                slot = static_cast<int>(w * 32) + __builtin_ctz(freeMap_[w]);
+                freeMap_[w] &= freeMap_[w] - 1;
+                break;
+            }
+        }
+        if (slot < 0) {
+            stats_.exhausted = stats_.exhausted + 1;
+        } else {
+            const uint16_t used = static_cast<uint16_t>(stats_.inUse + 1);
+            stats_.inUse = used;
+            if (used > stats_.highWater) stats_.highWater = used;
+        }
+        portEXIT_CRITICAL(&mux_);
+        if (slot < 0) {
+            return nullptr;
+        }
+        return new (storage_[slot]) T(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    Handle make(Args&&... args) {
+        return Handle(this, create(std::forward<Args>(args)...));
+    }
+
+    // Destroys an object from create(); other pointers and repeats are ignored
+    void destroy(T* obj) {
+        const int slot = slotOf(obj);
+        if (slot < 0) {
+            return;
+        }
+        const uint32_t bit = 1u << (slot % 32);
+        portENTER_CRITICAL(&mux_);
+        const bool live = !(freeMap_[slot / 32] & bit);
+        portEXIT_CRITICAL(&mux_);
+        if (!live) {
+            return;   // already destroyed
+        }
+        obj->~T();
+        portENTER_CRITICAL(&mux_);
+        freeMap_[slot / 32] |= bit;
+        stats_.inUse = static_cast<uint16_t>(stats_.inUse - 1);
+        portEXIT_CRITICAL(&mux_);
+    }
+
+    bool owns(const T* obj) const { return slotOf(obj) >= 0; }
+    size_t capacity() const { return N; }
+    size_t inUse() const { return stats_.inUse; }
+    const ObjectPoolStats* stats() const { return &stats_; }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+private:
+    static constexpr size_t kWords = (N + 31) / 32;
+
+    int slotOf(const T* obj) const {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(obj);
+        const uint8_t* base = storage_[0];
+        if (!obj || p < base || p >= base + sizeof(storage_)) {
+            return -1;
+        }
+        const size_t off = static_cast<size_t>(p - base);
+        return off % sizeof(T) == 0 ? static_cast<int>(off / sizeof(T)) : -1;
+    }
+
+    alignas(T) uint8_t storage_[N][sizeof(T)];
+    uint32_t freeMap_[kWords];   // bit set = free
+    portMUX_TYPE mux_;
+    ObjectPoolStats stats_;
+};
+
+#endif // OBJECT_POOL_H
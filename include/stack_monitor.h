@@ -15,6 +15,7 @@
 // STACK MONITORING CONFIGURATION
 // ============================================================================
 #define STACK_MONITOR_CHECK_INTERVAL_MS  10000  // Check every 10 seconds
+#define STACK_MONITOR_JOB_BUDGET_US      10000  // Service job run-time budget
 #define STACK_MONITOR_ENABLED          ENABLE_STACK_MONITORING
 
 // ============================================================================
@@ -53,9 +54,14 @@ private:
     // Mutex for thread safety
     SemaphoreHandle_t monitorMutex;
     
+    // Service job (service_task.h)
+    int serviceJob;
+    
     StackMonitor();
     
     // Internal methods
+    static void monitorJob(void* ctx);
+    void runChecks();
     void updateTaskStackInfo(StackInfo& info);
     void checkStackOverflow(const StackInfo& info);
     void reportStackIssue(const StackInfo& info);
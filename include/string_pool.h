@@ -1,9 +1,18 @@
 /*
  * String Pool Header
  * StampPLC CatM+GNSS FreeRTOS Modularization
- * 
+ *
  * Provides string pooling for frequently used strings to reduce heap fragmentation
- * 
+ *
+ * Pooled strings are packed end to end in one arena and found through an
+ * open-addressing (linear probing) hash index, so a lookup costs one hash and
+ * usually one strcmp. A returned pointer stays valid until the string is
+ * released or ages out; released strings stay indexed and are revived by the
+ * next lookup, and their arena space is reused only when a new string needs it.
+ *
+ * Compile-time constant strings never enter the pool: POOL_STRING("OK") and the
+ * STR_* constants below resolve to the literal itself, in flash.
+ *
  * SPDX-License-Identifier: MIT
  * Copyright (c) 2025 M5Stack Technology CO LTD
  */
@@ -12,20 +21,31 @@
 #define STRING_POOL_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
 
 // ============================================================================
 // STRING POOL CONFIGURATION
 // ============================================================================
-#define STRING_POOL_SIZE 32
-#define MAX_STRING_LENGTH 64
+#ifndef STRING_POOL_SLOTS
+#define STRING_POOL_SLOTS 64           // hash index slots (power of two)
+#endif
+#ifndef STRING_POOL_ARENA_BYTES
+#define STRING_POOL_ARENA_BYTES 1024   // packed string storage, terminators included
+#endif
+#define MAX_STRING_LENGTH 64           // longer strings are not pooled (terminator included)
+
+// Entries the index holds before released strings are evicted for new ones
+#define STRING_POOL_SIZE (STRING_POOL_SLOTS * 3 / 4)
 
 // ============================================================================
 // STRING POOL ENTRY
 // ============================================================================
 struct StringPoolEntry {
-    char string[MAX_STRING_LENGTH];
-    bool inUse;
+    uint32_t hash;
     uint32_t lastUsed;
+    uint16_t offset;   // into the arena
+    uint8_t cap;       // arena bytes owned; 0 = empty slot
+    bool inUse;        // false = released or aged out, still findable
 };
 
 // ============================================================================
@@ -33,34 +53,45 @@ struct StringPoolEntry {
 // ============================================================================
 class StringPool {
 private:
-    StringPoolEntry pool[STRING_POOL_SIZE];
-    SemaphoreHandle_t mutex;
+    static_assert((STRING_POOL_SLOTS & (STRING_POOL_SLOTS - 1)) == 0, "STRING_POOL_SLOTS must be a power of two");
+    static_assert(STRING_POOL_ARENA_BYTES <= 65535, "arena offsets are 16-bit");
+
+    StringPoolEntry index[STRING_POOL_SLOTS];
+    char arena[STRING_POOL_ARENA_BYTES];
+    uint16_t arenaUsed;       // bump pointer
+    uint16_t entryCount;      // occupied index slots, released ones included
+    mutable portMUX_TYPE mux;
+    bool ready;
     uint32_t totalAllocations;
     uint32_t totalHits;
-    
+
     // Private methods
-    int findAvailableSlot();
-    int findExistingString(const char* str);
+    static uint32_t hashOf(const char* str, size_t& len);
+    int findExistingString(const char* str, uint32_t hash) const;
+    int findAvailableSlot(uint32_t hash) const;
+    int takeSpan(size_t need, uint8_t& cap);
+    void freeSpan(uint16_t offset, uint8_t cap);
+    void removeEntry(int slot);
     void cleanupUnusedStrings();
 
 public:
     StringPool();
     ~StringPool();
-    
+
     // Pool management
     bool begin();
     void shutdown();
-    
+
     // String operations
     const char* getString(const char* str);
     void releaseString(const char* str);
-    
+
     // Statistics
     uint32_t getTotalAllocations() const { return totalAllocations; }
     uint32_t getTotalHits() const { return totalHits; }
     uint32_t getUsedSlots() const;
     void printStatistics() const;
-    
+
     // Cleanup
     void cleanup();
 };
@@ -73,20 +104,21 @@ extern StringPool g_stringPool;
 // ============================================================================
 // CONVENIENCE MACROS
 // ============================================================================
-#define POOL_STRING(str) g_stringPool.getString(str)
+// Constant strings are already interned by the compiler; only runtime buffers are looked up
+#define POOL_STRING(str) (__builtin_constant_p(str) ? (const char*)(str) : g_stringPool.getString(str))
 #define RELEASE_STRING(str) g_stringPool.releaseString(str)
 
 // ============================================================================
 // COMMON STRING CONSTANTS
 // ============================================================================
-extern const char* STR_OK;
-extern const char* STR_ERROR;
-extern const char* STR_TIMEOUT;
-extern const char* STR_CONNECTED;
-extern const char* STR_DISCONNECTED;
-extern const char* STR_INITIALIZING;
-extern const char* STR_READY;
-extern const char* STR_FAILED;
-extern const char* STR_SUCCESS;
+constexpr char STR_OK[] = "OK";
+constexpr char STR_ERROR[] = "ERROR";
+constexpr char STR_TIMEOUT[] = "TIMEOUT";
+constexpr char STR_CONNECTED[] = "CONNECTED";
+constexpr char STR_DISCONNECTED[] = "DISCONNECTED";
+constexpr char STR_INITIALIZING[] = "INITIALIZING";
+constexpr char STR_READY[] = "READY";
+constexpr char STR_FAILED[] = "FAILED";
+constexpr char STR_SUCCESS[] = "SUCCESS";
 
 #endif // STRING_POOL_H
@@ -2,13 +2,17 @@
 #define TRANSPORT_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 static constexpr size_t TRANSPORT_MAX_PACKET_BYTES = 768;
-static constexpr size_t TRANSPORT_QUEUE_DEPTH = 8;
+static constexpr size_t TRANSPORT_QUEUE_DEPTH = 32;           // queued packets (descriptors)
+static constexpr size_t TRANSPORT_ARENA_BYTES = 6144;          // shared variable-length payload storage
 static constexpr size_t TRANSPORT_MAX_HOST_LEN = 64;
 static constexpr size_t TRANSPORT_MAX_PATH_LEN = 128;
 static constexpr size_t TRANSPORT_MAX_SHARED_KEYS = 128;
 static constexpr size_t TRANSPORT_MAX_TOKEN_LEN = 80;
+static constexpr size_t TRANSPORT_MAX_DATAGRAM_BYTES = 1400;   // coalescing buffer; below SIM7080G CASEND limit
 
 #ifndef TRANSPORT_DEFAULT_BEAM_HOST
 #define TRANSPORT_DEFAULT_BEAM_HOST "beam.soracom.io"
@@ -25,6 +29,12 @@ static constexpr size_t TRANSPORT_MAX_TOKEN_LEN = 80;
 #ifndef TRANSPORT_DEFAULT_SHARED_KEYS
 #define TRANSPORT_DEFAULT_SHARED_KEYS "report_period_s,rpm_alert,ota_url"
 #endif
+#ifndef TRANSPORT_MODEM_SOCKET_CID
+#define TRANSPORT_MODEM_SOCKET_CID 0
+#endif
+#ifndef TRANSPORT_MODEM_LOCK_MS
+#define TRANSPORT_MODEM_LOCK_MS 3000UL
+#endif
 #ifndef TRANSPORT_DEFAULT_BASE_RETRY_MS
 #define TRANSPORT_DEFAULT_BASE_RETRY_MS 1000UL
 #endif
@@ -34,11 +44,109 @@ static constexpr size_t TRANSPORT_MAX_TOKEN_LEN = 80;
 #ifndef TRANSPORT_DEFAULT_MAX_ATTEMPTS
 #define TRANSPORT_DEFAULT_MAX_ATTEMPTS 6
 #endif
+#ifndef TRANSPORT_DEFAULT_MTU_BYTES
+#define TRANSPORT_DEFAULT_MTU_BYTES 1200
+#endif
+#ifndef TRANSPORT_DEFAULT_MAX_HOLD_MS
+#define TRANSPORT_DEFAULT_MAX_HOLD_MS 5000UL   // 0 = send each record as soon as it is queued
+#endif
+// Per-class send deadlines, measured from enqueue; 0 = none (sent after everything that has one)
+#ifndef TRANSPORT_DEFAULT_ALARM_DEADLINE_MS
+#define TRANSPORT_DEFAULT_ALARM_DEADLINE_MS 10000UL
+#endif
+#ifndef TRANSPORT_DEFAULT_TELEMETRY_DEADLINE_MS
+#define TRANSPORT_DEFAULT_TELEMETRY_DEADLINE_MS 60000UL
+#endif
+#ifndef TRANSPORT_DEFAULT_ATTRIBUTES_DEADLINE_MS
+#define TRANSPORT_DEFAULT_ATTRIBUTES_DEADLINE_MS 300000UL
+#endif
+#ifndef TRANSPORT_DEFAULT_BACKFILL_DEADLINE_MS
+#define TRANSPORT_DEFAULT_BACKFILL_DEADLINE_MS 0UL
+#endif
+#ifndef TRANSPORT_ALARM_MAX_BACKOFF_MS
+#define TRANSPORT_ALARM_MAX_BACKOFF_MS 5000UL  // alarm retries stay this close together
+#endif
+// Optional delivery confirmation for Beam UDP. Each datagram is prefixed with a 4-byte
+// header [0xA7][flags][seq u16 LE], flags bit0 = ACK requested, bit1 = session start (sent
+// until the first ACK; the receiver resets its window). The receiver answers on the same
+// socket with the text "#A<cum>:<mask>" (hex): every seq up to cum arrived and mask bit i
+// reports cum + 2 + i. A datagram is retransmitted, re-coalesced under a new seq, when a
+// later one is reported as arrived or after TRANSPORT_ACK_TIMEOUT_MS.
+#ifndef TRANSPORT_RELIABLE_ENABLE
+#define TRANSPORT_RELIABLE_ENABLE 0
+#endif
+#ifndef TRANSPORT_ACK_TIMEOUT_MS
+#define TRANSPORT_ACK_TIMEOUT_MS 4000UL
+#endif
+#ifndef TRANSPORT_ACK_WINDOW
+#define TRANSPORT_ACK_WINDOW 8                 // unacknowledged datagrams in flight
+#endif
+// Optional LZSS stage (lzss.h) between the coalescer and the socket. A compressed datagram,
+// behind the reliability header when that is enabled, is [0xC5][version << 4 | method]
+// [raw length u16 LE][LZSS stream]. It is only used when smaller than the raw bytes; any
+// other first byte means an uncompressed datagram.
+#ifndef TRANSPORT_COMPRESS_ENABLE
+#define TRANSPORT_COMPRESS_ENABLE 0
+#endif
+#ifndef TRANSPORT_COMPRESS_MIN_BYTES
+#define TRANSPORT_COMPRESS_MIN_BYTES 96        // smaller datagrams go out as they are
+#endif
+
+// Path router: every datagram goes out on the cheapest healthy path that accepts its kind
+// and falls over to the next one on failure. Cost is the payload plus the path's protocol
+// overhead, scaled by its recent success rate, plus its latency in bytes (alarms weigh
+// latency 4x). TRANSPORT_PATH_FAIL_LIMIT failures in a row cool a path down, doubling
+// from TRANSPORT_PATH_COOLDOWN_MS; it is probed again once the cooldown ends.
+#ifndef TRANSPORT_PATH_FAIL_LIMIT
+#define TRANSPORT_PATH_FAIL_LIMIT 3
+#endif
+#ifndef TRANSPORT_PATH_COOLDOWN_MS
+#define TRANSPORT_PATH_COOLDOWN_MS 15000UL
+#endif
+#ifndef TRANSPORT_PATH_MAX_COOLDOWN_MS
+#define TRANSPORT_PATH_MAX_COOLDOWN_MS 300000UL
+#endif
+#ifndef TRANSPORT_ROUTER_MS_PER_BYTE
+#define TRANSPORT_ROUTER_MS_PER_BYTE 10        // latency worth one byte of airtime
+#endif
+#define TRANSPORT_UDP_OVERHEAD_BYTES  28        // IPv4 + UDP
+#define TRANSPORT_MQTT_OVERHEAD_BYTES 110       // TCP/IP, PUBLISH header and topic, PUBACK
+#define TRANSPORT_HTTP_OVERHEAD_BYTES 700       // request and response headers, TCP/TLS records
 
 enum class TransportPacketKind : uint8_t {
     Telemetry = 0,
-    Attributes = 1
+    Attributes = 1,
+    TelemetryBinary = 2    // telemetry_codec frame instead of JSON text
+};
+
+// Scheduling class. Alarms go ahead of everything that is due, are never held back for
+// coalescing and retry on a short backoff; the other classes are sent earliest deadline
+// first. Records only coalesce with records of the same kind and class. Diagnostic
+// records go only when nothing else is due, never push other records out of the queue
+// and are dropped rather than spilled.
+enum class TransportPriority : uint8_t {
+    Alarm = 0,
+    Telemetry = 1,
+    Attributes = 2,
+    Backfill = 3,          // records drained back from the SD spill queue
+    Diagnostic = 4         // remote log stream (log_uplink)
+};
+static constexpr size_t TRANSPORT_PRIORITY_COUNT = 5;
+
+enum class TransportPathId : uint8_t {
+    ModemUdp = 0,          // SIM7080G socket, Beam UDP
+    TinyGsmUdp,
+    WifiUdp,
+    Mqtt,                  // registered by the owner of the client (transport_registerPath)
+    Http,
 };
+static constexpr size_t TRANSPORT_PATH_COUNT = 5;
+
+// External path: sends one datagram-sized batch of kind (coalesced JSON array or merged
+// object; never compressed or framed) and returns true once the far end accepted it.
+typedef bool (*TransportPathSendFn)(TransportPacketKind kind, const uint8_t* data, size_t len, void* ctx);
+// Called on the enqueuing task after a record is queued (lets the sending task sleep until there is work)
+typedef void (*TransportQueuedFn)(void* ctx);
 
 struct TransportConfig {
     char beamHost[TRANSPORT_MAX_HOST_LEN];
@@ -50,6 +158,28 @@ struct TransportConfig {
     uint8_t maxAttempts;
     uint32_t baseRetryDelayMs;
     uint32_t jitterMs;
+    uint16_t mtuBytes;          // coalesced datagram limit (a single larger record still goes alone)
+    uint32_t maxHoldMs;         // longest a fresh record waits for others to share its datagram
+    uint32_t deadlineMs[TRANSPORT_PRIORITY_COUNT];   // indexed by TransportPriority; 0 = none
+};
+
+struct TransportPathStats {
+    uint32_t attempts = 0;
+    uint32_t successes = 0;
+    uint32_t failures = 0;               // includes ACK timeouts with TRANSPORT_RELIABLE_ENABLE
+    uint32_t bytes = 0;                  // payload plus estimated protocol overhead
+    uint32_t latencyMs = 0;              // moving average of successful sends
+    uint16_t successPermille = 1000;     // moving average
+    uint8_t consecutiveFailures = 0;
+    bool healthy = true;                 // false while cooling down
+};
+
+struct TransportClassStats {
+    uint32_t queued = 0;
+    uint32_t sent = 0;
+    uint32_t late = 0;                   // sent after the class deadline
+    uint32_t lost = 0;                   // dropped or out of attempts without reaching the spill
+    uint32_t maxLatencyMs = 0;           // enqueue to successful send
 };
 
 struct TransportStats {
@@ -58,6 +188,38 @@ struct TransportStats {
     uint32_t retries = 0;
     uint32_t dropped = 0;
     uint32_t failed = 0;
+    uint32_t datagrams = 0;              // records per datagram = sent / datagrams
+    uint8_t lastRecordsPerDatagram = 0;
+    uint8_t maxRecordsPerDatagram = 0;
+    uint32_t spilled = 0;                // records written to the SD spill queue
+    uint32_t spillDrained = 0;           // spilled records moved back into the RAM queue
+    uint32_t spillLost = 0;              // corrupt records and segments discarded by the size cap
+    uint32_t spillPendingBytes = 0;
+    uint32_t acked = 0;                  // datagrams confirmed by an ACK (TRANSPORT_RELIABLE_ENABLE)
+    uint32_t ackTimeouts = 0;
+    uint32_t ackGaps = 0;                // datagrams resent early because a later one was acknowledged
+    uint32_t compressed = 0;             // datagrams sent compressed (TRANSPORT_COMPRESS_ENABLE)
+    uint32_t compressRawBytes = 0;       // their size before compression
+    uint32_t compressWireBytes = 0;      // and on the wire, header included
+    uint16_t lastCompressPermille = 0;   // wire / raw of the last compressed datagram, x1000
+    TransportClassStats classes[TRANSPORT_PRIORITY_COUNT];   // indexed by TransportPriority
+    TransportPathStats paths[TRANSPORT_PATH_COUNT];          // indexed by TransportPathId
+    uint32_t failovers = 0;              // datagrams delivered on other than the first-choice path
+    uint32_t dnsHits = 0;                // Beam host address served from the name cache
+    uint32_t dnsLookups = 0;             // AT+CDNSGIP issued (first use, expiry, refresh)
+    uint32_t dnsFailures = 0;
+    uint32_t dnsStale = 0;               // last known address used after a failed lookup
+};
+
+// In-place enqueue: transport_reserve() hands out maxLen bytes of the packet arena, the
+// caller serializes straight into data and then commits the bytes written (or aborts).
+// Keep reservations short; an open one holds back reclaiming everything queued after it.
+// priority starts as the kind's default class and may be changed before the commit.
+struct TransportReservation {
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+    int16_t slot = -1;
+    TransportPriority priority = TransportPriority::Telemetry;
 };
 
 TransportConfig transport_makeDefaultConfig();
@@ -65,16 +227,37 @@ bool transport_configure(const TransportConfig& cfg);
 bool transport_init();
 bool transport_sendTelemetry(const char* json, size_t len);
 bool transport_sendAttributes(const char* json, size_t len);
-bool transport_fetchShared(char* out, size_t outSz);
+bool transport_sendTelemetryBinary(const uint8_t* frame, size_t len);
+bool transport_sendAlarm(const char* json, size_t len);        // telemetry JSON in the Alarm class
+bool transport_sendDiagnostic(const char* json, size_t len);   // telemetry JSON in the Diagnostic class
+bool transport_reserve(TransportPacketKind kind, size_t maxLen, TransportReservation& out);
+bool transport_commit(TransportReservation& r, size_t len);   // queues len bytes and runs transport_process()
+void transport_abort(TransportReservation& r);
 void transport_process();
 TransportStats transport_getStats();
+// Bytes waiting in the queue; oldestAgeMs (optional) gets the age of the oldest packet or 0 when empty
+size_t transport_pendingBytes(uint32_t* oldestAgeMs = nullptr);
 void transport_resetStats();
 
 class WiFiUDP;
 class TinyGsm;
 class TinyGsmUDP;
+class M5_SIM7080G;
 
 void transport_attachWiFiUdp(WiFiUDP* udp);
 void transport_attachTinyGsm(TinyGsm* modem, TinyGsmUDP* udp);
+// SIM7080G internal UDP socket (AT+CAOPEN/CASEND). serialMutex is the lock every other
+// user of the modem UART takes; sends are skipped while it can't be acquired.
+void transport_attachModemSocket(M5_SIM7080G* modem, SemaphoreHandle_t serialMutex);
+// Mqtt / Http paths; kindMask bit n accepts TransportPacketKind n. fn = nullptr removes it.
+void transport_registerPath(TransportPathId id, TransportPathSendFn fn, void* ctx, uint8_t kindMask,
+                            uint16_t overheadBytes);
+// One listener; fn = nullptr removes it
+void transport_setQueuedNotify(TransportQueuedFn fn, void* ctx);
+// Modem owner's task while idle: looks the Beam host up again ahead of its cache expiry, so
+// reopening the socket never waits on DNS; a changed address reopens it
+void transport_refreshDns();
+// ThingsBoard HTTP device API URL for kind; false without an access token
+bool transport_thingsboardUrl(TransportPacketKind kind, char* out, size_t outSize);
 
 #endif // TRANSPORT_H
@@ -69,6 +69,7 @@ public:
     String& operator+=(const String& rhs) { _s += rhs._s; return *this; }
     String& operator+=(const char* rhs) { _s += (rhs ? rhs : ""); return *this; }
     String& operator+=(char rhs) { _s.push_back(rhs); return *this; }
+    bool concat(const char* cstr, unsigned int len) { if (cstr) _s.append(cstr, len); return true; }
 
     friend String operator+(const String& a, const String& b) { return a._s + b._s; }
     friend bool operator==(const String& a, const char* b) { return a._s == (b ? b : ""); }
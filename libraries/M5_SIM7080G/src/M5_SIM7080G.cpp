@@ -1,27 +1,16 @@
 #include "M5_SIM7080G.h"
 
+#include <stdio.h>
+#include <string.h>
+
 #if !SIM7080G_USE_ESP_IDF
-static inline bool _endsWithCRLF(const SIM7080G_String &s) {
-    const int n = s.length();
-    return n >= 2 && s[n - 2] == '\r' && s[n - 1] == '\n';
-}
 static inline bool _isEmpty(const SIM7080G_String &s) {
     return s.length() == 0;
 }
-static inline bool _containsToken(const SIM7080G_String &s, const char *token) {
-    return s.indexOf(token) != -1;
-}
 #else
-static inline bool _endsWithCRLF(const SIM7080G_String &s) {
-    const size_t n = s.size();
-    return n >= 2 && s[n - 2] == '\r' && s[n - 1] == '\n';
-}
 static inline bool _isEmpty(const SIM7080G_String &s) {
     return s.empty();
 }
-static inline bool _containsToken(const SIM7080G_String &s, const char *token) {
-    return s.find(token) != std::string::npos;
-}
 #endif
 
 M5_SIM7080G::M5_SIM7080G() = default;
@@ -29,13 +18,27 @@ M5_SIM7080G::M5_SIM7080G() = default;
 #if !SIM7080G_USE_ESP_IDF
 void M5_SIM7080G::Init(HardwareSerial *serial, uint8_t RX, uint8_t TX, uint32_t baud) {
     _serial = serial;
+    _baud = baud;
     if (_serial) {
         _serial->begin(baud, SERIAL_8N1, RX, TX);
+#if SIM7080G_HAS_RX_SIGNAL
+        if (!_rxSignal) _rxSignal = xSemaphoreCreateBinary();
+        if (_rxSignal) {
+            // Fires from the UART driver task on FIFO threshold / RX idle timeout
+            M5_SIM7080G *self = this;
+            _serial->onReceive([self]() {
+                xSemaphoreGive(self->_rxSignal);
+                void (*fn)(void *) = self->_rxNotify;
+                if (fn) fn(self->_rxNotifyCtx);
+            }, false);
+        }
+#endif
     }
 }
 #else
 M5_SIM7080G::Status M5_SIM7080G::Init(uart_port_t port, int rxPin, int txPin, int baud, int rxBufferSize) {
     _uart_port = port;
+    _baud = static_cast<uint32_t>(baud);
 
     uart_config_t cfg{};
     cfg.baud_rate = baud;
@@ -47,12 +50,29 @@ M5_SIM7080G::Status M5_SIM7080G::Init(uart_port_t port, int rxPin, int txPin, in
 
     if (uart_param_config(_uart_port, &cfg) != ESP_OK) return Status::TransportError;
     if (uart_set_pin(_uart_port, txPin, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) return Status::TransportError;
-    if (uart_driver_install(_uart_port, rxBufferSize, 0, 0, nullptr, 0) != ESP_OK) return Status::TransportError;
+    if (uart_driver_install(_uart_port, rxBufferSize, 0, kUartEventQueueLen, &_uart_events, 0) != ESP_OK) return Status::TransportError;
+    // Line-end interrupt: wake the reader as soon as a CR/LF terminated line is in the ring
+    if (uart_enable_pattern_det_baud_intr(_uart_port, '\n', 1, 9, 0, 0) == ESP_OK) {
+        (void)uart_pattern_queue_reset(_uart_port, kUartEventQueueLen);
+    }
     _idf_uart_ready = true;
     return Status::Ok;
 }
 #endif
 
+bool M5_SIM7080G::setRxNotify(void (*fn)(void *ctx), void *ctx) {
+#if !SIM7080G_USE_ESP_IDF && SIM7080G_HAS_RX_SIGNAL
+    _rxNotify = nullptr;
+    _rxNotifyCtx = ctx;
+    _rxNotify = fn;
+    return fn && _serial && _rxSignal && !_backend;
+#else
+    (void)fn;
+    (void)ctx;
+    return false;
+#endif
+}
+
 uint32_t M5_SIM7080G::nowMs() const {
 #if !SIM7080G_USE_ESP_IDF
     return ::millis();
@@ -70,6 +90,7 @@ void M5_SIM7080G::delayMs(uint32_t ms) const {
 }
 
 int M5_SIM7080G::available() {
+    if (_backend) return _backend->available ? _backend->available(_backend->ctx) : 0;
 #if !SIM7080G_USE_ESP_IDF
     if (!_serial) return 0;
     return _serial->available();
@@ -82,6 +103,13 @@ int M5_SIM7080G::available() {
 }
 
 int M5_SIM7080G::readSome(uint8_t *buf, size_t maxLen, uint32_t timeout_ms) {
+    if (!buf || maxLen == 0) return 0;
+    const int n = _backend ? _backend->read(_backend->ctx, buf, maxLen, timeout_ms) : readPort(buf, maxLen, timeout_ms);
+    if (n > 0 && _tap) _tap(false, buf, static_cast<size_t>(n), _tapCtx);
+    return n;
+}
+
+int M5_SIM7080G::readPort(uint8_t *buf, size_t maxLen, uint32_t timeout_ms) {
 #if !SIM7080G_USE_ESP_IDF
     if (!_serial || !buf || maxLen == 0) return 0;
 
@@ -89,24 +117,71 @@ int M5_SIM7080G::readSome(uint8_t *buf, size_t maxLen, uint32_t timeout_ms) {
     size_t n = 0;
     while (n < maxLen && (nowMs() - start) < timeout_ms) {
         int a = _serial->available();
-        while (a-- > 0 && n < maxLen) {
-            int b = _serial->read();
-            if (b < 0) break;
-            buf[n++] = static_cast<uint8_t>(b);
+        if (a > 0) {
+            // Bulk copy out of the driver ring instead of a read() call per byte
+            const size_t want = (static_cast<size_t>(a) < maxLen - n) ? static_cast<size_t>(a) : (maxLen - n);
+            n += _serial->readBytes(buf + n, want);
         }
         if (n > 0) break;
+#if SIM7080G_HAS_RX_SIGNAL
+        if (_rxSignal) {
+            const uint32_t elapsed = nowMs() - start;
+            if (elapsed >= timeout_ms) break;
+            (void)xSemaphoreTake(_rxSignal, pdMS_TO_TICKS(timeout_ms - elapsed));
+            continue;
+        }
+#endif
         delayMs(1);
     }
     return static_cast<int>(n);
 #else
     if (!_idf_uart_ready || !buf || maxLen == 0) return 0;
-    const int n = uart_read_bytes(_uart_port, buf, maxLen, pdMS_TO_TICKS(timeout_ms));
+
+    size_t buffered = 0;
+    (void)uart_get_buffered_data_len(_uart_port, &buffered);
+    if (buffered == 0 && _uart_events && timeout_ms > 0) {
+        // Sleep on the driver event queue until data or a line end arrives
+        const uint32_t start = nowMs();
+        bool haveData = false;
+        while (!haveData) {
+            const uint32_t elapsed = nowMs() - start;
+            if (elapsed >= timeout_ms) return 0;
+            uart_event_t ev;
+            if (xQueueReceive(_uart_events, &ev, pdMS_TO_TICKS(timeout_ms - elapsed)) != pdTRUE) return 0;
+            switch (ev.type) {
+                case UART_DATA:
+                    haveData = true;
+                    break;
+                case UART_PATTERN_DET:
+                    // Positions are only used as a wake-up; keep the record queue from filling
+                    while (uart_pattern_pop_pos(_uart_port) != -1) {}
+                    haveData = true;
+                    break;
+                case UART_FIFO_OVF:
+                case UART_BUFFER_FULL:
+                    _rxOverflows++;
+                    (void)uart_flush_input(_uart_port);
+                    (void)xQueueReset(_uart_events);
+                    return 0;
+                default:
+                    break;
+            }
+        }
+        (void)uart_get_buffered_data_len(_uart_port, &buffered);
+    }
+    if (buffered == 0) {
+        const int n = uart_read_bytes(_uart_port, buf, maxLen, _uart_events ? 0 : pdMS_TO_TICKS(timeout_ms));
+        return n > 0 ? n : 0;
+    }
+    const int n = uart_read_bytes(_uart_port, buf, buffered < maxLen ? buffered : maxLen, 0);
     return n > 0 ? n : 0;
 #endif
 }
 
 bool M5_SIM7080G::writeAll(const uint8_t *buf, size_t len) {
     if (!buf || len == 0) return true;
+    if (_tap) _tap(true, buf, len, _tapCtx);
+    if (_backend) return _backend->write(_backend->ctx, buf, len);
 #if !SIM7080G_USE_ESP_IDF
     if (!_serial) return false;
     const size_t n = _serial->write(buf, len);
@@ -119,86 +194,289 @@ bool M5_SIM7080G::writeAll(const uint8_t *buf, size_t len) {
 #endif
 }
 
+bool M5_SIM7080G::readLineStartingWith(const char *prefix, char *rest, size_t rest_size, uint32_t timeout_ms) {
+    if (!prefix || !rest || rest_size == 0) return false;
+    const size_t prefixLen = strlen(prefix);
+    char line[64];
+    size_t used = 0;
+    const uint32_t start = nowMs();
+    while ((nowMs() - start) < timeout_ms) {
+        uint8_t c;
+        if (readSome(&c, 1, timeout_ms - (nowMs() - start)) != 1) continue;
+        if (c == '\r') continue;
+        if (c != '\n') {
+            if (used < sizeof(line) - 1) line[used++] = static_cast<char>(c);
+            continue;
+        }
+        line[used] = '\0';
+        used = 0;
+        if (strncmp(line, prefix, prefixLen) == 0) {
+            strncpy(rest, line + prefixLen, rest_size - 1);
+            rest[rest_size - 1] = '\0';
+            return true;
+        }
+        if (strncmp(line, "ERROR", 5) == 0 || strncmp(line, "+CME ERROR", 10) == 0) return false;
+    }
+    return false;
+}
+
+size_t M5_SIM7080G::readExact(uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    size_t got = 0;
+    const uint32_t start = nowMs();
+    while (got < len && (nowMs() - start) < timeout_ms) {
+        const int n = readSome(buf + got, len - got, timeout_ms - (nowMs() - start));
+        if (n > 0) got += static_cast<size_t>(n);
+    }
+    return got;
+}
+
 void M5_SIM7080G::flushInput() {
+    // Let registered URC handlers see whatever is queued before it is discarded.
+    (void)pollUrcs(0);
+    _parser.reset();
+    if (_tap || _backend) {
+        // Discarded through readSome() so the transcript keeps these bytes too
+        uint8_t buf[64];
+        while (available() > 0 && readSome(buf, sizeof(buf), 1) > 0) {}
+        if (_backend) return;
+    }
 #if !SIM7080G_USE_ESP_IDF
     if (!_serial) return;
     while (_serial->available() > 0) (void)_serial->read();
 #else
     if (!_idf_uart_ready) return;
     (void)uart_flush_input(_uart_port);
+    if (_uart_events) (void)xQueueReset(_uart_events);
 #endif
 }
 
-M5_SIM7080G::AtResponse M5_SIM7080G::sendCommand(const SIM7080G_String &command, uint32_t timeout_ms, bool flush_input) {
-    if (flush_input) flushInput();
-
+static void _appendLine(const char *line, size_t len, void *ctx) {
+    // Re-frame each line the way the modem sends it (V1 "\r\n<line>\r\n") so callers
+    // that search the raw text for tokens keep working.
+    SIM7080G_String *out = static_cast<SIM7080G_String *>(ctx);
+    if (!out) return;
 #if !SIM7080G_USE_ESP_IDF
-    SIM7080G_String cmd = command;
-    if (!_endsWithCRLF(cmd)) cmd += "\r\n";
+    *out += "\r\n";
+    out->concat(line, len);
+    *out += "\r\n";
 #else
-    SIM7080G_String cmd = command;
-    if (!_endsWithCRLF(cmd)) cmd.append("\r\n");
+    out->append("\r\n");
+    out->append(line, len);
+    out->append("\r\n");
 #endif
+}
 
-#if !SIM7080G_USE_ESP_IDF
-    const uint8_t *cmdBytes = reinterpret_cast<const uint8_t *>(cmd.c_str());
-    const size_t cmdLen = cmd.length();
-#else
-    const uint8_t *cmdBytes = reinterpret_cast<const uint8_t *>(cmd.data());
-    const size_t cmdLen = cmd.size();
-#endif
+sim7080g::FinalResult M5_SIM7080G::pump(uint32_t wait_ms, sim7080g::LineSink sink, void *sinkCtx) {
+    // Lines already buffered from a previous read come first
+    sim7080g::FinalResult fr = _parser.process(sink, sinkCtx);
+    if (fr != sim7080g::FinalResult::None) return fr;
 
-    if (!writeAll(cmdBytes, cmdLen)) {
-        AtResponse out{};
-        out.status = Status::TransportError;
-        out.raw = SIM7080G_String{};
-        return out;
+    uint8_t buf[128];
+    const int n = readSome(buf, sizeof(buf), wait_ms);
+    size_t off = 0;
+    while (off < static_cast<size_t>(n > 0 ? n : 0)) {
+        off += _parser.feed(buf + off, static_cast<size_t>(n) - off);
+        fr = _parser.process(sink, sinkCtx);
+        if (fr != sim7080g::FinalResult::None) {
+            // Keep the tail for the next command / URC pass
+            if (off < static_cast<size_t>(n)) (void)_parser.feed(buf + off, static_cast<size_t>(n) - off);
+            return fr;
+        }
     }
+    return sim7080g::FinalResult::None;
+}
 
-    SIM7080G_String resp;
-    const uint32_t start = nowMs();
-    uint32_t last_rx = start;
+namespace {
+struct ResponseBuffer {
+    char *buf;
+    size_t size;
+    size_t len;
+};
+}  // namespace
+
+static void _appendLineToBuffer(const char *line, size_t len, void *ctx) {
+    // Same V1 framing as _appendLine, written in place; overflow is truncated.
+    ResponseBuffer *out = static_cast<ResponseBuffer *>(ctx);
+    if (!out || !out->buf || out->size == 0) return;
+    const char *parts[3] = {"\r\n", line, "\r\n"};
+    const size_t lens[3] = {2, len, 2};
+    for (int i = 0; i < 3; i++) {
+        const size_t room = out->size - 1 - out->len;
+        const size_t n = lens[i] < room ? lens[i] : room;
+        memcpy(out->buf + out->len, parts[i], n);
+        out->len += n;
+    }
+    out->buf[out->len] = '\0';
+}
+
+bool M5_SIM7080G::writeCommand(const char *command) {
+    // Written straight from the caller's buffer; the terminator goes out as a second write
+    // instead of building a terminated copy.
+    if (!command) return false;
+    const size_t n = strlen(command);
+    if (!writeAll(reinterpret_cast<const uint8_t *>(command), n)) return false;
+    if (n >= 2 && command[n - 2] == '\r' && command[n - 1] == '\n') return true;
+    return writeAll(reinterpret_cast<const uint8_t *>("\r\n"), 2);
+}
 
+M5_SIM7080G::Status M5_SIM7080G::collect(uint32_t timeout_ms, sim7080g::LineSink sink, void *sinkCtx,
+                                         sim7080g::AbortCheck abort, void *abortCtx) {
+    const uint32_t start = nowMs();
     while ((nowMs() - start) < timeout_ms) {
-        uint8_t buf[256];
-        const int n = readSome(buf, sizeof(buf), 50);
-        if (n > 0) {
-#if !SIM7080G_USE_ESP_IDF
-            for (int i = 0; i < n; i++) resp += static_cast<char>(buf[i]);
-#else
-            resp.append(reinterpret_cast<const char *>(buf), static_cast<size_t>(n));
-#endif
-            last_rx = nowMs();
-            if (_containsToken(resp, "\r\nOK\r\n") || _containsToken(resp, "\nOK\r\n") || _containsToken(resp, "\r\nOK\n") || _containsToken(resp, "OK\r\n")) {
-                AtResponse out{};
-                out.status = Status::Ok;
-                out.raw = resp;
-                return out;
+        if (abort && abort(abortCtx)) {
+            // Any character aborts; the final result that follows still belongs to this command
+            const uint8_t c = '\r';
+            if (!writeAll(&c, 1)) {
+                _parser.endCommand();
+                return Status::TransportError;
             }
-            if (_containsToken(resp, "ERROR")) {
-                AtResponse out{};
-                out.status = Status::Error;
-                out.raw = resp;
-                return out;
-            }
-        } else {
-            // If we've received something and it's gone quiet briefly, return it (caller may parse URCs)
-            if (!_isEmpty(resp) && (nowMs() - last_rx) > 120) {
-                // Not a hard OK/ERROR, but don't block forever for chatty URCs.
+            (void)collect(SIM7080G_ABORT_WAIT_MS, sink, sinkCtx);
+            return Status::Aborted;
+        }
+        const uint32_t left = timeout_ms - (nowMs() - start);
+        const sim7080g::FinalResult fr = pump(left < 20 ? left : 20, sink, sinkCtx);
+        switch (fr) {
+            case sim7080g::FinalResult::Ok:
+            case sim7080g::FinalResult::Prompt:
+                return Status::Ok;
+            case sim7080g::FinalResult::Error:
+            case sim7080g::FinalResult::CmeError:
+            case sim7080g::FinalResult::CmsError:
+                return Status::Error;
+            case sim7080g::FinalResult::None:
                 break;
-            }
-            delayMs(2);
         }
     }
+    _parser.endCommand();
+    return Status::Timeout;
+}
+
+M5_SIM7080G::Status M5_SIM7080G::execute(const char *command, bool expect_prompt, bool flush_input, uint32_t timeout_ms,
+                                         sim7080g::LineSink sink, void *sinkCtx, sim7080g::AbortCheck abort,
+                                         void *abortCtx) {
+    if (flush_input) flushInput();
+
+    _parser.beginCommand(command, expect_prompt);
+    if (!writeCommand(command)) {
+        _parser.endCommand();
+        return Status::TransportError;
+    }
+    return collect(timeout_ms, sink, sinkCtx, abort, abortCtx);
+}
+
+M5_SIM7080G::AtResponse M5_SIM7080G::sendCommand(const SIM7080G_String &command, uint32_t timeout_ms, bool flush_input) {
     AtResponse out{};
-    out.status = Status::Timeout;
-    out.raw = resp;
+    out.status = execute(command.c_str(), false, flush_input, timeout_ms, &_appendLine, &out.raw);
+    return out;
+}
+
+M5_SIM7080G::Status M5_SIM7080G::sendCommandInto(const char *command, char *response, size_t response_size,
+                                                 uint32_t timeout_ms, bool flush_input) {
+    ResponseBuffer out{response, response_size, 0};
+    if (response && response_size > 0) response[0] = '\0';
+    return execute(command, false, flush_input, timeout_ms, response ? &_appendLineToBuffer : nullptr, &out);
+}
+
+M5_SIM7080G::Status M5_SIM7080G::sendCommandAbortable(const char *command, char *response, size_t response_size,
+                                                      uint32_t timeout_ms, sim7080g::AbortCheck abort,
+                                                      void *abort_ctx) {
+    ResponseBuffer out{response, response_size, 0};
+    if (response && response_size > 0) response[0] = '\0';
+    return execute(command, false, true, timeout_ms, response ? &_appendLineToBuffer : nullptr, &out, abort,
+                   abort_ctx);
+}
+
+M5_SIM7080G::AtResponse M5_SIM7080G::sendCommandForPrompt(const char *command, uint32_t timeout_ms) {
+    AtResponse out{};
+    out.status = execute(command, true, true, timeout_ms, &_appendLine, &out.raw);
+    return out;
+}
+
+size_t M5_SIM7080G::sendBatch(sim7080g::AtBatchItem *items, size_t count) {
+    if (!items || count == 0) return 0;
+    for (size_t i = 0; i < count; i++) {
+        items[i].executed = false;
+        items[i].ok = false;
+        items[i].status = Status::Timeout;
+        items[i].elapsed_ms = 0;
+    }
+
+    // Only the first command discards stale input; replies are framed by the parser so
+    // anything left over belongs to a URC and is dispatched, not mixed into the next reply.
+    char resp[256];
+    size_t okCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        sim7080g::AtBatchItem &item = items[i];
+        if (!item.command) continue;
+
+        const uint32_t t0 = nowMs();
+        const Status st = sendCommandInto(item.command, item.expect ? resp : nullptr, sizeof(resp), item.timeout_ms, i == 0);
+        item.executed = true;
+        item.status = st;
+        item.elapsed_ms = nowMs() - t0;
+        item.ok = item.expect ? (strstr(resp, item.expect) != nullptr) : (st == Status::Ok);
+        if (item.ok) {
+            okCount++;
+        } else if (item.required || st == Status::TransportError) {
+            break;
+        }
+    }
+    return okCount;
+}
+
+M5_SIM7080G::AtResponse M5_SIM7080G::waitForFinal(uint32_t timeout_ms) {
+    _parser.continueCommand();
+    AtResponse out{};
+    out.status = collect(timeout_ms, &_appendLine, &out.raw);
+    return out;
+}
+
+bool M5_SIM7080G::registerUrcHandler(const char *prefix, sim7080g::UrcHandler handler, void *ctx) {
+    return _parser.registerUrc(prefix, handler, ctx);
+}
+
+bool M5_SIM7080G::unregisterUrcHandler(const char *prefix) {
+    return _parser.unregisterUrc(prefix);
+}
+
+uint32_t M5_SIM7080G::pollUrcs(uint32_t timeout_ms) {
+    const uint32_t before = _parser.stats().urcs;
+    const uint32_t start = nowMs();
+    if (timeout_ms == 0) {
+        do {
+            (void)pump(0, nullptr, nullptr);
+        } while (available() > 0);
+        return _parser.stats().urcs - before;
+    }
+    // readSome() sleeps on the RX signal / UART event queue between bursts
+    while ((nowMs() - start) < timeout_ms) {
+        (void)pump(timeout_ms - (nowMs() - start), nullptr, nullptr);
+    }
+    return _parser.stats().urcs - before;
+}
+
+SIM7080G_String M5_SIM7080G::takeBuffered() {
+    // Raw readers bypass line framing; hand them anything the parser is still holding.
+    SIM7080G_String out;
+    char partial[sim7080g::AtLineParser::kLineMax];
+    const size_t p = _parser.takePartial(partial, sizeof(partial));
+    uint8_t raw[64];
+#if !SIM7080G_USE_ESP_IDF
+    out.concat(partial, p);
+    for (size_t n = _parser.takeRaw(raw, sizeof(raw)); n > 0; n = _parser.takeRaw(raw, sizeof(raw))) {
+        out.concat(reinterpret_cast<const char *>(raw), n);
+    }
+#else
+    out.append(partial, p);
+    for (size_t n = _parser.takeRaw(raw, sizeof(raw)); n > 0; n = _parser.takeRaw(raw, sizeof(raw))) {
+        out.append(reinterpret_cast<const char *>(raw), n);
+    }
+#endif
     return out;
 }
 
 bool M5_SIM7080G::checkStatus(uint32_t timeout_ms) {
-    const auto r = sendCommand("AT", timeout_ms, true);
-    return r.status == Status::Ok;
+    return sendCommandInto("AT", nullptr, 0, timeout_ms, true) == Status::Ok;
 }
 
 bool M5_SIM7080G::wakeup(int attempts, uint32_t timeout_ms, uint32_t inter_attempt_delay_ms) {
@@ -210,6 +488,65 @@ bool M5_SIM7080G::wakeup(int attempts, uint32_t timeout_ms, uint32_t inter_attem
     return false;
 }
 
+bool M5_SIM7080G::setLocalBaud(uint32_t baud) {
+    if (_backend) {
+        _baud = baud;
+        _parser.reset();
+        return true;
+    }
+#if !SIM7080G_USE_ESP_IDF
+    if (!_serial) return false;
+    _serial->flush();
+    _serial->updateBaudRate(baud);
+#else
+    if (!_idf_uart_ready) return false;
+    (void)uart_wait_tx_done(_uart_port, pdMS_TO_TICKS(100));
+    if (uart_set_baudrate(_uart_port, baud) != ESP_OK) return false;
+#endif
+    _baud = baud;
+    _parser.reset();
+    return true;
+}
+
+bool M5_SIM7080G::negotiateBaud(uint32_t target_baud, bool persist, uint32_t fallback_baud) {
+    if (target_baud == 0) return false;
+    if (target_baud == _baud) return checkStatus(500);
+
+    char cmd[24];
+    snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", static_cast<unsigned long>(target_baud));
+    // The modem answers OK at the old rate, then switches
+    if (sendCommandInto(cmd, nullptr, 0, 1000, true) != Status::Ok) return false;
+    delayMs(50);
+
+    bool ok = setLocalBaud(target_baud) && wakeup(3, 500, 50);
+    if (ok) {
+        // Confirm the link carries a full reply cleanly at the new rate before committing to it
+        ok = sendCommandInto("ATI", nullptr, 0, 1000, true) == Status::Ok;
+    }
+    if (ok) {
+        if (persist) (void)sendCommandInto("AT&W", nullptr, 0, 2000, true);
+        return true;
+    }
+
+    // Fall back: ask the modem (possibly on the new rate) to return, then resync locally
+    snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", static_cast<unsigned long>(fallback_baud));
+    (void)sendCommandInto(cmd, nullptr, 0, 500, true);
+    delayMs(50);
+    (void)setLocalBaud(fallback_baud);
+    (void)wakeup(3, 500, 50);
+    return false;
+}
+
+bool M5_SIM7080G::detectBaud(const uint32_t *rates, size_t count, uint32_t timeout_ms) {
+    if (!rates) return false;
+    for (size_t i = 0; i < count; i++) {
+        if (rates[i] == 0) continue;
+        if (rates[i] != _baud && !setLocalBaud(rates[i])) continue;
+        if (wakeup(2, timeout_ms, 50)) return true;
+    }
+    return false;
+}
+
 SIM7080G_String M5_SIM7080G::waitMsg(unsigned long time) {
     // Back-compat behavior:
     // - time == 0: non-blocking read (whatever is available right now)
@@ -218,7 +555,7 @@ SIM7080G_String M5_SIM7080G::waitMsg(unsigned long time) {
         return getMsg();
     }
 
-    SIM7080G_String resp;
+    SIM7080G_String resp = takeBuffered();
     const uint32_t start = nowMs();
     uint32_t last_rx = start;
     while ((nowMs() - start) < static_cast<uint32_t>(time)) {
@@ -251,7 +588,7 @@ void M5_SIM7080G::sendMsg(SIM7080G_String command) {
 
 
 SIM7080G_String M5_SIM7080G::getMsg() {
-    SIM7080G_String resp;
+    SIM7080G_String resp = takeBuffered();
     while (available() > 0) {
         uint8_t buf[256];
         const int n = readSome(buf, sizeof(buf), 10);
@@ -263,7 +600,7 @@ SIM7080G_String M5_SIM7080G::getMsg() {
 #endif
     }
     return resp;
-}   
+}
 
 SIM7080G_String M5_SIM7080G::send_and_getMsg(SIM7080G_String str, uint32_t timeout_ms) {
     const auto r = sendCommand(str, timeout_ms, true);
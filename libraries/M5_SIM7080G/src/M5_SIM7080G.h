@@ -1,9 +1,23 @@
 #pragma once
 
 #include "SIM7080G_Common.h"
+#include "SIM7080G_AtParser.h"
+#include "SIM7080G_FixedString.h"
 
 #if SIM7080G_USE_ESP_IDF
   #include "driver/uart.h"
+  #include "freertos/queue.h"
+#elif defined(ESP32) && defined(ESP_ARDUINO_VERSION_MAJOR) && (ESP_ARDUINO_VERSION_MAJOR >= 2)
+  // HardwareSerial::onReceive() lets readSome() sleep until the UART driver has data
+  #include <freertos/FreeRTOS.h>
+  #include <freertos/semphr.h>
+  #define SIM7080G_HAS_RX_SIGNAL 1
+#endif
+#ifndef SIM7080G_HAS_RX_SIGNAL
+  #define SIM7080G_HAS_RX_SIGNAL 0
+#endif
+#ifndef SIM7080G_ABORT_WAIT_MS
+  #define SIM7080G_ABORT_WAIT_MS 3000
 #endif
 
 class M5_SIM7080G {
@@ -17,38 +31,124 @@ class M5_SIM7080G {
 #if !SIM7080G_USE_ESP_IDF
     void Init(HardwareSerial *serial = &Serial2, uint8_t RX = 16, uint8_t TX = 17, uint32_t baud = 115200);
 #else
+    // Installs the driver with an event queue and '\n' pattern detection so reads block until
+    // a line (or a driver timeout chunk) arrives instead of polling.
     Status Init(uart_port_t port, int rxPin, int txPin, int baud = 115200, int rxBufferSize = 2048);
 #endif
 
     bool checkStatus(uint32_t timeout_ms = 1000);
     AtResponse sendCommand(const SIM7080G_String &command, uint32_t timeout_ms = 1000, bool flush_input = true);
+    // Allocation-free variant: the command is written straight from the caller's buffer and the
+    // reply (V1 framed, truncated to fit) lands in response. response may be null.
+    Status sendCommandInto(const char *command, char *response, size_t response_size,
+                           uint32_t timeout_ms = 1000, bool flush_input = true);
+    // sendCommandInto() for commands that run for minutes (AT+COPS=?): abort is polled every
+    // read slice and, once it says so, one character is written to abort the command (V.250).
+    // Returns Status::Aborted after the modem's final result or SIM7080G_ABORT_WAIT_MS.
+    Status sendCommandAbortable(const char *command, char *response, size_t response_size, uint32_t timeout_ms,
+                                sim7080g::AbortCheck abort, void *abort_ctx);
+    template <size_t N>
+    Status sendCommandInto(const sim7080g::FixedString<N> &command, char *response, size_t response_size,
+                           uint32_t timeout_ms = 1000, bool flush_input = true) {
+      return sendCommandInto(command.c_str(), response, response_size, timeout_ms, flush_input);
+    }
     bool wakeup(int attempts = 6, uint32_t timeout_ms = 1000, uint32_t inter_attempt_delay_ms = 200);
 
+    // UART rate. negotiateBaud() switches both ends with AT+IPR, verifies with AT and optionally saves
+    // it on the modem (AT&W); on any failure both ends are put back on fallback_baud.
+    bool negotiateBaud(uint32_t target_baud, bool persist = true, uint32_t fallback_baud = 115200);
+    // Find a modem that kept a saved rate: tries each rate with AT and stays on the first that answers.
+    bool detectBaud(const uint32_t *rates, size_t count, uint32_t timeout_ms = 300);
+    uint32_t baudRate() const { return _baud; }
+    // Two-phase writes (AT+SMPUB, AT+CMGS, ...): completes on the '>' prompt (Status::Ok) or an error.
+    AtResponse sendCommandForPrompt(const char *command, uint32_t timeout_ms = 1000);
+    // Run commands back to back: the next one is written as soon as the previous final result is
+    // parsed, with no input flush or delay in between. Returns the number of items that succeeded.
+    size_t sendBatch(sim7080g::AtBatchItem *items, size_t count);
+    // Keep waiting for the final result of the command in flight (e.g. after a prompted payload).
+    AtResponse waitForFinal(uint32_t timeout_ms = 1000);
+
+    // Unsolicited result codes. Handlers run on the caller's task from inside
+    // sendCommand()/pollUrcs(); the line pointer is only valid during the call.
+    bool registerUrcHandler(const char *prefix, sim7080g::UrcHandler handler, void *ctx = nullptr);
+    bool unregisterUrcHandler(const char *prefix);
+    // Read for up to timeout_ms and dispatch any URCs. Returns the number dispatched.
+    uint32_t pollUrcs(uint32_t timeout_ms = 0);
+    const sim7080g::AtLineParser::Stats &parserStats() const { return _parser.stats(); }
+    uint32_t rxOverflows() const { return _rxOverflows; }
+
     // Back-compat API (kept for existing examples)
     SIM7080G_String waitMsg(unsigned long time_ms);
     void sendMsg(SIM7080G_String command);
     SIM7080G_String getMsg();
     SIM7080G_String send_and_getMsg(SIM7080G_String str, uint32_t timeout_ms = 1000);
 
+    // Raw write (payload phase of prompted commands); no framing or CRLF added.
+    bool sendRaw(const uint8_t *data, size_t len) { return writeAll(data, len); }
+
     void flushInput();
     int available();
 
+    // Binary payloads the line parser can't frame (e.g. AT+SHREAD data). Skips
+    // input up to the next line starting with prefix and returns the rest of that
+    // line in rest; false on timeout or an ERROR line first.
+    bool readLineStartingWith(const char *prefix, char *rest, size_t rest_size, uint32_t timeout_ms);
+    // Exactly len bytes, or fewer on timeout
+    size_t readExact(uint8_t *buf, size_t len, uint32_t timeout_ms);
+
+    // Transcript hooks; both null by default. Set them before the first command:
+    // they are not synchronised with a command in flight. With a backend the
+    // UART is never touched (Init() is not needed) and baud changes are local.
+    void setTap(sim7080g::IoTap tap, void *ctx = nullptr) { _tap = tap; _tapCtx = ctx; }
+    void setBackend(const sim7080g::IoBackend *backend) { _backend = backend; }
+    bool hasBackend() const { return _backend != nullptr; }
+    // Called from the UART driver task whenever bytes arrive, so a task that is not
+    // reading can sleep until the modem says something. False where the port gives
+    // no receive signal (ESP-IDF driver, backend); poll there instead.
+    bool setRxNotify(void (*fn)(void *ctx), void *ctx = nullptr);
+
   private:
     uint32_t nowMs() const;
     void delayMs(uint32_t ms) const;
     int readSome(uint8_t *buf, size_t maxLen, uint32_t timeout_ms);
+    int readPort(uint8_t *buf, size_t maxLen, uint32_t timeout_ms);
     bool writeAll(const uint8_t *buf, size_t len);
+    bool writeCommand(const char *command);
+    Status execute(const char *command, bool expect_prompt, bool flush_input, uint32_t timeout_ms,
+                   sim7080g::LineSink sink, void *sinkCtx, sim7080g::AbortCheck abort = nullptr,
+                   void *abortCtx = nullptr);
+    Status collect(uint32_t timeout_ms, sim7080g::LineSink sink, void *sinkCtx, sim7080g::AbortCheck abort = nullptr,
+                   void *abortCtx = nullptr);
+    bool setLocalBaud(uint32_t baud);
+    sim7080g::FinalResult pump(uint32_t wait_ms, sim7080g::LineSink sink, void *sinkCtx);
+    SIM7080G_String takeBuffered();
+
+    sim7080g::AtLineParser _parser;
 
 #if !SIM7080G_USE_ESP_IDF
     HardwareSerial *_serial = nullptr;
+#if SIM7080G_HAS_RX_SIGNAL
+    SemaphoreHandle_t _rxSignal = nullptr;
+    void (*volatile _rxNotify)(void *) = nullptr;
+    void *volatile _rxNotifyCtx = nullptr;
+#endif
 #else
+    static constexpr int kUartEventQueueLen = 20;
     uart_port_t _uart_port = UART_NUM_1;
     bool _idf_uart_ready = false;
+    QueueHandle_t _uart_events = nullptr;
 #endif
+    uint32_t _rxOverflows = 0;
+    uint32_t _baud = 115200;
+    sim7080g::IoTap _tap = nullptr;
+    void *_tapCtx = nullptr;
+    const sim7080g::IoBackend *_backend = nullptr;
 };
 
 // Convenience includes so users can just `#include <M5_SIM7080G.h>`
 #include "SIM7080G_Network.h"
 #include "SIM7080G_GNSS.h"
 #include "SIM7080G_MQTT.h"
-#include "SIM7080G_HTTP.h"
\ No newline at end of file
+#include "SIM7080G_HTTP.h"
+#include "SIM7080G_Socket.h"
+#include "SIM7080G_Dns.h"
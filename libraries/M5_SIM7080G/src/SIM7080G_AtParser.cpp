@@ -0,0 +1,205 @@
+#include "SIM7080G_AtParser.h"
+
+#include <string.h>
+
+namespace sim7080g {
+
+bool AtLineParser::startsWith(const char *line, size_t len, const char *prefix, size_t prefixLen) {
+  if (prefixLen == 0 || len < prefixLen) return false;
+  return memcmp(line, prefix, prefixLen) == 0;
+}
+
+FinalResult AtLineParser::classifyFinal(const char *line, size_t len) {
+  if (len == 2 && line[0] == 'O' && line[1] == 'K') return FinalResult::Ok;
+  if (len == 5 && memcmp(line, "ERROR", 5) == 0) return FinalResult::Error;
+  if (startsWith(line, len, "+CME ERROR", 10)) return FinalResult::CmeError;
+  if (startsWith(line, len, "+CMS ERROR", 10)) return FinalResult::CmsError;
+  return FinalResult::None;
+}
+
+bool AtLineParser::registerUrc(const char *prefix, UrcHandler handler, void *ctx) {
+  if (!prefix || !handler) return false;
+  const size_t n = strlen(prefix);
+  if (n == 0 || n > kMaxPrefixLen) return false;
+
+  UrcEntry *slot = nullptr;
+  for (auto &e : _urcs) {
+    if (e.handler && e.prefixLen == n && memcmp(e.prefix, prefix, n) == 0) {
+      slot = &e;  // re-register replaces the existing handler
+      break;
+    }
+    if (!slot && !e.handler) slot = &e;
+  }
+  if (!slot) return false;
+
+  memcpy(slot->prefix, prefix, n);
+  slot->prefix[n] = '\0';
+  slot->prefixLen = static_cast<uint8_t>(n);
+  slot->handler = handler;
+  slot->ctx = ctx;
+  return true;
+}
+
+bool AtLineParser::unregisterUrc(const char *prefix) {
+  if (!prefix) return false;
+  const size_t n = strlen(prefix);
+  for (auto &e : _urcs) {
+    if (e.handler && e.prefixLen == n && memcmp(e.prefix, prefix, n) == 0) {
+      e = UrcEntry();
+      return true;
+    }
+  }
+  return false;
+}
+
+void AtLineParser::beginCommand(const char *command, bool expectPrompt) {
+  _pending = true;
+  _expectPrompt = expectPrompt;
+  _respPrefixLen = 0;
+  _respPrefix[0] = '\0';
+  if (!command) return;
+
+  // "AT+CGNSINF" / "AT+CEREG?" / "AT+CNACT=0,1" -> "+CGNSINF" / "+CEREG" / "+CNACT"
+  const char *p = command;
+  if ((p[0] == 'A' || p[0] == 'a') && (p[1] == 'T' || p[1] == 't')) p += 2;
+  if (*p != '+') return;
+
+  size_t n = 0;
+  while (p[n] && p[n] != '=' && p[n] != '?' && p[n] != ';' && p[n] != '\r' && p[n] != '\n' && n < kMaxPrefixLen) {
+    _respPrefix[n] = p[n];
+    n++;
+  }
+  _respPrefix[n] = '\0';
+  _respPrefixLen = static_cast<uint8_t>(n);
+}
+
+void AtLineParser::continueCommand() {
+  _pending = true;
+  _expectPrompt = false;
+}
+
+void AtLineParser::endCommand() {
+  _pending = false;
+  _expectPrompt = false;
+  _respPrefixLen = 0;
+  _respPrefix[0] = '\0';
+}
+
+size_t AtLineParser::feed(const uint8_t *data, size_t len) {
+  if (!data) return 0;
+  size_t accepted = 0;
+  while (accepted < len && _count < kRingSize) {
+    _ring[_head] = data[accepted++];
+    _head = (_head + 1) % kRingSize;
+    _count++;
+  }
+  if (accepted < len) _stats.ringOverflows++;
+  return accepted;
+}
+
+FinalResult AtLineParser::handleLine(LineSink sink, void *sinkCtx) {
+  const char *line = _line;
+  const size_t len = _lineLen;
+  _stats.lines++;
+
+  if (_pending) {
+    const FinalResult fr = classifyFinal(line, len);
+    if (fr != FinalResult::None) {
+      if (sink) sink(line, len, sinkCtx);
+      return fr;
+    }
+    if (startsWith(line, len, _respPrefix, _respPrefixLen)) {
+      if (sink) sink(line, len, sinkCtx);
+      return FinalResult::None;
+    }
+  }
+
+  for (const auto &e : _urcs) {
+    if (e.handler && startsWith(line, len, e.prefix, e.prefixLen)) {
+      _stats.urcs++;
+      e.handler(line, len, e.ctx);
+      return FinalResult::None;
+    }
+  }
+
+  if (_pending) {
+    if (sink) sink(line, len, sinkCtx);
+  } else {
+    _stats.unclaimed++;
+  }
+  return FinalResult::None;
+}
+
+FinalResult AtLineParser::process(LineSink sink, void *sinkCtx) {
+  FinalResult result = FinalResult::None;
+  while (_count > 0) {
+    const char c = static_cast<char>(_ring[_tail]);
+    _tail = (_tail + 1) % kRingSize;
+    _count--;
+
+    if (c == '\r' || c == '\n') {
+      if (_lineLen > 0) {
+        if (_lineTruncated) _stats.lineOverflows++;
+        _line[_lineLen] = '\0';
+        const FinalResult fr = handleLine(sink, sinkCtx);
+        _lineLen = 0;
+        _lineTruncated = false;
+        if (fr != FinalResult::None) {
+          endCommand();
+          result = fr;
+          break;  // leave trailing bytes for the next command / URC pass
+        }
+      }
+      continue;
+    }
+
+    if (_lineLen < kLineMax) {
+      _line[_lineLen++] = c;
+    } else {
+      _lineTruncated = true;
+    }
+
+    // '>' prompt arrives without a line terminator
+    if (_pending && _expectPrompt && _lineLen == 1 && _line[0] == '>') {
+      _lineLen = 0;
+      if (_count > 0 && _ring[_tail] == ' ') {
+        _tail = (_tail + 1) % kRingSize;
+        _count--;
+      }
+      _pending = false;
+      _expectPrompt = false;
+      result = FinalResult::Prompt;
+      break;
+    }
+  }
+  return result;
+}
+
+size_t AtLineParser::takePartial(char *out, size_t outSize) {
+  if (!out || outSize == 0) return 0;
+  const size_t n = (_lineLen < outSize) ? _lineLen : outSize;
+  memcpy(out, _line, n);
+  _lineLen = 0;
+  _lineTruncated = false;
+  return n;
+}
+
+size_t AtLineParser::takeRaw(uint8_t *out, size_t outSize) {
+  if (!out) return 0;
+  size_t n = 0;
+  while (_count > 0 && n < outSize) {
+    out[n++] = _ring[_tail];
+    _tail = (_tail + 1) % kRingSize;
+    _count--;
+  }
+  return n;
+}
+
+void AtLineParser::reset() {
+  _head = _tail = _count = 0;
+  _lineLen = 0;
+  _lineTruncated = false;
+  endCommand();
+}
+
+}  // namespace sim7080g
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Streaming AT line parser.
+//
+// Bytes are pushed into a fixed ring as they arrive from the UART and split into
+// CR/LF terminated lines. Each line is classified as:
+//   - a final result code (OK / ERROR / +CME ERROR / +CMS ERROR / '>' prompt)
+//     completing the command currently in flight,
+//   - an information response belonging to that command (prefix matches the
+//     command, e.g. "+CEREG: ..." while "AT+CEREG?" is pending),
+//   - an unsolicited result code routed to a registered handler, or
+//   - an unclaimed line (handed to the command sink while a command is pending,
+//     otherwise counted and dropped).
+//
+// Handlers receive a pointer into the parser's line buffer; nothing is copied and
+// the pointer is only valid for the duration of the call.
+
+namespace sim7080g {
+  enum class FinalResult : uint8_t {
+    None = 0,
+    Ok,
+    Error,
+    CmeError,
+    CmsError,
+    Prompt,
+  };
+
+  using UrcHandler = void (*)(const char *line, size_t len, void *ctx);
+  using LineSink = void (*)(const char *line, size_t len, void *ctx);
+
+  class AtLineParser {
+    public:
+      static constexpr size_t kRingSize = 1024;
+      static constexpr size_t kLineMax = 256;
+      static constexpr size_t kMaxUrcHandlers = 12;
+      static constexpr size_t kMaxPrefixLen = 15;
+
+      struct Stats {
+        uint32_t lines = 0;
+        uint32_t urcs = 0;
+        uint32_t unclaimed = 0;
+        uint32_t ringOverflows = 0;
+        uint32_t lineOverflows = 0;
+      };
+
+      AtLineParser() = default;
+
+      // URC registry. Prefix is matched against the start of a line (e.g. "+CEREG").
+      bool registerUrc(const char *prefix, UrcHandler handler, void *ctx = nullptr);
+      bool unregisterUrc(const char *prefix);
+
+      // Mark a command as in flight. The response prefix is derived from the
+      // command text ("AT+CGNSINF" -> "+CGNSINF"). expectPrompt makes a bare '>'
+      // complete the command (two-phase writes such as AT+SMPUB / AT+CMGS).
+      void beginCommand(const char *command, bool expectPrompt = false);
+      // Continue waiting on the current command without changing its prefix
+      // (e.g. after the payload of a two-phase write has been sent).
+      void continueCommand();
+      void endCommand();
+      bool commandPending() const { return _pending; }
+
+      // Copy raw bytes into the ring. Returns the number of bytes accepted.
+      size_t feed(const uint8_t *data, size_t len);
+
+      // Drain the ring. Response lines (including the final result line) go to
+      // sink; URCs go to their handlers. Returns the final result code if the
+      // pending command completed during this call.
+      FinalResult process(LineSink sink, void *sinkCtx);
+
+      // Hand back an unterminated partial line (used by raw readers that bypass
+      // line framing, e.g. binary SHREAD payloads). Returns bytes copied.
+      size_t takePartial(char *out, size_t outSize);
+      // Move any undrained ring bytes out for raw consumers. Returns bytes copied.
+      size_t takeRaw(uint8_t *out, size_t outSize);
+
+      void reset();
+      const Stats &stats() const { return _stats; }
+
+    private:
+      struct UrcEntry {
+        char prefix[kMaxPrefixLen + 1] = {0};
+        uint8_t prefixLen = 0;
+        UrcHandler handler = nullptr;
+        void *ctx = nullptr;
+      };
+
+      FinalResult handleLine(LineSink sink, void *sinkCtx);
+      static FinalResult classifyFinal(const char *line, size_t len);
+      static bool startsWith(const char *line, size_t len, const char *prefix, size_t prefixLen);
+
+      uint8_t _ring[kRingSize];
+      size_t _head = 0;  // write index
+      size_t _tail = 0;  // read index
+      size_t _count = 0;
+
+      char _line[kLineMax + 1];
+      size_t _lineLen = 0;
+      bool _lineTruncated = false;
+
+      UrcEntry _urcs[kMaxUrcHandlers];
+
+      bool _pending = false;
+      bool _expectPrompt = false;
+      char _respPrefix[kMaxPrefixLen + 1] = {0};
+      uint8_t _respPrefixLen = 0;
+
+      Stats _stats{};
+  };
+}  // namespace sim7080g
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 // Decide backend:
@@ -47,8 +48,12 @@ namespace sim7080g {
     Error,
     Timeout,
     TransportError,
+    Aborted,           // the caller's abort check stopped a long-running command
   };
 
+  // Polled while a command runs (see M5_SIM7080G::sendCommandAbortable); true stops it.
+  using AbortCheck = bool (*)(void *ctx);
+
   struct AtResponse {
     Status status = Status::Timeout;
     String raw{};
@@ -60,6 +65,14 @@ namespace sim7080g {
     bool valid = false;
   };
 
+  // One operator of an AT+COPS=? list
+  struct OperatorInfo {
+    uint8_t stat = 0;        // 0 unknown, 1 available, 2 current, 3 forbidden
+    char long_name[24] = {};
+    char numeric[8] = {};    // MCC and MNC digits
+    uint8_t act = 0;         // 7 E-UTRAN (CAT-M), 9 NB-IoT
+  };
+
   struct GNSSFix {
     bool valid = false;
     double latitude = 0.0;
@@ -75,9 +88,34 @@ namespace sim7080g {
     String utc{};
   };
 
+  // One entry of a back-to-back command batch (see M5_SIM7080G::sendBatch).
+  struct AtBatchItem {
+    const char *command = nullptr;
+    const char *expect = nullptr;    // optional token required in the reply (default: final OK)
+    uint32_t timeout_ms = 1000;
+    bool required = true;            // a failing required item stops the rest of the batch
+    // Filled in by sendBatch()
+    bool executed = false;
+    bool ok = false;
+    Status status = Status::Timeout;
+    uint32_t elapsed_ms = 0;
+  };
+
   struct HttpResponse {
     Status status = Status::Timeout;
     int http_status = -1;
     String body{};
   };
+
+  // Byte-level hooks (see M5_SIM7080G::setTap/setBackend). The tap sees every
+  // chunk read from or written to the modem, flushed input included.
+  using IoTap = void (*)(bool tx, const uint8_t *data, size_t len, void *ctx);
+  // Stands in for the UART, e.g. to replay a recorded transcript. read() waits
+  // up to timeout_ms for at least one byte and returns how many it copied.
+  struct IoBackend {
+    int (*read)(void *ctx, uint8_t *buf, size_t max_len, uint32_t timeout_ms) = nullptr;
+    bool (*write)(void *ctx, const uint8_t *buf, size_t len) = nullptr;
+    int (*available)(void *ctx) = nullptr;
+    void *ctx = nullptr;
+  };
 }  // namespace sim7080g
@@ -0,0 +1,202 @@
+#include "SIM7080G_Dns.h"
+
+#include <string.h>
+
+static bool _isAddress(const char *host) {
+  // Dotted quad or IPv6 text; names always carry a letter outside ':'-separated hex
+  bool colon = false;
+  bool letter = false;
+  for (const char *p = host; *p; p++) {
+    if (*p == ':') {
+      colon = true;
+    } else if (*p != '.' && (*p < '0' || *p > '9')) {
+      letter = true;
+    }
+  }
+  return colon || !letter;
+}
+
+static void _copy(char *out, size_t out_size, const char *s) {
+  const size_t n = strlen(s);
+  const size_t take = n < out_size - 1 ? n : out_size - 1;
+  memcpy(out, s, take);
+  out[take] = '\0';
+}
+
+SIM7080G_Dns::~SIM7080G_Dns() {
+  if (_urcRegistered) (void)_modem.unregisterUrcHandler("+CDNSGIP:");
+}
+
+void SIM7080G_Dns::_onResult(const char *line, size_t len, void *ctx) {
+  SIM7080G_Dns *self = static_cast<SIM7080G_Dns *>(ctx);
+  if (self) self->_parseResult(line, len);
+}
+
+void SIM7080G_Dns::_parseResult(const char *line, size_t len) {
+  // +CDNSGIP: 1,"<name>","<ip1>"[,"<ip2>"]   or   +CDNSGIP: 0,<error>
+  const char *p = static_cast<const char *>(memchr(line, ':', len));
+  if (!p) return;
+  const char *end = line + len;
+  p++;
+  while (p < end && *p == ' ') p++;
+  if (p >= end) return;
+  if (*p != '1') {
+    _result = 0;
+    return;
+  }
+  // The address is the second quoted field
+  const char *q = p;
+  for (int quote = 0; quote < 3; quote++) {
+    q = static_cast<const char *>(memchr(q, '"', end - q));
+    if (!q) return;
+    q++;
+  }
+  const char *close = static_cast<const char *>(memchr(q, '"', end - q));
+  if (!close || close == q || static_cast<size_t>(close - q) >= sizeof(_resultIp)) return;
+  memcpy(_resultIp, q, close - q);
+  _resultIp[close - q] = '\0';
+  _result = 1;
+}
+
+bool SIM7080G_Dns::lookup(const char *host, char *ip, size_t ip_size, uint32_t timeout_ms) {
+  if (!host || !host[0] || !ip || ip_size == 0) return false;
+  if (!_urcRegistered) {
+    _urcRegistered = _modem.registerUrcHandler("+CDNSGIP:", &SIM7080G_Dns::_onResult, this);
+  }
+  _stats.lookups++;
+  _result = -1;
+
+  // AT+CDNSGIP=<name>,<retries>,<timeout ms>; OK comes first, the result as a URC afterwards
+  sim7080g::FixedString<128> cmd;
+  cmd.append("AT+CDNSGIP=").appendQuoted(host).appendf(",1,%lu", static_cast<unsigned long>(timeout_ms));
+  if (cmd.truncated()) return false;
+  char resp[128];
+  if (_modem.sendCommandInto(cmd, resp, sizeof(resp), 2000, true) != M5_SIM7080G::Status::Ok) {
+    _stats.failures++;
+    return false;
+  }
+  // A fast answer can land in the reply while the command is still pending
+  const char *inReply = strstr(resp, "+CDNSGIP:");
+  if (inReply) _parseResult(inReply, strcspn(inReply, "\r\n"));
+
+  const uint32_t start = sim7080g::nowMs();
+  while (_result < 0 && (sim7080g::nowMs() - start) < timeout_ms + 1000) {
+    (void)_modem.pollUrcs(100);
+  }
+  if (_result != 1) {
+    _stats.failures++;
+    return false;
+  }
+  _copy(ip, ip_size, _resultIp);
+  return true;
+}
+
+SIM7080G_Dns::Entry *SIM7080G_Dns::_find(const char *host) {
+  for (Entry &e : _entries) {
+    if (e.host[0] && strcmp(e.host, host) == 0) return &e;
+  }
+  return nullptr;
+}
+
+const SIM7080G_Dns::Entry *SIM7080G_Dns::_find(const char *host) const {
+  for (const Entry &e : _entries) {
+    if (e.host[0] && strcmp(e.host, host) == 0) return &e;
+  }
+  return nullptr;
+}
+
+SIM7080G_Dns::Entry *SIM7080G_Dns::_slotFor(const char *host) {
+  Entry *e = _find(host);
+  if (e) return e;
+  // Empty slot, else the one used longest ago
+  Entry *victim = &_entries[0];
+  for (Entry &c : _entries) {
+    if (!c.host[0]) {
+      victim = &c;
+      break;
+    }
+    if ((int32_t)(c.usedMs - victim->usedMs) < 0) victim = &c;
+  }
+  memset(victim, 0, sizeof(*victim));
+  _copy(victim->host, sizeof(victim->host), host);
+  return victim;
+}
+
+bool SIM7080G_Dns::_update(Entry &e, uint32_t timeout_ms) {
+  char addr[SIM7080G_DNS_ADDR_LEN];
+  const bool ok = lookup(e.host, addr, sizeof(addr), timeout_ms);
+  const uint32_t now = sim7080g::nowMs();
+  if (!ok) {
+    e.retryAtMs = now + SIM7080G_DNS_RETRY_MS;
+    if (e.retryAtMs == 0) e.retryAtMs = 1;
+    return false;
+  }
+  if (e.valid && strcmp(e.ip, addr) != 0) _stats.changes++;
+  _copy(e.ip, sizeof(e.ip), addr);
+  e.valid = true;
+  e.expiresMs = now + SIM7080G_DNS_TTL_MS;
+  e.retryAtMs = 0;
+  return true;
+}
+
+bool SIM7080G_Dns::resolve(const char *host, char *ip, size_t ip_size, uint32_t timeout_ms) {
+  if (!host || !host[0] || !ip || ip_size == 0) return false;
+  if (_isAddress(host)) {
+    _copy(ip, ip_size, host);
+    return true;
+  }
+  if (strlen(host) > SIM7080G_DNS_HOST_LEN) return lookup(host, ip, ip_size, timeout_ms);
+
+  const uint32_t now = sim7080g::nowMs();
+  Entry &e = *_slotFor(host);
+  e.usedMs = now;
+  const bool fresh = e.valid && (int32_t)(e.expiresMs - now) > 0;
+  const bool backingOff = e.retryAtMs && (int32_t)(e.retryAtMs - now) > 0;
+  if (fresh) {
+    _stats.hits++;
+  } else if (!backingOff && _update(e, timeout_ms)) {
+    // looked up
+  } else if (e.valid) {
+    _stats.staleServed++;
+  } else {
+    return false;
+  }
+  _copy(ip, ip_size, e.ip);
+  return true;
+}
+
+bool SIM7080G_Dns::cached(const char *host, char *ip, size_t ip_size) const {
+  if (!host || !ip || ip_size == 0) return false;
+  const Entry *e = _find(host);
+  if (!e || !e->valid) return false;
+  _copy(ip, ip_size, e->ip);
+  return true;
+}
+
+bool SIM7080G_Dns::refreshDue() const {
+  const uint32_t now = sim7080g::nowMs();
+  for (const Entry &e : _entries) {
+    if (!e.valid || (e.retryAtMs && (int32_t)(e.retryAtMs - now) > 0)) continue;
+    if ((int32_t)(e.expiresMs - now) <= (int32_t)SIM7080G_DNS_REFRESH_AHEAD_MS) return true;
+  }
+  return false;
+}
+
+bool SIM7080G_Dns::refresh(uint32_t timeout_ms) {
+  const uint32_t now = sim7080g::nowMs();
+  Entry *next = nullptr;
+  for (Entry &e : _entries) {
+    if (!e.valid || (e.retryAtMs && (int32_t)(e.retryAtMs - now) > 0)) continue;
+    if ((int32_t)(e.expiresMs - now) > (int32_t)SIM7080G_DNS_REFRESH_AHEAD_MS) continue;
+    if (!next || (int32_t)(e.expiresMs - next->expiresMs) < 0) next = &e;
+  }
+  if (!next) return false;
+  _stats.refreshes++;
+  char before[SIM7080G_DNS_ADDR_LEN];
+  _copy(before, sizeof(before), next->ip);
+  return _update(*next, timeout_ms) && strcmp(before, next->ip) != 0;
+}
+
+void SIM7080G_Dns::clear() {
+  memset(_entries, 0, sizeof(_entries));
+}
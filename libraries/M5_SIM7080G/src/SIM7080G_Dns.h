@@ -0,0 +1,85 @@
+#pragma once
+
+#include "M5_SIM7080G.h"
+
+#ifndef SIM7080G_DNS_ENTRIES
+#define SIM7080G_DNS_ENTRIES 4
+#endif
+#ifndef SIM7080G_DNS_HOST_LEN
+#define SIM7080G_DNS_HOST_LEN 64
+#endif
+#ifndef SIM7080G_DNS_ADDR_LEN
+#define SIM7080G_DNS_ADDR_LEN 40  // IPv6 text form
+#endif
+// AT+CDNSGIP does not report the record's TTL; cached addresses are trusted this long
+#ifndef SIM7080G_DNS_TTL_MS
+#define SIM7080G_DNS_TTL_MS 1800000UL
+#endif
+// refresh() looks an address up again once it is this close to expiring
+#ifndef SIM7080G_DNS_REFRESH_AHEAD_MS
+#define SIM7080G_DNS_REFRESH_AHEAD_MS 120000UL
+#endif
+// After a failed lookup nothing is asked again for this long
+#ifndef SIM7080G_DNS_RETRY_MS
+#define SIM7080G_DNS_RETRY_MS 30000UL
+#endif
+
+// Host name cache in front of AT+CDNSGIP, so sockets can open to an address instead of having
+// the modem resolve the name on every open. Addresses expire after SIM7080G_DNS_TTL_MS; a
+// lookup that fails keeps serving the last address that worked. One instance per modem owns
+// the +CDNSGIP handler. Nothing is locked; callers serialize access to the modem.
+class SIM7080G_Dns {
+  public:
+    struct Stats {
+      uint32_t hits = 0;          // answered from the cache
+      uint32_t lookups = 0;       // AT+CDNSGIP issued
+      uint32_t failures = 0;
+      uint32_t staleServed = 0;   // expired address handed out after a failed lookup
+      uint32_t refreshes = 0;     // ahead-of-expiry lookups from refresh()
+      uint32_t changes = 0;       // lookups that returned a different address
+    };
+
+    explicit SIM7080G_Dns(M5_SIM7080G &modem) : _modem(modem) {}
+    ~SIM7080G_Dns();
+
+    // Address of host into ip: an IP literal as is, else the cached address while fresh, else
+    // a lookup, else the last known address. false only when none of these has one.
+    bool resolve(const char *host, char *ip, size_t ip_size, uint32_t timeout_ms = 10000);
+    // Cached address only, fresh or not; never talks to the modem
+    bool cached(const char *host, char *ip, size_t ip_size) const;
+    // An entry is within SIM7080G_DNS_REFRESH_AHEAD_MS of expiring and may be looked up again
+    bool refreshDue() const;
+    // Looks up the entry closest to expiry if it is due. Returns true if its address changed.
+    bool refresh(uint32_t timeout_ms = 10000);
+    // Uncached AT+CDNSGIP
+    bool lookup(const char *host, char *ip, size_t ip_size, uint32_t timeout_ms = 10000);
+    void clear();
+
+    const Stats &stats() const { return _stats; }
+
+  private:
+    struct Entry {
+      char host[SIM7080G_DNS_HOST_LEN + 1];
+      char ip[SIM7080G_DNS_ADDR_LEN];
+      bool valid;                 // ip holds an address that resolved at some point
+      uint32_t expiresMs;
+      uint32_t retryAtMs;         // no lookup before this after a failure; 0 = none
+      uint32_t usedMs;
+    };
+
+    static void _onResult(const char *line, size_t len, void *ctx);
+    void _parseResult(const char *line, size_t len);
+    Entry *_find(const char *host);
+    const Entry *_find(const char *host) const;
+    Entry *_slotFor(const char *host);
+    // Looks up e's host; true if the lookup answered (address in e->ip)
+    bool _update(Entry &e, uint32_t timeout_ms);
+
+    M5_SIM7080G &_modem;
+    Entry _entries[SIM7080G_DNS_ENTRIES] = {};
+    bool _urcRegistered = false;
+    // Result of the lookup in flight: -1 waiting, 0 failed, 1 resolved
+    volatile int8_t _result = -1;
+    char _resultIp[SIM7080G_DNS_ADDR_LEN] = {};
+    Stats _stats{};
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Fixed-capacity, in-place string for building AT commands and holding replies
+// without touching the heap. Appends past capacity are truncated and flagged;
+// the buffer is always NUL-terminated.
+
+namespace sim7080g {
+  struct StringView {
+    const char *data = nullptr;
+    size_t size = 0;
+
+    StringView() = default;
+    StringView(const char *s) : data(s), size(s ? strlen(s) : 0) {}
+    StringView(const char *s, size_t n) : data(s), size(n) {}
+
+    bool empty() const { return size == 0; }
+    bool startsWith(const char *prefix) const {
+      const size_t n = prefix ? strlen(prefix) : 0;
+      return n <= size && memcmp(data, prefix, n) == 0;
+    }
+    // Index of needle or -1
+    int find(const char *needle, size_t from = 0) const {
+      const size_t n = needle ? strlen(needle) : 0;
+      if (n == 0 || n > size) return -1;
+      for (size_t i = from; i + n <= size; i++) {
+        if (memcmp(data + i, needle, n) == 0) return static_cast<int>(i);
+      }
+      return -1;
+    }
+  };
+
+  template <size_t N>
+  class FixedString {
+    public:
+      FixedString() { clear(); }
+      explicit FixedString(const char *s) {
+        clear();
+        append(s);
+      }
+
+      void clear() {
+        _len = 0;
+        _buf[0] = '\0';
+        _truncated = false;
+      }
+
+      FixedString &append(const char *s, size_t n) {
+        if (!s) return *this;
+        const size_t room = N - _len;
+        if (n > room) {
+          n = room;
+          _truncated = true;
+        }
+        memcpy(_buf + _len, s, n);
+        _len += n;
+        _buf[_len] = '\0';
+        return *this;
+      }
+      FixedString &append(const char *s) { return append(s, s ? strlen(s) : 0); }
+      FixedString &append(StringView v) { return append(v.data, v.size); }
+      FixedString &append(char c) { return append(&c, 1); }
+
+      FixedString &appendf(const char *fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        const int n = vsnprintf(_buf + _len, N - _len + 1, fmt, ap);
+        va_end(ap);
+        if (n < 0) {
+          _buf[_len] = '\0';
+          return *this;
+        }
+        if (static_cast<size_t>(n) > N - _len) {
+          _len = N;
+          _truncated = true;
+        } else {
+          _len += static_cast<size_t>(n);
+        }
+        return *this;
+      }
+
+      // Append a double-quoted AT string argument
+      FixedString &appendQuoted(const char *s) {
+        append('"');
+        append(s);
+        return append('"');
+      }
+
+      const char *c_str() const { return _buf; }
+      char *data() { return _buf; }
+      size_t length() const { return _len; }
+      static constexpr size_t capacity() { return N; }
+      bool truncated() const { return _truncated; }
+      bool empty() const { return _len == 0; }
+      StringView view() const { return StringView(_buf, _len); }
+
+    private:
+      char _buf[N + 1];
+      size_t _len = 0;
+      bool _truncated = false;
+  };
+}  // namespace sim7080g
@@ -1,125 +1,173 @@
 #include "SIM7080G_GNSS.h"
 
-#include <stdlib.h>
 #include <string.h>
 
-static bool _nextField(const char *&p, const char *&start, size_t &len) {
-  if (!p) return false;
-  // Skip leading spaces/commas
-  while (*p == ' ' || *p == '\t' || *p == ',') p++;
-  if (!*p) return false;
-  start = p;
-  while (*p && *p != ',' && *p != '\r' && *p != '\n') p++;
-  len = static_cast<size_t>(p - start);
-  if (*p == ',') p++;
+// Comma-separated fields of one line, in place. Empty fields are fields: the
+// reserved columns of +CGNSINF are usually blank and must still be counted.
+struct _FieldCursor {
+  const char *p;
+  const char *end;
+  bool done;
+
+  _FieldCursor(const char *s, const char *e) : p(s), end(e), done(s == nullptr) {}
+
+  bool next(const char *&start, size_t &len) {
+    if (done) return false;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    start = p;
+    while (p < end && *p != ',' && *p != '\r' && *p != '\n') p++;
+    len = static_cast<size_t>(p - start);
+    if (p < end && *p == ',') {
+      p++;
+    } else {
+      done = true;
+    }
+    return true;
+  }
+};
+
+static const uint32_t _kPow10[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// [-]digits[.digits] as mantissa / 10^scale. Fraction digits past 9 (or 18 in all) are dropped;
+// a number with no digits at all is rejected, trailing junk is not (".000" on a time).
+static bool _toFixed(const char *s, size_t len, int64_t &mant, uint8_t &scale) {
+  const char *e = s + len;
+  bool neg = false;
+  if (s < e && (*s == '-' || *s == '+')) neg = (*s++ == '-');
+  int64_t m = 0;
+  uint8_t sc = 0;
+  bool any = false;
+  for (; s < e && *s >= '0' && *s <= '9'; s++) {
+    if (m < 100000000000000000LL) m = m * 10 + (*s - '0');
+    any = true;
+  }
+  if (s < e && *s == '.') {
+    for (s++; s < e && *s >= '0' && *s <= '9'; s++) {
+      if (sc < 9 && m < 100000000000000000LL) {
+        m = m * 10 + (*s - '0');
+        sc++;
+      }
+      any = true;
+    }
+  }
+  if (!any) return false;
+  mant = neg ? -m : m;
+  scale = sc;
   return true;
 }
 
-static bool _toInt(const char *start, size_t len, int &out) {
-  if (!start || len == 0) return false;
-  char tmp[24];
-  if (len >= sizeof(tmp)) len = sizeof(tmp) - 1;
-  memcpy(tmp, start, len);
-  tmp[len] = 0;
-  char *end = nullptr;
-  long v = strtol(tmp, &end, 10);
-  if (end == tmp) return false;
-  out = static_cast<int>(v);
+static bool _toInt(const char *s, size_t len, int &out) {
+  int64_t m = 0;
+  uint8_t sc = 0;
+  if (!_toFixed(s, len, m, sc)) return false;
+  out = static_cast<int>(m / _kPow10[sc]);
   return true;
 }
 
-static bool _toDouble(const char *start, size_t len, double &out) {
-  if (!start || len == 0) return false;
-  char tmp[32];
-  if (len >= sizeof(tmp)) len = sizeof(tmp) - 1;
-  memcpy(tmp, start, len);
-  tmp[len] = 0;
-  char *end = nullptr;
-  double v = strtod(tmp, &end);
-  if (end == tmp) return false;
-  out = v;
+static bool _toDouble(const char *s, size_t len, double &out) {
+  int64_t m = 0;
+  uint8_t sc = 0;
+  if (!_toFixed(s, len, m, sc)) return false;
+  // Up to 15 digits both are exact, so the quotient is the value strtod would give
+  out = static_cast<double>(m) / static_cast<double>(_kPow10[sc]);
   return true;
 }
 
 bool SIM7080G_GNSS::powerOn(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+CGNSPWR=1", timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  return _modem.sendCommandInto("AT+CGNSPWR=1", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_GNSS::powerOff(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+CGNSPWR=0", timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  return _modem.sendCommandInto("AT+CGNSPWR=0", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
+}
+
+bool SIM7080G_GNSS::start(StartMode mode, uint32_t timeout_ms) {
+  const char *cmd = mode == StartMode::Cold ? "AT+CGNSCOLD" : mode == StartMode::Warm ? "AT+CGNSWARM" : "AT+CGNSHOT";
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
+}
+
+bool SIM7080G_GNSS::copyXtra(uint32_t timeout_ms) {
+  // "+CGNSCPY: 0" on success; a nonzero code (no file, copy failed) still ends in OK
+  char resp[48];
+  if (_modem.sendCommandInto("AT+CGNSCPY", resp, sizeof(resp), timeout_ms, true) != M5_SIM7080G::Status::Ok) return false;
+  const char *p = strstr(resp, "+CGNSCPY:");
+  if (!p) return true;
+  p += 9;
+  while (*p == ' ') p++;
+  return *p == '0';
+}
+
+bool SIM7080G_GNSS::setXtra(bool enable, uint32_t timeout_ms) {
+  return _modem.sendCommandInto(enable ? "AT+CGNSXTRA=1" : "AT+CGNSXTRA=0", nullptr, 0, timeout_ms, true) ==
+         M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_GNSS::setUpdateRate(uint32_t interval_ms, uint32_t timeout_ms) {
-  // Best-effort: many SIMCom firmwares support AT+CGNSURC=0 / AT+CGNSURC=1,<sec>
+  // AT+CGNSURC=<n> reports every n fixes (1 Hz engine); 0 disables. Some firmwares take
+  // AT+CGNSURC=1,<sec> instead, so fall back to that form.
   if (interval_ms == 0) {
-    auto r = _modem.sendCommand("AT+CGNSURC=0", timeout_ms, true);
-    return r.status == M5_SIM7080G::Status::Ok;
+    return _modem.sendCommandInto("AT+CGNSURC=0", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
   }
   uint32_t sec = interval_ms / 1000;
   if (sec == 0) sec = 1;
+  if (sec > 255) sec = 255;
+
+  sim7080g::FixedString<32> cmd;
+  cmd.appendf("AT+CGNSURC=%lu", static_cast<unsigned long>(sec));
+  if (_modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok) return true;
+  cmd.clear();
+  cmd.appendf("AT+CGNSURC=1,%lu", static_cast<unsigned long>(sec));
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
+}
 
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+CGNSURC=1,") + SIM7080G_String(sec);
-#else
-  SIM7080G_String cmd = "AT+CGNSURC=1," + std::to_string(sec);
-#endif
-  auto r = _modem.sendCommand(cmd, timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+bool SIM7080G_GNSS::parseInfo(const char *p, sim7080g::GNSSFix &fix, char *utc, size_t utc_size) {
+  return parseInfo(p, p ? strlen(p) : 0, fix, utc, utc_size);
 }
 
-sim7080g::GNSSFix SIM7080G_GNSS::getFix(uint32_t timeout_ms) {
-  sim7080g::GNSSFix fix{};
-  auto r = _modem.sendCommand("AT+CGNSINF", timeout_ms, true);
-  if (r.status != M5_SIM7080G::Status::Ok) return fix;
+bool SIM7080G_GNSS::parseInfo(const char *fields, size_t fields_len, sim7080g::GNSSFix &fix, char *utc, size_t utc_size) {
+  fix = sim7080g::GNSSFix{};
+  if (utc && utc_size > 0) utc[0] = '\0';
+  if (!fields) return false;
 
-  const char *raw = r.raw.c_str();
-  const char *p = strstr(raw, "+CGNSINF:");
-  if (!p) return fix;
-  p = strchr(p, ':');
-  if (!p) return fix;
-  p++;  // past ':'
-
-  // Fields: <run>,<fix>,<utc>,<lat>,<lon>,<alt>,<speed>,<course>,...
+  // <run>,<fix>,<utc>,<lat>,<lon>,<alt>,<speed>,<course>,<fix mode>,<reserved1>,
+  // <hdop>,<pdop>,<vdop>,<reserved2>,<satellites in view>,...
+  _FieldCursor f(fields, fields + fields_len);
   const char *s = nullptr;
   size_t len = 0;
 
   int run = 0;
   int fixStat = 0;
-  if (!_nextField(p, s, len) || !_toInt(s, len, run)) return fix;
-  if (!_nextField(p, s, len) || !_toInt(s, len, fixStat)) return fix;
+  if (!f.next(s, len) || !_toInt(s, len, run)) return false;
+  if (!f.next(s, len) || !_toInt(s, len, fixStat)) return false;
 
   // UTC
-  if (_nextField(p, s, len)) {
-#if !SIM7080G_USE_ESP_IDF
-    fix.utc = SIM7080G_String(s).substring(0, (int)len);
-#else
-    fix.utc = SIM7080G_String(s, len);
-#endif
+  if (f.next(s, len) && utc && utc_size > 0) {
+    const size_t n = len < utc_size - 1 ? len : utc_size - 1;
+    memcpy(utc, s, n);
+    utc[n] = '\0';
   }
 
   double lat = 0, lon = 0, alt = 0, spd = 0, cog = 0;
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, lat);
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, lon);
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, alt);
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, spd);
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, cog);
+  if (f.next(s, len)) (void)_toDouble(s, len, lat);
+  if (f.next(s, len)) (void)_toDouble(s, len, lon);
+  if (f.next(s, len)) (void)_toDouble(s, len, alt);
+  if (f.next(s, len)) (void)_toDouble(s, len, spd);
+  if (f.next(s, len)) (void)_toDouble(s, len, cog);
 
   // Skip Fix Mode, Reserved1
-  (void)_nextField(p, s, len);
-  (void)_nextField(p, s, len);
+  (void)f.next(s, len);
+  (void)f.next(s, len);
 
   double hd = 0.0, pd = 0.0, vd = 0.0;
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, hd);
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, pd);
-  if (_nextField(p, s, len)) (void)_toDouble(s, len, vd);
+  if (f.next(s, len)) (void)_toDouble(s, len, hd);
+  if (f.next(s, len)) (void)_toDouble(s, len, pd);
+  if (f.next(s, len)) (void)_toDouble(s, len, vd);
 
   // Skip Reserved2
-  (void)_nextField(p, s, len);
+  (void)f.next(s, len);
 
   int sats = 0;
-  if (_nextField(p, s, len)) (void)_toInt(s, len, sats);
+  if (f.next(s, len)) (void)_toInt(s, len, sats);
 
   fix.latitude = lat;
   fix.longitude = lon;
@@ -131,17 +179,74 @@ sim7080g::GNSSFix SIM7080G_GNSS::getFix(uint32_t timeout_ms) {
   fix.vdop = static_cast<float>(vd);
   fix.satellites = static_cast<uint8_t>(sats < 0 ? 0 : (sats > 255 ? 255 : sats));
   fix.valid = (run != 0) && (fixStat != 0);
+  return true;
+}
+
+sim7080g::GNSSFix SIM7080G_GNSS::getFix(uint32_t timeout_ms) {
+  sim7080g::GNSSFix fix{};
+  char utc[24];
+  if (!getFix(fix, utc, sizeof(utc), timeout_ms)) return sim7080g::GNSSFix{};
+  fix.utc = utc;
   return fix;
 }
 
+bool SIM7080G_GNSS::getFix(sim7080g::GNSSFix &fix, char *utc, size_t utc_size, uint32_t timeout_ms) {
+  fix = sim7080g::GNSSFix{};
+  if (utc && utc_size > 0) utc[0] = '\0';
+  char raw[256];
+  if (_modem.sendCommandInto("AT+CGNSINF", raw, sizeof(raw), timeout_ms, true) != M5_SIM7080G::Status::Ok) return false;
+
+  const char *p = strstr(raw, "+CGNSINF:");
+  if (!p) return false;
+  p += 9;  // past ':'
+  const char *eol = strpbrk(p, "\r\n");
+  return parseInfo(p, eol ? static_cast<size_t>(eol - p) : strlen(p), fix, utc, utc_size);
+}
+
+void SIM7080G_GNSS::_onUgnsinf(const char *line, size_t len, void *ctx) {
+  SIM7080G_GNSS *self = static_cast<SIM7080G_GNSS *>(ctx);
+  if (!self || !self->_streamCb) return;
+  const char *p = static_cast<const char *>(memchr(line, ':', len));
+  if (!p) return;
+
+  p++;  // past ':'
+  sim7080g::GNSSFix fix;
+  char utc[24];
+  if (!parseInfo(p, static_cast<size_t>(line + len - p), fix, utc, sizeof(utc))) return;
+  self->_streamedFixes++;
+  self->_streamCb(fix, utc, self->_streamCtx);
+}
+
+bool SIM7080G_GNSS::startStreaming(uint32_t interval_ms, FixCallback cb, void *ctx, uint32_t timeout_ms) {
+  if (!cb || interval_ms == 0) return false;
+  _streamCb = cb;
+  _streamCtx = ctx;
+  if (!_modem.registerUrcHandler("+UGNSINF", &SIM7080G_GNSS::_onUgnsinf, this)) {
+    _streamCb = nullptr;
+    return false;
+  }
+  if (!setUpdateRate(interval_ms, timeout_ms)) {
+    (void)_modem.unregisterUrcHandler("+UGNSINF");
+    _streamCb = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool SIM7080G_GNSS::stopStreaming(uint32_t timeout_ms) {
+  const bool ok = setUpdateRate(0, timeout_ms);
+  (void)_modem.unregisterUrcHandler("+UGNSINF");
+  _streamCb = nullptr;
+  _streamCtx = nullptr;
+  return ok;
+}
+
 bool SIM7080G_GNSS::startNMEA(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+CGNSTST=1", timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  return _modem.sendCommandInto("AT+CGNSTST=1", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_GNSS::stopNMEA(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+CGNSTST=0", timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  return _modem.sendCommandInto("AT+CGNSTST=0", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 SIM7080G_String SIM7080G_GNSS::getRawNMEA(uint32_t capture_ms) {
@@ -4,16 +4,50 @@
 
 class SIM7080G_GNSS {
   public:
+    // Streaming fix callback. fix.utc is left empty (no allocation); utc points at the raw
+    // timestamp field and, like the fix, is only valid for the duration of the call.
+    using FixCallback = void (*)(const sim7080g::GNSSFix &fix, const char *utc, void *ctx);
+
+    // Start modes of AT+CGNSCOLD / AT+CGNSWARM / AT+CGNSHOT
+    enum class StartMode : uint8_t { Cold = 0, Warm, Hot };
+
     explicit SIM7080G_GNSS(M5_SIM7080G &modem) : _modem(modem) {}
 
     bool powerOn(uint32_t timeout_ms = 5000);
     bool powerOff(uint32_t timeout_ms = 2000);
+    // Powers the receiver on with the given start mode. Warm drops the ephemeris the
+    // engine still holds, Cold also the almanac, time and position; powerOn() keeps them.
+    bool start(StartMode mode, uint32_t timeout_ms = 5000);
+
+    // XTRA assistance, receiver off: copyXtra() moves the file downloaded to
+    // the modem file system (AT+HTTPTOFS to /customer/Xtra3.bin) into the GNSS
+    // engine, setXtra() enables its use at the next start.
+    bool copyXtra(uint32_t timeout_ms = 5000);
+    bool setXtra(bool enable, uint32_t timeout_ms = 2000);
 
     // Enable/disable GNSS URCs (best-effort; exact support varies by firmware).
     bool setUpdateRate(uint32_t interval_ms, uint32_t timeout_ms = 2000);
 
     // Fetch +CGNSINF and parse a usable fix.
     sim7080g::GNSSFix getFix(uint32_t timeout_ms = 2000);
+    // Same without touching the heap: fix.utc stays empty, utc receives the raw timestamp.
+    // False when the command failed or the reply did not parse.
+    bool getFix(sim7080g::GNSSFix &fix, char *utc, size_t utc_size, uint32_t timeout_ms = 2000);
+
+    // Streaming mode: enables +UGNSINF reports (AT+CGNSURC) and parses each one through the
+    // modem's URC dispatcher. cb runs on whichever task is pumping the modem (sendCommand,
+    // pollUrcs), so no command is needed per fix.
+    bool startStreaming(uint32_t interval_ms, FixCallback cb, void *ctx = nullptr, uint32_t timeout_ms = 2000);
+    bool stopStreaming(uint32_t timeout_ms = 2000);
+    bool isStreaming() const { return _streamCb != nullptr; }
+    uint32_t streamedFixes() const { return _streamedFixes; }
+
+    // Parse the field list of a +CGNSINF / +UGNSINF line (text after ':'). utc (optional)
+    // receives the raw timestamp field. Parsed in place with integer arithmetic (no strtod,
+    // no copies); the span form stops at fields_len or the end of the line.
+    static bool parseInfo(const char *fields, sim7080g::GNSSFix &fix, char *utc = nullptr, size_t utc_size = 0);
+    static bool parseInfo(const char *fields, size_t fields_len, sim7080g::GNSSFix &fix, char *utc = nullptr,
+                          size_t utc_size = 0);
 
     // NMEA streaming control (best-effort; common SIMCom command is CGNSTST).
     bool startNMEA(uint32_t timeout_ms = 2000);
@@ -21,6 +55,11 @@ class SIM7080G_GNSS {
     SIM7080G_String getRawNMEA(uint32_t capture_ms = 1000);
 
   private:
+    static void _onUgnsinf(const char *line, size_t len, void *ctx);
+
     M5_SIM7080G &_modem;
+    FixCallback _streamCb = nullptr;
+    void *_streamCtx = nullptr;
+    uint32_t _streamedFixes = 0;
 };
 
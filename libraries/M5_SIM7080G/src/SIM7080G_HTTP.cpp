@@ -3,43 +3,34 @@
 #include <stdlib.h>
 #include <string.h>
 
-#if !SIM7080G_USE_ESP_IDF
-static inline bool _contains(const SIM7080G_String &s, const char *tok) { return s.indexOf(tok) != -1; }
-#else
-static inline bool _contains(const SIM7080G_String &s, const char *tok) { return s.find(tok) != std::string::npos; }
-#endif
-
-SIM7080G_String SIM7080G_HTTP::exec(const SIM7080G_String &cmd, uint32_t timeout_ms) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String line = cmd;
-  if (!line.endsWith("\r\n")) line += "\r\n";
-#else
-  SIM7080G_String line = cmd;
-  if (!(line.size() >= 2 && line[line.size() - 2] == '\r' && line[line.size() - 1] == '\n')) line.append("\r\n");
-#endif
+SIM7080G_String SIM7080G_HTTP::exec(const char *cmd, uint32_t timeout_ms) {
+  // Raw capture: SHREQ/SHREAD results arrive as URCs/payload after the final OK.
   _modem.flushInput();
-  _modem.sendMsg(line);
+  const size_t n = strlen(cmd);
+  _modem.sendRaw(reinterpret_cast<const uint8_t *>(cmd), n);
+  if (!(n >= 2 && cmd[n - 2] == '\r' && cmd[n - 1] == '\n')) _modem.sendRaw(reinterpret_cast<const uint8_t *>("\r\n"), 2);
   return _modem.waitMsg(timeout_ms);
 }
 
-bool SIM7080G_HTTP::execOk(const SIM7080G_String &cmd, uint32_t timeout_ms) {
-  const auto r = exec(cmd, timeout_ms);
-  return _contains(r, "OK") && !_contains(r, "ERROR");
+bool SIM7080G_HTTP::execOk(const char *cmd, uint32_t timeout_ms) {
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_HTTP::configure(const SIM7080G_String &baseUrl, uint16_t bodyLen, uint16_t headerLen, uint32_t timeout_ms) {
+  // A new URL is a new host; the modem only takes SHCONF while disconnected
+  if (_open) dropSession();
   // AT+SHCONF="URL","http://example.com"
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SHCONF=\"URL\",\"") + baseUrl + "\"";
-  if (!execOk(cmd, timeout_ms)) return false;
-  if (!execOk(SIM7080G_String("AT+SHCONF=\"BODYLEN\",") + SIM7080G_String(bodyLen), timeout_ms)) return false;
-  if (!execOk(SIM7080G_String("AT+SHCONF=\"HEADERLEN\",") + SIM7080G_String(headerLen), timeout_ms)) return false;
-#else
-  SIM7080G_String cmd = "AT+SHCONF=\"URL\",\"" + baseUrl + "\"";
-  if (!execOk(cmd, timeout_ms)) return false;
-  if (!execOk("AT+SHCONF=\"BODYLEN\"," + std::to_string(bodyLen), timeout_ms)) return false;
-  if (!execOk("AT+SHCONF=\"HEADERLEN\"," + std::to_string(headerLen), timeout_ms)) return false;
-#endif
+  sim7080g::FixedString<160> cmd;
+  cmd.append("AT+SHCONF=\"URL\",").appendQuoted(baseUrl.c_str());
+  if (cmd.truncated() || !execOk(cmd.c_str(), timeout_ms)) return false;
+  cmd.clear();
+  if (bodyLen > SIM7080G_HTTP_MAX_BODY) bodyLen = SIM7080G_HTTP_MAX_BODY;
+  cmd.appendf("AT+SHCONF=\"BODYLEN\",%u", static_cast<unsigned>(bodyLen));
+  if (!execOk(cmd.c_str(), timeout_ms)) return false;
+  _bodyLen = bodyLen;
+  cmd.clear();
+  cmd.appendf("AT+SHCONF=\"HEADERLEN\",%u", static_cast<unsigned>(headerLen));
+  if (!execOk(cmd.c_str(), timeout_ms)) return false;
   return true;
 }
 
@@ -48,20 +39,115 @@ bool SIM7080G_HTTP::connect(uint32_t timeout_ms) { return execOk("AT+SHCONN", ti
 bool SIM7080G_HTTP::disconnect(uint32_t timeout_ms) { return execOk("AT+SHDISC", timeout_ms); }
 
 bool SIM7080G_HTTP::connected(uint32_t timeout_ms) {
-  auto r = exec("AT+SHSTATE?", timeout_ms);
+  char resp[64];
+  if (_modem.sendCommandInto("AT+SHSTATE?", resp, sizeof(resp), timeout_ms, true) != M5_SIM7080G::Status::Ok) return false;
   // +SHSTATE: 1 => connected
-  return _contains(r, "+SHSTATE: 1");
+  return strstr(resp, "+SHSTATE: 1") != nullptr;
 }
 
-bool SIM7080G_HTTP::clearHeaders(uint32_t timeout_ms) { return execOk("AT+SHCHEAD", timeout_ms); }
+void SIM7080G_HTTP::setSessionPolicy(uint32_t idleMs, uint32_t healthCheckMs) {
+  _idleMs = idleMs;
+  _healthCheckMs = healthCheckMs;
+}
+
+bool SIM7080G_HTTP::closeIfIdle() {
+  if (!_open || (sim7080g::nowMs() - _lastUseMs) < _idleMs) return false;
+  dropSession();
+  _stats.idleCloses++;
+  return true;
+}
+
+void SIM7080G_HTTP::invalidateSession() {
+  _open = false;
+  _headers.clear();
+}
+
+void SIM7080G_HTTP::dropSession() {
+  (void)disconnect();
+  invalidateSession();
+}
+
+bool SIM7080G_HTTP::openSession(bool &reused) {
+  reused = false;
+  if (_open && (sim7080g::nowMs() - _lastUseMs) >= _healthCheckMs) {
+    // The server or the network may have closed it while it sat unused
+    _stats.healthChecks++;
+    if (!connected()) {
+      _stats.healthFailures++;
+      invalidateSession();
+    }
+  }
+  if (_open) {
+    reused = true;
+    _stats.reuses++;
+    return true;
+  }
+  _stats.connects++;
+  // SHCONN errors on a session the modem still has open
+  if (!connect(10000) && !connected()) return false;
+  _open = true;
+  _headers.clear();
+  _lastUseMs = sim7080g::nowMs();
+  return true;
+}
+
+bool SIM7080G_HTTP::applyHeaders(const char *contentType, const char *range) {
+  sim7080g::FixedString<96> block;
+  block.append(contentType ? contentType : "").append('|').append(range ? range : "");
+  if (!block.truncated() && _headers.length() && strcmp(block.c_str(), _headers.c_str()) == 0) {
+    _stats.headerHits++;
+    return true;
+  }
+  _headers.clear();
+  _stats.headerSends++;
+  (void)clearHeaders();
+  if (!addHeader("Accept", "*/*") || !addHeader("Connection", "keep-alive")) return false;
+  if (contentType && !addHeader("Content-Type", contentType)) return false;
+  if (range && !addHeader("Range", range)) return false;
+  if (!block.truncated()) _headers.append(block.c_str());
+  return true;
+}
+
+bool SIM7080G_HTTP::request(const char *path, int method, const char *contentType, const char *range, const Body *body,
+                            uint32_t timeout_ms, int &httpStatus, int &dataLen) {
+  sim7080g::FixedString<160> cmd;
+  cmd.append("AT+SHREQ=").appendQuoted(path).appendf(",%d", method);
+  if (cmd.truncated()) return false;
+  _stats.requests++;
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    if (!openSession(reused)) return false;
+    const bool ok = applyHeaders(contentType, range) && (!body || setBody(*body, 10000)) &&
+                    parseShreq(exec(cmd.c_str(), timeout_ms), httpStatus, dataLen);
+    if (ok) {
+      _lastUseMs = sim7080g::nowMs();
+      return true;
+    }
+    dropSession();
+    // A fresh session that fails is a real failure; a reused one may just have gone stale.
+    // A streamed body has been consumed and cannot be produced again.
+    if (!reused || (body && body->producer)) return false;
+    _stats.retries++;
+  }
+  return false;
+}
+
+bool SIM7080G_HTTP::clearHeaders(uint32_t timeout_ms) {
+  _headers.clear();
+  return execOk("AT+SHCHEAD", timeout_ms);
+}
 
 bool SIM7080G_HTTP::addHeader(const SIM7080G_String &name, const SIM7080G_String &value, uint32_t timeout_ms) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SHAHEAD=\"") + name + "\",\"" + value + "\"";
-#else
-  SIM7080G_String cmd = "AT+SHAHEAD=\"" + name + "\",\"" + value + "\"";
-#endif
-  return execOk(cmd, timeout_ms);
+  return addHeader(name.c_str(), value.c_str(), timeout_ms);
+}
+
+bool SIM7080G_HTTP::addHeader(const char *name, const char *value, uint32_t timeout_ms) {
+  _headers.clear();  // set outside the cached block
+  sim7080g::FixedString<192> cmd;
+  cmd.append("AT+SHAHEAD=").appendQuoted(name).append(',').appendQuoted(value);
+  if (cmd.truncated()) return false;
+  return execOk(cmd.c_str(), timeout_ms);
 }
 
 bool SIM7080G_HTTP::setHeaders(const SIM7080G_String &headersBlock, uint32_t timeout_ms) {
@@ -116,26 +202,49 @@ bool SIM7080G_HTTP::setHeaders(const SIM7080G_String &headersBlock, uint32_t tim
 }
 
 bool SIM7080G_HTTP::setBody(const SIM7080G_String &body, uint32_t timeout_ms) {
-  // Two-phase: AT+SHBOD=<len>,<timeout> then send body.
 #if !SIM7080G_USE_ESP_IDF
-  const int len = body.length();
-  SIM7080G_String cmd = SIM7080G_String("AT+SHBOD=") + SIM7080G_String(len) + "," + SIM7080G_String(timeout_ms);
+  return setBody(body.c_str(), body.length(), timeout_ms);
 #else
-  const int len = static_cast<int>(body.size());
-  SIM7080G_String cmd = "AT+SHBOD=" + std::to_string(len) + "," + std::to_string(timeout_ms);
+  return setBody(body.c_str(), body.size(), timeout_ms);
 #endif
+}
 
-  _modem.flushInput();
-#if !SIM7080G_USE_ESP_IDF
-  _modem.sendMsg(cmd + "\r\n");
-#else
-  _modem.sendMsg(cmd + "\r\n");
-#endif
-  (void)_modem.waitMsg(500);  // prompt '>'
-  _modem.sendMsg(body);
+bool SIM7080G_HTTP::setBody(const char *body, size_t len, uint32_t timeout_ms) {
+  const Body b{body, nullptr, nullptr, len, nullptr, nullptr};
+  return setBody(b, timeout_ms);
+}
 
-  const auto resp = _modem.waitMsg(timeout_ms);
-  return _contains(resp, "OK") && !_contains(resp, "ERROR");
+bool SIM7080G_HTTP::setBody(const Body &body, uint32_t timeout_ms) {
+  // Two-phase: AT+SHBOD=<len>,<timeout> then send body.
+  if (body.len > _bodyLen) return false;
+  sim7080g::FixedString<32> cmd;
+  cmd.appendf("AT+SHBOD=%u,%lu", static_cast<unsigned>(body.len), static_cast<unsigned long>(timeout_ms));
+
+  if (_modem.sendCommandForPrompt(cmd.c_str(), 1000).status != M5_SIM7080G::Status::Ok) return false;
+  if (!body.producer) {
+    _modem.sendRaw(reinterpret_cast<const uint8_t *>(body.data), body.len);
+    return _modem.waitForFinal(timeout_ms).status == M5_SIM7080G::Status::Ok;
+  }
+
+  // The modem waits for exactly len bytes: a producer that runs dry is padded out and the
+  // body refused, so the request is never sent
+  uint8_t chunk[SIM7080G_HTTP_STREAM_CHUNK];
+  size_t sent = 0;
+  bool complete = true;
+  while (sent < body.len) {
+    const size_t want = (body.len - sent) < sizeof(chunk) ? (body.len - sent) : sizeof(chunk);
+    size_t n = complete ? body.producer(chunk, want, body.ctx) : 0;
+    if (n > want) n = want;
+    if (n == 0) {
+      complete = false;
+      memset(chunk, ' ', want);
+      n = want;
+    }
+    if (!_modem.sendRaw(chunk, n)) complete = false;
+    sent += n;
+    if (complete && body.progress) body.progress(sent, body.len, body.progressCtx);
+  }
+  return _modem.waitForFinal(timeout_ms).status == M5_SIM7080G::Status::Ok && complete;
 }
 
 bool SIM7080G_HTTP::parseShreq(const SIM7080G_String &resp, int &httpStatus, int &dataLen) {
@@ -164,12 +273,9 @@ sim7080g::HttpResponse SIM7080G_HTTP::readBody(int dataLen, uint32_t timeout_ms)
     return out;
   }
 
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SHREAD=0,") + SIM7080G_String(dataLen);
-#else
-  SIM7080G_String cmd = "AT+SHREAD=0," + std::to_string(dataLen);
-#endif
-  const auto resp = exec(cmd, timeout_ms);
+  sim7080g::FixedString<32> cmd;
+  cmd.appendf("AT+SHREAD=0,%d", dataLen);
+  const auto resp = exec(cmd.c_str(), timeout_ms);
   const char *s = resp.c_str();
   const char *p = strstr(s, "+SHREAD:");
   if (!p) return out;
@@ -194,24 +300,9 @@ sim7080g::HttpResponse SIM7080G_HTTP::get(const SIM7080G_String &path, uint32_t
   sim7080g::HttpResponse out{};
   out.status = sim7080g::Status::Error;
 
-  // Ensure connection
-  (void)connect(10000);
-  (void)clearHeaders();
-  (void)addHeader("Accept", "*/*");
-  (void)addHeader("Connection", "keep-alive");
-
   // AT+SHREQ="<path>",1 (GET)
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SHREQ=\"") + path + "\",1";
-#else
-  SIM7080G_String cmd = "AT+SHREQ=\"" + path + "\",1";
-#endif
-  const auto resp = exec(cmd, timeout_ms);
   int httpStatus = -1, dataLen = -1;
-  if (!parseShreq(resp, httpStatus, dataLen)) {
-    out.status = sim7080g::Status::Error;
-    return out;
-  }
+  if (!request(path.c_str(), 1, nullptr, nullptr, nullptr, timeout_ms, httpStatus, dataLen)) return out;
   out.http_status = httpStatus;
 
   auto body = readBody(dataLen, timeout_ms);
@@ -219,34 +310,78 @@ sim7080g::HttpResponse SIM7080G_HTTP::get(const SIM7080G_String &path, uint32_t
   return body;
 }
 
-sim7080g::HttpResponse SIM7080G_HTTP::post(const SIM7080G_String &path, const SIM7080G_String &body, const SIM7080G_String &contentType,
-                                           uint32_t timeout_ms) {
-  sim7080g::HttpResponse out{};
-  out.status = sim7080g::Status::Error;
+int SIM7080G_HTTP::readBodyInto(uint32_t start, uint8_t *out, size_t len, uint32_t timeout_ms) {
+  // +SHREAD: <n> then n raw bytes, which may hold CR/LF or NUL
+  sim7080g::FixedString<40> cmd;
+  cmd.appendf("AT+SHREAD=%lu,%u\r\n", static_cast<unsigned long>(start), static_cast<unsigned>(len));
+  _modem.flushInput();
+  if (!_modem.sendRaw(reinterpret_cast<const uint8_t *>(cmd.c_str()), cmd.length())) return -1;
+  char rest[16];
+  if (!_modem.readLineStartingWith("+SHREAD:", rest, sizeof(rest), timeout_ms)) return -1;
+  int n = atoi(rest);
+  if (n < 0) return -1;
+  if (static_cast<size_t>(n) > len) n = static_cast<int>(len);
+  return _modem.readExact(out, static_cast<size_t>(n), timeout_ms) == static_cast<size_t>(n) ? n : -1;
+}
 
-  (void)connect(10000);
-  (void)clearHeaders();
-  (void)addHeader("Accept", "*/*");
-  (void)addHeader("Connection", "keep-alive");
-  (void)addHeader("Content-Type", contentType);
+int SIM7080G_HTTP::getRange(const SIM7080G_String &path, uint32_t offset, uint8_t *out, size_t len, int &httpStatus,
+                            uint32_t timeout_ms) {
+  httpStatus = -1;
+  if (!out || len == 0) return -1;
 
-  if (!setBody(body, 10000)) {
-    out.status = sim7080g::Status::Error;
-    return out;
+  sim7080g::FixedString<48> range;
+  range.appendf("bytes=%lu-%lu", static_cast<unsigned long>(offset), static_cast<unsigned long>(offset + len - 1));
+  int dataLen = -1;
+  if (!request(path.c_str(), 1, nullptr, range.c_str(), nullptr, timeout_ms, httpStatus, dataLen)) return -1;
+  if (httpStatus == 416) return 0;  // range starts past the end
+  uint32_t start = 0;
+  if (httpStatus == 200) {
+    if (static_cast<uint32_t>(dataLen) <= offset) return 0;
+    start = offset;
+    dataLen -= static_cast<int>(offset);
+  } else if (httpStatus != 206) {
+    return -1;
   }
+  if (dataLen == 0) return 0;
+  const size_t take = static_cast<size_t>(dataLen) < len ? static_cast<size_t>(dataLen) : len;
+  return readBodyInto(start, out, take, timeout_ms);
+}
 
-  // AT+SHREQ="<path>",3 (POST)
+sim7080g::HttpResponse SIM7080G_HTTP::post(const SIM7080G_String &path, const SIM7080G_String &body, const SIM7080G_String &contentType,
+                                           uint32_t timeout_ms) {
 #if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SHREQ=\"") + path + "\",3";
+  return post(path, body.c_str(), body.length(), contentType.c_str(), timeout_ms);
 #else
-  SIM7080G_String cmd = "AT+SHREQ=\"" + path + "\",3";
+  return post(path, body.c_str(), body.size(), contentType.c_str(), timeout_ms);
 #endif
-  const auto resp = exec(cmd, timeout_ms);
+}
+
+sim7080g::HttpResponse SIM7080G_HTTP::post(const SIM7080G_String &path, const char *body, size_t len, const char *contentType,
+                                           uint32_t timeout_ms) {
+  sim7080g::HttpResponse out{};
+  out.status = sim7080g::Status::Error;
+
+  // AT+SHREQ="<path>",3 (POST)
+  const Body b{body ? body : "", nullptr, nullptr, len, nullptr, nullptr};
   int httpStatus = -1, dataLen = -1;
-  if (!parseShreq(resp, httpStatus, dataLen)) {
-    out.status = sim7080g::Status::Error;
-    return out;
-  }
+  if (!request(path.c_str(), 3, contentType, nullptr, &b, timeout_ms, httpStatus, dataLen)) return out;
+  out.http_status = httpStatus;
+
+  auto bodyResp = readBody(dataLen, timeout_ms);
+  bodyResp.http_status = httpStatus;
+  return bodyResp;
+}
+
+sim7080g::HttpResponse SIM7080G_HTTP::postStream(const SIM7080G_String &path, size_t total, BodyProducer producer,
+                                                 void *ctx, const char *contentType, ProgressCallback progress,
+                                                 void *progressCtx, uint32_t timeout_ms) {
+  sim7080g::HttpResponse out{};
+  out.status = sim7080g::Status::Error;
+  if (!producer || total == 0 || total > _bodyLen) return out;
+
+  const Body b{nullptr, producer, ctx, total, progress, progressCtx};
+  int httpStatus = -1, dataLen = -1;
+  if (!request(path.c_str(), 3, contentType, nullptr, &b, timeout_ms, httpStatus, dataLen)) return out;
   out.http_status = httpStatus;
 
   auto bodyResp = readBody(dataLen, timeout_ms);
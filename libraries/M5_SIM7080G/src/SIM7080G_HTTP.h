@@ -2,8 +2,41 @@
 
 #include "M5_SIM7080G.h"
 
+// A kept-open session idle this long is closed by closeIfIdle()
+#ifndef SIM7080G_HTTP_IDLE_MS
+#define SIM7080G_HTTP_IDLE_MS 60000
+#endif
+// A session unused this long is checked with AT+SHSTATE? before it is reused
+#ifndef SIM7080G_HTTP_HEALTH_CHECK_MS
+#define SIM7080G_HTTP_HEALTH_CHECK_MS 20000
+#endif
+
+// Largest body the modem buffers for one request (AT+SHCONF="BODYLEN" upper bound)
+#ifndef SIM7080G_HTTP_MAX_BODY
+#define SIM7080G_HTTP_MAX_BODY 4096
+#endif
+// Stack buffer a streamed body passes through on its way to the modem
+#ifndef SIM7080G_HTTP_STREAM_CHUNK
+#define SIM7080G_HTTP_STREAM_CHUNK 256
+#endif
+
 class SIM7080G_HTTP {
   public:
+    // Fills buf with up to max body bytes; returns the count, 0 if it has nothing more
+    using BodyProducer = size_t (*)(uint8_t *buf, size_t max, void *ctx);
+    using ProgressCallback = void (*)(size_t sent, size_t total, void *ctx);
+    struct SessionStats {
+      uint32_t requests = 0;
+      uint32_t connects = 0;       // AT+SHCONN issued
+      uint32_t reuses = 0;         // requests on an already open session
+      uint32_t healthChecks = 0;
+      uint32_t healthFailures = 0; // checked session found closed
+      uint32_t retries = 0;        // reused session failed, request repeated on a new one
+      uint32_t idleCloses = 0;
+      uint32_t headerSends = 0;    // header block written to the modem
+      uint32_t headerHits = 0;     // header block already in place
+    };
+
     explicit SIM7080G_HTTP(M5_SIM7080G &modem) : _modem(modem) {}
 
     bool configure(const SIM7080G_String &baseUrl, uint16_t bodyLen = 1024, uint16_t headerLen = 350, uint32_t timeout_ms = 5000);
@@ -11,23 +44,79 @@ class SIM7080G_HTTP {
     bool disconnect(uint32_t timeout_ms = 3000);
     bool connected(uint32_t timeout_ms = 1500);
 
+    // Requests share one connection per configured base URL: it is opened by the first
+    // request, checked when it has sat unused for healthCheckMs, and reopened (with the
+    // request repeated once) if a reused session fails. The header block is only rewritten
+    // when it differs from the last one sent.
+    void setSessionPolicy(uint32_t idleMs, uint32_t healthCheckMs);
+    // Call from the owner's loop: disconnects a session idle longer than idleMs
+    bool closeIfIdle();
+    // The modem's HTTP state is unknown (reset, PDP context lost); nothing is sent
+    void invalidateSession();
+    bool sessionOpen() const { return _open; }
+    const SessionStats &sessionStats() const { return _stats; }
+
     bool clearHeaders(uint32_t timeout_ms = 1500);
     bool addHeader(const SIM7080G_String &name, const SIM7080G_String &value, uint32_t timeout_ms = 2000);
+    bool addHeader(const char *name, const char *value, uint32_t timeout_ms = 2000);
     // headersBlock like: "User-Agent: foo\r\nAccept: */*\r\n"
     bool setHeaders(const SIM7080G_String &headersBlock, uint32_t timeout_ms = 3000);
 
     sim7080g::HttpResponse get(const SIM7080G_String &path, uint32_t timeout_ms = 30000);
+    // GET of bytes [offset, offset + len) straight into out, binary safe. Returns the
+    // byte count (short at the end of the resource, 0 past it) or -1 on failure.
+    // httpStatus is 206, or 200 when the server ignored the range (the modem's
+    // copy of the whole body is then read from offset).
+    int getRange(const SIM7080G_String &path, uint32_t offset, uint8_t *out, size_t len, int &httpStatus,
+                 uint32_t timeout_ms = 30000);
     sim7080g::HttpResponse post(const SIM7080G_String &path, const SIM7080G_String &body, const SIM7080G_String &contentType,
                                 uint32_t timeout_ms = 30000);
+    // body is len bytes from the caller's buffer, sent as is
+    sim7080g::HttpResponse post(const SIM7080G_String &path, const char *body, size_t len, const char *contentType,
+                                uint32_t timeout_ms = 30000);
+    // POST of total bytes pulled from producer SIM7080G_HTTP_STREAM_CHUNK at a time straight into
+    // the modem's body buffer, so the body never sits in RAM whole. total must fit the bodyLen
+    // given to configure(). A producer that runs dry early fails the request before it is sent.
+    // progress (may be null) is called after each chunk. Not retried on a stale session.
+    sim7080g::HttpResponse postStream(const SIM7080G_String &path, size_t total, BodyProducer producer, void *ctx,
+                                      const char *contentType, ProgressCallback progress = nullptr,
+                                      void *progressCtx = nullptr, uint32_t timeout_ms = 30000);
+    size_t maxBody() const { return _bodyLen; }
 
   private:
-    SIM7080G_String exec(const SIM7080G_String &cmd, uint32_t timeout_ms);
-    bool execOk(const SIM7080G_String &cmd, uint32_t timeout_ms);
+    SIM7080G_String exec(const char *cmd, uint32_t timeout_ms);
+    struct Body {
+      const char *data;            // whole body in memory, or
+      BodyProducer producer;       // pulled in chunks
+      void *ctx;
+      size_t len;
+      ProgressCallback progress;
+      void *progressCtx;
+    };
+
+    bool openSession(bool &reused);
+    void dropSession();
+    bool applyHeaders(const char *contentType, const char *range);
+    // AT+SHREQ on the session, body (may be null) and headers set first
+    bool request(const char *path, int method, const char *contentType, const char *range, const Body *body,
+                 uint32_t timeout_ms, int &httpStatus, int &dataLen);
+    bool execOk(const char *cmd, uint32_t timeout_ms);
 
     bool setBody(const SIM7080G_String &body, uint32_t timeout_ms);
+    bool setBody(const char *body, size_t len, uint32_t timeout_ms);
+    bool setBody(const Body &body, uint32_t timeout_ms);
     bool parseShreq(const SIM7080G_String &resp, int &httpStatus, int &dataLen);
     sim7080g::HttpResponse readBody(int dataLen, uint32_t timeout_ms);
+    int readBodyInto(uint32_t start, uint8_t *out, size_t len, uint32_t timeout_ms);
 
     M5_SIM7080G &_modem;
+    bool _open = false;
+    uint32_t _lastUseMs = 0;
+    uint32_t _idleMs = SIM7080G_HTTP_IDLE_MS;
+    uint32_t _healthCheckMs = SIM7080G_HTTP_HEALTH_CHECK_MS;
+    size_t _bodyLen = 1024;
+    // Header block currently configured in the modem; empty = unknown
+    sim7080g::FixedString<96> _headers{};
+    SessionStats _stats{};
 };
 
@@ -8,6 +8,7 @@ static inline int _idxOf(const SIM7080G_String &s, const char *needle, int from
 static inline int _idxOfChar(const SIM7080G_String &s, char c, int from = 0) { return s.indexOf(c, from); }
 static inline SIM7080G_String _substr(const SIM7080G_String &s, int start, int endExclusive) { return s.substring(start, endExclusive); }
 static inline void _erasePrefix(SIM7080G_String &s, int n) { s.remove(0, n); }
+static inline void _erase(SIM7080G_String &s, int from, int n) { s.remove(from, n); }
 static inline int _len(const SIM7080G_String &s) { return s.length(); }
 #else
 static inline int _idxOf(const SIM7080G_String &s, const char *needle, int from = 0) {
@@ -24,98 +25,195 @@ static inline SIM7080G_String _substr(const SIM7080G_String &s, int start, int e
   return s.substr(static_cast<size_t>(start), static_cast<size_t>(endExclusive - start));
 }
 static inline void _erasePrefix(SIM7080G_String &s, int n) { s.erase(0, static_cast<size_t>(n)); }
+static inline void _erase(SIM7080G_String &s, int from, int n) { s.erase(static_cast<size_t>(from), static_cast<size_t>(n)); }
 static inline int _len(const SIM7080G_String &s) { return static_cast<int>(s.size()); }
 #endif
 
-static bool _sendSmconf(M5_SIM7080G &m, const SIM7080G_String &k, const SIM7080G_String &v, uint32_t timeout_ms) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SMCONF=\"") + k + "\",\"" + v + "\"";
-#else
-  SIM7080G_String cmd = "AT+SMCONF=\"" + k + "\",\"" + v + "\"";
-#endif
-  return m.sendCommand(cmd, timeout_ms, true).status == M5_SIM7080G::Status::Ok;
+static bool _sendSmconf(M5_SIM7080G &m, const char *k, const char *v, uint32_t timeout_ms) {
+  sim7080g::FixedString<160> cmd;
+  cmd.append("AT+SMCONF=").appendQuoted(k).append(',').appendQuoted(v);
+  if (cmd.truncated()) return false;
+  return m.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
-static bool _sendSmconfInt(M5_SIM7080G &m, const SIM7080G_String &k, int v, uint32_t timeout_ms) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SMCONF=\"") + k + "\"," + SIM7080G_String(v);
-#else
-  SIM7080G_String cmd = "AT+SMCONF=\"" + k + "\"," + std::to_string(v);
-#endif
-  return m.sendCommand(cmd, timeout_ms, true).status == M5_SIM7080G::Status::Ok;
+static bool _sendSmconfInt(M5_SIM7080G &m, const char *k, int v, uint32_t timeout_ms) {
+  sim7080g::FixedString<48> cmd;
+  cmd.append("AT+SMCONF=").appendQuoted(k).appendf(",%d", v);
+  return m.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_MQTT::configure(const SIM7080G_String &broker, uint16_t port, const SIM7080G_String &clientId,
                               uint16_t keepAliveSeconds, bool cleanSession) {
   // URL: broker + port as separate args: AT+SMCONF="URL","broker","1883"
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SMCONF=\"URL\",\"") + broker + "\",\"" + SIM7080G_String(port) + "\"";
-#else
-  SIM7080G_String cmd = "AT+SMCONF=\"URL\",\"" + broker + "\",\"" + std::to_string(port) + "\"";
-#endif
-  if (_modem.sendCommand(cmd, 5000, true).status != M5_SIM7080G::Status::Ok) return false;
+  sim7080g::FixedString<160> cmd;
+  cmd.append("AT+SMCONF=\"URL\",").appendQuoted(broker.c_str()).appendf(",\"%u\"", static_cast<unsigned>(port));
+  if (cmd.truncated()) return false;
+  if (_modem.sendCommandInto(cmd, nullptr, 0, 5000, true) != M5_SIM7080G::Status::Ok) return false;
 
   if (!_sendSmconfInt(_modem, "KEEPTIME", (int)keepAliveSeconds, 5000)) return false;
   if (!_sendSmconfInt(_modem, "CLEANSS", cleanSession ? 1 : 0, 5000)) return false;
-  if (!_sendSmconf(_modem, "CLIENTID", clientId, 5000)) return false;
+  if (!_sendSmconf(_modem, "CLIENTID", clientId.c_str(), 5000)) return false;
   return true;
 }
 
 bool SIM7080G_MQTT::connect(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+SMCONN", timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  return _modem.sendCommandInto("AT+SMCONN", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_MQTT::disconnect(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+SMDISC", timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  return _modem.sendCommandInto("AT+SMDISC", nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_MQTT::subscribe(const SIM7080G_String &topic, int qos, uint32_t timeout_ms) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SMSUB=\"") + topic + "\"," + SIM7080G_String(qos);
-#else
-  SIM7080G_String cmd = "AT+SMSUB=\"" + topic + "\"," + std::to_string(qos);
-#endif
-  auto r = _modem.sendCommand(cmd, timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  sim7080g::FixedString<160> cmd;
+  cmd.append("AT+SMSUB=").appendQuoted(topic.c_str()).appendf(",%d", qos);
+  if (cmd.truncated()) return false;
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_MQTT::unsubscribe(const SIM7080G_String &topic, uint32_t timeout_ms) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+SMUNSUB=\"") + topic + "\"";
-#else
-  SIM7080G_String cmd = "AT+SMUNSUB=\"" + topic + "\"";
-#endif
-  auto r = _modem.sendCommand(cmd, timeout_ms, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  sim7080g::FixedString<160> cmd;
+  cmd.append("AT+SMUNSUB=").appendQuoted(topic.c_str());
+  if (cmd.truncated()) return false;
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
+}
+
+bool SIM7080G_MQTT::setWindow(uint8_t window, uint32_t ackTimeoutMs) {
+  if (window < 1) window = 1;
+  if (window > SIM7080G_MQTT_MAX_WINDOW) window = SIM7080G_MQTT_MAX_WINDOW;
+  _ackTimeoutMs = ackTimeoutMs ? ackTimeoutMs : 10000;
+  _head = 0;
+  _count = 0;
+  _window = 1;
+  _stats.inFlight = 0;
+  _stats.async = false;
+  if (window == 1) return true;
+
+  if (!_sendSmconfInt(_modem, "ASYNCMODE", 1, 5000)) return false;
+  if (!_modem.registerUrcHandler(SIM7080G_MQTT_PUBACK_URC, &SIM7080G_MQTT::onCompletionUrc, this)) return false;
+  _window = window;
+  _stats.async = true;
+  return true;
 }
 
 bool SIM7080G_MQTT::publish(const SIM7080G_String &topic, const SIM7080G_String &payload, int qos, bool retain, uint32_t timeout_ms) {
-  // SMPUB is typically a two-phase command: send header, wait for '>' prompt, then send exactly <len> bytes.
 #if !SIM7080G_USE_ESP_IDF
-  const int len = payload.length();
-  SIM7080G_String header = SIM7080G_String("AT+SMPUB=\"") + topic + "\"," + SIM7080G_String(len) + "," + SIM7080G_String(qos) + "," + SIM7080G_String(retain ? 1 : 0) + "\r\n";
+  const size_t len = payload.length();
 #else
-  const int len = static_cast<int>(payload.size());
-  SIM7080G_String header = "AT+SMPUB=\"" + topic + "\"," + std::to_string(len) + "," + std::to_string(qos) + "," + std::to_string(retain ? 1 : 0) + "\r\n";
+  const size_t len = payload.size();
 #endif
+  return publish(topic.c_str(), reinterpret_cast<const uint8_t *>(payload.c_str()), len, qos, retain, timeout_ms);
+}
+
+bool SIM7080G_MQTT::publish(const char *topic, const uint8_t *data, size_t len, int qos, bool retain, uint32_t timeout_ms) {
+  if (!topic || (!data && len)) return false;
+  const bool windowed = qos > 0 && _window > 1;
+  if (windowed) {
+    // Completions come in as URCs while waiting; expire() drops the ones that never will
+    const uint32_t start = sim7080g::nowMs();
+    if (_count >= _window) _stats.windowFull++;
+    while (true) {
+      expire(sim7080g::nowMs());
+      if (_count < _window) break;
+      if ((sim7080g::nowMs() - start) >= timeout_ms) return false;
+      poll(20);
+    }
+  }
 
-  _modem.flushInput();
-  _modem.sendMsg(header);
+  // SMPUB is typically a two-phase command: send header, wait for '>' prompt, then send exactly <len> bytes.
+  sim7080g::FixedString<160> header;
+  header.append("AT+SMPUB=").appendQuoted(topic);
+  header.appendf(",%u,%d,%d", static_cast<unsigned>(len), qos, retain ? 1 : 0);
+  if (header.truncated()) return false;
 
-  // Wait briefly for prompt (some firmwares don't echo a clear '>' prompt; tolerate).
-  (void)_modem.waitMsg(500);
+  // Wait briefly for prompt (some firmwares don't echo a clear '>' prompt; tolerate a timeout).
+  // While SMPUB is pending the parser hands "+SMPUB" lines to the reply, so earlier
+  // publishes' completions are picked out of it.
+  auto prompt = _modem.sendCommandForPrompt(header.c_str(), 500);
+  scanCompletions(prompt.raw);
+  if (prompt.status == M5_SIM7080G::Status::Error) {
+    _stats.failed++;
+    return false;
+  }
 
-  _modem.sendMsg(payload);  // exact payload bytes
+  _modem.sendRaw(data, len);  // exact payload bytes
 
   // Now wait for OK/ERROR after payload
-  SIM7080G_String resp = _modem.waitMsg(timeout_ms);
-#if !SIM7080G_USE_ESP_IDF
-  return resp.indexOf("OK") != -1 && resp.indexOf("ERROR") == -1;
-#else
-  return resp.find("OK") != std::string::npos && resp.find("ERROR") == std::string::npos;
-#endif
+  auto final = _modem.waitForFinal(timeout_ms);
+  scanCompletions(final.raw);
+  if (final.status != M5_SIM7080G::Status::Ok) {
+    _stats.failed++;
+    return false;
+  }
+  _stats.published++;
+  if (qos > 0 && _window > 1) {  // expire() may have fallen back while waiting
+    _sentAt[(_head + _count) % SIM7080G_MQTT_MAX_WINDOW] = sim7080g::nowMs();
+    _count++;
+    _stats.inFlight = _count;
+    if (_count > _stats.maxInFlight) _stats.maxInFlight = _count;
+  }
+  return true;
+}
+
+bool SIM7080G_MQTT::drain(uint32_t timeout_ms) {
+  const uint32_t start = sim7080g::nowMs();
+  while (true) {
+    expire(sim7080g::nowMs());
+    if (_count == 0) return true;
+    if ((sim7080g::nowMs() - start) >= timeout_ms) return false;
+    poll(20);
+  }
+}
+
+void SIM7080G_MQTT::onCompletionUrc(const char *line, size_t len, void *ctx) {
+  static_cast<SIM7080G_MQTT *>(ctx)->onCompletion(line, len);
+}
+
+void SIM7080G_MQTT::onCompletion(const char *line, size_t len) {
+  // The result is the last field: +SMPUB: <...>,<result>
+  size_t i = len;
+  while (i > 0 && (line[i - 1] == '\r' || line[i - 1] == '\n' || line[i - 1] == ' ')) i--;
+  const size_t end = i;
+  while (i > 0 && line[i - 1] >= '0' && line[i - 1] <= '9') i--;
+  if (i == end || _count == 0) return;  // not a completion, or one already timed out
+
+  int result = 0;
+  for (size_t k = i; k < end; k++) result = result * 10 + (line[k] - '0');
+  _head = (_head + 1) % SIM7080G_MQTT_MAX_WINDOW;
+  _count--;
+  _stats.inFlight = _count;
+  if (result == 0) {
+    _stats.acked++;
+  } else {
+    _stats.failed++;
+  }
+}
+
+void SIM7080G_MQTT::scanCompletions(const SIM7080G_String &raw) {
+  const char *p = raw.c_str();
+  const size_t n = strlen(SIM7080G_MQTT_PUBACK_URC);
+  while ((p = strstr(p, SIM7080G_MQTT_PUBACK_URC)) != nullptr) {
+    const char *eol = strchr(p, '\n');
+    const size_t len = eol ? static_cast<size_t>(eol - p) : strlen(p);
+    onCompletion(p, len);
+    p += len > n ? len : n;
+  }
+}
+
+void SIM7080G_MQTT::expire(uint32_t now) {
+  while (_count > 0 && (now - _sentAt[_head]) >= _ackTimeoutMs) {
+    _head = (_head + 1) % SIM7080G_MQTT_MAX_WINDOW;
+    _count--;
+    _stats.timedOut++;
+  }
+  _stats.inFlight = _count;
+  // Asynchronous mode accepted but not a single completion reported: this firmware does
+  // not send them, so window slots would only ever free by timeout
+  if (_stats.timedOut > 0 && _stats.acked == 0 && _window > 1) {
+    _window = 1;
+    _count = 0;
+    _stats.inFlight = 0;
+  }
 }
 
 void SIM7080G_MQTT::poll(uint32_t capture_ms) {
@@ -136,6 +234,15 @@ void SIM7080G_MQTT::poll(uint32_t capture_ms) {
 }
 
 bool SIM7080G_MQTT::processRxBuffer() {
+  // Completions read by poll() bypass the line parser
+  while (_window > 1) {
+    const int i = _idxOf(_rxbuf, SIM7080G_MQTT_PUBACK_URC, 0);
+    if (i < 0) break;
+    const int lineEnd = _idxOfChar(_rxbuf, '\n', i);
+    if (lineEnd < 0) break;  // need more data
+    onCompletion(_rxbuf.c_str() + i, static_cast<size_t>(lineEnd - i));
+    _erase(_rxbuf, i, lineEnd + 1 - i);
+  }
   if (!_cb) return false;
 
   bool any = false;
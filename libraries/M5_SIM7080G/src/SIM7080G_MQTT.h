@@ -2,6 +2,15 @@
 
 #include "M5_SIM7080G.h"
 
+// Most QoS1 publishes allowed in flight (see setWindow)
+#ifndef SIM7080G_MQTT_MAX_WINDOW
+#define SIM7080G_MQTT_MAX_WINDOW 8
+#endif
+// Completion line of an asynchronous publish; its last field is the result, 0 = delivered
+#ifndef SIM7080G_MQTT_PUBACK_URC
+#define SIM7080G_MQTT_PUBACK_URC "+SMPUB:"
+#endif
+
 class SIM7080G_MQTT {
   public:
     using MessageCallback = void (*)(const SIM7080G_String &topic, const SIM7080G_String &payload);
@@ -16,8 +25,35 @@ class SIM7080G_MQTT {
     bool subscribe(const SIM7080G_String &topic, int qos = 1, uint32_t timeout_ms = 3000);
     bool unsubscribe(const SIM7080G_String &topic, uint32_t timeout_ms = 3000);
 
+    struct PublishStats {
+      uint32_t published = 0;   // accepted by the modem
+      uint32_t acked = 0;       // completion seen (window > 1)
+      uint32_t failed = 0;      // refused by the modem or completed with an error
+      uint32_t timedOut = 0;    // no completion within the ack timeout
+      uint32_t windowFull = 0;  // publishes that had to wait for room
+      uint8_t inFlight = 0;
+      uint8_t maxInFlight = 0;
+      bool async = false;       // modem in asynchronous mode
+    };
+
+    // Up to window QoS>0 publishes outstanding. window > 1 puts the modem in asynchronous
+    // mode (AT+SMCONF="ASYNCMODE",1; call after configure(), before connect()), so AT+SMPUB
+    // returns once the payload is taken and the broker's PUBACK is reported later by a
+    // SIM7080G_MQTT_PUBACK_URC line. A modem that refuses stays synchronous (window 1, returns
+    // false); one that never reports completions falls back to window 1 after ackTimeoutMs.
+    bool setWindow(uint8_t window, uint32_t ackTimeoutMs = 10000);
+    uint8_t window() const { return _window; }
+    uint8_t inFlight() const { return _count; }
+    const PublishStats &publishStats() const { return _stats; }
+
     bool publish(const SIM7080G_String &topic, const SIM7080G_String &payload, int qos = 1, bool retain = false,
                  uint32_t timeout_ms = 10000);
+    // Payload written straight from the caller's buffer. With a window the call waits for
+    // room (up to timeout_ms) and returns once the modem accepted the bytes.
+    bool publish(const char *topic, const uint8_t *data, size_t len, int qos = 1, bool retain = false,
+                 uint32_t timeout_ms = 10000);
+    // Waits until no publish is in flight; false on timeout
+    bool drain(uint32_t timeout_ms);
 
     void setCallback(MessageCallback cb) { _cb = cb; }
 
@@ -26,9 +62,21 @@ class SIM7080G_MQTT {
 
   private:
     bool processRxBuffer();
+    static void onCompletionUrc(const char *line, size_t len, void *ctx);
+    void onCompletion(const char *line, size_t len);
+    void scanCompletions(const SIM7080G_String &raw);
+    void expire(uint32_t now);
 
     M5_SIM7080G &_modem;
     MessageCallback _cb = nullptr;
     SIM7080G_String _rxbuf{};
+
+    uint8_t _window = 1;
+    uint32_t _ackTimeoutMs = 10000;
+    // Oldest first; completions arrive in publish order
+    uint32_t _sentAt[SIM7080G_MQTT_MAX_WINDOW] = {};
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    PublishStats _stats{};
 };
 
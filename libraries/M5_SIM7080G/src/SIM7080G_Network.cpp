@@ -34,80 +34,69 @@ static bool _registeredFromCeregLine(const char *line) {
   return (stat == 1 || stat == 5);
 }
 
-bool SIM7080G_Network::setAPN(const SIM7080G_String &apn, SIM7080G_String user, SIM7080G_String pass, int cid) {
-  // Basic CID/APN config. Auth parameters are module/firmware dependent; keep simple and common.
-  // AT+CGDCONT=<cid>,"IP","<apn>"
+static SIM7080G_String _lineFrom(const char *p) {
+  const char *e = p;
+  while (*e && *e != '\r' && *e != '\n') e++;
 #if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+CGDCONT=") + SIM7080G_String(cid) + ",\"IP\",\"" + apn + "\"";
+  SIM7080G_String out;
+  out.concat(p, static_cast<unsigned>(e - p));
+  return out;
 #else
-  SIM7080G_String cmd = "AT+CGDCONT=" + std::to_string(cid) + ",\"IP\",\"" + apn + "\"";
+  return SIM7080G_String(p, static_cast<size_t>(e - p));
 #endif
-  auto r = _modem.sendCommand(cmd, 3000, true);
-  if (r.status != M5_SIM7080G::Status::Ok) return false;
+}
+
+bool SIM7080G_Network::setAPN(const SIM7080G_String &apn, SIM7080G_String user, SIM7080G_String pass, int cid) {
+  // Basic CID/APN config. Auth parameters are module/firmware dependent; keep simple and common.
+  // AT+CGDCONT=<cid>,"IP","<apn>"
+  sim7080g::FixedString<128> cmd;
+  cmd.appendf("AT+CGDCONT=%d,\"IP\",", cid).appendQuoted(apn.c_str());
+  if (cmd.truncated()) return false;
+  if (_modem.sendCommandInto(cmd, nullptr, 0, 3000, true) != M5_SIM7080G::Status::Ok) return false;
 
   // Optional auth setup (best-effort). Not all firmware supports these.
-  bool hasAuth = false;
-#if !SIM7080G_USE_ESP_IDF
-  hasAuth = (user.length() > 0) || (pass.length() > 0);
-#else
-  hasAuth = (!user.empty()) || (!pass.empty());
-#endif
+  const bool hasAuth = user.c_str()[0] != '\0' || pass.c_str()[0] != '\0';
   if (hasAuth) {
     // Try the common SIMCom form:
     // AT+CGAUTH=<cid>,<auth_type>,<user>,<pass>
     // auth_type: 1=PAP, 2=CHAP
-#if !SIM7080G_USE_ESP_IDF
-    SIM7080G_String cmd2 = SIM7080G_String("AT+CGAUTH=") + SIM7080G_String(cid) + ",1,\"" + user + "\",\"" + pass + "\"";
-#else
-    SIM7080G_String cmd2 = "AT+CGAUTH=" + std::to_string(cid) + ",1,\"" + user + "\",\"" + pass + "\"";
-#endif
-    (void)_modem.sendCommand(cmd2, 3000, true);
+    cmd.clear();
+    cmd.appendf("AT+CGAUTH=%d,1,", cid).appendQuoted(user.c_str()).append(',').appendQuoted(pass.c_str());
+    if (!cmd.truncated()) (void)_modem.sendCommandInto(cmd, nullptr, 0, 3000, true);
   }
 
   return true;
 }
 
 bool SIM7080G_Network::activatePDP(int profileId) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+CNACT=") + SIM7080G_String(profileId) + ",1";
-#else
-  SIM7080G_String cmd = "AT+CNACT=" + std::to_string(profileId) + ",1";
-#endif
-  auto r = _modem.sendCommand(cmd, 10000, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  sim7080g::FixedString<24> cmd;
+  cmd.appendf("AT+CNACT=%d,1", profileId);
+  return _modem.sendCommandInto(cmd, nullptr, 0, 10000, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_Network::deactivatePDP(int profileId) {
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String cmd = SIM7080G_String("AT+CNACT=") + SIM7080G_String(profileId) + ",0";
-#else
-  SIM7080G_String cmd = "AT+CNACT=" + std::to_string(profileId) + ",0";
-#endif
-  auto r = _modem.sendCommand(cmd, 10000, true);
-  return r.status == M5_SIM7080G::Status::Ok;
+  sim7080g::FixedString<24> cmd;
+  cmd.appendf("AT+CNACT=%d,0", profileId);
+  return _modem.sendCommandInto(cmd, nullptr, 0, 10000, true) == M5_SIM7080G::Status::Ok;
 }
 
 bool SIM7080G_Network::isPDPActive(int profileId) {
-  auto r = _modem.sendCommand("AT+CNACT?", 2000, true);
-  if (r.status != M5_SIM7080G::Status::Ok && r.status != M5_SIM7080G::Status::Timeout) return false;
+  char resp[160];
+  auto st = _modem.sendCommandInto("AT+CNACT?", resp, sizeof(resp), 2000, true);
+  if (st != M5_SIM7080G::Status::Ok && st != M5_SIM7080G::Status::Timeout) return false;
 
   // Look for "+CNACT: <profileId>,1"
-#if !SIM7080G_USE_ESP_IDF
-  SIM7080G_String needle = SIM7080G_String("+CNACT: ") + SIM7080G_String(profileId) + ",1";
-  return r.raw.indexOf(needle) != -1;
-#else
-  SIM7080G_String needle = "+CNACT: " + std::to_string(profileId) + ",1";
-  return r.raw.find(needle) != std::string::npos;
-#endif
+  sim7080g::FixedString<24> needle;
+  needle.appendf("+CNACT: %d,1", profileId);
+  return strstr(resp, needle.c_str()) != nullptr;
 }
 
 sim7080g::SignalQuality SIM7080G_Network::getSignalQuality(uint32_t timeout_ms) {
   sim7080g::SignalQuality q{};
-  auto r = _modem.sendCommand("AT+CSQ", timeout_ms, true);
-  if (r.status != M5_SIM7080G::Status::Ok) return q;
+  char resp[64];
+  if (_modem.sendCommandInto("AT+CSQ", resp, sizeof(resp), timeout_ms, true) != M5_SIM7080G::Status::Ok) return q;
 
-  const char *s = r.raw.c_str();
-  const char *p = strstr(s, "+CSQ:");
+  const char *p = strstr(resp, "+CSQ:");
   if (!p) return q;
   int rssi = -1, ber = -1;
   if (!_parseTwoIntsAfterColon(p, rssi, ber)) return q;
@@ -118,52 +107,31 @@ sim7080g::SignalQuality SIM7080G_Network::getSignalQuality(uint32_t timeout_ms)
 }
 
 SIM7080G_String SIM7080G_Network::getNetworkStatus(uint32_t timeout_ms) {
-  auto r = _modem.sendCommand("AT+CEREG?", timeout_ms, true);
-  if (r.status != M5_SIM7080G::Status::Ok && r.status != M5_SIM7080G::Status::Timeout) return SIM7080G_String{};
+  char resp[96];
+  auto st = _modem.sendCommandInto("AT+CEREG?", resp, sizeof(resp), timeout_ms, true);
+  if (st != M5_SIM7080G::Status::Ok && st != M5_SIM7080G::Status::Timeout) return SIM7080G_String{};
 
   // Prefer CEREG line; fallback to CREG.
-  const char *s = r.raw.c_str();
-  const char *p = strstr(s, "+CEREG:");
-  if (p) {
-    // return from p until end-of-line
-    const char *e = p;
-    while (*e && *e != '\r' && *e != '\n') e++;
-#if !SIM7080G_USE_ESP_IDF
-    return SIM7080G_String(p).substring(0, (int)(e - p));
-#else
-    return SIM7080G_String(p, static_cast<size_t>(e - p));
-#endif
-  }
+  const char *p = strstr(resp, "+CEREG:");
+  if (p) return _lineFrom(p);
 
-  auto r2 = _modem.sendCommand("AT+CREG?", timeout_ms, true);
-  const char *s2 = r2.raw.c_str();
-  const char *p2 = strstr(s2, "+CREG:");
-  if (p2) {
-    const char *e = p2;
-    while (*e && *e != '\r' && *e != '\n') e++;
-#if !SIM7080G_USE_ESP_IDF
-    return SIM7080G_String(p2).substring(0, (int)(e - p2));
-#else
-    return SIM7080G_String(p2, static_cast<size_t>(e - p2));
-#endif
-  }
+  (void)_modem.sendCommandInto("AT+CREG?", resp, sizeof(resp), timeout_ms, true);
+  const char *p2 = strstr(resp, "+CREG:");
+  if (p2) return _lineFrom(p2);
   return SIM7080G_String{};
 }
 
 bool SIM7080G_Network::waitForNetwork(uint32_t timeout_ms) {
+  char resp[96];
   const uint32_t start = sim7080g::nowMs();
   while ((sim7080g::nowMs() - start) < timeout_ms) {
-    auto r = _modem.sendCommand("AT+CEREG?", 1500, true);
-    if (r.status == M5_SIM7080G::Status::Ok) {
-      const char *s = r.raw.c_str();
-      const char *p = strstr(s, "+CEREG:");
+    if (_modem.sendCommandInto("AT+CEREG?", resp, sizeof(resp), 1500, true) == M5_SIM7080G::Status::Ok) {
+      const char *p = strstr(resp, "+CEREG:");
       if (p && _registeredFromCeregLine(p)) return true;
     }
 
-    auto r2 = _modem.sendCommand("AT+CREG?", 1500, true);
-    if (r2.status == M5_SIM7080G::Status::Ok) {
-      const char *s2 = r2.raw.c_str();
-      const char *p2 = strstr(s2, "+CREG:");
+    if (_modem.sendCommandInto("AT+CREG?", resp, sizeof(resp), 1500, true) == M5_SIM7080G::Status::Ok) {
+      const char *p2 = strstr(resp, "+CREG:");
       if (p2 && _registeredFromCeregLine(p2)) return true;
     }
 
@@ -172,3 +140,88 @@ bool SIM7080G_Network::waitForNetwork(uint32_t timeout_ms) {
   return false;
 }
 
+// Copies a quoted field at p into out; returns the position past the closing quote or null
+static const char *_quotedField(const char *p, char *out, size_t out_size) {
+  if (*p != '"') return nullptr;
+  p++;
+  size_t n = 0;
+  while (*p && *p != '"' && *p != '\r' && *p != '\n') {
+    if (n + 1 < out_size) out[n++] = *p;
+    p++;
+  }
+  if (out_size) out[n] = '\0';
+  return *p == '"' ? p + 1 : nullptr;
+}
+
+size_t SIM7080G_Network::parseOperators(const char *response, sim7080g::OperatorInfo *out, size_t max) {
+  if (!response || !out) return 0;
+  const char *p = strstr(response, "+COPS:");
+  if (!p) return 0;
+  p += 6;
+  size_t count = 0;
+  char shortName[24];
+  while (count < max) {
+    while (*p == ' ' || *p == ',') p++;
+    // The operator list ends at the empty field before the supported modes
+    if (*p != '(') break;
+    p++;
+    char *end = nullptr;
+    const long stat = strtol(p, &end, 10);
+    if (end == p || *end != ',') break;
+    p = end + 1;
+    sim7080g::OperatorInfo op{};
+    op.stat = static_cast<uint8_t>(stat);
+    // Mode lists "(0,1,2,3,4)" have no quoted names
+    if (!(p = _quotedField(p, op.long_name, sizeof(op.long_name))) || *p++ != ',') break;
+    if (!(p = _quotedField(p, shortName, sizeof(shortName))) || *p++ != ',') break;
+    if (!(p = _quotedField(p, op.numeric, sizeof(op.numeric)))) break;
+    if (*p == ',') {
+      p++;
+      op.act = static_cast<uint8_t>(strtol(p, &end, 10));
+      p = end;
+    }
+    while (*p && *p != ')' && *p != '\r' && *p != '\n') p++;
+    if (*p != ')') break;
+    p++;
+    out[count++] = op;
+  }
+  return count;
+}
+
+M5_SIM7080G::Status SIM7080G_Network::scanOperators(sim7080g::OperatorInfo *out, size_t max, size_t &count,
+                                                    uint32_t timeout_ms, sim7080g::AbortCheck abort,
+                                                    void *abort_ctx) {
+  count = 0;
+  char resp[512];
+  const M5_SIM7080G::Status st = _modem.sendCommandAbortable("AT+COPS=?", resp, sizeof(resp), timeout_ms, abort,
+                                                             abort_ctx);
+  count = parseOperators(resp, out, max);
+  return st;
+}
+
+bool SIM7080G_Network::getBands(const char *rat, char *out, size_t out_size, uint32_t timeout_ms) {
+  if (!rat || !out || out_size == 0) return false;
+  out[0] = '\0';
+  char resp[256];
+  if (_modem.sendCommandInto("AT+CBANDCFG?", resp, sizeof(resp), timeout_ms, true) != M5_SIM7080G::Status::Ok) {
+    return false;
+  }
+  // +CBANDCFG: "CAT-M",1,2,3,4,5,8,12,13,14,18,19,20,25,26,27,28,66,85
+  sim7080g::FixedString<24> needle;
+  needle.append('"').append(rat).append("\",");
+  const char *p = strstr(resp, needle.c_str());
+  if (!p) return false;
+  p += strlen(needle.c_str());
+  size_t n = 0;
+  while ((*p == ',' || (*p >= '0' && *p <= '9')) && n + 1 < out_size) out[n++] = *p++;
+  out[n] = '\0';
+  return n > 0;
+}
+
+bool SIM7080G_Network::setBands(const char *rat, const char *bands, uint32_t timeout_ms) {
+  if (!rat || !bands || !bands[0]) return false;
+  sim7080g::FixedString<96> cmd;
+  cmd.append("AT+CBANDCFG=").appendQuoted(rat).append(',').append(bands);
+  if (cmd.truncated()) return false;
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
+}
@@ -23,6 +23,18 @@ class SIM7080G_Network {
     // Wait until registered (stat 1 or 5) based on CEREG/CREG.
     bool waitForNetwork(uint32_t timeout_ms = 60000);
 
+    // AT+COPS=?; takes minutes on CAT-M, abort stops it early (see sendCommandAbortable).
+    // count is the number of operators parsed into out, also after an abort.
+    M5_SIM7080G::Status scanOperators(sim7080g::OperatorInfo *out, size_t max, size_t &count, uint32_t timeout_ms,
+                                      sim7080g::AbortCheck abort = nullptr, void *abort_ctx = nullptr);
+    // +COPS: (2,"T-Mobile","T-Mobile","310260",7),(1,"AT&T","AT&T","310410",7),,(0,1,2,3,4),(0,1,2)
+    static size_t parseOperators(const char *response, sim7080g::OperatorInfo *out, size_t max);
+
+    // AT+CBANDCFG bands of one RAT ("CAT-M", "NB-IOT") as a comma list, e.g. "3,8,20,28".
+    // The modem keeps a set list across resets.
+    bool getBands(const char *rat, char *out, size_t out_size, uint32_t timeout_ms = 2000);
+    bool setBands(const char *rat, const char *bands, uint32_t timeout_ms = 5000);
+
   private:
     M5_SIM7080G &_modem;
 };
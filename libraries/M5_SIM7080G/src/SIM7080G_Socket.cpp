@@ -0,0 +1,145 @@
+#include "SIM7080G_Socket.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// +CAOPEN result codes that matter here (SIM7080 TCP/IP application note)
+static constexpr int kCaOpenOk = 0;
+static constexpr int kCaOpenCidInUse = 24;
+
+SIM7080G_Socket::~SIM7080G_Socket() {
+  if (_urcRegistered) {
+    (void)_modem.unregisterUrcHandler("+CASTATE");
+    (void)_modem.unregisterUrcHandler("+CADATAIND");
+  }
+}
+
+bool SIM7080G_Socket::_registerUrcs() {
+  if (!_urcRegistered) {
+    _urcRegistered = _modem.registerUrcHandler("+CASTATE", &SIM7080G_Socket::_onCaState, this) &&
+                     _modem.registerUrcHandler("+CADATAIND", &SIM7080G_Socket::_onDataInd, this);
+  }
+  return _urcRegistered;
+}
+
+void SIM7080G_Socket::_onCaState(const char *line, size_t len, void *ctx) {
+  // +CASTATE: <cid>,<state>  (state 0 = closed by the peer or the network)
+  SIM7080G_Socket *self = static_cast<SIM7080G_Socket *>(ctx);
+  if (!self) return;
+  const char *p = static_cast<const char *>(memchr(line, ':', len));
+  if (!p) return;
+  char *end = nullptr;
+  const long cid = strtol(p + 1, &end, 10);
+  if (!end || *end != ',' || cid != self->_cid) return;
+  if (strtol(end + 1, nullptr, 10) == 0 && self->_open) {
+    self->_open = false;
+    self->_closedByNetwork++;
+  }
+}
+
+void SIM7080G_Socket::_onDataInd(const char *line, size_t len, void *ctx) {
+  // +CADATAIND: <cid>
+  SIM7080G_Socket *self = static_cast<SIM7080G_Socket *>(ctx);
+  if (!self) return;
+  const char *p = static_cast<const char *>(memchr(line, ':', len));
+  if (p && strtol(p + 1, nullptr, 10) == self->_cid) self->_rxPending = true;
+}
+
+bool SIM7080G_Socket::openUdp(const char *host, uint16_t port, uint32_t timeout_ms) {
+  if (!host || !host[0] || port == 0) return false;
+  (void)_registerUrcs();
+  if (_open) (void)close();
+  _rxPending = false;
+
+  sim7080g::FixedString<128> cmd;
+  cmd.appendf("AT+CAOPEN=%u,%u,\"UDP\",", static_cast<unsigned>(_cid), static_cast<unsigned>(_pdp));
+  cmd.appendQuoted(host).appendf(",%u", static_cast<unsigned>(port));
+  if (cmd.truncated()) return false;
+
+  char resp[64];
+  const M5_SIM7080G::Status st = _modem.sendCommandInto(cmd, resp, sizeof(resp), timeout_ms, true);
+  _lastResult = -1;
+  if (st != M5_SIM7080G::Status::Ok) return false;
+
+  // +CAOPEN: <cid>,<result>
+  const char *p = strstr(resp, "+CAOPEN:");
+  if (!p) return false;
+  const char *comma = strchr(p, ',');
+  if (!comma) return false;
+  _lastResult = static_cast<int>(strtol(comma + 1, nullptr, 10));
+  // A cid left open from before a modem-side resume is still usable
+  _open = (_lastResult == kCaOpenOk || _lastResult == kCaOpenCidInUse);
+  return _open;
+}
+
+bool SIM7080G_Socket::close(uint32_t timeout_ms) {
+  _open = false;
+  sim7080g::FixedString<24> cmd;
+  cmd.appendf("AT+CACLOSE=%u", static_cast<unsigned>(_cid));
+  return _modem.sendCommandInto(cmd, nullptr, 0, timeout_ms, true) == M5_SIM7080G::Status::Ok;
+}
+
+bool SIM7080G_Socket::send(const uint8_t *data, size_t len, uint32_t timeout_ms) {
+  return send(nullptr, 0, data, len, timeout_ms);
+}
+
+bool SIM7080G_Socket::send(const uint8_t *head, size_t head_len, const uint8_t *data, size_t len,
+                           uint32_t timeout_ms) {
+  if (!head) head_len = 0;
+  if (!_open || !data || len == 0 || head_len + len > kMaxSendBytes) return false;
+
+  // The optional <inputtime> bounds how long the modem waits for the payload, so a lost
+  // prompt can't leave it swallowing the next AT command as data.
+  sim7080g::FixedString<40> cmd;
+  cmd.appendf("AT+CASEND=%u,%u,%lu", static_cast<unsigned>(_cid), static_cast<unsigned>(head_len + len),
+              static_cast<unsigned long>(timeout_ms));
+  const auto prompt = _modem.sendCommandForPrompt(cmd.c_str(), timeout_ms);
+  if (prompt.status != M5_SIM7080G::Status::Ok) {
+    _lastResult = -1;
+    // ERROR here means the modem no longer has this cid open
+    if (prompt.status == M5_SIM7080G::Status::Error) _open = false;
+    return false;
+  }
+
+  if ((head_len > 0 && !_modem.sendRaw(head, head_len)) || !_modem.sendRaw(data, len)) {
+    _lastResult = -1;
+    return false;
+  }
+  if (_modem.waitForFinal(timeout_ms).status != M5_SIM7080G::Status::Ok) {
+    _lastResult = -1;
+    return false;
+  }
+  return true;
+}
+
+int SIM7080G_Socket::recvText(char *out, size_t out_size, uint32_t timeout_ms) {
+  if (!out || out_size < 2) return -1;
+  out[0] = '\0';
+  if (!_rxPending) (void)_modem.pollUrcs(0);
+  if (!_open || !_rxPending) return 0;
+
+  sim7080g::FixedString<32> cmd;
+  cmd.appendf("AT+CARECV=%u,%u", static_cast<unsigned>(_cid), static_cast<unsigned>(out_size - 1));
+  char resp[160];
+  if (_modem.sendCommandInto(cmd, resp, sizeof(resp), timeout_ms, false) != M5_SIM7080G::Status::Ok) {
+    return -1;
+  }
+
+  // +CARECV: <len>,<data>   (or +CARECV: 0 once drained)
+  const char *p = strstr(resp, "+CARECV:");
+  if (!p) return -1;
+  char *end = nullptr;
+  const long n = strtol(p + 8, &end, 10);
+  if (n <= 0 || !end || *end != ',') {
+    _rxPending = false;
+    return 0;
+  }
+  const char *data = end + 1;
+  const char *eol = strstr(data, "\r\n");
+  size_t copy = eol ? static_cast<size_t>(eol - data) : strlen(data);
+  if (copy > static_cast<size_t>(n)) copy = static_cast<size_t>(n);
+  if (copy > out_size - 1) copy = out_size - 1;
+  memcpy(out, data, copy);
+  out[copy] = '\0';
+  return static_cast<int>(copy);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "M5_SIM7080G.h"
+
+// Client sockets on the modem's internal stack (AT+CAOPEN / AT+CASEND / AT+CACLOSE).
+// The socket stays open between sends; a +CASTATE report of the connection dropping
+// marks it closed so the next send can reopen it. One instance per modem owns the
+// +CASTATE and +CADATAIND handlers.
+class SIM7080G_Socket {
+  public:
+    static constexpr size_t kMaxSendBytes = 1459;  // AT+CASEND limit per call
+
+    explicit SIM7080G_Socket(M5_SIM7080G &modem, uint8_t cid = 0, uint8_t pdp_index = 0)
+        : _modem(modem), _cid(cid), _pdp(pdp_index) {}
+    ~SIM7080G_Socket();
+
+    bool openUdp(const char *host, uint16_t port, uint32_t timeout_ms = 10000);
+    bool close(uint32_t timeout_ms = 3000);
+
+    // Writes len bytes straight from data after the '>' prompt; no intermediate copy.
+    bool send(const uint8_t *data, size_t len, uint32_t timeout_ms = 5000);
+    // One datagram from two buffers (e.g. a protocol header and a payload held elsewhere)
+    bool send(const uint8_t *head, size_t head_len, const uint8_t *data, size_t len, uint32_t timeout_ms = 5000);
+
+    // Reads received bytes once +CADATAIND has reported some (AT+CARECV). The reply goes
+    // through the line parser, so this only suits text payloads without CR/LF. Returns the
+    // byte count (out is null-terminated), 0 when nothing is waiting, -1 on an AT error.
+    int recvText(char *out, size_t out_size, uint32_t timeout_ms = 1000);
+    bool dataPending() const { return _rxPending; }
+
+    bool isOpen() const { return _open; }
+    uint8_t cid() const { return _cid; }
+    // Reason for the last failure: the +CAOPEN result code, or -1 for an AT error/timeout
+    int lastResult() const { return _lastResult; }
+    uint32_t closedByNetwork() const { return _closedByNetwork; }
+
+  private:
+    static void _onCaState(const char *line, size_t len, void *ctx);
+    static void _onDataInd(const char *line, size_t len, void *ctx);
+    bool _registerUrcs();
+
+    M5_SIM7080G &_modem;
+    uint8_t _cid;
+    uint8_t _pdp;
+    volatile bool _open = false;
+    bool _urcRegistered = false;
+    volatile bool _rxPending = false;
+    int _lastResult = 0;
+    uint32_t _closedByNetwork = 0;
+};
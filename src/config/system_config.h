@@ -18,6 +18,36 @@
 #define FIRMWARE_BUILD_DATE __DATE__
 #define FIRMWARE_BUILD_TIME __TIME__
 
+// ============================================================================
+// BUILD PROFILES
+// ============================================================================
+// A profile picks the defaults of the feature flags below; any flag set on the
+// command line still wins (-DBUILD_PROFILE=BUILD_PROFILE_HEADLESS_GATEWAY
+// -DMODBUS_SLAVE_ENABLE=0). A feature that is off is compiled against the
+// module's inline stubs: no code, no static buffers, and its tasks get no
+// stack (TASK_IN_BUILD in task_config.h). kBuildFeatures, at the end of this
+// file, is the resulting set for code that tests features with plain if.
+#define BUILD_PROFILE_FULL 0                 // everything, display and CAN wiring as before
+#define BUILD_PROFILE_HEADLESS_GATEWAY 1     // PLC, Modbus, GNSS and uplink; no panel
+#define BUILD_PROFILE_DISPLAY_HMI 2          // panel and PLC on site; no CAN, no geofences
+#define BUILD_PROFILE_CAN_GATEWAY 3          // PWRCAN/J1939 to the uplink; no panel, no Modbus
+#define BUILD_PROFILE_RECOVERY 4             // modem, uplink and OTA only
+#ifndef BUILD_PROFILE
+#define BUILD_PROFILE BUILD_PROFILE_FULL
+#endif
+
+// The default for the current profile, from one value per profile in the order above
+#define BUILD_PROFILE_PICK(full, headless, hmi, can, recovery)           \
+    (BUILD_PROFILE == BUILD_PROFILE_HEADLESS_GATEWAY ? (headless)      \
+     : BUILD_PROFILE == BUILD_PROFILE_DISPLAY_HMI ? (hmi)              \
+     : BUILD_PROFILE == BUILD_PROFILE_CAN_GATEWAY ? (can)              \
+     : BUILD_PROFILE == BUILD_PROFILE_RECOVERY ? (recovery) : (full))
+
+// Panel, display task, UI pages, DMA strips and front-panel buttons
+#ifndef DISPLAY_ENABLE
+#define DISPLAY_ENABLE BUILD_PROFILE_PICK(1, 0, 1, 0, 0)
+#endif
+
 // ============================================================================
 // HARDWARE PIN DEFINITIONS
 // ============================================================================
@@ -39,6 +69,13 @@
 #ifndef CATM_PWRKEY_PIN
 #define CATM_PWRKEY_PIN -1
 #endif
+// Opt-in: negotiate a faster modem UART (AT+IPR) after bring-up; falls back to CATM_UART_BAUD
+#ifndef CATM_UART_HIGH_BAUD_ENABLE
+#define CATM_UART_HIGH_BAUD_ENABLE 0
+#endif
+#ifndef CATM_UART_HIGH_BAUD
+#define CATM_UART_HIGH_BAUD 921600
+#endif
 
 // ============================================================================
 // CATM CONFIGURATION
@@ -50,6 +87,28 @@
 #define CATM_PORT 80
 #define CATM_AT_TIMEOUT_MS 5000
 #define CATM_RETRY_COUNT 3
+// Power saving (PSM/eDRX) session manager; off by default
+#ifndef CATM_PSM_ENABLE
+#define CATM_PSM_ENABLE 0
+#endif
+#ifndef CATM_PSM_TAU_S
+#define CATM_PSM_TAU_S 3600        // requested periodic TAU (T3412 extended)
+#endif
+#ifndef CATM_PSM_ACTIVE_S
+#define CATM_PSM_ACTIVE_S 20       // requested active time after each wake (T3324)
+#endif
+#ifndef CATM_EDRX_ENABLE
+#define CATM_EDRX_ENABLE 0
+#endif
+#ifndef CATM_EDRX_CYCLE
+#define CATM_EDRX_CYCLE "0101"     // LTE-M eDRX value (3GPP 24.008): 0101 = 81.92 s
+#endif
+#ifndef CATM_TX_WINDOW_MS
+#define CATM_TX_WINDOW_MS 300000   // scheduled transmit window period while sleeping
+#endif
+#ifndef CATM_PSM_LINGER_MS
+#define CATM_PSM_LINGER_MS 5000    // stay awake this long after the uplink queue drains
+#endif
 
 // ============================================================================
 // GNSS CONFIGURATION
@@ -57,6 +116,33 @@
 #define GNSS_UPDATE_RATE_MS 1000
 #define GNSS_NMEA_BUFFER_SIZE 256
 #define GNSS_FIX_TIMEOUT_MS 30000
+// Streaming: fixes arrive as +UGNSINF URCs (AT+CGNSURC) instead of polling AT+CGNSINF
+#ifndef GNSS_STREAMING_ENABLE
+#define GNSS_STREAMING_ENABLE 1
+#endif
+#ifndef GNSS_STREAM_STALE_MS
+#define GNSS_STREAM_STALE_MS 5000   // no report for this long -> one polled fix and re-arm
+#endif
+// Track reduction: only fixes needed to redraw the track within TRACK_ERROR_M reach
+// the SD log and the uplink cadence; parked units keep a heartbeat point (track_reducer.h)
+#ifndef GNSS_TRACK_REDUCE_ENABLE
+#define GNSS_TRACK_REDUCE_ENABLE 1
+#endif
+// Geofences: circles and polygons from NVS / SD tested on every fix through a grid index;
+// confirmed entries and exits go out as transport alarms (modules/catm_gnss/geofence.h)
+#ifndef GEOFENCE_ENABLE
+#define GEOFENCE_ENABLE BUILD_PROFILE_PICK(1, 1, 0, 1, 0)
+#endif
+// GNSS assistance: XTRA orbits fetched into the modem file system over the data session and
+// injected before power-on, last fix kept in NVS for hot starts (modules/catm_gnss/gnss_assist.h)
+#ifndef GNSS_ASSIST_ENABLE
+#define GNSS_ASSIST_ENABLE 1
+#endif
+// Operator scan: AT+COPS=? one CAT-M band at a time in the RF arbiter's idle windows, results
+// cached in NVS for carrier selection (modules/catm_gnss/operator_scan.h)
+#ifndef OPERATOR_SCAN_ENABLE
+#define OPERATOR_SCAN_ENABLE 1
+#endif
 
 // ============================================================================
 // SYSTEM TIMING CONSTANTS
@@ -66,6 +152,10 @@
 #define SENSOR_READ_RATE_MS 1000
 #define CELLULAR_STATUS_CHECK_MS 10000
 #define DATA_TRANSMISSION_INTERVAL_MS 30000
+// Send telemetry as compact binary frames (transport/telemetry_codec.h) instead of JSON
+#ifndef TELEMETRY_BINARY_ENABLE
+#define TELEMETRY_BINARY_ENABLE 0
+#endif
 #define BUTTON_DEBOUNCE_MS 50
 #define LONG_PRESS_DURATION_MS 2000
 #define SCREEN_TIMEOUT_MS 10000
@@ -149,13 +239,188 @@
 #define ENABLE_GNSS_LOGGING true
 
 // Enable PWRCAN integration (guarded; disabled until wiring confirmed)
-// Integrated PWRCAN on StampPLC
-#define ENABLE_PWRCAN false
+// Integrated PWRCAN on StampPLC; on by default in the CAN gateway profile
+#ifndef ENABLE_PWRCAN
+#define ENABLE_PWRCAN BUILD_PROFILE_PICK(0, 0, 0, 1, 0)
+#endif
 #define ENABLE_WEB_SERVER false
 // SD card usage can produce noisy logs when no card is present.
 // Keep disabled by default for stability; enable when SD is required.
 #ifndef ENABLE_SD
-#define ENABLE_SD 1
+#define ENABLE_SD BUILD_PROFILE_PICK(1, 1, 1, 1, 0)
+#endif
+// Binary capture of received CAN frames to the SD card (modules/pwrcan/can_capture.h);
+// idle until started from the can_capture shared attribute
+#ifndef CAN_CAPTURE_ENABLE
+#define CAN_CAPTURE_ENABLE (ENABLE_PWRCAN && ENABLE_SD)
+#endif
+// Bench soak scenario (system/soak_bench.h): replayed modem, synthetic sensor and log
+// load, page cycling, and a JSON metrics/profiler line every minute on Serial and SD
+#ifndef SOAK_BENCH_ENABLE
+#define SOAK_BENCH_ENABLE 0
+#endif
+// Modem byte stream to SD for AT-path comparisons (modules/catm_gnss/modem_transcript.h):
+// 0 off, 1 record from CatMGNSSModule::begin(), 2 replay a recording in place of the modem
+#ifndef MODEM_TRANSCRIPT_MODE
+#define MODEM_TRANSCRIPT_MODE (SOAK_BENCH_ENABLE ? 2 : 0)
+#endif
+// Run the SD throughput/latency benchmark once at boot, before the storage task
+// starts (several seconds; report on Serial and in /data/bench.json)
+#ifndef ENABLE_SD_BENCHMARK
+#define ENABLE_SD_BENCHMARK 0
+#endif
+// Cycle every UI page under synthetic data once when the display task starts and
+// print frame timings (ui/ui_perf.h); a few seconds of benchmark frames on the panel
+#ifndef ENABLE_UI_BENCHMARK
+#define ENABLE_UI_BENCHMARK 0
+#endif
+// Time the modem, settings and CAN parsers on canned input once at boot and print
+// ns/op and allocations/op on Serial (system/parser_bench.h)
+#ifndef ENABLE_PARSER_BENCHMARK
+#define ENABLE_PARSER_BENCHMARK 0
+#endif
+// Remote log stream over the transport (modules/logging/log_uplink.h); compiled in,
+// stays off until the log_uplink shared attribute selects what to send
+#ifndef LOG_UPLINK_ENABLE
+#define LOG_UPLINK_ENABLE 1
+#endif
+// Diagnostics commands as ThingsBoard RPC over MQTT, output streamed as capped
+// Diagnostic records (modules/transport/remote_diag.h)
+#ifndef REMOTE_DIAG_ENABLE
+#define REMOTE_DIAG_ENABLE 1
+#endif
+// Uploads what the time log recorded during link outages, under a byte budget
+// (modules/transport/backfill.h); needs TIME_LOG_ENABLE
+#ifndef BACKFILL_ENABLE
+#define BACKFILL_ENABLE 1
+#endif
+// Heap allocation profiler and per-task heap budgets (system/heap_profiler.h,
+// system/task_heap.h); also needs the malloc --wrap linker flags listed there
+#ifndef HEAP_PROFILE_ENABLE
+#define HEAP_PROFILE_ENABLE 0
+#endif
+// Per-task and per-core CPU profiler (system/cpu_profiler.h): tick hooks plus a
+// sample every few seconds from the SysHealth service job
+#ifndef CPU_PROFILE_ENABLE
+#define CPU_PROFILE_ENABLE 1
+#endif
+// Response-time schedulability analysis (system/sched_analysis.h) over the CPU
+// profile, with a rate-monotonic priority suggestion, in the memory report
+#ifndef SCHED_ANALYSIS_ENABLE
+#define SCHED_ANALYSIS_ENABLE CPU_PROFILE_ENABLE
+#endif
+// Stack watermark soak profiler (system/stack_profiler.h): peaks persist in NVS
+// and the report carries recommended task_config.h stack sizes
+#ifndef STACK_PROFILE_ENABLE
+#define STACK_PROFILE_ENABLE 0
+#endif
+// Wait/hold histograms, timeouts and call sites for mutexes taken through
+// mutex_take()/MutexGuard (system/mutex_profiler.h); shown on the system page
+#ifndef MUTEX_PROFILE_ENABLE
+#define MUTEX_PROFILE_ENABLE 1
+#endif
+// Named counters, gauges and latency histograms in one registry (system/metrics.h);
+// printed with the memory report, on the system page and sent as Diagnostic records
+#ifndef METRICS_ENABLE
+#define METRICS_ENABLE 1
+#endif
+// Tiered load shedding from the metrics registry (system/load_shed.h): display rate, verbose
+// logs, GNSS rate and backfill given up in a configured order under pressure, then restored
+#ifndef LOAD_SHED_ENABLE
+#define LOAD_SHED_ENABLE METRICS_ENABLE
+#endif
+// CCOUNT timers on the AT command, SD write, page render, CAN dispatch and PLC scan
+// paths, one histogram per site in the metrics registry (system/hot_path_timer.h)
+#ifndef HOT_PATH_TIMER_ENABLE
+#define HOT_PATH_TIMER_ENABLE 0
+#endif
+// Binary trace of task switches, queue/semaphore traffic, ISRs and UI markers
+// (system/trace_recorder.h); kernel events also need the hooks in system/trace_hooks.h
+#ifndef TRACE_RECORDER_ENABLE
+#define TRACE_RECORDER_ENABLE 0
+#endif
+// Firmware updates from the ota_url shared attribute, streamed in HTTP Range
+// chunks into the inactive OTA partition, full or delta (modules/transport/ota_client.h)
+#ifndef OTA_CLIENT_ENABLE
+#define OTA_CLIENT_ENABLE 1
+#endif
+// Compact crash record from the panic handler, uploaded on the next boot
+// (system/crash_dump.h); needs the --wrap linker flag and partition listed there
+#ifndef CRASH_DUMP_ENABLE
+#define CRASH_DUMP_ENABLE 0
+#endif
+// Metrics, newest log lines and trace events kept in RTC memory across any
+// reset and uploaded on the next boot (system/reset_journal.h)
+#ifndef RESET_JOURNAL_ENABLE
+#define RESET_JOURNAL_ENABLE 1
+#endif
+// Core affinity tuner (system/core_affinity.h): plans task placement from the CPU
+// profile and trace wakeups; APPLY saves the plan to NVS for the next boot
+#ifndef CORE_AFFINITY_ENABLE
+#define CORE_AFFINITY_ENABLE 1
+#endif
+#ifndef CORE_AFFINITY_APPLY
+#define CORE_AFFINITY_APPLY 0
+#endif
+// DFS and automatic light sleep with PM locks around UART, SD and display
+// transfers (system/power_manager.h); DFS/sleep also need CONFIG_PM_ENABLE
+#ifndef POWER_PM_ENABLE
+#define POWER_PM_ENABLE 0
+#endif
+// INA226 charge split between modem, GNSS, display and CPU by their state hooks,
+// mAh per subsystem per day (system/energy_account.h)
+#ifndef ENERGY_ACCOUNT_ENABLE
+#define ENERGY_ACCOUNT_ENABLE 1
+#endif
+// Edge timestamps, pulse counters and frequency for the PLC inputs
+// (hardware/input_capture.h); GPIO interrupts for inputs also wired to the ESP32
+#ifndef INPUT_CAPTURE_ENABLE
+#define INPUT_CAPTURE_ENABLE BUILD_PROFILE_PICK(1, 1, 1, 1, 0)
+#endif
+// PLC inputs read and relays written as one I/O expander transaction each per scan
+// (hardware/plc_io.h); 0 goes back to one call per channel
+#ifndef PLC_IO_BULK_ENABLE
+#define PLC_IO_BULK_ENABLE 1
+#endif
+// Relay and alarm logic as a bytecode program run by the PLC scan (hardware/plc_logic.h),
+// stored in NVS and importable from the SD card
+#ifndef PLC_LOGIC_ENABLE
+#define PLC_LOGIC_ENABLE BUILD_PROFILE_PICK(1, 1, 1, 1, 0)
+#endif
+// Threshold alarms with hysteresis, deadbands and delays evaluated in the PLC scan
+// (hardware/alarm_eval.h); only transitions are sent
+#ifndef ALARM_EVAL_ENABLE
+#define ALARM_EVAL_ENABLE BUILD_PROFILE_PICK(1, 1, 1, 1, 0)
+#endif
+// Continuous DMA ADC sampling and windowed min/max/mean/RMS of the analog values
+// (hardware/analog_sampler.h); only the window aggregates are logged and sent
+#ifndef ANALOG_SAMPLER_ENABLE
+#define ANALOG_SAMPLER_ENABLE BUILD_PROFILE_PICK(1, 1, 1, 0, 0)
+#endif
+// Fuel burn rate, time to empty and service projections updated per sample and memoized for
+// the UI, uplink and Modbus slave (hardware/generator_derived.h)
+#ifndef GEN_DERIVED_ENABLE
+#define GEN_DERIVED_ENABLE 1
+#endif
+// Modbus RTU master polling genset controllers over RS485 with packed requests
+// (hardware/modbus_master.h); idle until a point is configured
+#ifndef MODBUS_MASTER_ENABLE
+#define MODBUS_MASTER_ENABLE BUILD_PROFILE_PICK(1, 1, 1, 0, 0)
+#endif
+// Modbus slave serving the PLC and generator snapshots to SCADA over RS485 and
+// TCP (hardware/modbus_slave.h); RTU only with MODBUS_SLAVE_ADDRESS set
+#ifndef MODBUS_SLAVE_ENABLE
+#define MODBUS_SLAVE_ENABLE BUILD_PROFILE_PICK(1, 1, 1, 0, 0)
+#endif
+// Render pages into two SRAM strips and push them with DMA, drawing the next
+// strip while the last one goes out (ui/components/ui_widgets.h)
+#ifndef UI_DMA_STRIPS_ENABLE
+#define UI_DMA_STRIPS_ENABLE DISPLAY_ENABLE
+#endif
+// Allocate every task stack/TCB, queue, mutex, event group and timer listed in
+// task_config.h from static buffers (system/kernel_objects.h) instead of the heap
+#ifndef STATIC_KERNEL_ALLOC_ENABLE
+#define STATIC_KERNEL_ALLOC_ENABLE 0
 #endif
 // Optional: enable web font upload endpoint (/upload, /api/upload_font)
 // Disabled by default to reduce heap pressure
@@ -163,6 +428,37 @@
 #define ENABLE_WEB_FONT_UPLOAD 0
 #endif
 
+// What this build carries, after the profile and any overrides above
+struct BuildFeatures {
+    const char* profile;
+    bool display;
+    bool sd;
+    bool pwrcan;
+    bool modbusMaster;
+    bool modbusSlave;
+    bool plcLogic;
+    bool alarms;
+    bool analogSampler;
+    bool inputCapture;
+    bool geofence;
+};
+
+constexpr BuildFeatures kBuildFeatures = {
+    BUILD_PROFILE_PICK("full", "headless-gateway", "display-hmi", "can-gateway", "recovery"),
+    DISPLAY_ENABLE != 0,
+    ENABLE_SD != 0,
+    ENABLE_PWRCAN != 0,
+    MODBUS_MASTER_ENABLE != 0,
+    MODBUS_SLAVE_ENABLE != 0,
+    PLC_LOGIC_ENABLE != 0,
+    ALARM_EVAL_ENABLE != 0,
+    ANALOG_SAMPLER_ENABLE != 0,
+    INPUT_CAPTURE_ENABLE != 0,
+    GEOFENCE_ENABLE != 0,
+};
+
+static_assert(BUILD_PROFILE >= BUILD_PROFILE_FULL && BUILD_PROFILE <= BUILD_PROFILE_RECOVERY, "unknown BUILD_PROFILE");
+
 // PWRCAN default pins/bitrate (to be confirmed with PWRCAN module wiring)
 #define PWRCAN_TX_PIN  42
 #define PWRCAN_RX_PIN  43
@@ -18,30 +18,62 @@
 // ============================================================================
 // TASK PRIORITIES (Higher number = Higher priority)
 // ============================================================================
-#define TASK_PRIORITY_SYSTEM_MONITOR    3
 #define TASK_PRIORITY_INDUSTRIAL_IO     4
 #define TASK_PRIORITY_SENSOR            4
 #define TASK_PRIORITY_GNSS              3
 #define TASK_PRIORITY_CELLULAR          3
 #define TASK_PRIORITY_DISPLAY           2
 #define TASK_PRIORITY_DATA_TRANSMIT     2
-#define TASK_PRIORITY_BUTTON_HANDLER    1
+#define TASK_PRIORITY_MODEM_IO          3   // Same as cellular; owns the AT command stream
+#define TASK_PRIORITY_LOG_COMPACTOR     1   // Background rewrite of old time-log segments
+#define TASK_PRIORITY_DEBUG_SINK        1   // Drains LOG_MACRO lines to Serial
+#define TASK_PRIORITY_SERVICE           1   // Timer-wheel jobs: monitors, watchdog supervision
+#define TASK_PRIORITY_WORK              1   // Deferred jobs (work_queue.h); below the display
+#define TASK_PRIORITY_MODBUS            3   // RS485 poll cycle; response timing matters
+#define TASK_PRIORITY_RS485_RX          5   // Closes RS485 frames at the UART timeout; no parsing
+#define TASK_PRIORITY_PWRCAN            4   // Sleeps on TWAI alerts, drains the RX queue in bursts
 
 // ============================================================================
 // TASK STACK SIZES (in words, 4 bytes per word on ESP32)
 // ============================================================================
-#define TASK_STACK_SIZE_SYSTEM_MONITOR  8192  // 32KB - prevent StatusBar stack overflow
 #define TASK_STACK_SIZE_INDUSTRIAL_IO   2048  // 8KB - increased to prevent stack overflow
 #define TASK_STACK_SIZE_SENSOR          2048  // 8KB - increased to prevent stack overflow
 #define TASK_STACK_SIZE_GNSS            1024  // 4KB
 #define TASK_STACK_SIZE_CELLULAR        1536  // 6KB
 #define TASK_STACK_SIZE_DISPLAY         3072   // 12KB - increased for M5GFX rendering and UI processing
 #define TASK_STACK_SIZE_DATA_TRANSMIT   1024  // 4KB
-#define TASK_STACK_SIZE_BUTTON_HANDLER  4096  // 16KB (increased from 8KB)
 
 // Application-specific task sizes (words) optimized for no-PSRAM StampS3A
 #define TASK_STACK_SIZE_APP_DISPLAY     3072  // 12KB (M5GFX rendering) - reduced
 #define TASK_STACK_SIZE_APP_GNSS        5120  // 20KB (AT I/O, JSON, PDP) - reduced
+#define TASK_STACK_SIZE_MODEM_IO        3072  // 12KB (AT send/parse, response String)
+#define TASK_STACK_SIZE_LOG_COMPACTOR   2048  // 8KB (record JSON parse, rollup formatting)
+#define TASK_STACK_SIZE_DEBUG_SINK      1024  // 4KB (one line copy, Serial.write)
+#define TASK_STACK_SIZE_STORAGE         4096  // 16KB (SD writes, time-log records)
+#define TASK_STACK_SIZE_SERVICE         4096  // 16KB (deepest job: crash recovery checks)
+#define TASK_STACK_SIZE_WORK_MODEM      5120  // 20KB (CatM re-probe: module begin, AT init)
+#define TASK_STACK_SIZE_WORK_APP        4096  // 16KB (settings journal, SD export)
+#define TASK_STACK_SIZE_MODBUS          1536  // 6KB (one RTU frame, log line)
+#define TASK_STACK_SIZE_RS485_RX        768   // 3KB (UART events into pooled frames)
+#define TASK_STACK_SIZE_PWRCAN          1536  // 6KB (frame decode, calibration, self-test printf)
+
+// ============================================================================
+// TASK HEAP BUDGETS (bytes of live heap a task may hold; 0 = accounted only)
+// ============================================================================
+// Enforced by system/task_heap.h when the heap hooks are built in
+#define TASK_HEAP_BUDGET_APP_GNSS       (48 * 1024)  // AT responses, JSON documents, Strings
+#define TASK_HEAP_BUDGET_DISPLAY        (24 * 1024)  // sprite buffers
+#define TASK_HEAP_BUDGET_INDUSTRIAL_IO  (8 * 1024)
+#define TASK_HEAP_BUDGET_STORAGE        (16 * 1024)
+#define TASK_HEAP_BUDGET_LOG_COMPACTOR  (8 * 1024)
+
+// Task name -> budget, matched when a task first allocates
+#define TASK_HEAP_BUDGETS(X)                             \
+    X("CatMGNSS", TASK_HEAP_BUDGET_APP_GNSS)             \
+    X("Display", TASK_HEAP_BUDGET_DISPLAY)               \
+    X("StampPLC", TASK_HEAP_BUDGET_INDUSTRIAL_IO)        \
+    X("Storage", TASK_HEAP_BUDGET_STORAGE)               \
+    X("LogCompact", TASK_HEAP_BUDGET_LOG_COMPACTOR)
 
 // Stack monitoring thresholds for no-PSRAM
 #define STACK_WATERMARK_WARNING_THRESHOLD 512   // 512 words (2KB) warning
@@ -67,6 +99,14 @@
 #define QUEUE_SIZE_DISPLAY_CMD          10
 #define QUEUE_SIZE_ERROR_LOG            20
 #define QUEUE_SIZE_BUTTON_EVENT         5
+#define QUEUE_SIZE_MODEM_CMD            8
+#define QUEUE_SIZE_UI_EVENT             16
+#define QUEUE_SIZE_RS485_FRAMES         4
+
+// Largest item each queue carries; call sites static_assert their item type fits
+#define QUEUE_ITEM_BYTES_UI_EVENT       4     // UIEvent
+#define QUEUE_ITEM_BYTES_MODEM_CMD      192   // ModemCommandQueue::Request (command + 24 B)
+#define QUEUE_ITEM_BYTES_RS485_FRAME    4     // pointer to a pooled frame
 
 #define QUEUE_TIMEOUT_MS                100
 #define QUEUE_TIMEOUT_TICKS             pdMS_TO_TICKS(QUEUE_TIMEOUT_MS)
@@ -90,11 +130,71 @@
 #define EVENT_BIT_SLEEP_MODE            (1UL << 7)
 
 // Event-driven task coordination bits
+// GNSS data ready, status change and heap low (bits 9, 11, 12) are event bus
+// topics now (system/event_bus.h)
 #define EVENT_BIT_GNSS_UPDATE_REQ       (1UL << 8)
-#define EVENT_BIT_GNSS_DATA_READY       (1UL << 9)
 #define EVENT_BIT_SYSTEM_ERROR          (1UL << 10)
-#define EVENT_BIT_STATUS_CHANGE         (1UL << 11)
-#define EVENT_BIT_HEAP_LOW              (1UL << 12)
+#define EVENT_BIT_MODEM_RX              (1UL << 13)   // modem UART bytes arrived (CatM task wakeup)
+#define EVENT_BIT_UPLINK_QUEUED         (1UL << 14)   // transport record queued (CatM task wakeup)
+
+// ============================================================================
+// KERNEL OBJECT TABLE
+// ============================================================================
+// Every task, queue, message buffer, mutex, event group and timer the firmware
+// creates, by id. With STATIC_KERNEL_ALLOC_ENABLE each entry gets its buffers
+// reserved at link time (system/kernel_objects.h); otherwise they come from the
+// heap as before. A task the build leaves out (BUILD_PROFILE and the feature
+// flags in system_config.h) gets stack 0 through TASK_IN_BUILD: nothing is
+// reserved for it and kernel_task_create() refuses it.
+//   X(id, name, stack size)
+#define TASK_IN_BUILD(enabled, stack) ((enabled) ? (stack) : 0)
+#define TASK_MODBUS_IN_BUILD (MODBUS_MASTER_ENABLE || MODBUS_SLAVE_ENABLE)
+
+#define KERNEL_TASKS(X)                                                                  \
+    X(Display, "Display", TASK_IN_BUILD(DISPLAY_ENABLE, TASK_STACK_SIZE_DISPLAY))        \
+    X(StampPLC, "StampPLC", TASK_STACK_SIZE_INDUSTRIAL_IO)                               \
+    X(CatMGNSS, "CatMGNSS", TASK_STACK_SIZE_APP_GNSS)                                    \
+    X(Storage, "Storage", TASK_IN_BUILD(ENABLE_SD, TASK_STACK_SIZE_STORAGE))             \
+    X(LogCompact, "LogCompact", TASK_IN_BUILD(ENABLE_SD, TASK_STACK_SIZE_LOG_COMPACTOR)) \
+    X(DebugSink, "DebugSink", TASK_STACK_SIZE_DEBUG_SINK)                                \
+    X(ModemIO, "ModemIO", TASK_STACK_SIZE_MODEM_IO)                                      \
+    X(Service, "Service", TASK_STACK_SIZE_SERVICE)                                       \
+    X(Work0, "Work0", TASK_STACK_SIZE_WORK_MODEM)                                        \
+    X(Work1, "Work1", TASK_STACK_SIZE_WORK_APP)                                          \
+    X(Modbus, "Modbus", TASK_IN_BUILD(TASK_MODBUS_IN_BUILD, TASK_STACK_SIZE_MODBUS))     \
+    X(Rs485Rx, "Rs485Rx", TASK_IN_BUILD(TASK_MODBUS_IN_BUILD, TASK_STACK_SIZE_RS485_RX)) \
+    X(PWRCAN, "PWRCAN", TASK_IN_BUILD(ENABLE_PWRCAN, TASK_STACK_SIZE_PWRCAN))
+
+//   X(id, length, item bytes)
+#define KERNEL_QUEUES(X)                                                  \
+    X(UiEvents, QUEUE_SIZE_UI_EVENT, QUEUE_ITEM_BYTES_UI_EVENT)           \
+    X(ModemCmd, QUEUE_SIZE_MODEM_CMD, QUEUE_ITEM_BYTES_MODEM_CMD)       \
+    X(Rs485Frames, QUEUE_SIZE_RS485_FRAMES, QUEUE_ITEM_BYTES_RS485_FRAME)
+
+//   X(id, bytes)
+#define KERNEL_MESSAGE_BUFFERS(X) \
+    X(StorageIngest, STORAGE_INGEST_BYTES)
+
+//   X(id)
+#define KERNEL_MUTEXES(X)   \
+    X(Sd)                   \
+    X(StorageIngest)        \
+    X(LogBuffer)            \
+    X(Settings)             \
+    X(ModemSerial)          \
+    X(TransportQueue)       \
+    X(TransportProcess)     \
+    X(PlcIo)                \
+    X(MemoryMonitor)        \
+    X(CrashRecovery)
+
+#define KERNEL_EVENT_GROUPS(X) \
+    X(SystemStatus)            \
+    X(BootStages)
+
+//   X(id, name)
+#define KERNEL_TIMERS(X) \
+    X(CrashWatchdog, "CrashRecoveryWDT")
 
 // ============================================================================
 // TASK HANDLES
@@ -1,4 +1,11 @@
 #include "../include/debug_system.h"
+#include "modules/logging/log_uplink.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
 
 // Default log level
 static LogLevel current_log_level = DEBUG_LOG_LEVEL_INFO;
@@ -9,4 +16,171 @@ void set_log_level(LogLevel level) {
 
 LogLevel get_log_level() {
     return current_log_level;
-}
\ No newline at end of file
+}
+
+// ============================================================================
+// Per-tag thresholds
+// ============================================================================
+uint8_t g_logTagLevel[LOG_TAG_COUNT] = {
+    DEBUG_LOG_LEVEL_INFO, DEBUG_LOG_LEVEL_INFO, DEBUG_LOG_LEVEL_INFO, DEBUG_LOG_LEVEL_WARN,
+    DEBUG_LOG_LEVEL_INFO, DEBUG_LOG_LEVEL_INFO, DEBUG_LOG_LEVEL_WARN,
+};
+
+static const char* const kTagNames[LOG_TAG_COUNT] = {"CATM", "GNSS", "STORAGE", "UI", "PLC", "CAN", "SCHED"};
+static const char* const kLevelNames[] = {"NONE", "ERROR", "WARN", "INFO", "DEBUG", "VERBOSE"};
+
+void log_tag_set_level(LogTag tag, LogLevel level) {
+    if (tag < LOG_TAG_COUNT && level <= DEBUG_LOG_LEVEL_VERBOSE) {
+        g_logTagLevel[tag] = static_cast<uint8_t>(level);
+    }
+}
+
+LogLevel log_tag_get_level(LogTag tag) {
+    return tag < LOG_TAG_COUNT ? static_cast<LogLevel>(g_logTagLevel[tag]) : DEBUG_LOG_LEVEL_NONE;
+}
+
+const char* log_tag_name(LogTag tag) {
+    return tag < LOG_TAG_COUNT ? kTagNames[tag] : "?";
+}
+
+bool log_level_parse(const char* s, size_t len, LogLevel& out) {
+    if (len == 1 && s[0] >= '0' && s[0] <= '5') {
+        out = static_cast<LogLevel>(s[0] - '0');
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(kLevelNames) / sizeof(kLevelNames[0]); i++) {
+        if (strlen(kLevelNames[i]) == len && strncasecmp(kLevelNames[i], s, len) == 0) {
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool log_tag_parse(const char* s, size_t len, LogTag& out) {
+    for (uint8_t t = 0; t < LOG_TAG_COUNT; t++) {
+        if (strlen(kTagNames[t]) == len && strncasecmp(kTagNames[t], s, len) == 0) {
+            out = static_cast<LogTag>(t);
+            return true;
+        }
+    }
+    return false;
+}
+
+int log_tag_apply(const char* spec) {
+    if (!spec) return 0;
+    int changed = 0;
+    const char* p = spec;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        if (!end) end = p + strlen(p);
+        const char* eq = static_cast<const char*>(memchr(p, '=', end - p));
+        LogLevel level;
+        LogTag tag;
+        if (eq && log_level_parse(eq + 1, end - eq - 1, level) && log_tag_parse(p, eq - p, tag)) {
+            if (g_logTagLevel[tag] != level) changed++;
+            g_logTagLevel[tag] = static_cast<uint8_t>(level);
+        }
+        p = *end ? end + 1 : end;
+    }
+    return changed;
+}
+
+void log_tag_write(LogTag tag, LogLevel level, const char* fmt, ...) {
+    char buf[DEBUG_SINK_LINE_BYTES];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n <= 0) return;
+    if (static_cast<size_t>(n) >= sizeof(buf)) n = sizeof(buf) - 1;
+#if ENABLE_DEBUG_SYSTEM
+    debug_sink_write(buf, static_cast<size_t>(n));
+#endif
+#if LOG_UPLINK_ENABLE
+    log_uplink_offer(tag, level, buf);
+#else
+    (void)tag;
+    (void)level;
+#endif
+}
+
+// ============================================================================
+// Async serial sink
+// ============================================================================
+struct DebugSinkSlot {
+    uint8_t len;
+    char text[DEBUG_SINK_LINE_BYTES];
+};
+
+static DebugSinkSlot s_sink[DEBUG_SINK_SLOTS];
+static uint32_t s_sinkHead = 0;      // next write
+static uint32_t s_sinkTail = 0;      // next to print
+static uint32_t s_sinkDropped = 0;
+static DebugSinkMode s_sinkMode = DEBUG_SINK_DROP_NEWEST;
+static TaskHandle_t s_sinkTask = nullptr;
+static portMUX_TYPE s_sinkMux = portMUX_INITIALIZER_UNLOCKED;
+
+void debug_sink_set_mode(DebugSinkMode mode) {
+    s_sinkMode = mode;
+}
+
+uint32_t debug_sink_dropped() {
+    return s_sinkDropped;
+}
+
+void debug_sink_write(const char* line, size_t len) {
+    if (!line) return;
+    if (!s_sinkTask) {
+        Serial.write(reinterpret_cast<const uint8_t*>(line), len);
+        Serial.write('\n');
+        return;
+    }
+    if (len > DEBUG_SINK_LINE_BYTES) len = DEBUG_SINK_LINE_BYTES;
+    portENTER_CRITICAL(&s_sinkMux);
+    if (s_sinkHead - s_sinkTail >= DEBUG_SINK_SLOTS) {
+        s_sinkDropped++;
+        if (s_sinkMode == DEBUG_SINK_DROP_NEWEST) {
+            portEXIT_CRITICAL(&s_sinkMux);
+            return;
+        }
+        s_sinkTail++;
+    }
+    DebugSinkSlot& slot = s_sink[s_sinkHead % DEBUG_SINK_SLOTS];
+    memcpy(slot.text, line, len);
+    slot.len = static_cast<uint8_t>(len);
+    s_sinkHead++;
+    portEXIT_CRITICAL(&s_sinkMux);
+    xTaskNotifyGive(s_sinkTask);
+}
+
+extern "C" void vTaskDebugSink(void* pvParameters) {
+    (void)pvParameters;
+    s_sinkTask = xTaskGetCurrentTaskHandle();
+    uint32_t reportedDrops = 0;
+    char line[DEBUG_SINK_LINE_BYTES];
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        for (;;) {
+            size_t len = 0;
+            portENTER_CRITICAL(&s_sinkMux);
+            const bool any = s_sinkTail != s_sinkHead;
+            if (any) {
+                const DebugSinkSlot& slot = s_sink[s_sinkTail % DEBUG_SINK_SLOTS];
+                len = slot.len;
+                memcpy(line, slot.text, len);
+                s_sinkTail++;
+            }
+            portEXIT_CRITICAL(&s_sinkMux);
+            if (!any) break;
+            // The UART wait happens here, on this task, outside the critical section
+            Serial.write(reinterpret_cast<const uint8_t*>(line), len);
+            Serial.write('\n');
+        }
+        const uint32_t dropped = s_sinkDropped;
+        if (dropped != reportedDrops) {
+            Serial.printf("[debug_sink] %lu lines dropped\n", static_cast<unsigned long>(dropped - reportedDrops));
+            reportedDrops = dropped;
+        }
+    }
+}
@@ -0,0 +1,352 @@
+/*
+ * Alarm Evaluator Implementation
+ */
+
+#include "alarm_eval.h"
+
+#if ALARM_EVAL_ENABLE
+
+#include "plc_scan.h"
+#include "generator_calibration.h"
+#include "generator_status.h"
+#include "input_capture.h"
+#include "sensor_acquisition.h"
+#include "../system/work_queue.h"
+#include "../modules/logging/log_buffer.h"
+#include "../modules/transport/shared_attributes.h"
+#include "../modules/transport/live_config.h"
+#include "../../include/transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if ENABLE_PWRCAN
+#include "../modules/pwrcan/pwrcan_module.h"
+extern PWRCANModule* pwrcanModule;
+#endif
+
+namespace {
+constexpr size_t kAlarms = (size_t)AlarmId::Count;
+constexpr size_t kSignals = (size_t)AlarmSignal::Count;
+
+const char* const kKeys[kAlarms] = {
+#define ALARM_KEY(id, key, signal, high, thr, hyst, dband, on, off, latch) key,
+    ALARM_TABLE(ALARM_KEY)
+#undef ALARM_KEY
+};
+
+// Live configuration keys, "alarm_" and the rule key
+const char* const kConfigKeys[kAlarms] = {
+#define ALARM_CONFIG_KEY(id, key, signal, high, thr, hyst, dband, on, off, latch) "alarm_" key,
+    ALARM_TABLE(ALARM_CONFIG_KEY)
+#undef ALARM_CONFIG_KEY
+};
+
+// Thresholds a remote setting may choose, per AlarmSignal
+struct Range {
+    int32_t min;
+    int32_t max;
+};
+const Range kThresholdRange[kSignals] = {
+    {0, 100}, {0, 100}, {0, 100}, {0, 100},      // %
+    {0, 10000},                                  // rpm
+    {0, 36000},                                  // mV
+    {-400, 1250},                                // 0.1 C
+};
+
+const AlarmRule kDefaults[kAlarms] = {
+#define ALARM_RULE(id, key, signal, high, thr, hyst, dband, on, off, latch) \
+    {AlarmSignal::signal, high, true, latch, thr, hyst, dband, on, off},
+    ALARM_TABLE(ALARM_RULE)
+#undef ALARM_RULE
+};
+
+struct Alarm {
+    bool have;               // value holds a reading
+    bool condition;          // threshold test with hysteresis, before the delays
+    bool active;
+    bool acked;
+    bool valid;
+    int32_t value;
+    uint32_t pendingSince;   // condition != active since, 0 = not pending
+    uint32_t changedMs;
+    uint32_t transitions;
+};
+
+struct Event {
+    uint8_t id;
+    bool active;
+    int32_t value;
+    uint32_t ms;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+AlarmRule s_rules[kAlarms];              // under s_mux; the scan copies the one it evaluates
+Alarm s_alarms[kAlarms];                 // scan task; status readers take s_mux
+Event s_events[ALARM_EVAL_EVENTS];       // under s_mux
+uint32_t s_head = 0;
+uint32_t s_tail = 0;
+uint32_t s_lost = 0;
+uint32_t s_lastSubmitMs = 0;
+uint32_t s_attrVersion = 0;
+bool s_started = false;
+
+// This scan's readings; valid[s] false when the signal has none
+void sample(int32_t* value, bool* valid, uint32_t now) {
+    for (size_t s = 0; s < kSignals; s++) valid[s] = false;
+
+#if ENABLE_PWRCAN
+    if (pwrcanModule && pwrcanModule->isStarted()) {
+        const CanGeneratorSnapshot g = pwrcanModule->getGeneratorProtocol().snapshot();
+        if (g.sensorsMs && now - g.sensorsMs < ALARM_EVAL_CAN_STALE_MS) {
+            value[(size_t)AlarmSignal::FuelLevel] = generator_calibrate(GenSensor::FuelLevel, g.sensors.fuelLevel);
+            value[(size_t)AlarmSignal::OilLevel] = generator_calibrate(GenSensor::OilLevel, g.sensors.oilLevel);
+            value[(size_t)AlarmSignal::FuelFilterLife] =
+                100 - generator_calibrate(GenSensor::FuelFilter, g.sensors.fuelFilter);
+            value[(size_t)AlarmSignal::OilFilterLife] =
+                100 - generator_calibrate(GenSensor::OilFilter, g.sensors.oilFilter);
+            for (size_t s = (size_t)AlarmSignal::FuelLevel; s <= (size_t)AlarmSignal::OilFilterLife; s++) {
+                valid[s] = true;
+            }
+        }
+    }
+#endif
+
+#if GENERATOR_RPM_INPUT >= 0
+    InputChannelStats ch;
+    if (input_capture_channel(GENERATOR_RPM_INPUT, ch)) {
+        value[(size_t)AlarmSignal::EngineRpm] =
+            (int32_t)((uint64_t)ch.freqMilliHz * 60 / 1000 / GENERATOR_RPM_PULSES_PER_REV);
+        valid[(size_t)AlarmSignal::EngineRpm] = true;
+    }
+#endif
+
+    const PlcSensorSnapshot p = sensor_acq_snapshot();
+    if (p.powerOk && p.powerMs) {
+        value[(size_t)AlarmSignal::BusVoltage] = (int32_t)(p.busVoltage * 1000.0f);
+        valid[(size_t)AlarmSignal::BusVoltage] = true;
+    }
+    if (p.tempOk && p.tempMs) {
+        value[(size_t)AlarmSignal::Temperature] = (int32_t)(p.temperature * 10.0f);
+        valid[(size_t)AlarmSignal::Temperature] = true;
+    }
+}
+
+// An alarm_<key> setting moves its rule's threshold; deleting it restores the table value
+bool applyThreshold(const LiveConfigValue& v, void* ctx) {
+    const size_t i = (size_t)(uintptr_t)ctx;
+    portENTER_CRITICAL(&s_mux);
+    s_rules[i].threshold = v.present ? v.number : kDefaults[i].threshold;
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+// The rpm_alert shared attribute sets the overspeed threshold
+void followSharedAttributes() {
+    const uint32_t version = g_sharedAttributes.version();
+    if (version == s_attrVersion) return;
+    s_attrVersion = version;
+    SharedAttributes attrs;
+    g_sharedAttributes.get(attrs);
+    const bool set = (attrs.present & SHARED_ATTR_RPM_ALERT) && attrs.rpmAlert > 0;
+    AlarmRule& r = s_rules[(size_t)AlarmId::Overspeed];
+    portENTER_CRITICAL(&s_mux);
+    r.threshold = set ? attrs.rpmAlert : 0;
+    r.enabled = set;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// From the work queue on the modem core: log and uplink the queued transitions
+void drainJob(void*) {
+    for (;;) {
+        Event e;
+        portENTER_CRITICAL(&s_mux);
+        const uint32_t index = s_tail;
+        const bool any = index != s_head;
+        if (any) e = s_events[index % ALARM_EVAL_EVENTS];
+        portEXIT_CRITICAL(&s_mux);
+        if (!any) return;
+
+        char json[96];
+        const int n = snprintf(json, sizeof(json), "{\"alarm\":\"%s\",\"active\":%s,\"value\":%ld,\"age_ms\":%lu}",
+                               kKeys[e.id], e.active ? "true" : "false", (long)e.value,
+                               (unsigned long)(millis() - e.ms));
+        if (n <= 0 || n >= (int)sizeof(json) || !transport_sendAlarm(json, (size_t)n)) return;   // retried from the scan
+        logbuf_printf("Alarm: %s %s (%ld)", kKeys[e.id], e.active ? "raised" : "cleared", (long)e.value);
+
+        portENTER_CRITICAL(&s_mux);
+        // A full ring may have dropped the event meanwhile
+        if (s_tail == index) s_tail++;
+        portEXIT_CRITICAL(&s_mux);
+    }
+}
+
+void submitDrain(uint32_t now) {
+    s_lastSubmitMs = now;
+    work_submit("AlarmUplink", drainJob, nullptr, WorkPriority::High, WORK_CORE_MODEM, WORK_COALESCE);
+}
+
+void push(uint8_t id, bool active, int32_t value, uint32_t now) {
+    portENTER_CRITICAL(&s_mux);
+    s_events[s_head % ALARM_EVAL_EVENTS] = Event{id, active, value, now};
+    s_head++;
+    if (s_head - s_tail > ALARM_EVAL_EVENTS) {
+        s_tail = s_head - ALARM_EVAL_EVENTS;
+        s_lost++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool evaluate(Alarm& a, const AlarmRule& r, int32_t v, uint32_t now) {
+    if (!a.have || abs(v - a.value) >= r.deadband) a.value = v;
+    a.have = true;
+    if (r.high) {
+        a.condition = a.condition ? a.value >= r.threshold - r.hysteresis : a.value >= r.threshold;
+    } else {
+        a.condition = a.condition ? a.value <= r.threshold + r.hysteresis : a.value <= r.threshold;
+    }
+
+    // A latched alarm leaves the active state only once acknowledged
+    const bool want = a.condition || (r.latched && a.active && !a.acked);
+    if (want == a.active) {
+        a.pendingSince = 0;
+        return false;
+    }
+    if (!a.pendingSince) a.pendingSince = now ? now : 1;
+    if (now - a.pendingSince < (want ? r.delayOnMs : r.delayOffMs)) return false;
+    a.active = want;
+    a.acked = false;
+    a.pendingSince = 0;
+    a.changedMs = now;
+    a.transitions++;
+    return true;
+}
+
+// Scan logic phase
+void scanPhase(const PlcIoSnapshot&, void*) {
+    const uint32_t now = millis();
+    followSharedAttributes();
+    int32_t value[kSignals];
+    bool valid[kSignals];
+    sample(value, valid, now);
+
+    bool queued = false;
+    for (size_t i = 0; i < kAlarms; i++) {
+        portENTER_CRITICAL(&s_mux);
+        const AlarmRule r = s_rules[i];
+        portEXIT_CRITICAL(&s_mux);
+        Alarm& a = s_alarms[i];
+        const size_t sig = (size_t)r.signal;
+        a.valid = r.enabled && sig < kSignals && valid[sig];
+        if (!a.valid) {
+            // No reading, or disabled: hold the state, restart the pending delay
+            a.pendingSince = 0;
+            if (!r.enabled && a.active) {
+                a.active = false;
+                a.changedMs = now;
+                a.transitions++;
+                push((uint8_t)i, false, a.value, now);
+                queued = true;
+            }
+            continue;
+        }
+        portENTER_CRITICAL(&s_mux);
+        const bool changed = evaluate(a, r, value[sig], now);
+        portEXIT_CRITICAL(&s_mux);
+        if (changed) {
+            push((uint8_t)i, a.active, a.value, now);
+            queued = true;
+        }
+    }
+
+    bool pending;
+    portENTER_CRITICAL(&s_mux);
+    pending = s_tail != s_head;
+    portEXIT_CRITICAL(&s_mux);
+    if (queued || (pending && now - s_lastSubmitMs >= ALARM_EVAL_RETRY_MS)) submitDrain(now);
+}
+} // namespace
+
+bool alarm_eval_begin() {
+    if (s_started) return true;
+    for (size_t i = 0; i < kAlarms; i++) s_rules[i] = kDefaults[i];
+    // Overspeed waits for rpm_alert
+    s_rules[(size_t)AlarmId::Overspeed].enabled = false;
+    s_started = plc_scan_add_logic("Alarms", scanPhase, nullptr);
+    if (!s_started) return false;
+    for (size_t i = 0; i < kAlarms; i++) {
+        if ((AlarmId)i == AlarmId::Overspeed) continue;       // follows rpm_alert
+        const Range& r = kThresholdRange[(size_t)kDefaults[i].signal];
+        live_config_register(kConfigKeys[i], LiveConfigType::Int, r.min, r.max, applyThreshold, (void*)(uintptr_t)i);
+    }
+    return true;
+}
+
+bool alarm_get_rule(AlarmId id, AlarmRule& out) {
+    if (id >= AlarmId::Count) return false;
+    portENTER_CRITICAL(&s_mux);
+    out = s_rules[(size_t)id];
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+bool alarm_set_rule(AlarmId id, const AlarmRule& rule) {
+    if (id >= AlarmId::Count || rule.signal >= AlarmSignal::Count || rule.hysteresis < 0 || rule.deadband < 0) {
+        return false;
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_rules[(size_t)id] = rule;
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+bool alarm_ack(AlarmId id) {
+    if (id >= AlarmId::Count) return false;
+    portENTER_CRITICAL(&s_mux);
+    Alarm& a = s_alarms[(size_t)id];
+    const bool ok = a.active;
+    if (ok) a.acked = true;
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+uint32_t alarm_active_mask() {
+    uint32_t mask = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < kAlarms; i++) {
+        if (s_alarms[i].active) mask |= 1u << i;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return mask;
+}
+
+bool alarm_status(AlarmId id, AlarmStatus& out) {
+    if (id >= AlarmId::Count) return false;
+    portENTER_CRITICAL(&s_mux);
+    const Alarm& a = s_alarms[(size_t)id];
+    out = AlarmStatus{kKeys[(size_t)id], a.active, a.acked, a.valid, a.value, a.changedMs, a.transitions};
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+void alarm_report(Print& out) {
+    if (!s_started) return;
+    uint32_t queued, lost;
+    portENTER_CRITICAL(&s_mux);
+    queued = s_head - s_tail;
+    lost = s_lost;
+    portEXIT_CRITICAL(&s_mux);
+    out.printf("Alarms: %08lx active, %lu events queued, %lu lost\n", (unsigned long)alarm_active_mask(),
+               (unsigned long)queued, (unsigned long)lost);
+    for (size_t i = 0; i < kAlarms; i++) {
+        AlarmStatus s;
+        AlarmRule r;
+        alarm_status((AlarmId)i, s);
+        alarm_get_rule((AlarmId)i, r);
+        out.printf("  %-16s %-6s %s%s value %ld (%s %ld), %lu transitions\n", s.key,
+                   !r.enabled ? "off" : (s.active ? "ACTIVE" : "ok"), s.valid ? "" : "no data, ",
+                   s.acked ? "acked, " : "", (long)s.value, r.high ? ">=" : "<=", (long)r.threshold,
+                   (unsigned long)s.transitions);
+    }
+}
+
+#endif // ALARM_EVAL_ENABLE
@@ -0,0 +1,114 @@
+/*
+ * Alarm Evaluator
+ * Threshold alarms on the calibrated generator and PLC values, evaluated in the
+ * logic phase of every PLC scan (hardware/plc_scan.h):
+ *   - per rule: high or low threshold, hysteresis (a high alarm clears below
+ *     threshold - hysteresis), an input deadband (changes smaller than it are
+ *     ignored), delay-on and delay-off times, and latching (a latched alarm
+ *     stays active until acknowledged and its condition has cleared)
+ *   - only transitions leave the scan: each goes into a small event ring that
+ *     a modem-core work job drains into the log and the transport Alarm class,
+ *     so an alarm is queued within one scan and an unchanged state is never
+ *     resent. Events the transport refused are retried from the scan.
+ *   - the engine speed rule follows the rpm_alert shared attribute; 0 disables it
+ *   - the other thresholds follow alarm_<key> shared attributes (live_config.h),
+ *     e.g. alarm_fuel_low, within the signal's range
+ *
+ * A signal without a current reading (CAN silent, sensor down) is not
+ * evaluated: its alarm keeps its state and its pending delay restarts.
+ */
+
+#ifndef ALARM_EVAL_H
+#define ALARM_EVAL_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef ALARM_EVAL_EVENTS
+#define ALARM_EVAL_EVENTS 16               // transitions waiting for the uplink
+#endif
+#ifndef ALARM_EVAL_CAN_STALE_MS
+#define ALARM_EVAL_CAN_STALE_MS 5000       // generator readings older than this are not evaluated
+#endif
+#define ALARM_EVAL_RETRY_MS 1000
+
+// Values the rules compare; units of AlarmRule::threshold
+enum class AlarmSignal : uint8_t {
+    FuelLevel,               // %
+    OilLevel,                // %
+    FuelFilterLife,          // % remaining
+    OilFilterLife,           // % remaining
+    EngineRpm,               // rpm, GENERATOR_RPM_INPUT
+    BusVoltage,              // mV, INA226
+    Temperature,             // 0.1 C, LM75B
+    Count
+};
+
+// Rule table, in the order of AlarmId
+#define ALARM_TABLE(X)                                                                       \
+    /*  id             key                 signal           high   thr    hyst  dband on_ms  off_ms latch */ \
+    X(FuelLow,         "fuel_low",         FuelLevel,       false, 15,    5,    1,    10000, 10000, false) \
+    X(OilLow,          "oil_low",          OilLevel,        false, 20,    5,    1,    10000, 10000, false) \
+    X(FuelFilterDue,   "fuel_filter_due",  FuelFilterLife,  false, 10,    5,    1,    60000, 60000, true)  \
+    X(OilFilterDue,    "oil_filter_due",   OilFilterLife,   false, 10,    5,    1,    60000, 60000, true)  \
+    X(Overspeed,       "rpm_high",         EngineRpm,       true,  0,     50,   10,   1000,  2000,  false) \
+    X(SupplyLow,       "supply_low",       BusVoltage,      false, 4500,  200,  20,   2000,  2000,  false) \
+    X(OverTemp,        "temp_high",        Temperature,     true,  600,   30,   2,    5000,  5000,  false)
+
+enum class AlarmId : uint8_t {
+#define ALARM_ID(id, key, signal, high, thr, hyst, dband, on, off, latch) id,
+    ALARM_TABLE(ALARM_ID)
+#undef ALARM_ID
+    Count
+};
+
+struct AlarmRule {
+    AlarmSignal signal;
+    bool high;               // active above the threshold, else below it
+    bool enabled;
+    bool latched;
+    int32_t threshold;
+    int32_t hysteresis;
+    int32_t deadband;
+    uint32_t delayOnMs;
+    uint32_t delayOffMs;
+};
+
+struct AlarmStatus {
+    const char* key;
+    bool active;
+    bool acked;              // latched alarms: acknowledged, clears with its condition
+    bool valid;              // the signal had a reading in the last scan
+    int32_t value;           // deadband-filtered value
+    uint32_t changedMs;      // last transition
+    uint32_t transitions;
+};
+
+#if ALARM_EVAL_ENABLE
+
+// Joins the PLC scan's logic phase; call once from setup()
+bool alarm_eval_begin();
+
+bool alarm_get_rule(AlarmId id, AlarmRule& out);
+// Takes effect from the next scan; the alarm's state is kept
+bool alarm_set_rule(AlarmId id, const AlarmRule& rule);
+// Acknowledges a latched alarm; it clears once its condition has cleared
+bool alarm_ack(AlarmId id);
+
+uint32_t alarm_active_mask();                // bit per AlarmId
+bool alarm_status(AlarmId id, AlarmStatus& out);
+void alarm_report(Print& out);
+
+#else
+
+inline bool alarm_eval_begin() { return false; }
+inline bool alarm_get_rule(AlarmId, AlarmRule&) { return false; }
+inline bool alarm_set_rule(AlarmId, const AlarmRule&) { return false; }
+inline bool alarm_ack(AlarmId) { return false; }
+inline uint32_t alarm_active_mask() { return 0; }
+inline bool alarm_status(AlarmId, AlarmStatus&) { return false; }
+inline void alarm_report(Print&) {}
+
+#endif // ALARM_EVAL_ENABLE
+
+#endif // ALARM_EVAL_H
@@ -0,0 +1,359 @@
+/*
+ * Analog Sampler Implementation
+ */
+
+#include "analog_sampler.h"
+
+#if ANALOG_SAMPLER_ENABLE
+
+#include "generator_derived.h"
+#include "../system/seqlock.h"
+#include "../system/dsp_kernels.h"
+#include "../system/service_task.h"
+#include "../system/work_queue.h"
+#include "../system/json_writer.h"
+#include "../modules/logging/log_buffer.h"
+#include "../modules/storage/storage_task.h"
+#include "../../include/transport.h"
+#include <esp_timer.h>
+#include <math.h>
+#include <stdio.h>
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include <esp_adc/adc_continuous.h>
+#define ANALOG_SAMPLER_HAVE_DMA 1
+#else
+#define ANALOG_SAMPLER_HAVE_DMA 0
+#endif
+
+namespace {
+constexpr size_t kChannels = (size_t)AnalogChannel::Count;
+constexpr size_t kAdcInputs = 4;
+constexpr size_t kRingChunk = 32;            // pushed samples taken per lock
+constexpr uint8_t kMaxFramesPerJob = ANALOG_SAMPLER_POOL_BYTES / ANALOG_SAMPLER_FRAME_BYTES;
+const int kAdcGpios[kAdcInputs] = {ANALOG_SAMPLER_GPIO_0, ANALOG_SAMPLER_GPIO_1, ANALOG_SAMPLER_GPIO_2,
+                                   ANALOG_SAMPLER_GPIO_3};
+
+const char* const kKeys[kChannels] = {
+#define ANALOG_CHANNEL_KEY(id, key) key,
+    ANALOG_CHANNEL_TABLE(ANALOG_CHANNEL_KEY)
+#undef ANALOG_CHANNEL_KEY
+};
+
+struct Sample {
+    uint8_t ch;
+    int32_t value;
+};
+
+// Running sums of the open window
+struct Accumulator {
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    double sum;
+    double sumSq;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Sample s_ring[ANALOG_SAMPLER_RING];          // under s_mux
+uint32_t s_head = 0;
+uint32_t s_tail = 0;
+uint32_t s_ringDrops = 0;
+
+Accumulator s_acc[kChannels];                // job only
+uint32_t s_windowStartMs = 0;
+SeqlockSnapshot<AnalogWindowSet> s_window;
+AnalogSamplerStats s_stats = {};             // job writes, readers take a torn copy at worst
+int s_job = SERVICE_JOB_NONE;
+
+#if ANALOG_SAMPLER_HAVE_DMA
+adc_continuous_handle_t s_adc = nullptr;
+int8_t s_adcChannelToInput[SOC_ADC_MAX_CHANNEL_NUM];   // ADC1 channel -> AdcN, -1 = not sampled
+volatile uint32_t s_poolOverflows = 0;
+uint8_t s_frame[ANALOG_SAMPLER_FRAME_BYTES];
+constexpr size_t kFrameSamples = ANALOG_SAMPLER_FRAME_BYTES / SOC_ADC_DIGI_RESULT_BYTES;
+DSP_ALIGN float s_block[kAdcInputs][kFrameSamples];   // one frame de-interleaved per input
+
+bool IRAM_ATTR onPoolOverflow(adc_continuous_handle_t, const adc_continuous_evt_data_t*, void*) {
+    s_poolOverflows = s_poolOverflows + 1;
+    return false;
+}
+
+bool startAdc() {
+    for (size_t i = 0; i < SOC_ADC_MAX_CHANNEL_NUM; i++) s_adcChannelToInput[i] = -1;
+    adc_digi_pattern_config_t pattern[kAdcInputs] = {};
+    uint8_t n = 0;
+    for (size_t i = 0; i < kAdcInputs; i++) {
+        if (kAdcGpios[i] < 0) continue;
+        adc_unit_t unit;
+        adc_channel_t channel;
+        if (adc_continuous_io_to_channel(kAdcGpios[i], &unit, &channel) != ESP_OK || unit != ADC_UNIT_1) {
+            logbuf_printf("AnalogSampler: GPIO %d is not an ADC1 input", kAdcGpios[i]);
+            continue;
+        }
+        pattern[n].unit = ADC_UNIT_1;
+        pattern[n].channel = channel;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        pattern[n].atten = ADC_ATTEN_DB_12;
+#else
+        pattern[n].atten = ADC_ATTEN_DB_11;
+#endif
+        pattern[n].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        s_adcChannelToInput[channel] = (int8_t)i;
+        n++;
+    }
+    if (!n) return false;
+
+    adc_continuous_handle_cfg_t handleCfg = {};
+    handleCfg.max_store_buf_size = ANALOG_SAMPLER_POOL_BYTES;
+    handleCfg.conv_frame_size = ANALOG_SAMPLER_FRAME_BYTES;
+    if (adc_continuous_new_handle(&handleCfg, &s_adc) != ESP_OK) return false;
+
+    uint32_t rate = ANALOG_SAMPLER_RATE_HZ;
+    if (rate < SOC_ADC_SAMPLE_FREQ_THRES_LOW) rate = SOC_ADC_SAMPLE_FREQ_THRES_LOW;
+    if (rate > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) rate = SOC_ADC_SAMPLE_FREQ_THRES_HIGH;
+    adc_continuous_config_t cfg = {};
+    cfg.pattern_num = n;
+    cfg.adc_pattern = pattern;
+    cfg.sample_freq_hz = rate;
+    cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    adc_continuous_evt_cbs_t cbs = {};
+    cbs.on_pool_ovf = onPoolOverflow;
+    if (adc_continuous_config(s_adc, &cfg) != ESP_OK ||
+        adc_continuous_register_event_callbacks(s_adc, &cbs, nullptr) != ESP_OK ||
+        adc_continuous_start(s_adc) != ESP_OK) {
+        adc_continuous_deinit(s_adc);
+        s_adc = nullptr;
+        return false;
+    }
+    s_stats.adcChannels = n;
+    logbuf_printf("AnalogSampler: %u ADC inputs at %lu Hz", (unsigned)n, (unsigned long)rate);
+    return true;
+}
+#endif
+
+void resetWindow(uint32_t now) {
+    for (size_t i = 0; i < kChannels; i++) s_acc[i] = Accumulator{0, INT32_MAX, INT32_MIN, 0, 0};
+    s_windowStartMs = now;
+}
+
+inline void fold(size_t ch, int32_t v) {
+    Accumulator& a = s_acc[ch];
+    a.count++;
+    if (v < a.min) a.min = v;
+    if (v > a.max) a.max = v;
+    a.sum += v;
+    a.sumSq += (double)v * v;
+}
+
+// A block of one channel through the vector sums
+void foldBlock(size_t ch, const float* x, size_t n) {
+    DspBlockSums b;
+    if (!dsp_block_sums(x, n, b)) return;
+    Accumulator& a = s_acc[ch];
+    a.count += n;
+    if ((int32_t)b.min < a.min) a.min = (int32_t)b.min;
+    if ((int32_t)b.max > a.max) a.max = (int32_t)b.max;
+    a.sum += b.sum;
+    a.sumSq += b.sumSq;
+}
+
+void drainRing() {
+    Sample chunk[kRingChunk];
+    for (;;) {
+        size_t n = 0;
+        portENTER_CRITICAL(&s_mux);
+        while (n < kRingChunk && s_tail != s_head) chunk[n++] = s_ring[s_tail++ % ANALOG_SAMPLER_RING];
+        portEXIT_CRITICAL(&s_mux);
+        for (size_t i = 0; i < n; i++) fold(chunk[i].ch, chunk[i].value);
+        s_stats.samples += n;
+        if (n < kRingChunk) return;
+    }
+}
+
+#if ANALOG_SAMPLER_HAVE_DMA
+// Whole frames from the driver pool; never waits for a conversion
+void drainAdc() {
+    if (!s_adc) return;
+    for (uint8_t f = 0; f < kMaxFramesPerJob; f++) {
+        uint32_t len = 0;
+        if (adc_continuous_read(s_adc, s_frame, sizeof(s_frame), &len, 0) != ESP_OK) return;
+        s_stats.frames++;
+        size_t count[kAdcInputs] = {};
+        for (uint32_t off = 0; off + SOC_ADC_DIGI_RESULT_BYTES <= len; off += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* p = reinterpret_cast<const adc_digi_output_data_t*>(&s_frame[off]);
+            const uint32_t channel = p->type2.channel;
+            if (channel >= SOC_ADC_MAX_CHANNEL_NUM || s_adcChannelToInput[channel] < 0) continue;
+            const int8_t input = s_adcChannelToInput[channel];
+            s_block[input][count[input]++] = (float)p->type2.data;
+        }
+        for (size_t i = 0; i < kAdcInputs; i++) {
+            if (!count[i]) continue;
+            foldBlock((size_t)AnalogChannel::Adc0 + i, s_block[i], count[i]);
+            s_stats.samples += count[i];
+        }
+    }
+}
+#endif
+
+// One SD line per channel with samples: a full set would pass STORAGE_MAX_LINE_BYTES
+void logWindow(const AnalogWindowSet& w) {
+    if (!storage_ready()) return;
+    for (size_t i = 0; i < kChannels; i++) {
+        const AnalogAggregate& a = w.ch[i];
+        if (!a.count || !storage_admit(StorageStreamId::Analog, StoragePriority::Normal)) continue;
+        StorageLine line;
+        JsonWriter j(line.text(), STORAGE_MAX_LINE_BYTES);
+        j.beginObject()
+            .field("t", w.endMs)
+            .field("win_ms", w.endMs - w.startMs)
+            .field("ch", kKeys[i])
+            .field("n", a.count)
+            .field("min", a.min)
+            .field("max", a.max)
+            .field("mean", a.mean, 2)
+            .field("rms", a.rms, 2)
+            .endObject();
+        if (j.ok()) storage_push_line(StorageStreamId::Analog, line, j.length());
+    }
+}
+
+// From the work queue on the modem core; serialized straight into the transport arena
+void uplinkJob(void*) {
+    AnalogWindowSet w;
+    s_window.read(w);
+    TransportReservation slot;
+    // A window the queue refused is superseded by the next one
+    if (!transport_reserve(TransportPacketKind::Telemetry, TRANSPORT_MAX_PACKET_BYTES / 2, slot)) return;
+    JsonWriter j(reinterpret_cast<char*>(slot.data), slot.capacity);
+    j.beginObject().field("an_win_s", (w.endMs - w.startMs) / 1000);
+    // The fuel rate and service figures as the unit already has them, not left to be fitted from the windows
+    GeneratorDerived d;
+    if (generator_derived_get(d)) {
+        j.field("fuel_burn", d.burnPctPerHour, 2);
+        if (d.hoursToEmpty >= 0.0f) j.field("fuel_empty_h", d.hoursToEmpty, 1);
+    }
+    if (d.serviceValid) {
+        j.field("svc_h", (long)(d.service[d.nextService].remainingS / 3600));
+        if (d.service[d.nextService].daysToDue >= 0.0f) j.field("svc_days", d.service[d.nextService].daysToDue, 1);
+    }
+    JsonWriter::Mark last = j.mark();
+    for (size_t i = 0; i < kChannels; i++) {
+        const AnalogAggregate& a = w.ch[i];
+        if (!a.count) continue;
+        last = j.mark();
+        char key[24];
+        snprintf(key, sizeof(key), "%s_min", kKeys[i]);
+        j.field(key, a.min);
+        snprintf(key, sizeof(key), "%s_max", kKeys[i]);
+        j.field(key, a.max);
+        snprintf(key, sizeof(key), "%s_avg", kKeys[i]);
+        j.field(key, a.mean, 2);
+        snprintf(key, sizeof(key), "%s_rms", kKeys[i]);
+        j.field(key, a.rms, 2);
+        if (j.failed()) break;
+    }
+    // The channels that fit, with room left for the closing brace
+    j.endObject();
+    if (j.failed()) {
+        j.rewind(last);
+        j.endObject();
+    }
+    if (!j.ok() || !transport_commit(slot, j.length())) transport_abort(slot);
+}
+
+void closeWindow(uint32_t now) {
+    AnalogWindowSet w = {};
+    w.seq = ++s_stats.windows;
+    w.startMs = s_windowStartMs;
+    w.endMs = now;
+    for (size_t i = 0; i < kChannels; i++) {
+        const Accumulator& a = s_acc[i];
+        AnalogAggregate& out = w.ch[i];
+        out.count = a.count;
+        if (!a.count) continue;
+        out.min = a.min;
+        out.max = a.max;
+        out.mean = (float)(a.sum / a.count);
+        out.rms = (float)sqrt(a.sumSq / a.count);
+    }
+    s_window.write(w);
+    resetWindow(now);
+    logWindow(w);
+    work_submit("AnalogUplink", uplinkJob, nullptr, WorkPriority::Low, WORK_CORE_MODEM, WORK_COALESCE);
+}
+
+void samplerJob(void*) {
+    const int64_t start = esp_timer_get_time();
+    const uint32_t now = millis();
+    drainRing();
+#if ANALOG_SAMPLER_HAVE_DMA
+    drainAdc();
+#endif
+    if (now - s_windowStartMs >= ANALOG_SAMPLER_WINDOW_MS) closeWindow(now);
+    s_stats.lastJobUs = (uint32_t)(esp_timer_get_time() - start);
+    if (s_stats.lastJobUs > s_stats.maxJobUs) s_stats.maxJobUs = s_stats.lastJobUs;
+}
+} // namespace
+
+bool analog_sampler_begin() {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    resetWindow(millis());
+#if ANALOG_SAMPLER_HAVE_DMA
+    s_stats.dma = startAdc();
+#endif
+    s_job = service_job_add("AnalogSampler", samplerJob, nullptr, ANALOG_SAMPLER_PERIOD_MS,
+                            ANALOG_SAMPLER_JOB_BUDGET_US);
+    return s_job != SERVICE_JOB_NONE;
+}
+
+bool analog_sampler_push(AnalogChannel ch, int32_t value) {
+    if (ch >= AnalogChannel::Count) return false;
+    portENTER_CRITICAL(&s_mux);
+    const bool ok = s_head - s_tail < ANALOG_SAMPLER_RING;
+    if (ok) {
+        s_ring[s_head++ % ANALOG_SAMPLER_RING] = Sample{(uint8_t)ch, value};
+    } else {
+        s_ringDrops++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+bool analog_sampler_window(AnalogWindowSet& out) {
+    s_window.read(out);
+    return out.seq != 0;
+}
+
+void analog_sampler_stats(AnalogSamplerStats& out) {
+    out = s_stats;
+    portENTER_CRITICAL(&s_mux);
+    out.ringDrops = s_ringDrops;
+    portEXIT_CRITICAL(&s_mux);
+#if ANALOG_SAMPLER_HAVE_DMA
+    out.poolOverflows = s_poolOverflows;
+#endif
+}
+
+void analog_sampler_report(Print& out) {
+    if (s_job == SERVICE_JOB_NONE) return;
+    AnalogSamplerStats s;
+    analog_sampler_stats(s);
+    out.printf("Analog sampler: %s, %u ADC inputs, %lu samples, %lu frames, %lu pool overflows, %lu ring drops, "
+               "job %lu us (max %lu)\n",
+               s.dma ? "DMA" : "pushed only", (unsigned)s.adcChannels, (unsigned long)s.samples,
+               (unsigned long)s.frames, (unsigned long)s.poolOverflows, (unsigned long)s.ringDrops,
+               (unsigned long)s.lastJobUs, (unsigned long)s.maxJobUs);
+    AnalogWindowSet w;
+    if (!analog_sampler_window(w)) return;
+    out.printf("  window %lu (%lu ms):\n", (unsigned long)w.seq, (unsigned long)(w.endMs - w.startMs));
+    for (size_t i = 0; i < kChannels; i++) {
+        const AnalogAggregate& a = w.ch[i];
+        if (!a.count) continue;
+        out.printf("  %-5s n %-6lu min %-6ld max %-6ld mean %.2f rms %.2f\n", kKeys[i], (unsigned long)a.count,
+                   (long)a.min, (long)a.max, a.mean, a.rms);
+    }
+}
+
+#endif // ANALOG_SAMPLER_ENABLE
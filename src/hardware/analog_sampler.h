@@ -0,0 +1,121 @@
+/*
+ * Analog Sampler
+ * Keeps the shape of the analog signals between reports, not just the last value:
+ *   - ADC1 inputs on the ESP32-S3 GPIOs (ANALOG_SAMPLER_GPIO_n) are converted
+ *     continuously by the ADC's DMA engine at ANALOG_SAMPLER_RATE_HZ into the
+ *     driver's frame pool; the CPU only touches whole frames
+ *   - values produced elsewhere (INA226 averages, generator CAN frames) are
+ *     pushed into a sample ring by their producers
+ *   - a service job drains both into per-channel windows (DMA frames are
+ *     de-interleaved and summed per block with the DSP kernels,
+ *     system/dsp_kernels.h) and closes a window
+ *     every ANALOG_SAMPLER_WINDOW_MS with count, min, max, mean and RMS. Only
+ *     these aggregates go to the SD card (/data/analog.jsonl) and the uplink,
+ *     so a sag or slosh inside the interval still shows up in min/max. The
+ *     uplink record also carries the fuel burn rate and next service
+ *     (generator_derived.h), so they need not be fitted from the windows.
+ *
+ * Units: bus voltage mV, bus current mA, fuel and oil level % (calibrated),
+ * ADC inputs raw counts (12 bit, 11 dB attenuation).
+ */
+
+#ifndef ANALOG_SAMPLER_H
+#define ANALOG_SAMPLER_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef ANALOG_SAMPLER_RATE_HZ
+#define ANALOG_SAMPLER_RATE_HZ 2000        // conversions per second, shared by the ADC inputs
+#endif
+#ifndef ANALOG_SAMPLER_WINDOW_MS
+#define ANALOG_SAMPLER_WINDOW_MS 60000     // reporting interval
+#endif
+#ifndef ANALOG_SAMPLER_RING
+#define ANALOG_SAMPLER_RING 256            // pushed samples waiting for the job
+#endif
+#ifndef ANALOG_SAMPLER_GPIO_0
+#define ANALOG_SAMPLER_GPIO_0 -1           // ADC1 capable GPIO (1-10), -1 = unused
+#endif
+#ifndef ANALOG_SAMPLER_GPIO_1
+#define ANALOG_SAMPLER_GPIO_1 -1
+#endif
+#ifndef ANALOG_SAMPLER_GPIO_2
+#define ANALOG_SAMPLER_GPIO_2 -1
+#endif
+#ifndef ANALOG_SAMPLER_GPIO_3
+#define ANALOG_SAMPLER_GPIO_3 -1
+#endif
+#define ANALOG_SAMPLER_PERIOD_MS 100
+#define ANALOG_SAMPLER_FRAME_BYTES 256     // DMA conversion frame
+#define ANALOG_SAMPLER_POOL_BYTES 2048     // driver frame pool, ~200 ms at the default rate
+#define ANALOG_SAMPLER_JOB_BUDGET_US 2000
+
+#define ANALOG_CHANNEL_TABLE(X)          \
+    X(BusVoltage, "vbus")                \
+    X(BusCurrent, "ibus")                \
+    X(FuelLevel,  "fuel")                \
+    X(OilLevel,   "oil")                 \
+    X(Adc0,       "adc0")                \
+    X(Adc1,       "adc1")                \
+    X(Adc2,       "adc2")                \
+    X(Adc3,       "adc3")
+
+enum class AnalogChannel : uint8_t {
+#define ANALOG_CHANNEL_ID(id, key) id,
+    ANALOG_CHANNEL_TABLE(ANALOG_CHANNEL_ID)
+#undef ANALOG_CHANNEL_ID
+    Count
+};
+
+struct AnalogAggregate {
+    uint32_t count;          // 0: no samples in the window, the rest is unset
+    int32_t min;
+    int32_t max;
+    float mean;
+    float rms;
+};
+
+struct AnalogWindowSet {
+    uint32_t seq;            // windows closed since boot, 0 = none yet
+    uint32_t startMs;
+    uint32_t endMs;
+    AnalogAggregate ch[(size_t)AnalogChannel::Count];
+};
+
+struct AnalogSamplerStats {
+    bool dma;                // continuous ADC running
+    uint8_t adcChannels;
+    uint32_t samples;        // folded into windows
+    uint32_t frames;         // DMA frames read
+    uint32_t poolOverflows;  // frames the driver dropped before the job read them
+    uint32_t ringDrops;      // pushed samples lost to a full ring
+    uint32_t windows;
+    uint32_t lastJobUs;
+    uint32_t maxJobUs;
+};
+
+#if ANALOG_SAMPLER_ENABLE
+
+// Starts the continuous ADC and the aggregation job; call once from setup()
+bool analog_sampler_begin();
+
+// One sample from a producer task (not an ISR); false when the ring is full
+bool analog_sampler_push(AnalogChannel ch, int32_t value);
+
+// The last closed window; false before the first one
+bool analog_sampler_window(AnalogWindowSet& out);
+void analog_sampler_stats(AnalogSamplerStats& out);
+void analog_sampler_report(Print& out);
+
+#else
+
+inline bool analog_sampler_begin() { return false; }
+inline bool analog_sampler_push(AnalogChannel, int32_t) { return false; }
+inline bool analog_sampler_window(AnalogWindowSet&) { return false; }
+inline void analog_sampler_stats(AnalogSamplerStats& out) { out = AnalogSamplerStats{}; }
+inline void analog_sampler_report(Print&) {}
+
+#endif // ANALOG_SAMPLER_ENABLE
+
+#endif // ANALOG_SAMPLER_H
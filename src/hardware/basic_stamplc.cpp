@@ -1,7 +1,10 @@
 #include "basic_stamplc.h"
+#include "../system/kernel_objects.h"
+#include "input_capture.h"
 
 #include <cstring>
 #include <M5StamPLC.h>
+#include <esp_timer.h>
 
 extern m5::M5_STAMPLC M5StamPLC;
 
@@ -9,6 +12,8 @@ BasicStampPLC::BasicStampPLC() {
     stamPLC = nullptr;
     isInitialized = false;
     ioMutex = nullptr;
+    scanOwnsOutputs = false;
+    updatedMs = 0;
     memset(digitalInputs, 0, sizeof(digitalInputs));
     memset(analogInputs, 0, sizeof(analogInputs));
     memset(relayOutputs, 0, sizeof(relayOutputs));
@@ -38,10 +43,12 @@ bool BasicStampPLC::begin(m5::M5_STAMPLC* device) {
         relayOutputs[i] = false;
     }
     
+    io_.attach(stamPLC);
     isInitialized = true;
+    input_capture_begin();
 
     if (!ioMutex) {
-        ioMutex = xSemaphoreCreateMutex();
+        ioMutex = kernel_mutex_create(KernelMutex::PlcIo);
         if (!ioMutex) {
             Serial.println("StampPLC: Failed to create IO mutex");
         }
@@ -50,28 +57,88 @@ bool BasicStampPLC::begin(m5::M5_STAMPLC* device) {
 }
 
 void BasicStampPLC::update() {
+    updateButtons();
+    scanInputs();
+    writeOutputs();
+}
+
+void BasicStampPLC::updateButtons() {
     if (!isInitialized || !stamPLC) return;
     if (!ioMutex) return;
     if (xSemaphoreTake(ioMutex, portMAX_DELAY) != pdTRUE) {
         return;
     }
 
-    // Ensure underlying StamPLC subsystem (incl. buttons via IO expander) is updated
+    // Underlying StamPLC subsystem: buttons via the IO expander
+    stamPLC->update();
+
+    xSemaphoreGive(ioMutex);
+}
+
+bool BasicStampPLC::tryUpdateButtons() {
+    if (!isInitialized || !stamPLC) return false;
+    if (!ioMutex) return false;
+    if (xSemaphoreTake(ioMutex, 0) != pdTRUE) {
+        return false;
+    }
+
     stamPLC->update();
 
-    // Read digital inputs
+    xSemaphoreGive(ioMutex);
+    return true;
+}
+
+void BasicStampPLC::scanInputs() {
+    if (!isInitialized || !stamPLC) return;
+    if (!ioMutex) return;
+    if (xSemaphoreTake(ioMutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+
+    // All eight inputs in one read; edges and pulse counts are kept by the capture layer
+    const uint8_t bits = io_.readInputs();
     for (int i = 0; i < 8; i++) {
-        digitalInputs[i] = stamPLC->readPlcInput(i);
+        digitalInputs[i] = (bits >> i) & 1;
     }
+    input_capture_sample(bits, esp_timer_get_time());
 
-    // Read analog inputs (simplified for now)
+    // Read analog inputs (simplified for now: the first four digital inputs)
     for (int i = 0; i < 4; i++) {
-        analogInputs[i] = stamPLC->readPlcInput(i) ? 1023 : 0;
+        analogInputs[i] = digitalInputs[i] ? 1023 : 0;
     }
+    updatedMs = millis();
+    publishIo();
 
     xSemaphoreGive(ioMutex);
 }
 
+void BasicStampPLC::writeOutputs() {
+    if (!isInitialized || !stamPLC) return;
+    if (!ioMutex) return;
+    if (xSemaphoreTake(ioMutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    io_.writeRelays(relayImage());
+    xSemaphoreGive(ioMutex);
+}
+
+uint8_t BasicStampPLC::relayImage() const {
+    uint8_t image = 0;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (relayOutputs[i]) image |= 1 << i;
+    }
+    return image;
+}
+
+void BasicStampPLC::publishIo() {
+    PlcIoSnapshot s;
+    memcpy(s.digitalInputs, digitalInputs, sizeof(s.digitalInputs));
+    memcpy(s.analogInputs, analogInputs, sizeof(s.analogInputs));
+    memcpy(s.relayOutputs, relayOutputs, sizeof(s.relayOutputs));
+    s.updatedMs = updatedMs;
+    ioSnapshot_.write(s);
+}
+
 bool BasicStampPLC::getDigitalInput(uint8_t channel) {
     if (channel >= 8) return false;
     return digitalInputs[channel];
@@ -88,16 +155,15 @@ bool BasicStampPLC::setRelayOutput(uint8_t channel, bool state) {
     // Set relay state
     relayOutputs[channel] = state;
     
-    // Update physical relay
+    // Update physical relay, or leave it to the scan's output phase
     if (ioMutex && xSemaphoreTake(ioMutex, portMAX_DELAY) == pdTRUE) {
-        if (stamPLC) {
-            stamPLC->writePlcRelay(channel, state);
+        if (!scanOwnsOutputs) {
+            io_.writeRelays(relayImage());
         }
+        publishIo();
         xSemaphoreGive(ioMutex);
     } else {
-        if (stamPLC) {
-            stamPLC->writePlcRelay(channel, state);
-        }
+        io_.writeRelays(relayImage());
     }
     
     return true;
@@ -136,4 +202,8 @@ void BasicStampPLC::printStatus() {
         Serial.print(relayOutputs[i] ? "1" : "0");
     }
     Serial.println();
+
+    const PlcIoStats io = io_.stats();
+    Serial.printf("StampPLC: Expander %lu input reads, %lu relay writes, %lu unchanged\n",
+                  (unsigned long)io.inputReads, (unsigned long)io.relayWrites, (unsigned long)io.relaySkips);
 }
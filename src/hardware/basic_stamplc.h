@@ -6,6 +6,16 @@
 #include <freertos/semphr.h>
 #include <utils/ina226/ina226.h>
 #include <M5StamPLC.h>
+#include "../system/seqlock.h"
+#include "plc_io.h"
+
+// Latest I/O state for lock-free readers
+struct PlcIoSnapshot {
+    bool digitalInputs[8];
+    uint16_t analogInputs[4];
+    bool relayOutputs[2];
+    uint32_t updatedMs;      // last input scan
+};
 
 class BasicStampPLC {
 private:
@@ -17,6 +27,12 @@ private:
     bool digitalInputs[8];
     uint16_t analogInputs[4];
     bool relayOutputs[2];
+    bool scanOwnsOutputs;    // relays are written by the scan's output phase
+    uint32_t updatedMs;
+    SeqlockSnapshot<PlcIoSnapshot> ioSnapshot_;   // written with ioMutex held
+    PlcIoImage io_;                               // used with ioMutex held
+    void publishIo();
+    uint8_t relayImage() const;
 
 public:
     BasicStampPLC();
@@ -24,8 +40,16 @@ public:
     // Initialization
     bool begin(m5::M5_STAMPLC* device = nullptr);
     
-    // Update state
+    // Update state: buttons, then a full input scan and relay write
     void update();
+
+    // Scan phases (hardware/plc_scan.h); each takes ioMutex on its own
+    void updateButtons();        // IO expander buttons
+    bool tryUpdateButtons();     // same without waiting on ioMutex; false when it is held
+    void scanInputs();           // input phase: inputs, capture, snapshot
+    void writeOutputs();         // output phase: one relay write if any relay changed
+    // From the scan engine: setRelayOutput() defers the write to writeOutputs()
+    void setScanOwnsOutputs(bool owned) { scanOwnsOutputs = owned; }
     
     // Digital inputs (8 channels)
     bool getDigitalInput(uint8_t channel);
@@ -36,6 +60,11 @@ public:
     // Relay outputs (2 channels)
     bool setRelayOutput(uint8_t channel, bool state);
     bool getRelayOutput(uint8_t channel);
+
+    // Consistent copy of inputs and relays, without taking ioMutex
+    PlcIoSnapshot getIoSnapshot() const { return ioSnapshot_.read(); }
+    // Expander transactions since boot
+    PlcIoStats getIoStats() const { return io_.stats(); }
     
     // Status
     void printStatus();
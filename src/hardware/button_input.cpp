@@ -0,0 +1,166 @@
+/*
+ * Button Input Implementation
+ */
+
+#include "button_input.h"
+#include "basic_stamplc.h"
+#include "../system/metrics.h"
+#include "../system/trace_recorder.h"
+#include "../ui/ui_frame.h"
+#include <atomic>
+#include <esp_timer.h>
+
+namespace {
+constexpr size_t kButtons = static_cast<size_t>(ButtonId::Count);
+constexpr uint32_t kMask = BUTTON_EVENTS - 1;
+
+BasicStampPLC* s_plc = nullptr;
+esp_timer_handle_t s_timer = nullptr;
+bool s_interrupt = false;
+
+// Ring: head written by the sampler only, tail by the display task only
+ButtonEvent s_ring[BUTTON_EVENTS];
+std::atomic<uint32_t> s_head{0};
+std::atomic<uint32_t> s_tail{0};
+
+// INT mode: a sample is armed; the edge that armed it
+std::atomic<bool> s_armed{false};
+std::atomic<uint32_t> s_edgeUs{0};
+std::atomic<uint32_t> s_interrupts{0};
+
+// Sampler (esp_timer task) only
+bool s_holdSent[kButtons] = {};
+ButtonInputStats s_stats = {};
+
+MetricHistogram s_metricLatency("ui.input_us");      // button event to frame on the panel
+MetricCounter s_metricPresses("ui.presses", [] { return s_stats.presses; });
+
+bool push(ButtonId button, ButtonAction action, uint32_t atUs) {
+    const uint32_t head = s_head.load(std::memory_order_relaxed);
+    if (head - s_tail.load(std::memory_order_acquire) >= BUTTON_EVENTS) {
+        s_stats.lost++;
+        return false;
+    }
+    s_ring[head & kMask] = ButtonEvent{atUs, button, action};
+    s_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+#if BUTTON_EXPANDER_INT_GPIO >= 0
+void IRAM_ATTR intIsr(void*) {
+    s_interrupts.fetch_add(1, std::memory_order_relaxed);
+    if (s_armed.exchange(true)) return;   // the debounce sample is already coming
+    s_edgeUs.store((uint32_t)esp_timer_get_time(), std::memory_order_relaxed);
+    esp_timer_start_once(s_timer, BUTTON_DEBOUNCE_MS * 1000ULL);
+}
+#endif
+
+void sample(void*) {
+    // Cleared first: an edge during the read arms the next sample itself
+    uint32_t edgeUs = 0;
+    if (s_interrupt) {
+        s_armed.store(false);
+        edgeUs = s_edgeUs.exchange(0, std::memory_order_relaxed);
+    }
+    s_stats.samples++;
+
+    bool again = false;          // INT mode: sample once more after BUTTON_SAMPLE_MS
+    bool pushed = false;
+    if (!s_plc->tryUpdateButtons()) {
+        s_stats.busy++;
+        again = true;
+    } else if (m5::M5_STAMPLC* dev = s_plc->getStamPLC()) {
+        m5::Button_Class* const btn[kButtons] = {&dev->BtnA, &dev->BtnB, &dev->BtnC};
+        const uint32_t now = (uint32_t)esp_timer_get_time();
+        for (size_t i = 0; i < kButtons; i++) {
+            const ButtonId id = static_cast<ButtonId>(i);
+            if (btn[i]->wasPressed()) {
+                TRACE_USER(ButtonPress, i);
+                s_holdSent[i] = false;
+                s_stats.presses++;
+                pushed |= push(id, ButtonAction::Press, edgeUs ? edgeUs : now);
+            }
+            if (!btn[i]->isPressed()) {
+                s_holdSent[i] = false;
+                continue;
+            }
+            again = true;
+            if (!s_holdSent[i] && btn[i]->pressedFor(BUTTON_LONG_MS)) {
+                s_holdSent[i] = true;
+                s_stats.holds++;
+                pushed |= push(id, ButtonAction::Hold, now);
+            }
+        }
+    }
+    if (pushed) ui_frame_request();
+    if (s_interrupt && again && !s_armed.exchange(true)) {
+        esp_timer_start_once(s_timer, BUTTON_SAMPLE_MS * 1000ULL);
+    }
+}
+} // namespace
+
+bool button_input_begin(BasicStampPLC* plc) {
+    if (s_timer) return true;
+    if (!plc || !plc->isReady() || !plc->getStamPLC()) {
+        Serial.println("ButtonInput: PLC not ready, buttons disabled");
+        return false;
+    }
+    s_plc = plc;
+    const esp_timer_create_args_t args = {sample, nullptr, ESP_TIMER_TASK, "buttons"};
+    if (esp_timer_create(&args, &s_timer) != ESP_OK) {
+        s_timer = nullptr;
+        Serial.println("ButtonInput: timer create failed");
+        return false;
+    }
+
+#if BUTTON_EXPANDER_INT_GPIO >= 0
+    // Open-drain, active low; the expander's input read clears it
+    pinMode(BUTTON_EXPANDER_INT_GPIO, INPUT_PULLUP);
+    attachInterruptArg(BUTTON_EXPANDER_INT_GPIO, intIsr, nullptr, FALLING);
+    s_interrupt = true;
+    s_armed.store(true);
+    esp_timer_start_once(s_timer, BUTTON_SAMPLE_MS * 1000ULL);   // settle the initial state
+#else
+    esp_timer_start_periodic(s_timer, BUTTON_SAMPLE_MS * 1000ULL);
+#endif
+    s_stats.interrupt = s_interrupt;
+    Serial.printf("ButtonInput: %s every %u ms, long press %u ms\n", s_interrupt ? "expander INT, held buttons sampled" : "sampled",
+                  (unsigned)BUTTON_SAMPLE_MS, (unsigned)BUTTON_LONG_MS);
+    return true;
+}
+
+bool button_input_pop(ButtonEvent& out) {
+    const uint32_t tail = s_tail.load(std::memory_order_relaxed);
+    if (tail == s_head.load(std::memory_order_acquire)) return false;
+    out = s_ring[tail & kMask];
+    s_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+void button_input_presented(uint32_t atUs) {
+    const uint32_t us = (uint32_t)esp_timer_get_time() - atUs;
+    s_metricLatency.record(us);
+    s_stats.lastUs = us;
+    if (us > s_stats.maxUs) s_stats.maxUs = us;
+    s_stats.avgUs = s_stats.presented ? s_stats.avgUs - s_stats.avgUs / 8 + us / 8 : us;
+    s_stats.presented++;
+    if (us > BUTTON_LATENCY_BUDGET_US) s_stats.overBudget++;
+}
+
+void button_input_stats(ButtonInputStats& out) {
+    out = s_stats;
+    out.interrupts = s_interrupts.load(std::memory_order_relaxed);
+}
+
+void button_input_report(Print& out) {
+    if (!s_timer) return;
+    ButtonInputStats s;
+    button_input_stats(s);
+    out.printf("Buttons: %s, %lu samples (%lu busy, %lu INT), %lu presses, %lu holds, %lu lost\n",
+               s.interrupt ? "INT" : "polled", (unsigned long)s.samples, (unsigned long)s.busy,
+               (unsigned long)s.interrupts, (unsigned long)s.presses, (unsigned long)s.holds, (unsigned long)s.lost);
+    if (!s.presented) return;
+    out.printf("  input to pixel: last %lu us, avg %lu us, max %lu us, %lu of %lu over %lu us\n",
+               (unsigned long)s.lastUs, (unsigned long)s.avgUs, (unsigned long)s.maxUs,
+               (unsigned long)s.overBudget, (unsigned long)s.presented, (unsigned long)BUTTON_LATENCY_BUDGET_US);
+}
@@ -0,0 +1,90 @@
+/*
+ * Button Input
+ * Front-panel buttons A, B and C to the display task, without a task of their own:
+ *   - the buttons sit behind the I2C I/O expander, so no GPIO interrupt sees
+ *     them directly. An esp_timer samples the expander every BUTTON_SAMPLE_MS,
+ *     with a try-lock on the PLC I/O mutex: a sample that finds the scan on the
+ *     bus is skipped and the next one catches up. With the expander's INT line
+ *     wired to an ESP32 GPIO (BUTTON_EXPANDER_INT_GPIO) its falling edge arms a
+ *     one-shot BUTTON_DEBOUNCE_MS later instead, and sampling only continues
+ *     while a button is held (long press, release).
+ *   - each press, and each hold past BUTTON_LONG_MS, becomes a ButtonEvent
+ *     stamped with esp_timer time in a single-producer / single-consumer ring:
+ *     the esp_timer task writes, the display task reads, no lock on either
+ *     side. Every event is followed by a task notification to the display task
+ *     (ui_frame_request()).
+ *   - the display task calls button_input_presented() once the frame showing
+ *     an event's effect is on the panel; input-to-pixel latency is kept against
+ *     BUTTON_LATENCY_BUDGET_US, one frame.
+ *
+ * Without the INT line an event is stamped at the sample that saw it, so the
+ * latency reads up to one sample period short.
+ */
+
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef BUTTON_SAMPLE_MS
+#define BUTTON_SAMPLE_MS 20                  // expander poll, and while a button is held
+#endif
+#ifndef BUTTON_LONG_MS
+#define BUTTON_LONG_MS 500
+#endif
+#ifndef BUTTON_EVENTS
+#define BUTTON_EVENTS 16                     // ring slots, a power of two
+#endif
+#ifndef BUTTON_LATENCY_BUDGET_US
+#define BUTTON_LATENCY_BUDGET_US 33000UL     // one frame at 30 fps
+#endif
+// ESP32 GPIO on the I/O expander's INT output, -1 when it isn't wired
+#ifndef BUTTON_EXPANDER_INT_GPIO
+#define BUTTON_EXPANDER_INT_GPIO -1
+#endif
+
+static_assert((BUTTON_EVENTS & (BUTTON_EVENTS - 1)) == 0, "BUTTON_EVENTS must be a power of two");
+
+class BasicStampPLC;
+
+enum class ButtonId : uint8_t { A = 0, B, C, Count };
+
+enum class ButtonAction : uint8_t {
+    Press = 0,       // went down
+    Hold             // still down after BUTTON_LONG_MS; once per press
+};
+
+struct ButtonEvent {
+    uint32_t atUs;               // esp_timer time, low 32 bits
+    ButtonId button;
+    ButtonAction action;
+};
+
+struct ButtonInputStats {
+    uint32_t samples;
+    uint32_t busy;               // samples skipped, PLC I/O mutex held
+    uint32_t interrupts;         // expander INT edges
+    uint32_t presses;
+    uint32_t holds;
+    uint32_t lost;               // ring full
+    uint32_t presented;          // events whose frame reached the panel
+    uint32_t lastUs;             // input to pixel
+    uint32_t maxUs;
+    uint32_t avgUs;              // moving average, 1/8 per frame
+    uint32_t overBudget;         // frames later than BUTTON_LATENCY_BUDGET_US
+    bool interrupt;              // INT line in use
+};
+
+// Once the PLC is up and the display task is known to ui_frame_begin()
+bool button_input_begin(BasicStampPLC* plc);
+
+// Display task, the only consumer
+bool button_input_pop(ButtonEvent& out);
+// Display task: the frame showing the effect of an event stamped atUs is on the panel
+void button_input_presented(uint32_t atUs);
+
+void button_input_stats(ButtonInputStats& out);
+void button_input_report(Print& out);
+
+#endif // BUTTON_INPUT_H
@@ -3,8 +3,107 @@
 
 #define GEN_CALIB_NAMESPACE "gen_calib"
 
+namespace {
+constexpr size_t kChannels = (size_t)GenSensor::Count;
+constexpr size_t kLutSize = GEN_CALIB_RAW_MAX + 1;
+constexpr uint8_t kFivePercent[5] = {0, 25, 50, 75, 100};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+GeneratorCalibration s_cal;          // under s_mux once s_loaded
+bool s_loaded = false;
+uint32_t s_version = 0;              // under s_mux, bumped by every install
+uint16_t* s_lut = nullptr;           // kChannels tables of kLutSize, allocated on the first compile
+
+struct Points {
+    const uint16_t* raw;
+    const uint8_t* percent;
+    uint8_t count;
+};
+
+Points pointsOf(const GeneratorCalibration& cal, size_t ch) {
+    const GeneratorCurve& c = cal.curves[ch];
+    if (c.count >= 2) return Points{c.raw, c.percent, c.count};
+    const uint16_t* five[kChannels] = {cal.fuelLevelCal, cal.fuelFilterCal, cal.oilLevelCal, cal.oilFilterCal};
+    return Points{five[ch], kFivePercent, 5};
+}
+
+// Percent << GEN_CALIB_FRAC_BITS at raw: the segment walk of calibrateSensor
+// over any number of points, clamped to the end points
+int32_t interpolate(const Points& p, int32_t raw) {
+    if (raw <= p.raw[0]) return (int32_t)p.percent[0] << GEN_CALIB_FRAC_BITS;
+    if (raw >= p.raw[p.count - 1]) return (int32_t)p.percent[p.count - 1] << GEN_CALIB_FRAC_BITS;
+    for (uint8_t i = 0; i + 1 < p.count; i++) {
+        if (raw < p.raw[i] || raw > p.raw[i + 1]) continue;
+        const int32_t base = (int32_t)p.percent[i] << GEN_CALIB_FRAC_BITS;
+        const int32_t rawRange = p.raw[i + 1] - p.raw[i];
+        if (rawRange == 0) return base;
+        const int32_t percentRange = (int32_t)p.percent[i + 1] - p.percent[i];
+        return base + ((percentRange * (raw - p.raw[i])) << GEN_CALIB_FRAC_BITS) / rawRange;
+    }
+    return (int32_t)p.percent[p.count - 1] << GEN_CALIB_FRAC_BITS;
+}
+
+int32_t interpolateClamped(const Points& p, int32_t raw) {
+    return interpolate(p, raw < 0 ? 0 : (raw > (int32_t)GEN_CALIB_RAW_MAX ? (int32_t)GEN_CALIB_RAW_MAX : raw));
+}
+
+// One table; smoothing is a centred moving average over 2 * smoothing + 1 raw counts
+void compileTable(uint16_t* lut, const Points& p, uint8_t smoothing) {
+    if (!smoothing) {
+        for (size_t r = 0; r < kLutSize; r++) lut[r] = (uint16_t)interpolate(p, (int32_t)r);
+        return;
+    }
+    const int32_t w = smoothing;
+    const int32_t span = 2 * w + 1;
+    int32_t sum = 0;
+    for (int32_t k = -w; k <= w; k++) sum += interpolateClamped(p, k);
+    for (int32_t r = 0; r < (int32_t)kLutSize; r++) {
+        lut[r] = (uint16_t)((sum + span / 2) / span);
+        sum += interpolateClamped(p, r + w + 1) - interpolateClamped(p, r - w);
+    }
+}
+
+bool curveValid(const GeneratorCurve& c) {
+    if (c.count == 0) return true;
+    if (c.count < 2 || c.count > GEN_CALIB_MAX_POINTS) return false;
+    for (uint8_t i = 0; i < c.count; i++) {
+        if (c.raw[i] > GEN_CALIB_RAW_MAX || c.percent[i] > 100) return false;
+        if (i && c.raw[i] < c.raw[i - 1]) return false;
+    }
+    return true;
+}
+
+bool calibrationValid(const GeneratorCalibration& cal) {
+    if (cal.smoothing > GEN_CALIB_MAX_SMOOTHING) return false;
+    for (const GeneratorCurve& c : cal.curves) {
+        if (!curveValid(c)) return false;
+    }
+    return true;
+}
+
+// Compiles the tables in place and makes cal the cached calibration
+void install(const GeneratorCalibration& cal) {
+    if (!s_lut) {
+        s_lut = static_cast<uint16_t*>(malloc(kChannels * kLutSize * sizeof(uint16_t)));
+        if (!s_lut) Serial.println("GeneratorCalibration: no memory for tables, converting directly");
+    }
+    if (s_lut) {
+        for (size_t ch = 0; ch < kChannels; ch++) {
+            compileTable(s_lut + ch * kLutSize, pointsOf(cal, ch), cal.smoothing);
+        }
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_cal = cal;
+    s_loaded = true;
+    s_version++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+const char* const kCurveKeys[kChannels] = {"curve0", "curve1", "curve2", "curve3"};
+} // namespace
+
 GeneratorCalibration GeneratorCalibration::getDefaults() {
-    GeneratorCalibration cal;
+    GeneratorCalibration cal = {};
 
     // Default calibration: linear 0-1023 mapping
     // 0%, 25%, 50%, 75%, 100% correspond to 0, 255, 511, 767, 1023
@@ -49,6 +148,14 @@ uint16_t GeneratorCalibration::calibrateSensor(uint16_t rawValue, const uint16_t
 }
 
 GeneratorCalibration getGeneratorCalibration() {
+    if (s_loaded) {
+        GeneratorCalibration cal;
+        portENTER_CRITICAL(&s_mux);
+        cal = s_cal;
+        portEXIT_CRITICAL(&s_mux);
+        return cal;
+    }
+
     Preferences prefs;
     GeneratorCalibration cal = GeneratorCalibration::getDefaults();
 
@@ -61,6 +168,17 @@ GeneratorCalibration getGeneratorCalibration() {
             cal.oilFilterCal[i] = prefs.getUShort(("oilF" + String(i)).c_str(), cal.oilFilterCal[i]);
         }
 
+        // Load extended curves; a malformed one falls back to the 5-point array
+        for (size_t ch = 0; ch < kChannels; ch++) {
+            GeneratorCurve& c = cal.curves[ch];
+            if (!prefs.isKey(kCurveKeys[ch]) || prefs.getBytesLength(kCurveKeys[ch]) != sizeof(c) ||
+                prefs.getBytes(kCurveKeys[ch], &c, sizeof(c)) != sizeof(c) || !curveValid(c)) {
+                c = GeneratorCurve{};
+            }
+        }
+        cal.smoothing = prefs.getUChar("smooth", 0);
+        if (cal.smoothing > GEN_CALIB_MAX_SMOOTHING) cal.smoothing = 0;
+
         // Load service intervals
         cal.fuelFilterIntervalHours = prefs.getULong("fuelFInt", cal.fuelFilterIntervalHours);
         cal.oilFilterIntervalHours = prefs.getULong("oilFInt", cal.oilFilterIntervalHours);
@@ -69,10 +187,15 @@ GeneratorCalibration getGeneratorCalibration() {
         prefs.end();
     }
 
+    install(cal);
     return cal;
 }
 
 bool saveGeneratorCalibration(const GeneratorCalibration& cal) {
+    if (!calibrationValid(cal)) {
+        return false;
+    }
+
     Preferences prefs;
 
     if (!prefs.begin(GEN_CALIB_NAMESPACE, false)) { // Read-write mode
@@ -86,6 +209,14 @@ bool saveGeneratorCalibration(const GeneratorCalibration& cal) {
         prefs.putUShort(("oil" + String(i)).c_str(), cal.oilLevelCal[i]);
         prefs.putUShort(("oilF" + String(i)).c_str(), cal.oilFilterCal[i]);
     }
+    for (size_t ch = 0; ch < kChannels; ch++) {
+        if (cal.curves[ch].count) {
+            prefs.putBytes(kCurveKeys[ch], &cal.curves[ch], sizeof(GeneratorCurve));
+        } else if (prefs.isKey(kCurveKeys[ch])) {
+            prefs.remove(kCurveKeys[ch]);
+        }
+    }
+    prefs.putUChar("smooth", cal.smoothing);
 
     // Save service intervals
     prefs.putULong("fuelFInt", cal.fuelFilterIntervalHours);
@@ -93,6 +224,7 @@ bool saveGeneratorCalibration(const GeneratorCalibration& cal) {
     prefs.putULong("oilCInt", cal.oilChangeIntervalHours);
 
     prefs.end();
+    install(cal);
     return true;
 }
 
@@ -100,3 +232,42 @@ void resetGeneratorCalibrationToDefaults() {
     GeneratorCalibration cal = GeneratorCalibration::getDefaults();
     saveGeneratorCalibration(cal);
 }
+
+uint32_t generator_calibration_version() {
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t v = s_version;
+    portEXIT_CRITICAL(&s_mux);
+    return v;
+}
+
+uint16_t generator_calibrate_fixed(GenSensor sensor, uint16_t raw) {
+    const size_t ch = (size_t)sensor;
+    if (ch >= kChannels) return 0;
+    if (raw > GEN_CALIB_RAW_MAX) raw = GEN_CALIB_RAW_MAX;
+    if (!s_loaded) getGeneratorCalibration();
+    if (s_lut) return s_lut[ch * kLutSize + raw];
+
+    // No table memory: evaluate the curve, without smoothing
+    const GeneratorCalibration cal = getGeneratorCalibration();
+    return (uint16_t)interpolate(pointsOf(cal, ch), raw);
+}
+
+uint16_t generator_calibrate(GenSensor sensor, uint16_t raw) {
+    return generator_calibrate_fixed(sensor, raw) >> GEN_CALIB_FRAC_BITS;
+}
+
+uint16_t generator_calibrate_mean(GenSensor sensor, const uint16_t* raw, size_t n) {
+    if (!n) return 0;
+    const size_t ch = (size_t)sensor;
+    if (ch >= kChannels) return 0;
+    if (!s_loaded) getGeneratorCalibration();
+    if (!s_lut) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < n; i++) sum += generator_calibrate_fixed(sensor, raw[i]);
+        return (uint16_t)(sum / n);
+    }
+    const uint16_t* lut = s_lut + ch * kLutSize;
+    uint32_t sum = 0;
+    for (size_t i = 0; i < n; i++) sum += lut[raw[i] > GEN_CALIB_RAW_MAX ? GEN_CALIB_RAW_MAX : raw[i]];
+    return (uint16_t)(sum / n);
+}
@@ -5,13 +5,39 @@
 
 /**
  * Generator calibration functions
+ *
+ * The calibration is compiled into one fixed-point table per channel covering
+ * the whole 10-bit raw range (percent << GEN_CALIB_FRAC_BITS per raw count),
+ * when it is first loaded and on every save. A conversion is one table load,
+ * so oversampled readings can be converted sample by sample and averaged.
+ * Tables are rewritten in place on save: a conversion racing a save sees the
+ * old or the new entry, never a torn one.
  */
 
-// Load calibration from NVS
+#define GEN_CALIB_RAW_BITS 10
+#define GEN_CALIB_RAW_MAX ((1u << GEN_CALIB_RAW_BITS) - 1)
+#define GEN_CALIB_FRAC_BITS 8
+#ifndef GEN_CALIB_MAX_SMOOTHING
+#define GEN_CALIB_MAX_SMOOTHING 32
+#endif
+
+// Load calibration from NVS; cached after the first call
 GeneratorCalibration getGeneratorCalibration();
 
-// Save calibration to NVS
+// Save calibration to NVS and recompile the tables. Fails on an extended curve
+// with fewer than 2 or more than GEN_CALIB_MAX_POINTS points or raw values out
+// of order, or smoothing above GEN_CALIB_MAX_SMOOTHING.
 bool saveGeneratorCalibration(const GeneratorCalibration& cal);
 
 // Reset to default calibration
 void resetGeneratorCalibrationToDefaults();
+
+// Changes whenever the cached calibration does; 0 before the first load
+uint32_t generator_calibration_version();
+
+// Percent << GEN_CALIB_FRAC_BITS; raw values above GEN_CALIB_RAW_MAX clamp
+uint16_t generator_calibrate_fixed(GenSensor sensor, uint16_t raw);
+// Percent 0-100, as GeneratorCalibration::calibrateSensor
+uint16_t generator_calibrate(GenSensor sensor, uint16_t raw);
+// Mean of n converted samples, percent << GEN_CALIB_FRAC_BITS
+uint16_t generator_calibrate_mean(GenSensor sensor, const uint16_t* raw, size_t n);
@@ -0,0 +1,285 @@
+/*
+ * Generator Derived Metrics Implementation
+ */
+
+#include "generator_derived.h"
+
+#if GEN_DERIVED_ENABLE
+
+#include "generator_calibration.h"
+#include "../modules/settings/hour_meter.h"
+#include "../system/metrics.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr size_t kServices = (size_t)GenService::Count;
+constexpr size_t kCounters = (size_t)HourCounter::Count;
+constexpr float kFrac = (float)(1u << GEN_CALIB_FRAC_BITS);
+
+// Weighted sums of the fuel line, x in run hours before the newest sample
+struct FuelFit {
+    float s0;
+    float sx;
+    float sxx;
+    float sy;
+    float sxy;
+    uint32_t spanS;          // run time folded since the fit started
+    uint32_t samples;
+};
+
+// Everything a read depends on; the memo holds while this is unchanged
+struct InputKey {
+    uint32_t fuelSeq;
+    uint32_t seconds[kCounters];
+    uint32_t calVersion;
+    uint32_t dutySeq;
+};
+
+// Producer only
+FuelFit s_work = {};
+bool s_primed = false;
+uint32_t s_lastRunS = 0;
+float s_levelEma = 0.0f;     // refill reference
+uint8_t s_above = 0;         // frames in a row above it
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+// Under s_mux
+FuelFit s_fit = {};
+uint32_t s_fuelSeq = 0;
+uint32_t s_refills = 0;
+float s_duty = -1.0f;
+uint32_t s_dutySeq = 0;
+uint32_t s_dutyStartMs = 0;  // 0 = no window open
+uint32_t s_dutyStartRunS = 0;
+uint32_t s_intervalS[kServices] = {};
+uint32_t s_intervalVersion = 0;
+InputKey s_memoKey = {};
+GeneratorDerived s_memo = {};
+bool s_memoValid = false;
+
+// Under s_mux; closes the duty window when it is due
+void updateDuty(uint32_t now, uint32_t runS) {
+    if (!s_dutyStartMs) {
+        s_dutyStartMs = now ? now : 1;
+        s_dutyStartRunS = runS;
+        return;
+    }
+    const uint32_t elapsedMs = now - s_dutyStartMs;
+    if (elapsedMs < GEN_DERIVED_DUTY_WINDOW_S * 1000UL) return;
+    float d = (float)(runS - s_dutyStartRunS) * 1000.0f / (float)elapsedMs;
+    if (d > 1.0f) d = 1.0f;
+    s_duty = s_duty < 0.0f ? d : s_duty + (d - s_duty) / GEN_DERIVED_DUTY_EWMA_DIV;
+    s_dutySeq++;
+    s_dutyStartMs = now ? now : 1;
+    s_dutyStartRunS = runS;
+}
+
+// The intervals are copied out of the calibration only when it changed
+void refreshIntervals(uint32_t calVersion) {
+    portENTER_CRITICAL(&s_mux);
+    const bool current = calVersion && calVersion == s_intervalVersion;
+    portEXIT_CRITICAL(&s_mux);
+    if (current) return;
+    const GeneratorCalibration cal = getGeneratorCalibration();
+    const uint32_t hours[kServices] = {cal.fuelFilterIntervalHours, cal.oilFilterIntervalHours,
+                                       cal.oilChangeIntervalHours};
+    portENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < kServices; i++) s_intervalS[i] = hours[i] * 3600;
+    s_intervalVersion = generator_calibration_version();
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void compute(const FuelFit& fit, float duty, const uint32_t* intervalS, const uint32_t* seconds,
+             GeneratorDerived& out) {
+    out.fuelSamples = fit.samples;
+    out.fuelPercent = fit.s0 > 0.0f ? fit.sy / fit.s0 : 0.0f;
+    out.hoursToEmpty = -1.0f;
+    const float den = fit.s0 * fit.sxx - fit.sx * fit.sx;
+    if (fit.spanS >= GEN_DERIVED_MIN_SPAN_S && fit.samples >= 2 && den > 0.0f) {
+        const float slope = (fit.s0 * fit.sxy - fit.sx * fit.sy) / den;     // % per run hour
+        const float level = (fit.sy - slope * fit.sx) / fit.s0;
+        out.fuelValid = true;
+        out.fuelPercent = level < 0.0f ? 0.0f : level > 100.0f ? 100.0f : level;
+        out.burnPctPerHour = -slope;
+        if (out.burnPctPerHour >= GEN_DERIVED_MIN_BURN_PPH) out.hoursToEmpty = out.fuelPercent / out.burnPctPerHour;
+    }
+
+    out.duty = duty;
+    out.serviceValid = true;
+    int32_t soonest = INT32_MAX;
+    for (size_t i = 0; i < kServices; i++) {
+        GenServiceProjection& p = out.service[i];
+        p.daysToDue = -1.0f;
+        if (!intervalS[i]) {
+            p.remainingS = INT32_MAX;
+            continue;
+        }
+        const int64_t left = (int64_t)intervalS[i] - seconds[1 + i];
+        p.remainingS = left < INT32_MIN ? INT32_MIN : (int32_t)left;
+        if (p.remainingS <= 0) {
+            p.daysToDue = 0.0f;
+        } else if (duty > 0.001f) {
+            p.daysToDue = (float)p.remainingS / duty / 86400.0f;
+        }
+        if (p.remainingS < soonest) {
+            soonest = p.remainingS;
+            out.nextService = (uint8_t)i;
+        }
+    }
+}
+
+int32_t gauge(float v, float scale) {
+    const float s = v * scale;
+    return s >= 2147483520.0f ? INT32_MAX : s <= -2147483520.0f ? INT32_MIN : (int32_t)lroundf(s);
+}
+
+MetricGauge s_metricBurn("gen.burn_cph", []() -> int32_t {
+    GeneratorDerived d;
+    return generator_derived_get(d) ? gauge(d.burnPctPerHour, 100.0f) : 0;
+});
+MetricGauge s_metricEmpty("gen.empty_dh", []() -> int32_t {
+    GeneratorDerived d;
+    return generator_derived_get(d) && d.hoursToEmpty >= 0.0f ? gauge(d.hoursToEmpty, 10.0f) : -1;
+});
+MetricGauge s_metricService("gen.service_h", []() -> int32_t {
+    GeneratorDerived d;
+    generator_derived_get(d);
+    return d.service[d.nextService].remainingS / 3600;
+});
+} // namespace
+
+void generator_derived_fuel(uint16_t fixedPercent) {
+    const float y = fixedPercent / kFrac;
+    const uint32_t runS = hour_meter_seconds(HourCounter::Run);
+    if (!s_primed) {
+        s_primed = true;
+        s_levelEma = y;
+        s_lastRunS = runS;
+    }
+
+    // A slosh passes within a few frames; a refill stays up
+    bool refill = false;
+    if (y > s_levelEma + GEN_DERIVED_REFILL_PCT) {
+        if (++s_above >= GEN_DERIVED_REFILL_SAMPLES) {
+            refill = true;
+            s_above = 0;
+            s_levelEma = y;
+            s_work = FuelFit{};
+        }
+    } else {
+        s_above = 0;
+        s_levelEma += (y - s_levelEma) / 16.0f;
+    }
+
+    // One fold per run second at most: standing time has no burn
+    const uint32_t dx = runS - s_lastRunS;
+    if (dx == 0 && s_work.samples) return;
+    s_lastRunS = runS;
+    if (s_work.samples) {
+        // Re-centre on this sample, x -= h, then age the old ones
+        const float h = dx / 3600.0f;
+        const float sx = s_work.sx;
+        s_work.sx -= h * s_work.s0;
+        s_work.sxx += h * (h * s_work.s0 - 2.0f * sx);
+        s_work.sxy -= h * s_work.sy;
+        const float k = expf(-(float)dx / (float)GEN_DERIVED_FUEL_TAU_S);
+        s_work.s0 *= k;
+        s_work.sx *= k;
+        s_work.sxx *= k;
+        s_work.sy *= k;
+        s_work.sxy *= k;
+        s_work.spanS += dx;
+    }
+    s_work.s0 += 1.0f;
+    s_work.sy += y;
+    s_work.samples++;
+
+    portENTER_CRITICAL(&s_mux);
+    s_fit = s_work;
+    s_fuelSeq++;
+    if (refill) s_refills++;
+    updateDuty(millis(), runS);
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool generator_derived_get(GeneratorDerived& out) {
+    InputKey key{};
+    for (size_t i = 0; i < kCounters; i++) key.seconds[i] = hour_meter_seconds((HourCounter)i);
+    key.calVersion = generator_calibration_version();
+    refreshIntervals(key.calVersion);
+    key.calVersion = generator_calibration_version();
+
+    FuelFit fit;
+    float duty;
+    uint32_t intervalS[kServices];
+    uint32_t refills;
+    portENTER_CRITICAL(&s_mux);
+    updateDuty(millis(), key.seconds[(size_t)HourCounter::Run]);
+    key.fuelSeq = s_fuelSeq;
+    key.dutySeq = s_dutySeq;
+    if (s_memoValid && memcmp(&key, &s_memoKey, sizeof(key)) == 0) {
+        out = s_memo;
+        portEXIT_CRITICAL(&s_mux);
+        return out.fuelValid;
+    }
+    fit = s_fit;
+    duty = s_duty;
+    memcpy(intervalS, s_intervalS, sizeof(intervalS));
+    refills = s_refills;
+    const uint32_t version = s_memo.version + 1;
+    portEXIT_CRITICAL(&s_mux);
+
+    out = GeneratorDerived{};
+    compute(fit, duty, intervalS, key.seconds, out);
+    out.refills = refills;
+    out.version = version;
+    portENTER_CRITICAL(&s_mux);
+    s_memo = out;
+    s_memoKey = key;
+    s_memoValid = true;
+    portEXIT_CRITICAL(&s_mux);
+    return out.fuelValid;
+}
+
+const char* generator_service_name(GenService s) {
+    switch (s) {
+        case GenService::FuelFilter: return "fuel filter";
+        case GenService::OilFilter: return "oil filter";
+        case GenService::OilChange: return "oil change";
+        default: return "?";
+    }
+}
+
+void generator_derived_report(Print& out) {
+    GeneratorDerived d;
+    generator_derived_get(d);
+    if (d.fuelValid) {
+        out.printf("Generator derived: fuel %.1f%%, burn %.2f %%/run h, ", d.fuelPercent, d.burnPctPerHour);
+        if (d.hoursToEmpty >= 0.0f) {
+            out.printf("empty in %.1f run h", d.hoursToEmpty);
+        } else {
+            out.print("not burning");
+        }
+    } else {
+        out.printf("Generator derived: fuel fit pending (%lu samples)", (unsigned long)d.fuelSamples);
+    }
+    out.printf(", %lu refills, duty ", (unsigned long)d.refills);
+    if (d.duty >= 0.0f) {
+        out.printf("%.1f%%\n", d.duty * 100.0f);
+    } else {
+        out.println("pending");
+    }
+    for (size_t i = 0; i < kServices; i++) {
+        const GenServiceProjection& p = d.service[i];
+        if (p.remainingS == INT32_MAX) continue;
+        out.printf("  %-11s %ld run h left", generator_service_name((GenService)i), (long)(p.remainingS / 3600));
+        if (p.daysToDue >= 0.0f) {
+            out.printf(", due in %.1f days\n", p.daysToDue);
+        } else {
+            out.println();
+        }
+    }
+}
+
+#endif // GEN_DERIVED_ENABLE
@@ -0,0 +1,92 @@
+/*
+ * Generator Derived Metrics
+ * Fuel burn rate, time to empty and service projections kept current as the
+ * samples arrive, so the UI, the uplink and the Modbus slave read them rather
+ * than a backend recomputing them from raw history:
+ *   - fuel: an exponentially weighted least-squares line of fuel level over
+ *     engine run time, updated in O(1) per CAN sensor frame: five running sums,
+ *     re-centred on the newest sample and decayed with a time constant of
+ *     GEN_DERIVED_FUEL_TAU_S of run time. Its slope is the burn rate per run
+ *     hour. While the engine stands no run time passes and nothing is folded;
+ *     a level GEN_DERIVED_REFILL_PCT above the smoothed one for
+ *     GEN_DERIVED_REFILL_SAMPLES frames in a row is a refill and restarts the
+ *     fit.
+ *   - duty: run seconds per wall second, closed every GEN_DERIVED_DUTY_WINDOW_S
+ *     into a moving average (1/GEN_DERIVED_DUTY_EWMA_DIV per window)
+ *   - service: run time left to each interval (calibration intervals, hour
+ *     meter counters) and the calendar days that is at the learned duty
+ * A read computes from the sums only when an input changed since the last
+ * one: a folded fuel sample, an hour meter counter, the calibration or the
+ * duty. Otherwise it copies the memoized result.
+ */
+
+#ifndef GENERATOR_DERIVED_H
+#define GENERATOR_DERIVED_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef GEN_DERIVED_FUEL_TAU_S
+#define GEN_DERIVED_FUEL_TAU_S 7200        // run time the fit looks back over
+#endif
+#ifndef GEN_DERIVED_MIN_SPAN_S
+#define GEN_DERIVED_MIN_SPAN_S 1800        // run time folded before the rate counts
+#endif
+#ifndef GEN_DERIVED_MIN_BURN_PPH
+#define GEN_DERIVED_MIN_BURN_PPH 0.05f     // burn below this has no time to empty
+#endif
+#ifndef GEN_DERIVED_REFILL_PCT
+#define GEN_DERIVED_REFILL_PCT 5
+#endif
+#ifndef GEN_DERIVED_REFILL_SAMPLES
+#define GEN_DERIVED_REFILL_SAMPLES 5
+#endif
+#ifndef GEN_DERIVED_DUTY_WINDOW_S
+#define GEN_DERIVED_DUTY_WINDOW_S 3600
+#endif
+#ifndef GEN_DERIVED_DUTY_EWMA_DIV
+#define GEN_DERIVED_DUTY_EWMA_DIV 24       // about a day of windows
+#endif
+
+// Service intervals, in the order of HourCounter after Run
+enum class GenService : uint8_t { FuelFilter, OilFilter, OilChange, Count };
+
+struct GenServiceProjection {
+    int32_t remainingS;      // run time left, negative when overdue
+    float daysToDue;         // at the learned duty, -1 = unknown
+};
+
+struct GeneratorDerived {
+    uint32_t version;        // changes with any input
+    bool fuelValid;          // the fit spans GEN_DERIVED_MIN_SPAN_S of run time
+    float fuelPercent;       // the fit at the newest sample
+    float burnPctPerHour;    // per run hour, positive while burning
+    float hoursToEmpty;      // run hours at that rate, -1 = not burning
+    uint32_t fuelSamples;    // folded since the fit started
+    uint32_t refills;        // since boot
+    float duty;              // fraction of wall time running, -1 until the first window
+    bool serviceValid;
+    GenServiceProjection service[(size_t)GenService::Count];
+    uint8_t nextService;     // GenService due first
+};
+
+#if GEN_DERIVED_ENABLE
+
+// The fuel sensor's producer (CAN frame decode), percent << GEN_CALIB_FRAC_BITS
+void generator_derived_fuel(uint16_t fixedPercent);
+
+// Any task; false until the fuel fit is valid (service projections are filled regardless)
+bool generator_derived_get(GeneratorDerived& out);
+const char* generator_service_name(GenService s);
+void generator_derived_report(Print& out);
+
+#else
+
+inline void generator_derived_fuel(uint16_t) {}
+inline bool generator_derived_get(GeneratorDerived& out) { out = GeneratorDerived{}; return false; }
+inline const char* generator_service_name(GenService) { return "?"; }
+inline void generator_derived_report(Print&) {}
+
+#endif // GEN_DERIVED_ENABLE
+
+#endif // GENERATOR_DERIVED_H
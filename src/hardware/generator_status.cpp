@@ -1,5 +1,6 @@
 #include "generator_status.h"
 #include "generator_calibration.h"
+#include "input_capture.h"
 
 // Helper function to format time duration
 static String formatTimeSince(uint32_t timestamp) {
@@ -17,6 +18,21 @@ static String formatTimeSince(uint32_t timestamp) {
     }
 }
 
+// Pulse counts and frequencies from the local inputs
+static void applyInputCapture(GeneratorStatus& status) {
+    for (uint8_t i = 0; i < 8; i++) {
+        InputChannelStats s;
+        const bool ok = input_capture_channel(i, s);
+        status.inputPulses[i] = ok ? s.pulses : 0;
+        status.inputFreqMilliHz[i] = ok ? s.freqMilliHz : 0;
+    }
+    status.engineRpm = 0;
+#if GENERATOR_RPM_INPUT >= 0
+    status.engineRpm = (uint32_t)((uint64_t)status.inputFreqMilliHz[GENERATOR_RPM_INPUT] * 60 / 1000 /
+                                  GENERATOR_RPM_PULSES_PER_REV);
+#endif
+}
+
 GeneratorStatus GeneratorStatus::fromCanData(
     const CanGeneratorProtocol& canProtocol,
     bool canModuleReady
@@ -80,14 +96,13 @@ GeneratorStatus GeneratorStatus::fromCanData(
         status.oilChangeHours = 0;
     }
 
-    // Get calibration settings
-    GeneratorCalibration cal = getGeneratorCalibration();
+    applyInputCapture(status);
 
-    // Apply calibration
-    status.fuelLevelPercent = cal.calibrateSensor(status.fuelLevelRaw, cal.fuelLevelCal);
-    status.fuelFilterLifePercent = 100 - cal.calibrateSensor(status.fuelFilterRaw, cal.fuelFilterCal); // Inverted
-    status.oilLevelPercent = cal.calibrateSensor(status.oilLevelRaw, cal.oilLevelCal);
-    status.oilFilterLifePercent = 100 - cal.calibrateSensor(status.oilFilterRaw, cal.oilFilterCal); // Inverted
+    // Apply calibration (compiled tables, generator_calibration.h)
+    status.fuelLevelPercent = generator_calibrate(GenSensor::FuelLevel, status.fuelLevelRaw);
+    status.fuelFilterLifePercent = 100 - generator_calibrate(GenSensor::FuelFilter, status.fuelFilterRaw); // Inverted
+    status.oilLevelPercent = generator_calibrate(GenSensor::OilLevel, status.oilLevelRaw);
+    status.oilFilterLifePercent = 100 - generator_calibrate(GenSensor::OilFilter, status.oilFilterRaw); // Inverted
 
     // Format display strings
     status.runTimeText = String(status.totalRunTimeHours) + " hours total";
@@ -147,15 +162,13 @@ GeneratorStatus GeneratorStatus::fromRawData(
     status.fuelFilterHours = fuelFilterHrs;
     status.oilFilterHours = oilFilterHrs;
     status.oilChangeHours = oilChangeHrs;
+    applyInputCapture(status);
 
-    // Get calibration settings
-    GeneratorCalibration cal = getGeneratorCalibration();
-
-    // Apply calibration
-    status.fuelLevelPercent = cal.calibrateSensor(fuelRaw, cal.fuelLevelCal);
-    status.fuelFilterLifePercent = 100 - cal.calibrateSensor(fuelFilterRaw, cal.fuelFilterCal); // Inverted
-    status.oilLevelPercent = cal.calibrateSensor(oilRaw, cal.oilLevelCal);
-    status.oilFilterLifePercent = 100 - cal.calibrateSensor(oilFilterRaw, cal.oilFilterCal); // Inverted
+    // Apply calibration (compiled tables, generator_calibration.h)
+    status.fuelLevelPercent = generator_calibrate(GenSensor::FuelLevel, fuelRaw);
+    status.fuelFilterLifePercent = 100 - generator_calibrate(GenSensor::FuelFilter, fuelFilterRaw); // Inverted
+    status.oilLevelPercent = generator_calibrate(GenSensor::OilLevel, oilRaw);
+    status.oilFilterLifePercent = 100 - generator_calibrate(GenSensor::OilFilter, oilFilterRaw); // Inverted
 
     // Format display strings
     status.runTimeText = String(runTimeHours) + " hours total";
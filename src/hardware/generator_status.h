@@ -4,6 +4,14 @@
 #include <stdint.h>
 #include "../modules/pwrcan/can_generator_protocol.h"
 
+// PLC input carrying the engine speed pickup (hardware/input_capture.h), -1 for none
+#ifndef GENERATOR_RPM_INPUT
+#define GENERATOR_RPM_INPUT -1
+#endif
+#ifndef GENERATOR_RPM_PULSES_PER_REV
+#define GENERATOR_RPM_PULSES_PER_REV 1
+#endif
+
 /**
  * Generator status DTO with calibrated sensor values and service counters
  */
@@ -31,6 +39,11 @@ struct GeneratorStatus {
     bool relayOutputs[2];
     bool digitalInputs[8];
 
+    // Local input capture: rising edges and frequency per input, engine speed
+    uint32_t inputPulses[8];
+    uint32_t inputFreqMilliHz[8];
+    uint32_t engineRpm;           // 0 without GENERATOR_RPM_INPUT or when stalled
+
     // Status
     bool moduleReady;
 
@@ -59,6 +72,23 @@ struct GeneratorStatus {
     );
 };
 
+#ifndef GEN_CALIB_MAX_POINTS
+#define GEN_CALIB_MAX_POINTS 16            // points of an extended curve
+#endif
+
+// Calibrated channels, in the order of GeneratorCalibration::curves
+enum class GenSensor : uint8_t { FuelLevel, FuelFilter, OilLevel, OilFilter, Count };
+
+/**
+ * Extended calibration curve: count points (raw, percent), raw ascending.
+ * count 0 uses the 5-point array of the channel.
+ */
+struct GeneratorCurve {
+    uint8_t count;
+    uint16_t raw[GEN_CALIB_MAX_POINTS];
+    uint8_t percent[GEN_CALIB_MAX_POINTS];
+};
+
 /**
  * Generator calibration settings
  */
@@ -69,6 +99,10 @@ struct GeneratorCalibration {
     uint16_t oilLevelCal[5];       // Calibration points for oil level
     uint16_t oilFilterCal[5];      // Calibration points for oil filter life
 
+    // Optional curves with more points, replacing the arrays above
+    GeneratorCurve curves[(size_t)GenSensor::Count];
+    uint8_t smoothing;             // moving-average half-width in raw counts, 0 = off
+
     // Service intervals (in hours)
     uint32_t fuelFilterIntervalHours;
     uint32_t oilFilterIntervalHours;
@@ -76,5 +110,7 @@ struct GeneratorCalibration {
 
     // Helper methods
     static GeneratorCalibration getDefaults();
+    // Direct evaluation of a 5-point array; conversions go through the compiled
+    // tables (generator_calibrate())
     uint16_t calibrateSensor(uint16_t rawValue, const uint16_t calPoints[5]) const;
 };
@@ -0,0 +1,187 @@
+/*
+ * Input Capture Implementation
+ */
+
+#include "input_capture.h"
+
+#if INPUT_CAPTURE_ENABLE
+
+#include <driver/gpio.h>
+#include <esp_timer.h>
+
+namespace {
+constexpr int8_t kGpio[INPUT_CAPTURE_CHANNELS] = {
+    INPUT_CAPTURE_GPIO_0, INPUT_CAPTURE_GPIO_1, INPUT_CAPTURE_GPIO_2, INPUT_CAPTURE_GPIO_3,
+    INPUT_CAPTURE_GPIO_4, INPUT_CAPTURE_GPIO_5, INPUT_CAPTURE_GPIO_6, INPUT_CAPTURE_GPIO_7,
+};
+
+struct Channel {
+    bool known;              // level holds a reading
+    bool level;
+    bool interrupt;
+    uint32_t debounceUs;
+    uint32_t pulses;
+    uint32_t bounces;
+    int64_t lastEdgeUs;
+    uint8_t rises;           // valid entries of riseUs, up to INPUT_CAPTURE_PERIODS
+    uint8_t riseHead;
+    int64_t riseUs[INPUT_CAPTURE_PERIODS];
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Channel s_ch[INPUT_CAPTURE_CHANNELS];
+InputEdge s_edges[INPUT_CAPTURE_EDGES];
+uint32_t s_head = 0;         // edges written
+uint32_t s_tail = 0;         // edges drained
+uint32_t s_lost = 0;
+bool s_started = false;
+
+// Under s_mux; from the GPIO ISR too
+void IRAM_ATTR record(uint8_t ch, bool level, int64_t tUs) {
+    Channel& c = s_ch[ch];
+    if (c.known && level == c.level) return;
+    if (c.known && tUs - c.lastEdgeUs < (int64_t)c.debounceUs) {
+        c.bounces++;
+        return;
+    }
+    const bool edge = c.known;
+    c.known = true;
+    c.level = level;
+    if (!edge) return;   // the first reading sets the level only
+
+    c.lastEdgeUs = tUs;
+    if (level) {
+        c.pulses++;
+        c.riseUs[c.riseHead] = tUs;
+        c.riseHead = (c.riseHead + 1) % INPUT_CAPTURE_PERIODS;
+        if (c.rises < INPUT_CAPTURE_PERIODS) c.rises++;
+    }
+    s_edges[s_head % INPUT_CAPTURE_EDGES] = InputEdge{tUs, ch, level};
+    s_head++;
+    if (s_head - s_tail > INPUT_CAPTURE_EDGES) {
+        s_tail = s_head - INPUT_CAPTURE_EDGES;
+        s_lost++;
+    }
+}
+
+void IRAM_ATTR gpioIsr(void* arg) {
+    const uint8_t ch = (uint8_t)(uintptr_t)arg;
+    const bool level = gpio_get_level((gpio_num_t)kGpio[ch]) != 0;
+    const int64_t t = esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&s_mux);
+    record(ch, level, t);
+    portEXIT_CRITICAL_ISR(&s_mux);
+}
+
+// Under s_mux. Mean rising-edge period over the window; with fewer than two
+// rises inside it (below 1 Hz) the last period, until the channel stalls.
+uint32_t periodUs(const Channel& c, int64_t now) {
+    if (c.rises < 2) return 0;
+    const int64_t newest = c.riseUs[(c.riseHead + INPUT_CAPTURE_PERIODS - 1) % INPUT_CAPTURE_PERIODS];
+    if (now - newest > INPUT_CAPTURE_STALL_US) return 0;
+    int64_t oldest = newest;
+    uint8_t n = 1;
+    for (uint8_t i = 2; i <= c.rises; i++) {
+        const int64_t t = c.riseUs[(c.riseHead + INPUT_CAPTURE_PERIODS - i) % INPUT_CAPTURE_PERIODS];
+        if (n >= 2 && now - t > INPUT_CAPTURE_FREQ_WINDOW_US) break;
+        oldest = t;
+        n++;
+    }
+    return (uint32_t)((newest - oldest) / (n - 1));
+}
+} // namespace
+
+bool input_capture_begin() {
+    if (s_started) return true;
+    for (uint8_t ch = 0; ch < INPUT_CAPTURE_CHANNELS; ch++) {
+        s_ch[ch] = Channel{};
+        s_ch[ch].debounceUs = INPUT_CAPTURE_DEBOUNCE_US;
+    }
+    uint8_t attached = 0;
+    for (uint8_t ch = 0; ch < INPUT_CAPTURE_CHANNELS; ch++) {
+        if (kGpio[ch] < 0) continue;
+        pinMode(kGpio[ch], INPUT);
+        s_ch[ch].interrupt = true;
+        record(ch, digitalRead(kGpio[ch]) == HIGH, esp_timer_get_time());
+        attachInterruptArg(kGpio[ch], gpioIsr, (void*)(uintptr_t)ch, CHANGE);
+        attached++;
+    }
+    s_started = true;
+    Serial.printf("InputCapture: %u channels on GPIO interrupts, %u from the PLC scan\n", (unsigned)attached,
+                  (unsigned)(INPUT_CAPTURE_CHANNELS - attached));
+    return true;
+}
+
+void input_capture_sample(uint8_t bits, int64_t tUs) {
+    if (!s_started) return;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t ch = 0; ch < INPUT_CAPTURE_CHANNELS; ch++) {
+        if (!s_ch[ch].interrupt) record(ch, (bits >> ch) & 1, tUs);
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool input_capture_channel(uint8_t channel, InputChannelStats& out) {
+    if (!s_started || channel >= INPUT_CAPTURE_CHANNELS) return false;
+    const int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_mux);
+    const Channel& c = s_ch[channel];
+    out.level = c.level;
+    out.interrupt = c.interrupt;
+    out.pulses = c.pulses;
+    out.bounces = c.bounces;
+    out.lastEdgeUs = c.lastEdgeUs;
+    out.periodUs = periodUs(c, now);
+    portEXIT_CRITICAL(&s_mux);
+    out.freqMilliHz = out.periodUs ? (uint32_t)(1000000000ULL / out.periodUs) : 0;
+    return true;
+}
+
+float input_capture_frequency(uint8_t channel) {
+    InputChannelStats s;
+    if (!input_capture_channel(channel, s) || !s.periodUs) return 0.0f;
+    return 1000000.0f / (float)s.periodUs;
+}
+
+void input_capture_set_debounce(uint8_t channel, uint32_t us) {
+    if (channel >= INPUT_CAPTURE_CHANNELS) return;
+    portENTER_CRITICAL(&s_mux);
+    s_ch[channel].debounceUs = us;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void input_capture_reset_counts() {
+    portENTER_CRITICAL(&s_mux);
+    for (Channel& c : s_ch) {
+        c.pulses = 0;
+        c.bounces = 0;
+    }
+    s_lost = 0;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+size_t input_capture_edges(InputEdge* out, size_t max, uint32_t* lost) {
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    while (n < max && s_tail != s_head) {
+        out[n++] = s_edges[s_tail % INPUT_CAPTURE_EDGES];
+        s_tail++;
+    }
+    if (lost) *lost = s_lost;
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+void input_capture_report(Print& out) {
+    if (!s_started) return;
+    out.println("Input capture: ch src  lvl   pulses  bounces    freq_Hz");
+    for (uint8_t ch = 0; ch < INPUT_CAPTURE_CHANNELS; ch++) {
+        InputChannelStats s;
+        if (!input_capture_channel(ch, s)) continue;
+        out.printf("               %2u %-4s %3u %8lu %8lu %10.3f\n", (unsigned)ch, s.interrupt ? "isr" : "scan",
+                   (unsigned)s.level, (unsigned long)s.pulses, (unsigned long)s.bounces, s.freqMilliHz / 1000.0);
+    }
+    if (s_lost) out.printf("               %lu edges lost to ring overruns\n", (unsigned long)s_lost);
+}
+
+#endif // INPUT_CAPTURE_ENABLE
@@ -0,0 +1,118 @@
+/*
+ * Input Capture
+ * Edge timestamps, pulse counts and frequency for the eight PLC inputs.
+ *   - every accepted edge goes into a ring of INPUT_CAPTURE_EDGES with its
+ *     esp_timer timestamp; input_capture_edges() drains it
+ *   - per channel: rising edges counted, the level, and a frequency estimate
+ *     from the rising edges of the last INPUT_CAPTURE_FREQ_WINDOW_US, dropping
+ *     to zero when no edge arrived for INPUT_CAPTURE_STALL_US
+ *   - an edge closer than the channel's debounce time to the last accepted one
+ *     is dropped (contact bounce on relay pickups)
+ *
+ * The StampPLC inputs sit behind the I2C I/O expander, so they can't raise an
+ * interrupt of their own; they are sampled by the PLC scan
+ * (input_capture_sample()), which sees pulses longer than its period. A channel
+ * whose signal is also wired to an ESP32 GPIO (INPUT_CAPTURE_GPIO_n, e.g. an RPM
+ * pickup on the Grove port) is captured from an any-edge GPIO interrupt instead:
+ * exact timestamps, debounced in the ISR, and the scan no longer reports it.
+ */
+
+#ifndef INPUT_CAPTURE_H
+#define INPUT_CAPTURE_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#define INPUT_CAPTURE_CHANNELS 8
+#ifndef INPUT_CAPTURE_EDGES
+#define INPUT_CAPTURE_EDGES 64             // edges kept until drained
+#endif
+#ifndef INPUT_CAPTURE_DEBOUNCE_US
+#define INPUT_CAPTURE_DEBOUNCE_US 1000     // default per channel
+#endif
+#ifndef INPUT_CAPTURE_FREQ_WINDOW_US
+#define INPUT_CAPTURE_FREQ_WINDOW_US 1000000LL
+#endif
+#ifndef INPUT_CAPTURE_STALL_US
+#define INPUT_CAPTURE_STALL_US 2000000LL   // no edge this long: 0 Hz
+#endif
+#define INPUT_CAPTURE_PERIODS 16           // rising-edge periods kept per channel
+
+// ESP32 GPIO carrying the same signal as input n, -1 when it only reaches the expander
+#ifndef INPUT_CAPTURE_GPIO_0
+#define INPUT_CAPTURE_GPIO_0 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_1
+#define INPUT_CAPTURE_GPIO_1 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_2
+#define INPUT_CAPTURE_GPIO_2 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_3
+#define INPUT_CAPTURE_GPIO_3 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_4
+#define INPUT_CAPTURE_GPIO_4 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_5
+#define INPUT_CAPTURE_GPIO_5 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_6
+#define INPUT_CAPTURE_GPIO_6 -1
+#endif
+#ifndef INPUT_CAPTURE_GPIO_7
+#define INPUT_CAPTURE_GPIO_7 -1
+#endif
+
+struct InputEdge {
+    int64_t tUs;             // esp_timer_get_time()
+    uint8_t channel;
+    bool level;              // level after the edge
+};
+
+struct InputChannelStats {
+    bool level;
+    bool interrupt;          // captured from a GPIO interrupt rather than the scan
+    uint32_t pulses;         // rising edges since boot or the last reset
+    uint32_t bounces;        // edges dropped by the debounce
+    int64_t lastEdgeUs;
+    uint32_t periodUs;       // mean rising-edge period over the window, 0 when stalled
+    uint32_t freqMilliHz;
+};
+
+#if INPUT_CAPTURE_ENABLE
+
+// Attaches the GPIO interrupts; call once before the first scan
+bool input_capture_begin();
+
+// PLC scan: the eight expander inputs as bits (bit n = input n), read at tUs
+void input_capture_sample(uint8_t bits, int64_t tUs);
+
+bool input_capture_channel(uint8_t channel, InputChannelStats& out);
+// Frequency of channel in Hz; 0 when it stalled
+float input_capture_frequency(uint8_t channel);
+void input_capture_set_debounce(uint8_t channel, uint32_t us);
+void input_capture_reset_counts();
+
+// Copies up to max edges, oldest first, and removes them; lost counts ring overruns
+size_t input_capture_edges(InputEdge* out, size_t max, uint32_t* lost = nullptr);
+
+void input_capture_report(Print& out);
+
+#else
+
+inline bool input_capture_begin() { return false; }
+inline void input_capture_sample(uint8_t, int64_t) {}
+inline bool input_capture_channel(uint8_t, InputChannelStats&) { return false; }
+inline float input_capture_frequency(uint8_t) { return 0.0f; }
+inline void input_capture_set_debounce(uint8_t, uint32_t) {}
+inline void input_capture_reset_counts() {}
+inline size_t input_capture_edges(InputEdge*, size_t, uint32_t* lost = nullptr) {
+    if (lost) *lost = 0;
+    return 0;
+}
+inline void input_capture_report(Print&) {}
+
+#endif // INPUT_CAPTURE_ENABLE
+
+#endif // INPUT_CAPTURE_H
@@ -0,0 +1,379 @@
+/*
+ * Modbus RTU Master Implementation
+ */
+
+#include "modbus_master.h"
+
+uint16_t modbus_crc16(const uint8_t* p, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (uint8_t b = 0; b < 8; b++) crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+    }
+    return crc;
+}
+
+#if MODBUS_MASTER_ENABLE
+
+#include "rs485_adapter.h"
+#include "../modules/logging/log_buffer.h"
+#include <esp_timer.h>
+#include <string.h>
+
+namespace {
+constexpr uint32_t kIdleMs = 100;            // longest sleep with nothing due
+constexpr uint32_t kNoPortRetryMs = 5000;
+
+struct Point {
+    uint8_t request;
+    uint16_t first;
+    uint16_t count;
+};
+
+struct Request {
+    uint8_t slave;
+    uint8_t slaveRow;
+    ModbusFunction fn;
+    uint16_t first;
+    uint16_t count;
+    uint32_t periodMs;
+    uint32_t dueMs;
+    uint16_t offset;         // into s_pool
+    uint32_t readMs;         // millis() of the last good response
+    bool valid;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Point s_points[MODBUS_MAX_POINTS];           // under s_mux
+Request s_requests[MODBUS_MAX_REQUESTS];
+uint16_t s_pool[MODBUS_REGISTER_POOL];
+uint16_t s_pointCount = 0;
+uint8_t s_requestCount = 0;
+ModbusSlaveStats s_slaves[MODBUS_MAX_SLAVES];
+ModbusStats s_stats = {};
+uint32_t s_busyAccUs = 0;
+uint32_t s_busyWindowMs = 0;
+
+bool isBits(ModbusFunction fn) {
+    return fn == ModbusFunction::ReadCoils || fn == ModbusFunction::ReadDiscreteInputs;
+}
+
+uint16_t wordsFor(ModbusFunction fn, uint16_t count) {
+    return isBits(fn) ? (uint16_t)((count + 15) / 16) : count;
+}
+
+uint16_t limitFor(ModbusFunction fn) {
+    return isBits(fn) ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGS;
+}
+
+// Caller holds s_mux. Lays the requests out in the pool again; only a
+// request whose range changed loses its data.
+bool layoutPool() {
+    uint32_t offset = 0;
+    for (uint8_t i = 0; i < s_requestCount; i++) offset += wordsFor(s_requests[i].fn, s_requests[i].count);
+    if (offset > MODBUS_REGISTER_POOL) return false;
+    offset = 0;
+    for (uint8_t i = 0; i < s_requestCount; i++) {
+        Request& r = s_requests[i];
+        if (r.offset != offset) r.valid = false;
+        r.offset = (uint16_t)offset;
+        offset += wordsFor(r.fn, r.count);
+    }
+    return true;
+}
+
+// Caller holds s_mux
+int slaveRow(uint8_t address) {
+    for (uint8_t i = 0; i < MODBUS_MAX_SLAVES; i++) {
+        if (s_slaves[i].address == address) return i;
+    }
+    for (uint8_t i = 0; i < MODBUS_MAX_SLAVES; i++) {
+        if (!s_slaves[i].address) {
+            s_slaves[i] = ModbusSlaveStats{};
+            s_slaves[i].address = address;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The request to run next: the most overdue one, or -1 with waitMs until one is due
+int pickRequest(uint32_t now, uint32_t& waitMs) {
+    int best = -1;
+    int32_t bestLate = INT32_MIN;
+    waitMs = kIdleMs;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < s_requestCount; i++) {
+        const int32_t late = (int32_t)(now - s_requests[i].dueMs);
+        if (late >= 0 && late > bestLate) {
+            best = i;
+            bestLate = late;
+        } else if (late < 0 && (uint32_t)-late < waitMs) {
+            waitMs = (uint32_t)-late;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return best;
+}
+
+size_t buildRequest(const Request& r, uint8_t* frame) {
+    frame[0] = r.slave;
+    frame[1] = (uint8_t)r.fn;
+    frame[2] = (uint8_t)(r.first >> 8);
+    frame[3] = (uint8_t)r.first;
+    frame[4] = (uint8_t)(r.count >> 8);
+    frame[5] = (uint8_t)r.count;
+    const uint16_t crc = modbus_crc16(frame, 6);
+    frame[6] = (uint8_t)crc;
+    frame[7] = (uint8_t)(crc >> 8);
+    return 8;
+}
+
+enum class Outcome : uint8_t { Ok, Timeout, Corrupt, Exception };
+
+Outcome parseResponse(const Request& r, const uint8_t* f, size_t len, uint8_t& exception) {
+    if (len < 5 || modbus_crc16(f, len - 2) != (uint16_t)(f[len - 2] | (f[len - 1] << 8))) return Outcome::Corrupt;
+    if (f[0] != r.slave) return Outcome::Corrupt;
+    if (f[1] == ((uint8_t)r.fn | 0x80)) {
+        exception = f[2];
+        return Outcome::Exception;
+    }
+    const size_t dataBytes = isBits(r.fn) ? (r.count + 7) / 8 : (size_t)r.count * 2;
+    if (f[1] != (uint8_t)r.fn || f[2] != dataBytes || len != dataBytes + 5) return Outcome::Corrupt;
+    return Outcome::Ok;
+}
+
+// sent: the request as it went out; a point packed into it meanwhile widened it
+void publish(uint8_t index, const Request& sent, const uint8_t* data, uint32_t now) {
+    portENTER_CRITICAL(&s_mux);
+    Request& r = s_requests[index];
+    if (r.first != sent.first || r.count != sent.count) {
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    uint16_t* dst = &s_pool[r.offset];
+    if (isBits(r.fn)) {
+        const size_t bytes = (r.count + 7) / 8;
+        for (size_t i = 0; i < bytes; i += 2) {
+            dst[i / 2] = (uint16_t)(data[i] | (i + 1 < bytes ? data[i + 1] << 8 : 0));
+        }
+    } else {
+        for (uint16_t i = 0; i < r.count; i++) dst[i] = (uint16_t)((data[2 * i] << 8) | data[2 * i + 1]);
+    }
+    r.readMs = now;
+    r.valid = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void runRequest(uint8_t index) {
+    uint8_t frame[RS485_MAX_FRAME];
+    portENTER_CRITICAL(&s_mux);
+    Request r = s_requests[index];
+    portEXIT_CRITICAL(&s_mux);
+
+    const size_t txLen = buildRequest(r, frame);
+    rs485_port_flush_input();
+    const int64_t start = esp_timer_get_time();
+    size_t rxLen = 0;
+    Outcome outcome = Outcome::Timeout;
+    uint8_t exception = 0;
+    // The port hands over whole frames, so the wait covers the response's own length
+    const size_t expected = 5 + (isBits(r.fn) ? (r.count + 7) / 8 : (size_t)r.count * 2);
+    const uint32_t waitMs = MODBUS_TIMEOUT_MS + (uint32_t)(expected * 11000UL / RS485_BAUD) + 1;
+    if (rs485_port_send(frame, txLen) && rs485_port_receive(frame, sizeof(frame), rxLen, waitMs)) {
+        outcome = parseResponse(r, frame, rxLen, exception);
+    }
+    const uint32_t latencyUs = (uint32_t)(esp_timer_get_time() - start);
+    const uint32_t now = millis();
+    if (outcome == Outcome::Ok) publish(index, r, &frame[3], now);
+
+    portENTER_CRITICAL(&s_mux);
+    Request& live = s_requests[index];
+    // Next due one period on; a request that fell a full period behind restarts from now
+    live.dueMs += live.periodMs;
+    if ((int32_t)(now - live.dueMs) >= (int32_t)live.periodMs) {
+        live.dueMs = now + live.periodMs;
+        s_stats.late++;
+    }
+    ModbusSlaveStats& s = s_slaves[r.slaveRow];
+    s.requests++;
+    switch (outcome) {
+        case Outcome::Ok:
+            s.responses++;
+            s.lastLatencyUs = latencyUs;
+            if (latencyUs > s.maxLatencyUs) s.maxLatencyUs = latencyUs;
+            s.sumLatencyUs += latencyUs;
+            break;
+        case Outcome::Timeout: s.timeouts++; break;
+        case Outcome::Corrupt: s.crcErrors++; break;
+        case Outcome::Exception:
+            s.exceptions++;
+            s.lastException = exception;
+            break;
+    }
+    s_stats.transactions++;
+    s_busyAccUs += latencyUs;
+    if (now - s_busyWindowMs >= 1000) {
+        s_stats.busyUs = s_busyAccUs;
+        s_busyAccUs = 0;
+        s_busyWindowMs = now;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+} // namespace
+
+int modbus_add_point(uint8_t slave, ModbusFunction fn, uint16_t first, uint16_t count, uint32_t periodMs) {
+    if (!slave || slave > 247 || !count || count > limitFor(fn) || !periodMs || (uint32_t)first + count > 0x10000) {
+        return -1;
+    }
+    const uint32_t end = (uint32_t)first + count;
+    int handle = -1;
+    portENTER_CRITICAL(&s_mux);
+    const int row = slaveRow(slave);
+    if (row >= 0 && s_pointCount < MODBUS_MAX_POINTS) {
+        // Pack into a request of the same slave, function and period when close enough
+        int req = -1;
+        for (uint8_t i = 0; i < s_requestCount && req < 0; i++) {
+            Request& r = s_requests[i];
+            if (r.slave != slave || r.fn != fn || r.periodMs != periodMs) continue;
+            const uint32_t rEnd = (uint32_t)r.first + r.count;
+            const uint32_t lo = first < r.first ? first : r.first;
+            const uint32_t hi = end > rEnd ? end : rEnd;
+            if (first > rEnd + MODBUS_PACK_GAP || r.first > end + MODBUS_PACK_GAP || hi - lo > limitFor(fn)) continue;
+            const Request before = r;
+            r.first = (uint16_t)lo;
+            r.count = (uint16_t)(hi - lo);
+            if (!layoutPool()) {
+                r = before;
+                layoutPool();
+                continue;
+            }
+            if (r.first != before.first || r.count != before.count) r.valid = false;
+            req = i;
+        }
+        if (req < 0 && s_requestCount < MODBUS_MAX_REQUESTS) {
+            Request& r = s_requests[s_requestCount++];
+            r = Request{slave, (uint8_t)row, fn, first, count, periodMs, millis(), 0, 0, false};
+            if (layoutPool()) {
+                req = s_requestCount - 1;
+            } else {
+                s_requestCount--;
+            }
+        }
+        if (req >= 0) {
+            s_points[s_pointCount] = Point{(uint8_t)req, first, count};
+            handle = s_pointCount++;
+            s_stats.points = s_pointCount;
+            s_stats.requests = s_requestCount;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return handle;
+}
+
+bool modbus_read_point(int point, uint16_t* out, size_t maxWords, uint32_t* ageMs) {
+    if (point < 0 || !out) return false;
+    bool ok = false;
+    portENTER_CRITICAL(&s_mux);
+    if (point < s_pointCount) {
+        const Point& p = s_points[point];
+        const Request& r = s_requests[p.request];
+        const uint16_t skip = p.first - r.first;
+        ok = r.valid && maxWords >= wordsFor(r.fn, p.count);
+        if (ok && isBits(r.fn)) {
+            memset(out, 0, wordsFor(r.fn, p.count) * sizeof(uint16_t));
+            for (uint16_t i = 0; i < p.count; i++) {
+                const uint16_t bit = skip + i;
+                if (s_pool[r.offset + bit / 16] & (1u << (bit % 16))) out[i / 16] |= (uint16_t)(1u << (i % 16));
+            }
+        } else if (ok) {
+            memcpy(out, &s_pool[r.offset + skip], p.count * sizeof(uint16_t));
+        }
+        if (ok && ageMs) *ageMs = millis() - r.readMs;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+bool modbus_slave_stats(uint8_t slave, ModbusSlaveStats& out) {
+    bool ok = false;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < MODBUS_MAX_SLAVES && !ok; i++) {
+        if (s_slaves[i].address == slave) {
+            out = s_slaves[i];
+            ok = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+void modbus_stats(ModbusStats& out) {
+    portENTER_CRITICAL(&s_mux);
+    out = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void modbus_report(Print& out) {
+    ModbusStats s;
+    modbus_stats(s);
+    if (!s.points) return;
+    Rs485PortStats port;
+    rs485_port_stats(port);
+    out.printf("Modbus: %u points in %u requests, %lu transactions, %lu late, bus %lu%% busy at %lu baud\n",
+               (unsigned)s.points, (unsigned)s.requests, (unsigned long)s.transactions, (unsigned long)s.late,
+               (unsigned long)(s.busyUs / 10000), (unsigned long)port.baud);
+    out.printf("  port: %lu frames in, %lu cut, %lu dropped, %lu line errors\n", (unsigned long)port.framesRx,
+               (unsigned long)port.overflows, (unsigned long)port.dropped, (unsigned long)port.lineErrors);
+    for (uint8_t i = 0; i < MODBUS_MAX_SLAVES; i++) {
+        ModbusSlaveStats sl;
+        portENTER_CRITICAL(&s_mux);
+        sl = s_slaves[i];
+        portEXIT_CRITICAL(&s_mux);
+        if (!sl.address) continue;
+        out.printf("  slave %3u: %lu req, %lu ok, %lu timeout, %lu crc, %lu exc (last %u), latency %lu us "
+                   "(mean %lu, max %lu)\n",
+                   (unsigned)sl.address, (unsigned long)sl.requests, (unsigned long)sl.responses,
+                   (unsigned long)sl.timeouts, (unsigned long)sl.crcErrors, (unsigned long)sl.exceptions,
+                   (unsigned)sl.lastException, (unsigned long)sl.lastLatencyUs,
+                   (unsigned long)(sl.responses ? sl.sumLatencyUs / sl.responses : 0),
+                   (unsigned long)sl.maxLatencyUs);
+    }
+}
+
+extern "C" void vTaskModbus(void* pvParameters) {
+    (void)pvParameters;
+#define MODBUS_ADD_BOOT_POINT(slave, fn, first, count, period) \
+    modbus_add_point(slave, ModbusFunction(fn), first, count, period);
+    MODBUS_POLL_TABLE(MODBUS_ADD_BOOT_POINT)
+#undef MODBUS_ADD_BOOT_POINT
+
+    for (;;) {
+        portENTER_CRITICAL(&s_mux);
+        const bool anyPoints = s_requestCount != 0;
+        portEXIT_CRITICAL(&s_mux);
+        if (!anyPoints) {
+            vTaskDelay(pdMS_TO_TICKS(kIdleMs * 5));
+            continue;
+        }
+        if (!rs485_port_ready()) {
+            if (!rs485_port_begin(RS485_BAUD)) {
+                logbuf_printf("Modbus: RS485 port failed to open, retrying");
+                vTaskDelay(pdMS_TO_TICKS(kNoPortRetryMs));
+                continue;
+            }
+            logbuf_printf("Modbus: RS485 at %lu baud, frame gap %lu us", (unsigned long)RS485_BAUD,
+                          (unsigned long)rs485_frame_gap_us());
+        }
+
+        uint32_t waitMs = 0;
+        const int next = pickRequest(millis(), waitMs);
+        if (next < 0) {
+            vTaskDelay(pdMS_TO_TICKS(waitMs) ? pdMS_TO_TICKS(waitMs) : 1);
+            continue;
+        }
+        runRequest((uint8_t)next);
+    }
+}
+
+#endif // MODBUS_MASTER_ENABLE
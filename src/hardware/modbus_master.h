@@ -0,0 +1,112 @@
+/*
+ * Modbus RTU Master
+ * Polls genset controllers on the RS485 port (hardware/rs485_adapter.h):
+ *   - a poll table of points (slave, function, first register, count,
+ *     period). Points of one slave and function with the same period are
+ *     packed into one request when they are at most MODBUS_PACK_GAP registers
+ *     apart and the request stays within the function's limit, so a
+ *     controller map of scattered registers costs a few long reads.
+ *   - the Modbus task runs the most overdue request next, chosen and built
+ *     as soon as the previous response is complete; with work due the bus
+ *     only idles for the 3.5 character frame gap. A point is never polled
+ *     faster than its period.
+ *   - each response is checked (address, function, length, CRC, exception)
+ *     and its registers are published with their time; readers copy them
+ *     without touching the bus
+ *   - per slave: requests, responses, timeouts, CRC errors, exceptions and
+ *     response latency (last, mean, max)
+ *
+ * Points come from MODBUS_POLL_TABLE at boot and modbus_add_point() later;
+ * the port opens with the first point.
+ */
+
+#ifndef MODBUS_MASTER_H
+#define MODBUS_MASTER_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef MODBUS_MAX_POINTS
+#define MODBUS_MAX_POINTS 32
+#endif
+#ifndef MODBUS_MAX_REQUESTS
+#define MODBUS_MAX_REQUESTS 16
+#endif
+#ifndef MODBUS_MAX_SLAVES
+#define MODBUS_MAX_SLAVES 8
+#endif
+#ifndef MODBUS_REGISTER_POOL
+#define MODBUS_REGISTER_POOL 512           // registers (or 16-bit bit groups) of all requests
+#endif
+#ifndef MODBUS_TIMEOUT_MS
+#define MODBUS_TIMEOUT_MS 100              // response turnaround, on top of its transfer time
+#endif
+#ifndef MODBUS_PACK_GAP
+#define MODBUS_PACK_GAP 8                  // unused registers a packed request may read
+#endif
+#define MODBUS_MAX_READ_REGS 125
+#define MODBUS_MAX_READ_BITS 2000
+
+// Boot poll table:  X(slave, function, first register, count, period ms)
+#ifndef MODBUS_POLL_TABLE
+#define MODBUS_POLL_TABLE(X)
+#endif
+
+enum class ModbusFunction : uint8_t {
+    ReadCoils = 1,
+    ReadDiscreteInputs = 2,
+    ReadHoldingRegisters = 3,
+    ReadInputRegisters = 4
+};
+
+struct ModbusSlaveStats {
+    uint8_t address;         // 0 = unused row
+    uint32_t requests;
+    uint32_t responses;
+    uint32_t timeouts;
+    uint32_t crcErrors;      // and malformed frames
+    uint32_t exceptions;
+    uint8_t lastException;
+    uint32_t lastLatencyUs;  // request sent to response complete
+    uint32_t maxLatencyUs;
+    uint64_t sumLatencyUs;
+};
+
+struct ModbusStats {
+    uint16_t points;
+    uint16_t requests;
+    uint32_t transactions;
+    uint32_t late;           // requests started more than one period after due
+    uint32_t busyUs;         // bus time of the last second, request to response
+};
+
+// CRC-16/MODBUS of an RTU frame, also used by the slave (modbus_slave.h)
+uint16_t modbus_crc16(const uint8_t* p, size_t len);
+
+#if MODBUS_MASTER_ENABLE
+
+extern "C" void vTaskModbus(void* pvParameters);
+
+// Adds a point before or while the task runs; returns its handle, -1 when
+// the tables are full or the point is invalid
+int modbus_add_point(uint8_t slave, ModbusFunction fn, uint16_t first, uint16_t count, uint32_t periodMs);
+
+// Copies a point's registers (or bits, 16 per word, LSB first); ageMs is
+// the time since they were read. False before the first good response.
+bool modbus_read_point(int point, uint16_t* out, size_t maxWords, uint32_t* ageMs = nullptr);
+
+bool modbus_slave_stats(uint8_t slave, ModbusSlaveStats& out);
+void modbus_stats(ModbusStats& out);
+void modbus_report(Print& out);
+
+#else
+
+inline int modbus_add_point(uint8_t, ModbusFunction, uint16_t, uint16_t, uint32_t) { return -1; }
+inline bool modbus_read_point(int, uint16_t*, size_t, uint32_t* = nullptr) { return false; }
+inline bool modbus_slave_stats(uint8_t, ModbusSlaveStats&) { return false; }
+inline void modbus_stats(ModbusStats& out) { out = ModbusStats{}; }
+inline void modbus_report(Print&) {}
+
+#endif // MODBUS_MASTER_ENABLE
+
+#endif // MODBUS_MASTER_H
@@ -0,0 +1,348 @@
+/*
+ * Modbus Slave Implementation
+ */
+
+#include "modbus_slave.h"
+
+#if MODBUS_SLAVE_ENABLE
+
+#include "modbus_master.h"
+#include "rs485_adapter.h"
+#include "generator_calibration.h"
+#include "generator_derived.h"
+#include "input_capture.h"
+#include "sensor_acquisition.h"
+#include "../system/kernel_objects.h"
+#include "../system/service_task.h"
+#include "../modules/logging/log_buffer.h"
+#include "../modules/settings/hour_meter.h"
+#include "../modules/pwrcan/can_generator_protocol.h"
+#include <esp_timer.h>
+#include <string.h>
+
+#if ENABLE_PWRCAN
+#include "../modules/pwrcan/pwrcan_module.h"
+extern PWRCANModule* pwrcanModule;
+#endif
+
+#if MODBUS_SLAVE_TCP_PORT && __has_include(<WiFi.h>)
+#include <WiFi.h>
+#define MODBUS_SLAVE_TCP 1
+#else
+#define MODBUS_SLAVE_TCP 0
+#endif
+
+extern BasicStampPLC* stampPLC;
+
+namespace {
+constexpr size_t kRegisters = (size_t)ModbusSlaveRegister::Count;
+constexpr uint16_t kDigitalInputs = 8;
+constexpr uint16_t kRelays = 2;
+constexpr uint32_t kGenStaleMs = 10000;
+constexpr size_t kMbapBytes = 7;
+
+enum : uint8_t {
+    kExIllegalFunction = 1,
+    kExIllegalAddress = 2,
+    kExIllegalValue = 3,
+};
+
+// Snapshots a register can come from, bit per source
+enum : uint8_t {
+    Io = 1u << 0,
+    Gen = 1u << 1,
+    Sensors = 1u << 2,
+    Rpm = 1u << 3,
+    Hours = 1u << 4,
+    Derived = 1u << 5,
+    All = 0x3F,
+};
+
+// What one request reads; only the sources its registers need are filled
+struct ModbusSlaveView {
+    uint32_t now;
+    bool ioOk;
+    bool genOk;
+    bool rpmOk;
+    PlcIoSnapshot io;
+    CanGeneratorSnapshot gen;
+    PlcSensorSnapshot sensors;
+    uint32_t rpm;
+    uint32_t hours[(size_t)HourCounter::Count];
+    GeneratorDerived derived;
+};
+
+const uint8_t kSources[kRegisters] = {
+#define MODBUS_SLAVE_SOURCE(id, source, value) source,
+    MODBUS_SLAVE_REGISTERS(MODBUS_SLAVE_SOURCE)
+#undef MODBUS_SLAVE_SOURCE
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+ModbusSlaveCounters s_stats = {};               // under s_mux
+bool s_started = false;
+
+void count(uint32_t ModbusSlaveCounters::*field) {
+    portENTER_CRITICAL(&s_mux);
+    s_stats.*field += 1;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+uint16_t bits(const bool* b, uint8_t n) {
+    uint16_t v = 0;
+    for (uint8_t i = 0; i < n; i++) v |= b[i] ? (uint16_t)(1u << i) : 0;
+    return v;
+}
+
+uint16_t clamp16(float v) {
+    return v <= 0.0f ? 0 : v >= 65535.0f ? 0xFFFF : (uint16_t)(v + 0.5f);
+}
+
+uint16_t clamp16(uint32_t v) {
+    return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+}
+
+uint16_t signed16(float v) {
+    const float r = v < -32768.0f ? -32768.0f : v > 32767.0f ? 32767.0f : v;
+    return (uint16_t)(int16_t)(r < 0 ? r - 0.5f : r + 0.5f);
+}
+
+uint16_t ageS(uint32_t ms, uint32_t now) {
+    return ms ? clamp16((now - ms) / 1000) : MODBUS_SLAVE_STALE_S;
+}
+
+uint16_t level(const ModbusSlaveView& v, GenSensor s, uint16_t raw) {
+    return v.genOk ? generator_calibrate(s, raw) : 0;
+}
+
+uint16_t life(const ModbusSlaveView& v, GenSensor s, uint16_t raw) {
+    return v.genOk ? (uint16_t)(100 - generator_calibrate(s, raw)) : 0;
+}
+
+uint16_t fuelBurn(const GeneratorDerived& d) {
+    return d.fuelValid ? signed16(d.burnPctPerHour * 100.0f) : 0;
+}
+
+uint16_t fuelEmpty(const GeneratorDerived& d) {
+    const float h = d.fuelValid ? d.hoursToEmpty : -1.0f;
+    return h < 0.0f ? MODBUS_SLAVE_STALE_S : h * 10.0f >= 65534.0f ? 65534 : (uint16_t)(h * 10.0f + 0.5f);
+}
+
+uint16_t serviceHours(const GeneratorDerived& d) {
+    if (!d.serviceValid) return 0;
+    const int32_t h = d.service[d.nextService].remainingS / 3600;
+    return (uint16_t)(int16_t)(h < -32768 ? -32768 : h > 32767 ? 32767 : h);
+}
+
+uint16_t serviceDays(const GeneratorDerived& d) {
+    const float days = d.serviceValid ? d.service[d.nextService].daysToDue : -1.0f;
+    return days < 0.0f ? MODBUS_SLAVE_STALE_S : days >= 65534.0f ? 65534 : (uint16_t)(days + 0.5f);
+}
+
+uint16_t validBits(const ModbusSlaveView& v) {
+    return (v.ioOk ? 1u : 0u) | (v.genOk ? 2u : 0u) | (v.sensors.powerOk ? 4u : 0u) |
+           (v.sensors.tempOk ? 8u : 0u) | (v.rpmOk ? 16u : 0u) | (v.derived.fuelValid ? 32u : 0u);
+}
+
+void fill(ModbusSlaveView& v, uint8_t sources) {
+    memset(&v, 0, sizeof(v));
+    v.now = millis();
+    if ((sources & Io) && stampPLC) {
+        v.io = stampPLC->getIoSnapshot();
+        v.ioOk = v.io.updatedMs != 0;
+    }
+#if ENABLE_PWRCAN
+    if ((sources & Gen) && pwrcanModule && pwrcanModule->isStarted()) {
+        v.gen = pwrcanModule->getGeneratorProtocol().snapshot();
+        v.genOk = v.gen.sensorsMs && v.now - v.gen.sensorsMs < kGenStaleMs;
+    }
+#endif
+    if (sources & Sensors) v.sensors = sensor_acq_snapshot();
+#if GENERATOR_RPM_INPUT >= 0
+    InputChannelStats ch;
+    if ((sources & Rpm) && input_capture_channel(GENERATOR_RPM_INPUT, ch)) {
+        v.rpm = (uint32_t)((uint64_t)ch.freqMilliHz * 60 / 1000 / GENERATOR_RPM_PULSES_PER_REV);
+        v.rpmOk = true;
+    }
+#endif
+    if (sources & Hours) {
+        for (size_t i = 0; i < (size_t)HourCounter::Count; i++) v.hours[i] = hour_meter_hours((HourCounter)i);
+    }
+    // Memoized: a copy unless a sample or counter moved since the last read
+    if (sources & Derived) generator_derived_get(v.derived);
+}
+
+uint16_t registerValue(const ModbusSlaveView& v, size_t index) {
+    switch ((ModbusSlaveRegister)index) {
+#define MODBUS_SLAVE_VALUE(id, source, value) \
+        case ModbusSlaveRegister::id: return (uint16_t)(value);
+        MODBUS_SLAVE_REGISTERS(MODBUS_SLAVE_VALUE)
+#undef MODBUS_SLAVE_VALUE
+        default: return 0;
+    }
+}
+
+size_t exception(uint8_t fc, uint8_t code, uint8_t* out) {
+    count(&ModbusSlaveCounters::exceptions);
+    out[0] = fc | 0x80;
+    out[1] = code;
+    return 2;
+}
+
+size_t readBits(uint8_t fc, uint16_t first, uint16_t n, uint8_t* out) {
+    const uint16_t size = fc == 1 ? kRelays : kDigitalInputs;
+    if (!n || n > MODBUS_MAX_READ_BITS) return exception(fc, kExIllegalValue, out);
+    if ((uint32_t)first + n > size) return exception(fc, kExIllegalAddress, out);
+    ModbusSlaveView v;
+    fill(v, Io);
+    const uint16_t all = fc == 1 ? bits(v.io.relayOutputs, kRelays) : bits(v.io.digitalInputs, kDigitalInputs);
+    const uint16_t value = (uint16_t)(all >> first) & (uint16_t)((1u << n) - 1);
+    const uint8_t bytes = (uint8_t)((n + 7) / 8);
+    out[0] = fc;
+    out[1] = bytes;
+    out[2] = (uint8_t)value;
+    if (bytes > 1) out[3] = (uint8_t)(value >> 8);
+    return 2 + bytes;
+}
+
+size_t readRegisters(uint8_t fc, uint16_t first, uint16_t n, uint8_t* out) {
+    if (!n || n > MODBUS_MAX_READ_REGS) return exception(fc, kExIllegalValue, out);
+    if ((uint32_t)first + n > kRegisters) return exception(fc, kExIllegalAddress, out);
+    uint8_t sources = 0;
+    for (uint16_t i = 0; i < n; i++) sources |= kSources[first + i];
+    ModbusSlaveView v;
+    fill(v, sources);
+    out[0] = fc;
+    out[1] = (uint8_t)(n * 2);
+    for (uint16_t i = 0; i < n; i++) {
+        const uint16_t r = registerValue(v, first + i);
+        out[2 + 2 * i] = (uint8_t)(r >> 8);
+        out[3 + 2 * i] = (uint8_t)r;
+    }
+    return 2 + 2 * n;
+}
+
+#if MODBUS_SLAVE_ADDRESS
+void rtuTask(void*) {
+    if (!rs485_port_begin(RS485_BAUD)) {
+        logbuf_printf("ModbusSlave: RS485 port failed to open");
+        vTaskDelete(nullptr);
+        return;
+    }
+    logbuf_printf("ModbusSlave: unit %u on RS485 at %lu baud", (unsigned)MODBUS_SLAVE_ADDRESS,
+                  (unsigned long)RS485_BAUD);
+    uint8_t req[RS485_MAX_FRAME];
+    uint8_t resp[RS485_MAX_FRAME];
+    for (;;) {
+        size_t len = 0;
+        if (!rs485_port_receive(req, sizeof(req), len, 1000)) continue;
+        const int64_t start = esp_timer_get_time();
+        // Broadcasts carry only writes, which this map does not take
+        if (len < 4 || req[0] != MODBUS_SLAVE_ADDRESS ||
+            modbus_crc16(req, len - 2) != (uint16_t)(req[len - 2] | (req[len - 1] << 8))) {
+            count(&ModbusSlaveCounters::ignored);
+            continue;
+        }
+        count(&ModbusSlaveCounters::rtuRequests);
+        resp[0] = MODBUS_SLAVE_ADDRESS;
+        size_t n = 1 + modbus_slave_serve(req + 1, len - 3, resp + 1);
+        const uint16_t crc = modbus_crc16(resp, n);
+        resp[n++] = (uint8_t)crc;
+        resp[n++] = (uint8_t)(crc >> 8);
+        const uint32_t serviceUs = (uint32_t)(esp_timer_get_time() - start);
+        rs485_port_send(resp, n);
+        portENTER_CRITICAL(&s_mux);
+        s_stats.lastServiceUs = serviceUs;
+        if (serviceUs > s_stats.maxServiceUs) s_stats.maxServiceUs = serviceUs;
+        portEXIT_CRITICAL(&s_mux);
+    }
+}
+#endif
+
+#if MODBUS_SLAVE_TCP
+WiFiServer* s_server = nullptr;
+WiFiClient s_client;
+
+// One client at a time; each call answers the requests already received
+void tcpJob(void*) {
+    if (WiFi.status() != WL_CONNECTED) {
+        if (s_client) s_client.stop();
+        return;
+    }
+    if (!s_server) {
+        s_server = new WiFiServer(MODBUS_SLAVE_TCP_PORT);
+        s_server->begin();
+        s_server->setNoDelay(true);
+        logbuf_printf("ModbusSlave: TCP on port %u", (unsigned)MODBUS_SLAVE_TCP_PORT);
+    }
+    if (!s_client || !s_client.connected()) {
+        WiFiClient next = s_server->available();
+        if (!next) return;
+        s_client = next;
+        count(&ModbusSlaveCounters::tcpClients);
+    }
+    uint8_t req[kMbapBytes + 253];
+    uint8_t resp[kMbapBytes + 253];
+    while (s_client.available() >= (int)kMbapBytes) {
+        if (s_client.read(req, kMbapBytes) != (int)kMbapBytes) break;
+        const uint16_t length = (uint16_t)((req[4] << 8) | req[5]);
+        // MBAP length counts the unit id and the PDU
+        if (req[2] || req[3] || length < 2 || length > 254 ||
+            s_client.read(req + kMbapBytes, length - 1) != length - 1) {
+            count(&ModbusSlaveCounters::ignored);
+            s_client.stop();
+            return;
+        }
+        count(&ModbusSlaveCounters::tcpRequests);
+        const size_t n = modbus_slave_serve(req + kMbapBytes, length - 1, resp + kMbapBytes);
+        memcpy(resp, req, 4);
+        resp[4] = (uint8_t)((n + 1) >> 8);
+        resp[5] = (uint8_t)(n + 1);
+        resp[6] = req[6];
+        s_client.write(resp, kMbapBytes + n);
+    }
+}
+#endif
+} // namespace
+
+size_t modbus_slave_serve(const uint8_t* pdu, size_t len, uint8_t* out) {
+    if (!len) return exception(0, kExIllegalFunction, out);
+    const uint8_t fc = pdu[0];
+    if (fc < 1 || fc > 4) return exception(fc, kExIllegalFunction, out);
+    if (len != 5) return exception(fc, kExIllegalValue, out);
+    const uint16_t first = (uint16_t)((pdu[1] << 8) | pdu[2]);
+    const uint16_t n = (uint16_t)((pdu[3] << 8) | pdu[4]);
+    return fc <= 2 ? readBits(fc, first, n, out) : readRegisters(fc, first, n, out);
+}
+
+bool modbus_slave_begin() {
+    if (s_started) return true;
+    bool ok = true;
+#if MODBUS_SLAVE_ADDRESS
+    ok = kernel_task_create(KernelTask::Modbus, rtuTask, nullptr, TASK_PRIORITY_MODBUS, nullptr, 1) == pdPASS;
+#endif
+#if MODBUS_SLAVE_TCP
+    ok = service_job_add("ModbusTcp", tcpJob, nullptr, MODBUS_SLAVE_TCP_PERIOD_MS, 2000) != SERVICE_JOB_NONE && ok;
+#endif
+    s_started = true;
+    return ok;
+}
+
+void modbus_slave_counters(ModbusSlaveCounters& out) {
+    portENTER_CRITICAL(&s_mux);
+    out = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void modbus_slave_report(Print& out) {
+    if (!s_started) return;
+    ModbusSlaveCounters s;
+    modbus_slave_counters(s);
+    out.printf("Modbus slave: unit %u, %lu RTU + %lu TCP requests, %lu exceptions, %lu ignored, "
+               "%lu TCP clients, service %lu us (max %lu)\n",
+               (unsigned)MODBUS_SLAVE_ADDRESS, (unsigned long)s.rtuRequests, (unsigned long)s.tcpRequests,
+               (unsigned long)s.exceptions, (unsigned long)s.ignored, (unsigned long)s.tcpClients,
+               (unsigned long)s.lastServiceUs, (unsigned long)s.maxServiceUs);
+}
+
+#endif // MODBUS_SLAVE_ENABLE
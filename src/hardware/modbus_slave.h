@@ -0,0 +1,119 @@
+/*
+ * Modbus Slave
+ * Lets SCADA poll the StampPLC itself, over RS485 (RTU) and optionally TCP:
+ *   - coils are the relays, discrete inputs the digital inputs
+ *   - holding and input registers are one read-only map (MODBUS_SLAVE_REGISTERS)
+ *     onto the published snapshots: PLC I/O, generator CAN sensors (calibrated),
+ *     INA226/LM75B readings, engine speed, the hour meter and the derived
+ *     fuel and service figures (generator_derived.h)
+ *   - a request reads only the snapshots its registers come from, through their
+ *     seqlocks, and encodes the registers straight into the response frame;
+ *     there is no register image to keep up to date and no lock a busy modem
+ *     or CAN task could hold
+ *   - the RTU side answers from the Modbus task on the application core,
+ *     right after the request's frame gap
+ *
+ * With MODBUS_SLAVE_ADDRESS set the RS485 port belongs to the slave and the
+ * master (modbus_master.h) is not started; one bus has one role. Modbus TCP
+ * serves the same map on MODBUS_SLAVE_TCP_PORT while WiFi is connected.
+ *
+ * Register map (address = row, 16 bit each, levels in %, hours whole):
+ *    0 digital inputs, bit per input     11 engine rpm
+ *    1 relays, bit per relay             12 bus voltage mV
+ *    2-5 analog inputs 0-3 raw           13 bus current mA (signed)
+ *    6 I/O scan age s                    14 board temperature 0.1 C (signed)
+ *    7 fuel level                        15-16 run hours (high, low word)
+ *    8 oil level                         17 hours since fuel filter service
+ *    9 fuel filter life                  18 hours since oil filter service
+ *   10 oil filter life                   19 hours since oil change
+ *                                        20 generator CAN data age s
+ *                                        21 valid bits: I/O, CAN, power, temperature, rpm,
+ *                                           fuel rate
+ *   22 fuel burn 0.01 %/run h (signed)   24 run h to the next service (signed)
+ *   23 run time to empty 0.1 h           25 days to the next service
+ * Registers 23 and 25 read MODBUS_SLAVE_STALE_S while unknown.
+ */
+
+#ifndef MODBUS_SLAVE_H
+#define MODBUS_SLAVE_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef MODBUS_SLAVE_ADDRESS
+#define MODBUS_SLAVE_ADDRESS 0             // RTU unit address 1-247, 0 = no RTU slave
+#endif
+#ifndef MODBUS_SLAVE_TCP_PORT
+#define MODBUS_SLAVE_TCP_PORT 502          // 0 = no Modbus TCP
+#endif
+#define MODBUS_SLAVE_TCP_PERIOD_MS 20
+#define MODBUS_SLAVE_STALE_S 0xFFFF        // age registers without data
+
+//   X(id, source snapshot, value from the view v)
+#define MODBUS_SLAVE_REGISTERS(X)                                                                \
+    X(DigitalInputs,   Io,      bits(v.io.digitalInputs, 8))                                     \
+    X(Relays,          Io,      bits(v.io.relayOutputs, 2))                                      \
+    X(Analog0,         Io,      v.io.analogInputs[0])                                            \
+    X(Analog1,         Io,      v.io.analogInputs[1])                                            \
+    X(Analog2,         Io,      v.io.analogInputs[2])                                            \
+    X(Analog3,         Io,      v.io.analogInputs[3])                                            \
+    X(IoAge,           Io,      ageS(v.io.updatedMs, v.now))                                     \
+    X(FuelLevel,       Gen,     level(v, GenSensor::FuelLevel, v.gen.sensors.fuelLevel))         \
+    X(OilLevel,        Gen,     level(v, GenSensor::OilLevel, v.gen.sensors.oilLevel))           \
+    X(FuelFilterLife,  Gen,     life(v, GenSensor::FuelFilter, v.gen.sensors.fuelFilter))        \
+    X(OilFilterLife,   Gen,     life(v, GenSensor::OilFilter, v.gen.sensors.oilFilter))          \
+    X(EngineRpm,       Rpm,     clamp16(v.rpm))                                                  \
+    X(BusMilliVolts,   Sensors, v.sensors.powerOk ? clamp16(v.sensors.busVoltage * 1000.0f) : 0) \
+    X(BusMilliAmps,    Sensors, v.sensors.powerOk ? signed16(v.sensors.current * 1000.0f) : 0)   \
+    X(Temperature,     Sensors, v.sensors.tempOk ? signed16(v.sensors.temperature * 10.0f) : 0)  \
+    X(RunHoursHigh,    Hours,   (uint16_t)(v.hours[0] >> 16))                                    \
+    X(RunHoursLow,     Hours,   (uint16_t)v.hours[0])                                            \
+    X(FuelFilterHours, Hours,   clamp16(v.hours[1]))                                             \
+    X(OilFilterHours,  Hours,   clamp16(v.hours[2]))                                             \
+    X(OilChangeHours,  Hours,   clamp16(v.hours[3]))                                             \
+    X(GenAge,          Gen,     ageS(v.gen.sensorsMs, v.now))                                    \
+    X(Valid,           All,     validBits(v))                                                    \
+    X(FuelBurn,        Derived, fuelBurn(v.derived))                                             \
+    X(FuelEmpty,       Derived, fuelEmpty(v.derived))                                            \
+    X(ServiceHours,    Derived, serviceHours(v.derived))                                         \
+    X(ServiceDays,     Derived, serviceDays(v.derived))
+
+enum class ModbusSlaveRegister : uint16_t {
+#define MODBUS_SLAVE_REGISTER_ID(id, source, value) id,
+    MODBUS_SLAVE_REGISTERS(MODBUS_SLAVE_REGISTER_ID)
+#undef MODBUS_SLAVE_REGISTER_ID
+    Count
+};
+
+struct ModbusSlaveCounters {
+    uint32_t rtuRequests;    // addressed to us, CRC good
+    uint32_t tcpRequests;
+    uint32_t exceptions;
+    uint32_t ignored;        // bad CRC, other addresses, broadcasts
+    uint32_t tcpClients;     // connections accepted
+    uint32_t lastServiceUs;  // RTU request received to response ready to send
+    uint32_t maxServiceUs;
+};
+
+#if MODBUS_SLAVE_ENABLE
+
+// Starts the RTU slave task (MODBUS_SLAVE_ADDRESS) and the TCP job; call once from setup()
+bool modbus_slave_begin();
+
+// Serves one request PDU (function code first) into out, which holds at least
+// 253 bytes; returns the response PDU length, an exception response included
+size_t modbus_slave_serve(const uint8_t* pdu, size_t len, uint8_t* out);
+
+void modbus_slave_counters(ModbusSlaveCounters& out);
+void modbus_slave_report(Print& out);
+
+#else
+
+inline bool modbus_slave_begin() { return false; }
+inline size_t modbus_slave_serve(const uint8_t*, size_t, uint8_t*) { return 0; }
+inline void modbus_slave_counters(ModbusSlaveCounters& out) { out = ModbusSlaveCounters{}; }
+inline void modbus_slave_report(Print&) {}
+
+#endif // MODBUS_SLAVE_ENABLE
+
+#endif // MODBUS_SLAVE_H
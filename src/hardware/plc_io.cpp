@@ -0,0 +1,35 @@
+#include "plc_io.h"
+
+uint8_t PlcIoImage::readInputs() {
+    if (!dev_) return 0;
+    stats_.inputReads++;
+#if PLC_IO_BULK_ENABLE
+    return static_cast<uint8_t>(dev_->readPlcAllInput());
+#else
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < PLC_INPUT_COUNT; i++) {
+        if (dev_->readPlcInput(i)) bits |= 1 << i;
+    }
+    return bits;
+#endif
+}
+
+bool PlcIoImage::writeRelays(uint8_t image) {
+    if (!dev_) return false;
+    if (valid_ && image == relays_) {
+        stats_.relaySkips++;
+        return false;
+    }
+    stats_.relayWrites++;
+#if PLC_IO_BULK_ENABLE
+    dev_->writePlcAllRelay(image);
+#else
+    for (uint8_t i = 0; i < PLC_RELAY_COUNT; i++) {
+        const uint8_t bit = 1 << i;
+        if (!valid_ || ((image ^ relays_) & bit)) dev_->writePlcRelay(i, (image & bit) != 0);
+    }
+#endif
+    relays_ = image;
+    valid_ = true;
+    return true;
+}
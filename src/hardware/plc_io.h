@@ -0,0 +1,47 @@
+/*
+ * PLC I/O Expander Image
+ * The eight inputs and the relays as bytes, bit n = channel n. Inputs are read
+ * in one expander transaction and relays written in one, and only when the
+ * output image differs from what the expander last took, so a scan costs two
+ * I2C transactions at most instead of one per channel. With PLC_IO_BULK_ENABLE
+ * off the image falls back to the per-channel calls (changed relays only).
+ * Not locked: callers hold their own I/O mutex.
+ */
+
+#ifndef PLC_IO_H
+#define PLC_IO_H
+
+#include <Arduino.h>
+#include <M5StamPLC.h>
+#include "../config/system_config.h"
+
+struct PlcIoStats {
+    uint32_t inputReads;         // expander input transactions
+    uint32_t relayWrites;        // expander relay transactions
+    uint32_t relaySkips;         // output phases with nothing changed
+};
+
+class PlcIoImage {
+public:
+    PlcIoImage() : dev_(nullptr), relays_(0), valid_(false), stats_{} {}
+
+    void attach(m5::M5_STAMPLC* dev) {
+        dev_ = dev;
+        valid_ = false;
+    }
+    uint8_t readInputs();
+    // Writes image when it differs from the last write; true if it wrote
+    bool writeRelays(uint8_t image);
+    // The expander lost its state (reset, bus error): the next write goes out
+    void invalidate() { valid_ = false; }
+    uint8_t relays() const { return relays_; }
+    const PlcIoStats& stats() const { return stats_; }
+
+private:
+    m5::M5_STAMPLC* dev_;
+    uint8_t relays_;             // as last written
+    bool valid_;
+    PlcIoStats stats_;
+};
+
+#endif // PLC_IO_H
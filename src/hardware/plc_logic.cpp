@@ -0,0 +1,676 @@
+/*
+ * PLC Logic Engine Implementation
+ */
+
+#include "plc_logic.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+enum Op : uint8_t {
+    OP_END = 0x00,
+    OP_LD, OP_LDN, OP_AND, OP_ANDN, OP_OR, OP_ORN, OP_XOR,
+    OP_NOT,
+    OP_ST, OP_STN, OP_SET, OP_RST,
+    OP_PUSH_AND, OP_PUSH_OR, OP_POP,
+    OP_TON,                  // timer, preset ms (u32)
+    OP_EDGE,                 // marker bit holding the previous RLO
+    OP_LDV,                  // value source
+    OP_GT, OP_LT, OP_GE, OP_LE, OP_EQ, OP_NE,   // i32
+    OP_JMPC, OP_JMPCN,       // u16 forward distance from the next instruction
+    OP_COUNT
+};
+
+// Bit operand: area in the top 3 bits, index in the low 5
+enum Area : uint8_t { AREA_I, AREA_Q, AREA_M, AREA_T, AREA_A, AREA_S, AREA_COUNT };
+constexpr uint8_t kAreaSize[AREA_COUNT] = {8, 2, 32, PLC_LOGIC_TIMERS, PLC_LOGIC_ALARMS, 4};
+constexpr char kAreaName[AREA_COUNT] = {'I', 'Q', 'M', 'T', 'A', 'S'};
+
+// Value sources of LDV
+enum Value : uint8_t { VAL_AI0 = 0, VAL_VBUS = 4, VAL_IBUS, VAL_TEMP, VAL_FREQ0 = 8, VAL_CNT0 = 16, VAL_COUNT = 24 };
+
+struct Mnemonic {
+    const char* name;
+    uint8_t op;
+};
+const Mnemonic kMnemonics[] = {
+    {"END", OP_END},   {"LD", OP_LD},     {"LDN", OP_LDN},   {"AND", OP_AND},   {"ANDN", OP_ANDN},
+    {"OR", OP_OR},     {"ORN", OP_ORN},   {"XOR", OP_XOR},   {"NOT", OP_NOT},   {"ST", OP_ST},
+    {"STN", OP_STN},   {"SET", OP_SET},   {"RST", OP_RST},   {"AND(", OP_PUSH_AND}, {"OR(", OP_PUSH_OR},
+    {")", OP_POP},     {"TON", OP_TON},   {"EDGE", OP_EDGE}, {"LDV", OP_LDV},   {"GT", OP_GT},
+    {"LT", OP_LT},     {"GE", OP_GE},     {"LE", OP_LE},     {"EQ", OP_EQ},     {"NE", OP_NE},
+    {"JMPC", OP_JMPC}, {"JMPCN", OP_JMPCN},
+};
+
+bool isBitOp(uint8_t op) { return (op >= OP_LD && op <= OP_XOR) || (op >= OP_ST && op <= OP_RST) || op == OP_EDGE; }
+bool isCmpOp(uint8_t op) { return op >= OP_GT && op <= OP_NE; }
+
+size_t opSize(uint8_t op) {
+    if (isBitOp(op) || op == OP_LDV) return 2;
+    if (op == OP_TON) return 6;
+    if (isCmpOp(op)) return 5;
+    if (op == OP_JMPC || op == OP_JMPCN) return 3;
+    return 1;
+}
+
+bool bitValid(uint8_t operand) {
+    const uint8_t area = operand >> 5;
+    return area < AREA_COUNT && (operand & 0x1F) < kAreaSize[area];
+}
+
+bool bitWritable(uint8_t operand) {
+    const uint8_t area = operand >> 5;
+    return area == AREA_Q || area == AREA_M || area == AREA_A;
+}
+
+uint16_t rd16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// ---------------------------------------------------------------- assembler
+
+struct Asm {
+    uint8_t* code;
+    size_t cap;
+    size_t len;
+    char* err;
+    size_t errLen;
+    int line;
+    bool emit;               // second pass
+    static constexpr uint8_t kMaxLabels = 32;
+    char labels[kMaxLabels][16];
+    uint16_t labelAt[kMaxLabels];
+    uint8_t labelCount;
+};
+
+bool fail(Asm& a, const char* what, const char* token = nullptr) {
+    if (a.err && a.errLen) {
+        if (token) {
+            snprintf(a.err, a.errLen, "line %d: %s '%s'", a.line, what, token);
+        } else {
+            snprintf(a.err, a.errLen, "line %d: %s", a.line, what);
+        }
+    }
+    return false;
+}
+
+bool parseIndex(const char* s, uint8_t limit, uint8_t& out) {
+    if (!*s) return false;
+    char* end = nullptr;
+    const long v = strtol(s, &end, 10);
+    if (*end || v < 0 || v >= limit) return false;
+    out = (uint8_t)v;
+    return true;
+}
+
+bool parseBit(const char* tok, uint8_t& out) {
+    for (uint8_t area = 0; area < AREA_COUNT; area++) {
+        if (toupper((unsigned char)tok[0]) != kAreaName[area]) continue;
+        uint8_t index;
+        if (!parseIndex(tok + 1, kAreaSize[area], index)) return false;
+        out = (uint8_t)(area << 5 | index);
+        return true;
+    }
+    return false;
+}
+
+bool parseValue(const char* tok, uint8_t& out) {
+    uint8_t index;
+    if (!strncasecmp(tok, "AI", 2) && parseIndex(tok + 2, 4, index)) {
+        out = VAL_AI0 + index;
+    } else if (!strcasecmp(tok, "VBUS")) {
+        out = VAL_VBUS;
+    } else if (!strcasecmp(tok, "IBUS")) {
+        out = VAL_IBUS;
+    } else if (!strcasecmp(tok, "TEMP")) {
+        out = VAL_TEMP;
+    } else if (!strncasecmp(tok, "FREQ", 4) && parseIndex(tok + 4, 8, index)) {
+        out = VAL_FREQ0 + index;
+    } else if (!strncasecmp(tok, "CNT", 3) && parseIndex(tok + 3, 8, index)) {
+        out = VAL_CNT0 + index;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseInt(const char* tok, int32_t& out) {
+    if (!tok || !*tok) return false;
+    char* end = nullptr;
+    const long long v = strtoll(tok, &end, 0);
+    if (*end || v < INT32_MIN || v > INT32_MAX) return false;
+    out = (int32_t)v;
+    return true;
+}
+
+int findLabel(const Asm& a, const char* name) {
+    for (uint8_t i = 0; i < a.labelCount; i++) {
+        if (!strcasecmp(a.labels[i], name)) return i;
+    }
+    return -1;
+}
+
+bool put(Asm& a, uint8_t b) {
+    if (a.len >= a.cap) return fail(a, "program too large");
+    if (a.emit) a.code[a.len] = b;
+    a.len++;
+    return true;
+}
+
+bool put16(Asm& a, uint16_t v) { return put(a, (uint8_t)v) && put(a, (uint8_t)(v >> 8)); }
+bool put32(Asm& a, uint32_t v) { return put16(a, (uint16_t)v) && put16(a, (uint16_t)(v >> 16)); }
+
+// One source line; tokens are modified in place
+bool assembleLine(Asm& a, char* line) {
+    char* comment = strchr(line, ';');
+    if (comment) *comment = '\0';
+    char* tok[4] = {};
+    uint8_t n = 0;
+    char* save = nullptr;
+    for (char* t = strtok_r(line, " \t\r", &save); t && n < 4; t = strtok_r(nullptr, " \t\r", &save)) tok[n++] = t;
+    if (!n) return true;
+
+    const size_t first = strlen(tok[0]);
+    if (tok[0][first - 1] == ':') {
+        tok[0][first - 1] = '\0';
+        if (!a.emit) {
+            if (first - 1 == 0 || first - 1 >= sizeof(a.labels[0])) return fail(a, "bad label", tok[0]);
+            if (findLabel(a, tok[0]) >= 0) return fail(a, "duplicate label", tok[0]);
+            if (a.labelCount >= Asm::kMaxLabels) return fail(a, "too many labels");
+            strcpy(a.labels[a.labelCount], tok[0]);
+            a.labelAt[a.labelCount++] = (uint16_t)a.len;
+        }
+        if (n == 1) return true;
+        memmove(tok, tok + 1, sizeof(tok[0]) * 3);
+        tok[3] = nullptr;
+        n--;
+    }
+
+    int op = -1;
+    for (const Mnemonic& m : kMnemonics) {
+        if (!strcasecmp(m.name, tok[0])) op = m.op;
+    }
+    if (op < 0) return fail(a, "unknown instruction", tok[0]);
+    const uint8_t want = op == OP_TON ? 3 : (opSize(op) > 1 ? 2 : 1);
+    if (n != want) return fail(a, "wrong number of operands for", tok[0]);
+
+    if (!put(a, (uint8_t)op)) return false;
+    if (isBitOp(op)) {
+        uint8_t bit;
+        if (!parseBit(tok[1], bit)) return fail(a, "bad bit", tok[1]);
+        if (op >= OP_ST && op <= OP_RST && !bitWritable(bit)) return fail(a, "not writable", tok[1]);
+        if (op == OP_EDGE && (bit >> 5) != AREA_M) return fail(a, "EDGE needs a marker", tok[1]);
+        return put(a, bit);
+    }
+    if (op == OP_LDV) {
+        uint8_t value;
+        if (!parseValue(tok[1], value)) return fail(a, "bad value", tok[1]);
+        return put(a, value);
+    }
+    if (op == OP_TON) {
+        uint8_t bit;
+        int32_t ms;
+        if (!parseBit(tok[1], bit) || (bit >> 5) != AREA_T) return fail(a, "bad timer", tok[1]);
+        if (!parseInt(tok[2], ms) || ms < 0) return fail(a, "bad preset", tok[2]);
+        return put(a, bit & 0x1F) && put32(a, (uint32_t)ms);
+    }
+    if (isCmpOp(op)) {
+        int32_t k;
+        if (!parseInt(tok[1], k)) return fail(a, "bad number", tok[1]);
+        return put32(a, (uint32_t)k);
+    }
+    if (op == OP_JMPC || op == OP_JMPCN) {
+        if (!a.emit) return put16(a, 0);
+        const int label = findLabel(a, tok[1]);
+        if (label < 0) return fail(a, "unknown label", tok[1]);
+        const size_t next = a.len + 2;
+        if (a.labelAt[label] < next) return fail(a, "jumps must go forward", tok[1]);
+        return put16(a, (uint16_t)(a.labelAt[label] - next));
+    }
+    return true;
+}
+
+bool assemblePass(Asm& a, const char* source) {
+    a.len = 0;
+    a.line = 0;
+    char buf[96];
+    const char* p = source;
+    while (*p) {
+        const char* eol = strchr(p, '\n');
+        const size_t n = eol ? (size_t)(eol - p) : strlen(p);
+        a.line++;
+        if (n >= sizeof(buf)) return fail(a, "line too long");
+        memcpy(buf, p, n);
+        buf[n] = '\0';
+        if (!assembleLine(a, buf)) return false;
+        p += n + (eol ? 1 : 0);
+    }
+    return put(a, OP_END);
+}
+} // namespace
+
+bool plc_logic_compile(const char* source, uint8_t* code, size_t cap, size_t* len, char* err, size_t errLen) {
+    if (err && errLen) err[0] = '\0';
+    if (!source || !code || !cap) return false;
+    Asm a = {};
+    a.code = code;
+    a.cap = cap;
+    a.err = err;
+    a.errLen = errLen;
+    if (!assemblePass(a, source)) return false;   // labels and size
+    a.emit = true;
+    if (!assemblePass(a, source)) return false;
+    if (len) *len = a.len;
+    return plc_logic_verify(code, a.len);
+}
+
+bool plc_logic_verify(const uint8_t* code, size_t len) {
+    if (!code || !len || len > PLC_LOGIC_MAX_CODE) return false;
+    size_t pc = 0;
+    bool ends = false;
+    while (pc < len) {
+        const uint8_t op = code[pc];
+        if (op >= OP_COUNT) return false;
+        const size_t size = opSize(op);
+        if (pc + size > len) return false;
+        const uint8_t arg = size > 1 ? code[pc + 1] : 0;
+        if (isBitOp(op)) {
+            if (!bitValid(arg)) return false;
+            if (op >= OP_ST && op <= OP_RST && !bitWritable(arg)) return false;
+            if (op == OP_EDGE && (arg >> 5) != AREA_M) return false;
+        } else if (op == OP_LDV) {
+            if (arg >= VAL_COUNT || (arg > VAL_TEMP && arg < VAL_FREQ0)) return false;
+        } else if (op == OP_TON) {
+            if (arg >= PLC_LOGIC_TIMERS) return false;
+        } else if (op == OP_JMPC || op == OP_JMPCN) {
+            if (pc + size + rd16(code + pc + 1) > len) return false;
+        }
+        ends = op == OP_END;
+        pc += size;
+    }
+    return ends;
+}
+
+#if PLC_LOGIC_ENABLE
+
+#include "plc_scan.h"
+#include "sensor_acquisition.h"
+#include "input_capture.h"
+#include "../modules/logging/log_buffer.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+
+#if ENABLE_SD
+#include "../modules/storage/sd_card_module.h"
+extern SDCardModule* sdModule;
+#endif
+
+namespace {
+const char* const kNamespace = "plc_logic";
+const char* const kKey = "prog";
+constexpr uint32_t kMagic = 0x31474C50;   // "PLG1"
+
+struct StoredHeader {
+    uint32_t magic;
+    uint16_t len;
+    uint16_t reserved;
+    uint32_t crc;
+};
+
+struct Timer {
+    bool running;
+    bool done;
+    uint32_t startMs;
+};
+
+// Everything a scan may change; copied in, committed only when the scan completes
+struct State {
+    uint32_t markers;
+    uint8_t alarms;
+    Timer timers[PLC_LOGIC_TIMERS];
+};
+
+BasicStampPLC* s_plc = nullptr;
+uint8_t s_code[PLC_LOGIC_MAX_CODE];
+uint16_t s_len = 0;                      // 0: no program
+uint32_t s_crc = 0;
+State s_state = {};
+bool s_firstScan = true;
+PlcLogicStats s_stats = {};
+
+// Install from another task: staged here under s_mux, taken at the next scan
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+uint8_t s_staged[PLC_LOGIC_MAX_CODE];
+uint16_t s_stagedLen = 0;
+bool s_stagedReady = false;
+
+uint32_t rd32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t codeCrc(const uint8_t* code, size_t len) {
+    return esp_rom_crc32_le(0, code, len);
+}
+
+void takeStaged() {
+    portENTER_CRITICAL(&s_mux);
+    if (s_stagedReady) {
+        memcpy(s_code, s_staged, s_stagedLen);
+        s_len = s_stagedLen;
+        s_stagedReady = false;
+        s_state = State{};
+        s_firstScan = true;
+        s_crc = UINT32_MAX;   // recomputed below, outside the lock
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (s_crc == UINT32_MAX) s_crc = s_len ? codeCrc(s_code, s_len) : 0;
+}
+
+void stage(const uint8_t* code, size_t len) {
+    portENTER_CRITICAL(&s_mux);
+    if (len) memcpy(s_staged, code, len);
+    s_stagedLen = (uint16_t)len;
+    s_stagedReady = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool loadStored(uint8_t* code, size_t& len) {
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, true)) return false;
+    StoredHeader h{};
+    bool ok = prefs.isKey(kKey);
+    const size_t total = ok ? prefs.getBytesLength(kKey) : 0;
+    ok = ok && total > sizeof(h) && total <= sizeof(h) + PLC_LOGIC_MAX_CODE;
+    uint8_t* buf = ok ? static_cast<uint8_t*>(malloc(total)) : nullptr;
+    if (buf) {
+        ok = prefs.getBytes(kKey, buf, total) == total;
+        memcpy(&h, buf, sizeof(h));
+        ok = ok && h.magic == kMagic && h.len == total - sizeof(h) && h.crc == codeCrc(buf + sizeof(h), h.len);
+        if (ok) {
+            memcpy(code, buf + sizeof(h), h.len);
+            len = h.len;
+        }
+        free(buf);
+    }
+    prefs.end();
+    return buf && ok;
+}
+
+bool store(const uint8_t* code, size_t len) {
+    uint8_t* buf = static_cast<uint8_t*>(malloc(sizeof(StoredHeader) + len));
+    if (!buf) return false;
+    const StoredHeader h{kMagic, (uint16_t)len, 0, codeCrc(code, len)};
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), code, len);
+    Preferences prefs;
+    bool ok = prefs.begin(kNamespace, false);
+    if (ok) {
+        ok = prefs.putBytes(kKey, buf, sizeof(h) + len) == sizeof(h) + len;
+        prefs.end();
+    }
+    free(buf);
+    return ok;
+}
+
+#if ENABLE_SD
+// Compiles PLC_LOGIC_SD_PATH; true with code filled when the file exists and compiles
+bool importFromSd(uint8_t* code, size_t& len) {
+    if (!sdModule || !sdModule->isMounted() || !sdModule->exists(PLC_LOGIC_SD_PATH)) return false;
+    char* source = static_cast<char*>(malloc(PLC_LOGIC_MAX_SOURCE + 1));
+    if (!source) return false;
+    bool ok = sdModule->readText(PLC_LOGIC_SD_PATH, source, PLC_LOGIC_MAX_SOURCE + 1, PLC_LOGIC_MAX_SOURCE);
+    char err[64] = "";
+    if (ok) ok = plc_logic_compile(source, code, PLC_LOGIC_MAX_CODE, &len, err, sizeof(err));
+    if (!ok) logbuf_printf("Logic: %s not loaded: %s", PLC_LOGIC_SD_PATH, err[0] ? err : "read failed");
+    free(source);
+    return ok;
+}
+#endif
+
+struct Machine {
+    const PlcIoSnapshot& io;
+    State& st;
+    bool relays[2];
+    bool sensorsRead;
+    PlcSensorSnapshot sensors;
+    uint32_t nowMs;
+};
+
+bool readBit(Machine& m, uint8_t operand) {
+    const uint8_t index = operand & 0x1F;
+    switch (operand >> 5) {
+        case AREA_I: return m.io.digitalInputs[index];
+        case AREA_Q: return m.relays[index];
+        case AREA_M: return (m.st.markers >> index) & 1;
+        case AREA_T: return m.st.timers[index].done;
+        case AREA_A: return (m.st.alarms >> index) & 1;
+        default: break;
+    }
+    if (index == 0) return true;
+    if (index == 1) return s_firstScan;
+    if (!m.sensorsRead) {
+        m.sensors = sensor_acq_snapshot();
+        m.sensorsRead = true;
+    }
+    return index == 2 ? m.sensors.powerOk : m.sensors.tempOk;
+}
+
+void writeBit(Machine& m, uint8_t operand, bool v) {
+    const uint8_t index = operand & 0x1F;
+    switch (operand >> 5) {
+        case AREA_Q:
+            m.relays[index] = v;
+            break;
+        case AREA_M:
+            m.st.markers = v ? (m.st.markers | (1u << index)) : (m.st.markers & ~(1u << index));
+            break;
+        case AREA_A:
+            m.st.alarms = v ? (m.st.alarms | (1u << index)) : (m.st.alarms & ~(1u << index));
+            break;
+        default:
+            break;
+    }
+}
+
+int32_t readValue(Machine& m, uint8_t src) {
+    if (src < VAL_VBUS) return m.io.analogInputs[src];
+    if (src <= VAL_TEMP) {
+        if (!m.sensorsRead) {
+            m.sensors = sensor_acq_snapshot();
+            m.sensorsRead = true;
+        }
+        if (src == VAL_VBUS) return (int32_t)(m.sensors.busVoltage * 1000.0f);
+        if (src == VAL_IBUS) return (int32_t)(m.sensors.current * 1000.0f);
+        return (int32_t)(m.sensors.temperature * 10.0f);
+    }
+    InputChannelStats ch;
+    if (!input_capture_channel(src & 7, ch)) return 0;
+    return src < VAL_CNT0 ? (int32_t)ch.freqMilliHz : (int32_t)ch.pulses;
+}
+
+// Runs the program once; false on a fault, with steps the instructions executed
+bool execute(Machine& m, uint16_t& steps) {
+    bool rlo = false;
+    int32_t acc = 0;
+    bool stack[PLC_LOGIC_STACK];
+    uint8_t stackOp[PLC_LOGIC_STACK];
+    uint8_t sp = 0;
+    size_t pc = 0;
+    steps = 0;
+
+    while (pc < s_len) {
+        if (++steps > PLC_LOGIC_MAX_STEPS) return false;
+        const uint8_t op = s_code[pc];
+        const uint8_t arg = opSize(op) > 1 ? s_code[pc + 1] : 0;
+        const size_t next = pc + opSize(op);
+        switch (op) {
+            case OP_END: return sp == 0;
+            case OP_LD: rlo = readBit(m, arg); break;
+            case OP_LDN: rlo = !readBit(m, arg); break;
+            case OP_AND: rlo = rlo && readBit(m, arg); break;
+            case OP_ANDN: rlo = rlo && !readBit(m, arg); break;
+            case OP_OR: rlo = rlo || readBit(m, arg); break;
+            case OP_ORN: rlo = rlo || !readBit(m, arg); break;
+            case OP_XOR: rlo = rlo != readBit(m, arg); break;
+            case OP_NOT: rlo = !rlo; break;
+            case OP_ST: writeBit(m, arg, rlo); break;
+            case OP_STN: writeBit(m, arg, !rlo); break;
+            case OP_SET: if (rlo) writeBit(m, arg, true); break;
+            case OP_RST: if (rlo) writeBit(m, arg, false); break;
+            case OP_PUSH_AND:
+            case OP_PUSH_OR:
+                if (sp >= PLC_LOGIC_STACK) return false;
+                stack[sp] = rlo;
+                stackOp[sp++] = op;
+                break;
+            case OP_POP:
+                if (!sp) return false;
+                sp--;
+                rlo = stackOp[sp] == OP_PUSH_AND ? (stack[sp] && rlo) : (stack[sp] || rlo);
+                break;
+            case OP_TON: {
+                Timer& t = m.st.timers[arg];
+                if (!rlo) {
+                    t.running = false;
+                    t.done = false;
+                } else if (!t.running) {
+                    t.running = true;
+                    t.startMs = m.nowMs;
+                }
+                if (t.running && !t.done && m.nowMs - t.startMs >= rd32(s_code + pc + 2)) t.done = true;
+                rlo = t.done;
+                break;
+            }
+            case OP_EDGE: {
+                const bool before = readBit(m, arg);
+                writeBit(m, arg, rlo);
+                rlo = rlo && !before;
+                break;
+            }
+            case OP_LDV: acc = readValue(m, arg); break;
+            case OP_GT: rlo = acc > (int32_t)rd32(s_code + pc + 1); break;
+            case OP_LT: rlo = acc < (int32_t)rd32(s_code + pc + 1); break;
+            case OP_GE: rlo = acc >= (int32_t)rd32(s_code + pc + 1); break;
+            case OP_LE: rlo = acc <= (int32_t)rd32(s_code + pc + 1); break;
+            case OP_EQ: rlo = acc == (int32_t)rd32(s_code + pc + 1); break;
+            case OP_NE: rlo = acc != (int32_t)rd32(s_code + pc + 1); break;
+            case OP_JMPC:
+            case OP_JMPCN:
+                if (rlo == (op == OP_JMPC)) {
+                    pc = next + rd16(s_code + pc + 1);
+                    continue;
+                }
+                break;
+            default: return false;   // verified away
+        }
+        pc = next;
+    }
+    return sp == 0;
+}
+
+// Scan logic phase
+void logicPhase(const PlcIoSnapshot& io, void*) {
+    takeStaged();
+    if (!s_len) return;
+    const int64_t start = esp_timer_get_time();
+    State st = s_state;
+    Machine m{io, st, {io.relayOutputs[0], io.relayOutputs[1]}, false, {}, millis()};
+    uint16_t steps = 0;
+    const bool ok = execute(m, steps);
+
+    s_stats.scans++;
+    s_stats.lastSteps = steps;
+    if (steps > s_stats.maxSteps) s_stats.maxSteps = steps;
+    if (!ok) {
+        if (s_stats.faults++ == 0) logbuf_printf("Logic: scan aborted after %u steps, nothing committed", steps);
+    } else {
+        const uint8_t raised = st.alarms & ~s_state.alarms;
+        const uint8_t cleared = s_state.alarms & ~st.alarms;
+        for (uint8_t i = 0; i < PLC_LOGIC_ALARMS; i++) {
+            if (raised & (1 << i)) logbuf_printf("Logic: alarm A%u raised", (unsigned)i);
+            if (cleared & (1 << i)) logbuf_printf("Logic: alarm A%u cleared", (unsigned)i);
+        }
+        s_state = st;
+        s_firstScan = false;
+        for (uint8_t i = 0; i < 2; i++) {
+            if (m.relays[i] != io.relayOutputs[i]) s_plc->setRelayOutput(i, m.relays[i]);
+        }
+    }
+    s_stats.lastUs = (uint32_t)(esp_timer_get_time() - start);
+    if (s_stats.lastUs > s_stats.maxUs) s_stats.maxUs = s_stats.lastUs;
+}
+} // namespace
+
+bool plc_logic_begin(BasicStampPLC* plc) {
+    if (s_plc) return true;
+    if (!plc) return false;
+    s_plc = plc;
+
+    static uint8_t code[PLC_LOGIC_MAX_CODE];
+    size_t len = 0;
+    const bool stored = loadStored(code, len) && plc_logic_verify(code, len);
+    uint32_t crc = stored ? codeCrc(code, len) : 0;
+#if ENABLE_SD
+    size_t sdLen = 0;
+    static uint8_t sdCode[PLC_LOGIC_MAX_CODE];
+    if (importFromSd(sdCode, sdLen) && (!stored || codeCrc(sdCode, sdLen) != crc)) {
+        if (store(sdCode, sdLen)) {
+            logbuf_printf("Logic: installed %s (%u bytes)", PLC_LOGIC_SD_PATH, (unsigned)sdLen);
+        }
+        memcpy(code, sdCode, sdLen);
+        len = sdLen;
+        crc = codeCrc(code, len);
+    }
+#endif
+    if (len) stage(code, len);
+    Serial.printf("Logic: %s program, %u bytes, crc %08lx\n", len ? "running" : "no", (unsigned)len,
+                  (unsigned long)crc);
+    return plc_scan_add_logic("Bytecode", logicPhase, nullptr);
+}
+
+bool plc_logic_install(const uint8_t* code, size_t len, bool persist) {
+    if (!plc_logic_verify(code, len)) return false;
+    if (persist && !store(code, len)) return false;
+    stage(code, len);
+    logbuf_printf("Logic: program installed, %u bytes", (unsigned)len);
+    return true;
+}
+
+bool plc_logic_clear() {
+    stage(nullptr, 0);
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, false)) return false;
+    const bool ok = !prefs.isKey(kKey) || prefs.remove(kKey);
+    prefs.end();
+    return ok;
+}
+
+uint8_t plc_logic_alarms() {
+    return s_state.alarms;
+}
+
+void plc_logic_stats(PlcLogicStats& out) {
+    out = s_stats;
+    out.loaded = s_len != 0;
+    out.codeLen = s_len;
+    out.crc = s_crc;
+    out.alarms = s_state.alarms;
+}
+
+void plc_logic_report(Print& out) {
+    PlcLogicStats s;
+    plc_logic_stats(s);
+    if (!s.loaded) {
+        out.println("Logic: no program");
+        return;
+    }
+    out.printf("Logic: %u bytes crc %08lx, %lu scans, %lu faults, steps %u (max %u), %lu us (max %lu), alarms %02x\n",
+               (unsigned)s.codeLen, (unsigned long)s.crc, (unsigned long)s.scans, (unsigned long)s.faults,
+               (unsigned)s.lastSteps, (unsigned)s.maxSteps, (unsigned long)s.lastUs, (unsigned long)s.maxUs,
+               (unsigned)s.alarms);
+}
+
+#endif // PLC_LOGIC_ENABLE
@@ -0,0 +1,103 @@
+/*
+ * PLC Logic Engine
+ * Site relay and alarm logic as a small bytecode program instead of firmware:
+ *   - instruction-list style: a boolean result (RLO) built from input, relay,
+ *     marker, timer, alarm and status bits, a stack for nested terms, integer
+ *     comparisons on analog, power and pulse values, on-delay timers, edge
+ *     detection and forward jumps
+ *   - runs in the logic phase of every PLC scan (hardware/plc_scan.h) on that
+ *     scan's input image, at most PLC_LOGIC_MAX_STEPS instructions. A scan
+ *     that faults (budget, stack) commits nothing: relays, markers, timers and
+ *     alarms keep their previous state.
+ *   - programs are verified before they are installed (opcodes, operand
+ *     ranges, writable targets, jumps forward and inside the program); the
+ *     installed one is kept in NVS. At boot a source file on the SD card
+ *     (PLC_LOGIC_SD_PATH) is compiled on the device and replaces it when the
+ *     bytecode differs.
+ *
+ * Source, one instruction per line, ';' starts a comment, "name:" a label:
+ *   LD/LDN/AND/ANDN/OR/ORN/XOR <bit>    ST/STN/SET/RST <Q|M|A bit>    NOT
+ *   AND( or OR( ... )                   nested term
+ *   TON Tn <ms>                         on-delay on RLO; RLO becomes its output
+ *   EDGE Mn                             RLO true for one scan on a rising RLO
+ *   LDV <value>, then GT/LT/GE/LE/EQ/NE <int>   compare into RLO
+ *   JMPC/JMPCN <label>                  forward jump when RLO is true / false
+ * Bits: I0-7 inputs, Q0-1 relays, M0-31 markers, T0-7 timer outputs, A0-7
+ * alarms, S0 always on, S1 first scan, S2 power monitor ok, S3 temperature ok.
+ * Values: AI0-3, VBUS (mV), IBUS (mA), TEMP (0.1 C), FREQ0-7 (mHz), CNT0-7.
+ *
+ *   LD I0           ; relay 0 follows input 0 after 2 s
+ *   TON T0 2000
+ *   ST Q0
+ *   LDV TEMP
+ *   GT 600          ; alarm above 60 C
+ *   ST A0
+ */
+
+#ifndef PLC_LOGIC_H
+#define PLC_LOGIC_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+#include "basic_stamplc.h"
+
+#ifndef PLC_LOGIC_MAX_CODE
+#define PLC_LOGIC_MAX_CODE 1024            // bytecode bytes
+#endif
+#ifndef PLC_LOGIC_MAX_STEPS
+#define PLC_LOGIC_MAX_STEPS 512            // instructions per scan
+#endif
+#ifndef PLC_LOGIC_SD_PATH
+#define PLC_LOGIC_SD_PATH "/logic.il"
+#endif
+#define PLC_LOGIC_MAX_SOURCE 4096
+#define PLC_LOGIC_STACK 8
+#define PLC_LOGIC_TIMERS 8
+#define PLC_LOGIC_ALARMS 8
+
+struct PlcLogicStats {
+    bool loaded;
+    uint16_t codeLen;
+    uint32_t crc;            // of the running bytecode
+    uint32_t scans;
+    uint32_t faults;         // scans aborted, nothing committed
+    uint16_t lastSteps;
+    uint16_t maxSteps;
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint8_t alarms;          // bit per alarm
+};
+
+// Compiles source into bytecode; on failure err holds "line N: reason".
+bool plc_logic_compile(const char* source, uint8_t* code, size_t cap, size_t* len, char* err, size_t errLen);
+// Structural check of bytecode; every install runs it
+bool plc_logic_verify(const uint8_t* code, size_t len);
+
+#if PLC_LOGIC_ENABLE
+
+// Loads the stored program, imports PLC_LOGIC_SD_PATH and joins the scan's
+// logic phase. Call once from setup() after the SD card is mounted.
+bool plc_logic_begin(BasicStampPLC* plc);
+
+// Verifies, stores in NVS and runs bytecode from the next scan (e.g. received
+// over the uplink). persist false runs it until reboot only.
+bool plc_logic_install(const uint8_t* code, size_t len, bool persist = true);
+// Stops running logic and erases the stored program; relays keep their state
+bool plc_logic_clear();
+
+uint8_t plc_logic_alarms();
+void plc_logic_stats(PlcLogicStats& out);
+void plc_logic_report(Print& out);
+
+#else
+
+inline bool plc_logic_begin(BasicStampPLC*) { return false; }
+inline bool plc_logic_install(const uint8_t*, size_t, bool = true) { return false; }
+inline bool plc_logic_clear() { return false; }
+inline uint8_t plc_logic_alarms() { return 0; }
+inline void plc_logic_stats(PlcLogicStats& out) { out = PlcLogicStats{}; }
+inline void plc_logic_report(Print&) {}
+
+#endif // PLC_LOGIC_ENABLE
+
+#endif // PLC_LOGIC_H
@@ -0,0 +1,201 @@
+/*
+ * PLC Scan Cycle Implementation
+ */
+
+#include "plc_scan.h"
+#include "../system/boot_profile.h"
+#include "../system/core_affinity.h"
+#include "../system/hot_path_timer.h"
+#include "../system/metrics.h"
+#include "../system/sched_analysis.h"
+#include "../modules/transport/live_config.h"
+#include <esp_timer.h>
+#include <atomic>
+
+namespace {
+constexpr uint32_t kEdgesUs[PLC_SCAN_BUCKETS - 1] = {50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000};
+const char* const kEdgeNames[PLC_SCAN_BUCKETS] = {"<50us", "<100us", "<200us", "<500us", "<1ms", "<2ms",
+                                                  "<5ms", "<10ms", "<20ms", "<50ms", ">=50ms"};
+
+struct Logic {
+    const char* name;
+    PlcLogicFn fn;
+    void* ctx;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Logic s_logic[PLC_SCAN_MAX_LOGIC];
+std::atomic<uint8_t> s_logicCount{0};
+std::atomic<uint32_t> s_periodMs{PLC_SCAN_PERIOD_MS};
+PlcScanStats s_stats = {};               // under s_mux
+MetricCounter s_metricOverruns("plc.overruns", [] { return s_stats.overruns; });   // word read, no lock
+
+uint32_t clampPeriod(uint32_t ms) {
+    if (ms < PLC_SCAN_MIN_PERIOD_MS) return PLC_SCAN_MIN_PERIOD_MS;
+    if (ms > PLC_SCAN_MAX_PERIOD_MS) return PLC_SCAN_MAX_PERIOD_MS;
+    return ms;
+}
+
+uint8_t bucket(uint32_t us) {
+    uint8_t b = 0;
+    while (b < PLC_SCAN_BUCKETS - 1 && us >= kEdgesUs[b]) b++;
+    return b;
+}
+
+void record(uint32_t jitterUs, uint32_t inputUs, uint32_t logicUs, uint32_t outputUs, uint32_t periodUs) {
+    const uint32_t scanUs = inputUs + logicUs + outputUs;
+    portENTER_CRITICAL(&s_mux);
+    PlcScanStats& s = s_stats;
+    s.periodUs = periodUs;
+    s.scans++;
+    if (scanUs > periodUs) s.overruns++;
+    s.lastScanUs = scanUs;
+    if (scanUs > s.maxScanUs) s.maxScanUs = scanUs;
+    if (inputUs > s.maxInputUs) s.maxInputUs = inputUs;
+    if (logicUs > s.maxLogicUs) s.maxLogicUs = logicUs;
+    if (outputUs > s.maxOutputUs) s.maxOutputUs = outputUs;
+    s.lastJitterUs = jitterUs;
+    if (jitterUs > s.maxJitterUs) s.maxJitterUs = jitterUs;
+    s.scanHist[bucket(scanUs)]++;
+    s.jitterHist[bucket(jitterUs)]++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void printHist(Print& out, const char* name, const uint32_t* hist) {
+    out.printf("  %-6s", name);
+    for (uint8_t b = 0; b < PLC_SCAN_BUCKETS; b++) {
+        if (hist[b]) out.printf(" %s:%lu", kEdgeNames[b], (unsigned long)hist[b]);
+    }
+    out.println();
+}
+} // namespace
+
+bool plc_scan_add_logic(const char* name, PlcLogicFn fn, void* ctx) {
+    if (!fn) return false;
+    portENTER_CRITICAL(&s_mux);
+    const uint8_t n = s_logicCount.load(std::memory_order_relaxed);
+    const bool ok = n < PLC_SCAN_MAX_LOGIC;
+    if (ok) {
+        s_logic[n] = Logic{name, fn, ctx};
+        s_logicCount.store(n + 1, std::memory_order_release);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+bool plc_scan_set_period(uint32_t ms) {
+    const uint32_t clamped = clampPeriod(ms);
+    s_periodMs.store(clamped, std::memory_order_relaxed);
+    return clamped == ms;
+}
+
+uint32_t plc_scan_period_ms() {
+    return s_periodMs.load(std::memory_order_relaxed);
+}
+
+void plc_scan_run(BasicStampPLC* plc) {
+    plc->setScanOwnsOutputs(true);
+    // The analysis takes the configured period and the longest scan over the profiler's estimate
+    sched_analysis_source("StampPLC", [](uint32_t& periodUs, uint32_t& wcetUs) -> bool {
+        PlcScanStats s;
+        plc_scan_stats(s);
+        periodUs = s.periodUs;
+        wcetUs = s.maxScanUs;
+        return s.scans > 0;
+    });
+    // The plc_scan_ms shared attribute moves the period; deleting it restores PLC_SCAN_PERIOD_MS
+    live_config_register("plc_scan_ms", LiveConfigType::Int, PLC_SCAN_MIN_PERIOD_MS, PLC_SCAN_MAX_PERIOD_MS,
+                         [](const LiveConfigValue& v, void*) {
+        return plc_scan_set_period(v.present ? (uint32_t)v.number : PLC_SCAN_PERIOD_MS);
+    }, nullptr);
+    const int64_t tickUs = (int64_t)portTICK_PERIOD_MS * 1000;
+    uint32_t periodMs = 0;
+    TickType_t period = 1;
+    TickType_t nextWake = xTaskGetTickCount();
+    TickType_t anchorTick = nextWake;
+    int64_t anchorUs = esp_timer_get_time();
+    bool first = true;
+
+    for (;;) {
+        const uint32_t wantMs = plc_scan_period_ms();
+        if (wantMs != periodMs) {
+            // New period: restart the schedule from this wake
+            periodMs = wantMs;
+            period = pdMS_TO_TICKS(periodMs) ? pdMS_TO_TICKS(periodMs) : 1;
+            anchorTick = nextWake;
+            anchorUs = esp_timer_get_time();
+        }
+        const uint32_t periodUs = (uint32_t)(period * tickUs);
+        core_affinity_period(KernelTask::StampPLC, periodUs);
+
+        const int64_t start = esp_timer_get_time();
+        const int64_t due = anchorUs + (int64_t)(TickType_t)(nextWake - anchorTick) * tickUs;
+        const uint32_t jitterUs = (uint32_t)(start > due ? start - due : due - start);
+
+        int64_t inputDone;
+        int64_t logicDone;
+        int64_t outputDone;
+        {
+            HOT_PATH_TIMER("plc.scan");
+            plc->scanInputs();
+            inputDone = esp_timer_get_time();
+
+            const PlcIoSnapshot io = plc->getIoSnapshot();
+            const uint8_t logicCount = s_logicCount.load(std::memory_order_acquire);
+            for (uint8_t i = 0; i < logicCount; i++) s_logic[i].fn(io, s_logic[i].ctx);
+            logicDone = esp_timer_get_time();
+
+            plc->writeOutputs();
+            outputDone = esp_timer_get_time();
+        }
+
+        record(jitterUs, (uint32_t)(inputDone - start), (uint32_t)(logicDone - inputDone),
+               (uint32_t)(outputDone - logicDone), periodUs);
+        if (first && plc->isReady()) {
+            boot_mark(BootStage::FirstPlcScan);
+            first = false;
+        }
+
+        // Past the next deadline already: drop the missed periods, keep the phase
+        const TickType_t now = xTaskGetTickCount();
+        const TickType_t late = (TickType_t)(now - nextWake);
+        if (late >= period) {
+            const TickType_t missed = late / period;
+            nextWake += missed * period;
+            portENTER_CRITICAL(&s_mux);
+            s_stats.skipped += missed;
+            portEXIT_CRITICAL(&s_mux);
+        }
+        vTaskDelayUntil(&nextWake, period);
+    }
+}
+
+void plc_scan_stats(PlcScanStats& out) {
+    portENTER_CRITICAL(&s_mux);
+    out = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void plc_scan_reset_stats() {
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t periodUs = s_stats.periodUs;
+    s_stats = PlcScanStats{};
+    s_stats.periodUs = periodUs;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void plc_scan_report(Print& out) {
+    PlcScanStats s;
+    plc_scan_stats(s);
+    if (!s.scans) return;
+    out.printf("PLC scan: %lu us period, %lu scans, %lu overruns, %lu periods skipped\n", (unsigned long)s.periodUs,
+               (unsigned long)s.scans, (unsigned long)s.overruns, (unsigned long)s.skipped);
+    out.printf("  scan %lu us (max %lu: input %lu, logic %lu, output %lu), jitter %lu us (max %lu)\n",
+               (unsigned long)s.lastScanUs, (unsigned long)s.maxScanUs, (unsigned long)s.maxInputUs,
+               (unsigned long)s.maxLogicUs, (unsigned long)s.maxOutputUs, (unsigned long)s.lastJitterUs,
+               (unsigned long)s.maxJitterUs);
+    printHist(out, "scan", s.scanHist);
+    printHist(out, "jitter", s.jitterHist);
+    const uint8_t n = s_logicCount.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < n; i++) out.printf("  logic: %s\n", s_logic[i].name);
+}
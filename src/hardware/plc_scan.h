@@ -0,0 +1,70 @@
+/*
+ * PLC Scan Cycle
+ * Fixed-period scan of the StampPLC I/O, run by the StampPLC task:
+ *   - every period (PLC_SCAN_PERIOD_MS, 1-100 ms, changeable at run time, also
+ *     from the plc_scan_ms shared attribute) the task wakes on vTaskDelayUntil
+ *     and runs three phases in order: inputs (BasicStampPLC::scanInputs), the
+ *     registered logic callbacks on that input image, and outputs (relays set
+ *     since the last scan)
+ *   - relays set from any task are written in the output phase, so outputs
+ *     change once per scan, after the logic that saw the same inputs
+ *   - per scan: start jitter against the ideal schedule, scan time and per
+ *     phase maxima; histograms of both, overruns (scan longer than the period)
+ *     and periods skipped. A late scan does not trigger catch-up scans; the
+ *     next one keeps the original phase.
+ *
+ * Buttons are sampled by hardware/button_input.h, which shares the bus
+ * through the PLC I/O mutex.
+ */
+
+#ifndef PLC_SCAN_H
+#define PLC_SCAN_H
+
+#include <Arduino.h>
+#include "basic_stamplc.h"
+
+#ifndef PLC_SCAN_PERIOD_MS
+#define PLC_SCAN_PERIOD_MS 20
+#endif
+#define PLC_SCAN_MIN_PERIOD_MS 1
+#define PLC_SCAN_MAX_PERIOD_MS 100
+#ifndef PLC_SCAN_MAX_LOGIC
+#define PLC_SCAN_MAX_LOGIC 4
+#endif
+#define PLC_SCAN_BUCKETS 11                // histogram buckets, upper edges in plc_scan.cpp
+
+// Logic phase: io is this scan's input image; set relays through the PLC
+typedef void (*PlcLogicFn)(const PlcIoSnapshot& io, void* ctx);
+
+struct PlcScanStats {
+    uint32_t periodUs;
+    uint32_t scans;
+    uint32_t overruns;       // scans longer than the period
+    uint32_t skipped;        // periods with no scan after an overrun
+    uint32_t lastScanUs;
+    uint32_t maxScanUs;
+    uint32_t maxInputUs;
+    uint32_t maxLogicUs;
+    uint32_t maxOutputUs;
+    uint32_t lastJitterUs;   // |start - scheduled start|
+    uint32_t maxJitterUs;
+    uint32_t scanHist[PLC_SCAN_BUCKETS];
+    uint32_t jitterHist[PLC_SCAN_BUCKETS];
+};
+
+// Runs the logic phase callback every scan; name must be a string literal.
+// False when the table is full.
+bool plc_scan_add_logic(const char* name, PlcLogicFn fn, void* ctx);
+
+// Clamped to PLC_SCAN_MIN_PERIOD_MS..PLC_SCAN_MAX_PERIOD_MS; applies from the next scan
+bool plc_scan_set_period(uint32_t ms);
+uint32_t plc_scan_period_ms();
+
+// StampPLC task body; never returns
+void plc_scan_run(BasicStampPLC* plc);
+
+void plc_scan_stats(PlcScanStats& out);
+void plc_scan_reset_stats();
+void plc_scan_report(Print& out);
+
+#endif // PLC_SCAN_H
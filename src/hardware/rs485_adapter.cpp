@@ -1,4 +1,226 @@
 #include "rs485_adapter.h"
+#include "../system/kernel_objects.h"
+#include "../../include/memory_monitor.h"
+#include "../../include/object_pool.h"
+#include "../system/text_buffer.h"
+#include <driver/uart.h>
+#include <esp_timer.h>
+#include <string.h>
+
+namespace {
+constexpr uart_port_t kPort = (uart_port_t)RS485_UART_NUM;
+constexpr uint8_t kMaxToutSymbols = 90;      // register limit at 11 bit characters
+
+struct Rs485Frame {
+    int64_t endUs;           // TOUT event: the gap after the last byte elapsed
+    uint16_t len;
+    bool cut;
+    uint8_t data[RS485_MAX_FRAME];
+};
+
+static_assert(sizeof(Rs485Frame*) <= QUEUE_ITEM_BYTES_RS485_FRAME, "RS485 frame queue item too small");
+
+// One slot per queued frame plus the one being received
+ObjectPool<Rs485Frame, QUEUE_SIZE_RS485_FRAMES + 1> s_frames("rs485 frames");
+QueueHandle_t s_ready = nullptr;             // Rs485Frame*, oldest first
+QueueHandle_t s_events = nullptr;            // uart_event_t from the driver
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+volatile int64_t s_flushUs = 0;              // frames starting earlier are stale
+bool s_portReady = false;
+uint32_t s_gapUs = 0;
+uint32_t s_charUs = 0;
+uint8_t s_toutSymbols = 0;
+Rs485PortStats s_portStats = {};             // under s_mux
+
+void countLineError() {
+    portENTER_CRITICAL(&s_mux);
+    s_portStats.lineErrors++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+int64_t frameStartUs(const Rs485Frame& f) {
+    return f.endUs - (int64_t)(f.len + s_toutSymbols) * s_charUs;
+}
+
+void discard(size_t bytes) {
+    uint8_t sink[32];
+    while (bytes) {
+        const int got = uart_read_bytes(kPort, sink, bytes < sizeof(sink) ? bytes : sizeof(sink), 0);
+        if (got <= 0) break;
+        bytes -= (size_t)got;
+    }
+}
+
+// Moves the driver's bytes into the current frame and queues it at the frame end
+void rxTask(void*) {
+    Rs485Frame* cur = nullptr;
+    bool lost = false;       // the frame being received had no slot
+    for (;;) {
+        uart_event_t ev;
+        if (xQueueReceive(s_events, &ev, portMAX_DELAY) != pdTRUE) continue;
+        switch (ev.type) {
+            case UART_DATA: {
+                if (!cur && !lost) {
+                    cur = s_frames.create();
+                    if (cur) {
+                        cur->len = 0;
+                        cur->cut = false;
+                    } else {
+                        lost = true;
+                    }
+                }
+                size_t take = 0;
+                if (cur) {
+                    const size_t room = RS485_MAX_FRAME - cur->len;
+                    take = ev.size < room ? ev.size : room;
+                    const int got = take ? uart_read_bytes(kPort, cur->data + cur->len, take, 0) : 0;
+                    if (got > 0) cur->len += (uint16_t)got;
+                    if (ev.size > take) cur->cut = true;
+                }
+                discard(ev.size - take);
+                if (!ev.timeout_flag) break;
+                // TOUT: the line has been idle for the frame gap
+                const int64_t now = esp_timer_get_time();
+                if (cur) {
+                    cur->endUs = now;
+                    if (xQueueSend(s_ready, &cur, 0) != pdTRUE) {
+                        s_frames.destroy(cur);
+                        lost = true;
+                    }
+                    cur = nullptr;
+                }
+                portENTER_CRITICAL(&s_mux);
+                if (lost) s_portStats.dropped++;
+                s_portStats.lastRxMs = millis();
+                portEXIT_CRITICAL(&s_mux);
+                lost = false;
+                break;
+            }
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                // Bytes are gone; the frame in progress cannot be trusted
+                uart_flush_input(kPort);
+                xQueueReset(s_events);
+                if (cur) {
+                    s_frames.destroy(cur);
+                    cur = nullptr;
+                }
+                lost = false;
+                countLineError();
+                break;
+            case UART_FRAME_ERR:
+            case UART_PARITY_ERR:
+                countLineError();
+                break;
+            default:
+                break;
+        }
+    }
+}
+} // namespace
+
+bool rs485_port_begin(uint32_t baud) {
+    if (s_portReady) return true;
+    uart_config_t cfg = {};
+    cfg.baud_rate = (int)baud;
+    cfg.data_bits = UART_DATA_8_BITS;
+    cfg.parity = UART_PARITY_DISABLE;
+    cfg.stop_bits = UART_STOP_BITS_1;
+    cfg.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+#if ESP_IDF_VERSION_MAJOR >= 5
+    cfg.source_clk = UART_SCLK_DEFAULT;
+#else
+    cfg.source_clk = UART_SCLK_APB;
+#endif
+    // 11 bits per character; Modbus fixes the gap above 19200 baud
+    s_charUs = (uint32_t)(11 * 1000000UL / baud);
+    s_gapUs = baud > 19200 ? 1750 : (uint32_t)(3.5 * 11 * 1000000.0 / baud);
+    // Whole characters below the gap, so the frame is closed before the next may start
+    uint32_t tout = s_gapUs / s_charUs;
+    if (tout < 2) tout = 2;
+    if (tout > kMaxToutSymbols) tout = kMaxToutSymbols;
+    s_toutSymbols = (uint8_t)tout;
+
+    if (!s_ready) s_ready = kernel_queue_create(KernelQueue::Rs485Frames, sizeof(Rs485Frame*));
+    if (!s_ready) return false;
+    if (uart_driver_install(kPort, RS485_RX_BUFFER, 0, RS485_UART_EVENTS, &s_events, 0) != ESP_OK) return false;
+    if (uart_param_config(kPort, &cfg) != ESP_OK ||
+        uart_set_pin(kPort, RS485_TX_PIN, RS485_RX_PIN, RS485_DE_PIN, UART_PIN_NO_CHANGE) != ESP_OK ||
+        uart_set_mode(kPort, UART_MODE_RS485_HALF_DUPLEX) != ESP_OK ||
+        uart_set_rx_full_threshold(kPort, RS485_RX_FULL_THRESHOLD) != ESP_OK ||
+        uart_set_rx_timeout(kPort, s_toutSymbols) != ESP_OK ||
+        kernel_task_create(KernelTask::Rs485Rx, rxTask, nullptr, TASK_PRIORITY_RS485_RX, nullptr, 1) != pdPASS) {
+        uart_driver_delete(kPort);
+        s_events = nullptr;
+        return false;
+    }
+    MemoryMonitor::registerPool(s_frames.stats());
+    s_portStats.baud = baud;
+    s_portReady = true;
+    return true;
+}
+
+bool rs485_port_ready() {
+    return s_portReady;
+}
+
+uint32_t rs485_frame_gap_us() {
+    return s_gapUs;
+}
+
+bool rs485_port_send(const uint8_t* frame, size_t len) {
+    if (!s_portReady || !frame || !len) return false;
+    const int written = uart_write_bytes(kPort, reinterpret_cast<const char*>(frame), len);
+    // Transmit-done: the driver has released DE with the last stop bit
+    const bool ok = written == (int)len && uart_wait_tx_done(kPort, pdMS_TO_TICKS(100)) == ESP_OK;
+    if (ok) {
+        portENTER_CRITICAL(&s_mux);
+        s_portStats.framesTx++;
+        s_portStats.bytesTx += len;
+        portEXIT_CRITICAL(&s_mux);
+    }
+    return ok;
+}
+
+bool rs485_port_receive(uint8_t* buf, size_t cap, size_t& len, uint32_t timeoutMs, int64_t* tUs) {
+    len = 0;
+    if (!s_portReady || !buf || !cap) return false;
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t wait = pdMS_TO_TICKS(timeoutMs);
+    for (;;) {
+        const TickType_t spent = xTaskGetTickCount() - start;
+        Rs485Frame* f = nullptr;
+        if (xQueueReceive(s_ready, &f, spent < wait ? wait - spent : 0) != pdTRUE) return false;
+        const int64_t firstUs = frameStartUs(*f);
+        if (firstUs < s_flushUs) {
+            s_frames.destroy(f);
+            continue;
+        }
+        len = f->len < cap ? f->len : cap;
+        memcpy(buf, f->data, len);
+        portENTER_CRITICAL(&s_mux);
+        if (f->cut || f->len > cap) s_portStats.overflows++;
+        s_portStats.framesRx++;
+        s_portStats.bytesRx += len;
+        portEXIT_CRITICAL(&s_mux);
+        s_frames.destroy(f);
+        if (tUs) *tUs = firstUs;
+        return true;
+    }
+}
+
+void rs485_port_flush_input() {
+    if (!s_portReady) return;
+    s_flushUs = esp_timer_get_time();
+    Rs485Frame* f = nullptr;
+    while (xQueueReceive(s_ready, &f, 0) == pdTRUE) s_frames.destroy(f);
+}
+
+void rs485_port_stats(Rs485PortStats& out) {
+    portENTER_CRITICAL(&s_mux);
+    out = s_portStats;
+    portEXIT_CRITICAL(&s_mux);
+}
 
 Rs485Adapter::Rs485Adapter()
     : stampPLC(nullptr), lastFrameTime(0), startTime(millis()), errorCount(0) {}
@@ -16,15 +238,19 @@ Rs485AdapterStatus Rs485Adapter::getStatus() {
         status.available = false;
         status.initialized = false;
         status.lastFrameTime = 0;
+        status.lastFrameAgeS = UINT32_MAX;
         status.lineVoltage = 0.0f;
-        status.statusText = "No StampPLC";
-        status.formattedSummary = "RS485: Module not available\nStatus: Offline";
         return status;
     }
 
     status.available = true;
     status.initialized = stampPLC->isReady();
+    // Frames the port received count as bus activity
+    Rs485PortStats port;
+    rs485_port_stats(port);
+    if (port.lastRxMs && (int32_t)(port.lastRxMs - lastFrameTime) > 0) lastFrameTime = port.lastRxMs;
     status.lastFrameTime = lastFrameTime;
+    status.lastFrameAgeS = getLastFrameAge();
 
     // Try to read line voltage from analog input (assuming AI0 is voltage sense)
     if (status.initialized) {
@@ -34,42 +260,37 @@ Rs485AdapterStatus Rs485Adapter::getStatus() {
         status.lineVoltage = 0.0f;
     }
 
-    // Determine status text
-    if (!status.initialized) {
-        status.statusText = "Not initialized";
-    } else if (getLastFrameAge() > 30) { // No frames for 30+ seconds
-        status.statusText = "Initialized but inactive";
-    } else {
-        status.statusText = "Active";
-    }
+    return status;
+}
 
-    // Format summary
-    status.formattedSummary = "RS485 Bus Status\n";
-    status.formattedSummary += "State: " + status.statusText + "\n";
-    status.formattedSummary += "Errors: " + String(status.errorCount) + "\n";
+const char* Rs485AdapterStatus::statusText() const {
+    if (!available) return "No StampPLC";
+    if (!initialized) return "Not initialized";
+    if (lastFrameAgeS > 30) return "Initialized but inactive";   // No frames for 30+ seconds
+    return "Active";
+}
 
-    if (status.lineVoltage > 0.1f) {
-        status.formattedSummary += "Line Voltage: " + String(status.lineVoltage, 2) + "V\n";
+size_t Rs485AdapterStatus::formatSummary(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    if (!available) {
+        t.print("RS485: Module not available\nStatus: Offline");
+        return t.length();
+    }
+    t.printf("RS485 Bus Status\nState: %s\nErrors: %lu\n", statusText(), (unsigned long)errorCount);
+    if (lineVoltage > 0.1f) {
+        t.printf("Line Voltage: %.2fV\n", (double)lineVoltage);
     } else {
-        status.formattedSummary += "Line Voltage: --\n";
+        t.print("Line Voltage: --\n");
     }
-
-    if (status.lastFrameTime > 0) {
-        uint32_t age = getLastFrameAge();
-        status.formattedSummary += "Last Frame: ";
-        if (age < 60) {
-            status.formattedSummary += String(age) + "s ago";
-        } else {
-            status.formattedSummary += String(age / 60) + "m ago";
-        }
+    if (lastFrameTime == 0) {
+        t.print("Last Frame: Never");
+    } else if (lastFrameAgeS < 60) {
+        t.printf("Last Frame: %lus ago", (unsigned long)lastFrameAgeS);
     } else {
-        status.formattedSummary += "Last Frame: Never";
+        t.printf("Last Frame: %lum ago", (unsigned long)(lastFrameAgeS / 60));
     }
-
-    status.formattedSummary += "\nUptime: " + String(status.uptimeSeconds / 60) + "m " +
-                               String(status.uptimeSeconds % 60) + "s";
-
-    return status;
+    t.printf("\nUptime: %lum %lus", (unsigned long)(uptimeSeconds / 60), (unsigned long)(uptimeSeconds % 60));
+    return t.length();
 }
 
 void Rs485Adapter::recordFrameReceived() {
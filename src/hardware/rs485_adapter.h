@@ -3,6 +3,64 @@
 #include <Arduino.h>
 #include "basic_stamplc.h"
 
+// RS485 transceiver (to be confirmed with the StamPLC wiring)
+#ifndef RS485_UART_NUM
+#define RS485_UART_NUM 1
+#endif
+#ifndef RS485_TX_PIN
+#define RS485_TX_PIN 0
+#endif
+#ifndef RS485_RX_PIN
+#define RS485_RX_PIN 39
+#endif
+#ifndef RS485_DE_PIN
+#define RS485_DE_PIN 46                    // driver enable on the UART's RTS, high while transmitting
+#endif
+#ifndef RS485_BAUD
+#define RS485_BAUD 19200
+#endif
+#define RS485_RX_BUFFER 512
+#define RS485_MAX_FRAME 256
+#define RS485_RX_FULL_THRESHOLD 120        // FIFO bytes per interrupt inside a long frame
+#define RS485_UART_EVENTS 16
+
+struct Rs485PortStats {
+    uint32_t baud;
+    uint32_t framesTx;
+    uint32_t framesRx;
+    uint32_t bytesTx;
+    uint32_t bytesRx;
+    uint32_t overflows;      // frames longer than RS485_MAX_FRAME or the caller's buffer, cut
+    uint32_t dropped;        // whole frames lost to a full frame queue
+    uint32_t lineErrors;     // framing/parity errors and FIFO or ring buffer overruns
+    uint32_t lastRxMs;
+};
+
+/**
+ * RS485 port - 8N1 frames on the half-duplex bus; a frame ends at a 3.5
+ * character gap (Modbus RTU). One task owns it.
+ *
+ * The UART runs in RS485 half-duplex mode, so the driver raises DE (RTS) for
+ * the transmit and drops it after the last stop bit. Frame ends come from the
+ * UART's RX timeout (TOUT): the hardware raises it once the line has been
+ * idle for the gap, in character times, and the Rs485Rx task closes the frame
+ * there and queues it whole with its time in a pooled slot. No CPU time goes
+ * into watching the gap, and a busy caller no longer splits frames.
+ */
+bool rs485_port_begin(uint32_t baud = RS485_BAUD);
+bool rs485_port_ready();
+// 3.5 characters, fixed at 1750 us above 19200 baud; the TOUT threshold is
+// the whole characters below it
+uint32_t rs485_frame_gap_us();
+// Returns after the last stop bit
+bool rs485_port_send(const uint8_t* frame, size_t len);
+// The next whole frame, waiting up to timeoutMs for it to end. tUs gets the
+// esp_timer_get_time() of its first byte, worked back from the frame end.
+bool rs485_port_receive(uint8_t* buf, size_t cap, size_t& len, uint32_t timeoutMs, int64_t* tUs = nullptr);
+// Drops frames received outside a transaction, including one still arriving
+void rs485_port_flush_input();
+void rs485_port_stats(Rs485PortStats& out);
+
 /**
  * RS485 Adapter - Reports RS485 bus availability, error counts, and last communication
  */
@@ -11,10 +69,13 @@ struct Rs485AdapterStatus {
     bool initialized;
     uint32_t errorCount;
     uint32_t lastFrameTime;
+    uint32_t lastFrameAgeS;      // UINT32_MAX before the first frame
     uint32_t uptimeSeconds;
     float lineVoltage; // If available from analog inputs
-    String statusText;
-    String formattedSummary;
+
+    // Formatted on demand, into the caller's buffer for the summary
+    const char* statusText() const;
+    size_t formatSummary(char* out, size_t size) const;
 
     // Helper to create from BasicStampPLC
     static Rs485AdapterStatus fromStampPLC(BasicStampPLC* stampPLC);
@@ -0,0 +1,160 @@
+/*
+ * Sensor Acquisition Implementation
+ */
+
+#include "sensor_acquisition.h"
+#include "analog_sampler.h"
+#include "../system/seqlock.h"
+#include "../system/service_task.h"
+#include "../system/energy_account.h"
+#include "../modules/logging/log_buffer.h"
+#include <M5StamPLC.h>
+#include <Wire.h>
+#include <esp_timer.h>
+
+extern m5::M5_STAMPLC M5StamPLC;
+
+namespace {
+constexpr uint8_t kRegConfig = 0x00;
+constexpr uint8_t kRegMaskEnable = 0x06;
+constexpr uint16_t kCvrf = 0x0008;           // conversion ready; cleared by reading Mask/Enable
+// Shunt and bus 1.1 ms each, continuous; 16 averages finish in ~35 ms
+constexpr uint16_t kConfig = 0x4000 | (SENSOR_INA226_AVG << 9) | (4 << 6) | (4 << 3) | 0x7;
+constexpr uint8_t kMaxBackoffShift = 6;
+
+// Retry state of one sensor
+struct Device {
+    bool ok;
+    uint8_t failures;        // consecutive, sets the backoff
+    uint32_t retryAtMs;
+};
+
+Device s_power = {};
+Device s_temp = {};
+PlcSensorSnapshot s_latest = {};
+SeqlockSnapshot<PlcSensorSnapshot> s_snapshot;
+SensorAcqStats s_stats = {};
+uint32_t s_nextTempMs = 0;
+int s_job = SERVICE_JOB_NONE;
+
+bool writeReg16(uint8_t reg, uint16_t value) {
+    Wire.beginTransmission(SENSOR_INA226_ADDR);
+    Wire.write(reg);
+    Wire.write((uint8_t)(value >> 8));
+    Wire.write((uint8_t)value);
+    return Wire.endTransmission() == 0;
+}
+
+bool readReg16(uint8_t reg, uint16_t& value) {
+    Wire.beginTransmission(SENSOR_INA226_ADDR);
+    Wire.write(reg);
+    if (Wire.endTransmission(false) != 0) return false;
+    if (Wire.requestFrom((uint8_t)SENSOR_INA226_ADDR, (uint8_t)2) != 2) return false;
+    value = (uint16_t)(Wire.read() << 8);
+    value |= (uint16_t)Wire.read();
+    return true;
+}
+
+// A failed init or read: next attempt after SENSOR_ACQ_RETRY_MS, doubling
+void failed(Device& d, const char* name, uint32_t now) {
+    s_stats.failures++;
+    if (d.ok) logbuf_printf("SensorAcq: %s stopped answering", name);
+    d.ok = false;
+    const uint8_t shift = d.failures < kMaxBackoffShift ? d.failures : kMaxBackoffShift;
+    if (d.failures < 255) d.failures++;
+    d.retryAtMs = now + ((uint32_t)SENSOR_ACQ_RETRY_MS << shift);
+}
+
+// True once the device answers; the first call and every due retry runs init
+bool ready(Device& d, const char* name, uint32_t now, bool (*init)()) {
+    if (d.ok) return true;
+    if ((int32_t)(now - d.retryAtMs) < 0) return false;
+    if (d.failures) s_stats.retries++;
+    if (!init()) {
+        failed(d, name, now);
+        return false;
+    }
+    if (d.failures) logbuf_printf("SensorAcq: %s back after %u attempts", name, (unsigned)d.failures);
+    d.ok = true;
+    d.failures = 0;
+    return true;
+}
+
+bool initPower() {
+    return M5StamPLC.INA226.begin() && writeReg16(kRegConfig, kConfig);
+}
+
+bool initTemp() {
+    return M5StamPLC.LM75B.begin();
+}
+
+// One batch: the INA226 when a new average is ready, the LM75B when due
+void acquireJob(void*) {
+    const int64_t start = esp_timer_get_time();
+    const uint32_t now = millis();
+    bool changed = false;
+
+    if (ready(s_power, "INA226", now, initPower)) {
+        uint16_t mask = 0;
+        if (!readReg16(kRegMaskEnable, mask)) {
+            failed(s_power, "INA226", now);
+        } else if (mask & kCvrf) {
+            s_latest.busVoltage = M5StamPLC.INA226.getBusVoltage();
+            s_latest.current = M5StamPLC.INA226.getShuntCurrent();
+            s_latest.powerMs = now;
+            s_stats.powerReads++;
+            analog_sampler_push(AnalogChannel::BusVoltage, (int32_t)lroundf(s_latest.busVoltage * 1000.0f));
+            analog_sampler_push(AnalogChannel::BusCurrent, (int32_t)lroundf(s_latest.current * 1000.0f));
+            energy_current(s_latest.current, now);
+            changed = true;
+        } else {
+            s_stats.notReady++;
+        }
+    }
+
+    if ((int32_t)(now - s_nextTempMs) >= 0) {
+        s_nextTempMs = now + SENSOR_ACQ_TEMP_MS;
+        if (ready(s_temp, "LM75B", now, initTemp)) {
+            s_latest.temperature = M5StamPLC.getTemp();
+            s_latest.tempMs = now;
+            s_stats.tempReads++;
+            changed = true;
+        }
+    }
+
+    if (changed || s_latest.powerOk != s_power.ok || s_latest.tempOk != s_temp.ok) {
+        s_latest.powerOk = s_power.ok;
+        s_latest.tempOk = s_temp.ok;
+        s_snapshot.write(s_latest);
+    }
+    s_stats.lastJobUs = (uint32_t)(esp_timer_get_time() - start);
+    if (s_stats.lastJobUs > s_stats.maxJobUs) s_stats.maxJobUs = s_stats.lastJobUs;
+}
+} // namespace
+
+bool sensor_acq_begin() {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    s_job = service_job_add("SensorAcq", acquireJob, nullptr, SENSOR_ACQ_PERIOD_MS, SENSOR_ACQ_JOB_BUDGET_US);
+    return s_job != SERVICE_JOB_NONE;
+}
+
+PlcSensorSnapshot sensor_acq_snapshot() {
+    return s_snapshot.read();
+}
+
+void sensor_acq_stats(SensorAcqStats& out) {
+    out = s_stats;
+}
+
+void sensor_acq_report(Print& out) {
+    const PlcSensorSnapshot s = sensor_acq_snapshot();
+    const uint32_t now = millis();
+    out.printf("Sensors: INA226 %s %.2fV %.0fmA (%lu ms old), LM75B %s %.1fC (%lu ms old)\n",
+               s.powerOk ? "ok" : "down", s.busVoltage, s.current * 1000.0f,
+               (unsigned long)(s.powerMs ? now - s.powerMs : 0), s.tempOk ? "ok" : "down", s.temperature,
+               (unsigned long)(s.tempMs ? now - s.tempMs : 0));
+    out.printf("  reads %lu power, %lu temp; %lu not ready, %lu failures, %lu retries; job %lu us (max %lu)\n",
+               (unsigned long)s_stats.powerReads, (unsigned long)s_stats.tempReads, (unsigned long)s_stats.notReady,
+               (unsigned long)s_stats.failures, (unsigned long)s_stats.retries, (unsigned long)s_stats.lastJobUs,
+               (unsigned long)s_stats.maxJobUs);
+}
@@ -0,0 +1,69 @@
+/*
+ * Sensor Acquisition
+ * One owner for the I2C sensor reads (INA226 power monitor, LM75B
+ * temperature), so no scan loop, page draw or monitor blocks on the bus:
+ *   - a service job reads the sensors in one batch every SENSOR_ACQ_PERIOD_MS
+ *     and publishes a SeqlockSnapshot; the UI state, the power manager's
+ *     current sampler and the sensor range checks read that copy
+ *   - the INA226 is set to average SENSOR_INA226_AVG conversions in hardware;
+ *     the job reads it only when its conversion-ready flag (CVRF in the
+ *     Mask/Enable register) is set, so it never waits on a conversion and each
+ *     reading is a fresh average. The LM75B is read every SENSOR_ACQ_TEMP_MS.
+ *   - a sensor that fails to initialise or stops answering is retried from the
+ *     job with exponential backoff (SENSOR_ACQ_RETRY_MS up to 64x), not inline
+ *
+ * The bus is shared with the I/O expander and RTC drivers of M5StamPLC, so the
+ * reads stay blocking transactions on the common driver; they just run in one
+ * place, off every latency-sensitive path.
+ */
+
+#ifndef SENSOR_ACQUISITION_H
+#define SENSOR_ACQUISITION_H
+
+#include <Arduino.h>
+
+#ifndef SENSOR_ACQ_PERIOD_MS
+#define SENSOR_ACQ_PERIOD_MS 100
+#endif
+#ifndef SENSOR_ACQ_TEMP_MS
+#define SENSOR_ACQ_TEMP_MS 1000
+#endif
+#ifndef SENSOR_ACQ_RETRY_MS
+#define SENSOR_ACQ_RETRY_MS 5000
+#endif
+#ifndef SENSOR_INA226_ADDR
+#define SENSOR_INA226_ADDR 0x40
+#endif
+#ifndef SENSOR_INA226_AVG
+#define SENSOR_INA226_AVG 2                // CONFIG.AVG code: 0=1, 1=4, 2=16, 3=64 ... samples
+#endif
+#define SENSOR_ACQ_JOB_BUDGET_US 3000
+
+struct PlcSensorSnapshot {
+    bool powerOk;            // INA226 answering
+    bool tempOk;             // LM75B answering
+    float busVoltage;        // V
+    float current;           // A
+    float temperature;       // °C
+    uint32_t powerMs;        // millis() of the last INA226 reading
+    uint32_t tempMs;
+};
+
+struct SensorAcqStats {
+    uint32_t powerReads;
+    uint32_t tempReads;
+    uint32_t notReady;       // INA226 polls with no new average
+    uint32_t failures;       // transactions or inits that failed
+    uint32_t retries;        // re-inits attempted
+    uint32_t lastJobUs;
+    uint32_t maxJobUs;
+};
+
+// Schedules the acquisition job; the first reading follows one period later
+bool sensor_acq_begin();
+
+PlcSensorSnapshot sensor_acq_snapshot();
+void sensor_acq_stats(SensorAcqStats& out);
+void sensor_acq_report(Print& out);
+
+#endif // SENSOR_ACQUISITION_H
@@ -4,6 +4,7 @@
  */
 
 #include "stamp_plc.h"
+#include "sensor_acquisition.h"
 #include <M5StamPLC.h>
 #include <M5GFX.h>
 
@@ -79,6 +80,7 @@ bool StampPLC::initializeHardware() {
 
     // Call begin() but it will be safe since M5StamPLC.begin() was already called
     stamPLC->begin();
+    io.attach(stamPLC);
 
     // Initialize INA226 current sensor
     ina226Available = stamPLC->INA226.begin();
@@ -115,8 +117,7 @@ bool StampPLC::setRelayOutput(uint8_t channel, bool state) {
     if (channel >= 4) return false;
     
     if (xSemaphoreTake(xSemaphorePLC, pdMS_TO_TICKS(100)) == pdTRUE) {
-        // Set relay state
-        stamPLC->writePlcRelay(channel, state);
+        // Goes out with the other relays on the next updateRelayOutputs()
         currentData.relayOutputs[channel] = state;
         xSemaphoreGive(xSemaphorePLC);
         return true;
@@ -342,9 +343,10 @@ void StampPLC::taskWrapper(void* pvParameters) {
 
 void StampPLC::updateDigitalInputs() {
     if (xSemaphoreTake(xSemaphorePLC, pdMS_TO_TICKS(10)) == pdTRUE) {
-        // Read digital inputs from M5Stack StampPLC
+        // All eight inputs in one expander read
+        const uint8_t bits = io.readInputs();
         for (int i = 0; i < 8; i++) {
-            currentData.digitalInputs[i] = stamPLC->readPlcInput(i);
+            currentData.digitalInputs[i] = (bits >> i) & 1;
         }
         currentData.timestamp = millis();
         xSemaphoreGive(xSemaphorePLC);
@@ -353,23 +355,13 @@ void StampPLC::updateDigitalInputs() {
 
 void StampPLC::updateAnalogSensors() {
     if (xSemaphoreTake(xSemaphorePLC, pdMS_TO_TICKS(10)) == pdTRUE) {
-        // Read INA226 current sensor (retry init if it previously failed)
-        if (!ina226Available) {
-            ina226Available = stamPLC->INA226.begin();
-        }
-        if (ina226Available) {
-            currentData.voltage = stamPLC->getPowerVoltage();
-            currentData.current = stamPLC->getIoSocketOutputCurrent();
-        } else {
-            currentData.voltage = 0.0f;
-            currentData.current = 0.0f;
-        }
-
-        // Read LM75B temperature sensor (retry init if it previously failed)
-        if (!lm75bAvailable) {
-            lm75bAvailable = stamPLC->LM75B.begin();
-        }
-        currentData.temperature = lm75bAvailable ? stamPLC->getTemp() : 0.0f;
+        // INA226 and LM75B are read (and re-initialised) by the acquisition job
+        const PlcSensorSnapshot s = sensor_acq_snapshot();
+        ina226Available = s.powerOk;
+        lm75bAvailable = s.tempOk;
+        currentData.voltage = s.powerOk ? s.busVoltage : 0.0f;
+        currentData.current = s.powerOk ? s.current : 0.0f;
+        currentData.temperature = s.tempOk ? s.temperature : 0.0f;
 
         xSemaphoreGive(xSemaphorePLC);
     }
@@ -377,8 +369,12 @@ void StampPLC::updateAnalogSensors() {
 
 void StampPLC::updateRelayOutputs() {
     if (xSemaphoreTake(xSemaphorePLC, pdMS_TO_TICKS(10)) == pdTRUE) {
-        // Update relay states (they're already set via setRelayOutput)
-        // This is just for consistency
+        // One write for all four relays, none when nothing changed
+        uint8_t image = 0;
+        for (int i = 0; i < 4; i++) {
+            if (currentData.relayOutputs[i]) image |= 1 << i;
+        }
+        io.writeRelays(image);
         xSemaphoreGive(xSemaphorePLC);
     }
 }
@@ -13,6 +13,7 @@
 #include <freertos/semphr.h>
 #include <freertos/queue.h>
 #include <freertos/task.h>
+#include "plc_io.h"
 
 // Forward declarations
 struct PLCData;
@@ -71,6 +72,7 @@ class StampPLC {
 private:
     // M5Stack StampPLC instance
     m5::M5_STAMPLC* stamPLC;
+    PlcIoImage io;               // used with xSemaphorePLC held
     
     // FreeRTOS synchronization
     SemaphoreHandle_t xSemaphorePLC;
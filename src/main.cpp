@@ -23,26 +23,55 @@
 #include "../include/memory_monitor.h"
 #include "../include/ui_utils.h"
 #include "system/crash_recovery.h"
+#include "system/kernel_objects.h"
+#include "system/cpu_profiler.h"
+#include "system/stack_profiler.h"
+#include "system/trace_recorder.h"
+#include "system/mutex_profiler.h"
+#include "system/core_affinity.h"
+#include "system/power_manager.h"
+#include "system/energy_account.h"
+#include "system/boot_profile.h"
+#include "system/work_queue.h"
+#include "system/service_task.h"
 #include "system/memory_safety.h"
 #include "system/rtc_manager.h"
 #include "system/time_utils.h"
 #include "system/storage_utils.h"
+#include "system/parser_bench.h"
+#include "system/soak_bench.h"
+#include "system/load_shed.h"
 
 // Include our modules
 #include "hardware/basic_stamplc.h"
+#include "hardware/button_input.h"
+#include "hardware/sensor_acquisition.h"
+#include "hardware/plc_scan.h"
+#include "hardware/plc_logic.h"
+#include "hardware/alarm_eval.h"
+#include "hardware/analog_sampler.h"
+#include "system/dsp_kernels.h"
+#include "modules/settings/hour_meter.h"
+#include "hardware/modbus_master.h"
+#include "hardware/modbus_slave.h"
 #include "modules/catm_gnss/catm_gnss_module.h"
 #include "modules/catm_gnss/catm_gnss_task.h"
-#include "modules/catm_gnss/gnss_status.h"
 #include "modules/catm_gnss/network_utils.h"
 #include "config/system_config.h"
 #include "modules/pwrcan/pwrcan_module.h"
 #include "modules/storage/sd_card_module.h"
 #include "modules/storage/storage_task.h"
+#include "modules/storage/log_compactor.h"
+#include "modules/storage/sd_benchmark.h"
 #include "modules/settings/settings_store.h"
+#include "modules/transport/live_config.h"
 #include "ui/theme.h"
 #include "ui/components.h"
 #include "ui/ui_constants.h"
 #include "ui/ui_types.h"
+#include "ui/ui_frame.h"
+#include "ui/ui_state.h"
+#include "ui/ui_perf.h"
 #include "ui/pages/landing_page.h"
 #include "ui/pages/gnss_page.h"
 #include "ui/pages/cellular_page.h"
@@ -51,6 +80,7 @@
 #include "ui/pages/logs_page.h"
 #include "ui/components/ui_widgets.h"
 #include "ui/components/icon_manager.h"
+#include "ui/components/status_bar.h"
 #include "ui/boot_screen.h"
 
 // Legacy UI runs directly on M5GFX framebuffer (LVGL removed)
@@ -73,10 +103,6 @@ void updateSystemLED();
 // StamPLC RGB LED is controlled via M5StamPLC::SetStatusLight()
 // No direct GPIO control needed
 #define SERIAL_BAUD 115200
-// Prefer per-task sizes from task_config.h where safe. Values are in words.
-#ifndef TASK_STACK_SIZE
-#define TASK_STACK_SIZE 4096
-#endif
 
 // ============================================================================
 // GLOBAL VARIABLES
@@ -88,9 +114,7 @@ PWRCANModule* pwrcanModule = nullptr;
 SDCardModule* sdModule = nullptr;
 
 // Task handles
-TaskHandle_t buttonTaskHandle = nullptr;
 TaskHandle_t displayTaskHandle = nullptr;
-TaskHandle_t statusBarTaskHandle = nullptr;
 
 // System event group for task coordination
 EventGroupHandle_t xEventGroupSystemStatus = nullptr;
@@ -98,11 +122,9 @@ TaskHandle_t stampPLCTaskHandle = nullptr;
 TaskHandle_t catmGnssTaskHandle = nullptr;
 TaskHandle_t pwrcanTaskHandle = nullptr;
 TaskHandle_t storageTaskHandle = nullptr;
+TaskHandle_t logCompactorTaskHandle = nullptr;
 // Web task removed - web server functionality not required
 
-// Shared connectivity flags consumed by CAT-M
-volatile bool g_cellularUp = false;
-
 // UI event queue
 enum class UIEventType {
     GoLanding,
@@ -125,12 +147,13 @@ static QueueHandle_t g_uiQueue = nullptr;
 static uint32_t g_uiEventDrops = 0;
 
 // Mutex for protecting shared UI state
-static SemaphoreHandle_t g_uiStateMutex = nullptr;
 static String g_commFailureDescription = "Ensure CatM+GNSS unit is connected to Grove Port C (G4/G5).";
 
 // BootLogEntry moved to ui/boot_screen.cpp (internal use only)
 
-static bool enqueueUIEvent(UIEventType type, TickType_t waitTicks = pdMS_TO_TICKS(25)) {
+// From tasks other than the display task; buttons reach it through their own
+// ring (hardware/button_input.h). A full queue already holds pending redraws.
+static bool enqueueUIEvent(UIEventType type, TickType_t waitTicks = 0) {
     if (!g_uiQueue) return false;
     UIEvent ev{type};
     if (xQueueSend(g_uiQueue, &ev, waitTicks) != pdTRUE) {
@@ -139,6 +162,8 @@ static bool enqueueUIEvent(UIEventType type, TickType_t waitTicks = pdMS_TO_TICK
         }
         return false;
     }
+    TRACE_USER(UiEventSend, type);
+    ui_frame_request();
     return true;
 }
 
@@ -148,44 +173,12 @@ static bool enqueueUIEvent(UIEventType type, TickType_t waitTicks = pdMS_TO_TICK
 volatile DisplayPage currentPage = DisplayPage::LANDING_PAGE;
 volatile bool pageChanged = false;
 
-// Status bar sprite & cache
-// Note: M5GFX maintains compatibility with lgfx namespace, so lgfx::LGFX_Sprite works correctly
-lgfx::LGFX_Sprite statusSprite(&M5StamPLC.Display);
-bool statusSpriteInit = false;
-static bool lastGnssOk = false;
-static bool lastCellOk = false;
-static uint32_t lastStatusUpdate = 0;
-static uint8_t lastCellularSignal = 0;
-static uint8_t lastGnssSatellites = 0;
-static char lastTimeStr[32] = "";
-
-// Icon sprites for UI elements (declared here for access by icon_manager.cpp)
-// Note: M5GFX maintains compatibility with lgfx namespace, so lgfx::LGFX_Sprite works correctly
-lgfx::LGFX_Sprite iconSatellite(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconGear(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconTower(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconWrench(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconGPS(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconCellular(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconLog(&M5StamPLC.Display);
-// Larger icons for launcher card
-lgfx::LGFX_Sprite iconSatelliteBig(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconGearBig(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconTowerBig(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconWrenchBig(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconGPSBig(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconCellularBig(&M5StamPLC.Display);
-lgfx::LGFX_Sprite iconLogBig(&M5StamPLC.Display);
 bool iconsInitialized = false;
 
-// Content sprite for card-based pages
-lgfx::LGFX_Sprite contentSprite(&M5StamPLC.Display);
-bool contentSpriteInit = false;
-
 // Simple page transition tracking: -1 = prev (slide right), 1 = next (slide left), 0 = none
 static int8_t g_lastNavDir = 0;
-bool g_cntpSyncedThisSession = false; // Used by rtc_manager.cpp
-bool g_lastCellularNtpUsedCntp = false; // Used by rtc_manager.cpp
+bool g_cntpSyncedThisSession = false; // Used by time_utils.cpp
+bool g_lastCellularNtpUsedCntp = false; // Used by time_utils.cpp
 
 // ===================== Modal / Hot-plug State =====================
 enum class ModalType { NONE, NO_COMM_UNIT };
@@ -198,6 +191,13 @@ static uint32_t g_retryToastUntilMs = 0;
 
 static void drawModalOverlay();
 static void tryInitCatMIfAbsent(bool forced);
+static void catmProbeJob(void*) { tryInitCatMIfAbsent(true); }
+static bool catmBootStage(void*);
+// Power manager current sampler; the latest reading of the acquisition job
+static float inaCurrentA() {
+    const PlcSensorSnapshot s = sensor_acq_snapshot();
+    return s.powerOk && s.powerMs ? s.current : NAN;
+}
 
 // Time utilities moved to system/time_utils.cpp
 
@@ -255,7 +255,8 @@ uint8_t displayBrightness = 100;           // Default brightness (0-255)
 
 // Crash recovery helper functions
 void reduceDisplayRefreshRate() {
-    // Reduce display refresh rate to save CPU cycles and memory
+    // Stretch every page's poll timer and frame cap to save CPU cycles
+    ui_frame_set_slowdown(4);
     Serial.println("CrashRecovery: Reducing display refresh rate");
 }
 
@@ -265,231 +266,99 @@ void reduceLoggingLevel() {
 }
 
 // ============================================================================
-// TASK DECLARATIONS
+// BUTTON ACTIONS
 // ============================================================================
-void vTaskButton(void* pvParameters) {
-    // Explicit startup logging
-    Serial.println("[Button] Task starting...");
-    Serial.flush();
-    
-    const TickType_t kButtonPeriod = pdMS_TO_TICKS(20);
-    TickType_t nextWake = xTaskGetTickCount();
-
-    // Long press threshold
-    const uint32_t LONG_MS = 500;
-    bool aHandled = false, bHandled = false, cHandled = false;
-    
-    // Diagnostic counters
-    static uint32_t stampPLCNullCount = 0;
-    static uint32_t notReadyCount = 0;
-    static uint32_t buttonNullCount = 0;
-
-    for (;;) {
-        if (stampPLC) {
-            stampPLC->update();
-        } else {
-            // Log if stampPLC is null periodically
-            if (stampPLCNullCount++ % 250 == 0) { // Every ~5 seconds at 20ms period
-                Serial.println("[Button] WARNING: stampPLC is null");
-                Serial.flush();
-            }
+// Display task: what a button event from hardware/button_input.h means on the
+// page on screen; at most one UI event per button event. Short presses act on
+// the press, long ones once the hold passes BUTTON_LONG_MS.
+static bool buttonUIEvent(const ButtonEvent& b, UIEventType& out) {
+    const bool press = b.action == ButtonAction::Press;
+    if (press) lastDisplayActivity = millis();   // wakes a sleeping panel
+
+    // A modal dialog takes A (dismiss) and C (retry); navigation waits
+    if (g_modalActive) {
+        if (!press) return false;
+        if (b.button == ButtonId::A) {
+            Serial.println("[Button] Modal dismissed (A pressed)");
+            g_modalActive = false;
+            g_modalType = ModalType::NONE;
+            out = UIEventType::Redraw;
+            return true;
         }
-
-        // Update LVGL button states (critical for LVGL keypad input)
-        #if LVGL_UI_TEST_MODE
-        ui_update_button_states();
-        vTaskDelayUntil(&nextWake, kButtonPeriod);
-        continue; // Skip old button handling when LVGL is enabled
-        #endif
-
-        if (!stampPLC) {
-            if (stampPLCNullCount++ % 250 == 0) {
-                Serial.println("[Button] stampPLC null - waiting");
-            }
-            vTaskDelayUntil(&nextWake, kButtonPeriod);
-            continue;
-        }
-        
-        if (!stampPLC->isReady()) {
-            if (notReadyCount++ % 250 == 0) {
-                Serial.println("[Button] stampPLC not ready - waiting");
-            }
-            vTaskDelayUntil(&nextWake, kButtonPeriod);
-            continue;
-        }
-        
-        auto* stamPLC = stampPLC->getStamPLC();
-        if (!stamPLC) {
-            if (buttonNullCount++ % 250 == 0) {
-                Serial.println("[Button] getStamPLC() returned null - waiting");
-                Serial.flush();
-            }
-            vTaskDelayUntil(&nextWake, kButtonPeriod);
-            continue;
-        }
-
-        // Get button references - these are member variables, not pointers
-        // The address operator & returns a valid pointer, so null checks on btnA/B/C are redundant
-        // but kept for defensive programming
-        auto* btnA = &stamPLC->BtnA;
-        auto* btnB = &stamPLC->BtnB;
-        auto* btnC = &stamPLC->BtnC;
-        
-        // First-time initialization log
-        static bool firstRun = true;
-        if (firstRun) {
-            Serial.println("[Button] Successfully accessing buttons");
-            Serial.flush();
-            firstRun = false;
-        }
-
-        // Determine if we are on landing page (card launcher) or in a detail page
-        bool onLanding = (currentPage == DisplayPage::LANDING_PAGE);
-
-        // Wake display on any button press - with null checks
-        bool anyPressed = (btnA && btnA->wasPressed()) || 
-                          (btnB && btnB->wasPressed()) || 
-                          (btnC && btnC->wasPressed());
-        if (anyPressed) {
-            lastDisplayActivity = millis();
-        }
-
-        // If a modal dialog is active, intercept A/C buttons for modal actions
-        if (g_modalActive) {
-            // Check for button presses with explicit logging
-            bool aPressed = btnA && btnA->wasPressed();
-            bool cPressed = btnC && btnC->wasPressed();
-            
-            if (aPressed || cPressed) {
-                Serial.printf("[Button] Modal: A=%d C=%d\n", aPressed ? 1 : 0, cPressed ? 1 : 0);
-                Serial.flush();
-            }
-            
-            if (aPressed) {
-                // Dismiss modal
-                Serial.println("[Button] Modal dismissed (A pressed)");
-                Serial.flush();
-                g_modalActive = false;
-                g_modalType = ModalType::NONE;
-                enqueueUIEvent(UIEventType::Redraw);
-            }
-            if (cPressed) {
-                // Request immediate retry; leave modal visible
-                Serial.println("[Button] Modal retry (C pressed)");
-                Serial.flush();
-                g_forceCatMRetry = true;
-                g_retryToastActive = true;
-                g_retryToastUntilMs = millis() + 1500; // show for 1.5s
-                // Trigger retry immediately
-                tryInitCatMIfAbsent(true);
-            }
-            vTaskDelayUntil(&nextWake, kButtonPeriod);
-            continue; // Don't process normal navigation while modal active
+        if (b.button == ButtonId::C) {
+            // Request immediate retry; leave modal visible
+            Serial.println("[Button] Modal retry (C pressed)");
+            g_forceCatMRetry = true;
+            g_retryToastActive = true;
+            g_retryToastUntilMs = millis() + 1500; // show for 1.5s
+            // Trigger retry on the modem-side worker; the probe blocks for seconds
+            work_submit("CatMProbe", catmProbeJob, nullptr, WorkPriority::High, WORK_CORE_MODEM, WORK_COALESCE);
         }
+        return false;
+    }
 
-        if (onLanding) {
-            // Long-press navigation from landing page
-            if (btnA && btnA->pressedFor(LONG_MS) && !aHandled) {
-                enqueueUIEvent(UIEventType::GoCELL);
-                aHandled = true;
+    switch (currentPage) {
+        case DisplayPage::LANDING_PAGE:
+            // Long-press navigation from the card launcher
+            if (press) return false;
+            if (b.button == ButtonId::A) {
+                out = UIEventType::GoCELL;
                 DEBUG_LOG_BUTTON_PRESS("A", "GoCELL (long press)");
-            } else if (btnA && !btnA->isPressed() && currentPage != DisplayPage::SETTINGS_PAGE) { aHandled = false; }
-            if (btnB && btnB->pressedFor(LONG_MS) && !bHandled) {
-                enqueueUIEvent(UIEventType::GoGNSS);
-                bHandled = true;
+            } else if (b.button == ButtonId::B) {
+                out = UIEventType::GoGNSS;
                 DEBUG_LOG_BUTTON_PRESS("B", "GoGNSS (long press)");
-            } else if (btnB && !btnB->isPressed() && currentPage != DisplayPage::SETTINGS_PAGE) { bHandled = false; }
-            if (btnC && btnC->pressedFor(LONG_MS) && !cHandled) {
-                enqueueUIEvent(UIEventType::GoSYS);
-                cHandled = true;
+            } else {
+                out = UIEventType::GoSYS;
                 DEBUG_LOG_BUTTON_PRESS("C", "GoSYS (long press)");
-            } else if (btnC && !btnC->isPressed() && currentPage != DisplayPage::SETTINGS_PAGE) { cHandled = false; }
-        } else if (currentPage == DisplayPage::SETTINGS_PAGE) {
-            // SETTINGS PAGE: Special button handling
+            }
+            return true;
+        case DisplayPage::SETTINGS_PAGE: {
             // A = back to landing
             // B short = select previous item, B long = decrease value
             // C short = select next item, C long = increase value
-            if (btnA && btnA->wasPressed()) {
-                enqueueUIEvent(UIEventType::GoLanding);
-            }
-
-            // B button: long press = adjust down, short press = prev item
-            if (btnB && btnB->pressedFor(LONG_MS) && !bHandled) {
-                settingsAdjustValue(-1);  // Decrease
-                enqueueUIEvent(UIEventType::Redraw);
-                bHandled = true;
-            } else if (btnB && !btnB->isPressed()) {
-                bHandled = false;
-            } else if (btnB && btnB->wasPressed()) {
-                // Move to previous settings item
-                SettingsItem cur = settingsGetSelected();
-                if (cur == SettingsItem::BRIGHTNESS) {
-                    settingsSetSelected(SettingsItem::SLEEP_TIMEOUT);
-                } else {
-                    settingsSetSelected((SettingsItem)((uint8_t)cur - 1));
-                }
-                enqueueUIEvent(UIEventType::Redraw);
+            if (b.button == ButtonId::A) {
+                out = UIEventType::GoLanding;
+                return press;
             }
-
-            // C button: long press = adjust up, short press = next item
-            if (btnC && btnC->pressedFor(LONG_MS) && !cHandled) {
-                settingsAdjustValue(+1);  // Increase
-                enqueueUIEvent(UIEventType::Redraw);
-                cHandled = true;
-            } else if (btnC && !btnC->isPressed()) {
-                cHandled = false;
-            } else if (btnC && btnC->wasPressed()) {
-                // Move to next settings item
-                SettingsItem cur = settingsGetSelected();
-                if (cur == SettingsItem::SLEEP_TIMEOUT) {
-                    settingsSetSelected(SettingsItem::BRIGHTNESS);
-                } else {
-                    settingsSetSelected((SettingsItem)((uint8_t)cur + 1));
-                }
-                enqueueUIEvent(UIEventType::Redraw);
+            const bool up = b.button == ButtonId::C;
+            if (!press) {
+                settingsAdjustValue(up ? +1 : -1);
+            } else {
+                const uint8_t count = (uint8_t)SettingsItem::ITEM_COUNT;
+                const uint8_t cur = (uint8_t)settingsGetSelected();
+                settingsSetSelected((SettingsItem)(up ? (cur + 1) % count : (cur + count - 1) % count));
             }
-        } else {
+            out = UIEventType::Redraw;
+            return true;
+        }
+        default:
             // OTHER PAGES: A=HOME (back). B/C short=Scroll Up/Down. B/C long=Prev/Next page.
-            if (btnA && btnA->wasPressed()) {
-                enqueueUIEvent(UIEventType::GoLanding);
-            }
-
-            // B button: long press = prev page, short press = scroll up
-            if (btnB && btnB->pressedFor(LONG_MS) && !bHandled) {
-                enqueueUIEvent(UIEventType::PrevPage);
-                bHandled = true;
-            } else if (btnB && !btnB->isPressed()) {
-                bHandled = false;
-            } else if (btnB && btnB->wasPressed()) {
-                enqueueUIEvent(UIEventType::ScrollUp);
+            if (b.button == ButtonId::A) {
+                out = UIEventType::GoLanding;
+                return press;
             }
+            if (b.button == ButtonId::B) out = press ? UIEventType::ScrollUp : UIEventType::PrevPage;
+            else out = press ? UIEventType::ScrollDown : UIEventType::NextPage;
+            return true;
+    }
+}
 
-            // C button: long press = next page, short press = scroll down
-            if (btnC && btnC->pressedFor(LONG_MS) && !cHandled) {
-                enqueueUIEvent(UIEventType::NextPage);
-                cHandled = true;
-            } else if (btnC && !btnC->isPressed()) {
-                cHandled = false;
-            } else if (btnC && btnC->wasPressed()) {
-                enqueueUIEvent(UIEventType::ScrollDown);
-            }
-        }
-        
-        // Debug every 5s - only use buttons that are within scope
-        static uint32_t lastDebugTime = 0;
-        if (millis() - lastDebugTime > 5000) {
-            Serial.printf("[Button] A:%d B:%d C:%d | page:%d modal:%d | sleep:%s\n",
-                          (btnA ? btnA->isPressed() : 0), 
-                          (btnB ? btnB->isPressed() : 0), 
-                          (btnC ? btnC->isPressed() : 0),
-                          (int)currentPage, g_modalActive ? 1 : 0,
-                          displayAsleep ? "YES" : "NO");
-            Serial.flush();
-            lastDebugTime = millis();
+// Oldest button event whose effect is not on the panel yet
+static bool s_inputPending = false;
+static uint32_t s_inputUs = 0;
+
+// Display task: button events first, then those other tasks queued
+static bool nextUIEvent(UIEvent& ev) {
+    ButtonEvent b;
+    while (button_input_pop(b)) {
+        if (!buttonUIEvent(b, ev.type)) continue;
+        if (!s_inputPending) {
+            s_inputPending = true;
+            s_inputUs = b.atUs;
         }
-
-        vTaskDelayUntil(&nextWake, kButtonPeriod);
+        return true;
     }
+    return g_uiQueue && xQueueReceive(g_uiQueue, &ev, 0) == pdTRUE;
 }
 
 void vTaskStampPLC(void* pvParameters) {
@@ -499,29 +368,100 @@ void vTaskStampPLC(void* pvParameters) {
         return;
     }
 
-    const TickType_t kPlcPeriod = pdMS_TO_TICKS(100);
-    TickType_t nextWake = xTaskGetTickCount();
+    // Fixed-period input / logic / output scan (hardware/plc_scan.h)
+    plc_scan_run(stampPLC);
+}
 
-    for (;;) {
-        // Print status every 5 seconds
-        static uint32_t lastStatusTime = 0;
-        if (millis() - lastStatusTime > 5000) {
-            stampPLC->printStatus();
-            lastStatusTime = millis();
-        }
+// PLC status print, every 5 seconds, off the scan task
+static void plcStatusJob(void*) {
+    if (stampPLC) stampPLC->printStatus();
+}
 
-        vTaskDelayUntil(&nextWake, kPlcPeriod);
+#if SOAK_BENCH_ENABLE
+// Soak scenario: the pages in turn, with a scroll on the settings page, as if pressed
+static void soakPageStep(uint32_t step) {
+    static const UIEventType kSteps[SOAK_BENCH_PAGES] = {
+        UIEventType::GoLanding, UIEventType::GoGNSS, UIEventType::GoCELL,
+        UIEventType::GoSYS, UIEventType::GoSETTINGS, UIEventType::ScrollDown,
+    };
+    lastDisplayActivity = millis();   // keeps the panel awake
+    enqueueUIEvent(kSteps[step % SOAK_BENCH_PAGES]);
+}
+#endif
+
+// Page shown by the display task; the renderer calls back into it for partial redraws
+static DisplayPage s_renderedPage = DisplayPage::LANDING_PAGE;
+
+// What wakes the display task for each page besides UI events
+static UiFrameSchedule pageSchedule(DisplayPage page) {
+    switch (page) {
+        case DisplayPage::LANDING_PAGE:   // clock, heap and SD free change with time
+            return {UI_DATA_BIT(Cellular) | UI_DATA_BIT(Gnss), UI_REFRESH_MS, 250};
+        case DisplayPage::GNSS_PAGE:
+            return {UI_DATA_BIT(Gnss), 0, 250};
+        case DisplayPage::CELLULAR_PAGE:
+            return {UI_DATA_BIT(Cellular), 0, 250};
+        case DisplayPage::SYSTEM_PAGE:    // heap, CPU and uptime
+            return {0, UI_REFRESH_MS, 500};
+        case DisplayPage::LOGS_PAGE:
+            return {UI_DATA_BIT(Logs), 0, 250};
+        case DisplayPage::SETTINGS_PAGE:
+        default:
+            return {0, 0, 0};
     }
 }
 
+// Once per frame, before the page's passes: everything they show is pinned here
+static void beginFrame() {
+    ui_state_capture();
+    if (s_renderedPage == DisplayPage::LOGS_PAGE) logsPageBeginFrame();
+}
+
+// The compositor's regions: the status bar refreshes on its own timer
+// (STATUS_BAR_REFRESH_MS), the page below it on its UiFrameSchedule
+static void drawRenderedPage() {
+    drawStatusBar();
+    switch (s_renderedPage) {
+        case DisplayPage::LANDING_PAGE:
+            drawLandingPage();
+            break;
+        case DisplayPage::GNSS_PAGE:
+            drawGNSSPage();
+            break;
+        case DisplayPage::CELLULAR_PAGE:
+            drawCellularPage();
+            break;
+        case DisplayPage::SYSTEM_PAGE:
+            drawSystemPage();
+            break;
+        case DisplayPage::SETTINGS_PAGE:
+            drawSettingsPage();
+            break;
+        case DisplayPage::LOGS_PAGE:
+            drawLogsPage();
+            break;
+        default:
+            drawLandingPage();
+            break;
+    }
+
+    // Draw overlays after content render
+    drawButtonIndicators();
+}
+
 void vTaskDisplay(void* pvParameters) {
     // Use static variables to minimize stack usage
     static uint32_t lastStackCheck = 0;
     static uint32_t lastFullDraw = 0;
+    static uint32_t lastStatusDraw = 0;   // status bar region, drawn with every page frame
     static bool shouldSleep = false;
     static DisplayPage currentPageLocal = DisplayPage::LANDING_PAGE;
     static bool pageChangedLocal = false;
+    static bool dataPending = false;      // page data changed inside the frame cap
+    static bool modalShown = false;
+    static bool listScrolled = false;     // logs list moved; its rows repaint without a full frame
     static char logBuf[32]; // Static buffer for minimal logging
+    static uint8_t shownBrightness = displayBrightness;   // backlight level on the panel while awake
     
     // Wait for display to initialize
     vTaskDelay(pdMS_TO_TICKS(1000));
@@ -530,6 +470,23 @@ void vTaskDisplay(void* pvParameters) {
     strcpy(logBuf, "Display task started");
     Serial.println(logBuf);
     
+#if ENABLE_UI_BENCHMARK
+    {
+        static const UiBenchPage kBenchPages[] = {
+            {"status", drawStatusBar, nullptr},
+            {"landing", drawLandingPage, nullptr},
+            {"gnss", drawGNSSPage, nullptr},
+            {"cellular", drawCellularPage, nullptr},
+            {"system", drawSystemPage, nullptr},
+            {"settings", drawSettingsPage, nullptr},
+            {"logs", drawLogsPage, logsPageBeginFrame},
+        };
+        PowerLockGuard spi(PowerLock::Display);
+        ui_bench_run(kBenchPages, sizeof(kBenchPages) / sizeof(kBenchPages[0]), Serial);
+        pageChanged = true;   // back to the real page with live data
+    }
+#endif
+
     // Initialize display activity timer
     lastDisplayActivity = millis();
     
@@ -545,192 +502,227 @@ void vTaskDisplay(void* pvParameters) {
             lastStackCheck = now;
         }
 
-        // Check for display sleep/wake logic
-        // Disabled when LVGL UI is active to avoid unintended blanking
-        #if !LVGL_UI_TEST_MODE
-        if (displaySleepEnabled) {
-            shouldSleep = (now - lastDisplayActivity > displaySleepTimeoutMs);
-            
-            if (shouldSleep && !displayAsleep) {
-                // Put display to sleep and turn off backlight
-                displayAsleep = true;
-                M5StamPLC.Display.sleep();
-                M5StamPLC.Display.setBrightness(0);
-                // Minimal logging to save stack
-            } else if (!shouldSleep && displayAsleep) {
-                // Wake display up and restore backlight
-                displayAsleep = false;
-                M5StamPLC.Display.wakeup();
-                M5StamPLC.Display.setBrightness(displayBrightness);
-                pageChanged = true; // Force full redraw
-            }
-        }
-        #endif
-
-        // Skip old UI logic when LVGL is enabled
-        #if !LVGL_UI_TEST_MODE
         // Drain UI events and update state
-        if (g_uiQueue) {
+        {
             UIEvent ev;
-            while (xQueueReceive(g_uiQueue, &ev, 0) == pdTRUE) {
-                // Update local copies to reduce mutex contention
-                if (g_uiStateMutex && xSemaphoreTake(g_uiStateMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                    currentPageLocal = currentPage;
-                    pageChangedLocal = pageChanged;
-                    
-                    // Simple event processing to reduce stack usage
-                    switch (ev.type) {
-                        case UIEventType::GoLanding:
-                            currentPageLocal = DisplayPage::LANDING_PAGE;
-                            pageChangedLocal = true;
-                            g_lastNavDir = 0;
-                            break;
-                        case UIEventType::GoGNSS:
-                            currentPageLocal = DisplayPage::GNSS_PAGE;
-                            scrollGNSS = 0;
-                            pageChangedLocal = true;
+            while (nextUIEvent(ev)) {
+                TRACE_USER(UiEventHandled, ev.type);
+                // Page and scroll state is written only here, so no lock is needed
+                currentPageLocal = currentPage;
+                pageChangedLocal = pageChanged;
+                
+                // Simple event processing to reduce stack usage
+                switch (ev.type) {
+                    case UIEventType::GoLanding:
+                        currentPageLocal = DisplayPage::LANDING_PAGE;
+                        pageChangedLocal = true;
+                        g_lastNavDir = 0;
+                        break;
+                    case UIEventType::GoGNSS:
+                        currentPageLocal = DisplayPage::GNSS_PAGE;
+                        scrollGNSS = 0;
+                        pageChangedLocal = true;
+                        g_lastNavDir = 0;
+                        break;
+                    case UIEventType::GoCELL:
+                        currentPageLocal = DisplayPage::CELLULAR_PAGE;
+                        scrollCELL = 0;
+                        pageChangedLocal = true;
+                        g_lastNavDir = 0;
+                        break;
+                    case UIEventType::GoSYS:
+                        currentPageLocal = DisplayPage::SYSTEM_PAGE;
+                        scrollSYS = 0;
+                        pageChangedLocal = true;
+                        g_lastNavDir = 0;
+                        break;
+                    case UIEventType::GoSETTINGS:
+                        currentPageLocal = DisplayPage::SETTINGS_PAGE;
+                        scrollSETTINGS = 0;
+                        pageChangedLocal = true;
+                        g_lastNavDir = 0;
+                        break;
+                    case UIEventType::ScrollUp:
+                        switch (currentPageLocal) {
+                            case DisplayPage::GNSS_PAGE:
+                                scrollGNSS = clampScroll(scrollGNSS - SCROLL_STEP, gnssPageContentHeight());
+                                break;
+                            case DisplayPage::CELLULAR_PAGE:
+                                scrollCELL = clampScroll(scrollCELL - SCROLL_STEP, cellularPageContentHeight());
+                                break;
+                            case DisplayPage::SYSTEM_PAGE:
+                                scrollSYS = clampScroll(scrollSYS - SCROLL_STEP, systemPageContentHeight());
+                                break;
+                            case DisplayPage::SETTINGS_PAGE:
+                                scrollSETTINGS = clampScroll(scrollSETTINGS - SCROLL_STEP, settingsPageContentHeight());
+                                break;
+                            case DisplayPage::LOGS_PAGE:
+                                logsPageScroll(-SCROLL_STEP);
+                                break;
+                            default: break;
+                        }
+                        if (currentPageLocal == DisplayPage::LOGS_PAGE) listScrolled = true;
+                        else pageChangedLocal = true;
+                        break;
+                    case UIEventType::ScrollDown:
+                        switch (currentPageLocal) {
+                            case DisplayPage::GNSS_PAGE:
+                                scrollGNSS = clampScroll(scrollGNSS + SCROLL_STEP, gnssPageContentHeight());
+                                break;
+                            case DisplayPage::CELLULAR_PAGE:
+                                scrollCELL = clampScroll(scrollCELL + SCROLL_STEP, cellularPageContentHeight());
+                                break;
+                            case DisplayPage::SYSTEM_PAGE:
+                                scrollSYS = clampScroll(scrollSYS + SCROLL_STEP, systemPageContentHeight());
+                                break;
+                            case DisplayPage::SETTINGS_PAGE:
+                                scrollSETTINGS = clampScroll(scrollSETTINGS + SCROLL_STEP, settingsPageContentHeight());
+                                break;
+                            case DisplayPage::LOGS_PAGE:
+                                logsPageScroll(SCROLL_STEP);
+                                break;
+                            default: break;
+                        }
+                        if (currentPageLocal == DisplayPage::LOGS_PAGE) listScrolled = true;
+                        else pageChangedLocal = true;
+                        break;
+                    case UIEventType::PrevPage:
+                    case UIEventType::NextPage:
+                    case UIEventType::LauncherNext:
+                    case UIEventType::LauncherPrev:
+                    case UIEventType::LauncherOpen:
+                    case UIEventType::Redraw:
+                        pageChangedLocal = true;
+                        if (ev.type == UIEventType::NextPage || ev.type == UIEventType::LauncherNext) {
+                            g_lastNavDir = 1;
+                        } else if (ev.type == UIEventType::PrevPage || ev.type == UIEventType::LauncherPrev) {
+                            g_lastNavDir = -1;
+                        } else {
                             g_lastNavDir = 0;
-                            break;
-                        case UIEventType::GoCELL:
-                            currentPageLocal = DisplayPage::CELLULAR_PAGE;
-                            scrollCELL = 0;
-                            pageChangedLocal = true;
-                            g_lastNavDir = 0;
-                            break;
-                        case UIEventType::GoSYS:
-                            currentPageLocal = DisplayPage::SYSTEM_PAGE;
-                            scrollSYS = 0;
-                            pageChangedLocal = true;
-                            g_lastNavDir = 0;
-                            break;
-                        case UIEventType::GoSETTINGS:
-                            currentPageLocal = DisplayPage::SETTINGS_PAGE;
-                            scrollSETTINGS = 0;
-                            pageChangedLocal = true;
-                            g_lastNavDir = 0;
-                            break;
-                        case UIEventType::ScrollUp:
-                            switch (currentPageLocal) {
-                                case DisplayPage::GNSS_PAGE:
-                                    scrollGNSS = clampScroll(scrollGNSS - SCROLL_STEP, gnssPageContentHeight());
-                                    break;
-                                case DisplayPage::CELLULAR_PAGE:
-                                    scrollCELL = clampScroll(scrollCELL - SCROLL_STEP, cellularPageContentHeight());
-                                    break;
-                                case DisplayPage::SYSTEM_PAGE:
-                                    scrollSYS = clampScroll(scrollSYS - SCROLL_STEP, systemPageContentHeight());
-                                    break;
-                                case DisplayPage::SETTINGS_PAGE:
-                                    scrollSETTINGS = clampScroll(scrollSETTINGS - SCROLL_STEP, settingsPageContentHeight());
-                                    break;
-                                case DisplayPage::LOGS_PAGE:
-                                    scrollLOGS = clampScroll(scrollLOGS - SCROLL_STEP, logsPageContentHeight());
-                                    break;
-                                default: break;
-                            }
-                            pageChangedLocal = true;
-                            break;
-                        case UIEventType::ScrollDown:
-                            switch (currentPageLocal) {
-                                case DisplayPage::GNSS_PAGE:
-                                    scrollGNSS = clampScroll(scrollGNSS + SCROLL_STEP, gnssPageContentHeight());
-                                    break;
-                                case DisplayPage::CELLULAR_PAGE:
-                                    scrollCELL = clampScroll(scrollCELL + SCROLL_STEP, cellularPageContentHeight());
-                                    break;
-                                case DisplayPage::SYSTEM_PAGE:
-                                    scrollSYS = clampScroll(scrollSYS + SCROLL_STEP, systemPageContentHeight());
-                                    break;
-                                case DisplayPage::SETTINGS_PAGE:
-                                    scrollSETTINGS = clampScroll(scrollSETTINGS + SCROLL_STEP, settingsPageContentHeight());
-                                    break;
-                                case DisplayPage::LOGS_PAGE:
-                                    scrollLOGS = clampScroll(scrollLOGS + SCROLL_STEP, logsPageContentHeight());
-                                    break;
-                                default: break;
-                            }
-                            pageChangedLocal = true;
-                            break;
-                        case UIEventType::PrevPage:
-                        case UIEventType::NextPage:
-                        case UIEventType::LauncherNext:
-                        case UIEventType::LauncherPrev:
-                        case UIEventType::LauncherOpen:
-                        case UIEventType::Redraw:
-                            pageChangedLocal = true;
-                            if (ev.type == UIEventType::NextPage || ev.type == UIEventType::LauncherNext) {
-                                g_lastNavDir = 1;
-                            } else if (ev.type == UIEventType::PrevPage || ev.type == UIEventType::LauncherPrev) {
-                                g_lastNavDir = -1;
-                            } else {
-                                g_lastNavDir = 0;
-                            }
-                            break;
-                        default: break;
-                    }
-                    
-                    // Update globals
-                    currentPage = currentPageLocal;
-                    pageChanged = pageChangedLocal;
-                    
-                    xSemaphoreGive(g_uiStateMutex);
+                        }
+                        break;
+                    default: break;
                 }
+                
+                // Update globals
+                currentPage = currentPageLocal;
+                pageChanged = pageChangedLocal;
             }
         }
-        #endif // !LVGL_UI_TEST_MODE
 
-        #if LVGL_UI_TEST_MODE
-        // LVGL UI is handled by its own task, just sleep
-        vTaskDelay(pdMS_TO_TICKS(100));
-        continue;
-        #endif
+        // Check for display sleep/wake logic; after the events, so a press wakes the panel this pass
+        now = millis();
+        // Sleep turned off (settings page, remote setting) while asleep wakes the panel
+        shouldSleep = displaySleepEnabled && (now - lastDisplayActivity > displaySleepTimeoutMs);
+        if (shouldSleep && !displayAsleep) {
+            // Put display to sleep and turn off backlight
+            displayAsleep = true;
+            M5StamPLC.Display.sleep();
+            M5StamPLC.Display.setBrightness(0);
+            energy_state(EnergyDisplay::Asleep);
+            // Minimal logging to save stack
+        } else if (!shouldSleep && displayAsleep) {
+            // Wake display up and restore backlight
+            displayAsleep = false;
+            M5StamPLC.Display.wakeup();
+            M5StamPLC.Display.setBrightness(displayBrightness);
+            shownBrightness = displayBrightness;
+            energy_state(EnergyDisplay::On);
+            pageChanged = true; // Force full redraw
+        }
+        // A brightness set remotely reaches the backlight here; the settings page sets it itself
+        if (!displayAsleep && displayBrightness != shownBrightness) {
+            shownBrightness = displayBrightness;
+            M5StamPLC.Display.setBrightness(shownBrightness);
+        }
 
+        if (pageChanged) pageChangedLocal = true;   // set by modals and display wake
         bool doFullDraw = pageChangedLocal && !displayAsleep; // redraw only on changes and when awake
+        const UiFrameSchedule sched = pageSchedule(currentPageLocal);
+        const uint32_t slow = ui_frame_slowdown();
 
+        bool presented = false;               // this pass put a frame on the panel
         if (doFullDraw) {
-            // Full redraw on page change or periodic refresh
-            M5StamPLC.Display.fillScreen(BLACK);
-
-            // Simple page drawing to reduce stack usage - removed verbose logging
-            switch (currentPageLocal) {
-                case DisplayPage::LANDING_PAGE:
-                    drawLandingPage();
-                    break;
-                case DisplayPage::GNSS_PAGE:
-                    drawGNSSPage();
-                    break;
-                case DisplayPage::CELLULAR_PAGE:
-                    drawCellularPage();
-                    break;
-                case DisplayPage::SYSTEM_PAGE:
-                    drawSystemPage();
-                    break;
-                case DisplayPage::SETTINGS_PAGE:
-                    drawSettingsPage();
-                    break;
-                case DisplayPage::LOGS_PAGE:
-                    drawLogsPage();
-                    break;
-                default:
-                    drawLandingPage();
-                    break;
-            }
-
-            // Draw overlays after content render
-            drawButtonIndicators();
+            PowerLockGuard spi(PowerLock::Display);
+            // Full redraw on page change
+            s_renderedPage = currentPageLocal;
+            beginFrame();
+            ui_render_full(drawRenderedPage, BLACK);
             lastFullDraw = now;
+            lastStatusDraw = now;
+            ui_data_consume(~0UL);
+            dataPending = false;
+            listScrolled = false;
+            modalShown = false;
+            TRACE_USER(PageDrawn, currentPageLocal);
+            presented = true;
 
             pageChangedLocal = false;
             pageChanged = false;
             // Removed verbose logging to save stack
+        } else if (!displayAsleep && !g_modalActive) {
+            const bool fresh = ui_data_consume(sched.dataMask);
+            const bool pollDue = sched.pollMs && now - lastFullDraw >= sched.pollMs * slow;
+            const bool capped = now - lastFullDraw < sched.minFrameMs * slow;
+            if (fresh && dataPending && capped) ui_perf_skip();   // folded into the frame already waiting
+            if (fresh) dataPending = true;
+            if (listScrolled || ((dataPending || pollDue) && !capped)) {
+                // Live values: only the widgets whose value changed are pushed
+                PowerLockGuard spi(PowerLock::Display);
+                beginFrame();
+                ui_render_refresh(drawRenderedPage, BLACK);
+                lastFullDraw = now;
+                lastStatusDraw = now;
+                dataPending = false;
+                listScrolled = false;
+                presented = true;
+            } else if (now - lastStatusDraw >= STATUS_BAR_REFRESH_MS * slow) {
+                // Status bar alone: the page's tracked values aren't visited
+                PowerLockGuard spi(PowerLock::Display);
+                ui_state_capture();
+                ui_render_refresh(drawStatusBar, BLACK);
+                lastStatusDraw = now;
+            }
         }
 
-        // Always ensure modal overlay is drawn last when active (prevents background bleed)
-        if (g_modalActive) {
+        // Modal overlay goes on top of a fresh frame (prevents background bleed)
+        if (g_modalActive && !displayAsleep && !modalShown) {
+            PowerLockGuard spi(PowerLock::Display);
             drawModalOverlay();
+            modalShown = true;
+        } else if (!g_modalActive) {
+            modalShown = false;
         }
 
-        vTaskDelay(pdMS_TO_TICKS(100)); // Reduced delay for better responsiveness
+        // Input to pixel: the frame carrying a button's effect is on the panel
+        if (presented && s_inputPending) {
+            button_input_presented(s_inputUs);
+            s_inputPending = false;
+        }
+
+        // Sleep until an event, new data or the next deadline: the next poll or
+        // capped frame, the display sleep timeout. A button press wakes a sleeping panel.
+        uint32_t waitMs = UINT32_MAX;
+        if (!displayAsleep && !g_modalActive) {
+            const uint32_t since = millis() - lastFullDraw;
+            if (dataPending) {
+                const uint32_t cap = sched.minFrameMs * slow;
+                waitMs = since < cap ? cap - since : 0;
+            } else if (sched.pollMs) {
+                const uint32_t poll = sched.pollMs * slow;
+                waitMs = since < poll ? poll - since : 0;
+            }
+            const uint32_t sinceStatus = millis() - lastStatusDraw;
+            const uint32_t statusPoll = STATUS_BAR_REFRESH_MS * slow;
+            const uint32_t toStatus = sinceStatus < statusPoll ? statusPoll - sinceStatus : 0;
+            if (toStatus < waitMs) waitMs = toStatus;
+        }
+        if (displaySleepEnabled && !displayAsleep) {
+            const uint32_t idle = millis() - lastDisplayActivity;
+            const uint32_t toSleep = idle < displaySleepTimeoutMs ? displaySleepTimeoutMs - idle + 1 : 1;
+            if (toSleep < waitMs) waitMs = toSleep;
+        }
+        ulTaskNotifyTake(pdTRUE, waitMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(waitMs) + 1);
     }
 }
 
@@ -738,130 +730,31 @@ void vTaskDisplay(void* pvParameters) {
 // RTC SYNCHRONIZATION
 // ============================================================================
 
-// RTC synchronization moved to system/time_utils.cpp
+// RTC synchronization moved to system/time_utils.cpp (rtc_sync_begin)
 
-// STATUS BAR TASK
 // ============================================================================
-void vTaskStatusBar(void* pvParameters) {
-    Serial.println("Status bar task started");
-    
-    #if LVGL_UI_TEST_MODE
-    // LVGL handles status bar, but we still need periodic RTC sync
-    for (;;) {
-        EventBits_t bits = xEventGroupWaitBits(
-            xEventGroupSystemStatus,
-            EVENT_BIT_STATUS_CHANGE | EVENT_BIT_SYSTEM_ERROR | EVENT_BIT_HEAP_LOW,
-            pdTRUE,
-            pdFALSE,
-            pdMS_TO_TICKS(5000)  // 5s periodic check
-        );
-
-        // Handle status change events
-        if (bits & EVENT_BIT_STATUS_CHANGE) {
-            // Status changed - could trigger UI update
-        }
-
-        if (bits & EVENT_BIT_SYSTEM_ERROR) {
-            // System error - could show error indicator
-        }
-
-        if (bits & EVENT_BIT_HEAP_LOW) {
-            // Low heap - could show memory warning
-        }
+// SYSTEM HEALTH JOBS
+// ============================================================================
+// Run by the service task (system/service_task.h); the status bar they used to
+// share a task with is drawn by the display task (ui/components/status_bar.h).
+static void systemHealthJob(void*) {
+    cpu_profile_poll(millis());
+}
 
-        // Periodic RTC synchronization (every 5 seconds)
-        static uint32_t lastRtcSyncCheck = 0;
-        if (millis() - lastRtcSyncCheck >= 5000) {
-            syncRTCFromAvailableSources();
-            lastRtcSyncCheck = millis();
-        }
+static void sensorCheckJob(void*) {
+    // Range checks on the acquisition job's readings; it logs bus failures itself
+    const PlcSensorSnapshot s = sensor_acq_snapshot();
+    if (s.tempOk && (s.temperature < -100.0f || s.temperature > 200.0f)) {
+        Serial.printf("WARNING: Temperature sensor reading out of range: %.1f°C\n", s.temperature);
     }
-    #else
-    for (;;) {
-        // Wait for status change events or periodic timeout
-        EventBits_t bits = xEventGroupWaitBits(
-            xEventGroupSystemStatus,
-            EVENT_BIT_STATUS_CHANGE | EVENT_BIT_SYSTEM_ERROR | EVENT_BIT_HEAP_LOW,
-            pdTRUE,
-            pdFALSE,
-            pdMS_TO_TICKS(5000)  // 5s periodic check
-        );
-        
-        // Immediate stack watermark check for early warning
-        UBaseType_t hwmNow = uxTaskGetStackHighWaterMark(NULL);
-        if (hwmNow < 512) { // < 2KB remaining (words)
-            Serial.printf("WARNING: StatusBar stack low: %u words\n", (unsigned)hwmNow);
-            // Signal heap low event
-            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_HEAP_LOW);
-        }
-        
-        // Update memory monitoring
-        g_memoryMonitor.update();
-
-        // Check memory status and trigger alerts
-        MemoryStatus memStatus = g_memoryMonitor.getStatus();
-        if (memStatus == MemoryStatus::LOW_MEMORY || memStatus == MemoryStatus::CRITICAL) {
-            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_HEAP_LOW);
-        }
-
-        // Periodic hardware sensor monitoring and RTC sync
-        static uint32_t lastSensorCheck = 0;
-        if (millis() - lastSensorCheck > 10000) { // Check every 10 seconds
-            // Monitor thermal sensor with I2C error handling
-            if (M5StamPLC.LM75B.begin()) {
-                float temp = M5StamPLC.getTemp();
-                if (temp < -100.0f || temp > 200.0f) {
-                    Serial.printf("WARNING: Temperature sensor reading out of range: %.1f°C\n", temp);
-                }
-            } else {
-                Serial.println("WARNING: Thermal sensor (LM75B) I2C communication failed");
-            }
-
-            // Monitor power readings with I2C error handling
-            if (M5StamPLC.INA226.begin()) {
-                float voltage = M5StamPLC.INA226.getBusVoltage();
-                float current = M5StamPLC.INA226.getShuntCurrent();
-                if (voltage < 0.0f || voltage > 30.0f) {
-                    Serial.printf("WARNING: Voltage reading out of range: %.2fV\n", voltage);
-                }
-                if (current < -5.0f || current > 5.0f) {
-                    Serial.printf("WARNING: Current reading out of range: %.3fA\n", current);
-                }
-            } else {
-                Serial.println("WARNING: Power monitor (INA226) I2C communication failed");
-            }
-
-            // Periodic RTC synchronization from available sources
-            syncRTCFromAvailableSources();
-
-            lastSensorCheck = millis();
-        }
-        
-        // Handle status change events
-        if (bits & EVENT_BIT_STATUS_CHANGE) {
-            // Status changed - update status bar
-        }
-        
-        if (bits & EVENT_BIT_SYSTEM_ERROR) {
-            // System error - show error indicator
-        }
-        
-        if (bits & EVENT_BIT_HEAP_LOW) {
-            // Low heap - show memory warning
+    if (s.powerOk) {
+        if (s.busVoltage < 0.0f || s.busVoltage > 30.0f) {
+            Serial.printf("WARNING: Voltage reading out of range: %.2fV\n", s.busVoltage);
         }
-        
-        // Update every 5 seconds - much less frequent than main display
-        // Periodic diagnostics: stack high water marks every 30s
-        static uint32_t lastDiag = 0;
-        if (millis() - lastDiag > 30000) {
-            lastDiag = millis();
-            auto hwm = [](TaskHandle_t h){ return h ? (unsigned)uxTaskGetStackHighWaterMark(h) : 0u; };
-            Serial.printf("HWM words | Button:%u Display:%u Status:%u PLC:%u CatM:%u Storage:%u\n",
-                hwm(buttonTaskHandle), hwm(displayTaskHandle), hwm(statusBarTaskHandle), hwm(stampPLCTaskHandle),
-                hwm(catmGnssTaskHandle), hwm(storageTaskHandle));
+        if (s.current < -5.0f || s.current > 5.0f) {
+            Serial.printf("WARNING: Current reading out of range: %.3fA\n", s.current);
         }
     }
-    #endif // !LVGL_UI_TEST_MODE
 }
 
 // ============================================================================
@@ -903,9 +796,7 @@ void setCustomFont(lgfx::LGFX_Sprite* s, int size = 1) {
 // drawSignalBar moved to ui/components/ui_widgets.cpp
 // drawWiFiBar moved to ui/components/ui_widgets.cpp
 
-void drawStatusBar() {
-    // Status bar removed; intentionally left blank.
-}
+// drawStatusBar moved to ui/components/status_bar.cpp
 
 
 // ============================================================================
@@ -1064,10 +955,9 @@ static void tryInitCatMIfAbsent(bool forced) {
         log_add("CatM+GNSS hot-attached");
         g_commFailureDescription = "";
         // Spawn the CatMGNSS worker task
-        BaseType_t taskResult = xTaskCreatePinnedToCore(
+        BaseType_t taskResult = kernel_task_create(
+            KernelTask::CatMGNSS,
             vTaskCatMGNSS,
-            "CatMGNSS",
-            TASK_STACK_SIZE_APP_GNSS,
             catmGnssModule,
             TASK_PRIORITY_GNSS,
             &catmGnssTaskHandle,
@@ -1094,7 +984,62 @@ static void tryInitCatMIfAbsent(bool forced) {
     }
 }
 
+// Boot-time modem bring-up, on the modem-side worker (BootStage::CatM). Runs
+// while setup() continues, so it leaves the screen to setup() and the modal.
+static bool catmBootStage(void*) {
+    Serial.println("========================================");
+    Serial.println("Starting CatM+GNSS module initialization...");
+
+    CatMGNSSModule* m = new CatMGNSSModule();
+    if (!m) {
+        Serial.println("ERROR: Failed to allocate CatM+GNSS module - out of memory");
+        log_add("CatM+GNSS allocation failed");
+        g_modalType = ModalType::NO_COMM_UNIT;
+        g_modalActive = true;
+        pageChanged = true; // ensure UI redraw shows modal
+        ui_frame_request();
+        return false;
+    }
+
+    Serial.println("CatM+GNSS module allocated, calling begin()...");
+    if (!m->begin()) {
+        Serial.println("========================================");
+        Serial.println("CatM+GNSS module initialization failed");
+        Serial.printf("Error: %s\n", m->getLastError().c_str());
+        g_commFailureDescription = m->getLastError();
+        delete m;
+        log_add("CatM+GNSS init failed");
+        // Show modal alert; allow user to dismiss (A) or retry (C)
+        g_modalType = ModalType::NO_COMM_UNIT;
+        g_modalActive = true;
+        pageChanged = true; // ensure UI redraw shows modal
+        ui_frame_request();
+
+        // Schedule retry attempt
+        g_lastCatMProbeMs = millis() + 30000; // Retry in 30 seconds
+        return false;
+    }
+
+    Serial.println("========================================");
+    Serial.println("CatM+GNSS module initialized successfully");
+    log_add("CatM+GNSS initialized");
+    g_commFailureDescription = "";
+    catmGnssModule = m;
+
+    // CatM+GNSS task (Core 0)
+    if (kernel_task_create(KernelTask::CatMGNSS, vTaskCatMGNSS, catmGnssModule, TASK_PRIORITY_GNSS,
+                           &catmGnssTaskHandle, 0) != pdPASS) {
+        Serial.println("ERROR: Failed to create CatMGNSS task");
+        g_commFailureDescription = "Failed to create CatM worker task";
+        return false;
+    }
+    Serial.println("CatMGNSS task created");
+    return true;
+}
+
 void setup() {
+    boot_profile_begin();
+    boot_stage_begin(BootStage::Hardware);
     // Initialize serial early and ensure it's ready
     Serial.begin(115200);  // Use explicit 115200 baud for compatibility
     delay(1000);  // Longer delay to ensure serial is ready
@@ -1130,13 +1075,22 @@ void setup() {
     // Initialize M5StamPLC hardware
     M5StamPLC.begin();
     
-    // Initialize display early for POST screen
-    M5StamPLC.Display.setBrightness(128);
-    M5StamPLC.Display.fillScreen(BLACK);
+    // Initialize display early for POST screen; a build without one turns the panel off
+    Serial.printf("Build profile: %s\n", kBuildFeatures.profile);
+    if (kBuildFeatures.display) {
+        M5StamPLC.Display.setBrightness(128);
+        M5StamPLC.Display.fillScreen(BLACK);
+    } else {
+        M5StamPLC.Display.setBrightness(0);
+        M5StamPLC.Display.sleep();
+        energy_state(EnergyDisplay::Asleep);
+    }
     drawBootScreen("Starting POST...", 0);
     delay(300);
+    boot_stage_end(BootStage::Hardware);
 
     // Initialize memory monitoring and string pooling
+    boot_stage_begin(BootStage::Memory);
     drawBootScreen("Initializing memory monitor", 10);
     if (!g_memoryMonitor.begin()) {
         Serial.println("ERROR: Failed to initialize memory monitor");
@@ -1147,8 +1101,16 @@ void setup() {
 
     g_memoryMonitor.startMonitoring();
     Serial.println("Memory monitoring started");
+    cpu_profile_begin();
+    stack_profile_begin();
+    trace_recorder_begin();
+    work_queue_begin();
+    core_affinity_begin();
+    power_begin(inaCurrentA);
+    boot_stage_end(BootStage::Memory);
 
     // Initialize crash recovery system
+    boot_stage_begin(BootStage::CrashRecovery);
     drawBootScreen("Initializing crash recovery", 15);
     g_crashRecovery = CrashRecovery::getInstance();
     if (!g_crashRecovery->begin()) {
@@ -1159,12 +1121,115 @@ void setup() {
     }
     g_crashRecovery->startRecovery();
     Serial.println("Crash recovery system started");
+    boot_stage_end(BootStage::CrashRecovery);
+
+    boot_stage_begin(BootStage::Settings);
+    // Load settings from NVS once; everything else reads the cached copy
+    {
+        g_settings.begin();
+        AppSettings settings;
+        g_settings.get(settings);
+        displayBrightness = settings.displayBrightness;
+        displaySleepEnabled = settings.displaySleepEnabled;
+        displaySleepTimeoutMs = (uint32_t)settings.displaySleepSec * 1000;
+        g_settings.addListener(SETTINGS_DISPLAY, [](const AppSettings& s, uint32_t, void*) {
+            displayBrightness = s.displayBrightness;
+            displaySleepEnabled = s.displaySleepEnabled;
+            displaySleepTimeoutMs = (uint32_t)s.displaySleepSec * 1000;
+            ui_frame_request();
+        }, nullptr);
+        // Remote display settings go through g_settings like the settings page's, so they are
+        // journaled and deleting the attribute keeps them. display_sleep_s 0 turns sleep off.
+        if (kBuildFeatures.display) {
+            live_config_register("display_brightness", LiveConfigType::Int, 0, 255,
+                                 [](const LiveConfigValue& v, void*) -> bool {
+                if (!v.present) return true;
+                AppSettings next;
+                g_settings.get(next);
+                next.displayBrightness = (uint8_t)v.number;
+                return g_settings.update(next);
+            }, nullptr);
+            live_config_register("display_sleep_s", LiveConfigType::Int, 0, 600,
+                                 [](const LiveConfigValue& v, void*) -> bool {
+                if (!v.present) return true;
+                if (v.number != 0 && v.number < 30) return false;
+                AppSettings next;
+                g_settings.get(next);
+                next.displaySleepEnabled = v.number != 0;
+                if (v.number) next.displaySleepSec = (uint16_t)v.number;
+                return g_settings.update(next);
+            }, nullptr);
+        }
+        Serial.printf("Display settings loaded: brightness=%d, sleep=%s, timeout=%us\n",
+                      displayBrightness, displaySleepEnabled ? "ON" : "OFF", settings.displaySleepSec);
+    }
+
+    // Initialize display brightness
+    if (kBuildFeatures.display) {
+        M5StamPLC.Display.setBrightness(displayBrightness);
+        Serial.printf("Display brightness set to %d\n", displayBrightness);
+    }
+    boot_stage_end(BootStage::Settings);
+
+    boot_stage_begin(BootStage::Kernel);
+    Serial.println("DEBUG: Creating UI queue");
+    Serial.flush(); // Ensure log is written before potential crash
+    yield(); // Feed watchdog
+    // Create UI queue
+    static_assert(sizeof(UIEvent) <= QUEUE_ITEM_BYTES_UI_EVENT, "UIEvent outgrew its queue slot");
+    g_uiQueue = kernel_queue_create(KernelQueue::UiEvents, sizeof(UIEvent));
+    if (g_uiQueue == NULL) {
+        Serial.println("ERROR: Failed to create UI queue");
+        Serial.flush();
+        drawBootScreen("UI queue FAILED", 65, false);
+        delay(2000);
+        return;
+    }
+    Serial.println("DEBUG: UI queue created");
+    Serial.flush();
+
+    Serial.println("DEBUG: Creating system event group");
+    Serial.flush();
+    yield(); // Feed watchdog
+    // Create system event group
+    xEventGroupSystemStatus = kernel_event_group_create(KernelEventGroup::SystemStatus);
+    if (xEventGroupSystemStatus == NULL) {
+        Serial.println("ERROR: Failed to create system event group");
+        Serial.flush();
+        drawBootScreen("Event group FAILED", 65, false);
+        delay(2000);
+        return;
+    }
+    Serial.println("DEBUG: System event group created");
+    Serial.flush();
+
+    Serial.println("DEBUG: Initializing logging");
+    Serial.flush();
+    yield(); // Feed watchdog
+    // Init logging
+    log_init();
+    log_add("Booting StampPLC CatM+GNSS...");
+#if ENABLE_DEBUG_SYSTEM
+    // Async serial sink for LOG_* macros (Core 0, lowest priority)
+    kernel_task_create(KernelTask::DebugSink, vTaskDebugSink, NULL, TASK_PRIORITY_DEBUG_SINK, NULL, 0);
+#if PRODUCTION_BUILD
+    debug_sink_set_mode(DEBUG_SINK_KEEP_NEWEST);
+#endif
+#endif
+    Serial.println("DEBUG: Logging initialized");
+    Serial.flush();
+    boot_stage_end(BootStage::Kernel);
+
+    // The modem bring-up takes seconds (power key, AT sync, SIM); it runs on the
+    // modem-side worker while the I2C devices come up, icons render and SD mounts
+    boot_stage_async(BootStage::CatM, catmBootStage, nullptr, WORK_CORE_MODEM);
 
     // Feed watchdog
     yield();
     delay(200);
     
     // Quick I2C bus check (skip full scan during POST to avoid timing issues)
+    boot_stage_begin(BootStage::Sensors);
     drawBootScreen("Checking I2C bus", 20);
     Serial.println("Checking I2C bus...");
 
@@ -1258,59 +1323,22 @@ void setup() {
     esp_log_level_set("M5GFX", ESP_LOG_ERROR);
     Serial.println("M5StamPLC initialized");
     Serial.printf("Display w=%d, h=%d\n", M5StamPLC.Display.width(), M5StamPLC.Display.height());
+    boot_stage_end(BootStage::Sensors);
     
-    // Load display settings from NVS
-    {
-        uint16_t sleepSec = 120;
-        displaySettingsLoad(displayBrightness, displaySleepEnabled, sleepSec);
-        displaySleepTimeoutMs = (uint32_t)sleepSec * 1000;
-        Serial.printf("Display settings loaded: brightness=%d, sleep=%s, timeout=%us\n",
-                      displayBrightness, displaySleepEnabled ? "ON" : "OFF", sleepSec);
-    }
 
-    // Initialize display brightness
-    M5StamPLC.Display.setBrightness(displayBrightness);
-    Serial.printf("Display brightness set to %d\n", displayBrightness);
-
-    // Initialize LVGL UI (test mode)
-    #if LVGL_UI_TEST_MODE
-    Serial.println("=== Initializing LVGL UI Integration ===");
-    
-    // Create LVGL tick task (CRITICAL - must run every 1ms)
-    BaseType_t result = xTaskCreatePinnedToCore(
-        [](void* pvParameters) {
-            for(;;) {
-                ui_tick_1ms();
-                vTaskDelay(pdMS_TO_TICKS(1));
-            }
-        },
-        "LVGL_Tick",
-        2048,  // Stack size
-        NULL,
-        TASK_PRIORITY_GNSS,     // High priority - critical timing
-        &lvglTickTaskHandle,
-        0      // Core 0
-    );
-    
-    if (result == pdPASS) {
-        Serial.println("LVGL tick task created successfully");
-    } else {
-        Serial.println("ERROR: Failed to create LVGL tick task");
-    }
-    
-    // Start LVGL UI (this creates the GUI task)
-    ui_create_gui_task();
-    Serial.println("LVGL UI integration initialized");
-    #endif
-    
     // Initialize UI icons
-    initializeIcons();
-    Serial.println("UI icons initialized");
+    boot_stage_begin(BootStage::Icons);
+    if (kBuildFeatures.display) {
+        initializeIcons();
+        Serial.println("UI icons initialized");
+    }
+    boot_stage_end(BootStage::Icons);
     
     // Ensure first frame draws landing page
     pageChanged = true;
     
     // Initialize StampPLC
+    boot_stage_begin(BootStage::StampPlc);
     drawBootScreen("Initializing StampPLC", 55);
     Serial.println("Initializing StampPLC wrapper...");
     Serial.flush();
@@ -1330,8 +1358,10 @@ void setup() {
         // delete stampPLC;
         // stampPLC = nullptr;
     }
+    boot_stage_end(BootStage::StampPlc, stampPLC && stampPLC->isReady());
     
     // Initialize SD module (optional)
+    boot_stage_begin(BootStage::Sd);
     drawBootScreen("Initializing SD card", 60);
 #if ENABLE_SD
     sdModule = new SDCardModule();
@@ -1348,6 +1378,10 @@ void setup() {
             Serial.println("SDCardModule: WARNING - Write test failed, card may be read-only");
             log_add("SD card mounted (read-only)");
         }
+        g_settings.loadSdOverrides();
+#if ENABLE_SD_BENCHMARK
+        sdBenchmark_run();
+#endif
     } else {
         Serial.println("No SD card present or mount failed");
         drawBootScreen("SD card not detected", 60, false);
@@ -1361,70 +1395,20 @@ void setup() {
 #endif
     yield();
     delay(200);
+    boot_stage_end(BootStage::Sd, sdModule != nullptr);
+#if ENABLE_PARSER_BENCHMARK
+    parserBench_run(Serial);
+#endif
 
-    Serial.println("DEBUG: Creating UI queue");
-    Serial.flush(); // Ensure log is written before potential crash
-    yield(); // Feed watchdog
-    // Create UI queue
-    g_uiQueue = xQueueCreate(16, sizeof(UIEvent));
-    if (g_uiQueue == NULL) {
-        Serial.println("ERROR: Failed to create UI queue");
-        Serial.flush();
-        drawBootScreen("UI queue FAILED", 65, false);
-        delay(2000);
-        return;
-    }
-    Serial.println("DEBUG: UI queue created");
-    Serial.flush();
-
-    Serial.println("DEBUG: Creating UI state mutex");
-    Serial.flush();
-    yield(); // Feed watchdog
-    // Create UI state mutex
-    g_uiStateMutex = xSemaphoreCreateMutex();
-    if (g_uiStateMutex == NULL) {
-        Serial.println("ERROR: Failed to create UI state mutex");
-        Serial.flush();
-        drawBootScreen("UI mutex FAILED", 65, false);
-        delay(2000);
-        return;
-    }
-    Serial.println("DEBUG: UI state mutex created");
-    Serial.flush();
-
-    Serial.println("DEBUG: Creating system event group");
-    Serial.flush();
-    yield(); // Feed watchdog
-    // Create system event group
-    xEventGroupSystemStatus = xEventGroupCreate();
-    if (xEventGroupSystemStatus == NULL) {
-        Serial.println("ERROR: Failed to create system event group");
-        Serial.flush();
-        drawBootScreen("Event group FAILED", 65, false);
-        delay(2000);
-        return;
-    }
-    Serial.println("DEBUG: System event group created");
-    Serial.flush();
-
-    Serial.println("DEBUG: Initializing logging");
-    Serial.flush();
-    yield(); // Feed watchdog
-    // Init logging
-    log_init();
-    log_add("Booting StampPLC CatM+GNSS...");
-    Serial.println("DEBUG: Logging initialized");
-    Serial.flush();
-
+    boot_stage_begin(BootStage::Storage);
     Serial.println("DEBUG: Creating storage task");
     Serial.flush();
     yield(); // Feed watchdog
     // Storage task (Core 1) - only if SD is enabled
 #if ENABLE_SD
-    xTaskCreatePinnedToCore(
+    kernel_task_create(
+        KernelTask::Storage,
         vTaskStorage,
-        "Storage",
-        TASK_STACK_SIZE,
         NULL,
         TASK_PRIORITY_DATA_TRANSMIT,
         &storageTaskHandle,
@@ -1440,140 +1424,104 @@ void setup() {
     Serial.println("Storage task created");
     Serial.flush();
     yield(); // Feed watchdog after task creation
+#if TIME_LOG_ENABLE && LOG_COMPACT_ENABLE
+    // Log compactor (Core 1) - lowest priority, runs only when everything else is idle
+    kernel_task_create(
+        KernelTask::LogCompact,
+        vTaskLogCompactor,
+        NULL,
+        TASK_PRIORITY_LOG_COMPACTOR,
+        &logCompactorTaskHandle,
+        1
+    );
+    if (logCompactorTaskHandle == NULL) {
+        Serial.println("WARNING: Failed to create log compactor task");
+    }
+#endif
 #else
     Serial.println("Storage task disabled (SD disabled)");
 #endif
-    
-    // Initialize CatM+GNSS Module
-    drawBootScreen("Initializing CatM+GNSS", 70);
-    Serial.println("========================================");
-    Serial.println("Starting CatM+GNSS module initialization...");
-    Serial.flush();
-    delay(50);  // Give serial time to send
-    yield(); // Feed watchdog before long init
-    
-    catmGnssModule = new CatMGNSSModule();
-    if (!catmGnssModule) {
-        Serial.println("ERROR: Failed to allocate CatM+GNSS module - out of memory");
-        log_add("CatM+GNSS allocation failed");
-        drawBootScreen("CatM+GNSS allocation FAILED", 70, false);
-        g_modalActive = true;
-        g_modalType = ModalType::NO_COMM_UNIT;
-        pageChanged = true; // ensure UI redraw shows modal
-        delay(800);
-        return;
-    }
-    
-    Serial.println("CatM+GNSS module allocated, calling begin()...");
-    yield(); // Feed watchdog
-    
-    if (catmGnssModule->begin()) {
-        Serial.println("========================================");
-        Serial.println("CatM+GNSS module initialized successfully");
-        Serial.flush();
-        log_add("CatM+GNSS initialized");
-        g_commFailureDescription = "";
-    } else {
-        Serial.println("========================================");
-        Serial.println("CatM+GNSS module initialization failed");
-        Serial.printf("Error: %s\n", catmGnssModule->getLastError().c_str());
-        Serial.flush();
-        delay(100);  // Give serial time to send error message
-        drawBootScreen("CatM+GNSS init FAILED", 70, false);
-        g_commFailureDescription = catmGnssModule->getLastError();
-        delete catmGnssModule;
-        catmGnssModule = nullptr;
-        log_add("CatM+GNSS init failed");
-        // Show modal alert; allow user to dismiss (A) or retry (C)
-        g_modalActive = true;
-        g_modalType = ModalType::NO_COMM_UNIT;
-        pageChanged = true; // ensure UI redraw shows modal
-        
-        // Schedule retry attempt
-        g_lastCatMProbeMs = millis() + 30000; // Retry in 30 seconds
-        delay(800);
-    }
-    yield();
-    delay(200);
+    boot_stage_end(BootStage::Storage);
 
     // Initialize PWRCAN (guarded)
+    boot_stage_begin(BootStage::Pwrcan);
 #if ENABLE_PWRCAN
     pwrcanModule = new PWRCANModule();
     if (pwrcanModule->begin(PWRCAN_TX_PIN, PWRCAN_RX_PIN, PWRCAN_BITRATE_KBPS)) {
         Serial.println("PWRCAN initialized successfully");
+        const CanAcceptance& filter = pwrcanModule->getAcceptance();
+        if (filter.acceptAll) {
+            Serial.println("PWRCAN filter: accept all");
+        } else {
+            Serial.printf("PWRCAN filter: %s, code 0x%08lx mask 0x%08lx, %u IDs pass\n",
+                          filter.dual ? "dual" : "single", (unsigned long)filter.code, (unsigned long)filter.mask,
+                          (unsigned)filter.passIds);
+        }
+        // Receive task (Core 0); blocks on the driver's alerts
+        if (kernel_task_create(KernelTask::PWRCAN, vTaskPWRCAN, pwrcanModule, TASK_PRIORITY_PWRCAN,
+                               &pwrcanTaskHandle, 0) != pdPASS) {
+            Serial.println("ERROR: Failed to create PWRCAN task");
+        }
     } else {
         Serial.println("PWRCAN initialization failed");
         delete pwrcanModule;
         pwrcanModule = nullptr;
     }
 #endif
+    boot_stage_end(BootStage::Pwrcan);
 
 // Web server functionality removed - not required for this project
 
     // Create FreeRTOS tasks with proper error handling
+    boot_stage_begin(BootStage::Tasks);
     Serial.println("DEBUG: Creating FreeRTOS tasks");
     Serial.flush();
     yield(); // Feed watchdog
 
-    // Button task (Core 0)
-    BaseType_t buttonResult = xTaskCreatePinnedToCore(
-        vTaskButton,
-        "Button",
-        TASK_STACK_SIZE_BUTTON_HANDLER,
-        NULL,
-        TASK_PRIORITY_BUTTON_HANDLER,
-        &buttonTaskHandle,
-        0
-    );
-    if (buttonResult != pdPASS) {
-        Serial.println("ERROR: Failed to create button task");
-        drawBootScreen("Button task FAILED", 75, false);
-        delay(2000);
-        return;
-    }
-    Serial.println("Button task created");
-
-    // Display task (Core 1)
-    BaseType_t displayResult = xTaskCreatePinnedToCore(
-        vTaskDisplay,
-        "Display",
-        TASK_STACK_SIZE_DISPLAY,
-        NULL,
-        TASK_PRIORITY_DISPLAY,
-        &displayTaskHandle,
-        1
-    );
-    if (displayResult != pdPASS) {
-        Serial.println("ERROR: Failed to create display task");
-        drawBootScreen("Display task FAILED", 80, false);
-        delay(2000);
-        return;
+    // Display task (Core 1) and the buttons that drive it, when the profile has a panel
+    if (kBuildFeatures.display) {
+        BaseType_t displayResult = kernel_task_create(
+            KernelTask::Display,
+            vTaskDisplay,
+            NULL,
+            TASK_PRIORITY_DISPLAY,
+            &displayTaskHandle,
+            1
+        );
+        if (displayResult != pdPASS) {
+            Serial.println("ERROR: Failed to create display task");
+            drawBootScreen("Display task FAILED", 80, false);
+            delay(2000);
+            return;
+        }
+        Serial.println("Display task created");
+        ui_frame_begin(displayTaskHandle);
+        // Buttons: expander sampler feeding the display task (hardware/button_input.h)
+        button_input_begin(stampPLC);
     }
-    Serial.println("Display task created");
 
-    // Status bar task (Core 1)
-    BaseType_t statusResult = xTaskCreatePinnedToCore(
-        vTaskStatusBar,
-        "StatusBar",
-        TASK_STACK_SIZE_SYSTEM_MONITOR,
-        NULL,
-        TASK_PRIORITY_SYSTEM_MONITOR,
-        &statusBarTaskHandle,
-        1
-    );
-    if (statusResult != pdPASS) {
-        Serial.println("ERROR: Failed to create status bar task");
-        drawBootScreen("Status bar task FAILED", 85, false);
-        delay(2000);
-        return;
-    }
-    Serial.println("Status bar task created");
+    // Periodic system checks, formerly the status bar task's loop
+    service_job_add("SysHealth", systemHealthJob, nullptr, CPU_PROFILE_SAMPLE_MS, 2000);
+    sensor_acq_begin();
+    analog_sampler_begin();
+    hour_meter_begin();
+#if DSP_BENCH_AT_BOOT
+    dsp_benchmark(Serial);
+#endif
+    service_job_add("PlcStatus", plcStatusJob, nullptr, 5000, 5000);
+    service_job_add("SensorCheck", sensorCheckJob, nullptr, 10000, 200);
+    load_shed_begin();
+#if SOAK_BENCH_ENABLE
+    soak_bench_begin(displayTaskHandle ? soakPageStep : nullptr);
+#endif
+    rtc_sync_begin();
 
-    // StampPLC task (Core 0)
-    BaseType_t plcResult = xTaskCreatePinnedToCore(
+    // StampPLC task (Core 0); the logic program joins its scan
+    if (stampPLC) plc_logic_begin(stampPLC);
+    if (stampPLC) alarm_eval_begin();
+    BaseType_t plcResult = kernel_task_create(
+        KernelTask::StampPLC,
         vTaskStampPLC,
-        "StampPLC",
-        TASK_STACK_SIZE_INDUSTRIAL_IO,
         NULL,
         TASK_PRIORITY_INDUSTRIAL_IO,
         &stampPLCTaskHandle,
@@ -1586,34 +1534,28 @@ void setup() {
         return;
     }
     Serial.println("StampPLC task created");
-
-    // CatM+GNSS task (Core 0)
-    BaseType_t catmResult = xTaskCreatePinnedToCore(
-        vTaskCatMGNSS,
-        "CatMGNSS",
-        TASK_STACK_SIZE_APP_GNSS,
-        NULL,
-        TASK_PRIORITY_GNSS,
-        &catmGnssTaskHandle,
-        0
-    );
-    if (catmResult != pdPASS) {
-        Serial.println("ERROR: Failed to create CatMGNSS task");
-        drawBootScreen("CatMGNSS task FAILED", 95, false);
-        delay(2000);
-        return;
-    }
-    Serial.println("CatMGNSS task created");
-
+#if MODBUS_SLAVE_ENABLE && MODBUS_SLAVE_ADDRESS
+    // The RS485 port answers SCADA as a slave; the master stays off the bus
+#elif MODBUS_MASTER_ENABLE
+    // Modbus RTU master (Core 1); opens the RS485 port with the first point
+    kernel_task_create(KernelTask::Modbus, vTaskModbus, NULL, TASK_PRIORITY_MODBUS, NULL, 1);
+#endif
+    modbus_slave_begin();
+    // The CatM+GNSS task is started by the CatM stage once the modem answers
+    boot_stage_end(BootStage::Tasks);
 
     // Boot completed successfully
+    boot_stage_begin(BootStage::Ready);
     drawBootScreen("System Ready", 100, true);
     Serial.println("=== System initialization complete ===");
     log_add("System ready");
+    boot_stage_end(BootStage::Ready);
+    boot_profile_report(Serial);
     delay(1000);
 }
 
 void loop() {
-    // FreeRTOS handles all tasks, this loop is intentionally empty
+    // FreeRTOS handles all tasks; the loop only serves the trace dump command
+    trace_recorder_poll_serial();
     vTaskDelay(pdMS_TO_TICKS(1000));
 }
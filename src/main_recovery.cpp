@@ -1,546 +1,198 @@
 /*
  * GENPLC Recovery Main
- * 
- * Simplified main application for emergency stabilization
- * Addresses mutex contention, memory pressure, and task starvation
- * 
- * Key changes from main.cpp:
- * - Reduced from 6+ tasks to 3 essential tasks
- * - Eliminated mutex contention through task isolation
- * - Implemented emergency memory management
- * - Added robust error handling and recovery
- * - Simplified UI to essential pages only
- * 
- * Created: November 2025
- * Purpose: Emergency stabilization of production system
+ *
+ * Fast-boot recovery image. When a bad build bootloops a site, this is what
+ * gets it back over CatM, so it does only that, as early as it can:
+ *   - one task; no UI task, pages or sprites (status is text lines on the
+ *     display), no PLC I/O, SD card, CAN, Modbus or GNSS
+ *   - the modem goes straight to a data session with the APN stored in NVS
+ *   - the crash record (CRASH_DUMP_ENABLE) and a recovery report go up, then
+ *     shared attributes are fetched every RECOVERY_ATTR_POLL_MS and an ota_url
+ *     is downloaded and installed by the OTA client (it restarts into the image)
+ *
+ * Every phase is stamped in ms since reset and the report carries the stamps:
+ *   {"recovery":1,"reset":<esp_reset_reason>,"t_modem":..,"t_session":..,"t_attr":..}
+ * so reset-to-session and reset-to-OTA times can be compared across sites.
+ * Without a data session for RECOVERY_SESSION_TIMEOUT_MS the device restarts
+ * and tries again from a cold modem.
+ *
+ * Build it with main.cpp, ui/ and hardware/ left out of the sources.
  */
 
 #include <Arduino.h>
 #include <M5StamPLC.h>
-#include <M5GFX.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/queue.h>
-#include <ArduinoJson.h>
-#include <WiFi.h>
 #include <esp_log.h>
-#include <time.h>
-#include <stdlib.h>
+#include <esp_system.h>
 #include <string.h>
-#include <SD.h>
-#include <FS.h>
-#include <sys/time.h>
-#include <Preferences.h>
 
-// Essential includes only
-#include "../include/debug_system.h"
-#include "../include/memory_monitor.h"
-#include "../include/ui_utils.h"
-#include "system/crash_recovery.h"
-#include "system/memory_safety.h"
-#include "system/rtc_manager.h"
-#include "system/time_utils.h"
-#include "system/storage_utils.h"
-#include "hardware/basic_stamplc.h"
-#include "modules/catm_gnss/catm_gnss_module.h"
-#include "modules/catm_gnss/catm_gnss_task.h"
-#include "modules/storage/sd_card_module.h"
 #include "config/system_config.h"
-#include "ui/theme.h"
-#include "ui/components.h"
-#include "ui/ui_constants.h"
-#include "ui/ui_types.h"
-#include "ui/pages/landing_page.h"
-#include "ui/pages/gnss_page.h"
-#include "ui/pages/cellular_page.h"
-#include "ui/pages/system_page.h"
-#include "ui/boot_screen.h"
+#include "modules/catm_gnss/catm_gnss_module.h"
+#include "modules/settings/settings_store.h"
+#include "modules/transport/ota_client.h"
+#include "modules/transport/shared_attributes.h"
+#include "system/crash_dump.h"
+#include "../include/transport.h"
 
 // ============================================================================
 // RECOVERY CONFIGURATION
 // ============================================================================
-// Simplified task architecture
-#define RECOVERY_TASK_COUNT 3
-#define MAX_RETRY_ATTEMPTS 3
-#define MEMORY_EMERGENCY_THRESHOLD 1024  // 1KB free words (4KB)
-#define WATCHDOG_TIMEOUT_MS 30000
+#define RECOVERY_TASK_STACK 8192
+#define RECOVERY_TASK_PRIORITY 3
+#define RECOVERY_ATTACH_RETRY_MS 15000       // between connectNetwork() attempts
+#define RECOVERY_SESSION_TIMEOUT_MS 600000   // restart without a data session by then
+#define RECOVERY_ATTR_POLL_MS 60000          // ota_url check; no MQTT session for pushes
+#define RECOVERY_FALLBACK_APN "soracom.io"
 
 // ============================================================================
-// GLOBAL VARIABLES (Minimized)
+// GLOBAL VARIABLES
 // ============================================================================
-// Module instances (essential only)
-BasicStampPLC* stampPLC = nullptr;
+// Shared modules look the modem up here
 CatMGNSSModule* catmGnssModule = nullptr;
-
-// Task handles (simplified)
-TaskHandle_t mainTaskHandle = nullptr;
-TaskHandle_t communicationTaskHandle = nullptr;
-TaskHandle_t watchdogTaskHandle = nullptr;
-
-// System state (simplified)
-enum class RecoveryState {
-    INITIALIZING,
-    RUNNING,
-    CELLULAR_ISSUE,
-    MEMORY_ISSUE,
-    SYSTEM_ERROR,
-    RECOVERY
-};
-volatile RecoveryState currentState = RecoveryState::INITIALIZING;
-
-// Essential UI state
-volatile DisplayPage currentPage = DisplayPage::LANDING_PAGE;
-volatile bool pageChanged = true;
-volatile uint32_t lastActivity = 0;
-
-// UI globals referenced by shared page/components code
-volatile int16_t scrollGNSS = 0;
-volatile int16_t scrollCELL = 0;
-volatile int16_t scrollSYS  = 0;
-
-// Shared SD module pointer (normally defined in main.cpp)
-SDCardModule* sdModule = nullptr;
-
-// Error tracking (simplified)
-struct ErrorState {
-    uint32_t cellularFailures = 0;
-    uint32_t memoryWarnings = 0;
-    uint32_t systemErrors = 0;
-    uint32_t lastResetTime = 0;
-};
-static ErrorState errorState;
-
-// Communication state (no shared mutexes)
-struct CommState {
-    bool cellularConnected = false;
-    bool gnssEnabled = false;
-    uint32_t lastCellularCheck = 0;
-    uint32_t lastGnssCheck = 0;
-    String lastError = "";
-};
-static CommState commState;
-
-// ============================================================================
-// SIMPLIFIED UI EVENT SYSTEM (No mutex contention)
-// ============================================================================
-enum class UIEvent {
-    GO_HOME,
-    GO_GNSS,
-    GO_CELLULAR,
-    GO_SYSTEM,
-    SCROLL_UP,
-    SCROLL_DOWN,
-    REDRAW
-};
-
-struct UIEventMsg {
-    UIEvent event;
-    uint32_t timestamp;
-};
-static QueueHandle_t uiEventQueue = nullptr;
-
-// ============================================================================
-// MEMORY MANAGEMENT (Emergency)
-// ============================================================================
-namespace MemoryManager {
-    void checkEmergencyMemory() {
-        UBaseType_t freeHeap = uxTaskGetStackHighWaterMark(NULL);
-        if (freeHeap < MEMORY_EMERGENCY_THRESHOLD) {
-            Serial.printf("EMERGENCY: Low memory detected: %u words\n", freeHeap);
-            errorState.memoryWarnings++;
-            
-            // Emergency memory recovery
-            if (errorState.memoryWarnings > 5) {
-                Serial.println("EMERGENCY: Triggering system reset for memory recovery");
-                ESP.restart();
-            }
-        }
-    }
-    
-    void logMemoryUsage() {
-        static uint32_t lastLog = 0;
-        if (millis() - lastLog > 30000) { // Every 30 seconds
-            lastLog = millis();
-            
-            size_t freeHeap = ESP.getFreeHeap();
-            size_t minFreeHeap = ESP.getMinFreeHeap();
-            UBaseType_t taskStack = uxTaskGetStackHighWaterMark(NULL);
-            
-            Serial.printf("Memory: Heap=%u, Min=%u, Stack=%u\n", 
-                        freeHeap, minFreeHeap, taskStack * sizeof(StackType_t));
-        }
+bool g_cntpSyncedThisSession = false;
+bool g_lastCellularNtpUsedCntp = false;
+
+namespace {
+enum class Phase : uint8_t { Modem = 0, Session, Attributes, Count };
+const char* const kPhaseNames[] = {"modem", "session", "attr"};
+
+TaskHandle_t s_taskHandle = nullptr;
+uint32_t s_phaseMs[(size_t)Phase::Count] = {};   // ms since reset, 0 = not reached
+uint8_t s_resetReason = 0;
+uint8_t s_statusLine = 0;
+
+void status(const char* fmt, ...) {
+    char line[64];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    Serial.printf("[Recovery %lu ms] %s\n", (unsigned long)millis(), line);
+    // Plain text, scrolled by clearing once the screen is full
+    if (++s_statusLine > 8) {
+        s_statusLine = 1;
+        M5StamPLC.Display.fillScreen(BLACK);
+        M5StamPLC.Display.setCursor(0, 0);
     }
+    M5StamPLC.Display.println(line);
 }
 
-// ============================================================================
-// SIMPLIFIED TASK FUNCTIONS
-// ============================================================================
-
-// Arduino auto-generated function prototypes don't apply to .cpp files.
-static void updateSystemState();
-static bool checkCellularStatus();
-static bool checkGnssStatus();
-static void attemptCellularRecovery();
-static void attemptMemoryRecovery();
-
-// Main Task: UI, Buttons, StampPLC, System Management
-void vTaskMainRecovery(void* pvParameters) {
-    Serial.println("[Main] Recovery task started");
-    
-    const TickType_t taskDelay = pdMS_TO_TICKS(50); // 20Hz update rate
-    TickType_t lastWake = xTaskGetTickCount();
-    
-    // Button state tracking (no external dependencies)
-    uint32_t lastButtonCheck = 0;
-    bool lastButtonA = false, lastButtonB = false, lastButtonC = false;
-    
-    for (;;) {
-        // Memory monitoring (every cycle)
-        MemoryManager::checkEmergencyMemory();
-        MemoryManager::logMemoryUsage();
-        
-        // Update StampPLC if available
-        if (stampPLC && stampPLC->isReady()) {
-            stampPLC->update();
-            
-            // Simple button handling (no complex UI events)
-            auto* plc = stampPLC->getStamPLC();
-            if (plc) {
-                bool btnA = plc->BtnA.wasPressed();
-                bool btnB = plc->BtnB.wasPressed();
-                bool btnC = plc->BtnC.wasPressed();
-                
-                // Update activity timestamp
-                if (btnA || btnB || btnC) {
-                    lastActivity = millis();
-                }
-                
-                // Simple navigation
-                if (btnA) {
-                    currentPage = DisplayPage::LANDING_PAGE;
-                    pageChanged = true;
-                }
-                if (btnB && currentPage != DisplayPage::LANDING_PAGE) {
-                    currentPage = (DisplayPage)((int)currentPage - 1);
-                    if (currentPage < DisplayPage::LANDING_PAGE) {
-                        currentPage = DisplayPage::SYSTEM_PAGE;
-                    }
-                    pageChanged = true;
-                }
-                if (btnC) {
-                    currentPage = (DisplayPage)((int)currentPage + 1);
-                    if (currentPage > DisplayPage::SYSTEM_PAGE) {
-                        currentPage = DisplayPage::LANDING_PAGE;
-                    }
-                    pageChanged = true;
-                }
-            }
-        }
-        
-        // UI updates (only when page changes)
-        if (pageChanged) {
-            // Simple page rendering
-            M5StamPLC.Display.fillScreen(BLACK);
-            
-            switch (currentPage) {
-                case DisplayPage::LANDING_PAGE:
-                    drawLandingPage();
-                    break;
-                case DisplayPage::GNSS_PAGE:
-                    drawGNSSPage();
-                    break;
-                case DisplayPage::CELLULAR_PAGE:
-                    drawCellularPage();
-                    break;
-                case DisplayPage::SYSTEM_PAGE:
-                    drawSystemPage();
-                    break;
-                default:
-                    drawLandingPage();
-                    break;
-            }
-            
-            // Draw simple status
-            M5StamPLC.Display.setCursor(0, 0);
-            M5StamPLC.Display.setTextColor(WHITE);
-            M5StamPLC.Display.printf("State: %d | Cell: %s | Mem: %u", 
-                                  (int)currentState,
-                                  commState.cellularConnected ? "OK" : "FAIL",
-                                  ESP.getFreeHeap());
-            
-            pageChanged = false;
-        }
-        
-        // State machine update
-        updateSystemState();
-        
-        vTaskDelayUntil(&lastWake, taskDelay);
-    }
+void markPhase(Phase p) {
+    uint32_t& t = s_phaseMs[(size_t)p];
+    if (t) return;
+    t = millis() | 1;
+    status("%s after %lu ms", kPhaseNames[(size_t)p], (unsigned long)t);
 }
 
-// Communication Task: Cellular, GNSS, Storage (isolated from UI)
-void vTaskCommunicationRecovery(void* pvParameters) {
-    Serial.println("[Comm] Recovery communication task started");
-    
-    const TickType_t taskDelay = pdMS_TO_TICKS(1000); // 1Hz update
-    TickType_t lastWake = xTaskGetTickCount();
-    
-    for (;;) {
-        // Drive GNSS update cycle
-        if (catmGnssModule && catmGnssModule->isModuleInitialized()) {
-            catmGnssModule->updateGNSSData();
-        }
-
-        // Cellular status check
-        if (catmGnssModule && millis() - commState.lastCellularCheck > 5000) {
-            commState.lastCellularCheck = millis();
-            
-            // Non-blocking status check
-            // Note: This would need to be adapted based on actual CatMGNSSModule API
-            bool wasConnected = commState.cellularConnected;
-            commState.cellularConnected = checkCellularStatus();
-            
-            if (wasConnected && !commState.cellularConnected) {
-                errorState.cellularFailures++;
-                Serial.printf("[Comm] Cellular connection lost (failure #%u)\n", 
-                           errorState.cellularFailures);
-                
-                if (errorState.cellularFailures > 3) {
-                    currentState = RecoveryState::CELLULAR_ISSUE;
-                }
-            }
-        }
-        
-        // GNSS status check
-        if (millis() - commState.lastGnssCheck > 10000) { // Every 10 seconds
-            commState.lastGnssCheck = millis();
-            commState.gnssEnabled = checkGnssStatus();
-        }
-        
-        vTaskDelayUntil(&lastWake, taskDelay);
+bool fetchSharedAttributes(CatMGNSSModule* module, uint32_t now) {
+    char url[224];
+    bool ok = transport_thingsboardUrl(TransportPacketKind::Attributes, url, sizeof(url)) &&
+              strlcat(url, "?sharedKeys=" SHARED_ATTR_KEYS, sizeof(url)) < sizeof(url);
+    if (ok) {
+        String response;
+        ok = module->sendHTTP(String(url), String(), response) &&
+             g_sharedAttributes.apply(response.c_str(), response.length());
     }
+    g_sharedAttributes.markFetched(now, ok);
+    return ok;
 }
 
-// Watchdog Task: System monitoring and recovery
-void vTaskWatchdogRecovery(void* pvParameters) {
-    Serial.println("[Watchdog] Recovery watchdog task started");
-    
-    const TickType_t taskDelay = pdMS_TO_TICKS(5000); // 5Hz check
-    TickType_t lastWake = xTaskGetTickCount();
-    
-    for (;;) {
-        // Check if main task is responsive
-        uint32_t timeSinceActivity = millis() - lastActivity;
-        if (timeSinceActivity > WATCHDOG_TIMEOUT_MS) {
-            Serial.printf("[Watchdog] Main task unresponsive for %lu ms\n", timeSinceActivity);
-            
-            // Attempt recovery
-            if (timeSinceActivity > WATCHDOG_TIMEOUT_MS * 2) {
-                Serial.println("[Watchdog] Forced system reset");
-                ESP.restart();
-            }
-        }
-        
-        // Check system state and trigger recovery if needed
-        if (currentState == RecoveryState::CELLULAR_ISSUE) {
-            Serial.println("[Watchdog] Attempting cellular recovery");
-            attemptCellularRecovery();
-        }
-        
-        if (currentState == RecoveryState::MEMORY_ISSUE) {
-            Serial.println("[Watchdog] Attempting memory recovery");
-            attemptMemoryRecovery();
-        }
-        
-        vTaskDelayUntil(&lastWake, taskDelay);
+bool sendReport() {
+    char json[160];
+    int n = snprintf(json, sizeof(json), "{\"recovery\":1,\"reset\":%u,\"crash\":%d", (unsigned)s_resetReason,
+                     crash_dump_pending() ? 1 : 0);
+    for (size_t i = 0; i < (size_t)Phase::Count && n > 0 && (size_t)n < sizeof(json); i++) {
+        n += snprintf(json + n, sizeof(json) - n, ",\"t_%s\":%lu", kPhaseNames[i], (unsigned long)s_phaseMs[i]);
     }
+    if (n <= 0 || (size_t)n + 2 > sizeof(json)) return false;
+    json[n++] = '}';
+    json[n] = '\0';
+    return transport_sendDiagnostic(json, (size_t)n);
 }
 
-// ============================================================================
-// SYSTEM STATE MANAGEMENT
-// ============================================================================
+void vTaskRecovery(void*) {
+    AppSettings settings{};
+    g_settings.get(settings);
+    const char* apn = settings.apn[0] ? settings.apn : RECOVERY_FALLBACK_APN;
 
-void updateSystemState() {
-    static uint32_t lastStateUpdate = 0;
-    if (millis() - lastStateUpdate < 1000) return; // Update once per second
-    lastStateUpdate = millis();
-    
-    // Check for various error conditions
-    RecoveryState newState = RecoveryState::RUNNING;
-    
-    if (errorState.cellularFailures > 5) {
-        newState = RecoveryState::CELLULAR_ISSUE;
-    }
-    
-    if (errorState.memoryWarnings > 10) {
-        newState = RecoveryState::MEMORY_ISSUE;
-    }
-    
-    if (errorState.systemErrors > 3) {
-        newState = RecoveryState::SYSTEM_ERROR;
+    CatMGNSSModule* module = new CatMGNSSModule();
+    while (!module->begin()) {
+        status("modem: %s", module->getLastError().c_str());
+        if (millis() > RECOVERY_SESSION_TIMEOUT_MS) esp_restart();
+        vTaskDelay(pdMS_TO_TICKS(2000));
     }
-    
-    if (newState != currentState) {
-        Serial.printf("[State] %d -> %d\n", (int)currentState, (int)newState);
-        currentState = newState;
-        pageChanged = true; // Trigger UI update
-    }
-}
-
-bool checkCellularStatus() {
-    // Check actual network connection state
-    if (!catmGnssModule) return false;
-    return catmGnssModule->isNetworkConnected();
-}
-
-bool checkGnssStatus() {
-    // Check if we have a valid GNSS fix
-    if (!catmGnssModule) return false;
-    return catmGnssModule->hasValidFix();
-}
+    catmGnssModule = module;
+    module->disableGNSS();
+    module->setApnCredentials(String(apn), String(settings.apnUser), String(settings.apnPass));
+    markPhase(Phase::Modem);
+
+    uint32_t lastAttachMs = 0;
+    uint32_t lastAttrMs = 0;
+    bool reported = false;
+    OtaState lastOta = OtaState::IDLE;
+    for (;;) {
+        const uint32_t now = millis();
+        if (!module->isNetworkConnected()) {
+            if (!s_phaseMs[(size_t)Phase::Session] && now > RECOVERY_SESSION_TIMEOUT_MS) {
+                status("no data session, restarting");
+                esp_restart();
+            }
+            if (lastAttachMs == 0 || now - lastAttachMs >= RECOVERY_ATTACH_RETRY_MS) {
+                lastAttachMs = now | 1;
+                status("attach, APN %s", apn);
+                module->connectNetwork(String(apn), String(settings.apnUser), String(settings.apnPass));
+            }
+            vTaskDelay(pdMS_TO_TICKS(1000));
+            continue;
+        }
+        markPhase(Phase::Session);
 
-void attemptCellularRecovery() {
-    Serial.println("[Recovery] Attempting cellular module reset");
-    
-    if (catmGnssModule) {
-        // Try to reinitialize the module
-        if (catmGnssModule->begin()) {
-            Serial.println("[Recovery] Cellular module recovery successful");
-            errorState.cellularFailures = 0;
-            currentState = RecoveryState::RUNNING;
-            pageChanged = true;
-        } else {
-            Serial.println("[Recovery] Cellular recovery failed");
+        if (lastAttrMs == 0 || now - lastAttrMs >= RECOVERY_ATTR_POLL_MS) {
+            lastAttrMs = now | 1;
+            if (fetchSharedAttributes(module, now)) markPhase(Phase::Attributes);
+        }
+        // First report once the attributes were tried, so it carries that time too
+        if (!reported && lastAttrMs) reported = sendReport();
+        crash_dump_poll(now);
+        transport_process();
+        ota_client_poll(module, now);
+
+        OtaStatus ota;
+        ota_client_status(ota);
+        if (ota.state != lastOta) {
+            lastOta = ota.state;
+            if (ota.state == OtaState::DOWNLOADING) status("OTA download started");
+            if (ota.state == OtaState::FAILED) status("OTA failed: %s", ota.error);
         }
+        vTaskDelay(pdMS_TO_TICKS(ota_client_active() ? 50 : 1000));
     }
 }
+} // namespace
 
-void attemptMemoryRecovery() {
-    Serial.println("[Recovery] Attempting memory recovery");
-    
-    // Force garbage collection
-    ESP.restart(); // Simplified recovery - full reset
-}
-
-// ============================================================================
-// SIMPLIFIED SETUP
-// ============================================================================
-
-void setupRecovery() {
-    // Initialize serial
+void setup() {
     Serial.begin(115200);
-    delay(2000);
-    Serial.println("\n=== GENPLC Recovery Mode ===");
-    Serial.println("Emergency stabilization build");
-    
-    // Suppress noisy logs
-    esp_log_level_set("vfs_api", ESP_LOG_NONE);
-    esp_log_level_set("vfs", ESP_LOG_NONE);
-    esp_log_level_set("sd_diskio", ESP_LOG_NONE);
-    esp_log_level_set("Wire", ESP_LOG_ERROR);
-    
-    // Initialize M5StamPLC (minimal)
+    s_resetReason = (uint8_t)esp_reset_reason();
+    esp_log_level_set("*", ESP_LOG_WARN);
+
     M5StamPLC.begin();
     M5StamPLC.Display.setBrightness(128);
     M5StamPLC.Display.fillScreen(BLACK);
     M5StamPLC.Display.setCursor(0, 0);
     M5StamPLC.Display.setTextColor(WHITE);
-    M5StamPLC.Display.println("GENPLC Recovery Mode");
-    M5StamPLC.Display.println("Initializing...");
-    
-    // Initialize essential modules only
-    Serial.println("Initializing essential modules...");
-    
-    // StampPLC
-    stampPLC = new BasicStampPLC();
-    if (stampPLC && stampPLC->begin()) {
-        Serial.println("StampPLC initialized");
-    } else {
-        Serial.println("StampPLC initialization failed");
-        delete stampPLC;
-        stampPLC = nullptr;
-    }
-    
-    // CatM+GNSS (with error handling)
-    catmGnssModule = new CatMGNSSModule();
-    if (catmGnssModule && catmGnssModule->begin()) {
-        Serial.println("CatM+GNSS initialized");
-    } else {
-        Serial.println("CatM+GNSS initialization failed");
-        delete catmGnssModule;
-        catmGnssModule = nullptr;
-        currentState = RecoveryState::CELLULAR_ISSUE;
-    }
-    
-    // Create UI event queue
-    uiEventQueue = xQueueCreate(10, sizeof(UIEventMsg));
-    if (!uiEventQueue) {
-        Serial.println("FATAL: Failed to create UI event queue");
-        ESP.restart();
-    }
-    
-    // Initialize activity tracking
-    lastActivity = millis();
-    
-    Serial.println("Recovery initialization complete");
-    delay(1000);
-}
+    status("GENPLC recovery %s, reset %u", STAMPLC_VERSION, (unsigned)s_resetReason);
 
-void setup() {
-    setupRecovery();
-    
-    // Create simplified task architecture
-    Serial.println("Creating recovery tasks...");
-    
-    // Main task (Core 1) - UI, buttons, system management
-    BaseType_t result1 = xTaskCreatePinnedToCore(
-        vTaskMainRecovery,
-        "MainRecovery",
-        8192,  // 32KB stack - conservative
-        nullptr,
-        2,      // Medium priority
-        &mainTaskHandle,
-        1       // Core 1
-    );
-    
-    // Communication task (Core 0) - Cellular, GNSS, storage
-    BaseType_t result2 = xTaskCreatePinnedToCore(
-        vTaskCommunicationRecovery,
-        "CommRecovery", 
-        6144,  // 24KB stack - conservative
-        nullptr,
-        3,      // High priority for communication
-        &communicationTaskHandle,
-        0       // Core 0
-    );
-    
-    // Watchdog task (Core 0) - System monitoring
-    BaseType_t result3 = xTaskCreatePinnedToCore(
-        vTaskWatchdogRecovery,
-        "WatchdogRecovery",
-        4096,  // 16KB stack - minimal
-        nullptr,
-        4,      // Highest priority
-        &watchdogTaskHandle,
-        0       // Core 0
-    );
-    
-    if (result1 != pdPASS || result2 != pdPASS || result3 != pdPASS) {
-        Serial.println("FATAL: Failed to create recovery tasks");
-        ESP.restart();
+    crash_dump_begin(s_resetReason);
+    g_settings.begin();
+    ota_client_begin();
+
+    if (xTaskCreatePinnedToCore(vTaskRecovery, "Recovery", RECOVERY_TASK_STACK, nullptr, RECOVERY_TASK_PRIORITY,
+                                &s_taskHandle, 0) != pdPASS) {
+        Serial.println("FATAL: Failed to create recovery task");
+        esp_restart();
     }
-    
-    Serial.println("Recovery tasks created successfully");
-    currentState = RecoveryState::RUNNING;
-    
-    M5StamPLC.Display.fillScreen(BLACK);
-    M5StamPLC.Display.setCursor(0, 0);
-    M5StamPLC.Display.println("GENPLC Recovery Mode");
-    M5StamPLC.Display.println("System Running");
-    M5StamPLC.Display.println("A: Home | B: Prev | C: Next");
 }
 
 void loop() {
-    // Main loop is empty - FreeRTOS handles everything
     vTaskDelay(pdMS_TO_TICKS(1000));
 }
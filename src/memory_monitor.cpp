@@ -7,8 +7,60 @@
 
 #include "../include/memory_monitor.h"
 #include "../include/string_pool.h"
+#include "../include/object_pool.h"
 #include "../include/ui_utils.h"
 #include "config/task_config.h"
+#include "system/heap_profiler.h"
+#include "system/kernel_objects.h"
+#include "system/cpu_profiler.h"
+#include "system/sched_analysis.h"
+#include "system/core_affinity.h"
+#include "system/boot_profile.h"
+#include "system/service_task.h"
+#include "system/work_queue.h"
+#include "system/stack_profiler.h"
+#include "system/crash_dump.h"
+#include "system/event_bus.h"
+#include "system/reset_journal.h"
+#include "system/mutex_profiler.h"
+#include "system/task_heap.h"
+#include "system/power_manager.h"
+#include "system/error_ring.h"
+#include "system/time_service.h"
+#include "system/time_utils.h"
+#include "system/metrics.h"
+#include "system/energy_account.h"
+#include "system/soak_bench.h"
+#include "system/load_shed.h"
+#include "modules/transport/ota_client.h"
+#include "modules/transport/live_config.h"
+#include "modules/transport/remote_diag.h"
+#include "modules/transport/backfill.h"
+#include "modules/storage/storage_task.h"
+#include "modules/catm_gnss/modem_transcript.h"
+#include "modules/catm_gnss/geofence.h"
+#include "modules/catm_gnss/gnss_assist.h"
+#include "modules/catm_gnss/operator_scan.h"
+#include "modules/catm_gnss/catm_gnss_task.h"
+#include "hardware/input_capture.h"
+#include "hardware/plc_scan.h"
+#include "hardware/plc_logic.h"
+#include "hardware/alarm_eval.h"
+#include "hardware/analog_sampler.h"
+#include "hardware/generator_derived.h"
+#include "modules/settings/hour_meter.h"
+#include "hardware/modbus_master.h"
+#include "hardware/modbus_slave.h"
+#include "hardware/sensor_acquisition.h"
+#include "hardware/button_input.h"
+#include "modules/pwrcan/can_capture.h"
+#if ENABLE_PWRCAN
+#include "modules/pwrcan/pwrcan_module.h"
+extern PWRCANModule* pwrcanModule;
+#endif
+#include "ui/components/ui_widgets.h"
+#include "ui/components/ui_text.h"
+#include "ui/ui_perf.h"
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
@@ -18,10 +70,27 @@
 // ============================================================================
 MemoryMonitor g_memoryMonitor;
 
+// Heap in the metrics registry, read straight from the allocator rather than the sampled stats
+static MetricGauge s_metricFree("mem.free", [] { return static_cast<int32_t>(ESP.getFreeHeap()); });
+static MetricGauge s_metricMinFree("mem.min_free", [] { return static_cast<int32_t>(ESP.getMinFreeHeap()); });
+static MetricGauge s_metricLargest("mem.largest", [] { return static_cast<int32_t>(ESP.getMaxAllocHeap()); });
+
+// Constant-initialized, so registrations from static constructors are safe
+static const ObjectPoolStats* s_pools[MEMORY_MONITOR_MAX_POOLS];
+static uint8_t s_poolCount = 0;
+
+bool MemoryMonitor::registerPool(const ObjectPoolStats* pool) {
+    if (!pool || s_poolCount >= MEMORY_MONITOR_MAX_POOLS) {
+        return false;
+    }
+    s_pools[s_poolCount++] = pool;
+    return true;
+}
+
 // ============================================================================
 // CONSTRUCTOR/DESTRUCTOR
 // ============================================================================
-MemoryMonitor::MemoryMonitor() : monitorTaskHandle(nullptr), mutex(nullptr), isRunning(false) {
+MemoryMonitor::MemoryMonitor() : serviceJob(SERVICE_JOB_NONE), mutex(nullptr), isRunning(false) {
     // Initialize stats
     memset(&stats, 0, sizeof(MemoryStats));
     stats.status = MemoryStatus::NORMAL;
@@ -37,7 +106,7 @@ MemoryMonitor::~MemoryMonitor() {
 // MONITOR MANAGEMENT
 // ============================================================================
 bool MemoryMonitor::begin() {
-    mutex = xSemaphoreCreateMutex();
+    mutex = kernel_mutex_create(KernelMutex::MemoryMonitor);
     if (!mutex) {
         Serial.println("MemoryMonitor: Failed to create mutex");
         return false;
@@ -56,10 +125,8 @@ bool MemoryMonitor::begin() {
 void MemoryMonitor::shutdown() {
     stopMonitoring();
     
-    if (mutex) {
-        vSemaphoreDelete(mutex);
-        mutex = nullptr;
-    }
+    kernel_mutex_delete(KernelMutex::MemoryMonitor, mutex);
+    mutex = nullptr;
     
     g_stringPool.shutdown();
 }
@@ -70,25 +137,13 @@ void MemoryMonitor::shutdown() {
 void MemoryMonitor::startMonitoring() {
     if (isRunning || !mutex) return;
     
-    // Set flag BEFORE task creation to prevent race condition
-    isRunning = true;
-    
-    BaseType_t result = xTaskCreatePinnedToCore(
-        monitorTask,
-        "MemoryMonitor",
-        MEMORY_MONITOR_TASK_STACK_SIZE,
-        this,
-        MEMORY_MONITOR_TASK_PRIORITY,
-        &monitorTaskHandle,
-        0  // Core 0
-    );
-    
-    if (result == pdPASS) {
+    serviceJob = service_job_add("MemoryMonitor", monitorJob, this,
+                                 MEMORY_MONITOR_INTERVAL_MS, MEMORY_MONITOR_JOB_BUDGET_US);
+    if (serviceJob != SERVICE_JOB_NONE) {
+        isRunning = true;
         Serial.println("MemoryMonitor: Started monitoring");
     } else {
-        // Reset flag if task creation failed
-        isRunning = false;
-        Serial.println("MemoryMonitor: Failed to start monitoring task");
+        Serial.println("MemoryMonitor: Failed to schedule monitoring job");
     }
 }
 
@@ -96,30 +151,17 @@ void MemoryMonitor::stopMonitoring() {
     if (!isRunning) return;
     
     isRunning = false;
-    
-    if (monitorTaskHandle) {
-        vTaskDelete(monitorTaskHandle);
-        monitorTaskHandle = nullptr;
-    }
+    service_job_remove(serviceJob);
+    serviceJob = SERVICE_JOB_NONE;
     
     Serial.println("MemoryMonitor: Stopped monitoring");
 }
 
 // ============================================================================
-// MONITOR TASK
+// MONITOR JOB
 // ============================================================================
-void MemoryMonitor::monitorTask(void* pvParameters) {
-    MemoryMonitor* monitor = static_cast<MemoryMonitor*>(pvParameters);
-    
-    Serial.println("MemoryMonitor: Task started");
-    
-    while (monitor->isRunning) {
-        monitor->update();
-        vTaskDelay(pdMS_TO_TICKS(MEMORY_MONITOR_INTERVAL_MS));
-    }
-    
-    Serial.println("MemoryMonitor: Task ended");
-    vTaskDelete(nullptr);
+void MemoryMonitor::monitorJob(void* ctx) {
+    static_cast<MemoryMonitor*>(ctx)->update();
 }
 
 // ============================================================================
@@ -174,6 +216,10 @@ void MemoryMonitor::update() {
         addToHistory(stats.freeHeap);
         xSemaphoreGive(mutex);
     }
+
+    // Outside the mutex: the periodic SD report waits for the card
+    heap_profile_poll(millis());
+    task_heap_poll();
 }
 
 void MemoryMonitor::printStats() const {
@@ -194,9 +240,76 @@ void MemoryMonitor::printStats() const {
         
         // Print string pool stats
         g_stringPool.printStatistics();
+
+        for (uint8_t i = 0; i < s_poolCount; i++) {
+            const ObjectPoolStats* p = s_pools[i];
+            Serial.printf("Pool %s: %u/%u x %u B, high water %u, exhausted %u\n", p->name, p->inUse, p->capacity,
+                          p->objectSize, p->highWater, (unsigned)p->exhausted);
+        }
         
         xSemaphoreGive(mutex);
     }
+    // Per-task heap, static kernel buffers, CPU profile and top allocation sites, when built in
+    // Per-task heap and top allocation sites, when the heap hooks are built in
+    task_heap_report(Serial);
+    kernel_objects_report(Serial);
+    service_report(Serial);
+    work_report(Serial);
+    cpu_profile_report(Serial);
+    event_bus_report(Serial);
+    sched_analysis_report(Serial);
+    load_shed_report(Serial);
+    core_affinity_report(Serial);
+    stack_profile_report(Serial);
+    crash_dump_report(Serial);
+    reset_journal_report(Serial);
+    ota_client_report(Serial);
+    live_config_report(Serial);
+    remote_diag_report(Serial);
+    backfill_report(Serial);
+    storage_pressure_report(Serial);
+    modem_transcript_report(Serial);
+    soak_bench_report(Serial);
+    catm_task_report(Serial);
+    geofence_report(Serial);
+    gnss_assist_report(Serial);
+    operator_scan_report(Serial);
+    metrics_report(Serial);
+    boot_profile_report(Serial);
+    mutex_profile_report(Serial);
+    error_ring_report(Serial);
+    heap_profile_report(Serial, 8);
+    power_report(Serial);
+    energy_report(Serial);
+    time_service_report(Serial);
+    time_sync_report(Serial);
+    plc_scan_report(Serial);
+    plc_logic_report(Serial);
+    alarm_report(Serial);
+    input_capture_report(Serial);
+    sensor_acq_report(Serial);
+    analog_sampler_report(Serial);
+    hour_meter_report(Serial);
+    generator_derived_report(Serial);
+    modbus_report(Serial);
+    modbus_slave_report(Serial);
+#if ENABLE_PWRCAN
+    if (pwrcanModule) {
+        pwrcanModule->getDispatcher().report(Serial);
+        pwrcanModule->getJ1939().report(Serial);
+        Serial.printf("CAN bus load %lu%% (peak %lu%%), TX queued to sent %lu us (max %lu us)\n",
+                      (unsigned long)pwrcanModule->getBusLoad(), (unsigned long)pwrcanModule->getBusLoadPeak(),
+                      (unsigned long)pwrcanModule->getTxLatencyUs(), (unsigned long)pwrcanModule->getTxLatencyMaxUs());
+        pwrcanModule->getTxScheduler().report(Serial);
+    }
+    can_capture_report(Serial);
+#endif
+    if (kBuildFeatures.display) {
+        ui_render_report(Serial);
+        ui_perf_report(Serial);
+        button_input_report(Serial);
+        ui_text_report(Serial);
+    }
 }
 
 // ============================================================================
@@ -219,6 +332,7 @@ void MemoryMonitor::updateStats() {
 void MemoryMonitor::checkThresholds() {
     uint32_t freePercent = (stats.freeHeap * 100) / stats.totalHeap;
     
+    const MemoryStatus was = stats.status;
     if (freePercent <= MEMORY_CRITICAL_THRESHOLD_PERCENT) {
         if (stats.status != MemoryStatus::CRITICAL) {
             stats.status = MemoryStatus::CRITICAL;
@@ -232,6 +346,16 @@ void MemoryMonitor::checkThresholds() {
     } else {
         stats.status = MemoryStatus::NORMAL;
     }
+
+    // Every level change, back to normal included; the display gives up its strips on Critical
+    if (stats.status != was) {
+        HeapLowEvent e{};
+        e.level = stats.status == MemoryStatus::CRITICAL     ? HeapLevel::Critical
+                  : stats.status == MemoryStatus::LOW_MEMORY ? HeapLevel::Low
+                                                             : HeapLevel::Normal;
+        e.freeBytes = stats.freeHeap;
+        event_bus_publish<EventTopic::HeapLow>(e);
+    }
 }
 
 void MemoryMonitor::addToHistory(uint32_t freeHeap) {
@@ -251,12 +375,9 @@ void MemoryMonitor::alertCriticalMemory() {
     Serial.printf("MEMORY CRITICAL: Very low memory - %u bytes free (%.1f%%)\n",
                  stats.freeHeap, (float)stats.freeHeap * 100.0f / stats.totalHeap);
     
-    // Aggressive cleanup
+    // Aggressive cleanup; the display releases its strips on the HeapLow event
     g_stringPool.cleanup();
     
-    // Clean up sprites to free memory
-    cleanupAllSprites();
-    
     // Force garbage collection if available
     #ifdef ESP32
     // ESP32 doesn't have explicit GC, but we can try to defragment
@@ -1,6 +1,34 @@
 #include "memory_pool.h"
 #include "config/task_config.h"
 #include "../modules/logging/log_buffer.h"
+#include <string.h>
+
+// ============================================================================
+// BLOCK STORAGE
+// ============================================================================
+namespace {
+#define MEMORY_POOL_CLASS_BYTES(size, count) + (size_t)(size) * (count)
+#define MEMORY_POOL_CLASS_SIZE(size, count) (uint16_t)(size),
+#define MEMORY_POOL_CLASS_BLOCKS(size, count) (uint16_t)(count),
+
+constexpr size_t kArenaBytes = 0 MEMORY_POOL_CLASSES(MEMORY_POOL_CLASS_BYTES);
+constexpr uint16_t kClassSizes[] = {MEMORY_POOL_CLASSES(MEMORY_POOL_CLASS_SIZE)};
+constexpr uint16_t kClassBlocks[] = {MEMORY_POOL_CLASSES(MEMORY_POOL_CLASS_BLOCKS)};
+
+alignas(8) uint8_t s_arena[kArenaBytes];
+
+constexpr bool classesValid(size_t i = 0) {
+    return i >= sizeof(kClassSizes) / sizeof(kClassSizes[0]) ||
+           (kClassSizes[i] % 8 == 0 && kClassBlocks[i] > 0 && kClassBlocks[i] <= 128 &&
+            (i == 0 || kClassSizes[i] > kClassSizes[i - 1]) && classesValid(i + 1));
+}
+static_assert(classesValid(), "MEMORY_POOL_CLASSES: sizes must grow in multiples of 8, 1-128 blocks each");
+static_assert(MEMORY_POOL_MAGAZINE_SIZE <= 32, "MEMORY_POOL_MAGAZINE_SIZE too large");
+
+inline size_t currentCore() {
+    return static_cast<size_t>(xPortGetCoreID()) % portNUM_PROCESSORS;
+}
+} // namespace
 
 // ============================================================================
 // MEMORY POOL SINGLETON IMPLEMENTATION
@@ -14,58 +42,34 @@ MemoryPool* MemoryPool::getInstance() {
     return instance;
 }
 
-MemoryPool::MemoryPool() {
-    totalAllocated = 0;
-    peakUsage = 0;
-    allocCount = 0;
-    freeCount = 0;
-    fragmentationCount = 0;
-    
-    // Initialize mutex
-    poolMutex = xSemaphoreCreateMutex();
-    if (!poolMutex) {
-        Serial.println("MemoryPool: Failed to create mutex");
-        return;
-    }
-    
-    // Initialize all blocks
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        smallBlocks[i].inUse = false;
-        smallBlocks[i].size = MEMORY_POOL_SMALL_SIZE;
-        smallBlocks[i].data = malloc(MEMORY_POOL_SMALL_SIZE);
-        smallBlocks[i].owner = nullptr;
-        smallBlocks[i].timestamp = 0;
-    }
-    
-    for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-        mediumBlocks[i].inUse = false;
-        mediumBlocks[i].size = MEMORY_POOL_MEDIUM_SIZE;
-        mediumBlocks[i].data = malloc(MEMORY_POOL_MEDIUM_SIZE);
-        mediumBlocks[i].owner = nullptr;
-        mediumBlocks[i].timestamp = 0;
-    }
-    
-    for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-        largeBlocks[i].inUse = false;
-        largeBlocks[i].size = MEMORY_POOL_LARGE_SIZE;
-        largeBlocks[i].data = malloc(MEMORY_POOL_LARGE_SIZE);
-        largeBlocks[i].owner = nullptr;
-        largeBlocks[i].timestamp = 0;
+MemoryPool::MemoryPool()
+    : classMux(portMUX_INITIALIZER_UNLOCKED), totalAllocated(0), peakUsage(0), allocCount(0), freeCount(0),
+      fragmentationCount(0) {
+    uint8_t* base = s_arena;
+    for (size_t i = 0; i < kClassCount; i++) {
+        SizeClass& c = classes[i];
+        c.base = base;
+        c.blockSize = kClassSizes[i];
+        c.blockCount = kClassBlocks[i];
+        // Cache only when every core can hold a magazine and half the class stays shared
+        const size_t cap = c.blockCount / (2 * kCores);
+        c.magazineCap = static_cast<uint8_t>(cap < MEMORY_POOL_MAGAZINE_SIZE ? cap : MEMORY_POOL_MAGAZINE_SIZE);
+        base += static_cast<size_t>(c.blockSize) * c.blockCount;
+        for (size_t core = 0; core < kCores; core++) {
+            magazines[core][i].mux = portMUX_INITIALIZER_UNLOCKED;
+            magazines[core][i].count = 0;
+        }
     }
-    
+    cleanup();
+
     Serial.println("MemoryPool: Initialized with fixed-size pools");
     log_add("Memory pool system initialized");
 }
 
 MemoryPool::~MemoryPool() {
     cleanup();
-    
-    if (poolMutex) {
-        vSemaphoreDelete(poolMutex);
-    }
-    
-    if (instance) {
-        delete instance;
+
+    if (instance == this) {
         instance = nullptr;
     }
 }
@@ -76,126 +80,204 @@ void MemoryPool::initialize() {
 }
 
 void MemoryPool::cleanup() {
-    if (!poolMutex) return;
-    
-    if (xSemaphoreTake(poolMutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        Serial.println("MemoryPool: Failed to acquire mutex for cleanup");
-        return;
-    }
-    
-    // Free all small blocks
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        if (smallBlocks[i].data) {
-            free(smallBlocks[i].data);
-            smallBlocks[i].data = nullptr;
-        }
-        smallBlocks[i].inUse = false;
-        smallBlocks[i].owner = nullptr;
-    }
-    
-    // Free all medium blocks
-    for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-        if (mediumBlocks[i].data) {
-            free(mediumBlocks[i].data);
-            mediumBlocks[i].data = nullptr;
+    for (size_t i = 0; i < kClassCount; i++) {
+        SizeClass& c = classes[i];
+        for (size_t core = 0; core < kCores; core++) {
+            portENTER_CRITICAL(&magazines[core][i].mux);
+            magazines[core][i].count = 0;
+            portEXIT_CRITICAL(&magazines[core][i].mux);
         }
-        mediumBlocks[i].inUse = false;
-        mediumBlocks[i].owner = nullptr;
-    }
-    
-    // Free all large blocks
-    for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-        if (largeBlocks[i].data) {
-            free(largeBlocks[i].data);
-            largeBlocks[i].data = nullptr;
+        portENTER_CRITICAL(&classMux);
+        for (size_t w = 0; w < kMaxWords; w++) {
+            const int bits = static_cast<int>(c.blockCount) - static_cast<int>(w * 32);
+            c.freeMap[w] = bits >= 32 ? 0xFFFFFFFFu : bits > 0 ? ((1u << bits) - 1) : 0;
+#if MEMORY_POOL_DEBUG
+            c.liveMap[w].store(0, std::memory_order_relaxed);
+#endif
         }
-        largeBlocks[i].inUse = false;
-        largeBlocks[i].owner = nullptr;
+        c.inUse.store(0, std::memory_order_relaxed);
+        c.peakInUse = 0;
+        portEXIT_CRITICAL(&classMux);
+#if MEMORY_POOL_DEBUG
+        memset(c.base, MEMORY_POOL_POISON, static_cast<size_t>(c.blockSize) * c.blockCount);
+#endif
     }
-    
+
     totalAllocated = 0;
     allocCount = 0;
     freeCount = 0;
-    
-    xSemaphoreGive(poolMutex);
-    Serial.println("MemoryPool: Cleanup completed");
 }
 
-void* MemoryPool::allocate(size_t size) {
-    if (!poolMutex) {
-        Serial.println("MemoryPool: Mutex not available");
-        return nullptr;
-    }
-    
-    if (size == 0) {
-        return nullptr;
-    }
-    
-    if (xSemaphoreTake(poolMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        Serial.println("MemoryPool: Failed to acquire mutex for allocation");
-        return nullptr;
+// First free block by count-trailing-zeros, or -1; caller holds classMux
+int MemoryPool::popFreeLocked(SizeClass& c) {
+    for (size_t w = 0; w < kMaxWords; w++) {
+        if (c.freeMap[w]) {
+            const int bit = __builtin_ctz(c.freeMap[w]);
+            c.freeMap[w] &= c.freeMap[w] - 1;
+            return static_cast<int>(w * 32) + bit;
+        }
     }
-    
-    MemoryBlock* block = nullptr;
-    
-    // Find appropriate block size
-    if (size <= MEMORY_POOL_SMALL_SIZE) {
-        // Find free small block
-        for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-            if (!smallBlocks[i].inUse) {
-                block = &smallBlocks[i];
-                break;
+    return -1;
+}
+
+// Caller holds classMux
+void MemoryPool::releaseLocked(SizeClass& c, uint16_t index) {
+    c.freeMap[index / 32] |= 1u << (index % 32);
+}
+
+// Returns a free block index of cls, or -1 when the class is exhausted
+int MemoryPool::takeBlock(size_t cls) {
+    SizeClass& c = classes[cls];
+    const size_t core = currentCore();
+    int index = -1;
+
+    if (c.magazineCap) {
+        Magazine& m = magazines[core][cls];
+        portENTER_CRITICAL(&m.mux);
+        if (m.count == 0) {
+            portENTER_CRITICAL(&classMux);
+            const uint8_t want = static_cast<uint8_t>((c.magazineCap + 1) / 2);
+            while (m.count < want) {
+                const int i = popFreeLocked(c);
+                if (i < 0) break;
+                m.slots[m.count++] = static_cast<uint8_t>(i);
             }
+            portEXIT_CRITICAL(&classMux);
+        }
+        if (m.count) {
+            index = m.slots[--m.count];
         }
-    } else if (size <= MEMORY_POOL_MEDIUM_SIZE) {
-        // Find free medium block
-        for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-            if (!mediumBlocks[i].inUse) {
-                block = &mediumBlocks[i];
-                break;
+        portEXIT_CRITICAL(&m.mux);
+        if (index >= 0) {
+            return index;
+        }
+        // Bitmap empty: the other cores' magazines may still hold blocks. One
+        // magazine lock at a time, so two cores stealing cannot deadlock.
+        for (size_t other = 0; other < kCores && index < 0; other++) {
+            if (other == core) continue;
+            Magazine& o = magazines[other][cls];
+            portENTER_CRITICAL(&o.mux);
+            if (o.count) {
+                index = o.slots[--o.count];
             }
+            portEXIT_CRITICAL(&o.mux);
         }
-    } else if (size <= MEMORY_POOL_LARGE_SIZE) {
-        // Find free large block
-        for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-            if (!largeBlocks[i].inUse) {
-                block = &largeBlocks[i];
-                break;
+        return index;
+    }
+
+    portENTER_CRITICAL(&classMux);
+    index = popFreeLocked(c);
+    portEXIT_CRITICAL(&classMux);
+    return index;
+}
+
+void MemoryPool::returnBlock(size_t cls, uint16_t index) {
+    SizeClass& c = classes[cls];
+    if (c.magazineCap) {
+        Magazine& m = magazines[currentCore()][cls];
+        portENTER_CRITICAL(&m.mux);
+        if (m.count >= c.magazineCap) {
+            // Full: hand the older half back so the other core can reach it
+            portENTER_CRITICAL(&classMux);
+            const uint8_t keep = static_cast<uint8_t>(c.magazineCap / 2);
+            for (uint8_t i = 0; i < m.count - keep; i++) {
+                releaseLocked(c, m.slots[i]);
+            }
+            memmove(m.slots, m.slots + (m.count - keep), keep);
+            m.count = keep;
+            portEXIT_CRITICAL(&classMux);
+        }
+        m.slots[m.count++] = static_cast<uint8_t>(index);
+        portEXIT_CRITICAL(&m.mux);
+        return;
+    }
+    portENTER_CRITICAL(&classMux);
+    releaseLocked(c, index);
+    portEXIT_CRITICAL(&classMux);
+}
+
+void MemoryPool::drainMagazine(size_t core, size_t cls) {
+    SizeClass& c = classes[cls];
+    Magazine& m = magazines[core][cls];
+    portENTER_CRITICAL(&m.mux);
+    portENTER_CRITICAL(&classMux);
+    for (uint8_t i = 0; i < m.count; i++) {
+        releaseLocked(c, m.slots[i]);
+    }
+    m.count = 0;
+    portEXIT_CRITICAL(&classMux);
+    portEXIT_CRITICAL(&m.mux);
+}
+
+// Class and block index of a pool pointer; -1 when ptr is not a block start
+int MemoryPool::classOf(const void* ptr, uint16_t& index) const {
+    const uint8_t* p = static_cast<const uint8_t*>(ptr);
+    if (p < s_arena || p >= s_arena + kArenaBytes) {
+        return -1;
+    }
+    for (size_t i = 0; i < kClassCount; i++) {
+        const SizeClass& c = classes[i];
+        const size_t span = static_cast<size_t>(c.blockSize) * c.blockCount;
+        if (p < c.base + span) {
+            const size_t off = static_cast<size_t>(p - c.base);
+            if (off % c.blockSize != 0) {
+                return -1;
             }
+            index = static_cast<uint16_t>(off / c.blockSize);
+            return static_cast<int>(i);
         }
-    } else {
+    }
+    return -1;
+}
+
+void* MemoryPool::allocate(size_t size) {
+    if (size == 0) {
+        return nullptr;
+    }
+
+    size_t cls = 0;
+    while (cls < kClassCount && classes[cls].blockSize < size) {
+        cls++;
+    }
+    if (cls == kClassCount) {
         // Size too large for pool, fallback to heap
-        Serial.printf("MemoryPool: Size %u too large for pool, using heap\n", size);
-        fragmentationCount++;
-        xSemaphoreGive(poolMutex);
+        fragmentationCount.fetch_add(1, std::memory_order_relaxed);
         return malloc(size);
     }
-    
-    if (!block) {
-        // No suitable block available
-        Serial.printf("MemoryPool: No blocks available for size %u\n", size);
-        fragmentationCount++;
-        xSemaphoreGive(poolMutex);
+
+    // An exhausted class borrows from the next larger one
+    int index = -1;
+    for (; cls < kClassCount; cls++) {
+        index = takeBlock(cls);
+        if (index >= 0) break;
+    }
+    if (index < 0) {
+        fragmentationCount.fetch_add(1, std::memory_order_relaxed);
+        LOGF("MemoryPool: No blocks available for size %u", static_cast<unsigned>(size));
         return nullptr;
     }
-    
-    // Mark block as used
-    block->inUse = true;
-    block->owner = xTaskGetCurrentTaskHandle();
-    block->timestamp = millis();
-    
-    // Update statistics
-    totalAllocated += block->size;
-    allocCount++;
-    if (totalAllocated > peakUsage) {
-        peakUsage = totalAllocated;
+
+    SizeClass& c = classes[cls];
+    uint8_t* ptr = c.base + static_cast<size_t>(index) * c.blockSize;
+#if MEMORY_POOL_DEBUG
+    const uint32_t bit = 1u << (index % 32);
+    if (c.liveMap[index / 32].fetch_or(bit, std::memory_order_relaxed) & bit) {
+        LOGF("MemoryPool: block %u/%d handed out twice", static_cast<unsigned>(c.blockSize), index);
+    }
+    for (uint16_t i = 0; i < c.blockSize; i++) {
+        if (ptr[i] != MEMORY_POOL_POISON) {
+            LOGF("MemoryPool: block %u/%d written after free (offset %u)", static_cast<unsigned>(c.blockSize), index,
+                 static_cast<unsigned>(i));
+            break;
+        }
     }
-    
-    void* ptr = block->data;
-    
-    xSemaphoreGive(poolMutex);
-    
-    Serial.printf("MemoryPool: Allocated %u bytes from pool\n", block->size);
+#endif
+
+    const uint16_t used = c.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (used > c.peakInUse) c.peakInUse = used;   // statistics only; a lost race is harmless
+    const size_t total = totalAllocated.fetch_add(c.blockSize, std::memory_order_relaxed) + c.blockSize;
+    if (total > peakUsage.load(std::memory_order_relaxed)) peakUsage.store(total, std::memory_order_relaxed);
+    allocCount.fetch_add(1, std::memory_order_relaxed);
     return ptr;
 }
 
@@ -203,256 +285,99 @@ void MemoryPool::deallocate(void* ptr) {
     if (!ptr) {
         return;
     }
-    
-    if (!poolMutex) {
-        Serial.println("MemoryPool: Mutex not available for deallocation");
-        return;
-    }
-    
-    if (xSemaphoreTake(poolMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        Serial.println("MemoryPool: Failed to acquire mutex for deallocation");
-        return;
-    }
-    
-    bool found = false;
-    
-    // Search small blocks
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        if (smallBlocks[i].data == ptr && smallBlocks[i].inUse) {
-            smallBlocks[i].inUse = false;
-            smallBlocks[i].owner = nullptr;
-            totalAllocated -= smallBlocks[i].size;
-            freeCount++;
-            found = true;
-            break;
-        }
-    }
-    
-    // Search medium blocks
-    if (!found) {
-        for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-            if (mediumBlocks[i].data == ptr && mediumBlocks[i].inUse) {
-                mediumBlocks[i].inUse = false;
-                mediumBlocks[i].owner = nullptr;
-                totalAllocated -= mediumBlocks[i].size;
-                freeCount++;
-                found = true;
-                break;
-            }
-        }
-    }
-    
-    // Search large blocks
-    if (!found) {
-        for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-            if (largeBlocks[i].data == ptr && largeBlocks[i].inUse) {
-                largeBlocks[i].inUse = false;
-                largeBlocks[i].owner = nullptr;
-                totalAllocated -= largeBlocks[i].size;
-                freeCount++;
-                found = true;
-                break;
-            }
+
+    uint16_t index = 0;
+    const int cls = classOf(ptr, index);
+    if (cls < 0) {
+        const uint8_t* p = static_cast<const uint8_t*>(ptr);
+        if (p >= s_arena && p < s_arena + kArenaBytes) {
+            LOGF("MemoryPool: free of %p inside a block ignored", ptr);
+            return;
         }
-    }
-    
-    if (!found) {
         // Not found in pool, assume it was allocated from heap
         free(ptr);
-        Serial.println("MemoryPool: Deallocated heap memory");
-    } else {
-        Serial.printf("MemoryPool: Deallocated %u bytes to pool\n", found ? 64 : 256); // Simplified
+        return;
     }
-    
-    xSemaphoreGive(poolMutex);
-}
 
-void MemoryPool::defragment() {
-    if (!poolMutex) return;
-    
-    if (xSemaphoreTake(poolMutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        Serial.println("MemoryPool: Failed to acquire mutex for defragmentation");
+    SizeClass& c = classes[cls];
+#if MEMORY_POOL_DEBUG
+    const uint32_t bit = 1u << (index % 32);
+    if (!(c.liveMap[index / 32].fetch_and(~bit, std::memory_order_relaxed) & bit)) {
+        LOGF("MemoryPool: double free of block %u/%u", static_cast<unsigned>(c.blockSize),
+             static_cast<unsigned>(index));
         return;
     }
-    
-    // Check for orphaned blocks (blocks marked as used but task no longer exists)
-    uint32_t orphanedCount = 0;
-    uint32_t currentTime = millis();
-    
-    // Check small blocks
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        if (smallBlocks[i].inUse && smallBlocks[i].owner) {
-            // Check if task still exists
-            if (eTaskGetState(smallBlocks[i].owner) == eDeleted) {
-                smallBlocks[i].inUse = false;
-                smallBlocks[i].owner = nullptr;
-                totalAllocated -= smallBlocks[i].size;
-                orphanedCount++;
-            } else if (currentTime - smallBlocks[i].timestamp > 300000) { // 5 minutes
-                // Block held too long, assume orphaned
-                smallBlocks[i].inUse = false;
-                smallBlocks[i].owner = nullptr;
-                totalAllocated -= smallBlocks[i].size;
-                orphanedCount++;
-            }
-        }
-    }
-    
-    // Check medium blocks
-    for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-        if (mediumBlocks[i].inUse && mediumBlocks[i].owner) {
-            if (eTaskGetState(mediumBlocks[i].owner) == eDeleted) {
-                mediumBlocks[i].inUse = false;
-                mediumBlocks[i].owner = nullptr;
-                totalAllocated -= mediumBlocks[i].size;
-                orphanedCount++;
-            } else if (currentTime - mediumBlocks[i].timestamp > 300000) {
-                mediumBlocks[i].inUse = false;
-                mediumBlocks[i].owner = nullptr;
-                totalAllocated -= mediumBlocks[i].size;
-                orphanedCount++;
-            }
-        }
-    }
-    
-    // Check large blocks
-    for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-        if (largeBlocks[i].inUse && largeBlocks[i].owner) {
-            if (eTaskGetState(largeBlocks[i].owner) == eDeleted) {
-                largeBlocks[i].inUse = false;
-                largeBlocks[i].owner = nullptr;
-                totalAllocated -= largeBlocks[i].size;
-                orphanedCount++;
-            } else if (currentTime - largeBlocks[i].timestamp > 300000) {
-                largeBlocks[i].inUse = false;
-                largeBlocks[i].owner = nullptr;
-                totalAllocated -= largeBlocks[i].size;
-                orphanedCount++;
-            }
+    memset(ptr, MEMORY_POOL_POISON, c.blockSize);
+#endif
+    c.inUse.fetch_sub(1, std::memory_order_relaxed);
+    totalAllocated.fetch_sub(c.blockSize, std::memory_order_relaxed);
+    freeCount.fetch_add(1, std::memory_order_relaxed);
+    returnBlock(static_cast<size_t>(cls), index);
+}
+
+void MemoryPool::defragment() {
+    // Fixed blocks cannot fragment; what can drift is free blocks parked in one
+    // core's magazines. Give them all back to the shared bitmaps.
+    for (size_t core = 0; core < kCores; core++) {
+        for (size_t i = 0; i < kClassCount; i++) {
+            drainMagazine(core, i);
         }
     }
-    
-    if (orphanedCount > 0) {
-        Serial.printf("MemoryPool: Defragmented %u orphaned blocks\n", orphanedCount);
-        fragmentationCount += orphanedCount;
-    }
-    
-    xSemaphoreGive(poolMutex);
 }
 
 bool MemoryPool::isValidPointer(void* ptr) const {
     if (!ptr) return false;
-    
-    // Check small blocks
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        if (smallBlocks[i].data == ptr && smallBlocks[i].inUse) {
-            return true;
-        }
-    }
-    
-    // Check medium blocks
-    for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-        if (mediumBlocks[i].data == ptr && mediumBlocks[i].inUse) {
-            return true;
-        }
-    }
-    
-    // Check large blocks
-    for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-        if (largeBlocks[i].data == ptr && largeBlocks[i].inUse) {
-            return true;
-        }
-    }
-    
-    return false;
+
+    uint16_t index = 0;
+    const int cls = classOf(ptr, index);
+    if (cls < 0) {
+        return false;
+    }
+#if MEMORY_POOL_DEBUG
+    return (classes[cls].liveMap[index / 32].load(std::memory_order_relaxed) >> (index % 32)) & 1u;
+#else
+    return true;
+#endif
 }
 
 void MemoryPool::printStatistics() const {
-    if (!poolMutex) return;
-    
-    if (xSemaphoreTake(poolMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        Serial.println("MemoryPool: Failed to acquire mutex for statistics");
-        return;
-    }
-    
     Serial.println("=== Memory Pool Statistics ===");
-    Serial.printf("Total Allocated: %u bytes\n", totalAllocated);
-    Serial.printf("Peak Usage: %u bytes\n", peakUsage);
-    Serial.printf("Allocations: %u\n", allocCount);
-    Serial.printf("Deallocations: %u\n", freeCount);
-    Serial.printf("Fragmentation Events: %u\n", fragmentationCount);
-    
+    Serial.printf("Total Allocated: %u bytes\n", static_cast<unsigned>(totalAllocated.load()));
+    Serial.printf("Peak Usage: %u bytes\n", static_cast<unsigned>(peakUsage.load()));
+    Serial.printf("Allocations: %u\n", static_cast<unsigned>(allocCount.load()));
+    Serial.printf("Deallocations: %u\n", static_cast<unsigned>(freeCount.load()));
+    Serial.printf("Fragmentation Events: %u\n", static_cast<unsigned>(fragmentationCount.load()));
+
     // Calculate pool utilization
-    uint32_t smallUsed = 0, mediumUsed = 0, largeUsed = 0;
-    
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        if (smallBlocks[i].inUse) smallUsed++;
+    for (size_t i = 0; i < kClassCount; i++) {
+        const SizeClass& c = classes[i];
+        const unsigned used = c.inUse.load(std::memory_order_relaxed);
+        Serial.printf("%u B Pool: %u/%u blocks used (%.1f%%), peak %u\n", c.blockSize, used, c.blockCount,
+                      (float)used / c.blockCount * 100.0f, c.peakInUse);
     }
-    
-    for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-        if (mediumBlocks[i].inUse) mediumUsed++;
-    }
-    
-    for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-        if (largeBlocks[i].inUse) largeUsed++;
-    }
-    
-    Serial.printf("Small Pool: %u/%u blocks used (%.1f%%)\n", 
-                smallUsed, MEMORY_POOL_SMALL_BLOCKS, 
-                (float)smallUsed / MEMORY_POOL_SMALL_BLOCKS * 100.0f);
-    Serial.printf("Medium Pool: %u/%u blocks used (%.1f%%)\n", 
-                mediumUsed, MEMORY_POOL_MEDIUM_BLOCKS, 
-                (float)mediumUsed / MEMORY_POOL_MEDIUM_BLOCKS * 100.0f);
-    Serial.printf("Large Pool: %u/%u blocks used (%.1f%%)\n", 
-                largeUsed, MEMORY_POOL_LARGE_BLOCKS, 
-                (float)largeUsed / MEMORY_POOL_LARGE_BLOCKS * 100.0f);
-    
+
     Serial.println("============================");
-    
-    xSemaphoreGive(poolMutex);
 }
 
 void MemoryPool::printPoolStatus() const {
-    if (!poolMutex) return;
-    
-    if (xSemaphoreTake(poolMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        Serial.println("MemoryPool: Failed to acquire mutex for status");
-        return;
-    }
-    
     Serial.println("=== Memory Pool Status ===");
-    
-    // Small blocks
-    Serial.println("Small Blocks:");
-    for (int i = 0; i < MEMORY_POOL_SMALL_BLOCKS; i++) {
-        if (smallBlocks[i].inUse) {
-            Serial.printf("  Block %d: Used by task %p, age %ums\n", 
-                        i, smallBlocks[i].owner, 
-                        millis() - smallBlocks[i].timestamp);
-        }
-    }
-    
-    // Medium blocks
-    Serial.println("Medium Blocks:");
-    for (int i = 0; i < MEMORY_POOL_MEDIUM_BLOCKS; i++) {
-        if (mediumBlocks[i].inUse) {
-            Serial.printf("  Block %d: Used by task %p, age %ums\n", 
-                        i, mediumBlocks[i].owner, 
-                        millis() - mediumBlocks[i].timestamp);
+
+    for (size_t i = 0; i < kClassCount; i++) {
+        const SizeClass& c = classes[i];
+        uint32_t freeMap[kMaxWords];
+        portENTER_CRITICAL(const_cast<portMUX_TYPE*>(&classMux));
+        memcpy(freeMap, c.freeMap, sizeof(freeMap));
+        portEXIT_CRITICAL(const_cast<portMUX_TYPE*>(&classMux));
+        Serial.printf("%u B blocks: free bitmap", c.blockSize);
+        for (size_t w = 0; w * 32 < c.blockCount; w++) {
+            Serial.printf(" %08lx", static_cast<unsigned long>(freeMap[w]));
         }
-    }
-    
-    // Large blocks
-    Serial.println("Large Blocks:");
-    for (int i = 0; i < MEMORY_POOL_LARGE_BLOCKS; i++) {
-        if (largeBlocks[i].inUse) {
-            Serial.printf("  Block %d: Used by task %p, age %ums\n", 
-                        i, largeBlocks[i].owner, 
-                        millis() - largeBlocks[i].timestamp);
+        Serial.print(", cached per core:");
+        for (size_t core = 0; core < kCores; core++) {
+            Serial.printf(" %u", magazines[core][i].count);
         }
+        Serial.println();
     }
-    
+
     Serial.println("========================");
-    
-    xSemaphoreGive(poolMutex);
 }
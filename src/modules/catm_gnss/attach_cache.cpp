@@ -0,0 +1,132 @@
+#include "attach_cache.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+constexpr const char* kNamespace = "catm_attach";
+constexpr const char* kKey = "last";
+constexpr uint32_t kMagic = 0x31434143;      // "CAC1"
+constexpr size_t kPaths = (size_t)AttachPath::COUNT;
+
+struct Record {
+    uint32_t magic;
+    AttachCache cache;
+    uint32_t crc;            // CRC-32 of everything above
+};
+
+AttachCache s_cache = {};
+bool s_loaded = false;       // NVS read once
+bool s_valid = false;
+AttachPathStats s_paths[kPaths] = {};
+
+uint32_t recordCrc(const Record& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), offsetof(Record, crc));
+}
+
+void load() {
+    s_loaded = true;
+    Preferences p;
+    if (!p.begin(kNamespace, true)) return;
+    Record r{};
+    if (p.getBytes(kKey, &r, sizeof(r)) == sizeof(r) && r.magic == kMagic && r.crc == recordCrc(r)) {
+        s_cache = r.cache;
+        s_cache.plmn[sizeof(s_cache.plmn) - 1] = '\0';
+        s_cache.apn[sizeof(s_cache.apn) - 1] = '\0';
+        s_valid = s_cache.plmn[0] != '\0';
+    }
+    p.end();
+}
+} // namespace
+
+const char* attach_path_name(AttachPath path) {
+    switch (path) {
+        case AttachPath::WARM: return "warm";
+        case AttachPath::PDP: return "pdp";
+        case AttachPath::CACHED: return "cached";
+        case AttachPath::FULL: return "full";
+        default: return "?";
+    }
+}
+
+bool attach_cache_get(AttachCache& out) {
+    if (!s_loaded) load();
+    if (s_valid) out = s_cache;
+    return s_valid;
+}
+
+bool attach_cache_put(const AttachCache& cache) {
+    if (!s_loaded) load();
+    if (s_valid && memcmp(&s_cache, &cache, sizeof(cache)) == 0) return true;
+
+    Record r{};
+    r.magic = kMagic;
+    r.cache = cache;
+    r.crc = recordCrc(r);
+    Preferences p;
+    bool ok = p.begin(kNamespace, false);
+    if (ok) {
+        ok = p.putBytes(kKey, &r, sizeof(r)) == sizeof(r);
+        p.end();
+    }
+    if (ok) {
+        s_cache = cache;
+        s_valid = cache.plmn[0] != '\0';
+    }
+    return ok;
+}
+
+bool attach_parse_cpsi(const String& resp, char* plmn, size_t plmnSize, uint8_t& band) {
+    band = 0;
+    if (!plmn || plmnSize == 0) return false;
+    plmn[0] = '\0';
+    int idx = resp.indexOf("+CPSI:");
+    if (idx < 0) return false;
+    int lineEnd = resp.indexOf('\n', idx);
+    String line = (lineEnd > idx) ? resp.substring(idx + 6, lineEnd) : resp.substring(idx + 6);
+    line.trim();
+
+    // Fields: system mode, operation mode, MCC-MNC, TAC, cell, PCI, band, ...
+    int field = 0;
+    int start = 0;
+    while (start <= (int)line.length()) {
+        int comma = line.indexOf(',', start);
+        String value = (comma >= 0) ? line.substring(start, comma) : line.substring(start);
+        value.trim();
+        if (field == 1 && !value.equalsIgnoreCase("Online")) return false;
+        if (field == 2) {
+            size_t n = 0;
+            for (size_t i = 0; i < value.length() && n + 1 < plmnSize; i++) {
+                if (isdigit((unsigned char)value.charAt(i))) plmn[n++] = value.charAt(i);
+            }
+            plmn[n] = '\0';
+        } else if (field == 6) {
+            int b = value.indexOf("BAND");
+            if (b >= 0) band = (uint8_t)atoi(value.c_str() + b + 4);
+            break;
+        }
+        if (comma < 0) break;
+        start = comma + 1;
+        field++;
+    }
+    // MCC is 3 digits, MNC 2 or 3
+    return strlen(plmn) >= 5;
+}
+
+void attach_path_record(AttachPath path, bool ok, uint32_t ms) {
+    if (path >= AttachPath::COUNT) return;
+    AttachPathStats& s = s_paths[(size_t)path];
+    s.attempts++;
+    if (!ok) return;
+    s.avgMs = s.successes ? (s.avgMs * 3 + ms) / 4 : ms;
+    s.successes++;
+    s.lastMs = ms;
+    if (ms > s.maxMs) s.maxMs = ms;
+}
+
+AttachPathStats attach_path_stats(AttachPath path) {
+    return path < AttachPath::COUNT ? s_paths[(size_t)path] : AttachPathStats{};
+}
@@ -0,0 +1,59 @@
+/*
+ * CatM Attach Cache
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * The last attach that got an IP (PLMN, band, RAT mode and APN), kept in NVS
+ * so a reconnect can skip straight to what is still missing, and the
+ * time-to-IP of each reconnect path:
+ *   WARM    PDP context still active, nothing to redo
+ *   PDP     still registered, context reconfigured and activated
+ *   CACHED  not registered; last PLMN selected first with the RAT mode that
+ *           worked, short waits
+ *   FULL    the conservative attach from scratch
+ * The band is recorded for diagnostics only: locking bands (AT+CBANDCFG) is
+ * stored by the modem and would strand it if the unit is moved. The operator
+ * scan (operator_scan.h) keeps it allowed while it narrows the list.
+ */
+
+#ifndef CATM_ATTACH_CACHE_H
+#define CATM_ATTACH_CACHE_H
+
+#include <Arduino.h>
+
+#ifndef CATM_FAST_REG_WAIT_MS
+#define CATM_FAST_REG_WAIT_MS 30000        // cached PLMN registration before a full attach
+#endif
+#ifndef CATM_FAST_PDP_WAIT_MS
+#define CATM_FAST_PDP_WAIT_MS 30000
+#endif
+
+enum class AttachPath : uint8_t { WARM = 0, PDP, CACHED, FULL, COUNT };
+
+struct AttachCache {
+    char plmn[8];            // MCC and MNC digits
+    char apn[48];
+    uint8_t band;            // E-UTRAN band, 0 = unknown
+    uint8_t rat;             // AT+CNMP mode that attached
+};
+
+struct AttachPathStats {
+    uint32_t attempts;
+    uint32_t successes;
+    uint32_t lastMs;         // time to IP of the last success
+    uint32_t avgMs;          // of successes, recent weighted
+    uint32_t maxMs;
+};
+
+const char* attach_path_name(AttachPath path);
+
+// CatM task only
+bool attach_cache_get(AttachCache& out);
+// Writes NVS only when something changed
+bool attach_cache_put(const AttachCache& cache);
+// "+CPSI: CAT-M1,Online,310-260,0x4E1F,27447297,121,EUTRAN-BAND12,..."
+bool attach_parse_cpsi(const String& resp, char* plmn, size_t plmnSize, uint8_t& band);
+
+void attach_path_record(AttachPath path, bool ok, uint32_t ms);
+AttachPathStats attach_path_stats(AttachPath path);
+
+#endif // CATM_ATTACH_CACHE_H
@@ -1,12 +1,25 @@
 #include "catm_gnss_module.h"
+#include "cell_status.h"
+#include "gnss_assist.h"
 #include "../logging/log_buffer.h"
 #include "config/task_config.h"
+#include "system/kernel_objects.h"
+#include "system/power_manager.h"
+#include "system/hot_path_timer.h"
+#include "system/energy_account.h"
 #include "../../include/string_pool.h"
+#include "../../include/transport.h"
+#include "../transport/data_usage.h"
+#include "../transport/remote_diag.h"
+#include "modem_transcript.h"
+#include <esp_timer.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 extern EventGroupHandle_t xEventGroupSystemStatus;
 
-static bool parseHttpUrl(const String& url, SIM7080G_String& baseOut, SIM7080G_String& pathOut) {
+bool CatMGNSSModule::parseHttpUrl(const String& url, SIM7080G_String& baseOut, SIM7080G_String& pathOut) {
     int schemePos = url.indexOf("://");
     if (schemePos < 0) {
         return false;
@@ -26,6 +39,25 @@ static bool parseHttpUrl(const String& url, SIM7080G_String& baseOut, SIM7080G_S
     return true;
 }
 
+// Fallback uplink paths for the transport router when the Beam UDP socket is unusable
+static bool transportMqttSend(TransportPacketKind kind, const uint8_t* data, size_t len, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    return self->mqttPublish(kind == TransportPacketKind::Attributes ? "v1/devices/me/attributes"
+                                                                      : "v1/devices/me/telemetry",
+                             data, len, 1, false);
+}
+
+static bool transportHttpSend(TransportPacketKind kind, const uint8_t* data, size_t len, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    char url[192];
+    if (!transport_thingsboardUrl(kind, url, sizeof(url))) {
+        return false;
+    }
+    // Posted straight from the transport arena
+    String response;
+    return self->sendHTTP(String(url), reinterpret_cast<const char*>(data), len, response);
+}
+
 CatMGNSSModule::CatMGNSSModule() {
     isInitialized = false;
     state = CatMGNSSState::INITIALIZING;
@@ -80,9 +112,8 @@ CatMGNSSModule::CatMGNSSModule() {
     cellularData.txBps = 0;
     cellularData.rxBps = 0;
 
-    lastTxBytesSample_ = 0;
-    lastRxBytesSample_ = 0;
-    lastStatsSampleMs_ = 0;
+    sessionTxBase_ = 0;
+    sessionRxBase_ = 0;
     networkTimeConfigured_ = false;
     networkTimeSynced_ = false;
     lastNetworkTimeSyncMs_ = 0;
@@ -91,10 +122,11 @@ CatMGNSSModule::CatMGNSSModule() {
 
     
     // Create mutex
-    serialMutex = xSemaphoreCreateMutex();
+    serialMutex = kernel_mutex_create(KernelMutex::ModemSerial);
     if (!serialMutex) {
         Serial.println("CatM+GNSS: Failed to create serial mutex");
     }
+    power_lock_bind_mutex(serialMutex, PowerLock::Uart);
 }
 
 CatMGNSSModule::~CatMGNSSModule() {
@@ -114,9 +146,43 @@ CatMGNSSModule::~CatMGNSSModule() {
     network_ = nullptr;
     modem_ = nullptr;
     
-    if (serialMutex) {
-        vSemaphoreDelete(serialMutex);
+    power_lock_unbind_mutex(serialMutex);
+    kernel_mutex_delete(KernelMutex::ModemSerial, serialMutex);
+}
+
+void CatMGNSSModule::openUart(int rx, int tx) {
+    Serial.printf("CatM+GNSS: Configuring Grove Port C (RX:%d TX:%d) for UART @ %d baud\n", rx, tx, CATM_GNSS_BAUD_RATE);
+    Serial.flush();
+    
+    serialModule->end();
+    delay(50); // Give serial time to close
+    
+    pinMode(rx, INPUT_PULLUP);
+    pinMode(tx, OUTPUT);
+    
+    Serial.println("CatM+GNSS: Starting serial port...");
+    Serial.flush();
+    serialModule->begin(CATM_GNSS_BAUD_RATE, SERIAL_8N1, rx, tx);
+    power_wake_on_uart_rx(rx);
+    if (modem_) {
+        modem_->Init(serialModule, rx, tx, CATM_GNSS_BAUD_RATE);
     }
+    
+    Serial.println("CatM+GNSS: Waiting for serial to stabilize...");
+    Serial.flush();
+    delay(300); // Increased delay for module to boot/respond
+    
+    // Flush any startup garbage
+    uint32_t flushStart = millis();
+    int flushed = 0;
+    while (serialModule->available() && (millis() - flushStart < 500)) {
+        serialModule->read();
+        flushed++;
+    }
+    if (flushed > 0) {
+        Serial.printf("CatM+GNSS: Flushed %d bytes from serial buffer\n", flushed);
+    }
+    Serial.flush();
 }
 
 bool CatMGNSSModule::begin() {
@@ -154,38 +220,12 @@ bool CatMGNSSModule::begin() {
     lastProbeRx_ = rx;
     lastProbeTx_ = tx;
 
-    Serial.printf("CatM+GNSS: Configuring Grove Port C (RX:%d TX:%d) for UART @ %d baud\n", rx, tx, CATM_GNSS_BAUD_RATE);
-    Serial.flush();
-    
-    serialModule->end();
-    delay(50); // Give serial time to close
-    
-    pinMode(rx, INPUT_PULLUP);
-    pinMode(tx, OUTPUT);
-    
-    Serial.println("CatM+GNSS: Starting serial port...");
-    Serial.flush();
-    serialModule->begin(CATM_GNSS_BAUD_RATE, SERIAL_8N1, rx, tx);
-    if (modem_) {
-        modem_->Init(serialModule, rx, tx, CATM_GNSS_BAUD_RATE);
-    }
-    
-    Serial.println("CatM+GNSS: Waiting for serial to stabilize...");
-    Serial.flush();
-    delay(300); // Increased delay for module to boot/respond
-    
-    // Flush any startup garbage
-    uint32_t flushStart = millis();
-    int flushed = 0;
-    while (serialModule->available() && (millis() - flushStart < 500)) {
-        serialModule->read();
-        flushed++;
-    }
-    if (flushed > 0) {
-        Serial.printf("CatM+GNSS: Flushed %d bytes from serial buffer\n", flushed);
+    if (modem_ && modem_transcript_attach(*modem_)) {
+        Serial.println("CatM+GNSS: Replaying a modem transcript; UART left closed");
+    } else {
+        openUart(rx, tx);
     }
-    Serial.flush();
-    
+
     Serial.println("CatM+GNSS: Probing modem with AT...");
     Serial.flush();
     
@@ -242,6 +282,19 @@ bool CatMGNSSModule::begin() {
         }
     }
 
+#if CATM_UART_HIGH_BAUD_ENABLE
+    if (!at_ok && modem_) {
+        // A previous boot may have saved the faster rate on the modem (AT&W)
+        static const uint32_t kSavedRates[] = { CATM_UART_HIGH_BAUD, CATM_GNSS_BAUD_RATE };
+        MutexGuard guard(serialMutex);
+        if (guard.acquired() && modem_->detectBaud(kSavedRates, sizeof(kSavedRates) / sizeof(kSavedRates[0]))) {
+            at_ok = true;
+            lastError_.clear();
+            Serial.printf("CatM+GNSS: AT OK at saved rate %lu baud\n", (unsigned long)modem_->baudRate());
+        }
+    }
+#endif
+
     if (!at_ok) {
         lastError_ = "No AT response on Grove Port C (check unit power and Grove cable)";
         Serial.println("CatM+GNSS: Modem not detected (absent). Booting without CatM/GNSS.");
@@ -311,6 +364,8 @@ bool CatMGNSSModule::begin() {
     Serial.println("CatM+GNSS: Baseline config OK");
     Serial.flush();
 
+    negotiateUartBaud();
+
     Serial.println("CatM+GNSS: Configuring network time...");
     Serial.flush();
     if (!configureNetworkTime()) {
@@ -324,6 +379,27 @@ bool CatMGNSSModule::begin() {
         Serial.flush();
     }
 
+    // From here on AT traffic goes through the modem I/O task
+    if (!cmdQueue_.begin(modem_, serialMutex)) {
+        Serial.println("CatM+GNSS: WARNING - command queue unavailable, using direct AT path");
+    }
+    {
+        MutexGuard guard(serialMutex);
+        if (guard.acquired()) {
+            modem_->registerUrcHandler("+CEREG", onRegistrationUrc, this);
+            modem_->registerUrcHandler("+APP PDP", onPdpUrc, this);
+            modem_->registerUrcHandler("+CNTP", onCntpUrc, this);
+            modem_->registerUrcHandler("+HTTPTOFS", onHttpToFsUrc, this);
+        }
+    }
+    powerSession_.begin(modem_, serialMutex);
+    // Beam UDP goes out on the modem's own socket stack under the same serial lock
+    transport_attachModemSocket(modem_, serialMutex);
+    const uint8_t jsonKinds = (1U << static_cast<uint8_t>(TransportPacketKind::Telemetry)) |
+                              (1U << static_cast<uint8_t>(TransportPacketKind::Attributes));
+    transport_registerPath(TransportPathId::Mqtt, transportMqttSend, this, jsonKinds, TRANSPORT_MQTT_OVERHEAD_BYTES);
+    transport_registerPath(TransportPathId::Http, transportHttpSend, this, jsonKinds, TRANSPORT_HTTP_OVERHEAD_BYTES);
+
     Serial.println("CatM+GNSS: Module initialized successfully");
     lastError_.clear();
     isInitialized = true;
@@ -344,7 +420,12 @@ void CatMGNSSModule::shutdown() {
     // Power down module
     char response[128];
     resetNetworkStats();
+    powerSession_.end();
+    transport_registerPath(TransportPathId::Mqtt, nullptr, nullptr, 0, 0);
+    transport_registerPath(TransportPathId::Http, nullptr, nullptr, 0, 0);
+    transport_attachModemSocket(nullptr, nullptr);
     sendATCommand("AT+CPOWD=1", response, sizeof(response), 5000);
+    cmdQueue_.end();
 
     networkTimeConfigured_ = false;
     networkTimeSynced_ = false;
@@ -367,6 +448,7 @@ bool CatMGNSSModule::testAT() {
 }
 
 bool CatMGNSSModule::sendATCommand(const String& command, String& response, uint32_t timeout) {
+    HOT_PATH_TIMER("at.cmd");
     if (!serialModule || !serialMutex || !modem_) {
         Serial.println("CatM+GNSS: Serial interface not ready");
         return false;
@@ -377,6 +459,14 @@ bool CatMGNSSModule::sendATCommand(const String& command, String& response, uint
         return false;
     }
 
+    if (cmdQueue_.isRunning() && !cmdQueue_.isIoTask()) {
+        Serial.println("CatM+GNSS: >>> " + command);
+        char queuedResp[MODEM_CMD_MAX_RESPONSE_LEN + 1];
+        bool ok = cmdQueue_.execute(command.c_str(), queuedResp, sizeof(queuedResp), timeout);
+        response = queuedResp;
+        return ok;
+    }
+
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) {
         Serial.println("CatM+GNSS: Failed to take mutex");
@@ -394,9 +484,15 @@ bool CatMGNSSModule::sendATCommand(const String& command, String& response, uint
 }
 
 bool CatMGNSSModule::sendATCommand(const char* command, char* response, size_t responseSize, uint32_t timeout) {
+    HOT_PATH_TIMER("at.cmd_buf");
     if (!serialModule || !modem_ || !command || !response || responseSize == 0) return false;
     if (!serialMutex) return false;
 
+    if (cmdQueue_.isRunning() && !cmdQueue_.isIoTask()) {
+        Serial.printf("CatM+GNSS: >>> %s\n", command);
+        return cmdQueue_.execute(command, response, responseSize, timeout);
+    }
+
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) {
         Serial.println("CatM+GNSS: Failed to take mutex");
@@ -404,156 +500,192 @@ bool CatMGNSSModule::sendATCommand(const char* command, char* response, size_t r
     }
 
     Serial.printf("CatM+GNSS: >>> %s\n", command);
-    auto result = modem_->sendCommand(command, timeout, true);
-    const size_t copyLen = min(responseSize - 1, static_cast<size_t>(result.raw.length()));
-    memcpy(response, result.raw.c_str(), copyLen);
-    response[copyLen] = '\0';
+    M5_SIM7080G::Status status = modem_->sendCommandInto(command, response, responseSize, timeout, true);
 
-    if (result.status == M5_SIM7080G::Status::TransportError) {
+    if (status == M5_SIM7080G::Status::TransportError) {
         return false;
     }
-    return (result.status == M5_SIM7080G::Status::Ok || result.status == M5_SIM7080G::Status::Error);
+    return (status == M5_SIM7080G::Status::Ok || status == M5_SIM7080G::Status::Error);
 }
 
-bool CatMGNSSModule::applyBaselineConfig() {
-    char resp[256];
-    if (!sendATCommand("AT+CMEE=2", resp, sizeof(resp), 1000) || strstr(resp, POOL_STRING("OK")) == nullptr) {
-        lastError_ = "Failed to configure modem (AT+CMEE)";
-        return false;
-    }
-    if (!sendATCommand("AT+CFUN=1", resp, sizeof(resp), 5000) || strstr(resp, POOL_STRING("OK")) == nullptr) {
-        lastError_ = "Failed to set modem to full functionality";
-        return false;
+bool CatMGNSSModule::submitATCommand(const char* command, uint32_t timeoutMs, ModemCmdPriority priority,
+                                     ModemCmdCallback cb, void* ctx) {
+    if (!isInitialized) return false;
+    return cmdQueue_.submit(command, timeoutMs, priority, cb, ctx);
+}
+
+bool CatMGNSSModule::negotiateUartBaud() {
+#if CATM_UART_HIGH_BAUD_ENABLE
+    if (!modem_) return false;
+    if (modem_->baudRate() == CATM_UART_HIGH_BAUD) return true;
+
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) return false;
+    Serial.printf("CatM+GNSS: Negotiating UART %d -> %d baud\n", CATM_GNSS_BAUD_RATE, CATM_UART_HIGH_BAUD);
+    if (modem_->negotiateBaud(CATM_UART_HIGH_BAUD, true, CATM_GNSS_BAUD_RATE)) {
+        Serial.printf("CatM+GNSS: UART now %lu baud (saved)\n", (unsigned long)modem_->baudRate());
+        return true;
     }
-    // Improve boot reliability: keep UART awake and disable power-saving until attached
-    sendATCommand("AT+CSCLK=0", resp, sizeof(resp), 1000);   // UART clock always on
-    sendATCommand("AT+CPSMS=0", resp, sizeof(resp), 1000);   // disable PSM
-    sendATCommand("AT+CEDRXS=0", resp, sizeof(resp), 1000);  // disable eDRX
-    sendATCommand("AT+IFC=0,0", resp, sizeof(resp), 1000);   // no HW flow control on UART
-    // Preferred RAT and operator selection (best effort)
-    sendATCommand("AT+CMNB=1", resp, sizeof(resp), 2000);
-    sendATCommand("AT+CNMP=38", resp, sizeof(resp), 2000);
-    sendATCommand("AT+COPS=0", resp, sizeof(resp), 5000);
-    
-    // Soracom-centric network time configuration
-    if (!sendATCommand("AT+CLTS=1", resp, sizeof(resp), 1000) || strstr(resp, POOL_STRING("OK")) == nullptr) {
-        lastError_ = "Failed to enable network time latch (AT+CLTS=1)";
-        return false;
+    Serial.printf("CatM+GNSS: WARNING - high baud negotiation failed, staying at %lu\n",
+                  (unsigned long)modem_->baudRate());
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool CatMGNSSModule::runATBatch(sim7080g::AtBatchItem* items, size_t count) {
+    if (!modem_ || !serialMutex || !items || count == 0) return false;
+
+    if (cmdQueue_.isRunning() && !cmdQueue_.isIoTask()) {
+        return cmdQueue_.executeBatch(items, count);
     }
-    if (!sendATCommand("AT+CNTPCID=1", resp, sizeof(resp), 1000) || strstr(resp, POOL_STRING("OK")) == nullptr) {
-        lastError_ = "Failed to bind CNTP to PDP context 1 (AT+CNTPCID=1)";
+
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) {
+        Serial.println("CatM+GNSS: Failed to take mutex");
         return false;
     }
-    if (!sendATCommand("AT+CNTP=\"ntp.soracom.io\",0", resp, sizeof(resp), 1000) || strstr(resp, POOL_STRING("OK")) == nullptr) {
-        lastError_ = "Failed to configure Soracom NTP server (AT+CNTP)";
-        return false;
+    modem_->sendBatch(items, count);
+    for (size_t i = 0; i < count; i++) {
+        if (items[i].required && !items[i].ok) return false;
     }
-    
     return true;
 }
 
+static sim7080g::AtBatchItem makeBatchItem(const char* command, uint32_t timeoutMs, bool required) {
+    sim7080g::AtBatchItem item;
+    item.command = command;
+    item.timeout_ms = timeoutMs;
+    item.required = required;
+    return item;
+}
+
+bool CatMGNSSModule::applyBaselineConfig() {
+    // Independent settings go out back to back; required items stop the batch on failure.
+    sim7080g::AtBatchItem batch[] = {
+        makeBatchItem("AT+CMEE=2", 1000, true),
+        makeBatchItem("AT+CFUN=1", 5000, true),
+        // Improve boot reliability: keep UART awake and disable power-saving until attached
+        makeBatchItem("AT+CSCLK=0", 1000, false),   // UART clock always on
+        makeBatchItem("AT+CPSMS=0", 1000, false),   // disable PSM
+        makeBatchItem("AT+CEDRXS=0", 1000, false),  // disable eDRX
+        makeBatchItem("AT+IFC=0,0", 1000, false),   // no HW flow control on UART
+        // Preferred RAT and operator selection (best effort)
+        makeBatchItem("AT+CMNB=1", 2000, false),
+        makeBatchItem("AT+CNMP=38", 2000, false),
+        makeBatchItem("AT+COPS=0", 5000, false),
+        makeBatchItem("AT+CEREG=2", 1000, false),   // registration URCs feed the link cache
+        // Soracom-centric network time configuration
+        makeBatchItem("AT+CLTS=1", 1000, true),
+        makeBatchItem("AT+CNTPCID=1", 1000, true),
+        makeBatchItem("AT+CNTP=\"ntp.soracom.io\",0", 1000, true),
+    };
+    static const char* const kFailMessages[] = {
+        "Failed to configure modem (AT+CMEE)",
+        "Failed to set modem to full functionality",
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        "Failed to enable network time latch (AT+CLTS=1)",
+        "Failed to bind CNTP to PDP context 1 (AT+CNTPCID=1)",
+        "Failed to configure Soracom NTP server (AT+CNTP)",
+    };
+    static_assert(sizeof(kFailMessages) / sizeof(kFailMessages[0]) == sizeof(batch) / sizeof(batch[0]),
+                  "baseline batch and messages out of sync");
+
+    const uint32_t start = millis();
+    const bool ok = runATBatch(batch, sizeof(batch) / sizeof(batch[0]));
+    Serial.printf("CatM+GNSS: Baseline batch %s in %lu ms\n", ok ? "OK" : "FAILED", millis() - start);
+    if (ok) return true;
+
+    for (size_t i = 0; i < sizeof(batch) / sizeof(batch[0]); i++) {
+        if (batch[i].required && !batch[i].ok) {
+            lastError_ = kFailMessages[i];
+            return false;
+        }
+    }
+    lastError_ = "Baseline configuration batch failed";
+    return false;
+}
+
+// Waits for the final result code of the command already in flight. Lines are
+// framed by the modem's streaming parser; URCs that arrive meanwhile go to their
+// registered handlers instead of being mixed into the response. Caller holds serialMutex.
 bool CatMGNSSModule::waitForResponse(String& response, uint32_t timeout) {
     response = "";
+    if (!modem_) return false;
+
     uint32_t start = millis();
-    bool receivedAnyData = false;
-    
-    while (millis() - start < timeout) {
-        if (serialModule->available()) {
-            receivedAnyData = true;
-            char c = serialModule->read();
-            response += c;
-            
-            // Limit response size to prevent memory issues
-            if (response.length() > 512) {
-                Serial.println("CatM+GNSS: WARNING - Response too long, truncating");
-                Serial.flush();
-                response = response.substring(0, 512);
-            }
-            
-            // Check if we have a complete response
-            if (response.indexOf("\r\nOK\r\n") >= 0 ||
-                response.indexOf("\nOK\r\n") >= 0 ||
-                response.endsWith("OK\r\n") ||
-                response.indexOf("\r\nERROR\r\n") >= 0 || 
-                response.indexOf("+CME ERROR") > 0) {
-                Serial.printf("CatM+GNSS: <<< [%lu ms] %s\n", millis() - start, response.c_str());
-                Serial.flush();
-                return true;
-            }
-        }
-        yield(); // Feed watchdog and allow other tasks
-        delay(10);
+    auto result = modem_->waitForFinal(timeout);
+    response = result.raw;
+
+    // Limit response size to prevent memory issues
+    if (response.length() > 512) {
+        Serial.println("CatM+GNSS: WARNING - Response too long, truncating");
+        response = response.substring(0, 512);
     }
-    
+
+    if (result.status == M5_SIM7080G::Status::Ok || result.status == M5_SIM7080G::Status::Error) {
+        Serial.printf("CatM+GNSS: <<< [%lu ms] %s\n", millis() - start, response.c_str());
+        return true;
+    }
+
     // Timeout - log what we got (if anything)
-    if (receivedAnyData) {
+    if (response.length() > 0) {
         Serial.printf("CatM+GNSS: Timeout after %lu ms, partial response: [%s]\n", timeout, response.c_str());
     } else {
         Serial.printf("CatM+GNSS: Timeout after %lu ms, no data received\n", timeout);
     }
-    Serial.flush();
     return false;
 }
 
 bool CatMGNSSModule::waitForResponse(char* response, size_t responseSize, uint32_t timeout) {
     if (!response || responseSize == 0) return false;
-    
-    memset(response, 0, responseSize);
-    uint32_t start = millis();
-    size_t pos = 0;
-    bool receivedAnyData = false;
-    
-    while (millis() - start < timeout) {
-        if (serialModule->available()) {
-            receivedAnyData = true;
-            char c = serialModule->read();
-            
-            // Prevent buffer overflow
-            if (pos < responseSize - 1) {
-                response[pos++] = c;
-                response[pos] = '\0';
-                
-                // Check if we have a complete response
-                if (strstr(response, "\r\nOK\r\n") != nullptr ||
-                    strstr(response, "\nOK\r\n") != nullptr ||
-                    strstr(response, "OK\r\n") != nullptr ||
-                    strstr(response, "\r\nERROR\r\n") != nullptr || 
-                    strstr(response, "+CME ERROR") != nullptr) {
-                    Serial.printf("CatM+GNSS: <<< [%lu ms] %s\n", millis() - start, response);
-                    Serial.flush();
-                    return true;
-                }
-            }
-        }
-        yield(); // Feed watchdog and allow other tasks
-        delay(10);
-    }
-    
-    // Timeout - log what we got (if anything)
-    if (receivedAnyData) {
-        Serial.printf("CatM+GNSS: Timeout after %lu ms, partial response: [%s]\n", timeout, response);
-    } else {
-        Serial.printf("CatM+GNSS: Timeout after %lu ms, no data received\n", timeout);
-    }
-    Serial.flush();
-    return false;
+
+    String tmp;
+    const bool ok = waitForResponse(tmp, timeout);
+    const size_t copyLen = min(responseSize - 1, static_cast<size_t>(tmp.length()));
+    memcpy(response, tmp.c_str(), copyLen);
+    response[copyLen] = '\0';
+    return ok;
 }
 
 // GNSS Functions
 bool CatMGNSSModule::enableGNSS() {
     if (!isInitialized) return false;
 
+    // XTRA and the start mode only take effect from power-on
+    GnssAssistPlan assist;
+    gnss_assist_plan(assist, millis());
     bool ok = false;
+    bool xtra = false;
     if (gnss_) {
         MutexGuard guard(serialMutex);
         if (!guard.acquired()) return false;
-        ok = gnss_->powerOn(5000);
+        if (assist.injectXtra) {
+            if (assist.clock[0]) {
+                char cmd[40];
+                snprintf(cmd, sizeof(cmd), "AT+CCLK=\"%s\"", assist.clock);
+                (void)modem_->sendCommandInto(cmd, nullptr, 0, 1000, true);
+            }
+            xtra = gnss_->copyXtra() && gnss_->setXtra(true);
+        }
+        // Powering on as it was keeps the engine's ephemeris, the hot start
+        if (assist.mode == GnssStartMode::HOT && !xtra) {
+            ok = gnss_->powerOn(5000);
+        } else {
+            const SIM7080G_GNSS::StartMode mode = assist.mode == GnssStartMode::COLD ? SIM7080G_GNSS::StartMode::Cold
+                                                  : assist.mode == GnssStartMode::WARM ? SIM7080G_GNSS::StartMode::Warm
+                                                                                       : SIM7080G_GNSS::StartMode::Hot;
+            ok = gnss_->start(mode, 5000) || gnss_->powerOn(5000);
+        }
     }
 
     if (!ok) {
         Serial.println("CatM+GNSS: Failed to power on GNSS");
         return false;
     }
+    gnss_assist_started(assist, xtra, millis());
+    Serial.printf("CatM+GNSS: GNSS %s start%s\n", RfArbiter::startModeName(assist.mode), xtra ? " with XTRA" : "");
 
     // Configure GNSS output format (optional; some firmware may not support this)
     char response[128];
@@ -561,6 +693,13 @@ bool CatMGNSSModule::enableGNSS() {
         Serial.println("CatM+GNSS: GNSS sequence config not supported; continuing");
     }
 
+#if GNSS_STREAMING_ENABLE
+    if (!startGnssStreaming()) {
+        Serial.println("CatM+GNSS: GNSS URC streaming unavailable; polling AT+CGNSINF");
+    }
+#endif
+
+    energy_state(EnergyGnss::On);
     Serial.println("CatM+GNSS: GNSS enabled successfully");
     return true;
 }
@@ -572,6 +711,10 @@ bool CatMGNSSModule::disableGNSS() {
     if (gnss_) {
         MutexGuard guard(serialMutex);
         if (!guard.acquired()) return false;
+        if (gnssStreaming_) {
+            (void)gnss_->stopStreaming(1000);
+            gnssStreaming_ = false;
+        }
         ok = gnss_->powerOff(2000);
     }
 
@@ -580,315 +723,171 @@ bool CatMGNSSModule::disableGNSS() {
         return false;
     }
 
+    energy_state(EnergyGnss::Off);
     Serial.println("CatM+GNSS: GNSS disabled successfully");
     return true;
 }
 
-bool CatMGNSSModule::updateGNSSData() {
-    if (!isInitialized) return false;
-
+bool CatMGNSSModule::startGnssStreaming() {
     if (!gnss_) return false;
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) return false;
+    gnssStreaming_ = gnss_->startStreaming(GNSS_UPDATE_RATE_MS, onStreamedFix, this, 1000);
+    lastGnssStreamRearmMs_ = millis();
+    if (gnssStreaming_) {
+        Serial.printf("CatM+GNSS: GNSS streaming every %d ms via +UGNSINF\n", GNSS_UPDATE_RATE_MS);
+    }
+    return gnssStreaming_;
+}
+
+// Runs inside the modem pump of whichever task holds serialMutex, so writers stay serialized
+void CatMGNSSModule::onStreamedFix(const sim7080g::GNSSFix& fix, const char* utc, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    if (self) self->applyFix(fix, utc);
+}
 
-    sim7080g::GNSSFix fix = gnss_->getFix(2000);
+void CatMGNSSModule::applyFix(const sim7080g::GNSSFix& fix, const char* utc) {
     if (!fix.valid) {
-        gnssData.isValid = false;
-        return false;
+        if (gnssData.isValid) {
+            gnssData.isValid = false;
+            publishGnss();
+        }
+        return;
     }
 
-    gnssData.latitude = fix.latitude;
-    gnssData.longitude = fix.longitude;
-    gnssData.altitude = fix.altitude_m;
-    gnssData.speed = static_cast<float>(fix.speed_kph);
-    gnssData.course = static_cast<float>(fix.course_deg);
-    gnssData.satellites = fix.satellites;
-    gnssData.hdop = fix.hdop;
-    gnssData.pdop = fix.pdop;
-    gnssData.vdop = fix.vdop;
-    gnssData.isValid = true;
+    copyFix(fix, utc, gnssData);
     gnssData.lastUpdate = millis();
+    publishGnss();
+}
 
-    parseGnssUtc(fix.utc);
-
-    Serial.printf("CatM+GNSS: Valid fix - Lat: %.6f, Lon: %.6f, Alt: %.1f, Sats: %d\n",
-                 gnssData.latitude, gnssData.longitude, gnssData.altitude, gnssData.satellites);
-    return true;
+void CatMGNSSModule::copyFix(const sim7080g::GNSSFix& fix, const char* utc, GNSSData& out) {
+    out.latitude = fix.latitude;
+    out.longitude = fix.longitude;
+    out.altitude = fix.altitude_m;
+    out.speed = static_cast<float>(fix.speed_kph);
+    out.course = static_cast<float>(fix.course_deg);
+    out.satellites = fix.satellites;
+    out.hdop = fix.hdop;
+    out.pdop = fix.pdop;
+    out.vdop = fix.vdop;
+    out.isValid = true;
+    parseGnssUtc(utc, out);
 }
 
-bool CatMGNSSModule::parseGNSSData(const String& data) {
-    // Check if we have a valid response
-    int startIdx = data.indexOf("+CGNSINF: ");
-    if (startIdx < 0) {
-        Serial.println("CatM+GNSS: Invalid GNSS data format");
-        return false;
-    }
-    
-    // Extract the data part
-    startIdx += 10; // Skip "+CGNSINF: "
-    String gnssStr = data.substring(startIdx, data.indexOf("\r\n", startIdx));
-    
-    // Split by commas
-    int commaPos[15];
-    int commaCount = 0;
-    
-    for (int i = 0; i < gnssStr.length() && commaCount < 15; i++) {
-        if (gnssStr.charAt(i) == ',') {
-            commaPos[commaCount++] = i;
+bool CatMGNSSModule::updateGNSSData() {
+    if (!isInitialized) return false;
+
+    if (!gnss_) return false;
+
+    if (gnssStreaming_) {
+        {
+            // Opportunistic: if cellular holds the port its commands dispatch the reports for us
+            MutexGuard guard(serialMutex, 0);
+            if (guard.acquired()) {
+                modem_->pollUrcs(0);
+            }
         }
+        GNSSData latest = getGNSSData();
+        const uint32_t now = millis();
+        const bool fresh = latest.lastUpdate != 0 && (now - latest.lastUpdate) < GNSS_STREAM_STALE_MS;
+        if (fresh || (now - lastGnssStreamRearmMs_) < GNSS_STREAM_STALE_MS) {
+            return latest.isValid && fresh;
+        }
+        // Reports stopped (GNSS restarted, URC config lost): poll once below and re-arm
+        Serial.println("CatM+GNSS: GNSS reports stale; polling and re-arming streaming");
+        gnssStreaming_ = false;
     }
-    
-    if (commaCount < 14) {
-        Serial.println("CatM+GNSS: Not enough data fields");
-        return false;
-    }
-    
-    // GNSS run status
-    int gnssRunStatus = gnssStr.substring(0, commaPos[0]).toInt();
-    if (gnssRunStatus != 1) {
-        Serial.println("CatM+GNSS: GNSS is not running");
-        gnssData.isValid = false;
-        return false;
-    }
-    
-    // GNSS fix status
-    int gnssFixStatus = gnssStr.substring(commaPos[0] + 1, commaPos[1]).toInt();
-    gnssData.isValid = (gnssFixStatus == 1);
-    
-    if (!gnssData.isValid) {
-        Serial.println("CatM+GNSS: No valid GNSS fix");
-        return false;
-    }
-    
-    // UTC time
-    String utcTime = gnssStr.substring(commaPos[1] + 1, commaPos[2]);
-    if (utcTime.length() >= 14) {
-        gnssData.year = utcTime.substring(0, 4).toInt();
-        gnssData.month = utcTime.substring(4, 6).toInt();
-        gnssData.day = utcTime.substring(6, 8).toInt();
-        gnssData.hour = utcTime.substring(8, 10).toInt();
-        gnssData.minute = utcTime.substring(10, 12).toInt();
-        gnssData.second = utcTime.substring(12, 14).toInt();
+
+    bool valid = false;
+    {
+        MutexGuard guard(serialMutex);
+        if (!guard.acquired()) return false;
+
+        sim7080g::GNSSFix fix;
+        char utc[24];
+        if (gnss_->getFix(fix, utc, sizeof(utc), 2000)) {
+            applyFix(fix, utc);
+            valid = fix.valid;
+        }
     }
-    
-    // Latitude
-    gnssData.latitude = gnssStr.substring(commaPos[2] + 1, commaPos[3]).toFloat();
-    
-    // Longitude
-    gnssData.longitude = gnssStr.substring(commaPos[3] + 1, commaPos[4]).toFloat();
-    
-    // Altitude
-    gnssData.altitude = gnssStr.substring(commaPos[4] + 1, commaPos[5]).toFloat();
-    
-    // Speed
-    gnssData.speed = gnssStr.substring(commaPos[5] + 1, commaPos[6]).toFloat();
-    
-    // Course
-    gnssData.course = gnssStr.substring(commaPos[6] + 1, commaPos[7]).toFloat();
-    
-    // Satellites in view and accuracies (SIM7080 CGNSINF fields vary; parse defensively)
-    String satsStr = gnssStr.substring(commaPos[13] + 1, commaPos[14]);
-    gnssData.satellites = satsStr.toInt();
-    // Try to parse DOP/accuracy fields if present beyond known indices
-    // Some firmware: fields [10]=hdop, [11]=pdop, [12]=vdop, [14]=speed accuracy, [15]=course accuracy
-    // We'll clamp indices checks
-    auto safeField = [&](int idxA, int idxB)->String{
-        if (idxA >=0 && idxB >=0 && idxB > idxA && idxB <= (int)gnssStr.length()) return gnssStr.substring(idxA, idxB);
-        return String();
-    };
-    // attempt HDOP/PDOP/VDOP around [10..12]
-    if (commaCount > 12) {
-        String hd = safeField(commaPos[9] + 1, commaPos[10]);
-        String pd = safeField(commaPos[10] + 1, commaPos[11]);
-        String vd = safeField(commaPos[11] + 1, commaPos[12]);
-        gnssData.hdop = hd.length() ? hd.toFloat() : 0;
-        gnssData.pdop = pd.length() ? pd.toFloat() : 0;
-        gnssData.vdop = vd.length() ? vd.toFloat() : 0;
+
+#if GNSS_STREAMING_ENABLE
+    if (!gnssStreaming_ && millis() - lastGnssStreamRearmMs_ >= GNSS_STREAM_STALE_MS) {
+        (void)startGnssStreaming();
     }
-    
+#endif
+
+    if (!valid) return false;
+    Serial.printf("CatM+GNSS: Valid fix - Lat: %.6f, Lon: %.6f, Alt: %.1f, Sats: %d\n",
+                 gnssData.latitude, gnssData.longitude, gnssData.altitude, gnssData.satellites);
+    return true;
+}
+
+bool CatMGNSSModule::parseGNSSData(const char* data) {
+    if (!parseCgnsinf(data, gnssData)) return false;
+
     // Update timestamp
     gnssData.lastUpdate = millis();
-    
+    publishGnss();
+
     Serial.printf("CatM+GNSS: Valid fix - Lat: %.6f, Lon: %.6f, Alt: %.1f, Sats: %d\n",
                  gnssData.latitude, gnssData.longitude, gnssData.altitude, gnssData.satellites);
-    
+
     return true;
 }
 
-bool CatMGNSSModule::parseGNSSData(const char* data) {
+bool CatMGNSSModule::parseCgnsinf(const char* data, GNSSData& out) {
     if (!data) return false;
-    
-    // Check if we have a valid response
-    const char* startPtr = strstr(data, "+CGNSINF: ");
-    if (!startPtr) {
+    const char* p = strstr(data, "+CGNSINF:");
+    if (!p) {
         Serial.println("CatM+GNSS: Invalid GNSS data format");
         return false;
     }
-    
-    // Extract the data part
-    startPtr += 10; // Skip "+CGNSINF: "
-    const char* endPtr = strstr(startPtr, "\r\n");
-    if (!endPtr) {
+    p += 9;
+    const char* eol = strpbrk(p, "\r\n");
+    if (!eol) {
         Serial.println("CatM+GNSS: Invalid GNSS data format");
         return false;
     }
-    
-    // Copy data to local buffer for parsing
-    size_t dataLen = endPtr - startPtr;
-    if (dataLen >= 512) {
-        Serial.println("CatM+GNSS: GNSS data too long");
-        return false;
-    }
-    
-    char gnssStr[512];
-    strncpy(gnssStr, startPtr, dataLen);
-    gnssStr[dataLen] = '\0';
-    
-    // Split by commas
-    int commaPos[15];
-    int commaCount = 0;
-    
-    for (int i = 0; gnssStr[i] != '\0' && commaCount < 15; i++) {
-        if (gnssStr[i] == ',') {
-            commaPos[commaCount++] = i;
-        }
-    }
-    
-    if (commaCount < 14) {
+
+    // Same in-place tokenizer as the +UGNSINF stream
+    sim7080g::GNSSFix fix;
+    char utc[24];
+    if (!SIM7080G_GNSS::parseInfo(p, static_cast<size_t>(eol - p), fix, utc, sizeof(utc))) {
         Serial.println("CatM+GNSS: Not enough data fields");
         return false;
     }
-    
-    // GNSS run status
-    char runStatusStr[16];
-    strncpy(runStatusStr, gnssStr, commaPos[0]);
-    runStatusStr[commaPos[0]] = '\0';
-    int gnssRunStatus = atoi(runStatusStr);
-    
-    if (gnssRunStatus != 1) {
-        Serial.println("CatM+GNSS: GNSS is not running");
-        gnssData.isValid = false;
-        return false;
-    }
-    
-    // GNSS fix status
-    char fixStatusStr[16];
-    strncpy(fixStatusStr, gnssStr + commaPos[0] + 1, commaPos[1] - commaPos[0] - 1);
-    fixStatusStr[commaPos[1] - commaPos[0] - 1] = '\0';
-    int gnssFixStatus = atoi(fixStatusStr);
-    gnssData.isValid = (gnssFixStatus == 1);
-    
-    if (!gnssData.isValid) {
-        Serial.println("CatM+GNSS: No valid GNSS fix");
+    if (!fix.valid) {
+        out.isValid = false;
         return false;
     }
-    
-    // UTC time
-    char utcTimeStr[16];
-    strncpy(utcTimeStr, gnssStr + commaPos[1] + 1, commaPos[2] - commaPos[1] - 1);
-    utcTimeStr[commaPos[2] - commaPos[1] - 1] = '\0';
-    
-    if (strlen(utcTimeStr) >= 14) {
-        char yearStr[5], monthStr[3], dayStr[3], hourStr[3], minuteStr[3], secondStr[3];
-        strncpy(yearStr, utcTimeStr, 4); yearStr[4] = '\0';
-        strncpy(monthStr, utcTimeStr + 4, 2); monthStr[2] = '\0';
-        strncpy(dayStr, utcTimeStr + 6, 2); dayStr[2] = '\0';
-        strncpy(hourStr, utcTimeStr + 8, 2); hourStr[2] = '\0';
-        strncpy(minuteStr, utcTimeStr + 10, 2); minuteStr[2] = '\0';
-        strncpy(secondStr, utcTimeStr + 12, 2); secondStr[2] = '\0';
-        
-        gnssData.year = atoi(yearStr);
-        gnssData.month = atoi(monthStr);
-        gnssData.day = atoi(dayStr);
-        gnssData.hour = atoi(hourStr);
-        gnssData.minute = atoi(minuteStr);
-        gnssData.second = atoi(secondStr);
-    }
-    
-    // Latitude
-    char latStr[32];
-    strncpy(latStr, gnssStr + commaPos[2] + 1, commaPos[3] - commaPos[2] - 1);
-    latStr[commaPos[3] - commaPos[2] - 1] = '\0';
-    gnssData.latitude = atof(latStr);
-    
-    // Longitude
-    char lonStr[32];
-    strncpy(lonStr, gnssStr + commaPos[3] + 1, commaPos[4] - commaPos[3] - 1);
-    lonStr[commaPos[4] - commaPos[3] - 1] = '\0';
-    gnssData.longitude = atof(lonStr);
-    
-    // Altitude
-    char altStr[32];
-    strncpy(altStr, gnssStr + commaPos[4] + 1, commaPos[5] - commaPos[4] - 1);
-    altStr[commaPos[5] - commaPos[4] - 1] = '\0';
-    gnssData.altitude = atof(altStr);
-    
-    // Speed
-    char speedStr[32];
-    strncpy(speedStr, gnssStr + commaPos[5] + 1, commaPos[6] - commaPos[5] - 1);
-    speedStr[commaPos[6] - commaPos[5] - 1] = '\0';
-    gnssData.speed = atof(speedStr);
-    
-    // Course
-    char courseStr[32];
-    strncpy(courseStr, gnssStr + commaPos[6] + 1, commaPos[7] - commaPos[6] - 1);
-    courseStr[commaPos[7] - commaPos[6] - 1] = '\0';
-    gnssData.course = atof(courseStr);
-    
-    // Satellites in view
-    char satsStr[16];
-    strncpy(satsStr, gnssStr + commaPos[13] + 1, commaPos[14] - commaPos[13] - 1);
-    satsStr[commaPos[14] - commaPos[13] - 1] = '\0';
-    gnssData.satellites = atoi(satsStr);
-    
-    // Try to parse DOP/accuracy fields if present beyond known indices
-    if (commaCount > 12) {
-        char hdStr[16], pdStr[16], vdStr[16];
-        
-        if (commaPos[9] + 1 < commaPos[10]) {
-            strncpy(hdStr, gnssStr + commaPos[9] + 1, commaPos[10] - commaPos[9] - 1);
-            hdStr[commaPos[10] - commaPos[9] - 1] = '\0';
-            gnssData.hdop = atof(hdStr);
-        }
-        
-        if (commaPos[10] + 1 < commaPos[11]) {
-            strncpy(pdStr, gnssStr + commaPos[10] + 1, commaPos[11] - commaPos[10] - 1);
-            pdStr[commaPos[11] - commaPos[10] - 1] = '\0';
-            gnssData.pdop = atof(pdStr);
-        }
-        
-        if (commaPos[11] + 1 < commaPos[12]) {
-            strncpy(vdStr, gnssStr + commaPos[11] + 1, commaPos[12] - commaPos[11] - 1);
-            vdStr[commaPos[12] - commaPos[11] - 1] = '\0';
-            gnssData.vdop = atof(vdStr);
-        }
-    }
-    
-    // Update timestamp
-    gnssData.lastUpdate = millis();
-    
-    Serial.printf("CatM+GNSS: Valid fix - Lat: %.6f, Lon: %.6f, Alt: %.1f, Sats: %d\n",
-                 gnssData.latitude, gnssData.longitude, gnssData.altitude, gnssData.satellites);
-    
+    copyFix(fix, utc, out);
     return true;
 }
 
-bool CatMGNSSModule::parseGnssUtc(const SIM7080G_String& utc) {
-    if (utc.length() == 0) return false;
+bool CatMGNSSModule::parseGnssUtc(const char* utc, GNSSData& gnssData) {
+    if (!utc || !*utc) return false;
 
-    String digits;
-    digits.reserve(16);
-    for (size_t i = 0; i < utc.length() && digits.length() < 14; ++i) {
-        char c = utc.charAt(i);
-        if (c >= '0' && c <= '9') {
-            digits += c;
+    // yyyyMMddhhmmss[.sss] or yyMMddhhmmss[.sss]; keep digits only
+    char digits[15];
+    size_t n = 0;
+    for (const char* p = utc; *p && n < 14; ++p) {
+        if (*p == '.') break;
+        if (*p >= '0' && *p <= '9') {
+            digits[n++] = *p;
         }
     }
 
-    if (digits.length() < 12) {
+    if (n < 12) {
         return false;
     }
 
+    auto num = [&digits](size_t at, size_t len) {
+        int v = 0;
+        for (size_t i = 0; i < len; ++i) v = v * 10 + (digits[at + i] - '0');
+        return v;
+    };
+
     int year = 0;
     int month = 0;
     int day = 0;
@@ -896,20 +895,20 @@ bool CatMGNSSModule::parseGnssUtc(const SIM7080G_String& utc) {
     int minute = 0;
     int second = 0;
 
-    if (digits.length() >= 14) {
-        year = digits.substring(0, 4).toInt();
-        month = digits.substring(4, 6).toInt();
-        day = digits.substring(6, 8).toInt();
-        hour = digits.substring(8, 10).toInt();
-        minute = digits.substring(10, 12).toInt();
-        second = digits.substring(12, 14).toInt();
+    if (n >= 14) {
+        year = num(0, 4);
+        month = num(4, 2);
+        day = num(6, 2);
+        hour = num(8, 2);
+        minute = num(10, 2);
+        second = num(12, 2);
     } else {
-        year = 2000 + digits.substring(0, 2).toInt();
-        month = digits.substring(2, 4).toInt();
-        day = digits.substring(4, 6).toInt();
-        hour = digits.substring(6, 8).toInt();
-        minute = digits.substring(8, 10).toInt();
-        second = digits.substring(10, 12).toInt();
+        year = 2000 + num(0, 2);
+        month = num(2, 2);
+        day = num(4, 2);
+        hour = num(6, 2);
+        minute = num(8, 2);
+        second = num(10, 2);
     }
 
     if (year < 2020 || month < 1 || month > 12 || day < 1 || day > 31 ||
@@ -927,15 +926,15 @@ bool CatMGNSSModule::parseGnssUtc(const SIM7080G_String& utc) {
 }
 
 GNSSData CatMGNSSModule::getGNSSData() {
-    return gnssData;
+    return gnssSnapshot_.read();
 }
 
 bool CatMGNSSModule::hasValidFix() {
-    return gnssData.isValid;
+    return getGNSSData().isValid;
 }
 
 uint8_t CatMGNSSModule::getSatellites() {
-    return gnssData.satellites;
+    return getGNSSData().satellites;
 }
 
 // Cellular Functions
@@ -1061,20 +1060,24 @@ bool CatMGNSSModule::configureAPN() {
     }
 
     // Fallback: legacy CNCFG profile config
-    String response;
-    String cmd1 = String("AT+CNCFG=0,1,\"") + apn_ + "\"";
-    ok = sendATCommand(cmd1, response, 3000) && response.indexOf("OK") >= 0;
+    char response[96];
+    sim7080g::FixedString<96> cmd;
+    cmd.append("AT+CNCFG=0,1,").appendQuoted(apn_.c_str());
+    ok = sendATCommand(cmd.c_str(), response, sizeof(response), 3000) && strstr(response, "OK") != nullptr;
     if (!ok) {
-        String cmd2 = String("AT+CNCFG=0,\"") + apn_ + "\"";
-        ok = sendATCommand(cmd2, response, 3000) && response.indexOf("OK") >= 0;
+        cmd.clear();
+        cmd.append("AT+CNCFG=0,").appendQuoted(apn_.c_str());
+        ok = sendATCommand(cmd.c_str(), response, sizeof(response), 3000) && strstr(response, "OK") != nullptr;
     }
     if (apnUser_.length()) {
-        String userCmd = String("AT+CNCFG=0,3,\"") + apnUser_ + "\"";
-        sendATCommand(userCmd, response, 3000);
+        cmd.clear();
+        cmd.append("AT+CNCFG=0,3,").appendQuoted(apnUser_.c_str());
+        sendATCommand(cmd.c_str(), response, sizeof(response), 3000);
     }
     if (apnPass_.length()) {
-        String passCmd = String("AT+CNCFG=0,4,\"") + apnPass_ + "\"";
-        ok = sendATCommand(passCmd, response, 3000) && response.indexOf("OK") >= 0;
+        cmd.clear();
+        cmd.append("AT+CNCFG=0,4,").appendQuoted(apnPass_.c_str());
+        ok = sendATCommand(cmd.c_str(), response, sizeof(response), 3000) && strstr(response, "OK") != nullptr;
     }
     return ok;
 }
@@ -1156,6 +1159,77 @@ bool CatMGNSSModule::isGnssPowered(bool& powered) {
     return false;
 }
 
+bool CatMGNSSModule::probeAttachState(AttachProbe& probe) {
+    probe = AttachProbe();
+    String response;
+    // One round trip for SIM, registration and PDP state
+    if (!sendATCommand("AT+CPIN?;+CEREG?;+CNACT?", response, 3000)) return false;
+    probe.simReady = response.indexOf("+CPIN: READY") >= 0;
+    int idx = response.indexOf("+CEREG:");
+    if (idx >= 0) {
+        int comma = response.indexOf(',', idx);
+        if (comma > 0) {
+            int end = response.indexOf(',', comma + 1);
+            int lineEnd = response.indexOf('\n', idx);
+            if (end < 0 || (lineEnd > 0 && end > lineEnd)) end = lineEnd;
+            String stateStr = (end > comma) ? response.substring(comma + 1, end) : response.substring(comma + 1);
+            stateStr.trim();
+            probe.regState = (uint8_t)stateStr.toInt();
+            updateRegistrationState(probe.regState);
+        }
+    } else if (urcRegState_.load() != 0xFF) {
+        // The +CEREG line of a combined query is claimed by the URC handler
+        probe.regState = urcRegState_.load();
+        updateRegistrationState(probe.regState);
+    }
+    bool anyActive = false;
+    parseCNACTResponse(response, anyActive, probe.ip);
+    probe.pdpActive = anyActive && probe.ip.length() > 0 && probe.ip != "0.0.0.0";
+    return true;
+}
+
+bool CatMGNSSModule::completeAttach() {
+    String response;
+    sendATCommand("AT+CNACT?", response, 3000);
+    bool anyActive = false;
+    String ip;
+    parseCNACTResponse(response, anyActive, ip);
+    if (anyActive) {
+        cellularData.hasIpAddress = ip.length() > 0;
+        cellularData.ipAddress = ip;
+    } else {
+        cellularData.hasIpAddress = false;
+        cellularData.ipAddress = "";
+    }
+
+    cellularData.isConnected = true;
+    cellularData.lastUpdate = millis();
+    cellularData.lastDetachReason = "";
+    resetNetworkStats();
+    updateNetworkStats();
+
+    getOperatorName();
+    getSignalStrength();
+    signalSampledMs_ = millis();
+    signalIntervalMs_ = CATM_SIGNAL_MIN_MS;
+    linkEventsSeen_ = linkEvents_.load();
+    linkVerifiedMs_ = millis();
+    return true;
+}
+
+void CatMGNSSModule::rememberAttach(uint8_t rat) {
+    String response;
+    AttachCache cache;
+    memset(&cache, 0, sizeof(cache));
+    if (!sendATCommand("AT+CPSI?", response, 3000) ||
+        !attach_parse_cpsi(response, cache.plmn, sizeof(cache.plmn), cache.band)) {
+        return;
+    }
+    strncpy(cache.apn, apn_.c_str(), sizeof(cache.apn) - 1);
+    cache.rat = rat;
+    attach_cache_put(cache);
+}
+
 bool CatMGNSSModule::connectNetwork(const String& apn) {
     if (!isInitialized) return false;
 
@@ -1166,8 +1240,26 @@ bool CatMGNSSModule::connectNetwork(const String& apn) {
 
     String response;
     resetNetworkStats();
+    const uint32_t attachStart = millis();
+
+    // Most reconnects follow a short dropout: find out what survived and
+    // redo only the rest
+    AttachProbe probe;
+    probeAttachState(probe);
+    AttachCache cache;
+    const bool cached = attach_cache_get(cache) && apn == cache.apn;
+    const bool registered = probe.regState == 1 || probe.regState == 5;
+    AttachPath path = AttachPath::WARM;
+    uint8_t rat = cached ? cache.rat : 38;
+
+    apn_ = apn;
+    cellularData.apn = apn;
 
-    if (isGnssPowered(gnssWasOn) && gnssWasOn) {
+    if (probe.simReady && registered && probe.pdpActive && cached) {
+        success = completeAttach();
+    }
+
+    if (!success && isGnssPowered(gnssWasOn) && gnssWasOn) {
         Serial.println("CatM+GNSS: Suspending GNSS for network attach");
         gnssSuspendAttempted = true;
         gnssSuspendSucceeded = disableGNSS();
@@ -1178,24 +1270,54 @@ bool CatMGNSSModule::connectNetwork(const String& apn) {
         }
     }
 
-    do {
+    if (!success && probe.simReady && registered) {
+        path = AttachPath::PDP;
+        success = configureAPN() && activatePDP(CATM_FAST_PDP_WAIT_MS) && completeAttach();
+    } else if (!success && probe.simReady && cached) {
+        path = AttachPath::CACHED;
+        // Last PLMN first; COPS mode 4 falls back to automatic selection
+        sim7080g::FixedString<48> cops;
+        cops.append("AT+COPS=4,2,").appendQuoted(cache.plmn);
+        sim7080g::FixedString<16> cnmp;
+        cnmp.appendf("AT+CNMP=%u", (unsigned)cache.rat);
+        sim7080g::AtBatchItem attach[] = {
+            makeBatchItem("AT+CFUN=1", 5000, false),
+            makeBatchItem("AT+CMNB=1", 2000, false),
+            makeBatchItem(cnmp.c_str(), 2000, false),
+            makeBatchItem("AT+CGATT=1", 5000, false),
+            makeBatchItem(cops.c_str(), 5000, false),
+        };
+        runATBatch(attach, sizeof(attach) / sizeof(attach[0]));
+        success = ensureRegistered(CATM_FAST_REG_WAIT_MS) && configureAPN() &&
+                  activatePDP(CATM_FAST_PDP_WAIT_MS) && completeAttach();
+    }
+
+    if (!success && path != AttachPath::WARM) {
+        attach_path_record(path, false, millis() - attachStart);
+        Serial.printf("CatM+GNSS: %s reconnect failed, full attach\n", attach_path_name(path));
+    }
+
+    if (!success) do {
+        path = AttachPath::FULL;
+        rat = 38;
         if (!sendATCommand("AT+CPIN?", response, 2000) || response.indexOf("+CPIN: READY") < 0) {
             Serial.println("CatM+GNSS: SIM not ready");
             break;
         }
 
-        sendATCommand("AT+CFUN=1", response, 5000);
-        sendATCommand("AT+CMNB=1", response, 2000);
-        sendATCommand("AT+CNMP=38", response, 2000);
-        sendATCommand("AT+CGATT=1", response, 5000);
-        sendATCommand("AT+COPS=0", response, 5000);
+        sim7080g::AtBatchItem attach[] = {
+            makeBatchItem("AT+CFUN=1", 5000, false),
+            makeBatchItem("AT+CMNB=1", 2000, false),
+            makeBatchItem("AT+CNMP=38", 2000, false),
+            makeBatchItem("AT+CGATT=1", 5000, false),
+            makeBatchItem("AT+COPS=0", 5000, false),
+        };
+        runATBatch(attach, sizeof(attach) / sizeof(attach[0]));
 
         if (!ensureRegistered(120000)) {
             Serial.println("CatM+GNSS: Not registered to network (CEREG) yet");
         }
 
-        apn_ = apn;
-        cellularData.apn = apn;
         if (!configureAPN()) {
             Serial.println("CatM+GNSS: Failed to set APN (CNCFG)");
             break;
@@ -1204,6 +1326,7 @@ bool CatMGNSSModule::connectNetwork(const String& apn) {
         if (!activatePDP(90000)) {
             Serial.println("CatM+GNSS: PDP activation failed on CNMP=38; trying auto RAT (CNMP=2)");
             sendATCommand("AT+CNMP=2", response, 2000);
+            rat = 2;
             ensureRegistered(60000);
             if (!activatePDP(90000)) {
                 Serial.println("CatM+GNSS: Failed to activate PDP (CNACT) after fallback");
@@ -1218,32 +1341,7 @@ bool CatMGNSSModule::connectNetwork(const String& apn) {
             }
         }
 
-        sendATCommand("AT+CNACT?", response, 3000);
-        bool anyActive = false;
-        String ip;
-        parseCNACTResponse(response, anyActive, ip);
-        if (anyActive) {
-            cellularData.hasIpAddress = ip.length() > 0;
-            cellularData.ipAddress = ip;
-        } else {
-            cellularData.hasIpAddress = false;
-            cellularData.ipAddress = "";
-        }
-
-        getOperatorName();
-        getSignalStrength();
-
-        cellularData.isConnected = true;
-        cellularData.lastUpdate = millis();
-        cellularData.lastDetachReason = "";
-        resetNetworkStats();
-        updateNetworkStats();
-
-        getOperatorName();
-        getSignalStrength();
-
-        Serial.println("CatM+GNSS: Connected to network");
-        success = true;
+        success = completeAttach();
     } while (false);
 
     if (gnssSuspendAttempted && gnssWasOn) {
@@ -1259,11 +1357,18 @@ bool CatMGNSSModule::connectNetwork(const String& apn) {
         }
     }
 
+    const uint32_t elapsed = millis() - attachStart;
+    attach_path_record(path, success, elapsed);
+
     if (!success) {
         cellularData.isConnected = false;
         cellularData.hasIpAddress = false;
         cellularData.ipAddress = "";
         resetNetworkStats();
+    } else {
+        Serial.printf("CatM+GNSS: Connected to network (%s, %lu ms to IP)\n", attach_path_name(path),
+                      (unsigned long)elapsed);
+        if (path != AttachPath::WARM) rememberAttach(rat);
     }
 
     return success;
@@ -1288,6 +1393,7 @@ bool CatMGNSSModule::disconnectNetwork() {
     }
     
     cellularData.isConnected = false;
+    linkVerifiedMs_ = millis();
 
     if (xEventGroupSystemStatus) {
         xEventGroupClearBits(xEventGroupSystemStatus, EVENT_BIT_CELLULAR_READY);
@@ -1297,9 +1403,88 @@ bool CatMGNSSModule::disconnectNetwork() {
     return true;
 }
 
+// "+CEREG: <stat>[,<tac>,<ci>,<AcT>]" unsolicited, "+CEREG: <n>,<stat>[,...]" when
+// it is the reply to a query another command was combined with
+void CatMGNSSModule::onRegistrationUrc(const char* line, size_t len, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    if (!self || len < 8) return;
+    const char* p = line + 7;
+    const char* end = line + len;
+    while (p < end && *p == ' ') p++;
+    if (p >= end || !isdigit((unsigned char)*p)) return;
+    int first = 0;
+    while (p < end && isdigit((unsigned char)*p)) first = first * 10 + (*p++ - '0');
+    int stat = first;
+    if (p < end && *p == ',' && p + 1 < end && isdigit((unsigned char)p[1])) {
+        stat = 0;
+        for (p++; p < end && isdigit((unsigned char)*p); p++) stat = stat * 10 + (*p - '0');
+    }
+    self->regUrcs_++;
+    if (self->urcRegState_.exchange((uint8_t)stat) != (uint8_t)stat) self->linkEvents_++;
+}
+
+// "+APP PDP: 0,ACTIVE" / "+APP PDP: 0,DEACTIVE"
+void CatMGNSSModule::onPdpUrc(const char* line, size_t len, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    if (!self) return;
+    int8_t up = -1;
+    for (size_t i = 0; i + 6 <= len; ++i) {
+        if (i + 8 <= len && strncasecmp(line + i, "DEACTIVE", 8) == 0) { up = 0; break; }
+        if (strncasecmp(line + i, "ACTIVE", 6) == 0) { up = 1; break; }
+    }
+    if (up < 0) return;
+    self->pdpUrcs_++;
+    if (self->urcPdp_.exchange(up) != up) self->linkEvents_++;
+}
+
+void CatMGNSSModule::pollLinkUrcs() {
+    if (!modem_) return;
+    // Whoever holds the port dispatches URCs with its own traffic; don't wait for it
+    MutexGuard guard(serialMutex, 0);
+    if (guard.acquired()) {
+        modem_->pollUrcs(0);
+    }
+}
+
+bool CatMGNSSModule::rxUnread() {
+    if (!modem_) return false;
+    MutexGuard guard(serialMutex, 0);
+    return guard.acquired() && modem_->available() > 0;
+}
+
 bool CatMGNSSModule::isNetworkConnected() {
     if (!isInitialized) return false;
 
+    pollLinkUrcs();
+    const uint32_t now = millis();
+    const uint32_t events = linkEvents_.load();
+    const uint32_t verifyMs = cellularData.isConnected ? CATM_LINK_VERIFY_MS : CATM_LINK_DOWN_VERIFY_MS;
+    if (linkVerifiedMs_ != 0 && events == linkEventsSeen_ && now - linkVerifiedMs_ < verifyMs) {
+        linkCacheHits_++;
+        updateNetworkStats();
+        return cellularData.isConnected;
+    }
+    if (events != linkEventsSeen_ && urcRegState_.load() != 0xFF) {
+        updateRegistrationState(urcRegState_.load());
+    }
+    linkEventsSeen_ = events;
+    linkVerifiedMs_ = now;
+    linkVerifies_++;
+    return verifyLink();
+}
+
+LinkCacheStats CatMGNSSModule::getLinkCacheStats() const {
+    LinkCacheStats s;
+    s.cacheHits = linkCacheHits_;
+    s.verifies = linkVerifies_;
+    s.regUrcs = regUrcs_.load();
+    s.pdpUrcs = pdpUrcs_.load();
+    s.signalSamples = signalSamples_;
+    s.signalIntervalMs = signalIntervalMs_;
+    return s;
+}
+
+bool CatMGNSSModule::verifyLink() {
     String response;
     bool wasConnected = cellularData.isConnected;
 
@@ -1377,6 +1562,24 @@ int8_t CatMGNSSModule::getSignalStrength() {
     return rssi;
 }
 
+int8_t CatMGNSSModule::pollSignalStrength(uint32_t now) {
+    if (signalSampledMs_ != 0 && now - signalSampledMs_ < signalIntervalMs_) {
+        return cellularData.signalStrength;
+    }
+    const bool first = signalSampledMs_ == 0;
+    const int8_t previous = cellularData.signalStrength;
+    const int8_t rssi = getSignalStrength();
+    signalSampledMs_ = now;
+    signalSamples_++;
+    // Steady signal backs off; a change, or a weak link, samples fast again
+    if (!first && abs(rssi - previous) <= 2 && rssi > -105) {
+        signalIntervalMs_ = signalIntervalMs_ * 2 > CATM_SIGNAL_MAX_MS ? CATM_SIGNAL_MAX_MS : signalIntervalMs_ * 2;
+    } else {
+        signalIntervalMs_ = CATM_SIGNAL_MIN_MS;
+    }
+    return rssi;
+}
+
 String CatMGNSSModule::getOperatorName() {
     if (!isInitialized) return "";
     
@@ -1512,8 +1715,32 @@ bool CatMGNSSModule::softReset() {
 CellularData CatMGNSSModule::getCellularData() {
     return cellularData;
 }
-CellStatus CatMGNSSModule::getCellStatus() {
-    return CellStatus::fromCellularData(cellularData, apn_, cellularData.imei);
+void CatMGNSSModule::publishCellular() {
+    CellularSnapshot s = {};
+    s.isConnected = cellularData.isConnected;
+    s.isRegistered = cellularData.isRegistered;
+    s.isValid = cellularData.isValid;
+    s.hasIpAddress = cellularData.hasIpAddress;
+    s.signalStrength = cellularData.signalStrength;
+    s.registrationState = cellularData.registrationState;
+    s.lastUpdate = cellularData.lastUpdate;
+    s.errorCount = cellularData.errorCount;
+    s.txBytes = cellularData.txBytes;
+    s.rxBytes = cellularData.rxBytes;
+    s.txBps = cellularData.txBps;
+    s.rxBps = cellularData.rxBps;
+    strlcpy(s.operatorName, cellularData.operatorName.c_str(), sizeof(s.operatorName));
+    strlcpy(s.imei, cellularData.imei.c_str(), sizeof(s.imei));
+    strlcpy(s.ipAddress, cellularData.ipAddress.c_str(), sizeof(s.ipAddress));
+    strlcpy(s.apn, cellularData.apn.c_str(), sizeof(s.apn));
+    strlcpy(s.lastDetachReason, cellularData.lastDetachReason.c_str(), sizeof(s.lastDetachReason));
+    cellSnapshot_.write(s);
+}
+
+CellStatus CatMGNSSModule::getCellStatus() const {
+    CellStatus status = CellStatus::fromSnapshot(getCellularSnapshot());
+    if (apn_.length()) strlcpy(status.data.apn, apn_.c_str(), sizeof(status.data.apn));
+    return status;
 }
 
 
@@ -1580,55 +1807,48 @@ bool CatMGNSSModule::parseNetDevStatus(const String& resp, uint64_t& txBytes, ui
     return false;
 }
 
+// Counts and rates come from the local accounting; the modem's own counters
+// are only read when a reconcile is due
 bool CatMGNSSModule::updateNetworkStats() {
     if (!isInitialized || !cellularData.isConnected) {
         return false;
     }
 
-    String response;
-    if (!sendATCommand("AT+NETDEVSTATUS=0", response, 2000)) {
-        return false;
-    }
-
-    uint64_t txBytes = 0;
-    uint64_t rxBytes = 0;
-    uint32_t txBps = 0;
-    uint32_t rxBps = 0;
-    if (!parseNetDevStatus(response, txBytes, rxBytes, txBps, rxBps)) {
-        return false;
-    }
-
-    uint32_t now = millis();
-    if (lastStatsSampleMs_ != 0 && (txBps == 0 && rxBps == 0)) {
-        uint32_t deltaMs = now - lastStatsSampleMs_;
-        if (deltaMs > 0) {
-            uint64_t txDelta = (txBytes >= lastTxBytesSample_) ? (txBytes - lastTxBytesSample_) : 0;
-            uint64_t rxDelta = (rxBytes >= lastRxBytesSample_) ? (rxBytes - lastRxBytesSample_) : 0;
-            txBps = static_cast<uint32_t>((txDelta * 1000ULL) / deltaMs);
-            rxBps = static_cast<uint32_t>((rxDelta * 1000ULL) / deltaMs);
+    const uint32_t now = millis();
+    if (data_usage_reconcile_due(now)) {
+        String response;
+        uint64_t txBytes = 0;
+        uint64_t rxBytes = 0;
+        uint32_t txBps = 0;
+        uint32_t rxBps = 0;
+        if (sendATCommand("AT+NETDEVSTATUS=0", response, 2000) &&
+            parseNetDevStatus(response, txBytes, rxBytes, txBps, rxBps)) {
+            data_usage_reconcile(txBytes, rxBytes, now);
         }
     }
 
-    cellularData.txBytes = txBytes;
-    cellularData.rxBytes = rxBytes;
-    cellularData.txBps = txBps;
-    cellularData.rxBps = rxBps;
+    DataUsageStats usage;
+    data_usage_get(usage);
+    cellularData.txBytes = usage.cellular.txBytes - sessionTxBase_;
+    cellularData.rxBytes = usage.cellular.rxBytes - sessionRxBase_;
+    cellularData.txBps = usage.cellular.txBps;
+    cellularData.rxBps = usage.cellular.rxBps;
     cellularData.lastUpdate = now;
-
-    lastTxBytesSample_ = txBytes;
-    lastRxBytesSample_ = rxBytes;
-    lastStatsSampleMs_ = now;
     return true;
 }
 
 void CatMGNSSModule::resetNetworkStats() {
+    data_usage_session_reset();
+    // A new PDP session: the modem's HTTP connection went with the old one
+    if (http_) http_->invalidateSession();
+    DataUsageStats usage;
+    data_usage_get(usage);
+    sessionTxBase_ = usage.cellular.txBytes;
+    sessionRxBase_ = usage.cellular.rxBytes;
     cellularData.txBytes = 0;
     cellularData.rxBytes = 0;
     cellularData.txBps = 0;
     cellularData.rxBps = 0;
-    lastTxBytesSample_ = 0;
-    lastRxBytesSample_ = 0;
-    lastStatsSampleMs_ = 0;
 }
 
 bool CatMGNSSModule::sendSMS(const String& number, const String& message) {
@@ -1642,29 +1862,28 @@ bool CatMGNSSModule::sendSMS(const String& number, const String& message) {
         return false;
     }
     
-    // Send SMS command
-    String smsCmd = "AT+CMGS=\"" + number + "\"";
-    if (!sendATCommand(smsCmd, response, 1000) || response.indexOf(">") < 0) {
-        Serial.println("CatM+GNSS: Failed to start SMS");
+    // Prompted write: AT+CMGS completes on '>' and the body is terminated with Ctrl+Z
+    MutexGuard guard(serialMutex, pdMS_TO_TICKS(1000));
+    if (!guard.acquired()) {
+        Serial.println("CatM+GNSS: Failed to take mutex for SMS");
         return false;
     }
-    
-    // Take mutex for direct write
-    if (!serialMutex || xSemaphoreTake(serialMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        Serial.println("CatM+GNSS: Failed to take mutex for SMS");
+
+    String smsCmd = "AT+CMGS=\"" + number + "\"";
+    Serial.println("CatM+GNSS: >>> " + smsCmd);
+    auto prompt = modem_->sendCommandForPrompt(smsCmd.c_str(), 5000);
+    if (prompt.status != M5_SIM7080G::Status::Ok) {
+        Serial.println("CatM+GNSS: Failed to start SMS");
         return false;
     }
-    
+
     // Send message content
     serialModule->print(message);
     serialModule->write(26); // Ctrl+Z to end message
-    
+
     // Wait for response
     bool result = waitForResponse(response, 10000);
-    
-    // Release mutex
-    xSemaphoreGive(serialMutex);
-    
+
     if (!result || response.indexOf("+CMGS:") < 0) {
         Serial.println("CatM+GNSS: Failed to send SMS");
         return false;
@@ -1674,7 +1893,22 @@ bool CatMGNSSModule::sendSMS(const String& number, const String& message) {
     return true;
 }
 
+bool CatMGNSSModule::httpUseBase(const SIM7080G_String& baseUrl) {
+    if (baseUrl == lastHttpBaseUrl_) return true;
+    if (!http_->configure(baseUrl, CATM_HTTP_BODY_LEN, 350, 5000)) {
+        Serial.println("CatM+GNSS: HTTP configure failed");
+        lastHttpBaseUrl_.clear();
+        return false;
+    }
+    lastHttpBaseUrl_ = baseUrl;
+    return true;
+}
+
 bool CatMGNSSModule::sendHTTP(const String& url, const String& data, String& response) {
+    return sendHTTP(url, data.c_str(), data.length(), response);
+}
+
+bool CatMGNSSModule::sendHTTP(const String& url, const char* data, size_t len, String& response) {
     if (!isInitialized || !cellularData.isConnected || !http_) return false;
 
     SIM7080G_String baseUrl;
@@ -1687,21 +1921,16 @@ bool CatMGNSSModule::sendHTTP(const String& url, const String& data, String& res
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) return false;
 
-    if (baseUrl != lastHttpBaseUrl_) {
-        if (!http_->configure(baseUrl, 1024, 350, 5000)) {
-            Serial.println("CatM+GNSS: HTTP configure failed");
-            return false;
-        }
-        lastHttpBaseUrl_ = baseUrl;
-    }
+    if (!httpUseBase(baseUrl)) return false;
 
-    const bool isGetRequest = (data.length() == 0);
+    const bool isGetRequest = (len == 0 || !data);
     sim7080g::HttpResponse httpResp{};
     if (isGetRequest) {
         httpResp = http_->get(path, 30000);
     } else {
-        httpResp = http_->post(path, data, "application/json", 30000);
+        httpResp = http_->post(path, data, len, "application/json", 30000);
     }
+    data_usage_tx(TransportPathId::Http, path.length() + (isGetRequest ? 0 : len) + DATA_USAGE_HTTP_TX_OVERHEAD);
 
     if (httpResp.status != sim7080g::Status::Ok) {
         Serial.printf("CatM+GNSS: HTTP %s request failed\n", isGetRequest ? "GET" : "POST");
@@ -1710,38 +1939,114 @@ bool CatMGNSSModule::sendHTTP(const String& url, const String& data, String& res
     }
 
     response = httpResp.body;
+    data_usage_rx(TransportPathId::Http, response.length() + DATA_USAGE_HTTP_RX_OVERHEAD);
     Serial.printf("CatM+GNSS: HTTP %s request sent successfully\n", isGetRequest ? "GET" : "POST");
     return true;
 }
 
-bool CatMGNSSModule::sendJSON(const String& url, JsonDocument& json, String& response) {
-    // Serialize JSON
-    String jsonStr;
-    serializeJson(json, jsonStr);
-    
-    // Send HTTP request
-    return sendHTTP(url, jsonStr, response);
+int CatMGNSSModule::httpGetRange(const String& url, uint32_t offset, uint8_t* out, size_t len, int& httpStatus) {
+    httpStatus = -1;
+    if (!isInitialized || !cellularData.isConnected || !http_) return -1;
+
+    SIM7080G_String baseUrl;
+    SIM7080G_String path;
+    if (!parseHttpUrl(url, baseUrl, path)) {
+        Serial.println("CatM+GNSS: Invalid HTTP URL");
+        return -1;
+    }
+
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) return -1;
+
+    if (!httpUseBase(baseUrl)) return -1;
+
+    const int n = http_->getRange(path, offset, out, len, httpStatus, 30000);
+    data_usage_tx(TransportPathId::Http, path.length() + DATA_USAGE_HTTP_TX_OVERHEAD);
+    if (n >= 0) data_usage_rx(TransportPathId::Http, (size_t)n + DATA_USAGE_HTTP_RX_OVERHEAD);
+    return n;
+}
+
+bool CatMGNSSModule::httpPostStream(const String& url, size_t total, SIM7080G_HTTP::BodyProducer producer, void* ctx,
+                                    const char* contentType, SIM7080G_HTTP::ProgressCallback progress,
+                                    void* progressCtx, String& response) {
+    if (!isInitialized || !cellularData.isConnected || !http_ || !producer) return false;
+    if (total == 0 || total > CATM_HTTP_BODY_LEN) return false;
+
+    SIM7080G_String baseUrl;
+    SIM7080G_String path;
+    if (!parseHttpUrl(url, baseUrl, path)) {
+        Serial.println("CatM+GNSS: Invalid HTTP URL");
+        return false;
+    }
+
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) return false;
+    if (!httpUseBase(baseUrl)) return false;
+
+    const sim7080g::HttpResponse httpResp =
+        http_->postStream(path, total, producer, ctx, contentType, progress, progressCtx, 30000);
+    data_usage_tx(TransportPathId::Http, path.length() + total + DATA_USAGE_HTTP_TX_OVERHEAD);
+    if (httpResp.status != sim7080g::Status::Ok) {
+        Serial.printf("CatM+GNSS: HTTP streamed POST of %u bytes failed\n", (unsigned)total);
+        response = "";
+        return false;
+    }
+    response = httpResp.body;
+    data_usage_rx(TransportPathId::Http, response.length() + DATA_USAGE_HTTP_RX_OVERHEAD);
+    return true;
+}
+
+void CatMGNSSModule::httpPoll() {
+    if (!http_ || !serialMutex || !http_->sessionOpen()) return;
+    MutexGuard guard(serialMutex, 0);
+    if (!guard.acquired()) return;
+    http_->closeIfIdle();
+}
+
+bool CatMGNSSModule::sendJSON(const String& url, const JsonWriter& json, String& response) {
+    if (!json.ok() || !json.length()) return false;
+    return sendHTTP(url, json.data(), json.length(), response);
 }
 
 bool CatMGNSSModule::mqttConfigure(const String& broker, uint16_t port, const String& clientId) {
     if (!mqtt_ || !serialMutex) return false;
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) return false;
-    return mqtt_->configure(broker, port, clientId, 60, true);
+    if (!mqtt_->configure(broker, port, clientId, 60, true)) return false;
+    // Asynchronous publishing; a modem without it keeps one publish at a time
+    if (!mqtt_->setWindow(CATM_MQTT_WINDOW, CATM_MQTT_ACK_TIMEOUT_MS)) {
+        Serial.println("CatM+GNSS: MQTT async mode refused; publishing one at a time");
+    }
+    return true;
 }
 
 bool CatMGNSSModule::mqttConnect(uint32_t timeoutMs) {
     if (!mqtt_ || !serialMutex) return false;
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) return false;
-    return mqtt_->connect(timeoutMs);
+    if (!mqtt_->connect(timeoutMs)) return false;
+    // Shared-attribute pushes; a failed subscribe leaves the periodic fetch as the source
+    mqtt_->subscribe("v1/devices/me/attributes", 1, 3000);
+#if REMOTE_DIAG_ENABLE
+    // Diagnostics commands (remote_diag.h)
+    mqtt_->subscribe(REMOTE_DIAG_RPC_TOPIC "+", 1, 3000);
+#endif
+    return true;
 }
 
 bool CatMGNSSModule::mqttPublish(const String& topic, const String& payload, int qos, bool retain) {
+    return mqttPublish(topic.c_str(), reinterpret_cast<const uint8_t*>(payload.c_str()), payload.length(), qos,
+                       retain);
+}
+
+bool CatMGNSSModule::mqttPublish(const char* topic, const uint8_t* data, size_t len, int qos, bool retain) {
     if (!mqtt_ || !serialMutex) return false;
     MutexGuard guard(serialMutex);
     if (!guard.acquired()) return false;
-    return mqtt_->publish(topic, payload, qos, retain, 10000);
+    if (!mqtt_->publish(topic, data, len, qos, retain, 10000)) return false;
+    data_usage_tx(TransportPathId::Mqtt, strlen(topic) + len + DATA_USAGE_MQTT_OVERHEAD);
+    if (qos > 0) data_usage_rx(TransportPathId::Mqtt, DATA_USAGE_MQTT_ACK_BYTES);
+    return true;
 }
 
 bool CatMGNSSModule::mqttSubscribe(const String& topic, int qos) {
@@ -1767,6 +2072,7 @@ void CatMGNSSModule::printStatus() {
     Serial.println("=== CatM+GNSS Module Status ===");
     Serial.printf("Initialized: %s\n", isInitialized ? "YES" : "NO");
     Serial.printf("State: %d\n", (int)state);
+    Serial.printf("UART Baud: %lu\n", (unsigned long)getUartBaud());
     
     Serial.println("--- GNSS Status ---");
     Serial.printf("Valid Fix: %s\n", gnssData.isValid ? "YES" : "NO");
@@ -1783,6 +2089,35 @@ void CatMGNSSModule::printStatus() {
     Serial.printf("Signal: %d dBm\n", cellularData.signalStrength);
     Serial.printf("IMEI: %s\n", cellularData.imei.c_str());
     Serial.printf("Error Count: %d\n", cellularData.errorCount);
+    for (size_t i = 0; i < (size_t)AttachPath::COUNT; i++) {
+        const AttachPathStats a = attach_path_stats((AttachPath)i);
+        if (!a.attempts) continue;
+        Serial.printf("Attach %-6s %lu/%lu ok, to IP %lu ms (avg %lu, max %lu)\n", attach_path_name((AttachPath)i),
+                      (unsigned long)a.successes, (unsigned long)a.attempts, (unsigned long)a.lastMs,
+                      (unsigned long)a.avgMs, (unsigned long)a.maxMs);
+    }
+    const LinkCacheStats l = getLinkCacheStats();
+    Serial.printf("Link cache: %lu hits, %lu verifies, URCs %lu CEREG / %lu PDP; signal every %lu s (%lu samples)\n",
+                  (unsigned long)l.cacheHits, (unsigned long)l.verifies, (unsigned long)l.regUrcs,
+                  (unsigned long)l.pdpUrcs, (unsigned long)(l.signalIntervalMs / 1000),
+                  (unsigned long)l.signalSamples);
+    if (mqtt_) {
+        const SIM7080G_MQTT::PublishStats& m = mqtt_->publishStats();
+        Serial.printf("MQTT: %lu published, %lu acked, %lu failed, %lu timed out; window %u (%s), "
+                      "%u in flight (max %u), %lu waited\n",
+                      (unsigned long)m.published, (unsigned long)m.acked, (unsigned long)m.failed,
+                      (unsigned long)m.timedOut, (unsigned)mqtt_->window(), m.async ? "async" : "sync",
+                      (unsigned)m.inFlight, (unsigned)m.maxInFlight, (unsigned long)m.windowFull);
+    }
+    if (http_) {
+        const SIM7080G_HTTP::SessionStats& h = http_->sessionStats();
+        Serial.printf("HTTP: %lu requests, %lu connects, %lu reused (%lu retried), %lu/%lu health checks failed, "
+                      "%lu idle closes; headers %lu sent, %lu cached\n",
+                      (unsigned long)h.requests, (unsigned long)h.connects, (unsigned long)h.reuses,
+                      (unsigned long)h.retries, (unsigned long)h.healthFailures, (unsigned long)h.healthChecks,
+                      (unsigned long)h.idleCloses, (unsigned long)h.headerSends, (unsigned long)h.headerHits);
+    }
+    data_usage_report(Serial);
     
     Serial.println("============================");
 }
@@ -1950,12 +2285,26 @@ bool CatMGNSSModule::configureNetworkTime() {
     return false;
 }
 
-bool CatMGNSSModule::syncNetworkTime(struct tm& utcOut, uint32_t timeoutMs) {
+// "+CNTP: <code>[,"<yyyy/MM/dd,hh:mm:ss>"]", the outcome of AT+CNTPSTART
+void CatMGNSSModule::onCntpUrc(const char* line, size_t len, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    // The prefix also matches +CNTPCID
+    if (!self || len < 7 || line[5] != ':') return;
+    if (self->cntpState_.load() != static_cast<uint8_t>(NetworkTimeSyncState::PENDING)) return;
+    const size_t n = len < sizeof(self->cntpLine_) - 1 ? len : sizeof(self->cntpLine_) - 1;
+    memcpy(self->cntpLine_, line, n);
+    self->cntpLine_[n] = '\0';
+    self->cntpReceivedUs_ = esp_timer_get_time();
+    self->cntpState_.store(static_cast<uint8_t>(NetworkTimeSyncState::DONE));
+}
+
+bool CatMGNSSModule::startNetworkTimeSync() {
     if (!isInitialized) {
         lastError_ = "Module not initialized";
         networkTimeSynced_ = false;
         return false;
     }
+    if (cntpState_.load() == static_cast<uint8_t>(NetworkTimeSyncState::PENDING)) return true;
     if (!networkTimeConfigured_) {
         Serial.println("CatM+GNSS: Network time not configured, applying configuration...");
         if (!configureNetworkTime()) {
@@ -1964,69 +2313,154 @@ bool CatMGNSSModule::syncNetworkTime(struct tm& utcOut, uint32_t timeoutMs) {
             return false;
         }
     }
-    
-    Serial.printf("CatM+GNSS: Starting NTP sync (timeout %u ms)...\n", timeoutMs);
-    
-    // Clear UART buffer
-    if (xSemaphoreTake(serialMutex, pdMS_TO_TICKS(5000)) != pdTRUE) {
-        lastError_ = "Failed to acquire serial mutex";
+
+    // Armed before the command so a quick +CNTP isn't dropped
+    cntpState_.store(static_cast<uint8_t>(NetworkTimeSyncState::PENDING));
+    String response;
+    if (!sendATCommand("AT+CNTPSTART", response, 2000)) {
+        cntpState_.store(static_cast<uint8_t>(NetworkTimeSyncState::IDLE));
+        lastError_ = "AT+CNTPSTART failed";
         networkTimeSynced_ = false;
         return false;
     }
-    
-    while (serialModule->available()) {
-        serialModule->read();
-    }
-    
-    // Send AT+CNTPSTART
-    Serial.println("CatM+GNSS: >>> AT+CNTPSTART");
-    serialModule->println("AT+CNTPSTART");
-    
-    // Wait for URC response: +CNTP: <result>,"<time>"
-    char response[256] = {0};
-    uint32_t start = millis();
-    bool foundCNTP = false;
-    int responseLen = 0;
-    
-    while (millis() - start < timeoutMs) {
-        if (serialModule->available()) {
-            char c = serialModule->read();
-            if (responseLen < sizeof(response) - 1) {
-                response[responseLen++] = c;
-                response[responseLen] = '\0';
-            }
-            
-            // Check if we have a complete line
-            if (c == '\n') {
-                // Trim whitespace
-                while (responseLen > 0 && (response[responseLen-1] == '\r' || response[responseLen-1] == '\n' || response[responseLen-1] == ' ')) {
-                    response[--responseLen] = '\0';
-                }
-                
-                Serial.printf("CatM+GNSS: <<< %s\n", response);
-                
-                // Look for +CNTP: response
-                if (strncmp(response, "+CNTP:", 6) == 0) {
-                    foundCNTP = true;
-                    break;
-                }
-                
-                responseLen = 0;
-                response[0] = '\0';
-            }
+    cntpStartedMs_ = millis();
+    Serial.println("CatM+GNSS: NTP sync started");
+    return true;
+}
+
+NetworkTimeSyncState CatMGNSSModule::pollNetworkTimeSync(struct tm& utcOut, int64_t* receivedMonoUs) {
+    NetworkTimeSyncState state = static_cast<NetworkTimeSyncState>(cntpState_.load());
+    if (state == NetworkTimeSyncState::PENDING) {
+        pollLinkUrcs();
+        state = static_cast<NetworkTimeSyncState>(cntpState_.load());
+        if (state == NetworkTimeSyncState::PENDING) {
+            if (millis() - cntpStartedMs_ < CATM_CNTP_TIMEOUT_MS) return state;
+            cntpState_.store(static_cast<uint8_t>(NetworkTimeSyncState::IDLE));
+            lastError_ = "NTP sync timeout - no +CNTP response received";
+            Serial.printf("CatM+GNSS: ERROR - %s\n", lastError_.c_str());
+            networkTimeSynced_ = false;
+            return NetworkTimeSyncState::FAILED;
         }
-        vTaskDelay(pdMS_TO_TICKS(10));
     }
-    
-    xSemaphoreGive(serialMutex);
-    
-    if (!foundCNTP) {
-        lastError_ = "NTP sync timeout - no +CNTP response received";
-        Serial.printf("CatM+GNSS: ERROR - %s\n", lastError_.c_str());
-        networkTimeSynced_ = false;
+    if (state != NetworkTimeSyncState::DONE) return state;
+
+    char response[sizeof(cntpLine_)];
+    memcpy(response, cntpLine_, sizeof(response));
+    if (receivedMonoUs) *receivedMonoUs = cntpReceivedUs_;
+    cntpState_.store(static_cast<uint8_t>(NetworkTimeSyncState::IDLE));
+    Serial.printf("CatM+GNSS: <<< %s\n", response);
+    return parseCntpResult(response, utcOut) ? NetworkTimeSyncState::DONE : NetworkTimeSyncState::FAILED;
+}
+
+// Waits for the result without holding the serial lock
+bool CatMGNSSModule::syncNetworkTime(struct tm& utcOut, uint32_t timeoutMs) {
+    Serial.printf("CatM+GNSS: Starting NTP sync (timeout %u ms)...\n", timeoutMs);
+    if (!startNetworkTimeSync()) return false;
+    const uint32_t start = millis();
+    while (millis() - start < timeoutMs) {
+        const NetworkTimeSyncState state = pollNetworkTimeSync(utcOut);
+        if (state == NetworkTimeSyncState::DONE) return true;
+        if (state != NetworkTimeSyncState::PENDING) return false;
+        vTaskDelay(pdMS_TO_TICKS(200));
+    }
+    cntpState_.store(static_cast<uint8_t>(NetworkTimeSyncState::IDLE));
+    lastError_ = "NTP sync timeout - no +CNTP response received";
+    Serial.printf("CatM+GNSS: ERROR - %s\n", lastError_.c_str());
+    networkTimeSynced_ = false;
+    return false;
+}
+
+// "+HTTPTOFS: <http status>,<length>", the outcome of AT+HTTPTOFS
+void CatMGNSSModule::onHttpToFsUrc(const char* line, size_t len, void* ctx) {
+    CatMGNSSModule* self = static_cast<CatMGNSSModule*>(ctx);
+    // The prefix also matches +HTTPTOFSRL
+    if (!self || len < 11 || line[9] != ':') return;
+    if (self->downloadState_.load() != static_cast<uint8_t>(ModemDownloadState::PENDING)) return;
+    const size_t n = len < sizeof(self->downloadLine_) - 1 ? len : sizeof(self->downloadLine_) - 1;
+    memcpy(self->downloadLine_, line, n);
+    self->downloadLine_[n] = '\0';
+    self->downloadState_.store(static_cast<uint8_t>(ModemDownloadState::DONE));
+}
+
+bool CatMGNSSModule::startFileDownload(const char* url, const char* path) {
+    if (!isInitialized || !url || !path) return false;
+    if (downloadState_.load() == static_cast<uint8_t>(ModemDownloadState::PENDING)) return true;
+
+    char cmd[192];
+    const int n = snprintf(cmd, sizeof(cmd), "AT+HTTPTOFS=\"%s\",\"%s\"", url, path);
+    if (n <= 0 || (size_t)n >= sizeof(cmd)) return false;
+    // Armed before the command so a quick +HTTPTOFS isn't dropped
+    downloadState_.store(static_cast<uint8_t>(ModemDownloadState::PENDING));
+    char response[64];
+    if (!sendATCommand(cmd, response, sizeof(response), 5000) || strstr(response, AT_ERROR)) {
+        downloadState_.store(static_cast<uint8_t>(ModemDownloadState::IDLE));
+        lastError_ = "AT+HTTPTOFS failed";
         return false;
     }
-    
+    downloadStartedMs_ = millis();
+    Serial.printf("CatM+GNSS: Downloading %s to %s\n", url, path);
+    return true;
+}
+
+ModemDownloadState CatMGNSSModule::pollFileDownload(int& httpStatus, uint32_t& bytes) {
+    httpStatus = 0;
+    bytes = 0;
+    ModemDownloadState state = static_cast<ModemDownloadState>(downloadState_.load());
+    if (state == ModemDownloadState::PENDING) {
+        pollLinkUrcs();
+        state = static_cast<ModemDownloadState>(downloadState_.load());
+        if (state == ModemDownloadState::PENDING) {
+            if (millis() - downloadStartedMs_ < CATM_FILE_DOWNLOAD_TIMEOUT_MS) return state;
+            downloadState_.store(static_cast<uint8_t>(ModemDownloadState::IDLE));
+            lastError_ = "File download timeout - no +HTTPTOFS response received";
+            Serial.printf("CatM+GNSS: ERROR - %s\n", lastError_.c_str());
+            return ModemDownloadState::FAILED;
+        }
+    }
+    if (state != ModemDownloadState::DONE) return state;
+
+    char response[sizeof(downloadLine_)];
+    memcpy(response, downloadLine_, sizeof(response));
+    downloadState_.store(static_cast<uint8_t>(ModemDownloadState::IDLE));
+    Serial.printf("CatM+GNSS: <<< %s\n", response);
+    unsigned long len = 0;
+    if (sscanf(response + 10, "%d,%lu", &httpStatus, &len) < 1) return ModemDownloadState::FAILED;
+    bytes = (uint32_t)len;
+    return ModemDownloadState::DONE;
+}
+
+bool CatMGNSSModule::getCatmBands(char* out, size_t size) {
+    if (!isInitialized || !network_) return false;
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) return false;
+    return network_->getBands("CAT-M", out, size);
+}
+
+bool CatMGNSSModule::setCatmBands(const char* bands) {
+    if (!isInitialized || !network_) return false;
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) return false;
+    Serial.printf("CatM+GNSS: >>> AT+CBANDCFG=\"CAT-M\",%s\n", bands);
+    return network_->setBands("CAT-M", bands);
+}
+
+ModemScanResult CatMGNSSModule::scanOperators(sim7080g::OperatorInfo* out, size_t max, size_t& count,
+                                              uint32_t timeoutMs, sim7080g::AbortCheck abort, void* ctx) {
+    count = 0;
+    if (!isInitialized || !network_) return ModemScanResult::FAILED;
+    MutexGuard guard(serialMutex);
+    if (!guard.acquired()) return ModemScanResult::FAILED;
+    Serial.println("CatM+GNSS: >>> AT+COPS=?");
+    const M5_SIM7080G::Status st = network_->scanOperators(out, max, count, timeoutMs, abort, ctx);
+    if (st == M5_SIM7080G::Status::Aborted) return ModemScanResult::ABORTED;
+    if (st != M5_SIM7080G::Status::Ok) {
+        lastError_ = "AT+COPS=? failed";
+        return ModemScanResult::FAILED;
+    }
+    return ModemScanResult::DONE;
+}
+
+bool CatMGNSSModule::parseCntpResult(char* response, struct tm& utcOut) {
     // Parse +CNTP: <result>,"<time>"
     // Expected format: +CNTP: 1,"2025/10/08,14:23:45"
     char* colonPos = strchr(response, ':');
@@ -2272,7 +2706,7 @@ void CatMGNSSModule::taskFunction(void* pvParameters) {
             module->printStatus();
             CellularData cd = module->getCellularData();
             GNSSData gd = module->getGNSSData();
-            logbuf_printf("CELL %s RSSI=%d op=%s | GNSS %s sats=%u",
+            LOGF("CELL %s RSSI=%d op=%s | GNSS %s sats=%u",
                        cd.isConnected ? "UP" : "DOWN", (int)cd.signalStrength, cd.operatorName.c_str(),
                        gd.isValid ? "FIX" : "NOFIX", (unsigned)gd.satellites);
             lastStatusTime = millis();
@@ -5,24 +5,32 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
-#include <ArduinoJson.h>
 #include <time.h>
-#include "cell_status.h"
-#include "gnss_status.h"
+#include <atomic>
 #include <M5_SIM7080G.h>
+#include "modem_command_queue.h"
+#include "power_session.h"
+#include "attach_cache.h"
+#include "system/seqlock.h"
+#include "system/mutex_profiler.h"
+#include "system/json_writer.h"
+
+struct CellStatus;   // cell_status.h
 
 class MutexGuard {
 public:
-    explicit MutexGuard(SemaphoreHandle_t mutex, TickType_t timeout = pdMS_TO_TICKS(3000))
+    // file/line default to the caller's, so each guard is its own call site in the mutex profile
+    explicit MutexGuard(SemaphoreHandle_t mutex, TickType_t timeout = pdMS_TO_TICKS(3000),
+                        const char* file = __builtin_FILE(), int line = __builtin_LINE())
         : mutex_(mutex), acquired_(false) {
         if (mutex_) {
-            acquired_ = (xSemaphoreTake(mutex_, timeout) == pdTRUE);
+            acquired_ = mutex_take(mutex_, timeout, file, line);
         }
     }
 
     ~MutexGuard() {
         if (acquired_ && mutex_) {
-            xSemaphoreGive(mutex_);
+            mutex_give(mutex_);
         }
     }
 
@@ -105,6 +113,28 @@ struct CellularData {
     uint32_t rxBps;
 };
 
+// CellularData without String members, published for lock-free readers.
+// Text is truncated to the field sizes.
+struct CellularSnapshot {
+    bool isConnected;
+    bool isRegistered;
+    bool isValid;
+    bool hasIpAddress;
+    int8_t signalStrength;
+    uint8_t registrationState;
+    uint32_t lastUpdate;
+    uint32_t errorCount;
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t txBps;
+    uint32_t rxBps;
+    char operatorName[24];
+    char imei[20];
+    char ipAddress[40];
+    char apn[32];
+    char lastDetachReason[48];
+};
+
 // ============================================================================
 // M5UNIT-CATM+GNSS PIN CONFIGURATION (Grove Port C on StamPLC)
 // ============================================================================
@@ -130,6 +160,56 @@ struct CellularData {
 #define CATM_GNSS_ENABLE_PORTA_PROBE 0
 #endif
 
+// Link state comes from +CEREG and +APP PDP URCs; AT queries only confirm it
+// this often (or right after a URC reports a change)
+#ifndef CATM_LINK_VERIFY_MS
+#define CATM_LINK_VERIFY_MS 60000
+#endif
+#ifndef CATM_LINK_DOWN_VERIFY_MS
+#define CATM_LINK_DOWN_VERIFY_MS 5000
+#endif
+// Signal is sampled at the fast interval while it moves, backing off to the
+// slow one while it holds steady
+#ifndef CATM_SIGNAL_MIN_MS
+#define CATM_SIGNAL_MIN_MS 15000
+#endif
+#ifndef CATM_SIGNAL_MAX_MS
+#define CATM_SIGNAL_MAX_MS 120000
+#endif
+// AT+CNTPSTART answers with +CNTP once the NTP exchange is over
+#ifndef CATM_CNTP_TIMEOUT_MS
+#define CATM_CNTP_TIMEOUT_MS 65000
+#endif
+// AT+HTTPTOFS answers with +HTTPTOFS once the file is in the modem file system
+#ifndef CATM_FILE_DOWNLOAD_TIMEOUT_MS
+#define CATM_FILE_DOWNLOAD_TIMEOUT_MS 120000
+#endif
+
+// Modem-side HTTP body buffer; bounds one POST, streamed or not
+#ifndef CATM_HTTP_BODY_LEN
+#define CATM_HTTP_BODY_LEN SIM7080G_HTTP_MAX_BODY
+#endif
+// QoS1 MQTT publishes in flight before a publish waits for a PUBACK (1 = one at a time)
+#ifndef CATM_MQTT_WINDOW
+#define CATM_MQTT_WINDOW 4
+#endif
+#ifndef CATM_MQTT_ACK_TIMEOUT_MS
+#define CATM_MQTT_ACK_TIMEOUT_MS 15000
+#endif
+
+enum class NetworkTimeSyncState : uint8_t { IDLE = 0, PENDING, DONE, FAILED };
+enum class ModemDownloadState : uint8_t { IDLE = 0, PENDING, DONE, FAILED };
+enum class ModemScanResult : uint8_t { DONE = 0, ABORTED, FAILED };
+
+struct LinkCacheStats {
+    uint32_t cacheHits;      // isNetworkConnected() answered without AT traffic
+    uint32_t verifies;       // ... confirmed by AT queries
+    uint32_t regUrcs;
+    uint32_t pdpUrcs;
+    uint32_t signalSamples;
+    uint32_t signalIntervalMs;
+};
+
 // ============================================================================
 // CATM+GNSS MODULE CLASS
 // ============================================================================
@@ -145,11 +225,17 @@ private:
     
     // FreeRTOS components
     SemaphoreHandle_t serialMutex;
+    ModemCommandQueue cmdQueue_;
+    CatMPowerSession powerSession_;
     
     // Module state
     CatMGNSSState state;
-    GNSSData gnssData;
+    GNSSData gnssData;                      // writer-side copy (serialMutex holder only)
+    SeqlockSnapshot<GNSSData> gnssSnapshot_; // published copy for lock-free readers
+    bool gnssStreaming_ = false;
+    uint32_t lastGnssStreamRearmMs_ = 0;
     CellularData cellularData;
+    SeqlockSnapshot<CellularSnapshot> cellSnapshot_;   // published by the CatM task
     bool isInitialized;
 
     String lastError_;
@@ -161,33 +247,68 @@ private:
     bool sendATCommand(const String& command, String& response, uint32_t timeout = 1000);
     bool sendATCommand(const char* command, char* response, size_t responseSize, uint32_t timeout = 1000);
     bool waitForResponse(String& response, uint32_t timeout = 1000);
+    // Back-to-back command batch; true when every required item succeeded
+    bool runATBatch(sim7080g::AtBatchItem* items, size_t count);
     bool waitForResponse(char* response, size_t responseSize, uint32_t timeout = 1000);
     
     // Internal methods
+    void openUart(int rx, int tx);
     bool powerOnGNSS();
     bool powerOffGNSS();
     bool isGnssPowered(bool& powered);
-    bool parseGNSSData(const String& data);
     bool parseGNSSData(const char* data);
+    // +CGNSINF reply into out, parsed in place; parseGNSSData stamps and publishes it
+    static bool parseCgnsinf(const char* data, GNSSData& out);
+    static bool parseHttpUrl(const String& url, SIM7080G_String& baseOut, SIM7080G_String& pathOut);
+    // Points the modem's HTTP stack at baseUrl unless it already is; serialMutex held
+    bool httpUseBase(const SIM7080G_String& baseUrl);
     void updateState();
     // PDP attach helpers
     bool configureAPN();
     bool activatePDP(uint32_t timeoutMs);
     bool ensureRegistered(uint32_t maxWaitMs);
     bool applyBaselineConfig();
+    // Fast reconnect: what is still up, the shared tail of every attach path
+    // and the cache update after one
+    struct AttachProbe {
+        bool simReady = false;
+        uint8_t regState = 0;
+        bool pdpActive = false;
+        String ip;
+    };
+    bool probeAttachState(AttachProbe& probe);
+    bool completeAttach();
+    void rememberAttach(uint8_t rat);
+    bool negotiateUartBaud();
 
     void updateRegistrationState(uint8_t state);
-    bool parseCNACTResponse(const String& resp, bool& anyActive, String& ipOut);
+    // URC-fed link cache
+    static void onRegistrationUrc(const char* line, size_t len, void* ctx);
+    static void onPdpUrc(const char* line, size_t len, void* ctx);
+    static void onCntpUrc(const char* line, size_t len, void* ctx);
+    static void onHttpToFsUrc(const char* line, size_t len, void* ctx);
+    bool parseCntpResult(char* response, struct tm& utcOut);
+    void pollLinkUrcs();
+    bool verifyLink();
+    static bool parseCNACTResponse(const String& resp, bool& anyActive, String& ipOut);
     void refreshDetachReason(const String& resp);
-    bool parseNetDevStatus(const String& resp, uint64_t& txBytes, uint64_t& rxBytes, uint32_t& txBps, uint32_t& rxBps);
+    static bool parseNetDevStatus(const String& resp, uint64_t& txBytes, uint64_t& rxBytes, uint32_t& txBps, uint32_t& rxBps);
     bool updateNetworkStats();
     void resetNetworkStats();
-    bool parseGnssUtc(const SIM7080G_String& utc);
+    static bool parseGnssUtc(const char* utc, GNSSData& out);
+    void publishGnss() { gnssSnapshot_.write(gnssData); }
+    void applyFix(const sim7080g::GNSSFix& fix, const char* utc);
+    static void copyFix(const sim7080g::GNSSFix& fix, const char* utc, GNSSData& out);
+    static void onStreamedFix(const sim7080g::GNSSFix& fix, const char* utc, void* ctx);
+    bool startGnssStreaming();
+
+    friend class ParserBench;    // system/parser_bench.cpp times the static parsers
 
 public:
     const String& getLastError() const { return lastError_; }
     int getLastProbeRxPin() const { return lastProbeRx_; }
     int getLastProbeTxPin() const { return lastProbeTx_; }
+    uint32_t getUartBaud() const { return modem_ ? modem_->baudRate() : 0; }
 
     CatMGNSSModule();
     ~CatMGNSSModule();
@@ -199,31 +320,86 @@ public:
     // GNSS functions
     bool enableGNSS();
     bool disableGNSS();
+    // Streaming mode: drains pending +UGNSINF reports without blocking cellular traffic;
+    // falls back to a polled AT+CGNSINF when reports stop. Returns true on a fresh valid fix.
     bool updateGNSSData();
+    // Lock-free copy of the latest fix (safe from any task)
     GNSSData getGNSSData();
+    bool isGnssStreaming() const { return gnssStreaming_; }
     bool hasValidFix();
+    // The modem fetches url into its own file system (AT+HTTPTOFS) over the
+    // data session; poll until DONE (httpStatus and bytes set) or FAILED
+    bool startFileDownload(const char* url, const char* path);
+    ModemDownloadState pollFileDownload(int& httpStatus, uint32_t& bytes);
+    bool isFileDownloadPending() const {
+        return downloadState_.load() == static_cast<uint8_t>(ModemDownloadState::PENDING);
+    }
     uint8_t getSatellites();
     
+    // Operator scan chunks (operator_scan.h). Run on the modem task and hold the
+    // port throughout: abort is polled while AT+COPS=? runs.
+    bool getCatmBands(char* out, size_t size);
+    bool setCatmBands(const char* bands);
+    ModemScanResult scanOperators(sim7080g::OperatorInfo* out, size_t max, size_t& count, uint32_t timeoutMs,
+                                  sim7080g::AbortCheck abort, void* ctx);
+    
     // Cellular functions
     bool connectNetwork(const String& apn);
     bool connectNetwork(const String& apn, const String& user, const String& pass);
     bool disconnectNetwork();
+    // Answers from the URC-fed cache; AT queries only to confirm it now and then
     bool isNetworkConnected();
+    // Next isNetworkConnected() confirms with the modem (after a PSM wake, say)
+    void invalidateLinkCache() { linkVerifiedMs_ = 0; }
+    LinkCacheStats getLinkCacheStats() const;
     int8_t getSignalStrength();
+    // Cached RSSI, re-sampled on the adaptive schedule
+    int8_t pollSignalStrength(uint32_t now);
     String getOperatorName();
     String getIMEI();
     bool softReset();
     CellularData getCellularData();
     
+    // Asynchronous AT submission (completed on the modem I/O task)
+    bool submitATCommand(const char* command, uint32_t timeoutMs, ModemCmdPriority priority,
+                         ModemCmdCallback cb, void* ctx);
+    ModemCmdStats getCommandQueueStats() const { return cmdQueue_.getStats(); }
+
+    // PSM/eDRX session manager (inactive unless CATM_PSM_ENABLE)
+    CatMPowerSession& powerSession() { return powerSession_; }
+
+    // Wakeups for an event-driven caller. fn runs on the UART driver task whenever
+    // modem bytes arrive; false when the port has no receive signal.
+    bool setRxNotify(void (*fn)(void* ctx), void* ctx) { return modem_ && modem_->setRxNotify(fn, ctx); }
+    // Bytes no one is reading yet (false while another task holds the port: it dispatches them)
+    bool rxUnread();
+    // A link URC arrived since isNetworkConnected() last looked
+    bool linkEventPending() const { return linkEvents_.load() != linkEventsSeen_; }
+
     // Data transmission
     bool sendSMS(const String& number, const String& message);
     bool sendHTTP(const String& url, const String& data, String& response);
-    bool sendJSON(const String& url, JsonDocument& json, String& response);
+    // POST of len bytes from the caller's buffer; len = 0 is a GET
+    bool sendHTTP(const String& url, const char* data, size_t len, String& response);
+    // Binary-safe ranged GET into out: bytes read, short or 0 at the end, -1 on failure
+    int httpGetRange(const String& url, uint32_t offset, uint8_t* out, size_t len, int& httpStatus);
+    // POST of a finished JsonWriter's buffer; false if the writer failed
+    bool sendJSON(const String& url, const JsonWriter& json, String& response);
+    // POST of total bytes (at most CATM_HTTP_BODY_LEN) pulled from producer in chunks, e.g.
+    // from an SDFileReader; progress may be null
+    bool httpPostStream(const String& url, size_t total, SIM7080G_HTTP::BodyProducer producer, void* ctx,
+                        const char* contentType, SIM7080G_HTTP::ProgressCallback progress, void* progressCtx,
+                        String& response);
+
+    // Closes the kept-open HTTP session once it has been idle SIM7080G_HTTP_IDLE_MS
+    void httpPoll();
 
     // MQTT (new capability)
     bool mqttConfigure(const String& broker, uint16_t port, const String& clientId);
     bool mqttConnect(uint32_t timeoutMs = 15000);
     bool mqttPublish(const String& topic, const String& payload, int qos = 1, bool retain = false);
+    // Payload straight from the caller's buffer (e.g. a transport arena slot)
+    bool mqttPublish(const char* topic, const uint8_t* data, size_t len, int qos = 1, bool retain = false);
     bool mqttSubscribe(const String& topic, int qos = 1);
     void mqttPoll();
     void setMqttCallback(SIM7080G_MQTT::MessageCallback cb);
@@ -232,9 +408,15 @@ public:
     CatMGNSSState getState() { return state; }
     bool isModuleInitialized() { return isInitialized; }
     
-    // Enhanced DTO accessors
-    CellStatus getCellStatus();
-    GnssStatus getGnssStatus();
+    // Raw cellular state from the snapshot; text is formatted on demand (cell_status.h)
+    CellStatus getCellStatus() const;
+
+    // Lock-free, allocation-free copies for the UI and other readers
+    CellularSnapshot getCellularSnapshot() const { return cellSnapshot_.read(); }
+    uint32_t cellularVersion() const { return cellSnapshot_.version(); }
+    uint32_t gnssVersion() const { return gnssSnapshot_.version(); }
+    // Copies cellularData into the snapshot; CatM task only
+    void publishCellular();
 
     // Diagnostics
     bool testAT();
@@ -244,7 +426,15 @@ public:
     // Get network time from cellular module (returns true if successful, sets timeInfo)
     bool getNetworkTime(struct tm& timeInfo);
     bool configureNetworkTime();
-    bool syncNetworkTime(struct tm& utcOut, uint32_t timeoutMs = 65000);
+    // Blocks the caller (not the serial port) until +CNTP or the timeout
+    bool syncNetworkTime(struct tm& utcOut, uint32_t timeoutMs = CATM_CNTP_TIMEOUT_MS);
+    // Non-blocking form: start, then poll until DONE (utcOut set, as of
+    // esp_timer receivedMonoUs) or FAILED
+    bool startNetworkTimeSync();
+    NetworkTimeSyncState pollNetworkTimeSync(struct tm& utcOut, int64_t* receivedMonoUs = nullptr);
+    bool isNetworkTimeSyncPending() const {
+        return cntpState_.load() == static_cast<uint8_t>(NetworkTimeSyncState::PENDING);
+    }
     bool isNetworkTimeConfigured() const { return networkTimeConfigured_; }
     bool isNetworkTimeSynced() const { return networkTimeSynced_; }
     uint32_t getLastNetworkTimeSyncMs() const { return lastNetworkTimeSyncMs_; }
@@ -264,16 +454,38 @@ private:
     String apnUser_;
     String apnPass_;
 
-    // Cached throughput sampling
-    uint64_t lastTxBytesSample_ = 0;
-    uint64_t lastRxBytesSample_ = 0;
-    uint32_t lastStatsSampleMs_ = 0;
+    // data_usage cellular totals when the current PDP session started
+    uint64_t sessionTxBase_ = 0;
+    uint64_t sessionRxBase_ = 0;
+
+    // Link cache; the URC side is written by whichever task drains the UART
+    std::atomic<uint8_t> urcRegState_{0xFF};     // 0xFF = none yet
+    std::atomic<int8_t> urcPdp_{-1};             // -1 = none yet, 0 down, 1 up
+    std::atomic<uint32_t> linkEvents_{0};
+    std::atomic<uint32_t> regUrcs_{0};
+    std::atomic<uint32_t> pdpUrcs_{0};
+    uint32_t linkEventsSeen_ = 0;
+    uint32_t linkVerifiedMs_ = 0;
+    uint32_t linkCacheHits_ = 0;
+    uint32_t linkVerifies_ = 0;
+    uint32_t signalSampledMs_ = 0;
+    uint32_t signalIntervalMs_ = CATM_SIGNAL_MIN_MS;
+    uint32_t signalSamples_ = 0;
 
     // Network time state
     bool networkTimeConfigured_ = false;
     bool networkTimeSynced_ = false;
     uint32_t lastNetworkTimeSyncMs_ = 0;
     struct tm lastNetworkUtc_{};
+    std::atomic<uint8_t> cntpState_{0};          // NetworkTimeSyncState
+    char cntpLine_[64] = {};                     // +CNTP result, set with DONE
+    uint32_t cntpStartedMs_ = 0;
+    int64_t cntpReceivedUs_ = 0;                 // set before DONE
+
+    // AT+HTTPTOFS state, like the NTP one
+    std::atomic<uint8_t> downloadState_{0};      // ModemDownloadState
+    char downloadLine_[32] = {};                 // +HTTPTOFS result, set with DONE
+    uint32_t downloadStartedMs_ = 0;
 };
 
 #endif // CATM_GNSS_MODULE_H
@@ -1,17 +1,39 @@
 #include "catm_gnss_module.h"
 #include "../storage/storage_task.h"
-#include <ArduinoJson.h>
 #include <cstring>
 #include <climits>
 #include "config/task_config.h"
 #include "catm_gnss_task.h"
+#include "rf_arbiter.h"
+#include "track_reducer.h"
+#include "geofence.h"
+#include "gnss_assist.h"
+#include "operator_scan.h"
+#include "../../include/transport.h"
+#include "../transport/telemetry_codec.h"
+#include "../transport/report_cadence.h"
+#include "../transport/shared_attributes.h"
+#include "../transport/live_config.h"
+#include "../transport/data_usage.h"
+#include "../transport/ota_client.h"
+#include "../transport/remote_diag.h"
+#include "../transport/backfill.h"
 #include "../../include/debug_system.h"
 #include "../settings/settings_store.h"
 #include "../logging/log_buffer.h"
+#include "../logging/log_uplink.h"
+#include "../pwrcan/can_capture.h"
+#include "../../system/crash_dump.h"
+#include "../../system/reset_journal.h"
+#include "../../system/boot_profile.h"
+#include "../../system/metrics.h"
+#include "../../system/energy_account.h"
+#include "../../system/time_service.h"
+#include "../../system/json_writer.h"
+#include "../../system/event_bus.h"
+#include "../../system/load_shed.h"
 
 extern EventGroupHandle_t xEventGroupSystemStatus;
-extern QueueHandle_t g_storageQ;
-extern volatile bool g_cellularUp;
 
 // Function to trigger immediate GNSS update
 void requestGNSSUpdate() {
@@ -21,14 +43,160 @@ void requestGNSSUpdate() {
 }
 
 
-static void pushStorageRecord(const LogRecord& rec) {
-    if (!g_storageQ) return;
-    static uint32_t s_storageDrops = 0;
-    if (xQueueSend(g_storageQ, &rec, pdMS_TO_TICKS(50)) != pdTRUE) {
-        if ((++s_storageDrops % 8) == 1) {
-            LOG_WARN("Storage queue full - dropping records");
+static uint32_t s_storageDrops = 0;
+static RfArbiter s_rfArbiter;
+static CatmWakeStats s_wake = {};
+static MetricCounter s_metricWakes("catm.wakes", [] { return s_wake.wakes; });
+
+static const char* const kWakeNames[(size_t)CatmWake::Count] = {
+    "gnss_req", "modem_rx", "uplink", "link", "attach", "gnss", "status", "service", "power", "scan", "idle",
+};
+
+const char* catm_wake_name(CatmWake reason) {
+    return reason < CatmWake::Count ? kWakeNames[(size_t)reason] : "?";
+}
+
+void catm_wake_stats(CatmWakeStats& out) {
+    out = s_wake;
+}
+
+const RfArbiter& catmRfArbiter() {
+    return s_rfArbiter;
+}
+
+void catm_task_report(Print& out) {
+    const CatmWakeStats w = s_wake;
+    const uint32_t upS = millis() / 1000;
+    out.printf("CatM task: %lu wakes (%lu/min), last %s after %lu ms (max %lu ms), rx signal %s\n",
+               (unsigned long)w.wakes, (unsigned long)(upS ? (uint64_t)w.wakes * 60 / upS : 0),
+               catm_wake_name(w.last), (unsigned long)w.lastSleepMs, (unsigned long)w.maxSleepMs,
+               w.rxNotify ? "yes" : "no");
+    out.print(" ");
+    for (size_t i = 0; i < (size_t)CatmWake::Count; i++) {
+        out.printf(" %s %lu", kWakeNames[i], (unsigned long)w.byReason[i]);
+    }
+    out.println();
+}
+
+// UART driver and enqueuing tasks: wake the CatM task
+static void setWakeBit(EventBits_t bit) {
+    if (xEventGroupSystemStatus) {
+        xEventGroupSetBits(xEventGroupSystemStatus, bit);
+    }
+}
+
+// Earliest deadline for the next sleep and what it stands for
+struct WakePlan {
+    uint32_t now;
+    uint32_t at;
+    CatmWake reason;
+
+    explicit WakePlan(uint32_t t) : now(t), at(t + CATM_IDLE_WAKE_MS), reason(CatmWake::Idle) {}
+    void consider(uint32_t dueMs, CatmWake why) {
+        if ((int32_t)(dueMs - at) < 0) {
+            at = dueMs;
+            reason = why;
         }
     }
+    // One tick extra: a truncated wait would wake just before the deadline
+    TickType_t ticks() const {
+        const int32_t left = (int32_t)(at - now);
+        return left > 0 ? pdMS_TO_TICKS((uint32_t)left) + 1 : 0;
+    }
+};
+
+static void noteWake(CatmWake reason, uint32_t sleptMs) {
+    s_wake.wakes++;
+    s_wake.byReason[(size_t)reason]++;
+    s_wake.last = reason;
+    s_wake.lastSleepMs = sleptMs;
+    s_wake.sleptMs += sleptMs;
+    if (sleptMs > s_wake.maxSleepMs) s_wake.maxSleepMs = sleptMs;
+}
+
+#if GNSS_TRACK_REDUCE_ENABLE
+static TrackReducer s_track;
+static MetricCounter s_metricTrackKept("gnss.kept", [] { return s_track.stats().kept; });
+static MetricCounter s_metricTrackParked("gnss.skipped_parked", [] { return s_track.stats().skippedStationary; });
+static MetricCounter s_metricTrackOnLine("gnss.skipped_line", [] { return s_track.stats().skippedOnLine; });
+#endif
+
+static void noteStorageDrop() {
+    if ((++s_storageDrops % 8) == 1) {
+        LOGT_WARN(CATM, "Storage queue full - dropping records");
+    }
+}
+
+// Records shed under storage pressure are counted there, not here
+static void pushStorageRecord(StorageStreamId stream, const char* line, size_t len,
+                              StoragePriority prio = StoragePriority::Normal) {
+    if (!storage_admit(stream, prio)) return;
+    if (!storage_push(stream, line, len, pdMS_TO_TICKS(5), prio)) noteStorageDrop();
+}
+
+// JSON records serialized in place into the storage message
+static void pushStorageRecord(StorageStreamId stream, StorageLine& line, const JsonWriter& json,
+                              StoragePriority prio = StoragePriority::Normal) {
+    if (!json.ok()) return;
+    if (!storage_push_line(stream, line, json.length(), pdMS_TO_TICKS(5), prio)) noteStorageDrop();
+}
+
+static void writeGnssRecord(JsonWriter& w, const GNSSData& data, uint32_t t) {
+    w.beginObject()
+        .field("t", t)
+        .field("lat", data.latitude, 7)
+        .field("lon", data.longitude, 7)
+        .field("alt", data.altitude, 1)
+        .field("spd", data.speed, 2)
+        .field("sat", data.satellites)
+        .field("valid", data.isValid)
+        .endObject();
+}
+
+// cell = nullptr is the detached record
+static void writeCellRecord(JsonWriter& w, const CellularData* cell, int8_t rssi, uint32_t t) {
+    w.beginObject().field("t", t);
+    if (cell) {
+        w.field("op", cell->operatorName.c_str())
+            .field("rssi", rssi)
+            .field("conn", true)
+            .field("tx_bps", cell->txBps)
+            .field("rx_bps", cell->rxBps)
+            .field("tx_bytes", static_cast<unsigned long long>(cell->txBytes))
+            .field("rx_bytes", static_cast<unsigned long long>(cell->rxBytes));
+    } else {
+        w.field("conn", false)
+            .field("tx_bps", 0)
+            .field("rx_bps", 0)
+            .field("tx_bytes", 0)
+            .field("rx_bytes", 0)
+            .field("detach", 0);
+    }
+    w.endObject();
+}
+
+// Shared-attribute pushes arrive on the ThingsBoard MQTT session
+static void onMqttMessage(const SIM7080G_String& topic, const SIM7080G_String& payload) {
+    data_usage_rx(TransportPathId::Mqtt, topic.length() + payload.length() + DATA_USAGE_MQTT_OVERHEAD);
+    if (strncmp(topic.c_str(), "v1/devices/me/attributes", 24) == 0 &&
+        g_sharedAttributes.apply(payload.c_str(), payload.length())) {
+        g_sharedAttributes.markFetched(millis(), true);
+    } else {
+        remote_diag_request(topic.c_str(), payload.c_str(), payload.length());
+    }
+}
+
+static void fetchSharedAttributes(CatMGNSSModule* module, uint32_t now) {
+    static char url[448];          // CatM task only
+    bool ok = transport_thingsboardUrl(TransportPacketKind::Attributes, url, sizeof(url)) &&
+              strlcat(url, "?sharedKeys=" SHARED_ATTR_KEYS, sizeof(url)) < sizeof(url) &&
+              live_config_append_keys(url, sizeof(url));
+    if (ok) {
+        String response;
+        ok = module->sendHTTP(String(url), String(), response) &&
+             g_sharedAttributes.apply(response.c_str(), response.length());
+    }
+    g_sharedAttributes.markFetched(now, ok);
 }
 
 
@@ -41,7 +209,7 @@ void vTaskCatMGNSS(void* pvParameters) {
 
     if (!module) {
 
-        LOG_ERROR("Invalid module pointer");
+        LOGT_ERROR(CATM, "Invalid module pointer");
 
         vTaskDelete(NULL);
 
@@ -51,7 +219,7 @@ void vTaskCatMGNSS(void* pvParameters) {
 
 
 
-    LOG_INFO("CATM_GNSS_TASK starting...");
+    LOGT_INFO(CATM, "CATM_GNSS_TASK starting...");
 
 
 
@@ -69,11 +237,13 @@ void vTaskCatMGNSS(void* pvParameters) {
 
 
 
-    // Load settings for APN credentials (refresh periodically to pick up changes)
+    // APN credentials from the cached settings; re-applied when their version moves
 
     AppSettings settings{};
 
-    bool haveSettings = settingsLoad(settings);
+    g_settings.get(settings);
+    uint32_t settingsVersion = g_settings.version();
+    bool haveSettings = settingsVersion != 0;
 
     if (haveSettings) {
         module->setApnCredentials(String(settings.apn), String(settings.apnUser), String(settings.apnPass));
@@ -91,17 +261,93 @@ void vTaskCatMGNSS(void* pvParameters) {
 
     uint32_t lastConnectAttempt = 0;
 
-    uint32_t lastSettingsRefresh = millis();
-
-    uint32_t lastLinkCheck = 0;
-
     bool lastLinkState = false;
+    bool linkPublished = false;      // last CellularLink state on the event bus
 
-    const uint32_t kLinkPollIntervalMs = 2000;
+    const uint32_t kAttachRetryMs = 15000;
     uint8_t consecutiveAttachFailures = 0;
     uint32_t lastSoftResetMs = 0;
     const uint8_t kMaxAttachFailuresBeforeReset = 3;
     const uint32_t kSoftResetCooldownMs = 120000;
+    uint32_t lastPowerWakes = 0;
+#if TELEMETRY_BINARY_ENABLE
+    int8_t lastRssiDbm = -100;
+    static TelemetryEncoder s_telemetry;
+    // GNSS uplink fields the cadence watches (telemetry_codec fixed-point units)
+    enum : uint8_t { kCadenceLat = 0, kCadenceLon, kCadenceSpeed, kCadenceValid };
+    static ReportCadence s_cadence(DATA_TRANSMISSION_INTERVAL_MS);
+    s_cadence.setDeadband(kCadenceLat, 2000);      // 1e-7 deg, ~20 m
+    s_cadence.setDeadband(kCadenceLon, 2000);
+    s_cadence.setDeadband(kCadenceSpeed, 50);      // 0.1 km/h
+    s_cadence.setDeadband(kCadenceValid, 0);
+    g_sharedAttributes.addListener(SHARED_ATTR_REPORT_PERIOD, [](const SharedAttributes& attrs, uint32_t, void* ctx) {
+        static_cast<ReportCadence*>(ctx)->setBaseInterval(attrs.reportPeriodS ? attrs.reportPeriodS * 1000UL
+                                                                              : DATA_TRANSMISSION_INTERVAL_MS);
+    }, &s_cadence);
+    uint32_t lastTelemetryLosses = 0;
+#endif
+    g_sharedAttributes.addListener(SHARED_ATTR_LOG_LEVELS, [](const SharedAttributes& attrs, uint32_t, void*) {
+        if (attrs.logLevels[0]) {
+            logbuf_printf("log: %d tag levels set from server", log_tag_apply(attrs.logLevels));
+        }
+    }, nullptr);
+    // Deleting the attribute turns the stream off again
+    g_sharedAttributes.addListener(SHARED_ATTR_LOG_UPLINK, [](const SharedAttributes& attrs, uint32_t, void*) {
+        if (!log_uplink_configure(attrs.logUplink)) {
+            logbuf_printf("log: uplink filter '%s' not understood", attrs.logUplink);
+        }
+    }, nullptr);
+#if CAN_CAPTURE_ENABLE
+    // Deleting the attribute stops the capture
+    g_sharedAttributes.addListener(SHARED_ATTR_CAN_CAPTURE, [](const SharedAttributes& attrs, uint32_t, void*) {
+        if (!can_capture_configure(attrs.canCapture)) {
+            logbuf_printf("can capture: '%s' not started", attrs.canCapture);
+        }
+    }, nullptr);
+#endif
+    // Arbiter policy; the arbiter is only touched from this task
+    backfill_begin();
+    live_config_register("gnss_refresh_s", LiveConfigType::Int, 10, 3600,
+                         [](const LiveConfigValue& v, void*) -> bool {
+        s_rfArbiter.setFixRefreshMs(v.present ? (uint32_t)v.number * 1000UL : 0);
+        return true;
+    }, nullptr);
+    live_config_register("uplink_defer_s", LiveConfigType::Int, 5, 600,
+                         [](const LiveConfigValue& v, void*) -> bool {
+        s_rfArbiter.setUplinkMaxDeferMs(v.present ? (uint32_t)v.number * 1000UL : 0);
+        return true;
+    }, nullptr);
+    // Journaled like an APN set on the device and used from the next attach; deleting the
+    // attribute keeps it
+    live_config_register("apn", LiveConfigType::String, 1, sizeof(AppSettings::apn) - 1,
+                         [](const LiveConfigValue& v, void*) -> bool {
+        if (!v.present) return true;
+        AppSettings next;
+        g_settings.get(next);
+        if (strcmp(next.apn, v.text) == 0) return true;
+        strlcpy(next.apn, v.text, sizeof(next.apn));
+        return g_settings.update(next);
+    }, nullptr);
+    geofence_begin();
+    operator_scan_begin(module);
+    ota_client_begin();
+    module->setMqttCallback(onMqttMessage);
+
+    // Besides its deadlines the loop wakes for modem bytes and for freshly queued records
+    const bool rxNotify = module->setRxNotify([](void*) { setWakeBit(EVENT_BIT_MODEM_RX); }, nullptr);
+    s_wake.rxNotify = rxNotify;
+    transport_setQueuedNotify([](void*) { setWakeBit(EVENT_BIT_UPLINK_QUEUED); }, nullptr);
+    const EventBits_t kWakeBits = EVENT_BIT_GNSS_UPDATE_REQ | EVENT_BIT_ERROR_DETECTED | EVENT_BIT_MODEM_RX |
+                                  EVENT_BIT_UPLINK_QUEUED;
+
+    // Deadlines, millis(); due from the start
+    uint32_t linkDueMs = millis();
+    uint32_t gnssDueMs = linkDueMs;
+    uint32_t statusDueMs = linkDueMs;
+    uint32_t serviceDueMs = linkDueMs;
+    uint32_t lastFixMs = 0;          // lastUpdate of the last fix processed
+    uint32_t gnssSeenMs = 0;         // ... and of the last report seen, valid or not
+    bool forceLinkCheck = true;
 
 
 
@@ -115,13 +361,45 @@ void vTaskCatMGNSS(void* pvParameters) {
 
         }
 
-        EventBits_t bits = xEventGroupWaitBits(
-            xEventGroupSystemStatus,
-            EVENT_BIT_GNSS_UPDATE_REQ | EVENT_BIT_ERROR_DETECTED,
-            pdTRUE,
-            pdFALSE,
-            pdMS_TO_TICKS(1000)
-        );
+        // Our own AT traffic sets the RX bit too: keep it only for bytes nobody has read yet,
+        // or for what another task's commands dispatched for us meanwhile
+        if (rxNotify) {
+            xEventGroupClearBits(xEventGroupSystemStatus, EVENT_BIT_MODEM_RX);
+            if (module->rxUnread() || module->linkEventPending() ||
+                (gnssEnabled && module->getGNSSData().lastUpdate != gnssSeenMs)) {
+                setWakeBit(EVENT_BIT_MODEM_RX);
+            }
+        }
+
+        // Sleep until the earliest deadline this state has, unless an event comes first
+        CatMPowerSession& power = module->powerSession();
+        WakePlan plan(millis());
+        if (power.state() == PowerSessionState::SLEEPING) {
+            plan.consider(power.nextWindowMs(), CatmWake::Power);
+        } else {
+            if (power.state() == PowerSessionState::AWAKE) plan.consider(power.lingerEndsMs(), CatmWake::Power);
+            plan.consider(linkDueMs, CatmWake::Link);
+            plan.consider(statusDueMs, CatmWake::Status);
+            if (!lastLinkState && haveSettings) plan.consider(lastConnectAttempt + kAttachRetryMs + 1, CatmWake::Attach);
+            if (lastLinkState) plan.consider(serviceDueMs, CatmWake::Service);
+            if (gnssEnabled) plan.consider(gnssDueMs, CatmWake::Gnss);
+            if (s_rfArbiter.slot() == RfSlot::SCAN) plan.consider(plan.now + CATM_SERVICE_BUSY_MS, CatmWake::Scan);
+        }
+
+        EventBits_t bits = xEventGroupWaitBits(xEventGroupSystemStatus, kWakeBits, pdTRUE, pdFALSE, plan.ticks());
+        const uint32_t now = millis();
+        CatmWake reason = plan.reason;
+        if (bits & EVENT_BIT_GNSS_UPDATE_REQ) {
+            reason = CatmWake::GnssRequest;
+        } else if (bits & EVENT_BIT_MODEM_RX) {
+            reason = CatmWake::ModemRx;
+        } else if (bits & EVENT_BIT_UPLINK_QUEUED) {
+            reason = CatmWake::UplinkQueued;
+        }
+        noteWake(reason, now - plan.now);
+        const bool rxWake = (bits & EVENT_BIT_MODEM_RX) != 0;
+        const bool uplinkWake = (bits & EVENT_BIT_UPLINK_QUEUED) != 0;
+        auto due = [now](uint32_t at) { return (int32_t)(now - at) >= 0; };
 
 
 
@@ -145,40 +423,108 @@ void vTaskCatMGNSS(void* pvParameters) {
 
 
 
-        const uint32_t now = millis();
+        if (g_settings.version() != settingsVersion) {
 
+            settingsVersion = g_settings.version();
 
-
-        if (now - lastSettingsRefresh > 60000) {
-
-            lastSettingsRefresh = now;
-
-            if (settingsLoad(settings)) {
-                haveSettings = true;
-                if (settings.apn[0] == '\0') {
+            AppSettings latest;
+            g_settings.get(latest);
+            if (strcmp(latest.apn, settings.apn) != 0 || strcmp(latest.apnUser, settings.apnUser) != 0 ||
+                strcmp(latest.apnPass, settings.apnPass) != 0) {
+                if (latest.apn[0] == '\0') {
                     module->setApnCredentials(String("soracom.io"), String(), String());
                 } else {
-                    module->setApnCredentials(String(settings.apn), String(settings.apnUser), String(settings.apnPass));
+                    module->setApnCredentials(String(latest.apn), String(latest.apnUser), String(latest.apnPass));
                 }
+                LOGT_INFO(CATM, "APN changed; used from the next attach");
             }
+            settings = latest;
+            haveSettings = true;
 
         }
 
 
 
-        bool wasConnected = g_cellularUp;
+        // Power saving: while the modem sleeps in PSM nothing below may touch the UART
+        if (power.enabled()) {
+            const PowerAction action = power.step(now, transport_pendingBytes(), lastLinkState);
+            if (action != PowerAction::RUN) {
+                energy_state(EnergyModem::Psm);
+            }
+            if (action == PowerAction::SKIP) {
+                continue;
+            }
+            if (action == PowerAction::SLEEP) {
+                if (gnssEnabled && module->disableGNSS()) {
+                    gnssEnabled = false;
+                }
+                continue;
+            }
+            if (power.getStats().wakes != lastPowerWakes) {
+                lastPowerWakes = power.getStats().wakes;
+                forceLinkCheck = true;  // confirm the resumed link right away
+                module->invalidateLinkCache();
+            }
+        }
+
+        bool wasConnected = linkPublished;
 
         bool isConnected = lastLinkState;
 
-        if (lastLinkCheck == 0 || (now - lastLinkCheck) >= kLinkPollIntervalMs) {
+        // Link URCs arrive as modem bytes; between them the cache only needs its verify interval
+        if (forceLinkCheck || rxWake || due(linkDueMs)) {
 
-            lastLinkCheck = now;
+            forceLinkCheck = false;
 
             lastLinkState = module->isNetworkConnected();
 
+            linkDueMs = now + (lastLinkState ? CATM_LINK_VERIFY_MS : CATM_LINK_DOWN_VERIFY_MS);
+
         }
 
         isConnected = lastLinkState;
+        energy_state(isConnected ? EnergyModem::Attached : EnergyModem::Searching);
+
+        // RF arbitration: GNSS and the data session share the SIM7080G radio path
+        const bool attachDue = !isConnected && haveSettings && settings.apn[0] != '\0' &&
+                               (now - lastConnectAttempt > kAttachRetryMs);
+        RfArbiterInputs rfIn{};
+        rfIn.pendingUplinkBytes = transport_pendingBytes(&rfIn.oldestUplinkAgeMs);
+        rfIn.uplinkSent = transport_getStats().sent;
+        rfIn.attachNeeded = attachDue;
+        GNSSData lastFix = module->getGNSSData();
+        rfIn.fixValid = lastFix.isValid;
+        rfIn.lastFixMs = lastFix.lastUpdate;
+        rfIn.refreshScale = load_shed_active(ShedStep::Gnss) ? LOAD_SHED_GNSS_SLOWDOWN : 1;
+        rfIn.scanWanted = operator_scan_wanted(now) && !gnss_assist_busy();
+        const RfSlot rfSlot = s_rfArbiter.decide(rfIn, now);
+
+        // An assistance download in flight still holds the radio
+        if (rfSlot == RfSlot::GNSS && !gnssEnabled && !gnss_assist_busy()) {
+            if (module->enableGNSS()) {
+                gnssEnabled = true;
+            } else {
+                Serial.println("[CATM_GNSS_TASK] Failed to enable GNSS for GNSS slot");
+            }
+        } else if (rfSlot == RfSlot::DATA && gnssEnabled) {
+            Serial.println("[CATM_GNSS_TASK] Releasing GNSS for data slot");
+            if (module->disableGNSS()) {
+                gnssEnabled = false;
+                lastGnssPausedLog = now;
+            }
+        } else if (rfSlot == RfSlot::SCAN) {
+            if (gnssEnabled && module->disableGNSS()) {
+                gnssEnabled = false;
+            }
+            // Uplink data or a GNSS request ends the chunk; the band is scanned again later
+            if (!gnssEnabled) {
+                operator_scan_poll(module, now, [](void*) -> bool {
+                    return (xEventGroupGetBits(xEventGroupSystemStatus) &
+                            (EVENT_BIT_UPLINK_QUEUED | EVENT_BIT_GNSS_UPDATE_REQ)) != 0 ||
+                           transport_pendingBytes() > 0;
+                }, nullptr);
+            }
+        }
 
 
 
@@ -192,55 +538,32 @@ void vTaskCatMGNSS(void* pvParameters) {
 
 
 
-            if (now - lastConnectAttempt > 15000) {
+            // An attach is a data session: it waits for the arbiter to grant the radio
+            if (now - lastConnectAttempt > kAttachRetryMs && (!attachDue || rfSlot == RfSlot::DATA)) {
 
                 lastConnectAttempt = now;
-                bool attemptedAttach = false;
                 bool attachSucceeded = false;
 
                 if (haveSettings && settings.apn[0] != '\0') {
 
-                    attemptedAttach = true;
                     Serial.println("[CATM_GNSS_TASK] Attempting network attach with stored APN");
 
-                    if (g_storageQ) {
-
-                        LogRecord rec{};
+                    if (storage_ready()) {
 
-                        rec.type = LogRecord::CELL;
+                        char line[96];
 
-                        snprintf(rec.line, sizeof(rec.line), "Attempting attach APN=%s", settings.apn);
+                        const int n = snprintf(line, sizeof(line), "Attempting attach APN=%s", settings.apn);
 
-                        pushStorageRecord(rec);
+                        pushStorageRecord(StorageStreamId::Cell, line, n > 0 ? min((size_t)n, sizeof(line) - 1) : 0);
 
                     }
 
-                    bool gnssWasEnabled = gnssEnabled;
-                    if (gnssWasEnabled) {
-                        Serial.println("[CATM_GNSS_TASK] Disabling GNSS before network attach");
-                        if (module->disableGNSS()) {
-                            gnssEnabled = false;
-                            lastGnssPausedLog = now;
-                        }
-                    }
-
                     attachSucceeded = module->connectNetwork(String(settings.apn), String(settings.apnUser), String(settings.apnPass));
 
-                    if (!gnssEnabled) {
-                        if (module->enableGNSS()) {
-                            gnssEnabled = true;
-                            Serial.println("[CATM_GNSS_TASK] GNSS resumed after attach attempt");
-                        } else {
-                            Serial.println("[CATM_GNSS_TASK] Failed to re-enable GNSS after attach attempt");
-                        }
-                    } else if (gnssWasEnabled) {
-                        lastGnssPausedLog = now;
-                    }
-
                     isConnected = attachSucceeded;
                     lastLinkState = attachSucceeded;
                     if (attachSucceeded) {
-                        lastLinkCheck = now;
+                        linkDueMs = now + CATM_LINK_VERIFY_MS;
                         consecutiveAttachFailures = 0;
                     } else if (consecutiveAttachFailures < kMaxAttachFailuresBeforeReset) {
                         consecutiveAttachFailures++;
@@ -248,7 +571,7 @@ void vTaskCatMGNSS(void* pvParameters) {
 
                     if (!attachSucceeded) {
 
-                        LOG_WARN("APN attach failed: %s", settings.apn);
+                        LOGT_WARN(CATM, "APN attach failed: %s", settings.apn);
 
                         log_add("ERROR: CatM APN attach failed");
                         const char* modemError = module->getLastError().c_str();
@@ -262,7 +585,8 @@ void vTaskCatMGNSS(void* pvParameters) {
                             if (module->softReset()) {
                                 lastSoftResetMs = millis();
                                 consecutiveAttachFailures = 0;
-                                lastLinkCheck = 0;
+                                forceLinkCheck = true;
+                                module->invalidateLinkCache();
                             } else {
                                 Serial.println("[CATM_GNSS_TASK] Modem soft reset failed");
                                 lastSoftResetMs = millis();
@@ -273,13 +597,16 @@ void vTaskCatMGNSS(void* pvParameters) {
 
                         if (xEventGroupSystemStatus) {
 
-                            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_CELLULAR_READY | EVENT_BIT_STATUS_CHANGE);
+                            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_CELLULAR_READY);
 
                         }
 
                         log_add("BOOT: CatM network attached");
 
                         Serial.println("[CATM_GNSS_TASK] Cellular attach succeeded");
+                        if (module->powerSession().enabled()) {
+                            module->powerSession().negotiate();
+                        }
                     }
 
                 } else {
@@ -288,105 +615,142 @@ void vTaskCatMGNSS(void* pvParameters) {
 
                 }
 
-                if (!attemptedAttach && !gnssEnabled) {
-                    if (module->enableGNSS()) {
-                        gnssEnabled = true;
-                        Serial.println("[CATM_GNSS_TASK] GNSS enabled (no cellular attach attempted)");
-                    }
-                }
             }
 
         }
 
 
 
-        if (isConnected && !gnssEnabled) {
-
-            Serial.println("[CATM_GNSS_TASK] Enabling GNSS after confirming cellular link");
-
-            if (module->enableGNSS()) {
-
-                gnssEnabled = true;
-
-                Serial.println("[CATM_GNSS_TASK] GNSS enabled successfully");
+        if (isConnected && xEventGroupSystemStatus) {
 
-            } else {
+            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_CELLULAR_READY);
 
-                Serial.println("[CATM_GNSS_TASK] Failed to enable GNSS");
+        }
 
+        // Flushes records the transport is holding back for coalescing once their deadline passes;
+        // modem bytes may be an MQTT push, a queued record wants sending
+        if (isConnected && (rxWake || uplinkWake || due(serviceDueMs))) {
+            log_uplink_poll(now);
+            crash_dump_poll(now);
+            reset_journal_poll(now);
+            boot_profile_poll(now);
+            metrics_poll(now);
+            geofence_poll(now);
+            transport_process();
+            module->mqttPoll();
+            module->httpPoll();
+            transport_refreshDns();
+            remote_diag_poll(module, now);
+            backfill_poll(now);
+            if (g_sharedAttributes.refreshDue(now)) {
+                fetchSharedAttributes(module, now);
             }
-
+            ota_client_poll(module, now);
+            serviceDueMs = now + (transport_pendingBytes() || ota_client_active() ? CATM_SERVICE_BUSY_MS
+                                                                                 : CATM_SERVICE_IDLE_MS);
         }
 
-
-
-        if (isConnected && xEventGroupSystemStatus) {
-
-            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_CELLULAR_READY);
-
+        // XTRA downloads while the receiver is off; one in flight completes even if the link drops
+        if (!gnssEnabled) {
+            gnss_assist_poll(module, isConnected, now);
         }
 
 
 
-        if (gnssEnabled) {
+        if (gnssEnabled && (rxWake || (bits & EVENT_BIT_GNSS_UPDATE_REQ) || due(gnssDueMs))) {
 
-            if (module->updateGNSSData()) {
+            // Streamed reports come as modem bytes; the deadline only catches a stalled stream
+            const bool haveFix = module->updateGNSSData();
+            const uint32_t pollMs = load_shed_active(ShedStep::Gnss) ? GNSS_UPDATE_RATE_MS * LOAD_SHED_GNSS_SLOWDOWN
+                                                                      : GNSS_UPDATE_RATE_MS;
+            gnssDueMs = now + (rxNotify && module->isGnssStreaming() ? GNSS_STREAM_STALE_MS : pollMs);
+            GNSSData data = module->getGNSSData();
+            gnssSeenMs = data.lastUpdate;
+            const bool newFix = haveFix && data.lastUpdate != lastFixMs;
+            GnssEvent gnssEvent{};
+            gnssEvent.latE7 = (int32_t)(data.latitude * 1e7);
+            gnssEvent.lonE7 = (int32_t)(data.longitude * 1e7);
+            gnssEvent.satellites = data.satellites;
+            gnssEvent.fix = haveFix;
+            gnssEvent.newFix = newFix;
+            event_bus_publish<EventTopic::Gnss>(gnssEvent);
+            // A streamed fix stays fresh for a while; process each one once
+            if (newFix) {
 
-                GNSSData data = module->getGNSSData();
+                lastFixMs = data.lastUpdate;
 
                 Serial.printf("[CATM_GNSS_TASK] GNSS: Valid fix, Satellites: %d\n", data.satellites);
 
 
 
-                if (xEventGroupSystemStatus) {
-
-                    xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_GNSS_DATA_READY);
-
+                // Every fix, not only the kept points: a boundary can be crossed between them
+                geofence_fix(data.latitude, data.longitude, millis());
+                gnss_assist_fix(data.latitude, data.longitude, millis());
+
+                // The points the track needs, each stamped with its own fix time
+                TrackPoint kept[TrackReducer::kMaxOut];
+#if GNSS_TRACK_REDUCE_ENABLE
+                const size_t keptCount = s_track.push(data, millis(), kept);
+#else
+                kept[0].fix = data;
+                kept[0].ms = millis();
+                kept[0].reason = TrackReason::First;
+                const size_t keptCount = 1;
+#endif
+
+                // Fixes are the last thing storage sheds
+                for (size_t i = 0; i < keptCount && storage_ready(); i++) {
+                    StorageLine line;
+                    JsonWriter w(line.text(), STORAGE_MAX_LINE_BYTES);
+                    writeGnssRecord(w, kept[i].fix, kept[i].ms);
+                    pushStorageRecord(StorageStreamId::Gnss, line, w, StoragePriority::Critical);
                 }
-
-
-
-                if (g_storageQ) {
-
-                    StaticJsonDocument<256> doc;
-
-                    doc["t"] = millis();
-
-                    doc["lat"] = data.latitude;
-
-                    doc["lon"] = data.longitude;
-
-                    doc["alt"] = data.altitude;
-
-                    doc["spd"] = data.speed;
-
-                    doc["sat"] = data.satellites;
-
-                    doc["valid"] = data.isValid;
-
-                    char buf[256];
-
-                    size_t n = serializeJson(doc, buf, sizeof(buf));
-
-                    LogRecord rec{};
-
-                    rec.type = LogRecord::GNSS;
-
-                    memcpy(rec.line, buf, min(n + 1, sizeof(rec.line)));
-
-                    pushStorageRecord(rec);
-
+#if TELEMETRY_BINARY_ENABLE
+                // Dropped fixes are not changes; a parked unit only heartbeats
+                for (size_t i = 0; i < keptCount; i++) {
+                    s_cadence.observe(kCadenceLat, static_cast<int32_t>(kept[i].fix.latitude * 1e7));
+                    s_cadence.observe(kCadenceLon, static_cast<int32_t>(kept[i].fix.longitude * 1e7));
+                    s_cadence.observe(kCadenceSpeed, static_cast<int32_t>(kept[i].fix.speed * 10.0f));
+                    s_cadence.observe(kCadenceValid, kept[i].fix.isValid ? 1 : 0);
+                }
+                s_cadence.setLink(lastRssiDbm, isConnected);
+                if (s_cadence.shouldReport(now)) {
+                    // The newest kept point; a heartbeat while parked repeats it
+#if GNSS_TRACK_REDUCE_ENABLE
+                    const TrackPoint& tip = s_track.lastKept();
+#else
+                    const TrackPoint& tip = kept[0];
+#endif
+                    // A dropped frame may have been a keyframe; restart the delta chain
+                    const TransportStats ts = transport_getStats();
+                    if (ts.dropped + ts.failed != lastTelemetryLosses) {
+                        lastTelemetryLosses = ts.dropped + ts.failed;
+                        s_telemetry.forceKeyframe();
+                    }
+                    // Encode straight into the transport arena
+                    TransportReservation slot;
+                    if (transport_reserve(TransportPacketKind::TelemetryBinary, TELEMETRY_MAX_FRAME_BYTES, slot)) {
+                        const uint32_t fixTime = time_uptime_s() - (millis() - tip.ms) / 1000;
+                        const size_t len = s_telemetry.encodeGnss(tip.fix, fixTime, slot.data, slot.capacity);
+                        if (len && transport_commit(slot, len)) {
+                            s_cadence.markReported(now);
+                        } else {
+                            transport_abort(slot);
+                        }
+                    }
                 }
+#endif
 
-            } else {
+            } else if (!haveFix) {
 
                 Serial.println("[CATM_GNSS_TASK] GNSS: No valid fix");
 
             }
 
-        } else if (now - lastGnssPausedLog > 5000) {
+        } else if (!gnssEnabled && now - lastGnssPausedLog > 5000) {
 
-            Serial.println("[CATM_GNSS_TASK] GNSS paused while cellular attach in progress");
+            Serial.printf("[CATM_GNSS_TASK] GNSS paused (RF %s slot, %lu ms)\n",
+                          RfArbiter::slotName(rfSlot), (unsigned long)s_rfArbiter.slotAgeMs(now));
 
             lastGnssPausedLog = now;
 
@@ -394,103 +758,78 @@ void vTaskCatMGNSS(void* pvParameters) {
 
 
 
-        if (!isConnected) {
-
-            Serial.println("[CATM_GNSS_TASK] Cellular: Not connected");
-
-
-
-            if (g_storageQ) {
-
-                StaticJsonDocument<128> doc;
-
-                doc["t"] = millis();
-                doc["conn"] = false;
-                doc["tx_bps"] = 0;
-                doc["rx_bps"] = 0;
-                doc["tx_bytes"] = 0;
-                doc["rx_bytes"] = 0;
-                doc["detach"] = 0;
-
-                char buf[128];
-
-                size_t n = serializeJson(doc, buf, sizeof(buf));
-
-                LogRecord rec{};
+        // Cellular record, signal and UI on their own interval, and on every link change
+        if (due(statusDueMs) || wasConnected != isConnected) {
 
-                rec.type = LogRecord::CELL;
+            statusDueMs = now + CATM_STATUS_INTERVAL_MS;
+            CellularStatusEvent statusEvent{};
+            statusEvent.connected = isConnected;
 
-                memcpy(rec.line, buf, min(n + 1, sizeof(rec.line)));
-
-                pushStorageRecord(rec);
-
-            }
-
-        } else {
-
-            int8_t signal = module->getSignalStrength();
-
-            // Get cached operator name from cellular data (avoid String allocation)
-            CellularData cellData = module->getCellularData();
+            if (!isConnected) {
 
-            Serial.printf("[CATM_GNSS_TASK] Cellular: Connected to %s, Signal: %d dBm\n",
+                Serial.println("[CATM_GNSS_TASK] Cellular: Not connected");
 
-                         cellData.operatorName.c_str(), signal);
 
 
+                if (storage_ready() && storage_admit(StorageStreamId::Cell, StoragePriority::Normal)) {
 
-            if (g_storageQ) {
+                    StorageLine line;
+                    JsonWriter w(line.text(), STORAGE_MAX_LINE_BYTES);
+                    writeCellRecord(w, nullptr, 0, millis());
+                    pushStorageRecord(StorageStreamId::Cell, line, w);
 
-                StaticJsonDocument<256> doc;
+                }
 
-                doc["t"] = millis();
+            } else {
 
-                doc["op"] = cellData.operatorName.c_str();
+                int8_t signal = module->pollSignalStrength(now);
+                statusEvent.rssiDbm = signal;
+#if TELEMETRY_BINARY_ENABLE
+                lastRssiDbm = signal;
+#endif
 
-                doc["rssi"] = signal;
+                // Get cached operator name from cellular data (avoid String allocation)
+                CellularData cellData = module->getCellularData();
 
-                doc["conn"] = true;
-                CellularData data = module->getCellularData();
-                doc["tx_bps"] = data.txBps;
-                doc["rx_bps"] = data.rxBps;
-                doc["tx_bytes"] = static_cast<unsigned long long>(data.txBytes);
-                doc["rx_bytes"] = static_cast<unsigned long long>(data.rxBytes);
+                Serial.printf("[CATM_GNSS_TASK] Cellular: Connected to %s, Signal: %d dBm\n",
 
-                char buf[256];
+                             cellData.operatorName.c_str(), signal);
 
-                size_t n = serializeJson(doc, buf, sizeof(buf));
 
-                LogRecord rec{};
 
-                rec.type = LogRecord::CELL;
+                if (storage_ready() && storage_admit(StorageStreamId::Cell, StoragePriority::Normal)) {
 
-                memcpy(rec.line, buf, min(n + 1, sizeof(rec.line)));
+                    StorageLine line;
+                    JsonWriter w(line.text(), STORAGE_MAX_LINE_BYTES);
+                    writeCellRecord(w, &cellData, signal, millis());
+                    pushStorageRecord(StorageStreamId::Cell, line, w);
 
-                pushStorageRecord(rec);
+                }
 
             }
 
-        }
-
+            module->publishCellular();
+            event_bus_publish<EventTopic::CellularStatus>(statusEvent);
 
+        }
 
         if (wasConnected != isConnected) {
 
-            g_cellularUp = isConnected;
+            CellularLinkEvent linkEvent{};
+            linkEvent.up = isConnected;
+            event_bus_publish<EventTopic::CellularLink>(linkEvent);
+            linkPublished = isConnected;
+            backfill_link(isConnected);
 
             if (!isConnected) {
+                // Pushes sent while detached are lost; re-fetch after the next attach
+                g_sharedAttributes.invalidate();
                 CellularData diag = module->getCellularData();
                 if (diag.lastDetachReason.length()) {
-                    LOG_WARN("Cellular detached: %s", diag.lastDetachReason.c_str());
+                    LOGT_WARN(CATM, "Cellular detached: %s", diag.lastDetachReason.c_str());
                 }
             }
 
-            if (xEventGroupSystemStatus) {
-
-                xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_STATUS_CHANGE);
-
-            }
-
         }
 
         lastLinkState = isConnected;
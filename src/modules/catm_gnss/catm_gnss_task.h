@@ -1,16 +1,66 @@
 #ifndef CATM_GNSS_TASK_H
 #define CATM_GNSS_TASK_H
 
+#include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/queue.h>
 #include <stdint.h>
 #include <stddef.h>
 
+// The task sleeps on xEventGroupSystemStatus until a request, modem bytes, a queued
+// uplink record or the earliest of its deadlines below
+#ifndef CATM_STATUS_INTERVAL_MS
+#define CATM_STATUS_INTERVAL_MS 10000      // cellular record, signal and UI refresh
+#endif
+#ifndef CATM_SERVICE_IDLE_MS
+#define CATM_SERVICE_IDLE_MS 10000         // uplink services with nothing queued
+#endif
+#ifndef CATM_SERVICE_BUSY_MS
+#define CATM_SERVICE_BUSY_MS 500           // ... with records held, retrying or an OTA download
+#endif
+#ifndef CATM_IDLE_WAKE_MS
+#define CATM_IDLE_WAKE_MS 60000            // longest sleep whatever else is planned
+#endif
+
+// Why the task last woke up: an event, or the deadline that came due
+enum class CatmWake : uint8_t {
+    GnssRequest = 0,     // EVENT_BIT_GNSS_UPDATE_REQ
+    ModemRx,             // URC or reply bytes
+    UplinkQueued,
+    Link,                // link cache check
+    Attach,              // attach retry
+    Gnss,                // polled fix, or stream stale check
+    Status,
+    Service,
+    Power,               // PSM linger over or transmit window
+    Scan,                // next operator scan chunk
+    Idle,
+    Count
+};
+
+struct CatmWakeStats {
+    uint32_t wakes;
+    uint32_t byReason[(size_t)CatmWake::Count];
+    CatmWake last;
+    uint32_t lastSleepMs;
+    uint32_t maxSleepMs;
+    uint64_t sleptMs;
+    bool rxNotify;       // the modem port signals received bytes
+};
+
 // Task function declaration
 void vTaskCatMGNSS(void* pvParameters);
 
 // Function to trigger immediate GNSS update
 void requestGNSSUpdate();
 
+const char* catm_wake_name(CatmWake reason);
+void catm_wake_stats(CatmWakeStats& out);
+void catm_task_report(Print& out);
+
+// RF slot arbiter owned by the CatM task (read-only; for status/diagnostics)
+class RfArbiter;
+const RfArbiter& catmRfArbiter();
+
 #endif // CATM_GNSS_TASK_H
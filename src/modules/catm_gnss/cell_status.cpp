@@ -1,121 +1,123 @@
 #include "cell_status.h"
-#include "catm_gnss_module.h"
+#include "../../system/text_buffer.h"
 
-CellStatus CellStatus::fromCellularData(const CellularData& data, const String& apnStr, const String& imeiStr) {
-    CellStatus status;
+namespace {
+void appendScaled(TextBuffer& t, double scaled, const char* unit, bool whole) {
+    if (whole) {
+        t.printf("%.0f %s", scaled, unit);
+    } else {
+        t.printf("%.1f %s", scaled, unit);
+    }
+}
 
-    // Copy raw values
-    status.isConnected = data.isConnected;
-    status.operatorName = data.operatorName;
-    status.signalStrength = data.signalStrength;
-    status.imei = imeiStr;
-    status.apn = apnStr.length() ? apnStr : data.apn;
-    status.ipAddress = data.ipAddress;
-    status.registrationState = data.registrationState;
-    status.registrationText = "Unknown";
-    status.lastUpdate = data.lastUpdate;
-    status.lastDetachReason = data.lastDetachReason;
-    status.txBytes = data.txBytes;
-    status.rxBytes = data.rxBytes;
-    status.txBps = data.txBps;
-    status.rxBps = data.rxBps;
+void appendBytes(TextBuffer& t, uint64_t value) {
+    static const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double scaled = static_cast<double>(value);
+    size_t unitIdx = 0;
+    while (scaled >= 1024.0 && unitIdx < 4) {
+        scaled /= 1024.0;
+        ++unitIdx;
+    }
+    appendScaled(t, scaled, units[unitIdx], unitIdx == 0 || scaled >= 100.0);
+}
 
-    auto formatBytes = [](uint64_t value) -> String {
-        static const char* units[] = {"B", "KB", "MB", "GB", "TB"};
-        double scaled = static_cast<double>(value);
-        size_t unitIdx = 0;
-        while (scaled >= 1024.0 && unitIdx < 4) {
-            scaled /= 1024.0;
-            ++unitIdx;
-        }
-        char buffer[32];
-        if (unitIdx == 0 || scaled >= 100.0) {
-            snprintf(buffer, sizeof(buffer), "%.0f %s", scaled, units[unitIdx]);
-        } else {
-            snprintf(buffer, sizeof(buffer), "%.1f %s", scaled, units[unitIdx]);
-        }
-        return String(buffer);
-    };
+void appendRate(TextBuffer& t, uint32_t value) {
+    if (value == 0) {
+        t.print("0 B/s");
+        return;
+    }
+    static const char* units[] = {"B/s", "KB/s", "MB/s"};
+    double scaled = static_cast<double>(value);
+    size_t unitIdx = 0;
+    while (scaled >= 1024.0 && unitIdx < 2) {
+        scaled /= 1024.0;
+        ++unitIdx;
+    }
+    appendScaled(t, scaled, units[unitIdx], unitIdx == 0 || scaled >= 100.0);
+}
 
-    auto formatRate = [](uint32_t value) -> String {
-        if (value == 0) {
-            return String("0 B/s");
-        }
-        static const char* units[] = {"B/s", "KB/s", "MB/s"};
-        double scaled = static_cast<double>(value);
-        size_t unitIdx = 0;
-        while (scaled >= 1024.0 && unitIdx < 2) {
-            scaled /= 1024.0;
-            ++unitIdx;
-        }
-        char buffer[32];
-        if (unitIdx == 0 || scaled >= 100.0) {
-            snprintf(buffer, sizeof(buffer), "%.0f %s", scaled, units[unitIdx]);
-        } else {
-            snprintf(buffer, sizeof(buffer), "%.1f %s", scaled, units[unitIdx]);
-        }
-        return String(buffer);
-    };
+const char* orDashes(const char* s) {
+    return s[0] ? s : "--";
+}
+} // namespace
 
-    status.throughputText = "Tx " + formatBytes(status.txBytes) + " (" + formatRate(status.txBps) + ")" +
-        String(" / Rx ") + formatBytes(status.rxBytes) + " (" + formatRate(status.rxBps) + ")";
+CellStatus CellStatus::fromSnapshot(const CellularSnapshot& snap) {
+    CellStatus status;
+    status.data = snap;
 
     // Calculate signal percentage (same formula as in ui_pages.cpp)
-    if (data.signalStrength <= -113) {
+    if (snap.signalStrength <= -113) {
         status.signalPercentage = 0;
-    } else if (data.signalStrength >= -51) {
+    } else if (snap.signalStrength >= -51) {
         status.signalPercentage = 100;
     } else {
-        status.signalPercentage = static_cast<uint16_t>((data.signalStrength + 113) * 100 / 62);
+        status.signalPercentage = static_cast<uint16_t>((snap.signalStrength + 113) * 100 / 62);
     }
+    return status;
+}
 
-    switch (status.registrationState) {
-        case 0: status.registrationText = "Not registered"; break;
-        case 1: status.registrationText = "Registered (home)"; break;
-        case 2: status.registrationText = "Searching"; break;
-        case 3: status.registrationText = "Registration denied"; break;
-        case 4: status.registrationText = "Unknown"; break;
-        case 5: status.registrationText = "Registered (roaming)"; break;
-        default: status.registrationText = String("State ") + status.registrationState; break;
-    }
+const char* CellStatus::signalText() const {
+    if (signalPercentage >= 80) return "Excellent";
+    if (signalPercentage >= 60) return "Good";
+    if (signalPercentage >= 40) return "Fair";
+    if (signalPercentage > 0) return "Poor";
+    return "No Signal";
+}
 
-    // Signal quality text
-    if (status.signalPercentage >= 80) {
-        status.signalText = "Excellent";
-    } else if (status.signalPercentage >= 60) {
-        status.signalText = "Good";
-    } else if (status.signalPercentage >= 40) {
-        status.signalText = "Fair";
-    } else if (status.signalPercentage > 0) {
-        status.signalText = "Poor";
-    } else {
-        status.signalText = "No Signal";
+const char* CellStatus::registrationText() const {
+    switch (data.registrationState) {
+        case 0: return "Not registered";
+        case 1: return "Registered (home)";
+        case 2: return "Searching";
+        case 3: return "Registration denied";
+        case 5: return "Registered (roaming)";
+        default: return "Unknown";
     }
+}
 
-    // Status text
-    if (status.isConnected) {
-        if (status.operatorName.length() > 0) {
-            status.statusText = "Connected to " + status.operatorName;
-        } else {
-            status.statusText = "Connected";
-        }
+const char* CellStatus::formatStatus(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    if (!data.isConnected) {
+        t.print("Offline");
+    } else if (data.operatorName[0]) {
+        t.printf("Connected to %s", data.operatorName);
     } else {
-        status.statusText = "Offline";
+        t.print("Connected");
     }
+    return t.c_str();
+}
 
-    // RSSI text
-    status.rssiText = String(status.signalStrength) + " dBm (" + String(status.signalPercentage) + "%)";
-
-    // Format the full summary text (matches ui_pages.cpp format)
-    status.formattedSummary = "Status: " + String(status.isConnected ? "Online" : "Offline") + "\n";
-    status.formattedSummary += "Operator: " + (status.operatorName.length() ? status.operatorName : String("--")) + "\n";
-    status.formattedSummary += "RSSI: " + status.rssiText + "\n";
-    status.formattedSummary += "APN: " + status.apn + "\n";
-    status.formattedSummary += "IP: " + (status.ipAddress.length() ? status.ipAddress : String("--")) + "\n";
-    status.formattedSummary += "Reg: " + status.registrationText + "\n";
-    status.formattedSummary += "Net: " + status.throughputText + "\n";
-    status.formattedSummary += "IMEI: " + status.imei;
+const char* CellStatus::formatRssi(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    t.printf("%d dBm (%u%%)", (int)data.signalStrength, (unsigned)signalPercentage);
+    return t.c_str();
+}
 
-    return status;
+const char* CellStatus::formatThroughput(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    t.print("Tx ");
+    appendBytes(t, data.txBytes);
+    t.print(" (");
+    appendRate(t, data.txBps);
+    t.print(") / Rx ");
+    appendBytes(t, data.rxBytes);
+    t.print(" (");
+    appendRate(t, data.rxBps);
+    t.print(")");
+    return t.c_str();
 }
 
+size_t CellStatus::formatSummary(char* out, size_t size) const {
+    char rssi[24];
+    char net[64];
+    TextBuffer t(out, size);
+    t.printf("Status: %s\n", data.isConnected ? "Online" : "Offline");
+    t.printf("Operator: %s\n", orDashes(data.operatorName));
+    t.printf("RSSI: %s\n", formatRssi(rssi, sizeof(rssi)));
+    t.printf("APN: %s\n", data.apn);
+    t.printf("IP: %s\n", orDashes(data.ipAddress));
+    t.printf("Reg: %s\n", registrationText());
+    t.printf("Net: %s\n", formatThroughput(net, sizeof(net)));
+    t.printf("IMEI: %s", data.imei);
+    return t.length();
+}
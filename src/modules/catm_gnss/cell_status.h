@@ -2,39 +2,26 @@
 
 #include <Arduino.h>
 
-// Forward declarations
-struct CellularData;
+// CellularSnapshot
+#include "catm_gnss_module.h"
 
 /**
- * Enhanced cellular status DTO with ready-to-render values
+ * Cellular status DTO: raw values only. Text is formatted into the caller's
+ * buffer when a page or command shows it, so nothing is built while no one
+ * looks.
  */
 struct CellStatus {
-    // Raw data
-    bool isConnected;
-    String operatorName;
-    int8_t signalStrength;
-    String imei;
-    String apn;
-    String ipAddress;
-    uint8_t registrationState;
-    String registrationText;
-    uint32_t lastUpdate;
-    String lastDetachReason;
+    CellularSnapshot data;       // text fields truncated to the snapshot sizes
+    uint16_t signalPercentage;   // 0-100%
 
-    uint64_t txBytes;
-    uint64_t rxBytes;
-    uint32_t txBps;
-    uint32_t rxBps;
+    static CellStatus fromSnapshot(const CellularSnapshot& snap);
 
-    // Derived/formatted values
-    uint16_t signalPercentage;  // 0-100%
-    String signalText;          // "Excellent", "Good", "Fair", "Poor", "No Signal"
-    String statusText;          // "Connected to [Operator]", "Offline", etc.
-    String rssiText;            // "-XX dBm (YY%)"
-    String throughputText;      // "Tx: 1.2 MB (8 kbps) / Rx: ..."
-    String formattedSummary;    // Multi-line text for display
-    
-    // Helper method to calculate derived values from raw data
-    static CellStatus fromCellularData(const CellularData& data, const String& apnStr, const String& imeiStr);
+    const char* signalText() const;          // "Excellent", "Good", "Fair", "Poor", "No Signal"
+    const char* registrationText() const;    // "Registered (home)", "Searching", ...
+    // Each writes at most size bytes, NUL included, and returns out
+    const char* formatStatus(char* out, size_t size) const;       // "Connected to [Operator]", "Offline"
+    const char* formatRssi(char* out, size_t size) const;         // "-XX dBm (YY%)"
+    const char* formatThroughput(char* out, size_t size) const;   // "Tx 1.2 MB (8 B/s) / Rx ..."
+    // Multi-line text for display; returns its length
+    size_t formatSummary(char* out, size_t size) const;
 };
-
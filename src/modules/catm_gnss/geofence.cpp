@@ -0,0 +1,635 @@
+/*
+ * Geofence Engine Implementation
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ */
+
+#include "geofence.h"
+
+#if GEOFENCE_ENABLE
+
+#include "../logging/log_buffer.h"
+#include "../../include/transport.h"
+#include "../../system/hot_path_timer.h"
+#include "../../system/json_writer.h"
+#include "../../system/metrics.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <algorithm>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if ENABLE_SD
+#include "../storage/sd_card_module.h"
+extern SDCardModule* sdModule;
+#endif
+
+namespace {
+const char* const kNamespace = "geofence";
+const char* const kTableKey = "table";
+const char* const kStateKey = "state";
+constexpr uint32_t kTableMagic = 0x31464547;   // "GEF1"
+constexpr uint32_t kStateMagic = 0x31534647;   // "GFS1"
+constexpr size_t kCells = (size_t)GEOFENCE_GRID * GEOFENCE_GRID;
+constexpr float kMetresPerDegLat = 111320.0f;
+constexpr float kDegToRad = 0.017453293f;
+constexpr int32_t kScale = 10000000;           // 1e-7 deg
+
+struct Point {
+    int32_t lat;
+    int32_t lon;
+};
+
+// Stored as is; unused entries stay zero so the CRC only follows the content
+struct Fence {
+    char name[GEOFENCE_NAME_LEN];
+    uint8_t kind;            // GeofenceKind
+    uint8_t events;          // GEOFENCE_ON_*
+    uint16_t first;          // polygon: first vertex
+    uint16_t count;          // polygon: vertices
+    uint16_t reserved;
+    Point centre;            // circle
+    uint32_t radiusM;
+};
+
+struct Table {
+    uint16_t fences;
+    uint16_t vertices;
+    Fence fence[GEOFENCE_MAX_FENCES];
+    Point vertex[GEOFENCE_MAX_VERTICES];
+};
+
+struct StoredTable {
+    uint32_t magic;
+    Table table;
+    uint32_t crc;            // CRC-32 of table
+};
+
+struct StoredState {
+    uint32_t magic;
+    uint32_t tableCrc;       // the state only holds for this table
+    uint32_t inside;
+};
+
+struct Box {
+    int32_t minLat;
+    int32_t maxLat;
+    int32_t minLon;
+    int32_t maxLon;
+};
+
+struct Event {
+    uint8_t fence;
+    bool enter;
+    Point at;
+    uint32_t ms;
+};
+
+Table s_table = {};
+uint32_t s_crc = 0;
+
+// Index, rebuilt with the table
+Box s_box[GEOFENCE_MAX_FENCES];
+float s_metresPerDegLon[GEOFENCE_MAX_FENCES];   // circles, at the centre
+Box s_extent = {};
+int64_t s_cellLat = 1;
+int64_t s_cellLon = 1;
+uint32_t s_cell[kCells];
+
+// Sides: s_inside confirmed, s_streak fixes in a row seen on the other side
+uint32_t s_inside = 0;
+bool s_known = false;        // s_inside came from a fix or a matching NVS state
+uint8_t s_streak[GEOFENCE_MAX_FENCES];
+
+Event s_events[GEOFENCE_EVENTS];
+uint32_t s_head = 0;
+uint32_t s_tail = 0;
+GeofenceStats s_stats = {};
+
+MetricCounter s_metricEnters("geo.enters", [] { return s_stats.enters; });
+MetricCounter s_metricExits("geo.exits", [] { return s_stats.exits; });
+MetricCounter s_metricCandidates("geo.candidates", [] { return s_stats.candidates; });
+
+uint32_t tableCrc(const Table& t) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&t), sizeof(t));
+}
+
+// ---- text format ------------------------------------------------------------
+
+struct Cursor {
+    const char* p;
+    const char* end;
+};
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == '\r';
+}
+
+// Next token on the current line; false at the end of the line
+bool token(Cursor& c, const char*& tok, size_t& n) {
+    while (c.p < c.end && isBlank(*c.p)) c.p++;
+    if (c.p >= c.end || *c.p == '\n' || *c.p == '#') return false;
+    tok = c.p;
+    while (c.p < c.end && !isBlank(*c.p) && *c.p != '\n' && *c.p != '#') c.p++;
+    n = (size_t)(c.p - tok);
+    return true;
+}
+
+void skipLine(Cursor& c) {
+    while (c.p < c.end && *c.p != '\n') c.p++;
+    if (c.p < c.end) c.p++;
+}
+
+bool tokenIs(const char* tok, size_t n, const char* word) {
+    return strlen(word) == n && strncmp(tok, word, n) == 0;
+}
+
+// Decimal degrees to 1e-7 deg; digits past the seventh decimal are dropped
+bool parseDegrees(const char* tok, size_t n, int32_t limitDeg, int32_t& out) {
+    size_t i = 0;
+    const bool neg = n && tok[0] == '-';
+    if (n && (tok[0] == '-' || tok[0] == '+')) i++;
+    int64_t whole = 0;
+    size_t digits = 0;
+    for (; i < n && tok[i] >= '0' && tok[i] <= '9'; i++, digits++) {
+        whole = whole * 10 + (tok[i] - '0');
+        if (whole > limitDeg) return false;
+    }
+    int64_t frac = 0;
+    int64_t scale = kScale;
+    if (i < n && tok[i] == '.') {
+        for (i++; i < n && tok[i] >= '0' && tok[i] <= '9'; i++, digits++) {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (tok[i] - '0') * scale;
+            }
+        }
+    }
+    if (i != n || digits == 0) return false;
+    const int64_t v = whole * kScale + frac;
+    if (v > (int64_t)limitDeg * kScale) return false;
+    out = (int32_t)(neg ? -v : v);
+    return true;
+}
+
+bool parsePoint(Cursor& c, Point& out) {
+    const char* tok;
+    size_t n;
+    return token(c, tok, n) && parseDegrees(tok, n, 90, out.lat) &&
+           token(c, tok, n) && parseDegrees(tok, n, 180, out.lon);
+}
+
+bool parseEvents(const char* tok, size_t n, uint8_t& out) {
+    if (tokenIs(tok, n, "enter")) out = GEOFENCE_ON_ENTER;
+    else if (tokenIs(tok, n, "exit")) out = GEOFENCE_ON_EXIT;
+    else if (tokenIs(tok, n, "both")) out = GEOFENCE_ON_ENTER | GEOFENCE_ON_EXIT;
+    else if (tokenIs(tok, n, "none")) out = 0;
+    else return false;
+    return true;
+}
+
+bool parseName(const char* tok, size_t n, char* name) {
+    if (n == 0 || n >= GEOFENCE_NAME_LEN) return false;
+    for (size_t i = 0; i < n; i++) {
+        const char ch = tok[i];
+        const bool ok = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') ||
+                        ch == '_' || ch == '-' || ch == '.';
+        if (!ok) return false;
+    }
+    memcpy(name, tok, n);
+    name[n] = '\0';
+    return true;
+}
+
+// One fence line past its keyword; false with the reason in err
+bool parseFence(Cursor& c, bool circle, Table& t, const char*& err) {
+    if (t.fences >= GEOFENCE_MAX_FENCES) {
+        err = "too many fences";
+        return false;
+    }
+    Fence& f = t.fence[t.fences];
+    const char* tok;
+    size_t n;
+    if (!token(c, tok, n) || !parseName(tok, n, f.name)) {
+        err = "bad name";
+        return false;
+    }
+    for (uint16_t i = 0; i < t.fences; i++) {
+        if (strcmp(t.fence[i].name, f.name) == 0) {
+            err = "duplicate name";
+            return false;
+        }
+    }
+    if (!token(c, tok, n) || !parseEvents(tok, n, f.events)) {
+        err = "expected enter, exit, both or none";
+        return false;
+    }
+    if (circle) {
+        f.kind = (uint8_t)GeofenceKind::Circle;
+        if (!parsePoint(c, f.centre)) {
+            err = "bad centre";
+            return false;
+        }
+        char* endp = nullptr;
+        if (!token(c, tok, n)) {
+            err = "missing radius";
+            return false;
+        }
+        char num[12];
+        const size_t k = n < sizeof(num) - 1 ? n : sizeof(num) - 1;
+        memcpy(num, tok, k);
+        num[k] = '\0';
+        const unsigned long r = strtoul(num, &endp, 10);
+        if (k != n || *endp != '\0' || r == 0 || r > GEOFENCE_MAX_RADIUS_M) {
+            err = "bad radius";
+            return false;
+        }
+        f.radiusM = (uint32_t)r;
+    } else {
+        f.kind = (uint8_t)GeofenceKind::Polygon;
+        f.first = t.vertices;
+        const char* tok2;
+        for (Cursor peek = c; token(peek, tok2, n); peek = c) {
+            if (t.vertices >= GEOFENCE_MAX_VERTICES) {
+                err = "too many vertices";
+                return false;
+            }
+            if (!parsePoint(c, t.vertex[t.vertices])) {
+                err = "bad point";
+                return false;
+            }
+            t.vertices++;
+        }
+        f.count = (uint16_t)(t.vertices - f.first);
+        if (f.count < 3) {
+            err = "polygon needs 3 points";
+            return false;
+        }
+    }
+    if (token(c, tok, n)) {
+        err = "unexpected text";
+        return false;
+    }
+    t.fences++;
+    return true;
+}
+
+bool parse(const char* text, size_t len, Table& t, char* err, size_t errLen) {
+    memset(&t, 0, sizeof(t));
+    Cursor c{text, text + len};
+    unsigned line = 1;
+    for (; c.p < c.end; line++) {
+        const char* tok;
+        size_t n;
+        if (token(c, tok, n)) {
+            const char* why = nullptr;
+            const bool circle = tokenIs(tok, n, "circle");
+            if (!circle && !tokenIs(tok, n, "poly")) {
+                why = "expected circle or poly";
+            } else {
+                parseFence(c, circle, t, why);
+            }
+            if (why) {
+                if (err && errLen) snprintf(err, errLen, "line %u: %s", line, why);
+                return false;
+            }
+        }
+        skipLine(c);
+    }
+    return true;
+}
+
+// ---- index --------------------------------------------------------------------
+
+void buildIndex() {
+    s_extent = Box{INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN};
+    for (uint16_t i = 0; i < s_table.fences; i++) {
+        const Fence& f = s_table.fence[i];
+        Box b;
+        if (f.kind == (uint8_t)GeofenceKind::Circle) {
+            const float cosLat = cosf((float)f.centre.lat / kScale * kDegToRad);
+            s_metresPerDegLon[i] = kMetresPerDegLat * (cosLat > 0.01f ? cosLat : 0.01f);
+            const int64_t dLat = (int64_t)((float)f.radiusM / kMetresPerDegLat * kScale) + 1;
+            const int64_t dLon = (int64_t)((float)f.radiusM / s_metresPerDegLon[i] * kScale) + 1;
+            b.minLat = (int32_t)std::max<int64_t>(f.centre.lat - dLat, -90LL * kScale);
+            b.maxLat = (int32_t)std::min<int64_t>(f.centre.lat + dLat, 90LL * kScale);
+            b.minLon = (int32_t)std::max<int64_t>(f.centre.lon - dLon, -180LL * kScale);
+            b.maxLon = (int32_t)std::min<int64_t>(f.centre.lon + dLon, 180LL * kScale);
+        } else {
+            const Point* v = s_table.vertex + f.first;
+            b = Box{v[0].lat, v[0].lat, v[0].lon, v[0].lon};
+            for (uint16_t k = 1; k < f.count; k++) {
+                b.minLat = std::min(b.minLat, v[k].lat);
+                b.maxLat = std::max(b.maxLat, v[k].lat);
+                b.minLon = std::min(b.minLon, v[k].lon);
+                b.maxLon = std::max(b.maxLon, v[k].lon);
+            }
+        }
+        s_box[i] = b;
+        s_extent.minLat = std::min(s_extent.minLat, b.minLat);
+        s_extent.maxLat = std::max(s_extent.maxLat, b.maxLat);
+        s_extent.minLon = std::min(s_extent.minLon, b.minLon);
+        s_extent.maxLon = std::max(s_extent.maxLon, b.maxLon);
+    }
+
+    memset(s_cell, 0, sizeof(s_cell));
+    if (!s_table.fences) return;
+    s_cellLat = ((int64_t)s_extent.maxLat - s_extent.minLat) / GEOFENCE_GRID + 1;
+    s_cellLon = ((int64_t)s_extent.maxLon - s_extent.minLon) / GEOFENCE_GRID + 1;
+    for (uint16_t i = 0; i < s_table.fences; i++) {
+        const Box& b = s_box[i];
+        const size_t r0 = (size_t)(((int64_t)b.minLat - s_extent.minLat) / s_cellLat);
+        const size_t r1 = (size_t)(((int64_t)b.maxLat - s_extent.minLat) / s_cellLat);
+        const size_t c0 = (size_t)(((int64_t)b.minLon - s_extent.minLon) / s_cellLon);
+        const size_t c1 = (size_t)(((int64_t)b.maxLon - s_extent.minLon) / s_cellLon);
+        for (size_t r = r0; r <= r1; r++) {
+            for (size_t c = c0; c <= c1; c++) s_cell[r * GEOFENCE_GRID + c] |= 1UL << i;
+        }
+    }
+}
+
+// Fences whose box may hold p
+uint32_t candidates(const Point& p) {
+    if (!s_table.fences || p.lat < s_extent.minLat || p.lat > s_extent.maxLat || p.lon < s_extent.minLon ||
+        p.lon > s_extent.maxLon) {
+        return 0;
+    }
+    const size_t r = (size_t)(((int64_t)p.lat - s_extent.minLat) / s_cellLat);
+    const size_t c = (size_t)(((int64_t)p.lon - s_extent.minLon) / s_cellLon);
+    return s_cell[r * GEOFENCE_GRID + c];
+}
+
+bool inBox(const Box& b, const Point& p) {
+    return p.lat >= b.minLat && p.lat <= b.maxLat && p.lon >= b.minLon && p.lon <= b.maxLon;
+}
+
+// Crossing count of a ray towards +lon; 64-bit products of 1e-7 deg differences are exact
+bool inPolygon(const Point* v, uint16_t n, const Point& p) {
+    bool inside = false;
+    for (uint16_t i = 0, j = n - 1; i < n; j = i++) {
+        if ((v[i].lat > p.lat) == (v[j].lat > p.lat)) continue;
+        const int64_t lhs = ((int64_t)p.lon - v[i].lon) * ((int64_t)v[j].lat - v[i].lat);
+        const int64_t rhs = ((int64_t)p.lat - v[i].lat) * ((int64_t)v[j].lon - v[i].lon);
+        if (v[j].lat > v[i].lat ? lhs < rhs : lhs > rhs) inside = !inside;
+    }
+    return inside;
+}
+
+bool contains(size_t i, const Point& p) {
+    const Fence& f = s_table.fence[i];
+    if (f.kind == (uint8_t)GeofenceKind::Circle) {
+        const float dy = (float)(p.lat - f.centre.lat) / kScale * kMetresPerDegLat;
+        const float dx = (float)(p.lon - f.centre.lon) / kScale * s_metresPerDegLon[i];
+        const float r = (float)f.radiusM;
+        return dx * dx + dy * dy <= r * r;
+    }
+    return inPolygon(s_table.vertex + f.first, f.count, p);
+}
+
+// ---- state and events -----------------------------------------------------------
+
+void loadState() {
+    s_inside = 0;
+    s_known = false;
+    memset(s_streak, 0, sizeof(s_streak));
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, true)) return;
+    StoredState st{};
+    if (prefs.getBytes(kStateKey, &st, sizeof(st)) == sizeof(st) && st.magic == kStateMagic &&
+        st.tableCrc == s_crc) {
+        const uint32_t used = s_table.fences >= 32 ? UINT32_MAX : (1UL << s_table.fences) - 1;
+        s_inside = st.inside & used;
+        s_known = true;
+    }
+    prefs.end();
+}
+
+void storeState() {
+    const StoredState st{kStateMagic, s_crc, s_inside};
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, false)) return;
+    prefs.putBytes(kStateKey, &st, sizeof(st));
+    prefs.end();
+}
+
+void push(uint8_t fence, bool enter, const Point& at, uint32_t now) {
+    if (s_head - s_tail >= GEOFENCE_EVENTS) {
+        s_tail++;
+        s_stats.lost++;
+    }
+    s_events[s_head++ % GEOFENCE_EVENTS] = Event{fence, enter, at, now};
+}
+
+// Oldest first; stops at the first one the transport refuses
+void drain() {
+    while (s_tail != s_head) {
+        const Event& e = s_events[s_tail % GEOFENCE_EVENTS];
+        char json[128];
+        JsonWriter w(json, sizeof(json));
+        w.beginObject()
+            .field("geofence", s_table.fence[e.fence].name)
+            .field("event", e.enter ? "enter" : "exit")
+            .field("lat", (double)e.at.lat / kScale, 7)
+            .field("lon", (double)e.at.lon / kScale, 7)
+            .field("age_ms", (unsigned long)(millis() - e.ms))
+            .endObject();
+        if (!w.ok() || !transport_sendAlarm(w.data(), w.length())) return;
+        s_stats.sent++;
+        s_tail++;
+    }
+}
+
+void install(const Table& t) {
+    s_table = t;
+    s_crc = tableCrc(s_table);
+    buildIndex();
+    // Events name fences of the old table
+    s_tail = s_head;
+    loadState();
+}
+
+bool loadStored(Table& out) {
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, true)) return false;
+    StoredTable* rec = static_cast<StoredTable*>(malloc(sizeof(StoredTable)));
+    bool ok = rec && prefs.getBytes(kTableKey, rec, sizeof(*rec)) == sizeof(*rec) && rec->magic == kTableMagic &&
+              rec->crc == tableCrc(rec->table) && rec->table.fences <= GEOFENCE_MAX_FENCES &&
+              rec->table.vertices <= GEOFENCE_MAX_VERTICES;
+    if (ok) out = rec->table;
+    free(rec);
+    prefs.end();
+    return ok;
+}
+
+bool store(const Table& t) {
+    StoredTable* rec = static_cast<StoredTable*>(malloc(sizeof(StoredTable)));
+    if (!rec) return false;
+    rec->magic = kTableMagic;
+    rec->table = t;
+    rec->crc = tableCrc(t);
+    Preferences prefs;
+    bool ok = prefs.begin(kNamespace, false);
+    if (ok) {
+        ok = prefs.putBytes(kTableKey, rec, sizeof(*rec)) == sizeof(*rec);
+        prefs.end();
+    }
+    free(rec);
+    return ok;
+}
+
+#if ENABLE_SD
+// Parses GEOFENCE_SD_PATH; true with t filled when the file exists and parses
+bool importFromSd(Table& t) {
+    if (!sdModule || !sdModule->isMounted() || !sdModule->exists(GEOFENCE_SD_PATH)) return false;
+    char* source = static_cast<char*>(malloc(GEOFENCE_MAX_SOURCE + 1));
+    if (!source) return false;
+    bool ok = sdModule->readText(GEOFENCE_SD_PATH, source, GEOFENCE_MAX_SOURCE + 1, GEOFENCE_MAX_SOURCE);
+    char err[48] = "";
+    if (ok) ok = parse(source, strlen(source), t, err, sizeof(err));
+    if (!ok) logbuf_printf("Geofence: %s not loaded: %s", GEOFENCE_SD_PATH, err[0] ? err : "read failed");
+    free(source);
+    return ok;
+}
+#endif
+} // namespace
+
+bool geofence_begin() {
+    Table* t = static_cast<Table*>(malloc(sizeof(Table)));
+    if (!t) return false;
+    memset(t, 0, sizeof(*t));
+    const bool stored = loadStored(*t);
+#if ENABLE_SD
+    Table* sd = static_cast<Table*>(malloc(sizeof(Table)));
+    if (sd && importFromSd(*sd) && (!stored || tableCrc(*sd) != tableCrc(*t))) {
+        if (store(*sd)) {
+            logbuf_printf("Geofence: installed %s (%u fences)", GEOFENCE_SD_PATH, (unsigned)sd->fences);
+        }
+        *t = *sd;
+    }
+    free(sd);
+#else
+    (void)stored;
+#endif
+    install(*t);
+    free(t);
+    Serial.printf("Geofence: %u fences, %u vertices, crc %08lx\n", (unsigned)s_table.fences,
+                  (unsigned)s_table.vertices, (unsigned long)s_crc);
+    return true;
+}
+
+bool geofence_install(const char* text, size_t len, bool persist, char* err, size_t errLen) {
+    if (!text) return false;
+    Table* t = static_cast<Table*>(malloc(sizeof(Table)));
+    if (!t) return false;
+    bool ok = parse(text, len, *t, err, errLen);
+    if (ok && persist && !store(*t)) {
+        if (err && errLen) snprintf(err, errLen, "NVS write failed");
+        ok = false;
+    }
+    if (ok) {
+        install(*t);
+        logbuf_printf("Geofence: %u fences installed", (unsigned)s_table.fences);
+    }
+    free(t);
+    return ok;
+}
+
+void geofence_fix(double latitude, double longitude, uint32_t now) {
+    if (!s_table.fences) return;
+    HOT_PATH_TIMER("geo.eval");
+    const Point p{(int32_t)lround(latitude * kScale), (int32_t)lround(longitude * kScale)};
+    s_stats.fixes++;
+
+    uint32_t inside = 0;
+    uint32_t tested = 0;
+    for (uint32_t m = candidates(p); m; m &= m - 1) {
+        const size_t i = (size_t)__builtin_ctz(m);
+        if (!inBox(s_box[i], p)) continue;
+        tested++;
+        if (contains(i, p)) inside |= 1UL << i;
+    }
+    s_stats.candidates += tested;
+    if (tested > s_stats.maxCandidates) s_stats.maxCandidates = tested;
+
+    if (!s_known) {
+        // No side to leave yet: the first fix sets it without events
+        s_inside = inside;
+        s_known = true;
+        storeState();
+        return;
+    }
+    bool changed = false;
+    for (size_t i = 0; i < s_table.fences; i++) {
+        const uint32_t bit = 1UL << i;
+        if ((inside & bit) == (s_inside & bit)) {
+            s_streak[i] = 0;
+            continue;
+        }
+        if (++s_streak[i] < GEOFENCE_CONFIRM_FIXES) continue;
+        s_streak[i] = 0;
+        s_inside ^= bit;
+        changed = true;
+        const bool enter = (inside & bit) != 0;
+        const Fence& f = s_table.fence[i];
+        if (enter) {
+            s_stats.enters++;
+        } else {
+            s_stats.exits++;
+        }
+        logbuf_printf("Geofence: %s %s", enter ? "entered" : "left", f.name);
+        if (f.events & (enter ? GEOFENCE_ON_ENTER : GEOFENCE_ON_EXIT)) push((uint8_t)i, enter, p, now);
+    }
+    if (changed) storeState();
+    drain();
+}
+
+void geofence_poll(uint32_t) {
+    drain();
+}
+
+size_t geofence_count() {
+    return s_table.fences;
+}
+
+bool geofence_info(size_t index, GeofenceInfo& out) {
+    if (index >= s_table.fences) return false;
+    const Fence& f = s_table.fence[index];
+    out.name = f.name;
+    out.kind = (GeofenceKind)f.kind;
+    out.events = f.events;
+    out.vertices = f.kind == (uint8_t)GeofenceKind::Polygon ? f.count : 0;
+    out.radiusM = f.kind == (uint8_t)GeofenceKind::Circle ? f.radiusM : 0;
+    out.inside = (s_inside >> index) & 1;
+    return true;
+}
+
+void geofence_stats(GeofenceStats& out) {
+    out = s_stats;
+    out.fences = s_table.fences;
+    out.vertices = s_table.vertices;
+    out.crc = s_crc;
+    out.insideMask = s_inside;
+}
+
+void geofence_report(Print& out) {
+    GeofenceStats s;
+    geofence_stats(s);
+    out.printf("Geofence: %lu fences, %lu vertices, crc %08lx, inside %08lx\n", (unsigned long)s.fences,
+               (unsigned long)s.vertices, (unsigned long)s.crc, (unsigned long)s.insideMask);
+    out.printf("  fixes %lu, tests %lu (max %lu/fix), enters %lu, exits %lu, sent %lu, pending %lu, lost %lu\n",
+               (unsigned long)s.fixes, (unsigned long)s.candidates, (unsigned long)s.maxCandidates,
+               (unsigned long)s.enters, (unsigned long)s.exits, (unsigned long)s.sent,
+               (unsigned long)(s_head - s_tail), (unsigned long)s.lost);
+    for (size_t i = 0; i < s_table.fences; i++) {
+        GeofenceInfo f;
+        geofence_info(i, f);
+        if (f.kind == GeofenceKind::Circle) {
+            out.printf("  %-15s circle %lu m  %s\n", f.name, (unsigned long)f.radiusM, f.inside ? "inside" : "outside");
+        } else {
+            out.printf("  %-15s poly %u pts  %s\n", f.name, (unsigned)f.vertices, f.inside ? "inside" : "outside");
+        }
+    }
+}
+
+#endif // GEOFENCE_ENABLE
@@ -0,0 +1,129 @@
+/*
+ * Geofence Engine
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * Circles and polygons kept in NVS, tested against every valid fix from
+ * updateGNSSData in the modem task:
+ *   - fences come from GEOFENCE_SD_PATH, one per line
+ *         circle <name> <enter|exit|both|none> <lat> <lon> <radius_m>
+ *         poly   <name> <enter|exit|both|none> <lat> <lon> <lat> <lon> ...
+ *     ('#' starts a comment, commas separate like blanks). At begin the file
+ *     replaces the NVS table when it parses and differs from it.
+ *   - the index is built once per table: a bounding box per fence and a
+ *     GEOFENCE_GRID x GEOFENCE_GRID grid over their union, each cell a bit
+ *     mask of the fences whose box touches it. A fix reads one cell and runs
+ *     the exact test (circle distance, polygon crossing count) only on the
+ *     fences in it, so the cost follows the fences near the unit rather than
+ *     the size of the table.
+ *   - a change of side takes GEOFENCE_CONFIRM_FIXES fixes in a row, which
+ *     keeps GNSS jitter at a boundary from flapping. Confirmed entries and
+ *     exits the fence asks for go to the transport Alarm class; refused ones
+ *     stay in a small ring and are retried from geofence_poll(). The inside
+ *     mask is kept in NVS, so a unit moved while powered off reports the exit
+ *     on its first fixes.
+ *
+ * Coordinates are 1e-7 degrees. Polygons must not cross the antimeridian.
+ */
+
+#ifndef GEOFENCE_H
+#define GEOFENCE_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+
+#ifndef GEOFENCE_MAX_FENCES
+#define GEOFENCE_MAX_FENCES 32               // one bit each in a grid cell
+#endif
+#ifndef GEOFENCE_MAX_VERTICES
+#define GEOFENCE_MAX_VERTICES 256            // all polygons together
+#endif
+#ifndef GEOFENCE_NAME_LEN
+#define GEOFENCE_NAME_LEN 16
+#endif
+#ifndef GEOFENCE_MAX_RADIUS_M
+#define GEOFENCE_MAX_RADIUS_M 100000UL
+#endif
+#ifndef GEOFENCE_GRID
+#define GEOFENCE_GRID 16                     // cells per side of the index
+#endif
+#ifndef GEOFENCE_CONFIRM_FIXES
+#define GEOFENCE_CONFIRM_FIXES 3             // fixes in a row on the new side
+#endif
+#ifndef GEOFENCE_EVENTS
+#define GEOFENCE_EVENTS 8                    // transitions waiting for the uplink
+#endif
+#ifndef GEOFENCE_MAX_SOURCE
+#define GEOFENCE_MAX_SOURCE 4096
+#endif
+#ifndef GEOFENCE_SD_PATH
+#define GEOFENCE_SD_PATH "/config/geofences.txt"
+#endif
+
+enum class GeofenceKind : uint8_t {
+    Circle = 0,
+    Polygon
+};
+
+// Which transitions raise an alarm
+enum : uint8_t {
+    GEOFENCE_ON_ENTER = 0x01,
+    GEOFENCE_ON_EXIT = 0x02
+};
+
+struct GeofenceInfo {
+    const char* name;
+    GeofenceKind kind;
+    uint8_t events;              // GEOFENCE_ON_*
+    uint16_t vertices;           // polygon
+    uint32_t radiusM;            // circle
+    bool inside;                 // confirmed side
+};
+
+struct GeofenceStats {
+    uint32_t fences;
+    uint32_t vertices;
+    uint32_t crc;                // of the installed table
+    uint32_t fixes;
+    uint32_t candidates;         // exact tests run, over all fixes
+    uint32_t maxCandidates;      // in one fix
+    uint32_t enters;
+    uint32_t exits;
+    uint32_t sent;
+    uint32_t lost;               // ring full
+    uint32_t insideMask;
+};
+
+#if GEOFENCE_ENABLE
+
+static_assert(GEOFENCE_MAX_FENCES <= 32, "grid cells hold one 32-bit mask");
+
+// Modem task, once before the first fix: NVS table, then GEOFENCE_SD_PATH
+bool geofence_begin();
+// Parses the text format above and swaps the table in; modem task.
+// persist stores it to NVS. err gets the first problem found.
+bool geofence_install(const char* text, size_t len, bool persist, char* err, size_t errLen);
+
+// Modem task, every valid fix
+void geofence_fix(double latitude, double longitude, uint32_t now);
+// Modem task: resends transitions the transport refused
+void geofence_poll(uint32_t now);
+
+size_t geofence_count();
+bool geofence_info(size_t index, GeofenceInfo& out);
+void geofence_stats(GeofenceStats& out);
+void geofence_report(Print& out);
+
+#else
+
+inline bool geofence_begin() { return false; }
+inline bool geofence_install(const char*, size_t, bool, char*, size_t) { return false; }
+inline void geofence_fix(double, double, uint32_t) {}
+inline void geofence_poll(uint32_t) {}
+inline size_t geofence_count() { return 0; }
+inline bool geofence_info(size_t, GeofenceInfo&) { return false; }
+inline void geofence_stats(GeofenceStats& out) { out = GeofenceStats{}; }
+inline void geofence_report(Print&) {}
+
+#endif // GEOFENCE_ENABLE
+
+#endif // GEOFENCE_H
@@ -0,0 +1,253 @@
+#include "gnss_assist.h"
+
+#if GNSS_ASSIST_ENABLE
+
+#include "catm_gnss_module.h"
+#include "../logging/log_buffer.h"
+#include "../transport/data_usage.h"
+#include "../../system/time_service.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <time.h>
+
+namespace {
+constexpr const char* kNamespace = "gnss_assist";
+constexpr const char* kKey = "state";
+constexpr uint32_t kMagic = 0x31414E47;      // "GNA1"
+
+struct Persisted {
+    int64_t xtraUtcS;        // 0 = no file
+    uint32_t xtraBytes;
+    int32_t fixLatE7;
+    int32_t fixLonE7;
+    int64_t fixUtcS;         // 0 = no fix
+};
+
+struct Record {
+    uint32_t magic;
+    Persisted state;
+    uint32_t crc;            // CRC-32 of everything above
+};
+
+Persisted s_saved = {};      // as in NVS
+bool s_loaded = false;
+bool s_injected = false;     // the cached file is in the engine
+bool s_downloading = false;
+uint32_t s_retryAtMs = 0;
+uint32_t s_lastFixMs = 0;    // millis() of the newest fix this boot, 0 = none
+int32_t s_fixLatE7 = 0;
+int32_t s_fixLonE7 = 0;
+// Pending first fix of the current start
+bool s_waitingFix = false;
+uint32_t s_startMs = 0;
+GnssStartMode s_startMode = GnssStartMode::COLD;
+bool s_startXtra = false;
+GnssAssistStats s_stats = {};
+
+uint32_t recordCrc(const Record& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), offsetof(Record, crc));
+}
+
+void load() {
+    s_loaded = true;
+    Preferences p;
+    if (!p.begin(kNamespace, true)) return;
+    Record r{};
+    if (p.getBytes(kKey, &r, sizeof(r)) == sizeof(r) && r.magic == kMagic && r.crc == recordCrc(r)) {
+        s_saved = r.state;
+    }
+    p.end();
+}
+
+bool save(const Persisted& state) {
+    Record r{};
+    r.magic = kMagic;
+    r.state = state;
+    r.crc = recordCrc(r);
+    Preferences p;
+    bool ok = p.begin(kNamespace, false);
+    if (ok) {
+        ok = p.putBytes(kKey, &r, sizeof(r)) == sizeof(r);
+        p.end();
+    }
+    if (ok) s_saved = state;
+    return ok;
+}
+
+bool xtraValid() {
+    return s_saved.xtraUtcS > 0 && time_utc_valid() &&
+           time_utc_s() - s_saved.xtraUtcS < (int64_t)GNSS_ASSIST_XTRA_VALID_S;
+}
+
+// Age of the newest fix, this boot's or the persisted one; false when unknown
+bool fixAgeMs(uint32_t now, uint64_t& ageMs) {
+    if (s_lastFixMs) {
+        ageMs = now - s_lastFixMs;
+        return true;
+    }
+    if (s_saved.fixUtcS <= 0 || !time_utc_valid()) return false;
+    const int64_t age = time_utc_s() - s_saved.fixUtcS;
+    if (age < 0) return false;
+    ageMs = (uint64_t)age * 1000ULL;
+    return true;
+}
+
+void recordTtff(GnssAssistTtff& t, uint32_t ms) {
+    t.avgMs = t.fixes ? (t.avgMs * 3 + ms) / 4 : ms;
+    t.fixes++;
+    t.lastMs = ms;
+    if (ms > t.maxMs) t.maxMs = ms;
+}
+
+void finishDownload(ModemDownloadState state, int httpStatus, uint32_t bytes, uint32_t now) {
+    s_downloading = false;
+    s_stats.lastHttpStatus = state == ModemDownloadState::DONE ? httpStatus : -1;
+    s_stats.lastBytes = bytes;
+    data_usage_tx(TransportPathId::Http, DATA_USAGE_HTTP_TX_OVERHEAD);
+    if (state == ModemDownloadState::DONE && httpStatus == 200 && bytes > 0 && time_utc_valid()) {
+        data_usage_rx(TransportPathId::Http, bytes + DATA_USAGE_HTTP_RX_OVERHEAD);
+        Persisted next = s_saved;
+        next.xtraUtcS = time_utc_s();
+        next.xtraBytes = bytes;
+        if (!save(next)) s_saved = next;      // kept for this boot at least
+        s_injected = false;
+        s_stats.downloads++;
+        logbuf_printf("GNSS: XTRA file downloaded, %lu bytes", (unsigned long)bytes);
+        return;
+    }
+    s_stats.downloadFailures++;
+    s_retryAtMs = now + GNSS_ASSIST_RETRY_MS;
+    logbuf_printf("GNSS: XTRA download failed (HTTP %d)", s_stats.lastHttpStatus);
+}
+} // namespace
+
+void gnss_assist_plan(GnssAssistPlan& out, uint32_t now) {
+    if (!s_loaded) load();
+    out = GnssAssistPlan{};
+    uint64_t ageMs = 0;
+    if (!fixAgeMs(now, ageMs)) {
+        out.mode = GnssStartMode::COLD;
+    } else if (ageMs < RF_ARB_HOT_MAX_FIX_AGE_MS) {
+        out.mode = GnssStartMode::HOT;
+    } else if (ageMs < RF_ARB_WARM_MAX_FIX_AGE_MS) {
+        out.mode = GnssStartMode::WARM;
+    } else {
+        out.mode = GnssStartMode::COLD;
+    }
+
+    out.injectXtra = !s_injected && xtraValid();
+    if (out.injectXtra) {
+        const time_t utc = (time_t)time_utc_s();
+        struct tm t;
+        gmtime_r(&utc, &t);
+        snprintf(out.clock, sizeof(out.clock), "%02d/%02d/%02d,%02d:%02d:%02d+00", t.tm_year % 100,
+                 t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+    }
+}
+
+void gnss_assist_started(const GnssAssistPlan& plan, bool xtraInjected, uint32_t now) {
+    if (plan.injectXtra) {
+        if (xtraInjected) {
+            s_injected = true;
+            s_stats.injections++;
+        } else {
+            s_stats.injectFailures++;
+        }
+    }
+    s_waitingFix = true;
+    s_startMs = now;
+    s_startMode = plan.mode;
+    s_startXtra = s_injected && xtraValid();
+    s_stats.modes[(size_t)plan.mode].starts++;
+    if (s_startXtra) s_stats.xtra.starts++;
+}
+
+void gnss_assist_fix(double latitude, double longitude, uint32_t now) {
+    if (!s_loaded) load();
+    if (s_waitingFix) {
+        s_waitingFix = false;
+        const uint32_t ttff = now - s_startMs;
+        recordTtff(s_stats.modes[(size_t)s_startMode], ttff);
+        if (s_startXtra) recordTtff(s_stats.xtra, ttff);
+    }
+    s_lastFixMs = now ? now : 1;
+    s_fixLatE7 = (int32_t)(latitude * 1e7);
+    s_fixLonE7 = (int32_t)(longitude * 1e7);
+
+    // Without UTC the fix can't be aged after a reset
+    if (!time_utc_valid()) return;
+    const int64_t utc = time_utc_s();
+    if (s_saved.fixUtcS > 0 && utc - s_saved.fixUtcS < GNSS_ASSIST_FIX_SAVE_S) return;
+    Persisted next = s_saved;
+    next.fixLatE7 = s_fixLatE7;
+    next.fixLonE7 = s_fixLonE7;
+    next.fixUtcS = utc;
+    (void)save(next);
+}
+
+void gnss_assist_poll(CatMGNSSModule* module, bool connected, uint32_t now) {
+    if (!module) return;
+    if (!s_loaded) load();
+    if (s_downloading) {
+        int httpStatus = 0;
+        uint32_t bytes = 0;
+        const ModemDownloadState state = module->pollFileDownload(httpStatus, bytes);
+        if (state == ModemDownloadState::PENDING) return;
+        finishDownload(state, httpStatus, bytes, now);
+        return;
+    }
+
+    // The file's age needs UTC; without it a download could repeat every boot
+    if (!connected || !time_utc_valid() || (int32_t)(now - s_retryAtMs) < 0) return;
+    if (s_saved.xtraUtcS > 0 && time_utc_s() - s_saved.xtraUtcS < (int64_t)GNSS_ASSIST_XTRA_REFRESH_S) return;
+    if (module->startFileDownload(GNSS_ASSIST_XTRA_URL, GNSS_ASSIST_XTRA_PATH)) {
+        s_downloading = true;
+    } else {
+        s_stats.downloadFailures++;
+        s_retryAtMs = now + GNSS_ASSIST_RETRY_MS;
+    }
+}
+
+bool gnss_assist_busy() {
+    return s_downloading;
+}
+
+void gnss_assist_stats(GnssAssistStats& out) {
+    out = s_stats;
+    out.xtraUtcS = s_saved.xtraUtcS;
+    out.xtraValid = xtraValid();
+    out.xtraInjected = s_injected;
+    out.fixKnown = s_lastFixMs != 0 || s_saved.fixUtcS > 0;
+    out.fixLatE7 = s_lastFixMs ? s_fixLatE7 : s_saved.fixLatE7;
+    out.fixLonE7 = s_lastFixMs ? s_fixLonE7 : s_saved.fixLonE7;
+    out.fixUtcS = s_saved.fixUtcS;
+}
+
+void gnss_assist_report(Print& out) {
+    GnssAssistStats s;
+    gnss_assist_stats(s);
+    const long xtraAgeS = s.xtraUtcS > 0 && time_utc_valid() ? (long)(time_utc_s() - s.xtraUtcS) : -1;
+    out.printf("GNSS assist: XTRA %s, age %ld s, %s; downloads %lu, failed %lu (last HTTP %d, %lu bytes)%s\n",
+               s.xtraUtcS ? (s.xtraValid ? "valid" : "expired") : "none", xtraAgeS,
+               s.xtraInjected ? "injected" : "not injected", (unsigned long)s.downloads,
+               (unsigned long)s.downloadFailures, s.lastHttpStatus, (unsigned long)s.lastBytes,
+               s_downloading ? ", downloading" : "");
+    out.printf("  injections %lu, failed %lu; ", (unsigned long)s.injections, (unsigned long)s.injectFailures);
+    if (s.fixKnown) {
+        out.printf("last fix %.5f %.5f, saved at utc %lld\n", s.fixLatE7 / 1e7, s.fixLonE7 / 1e7,
+                   (long long)s.fixUtcS);
+    } else {
+        out.println("no fix yet");
+    }
+    for (size_t i = 0; i < 4; i++) {
+        const GnssAssistTtff& t = i < 3 ? s.modes[i] : s.xtra;
+        if (!t.starts) continue;
+        out.printf("  TTFF %-5s %lu starts, %lu fixes, last %lu ms, avg %lu ms, max %lu ms\n",
+                   i < 3 ? RfArbiter::startModeName((GnssStartMode)i) : "xtra", (unsigned long)t.starts,
+                   (unsigned long)t.fixes, (unsigned long)t.lastMs, (unsigned long)t.avgMs,
+                   (unsigned long)t.maxMs);
+    }
+}
+
+#endif // GNSS_ASSIST_ENABLE
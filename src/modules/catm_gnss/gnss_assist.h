@@ -0,0 +1,113 @@
+/*
+ * GNSS Assistance
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * Cuts time-to-first-fix with what the modem can be given before the
+ * receiver powers on:
+ *   - XTRA predicted orbits: while the data session owns the radio the modem
+ *     downloads GNSS_ASSIST_XTRA_URL into its own file system (AT+HTTPTOFS),
+ *     so nothing crosses the UART. The download time is kept in NVS; the file
+ *     counts as valid for GNSS_ASSIST_XTRA_VALID_S and is fetched again after
+ *     GNSS_ASSIST_XTRA_REFRESH_S. A valid file not yet injected this boot is
+ *     copied into the engine (AT+CGNSCPY, AT+CGNSXTRA=1) at the next
+ *     power-on, after the modem clock is set from the time service: XTRA is
+ *     useless without time.
+ *   - last fix: position and UTC time go to NVS every GNSS_ASSIST_FIX_SAVE_S
+ *     of fixes, so after a reset the start mode still follows the age of the
+ *     last fix (the RF_ARB_*_MAX_FIX_AGE_MS limits): powered on as it was
+ *     while the ephemeris is fresh, warm while the almanac and time are
+ *     useful, cold otherwise. The SIM7080G takes no reference position, so
+ *     the position itself is reported, not injected.
+ * Time-to-first-fix is recorded per start mode and for XTRA-assisted starts.
+ */
+
+#ifndef GNSS_ASSIST_H
+#define GNSS_ASSIST_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+#include "rf_arbiter.h"
+
+#ifndef GNSS_ASSIST_XTRA_URL
+#define GNSS_ASSIST_XTRA_URL "http://iot1.xtracloud.net/xtra3gr_72h.bin"
+#endif
+#ifndef GNSS_ASSIST_XTRA_PATH
+#define GNSS_ASSIST_XTRA_PATH "/customer/Xtra3.bin"     // where AT+CGNSCPY looks for it
+#endif
+#ifndef GNSS_ASSIST_XTRA_VALID_S
+#define GNSS_ASSIST_XTRA_VALID_S (72UL * 3600UL)
+#endif
+#ifndef GNSS_ASSIST_XTRA_REFRESH_S
+#define GNSS_ASSIST_XTRA_REFRESH_S (24UL * 3600UL)
+#endif
+#ifndef GNSS_ASSIST_RETRY_MS
+#define GNSS_ASSIST_RETRY_MS (30UL * 60UL * 1000UL)       // after a failed download
+#endif
+#ifndef GNSS_ASSIST_FIX_SAVE_S
+#define GNSS_ASSIST_FIX_SAVE_S 900                        // NVS writes of the last fix at most this often
+#endif
+
+class CatMGNSSModule;
+
+struct GnssAssistPlan {
+    GnssStartMode mode;
+    bool injectXtra;         // a valid XTRA file not yet in the engine
+    char clock[24];          // AT+CCLK value "yy/MM/dd,hh:mm:ss+00", empty to leave the modem clock
+};
+
+struct GnssAssistTtff {
+    uint32_t starts;
+    uint32_t fixes;          // starts that reached a fix
+    uint32_t lastMs;
+    uint32_t avgMs;          // recent weighted
+    uint32_t maxMs;
+};
+
+struct GnssAssistStats {
+    uint32_t downloads;
+    uint32_t downloadFailures;
+    int lastHttpStatus;      // 0 = none yet, -1 = no answer
+    uint32_t lastBytes;
+    int64_t xtraUtcS;        // download time of the cached file, 0 = none
+    bool xtraValid;
+    bool xtraInjected;       // this boot
+    uint32_t injections;
+    uint32_t injectFailures;
+    bool fixKnown;
+    int32_t fixLatE7;
+    int32_t fixLonE7;
+    int64_t fixUtcS;         // 0 = time of the fix unknown
+    GnssAssistTtff modes[3]; // by GnssStartMode
+    GnssAssistTtff xtra;     // XTRA-assisted starts, any mode
+};
+
+#if GNSS_ASSIST_ENABLE
+
+// Modem task, right before the receiver powers on
+void gnss_assist_plan(GnssAssistPlan& out, uint32_t now);
+// After the power-on: xtraInjected tells whether the copy asked for took
+void gnss_assist_started(const GnssAssistPlan& plan, bool xtraInjected, uint32_t now);
+// Modem task, every new valid fix
+void gnss_assist_fix(double latitude, double longitude, uint32_t now);
+// Modem task while GNSS is off: starts a due download when connected and
+// completes one in flight either way
+void gnss_assist_poll(CatMGNSSModule* module, bool connected, uint32_t now);
+// A download holds the radio; GNSS waits for it
+bool gnss_assist_busy();
+
+void gnss_assist_stats(GnssAssistStats& out);
+void gnss_assist_report(Print& out);
+
+#else
+
+inline void gnss_assist_plan(GnssAssistPlan& out, uint32_t) { out = GnssAssistPlan{GnssStartMode::HOT, false, {}}; }
+inline void gnss_assist_started(const GnssAssistPlan&, bool, uint32_t) {}
+inline void gnss_assist_fix(double, double, uint32_t) {}
+inline void gnss_assist_poll(CatMGNSSModule*, bool, uint32_t) {}
+inline bool gnss_assist_busy() { return false; }
+inline void gnss_assist_stats(GnssAssistStats& out) { out = GnssAssistStats{}; }
+inline void gnss_assist_report(Print&) {}
+
+#endif // GNSS_ASSIST_ENABLE
+
+#endif // GNSS_ASSIST_H
@@ -0,0 +1,246 @@
+/*
+ * Modem Command Queue Implementation
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ */
+
+#include "modem_command_queue.h"
+#include "catm_gnss_module.h"
+#include "config/task_config.h"
+#include "system/kernel_objects.h"
+#include <cstring>
+
+namespace {
+struct SyncWait {
+    StaticSemaphore_t semBuf;
+    SemaphoreHandle_t done;
+    char* out;
+    size_t outSize;
+    M5_SIM7080G::Status status;
+};
+
+void syncCompletion(const ModemCmdResult& result, void* ctx) {
+    SyncWait* w = static_cast<SyncWait*>(ctx);
+    if (!w) return;
+    w->status = result.status;
+    if (w->out && w->outSize > 0) {
+        const size_t n = min(w->outSize - 1, result.responseLen);
+        memcpy(w->out, result.response, n);
+        w->out[n] = '\0';
+    }
+    xSemaphoreGive(w->done);
+}
+} // namespace
+
+ModemCommandQueue::ModemCommandQueue()
+    : modem_(nullptr), serialMutex_(nullptr), queue_(nullptr), taskHandle_(nullptr), stopRequested_(false) {
+    memset(&stats_, 0, sizeof(stats_));
+    response_[0] = '\0';
+}
+
+ModemCommandQueue::~ModemCommandQueue() {
+    end();
+}
+
+bool ModemCommandQueue::begin(M5_SIM7080G* modem, SemaphoreHandle_t serialMutex) {
+    if (taskHandle_) return true;
+    if (!modem || !serialMutex) return false;
+
+    modem_ = modem;
+    serialMutex_ = serialMutex;
+    if (!queue_) {
+        static_assert(sizeof(Request) <= QUEUE_ITEM_BYTES_MODEM_CMD, "Request outgrew its queue slot");
+        queue_ = kernel_queue_create(KernelQueue::ModemCmd, sizeof(Request));
+        if (!queue_) {
+            Serial.println("ModemQueue: Failed to create queue");
+            return false;
+        }
+    }
+
+    stopRequested_ = false;
+    BaseType_t result = kernel_task_create(
+        KernelTask::ModemIO,
+        ioTask,
+        this,
+        TASK_PRIORITY_MODEM_IO,
+        &taskHandle_,
+        0  // Core 0 (same as CatMGNSS)
+    );
+    if (result != pdPASS) {
+        taskHandle_ = nullptr;
+        Serial.println("ModemQueue: Failed to start I/O task");
+        return false;
+    }
+    Serial.println("ModemQueue: I/O task started");
+    return true;
+}
+
+void ModemCommandQueue::end() {
+    if (!taskHandle_) return;
+    stopRequested_ = true;
+    // The task drains outstanding requests (completing them) before exiting
+    for (int i = 0; i < 50 && taskHandle_; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+bool ModemCommandQueue::isIoTask() const {
+    return taskHandle_ && xTaskGetCurrentTaskHandle() == taskHandle_;
+}
+
+bool ModemCommandQueue::submit(const char* command, uint32_t timeoutMs, ModemCmdPriority priority,
+                               ModemCmdCallback cb, void* ctx, TickType_t enqueueWait) {
+    if (!queue_ || !taskHandle_ || stopRequested_ || !command || !cb) {
+        stats_.rejected++;
+        return false;
+    }
+    const size_t len = strlen(command);
+    if (len == 0 || len >= MODEM_CMD_MAX_COMMAND_LEN) {
+        stats_.rejected++;
+        return false;
+    }
+
+    Request req;
+    memcpy(req.command, command, len + 1);
+    req.timeoutMs = timeoutMs;
+    req.cb = cb;
+    req.ctx = ctx;
+    req.batch = nullptr;
+    req.batchCount = 0;
+    return enqueue(req, priority, enqueueWait);
+}
+
+bool ModemCommandQueue::enqueue(Request& req, ModemCmdPriority priority, TickType_t enqueueWait) {
+    req.submittedMs = millis();
+    BaseType_t ok = (priority == ModemCmdPriority::HIGH)
+        ? xQueueSendToFront(queue_, &req, enqueueWait)
+        : xQueueSendToBack(queue_, &req, enqueueWait);
+    if (ok != pdTRUE) {
+        stats_.rejected++;
+        return false;
+    }
+    stats_.submitted++;
+    return true;
+}
+
+bool ModemCommandQueue::execute(const char* command, char* response, size_t responseSize, uint32_t timeoutMs,
+                                ModemCmdPriority priority, M5_SIM7080G::Status* statusOut) {
+    if (isIoTask()) {
+        // Would deadlock waiting on ourselves
+        return false;
+    }
+
+    SyncWait w;
+    w.done = xSemaphoreCreateBinaryStatic(&w.semBuf);
+    w.out = response;
+    w.outSize = responseSize;
+    w.status = M5_SIM7080G::Status::Timeout;
+    if (response && responseSize > 0) response[0] = '\0';
+
+    if (!submit(command, timeoutMs, priority, syncCompletion, &w, pdMS_TO_TICKS(QUEUE_TIMEOUT_MS))) {
+        vSemaphoreDelete(w.done);
+        return false;
+    }
+
+    // Every accepted request is completed by the I/O task (expired, drained on stop or
+    // executed), so waiting without a limit cannot leave the callback pointing at a dead frame.
+    xSemaphoreTake(w.done, portMAX_DELAY);
+    vSemaphoreDelete(w.done);
+
+    if (statusOut) *statusOut = w.status;
+    return w.status == M5_SIM7080G::Status::Ok || w.status == M5_SIM7080G::Status::Error;
+}
+
+bool ModemCommandQueue::executeBatch(sim7080g::AtBatchItem* items, size_t count, ModemCmdPriority priority) {
+    if (!items || count == 0 || isIoTask() || !queue_ || !taskHandle_ || stopRequested_) return false;
+
+    SyncWait w;
+    w.done = xSemaphoreCreateBinaryStatic(&w.semBuf);
+    w.out = nullptr;
+    w.outSize = 0;
+    w.status = M5_SIM7080G::Status::Timeout;
+
+    Request req;
+    req.command[0] = '\0';
+    req.timeoutMs = 0;
+    req.cb = syncCompletion;
+    req.ctx = &w;
+    req.batch = items;
+    req.batchCount = count;
+    if (!enqueue(req, priority, pdMS_TO_TICKS(QUEUE_TIMEOUT_MS))) {
+        vSemaphoreDelete(w.done);
+        return false;
+    }
+
+    xSemaphoreTake(w.done, portMAX_DELAY);
+    vSemaphoreDelete(w.done);
+    return w.status == M5_SIM7080G::Status::Ok;
+}
+
+void ModemCommandQueue::complete(const Request& req, M5_SIM7080G::Status status, uint32_t queuedMs, uint32_t elapsedMs,
+                                 const char* response, size_t responseLen) {
+    ModemCmdResult result;
+    result.status = status;
+    result.queuedMs = queuedMs;
+    result.elapsedMs = elapsedMs;
+    result.response = response ? response : "";
+    result.responseLen = response ? responseLen : 0;
+    req.cb(result, req.ctx);
+    stats_.completed++;
+}
+
+void ModemCommandQueue::process(const Request& req) {
+    const uint32_t dispatchMs = millis();
+    const uint32_t queuedMs = dispatchMs - req.submittedMs;
+    if (queuedMs > stats_.maxQueuedMs) stats_.maxQueuedMs = queuedMs;
+
+    if (queuedMs > MODEM_CMD_MAX_QUEUE_WAIT_MS) {
+        stats_.expired++;
+        complete(req, M5_SIM7080G::Status::Timeout, queuedMs, 0, nullptr, 0);
+        return;
+    }
+
+    // Hold the UART only for the duration of this command so direct users
+    // (GNSS/HTTP helpers) interleave at command granularity.
+    MutexGuard guard(serialMutex_);
+    if (!guard.acquired()) {
+        complete(req, M5_SIM7080G::Status::TransportError, queuedMs, 0, nullptr, 0);
+        return;
+    }
+
+    if (req.batch) {
+        modem_->sendBatch(req.batch, req.batchCount);
+        M5_SIM7080G::Status status = M5_SIM7080G::Status::Ok;
+        for (size_t i = 0; i < req.batchCount; i++) {
+            const sim7080g::AtBatchItem& item = req.batch[i];
+            if (item.required && !item.ok) {
+                status = item.executed ? M5_SIM7080G::Status::Error : M5_SIM7080G::Status::Timeout;
+                break;
+            }
+        }
+        complete(req, status, queuedMs, millis() - dispatchMs, nullptr, 0);
+        return;
+    }
+
+    // Reply lands directly in the task-owned buffer; nothing on this path touches the heap
+    M5_SIM7080G::Status status = modem_->sendCommandInto(req.command, response_, sizeof(response_), req.timeoutMs, true);
+    complete(req, status, queuedMs, millis() - dispatchMs, response_, strlen(response_));
+}
+
+void ModemCommandQueue::ioTask(void* pvParameters) {
+    ModemCommandQueue* self = static_cast<ModemCommandQueue*>(pvParameters);
+    Request req;
+
+    while (!self->stopRequested_) {
+        if (xQueueReceive(self->queue_, &req, pdMS_TO_TICKS(250)) == pdTRUE) {
+            self->process(req);
+        }
+    }
+
+    // Complete anything still queued so blocked execute() callers return
+    while (xQueueReceive(self->queue_, &req, 0) == pdTRUE) {
+        self->complete(req, M5_SIM7080G::Status::TransportError, millis() - req.submittedMs, 0, nullptr, 0);
+    }
+
+    self->taskHandle_ = nullptr;
+    vTaskDelete(NULL);
+}
@@ -0,0 +1,106 @@
+/*
+ * Modem Command Queue
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * Single modem I/O task that owns the AT command stream. Callers submit
+ * commands with a timeout and priority and are completed through a callback
+ * (or block in execute()) instead of holding serialMutex for the whole wait.
+ */
+
+#ifndef MODEM_COMMAND_QUEUE_H
+#define MODEM_COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <M5_SIM7080G.h>
+
+// ============================================================================
+// MODEM COMMAND QUEUE CONFIGURATION
+// ============================================================================
+#define MODEM_CMD_MAX_COMMAND_LEN   160
+#define MODEM_CMD_MAX_RESPONSE_LEN  512
+#define MODEM_CMD_MAX_QUEUE_WAIT_MS 10000   // Requests older than this are expired unsent
+
+enum class ModemCmdPriority : uint8_t {
+    NORMAL = 0,
+    HIGH = 1     // Jumps the queue (link checks, time-critical polls)
+};
+
+struct ModemCmdResult {
+    M5_SIM7080G::Status status;
+    uint32_t queuedMs;       // time spent waiting for the I/O task
+    uint32_t elapsedMs;      // time spent on the wire
+    const char* response;    // valid only for the duration of the callback
+    size_t responseLen;
+};
+
+// Runs on the modem I/O task. Keep it short; copy what you need out of result.
+typedef void (*ModemCmdCallback)(const ModemCmdResult& result, void* ctx);
+
+struct ModemCmdStats {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t expired;
+    uint32_t rejected;
+    uint32_t maxQueuedMs;
+};
+
+class ModemCommandQueue {
+public:
+    ModemCommandQueue();
+    ~ModemCommandQueue();
+
+    bool begin(M5_SIM7080G* modem, SemaphoreHandle_t serialMutex);
+    void end();
+    bool isRunning() const { return taskHandle_ != nullptr; }
+    // True when called from the I/O task itself (callers must not block on execute() there)
+    bool isIoTask() const;
+
+    // Asynchronous submit. Returns false if the queue is full or not running;
+    // otherwise the callback is guaranteed to run exactly once.
+    bool submit(const char* command, uint32_t timeoutMs, ModemCmdPriority priority,
+                ModemCmdCallback cb, void* ctx, TickType_t enqueueWait = 0);
+
+    // Blocking helper built on submit(). Copies the response (NUL-terminated).
+    bool execute(const char* command, char* response, size_t responseSize, uint32_t timeoutMs,
+                 ModemCmdPriority priority = ModemCmdPriority::NORMAL,
+                 M5_SIM7080G::Status* statusOut = nullptr);
+
+    // Blocking batch (M5_SIM7080G::sendBatch) run on the I/O task while holding the UART once.
+    // Returns true when every required item succeeded; per-item results are written back.
+    bool executeBatch(sim7080g::AtBatchItem* items, size_t count,
+                      ModemCmdPriority priority = ModemCmdPriority::NORMAL);
+
+    ModemCmdStats getStats() const { return stats_; }
+    UBaseType_t pending() const { return queue_ ? uxQueueMessagesWaiting(queue_) : 0; }
+
+private:
+    struct Request {
+        char command[MODEM_CMD_MAX_COMMAND_LEN];
+        uint32_t timeoutMs;
+        uint32_t submittedMs;
+        ModemCmdCallback cb;
+        void* ctx;
+        sim7080g::AtBatchItem* batch;   // non-null: run as a batch instead of command
+        size_t batchCount;
+    };
+
+    bool enqueue(Request& req, ModemCmdPriority priority, TickType_t enqueueWait);
+    static void ioTask(void* pvParameters);
+    void process(const Request& req);
+    void complete(const Request& req, M5_SIM7080G::Status status, uint32_t queuedMs, uint32_t elapsedMs,
+                  const char* response, size_t responseLen);
+
+    M5_SIM7080G* modem_;
+    SemaphoreHandle_t serialMutex_;
+    QueueHandle_t queue_;
+    TaskHandle_t taskHandle_;
+    volatile bool stopRequested_;
+    ModemCmdStats stats_;
+    char response_[MODEM_CMD_MAX_RESPONSE_LEN + 1];
+};
+
+#endif // MODEM_COMMAND_QUEUE_H
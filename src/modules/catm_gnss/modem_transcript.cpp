@@ -0,0 +1,540 @@
+#include "modem_transcript.h"
+
+#if MODEM_TRANSCRIPT_MODE && ENABLE_SD
+
+#include <M5_SIM7080G.h>
+#include "../storage/storage_task.h"
+#include "../logging/log_buffer.h"
+#include "../../system/mutex_profiler.h"
+#include "../../system/time_service.h"
+#include <SD.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+constexpr size_t kRecordHeader = 6;                 // time, length | flags
+
+struct __attribute__((packed)) FileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerBytes;
+    uint32_t baud;
+    uint64_t wallUs;
+};
+
+} // namespace
+
+#if MODEM_TRANSCRIPT_MODE == MODEM_TRANSCRIPT_RECORD
+
+namespace {
+
+struct RecordStats {
+    uint32_t records;
+    uint32_t bytes;            // appended to the ring, record headers included
+    uint32_t lostBytes;        // ring full
+    uint32_t written;          // on the card
+    uint32_t writeErrors;
+    uint32_t maxWriteUs;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+uint8_t* s_ring = nullptr;
+uint32_t s_head = 0;           // bytes appended, under s_mux
+uint32_t s_tail = 0;           // bytes on the card, under s_mux
+bool s_lostPending = false;    // under s_mux
+bool s_stopped = false;        // MODEM_TRANSCRIPT_MAX_BYTES reached, under s_mux
+RecordStats s_stats = {};      // under s_mux
+int64_t s_startUs = 0;
+uint32_t s_baud = 0;
+
+// Storage task
+File s_file;
+bool s_fileOpen = false;
+bool s_headerWritten = false;
+uint32_t s_retryAtMs = 0;
+
+void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Under s_mux
+void ringWrite(const uint8_t* p, size_t n) {
+    const uint32_t at = s_head % MODEM_TRANSCRIPT_RING_BYTES;
+    const size_t first = n < MODEM_TRANSCRIPT_RING_BYTES - at ? n : MODEM_TRANSCRIPT_RING_BYTES - at;
+    memcpy(s_ring + at, p, first);
+    memcpy(s_ring, p + first, n - first);
+    s_head += n;
+}
+
+void append(bool tx, uint32_t timeUs, const uint8_t* data, size_t n) {
+    uint8_t hdr[kRecordHeader];
+    put32(hdr, timeUs);
+    portENTER_CRITICAL(&s_mux);
+    if (s_stopped) {
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    if (s_stats.bytes + kRecordHeader + n > MODEM_TRANSCRIPT_MAX_BYTES) {
+        s_stopped = true;
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    if (kRecordHeader + n > MODEM_TRANSCRIPT_RING_BYTES - (s_head - s_tail)) {
+        s_stats.lostBytes += n;
+        s_lostPending = true;
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    put16(hdr + 4, (uint16_t)(n | (tx ? MODEM_TRANSCRIPT_TX : 0) | (s_lostPending ? MODEM_TRANSCRIPT_LOST : 0)));
+    s_lostPending = false;
+    ringWrite(hdr, sizeof(hdr));
+    ringWrite(data, n);
+    s_stats.records++;
+    s_stats.bytes += kRecordHeader + n;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// Runs inside the library's reads and writes, under the modem serial mutex
+void tap(bool tx, const uint8_t* data, size_t len, void*) {
+    const uint32_t timeUs = (uint32_t)(esp_timer_get_time() - s_startUs);
+    while (len > 0) {
+        const size_t n = len > MODEM_TRANSCRIPT_LEN_MASK ? MODEM_TRANSCRIPT_LEN_MASK : len;
+        append(tx, timeUs, data, n);
+        data += n;
+        len -= n;
+    }
+}
+
+// Caller holds g_sdMutex. A reopen after an error appends to what is there.
+bool openFile() {
+    if (s_fileOpen) return true;
+    if (SD.cardType() == CARD_NONE || (!SD.exists(MODEM_TRANSCRIPT_DIR) && !SD.mkdir(MODEM_TRANSCRIPT_DIR))) {
+        return false;
+    }
+    s_file = SD.open(MODEM_TRANSCRIPT_RECORD_PATH, s_headerWritten ? "a" : "w");
+    if (!s_file) return false;
+    if (!s_headerWritten) {
+        FileHeader h = {};
+        h.magic = MODEM_TRANSCRIPT_MAGIC;
+        h.version = MODEM_TRANSCRIPT_VERSION;
+        h.headerBytes = sizeof(h);
+        h.baud = s_baud;
+        h.wallUs = (uint64_t)time_utc_us();
+        if (s_file.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) != sizeof(h)) {
+            s_file.close();
+            return false;
+        }
+        s_headerWritten = true;
+    }
+    s_fileOpen = true;
+    return true;
+}
+
+} // namespace
+
+bool modem_transcript_attach(M5_SIM7080G& modem) {
+    if (!s_ring) {
+        s_ring = static_cast<uint8_t*>(malloc(MODEM_TRANSCRIPT_RING_BYTES));
+        if (!s_ring) {
+            logbuf_printf("modem transcript: no memory for the %u byte ring", (unsigned)MODEM_TRANSCRIPT_RING_BYTES);
+            return false;
+        }
+        s_startUs = esp_timer_get_time();
+        s_baud = modem.baudRate();
+        logbuf_printf("modem transcript: recording to %s", MODEM_TRANSCRIPT_RECORD_PATH);
+    }
+    modem.setTap(tap, nullptr);
+    return false;
+}
+
+uint32_t modem_transcript_drain(uint32_t nowMs) {
+    if (!s_ring) return UINT32_MAX;
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t head = s_head;
+    const uint32_t tail = s_tail;
+    const bool stopped = s_stopped;
+    portEXIT_CRITICAL(&s_mux);
+    if (head == tail && !(stopped && s_fileOpen)) return stopped ? UINT32_MAX : MODEM_TRANSCRIPT_DRAIN_MS;
+    if (s_retryAtMs != 0 && (int32_t)(nowMs - s_retryAtMs) < 0) return MODEM_TRANSCRIPT_DRAIN_MS;
+    if (!mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) return MODEM_TRANSCRIPT_DRAIN_MS;
+
+    uint32_t done = tail;
+    uint32_t errors = 0;
+    uint32_t maxUs = 0;
+    if (openFile()) {
+        while (done != head) {
+            const uint32_t at = done % MODEM_TRANSCRIPT_RING_BYTES;
+            const size_t n = head - done < MODEM_TRANSCRIPT_RING_BYTES - at ? head - done
+                                                                            : MODEM_TRANSCRIPT_RING_BYTES - at;
+            const uint32_t t0 = micros();
+            if (s_file.write(s_ring + at, n) != n) {
+                s_file.close();
+                s_fileOpen = false;
+                errors++;
+                break;
+            }
+            const uint32_t us = micros() - t0;
+            if (us > maxUs) maxUs = us;
+            done += n;
+        }
+        if (done != tail && s_fileOpen) s_file.flush();
+    } else {
+        errors++;
+    }
+    const bool finished = stopped && done == head && s_fileOpen;
+    if (finished) {
+        s_file.close();
+        s_fileOpen = false;
+    }
+    mutex_give(g_sdMutex);
+    if (errors) s_retryAtMs = (nowMs + STORAGE_REOPEN_RETRY_MS) | 1;
+
+    portENTER_CRITICAL(&s_mux);
+    s_tail = done;
+    s_stats.written += done - tail;
+    s_stats.writeErrors += errors;
+    if (maxUs > s_stats.maxWriteUs) s_stats.maxWriteUs = maxUs;
+    const uint32_t written = s_stats.written;
+    portEXIT_CRITICAL(&s_mux);
+    if (finished) {
+        logbuf_printf("modem transcript: stopped at %lu KB", (unsigned long)(written >> 10));
+        return UINT32_MAX;
+    }
+    return MODEM_TRANSCRIPT_DRAIN_MS;
+}
+
+void modem_transcript_report(Print& out) {
+    if (!s_ring) return;
+    portENTER_CRITICAL(&s_mux);
+    const RecordStats s = s_stats;
+    const bool stopped = s_stopped;
+    portEXIT_CRITICAL(&s_mux);
+    out.printf("Modem transcript: %s, %lu records, %lu of %lu KB on the card, %lu bytes lost, "
+               "%lu write errors, max write %lu us\n",
+               stopped ? "stopped" : "recording", (unsigned long)s.records, (unsigned long)(s.written >> 10),
+               (unsigned long)(s.bytes >> 10), (unsigned long)s.lostBytes, (unsigned long)s.writeErrors,
+               (unsigned long)s.maxWriteUs);
+}
+
+#elif MODEM_TRANSCRIPT_MODE == MODEM_TRANSCRIPT_REPLAY
+
+namespace {
+
+constexpr size_t kPendingWrites = 8;
+
+struct PendingWrite {
+    uint32_t crc;
+    uint32_t len;
+    int64_t atUs;
+};
+
+struct Milestone {
+    const char* name;
+    bool seen;
+    uint64_t recordedUs;       // since the recording started
+    int64_t replayedUs;        // since the replay started
+};
+
+struct ReplayStats {
+    uint32_t records;
+    uint32_t writes;
+    uint32_t matched;
+    uint32_t diverged;
+    uint32_t firstDivergence;  // record number of the first write that differed
+    uint32_t rxBytes;
+    uint32_t sdStalls;         // read-ahead waited out on g_sdMutex
+    bool done;
+    uint64_t recordedUs;       // span of the transcript
+    int64_t replayedUs;        // time the firmware took through it
+};
+
+// All on the CatM side: the library calls the backend under the modem serial mutex
+File s_file;
+bool s_open = false;
+bool s_eof = false;
+uint8_t s_buf[MODEM_TRANSCRIPT_READ_BYTES];
+size_t s_bufLen = 0;
+size_t s_bufPos = 0;
+sim7080g::IoBackend s_backend;
+int64_t s_startUs = 0;
+
+// Record under the cursor
+bool s_haveRec = false;
+bool s_recTx = false;
+bool s_recMqtt = false;        // a recorded AT+SMCONN
+uint16_t s_recLen = 0;
+uint16_t s_recPos = 0;
+uint32_t s_recCrc = 0;
+uint64_t s_recUs = 0;
+uint32_t s_lastRawUs = 0;
+uint64_t s_wrapUs = 0;
+
+// A received chunk is due this long after the write it followed in the recording
+int64_t s_anchorReplayUs = 0;
+uint64_t s_anchorRecUs = 0;
+
+PendingWrite s_pending[kPendingWrites];
+uint32_t s_pendHead = 0;
+uint32_t s_pendTail = 0;
+bool s_awaitMqttOk = false;
+char s_line[48];               // received line being assembled, for the milestones
+size_t s_lineLen = 0;
+
+Milestone s_milestones[] = {
+    {"attach", false, 0, 0},
+    {"first fix", false, 0, 0},
+    {"mqtt", false, 0, 0},
+};
+ReplayStats s_stats = {};
+
+uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t get32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// At least n unread bytes in the read-ahead; false at the end of the file or
+// when the card is busy past STORAGE_SD_LOCK_MS
+bool ensure(size_t n) {
+    if (s_bufLen - s_bufPos >= n) return true;
+    if (s_eof) return false;
+    memmove(s_buf, s_buf + s_bufPos, s_bufLen - s_bufPos);
+    s_bufLen -= s_bufPos;
+    s_bufPos = 0;
+    if (!mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) {
+        s_stats.sdStalls++;
+        return false;
+    }
+    const int got = s_file.read(s_buf + s_bufLen, sizeof(s_buf) - s_bufLen);
+    mutex_give(g_sdMutex);
+    if (got <= 0) {
+        s_eof = true;
+    } else {
+        s_bufLen += (size_t)got;
+    }
+    return s_bufLen - s_bufPos >= n;
+}
+
+void finish() {
+    if (s_stats.done) return;
+    s_stats.done = true;
+    s_stats.recordedUs = s_recUs;
+    s_stats.replayedUs = esp_timer_get_time() - s_startUs;
+    s_haveRec = false;
+    logbuf_printf("modem replay: done, %lu/%lu writes matched, %lu ms recorded, %lu ms replayed",
+                  (unsigned long)s_stats.matched, (unsigned long)s_stats.writes,
+                  (unsigned long)(s_stats.recordedUs / 1000), (unsigned long)(s_stats.replayedUs / 1000));
+}
+
+void mark(size_t i, int64_t nowUs) {
+    Milestone& m = s_milestones[i];
+    if (m.seen) return;
+    m.seen = true;
+    m.recordedUs = s_recUs;
+    m.replayedUs = nowUs - s_startUs;
+}
+
+bool startsWith(const char* line, const char* prefix) {
+    return strncmp(line, prefix, strlen(prefix)) == 0;
+}
+
+// Received bytes, assembled into lines however the recording split them
+void noteMilestones(const uint8_t* data, size_t n, int64_t nowUs) {
+    for (size_t i = 0; i < n; i++) {
+        const char c = (char)data[i];
+        if (c != '\n') {
+            if (c != '\r' && s_lineLen < sizeof(s_line) - 1) s_line[s_lineLen++] = c;
+            continue;
+        }
+        s_line[s_lineLen] = '\0';
+        s_lineLen = 0;
+        if (startsWith(s_line, "+APP PDP: 0,ACTIVE") || startsWith(s_line, "+CNACT: 0,1")) mark(0, nowUs);
+        if (startsWith(s_line, "+CGNSINF: 1,1")) mark(1, nowUs);
+        if (s_awaitMqttOk && (startsWith(s_line, "OK") || strstr(s_line, "ERROR"))) {
+            if (s_line[0] == 'O') mark(2, nowUs);
+            s_awaitMqttOk = false;
+        }
+    }
+}
+
+// Moves past recorded writes the firmware has made. Leaves the cursor on a
+// received chunk, on a recorded write not made yet, or at the end.
+void advance() {
+    for (;;) {
+        if (!s_haveRec) {
+            if (!ensure(kRecordHeader)) {
+                if (s_eof) finish();
+                return;
+            }
+            const uint8_t* h = s_buf + s_bufPos;
+            const uint32_t raw = get32(h);
+            const uint16_t len = get16(h + 4);
+            s_bufPos += kRecordHeader;
+            if (raw < s_lastRawUs) s_wrapUs += 1ULL << 32;
+            s_lastRawUs = raw;
+            s_recUs = s_wrapUs + raw;
+            s_recTx = (len & MODEM_TRANSCRIPT_TX) != 0;
+            s_recLen = len & MODEM_TRANSCRIPT_LEN_MASK;
+            s_recPos = 0;
+            s_recCrc = 0;
+            s_recMqtt = false;
+            s_haveRec = s_recLen > 0;
+            s_stats.records++;
+            continue;
+        }
+        if (!s_recTx || s_pendHead == s_pendTail) return;
+
+        while (s_recPos < s_recLen) {
+            if (!ensure(1)) {
+                if (s_eof) finish();
+                return;
+            }
+            const uint8_t* p = s_buf + s_bufPos;
+            size_t n = s_bufLen - s_bufPos;
+            if (n > (size_t)(s_recLen - s_recPos)) n = s_recLen - s_recPos;
+            if (s_recPos == 0) s_recMqtt = n >= 9 && memcmp(p, "AT+SMCONN", 9) == 0;
+            s_recCrc = esp_rom_crc32_le(s_recCrc, p, n);
+            s_bufPos += n;
+            s_recPos += n;
+        }
+        const PendingWrite& w = s_pending[s_pendTail % kPendingWrites];
+        s_pendTail++;
+        if (w.len == s_recLen && w.crc == s_recCrc) {
+            s_stats.matched++;
+        } else if (s_stats.diverged++ == 0) {
+            s_stats.firstDivergence = s_stats.records;
+        }
+        s_anchorReplayUs = w.atUs;
+        s_anchorRecUs = s_recUs;
+        if (s_recMqtt) s_awaitMqttOk = true;
+        s_haveRec = false;
+    }
+}
+
+bool rxDue(int64_t nowUs) {
+    return s_haveRec && !s_recTx && nowUs >= s_anchorReplayUs + (int64_t)(s_recUs - s_anchorRecUs);
+}
+
+int replayRead(void*, uint8_t* buf, size_t maxLen, uint32_t timeoutMs) {
+    const int64_t deadline = esp_timer_get_time() + (int64_t)timeoutMs * 1000;
+    for (;;) {
+        advance();
+        const int64_t now = esp_timer_get_time();
+        if (rxDue(now) && ensure(1)) {
+            size_t n = s_bufLen - s_bufPos;
+            if (n > (size_t)(s_recLen - s_recPos)) n = s_recLen - s_recPos;
+            if (n > maxLen) n = maxLen;
+            memcpy(buf, s_buf + s_bufPos, n);
+            s_bufPos += n;
+            s_recPos += n;
+            if (s_recPos == s_recLen) s_haveRec = false;
+            s_stats.rxBytes += n;
+            noteMilestones(buf, n, now);
+            return (int)n;
+        }
+        if (now >= deadline) return 0;
+        int64_t waitUs = deadline - now;
+        if (s_haveRec && !s_recTx) {
+            const int64_t dueUs = s_anchorReplayUs + (int64_t)(s_recUs - s_anchorRecUs) - now;
+            if (dueUs > 0 && dueUs < waitUs) waitUs = dueUs;
+        }
+        TickType_t ticks = pdMS_TO_TICKS((uint32_t)((waitUs + 999) / 1000));
+        vTaskDelay(ticks ? ticks : 1);
+    }
+}
+
+bool replayWrite(void*, const uint8_t* buf, size_t len) {
+    if (s_pendHead - s_pendTail >= kPendingWrites) {
+        advance();
+        if (s_pendHead - s_pendTail >= kPendingWrites) {
+            // The firmware keeps writing without reading what the recording answered
+            s_pendTail++;
+            if (s_stats.diverged++ == 0) s_stats.firstDivergence = s_stats.records;
+        }
+    }
+    PendingWrite& w = s_pending[s_pendHead % kPendingWrites];
+    w.crc = esp_rom_crc32_le(0, buf, len);
+    w.len = (uint32_t)len;
+    w.atUs = esp_timer_get_time();
+    s_pendHead++;
+    s_stats.writes++;
+    return true;
+}
+
+int replayAvailable(void*) {
+    advance();
+    return rxDue(esp_timer_get_time()) ? (int)(s_recLen - s_recPos) : 0;
+}
+
+} // namespace
+
+bool modem_transcript_attach(M5_SIM7080G& modem) {
+    if (!s_open) {
+        FileHeader h = {};
+        bool ok = false;
+        if (mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) {
+            if (SD.cardType() != CARD_NONE) s_file = SD.open(MODEM_TRANSCRIPT_REPLAY_PATH, "r");
+            ok = s_file && s_file.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h) &&
+                 h.magic == MODEM_TRANSCRIPT_MAGIC && h.version == MODEM_TRANSCRIPT_VERSION &&
+                 h.headerBytes >= sizeof(h) && s_file.seek(h.headerBytes);
+            if (!ok && s_file) s_file.close();
+            mutex_give(g_sdMutex);
+        }
+        if (!ok) {
+            logbuf_printf("modem replay: no transcript at %s, using the modem", MODEM_TRANSCRIPT_REPLAY_PATH);
+            return false;
+        }
+        s_backend.read = replayRead;
+        s_backend.write = replayWrite;
+        s_backend.available = replayAvailable;
+        s_backend.ctx = nullptr;
+        s_startUs = esp_timer_get_time();
+        s_anchorReplayUs = s_startUs;
+        s_anchorRecUs = 0;
+        s_open = true;
+        logbuf_printf("modem replay: %s, recorded at %lu baud", MODEM_TRANSCRIPT_REPLAY_PATH, (unsigned long)h.baud);
+    }
+    modem.setBackend(&s_backend);
+    return true;
+}
+
+uint32_t modem_transcript_drain(uint32_t) {
+    return UINT32_MAX;
+}
+
+void modem_transcript_report(Print& out) {
+    if (!s_open) return;
+    const int64_t replayedUs = s_stats.done ? s_stats.replayedUs : esp_timer_get_time() - s_startUs;
+    out.printf("Modem replay: %s, %lu records, %lu/%lu writes matched", s_stats.done ? "done" : "running",
+               (unsigned long)s_stats.records, (unsigned long)s_stats.matched, (unsigned long)s_stats.writes);
+    if (s_stats.diverged) {
+        out.printf(" (%lu differ, first at record %lu)", (unsigned long)s_stats.diverged,
+                   (unsigned long)s_stats.firstDivergence);
+    }
+    out.printf(", %lu ms recorded / %lu ms replayed", (unsigned long)((s_stats.done ? s_stats.recordedUs : s_recUs) / 1000),
+               (unsigned long)(replayedUs / 1000));
+    for (const Milestone& m : s_milestones) {
+        if (!m.seen) continue;
+        out.printf("; %s %lu/%lu ms", m.name, (unsigned long)(m.recordedUs / 1000), (unsigned long)(m.replayedUs / 1000));
+    }
+    out.printf(", %lu SD stalls\n", (unsigned long)s_stats.sdStalls);
+}
+
+#else
+#error "MODEM_TRANSCRIPT_MODE is 0, MODEM_TRANSCRIPT_RECORD or MODEM_TRANSCRIPT_REPLAY"
+#endif // MODEM_TRANSCRIPT_MODE
+
+#endif // MODEM_TRANSCRIPT_MODE && ENABLE_SD
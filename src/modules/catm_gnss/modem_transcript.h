@@ -0,0 +1,85 @@
+/*
+ * Modem Transcript
+ * Records the bytes exchanged with the SIM7080G and replays them in place of
+ * the modem, so AT-path changes can be compared on identical traffic: slow
+ * replies, URC bursts and lines split across reads included.
+ *
+ * MODEM_TRANSCRIPT_MODE (build flag, config/system_config.h):
+ *   RECORD  every chunk the library reads or writes from CatMGNSSModule::begin()
+ *           on goes to MODEM_TRANSCRIPT_RECORD_PATH. The library tap appends to
+ *           a RAM ring under a spinlock; the storage task writes the ring out
+ *           every MODEM_TRANSCRIPT_DRAIN_MS. Bytes that find the ring full are
+ *           counted and flagged on the next record. Recording stops at
+ *           MODEM_TRANSCRIPT_MAX_BYTES.
+ *   REPLAY  MODEM_TRANSCRIPT_REPLAY_PATH stands in for the UART and the rest of
+ *           the firmware runs unchanged. A received chunk becomes readable as
+ *           long after the preceding write as it arrived in the recording; each
+ *           write is checked (length, CRC) against the next recorded one, so a
+ *           replay whose command sequence diverged is visible. The report puts
+ *           recorded and replayed times of the attach, the first fix and the
+ *           MQTT connect side by side; the mutex profiler has the ModemSerial
+ *           hold times for the same run.
+ * Copy a recording to the replay path to replay it.
+ *
+ * File (little endian):
+ *   header  "GMTR", u16 version, u16 header bytes, u32 baud,
+ *           u64 wall-clock us at open (0 = unset)
+ *   records u32 time us since the recording started (wraps after 71 minutes;
+ *           replay unwraps it), u16 length | 0x8000 for TX | 0x4000 when bytes
+ *           were lost before this record, then the bytes.
+ */
+
+#ifndef MODEM_TRANSCRIPT_H
+#define MODEM_TRANSCRIPT_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+
+#define MODEM_TRANSCRIPT_RECORD 1
+#define MODEM_TRANSCRIPT_REPLAY 2
+
+#ifndef MODEM_TRANSCRIPT_DIR
+#define MODEM_TRANSCRIPT_DIR "/modem"
+#endif
+#ifndef MODEM_TRANSCRIPT_RECORD_PATH
+#define MODEM_TRANSCRIPT_RECORD_PATH MODEM_TRANSCRIPT_DIR "/record.mtr"
+#endif
+#ifndef MODEM_TRANSCRIPT_REPLAY_PATH
+#define MODEM_TRANSCRIPT_REPLAY_PATH MODEM_TRANSCRIPT_DIR "/replay.mtr"
+#endif
+#ifndef MODEM_TRANSCRIPT_RING_BYTES
+#define MODEM_TRANSCRIPT_RING_BYTES 16384  // about a second of 115200 baud both ways
+#endif
+#ifndef MODEM_TRANSCRIPT_MAX_BYTES
+#define MODEM_TRANSCRIPT_MAX_BYTES (8UL * 1024UL * 1024UL)
+#endif
+#define MODEM_TRANSCRIPT_DRAIN_MS 100
+#define MODEM_TRANSCRIPT_READ_BYTES 2048  // replay read-ahead, one SD read
+
+#define MODEM_TRANSCRIPT_MAGIC 0x52544D47u  // "GMTR"
+#define MODEM_TRANSCRIPT_VERSION 1
+#define MODEM_TRANSCRIPT_TX 0x8000
+#define MODEM_TRANSCRIPT_LOST 0x4000
+#define MODEM_TRANSCRIPT_LEN_MASK 0x3FFF
+
+class M5_SIM7080G;
+
+#if MODEM_TRANSCRIPT_MODE && ENABLE_SD
+
+// CatMGNSSModule::begin(): installs the recording tap or the replay backend.
+// True when the transcript replaces the UART, which then stays closed.
+bool modem_transcript_attach(M5_SIM7080G& modem);
+// Storage task: writes recorded bytes out. Returns the longest the task may
+// wait before the next call (UINT32_MAX when not recording).
+uint32_t modem_transcript_drain(uint32_t nowMs);
+void modem_transcript_report(Print& out);
+
+#else
+
+inline bool modem_transcript_attach(M5_SIM7080G&) { return false; }
+inline uint32_t modem_transcript_drain(uint32_t) { return UINT32_MAX; }
+inline void modem_transcript_report(Print&) {}
+
+#endif
+
+#endif // MODEM_TRANSCRIPT_H
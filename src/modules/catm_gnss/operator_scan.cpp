@@ -0,0 +1,339 @@
+#include "operator_scan.h"
+
+#if OPERATOR_SCAN_ENABLE
+
+#include "attach_cache.h"
+#include "catm_gnss_module.h"
+#include "../logging/log_buffer.h"
+#include "../../system/time_service.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+constexpr const char* kNamespace = "catm_scan";
+constexpr const char* kKey = "ops";
+constexpr uint32_t kMagic = 0x3153504F;      // "OPS1"
+constexpr size_t kMaxBands = 32;             // bits of OperatorScanEntry::bandMask
+
+struct Persisted {
+    char bands[64];          // the modem's CAT-M list, put back after every chunk
+    uint8_t nextBand;
+    uint8_t inPass;
+    uint8_t bandLocked;      // a chunk may have left the list narrowed
+    uint8_t count;           // of results
+    uint8_t pendingCount;    // of the pass in progress
+    int64_t completedUtcS;
+    OperatorScanEntry results[OPERATOR_SCAN_MAX_OPS];   // last complete pass
+    OperatorScanEntry pending[OPERATOR_SCAN_MAX_OPS];   // gathered by the pass in progress
+};
+
+struct Record {
+    uint32_t magic;
+    Persisted state;
+    uint32_t crc;            // CRC-32 of everything above
+};
+
+// Written by the CatM task only; other tasks copy it under s_mux
+Persisted s_saved = {};
+bool s_loaded = false;
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+bool s_restorePending = false;   // the band list could not be put back yet
+volatile bool s_requested = false;
+bool s_passThisBoot = false;
+uint32_t s_completedMs = 0;      // millis() of a pass completed this boot, 0 = none
+uint32_t s_retryAtMs = 0;
+uint32_t s_chunks = 0;
+uint32_t s_aborted = 0;
+uint32_t s_failed = 0;
+uint32_t s_passes = 0;
+uint32_t s_lastChunkMs = 0;
+
+uint32_t recordCrc(const Record& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), offsetof(Record, crc));
+}
+
+void commit(const Persisted& state) {
+    portENTER_CRITICAL(&s_mux);
+    s_saved = state;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void load() {
+    s_loaded = true;
+    Preferences p;
+    if (!p.begin(kNamespace, true)) return;
+    Record r{};
+    if (p.getBytes(kKey, &r, sizeof(r)) == sizeof(r) && r.magic == kMagic && r.crc == recordCrc(r)) {
+        r.state.bands[sizeof(r.state.bands) - 1] = '\0';
+        if (r.state.count > OPERATOR_SCAN_MAX_OPS) r.state.count = 0;
+        if (r.state.pendingCount > OPERATOR_SCAN_MAX_OPS) r.state.pendingCount = 0;
+        commit(r.state);
+        s_restorePending = r.state.bandLocked && r.state.bands[0];
+    }
+    p.end();
+}
+
+bool save(const Persisted& state) {
+    Record r{};
+    r.magic = kMagic;
+    r.state = state;
+    r.crc = recordCrc(r);
+    Preferences p;
+    bool ok = p.begin(kNamespace, false);
+    if (ok) {
+        ok = p.putBytes(kKey, &r, sizeof(r)) == sizeof(r);
+        p.end();
+    }
+    commit(state);           // kept for this boot even when NVS failed
+    return ok;
+}
+
+// Band number at position index of a "1,2,3,..." list, 0 past the end
+uint8_t bandAt(const char* list, size_t index) {
+    const char* p = list;
+    for (size_t i = 0; i < index && p; i++) {
+        p = strchr(p, ',');
+        if (p) p++;
+    }
+    return p && *p ? (uint8_t)atoi(p) : 0;
+}
+
+size_t bandCount(const char* list) {
+    if (!list[0]) return 0;
+    size_t n = 1;
+    for (const char* p = list; *p; p++) {
+        if (*p == ',') n++;
+    }
+    return n < kMaxBands ? n : kMaxBands;
+}
+
+bool fresh(uint32_t now) {
+    if (s_completedMs && now - s_completedMs < OPERATOR_SCAN_FRESH_S * 1000UL) return true;
+    return s_saved.completedUtcS > 0 && time_utc_valid() &&
+           time_utc_s() - s_saved.completedUtcS < (int64_t)OPERATOR_SCAN_FRESH_S;
+}
+
+bool restoreBands(CatMGNSSModule* module) {
+    if (!module->setCatmBands(s_saved.bands)) {
+        s_restorePending = true;
+        return false;
+    }
+    s_restorePending = false;
+    return true;
+}
+
+void merge(Persisted& state, const sim7080g::OperatorInfo* ops, size_t count, size_t bandIndex) {
+    const int64_t utc = time_utc_valid() ? time_utc_s() : 0;
+    for (size_t i = 0; i < count; i++) {
+        const sim7080g::OperatorInfo& op = ops[i];
+        if (!op.numeric[0]) continue;
+        OperatorScanEntry* e = nullptr;
+        for (size_t j = 0; j < state.pendingCount; j++) {
+            if (state.pending[j].act == op.act && strcmp(state.pending[j].plmn, op.numeric) == 0) {
+                e = &state.pending[j];
+                break;
+            }
+        }
+        if (!e) {
+            if (state.pendingCount >= OPERATOR_SCAN_MAX_OPS) continue;
+            e = &state.pending[state.pendingCount++];
+            *e = OperatorScanEntry{};
+            strlcpy(e->plmn, op.numeric, sizeof(e->plmn));
+            strlcpy(e->name, op.long_name, sizeof(e->name));
+            e->act = op.act;
+            e->stat = op.stat;
+        } else if (e->stat != 2) {
+            // The serving operator shows as current on every band it is locked into
+            e->stat = op.stat;
+        }
+        e->bandMask |= 1UL << bandIndex;
+        e->seenUtcS = utc;
+    }
+}
+
+void finishPass(Persisted& next, uint32_t now) {
+    memcpy(next.results, next.pending, sizeof(next.results));
+    next.count = next.pendingCount;
+    next.pendingCount = 0;
+    next.inPass = 0;
+    next.nextBand = 0;
+    next.completedUtcS = time_utc_valid() ? time_utc_s() : 0;
+    s_requested = false;
+    s_passThisBoot = true;
+    s_completedMs = now ? now : 1;
+    s_passes++;
+    logbuf_printf("CatM: operator scan done, %u operators on %u bands", (unsigned)next.count,
+                  (unsigned)bandCount(next.bands));
+}
+} // namespace
+
+void operator_scan_begin(CatMGNSSModule* module) {
+    if (!s_loaded) load();
+    if (!module || !s_restorePending) return;
+    if (restoreBands(module)) {
+        Persisted next = s_saved;
+        next.bandLocked = 0;
+        (void)save(next);
+        logbuf_printf("CatM: CAT-M bands restored after an interrupted scan");
+    }
+}
+
+bool operator_scan_wanted(uint32_t now) {
+    if (!s_loaded) load();
+    if (s_restorePending) return true;
+    if ((int32_t)(now - s_retryAtMs) < 0) return false;
+    if (s_saved.inPass || s_requested) return true;
+    // Without UTC a pass can't be aged: once per boot
+    if (!time_utc_valid() || s_saved.completedUtcS <= 0) return !s_passThisBoot;
+    return time_utc_s() - s_saved.completedUtcS >= (int64_t)OPERATOR_SCAN_INTERVAL_S;
+}
+
+void operator_scan_request() {
+    s_requested = true;
+}
+
+void operator_scan_poll(CatMGNSSModule* module, uint32_t now, bool (*abort)(void*), void* ctx) {
+    if (!module || !operator_scan_wanted(now)) return;
+    if (s_restorePending) {
+        if (!restoreBands(module)) {
+            s_retryAtMs = now + OPERATOR_SCAN_RETRY_MS;
+            return;
+        }
+        Persisted next = s_saved;
+        next.bandLocked = 0;
+        (void)save(next);
+    }
+
+    Persisted next = s_saved;
+    if (!next.inPass) {
+        char bands[sizeof(next.bands)];
+        if (!module->getCatmBands(bands, sizeof(bands))) {
+            s_failed++;
+            s_retryAtMs = now + OPERATOR_SCAN_RETRY_MS;
+            return;
+        }
+        strlcpy(next.bands, bands, sizeof(next.bands));
+        next.inPass = 1;
+        next.nextBand = 0;
+        next.pendingCount = 0;
+    }
+    const size_t bands = bandCount(next.bands);
+    const uint8_t band = bandAt(next.bands, next.nextBand);
+    if (next.nextBand >= bands || band == 0) {
+        finishPass(next, now);
+        (void)save(next);
+        return;
+    }
+
+    // The serving band stays allowed so the registration survives the chunk
+    AttachCache cache{};
+    char lock[8];
+    if (attach_cache_get(cache) && cache.band && cache.band != band) {
+        snprintf(lock, sizeof(lock), "%u,%u", (unsigned)band, (unsigned)cache.band);
+    } else {
+        snprintf(lock, sizeof(lock), "%u", (unsigned)band);
+    }
+
+    // One NVS write per chunk: marked narrowed before the lock, with the last chunk's
+    // results. A stale mark after a clean restore only costs one AT+CBANDCFG at boot.
+    next.bandLocked = 1;
+    (void)save(next);
+    const uint32_t start = millis();
+    if (!module->setCatmBands(lock)) {
+        s_failed++;
+        s_retryAtMs = now + OPERATOR_SCAN_RETRY_MS;
+        (void)restoreBands(module);
+        return;
+    }
+    sim7080g::OperatorInfo ops[OPERATOR_SCAN_MAX_OPS];
+    size_t count = 0;
+    const ModemScanResult result =
+        module->scanOperators(ops, OPERATOR_SCAN_MAX_OPS, count, OPERATOR_SCAN_CHUNK_TIMEOUT_MS, abort, ctx);
+    if (restoreBands(module)) next.bandLocked = 0;
+    s_lastChunkMs = millis() - start;
+    s_chunks++;
+
+    switch (result) {
+        case ModemScanResult::DONE:
+            merge(next, ops, count, next.nextBand);
+            next.nextBand++;
+            break;
+        case ModemScanResult::ABORTED:
+            // Same band again at the next slot
+            s_aborted++;
+            break;
+        case ModemScanResult::FAILED:
+            s_failed++;
+            next.nextBand++;
+            s_retryAtMs = now + OPERATOR_SCAN_RETRY_MS;
+            break;
+    }
+    if (next.nextBand >= bands) {
+        finishPass(next, now);
+        (void)save(next);
+    } else {
+        commit(next);
+    }
+}
+
+bool operator_scan_get(OperatorScanStats& out) {
+    if (!s_loaded) load();
+    out = OperatorScanStats{};
+    portENTER_CRITICAL(&s_mux);
+    memcpy(out.bands, s_saved.bands, sizeof(out.bands));
+    out.nextBand = s_saved.nextBand;
+    out.inProgress = s_saved.inPass;
+    out.completedUtcS = s_saved.completedUtcS;
+    out.count = s_saved.count;
+    memcpy(out.entries, s_saved.results, sizeof(out.entries));
+    portEXIT_CRITICAL(&s_mux);
+    out.bandCount = (uint8_t)bandCount(out.bands);
+    out.fresh = fresh(millis());
+    out.chunks = s_chunks;
+    out.aborted = s_aborted;
+    out.failed = s_failed;
+    out.passes = s_passes;
+    out.lastChunkMs = s_lastChunkMs;
+    return out.fresh;
+}
+
+bool operator_scan_find(const char* plmn, OperatorScanEntry& out) {
+    if (!plmn || !plmn[0]) return false;
+    OperatorScanStats s;
+    if (!operator_scan_get(s)) return false;
+    // The CAT-M entry first, any other RAT otherwise
+    bool found = false;
+    for (size_t i = 0; i < s.count; i++) {
+        if (strcmp(s.entries[i].plmn, plmn) != 0) continue;
+        if (!found || s.entries[i].act == 7) out = s.entries[i];
+        found = true;
+    }
+    return found;
+}
+
+void operator_scan_report(Print& out) {
+    OperatorScanStats s;
+    operator_scan_get(s);
+    const long ageS = s.completedUtcS > 0 && time_utc_valid() ? (long)(time_utc_s() - s.completedUtcS) : -1;
+    out.printf("Operator scan: %u operators, %s, age %ld s; %lu passes, %lu chunks (%lu aborted, %lu failed, "
+               "last %lu ms)",
+               (unsigned)s.count, s.fresh ? "fresh" : "stale", ageS, (unsigned long)s.passes,
+               (unsigned long)s.chunks, (unsigned long)s.aborted, (unsigned long)s.failed,
+               (unsigned long)s.lastChunkMs);
+    if (s.inProgress) out.printf(", band %u/%u", (unsigned)s.nextBand + 1, (unsigned)s.bandCount);
+    out.println(s_restorePending ? ", bands not restored" : "");
+    for (size_t i = 0; i < s.count; i++) {
+        const OperatorScanEntry& e = s.entries[i];
+        out.printf("  %-7s %-20s %s act %u, bands", e.plmn, e.name,
+                   e.stat == 2 ? "current  " : e.stat == 3 ? "forbidden" : "available", (unsigned)e.act);
+        for (size_t b = 0; b < s.bandCount; b++) {
+            if (e.bandMask & (1UL << b)) out.printf(" %u", (unsigned)bandAt(s.bands, b));
+        }
+        out.println();
+    }
+}
+
+#endif // OPERATOR_SCAN_ENABLE
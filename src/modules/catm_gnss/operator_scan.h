@@ -0,0 +1,101 @@
+/*
+ * Operator Scan
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * Keeps a cached list of the operators in reach (AT+COPS=?) for carrier
+ * selection, without ever stalling the uplink for the minutes a full scan
+ * takes:
+ *   - the scan runs only in the RF arbiter's SCAN slot: data session idle and
+ *     a fresh fix in hand (rf_arbiter.h);
+ *   - it is split into chunks, one CAT-M band each: the bands are locked to
+ *     that band plus the serving one (attach cache) so the registration
+ *     stays, AT+COPS=? runs, and the modem's own band list is put back
+ *     straight after. The list is in NVS while a chunk holds it narrowed, so
+ *     a reset mid-chunk restores it at the next operator_scan_begin();
+ *   - a chunk is aborted as soon as uplink data or a GNSS request is waiting,
+ *     and that band is scanned again in the next slot.
+ * Results, with the UTC time and the bands each operator was seen on, are in
+ * NVS. A full pass is due every OPERATOR_SCAN_INTERVAL_S, once per boot while
+ * UTC is unknown, or on operator_scan_request(). Results are fresh for
+ * OPERATOR_SCAN_FRESH_S.
+ */
+
+#ifndef OPERATOR_SCAN_H
+#define OPERATOR_SCAN_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+
+#ifndef OPERATOR_SCAN_MAX_OPS
+#define OPERATOR_SCAN_MAX_OPS 8
+#endif
+#ifndef OPERATOR_SCAN_INTERVAL_S
+#define OPERATOR_SCAN_INTERVAL_S (24UL * 3600UL)
+#endif
+#ifndef OPERATOR_SCAN_FRESH_S
+#define OPERATOR_SCAN_FRESH_S (72UL * 3600UL)
+#endif
+#ifndef OPERATOR_SCAN_CHUNK_TIMEOUT_MS
+#define OPERATOR_SCAN_CHUNK_TIMEOUT_MS 45000UL     // AT+COPS=? on a single band
+#endif
+#ifndef OPERATOR_SCAN_RETRY_MS
+#define OPERATOR_SCAN_RETRY_MS (10UL * 60UL * 1000UL)     // after a failed chunk
+#endif
+
+class CatMGNSSModule;
+
+struct OperatorScanEntry {
+    char plmn[8];            // MCC and MNC digits
+    char name[20];
+    uint8_t stat;            // as AT+COPS=?: 1 available, 2 current, 3 forbidden
+    uint8_t act;             // 7 CAT-M, 9 NB-IoT
+    uint32_t bandMask;       // bit per position in OperatorScanStats::bands
+    int64_t seenUtcS;        // 0 = time unknown
+};
+
+struct OperatorScanStats {
+    char bands[64];          // the modem's CAT-M band list, "1,2,3,..."
+    uint8_t bandCount;
+    uint8_t nextBand;        // chunk to run next of the current pass
+    bool inProgress;
+    bool fresh;              // the last complete pass is younger than OPERATOR_SCAN_FRESH_S
+    int64_t completedUtcS;   // 0 = no complete pass
+    uint32_t chunks;         // this boot
+    uint32_t aborted;
+    uint32_t failed;
+    uint32_t passes;
+    uint32_t lastChunkMs;
+    uint8_t count;
+    OperatorScanEntry entries[OPERATOR_SCAN_MAX_OPS];
+};
+
+#if OPERATOR_SCAN_ENABLE
+
+// CatM task, once the modem is up: puts back a band list left narrowed by a reset
+void operator_scan_begin(CatMGNSSModule* module);
+// CatM task: a chunk is due (feeds RfArbiterInputs::scanWanted)
+bool operator_scan_wanted(uint32_t now);
+// CatM task, in the SCAN slot: runs one chunk; abort is polled while the modem scans
+void operator_scan_poll(CatMGNSSModule* module, uint32_t now, bool (*abort)(void*), void* ctx);
+// Any task: start a pass at the next SCAN slot
+void operator_scan_request();
+
+// Whether the last complete pass is fresh; out gets its results
+bool operator_scan_get(OperatorScanStats& out);
+// A fresh result for the PLMN, false when not seen or not fresh
+bool operator_scan_find(const char* plmn, OperatorScanEntry& out);
+void operator_scan_report(Print& out);
+
+#else
+
+inline void operator_scan_begin(CatMGNSSModule*) {}
+inline bool operator_scan_wanted(uint32_t) { return false; }
+inline void operator_scan_poll(CatMGNSSModule*, uint32_t, bool (*)(void*), void*) {}
+inline void operator_scan_request() {}
+inline bool operator_scan_get(OperatorScanStats& out) { out = OperatorScanStats{}; return false; }
+inline bool operator_scan_find(const char*, OperatorScanEntry&) { return false; }
+inline void operator_scan_report(Print&) {}
+
+#endif // OPERATOR_SCAN_ENABLE
+
+#endif // OPERATOR_SCAN_H
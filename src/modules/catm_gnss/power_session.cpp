@@ -0,0 +1,312 @@
+/*
+ * CatM Power Session Manager Implementation
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ */
+
+#include "power_session.h"
+#include "catm_gnss_module.h"
+#include "config/task_config.h"
+#include <cstring>
+#include <strings.h>
+
+namespace {
+struct TimerUnit {
+    uint8_t code;      // bits 8..6 of the timer IE
+    uint32_t seconds;
+};
+
+// Ascending so the finest unit that fits is chosen
+const TimerUnit kT3412Units[] = {
+    {0b011, 2}, {0b100, 30}, {0b101, 60}, {0b000, 600}, {0b001, 3600}, {0b010, 36000}, {0b110, 1152000},
+};
+const TimerUnit kT3324Units[] = {
+    {0b000, 2}, {0b001, 60}, {0b010, 360},
+};
+
+bool encodeTimer(const TimerUnit* units, size_t count, uint32_t seconds, char out[9]) {
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t value = (seconds + units[i].seconds - 1) / units[i].seconds;
+        if (value <= 31) {
+            const uint8_t ie = static_cast<uint8_t>((units[i].code << 5) | value);
+            for (int b = 0; b < 8; ++b) {
+                out[b] = (ie & (0x80 >> b)) ? '1' : '0';
+            }
+            out[8] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t decodeTimer(const TimerUnit* units, size_t count, const char* bits) {
+    if (!bits || strlen(bits) < 8) return 0;
+    uint8_t ie = 0;
+    for (int b = 0; b < 8; ++b) {
+        if (bits[b] != '0' && bits[b] != '1') return 0;
+        ie = static_cast<uint8_t>((ie << 1) | (bits[b] == '1'));
+    }
+    const uint8_t code = ie >> 5;
+    const uint8_t value = ie & 0x1F;
+    for (size_t i = 0; i < count; ++i) {
+        if (units[i].code == code) return units[i].seconds * value;
+    }
+    return 0;  // deactivated / reserved
+}
+
+// Copies the n-th (0-based) double-quoted field of line into out
+bool quotedField(const char* line, int index, char* out, size_t outSize) {
+    const char* p = line;
+    for (int i = 0; p && *p; ++i) {
+        const char* open = strchr(p, '"');
+        if (!open) return false;
+        const char* close = strchr(open + 1, '"');
+        if (!close) return false;
+        if (i == index) {
+            const size_t n = min(static_cast<size_t>(close - open - 1), outSize - 1);
+            memcpy(out, open + 1, n);
+            out[n] = '\0';
+            return true;
+        }
+        p = close + 1;
+    }
+    return false;
+}
+
+sim7080g::AtBatchItem batchItem(const char* command, uint32_t timeoutMs, bool required) {
+    sim7080g::AtBatchItem item;
+    item.command = command;
+    item.timeout_ms = timeoutMs;
+    item.required = required;
+    return item;
+}
+} // namespace
+
+bool CatMPowerSession::encodeT3412(uint32_t seconds, char out[9]) {
+    return encodeTimer(kT3412Units, sizeof(kT3412Units) / sizeof(kT3412Units[0]), seconds, out);
+}
+
+bool CatMPowerSession::encodeT3324(uint32_t seconds, char out[9]) {
+    return encodeTimer(kT3324Units, sizeof(kT3324Units) / sizeof(kT3324Units[0]), seconds, out);
+}
+
+uint32_t CatMPowerSession::decodeT3412(const char* bits) {
+    return decodeTimer(kT3412Units, sizeof(kT3412Units) / sizeof(kT3412Units[0]), bits);
+}
+
+uint32_t CatMPowerSession::decodeT3324(const char* bits) {
+    return decodeTimer(kT3324Units, sizeof(kT3324Units) / sizeof(kT3324Units[0]), bits);
+}
+
+CatMPowerSession::CatMPowerSession()
+    : modem_(nullptr), serialMutex_(nullptr), state_(PowerSessionState::DISABLED), modemReportedPsm_(false),
+      lastActivityMs_(0), sleepStartMs_(0), nextWindowMs_(0) {
+    memset(&grant_, 0, sizeof(grant_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+bool CatMPowerSession::begin(M5_SIM7080G* modem, SemaphoreHandle_t serialMutex) {
+#if CATM_PSM_ENABLE
+    if (!modem || !serialMutex) return false;
+    modem_ = modem;
+    serialMutex_ = serialMutex;
+
+    MutexGuard guard(serialMutex_);
+    if (!guard.acquired()) return false;
+    modem_->registerUrcHandler("+CPSMSTATUS", onPsmStatusUrc, this);
+    // PSM enter/exit notifications (best-effort; older firmware lacks CPSMSTATUS)
+    (void)modem_->sendCommandInto("AT+CPSMSTATUS=1", nullptr, 0, 1000, true);
+
+    state_ = PowerSessionState::AWAKE;
+    lastActivityMs_ = millis();
+    Serial.println("CatM+PSM: power session manager enabled");
+    return true;
+#else
+    (void)modem;
+    (void)serialMutex;
+    return false;
+#endif
+}
+
+void CatMPowerSession::end() {
+    if (state_ == PowerSessionState::DISABLED) return;
+    if (modem_) {
+        MutexGuard guard(serialMutex_);
+        if (guard.acquired()) {
+            modem_->unregisterUrcHandler("+CPSMSTATUS");
+        }
+    }
+    state_ = PowerSessionState::DISABLED;
+}
+
+void CatMPowerSession::onPsmStatusUrc(const char* line, size_t len, void* ctx) {
+    CatMPowerSession* self = static_cast<CatMPowerSession*>(ctx);
+    if (!self) return;
+    // +CPSMSTATUS: "ENTER PSM" / "EXIT PSM" (wording varies by firmware)
+    for (size_t i = 0; i + 4 <= len; ++i) {
+        if (i + 5 <= len && strncasecmp(line + i, "ENTER", 5) == 0) {
+            self->modemReportedPsm_ = true;
+            self->stats_.psmEnterUrcs++;
+            return;
+        }
+        if (strncasecmp(line + i, "EXIT", 4) == 0) {
+            self->modemReportedPsm_ = false;
+            self->stats_.psmExitUrcs++;
+            return;
+        }
+    }
+}
+
+bool CatMPowerSession::negotiate() {
+    if (state_ == PowerSessionState::DISABLED || !modem_) return false;
+
+    char tau[9];
+    char active[9];
+    if (!encodeT3412(CATM_PSM_TAU_S, tau) || !encodeT3324(CATM_PSM_ACTIVE_S, active)) {
+        Serial.println("CatM+PSM: requested timers out of range");
+        return false;
+    }
+
+    sim7080g::FixedString<64> psmCmd;
+    psmCmd.append("AT+CPSMS=1,,,").appendQuoted(tau).append(',').appendQuoted(active);
+    sim7080g::FixedString<40> edrxCmd;
+#if CATM_EDRX_ENABLE
+    edrxCmd.append("AT+CEDRXS=1,4,").appendQuoted(CATM_EDRX_CYCLE);
+#else
+    edrxCmd.append("AT+CEDRXS=0");
+#endif
+
+    sim7080g::AtBatchItem batch[] = {
+        batchItem(psmCmd.c_str(), 2000, true),
+        batchItem(edrxCmd.c_str(), 2000, false),
+        batchItem("AT+CEREG=4", 1000, false),   // granted timers in +CEREG
+    };
+
+    bool ok = false;
+    {
+        MutexGuard guard(serialMutex_);
+        if (!guard.acquired()) return false;
+        modem_->sendBatch(batch, sizeof(batch) / sizeof(batch[0]));
+        ok = batch[0].ok;
+        if (ok) ok = readGrant();
+        (void)modem_->sendCommandInto("AT+CEREG=2", nullptr, 0, 1000, true);
+    }
+
+    stats_.negotiations++;
+    if (!ok) {
+        Serial.println("CatM+PSM: PSM request rejected or not granted");
+        return false;
+    }
+    Serial.printf("CatM+PSM: requested TAU=%us active=%us, granted TAU=%lus active=%lus%s\n",
+                  (unsigned)CATM_PSM_TAU_S, (unsigned)CATM_PSM_ACTIVE_S,
+                  (unsigned long)grant_.periodicTauS, (unsigned long)grant_.activeTimeS,
+                  batch[1].ok ? "" : " (eDRX not accepted)");
+    return true;
+}
+
+bool CatMPowerSession::readGrant() {
+    // Caller holds serialMutex_
+    char resp[160];
+    if (modem_->sendCommandInto("AT+CEREG?", resp, sizeof(resp), 1500, true) != M5_SIM7080G::Status::Ok) {
+        return false;
+    }
+    const char* line = strstr(resp, "+CEREG:");
+    if (!line) return false;
+
+    // +CEREG: 4,<stat>,"<tac>","<ci>",<AcT>,,,"<active-time>","<periodic-tau>"
+    char activeBits[12];
+    char tauBits[12];
+    if (!quotedField(line, 2, activeBits, sizeof(activeBits)) || !quotedField(line, 3, tauBits, sizeof(tauBits))) {
+        grant_.valid = false;
+        return false;
+    }
+    grant_.activeTimeS = decodeT3324(activeBits);
+    grant_.periodicTauS = decodeT3412(tauBits);
+    grant_.valid = grant_.activeTimeS > 0;
+    return grant_.valid;
+}
+
+void CatMPowerSession::enterSleep(uint32_t nowMs) {
+    state_ = PowerSessionState::SLEEPING;
+    sleepStartMs_ = nowMs;
+    nextWindowMs_ = nowMs + CATM_TX_WINDOW_MS;
+    stats_.sleeps++;
+    Serial.printf("CatM+PSM: idle, modem may enter PSM; next window in %lus\n",
+                  (unsigned long)(CATM_TX_WINDOW_MS / 1000));
+}
+
+bool CatMPowerSession::wake(uint32_t nowMs) {
+    stats_.sleptMs += nowMs - sleepStartMs_;
+    state_ = PowerSessionState::AWAKE;
+    lastActivityMs_ = nowMs;
+    stats_.wakes++;
+
+    MutexGuard guard(serialMutex_);
+    if (!guard.acquired()) return false;
+
+    const uint32_t start = millis();
+    bool responsive = modem_->wakeup(2, 300, 50);
+#if CATM_PWRKEY_PIN >= 0
+    if (!responsive) {
+        // PWRKEY pulse brings the SIM7080G out of PSM; only sent when AT is silent,
+        // since the same pulse powers an awake module down
+        pinMode(CATM_PWRKEY_PIN, OUTPUT);
+        digitalWrite(CATM_PWRKEY_PIN, HIGH);
+        vTaskDelay(pdMS_TO_TICKS(1100));
+        digitalWrite(CATM_PWRKEY_PIN, LOW);
+        responsive = modem_->wakeup(6, 500, 200);
+    }
+#endif
+    if (!responsive) {
+        stats_.wakeFailures++;
+        Serial.println("CatM+PSM: modem did not wake");
+        return false;
+    }
+    modemReportedPsm_ = false;
+
+    // PSM keeps the EPS bearer; only the app PDP context may need reactivating
+    char resp[128];
+    bool active = modem_->sendCommandInto("AT+CNACT?", resp, sizeof(resp), 2000, true) == M5_SIM7080G::Status::Ok &&
+                  strstr(resp, "+CNACT: 0,1") != nullptr;
+    if (!active) {
+        active = modem_->sendCommandInto("AT+CNACT=0,1", resp, sizeof(resp), 10000, true) == M5_SIM7080G::Status::Ok;
+    }
+    stats_.lastWakeMs = millis() - start;
+    if (!active) {
+        stats_.wakeFailures++;
+        Serial.println("CatM+PSM: PDP resume failed; full attach required");
+        return false;
+    }
+    stats_.resumes++;
+    Serial.printf("CatM+PSM: resumed in %lu ms without re-attach\n", (unsigned long)stats_.lastWakeMs);
+    return true;
+}
+
+uint32_t CatMPowerSession::lingerEndsMs() const {
+    return lastActivityMs_ + CATM_PSM_LINGER_MS;
+}
+
+PowerAction CatMPowerSession::step(uint32_t nowMs, size_t pendingUplinkBytes, bool linkUp) {
+    switch (state_) {
+        case PowerSessionState::DISABLED:
+            return PowerAction::RUN;
+
+        case PowerSessionState::SLEEPING:
+            if (pendingUplinkBytes == 0 && (int32_t)(nowMs - nextWindowMs_) < 0) {
+                return PowerAction::SKIP;
+            }
+            (void)wake(nowMs);   // on failure the regular link check re-attaches
+            return PowerAction::RUN;
+
+        case PowerSessionState::AWAKE:
+            if (pendingUplinkBytes > 0 || !linkUp) {
+                lastActivityMs_ = nowMs;
+                return PowerAction::RUN;
+            }
+            if (modemReportedPsm_ || nowMs - lastActivityMs_ >= CATM_PSM_LINGER_MS) {
+                enterSleep(nowMs);
+                return PowerAction::SLEEP;
+            }
+            return PowerAction::RUN;
+    }
+    return PowerAction::RUN;
+}
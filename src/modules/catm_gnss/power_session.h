@@ -0,0 +1,95 @@
+/*
+ * CatM Power Session Manager
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * Negotiates PSM (AT+CPSMS) and eDRX (AT+CEDRXS) timers with the network and
+ * decides when the modem may sleep. While asleep the link is not polled; the
+ * modem is woken only for the scheduled transmit window or when transport
+ * packets are pending, and the PDP context is resumed instead of re-attaching.
+ */
+
+#ifndef CATM_POWER_SESSION_H
+#define CATM_POWER_SESSION_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <M5_SIM7080G.h>
+
+enum class PowerSessionState : uint8_t {
+    DISABLED = 0,
+    AWAKE,
+    SLEEPING
+};
+
+// What the CatM task should do this iteration
+enum class PowerAction : uint8_t {
+    RUN = 0,     // modem awake; poll/attach/send as usual
+    SKIP,        // modem asleep and nothing is due; leave the UART and radio alone
+    SLEEP        // just entered sleep; release GNSS and stop polling
+};
+
+struct PowerSessionGrant {
+    bool valid;
+    uint32_t activeTimeS;     // network-granted T3324 (0 = deactivated)
+    uint32_t periodicTauS;    // network-granted T3412 extended
+};
+
+struct PowerSessionStats {
+    uint32_t negotiations;
+    uint32_t sleeps;
+    uint32_t wakes;
+    uint32_t resumes;         // woke with the PDP context still (or re-)active, no attach
+    uint32_t wakeFailures;    // needed a full attach
+    uint32_t psmEnterUrcs;
+    uint32_t psmExitUrcs;
+    uint32_t lastWakeMs;      // wake latency
+    uint64_t sleptMs;
+};
+
+class CatMPowerSession {
+public:
+    CatMPowerSession();
+
+    bool begin(M5_SIM7080G* modem, SemaphoreHandle_t serialMutex);
+    void end();
+    bool enabled() const { return state_ != PowerSessionState::DISABLED; }
+    PowerSessionState state() const { return state_; }
+
+    // Request PSM/eDRX timers and read back the granted values. Call after attach.
+    bool negotiate();
+
+    // Policy step, once per task iteration. Wakes the modem itself when a window or
+    // pending uplink is due.
+    PowerAction step(uint32_t nowMs, size_t pendingUplinkBytes, bool linkUp);
+
+    const PowerSessionGrant& grant() const { return grant_; }
+    const PowerSessionStats& getStats() const { return stats_; }
+    uint32_t nextWindowMs() const { return nextWindowMs_; }
+    // AWAKE: millis() at which an idle step() enters sleep
+    uint32_t lingerEndsMs() const;
+
+    // 3GPP 24.008 timer encodings ("GPRS Timer 3" for T3412 ext, "GPRS Timer 2" for T3324)
+    static bool encodeT3412(uint32_t seconds, char out[9]);
+    static bool encodeT3324(uint32_t seconds, char out[9]);
+    static uint32_t decodeT3412(const char* bits);
+    static uint32_t decodeT3324(const char* bits);
+
+private:
+    bool wake(uint32_t nowMs);
+    void enterSleep(uint32_t nowMs);
+    bool readGrant();
+    static void onPsmStatusUrc(const char* line, size_t len, void* ctx);
+
+    M5_SIM7080G* modem_;
+    SemaphoreHandle_t serialMutex_;
+    PowerSessionState state_;
+    volatile bool modemReportedPsm_;
+    uint32_t lastActivityMs_;
+    uint32_t sleepStartMs_;
+    uint32_t nextWindowMs_;
+    PowerSessionGrant grant_;
+    PowerSessionStats stats_;
+};
+
+#endif // CATM_POWER_SESSION_H
@@ -0,0 +1,172 @@
+/*
+ * RF Time-Slot Arbiter Implementation
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ */
+
+#include "rf_arbiter.h"
+#include <cstring>
+
+RfArbiter::RfArbiter()
+    : slot_(RfSlot::IDLE), slotStartMs_(0), startMode_(GnssStartMode::COLD), fixInSlot_(false),
+      deferCounted_(false), consecutivePreempts_(0), ttfbPending_(false), sentAtSlotStart_(0),
+      fixRefreshMs_(RF_ARB_FIX_REFRESH_MS), uplinkMaxDeferMs_(RF_ARB_UPLINK_MAX_DEFER_MS) {
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+const char* RfArbiter::slotName(RfSlot slot) {
+    switch (slot) {
+        case RfSlot::GNSS: return "GNSS";
+        case RfSlot::DATA: return "DATA";
+        case RfSlot::SCAN: return "SCAN";
+        default: return "IDLE";
+    }
+}
+
+const char* RfArbiter::startModeName(GnssStartMode mode) {
+    switch (mode) {
+        case GnssStartMode::HOT: return "hot";
+        case GnssStartMode::WARM: return "warm";
+        default: return "cold";
+    }
+}
+
+GnssStartMode RfArbiter::classifyStart(const RfArbiterInputs& in, uint32_t nowMs) {
+    if (in.lastFixMs == 0) return GnssStartMode::COLD;
+    const uint32_t age = nowMs - in.lastFixMs;
+    if (age <= RF_ARB_HOT_MAX_FIX_AGE_MS) return GnssStartMode::HOT;
+    if (age <= RF_ARB_WARM_MAX_FIX_AGE_MS) return GnssStartMode::WARM;
+    return GnssStartMode::COLD;
+}
+
+uint32_t RfArbiter::budgetFor(GnssStartMode mode) {
+    switch (mode) {
+        case GnssStartMode::HOT: return RF_ARB_GNSS_HOT_BUDGET_MS;
+        case GnssStartMode::WARM: return RF_ARB_GNSS_WARM_BUDGET_MS;
+        default: return RF_ARB_GNSS_COLD_BUDGET_MS;
+    }
+}
+
+void RfArbiter::enter(RfSlot slot, const RfArbiterInputs& in, uint32_t nowMs) {
+    slot_ = slot;
+    slotStartMs_ = nowMs;
+    fixInSlot_ = false;
+    deferCounted_ = false;
+    ttfbPending_ = false;
+
+    if (slot == RfSlot::GNSS) {
+        startMode_ = classifyStart(in, nowMs);
+        stats_.gnssSlots++;
+        stats_.lastStartMode = startMode_;
+        Serial.printf("RF: GNSS slot (%s start, budget %lu ms)\n", startModeName(startMode_),
+                      (unsigned long)budgetFor(startMode_));
+    } else if (slot == RfSlot::DATA) {
+        stats_.dataSlots++;
+        ttfbPending_ = in.pendingUplinkBytes > 0;
+        sentAtSlotStart_ = in.uplinkSent;
+        Serial.printf("RF: DATA slot (%lu bytes pending%s)\n", (unsigned long)in.pendingUplinkBytes,
+                      in.attachNeeded ? ", attach" : "");
+    } else if (slot == RfSlot::SCAN) {
+        stats_.scanSlots++;
+        Serial.println("RF: SCAN slot");
+    }
+}
+
+void RfArbiter::track(const RfArbiterInputs& in, uint32_t nowMs) {
+    if (slot_ == RfSlot::GNSS && !fixInSlot_ && in.fixValid && in.lastFixMs != 0 &&
+        (int32_t)(in.lastFixMs - slotStartMs_) >= 0) {
+        fixInSlot_ = true;
+        consecutivePreempts_ = 0;
+        const uint32_t ttff = in.lastFixMs - slotStartMs_;
+        stats_.fixes++;
+        stats_.lastTtffMs = ttff;
+        if (stats_.minTtffMs == 0 || ttff < stats_.minTtffMs) stats_.minTtffMs = ttff;
+        if (ttff > stats_.maxTtffMs) stats_.maxTtffMs = ttff;
+        Serial.printf("RF: TTFF %lu ms (%s start)\n", (unsigned long)ttff, startModeName(startMode_));
+    }
+
+    if (slot_ == RfSlot::DATA && ttfbPending_ && in.uplinkSent != sentAtSlotStart_) {
+        ttfbPending_ = false;
+        const uint32_t ttfb = nowMs - slotStartMs_;
+        stats_.lastTtfbMs = ttfb;
+        if (ttfb > stats_.maxTtfbMs) stats_.maxTtfbMs = ttfb;
+        Serial.printf("RF: TTFB %lu ms\n", (unsigned long)ttfb);
+    }
+}
+
+RfSlot RfArbiter::nextFromGnss(const RfArbiterInputs& in, uint32_t nowMs, bool dataWanted) {
+    const uint32_t elapsed = nowMs - slotStartMs_;
+
+    // A fix in hand means the receiver is hot; hand over as soon as data is waiting
+    if (fixInSlot_) {
+        if (dataWanted) return RfSlot::DATA;
+        return in.scanWanted ? RfSlot::SCAN : RfSlot::GNSS;
+    }
+    if (!dataWanted) {
+        return RfSlot::GNSS;
+    }
+    if (elapsed < RF_ARB_GNSS_MIN_SLOT_MS) {
+        return RfSlot::GNSS;
+    }
+
+    const bool urgent = in.pendingUplinkBytes >= RF_ARB_UPLINK_URGENT_BYTES ||
+                        (in.oldestUplinkAgeMs != 0 && in.oldestUplinkAgeMs >= uplinkMaxDeferMs_);
+    if (elapsed >= budgetFor(startMode_)) {
+        // Budget spent without a fix; give way for now instead of holding uplink indefinitely
+        if (consecutivePreempts_ < 0xFF) consecutivePreempts_++;
+        return RfSlot::DATA;
+    }
+    if (urgent) {
+        if (consecutivePreempts_ >= RF_ARB_MAX_GNSS_PREEMPTS) {
+            // GNSS has been starved repeatedly; let this acquisition run to its budget
+            if (!deferCounted_) {
+                deferCounted_ = true;
+                stats_.uplinkDeferred++;
+            }
+            return RfSlot::GNSS;
+        }
+        consecutivePreempts_++;
+        stats_.gnssPreempted++;
+        return RfSlot::DATA;
+    }
+    return RfSlot::GNSS;
+}
+
+RfSlot RfArbiter::decide(const RfArbiterInputs& in, uint32_t nowMs) {
+    track(in, nowMs);
+
+    const bool dataWanted = in.pendingUplinkBytes > 0 || in.attachNeeded;
+    const uint32_t fixAge = in.lastFixMs ? nowMs - in.lastFixMs : UINT32_MAX;
+    const uint32_t refreshMs = in.refreshScale > 1 ? fixRefreshMs_ * in.refreshScale : fixRefreshMs_;
+    const bool gnssWanted = !in.fixValid || fixAge > refreshMs;
+
+    RfSlot next = slot_;
+    switch (slot_) {
+        case RfSlot::IDLE:
+            next = dataWanted ? RfSlot::DATA : RfSlot::GNSS;
+            break;
+        case RfSlot::GNSS:
+            next = nextFromGnss(in, nowMs, dataWanted);
+            break;
+        case RfSlot::DATA:
+            if (!dataWanted) {
+                // Idle radio goes back to GNSS so the receiver stays hot, or scans with a fresh fix
+                next = in.scanWanted && !gnssWanted ? RfSlot::SCAN : RfSlot::GNSS;
+            } else if (gnssWanted && (nowMs - slotStartMs_) >= RF_ARB_DATA_SLOT_MAX_MS) {
+                next = RfSlot::GNSS;
+            }
+            break;
+        case RfSlot::SCAN:
+            // A chunk in progress is aborted by the caller as soon as data is wanted
+            if (dataWanted) {
+                next = RfSlot::DATA;
+            } else if (gnssWanted || !in.scanWanted) {
+                next = RfSlot::GNSS;
+            }
+            break;
+    }
+
+    if (next != slot_) {
+        enter(next, in, nowMs);
+    }
+    return slot_;
+}
@@ -0,0 +1,113 @@
+/*
+ * RF Time-Slot Arbiter
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * The SIM7080G shares one RF path between the GNSS receiver and the LTE-M
+ * data session. The arbiter decides which of the two owns the radio, from
+ * pending uplink bytes, fix age and the expected GNSS start mode, and records
+ * time-to-fix (TTFF) and time-to-first-byte (TTFB) per slot. A radio wanted by
+ * neither, with a fresh fix, goes to an operator scan (operator_scan.h) while
+ * one is due; anything for the data session ends that slot at once.
+ */
+
+#ifndef RF_ARBITER_H
+#define RF_ARBITER_H
+
+#include <Arduino.h>
+
+// ============================================================================
+// RF ARBITER POLICY
+// ============================================================================
+#define RF_ARB_GNSS_MIN_SLOT_MS       10000     // GNSS always keeps the radio this long
+#define RF_ARB_GNSS_HOT_BUDGET_MS     15000     // acquisition budget per start mode
+#define RF_ARB_GNSS_WARM_BUDGET_MS    45000
+#define RF_ARB_GNSS_COLD_BUDGET_MS    120000
+#define RF_ARB_HOT_MAX_FIX_AGE_MS     (2UL * 3600UL * 1000UL)   // ephemeris still valid
+#define RF_ARB_WARM_MAX_FIX_AGE_MS    (4UL * 3600UL * 1000UL)   // almanac/time still useful
+#define RF_ARB_FIX_REFRESH_MS         60000     // fix older than this makes GNSS want the radio
+#define RF_ARB_UPLINK_URGENT_BYTES    2048      // this much queued preempts an acquiring GNSS slot
+#define RF_ARB_UPLINK_MAX_DEFER_MS    30000     // oldest packet may wait this long for the radio
+#define RF_ARB_DATA_SLOT_MAX_MS       60000     // data yields to a waiting GNSS after this
+#define RF_ARB_MAX_GNSS_PREEMPTS      2         // after this many fix-less preemptions GNSS gets a protected slot
+
+enum class RfSlot : uint8_t {
+    IDLE = 0,
+    GNSS,
+    DATA,
+    SCAN             // operator scan chunks while both others are idle
+};
+
+enum class GnssStartMode : uint8_t {
+    COLD = 0,
+    WARM,
+    HOT
+};
+
+struct RfArbiterInputs {
+    uint32_t pendingUplinkBytes;
+    uint32_t oldestUplinkAgeMs;   // 0 when nothing is queued
+    uint32_t uplinkSent;          // monotonic delivered-packet counter
+    bool attachNeeded;            // link down and an attach attempt is due
+    bool fixValid;
+    uint32_t lastFixMs;           // millis() of the latest fix, 0 = never
+    uint8_t refreshScale;         // fix refresh interval multiplier, 0 = 1
+    bool scanWanted;              // operator scan work is due
+};
+
+struct RfArbiterStats {
+    uint32_t gnssSlots;
+    uint32_t dataSlots;
+    uint32_t gnssPreempted;       // GNSS slot cut short for uplink before a fix
+    uint32_t uplinkDeferred;      // urgent uplink held back by a protected GNSS slot
+    uint32_t fixes;
+    uint32_t lastTtffMs;
+    uint32_t minTtffMs;
+    uint32_t maxTtffMs;
+    GnssStartMode lastStartMode;
+    uint32_t lastTtfbMs;
+    uint32_t maxTtfbMs;
+    uint32_t scanSlots;
+};
+
+class RfArbiter {
+public:
+    RfArbiter();
+
+    // Re-evaluate the policy; returns the slot that should own the radio now.
+    RfSlot decide(const RfArbiterInputs& in, uint32_t nowMs);
+
+    RfSlot slot() const { return slot_; }
+    uint32_t slotAgeMs(uint32_t nowMs) const { return nowMs - slotStartMs_; }
+    GnssStartMode startMode() const { return startMode_; }
+    const RfArbiterStats& getStats() const { return stats_; }
+
+    // Live tuning (live_config.h), from the owning task; 0 restores the RF_ARB_* default
+    void setFixRefreshMs(uint32_t ms) { fixRefreshMs_ = ms ? ms : RF_ARB_FIX_REFRESH_MS; }
+    void setUplinkMaxDeferMs(uint32_t ms) { uplinkMaxDeferMs_ = ms ? ms : RF_ARB_UPLINK_MAX_DEFER_MS; }
+    uint32_t fixRefreshMs() const { return fixRefreshMs_; }
+    uint32_t uplinkMaxDeferMs() const { return uplinkMaxDeferMs_; }
+
+    static const char* slotName(RfSlot slot);
+    static const char* startModeName(GnssStartMode mode);
+
+private:
+    void enter(RfSlot slot, const RfArbiterInputs& in, uint32_t nowMs);
+    void track(const RfArbiterInputs& in, uint32_t nowMs);
+    RfSlot nextFromGnss(const RfArbiterInputs& in, uint32_t nowMs, bool dataWanted);
+    static GnssStartMode classifyStart(const RfArbiterInputs& in, uint32_t nowMs);
+    static uint32_t budgetFor(GnssStartMode mode);
+
+    RfSlot slot_;
+    uint32_t slotStartMs_;
+    GnssStartMode startMode_;
+    bool fixInSlot_;
+    bool deferCounted_;
+    uint8_t consecutivePreempts_;
+    bool ttfbPending_;
+    uint32_t sentAtSlotStart_;
+    uint32_t fixRefreshMs_;
+    uint32_t uplinkMaxDeferMs_;
+    RfArbiterStats stats_;
+};
+
+#endif // RF_ARBITER_H
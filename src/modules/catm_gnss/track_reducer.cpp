@@ -0,0 +1,124 @@
+/*
+ * GNSS Track Reducer Implementation
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ */
+
+#include "track_reducer.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+constexpr float kMetresPerDegLat = 111320.0f;
+constexpr float kDegToRad = 0.017453293f;
+} // namespace
+
+TrackReducer::TrackReducer() {
+    memset(&stats_, 0, sizeof(stats_));
+    reset();
+}
+
+void TrackReducer::reset() {
+    memset(&anchor_, 0, sizeof(anchor_));
+    memset(&prev_, 0, sizeof(prev_));
+    windowCount_ = 0;
+    metresPerDegLon_ = kMetresPerDegLat;
+    haveAnchor_ = false;
+}
+
+TrackReducer::Offset TrackReducer::offset(const GNSSData& fix) const {
+    Offset o;
+    o.x = static_cast<float>(fix.longitude - anchor_.fix.longitude) * metresPerDegLon_;
+    o.y = static_cast<float>(fix.latitude - anchor_.fix.latitude) * kMetresPerDegLat;
+    return o;
+}
+
+bool TrackReducer::stationary(const GNSSData& fix, const GNSSData& ref) const {
+    if (fix.speed >= TRACK_STATIONARY_KPH) return false;
+    const float dx = static_cast<float>(fix.longitude - ref.longitude) * metresPerDegLon_;
+    const float dy = static_cast<float>(fix.latitude - ref.latitude) * kMetresPerDegLat;
+    return dx * dx + dy * dy <= TRACK_STATIONARY_M * TRACK_STATIONARY_M;
+}
+
+TrackReducerStats TrackReducer::stats() const {
+    TrackReducerStats s = stats_;
+    // Fixes neither kept nor parked, less the window still open
+    s.pending = static_cast<uint32_t>(windowCount_);
+    s.skippedOnLine = s.fixes - s.kept - s.skippedStationary - s.pending;
+    return s;
+}
+
+// Every windowed fix within TRACK_ERROR_M of the segment anchor -> to
+bool TrackReducer::lineCovers(const Offset& to) const {
+    const float len2 = to.x * to.x + to.y * to.y;
+    const float bound2 = TRACK_ERROR_M * TRACK_ERROR_M;
+    for (size_t i = 0; i < windowCount_; i++) {
+        const Offset& q = window_[i];
+        float t = len2 > 0.0f ? (q.x * to.x + q.y * to.y) / len2 : 0.0f;
+        if (t < 0.0f) t = 0.0f;
+        if (t > 1.0f) t = 1.0f;
+        const float dx = q.x - t * to.x;
+        const float dy = q.y - t * to.y;
+        if (dx * dx + dy * dy > bound2) return false;
+    }
+    return true;
+}
+
+void TrackReducer::keep(const GNSSData& fix, uint32_t ms, TrackReason reason, TrackPoint out[kMaxOut], size_t& n) {
+    anchor_.fix = fix;
+    anchor_.ms = ms;
+    anchor_.reason = reason;
+    haveAnchor_ = true;
+    windowCount_ = 0;
+    metresPerDegLon_ = kMetresPerDegLat * cosf(static_cast<float>(fix.latitude) * kDegToRad);
+    if (n < kMaxOut) out[n++] = anchor_;
+    stats_.kept++;
+    switch (reason) {
+        case TrackReason::Turn: stats_.byTurn++; break;
+        case TrackReason::Stop: stats_.byStop++; break;
+        case TrackReason::Window: stats_.byWindow++; break;
+        case TrackReason::Heartbeat: stats_.byHeartbeat++; break;
+        default: break;
+    }
+}
+
+size_t TrackReducer::push(const GNSSData& fix, uint32_t now, TrackPoint out[kMaxOut]) {
+    size_t n = 0;
+    stats_.fixes++;
+    if (!haveAnchor_) {
+        keep(fix, now, TrackReason::First, out, n);
+        return n;
+    }
+
+    const bool heartbeat = now - anchor_.ms >= TRACK_HEARTBEAT_MS;
+    // Parked relative to the kept point, halted relative to the last fix on the move
+    if (stationary(fix, windowCount_ ? prev_.fix : anchor_.fix)) {
+        if (windowCount_ == 0) {
+            // Parked at the kept point
+            if (heartbeat) {
+                keep(fix, now, TrackReason::Heartbeat, out, n);
+            } else {
+                stats_.skippedStationary++;
+            }
+            return n;
+        }
+        // Came to a halt: the stop closes the segment, after whatever bend it needs
+        if (!lineCovers(offset(fix))) keep(prev_.fix, prev_.ms, TrackReason::Turn, out, n);
+        keep(fix, now, TrackReason::Stop, out, n);
+        return n;
+    }
+
+    if (windowCount_ > 0 && !lineCovers(offset(fix))) {
+        // The previous fix is the last one the straight line still explains
+        keep(prev_.fix, prev_.ms, TrackReason::Turn, out, n);
+    } else if (windowCount_ >= TRACK_WINDOW_POINTS) {
+        keep(prev_.fix, prev_.ms, TrackReason::Window, out, n);
+    }
+    if (now - anchor_.ms >= TRACK_HEARTBEAT_MS) {
+        keep(fix, now, TrackReason::Heartbeat, out, n);
+        return n;
+    }
+    window_[windowCount_++] = offset(fix);
+    prev_.fix = fix;
+    prev_.ms = now;
+    return n;
+}
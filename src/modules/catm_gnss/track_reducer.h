@@ -0,0 +1,107 @@
+/*
+ * GNSS Track Reducer
+ * StampPLC CatM+GNSS FreeRTOS Modularization
+ *
+ * Keeps only the fixes needed to redraw the track within TRACK_ERROR_M, for
+ * the SD log and the telemetry uplink:
+ *   - stationary: a fix slower than TRACK_STATIONARY_KPH and within
+ *     TRACK_STATIONARY_M of the last kept point is dropped; a parked trailer
+ *     keeps one point per TRACK_HEARTBEAT_MS
+ *   - moving: an opening-window (streaming Douglas-Peucker) filter. Fixes
+ *     since the last kept point collect in a window; while every one of them
+ *     lies within TRACK_ERROR_M of the straight line from the kept point to
+ *     the newest fix, nothing is emitted. The first fix that bends the line
+ *     past the bound emits the fix before it, which becomes the new anchor.
+ *   - the first stationary fix after moving closes the segment (stop point),
+ *     a full window or TRACK_HEARTBEAT_MS without a kept point emits too
+ *
+ * A kept point can be the previous fix, so emitted points carry their own
+ * millis() timestamp. Distances use a local flat-earth frame around the
+ * anchor, well within the bound over a window.
+ */
+
+#ifndef TRACK_REDUCER_H
+#define TRACK_REDUCER_H
+
+#include <Arduino.h>
+#include "catm_gnss_module.h"
+
+#ifndef TRACK_ERROR_M
+#define TRACK_ERROR_M 15.0f                 // largest distance of a dropped fix from the kept track
+#endif
+#ifndef TRACK_STATIONARY_M
+#define TRACK_STATIONARY_M 10.0f            // GNSS jitter while parked
+#endif
+#ifndef TRACK_STATIONARY_KPH
+#define TRACK_STATIONARY_KPH 2.0f
+#endif
+#ifndef TRACK_HEARTBEAT_MS
+#define TRACK_HEARTBEAT_MS 600000UL         // longest gap between kept points
+#endif
+#ifndef TRACK_WINDOW_POINTS
+#define TRACK_WINDOW_POINTS 32              // fixes checked against each candidate line
+#endif
+
+enum class TrackReason : uint8_t {
+    First = 0,
+    Turn,           // the line to the newest fix passed the error bound
+    Stop,           // first stationary fix after moving
+    Window,         // window full
+    Heartbeat
+};
+
+struct TrackPoint {
+    GNSSData fix;
+    uint32_t ms;                 // millis() of the fix
+    TrackReason reason;
+};
+
+struct TrackReducerStats {
+    uint32_t fixes;
+    uint32_t kept;
+    uint32_t skippedStationary;
+    uint32_t skippedOnLine;      // moving, within the bound of a kept segment
+    uint32_t pending;            // in the open window, not decided yet
+    uint32_t byTurn;
+    uint32_t byStop;
+    uint32_t byWindow;
+    uint32_t byHeartbeat;
+};
+
+class TrackReducer {
+public:
+    // Room for what one push() can emit
+    static constexpr size_t kMaxOut = 2;
+
+    TrackReducer();
+
+    // One valid fix; writes the points to keep, oldest first, and returns their count
+    size_t push(const GNSSData& fix, uint32_t now, TrackPoint out[kMaxOut]);
+    // Forget the track (GNSS restarted); the next fix is kept as First
+    void reset();
+
+    bool hasKept() const { return haveAnchor_; }
+    const TrackPoint& lastKept() const { return anchor_; }
+    TrackReducerStats stats() const;
+
+private:
+    struct Offset {
+        float x;                 // metres east of the anchor
+        float y;                 // metres north
+    };
+
+    Offset offset(const GNSSData& fix) const;
+    bool stationary(const GNSSData& fix, const GNSSData& ref) const;
+    bool lineCovers(const Offset& to) const;
+    void keep(const GNSSData& fix, uint32_t ms, TrackReason reason, TrackPoint out[kMaxOut], size_t& n);
+
+    TrackPoint anchor_;
+    TrackPoint prev_;            // newest fix in the window
+    Offset window_[TRACK_WINDOW_POINTS];
+    size_t windowCount_;
+    float metresPerDegLon_;
+    bool haveAnchor_;
+    TrackReducerStats stats_;
+};
+
+#endif // TRACK_REDUCER_H
@@ -0,0 +1,320 @@
+/*
+ * Carrier History Implementation
+ */
+
+#include "carrier_history.h"
+#include "../logging/log_buffer.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+constexpr const char* kNamespace = "carrier_hist";
+constexpr uint32_t kMagic = 0x31484143;      // "CAH1"
+constexpr size_t kCarriers = 2;              // TMOBILE, SORACOM
+constexpr uint8_t kHours = 24;
+constexpr uint8_t kNoHour = 0xFF;
+constexpr float kPriorHours = 4.0f;          // weight of the wider estimate, in hours of history
+constexpr float kSlowWeight = 0.25f;         // share of the hour a link at zero upload counts as lost
+constexpr float kMaxAttachFail = 0.8f;
+
+struct HourBucket {
+    uint16_t drops;
+    uint16_t minutes;
+};
+
+struct CarrierRecord {
+    uint32_t magic;
+    uint16_t attaches;
+    uint16_t attachFails;
+    uint32_t attachMs;       // mean of successful attaches, recent weighted
+    uint16_t upKbps;         // same for speed tests, 0 = never tested
+    uint16_t downKbps;
+    uint32_t drops;
+    uint32_t minutes;        // connected
+    HourBucket hours[kHours];
+    uint32_t crc;            // CRC-32 of everything above
+};
+
+struct CellRecord {
+    uint8_t carrier;         // 0 = unused slot
+    char cell[15];
+    uint16_t drops;
+    uint16_t minutes;
+};
+
+struct CellTable {
+    uint32_t magic;
+    CellRecord cells[CARRIER_HISTORY_CELLS];
+    uint32_t crc;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+CarrierRecord s_carriers[kCarriers] = {};    // under s_mux
+CellTable s_cells = {};
+uint32_t s_carryMs[kCarriers] = {};          // connected time below one minute
+bool s_dirty = false;
+uint32_t s_lastCommitMs = 0;
+uint32_t s_commitFailures = 0;
+bool s_started = false;
+
+template <typename T>
+uint32_t blobCrc(const T& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), offsetof(T, crc));
+}
+
+int carrierIndex(NetworkCarrier c) {
+    switch (c) {
+        case NetworkCarrier::TMOBILE: return 0;
+        case NetworkCarrier::SORACOM: return 1;
+        default: return -1;
+    }
+}
+
+uint8_t localHour() {
+    time_t now = time(nullptr);
+    struct tm lt;
+    if (!localtime_r(&now, &lt) || lt.tm_year + 1900 < 2020) return kNoHour;
+    return (uint8_t)lt.tm_hour;
+}
+
+// Under s_mux
+CellRecord* findCell(uint8_t carrier, const char* cellId, bool create) {
+    if (!cellId || !cellId[0]) return nullptr;
+    CellRecord* weakest = nullptr;
+    for (size_t i = 0; i < CARRIER_HISTORY_CELLS; i++) {
+        CellRecord& c = s_cells.cells[i];
+        if (c.carrier == carrier && strncmp(c.cell, cellId, sizeof(c.cell) - 1) == 0) return &c;
+        if (!weakest || c.carrier == 0 || (weakest->carrier != 0 && c.minutes < weakest->minutes)) weakest = &c;
+    }
+    if (!create) return nullptr;
+    // Replace the cell with the least history
+    memset(weakest, 0, sizeof(*weakest));
+    weakest->carrier = carrier;
+    strncpy(weakest->cell, cellId, sizeof(weakest->cell) - 1);
+    return weakest;
+}
+
+// Under s_mux
+void age(CarrierRecord& r, uint8_t carrier) {
+    if (r.minutes < CARRIER_HISTORY_AGE_MIN) return;
+    r.attaches /= 2;
+    r.attachFails /= 2;
+    r.drops /= 2;
+    r.minutes /= 2;
+    for (uint8_t h = 0; h < kHours; h++) {
+        r.hours[h].drops /= 2;
+        r.hours[h].minutes /= 2;
+    }
+    for (size_t i = 0; i < CARRIER_HISTORY_CELLS; i++) {
+        CellRecord& c = s_cells.cells[i];
+        if (c.carrier != carrier) continue;
+        c.drops /= 2;
+        c.minutes /= 2;
+    }
+}
+
+// Drops per hour, pulled towards prior when there is little connected time
+float shrinkRate(uint32_t drops, uint32_t minutes, float prior) {
+    return ((float)drops + prior * kPriorHours) / ((float)minutes / 60.0f + kPriorHours);
+}
+
+float expectedAttachS(const CarrierRecord& r) {
+    const float attachS = (r.attaches > r.attachFails && r.attachMs ? r.attachMs : CARRIER_DEFAULT_ATTACH_MS) / 1000.0f;
+    float fail = ((float)r.attachFails + 0.2f) / ((float)r.attaches + 2.0f);
+    if (fail > kMaxAttachFail) fail = kMaxAttachFail;
+    // Retries until one attach succeeds
+    return attachS / (1.0f - fail);
+}
+
+float costOf(const CarrierRecord& r, const CellRecord* cell, uint8_t hour, ConnectionQuality live,
+             uint16_t minUpKbps) {
+    float rate = shrinkRate(r.drops, r.minutes, CARRIER_PRIOR_DROPS_PER_H);
+    if (hour != kNoHour) rate = shrinkRate(r.hours[hour].drops, r.hours[hour].minutes, rate);
+    if (cell) rate = shrinkRate(cell->drops, cell->minutes, rate);
+    // The link as it is now is evidence too
+    if (live == ConnectionQuality::POOR) rate *= 4.0f;
+    else if (live == ConnectionQuality::FAIR) rate *= 2.0f;
+
+    float cost = rate * expectedAttachS(r);
+    if (r.upKbps && minUpKbps && r.upKbps < minUpKbps) {
+        cost += (1.0f - (float)r.upKbps / minUpKbps) * 3600.0f * kSlowWeight;
+    }
+    return cost;
+}
+
+void ewma(uint32_t& avg, uint32_t sample, bool first) {
+    avg = first ? sample : (avg * 3 + sample) / 4;
+}
+
+void ewma16(uint16_t& avg, uint16_t sample) {
+    avg = avg ? (uint16_t)(((uint32_t)avg * 3 + sample) / 4) : sample;
+}
+
+bool commit() {
+    CarrierRecord carriers[kCarriers];
+    CellTable cells;
+    portENTER_CRITICAL(&s_mux);
+    memcpy(carriers, s_carriers, sizeof(carriers));
+    cells = s_cells;
+    s_dirty = false;
+    portEXIT_CRITICAL(&s_mux);
+
+    Preferences p;
+    bool ok = p.begin(kNamespace, false);
+    if (ok) {
+        for (size_t i = 0; i < kCarriers && ok; i++) {
+            carriers[i].magic = kMagic;
+            carriers[i].crc = blobCrc(carriers[i]);
+            const char key[3] = {'c', (char)('0' + i), 0};
+            ok = p.putBytes(key, &carriers[i], sizeof(carriers[i])) == sizeof(carriers[i]);
+        }
+        cells.magic = kMagic;
+        cells.crc = blobCrc(cells);
+        ok = ok && p.putBytes("cells", &cells, sizeof(cells)) == sizeof(cells);
+        p.end();
+    }
+    s_lastCommitMs = millis();
+    if (!ok) {
+        if (s_commitFailures++ == 0) logbuf_printf("CarrierHistory: NVS commit failed");
+        portENTER_CRITICAL(&s_mux);
+        s_dirty = true;
+        portEXIT_CRITICAL(&s_mux);
+    }
+    return ok;
+}
+} // namespace
+
+void carrier_history_begin() {
+    if (s_started) return;
+    Preferences p;
+    if (p.begin(kNamespace, true)) {
+        for (size_t i = 0; i < kCarriers; i++) {
+            const char key[3] = {'c', (char)('0' + i), 0};
+            CarrierRecord r{};
+            if (p.getBytes(key, &r, sizeof(r)) == sizeof(r) && r.magic == kMagic && r.crc == blobCrc(r)) {
+                s_carriers[i] = r;
+            }
+        }
+        CellTable cells{};
+        if (p.getBytes("cells", &cells, sizeof(cells)) == sizeof(cells) && cells.magic == kMagic &&
+            cells.crc == blobCrc(cells)) {
+            s_cells = cells;
+        }
+        p.end();
+    }
+    s_lastCommitMs = millis();
+    s_started = true;
+    logbuf_printf("CarrierHistory: T-Mobile %lu min/%lu drops, Soracom %lu min/%lu drops",
+                  (unsigned long)s_carriers[0].minutes, (unsigned long)s_carriers[0].drops,
+                  (unsigned long)s_carriers[1].minutes, (unsigned long)s_carriers[1].drops);
+}
+
+void carrier_history_attach(NetworkCarrier carrier, bool ok, uint32_t ms) {
+    const int i = carrierIndex(carrier);
+    if (i < 0 || !s_started) return;
+    portENTER_CRITICAL(&s_mux);
+    CarrierRecord& r = s_carriers[i];
+    const bool first = r.attaches == r.attachFails || r.attachMs == 0;
+    if (r.attaches < UINT16_MAX) r.attaches++;
+    if (!ok) {
+        if (r.attachFails < UINT16_MAX) r.attachFails++;
+    } else {
+        ewma(r.attachMs, ms, first);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    commit();
+}
+
+void carrier_history_drop(NetworkCarrier carrier, const char* cellId) {
+    const int i = carrierIndex(carrier);
+    if (i < 0 || !s_started) return;
+    const uint8_t hour = localHour();
+    portENTER_CRITICAL(&s_mux);
+    CarrierRecord& r = s_carriers[i];
+    r.drops++;
+    if (hour != kNoHour && r.hours[hour].drops < UINT16_MAX) r.hours[hour].drops++;
+    CellRecord* cell = findCell((uint8_t)(i + 1), cellId, true);
+    if (cell && cell->drops < UINT16_MAX) cell->drops++;
+    s_dirty = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void carrier_history_connected(NetworkCarrier carrier, const char* cellId, uint32_t ms) {
+    const int i = carrierIndex(carrier);
+    if (i < 0 || !s_started) return;
+    const uint8_t hour = localHour();
+    portENTER_CRITICAL(&s_mux);
+    s_carryMs[i] += ms;
+    const uint32_t minutes = s_carryMs[i] / 60000;
+    s_carryMs[i] %= 60000;
+    if (minutes) {
+        CarrierRecord& r = s_carriers[i];
+        r.minutes += minutes;
+        if (hour != kNoHour) {
+            const uint32_t m = r.hours[hour].minutes + minutes;
+            r.hours[hour].minutes = m > UINT16_MAX ? UINT16_MAX : (uint16_t)m;
+        }
+        CellRecord* cell = findCell((uint8_t)(i + 1), cellId, true);
+        if (cell) {
+            const uint32_t m = cell->minutes + minutes;
+            cell->minutes = m > UINT16_MAX ? UINT16_MAX : (uint16_t)m;
+        }
+        age(r, (uint8_t)(i + 1));
+        s_dirty = true;
+    }
+    const bool due = s_dirty && millis() - s_lastCommitMs >= CARRIER_HISTORY_COMMIT_MS;
+    portEXIT_CRITICAL(&s_mux);
+    if (due) commit();
+}
+
+void carrier_history_throughput(NetworkCarrier carrier, uint16_t upKbps, uint16_t downKbps) {
+    const int i = carrierIndex(carrier);
+    if (i < 0 || !s_started) return;
+    portENTER_CRITICAL(&s_mux);
+    ewma16(s_carriers[i].upKbps, upKbps ? upKbps : 1);
+    ewma16(s_carriers[i].downKbps, downKbps ? downKbps : 1);
+    s_dirty = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+float carrier_history_cost(NetworkCarrier carrier, const char* cellId, ConnectionQuality live,
+                           uint16_t minUpKbps) {
+    const int i = carrierIndex(carrier);
+    if (i < 0) return 0.0f;
+    const uint8_t hour = localHour();
+    portENTER_CRITICAL(&s_mux);
+    const CarrierRecord r = s_carriers[i];
+    const CellRecord* found = findCell((uint8_t)(i + 1), cellId, false);
+    CellRecord cell = found ? *found : CellRecord{};
+    portEXIT_CRITICAL(&s_mux);
+    return costOf(r, found ? &cell : nullptr, hour, live, minUpKbps);
+}
+
+bool carrier_history_should_switch(NetworkCarrier current, NetworkCarrier candidate, const char* cellId,
+                                   ConnectionQuality live, uint16_t minUpKbps, CarrierSwitchDecision* out) {
+    const int ci = carrierIndex(candidate);
+    CarrierSwitchDecision d = {};
+    if (ci >= 0 && candidate != current) {
+        d.currentCostS = carrier_history_cost(current, cellId, live, minUpKbps);
+        // Nothing is known about the other carrier's cell or link from here
+        d.candidateCostS = carrier_history_cost(candidate, nullptr, ConnectionQuality::GOOD, minUpKbps);
+        portENTER_CRITICAL(&s_mux);
+        const CarrierRecord r = s_carriers[ci];
+        portEXIT_CRITICAL(&s_mux);
+        d.switchCostS = expectedAttachS(r);
+        const float paidBack = d.switchCostS * 3600.0f / CARRIER_SWITCH_HORIZON_S;
+        d.worthIt = d.currentCostS - d.candidateCostS > paidBack + CARRIER_SWITCH_MARGIN_S;
+    }
+    if (out) *out = d;
+    return d.worthIt;
+}
+
+bool carrier_history_flush() {
+    portENTER_CRITICAL(&s_mux);
+    const bool pending = s_dirty;
+    portEXIT_CRITICAL(&s_mux);
+    return !s_started || !pending || commit();
+}
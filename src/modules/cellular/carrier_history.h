@@ -0,0 +1,75 @@
+/*
+ * Carrier History
+ * What each carrier has been like here, kept in NVS so it survives reboots,
+ * and the expected-cost model NetworkManager decides carrier switches by:
+ *   - per carrier: attach attempts, failures and time to attach, speed test
+ *     throughput, connection drops and connected time, the last two also per
+ *     hour of the day (local time, once the clock is set)
+ *   - per cell (the last CARRIER_HISTORY_CELLS seen): drops and connected time
+ *   - the cost of a carrier is the connected time it is expected to lose per
+ *     hour: drop rate times the time to attach again, plus a penalty while its
+ *     measured upload rate is below the minimum. Rates with little history are
+ *     pulled towards the wider estimate (cell to hour of day to carrier to
+ *     CARRIER_PRIOR_DROPS_PER_H), so a few events do not swing the decision.
+ *   - a switch costs a full attach on the other carrier. It is only worth it
+ *     when the saving, paid back over CARRIER_SWITCH_HORIZON_S, beats that
+ *     attach by CARRIER_SWITCH_MARGIN_S per hour.
+ *
+ * Counts are halved once a carrier has CARRIER_HISTORY_AGE_MIN minutes of
+ * history, so old behaviour fades. Records are committed on attach events
+ * and at most every CARRIER_HISTORY_COMMIT_MS otherwise.
+ */
+
+#ifndef CARRIER_HISTORY_H
+#define CARRIER_HISTORY_H
+
+#include <Arduino.h>
+#include "../../../include/network_config.h"
+
+#ifndef CARRIER_HISTORY_CELLS
+#define CARRIER_HISTORY_CELLS 8
+#endif
+#ifndef CARRIER_HISTORY_COMMIT_MS
+#define CARRIER_HISTORY_COMMIT_MS 900000      // flash writes for connected time
+#endif
+#ifndef CARRIER_HISTORY_AGE_MIN
+#define CARRIER_HISTORY_AGE_MIN 43200         // 30 days of connected time per carrier
+#endif
+#ifndef CARRIER_PRIOR_DROPS_PER_H
+#define CARRIER_PRIOR_DROPS_PER_H 0.1f
+#endif
+#ifndef CARRIER_DEFAULT_ATTACH_MS
+#define CARRIER_DEFAULT_ATTACH_MS 90000       // until an attach has been timed
+#endif
+#ifndef CARRIER_SWITCH_HORIZON_S
+#define CARRIER_SWITCH_HORIZON_S 14400        // a switch is paid back over this long
+#endif
+#ifndef CARRIER_SWITCH_MARGIN_S
+#define CARRIER_SWITCH_MARGIN_S 30            // per hour, hysteresis against flapping
+#endif
+
+struct CarrierSwitchDecision {
+    float currentCostS;      // expected seconds lost per hour staying
+    float candidateCostS;    // ... on the other carrier
+    float switchCostS;       // expected attach time on the other carrier
+    bool worthIt;
+};
+
+void carrier_history_begin();
+
+// NetworkManager reports, under its mutex
+void carrier_history_attach(NetworkCarrier carrier, bool ok, uint32_t ms);
+void carrier_history_drop(NetworkCarrier carrier, const char* cellId);
+void carrier_history_connected(NetworkCarrier carrier, const char* cellId, uint32_t ms);
+void carrier_history_throughput(NetworkCarrier carrier, uint16_t upKbps, uint16_t downKbps);
+
+// Expected seconds lost per hour on a carrier; live is the current link
+// quality when it is the carrier in use, cellId its serving cell (or null)
+float carrier_history_cost(NetworkCarrier carrier, const char* cellId, ConnectionQuality live,
+                           uint16_t minUpKbps);
+bool carrier_history_should_switch(NetworkCarrier current, NetworkCarrier candidate, const char* cellId,
+                                   ConnectionQuality live, uint16_t minUpKbps, CarrierSwitchDecision* out);
+
+bool carrier_history_flush();
+
+#endif // CARRIER_HISTORY_H
@@ -4,14 +4,114 @@
  */
 
 #include "network_manager.h"
+#include "carrier_history.h"
+#include "../catm_gnss/operator_scan.h"
 #include "../../include/memory_pool.h"
 #include "../../include/error_handler.h"
 #include "../../modules/logging/log_buffer.h"
+#include "../../system/work_queue.h"
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/semphr.h>
 
+namespace {
+enum class ScanVerdict : uint8_t { Unknown, Seen, Missing };
+
+// What the last fresh operator scan says of a carrier. Soracom roams abroad, so
+// any operator that takes roamers will do when roaming is allowed.
+ScanVerdict scan_verdict(NetworkCarrier carrier, bool roaming) {
+    OperatorScanStats scan;
+    if (carrier == NetworkCarrier::AUTO || !operator_scan_get(scan)) return ScanVerdict::Unknown;
+    const char* home = carrier == NetworkCarrier::TMOBILE ? TMOBILE_MCC TMOBILE_MNC : SORACOM_MCC SORACOM_MNC;
+    for (size_t i = 0; i < scan.count; i++) {
+        const OperatorScanEntry& e = scan.entries[i];
+        if (e.stat == 3) continue;
+        if (strcmp(e.plmn, home) == 0) return ScanVerdict::Seen;
+        if (carrier == NetworkCarrier::SORACOM && roaming) return ScanVerdict::Seen;
+    }
+    return ScanVerdict::Missing;
+}
+
+// Buffer queue primitives; all run under managerMutex
+
+void buffer_reset_slots(NetworkBuffer& b) {
+    for (uint16_t i = 0; i < b.capacity; i++) {
+        b.entries[i].data = nullptr;
+        b.entries[i].next = (i + 1 < b.capacity) ? i + 1 : BUFFER_SLOT_NONE;
+    }
+    b.free_head = b.capacity ? 0 : BUFFER_SLOT_NONE;
+    for (uint8_t p = 0; p < NETWORK_BUFFER_PRIORITIES; p++) {
+        b.queues[p].head = b.queues[p].tail = BUFFER_SLOT_NONE;
+        b.priority_levels[p] = 0;
+    }
+    b.count = 0;
+    b.total_size = 0;
+}
+
+// Appends a copy of the entry to its priority queue; false without a free slot
+bool buffer_push(NetworkBuffer& b, const BufferEntry& entry, bool front) {
+    const uint16_t slot = b.free_head;
+    if (slot == BUFFER_SLOT_NONE) return false;
+    b.free_head = b.entries[slot].next;
+
+    const uint8_t p = (uint8_t)entry.priority;
+    BufferQueue& q = b.queues[p];
+    BufferEntry& e = b.entries[slot];
+    e = entry;
+    if (front) {
+        e.next = q.head;
+        q.head = slot;
+        if (q.tail == BUFFER_SLOT_NONE) q.tail = slot;
+    } else {
+        e.next = BUFFER_SLOT_NONE;
+        if (q.tail != BUFFER_SLOT_NONE) b.entries[q.tail].next = slot;
+        else q.head = slot;
+        q.tail = slot;
+    }
+    b.count++;
+    b.total_size += e.size;
+    b.priority_levels[p]++;
+    return true;
+}
+
+// Takes the oldest entry of one priority off the buffer; its data now belongs to the caller
+bool buffer_pop(NetworkBuffer& b, uint8_t p, BufferEntry& out) {
+    BufferQueue& q = b.queues[p];
+    const uint16_t slot = q.head;
+    if (slot == BUFFER_SLOT_NONE) return false;
+    BufferEntry& e = b.entries[slot];
+    out = e;
+    q.head = e.next;
+    if (q.head == BUFFER_SLOT_NONE) q.tail = BUFFER_SLOT_NONE;
+    e.data = nullptr;
+    e.next = b.free_head;
+    b.free_head = slot;
+    b.count--;
+    b.total_size -= out.size;
+    b.priority_levels[p]--;
+    return true;
+}
+
+void buffer_free_all(NetworkBuffer& b) {
+    BufferEntry entry;
+    for (uint8_t p = 0; p < NETWORK_BUFFER_PRIORITIES; p++) {
+        while (buffer_pop(b, p, entry)) POOL_FREE(entry.data);
+    }
+}
+
+NetworkCarrier other_carrier(NetworkCarrier carrier) {
+    return carrier == NetworkCarrier::TMOBILE ? NetworkCarrier::SORACOM : NetworkCarrier::TMOBILE;
+}
+
+uint16_t buffer_slots_for(uint32_t sizeLimit) {
+    uint32_t slots = sizeLimit / NETWORK_BUFFER_ENTRY_BYTES;
+    if (slots < NETWORK_BUFFER_PRIORITIES) slots = NETWORK_BUFFER_PRIORITIES;
+    if (slots >= BUFFER_SLOT_NONE) slots = BUFFER_SLOT_NONE - 1;
+    return (uint16_t)slots;
+}
+} // namespace
+
 // ============================================================================
 // GLOBAL INSTANCE
 // ============================================================================
@@ -58,9 +158,17 @@ NetworkManager::NetworkManager() {
     
     // Initialize buffer
     memset(&buffer, 0, sizeof(buffer));
-    buffer.capacity = config.buffer_size_limit / 64; // Approximate entries
+    buffer.capacity = buffer_slots_for(config.buffer_size_limit);
     buffer.entries = nullptr;
     buffer.max_size = config.buffer_size_limit;
+    buffer.free_head = BUFFER_SLOT_NONE;
+    for (uint8_t p = 0; p < NETWORK_BUFFER_PRIORITIES; p++) {
+        buffer.queues[p].head = buffer.queues[p].tail = BUFFER_SLOT_NONE;
+    }
+    
+    historyMarkMs = 0;
+    pingFailStreak = 0;
+    pendingCarrier = NetworkCarrier::AUTO;
     
     // Initialize synchronization
     managerMutex = xSemaphoreCreateMutex();
@@ -76,11 +184,7 @@ NetworkManager::NetworkManager() {
 // ============================================================================
 NetworkManager::~NetworkManager() {
     if (buffer.entries) {
-        for (uint16_t i = 0; i < buffer.count; i++) {
-            if (buffer.entries[i].data) {
-                POOL_FREE(buffer.entries[i].data);
-            }
-        }
+        buffer_free_all(buffer);
         POOL_FREE(buffer.entries);
     }
     
@@ -132,6 +236,8 @@ bool NetworkManager::connect() {
         return true;
     }
     
+    carrier_history_begin();
+    
     // Determine initial carrier
     NetworkCarrier targetCarrier = selectOptimalCarrier();
     
@@ -144,12 +250,15 @@ bool NetworkManager::connect() {
     const char* apn, *user, *pass;
     getApnConfig(targetCarrier, apn, user, pass);
     
+    uint32_t attachStart = millis();
     bool success = performConnection(apn, user, pass);
+    carrier_history_attach(targetCarrier, success, millis() - attachStart);
     
     if (success) {
         stats.state = NetworkState::CONNECTED;
         stats.successful_connections++;
         stats.last_switch_time = millis();
+        historyMarkMs = stats.last_switch_time;
         
         logbuf_printf("NetworkManager: Connected to %s (RSSI: %d)",
                      carrierToString(targetCarrier), stats.rssi);
@@ -163,16 +272,20 @@ bool NetworkManager::connect() {
         stats.failed_connections++;
         
         // Try secondary carrier if enabled
-        if (config.enable_auto_switching && targetCarrier != getSecondaryCarrier()) {
-            logbuf_printf("NetworkManager: Primary failed, trying secondary carrier...");
-            targetCarrier = getSecondaryCarrier();
+        if (config.enable_auto_switching) {
+            logbuf_printf("NetworkManager: %s failed, trying the other carrier...", carrierToString(targetCarrier));
+            targetCarrier = other_carrier(targetCarrier);
+            getApnConfig(targetCarrier, apn, user, pass);
+            attachStart = millis();
             success = performConnection(apn, user, pass);
+            carrier_history_attach(targetCarrier, success, millis() - attachStart);
             
             if (success) {
                 stats.state = NetworkState::CONNECTED;
                 stats.carrier = targetCarrier;
                 stats.successful_connections++;
                 stats.last_switch_time = millis();
+                historyMarkMs = stats.last_switch_time;
                 
                 logbuf_printf("NetworkManager: Connected to secondary %s", carrierToString(targetCarrier));
             }
@@ -198,6 +311,12 @@ bool NetworkManager::disconnect() {
     
     logbuf_printf("NetworkManager: Disconnecting from %s", carrierToString(stats.carrier));
     
+    if (historyMarkMs) {
+        carrier_history_connected(stats.carrier, stats.cell_id, millis() - historyMarkMs);
+        historyMarkMs = 0;
+    }
+    carrier_history_flush();
+    
     // Perform disconnection
     bool success = performDisconnection();
     
@@ -231,8 +350,13 @@ bool NetworkManager::switchCarrier(NetworkCarrier targetCarrier) {
     logbuf_printf("NetworkManager: Switching from %s to %s",
                  carrierToString(stats.carrier), carrierToString(targetCarrier));
     
+    NetworkCarrier previousCarrier = stats.carrier;
     stats.state = NetworkState::SWITCHING;
     
+    if (historyMarkMs) {
+        carrier_history_connected(previousCarrier, stats.cell_id, millis() - historyMarkMs);
+    }
+    
     // Disconnect from current carrier
     performDisconnection();
     
@@ -240,7 +364,10 @@ bool NetworkManager::switchCarrier(NetworkCarrier targetCarrier) {
     const char* apn, *user, *pass;
     getApnConfig(targetCarrier, apn, user, pass);
     
+    uint32_t attachStart = millis();
     bool success = performConnection(apn, user, pass);
+    carrier_history_attach(targetCarrier, success, millis() - attachStart);
+    historyMarkMs = millis();
     
     if (success) {
         stats.carrier = targetCarrier;
@@ -257,7 +384,6 @@ bool NetworkManager::switchCarrier(NetworkCarrier targetCarrier) {
                       "Carrier switch failed");
         
         // Try to reconnect to previous carrier
-        NetworkCarrier previousCarrier = getSecondaryCarrier();
         getApnConfig(previousCarrier, apn, user, pass);
         performConnection(apn, user, pass);
         stats.carrier = previousCarrier;
@@ -283,6 +409,13 @@ void NetworkManager::performHealthCheck() {
     bool pingSuccess = performPingTest();
     uint32_t latency = millis() - startTime;
     
+    // Connected time since the last check goes into the carrier history
+    uint32_t now = millis();
+    if (historyMarkMs) {
+        carrier_history_connected(stats.carrier, stats.cell_id, now - historyMarkMs);
+    }
+    historyMarkMs = now;
+    
     // Update health metrics
     healthMetrics.last_ping_time = startTime;
     
@@ -295,8 +428,15 @@ void NetworkManager::performHealthCheck() {
         if (latency > healthMetrics.max_latency_ms) {
             healthMetrics.max_latency_ms = latency;
         }
+        pingFailStreak = 0;
     } else {
         healthMetrics.ping_failure_count++;
+        
+        // A run of failed pings is a dropped connection
+        if (++pingFailStreak == NETWORK_DROP_PING_FAILURES) {
+            healthMetrics.connection_drops++;
+            carrier_history_drop(stats.carrier, stats.cell_id);
+        }
     }
     
     // Calculate packet loss rate
@@ -311,14 +451,12 @@ void NetworkManager::performHealthCheck() {
     healthMetrics.last_quality_update = millis();
     
     // Check if carrier switch is needed
-    if (config.enable_auto_switching && shouldSwitchCarrier()) {
-        NetworkCarrier betterCarrier = selectOptimalCarrier();
-        if (betterCarrier != stats.carrier) {
-            logbuf_printf("NetworkManager: Health check suggests switching to %s",
-                         carrierToString(betterCarrier));
-            // Schedule carrier switch (don't block health check)
-            scheduleCarrierSwitch(betterCarrier);
-        }
+    NetworkCarrier betterCarrier;
+    if (config.enable_auto_switching && shouldSwitchCarrier(betterCarrier)) {
+        logbuf_printf("NetworkManager: Health check suggests switching to %s",
+                     carrierToString(betterCarrier));
+        // Schedule carrier switch (don't block health check)
+        scheduleCarrierSwitch(betterCarrier);
     }
     
     // Update signal quality
@@ -372,6 +510,7 @@ void NetworkManager::performSpeedTest() {
     stats.upload_speed_kbps = uploadSpeed;
     stats.download_speed_kbps = downloadSpeed;
     stats.last_speed_test = millis();
+    carrier_history_throughput(stats.carrier, uploadSpeed, downloadSpeed);
     
     // Check if speeds meet minimum requirements
     bool speedAdequate = (uploadSpeed >= config.min_upload_speed_kbps) &&
@@ -382,8 +521,8 @@ void NetworkManager::performSpeedTest() {
                      uploadSpeed, downloadSpeed,
                      config.min_upload_speed_kbps, config.min_download_speed_kbps);
         
-        NetworkCarrier betterCarrier = selectOptimalCarrier();
-        if (betterCarrier != stats.carrier) {
+        NetworkCarrier betterCarrier;
+        if (shouldSwitchCarrier(betterCarrier)) {
             scheduleCarrierSwitch(betterCarrier);
         }
     }
@@ -398,111 +537,204 @@ void NetworkManager::performSpeedTest() {
 // DATA BUFFERING
 // ============================================================================
 bool NetworkManager::bufferData(const char* data, uint16_t size, BufferPriority priority) {
+    if (!data || size == 0 || (uint8_t)priority >= NETWORK_BUFFER_PRIORITIES) return false;
     if (!takeMutex()) return false;
     
-    // Check buffer capacity
-    if (buffer.total_size + size > buffer.max_size) {
-        // Remove low priority entries to make space
-        if (!evictLowPriorityEntries(size)) {
-            buffer.overflow = true;
-            giveMutex();
-            
-            REPORT_ERROR(ERROR_MEMORY_FAULT, ErrorSeverity::WARNING, ErrorCategory::NETWORK,
-                          "Network buffer overflow");
-            return false;
-        }
-    }
-    
-    // Allocate new entry
+    // Allocate slot array
     if (!buffer.entries) {
         buffer.entries = (BufferEntry*)POOL_ALLOC(buffer.capacity * sizeof(BufferEntry));
         if (!buffer.entries) {
             giveMutex();
             return false;
         }
-        memset(buffer.entries, 0, buffer.capacity * sizeof(BufferEntry));
+        buffer_reset_slots(buffer);
     }
     
-    // Find free slot
-    uint16_t slot = findFreeBufferSlot();
-    if (slot == 0xFFFF) {
-        buffer.overflow = true;
-        giveMutex();
-        return false;
-    }
+    // Make room in bytes and slots; data no more important than this goes first
+    bool stored = size <= buffer.max_size && evictLowPriorityEntries(size, priority);
     
-    // Fill entry
-    BufferEntry& entry = buffer.entries[slot];
+    BufferEntry entry;
     entry.timestamp = millis();
     entry.priority = priority;
     entry.size = size;
-    entry.data = (char*)POOL_ALLOC(size);
+    entry.data = nullptr;
     entry.is_compressed = false;
+    entry.next = BUFFER_SLOT_NONE;
+    
+    if (stored) {
+        entry.data = (char*)POOL_ALLOC(size);
+        while (!entry.data && evictOldestEntry(priority)) {
+            entry.data = (char*)POOL_ALLOC(size);
+        }
+        stored = entry.data != nullptr;
+    }
     
-    if (!entry.data) {
+    if (!stored) {
+        // Report once per outage, not once per message
+        bool firstDrop = !buffer.overflow;
+        buffer.overflow = true;
+        buffer.rejected++;
         giveMutex();
+        
+        if (firstDrop) {
+            REPORT_ERROR(ERROR_MEMORY_FAULT, ErrorSeverity::WARNING, ErrorCategory::NETWORK,
+                          "Network buffer overflow");
+        }
         return false;
     }
     
     memcpy(entry.data, data, size);
-    
-    // Update buffer statistics
-    buffer.count++;
-    buffer.total_size += size;
-    buffer.priority_levels[(int)priority]++;
+    buffer_push(buffer, entry, false);
     
     giveMutex();
     
-    logbuf_printf("Data buffered: %u bytes, priority=%u (total: %u/%u)",
-                 size, (int)priority, buffer.total_size, buffer.max_size);
-    
     return true;
 }
 
 bool NetworkManager::flushBuffer() {
-    if (!takeMutex()) return false;
-    
+    BufferEntry batch[NETWORK_BUFFER_FLUSH_BATCH];
     bool success = true;
     uint16_t flushedCount = 0;
-    uint16_t totalBytes = 0;
-    
-    // Flush entries by priority (CRITICAL first)
-    for (int priority = 0; priority < 4 && buffer.count > 0; priority++) {
-        for (uint16_t i = 0; i < buffer.capacity && flushedCount < buffer.count; i++) {
-            BufferEntry& entry = buffer.entries[i];
+    uint32_t totalBytes = 0;
+    
+    // Take a batch by priority (CRITICAL first, oldest first within one) and
+    // send it without holding the mutex, so producers are not blocked on the modem
+    while (success) {
+        if (!takeMutex()) return false;
+        uint8_t taken = 0;
+        for (uint8_t p = 0; p < NETWORK_BUFFER_PRIORITIES && taken < NETWORK_BUFFER_FLUSH_BATCH; p++) {
+            while (taken < NETWORK_BUFFER_FLUSH_BATCH && buffer_pop(buffer, p, batch[taken])) {
+                taken++;
+            }
+        }
+        if (taken == 0) buffer.overflow = false;
+        giveMutex();
+        
+        if (taken == 0) break;
+        
+        uint8_t sent = 0;
+        while (sent < taken && transmitData(batch[sent].data, batch[sent].size)) {
+            totalBytes += batch[sent].size;
+            POOL_FREE(batch[sent].data);
+            sent++;
+        }
+        flushedCount += sent;
+        
+        if (sent < taken) {
+            success = false; // Stop flushing on first failure
             
-            if (entry.data && entry.priority == (BufferPriority)priority) {
-                // Try to send data
-                bool sendSuccess = transmitData(entry.data, entry.size);
-                
-                if (sendSuccess) {
-                    totalBytes += entry.size;
-                    flushedCount++;
-                    
-                    // Free entry
-                    POOL_FREE(entry.data);
-                    entry.data = nullptr;
-                    buffer.count--;
-                    buffer.total_size -= entry.size;
-                    buffer.priority_levels[priority]--;
-                } else {
-                    success = false;
-                    break; // Stop flushing on first failure
+            // Put the rest back at the head of their queues, newest first so the
+            // order is kept; anything that no longer fits is the oldest, drop it
+            if (takeMutex()) {
+                for (uint8_t i = taken; i-- > sent;) {
+                    if (!buffer_push(buffer, batch[i], true)) {
+                        POOL_FREE(batch[i].data);
+                        buffer.evicted++;
+                        buffer.overflow = true;
+                    }
+                }
+                giveMutex();
+            } else {
+                for (uint8_t i = sent; i < taken; i++) {
+                    POOL_FREE(batch[i].data);
                 }
+                logbuf_printf("Buffer flush: %u entries lost, buffer busy", taken - sent);
             }
         }
     }
     
-    giveMutex();
-    
     if (flushedCount > 0) {
-        logbuf_printf("Buffer flush: %u entries, %u bytes, success=%s",
-                     flushedCount, totalBytes, success ? "YES" : "NO");
+        logbuf_printf("Buffer flush: %u entries, %lu bytes, success=%s",
+                     flushedCount, (unsigned long)totalBytes, success ? "YES" : "NO");
     }
     
     return success;
 }
 
+void NetworkManager::clearBuffer() {
+    if (!takeMutex()) return;
+    
+    uint16_t dropped = buffer.count;
+    if (buffer.entries) {
+        buffer_free_all(buffer);
+    }
+    buffer.overflow = false;
+    
+    giveMutex();
+    
+    logbuf_printf("Network buffer cleared: %u entries dropped", dropped);
+}
+
+// Caller holds the mutex
+bool NetworkManager::evictLowPriorityEntries(uint32_t requiredSpace, BufferPriority priority) {
+    while (buffer.total_size + requiredSpace > buffer.max_size || buffer.free_head == BUFFER_SLOT_NONE) {
+        if (!evictOldestEntry(priority)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Drops the oldest entry of the lowest priority present, down to and
+// including the given one: a long outage keeps the newest data of each
+// priority rather than refusing it. Caller holds the mutex.
+bool NetworkManager::evictOldestEntry(BufferPriority priority) {
+    BufferEntry victim;
+    for (int p = NETWORK_BUFFER_PRIORITIES - 1; p >= (int)priority; p--) {
+        if (buffer_pop(buffer, (uint8_t)p, victim)) {
+            POOL_FREE(victim.data);
+            if (!buffer.overflow) {
+                logbuf_printf("Network buffer full: dropping oldest priority %d data", p);
+            }
+            buffer.evicted++;
+            buffer.overflow = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Caller holds the mutex; keeps what fits of the new size, least important and oldest dropped first
+bool NetworkManager::reinitializeBuffer() {
+    uint16_t slots = buffer_slots_for(config.buffer_size_limit);
+    buffer.max_size = config.buffer_size_limit;
+    
+    while ((buffer.count > slots || buffer.total_size > buffer.max_size) &&
+           evictOldestEntry(BufferPriority::BUFFER_CRITICAL)) {
+    }
+    
+    if (!buffer.entries) {
+        buffer.capacity = slots;
+        return true;
+    }
+    if (slots == buffer.capacity) {
+        return true;
+    }
+    
+    BufferEntry* entries = (BufferEntry*)POOL_ALLOC(slots * sizeof(BufferEntry));
+    if (!entries) {
+        logbuf_printf("Network buffer: keeping %u slots, no memory for %u", buffer.capacity, slots);
+        return false;
+    }
+    
+    // Move the queues over in order
+    NetworkBuffer resized = buffer;
+    resized.entries = entries;
+    resized.capacity = slots;
+    buffer_reset_slots(resized);
+    BufferEntry entry;
+    for (uint8_t p = 0; p < NETWORK_BUFFER_PRIORITIES; p++) {
+        while (buffer_pop(buffer, p, entry)) {
+            buffer_push(resized, entry, false);
+        }
+    }
+    POOL_FREE(buffer.entries);
+    buffer = resized;
+    
+    logbuf_printf("Network buffer resized: %u slots, %lu bytes", slots, (unsigned long)buffer.max_size);
+    return true;
+}
+
 // ============================================================================
 // UTILITY METHODS
 // ============================================================================
@@ -511,12 +743,18 @@ NetworkCarrier NetworkManager::selectOptimalCarrier() const {
         return config.preferred_carrier;
     }
     
-    // Auto-select based on current conditions
-    if (stats.rssi < config.switch_rssi_threshold) {
-        return getSecondaryCarrier(); // Use secondary for better coverage
-    }
-    
-    return (NetworkCarrier)1; // Default to primary (T-Mobile)
+    // Auto-select the carrier expected to lose the least connected time here;
+    // with no history either way that is the primary (T-Mobile)
+    float primaryCost = carrier_history_cost(NetworkCarrier::TMOBILE, nullptr, ConnectionQuality::GOOD,
+                                             config.min_upload_speed_kbps);
+    float secondaryCost = carrier_history_cost(NetworkCarrier::SORACOM, nullptr, ConnectionQuality::GOOD,
+                                               config.min_upload_speed_kbps);
+    // A fresh operator scan that found only one of them settles it
+    const ScanVerdict primaryScan = scan_verdict(NetworkCarrier::TMOBILE, config.enable_roaming);
+    const ScanVerdict secondaryScan = scan_verdict(NetworkCarrier::SORACOM, config.enable_roaming);
+    if (primaryScan == ScanVerdict::Missing && secondaryScan != ScanVerdict::Missing) return NetworkCarrier::SORACOM;
+    if (secondaryScan == ScanVerdict::Missing && primaryScan != ScanVerdict::Missing) return NetworkCarrier::TMOBILE;
+    return secondaryCost < primaryCost ? NetworkCarrier::SORACOM : NetworkCarrier::TMOBILE;
 }
 
 NetworkCarrier NetworkManager::getSecondaryCarrier() const {
@@ -540,26 +778,54 @@ void NetworkManager::getApnConfig(NetworkCarrier carrier, const char*& apn,
     }
 }
 
-bool NetworkManager::shouldSwitchCarrier() const {
-    // Check various conditions for carrier switching
-    
-    // Poor signal quality
-    if (rssiToQuality(stats.rssi) < ConnectionQuality::FAIR) {
-        return true;
+bool NetworkManager::shouldSwitchCarrier(NetworkCarrier& target) const {
+    // Pinned to a carrier: only ever go back to it
+    if (config.preferred_carrier != NetworkCarrier::AUTO) {
+        target = config.preferred_carrier;
+        return stats.carrier != target;
     }
     
-    // High packet loss
-    if (healthMetrics.packet_loss_rate > 5.0f) {
-        return true;
+    // Weak signal, loss and latency all lower the live quality, which raises
+    // the expected drop rate of the current carrier; whether that is worth a
+    // full attach elsewhere is down to both carriers' history
+    target = other_carrier(stats.carrier);
+    if (scan_verdict(target, config.enable_roaming) == ScanVerdict::Missing) {
+        return false;
     }
-    
-    // Poor performance
-    if (stats.upload_speed_kbps < config.min_upload_speed_kbps ||
-        stats.download_speed_kbps < config.min_download_speed_kbps) {
-        return true;
+    CarrierSwitchDecision decision;
+    if (!carrier_history_should_switch(stats.carrier, target, stats.cell_id, calculateConnectionQuality(),
+                                       config.min_upload_speed_kbps, &decision)) {
+        return false;
     }
     
-    return false;
+    logbuf_printf("NetworkManager: %s expected to lose %.0f s/h, %s %.0f s/h plus a %.0f s attach",
+                 carrierToString(stats.carrier), decision.currentCostS, carrierToString(target),
+                 decision.candidateCostS, decision.switchCostS);
+    return true;
+}
+
+// Answered from the cached operator scan: attaching to find out would take the radio from the uplink
+bool NetworkManager::testConnection(NetworkCarrier carrier) {
+    const ScanVerdict verdict = scan_verdict(carrier, config.enable_roaming);
+    if (verdict == ScanVerdict::Unknown) {
+        operator_scan_request();
+        logbuf_printf("NetworkManager: no fresh operator scan for %s, one requested", carrierToString(carrier));
+        return false;
+    }
+    return verdict == ScanVerdict::Seen;
+}
+
+// The scan itself runs on the modem task in the RF arbiter's idle windows
+void NetworkManager::scanNetworks() {
+    operator_scan_request();
+    OperatorScanStats scan;
+    const bool fresh = operator_scan_get(scan);
+    logbuf_printf("NetworkManager: operator scan requested; cached %u operators (%s)", (unsigned)scan.count,
+                  fresh ? "fresh" : "stale");
+    for (size_t i = 0; i < scan.count; i++) {
+        logbuf_printf("  %s %s stat %u act %u", scan.entries[i].plmn, scan.entries[i].name,
+                      (unsigned)scan.entries[i].stat, (unsigned)scan.entries[i].act);
+    }
 }
 
 // ============================================================================
@@ -578,9 +844,23 @@ void NetworkManager::giveMutex() const {
 // ============================================================================
 // TASK SCHEDULING
 // ============================================================================
+// Both run on the modem-side worker; a request while one is queued coalesces
+void NetworkManager::scheduleHealthCheck() {
+    work_submit("NetHealth", [](void* ctx) { static_cast<NetworkManager*>(ctx)->performHealthCheck(); }, this,
+                WorkPriority::Normal, WORK_CORE_MODEM, WORK_COALESCE);
+}
+
+void NetworkManager::scheduleSpeedTest() {
+    work_submit("SpeedTest", [](void* ctx) { static_cast<NetworkManager*>(ctx)->performSpeedTest(); }, this,
+                WorkPriority::Low, WORK_CORE_MODEM, WORK_COALESCE);
+}
+
+// Runs after the caller has released the mutex; a newer target replaces a queued one
 void NetworkManager::scheduleCarrierSwitch(NetworkCarrier carrier) {
-    // Simple implementation - just switch immediately
-    // In a full implementation, this would schedule a task to avoid blocking
     logbuf_printf("NetworkManager: Scheduling switch to %s", carrierToString(carrier));
-    switchCarrier(carrier);
+    pendingCarrier = carrier;
+    work_submit("NetSwitch", [](void* ctx) {
+                    NetworkManager* self = static_cast<NetworkManager*>(ctx);
+                    self->switchCarrier(self->pendingCarrier);
+                }, this, WorkPriority::Normal, WORK_CORE_MODEM, WORK_COALESCE);
 }
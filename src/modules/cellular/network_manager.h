@@ -14,6 +14,21 @@
 #include <freertos/task.h>
 #include <freertos/semphr.h>
 
+// Average entry size the slot array is sized for: buffer_size_limit / this
+#ifndef NETWORK_BUFFER_ENTRY_BYTES
+#define NETWORK_BUFFER_ENTRY_BYTES 64
+#endif
+
+// Entries taken off the buffer per mutex hold while flushing
+#ifndef NETWORK_BUFFER_FLUSH_BATCH
+#define NETWORK_BUFFER_FLUSH_BATCH 8
+#endif
+
+// Consecutive failed health pings that count as a dropped connection
+#ifndef NETWORK_DROP_PING_FAILURES
+#define NETWORK_DROP_PING_FAILURES 3
+#endif
+
 // ============================================================================
 // NETWORK MANAGER CLASS
 // ============================================================================
@@ -27,17 +42,20 @@ private:
     // Synchronization
     SemaphoreHandle_t managerMutex;
     
-    // Task handles
-    TaskHandle_t healthCheckTask;
-    TaskHandle_t speedTestTask;
+    // Task handles; health checks and speed tests run as work queue jobs
     TaskHandle_t bufferFlushTask;
     
+    // Carrier history bookkeeping
+    uint32_t historyMarkMs;          // connected time recorded up to here, 0 = not connected
+    uint8_t pingFailStreak;
+    volatile NetworkCarrier pendingCarrier;
+    
     // Internal methods
     NetworkCarrier selectOptimalCarrier() const;
     NetworkCarrier getSecondaryCarrier() const;
     void getApnConfig(NetworkCarrier carrier, const char*& apn, 
                       const char*& user, const char*& pass) const;
-    bool shouldSwitchCarrier() const;
+    bool shouldSwitchCarrier(NetworkCarrier& target) const;
     ConnectionQuality calculateConnectionQuality() const;
     
     // Low-level operations (to be implemented in cellular module)
@@ -51,8 +69,8 @@ private:
     
     // Buffer management
     bool reinitializeBuffer();
-    bool evictLowPriorityEntries(uint32_t requiredSpace);
-    uint16_t findFreeBufferSlot();
+    bool evictLowPriorityEntries(uint32_t requiredSpace, BufferPriority priority);
+    bool evictOldestEntry(BufferPriority priority);
     
     // Synchronization helpers
     bool takeMutex() const;
@@ -134,8 +152,6 @@ public:
 // ============================================================================
 // TASK FUNCTION DECLARATIONS
 // ============================================================================
-void vTaskNetworkHealthCheck(void* pvParameters);
-void vTaskNetworkSpeedTest(void* pvParameters);
 void vTaskNetworkBufferFlush(void* pvParameters);
 
 // ============================================================================
@@ -1,24 +1,51 @@
 #include "log_buffer.h"
+#include "log_uplink.h"
 #include "../storage/storage_task.h"
+#include "../../system/kernel_objects.h"
+#include "../../system/reset_journal.h"
+#include "../../ui/ui_frame.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 
 static char s_lines[LOG_BUFFER_CAPACITY][LOG_BUFFER_LINE_LEN];
 static size_t s_head = 0;   // next write position
 static size_t s_count = 0;  // number of valid lines
+static uint32_t s_seq = 0;  // lines added since boot
 static SemaphoreHandle_t s_mutex = nullptr;
 
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+static LogRingEntry s_ring[LOG_RING_SLOTS];
+static std::atomic<uint32_t> s_ringHead{0};   // next claim
+static uint32_t s_ringTail = 0;               // next to format; consumers hold s_mutex
+static uint32_t s_ringDropped = 0;
+
 void log_init() {
     if (!s_mutex) {
-        s_mutex = xSemaphoreCreateMutex();
+        s_mutex = kernel_mutex_create(KernelMutex::LogBuffer);
+    }
+}
+
+// Lines reporting a problem are kept longer under storage pressure than the
+// routine chatter, which the RAM buffer and the uplink still carry
+static StoragePriority log_storage_priority(const char* line) {
+    static const char* const kKeep[] = {"error", "fail", "warn"};
+    for (const char* p = line; *p; p++) {
+        for (const char* word : kKeep) {
+            size_t k = 0;
+            while (word[k] && tolower((unsigned char)p[k]) == word[k]) k++;
+            if (!word[k]) return StoragePriority::Normal;
+        }
     }
+    return StoragePriority::Optional;
 }
 
-static void log_add_unlocked(const char* line) {
+static void log_add_unlocked(const char* line, uint32_t timestampMs) {
     size_t i = s_head % LOG_BUFFER_CAPACITY;
     // Timestamp prefix [ms]
-    int n = snprintf(s_lines[i], LOG_BUFFER_LINE_LEN, "[%lu] %s", (unsigned long)millis(), line ? line : "");
+    int n = snprintf(s_lines[i], LOG_BUFFER_LINE_LEN, "[%lu] %s", (unsigned long)timestampMs, line ? line : "");
     if (n < 0) {
         s_lines[i][0] = '\0';
     } else {
@@ -26,22 +53,179 @@ static void log_add_unlocked(const char* line) {
     }
     s_head = (s_head + 1) % LOG_BUFFER_CAPACITY;
     if (s_count < LOG_BUFFER_CAPACITY) s_count++;
+    s_seq++;
+    ui_data_changed(UiData::Logs);
 
     // Also push to SD storage queue if available
-    if (g_storageQ && line) {
-        LogRecord rec;
-        rec.type = LogRecord::SYSTEM;
-        strncpy(rec.line, s_lines[i], sizeof(rec.line) - 1);
-        rec.line[sizeof(rec.line) - 1] = '\0';
-        // Non-blocking send - drop if queue full
-        xQueueSend(g_storageQ, &rec, 0);
+    if (line) {
+        // Non-blocking send - drop if the buffer is full or storage is shedding
+        storage_push(StorageStreamId::System, s_lines[i], strnlen(s_lines[i], LOG_BUFFER_LINE_LEN), 0,
+                     log_storage_priority(line));
+        log_uplink_offer(LOG_UPLINK_UNTAGGED, DEBUG_LOG_LEVEL_INFO, line);
+        reset_journal_line(timestampMs, line);
+    }
+}
+
+LogRingEntry* logring_begin(uint32_t& idx) {
+    idx = s_ringHead.fetch_add(1, std::memory_order_relaxed);
+    LogRingEntry* e = &s_ring[idx & (LOG_RING_SLOTS - 1)];
+    e->seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    e->timestampMs = millis();
+    e->words = 0;
+    e->strBytes = 0;
+    return e;
+}
+
+void logring_end(LogRingEntry* e, uint32_t idx) {
+    e->seq.store(idx + 1, std::memory_order_release);
+}
+
+// Pulls the next word pair as a 64-bit value (low word first, as packed)
+static uint64_t take_wide(const LogRingEntry& e, uint8_t& w) {
+    uint64_t lo = w < e.words ? e.args[w] : 0;
+    uint64_t hi = w + 1 < e.words ? e.args[w + 1] : 0;
+    w += 2;
+    return lo | (hi << 32);
+}
+
+static uint32_t take_word(const LogRingEntry& e, uint8_t& w) {
+    return w < e.words ? e.args[w++] : (w++, 0);
+}
+
+// Replays fmt against the packed words one conversion at a time
+static void logring_format(const LogRingEntry& e, char* out, size_t outsz) {
+    size_t n = 0;
+    uint8_t w = 0;
+    const char* p = e.fmt ? e.fmt : "";
+    while (*p && n + 1 < outsz) {
+        if (*p != '%') {
+            out[n++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[n++] = '%';
+            p += 2;
+            continue;
+        }
+        // Copy one conversion spec, taking '*' widths from the arguments
+        char spec[24];
+        size_t k = 0;
+        spec[k++] = *p++;
+        int star[2] = {0, 0};
+        int stars = 0;
+        while (*p && strchr("-+ #0123456789.*", *p) && k < sizeof(spec) - 4) {
+            if (*p == '*' && stars < 2) star[stars++] = static_cast<int>(take_word(e, w));
+            spec[k++] = *p++;
+        }
+        size_t bytes = 4;   // argument size the length modifier implies
+        int longs = 0;
+        while (*p && strchr("hlLjzt", *p) && k < sizeof(spec) - 3) {
+            switch (*p) {
+                case 'l': bytes = ++longs >= 2 ? 8 : sizeof(long); break;
+                case 'j': bytes = 8; break;
+                case 'z': bytes = sizeof(size_t); break;
+                case 't': bytes = sizeof(ptrdiff_t); break;
+                default: break;
+            }
+            if (*p != 'L') spec[k++] = *p;   // doubles only; no long double in the ring
+            p++;
+        }
+        const char conv = *p ? *p++ : '\0';
+        spec[k++] = conv;
+        spec[k] = '\0';
+        char* dst = out + n;
+        const size_t room = outsz - n;
+        int wrote = 0;
+        auto emit = [&](auto value) {
+            if (stars == 2) wrote = snprintf(dst, room, spec, star[0], star[1], value);
+            else if (stars == 1) wrote = snprintf(dst, room, spec, star[0], value);
+            else wrote = snprintf(dst, room, spec, value);
+        };
+        switch (conv) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                if (bytes > 4) emit(static_cast<long long>(take_wide(e, w)));
+                else emit(static_cast<int>(take_word(e, w)));
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                const uint64_t bits = take_wide(e, w);
+                double v;
+                memcpy(&v, &bits, sizeof(v));
+                emit(v);
+                break;
+            }
+            case 's': {
+                const uint32_t off = take_word(e, w);
+                emit(off < e.strBytes ? e.str + off : "?");
+                break;
+            }
+            case 'p':
+                emit(reinterpret_cast<void*>(static_cast<uintptr_t>(take_wide(e, w))));
+                break;
+            default:
+                break;   // %n and unknown conversions print nothing
+        }
+        if (wrote > 0) n += static_cast<size_t>(wrote) < room ? static_cast<size_t>(wrote) : room - 1;
+    }
+    out[n] = '\0';
+}
+
+// Caller holds s_mutex
+static void log_pump_unlocked() {
+    const uint32_t head = s_ringHead.load(std::memory_order_acquire);
+    if (head - s_ringTail > LOG_RING_SLOTS) {
+        s_ringDropped += head - s_ringTail - LOG_RING_SLOTS;
+        s_ringTail = head - LOG_RING_SLOTS;
+    }
+    while (s_ringTail != head) {
+        const LogRingEntry& slot = s_ring[s_ringTail & (LOG_RING_SLOTS - 1)];
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != s_ringTail + 1) {
+            if (seq == 0 && head - s_ringTail <= LOG_RING_SLOTS / 2) {
+                break;   // still being written; keep order and come back later
+            }
+            s_ringDropped++;   // overwritten by a lapping producer, or its writer stalled
+            s_ringTail++;
+            continue;
+        }
+        LogRingEntry copy;
+        copy.timestampMs = slot.timestampMs;
+        copy.fmt = slot.fmt;
+        copy.words = slot.words;
+        copy.strBytes = slot.strBytes;
+        memcpy(copy.args, slot.args, sizeof(copy.args));
+        memcpy(copy.str, slot.str, sizeof(copy.str));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) {
+            s_ringDropped++;
+            s_ringTail++;
+            continue;
+        }
+        char line[LOG_BUFFER_LINE_LEN];
+        logring_format(copy, line, sizeof(line));
+        log_add_unlocked(line, copy.timestampMs);
+        s_ringTail++;
+    }
+}
+
+void log_pump() {
+    if (s_ringHead.load(std::memory_order_relaxed) == s_ringTail) return;
+    if (!s_mutex) log_init();
+    if (xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE) {
+        log_pump_unlocked();
+        xSemaphoreGive(s_mutex);
     }
 }
 
+uint32_t log_ring_dropped() {
+    return s_ringDropped;
+}
+
 void log_add(const char* line) {
     if (!s_mutex) log_init();
     if (xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE) {
-        log_add_unlocked(line);
+        log_pump_unlocked();   // keep deferred entries ahead of this line
+        log_add_unlocked(line, millis());
         xSemaphoreGive(s_mutex);
     }
 }
@@ -53,13 +237,16 @@ void logbuf_printf(const char* fmt, ...) {
     va_list ap; va_start(ap, fmt);
     vsnprintf(buf, sizeof(buf), fmt, ap);
     va_end(ap);
+    const uint32_t now = millis();
     if (xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE) {
-        log_add_unlocked(buf);
+        log_pump_unlocked();
+        log_add_unlocked(buf, now);
         xSemaphoreGive(s_mutex);
     }
 }
 
 size_t log_count() {
+    log_pump();
     return s_count;
 }
 
@@ -81,3 +268,51 @@ bool log_get_line(size_t idx_from_oldest, char* out, size_t outsz) {
     }
     return ok;
 }
+
+void log_seq_range(uint32_t& begin, uint32_t& end) {
+    begin = end = 0;
+    if (!s_mutex) log_init();
+    if (xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE) {
+        log_pump_unlocked();
+        end = s_seq;
+        begin = s_seq - static_cast<uint32_t>(s_count);
+        xSemaphoreGive(s_mutex);
+    }
+}
+
+bool log_get_seq(uint32_t seq, char* out, size_t outsz) {
+    if (!out || outsz == 0) return false;
+    out[0] = '\0';
+    if (!s_mutex) log_init();
+    bool ok = false;
+    if (xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE) {
+        const uint32_t back = s_seq - seq;   // 1 for the newest line
+        if (back >= 1 && back <= s_count) {
+            const size_t pos = (s_head + LOG_BUFFER_CAPACITY - back) % LOG_BUFFER_CAPACITY;
+            strncpy(out, s_lines[pos], outsz - 1);
+            out[outsz - 1] = '\0';
+            ok = true;
+        }
+        xSemaphoreGive(s_mutex);
+    }
+    return ok;
+}
+
+bool log_peek_line_unlocked(size_t idx_from_newest, char* out, size_t outsz) {
+    if (!out || outsz == 0) return false;
+    out[0] = '\0';
+    const size_t count = s_count;
+    if (idx_from_newest >= count) return false;
+    const size_t pos = (s_head + LOG_BUFFER_CAPACITY - 1 - idx_from_newest) % LOG_BUFFER_CAPACITY;
+    size_t n = 0;
+    while (n + 1 < outsz && n + 1 < LOG_BUFFER_LINE_LEN && s_lines[pos][n]) {
+        out[n] = s_lines[pos][n];
+        n++;
+    }
+    out[n] = '\0';
+    return true;
+}
+
+uint32_t log_ring_pending() {
+    return s_ringHead.load(std::memory_order_relaxed) - s_ringTail;
+}
@@ -5,6 +5,9 @@
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <atomic>
+#include <string.h>
+#include <type_traits>
 
 #ifndef LOG_BUFFER_CAPACITY
 #define LOG_BUFFER_CAPACITY 100
@@ -14,14 +17,117 @@
 #define LOG_BUFFER_LINE_LEN 160
 #endif
 
+#ifndef LOG_RING_SLOTS
+#define LOG_RING_SLOTS 64          // deferred entries in flight; power of two
+#endif
+#define LOG_RING_MAX_WORDS 8       // argument words per entry (a double takes two)
+#define LOG_RING_STR_BYTES 32      // copied %s text per entry, all strings together
+
 void log_init();
 void log_add(const char* line);
 // printf-style logging into the ring buffer (name avoids clash with ESP-IDF's log_printf)
 void logbuf_printf(const char* fmt, ...);
 
+// Deferred logging for hot paths: LOGF("fmt", args...) stores the format pointer,
+// a timestamp and the raw arguments into a lock-free multi-producer ring and
+// returns; no mutex, no formatting. Text is produced when the log is read (logs
+// page, SD sink via log_pump()). fmt must be a string literal, since only its
+// address is kept. %s arguments are copied, truncated to LOG_RING_STR_BYTES in
+// total. When producers lap the reader the oldest entries are dropped.
+#define LOGF(fmt, ...) logring_emit(fmt, ##__VA_ARGS__)
+
+// Formats pending deferred entries into the line buffer and the SD stream
+void log_pump();
+uint32_t log_ring_dropped();
+
 // Read API
 size_t log_count();
 // Get line by index from oldest (0) to newest (count-1). Returns false if out of range.
 bool log_get_line(size_t idx_from_oldest, char* out, size_t outsz);
+// Lines are also numbered from boot: [begin, end) are still in the buffer. A
+// sequence number keeps naming the same line as newer lines push older ones out.
+void log_seq_range(uint32_t& begin, uint32_t& end);
+bool log_get_seq(uint32_t seq, char* out, size_t outsz);
+
+// Panic-context read (crash_dump.h): copies the line idx_from_newest back without
+// the mutex and without formatting; the line being written may come out torn.
+bool log_peek_line_unlocked(size_t idx_from_newest, char* out, size_t outsz);
+// Deferred entries claimed but not yet formatted into the line buffer
+uint32_t log_ring_pending();
+
+// ---------------------------------------------------------------------------
+// Deferred ring internals (used by LOGF)
+// ---------------------------------------------------------------------------
+struct LogRingEntry {
+    std::atomic<uint32_t> seq;     // claim index + 1 once complete, 0 while written
+    uint32_t timestampMs;
+    const char* fmt;
+    uint8_t words;
+    uint8_t strBytes;
+    uint32_t args[LOG_RING_MAX_WORDS];
+    char str[LOG_RING_STR_BYTES];
+};
+
+LogRingEntry* logring_begin(uint32_t& idx);
+void logring_end(LogRingEntry* e, uint32_t idx);
+
+namespace logring_detail {
+inline void word(LogRingEntry& e, uint32_t v) {
+    if (e.words < LOG_RING_MAX_WORDS) e.args[e.words++] = v;
+}
+
+inline void wide(LogRingEntry& e, uint64_t v) {
+    word(e, static_cast<uint32_t>(v));
+    word(e, static_cast<uint32_t>(v >> 32));
+}
+
+// Strings go into e.str; the word holds the offset, or 0xFF when out of room
+inline void put(LogRingEntry& e, const char* s) {
+    if (!s) s = "(null)";
+    const uint8_t off = e.strBytes;
+    if (off >= LOG_RING_STR_BYTES) {
+        word(e, 0xFF);
+        return;
+    }
+    size_t n = strnlen(s, LOG_RING_STR_BYTES - 1 - off);
+    memcpy(e.str + off, s, n);
+    e.str[off + n] = '\0';
+    e.strBytes = static_cast<uint8_t>(off + n + 1);
+    word(e, off);
+}
+inline void put(LogRingEntry& e, char* s) { put(e, static_cast<const char*>(s)); }
+
+inline void put(LogRingEntry& e, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    wide(e, bits);
+}
+inline void put(LogRingEntry& e, float v) { put(e, static_cast<double>(v)); }
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type put(LogRingEntry& e,
+                                                                                               T v) {
+    if (sizeof(T) > 4) {
+        wide(e, static_cast<uint64_t>(v));
+    } else {
+        word(e, static_cast<uint32_t>(v));
+    }
+}
+
+template <typename T>
+inline void put(LogRingEntry& e, const T* p) {
+    wide(e, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(p)));
+}
+} // namespace logring_detail
+
+template <typename... Args>
+inline void logring_emit(const char* fmt, Args... args) {
+    uint32_t idx;
+    LogRingEntry* e = logring_begin(idx);
+    e->fmt = fmt;
+    int expand[] = {0, (logring_detail::put(*e, args), 0)...};
+    (void)expand;
+    logring_end(e, idx);
+}
 
 #endif // LOG_BUFFER_H
@@ -0,0 +1,248 @@
+/*
+ * Remote Log Uplink Implementation
+ */
+
+#include "log_uplink.h"
+#include "log_buffer.h"
+#include "../../../include/transport.h"
+#include <freertos/FreeRTOS.h>
+#include <algorithm>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#if LOG_UPLINK_ENABLE
+
+namespace {
+constexpr uint8_t kAnyTag = 0xFF;
+constexpr size_t kRecordOverhead = 48;   // {"log":"..."} plus the suppressed count
+constexpr size_t kLineOverhead = 16;     // uptime prefix, repeat suffix, separator, escapes
+
+struct BatchLine {
+    uint32_t hash;
+    uint32_t firstMs;
+    uint16_t offset;
+    uint8_t len;
+    uint16_t count;
+};
+
+// Filter; written by the configuring task, read by every producer
+volatile bool s_enabled = false;
+volatile uint8_t s_filterTag = kAnyTag;
+volatile uint8_t s_minLevel = DEBUG_LOG_LEVEL_WARN;
+
+// Batch under s_mux
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+char s_text[LOG_UPLINK_BATCH_BYTES];
+BatchLine s_lines[LOG_UPLINK_BATCH_LINES];
+uint8_t s_lineCount = 0;
+uint16_t s_textUsed = 0;
+uint32_t s_pendingSuppressed = 0;   // not yet reported to the server
+LogUplinkStats s_stats{};
+
+// Poller state
+char s_outText[LOG_UPLINK_BATCH_BYTES];
+BatchLine s_outLines[LOG_UPLINK_BATCH_LINES];
+char s_record[TRANSPORT_MAX_PACKET_BYTES];
+uint64_t s_budgetMilli = LOG_UPLINK_BYTES_PER_HOUR * 1000ULL;   // starts with a full hour
+uint32_t s_lastRefillMs = 0;
+
+uint32_t hashLine(const char* s, size_t len) {
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ static_cast<uint8_t>(s[i])) * 16777619u;
+    }
+    return h;
+}
+
+bool mentionsFailure(const char* s) {
+    static const char* const kWords[] = {"fail", "error", "drop", "lost", "reject", "timeout"};
+    for (const char* p = s; *p; p++) {
+        for (const char* w : kWords) {
+            size_t i = 0;
+            while (w[i] && tolower(static_cast<unsigned char>(p[i])) == w[i]) i++;
+            if (!w[i]) return true;
+        }
+    }
+    return false;
+}
+
+// Appends s as JSON string content; false if it does not fit
+bool appendEscaped(char* out, size_t size, size_t& n, const char* s, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        const char c = s[i];
+        char esc[7];
+        size_t k = 0;
+        if (c == '"' || c == '\\') {
+            esc[k++] = '\\';
+            esc[k++] = c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            k = snprintf(esc, sizeof(esc), "\\u%04x", static_cast<unsigned>(c));
+        } else {
+            esc[k++] = c;
+        }
+        if (n + k >= size) return false;
+        memcpy(out + n, esc, k);
+        n += k;
+    }
+    return true;
+}
+} // namespace
+
+bool log_uplink_configure(const char* spec) {
+    if (!spec || !*spec || strcasecmp(spec, "off") == 0) {
+        s_enabled = false;
+        return true;
+    }
+    const char* eq = strchr(spec, '=');
+    const size_t headLen = eq ? static_cast<size_t>(eq - spec) : strlen(spec);
+    LogTag tag;
+    LogLevel level;
+    if (log_tag_parse(spec, headLen, tag)) {
+        if (eq && !log_level_parse(eq + 1, strlen(eq + 1), level)) return false;
+        s_filterTag = static_cast<uint8_t>(tag);
+        s_minLevel = eq ? level : DEBUG_LOG_LEVEL_VERBOSE;   // the tag's own threshold still applies
+    } else if (!eq && log_level_parse(spec, headLen, level)) {
+        s_filterTag = kAnyTag;
+        s_minLevel = level;
+    } else {
+        return false;
+    }
+    s_enabled = s_minLevel != DEBUG_LOG_LEVEL_NONE;
+    return true;
+}
+
+bool log_uplink_enabled() {
+    return s_enabled;
+}
+
+void log_uplink_offer(uint8_t tag, LogLevel level, const char* line) {
+    if (!s_enabled || !line) return;
+    if (s_filterTag != kAnyTag && tag != s_filterTag) return;
+    if (tag == LOG_UPLINK_UNTAGGED && level > DEBUG_LOG_LEVEL_WARN && level > s_minLevel && mentionsFailure(line)) {
+        level = DEBUG_LOG_LEVEL_WARN;
+    }
+    if (level > s_minLevel) return;
+
+    size_t len = strnlen(line, 255);
+    const uint32_t hash = hashLine(line, len);
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < s_lineCount; i++) {
+        if (s_lines[i].hash == hash && s_lines[i].len == len) {
+            if (s_lines[i].count < UINT16_MAX) s_lines[i].count++;
+            s_stats.repeats++;
+            portEXIT_CRITICAL(&s_mux);
+            return;
+        }
+    }
+    if (s_lineCount >= LOG_UPLINK_BATCH_LINES || s_textUsed + len > sizeof(s_text)) {
+        s_stats.suppressed++;
+        s_pendingSuppressed++;
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    BatchLine& b = s_lines[s_lineCount++];
+    b.hash = hash;
+    b.firstMs = now;
+    b.offset = s_textUsed;
+    b.len = static_cast<uint8_t>(len);
+    b.count = 1;
+    memcpy(s_text + s_textUsed, line, len);
+    s_textUsed += len;
+    s_stats.lines++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void log_uplink_poll(uint32_t now) {
+    if (s_lastRefillMs != 0) {
+        s_budgetMilli += static_cast<uint64_t>(now - s_lastRefillMs) * LOG_UPLINK_BYTES_PER_HOUR / 3600;
+        if (s_budgetMilli > LOG_UPLINK_BYTES_PER_HOUR * 1000ULL) s_budgetMilli = LOG_UPLINK_BYTES_PER_HOUR * 1000ULL;
+    }
+    s_lastRefillMs = now;
+
+    // Decide and take the batch in one step; an unaffordable batch stays and fills up
+    portENTER_CRITICAL(&s_mux);
+    const uint8_t count = s_lineCount;
+    const bool due = count > 0 && (count >= LOG_UPLINK_BATCH_LINES ||
+                                   s_textUsed + LOG_BUFFER_LINE_LEN / 2u > sizeof(s_text) ||
+                                   now - s_lines[0].firstMs >= LOG_UPLINK_FLUSH_MS);
+    const size_t estimate = s_textUsed + count * kLineOverhead + kRecordOverhead;
+    if (!due || estimate * 1000ULL > s_budgetMilli) {
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    memcpy(s_outText, s_text, s_textUsed);
+    memcpy(s_outLines, s_lines, count * sizeof(BatchLine));
+    const uint32_t suppressed = s_pendingSuppressed;
+    s_pendingSuppressed = 0;
+    s_lineCount = 0;
+    s_textUsed = 0;
+    portEXIT_CRITICAL(&s_mux);
+
+    size_t n = static_cast<size_t>(snprintf(s_record, sizeof(s_record), "{\"log\":\""));
+    // Lines that no longer fit the record are reported with the suppressed count
+    const size_t limit = sizeof(s_record) - kRecordOverhead;
+    uint32_t truncated = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const BatchLine& b = s_outLines[i];
+        const size_t mark = n;
+        char affix[24];
+        int k = snprintf(affix, sizeof(affix), "%s%lu ", i ? "\\n" : "", static_cast<unsigned long>(b.firstMs / 1000));
+        bool ok = n + k < limit;
+        if (ok) {
+            memcpy(s_record + n, affix, k);
+            n += k;
+            ok = appendEscaped(s_record, limit, n, s_outText + b.offset, b.len);
+        }
+        if (ok && b.count > 1) {
+            k = snprintf(affix, sizeof(affix), " (x%u)", static_cast<unsigned>(b.count));
+            ok = n + k < limit;
+            if (ok) {
+                memcpy(s_record + n, affix, k);
+                n += k;
+            }
+        }
+        if (!ok) {
+            n = mark;
+            truncated = count - i;
+            break;
+        }
+    }
+    const uint32_t lost = suppressed + truncated;
+    if (lost) {
+        n += snprintf(s_record + n, sizeof(s_record) - n, "\",\"log_suppressed\":%lu}", static_cast<unsigned long>(lost));
+    } else {
+        n += snprintf(s_record + n, sizeof(s_record) - n, "\"}");
+    }
+
+    const bool sent = transport_sendDiagnostic(s_record, n);
+    s_budgetMilli -= std::min<uint64_t>(s_budgetMilli, n * 1000ULL);
+    portENTER_CRITICAL(&s_mux);
+    if (sent) {
+        s_stats.batches++;
+        s_stats.bytes += n;
+    } else {
+        s_stats.sendFailures++;
+    }
+    s_stats.suppressed += truncated;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+LogUplinkStats log_uplink_getStats() {
+    portENTER_CRITICAL(&s_mux);
+    const LogUplinkStats out = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+    return out;
+}
+
+#else
+
+bool log_uplink_configure(const char*) { return false; }
+bool log_uplink_enabled() { return false; }
+void log_uplink_offer(uint8_t, LogLevel, const char*) {}
+void log_uplink_poll(uint32_t) {}
+LogUplinkStats log_uplink_getStats() { return LogUplinkStats{}; }
+
+#endif // LOG_UPLINK_ENABLE
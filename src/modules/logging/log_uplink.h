@@ -0,0 +1,60 @@
+/*
+ * Remote Log Uplink
+ * Opt-in stream of selected log lines to the server, for triage without a site
+ * visit. Lines are offered by the log buffer and by tagged LOGT_* calls, batched
+ * into one telemetry record ({"log":"line\nline"}) and queued in the transport's
+ * Diagnostic class, which only sends when nothing else is due.
+ *   - filter: a minimum level for every line, or one module tag
+ *   - repeats of a line within a batch are sent once with a count
+ *   - a byte budget per hour; lines that find the batch full are counted and the
+ *     count goes out with the next batch
+ * Off until configured, from the log_uplink shared attribute:
+ *   "off" | "WARN" | "CATM" | "CATM=DEBUG"
+ * Untagged log buffer lines carry no level: they count as WARN when they mention
+ * a failure (fail, error, drop, lost, reject, timeout) and as INFO otherwise.
+ */
+
+#ifndef LOG_UPLINK_H
+#define LOG_UPLINK_H
+
+#include <Arduino.h>
+#include "../../../include/debug_system.h"
+
+#ifndef LOG_UPLINK_BYTES_PER_HOUR
+#define LOG_UPLINK_BYTES_PER_HOUR 16384UL
+#endif
+#ifndef LOG_UPLINK_BATCH_BYTES
+#define LOG_UPLINK_BATCH_BYTES 512        // line text per batch; the record stays under TRANSPORT_MAX_PACKET_BYTES
+#endif
+#ifndef LOG_UPLINK_BATCH_LINES
+#define LOG_UPLINK_BATCH_LINES 16
+#endif
+#ifndef LOG_UPLINK_FLUSH_MS
+#define LOG_UPLINK_FLUSH_MS 60000UL       // oldest line in a batch waits at most this long
+#endif
+
+#define LOG_UPLINK_UNTAGGED LOG_TAG_COUNT   // tag value for log buffer lines
+
+struct LogUplinkStats {
+    uint32_t lines;        // accepted into a batch
+    uint32_t repeats;      // folded into an earlier line of the same batch
+    uint32_t suppressed;   // batch full or over budget
+    uint32_t batches;      // queued on the transport
+    uint32_t bytes;        // record bytes queued
+    uint32_t sendFailures;
+};
+
+// Parses a filter spec (see above); false leaves the current filter unchanged
+bool log_uplink_configure(const char* spec);
+bool log_uplink_enabled();
+
+// Any task; never blocks and never logs. line is without the timestamp prefix.
+void log_uplink_offer(uint8_t tag, LogLevel level, const char* line);
+
+// Queues the batch when it is full or old enough and the budget allows. Call from
+// the task that owns the transport.
+void log_uplink_poll(uint32_t now);
+
+LogUplinkStats log_uplink_getStats();
+
+#endif // LOG_UPLINK_H
@@ -1,4 +1,5 @@
 #include "can_adapter.h"
+#include "../../system/text_buffer.h"
 
 CanAdapter::CanAdapter()
     : canModule(nullptr), lastFrameTime(0), startTime(millis()) {}
@@ -17,8 +18,7 @@ CanAdapterStatus CanAdapter::getStatus() {
         status.started = false;
         status.errorCount = 0;
         status.lastFrameTime = 0;
-        status.statusText = "No CAN module";
-        status.formattedSummary = "CAN: Module not available\nStatus: Offline";
+        status.lastFrameAgeS = UINT32_MAX;
         return status;
     }
 
@@ -27,39 +27,34 @@ CanAdapterStatus CanAdapter::getStatus() {
     status.started = canModule->isStarted();
     status.errorCount = canModule->getErrorCount();
     status.lastFrameTime = lastFrameTime;
+    status.lastFrameAgeS = getLastFrameAge();
+    return status;
+}
 
-    // Determine status text
-    if (!status.initialized) {
-        status.statusText = "Not initialized";
-    } else if (!status.started) {
-        status.statusText = "Initialized but not started";
-    } else if (getLastFrameAge() > 30) { // No frames for 30+ seconds
-        status.statusText = "Started but inactive";
-    } else {
-        status.statusText = "Active";
-    }
-
-    // Format summary
-    status.formattedSummary = "CAN Bus Status\n";
-    status.formattedSummary += "State: " + status.statusText + "\n";
-    status.formattedSummary += "Errors: " + String(status.errorCount) + "\n";
+const char* CanAdapterStatus::statusText() const {
+    if (!available) return "No CAN module";
+    if (!initialized) return "Not initialized";
+    if (!started) return "Initialized but not started";
+    if (lastFrameAgeS > 30) return "Started but inactive";   // No frames for 30+ seconds
+    return "Active";
+}
 
-    if (status.lastFrameTime > 0) {
-        uint32_t age = getLastFrameAge();
-        status.formattedSummary += "Last Frame: ";
-        if (age < 60) {
-            status.formattedSummary += String(age) + "s ago";
-        } else {
-            status.formattedSummary += String(age / 60) + "m ago";
-        }
+size_t CanAdapterStatus::formatSummary(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    if (!available) {
+        t.print("CAN: Module not available\nStatus: Offline");
+        return t.length();
+    }
+    t.printf("CAN Bus Status\nState: %s\nErrors: %lu\n", statusText(), (unsigned long)errorCount);
+    if (lastFrameTime == 0) {
+        t.print("Last Frame: Never");
+    } else if (lastFrameAgeS < 60) {
+        t.printf("Last Frame: %lus ago", (unsigned long)lastFrameAgeS);
     } else {
-        status.formattedSummary += "Last Frame: Never";
+        t.printf("Last Frame: %lum ago", (unsigned long)(lastFrameAgeS / 60));
     }
-
-    status.formattedSummary += "\nUptime: " + String(status.uptimeSeconds / 60) + "m " +
-                               String(status.uptimeSeconds % 60) + "s";
-
-    return status;
+    t.printf("\nUptime: %lum %lus", (unsigned long)(uptimeSeconds / 60), (unsigned long)(uptimeSeconds % 60));
+    return t.length();
 }
 
 void CanAdapter::recordFrameReceived() {
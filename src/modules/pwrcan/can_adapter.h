@@ -12,9 +12,12 @@ struct CanAdapterStatus {
     bool started;
     uint32_t errorCount;
     uint32_t lastFrameTime;
+    uint32_t lastFrameAgeS;      // UINT32_MAX before the first frame
     uint32_t uptimeSeconds;
-    String statusText;
-    String formattedSummary;
+
+    // Formatted on demand, into the caller's buffer for the summary
+    const char* statusText() const;
+    size_t formatSummary(char* out, size_t size) const;
 
     // Helper to create from PWRCANModule
     static CanAdapterStatus fromCanModule(PWRCANModule* canModule);
@@ -0,0 +1,87 @@
+#include "can_bus_load.h"
+
+namespace {
+// CRC delimiter, ACK slot and delimiter, end of frame, intermission
+constexpr uint16_t kUnstuffedTail = 1 + 2 + 7 + 3;
+
+// Walks the stuffed part of the frame (SOF to the end of the CRC) bit by bit,
+// computing the CRC-15 on the way
+struct StuffCounter {
+    uint16_t bits = 0;
+    uint16_t crc = 0;
+    uint8_t run = 0;
+    uint8_t last = 2;
+
+    void stuff(uint8_t b) {
+        bits++;
+        if (b == last) {
+            if (++run == 5) {
+                bits++;               // complement inserted, starts the next run
+                last = !b;
+                run = 1;
+            }
+        } else {
+            last = b;
+            run = 1;
+        }
+    }
+    void put(uint8_t b) {
+        const uint8_t next = b ^ ((crc >> 14) & 1);
+        crc = (uint16_t)((crc << 1) & 0x7FFF);
+        if (next) crc ^= 0x4599;
+        stuff(b);
+    }
+    void putBits(uint32_t v, uint8_t n) {
+        while (n--) put((v >> n) & 1);
+    }
+};
+} // namespace
+
+uint16_t can_frame_bits(uint32_t id, bool extended, bool remote, const uint8_t* data, uint8_t length) {
+    if (length > 8) length = 8;
+    StuffCounter s;
+    s.put(0);                                // SOF
+    if (extended) {
+        s.putBits(id >> 18, 11);
+        s.put(1);                            // SRR
+        s.put(1);                            // IDE
+        s.putBits(id & 0x3FFFF, 18);
+        s.put(remote);
+        s.put(0);                            // r1
+        s.put(0);                            // r0
+    } else {
+        s.putBits(id & 0x7FF, 11);
+        s.put(remote);
+        s.put(0);                            // IDE
+        s.put(0);                            // r0
+    }
+    s.putBits(length, 4);
+    if (!remote) {
+        for (uint8_t i = 0; i < length; i++) s.putBits(data[i], 8);
+    }
+    const uint16_t crc = s.crc;
+    for (int8_t i = 14; i >= 0; i--) s.stuff((crc >> i) & 1);
+    return s.bits + kUnstuffedTail;
+}
+
+CanBusLoad::CanBusLoad() : bits_(0), bitrateKbps_(0), windowStartMs_(0), permille_(0), peak_(0) {}
+
+void CanBusLoad::begin(uint32_t bitrateKbps, uint32_t nowMs) {
+    bitrateKbps_ = bitrateKbps;
+    windowStartMs_ = nowMs;
+    bits_.store(0, std::memory_order_relaxed);
+    permille_ = 0;
+    peak_ = 0;
+}
+
+bool CanBusLoad::sample(uint32_t nowMs) {
+    const uint32_t elapsed = nowMs - windowStartMs_;
+    if (bitrateKbps_ == 0 || elapsed < CAN_BUS_LOAD_WINDOW_MS) return false;
+    const uint32_t bits = bits_.exchange(0, std::memory_order_relaxed);
+    windowStartMs_ = nowMs;
+    // kbit/s * ms = bits on the wire in the window at 100 %
+    uint64_t load = (uint64_t)bits * 1000 / ((uint64_t)bitrateKbps_ * elapsed);
+    permille_ = load > 1000 ? 1000 : (uint16_t)load;
+    if (permille_ > peak_) peak_ = permille_;
+    return true;
+}
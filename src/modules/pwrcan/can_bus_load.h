@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <atomic>
+
+// Bus load from the frames actually seen: every received and transmitted
+// frame adds its exact on-wire length (arbitration, control, data and CRC
+// fields with their stuff bits, delimiters, ACK, EOF and interframe space),
+// and each window reports those bits against the bit rate. Error frames and
+// other nodes' frames this controller filtered in hardware are not counted.
+
+#ifndef CAN_BUS_LOAD_WINDOW_MS
+#define CAN_BUS_LOAD_WINDOW_MS 1000
+#endif
+
+// On-wire bits of one frame, stuff bits included
+uint16_t can_frame_bits(uint32_t id, bool extended, bool remote, const uint8_t* data, uint8_t length);
+
+class CanBusLoad {
+public:
+    CanBusLoad();
+
+    void begin(uint32_t bitrateKbps, uint32_t nowMs);
+    // Any task
+    void add(uint16_t bits) { bits_.fetch_add(bits, std::memory_order_relaxed); }
+    // Closes the window once CAN_BUS_LOAD_WINDOW_MS have passed; true with a new value
+    bool sample(uint32_t nowMs);
+
+    uint16_t permille() const { return permille_; }
+    uint16_t peakPermille() const { return peak_; }
+    uint32_t percent() const { return (permille_ + 5) / 10; }
+
+private:
+    std::atomic<uint32_t> bits_;
+    uint32_t bitrateKbps_;
+    uint32_t windowStartMs_;
+    uint16_t permille_;
+    uint16_t peak_;
+};
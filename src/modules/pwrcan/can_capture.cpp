@@ -0,0 +1,369 @@
+#include "can_capture.h"
+
+#if CAN_CAPTURE_ENABLE
+
+#include "../storage/storage_task.h"
+#include "../logging/log_buffer.h"
+#include "../../system/mutex_profiler.h"
+#include <SD.h>
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+namespace {
+
+enum : uint8_t {
+    kIdle = 0,
+    kStarting,   // can_capture_start() is allocating
+    kRunning,
+    kStopping,   // stop asked, the CAN task has not sealed its block yet
+    kDraining,   // no more records; close once the sealed blocks are written
+};
+
+constexpr size_t kRecordBytes = 9;                  // time, id, info
+constexpr size_t kMaxRecord = kRecordBytes + 8;
+constexpr size_t kTimeRecord = kRecordBytes + 4;
+constexpr uint32_t kEpochValid = 1577836800UL;      // 2020-01-01; older means unset
+
+struct Block {
+    uint16_t used;             // CAN task while current, storage task once sealed
+    uint32_t openedMs;
+    uint8_t data[CAN_CAPTURE_BLOCK_BYTES];
+};
+
+struct __attribute__((packed)) FileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerBytes;
+    uint16_t bitrateKbps;
+    uint16_t reserved;
+    uint32_t filterId;
+    uint32_t filterMask;
+    uint64_t timerUs;
+    uint64_t wallUs;
+};
+
+std::atomic<uint8_t> s_state{kIdle};
+Block* s_blocks = nullptr;
+CanCaptureFilter s_filter = {0, 0};
+// Blocks handed over / written since start; the current block is s_sealed % N
+std::atomic<uint32_t> s_sealed{0};
+std::atomic<uint32_t> s_written{0};
+bool s_lostPending = false;    // CAN task
+uint32_t s_stopAtMs = 0;
+CanCaptureStats s_stats = {};
+// A filter change restarts the capture once the current one is closed
+CanCaptureFilter s_nextFilter = {0, 0};
+std::atomic<bool> s_restart{false};
+
+// Storage task
+File s_file;
+bool s_fileOpen = false;
+bool s_dirScanned = false;
+uint32_t s_fileBytes = 0;
+uint32_t s_loSeq = 1;
+uint32_t s_seq = 1;
+uint32_t s_retryAtMs = 0;
+
+void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// The block the CAN task fills, or null while the card has all of them
+Block* current() {
+    const uint32_t sealed = s_sealed.load(std::memory_order_relaxed);
+    if (sealed - s_written.load(std::memory_order_acquire) >= CAN_CAPTURE_BLOCKS) return nullptr;
+    return &s_blocks[sealed % CAN_CAPTURE_BLOCKS];
+}
+
+void seal() {
+    const uint32_t sealed = s_sealed.load(std::memory_order_relaxed) + 1;
+    s_sealed.store(sealed, std::memory_order_release);
+    const uint32_t pending = sealed - s_written.load(std::memory_order_relaxed);
+    if (pending > s_stats.maxPending) s_stats.maxPending = (uint8_t)pending;
+}
+
+void capturePath(uint32_t seq, char* out, size_t cap) {
+    snprintf(out, cap, CAN_CAPTURE_DIR "/%08lu.can", (unsigned long)seq);
+}
+
+// Finds the sequence range already on the card, once per capture
+bool scanDir() {
+    if (s_dirScanned) return true;
+    if (SD.cardType() == CARD_NONE || (!SD.exists(CAN_CAPTURE_DIR) && !SD.mkdir(CAN_CAPTURE_DIR))) {
+        return false;
+    }
+    bool any = false;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    File dir = SD.open(CAN_CAPTURE_DIR);
+    if (dir) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            const char* name = entry.name();
+            const char* base = strrchr(name, '/');
+            base = base ? base + 1 : name;
+            char* end = nullptr;
+            const unsigned long seq = strtoul(base, &end, 10);
+            if (end && end != base && strcmp(end, ".can") == 0) {
+                if (!any || seq < lo) lo = seq;
+                if (!any || seq > hi) hi = seq;
+                any = true;
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+    s_loSeq = any ? lo : 1;
+    s_seq = any ? hi + 1 : 1;
+    s_dirScanned = true;
+    return true;
+}
+
+void closeFile() {
+    if (!s_fileOpen) return;
+    s_file.close();
+    s_fileOpen = false;
+}
+
+// Caller holds g_sdMutex
+bool openFile(uint32_t nowMs) {
+    if (s_fileOpen) return true;
+    if (s_retryAtMs != 0 && (int32_t)(nowMs - s_retryAtMs) < 0) return false;
+    char path[40];
+    if (scanDir()) {
+        while (s_seq - s_loSeq >= CAN_CAPTURE_FILES) {
+            capturePath(s_loSeq++, path, sizeof(path));
+            SD.remove(path);
+        }
+        capturePath(s_seq, path, sizeof(path));
+        s_file = SD.open(path, "w");
+    }
+    if (!s_file) {
+        s_stats.writeErrors++;
+        s_retryAtMs = (nowMs + STORAGE_REOPEN_RETRY_MS) | 1;
+        return false;
+    }
+    FileHeader h = {};
+    h.magic = CAN_CAPTURE_MAGIC;
+    h.version = CAN_CAPTURE_VERSION;
+    h.headerBytes = sizeof(h);
+    h.bitrateKbps = PWRCAN_BITRATE_KBPS;
+    h.filterId = s_filter.id;
+    h.filterMask = s_filter.mask;
+    h.timerUs = (uint64_t)esp_timer_get_time();
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);
+    if ((uint32_t)tv.tv_sec >= kEpochValid) h.wallUs = (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+    if (s_file.write(reinterpret_cast<const uint8_t*>(&h), sizeof(h)) != sizeof(h)) {
+        s_file.close();
+        s_stats.writeErrors++;
+        s_retryAtMs = (nowMs + STORAGE_REOPEN_RETRY_MS) | 1;
+        return false;
+    }
+    s_fileOpen = true;
+    s_fileBytes = sizeof(h);
+    s_seq++;
+    s_stats.files++;
+    s_retryAtMs = 0;
+    return true;
+}
+
+// Caller holds g_sdMutex; false leaves the block for the next pass
+bool writeBlock(Block& b, uint32_t nowMs) {
+    if (s_fileOpen && CAN_CAPTURE_ROTATE_BYTES && s_fileBytes + b.used > CAN_CAPTURE_ROTATE_BYTES) {
+        closeFile();
+    }
+    if (!openFile(nowMs)) return false;
+    const uint32_t t0 = micros();
+    if (s_file.write(b.data, b.used) != b.used) {
+        // Card pulled or full: reopen later into a new file
+        closeFile();
+        s_stats.writeErrors++;
+        s_retryAtMs = (nowMs + STORAGE_REOPEN_RETRY_MS) | 1;
+        return false;
+    }
+    const uint32_t us = micros() - t0;
+    if (us > s_stats.maxWriteUs) s_stats.maxWriteUs = us;
+    s_fileBytes += b.used;
+    s_stats.bytes += b.used;
+    return true;
+}
+
+// Caller holds g_sdMutex
+void finish() {
+    closeFile();
+    heap_caps_free(s_blocks);
+    s_blocks = nullptr;
+    s_stats.running = false;
+    logbuf_printf("can capture: stopped, %lu frames, %lu dropped, %lu KB in %lu files",
+                  (unsigned long)s_stats.frames, (unsigned long)s_stats.dropped,
+                  (unsigned long)(s_stats.bytes >> 10), (unsigned long)s_stats.files);
+    s_state.store(kIdle, std::memory_order_release);
+}
+
+} // namespace
+
+bool can_capture_start(const CanCaptureFilter& filter) {
+    uint8_t idle = kIdle;
+    if (!s_state.compare_exchange_strong(idle, kStarting)) return false;
+    s_blocks = static_cast<Block*>(
+        heap_caps_malloc(sizeof(Block) * CAN_CAPTURE_BLOCKS, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT));
+    if (!s_blocks) {
+        s_state.store(kIdle, std::memory_order_release);
+        logbuf_printf("can capture: no memory for %u blocks", (unsigned)CAN_CAPTURE_BLOCKS);
+        return false;
+    }
+    for (uint8_t i = 0; i < CAN_CAPTURE_BLOCKS; i++) s_blocks[i].used = 0;
+    s_filter = filter;
+    s_sealed.store(0, std::memory_order_relaxed);
+    s_written.store(0, std::memory_order_relaxed);
+    s_lostPending = false;
+    s_dirScanned = false;
+    s_retryAtMs = 0;
+    s_stats = CanCaptureStats{};
+    s_stats.running = true;
+    logbuf_printf("can capture: started, filter %08lx/%08lx", (unsigned long)filter.id, (unsigned long)filter.mask);
+    s_state.store(kRunning, std::memory_order_release);
+    return true;
+}
+
+void can_capture_stop() {
+    uint8_t running = kRunning;
+    s_stopAtMs = millis();
+    s_state.compare_exchange_strong(running, kStopping);
+}
+
+bool can_capture_configure(const char* spec) {
+    if (!spec || !spec[0] || strcmp(spec, "off") == 0) {
+        can_capture_stop();
+        return true;
+    }
+    CanCaptureFilter filter = {0, 0};
+    if (strcmp(spec, "all") != 0) {
+        char* end = nullptr;
+        filter.id = strtoul(spec, &end, 16);
+        if (end == spec || *end != '/') return false;
+        const char* maskText = end + 1;
+        filter.mask = strtoul(maskText, &end, 16);
+        if (end == maskText || *end != '\0') return false;
+    }
+    if (can_capture_running()) {
+        // Restarted with the new filter once the running capture is closed
+        s_nextFilter = filter;
+        s_restart.store(true);
+        can_capture_stop();
+        return true;
+    }
+    return can_capture_start(filter);
+}
+
+void can_capture_frame(uint32_t id, bool extended, bool remote, const uint8_t* data, uint8_t length,
+                       int64_t timeUs) {
+    if (s_state.load(std::memory_order_acquire) != kRunning) return;
+    if ((id ^ s_filter.id) & s_filter.mask) {
+        s_stats.filtered++;
+        return;
+    }
+    Block* b = current();
+    if (!b) {
+        s_stats.dropped++;
+        s_lostPending = true;
+        return;
+    }
+    if (length > 8) length = 8;
+    uint8_t* p;
+    if (b->used == 0) {
+        b->openedMs = millis();
+        p = b->data;
+        put32(p, (uint32_t)timeUs);
+        put32(p + 4, 0);
+        p[8] = CAN_CAPTURE_INFO_TIME | 4;
+        put32(p + 9, (uint32_t)((uint64_t)timeUs >> 32));
+        b->used = kTimeRecord;
+    }
+    p = b->data + b->used;
+    put32(p, (uint32_t)timeUs);
+    put32(p + 4, (id & 0x1FFFFFFFu) | (extended ? 0x80000000u : 0) | (remote ? 0x40000000u : 0));
+    p[8] = length | (s_lostPending ? CAN_CAPTURE_INFO_LOST : 0);
+    memcpy(p + kRecordBytes, data, length);
+    b->used += kRecordBytes + length;
+    s_lostPending = false;
+    s_stats.frames++;
+    if (b->used + kMaxRecord > CAN_CAPTURE_BLOCK_BYTES) seal();
+}
+
+void can_capture_lost(uint32_t frames) {
+    if (frames == 0 || s_state.load(std::memory_order_acquire) != kRunning) return;
+    s_stats.driverLost += frames;
+    s_lostPending = true;
+}
+
+void can_capture_poll(uint32_t nowMs) {
+    const uint8_t state = s_state.load(std::memory_order_acquire);
+    if (state != kRunning && state != kStopping) return;
+    Block* b = current();
+    if (b && b->used && (state == kStopping || nowMs - b->openedMs >= CAN_CAPTURE_SEAL_MS)) seal();
+    if (state == kStopping) s_state.store(kDraining, std::memory_order_release);
+}
+
+uint32_t can_capture_drain(uint32_t nowMs) {
+    uint8_t state = s_state.load(std::memory_order_acquire);
+    if (state == kIdle || state == kStarting) return UINT32_MAX;
+    if (state == kStopping && nowMs - s_stopAtMs >= CAN_CAPTURE_STOP_MS) {
+        // The CAN task is not running to seal its block; nothing writes it either
+        Block* b = current();
+        if (b && b->used) seal();
+        s_state.store(kDraining, std::memory_order_release);
+        state = kDraining;
+    }
+    uint32_t written = s_written.load(std::memory_order_relaxed);
+    const uint32_t sealed = s_sealed.load(std::memory_order_acquire);
+    const bool closing = state == kDraining;
+    if ((written == sealed && !closing) || !mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) {
+        return CAN_CAPTURE_DRAIN_MS;
+    }
+    const uint32_t before = written;
+    while (written != sealed) {
+        Block& b = s_blocks[written % CAN_CAPTURE_BLOCKS];
+        if (!writeBlock(b, nowMs)) break;
+        b.used = 0;
+        s_written.store(++written, std::memory_order_release);
+    }
+    if (written != before && s_fileOpen) s_file.flush();
+    // Blocks the card would not take are given up with the capture
+    const bool done = closing && (written == sealed || !s_fileOpen);
+    if (done) finish();
+    mutex_give(g_sdMutex);
+    if (done && s_restart.exchange(false)) {
+        can_capture_start(s_nextFilter);
+    }
+    return s_state.load(std::memory_order_acquire) == kIdle ? UINT32_MAX : CAN_CAPTURE_DRAIN_MS;
+}
+
+bool can_capture_running() {
+    return s_state.load(std::memory_order_acquire) != kIdle;
+}
+
+void can_capture_stats(CanCaptureStats& out) {
+    out = s_stats;
+}
+
+void can_capture_report(Print& out) {
+    if (!s_stats.running && s_stats.files == 0) return;
+    out.printf("CAN capture: %s, %lu frames (%lu filtered), %lu dropped, %lu lost in driver, %lu KB, %lu files, "
+               "%lu write errors, max write %lu us, max %u blocks pending\n",
+               s_stats.running ? "running" : "stopped", (unsigned long)s_stats.frames,
+               (unsigned long)s_stats.filtered, (unsigned long)s_stats.dropped, (unsigned long)s_stats.driverLost,
+               (unsigned long)(s_stats.bytes >> 10), (unsigned long)s_stats.files,
+               (unsigned long)s_stats.writeErrors, (unsigned long)s_stats.maxWriteUs, (unsigned)s_stats.maxPending);
+}
+
+#endif // CAN_CAPTURE_ENABLE
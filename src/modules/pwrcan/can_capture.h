@@ -0,0 +1,123 @@
+/*
+ * CAN Capture
+ * Records received frames to the SD card for offline analysis and replay.
+ *   - the CAN task appends each frame that passes the capture filter to a RAM
+ *     block (no lock, no copy beyond the record itself); full blocks, and
+ *     partial ones older than CAN_CAPTURE_SEAL_MS, are handed over whole
+ *   - the storage task writes handed-over blocks under g_sdMutex every
+ *     CAN_CAPTURE_DRAIN_MS while a capture runs, so the card sees 2 KB writes
+ *     and one flush per pass; the block ring rides out SD stalls of about
+ *     300 ms at full 500 kbit/s load
+ *   - frames that find the ring full, and frames the driver lost, are counted
+ *     and flagged on the next record, so a gap in the file is never silent
+ *   - files rotate at CAN_CAPTURE_ROTATE_BYTES; the oldest beyond
+ *     CAN_CAPTURE_FILES are removed
+ * Block memory is allocated by can_capture_start() and freed after stop.
+ * Remote control: the can_capture shared attribute, "all", "off", or an
+ * "<id>/<mask>" hex filter. tools/cancap2log.py converts files to candump
+ * log or Vector ASC.
+ *
+ * File CAN_CAPTURE_DIR/<seq>.can (little endian):
+ *   header  "GCAN", u16 version, u16 header bytes, u16 bitrate kbit/s,
+ *           u16 reserved, u32 filter id, u32 filter mask,
+ *           u64 esp_timer us and u64 wall-clock us (0 = unset) at file open
+ *   records u32 time us (low word of esp_timer), u32 id (bit 31 extended,
+ *           bit 30 remote), u8 info, info & 0x0F data bytes.
+ *           info bit 7: frames were lost before this record;
+ *           info bit 6: time record, data is the u32 high word of esp_timer.
+ *           Every block starts with a time record.
+ * TWAI frames carry no receive timestamp: time is taken when the CAN task
+ * takes the frame from the driver queue, within its wake-up latency of arrival.
+ */
+
+#ifndef CAN_CAPTURE_H
+#define CAN_CAPTURE_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+
+#ifndef CAN_CAPTURE_DIR
+#define CAN_CAPTURE_DIR "/can"
+#endif
+#ifndef CAN_CAPTURE_BLOCK_BYTES
+#define CAN_CAPTURE_BLOCK_BYTES 2048       // one SD write
+#endif
+#ifndef CAN_CAPTURE_BLOCKS
+#define CAN_CAPTURE_BLOCKS 12              // 24 KB of RAM while capturing
+#endif
+#ifndef CAN_CAPTURE_ROTATE_BYTES
+#define CAN_CAPTURE_ROTATE_BYTES (16UL * 1024UL * 1024UL)   // 0 = one file per capture
+#endif
+#ifndef CAN_CAPTURE_FILES
+#define CAN_CAPTURE_FILES 16               // capture files kept on the card
+#endif
+#define CAN_CAPTURE_SEAL_MS 500            // partial block handed over after this long
+#define CAN_CAPTURE_DRAIN_MS 20            // storage task pass while capturing
+#define CAN_CAPTURE_STOP_MS 3000           // stop completes without the CAN task after this
+
+#define CAN_CAPTURE_MAGIC 0x4E414347u      // "GCAN"
+#define CAN_CAPTURE_VERSION 1
+#define CAN_CAPTURE_INFO_LOST 0x80
+#define CAN_CAPTURE_INFO_TIME 0x40
+
+struct CanCaptureFilter {
+    uint32_t id;
+    uint32_t mask;             // frames with (frame id & mask) == (id & mask); 0 = all
+};
+
+struct CanCaptureStats {
+    bool running;
+    uint32_t frames;           // recorded
+    uint32_t filtered;         // received but outside the filter
+    uint32_t dropped;          // block ring full
+    uint32_t driverLost;       // lost in the TWAI driver, as reported to us
+    uint32_t bytes;            // written to the card
+    uint32_t files;            // opened by this capture
+    uint32_t writeErrors;
+    uint32_t maxWriteUs;       // longest single block write
+    uint8_t maxPending;        // most blocks waiting for the card at once
+};
+
+#if CAN_CAPTURE_ENABLE
+
+// Allocates the block ring and starts recording; false if already running or
+// out of memory. Any task.
+bool can_capture_start(const CanCaptureFilter& filter);
+// Seals the last block; the file is closed once it is on the card. Any task.
+void can_capture_stop();
+// Parses "all", "off" (or empty) or "<id>/<mask>" in hex and starts or stops
+bool can_capture_configure(const char* spec);
+
+// CAN task: one received frame, with the time it was taken from the driver
+void can_capture_frame(uint32_t id, bool extended, bool remote, const uint8_t* data, uint8_t length,
+                       int64_t timeUs);
+// CAN task: frames the driver dropped since the last call
+void can_capture_lost(uint32_t frames);
+// CAN task: hands over a partial block when due and acknowledges a stop; call
+// at least every second
+void can_capture_poll(uint32_t nowMs);
+
+// Storage task: writes handed-over blocks, rotates and closes files. Returns the
+// longest the task may wait before the next call (UINT32_MAX when idle).
+uint32_t can_capture_drain(uint32_t nowMs);
+
+bool can_capture_running();
+void can_capture_stats(CanCaptureStats& out);
+void can_capture_report(Print& out);
+
+#else
+
+inline bool can_capture_start(const CanCaptureFilter&) { return false; }
+inline void can_capture_stop() {}
+inline bool can_capture_configure(const char*) { return false; }
+inline void can_capture_frame(uint32_t, bool, bool, const uint8_t*, uint8_t, int64_t) {}
+inline void can_capture_lost(uint32_t) {}
+inline void can_capture_poll(uint32_t) {}
+inline uint32_t can_capture_drain(uint32_t) { return UINT32_MAX; }
+inline bool can_capture_running() { return false; }
+inline void can_capture_stats(CanCaptureStats& out) { out = CanCaptureStats{}; }
+inline void can_capture_report(Print&) {}
+
+#endif // CAN_CAPTURE_ENABLE
+
+#endif // CAN_CAPTURE_H
@@ -0,0 +1,110 @@
+#include "can_dispatch.h"
+#include "../../system/hot_path_timer.h"
+#include <string.h>
+
+namespace {
+constexpr uint32_t kSlots = 1u << CAN_DISPATCH_SLOT_BITS;
+}
+
+CanDispatcher::CanDispatcher() : count_(0), groupCount_(0), unmatched_(0), short_(0) {
+    memset(routes_, 0, sizeof(routes_));
+    memset(hits_, 0, sizeof(hits_));
+    memset(slots_, 0, sizeof(slots_));
+    memset(groups_, 0, sizeof(groups_));
+}
+
+uint32_t CanDispatcher::slotOf(uint32_t key, uint32_t mask, bool extended) {
+    // Fibonacci hashing of the masked ID, salted per mask group
+    const uint32_t h = (key ^ (mask * 0x9E3779B9u) ^ (extended ? 0x80000000u : 0)) * 2654435761u;
+    return h >> (32 - CAN_DISPATCH_SLOT_BITS);
+}
+
+int CanDispatcher::find(uint32_t key, uint32_t mask, bool extended) const {
+    for (uint32_t probe = 0, s = slotOf(key, mask, extended); probe < kSlots; probe++, s = (s + 1) & (kSlots - 1)) {
+        const uint8_t v = slots_[s];
+        if (!v) return -1;
+        const Route& r = routes_[v - 1];
+        if (r.mask == mask && r.extended == extended && (r.id & mask) == key) return v - 1;
+    }
+    return -1;
+}
+
+bool CanDispatcher::add(const Route& route) {
+    const uint32_t limit = route.extended ? CAN_ID_EXT_EXACT : CAN_ID_STD_EXACT;
+    const uint32_t mask = route.mask & limit;
+    if (!route.handler || !mask || count_ >= CAN_DISPATCH_MAX_ROUTES || (uint32_t)(count_ + 1) * 5 > kSlots * 2) return false;
+    if (find(route.id & mask, mask, route.extended) >= 0) return false;
+
+    int g = -1;
+    for (uint8_t i = 0; i < groupCount_; i++) {
+        if (groups_[i].mask == mask && groups_[i].extended == route.extended) g = i;
+    }
+    if (g < 0) {
+        if (groupCount_ >= CAN_DISPATCH_MAX_MASKS) return false;
+        // Keep the more specific masks first so an exact route wins
+        uint8_t at = groupCount_;
+        while (at > 0 && __builtin_popcount(groups_[at - 1].mask) < __builtin_popcount(mask)) {
+            groups_[at] = groups_[at - 1];
+            at--;
+        }
+        groups_[at] = MaskGroup{mask, route.extended};
+        groupCount_++;
+    }
+
+    Route& r = routes_[count_];
+    r = route;
+    r.mask = mask;
+    r.id &= mask;
+    uint32_t s = slotOf(r.id, mask, r.extended);
+    while (slots_[s]) s = (s + 1) & (kSlots - 1);
+    slots_[s] = (uint8_t)(count_ + 1);
+    count_++;
+    return true;
+}
+
+bool CanDispatcher::dispatch(uint32_t id, bool extended, const uint8_t* data, uint16_t length) {
+    HOT_PATH_TIMER("can.dispatch");
+    for (uint8_t g = 0; g < groupCount_; g++) {
+        const MaskGroup& group = groups_[g];
+        if (group.extended != extended) continue;
+        const int i = find(id & group.mask, group.mask, extended);
+        if (i < 0) continue;
+        const Route& r = routes_[i];
+        if (length < r.minLength) {
+            short_++;
+            return false;
+        }
+        hits_[i]++;
+        return r.handler(r.ctx, id, data, length);
+    }
+    unmatched_++;
+    return false;
+}
+
+size_t CanDispatcher::standardIds(uint16_t* out, size_t cap, bool& complete) const {
+    size_t n = 0;
+    complete = true;
+    for (uint8_t i = 0; i < count_; i++) {
+        const Route& r = routes_[i];
+        if (r.extended || r.mask != CAN_ID_STD_EXACT) {
+            complete = false;
+            continue;
+        }
+        if (n < cap) {
+            out[n++] = (uint16_t)r.id;
+        } else {
+            complete = false;
+        }
+    }
+    return n;
+}
+
+void CanDispatcher::report(Print& out) const {
+    out.printf("CAN dispatch: %u routes in %u mask groups, %lu unmatched, %lu short\n", (unsigned)count_,
+               (unsigned)groupCount_, (unsigned long)unmatched_, (unsigned long)short_);
+    for (uint8_t i = 0; i < count_; i++) {
+        const Route& r = routes_[i];
+        out.printf("  %-14s %s 0x%08lx/0x%08lx %lu hits\n", r.name ? r.name : "?", r.extended ? "ext" : "std",
+                   (unsigned long)r.id, (unsigned long)r.mask, (unsigned long)hits_[i]);
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// CAN receive dispatch: protocol handlers register routes (ID, mask) with a
+// decoder, and every received frame costs one hash probe per distinct mask
+// instead of a walk through each protocol's switch. Several protocols share
+// one dispatcher, e.g. the generator's standard IDs next to J1939 PGNs on
+// extended IDs (an exact route wins over a masked one). Routes are added
+// before the receive task starts; each counts its hits.
+
+#ifndef CAN_DISPATCH_MAX_ROUTES
+#define CAN_DISPATCH_MAX_ROUTES 24
+#endif
+#define CAN_DISPATCH_MAX_MASKS 4           // distinct (mask, frame format) pairs
+#define CAN_DISPATCH_SLOT_BITS 6           // 64 hash slots, kept at most ~40% full
+
+#define CAN_ID_STD_EXACT 0x7FFu
+#define CAN_ID_EXT_EXACT 0x1FFFFFFFu
+// J1939 on 29 bit IDs (priority, DP, PF, PS, source address): a PDU2 PGN
+// (PF >= 240) is bits 8-25; a PDU1 PGN has the destination in PS, so only
+// DP and PF (bits 16-25) identify it. The route ID is the PGN shifted left 8.
+#define CAN_J1939_PDU2_MASK 0x03FFFF00u
+#define CAN_J1939_PDU1_MASK 0x03FF0000u
+
+class CanDispatcher {
+public:
+    // Returns false when the frame did not decode
+    // length is up to 8 for a frame, more for a reassembled J1939 message
+    typedef bool (*Handler)(void* ctx, uint32_t id, const uint8_t* data, uint16_t length);
+
+    struct Route {
+        const char* name;
+        uint32_t id;
+        uint32_t mask;           // ID bits that must match
+        bool extended;
+        uint8_t minLength;       // shorter frames are counted, not decoded
+        Handler handler;
+        void* ctx;
+    };
+
+    CanDispatcher();
+
+    // False when the tables are full or (id & mask) is already routed
+    bool add(const Route& route);
+
+    // The frame's handler result; false when no route takes it
+    bool dispatch(uint32_t id, bool extended, const uint8_t* data, uint16_t length);
+
+    size_t routeCount() const { return count_; }
+    const Route& route(size_t i) const { return routes_[i]; }
+    uint32_t hits(size_t i) const { return hits_[i]; }
+    uint32_t unmatched() const { return unmatched_; }
+    uint32_t shortFrames() const { return short_; }
+
+    // The exact standard IDs routed; complete is false when other routes
+    // (masked or extended) exist, which such a list cannot describe
+    size_t standardIds(uint16_t* out, size_t cap, bool& complete) const;
+
+    void report(Print& out) const;
+
+private:
+    struct MaskGroup {
+        uint32_t mask;
+        bool extended;
+    };
+
+    static uint32_t slotOf(uint32_t key, uint32_t mask, bool extended);
+    int find(uint32_t key, uint32_t mask, bool extended) const;
+
+    Route routes_[CAN_DISPATCH_MAX_ROUTES];
+    uint32_t hits_[CAN_DISPATCH_MAX_ROUTES];
+    uint8_t slots_[1u << CAN_DISPATCH_SLOT_BITS];   // route index + 1, 0 = empty
+    MaskGroup groups_[CAN_DISPATCH_MAX_MASKS];      // most specific mask first
+    uint8_t count_;
+    uint8_t groupCount_;
+    uint32_t unmatched_;
+    uint32_t short_;
+};
@@ -0,0 +1,57 @@
+#include "can_filter.h"
+
+namespace {
+constexpr uint16_t kIdMask = 0x7FF;
+
+// Smallest code/mask that matches every ID in the set (bit per ids[] index)
+struct Cover {
+    uint16_t code;
+    uint16_t dontCare;
+    uint16_t pass;
+};
+
+Cover cover(const uint16_t* ids, size_t n, uint32_t set) {
+    uint16_t all = kIdMask;
+    uint16_t any = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!(set & (1u << i))) continue;
+        all &= ids[i];
+        any |= ids[i];
+    }
+    const uint16_t dontCare = (uint16_t)((all ^ any) & kIdMask);
+    return Cover{(uint16_t)(all & ~dontCare), dontCare, (uint16_t)(1u << __builtin_popcount(dontCare))};
+}
+
+CanAcceptance acceptAll() {
+    return CanAcceptance{true, false, 0, 0xFFFFFFFFu, 2048};
+}
+} // namespace
+
+CanAcceptance can_acceptance_for(const uint16_t* ids, size_t n) {
+    if (!ids || !n || n > CAN_FILTER_MAX_IDS) return acceptAll();
+    for (size_t i = 0; i < n; i++) {
+        if (ids[i] > kIdMask) return acceptAll();
+    }
+    const uint32_t full = (1u << n) - 1;
+
+    // Single filter: ID in bits 31-21; RTR and the data bytes are don't care
+    const Cover one = cover(ids, n, full);
+    CanAcceptance best{false, false, (uint32_t)one.code << 21, ((uint32_t)one.dontCare << 21) | 0x1FFFFFu, one.pass};
+
+    // Dual filter: ID 1 in bits 31-21, ID 2 in bits 15-5. Every split of the
+    // IDs in two, ids[0] always in the first half.
+    for (uint32_t first = 1; first < full && best.passIds > n; first += 2) {
+        const Cover a = cover(ids, n, first);
+        const Cover b = cover(ids, n, full & ~first);
+        // A shared ID would pass once but count twice; the sum is an upper bound
+        const uint32_t pass = (uint32_t)a.pass + b.pass;
+        if (pass < best.passIds) {
+            best.dual = true;
+            best.code = ((uint32_t)a.code << 21) | ((uint32_t)b.code << 5);
+            // RTR (bits 20, 4) and filter 1's data byte nibbles (19-16, 3-0) don't care
+            best.mask = ((uint32_t)a.dontCare << 21) | ((uint32_t)b.dontCare << 5) | 0x001F001Fu;
+            best.passIds = (uint16_t)pass;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Hardware acceptance filter for the TWAI controller, derived from the
+// standard (11 bit) IDs the protocol handlers take. The controller offers one
+// 29 bit code/mask filter or two 11 bit ones; the IDs are split between the
+// two filters so the fewest foreign IDs pass, and a single filter is used when
+// it is as tight. Frames the filter passes still go through the handlers' own
+// ID checks, it only keeps the rest of a busy bus out of software.
+
+#ifndef CAN_FILTER_MAX_IDS
+#define CAN_FILTER_MAX_IDS 16              // more IDs: accept all
+#endif
+
+struct CanAcceptance {
+    bool acceptAll;
+    bool dual;               // two 11 bit filters
+    uint32_t code;           // TWAI acceptance_code register layout
+    uint32_t mask;           // acceptance_mask, 1 = don't care
+    uint16_t passIds;        // standard IDs let through, 2048 = all
+};
+
+// Code and mask for these standard IDs; acceptAll when there are none or too many
+CanAcceptance can_acceptance_for(const uint16_t* ids, size_t n);
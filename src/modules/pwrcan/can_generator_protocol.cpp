@@ -1,4 +1,7 @@
 #include "can_generator_protocol.h"
+#include "../../hardware/analog_sampler.h"
+#include "../../hardware/generator_calibration.h"
+#include "../../hardware/generator_derived.h"
 
 CanGeneratorProtocol::CanGeneratorProtocol() {
     // Initialize with zeros
@@ -8,61 +11,60 @@ CanGeneratorProtocol::CanGeneratorProtocol() {
     lastFilterHours = {0};
 }
 
-bool CanGeneratorProtocol::processMessage(uint32_t canId, const uint8_t* data, uint8_t length) {
-    uint32_t now = millis();
-
-    switch (canId) {
-        case CAN_ID_GENERATOR_SENSORS:
-            if (length >= 8) { // 4 x uint16_t = 8 bytes
-                lastSensors.fuelLevel = (data[1] << 8) | data[0];
-                lastSensors.fuelFilter = (data[3] << 8) | data[2];
-                lastSensors.oilLevel = (data[5] << 8) | data[4];
-                lastSensors.oilFilter = (data[7] << 8) | data[6];
-                lastSensorsTime = now;
-                return true;
-            }
-            break;
-
-        case CAN_ID_GENERATOR_RUNTIME:
-            if (length >= 8) { // 2 x uint32_t = 8 bytes
-                lastRuntime.totalRunTimeHours =
-                    (data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
-                lastRuntime.lastServiceTimestamp =
-                    (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
-                lastRuntimeTime = now;
-                return true;
-            }
-            break;
-
-        case CAN_ID_GENERATOR_RELAYS:
-            if (length >= 3) { // 3 bytes minimum
-                lastRelays.relayStates = data[0];
-                lastRelays.digitalInputsLow = data[1];
-                lastRelays.digitalInputsHigh = (length >= 3) ? data[2] : 0;
-                lastRelaysTime = now;
-                return true;
-            }
-            break;
-
-        case CAN_ID_GENERATOR_FILTER_HOURS:
-            if (length >= 8) { // Packed filter hours (8 bytes)
-                lastFilterHours.fuelFilterHours =
-                    (data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
-                lastFilterHours.oilFilterHours =
-                    (data[5] << 8) | data[4];  // Only 16 bits available
-                lastFilterHours.oilChangeHours =
-                    (data[7] << 8) | data[6];  // Only 16 bits available
-                lastFilterHoursTime = now;
-                return true;
-            }
-            break;
-
-        default:
-            // Unknown CAN ID - ignore
-            break;
-    }
+bool CanGeneratorProtocol::registerRoutes(CanDispatcher& dispatcher) {
+    bool ok = true;
+#define CAN_GENERATOR_ROUTE(name, canId, minLength, decoder)                                              \
+    ok = dispatcher.add(CanDispatcher::Route{#name, canId, CAN_ID_STD_EXACT, false, minLength,            \
+                                             &CanGeneratorProtocol::route<&CanGeneratorProtocol::decoder>, \
+                                             this}) && ok;
+    CAN_GENERATOR_RX_TABLE(CAN_GENERATOR_ROUTE)
+#undef CAN_GENERATOR_ROUTE
+    return ok;
+}
 
-    return false;
+// Data: [fuel_level(2), fuel_filter(2), oil_level(2), oil_filter(2)], little endian
+void CanGeneratorProtocol::decodeSensors(const uint8_t* data, uint8_t length) {
+    (void)length;
+    lastSensors.fuelLevel = (data[1] << 8) | data[0];
+    lastSensors.fuelFilter = (data[3] << 8) | data[2];
+    lastSensors.oilLevel = (data[5] << 8) | data[4];
+    lastSensors.oilFilter = (data[7] << 8) | data[6];
+    lastSensorsTime = millis();
+    publish();
+    analog_sampler_push(AnalogChannel::FuelLevel, generator_calibrate(GenSensor::FuelLevel, lastSensors.fuelLevel));
+    analog_sampler_push(AnalogChannel::OilLevel, generator_calibrate(GenSensor::OilLevel, lastSensors.oilLevel));
+    generator_derived_fuel(generator_calibrate_fixed(GenSensor::FuelLevel, lastSensors.fuelLevel));
+}
+
+void CanGeneratorProtocol::decodeRuntime(const uint8_t* data, uint8_t length) {
+    (void)length;
+    lastRuntime.totalRunTimeHours = (data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+    lastRuntime.lastServiceTimestamp = (data[7] << 24) | (data[6] << 16) | (data[5] << 8) | data[4];
+    lastRuntimeTime = millis();
+    publish();
+}
+
+void CanGeneratorProtocol::decodeRelays(const uint8_t* data, uint8_t length) {
+    (void)length;
+    lastRelays.relayStates = data[0];
+    lastRelays.digitalInputsLow = data[1];
+    lastRelays.digitalInputsHigh = data[2];
+    lastRelaysTime = millis();
+    publish();
+}
+
+void CanGeneratorProtocol::decodeFilterHours(const uint8_t* data, uint8_t length) {
+    (void)length;
+    lastFilterHours.fuelFilterHours = (data[3] << 24) | (data[2] << 16) | (data[1] << 8) | data[0];
+    lastFilterHours.oilFilterHours = (data[5] << 8) | data[4];  // Only 16 bits available
+    lastFilterHours.oilChangeHours = (data[7] << 8) | data[6];  // Only 16 bits available
+    lastFilterHoursTime = millis();
+    publish();
+}
+
+void CanGeneratorProtocol::publish() {
+    snapshot_.write(CanGeneratorSnapshot{lastSensors, lastRuntime, lastRelays, lastFilterHours, lastSensorsTime,
+                                         lastRuntimeTime, lastRelaysTime, lastFilterHoursTime});
 }
 
 bool CanGeneratorProtocol::getSensors(CanGeneratorSensors& sensors) const {
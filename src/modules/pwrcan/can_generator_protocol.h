@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 #include <stdint.h>
+#include "../../system/seqlock.h"
+#include "can_dispatch.h"
 
 // CANBUS Protocol for Generator Data
 // Standard CAN IDs (11-bit) for generator communication
@@ -56,6 +58,26 @@ struct CanGeneratorFilterHours {
     uint32_t oilChangeHours;
 };
 
+// Everything last received, for lock-free readers; times are millis() of
+// arrival, 0 when that message has not been seen
+struct CanGeneratorSnapshot {
+    CanGeneratorSensors sensors;
+    CanGeneratorRuntime runtime;
+    CanGeneratorRelays relays;
+    CanGeneratorFilterHours filterHours;
+    uint32_t sensorsMs;
+    uint32_t runtimeMs;
+    uint32_t relaysMs;
+    uint32_t filterHoursMs;
+};
+
+// Messages this protocol decodes:  X(name, CAN ID, minimum length, decoder)
+#define CAN_GENERATOR_RX_TABLE(X)                                       \
+    X(Sensors, CAN_ID_GENERATOR_SENSORS, 8, decodeSensors)              \
+    X(Runtime, CAN_ID_GENERATOR_RUNTIME, 8, decodeRuntime)              \
+    X(Relays, CAN_ID_GENERATOR_RELAYS, 3, decodeRelays)                 \
+    X(FilterHours, CAN_ID_GENERATOR_FILTER_HOURS, 8, decodeFilterHours)
+
 // Generator CAN Protocol Handler Class
 class CanGeneratorProtocol {
 private:
@@ -72,11 +94,26 @@ private:
 
     uint32_t timeoutMs = 5000; // 5 second timeout for stale data
 
+    SeqlockSnapshot<CanGeneratorSnapshot> snapshot_;   // written by the CAN task only
+    void publish();
+
+    // Decoders; the dispatcher has checked the ID and the minimum length
+    void decodeSensors(const uint8_t* data, uint8_t length);
+    void decodeRuntime(const uint8_t* data, uint8_t length);
+    void decodeRelays(const uint8_t* data, uint8_t length);
+    void decodeFilterHours(const uint8_t* data, uint8_t length);
+
+    template <void (CanGeneratorProtocol::*Decode)(const uint8_t*, uint8_t)>
+    static bool route(void* ctx, uint32_t, const uint8_t* data, uint16_t length) {
+        (static_cast<CanGeneratorProtocol*>(ctx)->*Decode)(data, (uint8_t)(length > 8 ? 8 : length));
+        return true;
+    }
+
 public:
     CanGeneratorProtocol();
 
-    // Process incoming CAN messages
-    bool processMessage(uint32_t canId, const uint8_t* data, uint8_t length);
+    // Adds CAN_GENERATOR_RX_TABLE to the dispatcher; false when it is full
+    bool registerRoutes(CanDispatcher& dispatcher);
 
     // Get latest data (with timeout checking)
     bool getSensors(CanGeneratorSensors& sensors) const;
@@ -95,4 +132,8 @@ public:
     uint32_t getRuntimeAge() const;
     uint32_t getRelaysAge() const;
     uint32_t getFilterHoursAge() const;
+
+    // Consistent copy of all messages from any task, without a lock
+    CanGeneratorSnapshot snapshot() const { return snapshot_.read(); }
+    uint32_t snapshotVersion() const { return snapshot_.version(); }
 };
@@ -5,28 +5,28 @@ bool sendGeneratorSensors(PWRCANModule& canModule, const CanGeneratorSensors& se
     uint8_t data[8];
     uint8_t length;
     packGeneratorSensors(sensors, data, length);
-    return canModule.sendFrame(CAN_ID_GENERATOR_SENSORS, data, length);
+    return canModule.queueFrame(CAN_ID_GENERATOR_SENSORS, data, length);
 }
 
 bool sendGeneratorRuntime(PWRCANModule& canModule, const CanGeneratorRuntime& runtime) {
     uint8_t data[8];
     uint8_t length;
     packGeneratorRuntime(runtime, data, length);
-    return canModule.sendFrame(CAN_ID_GENERATOR_RUNTIME, data, length);
+    return canModule.queueFrame(CAN_ID_GENERATOR_RUNTIME, data, length);
 }
 
 bool sendGeneratorRelays(PWRCANModule& canModule, const CanGeneratorRelays& relays) {
     uint8_t data[8];
     uint8_t length;
     packGeneratorRelays(relays, data, length);
-    return canModule.sendFrame(CAN_ID_GENERATOR_RELAYS, data, length);
+    return canModule.queueFrame(CAN_ID_GENERATOR_RELAYS, data, length);
 }
 
 bool sendGeneratorFilterHours(PWRCANModule& canModule, const CanGeneratorFilterHours& filterHours) {
     uint8_t data[8];
     uint8_t length;
     packGeneratorFilterHours(filterHours, data, length);
-    return canModule.sendFrame(CAN_ID_GENERATOR_FILTER_HOURS, data, length);
+    return canModule.queueFrame(CAN_ID_GENERATOR_FILTER_HOURS, data, length);
 }
 
 bool sendGeneratorStatus(PWRCANModule& canModule, const GeneratorStatus& status) {
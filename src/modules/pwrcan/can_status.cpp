@@ -1,5 +1,30 @@
 #include "can_status.h"
 #include "pwrcan_module.h"
+#include "../../system/text_buffer.h"
+
+namespace {
+void appendLastError(TextBuffer& t, uint32_t code) {
+    const char* name = PWRCANModule::errorName(code);
+    if (!name) {
+        t.printf("Last Error: Unknown error %lu", (unsigned long)code);
+    } else {
+        t.printf("Last Error: %s", name[0] ? name : "None");
+    }
+}
+
+void appendActivity(TextBuffer& t, uint32_t lastActivity) {
+    if (lastActivity == 0) {
+        t.print("Last Activity: Never");
+        return;
+    }
+    const uint32_t age = (millis() - lastActivity) / 1000;
+    if (age < 60) {
+        t.printf("Last Activity: %lus ago", (unsigned long)age);
+    } else {
+        t.printf("Last Activity: %lum ago", (unsigned long)(age / 60));
+    }
+}
+} // namespace
 
 CanStatus CanStatus::create(const PWRCANModule& module) {
     CanStatus status;
@@ -15,45 +40,67 @@ CanStatus CanStatus::create(const PWRCANModule& module) {
     status.framesTransmitted = module.getFramesTransmitted();
     status.busLoadPercent = module.getBusLoad();
     status.lastErrorCode = module.getLastErrorCode();
-    status.lastBusActivityTime = module.getLastErrorCode(); // Using error code as placeholder for activity time
+    status.lastBusActivityTime = module.getLastBusActivityTime();
+    status.rxQueueFull = module.getRxQueueFull();
+    status.busErrors = module.getBusErrors();
+
+    return status;
+}
 
-    // Set derived text values
-    if (status.initialized) {
-        status.statusText = "Initialized: Yes\nStarted: " + String(status.started ? "Yes" : "No");
+const char* CanStatus::formatStatus(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    if (initialized) {
+        t.printf("Initialized: Yes\nStarted: %s", started ? "Yes" : "No");
     } else {
-        status.statusText = "Initialized: No";
+        t.print("Initialized: No");
     }
+    return t.c_str();
+}
 
-    status.errorText = "Error Count: " + String(status.errorCount);
-    status.trafficText = "RX: " + String(status.framesReceived) + ", TX: " + String(status.framesTransmitted);
-    status.busLoadText = "Bus Load: " + String(status.busLoadPercent) + "%";
+const char* CanStatus::formatErrors(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    t.printf("Error Count: %lu (bus %lu, RX full %lu)", (unsigned long)errorCount, (unsigned long)busErrors,
+             (unsigned long)rxQueueFull);
+    return t.c_str();
+}
 
-    String errorDesc = module.getLastErrorDescription();
-    status.lastErrorText = "Last Error: " + (errorDesc.length() > 0 ? errorDesc : "None");
+const char* CanStatus::formatTraffic(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    t.printf("RX: %lu, TX: %lu", (unsigned long)framesReceived, (unsigned long)framesTransmitted);
+    return t.c_str();
+}
 
-    if (status.lastBusActivityTime > 0) {
-        uint32_t age = (millis() - status.lastBusActivityTime) / 1000;
-        if (age < 60) {
-            status.activityText = "Last Activity: " + String(age) + "s ago";
-        } else {
-            status.activityText = "Last Activity: " + String(age / 60) + "m ago";
-        }
-    } else {
-        status.activityText = "Last Activity: Never";
-    }
+const char* CanStatus::formatBusLoad(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    t.printf("Bus Load: %lu%%", (unsigned long)busLoadPercent);
+    return t.c_str();
+}
 
-    // Format the full summary
-    if (status.initialized) {
-        status.formattedSummary = "Initialized: Yes\n";
-        status.formattedSummary += "Started: " + String(status.started ? "Yes" : "No") + "\n";
-        status.formattedSummary += "Error Count: " + String(status.errorCount) + "\n";
-        status.formattedSummary += "Traffic: RX " + String(status.framesReceived) + ", TX " + String(status.framesTransmitted) + "\n";
-        status.formattedSummary += "Bus Load: " + String(status.busLoadPercent) + "%\n";
-        status.formattedSummary += status.lastErrorText + "\n";
-        status.formattedSummary += status.activityText;
-    } else {
-        status.formattedSummary = "CAN bus module not initialized";
-    }
+const char* CanStatus::formatLastError(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    appendLastError(t, lastErrorCode);
+    return t.c_str();
+}
 
-    return status;
+const char* CanStatus::formatActivity(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    appendActivity(t, lastBusActivityTime);
+    return t.c_str();
+}
+
+size_t CanStatus::formatSummary(char* out, size_t size) const {
+    TextBuffer t(out, size);
+    if (!initialized) {
+        t.print("CAN bus module not initialized");
+        return t.length();
+    }
+    t.printf("Initialized: Yes\nStarted: %s\n", started ? "Yes" : "No");
+    t.printf("Error Count: %lu (bus %lu, RX full %lu)\n", (unsigned long)errorCount, (unsigned long)busErrors,
+             (unsigned long)rxQueueFull);
+    t.printf("Traffic: RX %lu, TX %lu\n", (unsigned long)framesReceived, (unsigned long)framesTransmitted);
+    t.printf("Bus Load: %lu%%\n", (unsigned long)busLoadPercent);
+    appendLastError(t, lastErrorCode);
+    t.print("\n");
+    appendActivity(t, lastBusActivityTime);
+    return t.length();
 }
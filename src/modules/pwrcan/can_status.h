@@ -6,7 +6,8 @@
 class PWRCANModule;
 
 /**
- * Enhanced CAN bus status DTO with ready-to-render values
+ * CAN bus status DTO: raw values copied from the module, text formatted on
+ * demand into the caller's buffer
  */
 struct CanStatus {
     // Raw data
@@ -21,16 +22,19 @@ struct CanStatus {
     uint32_t busLoadPercent;
     uint32_t lastErrorCode;
     uint32_t lastBusActivityTime;
+    uint32_t rxQueueFull;        // RX-queue-full alerts (frames lost)
+    uint32_t busErrors;          // bus error and error-passive alerts
 
-    // Derived/formatted values
-    String statusText;           // "Initialized: Yes/No", "Started: Yes/No"
-    String errorText;            // "Error Count: X"
-    String trafficText;          // "RX: X, TX: Y frames"
-    String busLoadText;          // "Bus Load: Z%"
-    String lastErrorText;        // "Last Error: description"
-    String activityText;         // "Last Activity: time ago"
-    String formattedSummary;     // Complete summary text
+    // Formatters; each returns out
+    const char* formatStatus(char* out, size_t size) const;      // "Initialized: Yes/No", "Started: Yes/No"
+    const char* formatErrors(char* out, size_t size) const;      // "Error Count: X (bus Y, RX full Z)"
+    const char* formatTraffic(char* out, size_t size) const;     // "RX: X, TX: Y"
+    const char* formatBusLoad(char* out, size_t size) const;     // "Bus Load: Z%"
+    const char* formatLastError(char* out, size_t size) const;   // "Last Error: description"
+    const char* formatActivity(char* out, size_t size) const;    // "Last Activity: time ago"
+    // Complete summary; returns its length
+    size_t formatSummary(char* out, size_t size) const;
 
-    // Helper method to create CanStatus with derived values
+    // Helper method to create CanStatus from the module's counters
     static CanStatus create(const class PWRCANModule& module);
 };
@@ -0,0 +1,99 @@
+#include "can_tx_scheduler.h"
+#include <string.h>
+
+CanTxScheduler::CanTxScheduler() : count_(0), queue_(nullptr), queueCtx_(nullptr), startUs_(0) {
+    memset(messages_, 0, sizeof(messages_));
+}
+
+int CanTxScheduler::add(const char* name, uint32_t id, bool extended, uint32_t periodMs, uint32_t phaseMs,
+                        FillFn fill, void* ctx) {
+    if (count_ >= CAN_TX_MAX_MESSAGES || !fill) return -1;
+    Message& m = messages_[count_];
+    m.name = name;
+    m.id = id;
+    m.extended = extended;
+    m.periodMs = periodMs;
+    m.phaseMs = phaseMs;
+    m.fill = fill;
+    m.ctx = ctx;
+    m.stats.name = name;
+    return count_++;
+}
+
+void CanTxScheduler::setPeriod(int index, uint32_t periodMs) {
+    if (index >= 0 && index < count_) messages_[index].periodMs = periodMs;
+}
+
+// Next slot at or after now: start + phase + k * period
+void CanTxScheduler::schedule(Message& m, int64_t nowUs) {
+    m.activePeriodMs = m.periodMs;
+    m.stats.periodMs = m.activePeriodMs;
+    if (m.activePeriodMs == 0) return;
+    const int64_t periodUs = (int64_t)m.activePeriodMs * 1000;
+    const int64_t first = startUs_ + (int64_t)m.phaseMs * 1000;
+    m.dueUs = nowUs <= first ? first : first + (nowUs - first + periodUs - 1) / periodUs * periodUs;
+}
+
+void CanTxScheduler::begin(QueueFn queue, void* ctx, int64_t nowUs) {
+    queue_ = queue;
+    queueCtx_ = ctx;
+    startUs_ = nowUs;
+    for (uint8_t i = 0; i < count_; i++) schedule(messages_[i], nowUs);
+}
+
+uint32_t CanTxScheduler::run(int64_t nowUs) {
+    uint32_t waitMs = UINT32_MAX;
+    if (!queue_) return waitMs;
+    for (uint8_t i = 0; i < count_; i++) {
+        Message& m = messages_[i];
+        if (m.periodMs != m.activePeriodMs) schedule(m, nowUs);
+        if (m.activePeriodMs == 0) continue;
+        const int64_t periodUs = (int64_t)m.activePeriodMs * 1000;
+        if (nowUs >= m.dueUs) {
+            const uint32_t lateUs = (uint32_t)(nowUs - m.dueUs);
+            uint8_t data[8];
+            uint8_t length = 0;
+            if (!m.fill(m.ctx, data, length)) {
+                m.stats.skipped++;
+            } else if (queue_(queueCtx_, m.id, m.extended, data, length > 8 ? 8 : length, (uint8_t)(i + 1))) {
+                m.stats.sent++;
+                m.stats.lastLateUs = lateUs;
+                if (lateUs > m.stats.maxLateUs) m.stats.maxLateUs = lateUs;
+            } else {
+                m.stats.queueFull++;
+            }
+            m.dueUs += periodUs;
+            if (m.dueUs <= nowUs) {
+                // Held up past whole periods: drop those slots rather than burst
+                const int64_t behind = (nowUs - m.dueUs) / periodUs + 1;
+                m.stats.missed += (uint32_t)behind;
+                m.dueUs += behind * periodUs;
+            }
+        }
+        const uint32_t left = (uint32_t)((m.dueUs - nowUs + 999) / 1000);
+        if (left < waitMs) waitMs = left;
+    }
+    return waitMs;
+}
+
+void CanTxScheduler::onSent(uint8_t tag, uint32_t txUs) {
+    if (tag == 0 || tag > count_) return;
+    CanTxMessageStats& s = messages_[tag - 1].stats;
+    s.lastTxUs = txUs;
+    if (txUs > s.maxTxUs) s.maxTxUs = txUs;
+}
+
+void CanTxScheduler::stats(size_t i, CanTxMessageStats& out) const {
+    if (i < count_) out = messages_[i].stats;
+}
+
+void CanTxScheduler::report(Print& out) const {
+    for (uint8_t i = 0; i < count_; i++) {
+        const CanTxMessageStats& s = messages_[i].stats;
+        out.printf("CAN TX %-10s %5lu ms: %lu sent, %lu skipped, %lu queue full, %lu missed; late %lu/%lu us, "
+                   "on bus after %lu/%lu us (last/max)\n",
+                   s.name, (unsigned long)s.periodMs, (unsigned long)s.sent, (unsigned long)s.skipped,
+                   (unsigned long)s.queueFull, (unsigned long)s.missed, (unsigned long)s.lastLateUs,
+                   (unsigned long)s.maxLateUs, (unsigned long)s.lastTxUs, (unsigned long)s.maxTxUs);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Periodic CAN transmit table, run by the CAN receive task: each message has
+// a period and a phase offset (so messages with the same period are spread
+// over it instead of bursting together) and a fill callback that builds the
+// payload at send time from current data. Frames are queued on the driver
+// without waiting; a full TX queue skips that instance and counts it, the
+// next one keeps the cadence. Per message it publishes how late the frame
+// was queued against its slot and, from the driver's TX queue, how long it
+// then waited for the bus.
+
+#ifndef CAN_TX_MAX_MESSAGES
+#define CAN_TX_MAX_MESSAGES 8
+#endif
+
+struct CanTxMessageStats {
+    const char* name;
+    uint32_t periodMs;           // 0 = paused
+    uint32_t sent;               // queued on the driver
+    uint32_t skipped;            // fill callback had nothing to send
+    uint32_t queueFull;          // instance dropped, driver queue full
+    uint32_t missed;             // slots passed while the task was held up
+    uint32_t lastLateUs;         // queued this long after its slot
+    uint32_t maxLateUs;
+    uint32_t lastTxUs;           // queued to sent on the bus
+    uint32_t maxTxUs;
+};
+
+class CanTxScheduler {
+public:
+    // Builds the payload; false skips this instance
+    typedef bool (*FillFn)(void* ctx, uint8_t* data, uint8_t& length);
+    // Queues one frame without blocking; false when the driver queue is full
+    typedef bool (*QueueFn)(void* ctx, uint32_t id, bool extended, const uint8_t* data, uint8_t length,
+                            uint8_t tag);
+
+    CanTxScheduler();
+
+    // Setup only, before the CAN task starts; returns the message index or -1
+    int add(const char* name, uint32_t id, bool extended, uint32_t periodMs, uint32_t phaseMs, FillFn fill,
+            void* ctx);
+    // Any task; 0 pauses, a change takes effect at the next slot
+    void setPeriod(int index, uint32_t periodMs);
+
+    void begin(QueueFn queue, void* ctx, int64_t nowUs);
+    // Queues every message whose slot has come; returns ms until the next slot
+    uint32_t run(int64_t nowUs);
+    // Driver reports a tagged frame sent after waiting txUs since it was queued
+    void onSent(uint8_t tag, uint32_t txUs);
+
+    size_t count() const { return count_; }
+    void stats(size_t i, CanTxMessageStats& out) const;
+    void report(Print& out) const;
+
+private:
+    struct Message {
+        const char* name;
+        uint32_t id;
+        bool extended;
+        volatile uint32_t periodMs;
+        uint32_t phaseMs;
+        FillFn fill;
+        void* ctx;
+        int64_t dueUs;
+        uint32_t activePeriodMs;     // period dueUs was computed with
+        CanTxMessageStats stats;
+    };
+
+    void schedule(Message& m, int64_t nowUs);
+
+    Message messages_[CAN_TX_MAX_MESSAGES];
+    uint8_t count_;
+    QueueFn queue_;
+    void* queueCtx_;
+    int64_t startUs_;
+};
@@ -0,0 +1,223 @@
+#include "j1939_tp.h"
+#include <string.h>
+
+namespace {
+enum : uint8_t {
+    kRts = 16,
+    kCts = 17,
+    kEndOfMsgAck = 19,
+    kBam = 32,
+    kAbort = 255,
+};
+
+// Connection abort reasons (J1939-21)
+enum : uint8_t {
+    kAbortBusy = 1,          // no session slot free
+    kAbortResources = 2,     // transfer larger than the buffer
+    kAbortTimeout = 3,
+};
+
+constexpr uint8_t kGlobal = 0xFF;
+constexpr uint16_t kMaxSize = 1785;
+constexpr uint8_t kPriorityCm = 7;
+constexpr uint8_t kPriorityDelivered = 6;
+
+uint8_t sourceOf(uint32_t id) { return (uint8_t)id; }
+uint8_t destOf(uint32_t id) { return (uint8_t)(id >> 8); }
+
+void putPgn(uint8_t* p, uint32_t pgn) {
+    p[0] = (uint8_t)pgn;
+    p[1] = (uint8_t)(pgn >> 8);
+    p[2] = (uint8_t)(pgn >> 16);
+}
+} // namespace
+
+J1939Transport::J1939Transport()
+    : pool_("j1939 tp"), dispatcher_(nullptr), send_(nullptr), sendCtx_(nullptr) {
+    memset(sessions_, 0, sizeof(sessions_));
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+bool J1939Transport::registerRoutes(CanDispatcher& dispatcher, SendFn send, void* sendCtx) {
+    dispatcher_ = &dispatcher;
+    send_ = send;
+    sendCtx_ = sendCtx;
+    const bool cm = dispatcher.add(CanDispatcher::Route{"J1939 TP.CM", J1939_PGN_TP_CM << 8, CAN_J1939_PDU1_MASK, true,
+                                                          8, &J1939Transport::onControl, this});
+    const bool dt = dispatcher.add(CanDispatcher::Route{"J1939 TP.DT", J1939_PGN_TP_DT << 8, CAN_J1939_PDU1_MASK, true,
+                                                          8, &J1939Transport::onData, this});
+    return cm && dt;
+}
+
+bool J1939Transport::onControl(void* ctx, uint32_t id, const uint8_t* data, uint16_t length) {
+    (void)length;
+    return static_cast<J1939Transport*>(ctx)->control(id, data);
+}
+
+bool J1939Transport::onData(void* ctx, uint32_t id, const uint8_t* data, uint16_t length) {
+    (void)length;
+    return static_cast<J1939Transport*>(ctx)->packet(id, data);
+}
+
+J1939Transport::Session* J1939Transport::find(uint8_t source, uint8_t dest) {
+    for (uint8_t i = 0; i < J1939_TP_SESSIONS; i++) {
+        Session* s = sessions_[i];
+        if (s && s->source == source && s->dest == dest) return s;
+    }
+    return nullptr;
+}
+
+void J1939Transport::release(Session* s) {
+    for (uint8_t i = 0; i < J1939_TP_SESSIONS; i++) {
+        if (sessions_[i] == s) sessions_[i] = nullptr;
+    }
+    pool_.destroy(s);
+    stats_.active--;
+}
+
+void J1939Transport::sendControl(uint8_t dest, const uint8_t* payload) {
+    if (!send_) return;
+    const uint32_t id = ((uint32_t)kPriorityCm << 26) | (J1939_PGN_TP_CM << 8) | ((uint32_t)dest << 8) |
+                        J1939_SOURCE_ADDRESS;
+    send_(sendCtx_, id, payload, 8);
+}
+
+void J1939Transport::sendCts(Session& s) {
+    const uint8_t left = (uint8_t)(s.packets - s.nextSeq + 1);
+    uint8_t n = left < J1939_TP_CTS_PACKETS ? left : J1939_TP_CTS_PACKETS;
+    if (s.maxPerCts && n > s.maxPerCts) n = s.maxPerCts;
+    uint8_t p[8] = {kCts, n, s.nextSeq, 0xFF, 0xFF};
+    putPgn(&p[5], s.pgn);
+    sendControl(s.source, p);
+    s.window = n;
+    s.deadlineMs = millis() + J1939_TP_T2_MS;
+}
+
+void J1939Transport::sendAbort(uint8_t dest, uint32_t pgn, uint8_t reason) {
+    uint8_t p[8] = {kAbort, reason, 0xFF, 0xFF, 0xFF};
+    putPgn(&p[5], pgn);
+    sendControl(dest, p);
+}
+
+bool J1939Transport::control(uint32_t id, const uint8_t* data) {
+    const uint8_t source = sourceOf(id);
+    const uint8_t dest = destOf(id);
+    const uint32_t pgn = (uint32_t)data[5] | ((uint32_t)data[6] << 8) | ((uint32_t)data[7] << 16);
+
+    if (data[0] == kAbort) {
+        Session* s = find(source, dest);
+        if (s && s->pgn == pgn) {
+            stats_.aborted++;
+            release(s);
+        }
+        return true;
+    }
+    const bool bam = data[0] == kBam;
+    if (!bam && data[0] != kRts) return false;   // CTS and ACK are for senders
+    if (bam ? dest != kGlobal : dest != J1939_SOURCE_ADDRESS) return false;
+    if (pgn == J1939_PGN_TP_CM || pgn == J1939_PGN_TP_DT) return false;
+
+    // A new announcement from the same sender replaces the transfer in progress
+    if (Session* old = find(source, dest)) {
+        stats_.aborted++;
+        release(old);
+    }
+    const uint16_t size = (uint16_t)(data[1] | (data[2] << 8));
+    const uint8_t packets = data[3];
+    if (size < 9 || size > kMaxSize || packets != (size + 6) / 7 || size > J1939_TP_MAX_BYTES) {
+        stats_.rejected++;
+        if (!bam) sendAbort(source, pgn, kAbortResources);
+        return false;
+    }
+    int slot = -1;
+    for (uint8_t i = 0; i < J1939_TP_SESSIONS && slot < 0; i++) {
+        if (!sessions_[i]) slot = i;
+    }
+    Session* s = slot >= 0 ? pool_.create() : nullptr;
+    if (!s) {
+        stats_.rejected++;
+        if (!bam) sendAbort(source, pgn, kAbortBusy);
+        return false;
+    }
+    sessions_[slot] = s;
+    stats_.active++;
+    stats_.started++;
+    s->bam = bam;
+    s->source = source;
+    s->dest = dest;
+    s->pgn = pgn;
+    s->size = size;
+    s->packets = packets;
+    s->nextSeq = 1;
+    s->maxPerCts = bam || data[4] == 0xFF ? 0 : data[4];
+    if (bam) {
+        s->deadlineMs = millis() + J1939_TP_T1_MS;
+    } else {
+        sendCts(*s);
+    }
+    return true;
+}
+
+bool J1939Transport::packet(uint32_t id, const uint8_t* data) {
+    Session* s = find(sourceOf(id), destOf(id));
+    if (!s) return false;
+    const uint8_t seq = data[0];
+    if (seq < s->nextSeq) return true;       // repeated packet
+    if (seq > s->nextSeq) {
+        // A lost packet; BAM cannot ask again and CMDT gives up the same way
+        stats_.aborted++;
+        if (!s->bam) sendAbort(s->source, s->pgn, kAbortTimeout);
+        release(s);
+        return false;
+    }
+    const uint16_t offset = (uint16_t)(seq - 1) * 7;
+    const uint16_t n = s->size - offset < 7 ? s->size - offset : 7;
+    memcpy(&s->data[offset], &data[1], n);
+    s->nextSeq++;
+
+    if (s->nextSeq > s->packets) {
+        if (!s->bam) {
+            uint8_t p[8] = {kEndOfMsgAck, (uint8_t)s->size, (uint8_t)(s->size >> 8), s->packets, 0xFF};
+            putPgn(&p[5], s->pgn);
+            sendControl(s->source, p);
+        }
+        deliver(*s);
+        release(s);
+        return true;
+    }
+    if (!s->bam && --s->window == 0) {
+        sendCts(*s);
+    } else {
+        s->deadlineMs = millis() + J1939_TP_T1_MS;
+    }
+    return true;
+}
+
+void J1939Transport::deliver(Session& s) {
+    stats_.completed++;
+    stats_.bytes += s.size;
+    if (!dispatcher_) return;
+    // PDU1 PGNs carry the destination in PS, as the single-frame form would
+    const bool pdu1 = ((s.pgn >> 8) & 0xFF) < 240;
+    uint32_t id = ((uint32_t)kPriorityDelivered << 26) | (s.pgn << 8) | s.source;
+    if (pdu1) id = (id & ~0xFF00u) | ((uint32_t)s.dest << 8);
+    dispatcher_->dispatch(id, true, s.data, s.size);
+}
+
+void J1939Transport::poll(uint32_t nowMs) {
+    for (uint8_t i = 0; i < J1939_TP_SESSIONS; i++) {
+        Session* s = sessions_[i];
+        if (!s || (int32_t)(nowMs - s->deadlineMs) < 0) continue;
+        stats_.timeouts++;
+        if (!s->bam) sendAbort(s->source, s->pgn, kAbortTimeout);
+        release(s);
+    }
+}
+
+void J1939Transport::report(Print& out) const {
+    out.printf("J1939 TP: %u active, %lu started, %lu completed (%lu bytes), %lu timeouts, %lu aborted, "
+               "%lu rejected\n",
+               (unsigned)stats_.active, (unsigned long)stats_.started, (unsigned long)stats_.completed,
+               (unsigned long)stats_.bytes, (unsigned long)stats_.timeouts, (unsigned long)stats_.aborted,
+               (unsigned long)stats_.rejected);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "can_dispatch.h"
+#include "../../../include/object_pool.h"
+
+// J1939-21 transport protocol, receive side: multi-packet PGNs (DM1 fault
+// lists, component ID, ...) arrive as a TP.CM announcement followed by TP.DT
+// data packets, either broadcast (BAM) or to this node with flow control
+// (CMDT: RTS, CTS, end-of-message ACK). Each transfer is reassembled in a
+// pooled buffer and the complete PGN goes back through the dispatcher as one
+// extended-ID message, so its decoder registers a route on the PGN like any
+// single-frame one. Sessions time out per the standard (T1 750 ms between
+// packets, T2 1250 ms after a CTS); CMDT sessions are aborted towards the
+// sender on timeout or when no buffer is free.
+
+#ifndef J1939_SOURCE_ADDRESS
+#define J1939_SOURCE_ADDRESS 0xF9          // this node; 249 = off-board diagnostic tool
+#endif
+#ifndef J1939_TP_SESSIONS
+#define J1939_TP_SESSIONS 4                // concurrent transfers
+#endif
+#ifndef J1939_TP_MAX_BYTES
+#define J1939_TP_MAX_BYTES 512             // per transfer (standard allows 1785); DM1 with 127 DTCs
+#endif
+#ifndef J1939_TP_CTS_PACKETS
+#define J1939_TP_CTS_PACKETS 16            // packets granted per CTS
+#endif
+#define J1939_TP_T1_MS 750
+#define J1939_TP_T2_MS 1250
+#define J1939_TP_POLL_MS 100               // receive wait while a session is open
+
+#define J1939_PGN_TP_CM 0xEC00u
+#define J1939_PGN_TP_DT 0xEB00u
+
+struct J1939TpStats {
+    uint32_t started;
+    uint32_t completed;
+    uint32_t bytes;          // in completed transfers
+    uint32_t timeouts;
+    uint32_t aborted;        // by the sender, or by us for lack of a buffer
+    uint32_t rejected;       // announcements too large or for a busy slot
+    uint8_t active;
+};
+
+class J1939Transport {
+public:
+    // Sends one 8-byte extended frame (CTS, ACK, abort)
+    typedef bool (*SendFn)(void* ctx, uint32_t id, const uint8_t* data, uint8_t length);
+
+    J1939Transport();
+
+    // Adds the TP.CM and TP.DT routes; complete PGNs are dispatched back into
+    // the same dispatcher
+    bool registerRoutes(CanDispatcher& dispatcher, SendFn send, void* sendCtx);
+
+    // Expires sessions; call from the receive task at least every
+    // J1939_TP_POLL_MS while active() is non-zero
+    void poll(uint32_t nowMs);
+    uint8_t active() const { return stats_.active; }
+
+    const J1939TpStats& stats() const { return stats_; }
+    void report(Print& out) const;
+
+private:
+    struct Session {
+        bool bam;
+        uint8_t source;
+        uint8_t dest;
+        uint32_t pgn;
+        uint16_t size;
+        uint8_t packets;
+        uint8_t nextSeq;        // next TP.DT sequence number expected, from 1
+        uint8_t window;         // CMDT: packets left in the CTS window
+        uint8_t maxPerCts;      // sender's limit from the RTS
+        uint32_t deadlineMs;
+        uint8_t data[J1939_TP_MAX_BYTES];
+    };
+
+    static bool onControl(void* ctx, uint32_t id, const uint8_t* data, uint16_t length);
+    static bool onData(void* ctx, uint32_t id, const uint8_t* data, uint16_t length);
+    bool control(uint32_t id, const uint8_t* data);
+    bool packet(uint32_t id, const uint8_t* data);
+
+    Session* find(uint8_t source, uint8_t dest);
+    void release(Session* s);
+    void sendControl(uint8_t dest, const uint8_t* payload);
+    void sendCts(Session& s);
+    void sendAbort(uint8_t dest, uint32_t pgn, uint8_t reason);
+    void deliver(Session& s);
+
+    ObjectPool<Session, J1939_TP_SESSIONS> pool_;
+    Session* sessions_[J1939_TP_SESSIONS];
+    CanDispatcher* dispatcher_;
+    SendFn send_;
+    void* sendCtx_;
+    J1939TpStats stats_;
+};
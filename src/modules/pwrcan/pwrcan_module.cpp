@@ -1,9 +1,57 @@
 #include "pwrcan_module.h"
+#include "can_capture.h"
+#include <esp_timer.h>
+#include "../../system/metrics.h"
+
+extern PWRCANModule* pwrcanModule;
+
+namespace {
+// Module counters in the metrics registry; zero until the module is up
+uint32_t canCounter(uint32_t (PWRCANModule::*get)() const) {
+    return pwrcanModule ? (pwrcanModule->*get)() : 0;
+}
+MetricCounter s_metricRx("can.rx", [] { return canCounter(&PWRCANModule::getFramesReceived); });
+MetricCounter s_metricTx("can.tx", [] { return canCounter(&PWRCANModule::getFramesTransmitted); });
+MetricCounter s_metricErrors("can.errors", [] { return canCounter(&PWRCANModule::getErrorCount); });
+MetricCounter s_metricRxMissed("can.rx_missed", [] { return canCounter(&PWRCANModule::getRxMissed); });
+MetricCounter s_metricBusOff("can.bus_off", [] { return canCounter(&PWRCANModule::getBusOffCount); });
+MetricGauge s_metricLoad("can.load_pct", [] { return static_cast<int32_t>(canCounter(&PWRCANModule::getBusLoad)); });
+MetricHistogram s_metricTxLatency("can.tx_us");      // queued to sent
+} // namespace
 
 PWRCANModule::PWRCANModule()
     : isInitializedFlag(false), isStartedFlag(false), errorCount(0),
       framesReceived(0), framesTransmitted(0), busLoadPercent(0),
-      lastErrorCode(0), lastBusActivityTime(0) {}
+      lastErrorCode(0), lastBusActivityTime(0), rxQueueFullCount(0), rxMissedCount(0),
+      busErrorCount(0), busOffCount(0), acceptance{true, false, 0, 0xFFFFFFFFu, 2048}, bitrateKbps(0),
+      lastTxLatencyUs(0), maxTxLatencyUs(0), txHead(0), txCount(0), txMux(portMUX_INITIALIZER_UNLOCKED) {
+    generatorProtocol.registerRoutes(dispatcher);
+#if PWRCAN_J1939_TP
+    j1939.registerRoutes(dispatcher, &PWRCANModule::sendJ1939, this);
+#endif
+#if PWRCAN_HEARTBEAT_MS
+    txScheduler.add("heartbeat", 0x700 + PWRCAN_NODE_ID, false, PWRCAN_HEARTBEAT_MS, 0,
+                    &PWRCANModule::fillHeartbeat, this);
+#endif
+}
+
+// The receive task sends these itself, so it never waits for queue room
+bool PWRCANModule::sendJ1939(void* ctx, uint32_t id, const uint8_t* data, uint8_t length) {
+    return static_cast<PWRCANModule*>(ctx)->queueFrame(id, data, length, true);
+}
+
+bool PWRCANModule::queueScheduled(void* ctx, uint32_t id, bool extended, const uint8_t* data, uint8_t length,
+                                  uint8_t tag) {
+    return static_cast<PWRCANModule*>(ctx)->transmit(id, data, length, extended, false, 0, tag);
+}
+
+// CANopen heartbeat: NMT state 0x05 (operational) while the bus is up
+bool PWRCANModule::fillHeartbeat(void* ctx, uint8_t* data, uint8_t& length) {
+    if (!static_cast<PWRCANModule*>(ctx)->isStartedFlag) return false;
+    data[0] = 0x05;
+    length = 1;
+    return true;
+}
 
 PWRCANModule::~PWRCANModule() {
     end();
@@ -17,14 +65,32 @@ bool PWRCANModule::begin(int txPin, int rxPin, int bitrateKbps) {
 
     // General config
     twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT((gpio_num_t)txPin, (gpio_num_t)rxPin, TWAI_MODE_NORMAL);
-    g_config.tx_queue_len = 10;
-    g_config.rx_queue_len = 10;
+    g_config.tx_queue_len = PWRCAN_TX_QUEUE_LEN;
+    g_config.rx_queue_len = PWRCAN_RX_QUEUE_LEN;
+    // The task sleeps in twai_read_alerts() until one of these
+    g_config.alerts_enabled = TWAI_ALERT_RX_DATA | TWAI_ALERT_RX_QUEUE_FULL | TWAI_ALERT_BUS_ERROR |
+                              TWAI_ALERT_ERR_PASS | TWAI_ALERT_BUS_OFF | TWAI_ALERT_BUS_RECOVERED |
+                              TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_FAILED;
+#ifdef TWAI_ALERT_RX_FIFO_OVERRUN
+    g_config.alerts_enabled |= TWAI_ALERT_RX_FIFO_OVERRUN;
+#endif
 
     // Timing config
     twai_timing_config_t t_config = selectTimingConfig(bitrateKbps);
 
-    // Filter: accept all
+    // Filter: only the IDs the protocol handlers decode, accept-all when they cannot be expressed
     twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+#if PWRCAN_HW_FILTER
+    uint16_t ids[CAN_FILTER_MAX_IDS];
+    bool complete = false;
+    const size_t idCount = dispatcher.standardIds(ids, CAN_FILTER_MAX_IDS, complete);
+    if (complete) acceptance = can_acceptance_for(ids, idCount);
+    if (!acceptance.acceptAll) {
+        f_config.acceptance_code = acceptance.code;
+        f_config.acceptance_mask = acceptance.mask;
+        f_config.single_filter = !acceptance.dual;
+    }
+#endif
 
     if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK) {
         errorCount++;
@@ -38,6 +104,9 @@ bool PWRCANModule::begin(int txPin, int rxPin, int bitrateKbps) {
 
     isInitializedFlag = true;
     isStartedFlag = true;
+    this->bitrateKbps = bitrateKbps;
+    busLoad.begin(bitrateKbps, millis());
+    txScheduler.begin(&PWRCANModule::queueScheduled, this, esp_timer_get_time());
     return true;
 #else
     (void)txPin; (void)rxPin; (void)bitrateKbps;
@@ -64,6 +133,11 @@ bool PWRCANModule::sendFrame(uint32_t identifier,
                              bool isExtendedId,
                              bool isRemoteRequest,
                              uint32_t timeoutMs) {
+    return transmit(identifier, payload, length, isExtendedId, isRemoteRequest, timeoutMs, 0);
+}
+
+bool PWRCANModule::transmit(uint32_t identifier, const uint8_t* payload, uint8_t length, bool isExtendedId,
+                            bool isRemoteRequest, uint32_t timeoutMs, uint8_t tag) {
 #if defined(ARDUINO_ARCH_ESP32)
     if (!isStartedFlag || payload == nullptr || length > 8) {
         errorCount++;
@@ -87,14 +161,120 @@ bool PWRCANModule::sendFrame(uint32_t identifier,
     // Success - update statistics
     framesTransmitted++;
     lastBusActivityTime = millis();
+    busLoad.add(can_frame_bits(identifier, isExtendedId, isRemoteRequest, payload, length));
+    const uint32_t now = (uint32_t)esp_timer_get_time();
+    portENTER_CRITICAL(&txMux);
+    if (txCount < PWRCAN_TX_QUEUE_LEN) {
+        txFifo[(txHead + txCount) % PWRCAN_TX_QUEUE_LEN] = TxStamp{now, tag};
+        txCount++;
+    }
+    portEXIT_CRITICAL(&txMux);
 
     return true;
 #else
     (void)identifier; (void)payload; (void)length; (void)isExtendedId; (void)isRemoteRequest; (void)timeoutMs;
+    (void)tag;
     return false;
 #endif
 }
 
+// The driver sends in queue order: everything beyond what it still holds has
+// gone out (or failed) since the last look
+void PWRCANModule::completeTx(uint32_t stillQueued) {
+    const uint32_t now = (uint32_t)esp_timer_get_time();
+    for (;;) {
+        TxStamp done;
+        portENTER_CRITICAL(&txMux);
+        const bool any = txCount > stillQueued;
+        if (any) {
+            done = txFifo[txHead];
+            txHead = (uint8_t)((txHead + 1) % PWRCAN_TX_QUEUE_LEN);
+            txCount--;
+        }
+        portEXIT_CRITICAL(&txMux);
+        if (!any) break;
+        const uint32_t us = now - done.queuedUs;
+        lastTxLatencyUs = us;
+        if (us > maxTxLatencyUs) maxTxLatencyUs = us;
+        s_metricTxLatency.record(us);
+        txScheduler.onSent(done.tag, us);
+    }
+}
+
+uint32_t PWRCANModule::serviceBus(uint32_t timeoutMs) {
+#if defined(ARDUINO_ARCH_ESP32)
+    if (!isInitializedFlag) {
+        vTaskDelay(pdMS_TO_TICKS(timeoutMs));
+        return 0;
+    }
+    const uint32_t nextTxMs = txScheduler.run(esp_timer_get_time());
+    if (nextTxMs < timeoutMs) timeoutMs = nextTxMs;
+    if (j1939.active() && timeoutMs > J1939_TP_POLL_MS) timeoutMs = J1939_TP_POLL_MS;
+    uint32_t alerts = 0;
+    if (twai_read_alerts(&alerts, pdMS_TO_TICKS(timeoutMs)) != ESP_OK) {
+        alerts = 0;
+    }
+
+    uint32_t frames = 0;
+    if (alerts & TWAI_ALERT_RX_DATA) {
+        // One alert can stand for many frames: empty the queue
+        twai_message_t msg;
+        while (twai_receive(&msg, 0) == ESP_OK) {
+            const uint8_t len = msg.data_length_code <= 8 ? msg.data_length_code : 8;
+            can_capture_frame(msg.identifier, msg.extd, msg.rtr, msg.data, len, esp_timer_get_time());
+            busLoad.add(can_frame_bits(msg.identifier, msg.extd, msg.rtr, msg.data, len));
+            processReceivedFrame(msg.identifier, msg.data, len, msg.extd);
+            frames++;
+        }
+    }
+
+    uint32_t lostAlerts = TWAI_ALERT_RX_QUEUE_FULL;
+#ifdef TWAI_ALERT_RX_FIFO_OVERRUN
+    lostAlerts |= TWAI_ALERT_RX_FIFO_OVERRUN;
+#endif
+    if (alerts & lostAlerts) {
+        rxQueueFullCount++;
+        errorCount++;
+        lastErrorCode = 4; // Receive overrun
+        twai_status_info_t info;
+        if (twai_get_status_info(&info) == ESP_OK) {
+            can_capture_lost(info.rx_missed_count - rxMissedCount);
+            rxMissedCount = info.rx_missed_count;
+        }
+    }
+    if (alerts & (TWAI_ALERT_BUS_ERROR | TWAI_ALERT_ERR_PASS)) {
+        busErrorCount++;
+        errorCount++;
+    }
+    if (alerts & (TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_FAILED)) {
+        twai_status_info_t info;
+        if (twai_get_status_info(&info) == ESP_OK) completeTx(info.msgs_to_tx);
+    }
+    if (alerts & TWAI_ALERT_BUS_OFF) {
+        busOffCount++;
+        errorCount++;
+        lastErrorCode = 5; // Bus off
+        isStartedFlag = false;
+        // The driver empties its TX queue; those frames never reach the bus
+        portENTER_CRITICAL(&txMux);
+        txCount = 0;
+        portEXIT_CRITICAL(&txMux);
+        twai_initiate_recovery();
+    }
+    if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+        isStartedFlag = twai_start() == ESP_OK;
+    }
+    const uint32_t now = millis();
+    if (busLoad.sample(now)) busLoadPercent = busLoad.percent();
+    if (j1939.active()) j1939.poll(now);
+    can_capture_poll(now);
+    return frames;
+#else
+    delay(timeoutMs);
+    return 0;
+#endif
+}
+
 bool PWRCANModule::receiveFrame(uint32_t &identifier,
                                 uint8_t *payload,
                                 uint8_t &length,
@@ -117,7 +297,7 @@ bool PWRCANModule::receiveFrame(uint32_t &identifier,
     for (uint8_t i = 0; i < length && i < 8; ++i) payload[i] = msg.data[i];
 
     // Process received frame for generator protocol
-    processReceivedFrame(identifier, payload, length);
+    processReceivedFrame(identifier, payload, length, isExtendedId);
 
     return true;
 #else
@@ -126,27 +306,33 @@ bool PWRCANModule::receiveFrame(uint32_t &identifier,
 #endif
 }
 
-bool PWRCANModule::processReceivedFrame(uint32_t identifier, const uint8_t* payload, uint8_t length) {
+bool PWRCANModule::processReceivedFrame(uint32_t identifier, const uint8_t* payload, uint8_t length, bool isExtendedId) {
     // Update statistics
     framesReceived++;
     lastBusActivityTime = millis();
 
-    // Pass to generator protocol handler
-    return generatorProtocol.processMessage(identifier, payload, length);
+    // One hash probe per mask group finds the protocol handler
+    return dispatcher.dispatch(identifier, isExtendedId, payload, length);
 }
 
 // Enhanced status methods
-String PWRCANModule::getLastErrorDescription() const {
-    switch (lastErrorCode) {
+const char* PWRCANModule::errorName(uint32_t code) {
+    switch (code) {
         case 0: return "";
         case 1: return "Driver install failed";
         case 2: return "Start failed";
         case 3: return "Send timeout";
-        case 4: return "Receive error";
-        default: return "Unknown error " + String(lastErrorCode);
+        case 4: return "Receive overrun";
+        case 5: return "Bus off";
+        default: return nullptr;
     }
 }
 
+String PWRCANModule::getLastErrorDescription() const {
+    const char* name = errorName(lastErrorCode);
+    return name ? String(name) : "Unknown error " + String(lastErrorCode);
+}
+
 // Update the getCanStatus method to use the new create signature
 CanStatus PWRCANModule::getCanStatus() const {
     return CanStatus::create(*this);
@@ -7,6 +7,10 @@
 #include <Arduino.h>
 #include "can_status.h"
 #include "can_generator_protocol.h"
+#include "can_filter.h"
+#include "j1939_tp.h"
+#include "can_bus_load.h"
+#include "can_tx_scheduler.h"
 
 #if defined(ARDUINO_ARCH_ESP32)
 extern "C" {
@@ -14,9 +18,35 @@ extern "C" {
 }
 #endif
 
+#ifndef PWRCAN_RX_QUEUE_LEN
+#define PWRCAN_RX_QUEUE_LEN 32             // driver RX queue, frames; holds a burst while the task is away
+#endif
+#ifndef PWRCAN_TX_QUEUE_LEN
+#define PWRCAN_TX_QUEUE_LEN 16             // driver TX queue, frames
+#endif
+#ifndef PWRCAN_NODE_ID
+#define PWRCAN_NODE_ID 1                   // heartbeat ID is 0x700 + node, CANopen style
+#endif
+#ifndef PWRCAN_HEARTBEAT_MS
+#define PWRCAN_HEARTBEAT_MS 1000           // 0 = no heartbeat
+#endif
+#ifndef PWRCAN_HW_FILTER
+#define PWRCAN_HW_FILTER 1                 // 0 = accept every frame in hardware
+#endif
+#ifndef PWRCAN_J1939_TP
+#define PWRCAN_J1939_TP 1                  // reassemble J1939 multi-packet PGNs (BAM/CMDT)
+#endif
+#ifndef PWRCAN_ALERT_WAIT_MS
+#define PWRCAN_ALERT_WAIT_MS 1000          // longest the task blocks before checking in
+#endif
+
 class PWRCANModule {
 private:
     CanGeneratorProtocol generatorProtocol;
+    CanDispatcher dispatcher;        // routes of every protocol handler
+    J1939Transport j1939;            // feeds reassembled PGNs back into dispatcher
+    CanTxScheduler txScheduler;      // periodic frames, run by the receive task
+    CanBusLoad busLoad;
 
 public:
     PWRCANModule();
@@ -36,16 +66,33 @@ public:
     // Extended status information
     uint32_t getFramesReceived() const { return framesReceived; }
     uint32_t getFramesTransmitted() const { return framesTransmitted; }
-    uint32_t getBusLoad() const { return busLoadPercent; }
+    uint32_t getBusLoad() const { return busLoadPercent; }            // last window, RX + TX bits
+    uint32_t getBusLoadPeak() const { return (busLoad.peakPermille() + 5) / 10; }
+    uint32_t getTxLatencyUs() const { return lastTxLatencyUs; }      // queued to sent, last frame
+    uint32_t getTxLatencyMaxUs() const { return maxTxLatencyUs; }
     uint32_t getLastErrorCode() const { return lastErrorCode; }
+    uint32_t getLastBusActivityTime() const { return lastBusActivityTime; }
+    uint32_t getRxQueueFull() const { return rxQueueFullCount; }   // alerts: a frame was lost
+    uint32_t getRxMissed() const { return rxMissedCount; }          // frames lost, driver count
+    uint32_t getBusErrors() const { return busErrorCount; }
+    uint32_t getBusOffCount() const { return busOffCount; }
+    // The acceptance filter begin() installed
+    const CanAcceptance& getAcceptance() const { return acceptance; }
     String getLastErrorDescription() const;
+    // Literal for a lastErrorCode; "" for none, nullptr for a code without a name
+    static const char* errorName(uint32_t code);
 
     // Enhanced DTO with ready-to-render values
     CanStatus getCanStatus() const;
 
-    // Generator protocol methods
-    bool processReceivedFrame(uint32_t identifier, const uint8_t* payload, uint8_t length);
+    // Protocol handlers: routes are added before begin(), which derives the
+    // acceptance filter from them
+    bool processReceivedFrame(uint32_t identifier, const uint8_t* payload, uint8_t length, bool isExtendedId = false);
     CanGeneratorProtocol& getGeneratorProtocol() { return generatorProtocol; }
+    CanDispatcher& getDispatcher() { return dispatcher; }
+    J1939Transport& getJ1939() { return j1939; }
+    // Periodic messages are added before begin()
+    CanTxScheduler& getTxScheduler() { return txScheduler; }
 
     // Send a CAN frame (Standard ID by default). Returns true if queued.
     bool sendFrame(uint32_t identifier,
@@ -54,6 +101,17 @@ public:
                    bool isExtendedId = false,
                    bool isRemoteRequest = false,
                    uint32_t timeoutMs = 10);
+    // Same without waiting for room in the driver's TX queue
+    bool queueFrame(uint32_t identifier, const uint8_t* payload, uint8_t length, bool isExtendedId = false) {
+        return transmit(identifier, payload, length, isExtendedId, false, 0, 0);
+    }
+
+    // Queues the scheduled frames that are due, then blocks for TWAI alerts up
+    // to timeoutMs (or the next TX slot, or J1939_TP_POLL_MS while a J1939
+    // transfer is open). Drains every queued frame into the dispatcher, counts
+    // RX-queue-full and bus errors, starts bus-off recovery, times sent frames
+    // and updates the bus load. Returns the frames processed.
+    uint32_t serviceBus(uint32_t timeoutMs);
 
     // Receive a CAN frame if available (non-blocking when timeoutMs == 0).
     bool receiveFrame(uint32_t &identifier,
@@ -74,6 +132,33 @@ private:
     uint32_t busLoadPercent;
     uint32_t lastErrorCode;
     uint32_t lastBusActivityTime;
+    uint32_t rxQueueFullCount;
+    uint32_t rxMissedCount;
+    uint32_t busErrorCount;
+    uint32_t busOffCount;
+    CanAcceptance acceptance;
+    uint32_t bitrateKbps;
+    uint32_t lastTxLatencyUs;
+    uint32_t maxTxLatencyUs;
+
+    // Frames in the driver's TX queue, oldest first, to time them onto the bus
+    struct TxStamp {
+        uint32_t queuedUs;
+        uint8_t tag;             // scheduler message + 1, 0 = ad hoc
+    };
+    TxStamp txFifo[PWRCAN_TX_QUEUE_LEN];
+    uint8_t txHead;
+    uint8_t txCount;
+    portMUX_TYPE txMux;
+
+    bool transmit(uint32_t identifier, const uint8_t* payload, uint8_t length, bool isExtendedId,
+                  bool isRemoteRequest, uint32_t timeoutMs, uint8_t tag);
+    void completeTx(uint32_t stillQueued);
+    static bool queueScheduled(void* ctx, uint32_t id, bool extended, const uint8_t* data, uint8_t length,
+                               uint8_t tag);
+    static bool fillHeartbeat(void* ctx, uint8_t* data, uint8_t& length);
+
+    static bool sendJ1939(void* ctx, uint32_t id, const uint8_t* data, uint8_t length);
 
 #if defined(ARDUINO_ARCH_ESP32)
     twai_timing_config_t selectTimingConfig(int bitrateKbps);
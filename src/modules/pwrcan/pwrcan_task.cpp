@@ -1,7 +1,7 @@
 #include <Arduino.h>
 #include "pwrcan_module.h"
 
-// FreeRTOS task wrapper for PWRCAN polling
+// FreeRTOS task wrapper for PWRCAN receive
 // Non-intrusive: only runs if module initialized successfully
 
 extern "C" void vTaskPWRCAN(void* pvParameters) {
@@ -20,18 +20,9 @@ extern "C" void vTaskPWRCAN(void* pvParameters) {
         Serial.printf("PWRCAN self-test TX: %s\n", txOk ? "OK" : "FAIL (no ACK or bus issue)" );
     }
 
-    // Simple RX loop; adjust pins/bitrate as needed when wiring is finalized
+    // Sleeps until the driver raises an alert, then drains the RX queue in one go
     for (;;) {
-        uint32_t id = 0;
-        uint8_t data[8] = {0};
-        uint8_t len = 0;
-        bool ext = false;
-        bool rtr = false;
-        if (canModule->receiveFrame(id, data, len, ext, rtr, 0)) {
-            // Minimal debug print to avoid flooding
-            Serial.printf("CAN RX id=0x%08lx len=%u\n", (unsigned long)id, (unsigned)len);
-        }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        canModule->serviceBus(PWRCAN_ALERT_WAIT_MS);
     }
 }
 
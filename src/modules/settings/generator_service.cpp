@@ -1,41 +1,31 @@
 #include "generator_service.h"
-#include <Preferences.h>
+#include "hour_meter.h"
 
-#define GEN_SERVICE_NAMESPACE "gen_service"
+// The counters live in the hour meter (hour_meter.h); this keeps the hourly view
 
 GeneratorServiceData loadGeneratorServiceData() {
-    Preferences prefs;
     GeneratorServiceData data = {0, 0, 0, 0, 0, 0}; // Initialize to zeros
 
-    if (prefs.begin(GEN_SERVICE_NAMESPACE, true)) { // Read-only mode
-        data.totalRunTimeHours = prefs.getULong("totalHrs", 0);
-        data.lastServiceTimestamp = prefs.getULong("lastSvc", 0);
-        data.fuelFilterHours = prefs.getULong("fuelFHrs", 0);
-        data.oilFilterHours = prefs.getULong("oilFHrs", 0);
-        data.oilChangeHours = prefs.getULong("oilCHrs", 0);
-        data.lastUpdateTimestamp = prefs.getULong("lastUpd", 0);
-        prefs.end();
-    }
+    data.totalRunTimeHours = hour_meter_hours(HourCounter::Run);
+    data.lastServiceTimestamp = hour_meter_last_service();
+    data.fuelFilterHours = hour_meter_hours(HourCounter::FuelFilter);
+    data.oilFilterHours = hour_meter_hours(HourCounter::OilFilter);
+    data.oilChangeHours = hour_meter_hours(HourCounter::OilChange);
+    data.lastUpdateTimestamp = millis() / 1000;
 
     return data;
 }
 
 bool saveGeneratorServiceData(const GeneratorServiceData& data) {
-    Preferences prefs;
-
-    if (!prefs.begin(GEN_SERVICE_NAMESPACE, false)) { // Read-write mode
-        return false;
+    // Whole hours replace the counters; a counter still in the same hour keeps its minutes
+    const uint32_t hours[] = {data.totalRunTimeHours, data.fuelFilterHours, data.oilFilterHours,
+                              data.oilChangeHours};
+    uint32_t seconds[(size_t)HourCounter::Count];
+    for (size_t i = 0; i < (size_t)HourCounter::Count; i++) {
+        const uint32_t current = hour_meter_seconds((HourCounter)i);
+        seconds[i] = hours[i] == current / 3600 ? current : hours[i] * 3600;
     }
-
-    prefs.putULong("totalHrs", data.totalRunTimeHours);
-    prefs.putULong("lastSvc", data.lastServiceTimestamp);
-    prefs.putULong("fuelFHrs", data.fuelFilterHours);
-    prefs.putULong("oilFHrs", data.oilFilterHours);
-    prefs.putULong("oilCHrs", data.oilChangeHours);
-    prefs.putULong("lastUpd", data.lastUpdateTimestamp);
-
-    prefs.end();
-    return true;
+    return hour_meter_set(0x0F, seconds, data.lastServiceTimestamp);
 }
 
 void resetGeneratorServiceData() {
@@ -44,42 +34,10 @@ void resetGeneratorServiceData() {
 }
 
 void updateGeneratorServiceCounters(bool generatorRunning) {
-    static uint32_t lastUpdateTime = 0;
-    uint32_t now = millis();
-
-    // Only update every hour (3600000 ms) to avoid excessive wear on NVS
-    if ((now - lastUpdateTime) < 3600000) {
-        return;
-    }
-    lastUpdateTime = now;
-
-    GeneratorServiceData data = loadGeneratorServiceData();
-
-    if (generatorRunning) {
-        // Increment counters when generator is running
-        uint32_t hoursElapsed = 1; // Assuming this function is called every hour
-
-        data.totalRunTimeHours += hoursElapsed;
-        data.fuelFilterHours += hoursElapsed;
-        data.oilFilterHours += hoursElapsed;
-        data.oilChangeHours += hoursElapsed;
-    }
-
-    data.lastUpdateTimestamp = now / 1000; // Store as seconds since boot
-    saveGeneratorServiceData(data);
+    // Any call rate; run time is counted to the second and committed by the hour meter
+    hour_meter_tick(generatorRunning);
 }
 
 void resetGeneratorServiceCounters(uint32_t currentTimestamp) {
-    GeneratorServiceData data = loadGeneratorServiceData();
-
-    // Reset all service interval counters to zero
-    data.fuelFilterHours = 0;
-    data.oilFilterHours = 0;
-    data.oilChangeHours = 0;
-
-    // Update last service timestamp
-    data.lastServiceTimestamp = currentTimestamp;
-    data.lastUpdateTimestamp = millis() / 1000;
-
-    saveGeneratorServiceData(data);
+    hour_meter_service(currentTimestamp);
 }
@@ -23,7 +23,7 @@ bool saveGeneratorServiceData(const GeneratorServiceData& data);
 // Reset generator service data to defaults
 void resetGeneratorServiceData();
 
-// Update service counters (call periodically when generator is running)
+// Update service counters (call periodically; any rate, counted to the second)
 void updateGeneratorServiceCounters(bool generatorRunning);
 
 // Reset service counters after maintenance (call when service is performed)
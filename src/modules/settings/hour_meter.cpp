@@ -0,0 +1,225 @@
+/*
+ * Hour Meter Implementation
+ */
+
+#include "hour_meter.h"
+#include "../logging/log_buffer.h"
+#include "../../hardware/generator_status.h"
+#include "../../hardware/input_capture.h"
+#include "../../system/service_task.h"
+#include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <stdio.h>
+
+namespace {
+constexpr const char* kNamespace = "hour_meter";
+constexpr const char* kLegacyNamespace = "gen_service";
+constexpr uint32_t kMagic = 0x31524D48;      // "HMR1"
+constexpr size_t kCounters = (size_t)HourCounter::Count;
+
+struct Record {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t seconds[kCounters];
+    uint32_t lastService;
+    uint32_t crc;            // CRC-32 of everything above
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t s_seconds[kCounters] = {};          // under s_mux, committed + uncommitted
+uint32_t s_lastService = 0;
+uint32_t s_uncommittedS = 0;
+uint32_t s_carryMs = 0;                      // run time below one second
+uint32_t s_lastTickMs = 0;
+bool s_wasRunning = false;
+HourMeterStats s_stats = {};
+bool s_started = false;
+
+uint32_t recordCrc(const Record& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), offsetof(Record, crc));
+}
+
+void slotKey(uint32_t seq, char* key, size_t size) {
+    snprintf(key, size, "r%lu", (unsigned long)(seq % HOUR_METER_SLOTS));
+}
+
+bool recover(Record& best) {
+    Preferences p;
+    if (!p.begin(kNamespace, true)) return false;
+    bool found = false;
+    for (uint32_t slot = 0; slot < HOUR_METER_SLOTS; slot++) {
+        char key[8];
+        slotKey(slot, key, sizeof(key));
+        Record r{};
+        if (p.getBytes(key, &r, sizeof(r)) != sizeof(r) || r.magic != kMagic || r.crc != recordCrc(r)) continue;
+        if (!found || (int32_t)(r.seq - best.seq) > 0) {
+            best = r;
+            found = true;
+        }
+    }
+    p.end();
+    return found;
+}
+
+// The hourly counters this store replaces
+void seedFromLegacy() {
+    Preferences p;
+    if (!p.begin(kLegacyNamespace, true)) return;
+    s_seconds[(size_t)HourCounter::Run] = p.getULong("totalHrs", 0) * 3600;
+    s_seconds[(size_t)HourCounter::FuelFilter] = p.getULong("fuelFHrs", 0) * 3600;
+    s_seconds[(size_t)HourCounter::OilFilter] = p.getULong("oilFHrs", 0) * 3600;
+    s_seconds[(size_t)HourCounter::OilChange] = p.getULong("oilCHrs", 0) * 3600;
+    s_lastService = p.getULong("lastSvc", 0);
+    p.end();
+}
+
+// Writes the current counters into the next slot
+bool commit() {
+    Record r{};
+    r.magic = kMagic;
+    portENTER_CRITICAL(&s_mux);
+    r.seq = s_stats.seq + 1;
+    memcpy(r.seconds, s_seconds, sizeof(r.seconds));
+    r.lastService = s_lastService;
+    const uint32_t pending = s_uncommittedS;
+    portEXIT_CRITICAL(&s_mux);
+    r.crc = recordCrc(r);
+
+    char key[8];
+    slotKey(r.seq, key, sizeof(key));
+    Preferences p;
+    bool ok = p.begin(kNamespace, false);
+    if (ok) {
+        ok = p.putBytes(key, &r, sizeof(r)) == sizeof(r);
+        p.end();
+    }
+    portENTER_CRITICAL(&s_mux);
+    if (ok) {
+        s_stats.seq = r.seq;
+        s_stats.commits++;
+        s_uncommittedS -= pending < s_uncommittedS ? pending : s_uncommittedS;
+    } else {
+        s_stats.failures++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+#if GENERATOR_RPM_INPUT >= 0
+int s_job = SERVICE_JOB_NONE;
+
+void meterJob(void*) {
+    InputChannelStats ch;
+    const bool running = input_capture_channel(GENERATOR_RPM_INPUT, ch) &&
+                         (uint64_t)ch.freqMilliHz * 60 / 1000 / GENERATOR_RPM_PULSES_PER_REV >= HOUR_METER_RUNNING_RPM;
+    hour_meter_tick(running);
+}
+#endif
+} // namespace
+
+bool hour_meter_begin() {
+    if (s_started) return true;
+    Record r{};
+    if (recover(r)) {
+        memcpy(s_seconds, r.seconds, sizeof(s_seconds));
+        s_lastService = r.lastService;
+        s_stats.seq = r.seq;
+        s_stats.loaded = true;
+    } else {
+        seedFromLegacy();
+        if (s_seconds[(size_t)HourCounter::Run]) commit();
+    }
+    s_lastTickMs = millis();
+    s_started = true;
+    logbuf_printf("HourMeter: %lu.%02lu h run (record %lu)", (unsigned long)(s_seconds[0] / 3600),
+                  (unsigned long)(s_seconds[0] % 3600 / 36), (unsigned long)s_stats.seq);
+#if GENERATOR_RPM_INPUT >= 0
+    s_job = service_job_add("HourMeter", meterJob, nullptr, HOUR_METER_PERIOD_MS, 500);
+#endif
+    return true;
+}
+
+void hour_meter_tick(bool running) {
+    if (!s_started) return;
+    const uint32_t now = millis();
+    const uint32_t elapsed = now - s_lastTickMs;
+    s_lastTickMs = now;
+
+    bool due = false;
+    portENTER_CRITICAL(&s_mux);
+    if (s_wasRunning) {
+        // The interval counts when the engine was running at its start
+        s_carryMs += elapsed;
+        const uint32_t secs = s_carryMs / 1000;
+        s_carryMs %= 1000;
+        for (size_t i = 0; i < kCounters; i++) s_seconds[i] += secs;
+        s_uncommittedS += secs;
+    }
+    if (!running) s_carryMs = 0;
+    due = s_uncommittedS && (s_uncommittedS >= HOUR_METER_COMMIT_S || (s_wasRunning && !running));
+    s_wasRunning = running;
+    portEXIT_CRITICAL(&s_mux);
+    if (due) commit();
+}
+
+bool hour_meter_flush() {
+    portENTER_CRITICAL(&s_mux);
+    const bool pending = s_uncommittedS != 0;
+    portEXIT_CRITICAL(&s_mux);
+    return !pending || commit();
+}
+
+uint32_t hour_meter_seconds(HourCounter c) {
+    if (c >= HourCounter::Count) return 0;
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t v = s_seconds[(size_t)c];
+    portEXIT_CRITICAL(&s_mux);
+    return v;
+}
+
+uint32_t hour_meter_last_service() {
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t v = s_lastService;
+    portEXIT_CRITICAL(&s_mux);
+    return v;
+}
+
+bool hour_meter_set(uint8_t mask, const uint32_t* seconds, uint32_t lastServiceTs) {
+    if (!seconds) return false;
+    portENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < kCounters; i++) {
+        if (mask & (1u << i)) s_seconds[i] = seconds[i];
+    }
+    s_lastService = lastServiceTs;
+    portEXIT_CRITICAL(&s_mux);
+    return commit();
+}
+
+bool hour_meter_service(uint32_t timestamp) {
+    const uint32_t zero[kCounters] = {};
+    const uint8_t intervals = (1u << (uint8_t)HourCounter::FuelFilter) | (1u << (uint8_t)HourCounter::OilFilter) |
+                              (1u << (uint8_t)HourCounter::OilChange);
+    return hour_meter_set(intervals, zero, timestamp);
+}
+
+void hour_meter_stats(HourMeterStats& out) {
+    portENTER_CRITICAL(&s_mux);
+    out = s_stats;
+    out.uncommittedS = s_uncommittedS;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void hour_meter_report(Print& out) {
+    if (!s_started) return;
+    HourMeterStats s;
+    hour_meter_stats(s);
+    out.printf("Hour meter: record %lu (%s), %lu commits, %lu failures, %lu s uncommitted\n", (unsigned long)s.seq,
+               s.loaded ? "recovered" : "new", (unsigned long)s.commits, (unsigned long)s.failures,
+               (unsigned long)s.uncommittedS);
+    static const char* const kNames[kCounters] = {"run", "fuel filter", "oil filter", "oil change"};
+    for (size_t i = 0; i < kCounters; i++) {
+        const uint32_t v = hour_meter_seconds((HourCounter)i);
+        out.printf("  %-11s %lu h %02lu min\n", kNames[i], (unsigned long)(v / 3600), (unsigned long)(v % 3600 / 60));
+    }
+}
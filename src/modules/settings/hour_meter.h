@@ -0,0 +1,65 @@
+/*
+ * Hour Meter
+ * Engine run time and the service interval counters at one second
+ * resolution, kept across power loss without wearing out the flash:
+ *   - run time accumulates in RAM; a record is committed after every
+ *     HOUR_METER_COMMIT_S of running and when the engine stops, never while it
+ *     stands, so a power cut loses at most HOUR_METER_COMMIT_S of run time
+ *   - records go round-robin through HOUR_METER_SLOTS small NVS blobs, each
+ *     CRC-checked and numbered; boot recovers the valid record with the highest
+ *     sequence. A torn write only loses that one record, and the rewrites are
+ *     spread over the slots and NVS pages instead of one key.
+ *   - with an engine speed pickup (GENERATOR_RPM_INPUT) a service job decides
+ *     "running" itself; otherwise updateGeneratorServiceCounters() feeds it
+ *
+ * The first boot seeds the counters from the hourly gen_service keys.
+ */
+
+#ifndef HOUR_METER_H
+#define HOUR_METER_H
+
+#include <Arduino.h>
+
+#ifndef HOUR_METER_SLOTS
+#define HOUR_METER_SLOTS 8
+#endif
+#ifndef HOUR_METER_COMMIT_S
+#define HOUR_METER_COMMIT_S 60             // run time at risk on a power cut
+#endif
+#ifndef HOUR_METER_RUNNING_RPM
+#define HOUR_METER_RUNNING_RPM 300         // engine counts as running at or above
+#endif
+#define HOUR_METER_PERIOD_MS 1000
+
+enum class HourCounter : uint8_t { Run, FuelFilter, OilFilter, OilChange, Count };
+
+struct HourMeterStats {
+    bool loaded;             // a valid record was recovered at boot
+    uint32_t seq;            // of the newest record
+    uint32_t commits;        // since boot
+    uint32_t failures;
+    uint32_t uncommittedS;   // run time only in RAM
+};
+
+// Recovers the counters; call once from setup()
+bool hour_meter_begin();
+
+// running: the engine runs now. The time since the previous call counts when
+// it was running then, so call at least every few seconds.
+void hour_meter_tick(bool running);
+// Commits the RAM run time now, e.g. before a planned reboot
+bool hour_meter_flush();
+
+uint32_t hour_meter_seconds(HourCounter c);
+inline uint32_t hour_meter_hours(HourCounter c) { return hour_meter_seconds(c) / 3600; }
+uint32_t hour_meter_last_service();
+
+// Sets counters outright (seconds); the mask selects them, bit per HourCounter
+bool hour_meter_set(uint8_t mask, const uint32_t* seconds, uint32_t lastServiceTs);
+// Service performed: zeroes the interval counters, keeps the run total
+bool hour_meter_service(uint32_t timestamp);
+
+void hour_meter_stats(HourMeterStats& out);
+void hour_meter_report(Print& out);
+
+#endif // HOUR_METER_H
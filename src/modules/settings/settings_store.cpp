@@ -1,5 +1,7 @@
 #include "settings_store.h"
 #include <Preferences.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
 #include "config/system_config.h"
 
 #if ENABLE_SD
@@ -7,11 +9,99 @@
 #include <SD.h>
 #include <SPI.h>
 #include "../storage/sd_card_module.h"
+#include "../storage/storage_task.h"
+#include "../../system/kernel_objects.h"
 extern SDCardModule* sdModule;
 #endif
 
 static const char* NS = "stamplc";
 
+SettingsService g_settings;
+
+// Binary settings journal: two NVS blob slots written alternately. A save goes to
+// the slot that does not hold the newest record, so a power cut mid-write leaves
+// the previous record readable; load takes the valid record with the highest
+// generation. AppSettings fields are only ever appended: an older record (smaller
+// payloadSize) loads over the defaults, and a schema change bumps SETTINGS_SCHEMA.
+#define SETTINGS_SCHEMA 1
+
+static const char* NS_JOURNAL = "settings";
+static const char* kSlotKeys[2] = {"slotA", "slotB"};
+static constexpr uint32_t kJournalMagic = 0x314A5453;   // "STJ1"
+
+struct SettingsRecord {
+    uint32_t magic;
+    uint16_t schema;
+    uint16_t payloadSize;       // sizeof(AppSettings) when written
+    uint32_t generation;
+    uint32_t importCheck;       // CRC of the last imported connection.json, 0 = none
+    AppSettings payload;
+    uint32_t crc;               // CRC-32 of everything above
+};
+
+static uint32_t s_generation = 0;
+static int8_t s_newestSlot = -1;
+static uint32_t s_importCheck = 0;
+static bool s_importPending = false;    // import CRC changed but not journaled yet
+
+static uint32_t recordCrc(const SettingsRecord& r) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r), offsetof(SettingsRecord, crc));
+}
+
+static bool journalLoad(AppSettings& s) {
+    Preferences p;
+    if (!p.begin(NS_JOURNAL, true)) {
+        return false;
+    }
+    SettingsRecord best{};
+    bool found = false;
+    for (int8_t slot = 0; slot < 2; slot++) {
+        SettingsRecord r{};
+        const size_t n = p.getBytes(kSlotKeys[slot], &r, sizeof(r));
+        if (n != sizeof(r) || r.magic != kJournalMagic || r.schema != SETTINGS_SCHEMA ||
+            r.payloadSize > sizeof(AppSettings) || r.crc != recordCrc(r)) {
+            continue;   // missing, torn or from an incompatible schema
+        }
+        if (!found || (int32_t)(r.generation - best.generation) > 0) {
+            best = r;
+            s_newestSlot = slot;
+            found = true;
+        }
+    }
+    p.end();
+    if (!found) {
+        return false;
+    }
+    memcpy(&s, &best.payload, best.payloadSize);
+    s_generation = best.generation;
+    s_importCheck = best.importCheck;
+    return true;
+}
+
+static bool journalWrite(const AppSettings& s) {
+    Preferences p;
+    if (!p.begin(NS_JOURNAL, false)) {
+        return false;
+    }
+    SettingsRecord r{};
+    r.magic = kJournalMagic;
+    r.schema = SETTINGS_SCHEMA;
+    r.payloadSize = sizeof(AppSettings);
+    r.generation = s_generation + 1;
+    r.importCheck = s_importCheck;
+    r.payload = s;
+    r.crc = recordCrc(r);
+    const int8_t slot = s_newestSlot == 0 ? 1 : 0;
+    const bool ok = p.putBytes(kSlotKeys[slot], &r, sizeof(r)) == sizeof(r);
+    p.end();
+    if (ok) {
+        s_generation = r.generation;
+        s_newestSlot = slot;
+        s_importPending = false;
+    }
+    return ok;
+}
+
 static void clear(AppSettings& s) {
     memset(&s, 0, sizeof(s));
 }
@@ -87,9 +177,25 @@ static bool loadSettingsFromSd(AppSettings& s) {
         return false;
     }
 
-    StaticJsonDocument<512> doc;
-    DeserializationError err = deserializeJson(doc, f);
+    // Only a file that changed since the last import is parsed
+    static char text[1024];
+    const size_t len = f.read(reinterpret_cast<uint8_t*>(text), sizeof(text));
     f.close();
+    if (len == 0 || len == sizeof(text)) {
+        Serial.println("settings: connection.json empty or larger than 1 KB; ignored");
+        return false;
+    }
+    const uint32_t check = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(text), len) | 1;
+    if (check == s_importCheck) {
+        return false;
+    }
+
+    StaticJsonDocument<512> doc;
+    DeserializationError err = deserializeJson(doc, text, len);
+    if (!err) {
+        s_importCheck = check;
+        s_importPending = true;
+    }
     if (err) {
         Serial.printf("settings: failed to parse connection.json (%s)\n", err.c_str());
         return false;
@@ -145,12 +251,33 @@ static bool loadSettingsFromSd(AppSettings& s) {
     }
     return changed;
 }
+
+bool settingsExportToSd(const AppSettings& s, const char* path) {
+    if (!path || SD.cardType() == CARD_NONE) {
+        return false;
+    }
+    StaticJsonDocument<512> doc;
+    doc["apn"] = s.apn;
+    doc["apnUser"] = s.apnUser;
+    doc["apnPass"] = s.apnPass;
+    doc["httpHost"] = s.httpHost;
+    doc["httpPort"] = s.httpPort;
+    doc["httpToken"] = s.httpToken;
+    File f = SD.open(path, FILE_WRITE);
+    if (!f) {
+        return false;
+    }
+    const size_t n = serializeJsonPretty(doc, f);
+    f.close();
+    return n > 0;
+}
 #else
 static bool loadSettingsFromSd(AppSettings&) { return false; }
+bool settingsExportToSd(const AppSettings&, const char*) { return false; }
 #endif
 
-bool settingsLoad(AppSettings& s){
-    clear(s);
+// Pre-journal layout: one NVS key per field; read once to migrate
+static void loadLegacyNvs(AppSettings& s) {
     ensureDefaultPreferences();
     Preferences p;
     if(!p.begin(NS, true)) {
@@ -160,7 +287,10 @@ bool settingsLoad(AppSettings& s){
         strlcpy(s.httpHost, "beam.soracom.io", sizeof(s.httpHost));
         s.httpPort = 8888;
         strlcpy(s.httpToken, "9751vqagkctha30lwow8", sizeof(s.httpToken));
-        return true;
+        s.displayBrightness = 100;
+        s.displaySleepEnabled = true;
+        s.displaySleepSec = 120;
+        return;
     }
 
     strlcpy(s.apn,      p.getString("apn",   "soracom.io").c_str(), sizeof(s.apn));
@@ -188,26 +318,34 @@ bool settingsLoad(AppSettings& s){
 
     p.end();
 
-    if (loadSettingsFromSd(s)) {
+    uint16_t sleepSec = 120;
+    displaySettingsLoad(s.displayBrightness, s.displaySleepEnabled, sleepSec);
+    s.displaySleepSec = sleepSec;
+}
+
+static void loadFromNvs(AppSettings& s) {
+    clear(s);
+    if (journalLoad(s)) {
+        return;
+    }
+    loadLegacyNvs(s);
+    if (journalWrite(s)) {
+        Serial.println("settings: migrated NVS keys to the settings journal");
+    }
+}
+
+bool settingsLoad(AppSettings& s){
+    loadFromNvs(s);
+    if (loadSettingsFromSd(s) || s_importPending) {
         settingsSave(s);  // Persist SD overrides into NVS so they survive without SD
     }
     return true;
 }
 
 bool settingsSave(const AppSettings& s){
-    Preferences p;
-    if(!p.begin(NS, false)) {
-        // Could not open/create namespace
-        return false;
-    }
-    p.putString("apn",   s.apn);
-    p.putString("apnU",  s.apnUser);
-    p.putString("apnP",  s.apnPass);
-    p.putString("httpHost", s.httpHost);
-    p.putUInt("httpPort",   s.httpPort ? s.httpPort : 443);
-    p.putString("httpToken", s.httpToken);
-    p.end();
-    return true;
+    AppSettings copy = s;
+    if (copy.httpPort == 0) copy.httpPort = 443;
+    return journalWrite(copy);
 }
 
 // ============================================================================
@@ -245,3 +383,95 @@ void displaySettingsSave(uint8_t brightness, bool sleepEnabled, uint16_t sleepSe
     p.putUShort("sleepSec", sleepSec);
     p.end();
 }
+
+// ============================================================================
+// Settings Service
+// ============================================================================
+SettingsService::SettingsService() : lock_(nullptr), listenerCount_(0) {
+    clear(current_);
+    memset(listeners_, 0, sizeof(listeners_));
+}
+
+bool SettingsService::begin() {
+    if (!lock_) {
+        lock_ = kernel_mutex_create(KernelMutex::Settings);
+        if (!lock_) return false;
+    }
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    loadFromNvs(current_);
+    snapshot_.write(current_);
+    xSemaphoreGive(lock_);
+    return true;
+}
+
+bool SettingsService::loadSdOverrides() {
+    if (!lock_) return false;
+    AppSettings next;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    next = current_;
+    xSemaphoreGive(lock_);
+#if ENABLE_SD
+    // Null until the storage task starts; nothing else uses the card before then
+    if (g_sdMutex && xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS)) != pdTRUE) {
+        return false;
+    }
+    const bool changed = loadSettingsFromSd(next);
+    if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+    if (changed) {
+        return update(next);
+    }
+    if (s_importPending) {
+        // Same values, new file: remember it so the next boot skips the parse
+        xSemaphoreTake(lock_, portMAX_DELAY);
+        const bool ok = settingsSave(current_);
+        xSemaphoreGive(lock_);
+        return ok;
+    }
+    return true;
+#else
+    return true;
+#endif
+}
+
+bool SettingsService::addListener(uint32_t mask, SettingsListener fn, void* ctx) {
+    if (!fn || listenerCount_ >= SETTINGS_MAX_LISTENERS) {
+        return false;
+    }
+    listeners_[listenerCount_++] = Listener{mask, fn, ctx};
+    return true;
+}
+
+uint32_t SettingsService::diff(const AppSettings& a, const AppSettings& b) {
+    uint32_t changed = 0;
+    if (strcmp(a.apn, b.apn) != 0 || strcmp(a.apnUser, b.apnUser) != 0 || strcmp(a.apnPass, b.apnPass) != 0) {
+        changed |= SETTINGS_APN;
+    }
+    if (strcmp(a.httpHost, b.httpHost) != 0 || a.httpPort != b.httpPort || strcmp(a.httpToken, b.httpToken) != 0) {
+        changed |= SETTINGS_HTTP;
+    }
+    if (a.displayBrightness != b.displayBrightness || a.displaySleepEnabled != b.displaySleepEnabled ||
+        a.displaySleepSec != b.displaySleepSec) {
+        changed |= SETTINGS_DISPLAY;
+    }
+    return changed;
+}
+
+bool SettingsService::update(const AppSettings& next) {
+    if (!lock_) return false;
+    xSemaphoreTake(lock_, portMAX_DELAY);
+    const uint32_t changed = diff(current_, next);
+    if (changed == 0) {
+        xSemaphoreGive(lock_);
+        return true;
+    }
+    const bool ok = settingsSave(next);
+    current_ = next;
+    snapshot_.write(current_);
+    for (uint8_t i = 0; i < listenerCount_; i++) {
+        if (listeners_[i].mask & changed) {
+            listeners_[i].fn(current_, changed, listeners_[i].ctx);
+        }
+    }
+    xSemaphoreGive(lock_);
+    return ok;
+}
@@ -2,6 +2,9 @@
 #define SETTINGS_STORE_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "../../system/seqlock.h"
 
 struct AppSettings {
     char apn[48];
@@ -17,12 +20,70 @@ struct AppSettings {
     uint16_t displaySleepSec;   // Sleep timeout in seconds (30-600)
 };
 
-// Display settings functions
+// Legacy per-key display namespace; read once when migrating to the journal
 void displaySettingsLoad(uint8_t& brightness, bool& sleepEnabled, uint16_t& sleepSec);
 void displaySettingsSave(uint8_t brightness, bool sleepEnabled, uint16_t sleepSec);
 
+// Persistence layer: a CRC-checked A/B record journal in NVS, plus an import of
+// /config/connection.json that is parsed only when the file changes. Read
+// settings through g_settings instead.
 bool settingsLoad(AppSettings& s);
 bool settingsSave(const AppSettings& s);
+// Writes the connection fields in the connection.json import format. Once the
+// storage task runs, the caller holds g_sdMutex.
+bool settingsExportToSd(const AppSettings& s, const char* path = "/config/connection.export.json");
+
+#define SETTINGS_MAX_LISTENERS 6
+
+// Field groups for change masks
+enum : uint32_t {
+    SETTINGS_APN     = 1UL << 0,   // apn, apnUser, apnPass
+    SETTINGS_HTTP    = 1UL << 1,   // httpHost, httpPort, httpToken
+    SETTINGS_DISPLAY = 1UL << 2,   // displayBrightness, displaySleepEnabled, displaySleepSec
+    SETTINGS_ALL     = 0x7
+};
+
+typedef void (*SettingsListener)(const AppSettings& s, uint32_t changed, void* ctx);
+
+// Settings held in RAM after one load. Readers on any task take a consistent
+// copy through a seqlock, or compare version() to spot a change cheaply.
+// update() is the single way to change a field (settings page, remote push):
+// it journals the new value and runs the listeners registered for the changed groups on
+// the calling task, so listeners must be short and must not call update().
+class SettingsService {
+public:
+    SettingsService();
+
+    // Loads NVS once; call from setup before any task reads settings
+    bool begin();
+    // Applies /config/connection.json overrides once the card is mounted
+    bool loadSdOverrides();
+
+    // Register during setup
+    bool addListener(uint32_t mask, SettingsListener fn, void* ctx);
+
+    void get(AppSettings& out) const { snapshot_.read(out); }
+    uint32_t version() const { return snapshot_.version(); }
+
+    bool update(const AppSettings& next);
+
+private:
+    struct Listener {
+        uint32_t mask;
+        SettingsListener fn;
+        void* ctx;
+    };
+
+    static uint32_t diff(const AppSettings& a, const AppSettings& b);
+
+    SeqlockSnapshot<AppSettings> snapshot_;
+    AppSettings current_;          // writers' copy, under lock_
+    SemaphoreHandle_t lock_;
+    Listener listeners_[SETTINGS_MAX_LISTENERS];
+    uint8_t listenerCount_;
+};
+
+extern SettingsService g_settings;
 
 #endif // SETTINGS_STORE_H
 
@@ -0,0 +1,272 @@
+/*
+ * Time Log Compactor Implementation
+ */
+
+#include "log_compactor.h"
+#include "storage_task.h"
+#include "../logging/log_buffer.h"
+
+#include <ArduinoJson.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+constexpr uint32_t kClockValidAfter = 1600000000UL;   // time() before this is not wall time
+constexpr uint32_t kChunkLockMs = 1000;
+
+struct RollupField {
+    char name[12];
+    double min;
+    double max;
+    double sum;
+    uint32_t count;
+};
+
+struct StreamRollup {
+    uint8_t stream;
+    uint32_t samples;
+    uint8_t fieldCount;
+    RollupField fields[LOG_ROLLUP_MAX_FIELDS];
+};
+
+// Accumulates one bucket across the streams seen in it
+class RollupBuilder {
+public:
+    void reset() { used_ = 0; }
+    bool empty() const { return used_ == 0; }
+
+    void add(uint8_t stream, JsonObjectConst values) {
+        StreamRollup* r = find(stream);
+        if (!r) {
+            return;
+        }
+        r->samples++;
+        for (JsonPairConst kv : values) {
+            if (!kv.value().is<double>() || strcmp(kv.key().c_str(), "t") == 0) {
+                continue;
+            }
+            RollupField* f = field(*r, kv.key().c_str());
+            if (!f) {
+                continue;
+            }
+            const double v = kv.value().as<double>();
+            if (f->count == 0 || v < f->min) f->min = v;
+            if (f->count == 0 || v > f->max) f->max = v;
+            f->sum += v;
+            f->count++;
+        }
+    }
+
+    // Emits one rollup payload per stream through fn; returns false on a write error
+    template <typename Fn>
+    bool emit(Fn&& fn) {
+        char out[LOG_ROLLUP_MAX_FIELDS * 56 + 32];
+        for (uint8_t i = 0; i < used_; i++) {
+            const StreamRollup& r = streams_[i];
+            int n = snprintf(out, sizeof(out), "{\"n\":%lu", static_cast<unsigned long>(r.samples));
+            for (uint8_t k = 0; k < r.fieldCount && n > 0 && static_cast<size_t>(n) < sizeof(out); k++) {
+                const RollupField& f = r.fields[k];
+                n += snprintf(out + n, sizeof(out) - n, ",\"%s\":[%.7g,%.7g,%.7g]", f.name, f.min, f.max,
+                              f.sum / f.count);
+            }
+            if (n <= 0 || static_cast<size_t>(n) + 1 >= sizeof(out)) {
+                continue;
+            }
+            out[n++] = '}';
+            if (!fn(r.stream, out, static_cast<size_t>(n))) {
+                return false;
+            }
+        }
+        used_ = 0;
+        return true;
+    }
+
+private:
+    StreamRollup* find(uint8_t stream) {
+        for (uint8_t i = 0; i < used_; i++) {
+            if (streams_[i].stream == stream) return &streams_[i];
+        }
+        if (used_ >= LOG_ROLLUP_MAX_STREAMS) {
+            return nullptr;
+        }
+        StreamRollup& r = streams_[used_++];
+        r.stream = stream;
+        r.samples = 0;
+        r.fieldCount = 0;
+        return &r;
+    }
+
+    static RollupField* field(StreamRollup& r, const char* name) {
+        for (uint8_t i = 0; i < r.fieldCount; i++) {
+            if (strcmp(r.fields[i].name, name) == 0) return &r.fields[i];
+        }
+        if (r.fieldCount >= LOG_ROLLUP_MAX_FIELDS || strlen(name) >= sizeof(r.fields[0].name)) {
+            return nullptr;
+        }
+        RollupField& f = r.fields[r.fieldCount++];
+        strlcpy(f.name, name, sizeof(f.name));
+        f.min = f.max = f.sum = 0;
+        f.count = 0;
+        return &f;
+    }
+
+    uint8_t used_ = 0;
+    StreamRollup streams_[LOG_ROLLUP_MAX_STREAMS];
+};
+
+LogCompactorStats s_stats;
+RollupBuilder s_rollup;
+uint8_t s_payload[STORAGE_MAX_LINE_BYTES];
+uint8_t s_record[TIME_LOG_RECORD_HEADER_BYTES + LOG_ROLLUP_MAX_FIELDS * 56 + 32];
+
+inline bool lockSd() {
+    return g_sdMutex && xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(kChunkLockMs)) == pdTRUE;
+}
+
+enum class CompactResult { Done, NotDue, Skipped, Failed };
+
+// Rewrites one sealed segment as rollups. The segment is pinned so retention does
+// not delete it mid-rewrite; it is replaced only once the rollup file is complete.
+CompactResult compactSegment(uint32_t seq, uint32_t now) {
+    char path[40];
+    char tmpPath[40];
+    g_timeLog.segmentPath(seq, path, sizeof(path));
+    snprintf(tmpPath, sizeof(tmpPath), TIME_LOG_DIR "/%08lu.tmp", static_cast<unsigned long>(seq));
+
+    if (!lockSd()) {
+        return CompactResult::Failed;
+    }
+    File src = SD.open(path, "r");
+    TimeLogSegmentInfo info{};
+    if (!src || !TimeLog::readInfo(src, info) || !info.sealed || info.compacted) {
+        if (src) src.close();
+        xSemaphoreGive(g_sdMutex);
+        return CompactResult::Skipped;   // missing, unsealed or already rolled up
+    }
+    if (info.maxTime < kClockValidAfter || info.maxTime + LOG_COMPACT_AGE_S > now) {
+        src.close();
+        xSemaphoreGive(g_sdMutex);
+        return info.maxTime < kClockValidAfter ? CompactResult::Skipped : CompactResult::NotDue;
+    }
+    File out = SD.open(tmpPath, "w");
+    if (!out || !TimeLogSegment::writeHeader(out, seq, true)) {
+        if (out) out.close();
+        src.close();
+        xSemaphoreGive(g_sdMutex);
+        return CompactResult::Failed;
+    }
+    g_timeLog.setPinned(seq);
+    xSemaphoreGive(g_sdMutex);
+
+    TimeLogSegment seg;
+    uint32_t bucket = 0;
+    uint32_t recordsIn = 0;
+    uint32_t rollups = 0;
+    bool ok = true;
+    auto writeRollup = [&](uint8_t stream, const char* json, size_t len) {
+        const size_t n = TimeLog::encodeRecord(s_record, sizeof(s_record), stream | TIME_LOG_ROLLUP_FLAG, bucket,
+                                               json, len);
+        if (n == 0 || !seg.accepts(bucket, n) || out.write(s_record, n) != n) {
+            return false;
+        }
+        seg.add(s_record, n);
+        rollups++;
+        return true;
+    };
+
+    uint32_t off = TIME_LOG_HEADER_BYTES;
+    bool more = true;
+    while (more && ok) {
+        if (!lockSd()) {
+            ok = false;
+            break;
+        }
+        for (uint32_t i = 0; i < LOG_COMPACT_CHUNK_RECORDS; i++) {
+            uint8_t stream = 0;
+            uint32_t time = 0;
+            size_t len = 0;
+            if (!TimeLog::readRecord(src, off, info.recordEnd, stream, time, s_payload, sizeof(s_payload), len)) {
+                more = false;
+                break;
+            }
+            recordsIn++;
+            if (stream == static_cast<uint8_t>(StorageStreamId::System) || (stream & TIME_LOG_ROLLUP_FLAG)) {
+                continue;
+            }
+            const uint32_t b = time - time % LOG_COMPACT_BUCKET_S;
+            if (b != bucket && !s_rollup.empty() && !s_rollup.emit(writeRollup)) {
+                ok = false;
+                break;
+            }
+            bucket = b;
+            StaticJsonDocument<384> doc;
+            if (deserializeJson(doc, s_payload, len) == DeserializationError::Ok && doc.is<JsonObject>()) {
+                s_rollup.add(stream, doc.as<JsonObjectConst>());
+            }
+        }
+        if (ok && !more) {
+            ok = (s_rollup.empty() || s_rollup.emit(writeRollup)) && seg.writeTrailer(out);
+            out.close();
+            src.close();
+            // Swap the rollups in under the same lock the readers take
+            ok = ok && SD.remove(path) && SD.rename(tmpPath, path);
+        }
+        xSemaphoreGive(g_sdMutex);
+        if (more) {
+            vTaskDelay(1);
+        }
+    }
+    s_rollup.reset();
+
+    if (lockSd()) {
+        if (!ok) {
+            out.close();
+            src.close();
+            if (SD.exists(path)) {
+                SD.remove(tmpPath);   // otherwise the next directory scan finishes the swap
+            }
+        }
+        g_timeLog.setPinned(0);
+        xSemaphoreGive(g_sdMutex);
+    }
+    if (!ok) {
+        s_stats.failures++;
+        logbuf_printf("tlog: compaction of segment %lu failed", static_cast<unsigned long>(seq));
+        return CompactResult::Failed;
+    }
+    s_stats.segments++;
+    s_stats.recordsIn += recordsIn;
+    s_stats.rollupsOut += rollups;
+    logbuf_printf("tlog: segment %lu compacted, %lu records -> %lu rollups", static_cast<unsigned long>(seq),
+                  static_cast<unsigned long>(recordsIn), static_cast<unsigned long>(rollups));
+    return CompactResult::Done;
+}
+} // namespace
+
+extern "C" void vTaskLogCompactor(void* pvParameters) {
+    (void)pvParameters;
+    uint32_t cursor = 0;   // segments below this are compacted or gone
+    for (;;) {
+        vTaskDelay(pdMS_TO_TICKS(LOG_COMPACT_INTERVAL_MS));
+        const uint32_t now = static_cast<uint32_t>(time(nullptr));
+        if (!g_timeLog.ready() || now < kClockValidAfter) {
+            continue;
+        }
+        if (cursor < g_timeLog.oldestSegment()) {
+            cursor = g_timeLog.oldestSegment();
+        }
+        // Segments are in time order: stop at the first one still too young
+        while (cursor < g_timeLog.newestSegment()) {
+            const CompactResult r = compactSegment(cursor, now);
+            if (r == CompactResult::NotDue || r == CompactResult::Failed) {
+                break;
+            }
+            cursor++;
+        }
+    }
+}
+
+LogCompactorStats logCompactor_getStats() {
+    return s_stats;
+}
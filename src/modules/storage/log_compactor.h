@@ -0,0 +1,47 @@
+/*
+ * Time Log Compactor
+ * Low-priority task that downsamples old time-log segments into rollups.
+ *
+ * A sealed segment whose newest record is older than LOG_COMPACT_AGE_S is
+ * rewritten in place: numeric fields of every JSON record are folded into
+ * one min/max/mean rollup per stream and LOG_COMPACT_BUCKET_S bucket,
+ *   {"n":<samples>,"<field>":[min,max,mean],...}
+ * stored with TIME_LOG_ROLLUP_FLAG on the stream. System log lines are dropped.
+ * The compactor holds g_sdMutex for LOG_COMPACT_CHUNK_RECORDS records at a
+ * time, so the storage task's group commits are never held up for long.
+ */
+
+#ifndef LOG_COMPACTOR_H
+#define LOG_COMPACTOR_H
+
+#include <Arduino.h>
+#include "time_log.h"
+
+#ifndef LOG_COMPACT_ENABLE
+#define LOG_COMPACT_ENABLE 1
+#endif
+#ifndef LOG_COMPACT_AGE_S
+#define LOG_COMPACT_AGE_S (7UL * 86400UL)       // full resolution kept this long
+#endif
+#ifndef LOG_COMPACT_BUCKET_S
+#define LOG_COMPACT_BUCKET_S 900UL              // rollup period
+#endif
+#ifndef LOG_COMPACT_INTERVAL_MS
+#define LOG_COMPACT_INTERVAL_MS 600000UL        // idle time between passes
+#endif
+
+#define LOG_COMPACT_CHUNK_RECORDS 32
+#define LOG_ROLLUP_MAX_FIELDS     8
+#define LOG_ROLLUP_MAX_STREAMS    4
+
+struct LogCompactorStats {
+    uint32_t segments = 0;       // segments rewritten
+    uint32_t recordsIn = 0;
+    uint32_t rollupsOut = 0;
+    uint32_t failures = 0;
+};
+
+extern "C" void vTaskLogCompactor(void* pvParameters);
+LogCompactorStats logCompactor_getStats();
+
+#endif // LOG_COMPACTOR_H
@@ -0,0 +1,173 @@
+/*
+ * Log History Implementation
+ */
+
+#include "log_history.h"
+#include "storage_task.h"
+#include "time_log.h"
+#include "../../system/work_queue.h"
+#include "../../ui/ui_frame.h"
+#include <atomic>
+#include <time.h>
+
+#if TIME_LOG_ENABLE
+
+namespace {
+enum : uint8_t { kIdle, kLoading, kReady };
+
+constexpr uint8_t kStream = static_cast<uint8_t>(StorageStreamId::System);
+
+struct Request {
+    LogHistoryDir dir;
+    uint32_t t;
+    uint16_t skip;
+};
+
+// Counts the lines of a span and those in its last second
+struct CountCtx {
+    uint32_t t;
+    uint32_t total;
+    uint32_t atT;
+};
+
+// Keeps lines [from, to) of a span after skipping the first skip lines of second t
+struct CollectCtx {
+    uint32_t t;
+    uint32_t skipLeft;
+    uint32_t from;
+    uint32_t to;
+    uint32_t index;
+    LogHistoryPage* page;
+};
+
+std::atomic<uint8_t> s_state{kIdle};
+Request s_req;                 // set before a load is queued
+LogHistoryPage s_page;         // the job's until Ready, then the display task's
+uint32_t s_nextId = 1;
+uint8_t s_scratch[STORAGE_MAX_LINE_BYTES];
+
+bool count_fn(uint8_t stream, uint32_t time, const uint8_t*, size_t, void* ctx) {
+    if (stream & TIME_LOG_ROLLUP_FLAG) return true;
+    CountCtx& c = *static_cast<CountCtx*>(ctx);
+    c.total++;
+    if (time == c.t) c.atT++;
+    return true;
+}
+
+void add_line(LogHistoryPage& p, uint32_t time, const uint8_t* data, size_t len) {
+    // Drop the "[ms] " prefix; it counts from a boot the page can't place
+    size_t i = 0;
+    if (len && data[0] == '[') {
+        size_t j = 1;
+        while (j < len && j < 12 && data[j] >= '0' && data[j] <= '9') j++;
+        if (j < len && data[j] == ']') {
+            i = j + 1;
+            if (i < len && data[i] == ' ') i++;
+        }
+    }
+    LogHistoryLine& line = p.lines[p.count++];
+    line.time = time;
+    size_t n = 0;
+    for (; i < len && n + 1 < sizeof(line.text) && data[i] != '\n' && data[i] != '\r'; i++) {
+        line.text[n++] = static_cast<char>(data[i]);
+    }
+    line.text[n] = '\0';
+}
+
+bool collect_fn(uint8_t stream, uint32_t time, const uint8_t* data, size_t len, void* ctx) {
+    if (stream & TIME_LOG_ROLLUP_FLAG) return true;
+    CollectCtx& c = *static_cast<CollectCtx*>(ctx);
+    if (c.skipLeft && time == c.t) {
+        c.skipLeft--;
+        return true;
+    }
+    const uint32_t i = c.index++;
+    if (i < c.from) return true;
+    if (i >= c.to || c.page->count >= LOG_HISTORY_LINES) return false;
+    add_line(*c.page, time, data, len);
+    return c.page->count < LOG_HISTORY_LINES && c.index < c.to;
+}
+
+void load_job(void*) {
+    const Request r = s_req;
+    LogHistoryPage& p = s_page;
+    p.count = 0;
+    p.atOldest = false;
+    p.atNewest = false;
+    const uint32_t now = static_cast<uint32_t>(::time(nullptr));
+
+    for (uint32_t span = LOG_HISTORY_FIRST_SPAN_S;; span *= 4) {
+        if (span > LOG_HISTORY_MAX_SPAN_S) span = LOG_HISTORY_MAX_SPAN_S;
+        if (work_cancel_requested()) break;
+        p.count = 0;
+        if (r.dir == LogHistoryDir::Older) {
+            const uint32_t t0 = r.t > span ? r.t - span : 0;
+            CountCtx count{r.t, 0, 0};
+            g_timeLog.query(kStream, t0, r.t, s_scratch, sizeof(s_scratch), count_fn, &count);
+            const uint32_t keep = count.total - (r.skip < count.atT ? r.skip : count.atT);
+            if (keep < LOG_HISTORY_LINES && span < LOG_HISTORY_MAX_SPAN_S && t0 > 0) continue;
+            CollectCtx collect{r.t, 0, keep > LOG_HISTORY_LINES ? keep - LOG_HISTORY_LINES : 0, keep, 0, &p};
+            if (keep) g_timeLog.query(kStream, t0, r.t, s_scratch, sizeof(s_scratch), collect_fn, &collect);
+            p.atOldest = keep < LOG_HISTORY_LINES;
+            break;
+        }
+        const uint32_t t1 = r.t + span;
+        CollectCtx collect{r.t, r.skip, 0, LOG_HISTORY_LINES, 0, &p};
+        g_timeLog.query(kStream, r.t, t1, s_scratch, sizeof(s_scratch), collect_fn, &collect);
+        if (p.count >= LOG_HISTORY_LINES || span >= LOG_HISTORY_MAX_SPAN_S || t1 >= now) {
+            p.atNewest = p.count < LOG_HISTORY_LINES;
+            break;
+        }
+    }
+
+    p.firstSkip = 0;
+    p.lastSkip = 0;
+    for (uint16_t i = 0; i < p.count; i++) {
+        if (p.lines[i].time == p.lines[0].time) p.firstSkip++;
+        if (p.lines[i].time == p.lines[p.count - 1].time) p.lastSkip++;
+    }
+    p.id = s_nextId++;
+    s_state.store(kReady, std::memory_order_release);
+    ui_data_changed(UiData::Logs);
+}
+} // namespace
+
+bool log_history_available() {
+    return g_timeLog.ready();
+}
+
+bool log_history_request(LogHistoryDir dir, uint32_t t, uint16_t skip) {
+    if (!log_history_available() || s_state.load(std::memory_order_acquire) == kLoading) {
+        return false;
+    }
+    s_req = Request{dir, t, skip};
+    s_state.store(kLoading, std::memory_order_release);
+    if (work_submit("LogHistory", load_job, nullptr, WorkPriority::Low, WORK_CORE_APP) == WORK_ID_NONE) {
+        s_state.store(kIdle, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+bool log_history_busy() {
+    return s_state.load(std::memory_order_acquire) == kLoading;
+}
+
+const LogHistoryPage* log_history_result() {
+    return s_state.load(std::memory_order_acquire) == kReady ? &s_page : nullptr;
+}
+
+void log_history_release() {
+    uint8_t ready = kReady;
+    s_state.compare_exchange_strong(ready, kIdle, std::memory_order_acq_rel);
+}
+
+#else
+
+bool log_history_available() { return false; }
+bool log_history_request(LogHistoryDir, uint32_t, uint16_t) { return false; }
+bool log_history_busy() { return false; }
+const LogHistoryPage* log_history_result() { return nullptr; }
+void log_history_release() {}
+
+#endif // TIME_LOG_ENABLE
@@ -0,0 +1,59 @@
+/*
+ * Log History
+ * Pages of System log lines read back from the binary time log, so the logs
+ * page can browse history the RAM line buffer no longer holds.
+ *
+ * A page is loaded by a work queue job, since the card is slow and shared with
+ * the storage task; the display task polls for it with log_history_result().
+ * Pages are found by wall-clock second: an older page ends just before the
+ * first line of the one shown, a newer page starts just after its last. Lines
+ * that share the boundary second are skipped by count, so paging neither
+ * repeats nor loses lines. Each search starts LOG_HISTORY_FIRST_SPAN_S wide and
+ * widens fourfold up to LOG_HISTORY_MAX_SPAN_S until the page is full.
+ */
+
+#ifndef LOG_HISTORY_H
+#define LOG_HISTORY_H
+
+#include <Arduino.h>
+
+#ifndef LOG_HISTORY_LINES
+#define LOG_HISTORY_LINES 32               // lines per page
+#endif
+#ifndef LOG_HISTORY_TEXT
+#define LOG_HISTORY_TEXT 40                // characters kept per line; the page shows 37
+#endif
+#ifndef LOG_HISTORY_MAX_SPAN_S
+#define LOG_HISTORY_MAX_SPAN_S (8UL * 86400UL)   // compaction drops System lines after 7 days
+#endif
+#define LOG_HISTORY_FIRST_SPAN_S 600UL
+
+struct LogHistoryLine {
+    uint32_t time;                         // wall clock, seconds
+    char text[LOG_HISTORY_TEXT];           // without the [ms] prefix of the boot it came from
+};
+
+struct LogHistoryPage {
+    uint32_t id;                           // changes with every load
+    uint16_t count;
+    uint16_t firstSkip;                    // lines of this page in the second of lines[0]
+    uint16_t lastSkip;                     // lines of this page in the second of lines[count - 1]
+    bool atOldest;                         // nothing older within the search span
+    bool atNewest;                         // nothing newer up to now
+    LogHistoryLine lines[LOG_HISTORY_LINES];
+};
+
+enum class LogHistoryDir : uint8_t { Older, Newer };
+
+// False without a time log on a mounted card
+bool log_history_available();
+
+// Queues the page before (Older) or after (Newer) second t, leaving out the last
+// (Older) or first (Newer) skip lines of second t. False while a load is running.
+bool log_history_request(LogHistoryDir dir, uint32_t t, uint16_t skip);
+bool log_history_busy();
+// Display task: the finished page, or null; valid until log_history_release()
+const LogHistoryPage* log_history_result();
+void log_history_release();
+
+#endif // LOG_HISTORY_H
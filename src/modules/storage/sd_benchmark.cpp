@@ -0,0 +1,223 @@
+/*
+ * SD Card Benchmark Implementation
+ */
+
+#include "sd_benchmark.h"
+#include "storage_task.h"
+#include <SD.h>
+#include <algorithm>
+#include <string.h>
+
+namespace {
+constexpr uint16_t kRecordBytes[SD_BENCH_SIZE_COUNT] = {64, 256, 1024, 4096};
+constexpr uint32_t kRotateSamples = 16;
+constexpr uint32_t kRotateFileBytes = 64UL * 1024UL;
+constexpr char kAppendPath[] = SD_BENCH_DIR "/append.bin";
+constexpr char kStreamPath[] = SD_BENCH_DIR "/stream.jsonl";
+
+uint8_t s_block[4096];
+uint32_t s_samples[SD_BENCH_SAMPLES];
+
+// Null before the storage task starts; nothing else writes the card then
+bool lockSd() {
+    return !g_sdMutex || xSemaphoreTake(g_sdMutex, portMAX_DELAY) == pdTRUE;
+}
+
+void unlockSd() {
+    if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+}
+
+SdBenchLatency summarize(uint32_t* samples, size_t n) {
+    SdBenchLatency l{};
+    if (n == 0) return l;
+    std::sort(samples, samples + n);
+    auto pct = [&](size_t p) { return samples[std::min(n - 1, n * p / 100)]; };
+    l.p50Us = pct(50);
+    l.p90Us = pct(90);
+    l.p99Us = pct(99);
+    l.maxUs = samples[n - 1];
+    return l;
+}
+
+// Streams SD_BENCH_APPEND_BYTES through one handle in records of len bytes
+bool benchAppend(uint16_t len, uint32_t& kbps) {
+    File f = SD.open(kAppendPath, "w");
+    if (!f) return false;
+    const uint32_t records = SD_BENCH_APPEND_BYTES / len;
+    const uint32_t start = micros();
+    for (uint32_t i = 0; i < records; i++) {
+        if (f.write(s_block, len) != len) {
+            f.close();
+            return false;
+        }
+    }
+    f.flush();
+    const uint32_t us = micros() - start;
+    f.close();
+    kbps = us ? static_cast<uint32_t>((static_cast<uint64_t>(records) * len * 1000000ULL / us) >> 10) : 0;
+    return true;
+}
+
+// One record then a flush, as a group commit with a single line pending does
+bool benchFlush(uint16_t len, SdBenchLatency& out) {
+    File f = SD.open(kAppendPath, "a");
+    if (!f) return false;
+    size_t n = 0;
+    for (; n < SD_BENCH_SAMPLES; n++) {
+        if (f.write(s_block, len) != len) break;
+        const uint32_t start = micros();
+        f.flush();
+        s_samples[n] = micros() - start;
+    }
+    f.close();
+    out = summarize(s_samples, n);
+    return n == SD_BENCH_SAMPLES;
+}
+
+bool benchOpenClose(SdBenchLatency& out) {
+    size_t n = 0;
+    for (; n < SD_BENCH_SAMPLES; n++) {
+        const uint32_t start = micros();
+        File f = SD.open(kAppendPath, "a");
+        if (!f) break;
+        f.close();
+        s_samples[n] = micros() - start;
+    }
+    out = summarize(s_samples, n);
+    return n == SD_BENCH_SAMPLES;
+}
+
+// The storage task's rotation: drop <path>.N, shift the rest up, move the live file
+bool benchRotate(SdBenchLatency& out) {
+    char from[48];
+    char to[48];
+    size_t n = 0;
+    for (; n < kRotateSamples; n++) {
+        File f = SD.open(kStreamPath, "w");
+        if (!f) break;
+        for (uint32_t w = 0; w < kRotateFileBytes; w += sizeof(s_block)) {
+            f.write(s_block, sizeof(s_block));
+        }
+        f.close();
+
+        const uint32_t start = micros();
+        snprintf(to, sizeof(to), "%s.%lu", kStreamPath, static_cast<unsigned long>(STORAGE_ROTATE_GENERATIONS));
+        SD.remove(to);
+        for (uint32_t g = STORAGE_ROTATE_GENERATIONS; g > 1; g--) {
+            snprintf(from, sizeof(from), "%s.%lu", kStreamPath, static_cast<unsigned long>(g - 1));
+            snprintf(to, sizeof(to), "%s.%lu", kStreamPath, static_cast<unsigned long>(g));
+            if (SD.exists(from)) SD.rename(from, to);
+        }
+        snprintf(to, sizeof(to), "%s.1", kStreamPath);
+        const bool ok = SD.rename(kStreamPath, to);
+        s_samples[n] = micros() - start;
+        if (!ok) break;
+    }
+    for (uint32_t g = 1; g <= STORAGE_ROTATE_GENERATIONS; g++) {
+        snprintf(to, sizeof(to), "%s.%lu", kStreamPath, static_cast<unsigned long>(g));
+        SD.remove(to);
+    }
+    SD.remove(kStreamPath);
+    out = summarize(s_samples, n);
+    return n == kRotateSamples;
+}
+
+int formatLatency(char* out, size_t size, const char* key, const SdBenchLatency& l) {
+    return snprintf(out, size, "\"%s\":{\"p50_us\":%lu,\"p90_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu}", key,
+                    static_cast<unsigned long>(l.p50Us), static_cast<unsigned long>(l.p90Us),
+                    static_cast<unsigned long>(l.p99Us), static_cast<unsigned long>(l.maxUs));
+}
+
+void printLatency(const char* what, const SdBenchLatency& l) {
+    Serial.printf("SD bench: %-18s p50 %6lu us  p90 %6lu us  p99 %6lu us  max %6lu us\n", what,
+                  static_cast<unsigned long>(l.p50Us), static_cast<unsigned long>(l.p90Us),
+                  static_cast<unsigned long>(l.p99Us), static_cast<unsigned long>(l.maxUs));
+}
+
+bool writeReport(const SdBenchResult& r) {
+    char json[1024];
+    int n = snprintf(json, sizeof(json), "{\"card_type\":%d,\"total_mb\":%lu,\"append\":[",
+                     static_cast<int>(SD.cardType()), static_cast<unsigned long>(SD.totalBytes() >> 20));
+    for (size_t i = 0; i < SD_BENCH_SIZE_COUNT && n > 0 && static_cast<size_t>(n) < sizeof(json); i++) {
+        n += snprintf(json + n, sizeof(json) - n, "%s{\"record\":%u,\"kbps\":%lu,", i ? "," : "",
+                      r.recordBytes[i], static_cast<unsigned long>(r.appendKBps[i]));
+        if (static_cast<size_t>(n) >= sizeof(json)) break;
+        n += formatLatency(json + n, sizeof(json) - n, "flush", r.flush[i]);
+        if (static_cast<size_t>(n) < sizeof(json)) json[n++] = '}';
+    }
+    if (n > 0 && static_cast<size_t>(n) < sizeof(json)) {
+        n += snprintf(json + n, sizeof(json) - n, "],");
+    }
+    if (n > 0 && static_cast<size_t>(n) < sizeof(json)) {
+        n += formatLatency(json + n, sizeof(json) - n, "open_close", r.openClose);
+    }
+    if (n > 0 && static_cast<size_t>(n) < sizeof(json)) {
+        json[n++] = ',';
+        n += formatLatency(json + n, sizeof(json) - n, "rotate", r.rotate);
+    }
+    if (n > 0 && static_cast<size_t>(n) < sizeof(json)) {
+        n += snprintf(json + n, sizeof(json) - n, ",\"total_ms\":%lu}\n", static_cast<unsigned long>(r.totalMs));
+    }
+    if (n <= 0 || static_cast<size_t>(n) >= sizeof(json)) {
+        return false;
+    }
+    SD.mkdir("/data");
+    File f = SD.open(SD_BENCH_REPORT_PATH, "w");
+    if (!f) return false;
+    const bool ok = f.write(reinterpret_cast<const uint8_t*>(json), n) == static_cast<size_t>(n);
+    f.close();
+    return ok;
+}
+} // namespace
+
+bool sdBenchmark_run(SdBenchResult* out) {
+    SdBenchResult r{};
+    if (!lockSd()) return false;
+    const bool present = SD.cardType() != CARD_NONE && (SD.exists(SD_BENCH_DIR) || SD.mkdir(SD_BENCH_DIR));
+    unlockSd();
+    if (!present) {
+        Serial.println("SD bench: no card");
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(s_block); i++) {
+        s_block[i] = (i % 64 == 63) ? '\n' : static_cast<uint8_t>('a' + i % 26);
+    }
+    Serial.println("SD bench: starting");
+    const uint32_t startMs = millis();
+    bool ok = true;
+
+    for (size_t i = 0; i < SD_BENCH_SIZE_COUNT; i++) {
+        r.recordBytes[i] = kRecordBytes[i];
+        if (!lockSd()) return false;
+        ok = benchAppend(kRecordBytes[i], r.appendKBps[i]) && ok;
+        ok = benchFlush(kRecordBytes[i], r.flush[i]) && ok;
+        unlockSd();
+        Serial.printf("SD bench: append %4u B records: %lu KB/s\n", kRecordBytes[i],
+                      static_cast<unsigned long>(r.appendKBps[i]));
+        char label[24];
+        snprintf(label, sizeof(label), "flush after %u B", kRecordBytes[i]);
+        printLatency(label, r.flush[i]);
+        vTaskDelay(1);
+    }
+
+    if (!lockSd()) return false;
+    ok = benchOpenClose(r.openClose) && ok;
+    SD.remove(kAppendPath);
+    unlockSd();
+    printLatency("open+close", r.openClose);
+    vTaskDelay(1);
+
+    if (!lockSd()) return false;
+    ok = benchRotate(r.rotate) && ok;
+    SD.rmdir(SD_BENCH_DIR);
+    r.totalMs = millis() - startMs;
+    const bool saved = writeReport(r);
+    unlockSd();
+    printLatency("rotate", r.rotate);
+
+    Serial.printf("SD bench: done in %lu ms%s; report %s%s\n", static_cast<unsigned long>(r.totalMs),
+                  ok ? "" : " (some phases failed)", SD_BENCH_REPORT_PATH, saved ? "" : " NOT written");
+    if (out) *out = r;
+    return ok && saved;
+}
@@ -0,0 +1,53 @@
+/*
+ * SD Card Benchmark
+ * Measures the card under the access pattern the storage task uses, so cards
+ * can be qualified and writer changes compared:
+ *   - sequential append throughput per record size
+ *   - open/close cost of an append handle
+ *   - flush (fsync) latency percentiles after one record per size
+ *   - rotation cost (remove + rename of a full stream file)
+ * Results go to Serial and, as JSON, to SD_BENCH_REPORT_PATH. Scratch files
+ * live under SD_BENCH_DIR and are removed afterwards.
+ */
+
+#ifndef SD_BENCHMARK_H
+#define SD_BENCHMARK_H
+
+#include <Arduino.h>
+
+#ifndef SD_BENCH_DIR
+#define SD_BENCH_DIR "/bench"
+#endif
+#ifndef SD_BENCH_REPORT_PATH
+#define SD_BENCH_REPORT_PATH "/data/bench.json"
+#endif
+#ifndef SD_BENCH_APPEND_BYTES
+#define SD_BENCH_APPEND_BYTES (256UL * 1024UL)   // written per record size
+#endif
+#ifndef SD_BENCH_SAMPLES
+#define SD_BENCH_SAMPLES 64                       // flush and open/close iterations
+#endif
+
+#define SD_BENCH_SIZE_COUNT 4                     // 64, 256, 1024, 4096 byte records
+
+struct SdBenchLatency {
+    uint32_t p50Us;
+    uint32_t p90Us;
+    uint32_t p99Us;
+    uint32_t maxUs;
+};
+
+struct SdBenchResult {
+    uint16_t recordBytes[SD_BENCH_SIZE_COUNT];
+    uint32_t appendKBps[SD_BENCH_SIZE_COUNT];
+    SdBenchLatency flush[SD_BENCH_SIZE_COUNT];
+    SdBenchLatency openClose;
+    SdBenchLatency rotate;
+    uint32_t totalMs;
+};
+
+// Runs every phase; takes g_sdMutex per phase when the storage task is up.
+// Writes the report when out is null too. False if the card could not be used.
+bool sdBenchmark_run(SdBenchResult* out = nullptr);
+
+#endif // SD_BENCHMARK_H
@@ -1,7 +1,59 @@
 #include "sd_card_module.h"
+#include "storage_task.h"
 #include <SD.h>
 #include <SPI.h>
 
+namespace {
+// Null before the storage task starts; nothing else writes the card then
+bool lockSd(uint32_t ms) {
+    return !g_sdMutex || xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(ms)) == pdTRUE;
+}
+
+void unlockSd() {
+    if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+}
+} // namespace
+
+int SDFileReader::readChunk(uint8_t* buf, size_t len, uint32_t lockMs) {
+    if (!open_ || !buf) return -1;
+    if (len == 0) return 0;
+    if (!lockSd(lockMs)) return -1;
+    size_ = file_.size();
+    int n = 0;
+    if (pos_ < size_) {
+        n = static_cast<int>(file_.read(buf, len));
+        if (n > 0) {
+            pos_ += n;
+        } else {
+            n = -1;
+        }
+    }
+    unlockSd();
+    return n;
+}
+
+bool SDFileReader::seek(uint32_t pos) {
+    if (!open_ || !lockSd(SD_READER_LOCK_MS)) return false;
+    size_ = file_.size();
+    const bool ok = pos <= size_ && file_.seek(pos);
+    if (ok) pos_ = pos;
+    unlockSd();
+    return ok;
+}
+
+void SDFileReader::close() {
+    if (!open_) return;
+    if (lockSd(SD_READER_LOCK_MS)) {
+        file_.close();
+        unlockSd();
+    } else {
+        file_.close();   // a leaked handle would pin a FATFS slot for good
+    }
+    open_ = false;
+    size_ = 0;
+    pos_ = 0;
+}
+
 SDCardModule::SDCardModule()
     : mounted(false) {}
 
@@ -222,21 +274,35 @@ bool SDCardModule::writeText(const char* path, const char* text, bool append) {
 bool SDCardModule::readText(const char* path, char* buffer, size_t bufferSize, size_t maxBytes) const {
     if (!mounted || !buffer || bufferSize == 0) return false;
 
-    File file = SD.open(path, "r");
-    if (!file) return false;
+    SDFileReader reader;
+    if (!openReader(path, reader)) return false;
 
     size_t bytesRead = 0;
     size_t maxRead = min(maxBytes, bufferSize - 1);
 
-    while (file.available() && bytesRead < maxRead) {
-        buffer[bytesRead++] = (char)file.read();
+    while (bytesRead < maxRead) {
+        int n = reader.readChunk(reinterpret_cast<uint8_t*>(buffer) + bytesRead, maxRead - bytesRead);
+        if (n <= 0) break;
+        bytesRead += n;
     }
 
     buffer[bytesRead] = '\0';
-    file.close();
     return true;
 }
 
+bool SDCardModule::openReader(const char* path, SDFileReader& reader) const {
+    reader.close();
+    if (!mounted || !path || !lockSd(SD_READER_LOCK_MS)) return false;
+    reader.file_ = SD.open(path, "r");
+    if (reader.file_) {
+        reader.open_ = true;
+        reader.size_ = reader.file_.size();
+        reader.pos_ = 0;
+    }
+    unlockSd();
+    return reader.open_;
+}
+
 bool SDCardModule::testWrite() const {
     if (!mounted) return false;
 
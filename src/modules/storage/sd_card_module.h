@@ -2,6 +2,40 @@
 #define SD_CARD_MODULE_H
 
 #include <Arduino.h>
+#include <SD.h>
+
+#ifndef SD_READER_LOCK_MS
+#define SD_READER_LOCK_MS 500   // longest wait for g_sdMutex per chunk
+#endif
+
+// Cursor over one file, read through a caller-owned window. The file stays open
+// between chunks but g_sdMutex is held only while a chunk is read, so the storage
+// task keeps committing while a large file is streamed out.
+class SDFileReader {
+public:
+    SDFileReader() : open_(false), size_(0), pos_(0) {}
+    ~SDFileReader() { close(); }
+    SDFileReader(const SDFileReader&) = delete;
+    SDFileReader& operator=(const SDFileReader&) = delete;
+
+    bool isOpen() const { return open_; }
+    // Size as of the last chunk; grows while another task appends
+    uint32_t size() const { return size_; }
+    uint32_t position() const { return pos_; }
+    bool eof() const { return pos_ >= size_; }
+
+    // Bytes read into buf (0 at end of file), or -1 on a read error or lock timeout
+    int readChunk(uint8_t* buf, size_t len, uint32_t lockMs = SD_READER_LOCK_MS);
+    bool seek(uint32_t pos);
+    void close();
+
+private:
+    friend class SDCardModule;
+    File file_;
+    bool open_;
+    uint32_t size_;
+    uint32_t pos_;
+};
 
 class SDCardModule {
 private:
@@ -23,6 +57,8 @@ public:
     bool exists(const char* path) const;
     bool writeText(const char* path, const char* text, bool append = true);
     bool readText(const char* path, char* buffer, size_t bufferSize, size_t maxBytes = 4096) const;
+    // Opens path for chunked reading; any previous file on reader is closed
+    bool openReader(const char* path, SDFileReader& reader) const;
     
     // Diagnostics
     bool testWrite() const;
@@ -1,60 +1,406 @@
 #include "storage_task.h"
 #include "sd_card_module.h"
+#include "time_log.h"
+#include "../logging/log_buffer.h"
+#include "../pwrcan/can_capture.h"
+#include "../catm_gnss/modem_transcript.h"
+#include "../../system/kernel_objects.h"
+#include "../../system/mutex_profiler.h"
+#include "../../system/power_manager.h"
+#include "../../system/hot_path_timer.h"
+#include "../../system/metrics.h"
 #include <SD.h>
+#include <atomic>
+#include <freertos/message_buffer.h>
+#include <string.h>
+#include <time.h>
 
-QueueHandle_t g_storageQ = nullptr;
 SemaphoreHandle_t g_sdMutex = nullptr;
+static MessageBufferHandle_t s_ingest = nullptr;
+static SemaphoreHandle_t s_ingestMutex = nullptr;   // message buffers take one writer at a time
 
 extern SDCardModule* sdModule;
 
-static bool sd_rotate_if_big(const char* path, size_t maxBytes) {
-    File f = SD.open(path, "r");
-    if (!f) return true;  // nothing to rotate yet
-    size_t sz = f.size();
-    f.close();
-    if (sz <= maxBytes) return true;
-    char bak[128];
-    snprintf(bak, sizeof(bak), "%s.1", path);
-    SD.remove(bak);
-    SD.rename(path, bak);
-    File nf = SD.open(path, "w");
-    if (nf) nf.close();
-    return true;
+// One JSONL stream per record type. The file stays open between records and lines
+// collect in RAM; whole sectors go to the card as they fill, and the tail goes out
+// with a flush once the oldest buffered line is STORAGE_FLUSH_MAX_DELAY_MS old.
+struct StorageStream {
+    const char* path;
+    File file;
+    bool open;
+    uint32_t size;             // bytes on the card, tracked here for rotation
+    uint32_t firstBufferedMs;  // 0 = buffer empty
+    uint32_t retryAtMs;        // reopen backoff after an SD error
+    size_t used;
+    uint8_t buf[STORAGE_WRITE_BUFFER_BYTES];
+};
+
+static StorageStream s_streams[] = {
+    {"/data/gnss.jsonl"},
+    {"/data/cellular.jsonl"},
+    {"/data/system.jsonl"},
+    {"/data/analog.jsonl"},
+};
+static constexpr size_t kStreamCount = sizeof(s_streams) / sizeof(s_streams[0]);
+static uint32_t s_droppedLines = 0;
+static uint32_t s_generations = 1;        // until the card size is known
+static bool s_retentionSet = false;
+
+// Backpressure; the write-behind fill is published by the storage task, the
+// ingest fill read by whoever asks
+static std::atomic<uint8_t> s_backlogPercent{0};
+static std::atomic<uint8_t> s_pressure{0};
+static std::atomic<uint32_t> s_pressureRaised{0};
+static std::atomic<uint32_t> s_pressureCritical{0};
+static std::atomic<uint32_t> s_shed[kStreamCount];
+static MetricCounter s_metricShed("storage.shed");
+static MetricGauge s_metricPressure("storage.pressure");
+
+#if TIME_LOG_ENABLE
+// Mirrors every line into the binary time log, stamped with the wall clock at queue time
+static void tlog_buffer(const StorageRecordHeader& hdr, const char* line, uint32_t now) {
+    const uint32_t time = static_cast<uint32_t>(::time(nullptr)) - (now - hdr.timestampMs) / 1000;
+    if (g_timeLog.append(hdr.stream, time, line, hdr.length)) {
+        return;
+    }
+    if (mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) {
+        g_timeLog.flush(now);
+        mutex_give(g_sdMutex);
+    }
+    if (!g_timeLog.append(hdr.stream, time, line, hdr.length)) {
+        s_droppedLines++;
+    }
+}
+#endif
+
+static void sd_close_stream(StorageStream& s) {
+    if (s.open) {
+        s.file.close();
+        s.open = false;
+    }
 }
 
-static void sd_append_jsonl(const char* path, const char* jsonLine) {
-    // Check if SD card is available before attempting operations
+static bool sd_open_stream(StorageStream& s, uint32_t now) {
+    if (s.open) return true;
+    if (s.retryAtMs != 0 && (int32_t)(now - s.retryAtMs) < 0) return false;
     if (SD.cardType() == CARD_NONE) {
-        return; // SD card not present, skip silently
+        s.retryAtMs = (now + STORAGE_REOPEN_RETRY_MS) | 1;
+        return false;
     }
-    
-    xSemaphoreTake(g_sdMutex, portMAX_DELAY);
     SD.mkdir("/data");
-    sd_rotate_if_big(path, 512 * 1024);
-    File f = SD.open(path, "a");
-    if (f) {
-        f.println(jsonLine);
-        f.close();
+    s.file = SD.open(s.path, "a");
+    if (!s.file) {
+        s.retryAtMs = (now + STORAGE_REOPEN_RETRY_MS) | 1;
+        return false;
+    }
+    s.open = true;
+    s.size = s.file.size();
+    s.retryAtMs = 0;
+    return true;
+}
+
+// Splits STORAGE_RETENTION_PERCENT of the card between the JSONL generations (at
+// most a quarter of it) and time-log segments. Caller holds g_sdMutex.
+static void sd_apply_retention() {
+    if (s_retentionSet || !sdModule) return;
+    const uint64_t total = sdModule->totalBytes();
+    if (total == 0) return;
+    const uint64_t budget = total / 100 * STORAGE_RETENTION_PERCENT;
+    // Each generation costs one rotated file per stream; +1 for the live files
+    const uint64_t perGeneration = static_cast<uint64_t>(STORAGE_ROTATE_BYTES) * kStreamCount;
+    uint32_t gens = STORAGE_ROTATE_GENERATIONS;
+    while (gens > 1 && perGeneration * (gens + 1) > budget / 4) {
+        gens--;
+    }
+    s_generations = gens;
+    s_retentionSet = true;
+#if TIME_LOG_ENABLE
+    const uint64_t jsonl = perGeneration * (gens + 1);
+    uint64_t segments = budget > jsonl ? (budget - jsonl) / TIME_LOG_SEGMENT_BYTES : 0;
+    if (segments < 2) segments = 2;
+    if (segments > TIME_LOG_MAX_SEGMENTS) segments = TIME_LOG_MAX_SEGMENTS;
+    g_timeLog.setMaxSegments(static_cast<uint32_t>(segments));
+    logbuf_printf("storage: %llu MB budget, %lu generations, %lu tlog segments",
+                  static_cast<unsigned long long>(budget >> 20), static_cast<unsigned long>(gens),
+                  static_cast<unsigned long>(segments));
+#else
+    logbuf_printf("storage: %llu MB budget, %lu generations", static_cast<unsigned long long>(budget >> 20),
+                  static_cast<unsigned long>(gens));
+#endif
+}
+
+// Shifts <path>.N-1 .. <path>.1 up one, dropping the oldest, and the live file
+// to <path>.1. Caller holds g_sdMutex.
+static void sd_rotate_stream(StorageStream& s) {
+    sd_close_stream(s);
+    char from[128];
+    char to[128];
+    snprintf(to, sizeof(to), "%s.%lu", s.path, static_cast<unsigned long>(s_generations));
+    SD.remove(to);
+    for (uint32_t g = s_generations; g > 1; g--) {
+        snprintf(from, sizeof(from), "%s.%lu", s.path, static_cast<unsigned long>(g - 1));
+        snprintf(to, sizeof(to), "%s.%lu", s.path, static_cast<unsigned long>(g));
+        if (SD.exists(from)) {
+            SD.rename(from, to);
+        }
+    }
+    snprintf(to, sizeof(to), "%s.1", s.path);
+    SD.rename(s.path, to);
+    s.size = 0;
+}
+
+// Writes buffered bytes; all of them when drain is set, otherwise only up to the
+// last sector boundary of the file. Caller holds g_sdMutex.
+static bool sd_write_stream(StorageStream& s, bool drain, uint32_t now) {
+    if (s.used == 0) return true;
+    HOT_PATH_TIMER("sd.write");
+    if (s.open && s.size + s.used > STORAGE_ROTATE_BYTES) {
+        sd_rotate_stream(s);
+    }
+    if (!sd_open_stream(s, now)) {
+        return false;
+    }
+    size_t n = s.used;
+    if (!drain) {
+        const uint32_t end = ((s.size + s.used) / STORAGE_SECTOR_BYTES) * STORAGE_SECTOR_BYTES;
+        if (end <= s.size) return true;
+        n = end - s.size;
+    }
+    if (s.file.write(s.buf, n) != n) {
+        // The handle may be dead (card pulled); reopen later and keep the tail
+        sd_close_stream(s);
+        s.retryAtMs = (now + STORAGE_REOPEN_RETRY_MS) | 1;
+        return false;
     }
-    xSemaphoreGive(g_sdMutex);
+    s.size += n;
+    s.used -= n;
+    memmove(s.buf, s.buf + n, s.used);
+    if (s.used == 0) {
+        s.firstBufferedMs = 0;
+    }
+    return true;
+}
+
+static void sd_buffer_line(StorageStream& s, const char* line, size_t len, uint32_t now) {
+    if (len + 1 > sizeof(s.buf) - s.used) {
+        // Buffer full and the card not taking data: make room by writing or drop the line
+        if (mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) {
+            sd_write_stream(s, true, now);
+            mutex_give(g_sdMutex);
+        }
+        if (len + 1 > sizeof(s.buf) - s.used) {
+            s_droppedLines++;
+            return;
+        }
+    }
+    memcpy(s.buf + s.used, line, len);
+    s.used += len;
+    s.buf[s.used++] = '\n';
+    if (s.firstBufferedMs == 0) {
+        s.firstBufferedMs = now ? now : 1;
+    }
+}
+
+// Group commit: full sectors always, the partial tail only once it is due; one
+// fsync per stream that wrote anything
+static void sd_commit(uint32_t now) {
+    bool pending = false;
+#if TIME_LOG_ENABLE
+    const bool tlogDue = g_timeLog.msUntilFlush(now, STORAGE_FLUSH_MAX_DELAY_MS) == 0;
+    pending = tlogDue;
+#endif
+    for (auto& s : s_streams) {
+        if (s.used >= STORAGE_SECTOR_BYTES || (s.used && now - s.firstBufferedMs >= STORAGE_FLUSH_MAX_DELAY_MS)) {
+            pending = true;
+        }
+    }
+    if (!pending || !mutex_take(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS))) {
+        return;
+    }
+    sd_apply_retention();
+    for (auto& s : s_streams) {
+        const bool due = s.used && now - s.firstBufferedMs >= STORAGE_FLUSH_MAX_DELAY_MS;
+        const size_t before = s.used;
+        if ((due || s.used >= STORAGE_SECTOR_BYTES) && sd_write_stream(s, due, now) && s.used != before) {
+            s.file.flush();
+        }
+    }
+#if TIME_LOG_ENABLE
+    if (tlogDue) {
+        g_timeLog.flush(now);
+    }
+#endif
+    mutex_give(g_sdMutex);
+}
+
+// Fill of the fullest stream buffer: past a sector or two only while the card
+// is slow or refusing writes
+static void sd_publish_backlog() {
+    size_t used = 0;
+    for (const auto& s : s_streams) {
+        if (s.used > used) used = s.used;
+    }
+    s_backlogPercent.store(static_cast<uint8_t>(used * 100 / STORAGE_WRITE_BUFFER_BYTES), std::memory_order_relaxed);
+}
+
+// captureWait: what the CAN capture asked for on its last pass
+static TickType_t sd_next_wait(uint32_t now, uint32_t captureWait) {
+    uint32_t wait = captureWait;
+#if TIME_LOG_ENABLE
+    const uint32_t tlog = g_timeLog.msUntilFlush(now, STORAGE_FLUSH_MAX_DELAY_MS);
+    if (tlog < wait) wait = tlog;
+#endif
+    for (const auto& s : s_streams) {
+        if (s.used) {
+            const uint32_t age = now - s.firstBufferedMs;
+            uint32_t left = age >= STORAGE_FLUSH_MAX_DELAY_MS ? 0 : STORAGE_FLUSH_MAX_DELAY_MS - age;
+            // No point waking before a failed stream may reopen
+            if (!s.open && s.retryAtMs != 0 && (int32_t)(s.retryAtMs - now) > (int32_t)left) {
+                left = s.retryAtMs - now;
+            }
+            if (left < wait) wait = left;
+        }
+    }
+    // Deferred log entries are formatted (and queued back to us) at this pace
+    if (wait > STORAGE_LOG_PUMP_MS) wait = STORAGE_LOG_PUMP_MS;
+    return pdMS_TO_TICKS(wait);
 }
 
 extern "C" void vTaskStorage(void* pvParameters) {
     (void)pvParameters;
-    g_sdMutex = xSemaphoreCreateMutex();
-    g_storageQ = xQueueCreate(64, sizeof(LogRecord));
+    g_sdMutex = kernel_mutex_create(KernelMutex::Sd);
+    power_lock_bind_mutex(g_sdMutex, PowerLock::Sd);
+    s_ingestMutex = kernel_mutex_create(KernelMutex::StorageIngest);
+    s_ingest = kernel_message_buffer_create(KernelMessageBuffer::StorageIngest);
+    uint8_t rx[sizeof(StorageRecordHeader) + STORAGE_MAX_LINE_BYTES];
+    uint32_t captureWait = UINT32_MAX;
     for (;;) {
-        LogRecord rec;
-        if (xQueueReceive(g_storageQ, &rec, portMAX_DELAY) == pdTRUE) {
-            if (rec.type == LogRecord::GNSS) {
-                sd_append_jsonl("/data/gnss.jsonl", rec.line);
-            } else if (rec.type == LogRecord::CELL) {
-                sd_append_jsonl("/data/cellular.jsonl", rec.line);
-            } else if (rec.type == LogRecord::SYSTEM) {
-                sd_append_jsonl("/data/system.jsonl", rec.line);
+        size_t got = xMessageBufferReceive(s_ingest, rx, sizeof(rx), sd_next_wait(millis(), captureWait));
+        // Take everything already queued before touching the card
+        while (got >= sizeof(StorageRecordHeader)) {
+            StorageRecordHeader hdr;
+            memcpy(&hdr, rx, sizeof(hdr));
+            if (hdr.stream < kStreamCount && sizeof(hdr) + hdr.length <= got) {
+                const char* line = reinterpret_cast<const char*>(rx + sizeof(hdr));
+                sd_buffer_line(s_streams[hdr.stream], line, hdr.length, millis());
+#if TIME_LOG_ENABLE
+                tlog_buffer(hdr, line, millis());
+#endif
             }
+            got = xMessageBufferReceive(s_ingest, rx, sizeof(rx), 0);
         }
+        log_pump();
+        sd_commit(millis());
+        sd_publish_backlog();
+        captureWait = can_capture_drain(millis());
+        const uint32_t transcriptWait = modem_transcript_drain(millis());
+        if (transcriptWait < captureWait) captureWait = transcriptWait;
     }
 }
 
+bool storage_ready() {
+    return s_ingest != nullptr;
+}
+
+static uint8_t ingest_percent() {
+    if (!s_ingest) return 0;
+    const size_t room = xMessageBufferSpacesAvailable(s_ingest);
+    if (room >= STORAGE_INGEST_BYTES) return 0;
+    return static_cast<uint8_t>((STORAGE_INGEST_BYTES - room) * 100 / STORAGE_INGEST_BYTES);
+}
 
+StoragePressure storage_pressure() {
+    uint8_t percent = ingest_percent();
+    const uint8_t backlog = s_backlogPercent.load(std::memory_order_relaxed);
+    if (backlog > percent) percent = backlog;
+    const StoragePressure level = percent >= STORAGE_CRITICAL_PERCENT ? StoragePressure::Critical
+                                  : percent >= STORAGE_SHED_PERCENT  ? StoragePressure::Shed
+                                                                      : StoragePressure::Normal;
+    const uint8_t prev = s_pressure.exchange(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    if (prev != static_cast<uint8_t>(level)) {
+        if (prev == static_cast<uint8_t>(StoragePressure::Normal)) {
+            s_pressureRaised.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (level == StoragePressure::Critical) s_pressureCritical.fetch_add(1, std::memory_order_relaxed);
+        s_metricPressure.set(static_cast<int32_t>(level));
+    }
+    return level;
+}
+
+bool storage_admit(StorageStreamId stream, StoragePriority prio) {
+    const StoragePressure level = storage_pressure();
+    // Shed turns Optional away, Critical everything but Critical
+    if (static_cast<uint8_t>(prio) >= static_cast<uint8_t>(level)) {
+        return true;
+    }
+    const size_t i = static_cast<size_t>(stream);
+    if (i < kStreamCount) s_shed[i].fetch_add(1, std::memory_order_relaxed);
+    s_metricShed.inc();
+    return false;
+}
+
+void storage_pressure_stats(StoragePressureStats& out) {
+    out = StoragePressureStats{};
+    out.level = storage_pressure();
+    out.ingestPercent = ingest_percent();
+    out.backlogPercent = s_backlogPercent.load(std::memory_order_relaxed);
+    out.raised = s_pressureRaised.load(std::memory_order_relaxed);
+    out.critical = s_pressureCritical.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kStreamCount && i < sizeof(out.shed) / sizeof(out.shed[0]); i++) {
+        out.shed[i] = s_shed[i].load(std::memory_order_relaxed);
+    }
+}
+
+void storage_pressure_report(Print& out) {
+    static const char* const kLevels[] = {"normal", "shed", "critical"};
+    StoragePressureStats s;
+    storage_pressure_stats(s);
+    out.printf("Storage: pressure %s (ingest %u%%, write-behind %u%%), raised %lu, critical %lu, "
+               "shed gnss %lu cell %lu system %lu analog %lu, dropped %lu\n",
+               kLevels[static_cast<size_t>(s.level)], (unsigned)s.ingestPercent, (unsigned)s.backlogPercent,
+               (unsigned long)s.raised, (unsigned long)s.critical, (unsigned long)s.shed[0],
+               (unsigned long)s.shed[1], (unsigned long)s.shed[2], (unsigned long)s.shed[3],
+               (unsigned long)s_droppedLines);
+}
+
+bool storage_push(StorageStreamId stream, const char* line, size_t len, TickType_t wait, StoragePriority prio) {
+    if (!s_ingest || !line) {
+        return false;
+    }
+    if (len > STORAGE_MAX_LINE_BYTES) {
+        len = STORAGE_MAX_LINE_BYTES;
+    }
+    StorageLine msg;
+    memcpy(msg.text(), line, len);
+    return storage_push_line(stream, msg, len, wait, prio);
+}
+
+bool storage_push_line(StorageStreamId stream, StorageLine& line, size_t len, TickType_t wait,
+                       StoragePriority prio) {
+    if (!s_ingest || !storage_admit(stream, prio)) {
+        return false;
+    }
+    // Under pressure only Critical lines wait for room
+    if (prio != StoragePriority::Critical && s_pressure.load(std::memory_order_relaxed) != 0) {
+        wait = 0;
+    }
+    if (len > STORAGE_MAX_LINE_BYTES) {
+        len = STORAGE_MAX_LINE_BYTES;
+    }
+    StorageRecordHeader hdr{};
+    hdr.stream = static_cast<uint8_t>(stream);
+    hdr.length = static_cast<uint16_t>(len);
+    hdr.timestampMs = millis();
+    memcpy(line.msg, &hdr, sizeof(hdr));
+
+    if (!mutex_take(s_ingestMutex, wait)) {
+        return false;
+    }
+    const size_t sent = xMessageBufferSend(s_ingest, line.msg, sizeof(hdr) + len, wait);
+    mutex_give(s_ingestMutex);
+    return sent != 0;
+}
+
+uint32_t storage_droppedLines() {
+    return s_droppedLines;
+}
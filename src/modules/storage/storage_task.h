@@ -3,15 +3,91 @@
 
 #include <Arduino.h>
 
-struct LogRecord {
-    enum Type : uint8_t { GNSS = 0, CELL = 1, SYSTEM = 2 } type;
-    char line[256];
+#ifndef STORAGE_WRITE_BUFFER_BYTES
+#define STORAGE_WRITE_BUFFER_BYTES 2048        // RAM write-behind per stream
+#endif
+#ifndef STORAGE_FLUSH_MAX_DELAY_MS
+#define STORAGE_FLUSH_MAX_DELAY_MS 2000        // oldest buffered line waits at most this long
+#endif
+#ifndef STORAGE_ROTATE_BYTES
+#define STORAGE_ROTATE_BYTES (512UL * 1024UL)  // stream file moves to <path>.1 beyond this
+#endif
+#ifndef STORAGE_ROTATE_GENERATIONS
+#define STORAGE_ROTATE_GENERATIONS 8           // <path>.1 .. <path>.N kept, oldest dropped
+#endif
+#ifndef STORAGE_RETENTION_PERCENT
+#define STORAGE_RETENTION_PERCENT 50           // share of the card the logs may fill
+#endif
+
+#define STORAGE_SECTOR_BYTES      512
+#define STORAGE_SD_LOCK_MS        500
+#define STORAGE_REOPEN_RETRY_MS   5000         // after an SD open/write error
+#define STORAGE_LOG_PUMP_MS       500          // deferred LOGF entries reach the SD sink this often
+
+#ifndef STORAGE_INGEST_BYTES
+#define STORAGE_INGEST_BYTES 4096              // message buffer between producers and the storage task
+#endif
+
+#define STORAGE_MAX_LINE_BYTES 256
+
+// Backpressure: the fuller of the ingest buffer and the fullest stream's write-behind
+#ifndef STORAGE_SHED_PERCENT
+#define STORAGE_SHED_PERCENT 50                // Optional lines turned away from here
+#endif
+#ifndef STORAGE_CRITICAL_PERCENT
+#define STORAGE_CRITICAL_PERCENT 85            // only Critical lines taken from here
+#endif
+
+enum class StorageStreamId : uint8_t { Gnss = 0, Cell = 1, System = 2, Analog = 3 };
+
+// How much a line matters to its producer; the pressure decides which get in
+enum class StoragePriority : uint8_t { Optional = 0, Normal, Critical };
+enum class StoragePressure : uint8_t { Normal = 0, Shed, Critical };
+
+struct StoragePressureStats {
+    StoragePressure level;
+    uint8_t ingestPercent;
+    uint8_t backlogPercent;
+    uint32_t raised;           // times the pressure left Normal
+    uint32_t critical;         // times it reached Critical
+    uint32_t shed[4];          // lines turned away, by StorageStreamId
+};
+
+// Each ingest message is this header followed by length bytes of line text (no newline)
+struct StorageRecordHeader {
+    uint8_t stream;            // StorageStreamId
+    uint8_t flags;             // reserved, 0
+    uint16_t length;
+    uint32_t timestampMs;      // millis() when queued
 };
 
-extern QueueHandle_t g_storageQ;
 extern SemaphoreHandle_t g_sdMutex;
 
 extern "C" void vTaskStorage(void* pvParameters);
+// False until the storage task has created its ingest buffer
+bool storage_ready();
+// Queues one line for stream; longer lines are cut at STORAGE_MAX_LINE_BYTES.
+// Safe from any task; false if the buffer stayed full for wait ticks, or if prio
+// is shed at the current pressure (then without waiting, and counted).
+bool storage_push(StorageStreamId stream, const char* line, size_t len, TickType_t wait = 0,
+                  StoragePriority prio = StoragePriority::Normal);
+// A line built in place: serialize STORAGE_MAX_LINE_BYTES at most into text() and queue
+// it with storage_push_line(), which skips the copy storage_push makes into its message
+struct StorageLine {
+    uint8_t msg[sizeof(StorageRecordHeader) + STORAGE_MAX_LINE_BYTES];
+    char* text() { return reinterpret_cast<char*>(msg + sizeof(StorageRecordHeader)); }
+};
+bool storage_push_line(StorageStreamId stream, StorageLine& line, size_t len, TickType_t wait = 0,
+                       StoragePriority prio = StoragePriority::Normal);
+// Lines lost because a stream's buffer was full while the card refused writes
+uint32_t storage_droppedLines();
+
+// Any task. Producers ask before building a line so load is shed at the source;
+// false (counted as shed) when prio is below what the current pressure takes.
+StoragePressure storage_pressure();
+bool storage_admit(StorageStreamId stream, StoragePriority prio);
+void storage_pressure_stats(StoragePressureStats& out);
+void storage_pressure_report(Print& out);
 
 #endif // STORAGE_TASK_H
 
@@ -0,0 +1,477 @@
+/*
+ * Binary Time-Indexed Log Implementation
+ */
+
+#include "time_log.h"
+#include "storage_task.h"
+#include "../logging/log_buffer.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+TimeLog g_timeLog;
+
+namespace {
+constexpr uint32_t kSegmentMagic = 0x31474C54;   // "TLG1"
+constexpr uint32_t kFooterMagic = 0x46474C54;    // "TLGF"
+constexpr uint16_t kVersion = 1;
+constexpr uint16_t kFlagCompacted = 0x0001;
+constexpr uint16_t kFlagPreallocated = 0x0002;   // length is valid; the file size is not
+constexpr uint8_t kRecordMagic = 0xD5;
+constexpr uint32_t kQueryLockMs = 2000;
+constexpr uint32_t kFnvBasis = 2166136261u;
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t seq;
+    uint32_t length;           // committed bytes, preallocated segments only
+};
+
+struct RecordHeader {
+    uint8_t magic;
+    uint8_t stream;
+    uint16_t length;
+    uint32_t time;
+};
+
+struct SegmentFooter {
+    uint32_t magic;
+    uint32_t indexOffset;
+    uint16_t indexCount;
+    uint16_t streamMask;
+    uint32_t recordCount;
+    uint32_t minTime;
+    uint32_t maxTime;
+    uint32_t dataCheck;        // over every record byte
+    uint32_t check;            // over the index and the footer up to here
+};
+
+static_assert(sizeof(SegmentHeader) == TIME_LOG_HEADER_BYTES, "segment header layout");
+static_assert(sizeof(RecordHeader) == TIME_LOG_RECORD_HEADER_BYTES, "record header layout");
+static_assert(sizeof(SegmentFooter) == 32, "segment footer layout");
+
+// Room kept at the end of every segment for the index and footer
+constexpr uint32_t kTrailerReserve = TIME_LOG_MAX_INDEX * 8 + sizeof(SegmentFooter);
+
+uint32_t fnv1a(const void* data, size_t len, uint32_t h = kFnvBasis) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+} // namespace
+
+void TimeLogSegment::reset() {
+    bytes_ = sizeof(SegmentHeader);
+    records_ = 0;
+    minTime_ = maxTime_ = 0;
+    streamMask_ = 0;
+    dataCheck_ = kFnvBasis;
+    lastIndexOffset_ = 0;
+    indexCount_ = 0;
+}
+
+bool TimeLogSegment::accepts(uint32_t time, size_t recordBytes) const {
+    return records_ == 0 || (time >= maxTime_ && bytes_ + recordBytes + kTrailerReserve <= TIME_LOG_SEGMENT_BYTES);
+}
+
+void TimeLogSegment::add(const uint8_t* record, size_t recordBytes) {
+    RecordHeader hdr;
+    memcpy(&hdr, record, sizeof(hdr));
+    if (records_ == 0 || (bytes_ - lastIndexOffset_ >= TIME_LOG_INDEX_STRIDE && indexCount_ < TIME_LOG_MAX_INDEX)) {
+        index_[indexCount_++] = IndexEntry{hdr.time, bytes_};
+        lastIndexOffset_ = bytes_;
+    }
+    if (records_ == 0) {
+        minTime_ = hdr.time;
+    }
+    maxTime_ = hdr.time;
+    records_++;
+    streamMask_ |= static_cast<uint16_t>(1U << (hdr.stream & 0x0F));
+    dataCheck_ = fnv1a(record, recordBytes, dataCheck_);
+    bytes_ += recordBytes;
+}
+
+bool TimeLogSegment::writeHeader(File& f, uint32_t seq, bool compacted, bool preallocated) {
+    SegmentHeader hdr{};
+    hdr.magic = kSegmentMagic;
+    hdr.version = kVersion;
+    hdr.flags = (compacted ? kFlagCompacted : 0) | (preallocated ? kFlagPreallocated : 0);
+    hdr.seq = seq;
+    hdr.length = sizeof(hdr);
+    return f.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr);
+}
+
+bool TimeLogSegment::writeLength(File& f, uint32_t length) {
+    // The records are written first: seeking away puts their sector on the card
+    // before the header sector that commits them
+    return f.seek(offsetof(SegmentHeader, length)) &&
+           f.write(reinterpret_cast<const uint8_t*>(&length), sizeof(length)) == sizeof(length) && f.seek(length);
+}
+
+bool TimeLogSegment::writeTrailer(File& f) const {
+    SegmentFooter footer{};
+    footer.magic = kFooterMagic;
+    footer.indexOffset = bytes_;
+    footer.indexCount = indexCount_;
+    footer.streamMask = streamMask_;
+    footer.recordCount = records_;
+    footer.minTime = minTime_;
+    footer.maxTime = maxTime_;
+    footer.dataCheck = dataCheck_;
+    const size_t indexBytes = indexCount_ * sizeof(IndexEntry);
+    footer.check = fnv1a(&footer, offsetof(SegmentFooter, check), fnv1a(index_, indexBytes));
+    return f.write(reinterpret_cast<const uint8_t*>(index_), indexBytes) == indexBytes &&
+           f.write(reinterpret_cast<const uint8_t*>(&footer), sizeof(footer)) == sizeof(footer);
+}
+
+TimeLog::TimeLog()
+    : dirReady_(false), lastProbeMs_(0), open_(false), sealPending_(false), maxSegments_(TIME_LOG_MAX_SEGMENTS),
+      pinnedSeq_(0), loSeq_(0), seq_(0), firstBufferedMs_(0), used_(0) {}
+
+void TimeLog::segmentPath(uint32_t seq, char* out, size_t outSize) const {
+    snprintf(out, outSize, TIME_LOG_DIR "/%08lu.tlg", static_cast<unsigned long>(seq));
+}
+
+size_t TimeLog::encodeRecord(uint8_t* out, size_t outSize, uint8_t stream, uint32_t time, const void* data,
+                             size_t len) {
+    if (!out || len > 0xFFFF || sizeof(RecordHeader) + len > outSize) {
+        return 0;
+    }
+    RecordHeader hdr{};
+    hdr.magic = kRecordMagic;
+    hdr.stream = stream;
+    hdr.length = static_cast<uint16_t>(len);
+    hdr.time = time;
+    memcpy(out, &hdr, sizeof(hdr));
+    memmove(out + sizeof(hdr), data, len);
+    return sizeof(hdr) + len;
+}
+
+bool TimeLog::append(uint8_t stream, uint32_t time, const void* data, size_t len) {
+    if (!data || len == 0 || sealPending_) {
+        return false;
+    }
+    const size_t recordBytes = sizeof(RecordHeader) + len;
+    if (recordBytes > sizeof(buf_) - used_) {
+        return false;
+    }
+    if (!seg_.accepts(time, recordBytes)) {
+        // Clock stepped back or segment full: start a new one before taking this record
+        sealPending_ = true;
+        return false;
+    }
+    encodeRecord(buf_ + used_, sizeof(buf_) - used_, stream, time, data, len);
+    seg_.add(buf_ + used_, recordBytes);
+    used_ += recordBytes;
+    if (firstBufferedMs_ == 0) {
+        firstBufferedMs_ = millis() | 1;
+    }
+    return true;
+}
+
+uint32_t TimeLog::msUntilFlush(uint32_t nowMs, uint32_t maxDelayMs) const {
+    if (used_ == 0 && !sealPending_) {
+        return UINT32_MAX;
+    }
+    if (!dirReady_ && lastProbeMs_ != 0 && nowMs - lastProbeMs_ < STORAGE_REOPEN_RETRY_MS) {
+        return STORAGE_REOPEN_RETRY_MS - (nowMs - lastProbeMs_);
+    }
+    if (sealPending_ || used_ >= sizeof(buf_) / 2) {
+        return 0;
+    }
+    const uint32_t age = nowMs - firstBufferedMs_;
+    return age >= maxDelayMs ? 0 : maxDelayMs - age;
+}
+
+bool TimeLog::ensureDir(uint32_t nowMs) {
+    if (dirReady_) {
+        return true;
+    }
+    if (lastProbeMs_ != 0 && nowMs - lastProbeMs_ < STORAGE_REOPEN_RETRY_MS) {
+        return false;
+    }
+    lastProbeMs_ = nowMs | 1;
+    if (SD.cardType() == CARD_NONE || (!SD.exists(TIME_LOG_DIR) && !SD.mkdir(TIME_LOG_DIR))) {
+        return false;
+    }
+
+    // Segment names only; never append to a segment that may end in a torn record
+    bool any = false;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    uint32_t staleSeq = 0;   // at most one compaction runs, so at most one .tmp
+    File dir = SD.open(TIME_LOG_DIR);
+    if (dir) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            const char* name = entry.name();
+            const char* base = strrchr(name, '/');
+            base = base ? base + 1 : name;
+            char* end = nullptr;
+            const unsigned long seq = strtoul(base, &end, 10);
+            if (end && end != base && strcmp(end, ".tlg") == 0) {
+                if (!any || seq < lo) lo = seq;
+                if (!any || seq > hi) hi = seq;
+                any = true;
+            } else if (end && end != base && strcmp(end, ".tmp") == 0) {
+                staleSeq = seq;
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+    if (staleSeq != 0) {
+        // Compaction cut short: drop the partial rollup, or finish the swap when
+        // the original was already removed
+        char path[40];
+        char tmp[40];
+        segmentPath(staleSeq, path, sizeof(path));
+        snprintf(tmp, sizeof(tmp), TIME_LOG_DIR "/%08lu.tmp", static_cast<unsigned long>(staleSeq));
+        if (SD.exists(path)) {
+            SD.remove(tmp);
+        } else if (SD.rename(tmp, path)) {
+            if (!any || staleSeq < lo) lo = staleSeq;
+            if (!any || staleSeq > hi) hi = staleSeq;
+            any = true;
+        }
+    }
+    loSeq_ = any ? lo : 1;
+    seq_ = any ? hi + 1 : 1;
+    dirReady_ = true;
+    logbuf_printf("tlog: segments %lu..%lu", static_cast<unsigned long>(loSeq_), static_cast<unsigned long>(seq_));
+    return true;
+}
+
+bool TimeLog::openSegment() {
+    char path[40];
+    while (seq_ - loSeq_ >= maxSegments_ && loSeq_ != pinnedSeq_) {
+        segmentPath(loSeq_, path, sizeof(path));
+        SD.remove(path);
+        loSeq_++;
+    }
+    segmentPath(seq_, path, sizeof(path));
+    file_ = SD.open(path, "w");
+    if (!file_) {
+        return false;
+    }
+    bool ok = TimeLogSegment::writeHeader(file_, seq_, false, TIME_LOG_PREALLOCATE);
+#if TIME_LOG_PREALLOCATE
+    // Writing the last byte allocates the whole cluster chain now; flushes then
+    // only overwrite sectors the file already owns
+    const uint8_t zero = 0;
+    ok = ok && file_.seek(TIME_LOG_SEGMENT_BYTES - 1) && file_.write(&zero, 1) == 1 &&
+         TimeLogSegment::writeLength(file_, sizeof(SegmentHeader));
+    if (ok) {
+        file_.flush();
+    }
+#endif
+    if (!ok) {
+        file_.close();
+        SD.remove(path);
+        return false;
+    }
+    open_ = true;
+    return true;
+}
+
+bool TimeLog::sealSegment() {
+    bool ok = seg_.writeTrailer(file_);
+#if TIME_LOG_PREALLOCATE
+    ok = ok && TimeLogSegment::writeLength(file_, seg_.bytes() + seg_.trailerBytes());
+#endif
+    file_.close();
+    open_ = false;
+    seq_++;
+    restartFromBuffer();
+    return ok;
+}
+
+// Segment state for a fresh segment holding only the buffered records
+void TimeLog::restartFromBuffer() {
+    seg_.reset();
+    sealPending_ = false;
+    size_t off = 0;
+    while (off + sizeof(RecordHeader) <= used_) {
+        RecordHeader hdr;
+        memcpy(&hdr, buf_ + off, sizeof(hdr));
+        seg_.add(buf_ + off, sizeof(hdr) + hdr.length);
+        off += sizeof(hdr) + hdr.length;
+    }
+}
+
+bool TimeLog::flush(uint32_t nowMs) {
+    if (used_ == 0 && !sealPending_) {
+        return true;
+    }
+    if (!ensureDir(nowMs)) {
+        return false;
+    }
+    if (used_ > 0) {
+        if (!open_ && !openSegment()) {
+            dirReady_ = false;   // card gone or full; re-probe after the retry interval
+            return false;
+        }
+        bool written = file_.write(buf_, used_) == used_;
+#if TIME_LOG_PREALLOCATE
+        written = written && TimeLogSegment::writeLength(file_, seg_.bytes());
+#endif
+        if (!written) {
+            // The segment may now end in a partial record; it stays unsealed and the
+            // buffered records go into the next one
+            file_.close();
+            open_ = false;
+            seq_++;
+            restartFromBuffer();
+            dirReady_ = false;
+            return false;
+        }
+        used_ = 0;
+        firstBufferedMs_ = 0;
+        file_.flush();
+    }
+    if (sealPending_ && open_) {
+        sealSegment();
+    } else if (sealPending_) {
+        sealPending_ = false;   // nothing written since the last seal
+    }
+    return true;
+}
+
+bool TimeLog::readInfo(File& f, TimeLogSegmentInfo& out) {
+    memset(&out, 0, sizeof(out));
+    uint32_t size = static_cast<uint32_t>(f.size());
+    SegmentHeader hdr{};
+    if (size < sizeof(hdr) || !f.seek(0) || f.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) != sizeof(hdr) ||
+        hdr.magic != kSegmentMagic) {
+        return false;
+    }
+    if (hdr.flags & kFlagPreallocated) {
+        // Past the committed length is whatever the clusters held before
+        size = hdr.length >= sizeof(hdr) && hdr.length <= size ? hdr.length : sizeof(hdr);
+    }
+    out.compacted = (hdr.flags & kFlagCompacted) != 0;
+    out.length = size;
+    out.recordEnd = size;
+
+    SegmentFooter footer{};
+    if (size < sizeof(hdr) + sizeof(footer) || !f.seek(size - sizeof(footer)) ||
+        f.read(reinterpret_cast<uint8_t*>(&footer), sizeof(footer)) != sizeof(footer) ||
+        footer.magic != kFooterMagic ||
+        footer.indexOffset + footer.indexCount * 8UL + sizeof(footer) != size || !f.seek(footer.indexOffset)) {
+        return true;
+    }
+    uint32_t check = kFnvBasis;
+    for (uint16_t i = 0; i < footer.indexCount; i++) {
+        uint8_t entry[8];
+        if (f.read(entry, sizeof(entry)) != sizeof(entry)) {
+            return true;
+        }
+        check = fnv1a(entry, sizeof(entry), check);
+    }
+    if (fnv1a(&footer, offsetof(SegmentFooter, check), check) != footer.check) {
+        return true;   // index untrusted: treat as unsealed
+    }
+    out.sealed = true;
+    out.recordEnd = footer.indexOffset;
+    out.records = footer.recordCount;
+    out.minTime = footer.minTime;
+    out.maxTime = footer.maxTime;
+    out.streamMask = footer.streamMask;
+    return true;
+}
+
+bool TimeLog::readRecord(File& f, uint32_t& off, uint32_t end, uint8_t& stream, uint32_t& time, uint8_t* scratch,
+                         size_t scratchSize, size_t& len) {
+    RecordHeader rec{};
+    if (off + sizeof(rec) > end || !f.seek(off) ||
+        f.read(reinterpret_cast<uint8_t*>(&rec), sizeof(rec)) != sizeof(rec) || rec.magic != kRecordMagic ||
+        off + sizeof(rec) + rec.length > end || rec.length > scratchSize ||
+        f.read(scratch, rec.length) != rec.length) {
+        return false;
+    }
+    off += sizeof(rec) + rec.length;
+    stream = rec.stream;
+    time = rec.time;
+    len = rec.length;
+    return true;
+}
+
+size_t TimeLog::scanSegment(uint32_t seq, uint8_t stream, uint32_t t0, uint32_t t1, uint8_t* scratch,
+                            size_t scratchSize, TimeLogRecordFn fn, void* ctx, bool& stop) const {
+    char path[40];
+    segmentPath(seq, path, sizeof(path));
+    File f = SD.open(path, "r");
+    if (!f) {
+        return 0;
+    }
+    TimeLogSegmentInfo info;
+    if (!readInfo(f, info) ||
+        (info.sealed && (info.maxTime < t0 || info.minTime > t1 ||
+                         (stream != TIME_LOG_ANY_STREAM && !(info.streamMask & (1U << (stream & 0x0F))))))) {
+        f.close();
+        return 0;
+    }
+
+    // Sealed: enter through the last index entry at or before t0
+    uint32_t off = sizeof(SegmentHeader);
+    if (info.sealed && f.seek(info.recordEnd)) {
+        const uint32_t entries = (info.length - info.recordEnd - sizeof(SegmentFooter)) / 8;
+        for (uint32_t i = 0; i < entries; i++) {
+            uint32_t entry[2];
+            if (f.read(reinterpret_cast<uint8_t*>(entry), sizeof(entry)) != sizeof(entry) || entry[0] > t0) {
+                break;
+            }
+            off = entry[1];
+        }
+    }
+
+    size_t delivered = 0;
+    while (off + sizeof(RecordHeader) <= info.recordEnd && f.seek(off)) {
+        RecordHeader rec{};
+        if (f.read(reinterpret_cast<uint8_t*>(&rec), sizeof(rec)) != sizeof(rec) || rec.magic != kRecordMagic ||
+            off + sizeof(rec) + rec.length > info.recordEnd) {
+            break;  // torn tail of an unsealed segment
+        }
+        if (rec.time > t1) {
+            break;
+        }
+        if (rec.time >= t0 && (stream == TIME_LOG_ANY_STREAM || (rec.stream & ~TIME_LOG_ROLLUP_FLAG) == stream) &&
+            rec.length <= scratchSize) {
+            if (f.read(scratch, rec.length) != rec.length) {
+                break;
+            }
+            delivered++;
+            if (!fn(rec.stream, rec.time, scratch, rec.length, ctx)) {
+                stop = true;
+                break;
+            }
+        }
+        off += sizeof(rec) + rec.length;
+    }
+    f.close();
+    return delivered;
+}
+
+size_t TimeLog::query(uint8_t stream, uint32_t t0, uint32_t t1, uint8_t* scratch, size_t scratchSize,
+                      TimeLogRecordFn fn, void* ctx) const {
+    if (!fn || !scratch || t1 < t0 || !g_sdMutex || seq_ == 0) {
+        return 0;
+    }
+    size_t delivered = 0;
+    bool stop = false;
+    const uint32_t last = seq_;
+    for (uint32_t seq = loSeq_; seq <= last && !stop; seq++) {
+        if (xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(kQueryLockMs)) != pdTRUE) {
+            break;
+        }
+        delivered += scanSegment(seq, stream, t0, t1, scratch, scratchSize, fn, ctx, stop);
+        xSemaphoreGive(g_sdMutex);
+    }
+    return delivered;
+}
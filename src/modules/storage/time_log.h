@@ -0,0 +1,178 @@
+/*
+ * Binary Time-Indexed Log
+ * Segmented on-SD record log that answers "stream X between t0 and t1"
+ * without parsing record payloads.
+ *
+ * Segment file TIME_LOG_DIR/<seq>.tlg (little endian):
+ *   header   16 bytes  magic "TLG1", version, flags, segment sequence,
+ *                      committed length
+ *   records  [0xD5][stream u8][length u16][time u32][payload]...
+ *   index    (time u32, offset u32) for the first record past every
+ *            TIME_LOG_INDEX_STRIDE bytes
+ *   footer   32 bytes  index position/count, record count, stream mask,
+ *            time range, checksum of all record bytes, checksum of
+ *            index + footer
+ *
+ * Times are seconds from time(); within one segment they never go backwards
+ * (a clock step back seals the segment), so a sealed segment is searched
+ * through its index and skipped entirely by its time range. The segment being
+ * written, or one cut short by a power loss, has no footer yet and is scanned
+ * from its header; a torn record at its end stops the scan.
+ *
+ * With TIME_LOG_PREALLOCATE a segment is created at its full size, so the FAT
+ * work is done once when it opens rather than a cluster at a time on flushes
+ * under g_sdMutex. The file size then says nothing about the content: the
+ * header's committed length, rewritten after every flush, is where the records
+ * (or, once sealed, the footer) end. Segments without the preallocated flag,
+ * such as the compactor's, end at the file size.
+ */
+
+#ifndef TIME_LOG_H
+#define TIME_LOG_H
+
+#include <Arduino.h>
+#include <SD.h>
+
+#ifndef TIME_LOG_ENABLE
+#define TIME_LOG_ENABLE 1
+#endif
+#ifndef TIME_LOG_DIR
+#define TIME_LOG_DIR "/tlog"
+#endif
+#ifndef TIME_LOG_SEGMENT_BYTES
+#define TIME_LOG_SEGMENT_BYTES (256UL * 1024UL)
+#endif
+#ifndef TIME_LOG_MAX_SEGMENTS
+#define TIME_LOG_MAX_SEGMENTS 4096              // hard cap (1 GB); the retention budget lowers it
+#endif
+#ifndef TIME_LOG_PREALLOCATE
+#define TIME_LOG_PREALLOCATE 1                  // segments created at TIME_LOG_SEGMENT_BYTES
+#endif
+#ifndef TIME_LOG_BUFFER_BYTES
+#define TIME_LOG_BUFFER_BYTES 1024              // RAM write-behind
+#endif
+
+#define TIME_LOG_INDEX_STRIDE 4096
+#define TIME_LOG_MAX_INDEX    (TIME_LOG_SEGMENT_BYTES / TIME_LOG_INDEX_STRIDE + 1)
+#define TIME_LOG_ANY_STREAM   0xFF
+#define TIME_LOG_ROLLUP_FLAG  0x80              // stream bit of a compacted rollup record
+#define TIME_LOG_HEADER_BYTES 16                // segment header; the first record follows
+#define TIME_LOG_RECORD_HEADER_BYTES 8
+
+// Return false to stop the query. stream carries TIME_LOG_ROLLUP_FLAG for rollups.
+typedef bool (*TimeLogRecordFn)(uint8_t stream, uint32_t time, const uint8_t* data, size_t len, void* ctx);
+
+struct TimeLogSegmentInfo {
+    bool sealed;
+    bool compacted;
+    uint32_t length;             // committed bytes: header length or file size
+    uint32_t recordEnd;          // end of the record area (length when unsealed)
+    uint32_t records;            // sealed only
+    uint32_t minTime;            // sealed only
+    uint32_t maxTime;            // sealed only
+    uint16_t streamMask;         // sealed only
+};
+
+// Index and footer bookkeeping for one segment written front to back
+class TimeLogSegment {
+public:
+    TimeLogSegment() { reset(); }
+    void reset();
+
+    // False when time would go backwards or the record leaves no room for the trailer
+    bool accepts(uint32_t time, size_t recordBytes) const;
+    // An encoded record (header + payload) placed at offset bytes()
+    void add(const uint8_t* record, size_t recordBytes);
+
+    static bool writeHeader(File& f, uint32_t seq, bool compacted, bool preallocated = false);
+    // Preallocated segments: records up to length are committed; leaves f at length
+    static bool writeLength(File& f, uint32_t length);
+    bool writeTrailer(File& f) const;
+
+    uint32_t bytes() const { return bytes_; }
+    uint32_t records() const { return records_; }
+    uint32_t trailerBytes() const { return indexCount_ * 8UL + 32; }   // index + footer
+
+private:
+    struct IndexEntry {
+        uint32_t time;
+        uint32_t offset;
+    };
+
+    uint32_t bytes_;             // header included
+    uint32_t records_;
+    uint32_t minTime_;
+    uint32_t maxTime_;
+    uint16_t streamMask_;
+    uint32_t dataCheck_;
+    uint32_t lastIndexOffset_;
+    uint16_t indexCount_;
+    IndexEntry index_[TIME_LOG_MAX_INDEX];
+};
+
+class TimeLog {
+public:
+    TimeLog();
+
+    // Writer side: a single task, the storage task. append() only copies into RAM
+    // and returns false when the buffer (or the segment) needs a flush() first.
+    bool append(uint8_t stream, uint32_t time, const void* data, size_t len);
+    // 0 when flush() should run now; UINT32_MAX when nothing is buffered
+    uint32_t msUntilFlush(uint32_t nowMs, uint32_t maxDelayMs) const;
+    // Caller holds g_sdMutex. Writes the buffer, sealing and rolling the segment when due.
+    bool flush(uint32_t nowMs);
+    size_t pendingBytes() const { return used_; }
+
+    // Reader side, any task. Calls fn for each record of stream (or TIME_LOG_ANY_STREAM)
+    // with t0 <= time <= t1, oldest segment first; fn must not touch the card. scratch
+    // must hold the largest payload. Takes g_sdMutex one segment at a time. Returns the
+    // number of records delivered.
+    size_t query(uint8_t stream, uint32_t t0, uint32_t t1, uint8_t* scratch, size_t scratchSize,
+                 TimeLogRecordFn fn, void* ctx) const;
+
+    // Retention: oldest segments are removed beyond this many, except a pinned one
+    // (the compactor's), which holds removal back until it is unpinned with 0.
+    // Caller holds g_sdMutex for setPinned.
+    void setMaxSegments(uint32_t n) { maxSegments_ = n ? n : 1; }
+    void setPinned(uint32_t seq) { pinnedSeq_ = seq; }
+    uint32_t oldestSegment() const { return loSeq_; }
+    uint32_t newestSegment() const { return seq_; }
+    bool ready() const { return seq_ != 0; }
+    void segmentPath(uint32_t seq, char* out, size_t outSize) const;
+
+    // Encodes header + payload into out; returns the record size or 0 if out is too small
+    static size_t encodeRecord(uint8_t* out, size_t outSize, uint8_t stream, uint32_t time, const void* data,
+                               size_t len);
+    // Reads the header and, when present and intact, the footer of an open segment
+    static bool readInfo(File& f, TimeLogSegmentInfo& out);
+    // Reads the record at off (advanced past it) with its payload into scratch; false at
+    // end or on a torn or oversized record
+    static bool readRecord(File& f, uint32_t& off, uint32_t end, uint8_t& stream, uint32_t& time,
+                           uint8_t* scratch, size_t scratchSize, size_t& len);
+
+private:
+    bool ensureDir(uint32_t nowMs);
+    bool openSegment();
+    bool sealSegment();
+    void restartFromBuffer();
+    size_t scanSegment(uint32_t seq, uint8_t stream, uint32_t t0, uint32_t t1, uint8_t* scratch,
+                       size_t scratchSize, TimeLogRecordFn fn, void* ctx, bool& stop) const;
+
+    bool dirReady_;
+    uint32_t lastProbeMs_;
+    File file_;
+    bool open_;
+    bool sealPending_;
+    uint32_t maxSegments_;
+    uint32_t pinnedSeq_;
+    uint32_t loSeq_;
+    uint32_t seq_;
+    TimeLogSegment seg_;          // covers the buffered records too
+    uint32_t firstBufferedMs_;
+    size_t used_;
+    uint8_t buf_[TIME_LOG_BUFFER_BYTES];
+};
+
+extern TimeLog g_timeLog;
+
+#endif // TIME_LOG_H
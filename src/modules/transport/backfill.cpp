@@ -0,0 +1,326 @@
+/*
+ * Link-Recovery Backfill Implementation
+ */
+
+#include "backfill.h"
+
+#if BACKFILL_ENABLE && TIME_LOG_ENABLE
+
+#include "live_config.h"
+#include "../logging/log_buffer.h"
+#include "../storage/storage_task.h"
+#include "../../../include/transport.h"
+#include "../../system/json_writer.h"
+#include "../../system/load_shed.h"
+#include "../../system/metrics.h"
+#include "../../system/work_queue.h"
+#include <Preferences.h>
+#include <atomic>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+namespace {
+constexpr const char* kNamespace = "backfill";
+constexpr const char* kKey = "state";
+constexpr uint32_t kMagic = 0x31464B42;              // "BKF1"
+constexpr uint32_t kClockValidAfter = 1600000000UL;  // time() before this is not wall time
+constexpr size_t kRecordOverhead = 48;               // {"ts":...,"values":{"gnss":...}}
+
+struct Gap {
+    uint32_t start;
+    uint32_t end;                // 0 while open
+};
+
+// Persisted; gaps[0] is the oldest, only the newest may be open
+struct State {
+    uint32_t magic;
+    uint8_t count;
+    uint8_t reserved;
+    uint16_t cursorSkip;         // records at cursorTime already queued
+    uint32_t cursorTime;         // watermark in gaps[0]
+    Gap gaps[BACKFILL_MAX_GAPS];
+    uint32_t crc;                // CRC-32 of everything above
+};
+
+enum class Job : uint8_t { Idle = 0, Running, Done };
+
+// Handed to the worker at submit and back with the result
+struct Batch {
+    uint32_t t0;
+    uint16_t skip;
+    uint32_t t1;
+    uint32_t budget;
+    uint16_t seenAtT0;
+    uint32_t lastTime;
+    uint16_t lastSkip;
+    uint16_t records;
+    uint32_t bytes;
+    bool stopped;                // cut short; the gap is not finished
+    bool refused;
+};
+
+const char* const kStreamNames[] = {"gnss", "cell", "system", "analog"};
+
+State s_state = {};
+bool s_loaded = false;
+bool s_dirty = false;
+uint32_t s_savedMs = 0;
+uint32_t s_lastJobMs = 0;
+BackfillStats s_stats = {};
+MetricCounter s_metricRecords("backfill.records", [] { return s_stats.records; });
+
+// Budget
+std::atomic<uint32_t> s_bytesPerHour{BACKFILL_BYTES_PER_HOUR};
+// Holds a quarter hour at most, so a long outage does not bank a burst for the reconnect
+uint64_t s_budgetMilli = 0;
+uint32_t s_lastRefillMs = 0;
+
+std::atomic<uint8_t> s_job{(uint8_t)Job::Idle};
+Batch s_batch = {};
+uint8_t s_scratch[STORAGE_MAX_LINE_BYTES];
+char s_record[STORAGE_MAX_LINE_BYTES + kRecordOverhead];
+
+uint32_t stateCrc(const State& s) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&s), offsetof(State, crc));
+}
+
+void load() {
+    s_loaded = true;
+    Preferences p;
+    if (!p.begin(kNamespace, true)) return;
+    State st{};
+    if (p.getBytes(kKey, &st, sizeof(st)) == sizeof(st) && st.magic == kMagic && st.crc == stateCrc(st) &&
+        st.count <= BACKFILL_MAX_GAPS) {
+        s_state = st;
+    }
+    p.end();
+}
+
+void save(uint32_t now) {
+    s_state.magic = kMagic;
+    s_state.crc = stateCrc(s_state);
+    Preferences p;
+    if (p.begin(kNamespace, false)) {
+        p.putBytes(kKey, &s_state, sizeof(s_state));
+        p.end();
+    }
+    s_dirty = false;
+    s_savedMs = now;
+}
+
+bool clockValid(uint32_t t) {
+    return t >= kClockValidAfter;
+}
+
+bool newestOpen() {
+    return s_state.count > 0 && s_state.gaps[s_state.count - 1].end == 0;
+}
+
+uint8_t closedGaps() {
+    return s_state.count - (newestOpen() ? 1 : 0);
+}
+
+void popGap() {
+    memmove(&s_state.gaps[0], &s_state.gaps[1], (s_state.count - 1) * sizeof(Gap));
+    s_state.count--;
+    s_state.cursorTime = s_state.count ? s_state.gaps[0].start : 0;
+    s_state.cursorSkip = 0;
+    s_stats.gapsDone++;
+}
+
+void refill(uint32_t now) {
+    const uint64_t rate = s_bytesPerHour.load(std::memory_order_relaxed);
+    const uint64_t cap = rate * 1000ULL / 4;
+    s_budgetMilli += (uint64_t)(now - s_lastRefillMs) * rate / 3600ULL;
+    if (s_budgetMilli > cap) s_budgetMilli = cap;
+    s_lastRefillMs = now;
+}
+
+// Worker: one record of the gap; false stops the query
+bool onRecord(uint8_t stream, uint32_t time, const uint8_t* data, size_t len, void* ctx) {
+    Batch& b = *static_cast<Batch*>(ctx);
+    if ((stream & TIME_LOG_ROLLUP_FLAG) || stream >= 8 || !(BACKFILL_STREAMS & (1u << stream))) return true;
+    if (stream >= sizeof(kStreamNames) / sizeof(kStreamNames[0])) return true;
+    if (time == b.t0 && b.seenAtT0 < b.skip) {
+        b.seenAtT0++;
+        return true;
+    }
+    if (b.records >= BACKFILL_BATCH_RECORDS || b.bytes + len > b.budget ||
+        transport_pendingBytes() >= BACKFILL_MAX_PENDING_BYTES) {
+        b.stopped = true;
+        return false;
+    }
+
+    // Only JSON object lines go up; anything else is passed over
+    const char* line = reinterpret_cast<const char*>(data);
+    if (len >= 2 && line[0] == '{' && line[len - 1] == '}') {
+        JsonWriter w(s_record, sizeof(s_record));
+        w.beginObject()
+            .field("ts", (unsigned long long)time * 1000ULL)
+            .beginObject("values")
+            .fieldRaw(kStreamNames[stream], line, len)
+            .endObject()
+            .endObject();
+        TransportReservation slot;
+        if (!w.ok() || !transport_reserve(TransportPacketKind::Telemetry, w.length(), slot)) {
+            b.stopped = true;
+            b.refused = true;
+            return false;
+        }
+        slot.priority = TransportPriority::Backfill;
+        memcpy(slot.data, w.data(), w.length());
+        if (!transport_commit(slot, w.length())) {
+            b.stopped = true;
+            b.refused = true;
+            return false;
+        }
+        b.records++;
+        b.bytes += len;
+    }
+    if (time == b.lastTime) {
+        b.lastSkip++;
+    } else {
+        b.lastTime = time;
+        b.lastSkip = 1;
+    }
+    return true;
+}
+
+void backfillJob(void*) {
+    Batch& b = s_batch;
+    g_timeLog.query(TIME_LOG_ANY_STREAM, b.t0, b.t1, s_scratch, sizeof(s_scratch), onRecord, &b);
+    s_job.store((uint8_t)Job::Done, std::memory_order_release);
+}
+
+// CatM task: takes the finished job's watermark
+void collect(uint32_t now) {
+    const Batch& b = s_batch;
+    s_stats.records += b.records;
+    s_stats.bytes += b.bytes;
+    if (b.refused) s_stats.refused++;
+    const uint64_t spent = (uint64_t)b.bytes * 1000ULL;
+    s_budgetMilli = s_budgetMilli > spent ? s_budgetMilli - spent : 0;
+    if (s_state.count == 0) return;
+    if (!b.stopped) {
+        logbuf_printf("backfill: gap %lu..%lu done", (unsigned long)s_state.gaps[0].start,
+                      (unsigned long)s_state.gaps[0].end);
+        popGap();
+        save(now);
+        return;
+    }
+    if (b.lastTime != s_state.cursorTime || b.lastSkip != s_state.cursorSkip) {
+        s_state.cursorTime = b.lastTime;
+        s_state.cursorSkip = b.lastSkip;
+        s_dirty = true;
+    }
+}
+} // namespace
+
+void backfill_begin() {
+    if (!s_loaded) load();
+    s_lastRefillMs = millis();
+    live_config_register("backfill_bytes_h", LiveConfigType::Int, 0, 1048576,
+                         [](const LiveConfigValue& v, void*) -> bool {
+        s_bytesPerHour.store(v.present ? (uint32_t)v.number : BACKFILL_BYTES_PER_HOUR, std::memory_order_relaxed);
+        return true;
+    }, nullptr);
+}
+
+void backfill_link(bool up) {
+    if (!s_loaded) load();
+    const uint32_t now = (uint32_t)time(nullptr);
+    if (!clockValid(now)) return;
+    const uint32_t ms = millis();
+
+    if (!up) {
+        if (newestOpen()) return;
+        if (s_state.count == BACKFILL_MAX_GAPS) {
+            // Reopen the newest: it now also covers the uptime in between, sent twice
+            s_state.gaps[s_state.count - 1].end = 0;
+        } else {
+            s_state.gaps[s_state.count++] = Gap{now, 0};
+            if (s_state.count == 1) {
+                s_state.cursorTime = now;
+                s_state.cursorSkip = 0;
+            }
+        }
+        save(ms);
+        return;
+    }
+
+    if (!newestOpen()) return;
+    Gap& g = s_state.gaps[s_state.count - 1];
+    if (now - g.start < BACKFILL_MIN_GAP_S && s_state.count > 1) {
+        s_state.count--;                   // short: the RAM queue covered it
+    } else if (now - g.start < BACKFILL_MIN_GAP_S) {
+        s_state.count = 0;
+        s_state.cursorTime = 0;
+        s_state.cursorSkip = 0;
+    } else {
+        g.end = now;
+        s_stats.gaps++;
+        logbuf_printf("backfill: link back after %lu s outage", (unsigned long)(now - g.start));
+    }
+    save(ms);
+}
+
+void backfill_poll(uint32_t now) {
+    if (!s_loaded) load();
+    refill(now);
+
+    if ((Job)s_job.load(std::memory_order_acquire) == Job::Done) {
+        collect(now);
+        s_job.store((uint8_t)Job::Idle, std::memory_order_release);
+    }
+    if (s_dirty && now - s_savedMs >= BACKFILL_SAVE_MS) save(now);
+
+    if ((Job)s_job.load(std::memory_order_acquire) != Job::Idle || closedGaps() == 0) return;
+    if (now - s_lastJobMs < BACKFILL_INTERVAL_MS || !g_timeLog.ready()) return;
+    // Shed: the batch in flight finishes, the next waits; the budget keeps accruing
+    if (load_shed_active(ShedStep::Backfill)) return;
+    const uint32_t budget = (uint32_t)(s_budgetMilli / 1000ULL);
+    if (budget < STORAGE_MAX_LINE_BYTES || transport_pendingBytes() >= BACKFILL_MAX_PENDING_BYTES) return;
+
+    const Gap& g = s_state.gaps[0];
+    Batch& b = s_batch;
+    b = Batch{};
+    b.t0 = s_state.cursorTime > g.start ? s_state.cursorTime : g.start;
+    b.skip = s_state.cursorTime > g.start ? s_state.cursorSkip : 0;
+    b.t1 = g.end;
+    b.budget = budget;
+    b.lastTime = b.t0;
+    b.lastSkip = b.skip;
+    s_lastJobMs = now;
+    s_job.store((uint8_t)Job::Running, std::memory_order_release);
+    if (work_submit("Backfill", backfillJob, nullptr, WorkPriority::Low, WORK_CORE_APP) == WORK_ID_NONE) {
+        s_job.store((uint8_t)Job::Idle, std::memory_order_release);
+        return;
+    }
+    s_stats.jobs++;
+}
+
+void backfill_stats(BackfillStats& out) {
+    out = s_stats;
+    out.pending = closedGaps();
+    out.open = newestOpen();
+    out.cursor = s_state.count ? s_state.cursorTime : 0;
+    out.gapEnd = s_state.count ? s_state.gaps[0].end : 0;
+}
+
+void backfill_report(Print& out) {
+    BackfillStats s;
+    backfill_stats(s);
+    if (!s.gaps && !s.pending && !s.open) return;
+    out.printf("Backfill: %u gaps pending%s, %lu done, %lu jobs, %lu records, %lu bytes, %lu refused, "
+               "%lu B/h budget\n",
+               (unsigned)s.pending, s.open ? " (outage now)" : "", (unsigned long)s.gapsDone,
+               (unsigned long)s.jobs, (unsigned long)s.records, (unsigned long)s.bytes, (unsigned long)s.refused,
+               (unsigned long)s_bytesPerHour.load(std::memory_order_relaxed));
+    if (s.pending) {
+        out.printf("  at %lu of ..%lu\n", (unsigned long)s.cursor, (unsigned long)s.gapEnd);
+    }
+}
+
+#endif // BACKFILL_ENABLE && TIME_LOG_ENABLE
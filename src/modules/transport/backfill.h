@@ -0,0 +1,91 @@
+/*
+ * Link-Recovery Backfill
+ * Uploads what the time log recorded while the link was down:
+ *   - an outage is a gap [down, up] in wall-clock seconds, opened when the link
+ *     drops and closed when it comes back. Gaps shorter than BACKFILL_MIN_GAP_S
+ *     are left to the RAM queue and the spill. Gaps and the upload watermark are
+ *     kept in NVS, so a reboot mid-outage or mid-backfill resumes where it was.
+ *   - records of BACKFILL_STREAMS in the oldest closed gap are read back by a
+ *     work queue job and queued as timestamped telemetry,
+ *     {"ts":<ms>,"values":{"gnss":{...}}}, in the transport's Backfill class: they
+ *     coalesce and compress like live records and go after anything live that
+ *     is due.
+ *   - a job only starts while the transport holds less than
+ *     BACKFILL_MAX_PENDING_BYTES, and stops at BACKFILL_BATCH_RECORDS records,
+ *     at that much queued, or when the byte budget is spent.
+ *   - the budget is BACKFILL_BYTES_PER_HOUR of record text, live-configurable as
+ *     backfill_bytes_h (0 pauses the backfill).
+ * Records are resent from the last saved watermark after a reboot; ThingsBoard
+ * keeps one value per key and timestamp, so a repeat overwrites itself.
+ */
+
+#ifndef BACKFILL_H
+#define BACKFILL_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+#include "../storage/time_log.h"
+
+#ifndef BACKFILL_BYTES_PER_HOUR
+#define BACKFILL_BYTES_PER_HOUR 65536UL
+#endif
+#ifndef BACKFILL_BATCH_RECORDS
+#define BACKFILL_BATCH_RECORDS 16
+#endif
+#ifndef BACKFILL_MAX_PENDING_BYTES
+#define BACKFILL_MAX_PENDING_BYTES 1536        // transport backlog that holds the next job back
+#endif
+#ifndef BACKFILL_INTERVAL_MS
+#define BACKFILL_INTERVAL_MS 5000UL            // between jobs
+#endif
+#ifndef BACKFILL_MIN_GAP_S
+#define BACKFILL_MIN_GAP_S 60
+#endif
+#ifndef BACKFILL_MAX_GAPS
+#define BACKFILL_MAX_GAPS 8                    // beyond this the newest two merge
+#endif
+#ifndef BACKFILL_SAVE_MS
+#define BACKFILL_SAVE_MS 60000UL               // watermark written to NVS at most this often
+#endif
+// Bit n selects StorageStreamId n; Gnss, Cell and Analog (System lines stay local)
+#ifndef BACKFILL_STREAMS
+#define BACKFILL_STREAMS 0x0B
+#endif
+
+struct BackfillStats {
+    uint32_t gaps;               // outages recorded
+    uint32_t gapsDone;
+    uint32_t jobs;
+    uint32_t records;            // queued on the transport
+    uint32_t bytes;              // record text queued
+    uint32_t refused;            // records the transport had no room for (retried)
+    uint8_t pending;             // closed gaps left
+    bool open;                   // outage in progress
+    uint32_t cursor;             // wall-clock second reached in the oldest gap
+    uint32_t gapEnd;
+};
+
+#if BACKFILL_ENABLE && TIME_LOG_ENABLE
+
+// CatM task, at start: registers the live-config key
+void backfill_begin();
+// CatM task, on every link transition
+void backfill_link(bool up);
+// CatM task, each service pass while connected: collects the finished job and
+// starts the next one when the link, the transport and the budget allow
+void backfill_poll(uint32_t now);
+
+void backfill_stats(BackfillStats& out);
+void backfill_report(Print& out);
+
+#else
+
+inline void backfill_begin() {}
+inline void backfill_link(bool) {}
+inline void backfill_poll(uint32_t) {}
+inline void backfill_stats(BackfillStats& out) { out = BackfillStats{}; }
+inline void backfill_report(Print&) {}
+
+#endif // BACKFILL_ENABLE && TIME_LOG_ENABLE
+
+#endif // BACKFILL_H
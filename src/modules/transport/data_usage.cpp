@@ -0,0 +1,205 @@
+#include "data_usage.h"
+#include "../../system/metrics.h"
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+namespace {
+constexpr uint32_t kMaxRateSteps = 32;       // beyond this an idle rate is ~0 anyway
+
+struct Rate {
+    uint32_t startMs;
+    uint32_t bytes;          // in the open window
+    uint32_t bps;
+};
+
+struct PathUsage {
+    DataUsageCounters counters;
+    Rate tx;
+    Rate rx;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+PathUsage s_paths[TRANSPORT_PATH_COUNT] = {};   // under s_mux
+uint64_t s_unaccountedTx = 0;
+uint64_t s_unaccountedRx = 0;
+uint64_t s_modemTx = 0;      // modem counters at the last reconcile
+uint64_t s_modemRx = 0;
+uint64_t s_markTx = 0;       // local cellular totals at the last reconcile
+uint64_t s_markRx = 0;
+bool s_marked = false;
+uint32_t s_reconciles = 0;
+uint32_t s_lastReconcileMs = 0;
+uint16_t s_accountedPermille = 1000;
+
+bool isCellular(size_t path) {
+    return path != static_cast<size_t>(TransportPathId::WifiUdp);
+}
+
+// Under s_mux. Closes the window once it is long enough: one averaging step
+// per window elapsed, towards the rate over all of them.
+void rollRate(Rate& r, uint32_t now) {
+    if (r.startMs == 0) {
+        r.startMs = now | 1;
+        return;
+    }
+    const uint32_t elapsed = now - r.startMs;
+    if (elapsed < DATA_USAGE_RATE_WINDOW_MS) return;
+    const uint32_t sample = static_cast<uint32_t>(static_cast<uint64_t>(r.bytes) * 1000ULL / elapsed);
+    uint32_t steps = elapsed / DATA_USAGE_RATE_WINDOW_MS;
+    if (steps > kMaxRateSteps) steps = kMaxRateSteps;
+    for (uint32_t i = 0; i < steps; i++) {
+        r.bps = static_cast<uint32_t>((static_cast<uint64_t>(r.bps) * (DATA_USAGE_EWMA_DIV - 1) + sample) /
+                                      DATA_USAGE_EWMA_DIV);
+    }
+    r.bytes = 0;
+    r.startMs = now | 1;
+}
+
+// Under s_mux
+void cellularTotals(uint64_t& tx, uint64_t& rx) {
+    tx = 0;
+    rx = 0;
+    for (size_t i = 0; i < TRANSPORT_PATH_COUNT; i++) {
+        if (!isCellular(i)) continue;
+        tx += s_paths[i].counters.txBytes;
+        rx += s_paths[i].counters.rxBytes;
+    }
+}
+
+uint32_t cellularKb(bool tx) {
+    DataUsageStats s;
+    data_usage_get(s);
+    return static_cast<uint32_t>((tx ? s.cellular.txBytes : s.cellular.rxBytes) >> 10);
+}
+
+// Cellular totals, unaccounted traffic included, in the metrics registry
+MetricCounter s_metricTx("net.tx_kb", [] { return cellularKb(true); });
+MetricCounter s_metricRx("net.rx_kb", [] { return cellularKb(false); });
+MetricGauge s_metricAccounted("net.accounted_pm", [] {
+    DataUsageStats s;
+    data_usage_get(s);
+    return static_cast<int32_t>(s.accountedPermille);
+});
+
+void record(TransportPathId path, size_t bytes, bool tx) {
+    const size_t i = static_cast<size_t>(path);
+    if (i >= TRANSPORT_PATH_COUNT || bytes == 0) return;
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&s_mux);
+    PathUsage& p = s_paths[i];
+    Rate& r = tx ? p.tx : p.rx;
+    rollRate(r, now);
+    r.bytes += static_cast<uint32_t>(bytes);
+    if (tx) {
+        p.counters.txBytes += bytes;
+        p.counters.txPackets++;
+    } else {
+        p.counters.rxBytes += bytes;
+        p.counters.rxPackets++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+} // namespace
+
+void data_usage_tx(TransportPathId path, size_t bytes) {
+    record(path, bytes, true);
+}
+
+void data_usage_rx(TransportPathId path, size_t bytes) {
+    record(path, bytes, false);
+}
+
+bool data_usage_reconcile_due(uint32_t now) {
+    portENTER_CRITICAL(&s_mux);
+    const bool due = s_lastReconcileMs == 0 || now - s_lastReconcileMs >= DATA_USAGE_RECONCILE_MS;
+    portEXIT_CRITICAL(&s_mux);
+    return due;
+}
+
+void data_usage_reconcile(uint64_t modemTx, uint64_t modemRx, uint32_t now) {
+    portENTER_CRITICAL(&s_mux);
+    uint64_t localTx = 0;
+    uint64_t localRx = 0;
+    cellularTotals(localTx, localRx);
+    if (s_marked) {
+        // A fresh PDP session restarts the modem counters
+        if (modemTx < s_modemTx || modemRx < s_modemRx) {
+            s_modemTx = 0;
+            s_modemRx = 0;
+        }
+        const uint64_t modemDelta = (modemTx - s_modemTx) + (modemRx - s_modemRx);
+        const uint64_t dTx = localTx - s_markTx;
+        const uint64_t dRx = localRx - s_markRx;
+        if (modemTx - s_modemTx > dTx) s_unaccountedTx += modemTx - s_modemTx - dTx;
+        if (modemRx - s_modemRx > dRx) s_unaccountedRx += modemRx - s_modemRx - dRx;
+        if (modemDelta > 0) {
+            const uint64_t permille = (dTx + dRx) * 1000ULL / modemDelta;
+            s_accountedPermille = static_cast<uint16_t>(permille > 0xFFFF ? 0xFFFF : permille);
+        }
+    }
+    s_modemTx = modemTx;
+    s_modemRx = modemRx;
+    s_markTx = localTx;
+    s_markRx = localRx;
+    s_marked = true;
+    s_reconciles++;
+    s_lastReconcileMs = now | 1;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void data_usage_session_reset() {
+    portENTER_CRITICAL(&s_mux);
+    cellularTotals(s_markTx, s_markRx);
+    s_modemTx = 0;
+    s_modemRx = 0;
+    s_marked = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void data_usage_get(DataUsageStats& out) {
+    memset(&out, 0, sizeof(out));
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < TRANSPORT_PATH_COUNT; i++) {
+        PathUsage& p = s_paths[i];
+        rollRate(p.tx, now);
+        rollRate(p.rx, now);
+        p.counters.txBps = p.tx.bps;
+        p.counters.rxBps = p.rx.bps;
+        out.paths[i] = p.counters;
+        if (!isCellular(i)) continue;
+        out.cellular.txBytes += p.counters.txBytes;
+        out.cellular.rxBytes += p.counters.rxBytes;
+        out.cellular.txPackets += p.counters.txPackets;
+        out.cellular.rxPackets += p.counters.rxPackets;
+        out.cellular.txBps += p.tx.bps;
+        out.cellular.rxBps += p.rx.bps;
+    }
+    out.cellular.txBytes += s_unaccountedTx;
+    out.cellular.rxBytes += s_unaccountedRx;
+    out.unaccountedTx = s_unaccountedTx;
+    out.unaccountedRx = s_unaccountedRx;
+    out.reconciles = s_reconciles;
+    out.lastReconcileMs = s_lastReconcileMs;
+    out.accountedPermille = s_accountedPermille;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void data_usage_report(Print& out) {
+    static const char* const kNames[TRANSPORT_PATH_COUNT] = {"modem-udp", "tinygsm-udp", "wifi-udp", "mqtt", "http"};
+    DataUsageStats s;
+    data_usage_get(s);
+    for (size_t i = 0; i < TRANSPORT_PATH_COUNT; i++) {
+        const DataUsageCounters& c = s.paths[i];
+        if (!c.txPackets && !c.rxPackets) continue;
+        out.printf("Data %-11s tx %llu B / %lu msgs (%lu B/s), rx %llu B / %lu msgs (%lu B/s)\n", kNames[i],
+                   (unsigned long long)c.txBytes, (unsigned long)c.txPackets, (unsigned long)c.txBps,
+                   (unsigned long long)c.rxBytes, (unsigned long)c.rxPackets, (unsigned long)c.rxBps);
+    }
+    out.printf("Data cellular tx %llu B, rx %llu B (unaccounted %llu/%llu B); local count %u.%u%% of modem, "
+               "%lu reconciles\n",
+               (unsigned long long)s.cellular.txBytes, (unsigned long long)s.cellular.rxBytes,
+               (unsigned long long)s.unaccountedTx, (unsigned long long)s.unaccountedRx,
+               (unsigned)(s.accountedPermille / 10), (unsigned)(s.accountedPermille % 10),
+               (unsigned long)s.reconciles);
+}
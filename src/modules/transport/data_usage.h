@@ -0,0 +1,77 @@
+/*
+ * Data Usage Accounting
+ * Bytes counted where they are sent and received (transport UDP paths, HTTP,
+ * MQTT), protocol overhead estimated per message, so data use and throughput
+ * are known without asking the modem.
+ *
+ * AT+NETDEVSTATUS is only read every DATA_USAGE_RECONCILE_MS. Whatever the
+ * modem counted over that interval beyond the local count (DNS, NTP, TCP/TLS
+ * handshakes, retransmissions) is carried as unaccounted traffic, so the
+ * cellular totals follow the modem's between readings.
+ *
+ * Rates are moving averages, one step of 1/DATA_USAGE_EWMA_DIV per
+ * DATA_USAGE_RATE_WINDOW_MS.
+ */
+
+#ifndef DATA_USAGE_H
+#define DATA_USAGE_H
+
+#include <Arduino.h>
+#include "transport.h"
+
+#ifndef DATA_USAGE_RECONCILE_MS
+#define DATA_USAGE_RECONCILE_MS 300000UL
+#endif
+#ifndef DATA_USAGE_RATE_WINDOW_MS
+#define DATA_USAGE_RATE_WINDOW_MS 1000UL
+#endif
+#ifndef DATA_USAGE_EWMA_DIV
+#define DATA_USAGE_EWMA_DIV 8
+#endif
+// Per-message overhead estimates: TCP/IP plus protocol headers
+#ifndef DATA_USAGE_HTTP_TX_OVERHEAD
+#define DATA_USAGE_HTTP_TX_OVERHEAD 400        // request line, headers, TLS record
+#endif
+#ifndef DATA_USAGE_HTTP_RX_OVERHEAD
+#define DATA_USAGE_HTTP_RX_OVERHEAD 300        // status line and headers
+#endif
+#ifndef DATA_USAGE_MQTT_OVERHEAD
+#define DATA_USAGE_MQTT_OVERHEAD 60            // PUBLISH fixed header, packet id, TCP/IP
+#endif
+#ifndef DATA_USAGE_MQTT_ACK_BYTES
+#define DATA_USAGE_MQTT_ACK_BYTES 44           // PUBACK with TCP/IP
+#endif
+
+struct DataUsageCounters {
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t txBps;          // bytes per second
+    uint32_t rxBps;
+};
+
+struct DataUsageStats {
+    DataUsageCounters paths[TRANSPORT_PATH_COUNT];   // indexed by TransportPathId, since boot
+    DataUsageCounters cellular;      // cellular paths plus unaccounted traffic
+    uint64_t unaccountedTx;          // modem counters beyond the local count
+    uint64_t unaccountedRx;
+    uint32_t reconciles;
+    uint32_t lastReconcileMs;        // 0 = not yet
+    uint16_t accountedPermille;      // local / modem bytes over the last interval, x1000
+};
+
+// Any task; bytes on the wire, overhead included
+void data_usage_tx(TransportPathId path, size_t bytes);
+void data_usage_rx(TransportPathId path, size_t bytes);
+
+bool data_usage_reconcile_due(uint32_t now);
+// Modem counters since PDP activation; counters lower than last time mean a new session
+void data_usage_reconcile(uint64_t modemTx, uint64_t modemRx, uint32_t now);
+// The PDP session ended; the next reconcile counts the modem from zero
+void data_usage_session_reset();
+
+void data_usage_get(DataUsageStats& out);
+void data_usage_report(Print& out);
+
+#endif // DATA_USAGE_H
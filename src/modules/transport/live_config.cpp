@@ -0,0 +1,184 @@
+/*
+ * Live Configuration Implementation
+ */
+
+#include "live_config.h"
+#include "shared_attributes.h"
+#include "../logging/log_buffer.h"
+#include "../../system/metrics.h"
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+
+namespace {
+struct Key {
+    const char* name;
+    LiveConfigType type;
+    int32_t min;
+    int32_t max;
+    LiveConfigApply fn;
+    void* ctx;
+    // Writer (CatM task) only: the value last applied
+    bool set;
+    int32_t number;
+    bool flag;
+    char text[LIVE_CONFIG_STRING_LEN];
+    uint32_t applied;
+    uint32_t rejected;
+};
+
+Key s_keys[LIVE_CONFIG_MAX_KEYS] = {};
+std::atomic<uint8_t> s_count{0};
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+LiveConfigStats s_stats = {};
+
+MetricCounter s_metricApplied("config.applied", [] { return s_stats.applied; });
+MetricCounter s_metricRejected("config.rejected", [] { return s_stats.rejected; });
+
+void reject(Key& k, const char* why) {
+    k.rejected++;
+    s_stats.rejected++;
+    logbuf_printf("config: %s rejected (%s)", k.name, why);
+}
+
+// Validates v against the key; fills out and tells whether it differs from the applied value
+bool parse(Key& k, JsonVariantConst v, LiveConfigValue& out, bool& differs) {
+    out = LiveConfigValue{true, 0, false, nullptr};
+    switch (k.type) {
+        case LiveConfigType::Int:
+            if (!v.is<int32_t>()) {
+                reject(k, "not an integer");
+                return false;
+            }
+            out.number = v.as<int32_t>();
+            if (out.number < k.min || out.number > k.max) {
+                reject(k, "out of range");
+                return false;
+            }
+            differs = !k.set || out.number != k.number;
+            return true;
+        case LiveConfigType::Bool:
+            if (!v.is<bool>()) {
+                reject(k, "not a boolean");
+                return false;
+            }
+            out.flag = v.as<bool>();
+            differs = !k.set || out.flag != k.flag;
+            return true;
+        case LiveConfigType::String: {
+            if (!v.is<const char*>()) {
+                reject(k, "not a string");
+                return false;
+            }
+            out.text = v.as<const char*>();
+            const size_t len = strlen(out.text);
+            if (len < (size_t)k.min || len > (size_t)k.max || len >= sizeof(k.text)) {
+                reject(k, "bad length");
+                return false;
+            }
+            differs = !k.set || strcmp(out.text, k.text) != 0;
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+bool live_config_register(const char* key, LiveConfigType type, int32_t min, int32_t max,
+                          LiveConfigApply fn, void* ctx) {
+    if (!key || !fn || min > max) return false;
+    if (type == LiveConfigType::String && (min < 0 || max >= LIVE_CONFIG_STRING_LEN)) return false;
+    bool ok = false;
+    portENTER_CRITICAL(&s_mux);
+    const uint8_t n = s_count.load(std::memory_order_relaxed);
+    if (n < LIVE_CONFIG_MAX_KEYS) {
+        Key& k = s_keys[n];
+        k.name = key;
+        k.type = type;
+        k.min = min;
+        k.max = max;
+        k.fn = fn;
+        k.ctx = ctx;
+        s_count.store(n + 1, std::memory_order_release);
+        ok = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (!ok) {
+        Serial.printf("LiveConfig: no room for '%s' (LIVE_CONFIG_MAX_KEYS)\n", key);
+        return false;
+    }
+    // The last fetch did not ask for this key
+    if (g_sharedAttributes.version() != 0) g_sharedAttributes.invalidate();
+    return true;
+}
+
+void live_config_apply(JsonObjectConst values, JsonArrayConst deleted) {
+    const uint8_t n = s_count.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < n; i++) {
+        Key& k = s_keys[i];
+        JsonVariantConst v = values[k.name];
+        if (v.isNull()) continue;
+        LiveConfigValue value;
+        bool differs = false;
+        if (!parse(k, v, value, differs) || !differs) continue;
+        if (!k.fn(value, k.ctx)) {
+            reject(k, "refused");
+            continue;
+        }
+        k.set = true;
+        k.number = value.number;
+        k.flag = value.flag;
+        if (value.text) strlcpy(k.text, value.text, sizeof(k.text));
+        k.applied++;
+        s_stats.applied++;
+        logbuf_printf("config: %s applied", k.name);
+    }
+
+    for (JsonVariantConst name : deleted) {
+        const char* key = name.as<const char*>();
+        if (!key) continue;
+        for (uint8_t i = 0; i < n; i++) {
+            Key& k = s_keys[i];
+            if (!k.set || strcmp(k.name, key) != 0) continue;
+            const LiveConfigValue value{false, 0, false, nullptr};
+            k.fn(value, k.ctx);
+            k.set = false;
+            s_stats.deleted++;
+            logbuf_printf("config: %s back to default", k.name);
+        }
+    }
+}
+
+bool live_config_append_keys(char* out, size_t size) {
+    const uint8_t n = s_count.load(std::memory_order_acquire);
+    for (uint8_t i = 0; i < n; i++) {
+        if (strlcat(out, ",", size) >= size || strlcat(out, s_keys[i].name, size) >= size) return false;
+    }
+    return true;
+}
+
+void live_config_stats(LiveConfigStats& out) {
+    out = s_stats;
+    out.keys = s_count.load(std::memory_order_acquire);
+}
+
+void live_config_report(Print& out) {
+    LiveConfigStats s;
+    live_config_stats(s);
+    if (!s.keys) return;
+    out.printf("Live config: %u keys, %lu applied, %lu rejected, %lu deleted\n", (unsigned)s.keys,
+               (unsigned long)s.applied, (unsigned long)s.rejected, (unsigned long)s.deleted);
+    for (uint8_t i = 0; i < s.keys; i++) {
+        const Key& k = s_keys[i];
+        if (!k.set) {
+            out.printf("  %-20s default (%lu rejected)\n", k.name, (unsigned long)k.rejected);
+        } else if (k.type == LiveConfigType::Int) {
+            out.printf("  %-20s %ld (%lu applied, %lu rejected)\n", k.name, (long)k.number,
+                       (unsigned long)k.applied, (unsigned long)k.rejected);
+        } else {
+            out.printf("  %-20s %s (%lu applied, %lu rejected)\n", k.name,
+                       k.type == LiveConfigType::Bool ? (k.flag ? "true" : "false") : k.text,
+                       (unsigned long)k.applied, (unsigned long)k.rejected);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * Live Configuration
+ * Run-time settings pushed as ThingsBoard shared attributes and applied by the
+ * subsystem that owns them, without a reboot:
+ *   - each subsystem registers its keys with a type, a valid range and an
+ *     apply callback. The shared-attribute cache hands every document it
+ *     parses to live_config_apply(), so keys follow the same fetch, push and
+ *     deletion paths as the typed SharedAttributes fields.
+ *   - a value of the wrong type or outside its range, or one its callback
+ *     refuses, is rejected and logged; the subsystem keeps its current setting.
+ *     A value equal to the one last applied is not applied again.
+ *   - deleting the attribute on the server calls the callback with
+ *     present = false: the subsystem goes back to its compiled default.
+ *   - registered names join the ?sharedKeys= list of the attribute fetch
+ *     (live_config_append_keys()); a key registered after the first fetch
+ *     makes the next refresh come early, so it does not wait for a push.
+ *
+ * Callbacks run on the CatM task and hand the value over the way their
+ * subsystem already takes run-time changes (atomics, a critical section,
+ * g_settings.update()). They must be short and must not block on the modem.
+ */
+
+#ifndef LIVE_CONFIG_H
+#define LIVE_CONFIG_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef LIVE_CONFIG_MAX_KEYS
+#define LIVE_CONFIG_MAX_KEYS 16
+#endif
+#define LIVE_CONFIG_STRING_LEN 48
+
+enum class LiveConfigType : uint8_t {
+    Int = 0,         // JSON integer within [min, max]
+    Bool,            // JSON true / false
+    String           // JSON string, min..max characters, below LIVE_CONFIG_STRING_LEN
+};
+
+struct LiveConfigValue {
+    bool present;            // false: attribute deleted, back to the default
+    int32_t number;          // Int
+    bool flag;               // Bool
+    const char* text;        // String; valid during the callback only
+};
+
+// Returns false to refuse the value; the previous setting stays
+typedef bool (*LiveConfigApply)(const LiveConfigValue& value, void* ctx);
+
+struct LiveConfigStats {
+    uint8_t keys;
+    uint32_t applied;
+    uint32_t rejected;
+    uint32_t deleted;
+};
+
+// Any task, usually during setup; key must stay valid (a string literal)
+bool live_config_register(const char* key, LiveConfigType type, int32_t min, int32_t max,
+                          LiveConfigApply fn, void* ctx);
+
+// CatM task, from SharedAttributeCache::apply(): values and the "deleted" array
+void live_config_apply(JsonObjectConst values, JsonArrayConst deleted);
+
+// ",key,key..." after the SHARED_ATTR_KEYS list; false if out was too small
+bool live_config_append_keys(char* out, size_t size);
+
+void live_config_stats(LiveConfigStats& out);
+void live_config_report(Print& out);
+
+#endif // LIVE_CONFIG_H
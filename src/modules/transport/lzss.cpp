@@ -0,0 +1,117 @@
+/*
+ * LZSS Compressor Implementation
+ */
+
+#include "lzss.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace {
+constexpr uint16_t kNoPosition = 0xFFFF;
+
+// Last input position seen for each 3-byte hash; one candidate per bucket keeps the
+// table small and the search O(n)
+uint16_t s_head[1U << LZSS_HASH_BITS];
+
+inline uint16_t hash3(const uint8_t* p) {
+    const uint32_t v = (static_cast<uint32_t>(p[0]) << 16) | (static_cast<uint32_t>(p[1]) << 8) | p[2];
+    return static_cast<uint16_t>((v * 2654435761u) >> (32 - LZSS_HASH_BITS));
+}
+} // namespace
+
+size_t lzss_compress(const uint8_t* in, size_t len, uint8_t* out, size_t outSize) {
+    if (!in || !out || len == 0 || len >= kNoPosition) {
+        return 0;
+    }
+    memset(s_head, 0xFF, sizeof(s_head));
+
+    size_t n = 0;
+    size_t ctrlPos = 0;
+    uint8_t bit = 8;          // forces a new control byte on the first item
+    size_t i = 0;
+    while (i < len) {
+        if (bit == 8) {
+            if (n >= outSize) {
+                return 0;
+            }
+            ctrlPos = n++;
+            out[ctrlPos] = 0;
+            bit = 0;
+        }
+
+        size_t matchLen = 0;
+        size_t matchDist = 0;
+        if (i + LZSS_MIN_MATCH <= len) {
+            const uint16_t h = hash3(in + i);
+            const uint16_t cand = s_head[h];
+            s_head[h] = static_cast<uint16_t>(i);
+            if (cand != kNoPosition && i - cand <= LZSS_WINDOW) {
+                const size_t limit = std::min<size_t>(LZSS_MAX_MATCH, len - i);
+                while (matchLen < limit && in[cand + matchLen] == in[i + matchLen]) {
+                    matchLen++;
+                }
+                matchDist = i - cand;
+            }
+        }
+
+        if (matchLen >= LZSS_MIN_MATCH) {
+            if (n + 2 > outSize) {
+                return 0;
+            }
+            const uint16_t token = static_cast<uint16_t>((matchDist - 1) | ((matchLen - LZSS_MIN_MATCH) << LZSS_WINDOW_BITS));
+            out[n++] = static_cast<uint8_t>(token);
+            out[n++] = static_cast<uint8_t>(token >> 8);
+            out[ctrlPos] |= static_cast<uint8_t>(1U << bit);
+            // Index the skipped positions so later repeats can still find them
+            for (size_t k = 1; k < matchLen && i + k + LZSS_MIN_MATCH <= len; k++) {
+                s_head[hash3(in + i + k)] = static_cast<uint16_t>(i + k);
+            }
+            i += matchLen;
+        } else {
+            if (n >= outSize) {
+                return 0;
+            }
+            out[n++] = in[i++];
+        }
+        bit++;
+    }
+    return n;
+}
+
+size_t lzss_decompress(const uint8_t* in, size_t len, uint8_t* out, size_t rawLen) {
+    if (!in || !out) {
+        return 0;
+    }
+    size_t n = 0;
+    size_t i = 0;
+    while (n < rawLen) {
+        if (i >= len) {
+            return 0;
+        }
+        const uint8_t ctrl = in[i++];
+        for (uint8_t bit = 0; bit < 8 && n < rawLen; bit++) {
+            if (ctrl & (1U << bit)) {
+                if (i + 2 > len) {
+                    return 0;
+                }
+                const uint16_t token = static_cast<uint16_t>(in[i] | (in[i + 1] << 8));
+                i += 2;
+                const size_t dist = (token & (LZSS_WINDOW - 1)) + 1;
+                const size_t mlen = (token >> LZSS_WINDOW_BITS) + LZSS_MIN_MATCH;
+                if (dist > n || n + mlen > rawLen) {
+                    return 0;
+                }
+                for (size_t k = 0; k < mlen; k++, n++) {
+                    out[n] = out[n - dist];
+                }
+            } else {
+                if (i >= len) {
+                    return 0;
+                }
+                out[n++] = in[i++];
+            }
+        }
+    }
+    return n;
+}
@@ -0,0 +1,35 @@
+/*
+ * LZSS Compressor
+ * Small-window LZ77 for uplink batches; no heap, 1 KB of static hash table.
+ *
+ * Stream layout: a control byte, then up to 8 items, LSB of the control byte first.
+ *   bit = 0: one literal byte
+ *   bit = 1: two-byte match, little endian u16:
+ *            bits 0..9   distance - 1 (1..LZSS_WINDOW bytes back)
+ *            bits 10..15 length - LZSS_MIN_MATCH (LZSS_MIN_MATCH..LZSS_MAX_MATCH bytes)
+ * The stream carries no length; the decoder is told how many bytes to produce.
+ * Matches may overlap their own output (distance < length), as in plain LZ77.
+ */
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <Arduino.h>
+
+#ifndef LZSS_HASH_BITS
+#define LZSS_HASH_BITS 9
+#endif
+
+#define LZSS_WINDOW_BITS 10
+#define LZSS_WINDOW      (1U << LZSS_WINDOW_BITS)
+#define LZSS_MIN_MATCH   3
+#define LZSS_MAX_MATCH   (LZSS_MIN_MATCH + 63)
+
+// Returns the compressed length, or 0 if the output would not fit in outSize.
+// Not reentrant: the hash table is shared static state.
+size_t lzss_compress(const uint8_t* in, size_t len, uint8_t* out, size_t outSize);
+
+// Produces exactly rawLen bytes; returns rawLen, or 0 on a malformed stream
+size_t lzss_decompress(const uint8_t* in, size_t len, uint8_t* out, size_t rawLen);
+
+#endif // LZSS_H
@@ -0,0 +1,370 @@
+/*
+ * OTA Client Implementation
+ */
+
+#include "ota_client.h"
+
+#if OTA_CLIENT_ENABLE
+
+#include "shared_attributes.h"
+#include "../catm_gnss/catm_gnss_module.h"
+#include "../logging/log_buffer.h"
+#include "../settings/hour_meter.h"
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <mbedtls/sha256.h>
+#include <string.h>
+
+namespace {
+constexpr const char* kNamespace = "ota";
+constexpr const char* kInstalledKey = "installed";   // CRC-32 of the last URL installed
+constexpr uint8_t kOpCopy = 0x01;
+constexpr uint8_t kOpInsert = 0x02;
+constexpr size_t kCopyPiece = 512;
+
+enum class Format : uint8_t { UNKNOWN, IMAGE, FULL, DELTA };
+
+// CatM task only, apart from the status copy
+char s_url[SHARED_ATTR_OTA_URL_LEN] = {};
+uint32_t s_urlCrc = 0;
+bool s_requested = false;
+OtaStatus s_status = {};
+Format s_format = Format::UNKNOWN;
+uint32_t s_imageBytes = 0;
+uint8_t s_imageSha[32];
+const esp_partition_t* s_target = nullptr;
+const esp_partition_t* s_running = nullptr;
+esp_ota_handle_t s_handle = 0;
+mbedtls_sha256_context s_sha;
+bool s_shaActive = false;
+uint32_t s_nextAttemptMs = 0;
+uint32_t s_backoffMs = OTA_RETRY_MIN_MS;
+uint8_t s_consecutiveFailures = 0;
+bool s_validated = false;
+
+// Delta op being applied
+uint8_t s_opHeader[9];
+uint8_t s_opHeaderLen = 0;
+uint32_t s_insertLeft = 0;
+
+uint8_t s_chunk[OTA_CHUNK_BYTES];
+uint8_t s_piece[kCopyPiece];
+
+uint32_t urlCrc(const char* url) {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(url), strlen(url));
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t installedCrc() {
+    Preferences p;
+    if (!p.begin(kNamespace, true)) return 0;
+    const uint32_t crc = p.getUInt(kInstalledKey, 0);
+    p.end();
+    return crc;
+}
+
+void saveInstalledCrc(uint32_t crc) {
+    Preferences p;
+    if (!p.begin(kNamespace, false)) return;
+    p.putUInt(kInstalledKey, crc);
+    p.end();
+}
+
+void closeSession() {
+    if (s_handle) {
+        esp_ota_abort(s_handle);
+        s_handle = 0;
+    }
+    if (s_shaActive) {
+        mbedtls_sha256_free(&s_sha);
+        s_shaActive = false;
+    }
+}
+
+void fail(const char* why) {
+    closeSession();
+    s_status.state = OtaState::FAILED;
+    strlcpy(s_status.error, why, sizeof(s_status.error));
+    logbuf_printf("ota: failed after %lu bytes: %s", (unsigned long)s_status.written, why);
+}
+
+bool start() {
+    closeSession();
+    const uint32_t requested = s_urlCrc;
+    const char* url = s_url;
+    memset(&s_status, 0, sizeof(s_status));
+    s_format = Format::UNKNOWN;
+    s_imageBytes = 0;
+    s_opHeaderLen = 0;
+    s_insertLeft = 0;
+    s_consecutiveFailures = 0;
+    s_backoffMs = OTA_RETRY_MIN_MS;
+    s_nextAttemptMs = 0;
+
+    s_running = esp_ota_get_running_partition();
+    s_target = esp_ota_get_next_update_partition(nullptr);
+    if (!s_target) {
+        fail("no OTA partition");
+        return false;
+    }
+    // Sectors are erased as the writes reach them, not the whole partition up front
+    if (esp_ota_begin(s_target, OTA_WITH_SEQUENTIAL_WRITES, &s_handle) != ESP_OK) {
+        s_handle = 0;
+        fail("esp_ota_begin failed");
+        return false;
+    }
+    mbedtls_sha256_init(&s_sha);
+    mbedtls_sha256_starts(&s_sha, 0);
+    s_shaActive = true;
+    s_status.state = OtaState::DOWNLOADING;
+    logbuf_printf("ota: downloading %s into %s (url %08lx)", url, s_target->label, (unsigned long)requested);
+    return true;
+}
+
+bool writeOut(const uint8_t* p, size_t n) {
+    if (s_imageBytes && s_status.written + n > s_imageBytes) {
+        fail("image longer than the header says");
+        return false;
+    }
+    if (esp_ota_write(s_handle, p, n) != ESP_OK) {
+        fail("esp_ota_write failed");
+        return false;
+    }
+    mbedtls_sha256_update(&s_sha, p, n);
+    s_status.written += n;
+    return true;
+}
+
+bool copyFromBase(uint32_t offset, uint32_t len) {
+    if (!s_running || offset > s_running->size || len > s_running->size - offset) {
+        fail("delta copy outside the running image");
+        return false;
+    }
+    while (len) {
+        const size_t n = len < kCopyPiece ? len : kCopyPiece;
+        if (esp_partition_read(s_running, offset, s_piece, n) != ESP_OK) {
+            fail("running image read failed");
+            return false;
+        }
+        if (!writeOut(s_piece, n)) return false;
+        s_status.copiedBytes += n;
+        offset += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool applyDelta(const uint8_t* p, size_t n) {
+    while (n) {
+        if (s_insertLeft) {
+            const size_t take = n < s_insertLeft ? n : s_insertLeft;
+            if (!writeOut(p, take)) return false;
+            s_insertLeft -= take;
+            p += take;
+            n -= take;
+            continue;
+        }
+        s_opHeader[s_opHeaderLen++] = *p++;
+        n--;
+        const uint8_t op = s_opHeader[0];
+        const uint8_t need = op == kOpCopy ? 9 : op == kOpInsert ? 5 : 0;
+        if (need == 0) {
+            fail("bad delta op");
+            return false;
+        }
+        if (s_opHeaderLen < need) continue;
+        s_opHeaderLen = 0;
+        if (op == kOpCopy) {
+            if (!copyFromBase(readU32(s_opHeader + 1), readU32(s_opHeader + 5))) return false;
+        } else {
+            s_insertLeft = readU32(s_opHeader + 1);
+        }
+    }
+    return true;
+}
+
+// First bytes of the download: a plain image or a package header
+bool parseHeader(const uint8_t* p, size_t n, size_t& consumed) {
+    consumed = 0;
+    if (n >= 1 && p[0] == OTA_IMAGE_MAGIC) {
+        s_format = Format::IMAGE;
+        return true;
+    }
+    if (n < OTA_PACKAGE_HEADER_BYTES || readU32(p) != OTA_PACKAGE_MAGIC) {
+        fail("not an image or OTA package");
+        return false;
+    }
+    const uint8_t kind = p[4];
+    s_imageBytes = readU32(p + 8);
+    s_status.total = OTA_PACKAGE_HEADER_BYTES + readU32(p + 12);
+    memcpy(s_imageSha, p + 48, sizeof(s_imageSha));
+    if (s_imageBytes == 0 || s_imageBytes > s_target->size) {
+        fail("image does not fit the partition");
+        return false;
+    }
+    if (kind == 1) {
+        uint8_t running[32];
+        if (!s_running || esp_partition_get_sha256(s_running, running) != ESP_OK ||
+            memcmp(running, p + 16, sizeof(running)) != 0) {
+            fail("delta is for another base image");
+            return false;
+        }
+        s_format = Format::DELTA;
+        s_status.delta = true;
+    } else if (kind == 0) {
+        s_format = Format::FULL;
+    } else {
+        fail("unknown package kind");
+        return false;
+    }
+    consumed = OTA_PACKAGE_HEADER_BYTES;
+    return true;
+}
+
+bool feed(const uint8_t* p, size_t n) {
+    if (s_format == Format::UNKNOWN) {
+        size_t consumed = 0;
+        if (!parseHeader(p, n, consumed)) return false;
+        p += consumed;
+        n -= consumed;
+    }
+    if (n == 0) return true;
+    return s_format == Format::DELTA ? applyDelta(p, n) : writeOut(p, n);
+}
+
+void finish() {
+    if (s_format == Format::DELTA && (s_insertLeft || s_opHeaderLen)) {
+        fail("delta ends inside an op");
+        return;
+    }
+    if (s_imageBytes && s_status.written != s_imageBytes) {
+        fail("image shorter than the header says");
+        return;
+    }
+    uint8_t sha[32];
+    mbedtls_sha256_finish(&s_sha, sha);
+    mbedtls_sha256_free(&s_sha);
+    s_shaActive = false;
+    if (s_format != Format::IMAGE && memcmp(sha, s_imageSha, sizeof(sha)) != 0) {
+        fail("SHA-256 mismatch");
+        return;
+    }
+    // Validates the image format and its appended hash
+    const esp_err_t err = esp_ota_end(s_handle);
+    s_handle = 0;
+    if (err != ESP_OK) {
+        fail(err == ESP_ERR_OTA_VALIDATE_FAILED ? "image validation failed" : "esp_ota_end failed");
+        return;
+    }
+    if (esp_ota_set_boot_partition(s_target) != ESP_OK) {
+        fail("set boot partition failed");
+        return;
+    }
+    saveInstalledCrc(s_urlCrc);
+    s_status.state = OtaState::RESTARTING;
+    logbuf_printf("ota: %lu byte image verified (%s, %lu B downloaded), restarting into %s",
+                  (unsigned long)s_status.written, s_format == Format::DELTA ? "delta" : "full",
+                  (unsigned long)s_status.fetched, s_target->label);
+    hour_meter_flush();
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    esp_restart();
+}
+
+void retryLater(uint32_t now, int httpStatus) {
+    s_status.retries++;
+    if (++s_consecutiveFailures >= OTA_MAX_RETRIES) {
+        char why[40];
+        snprintf(why, sizeof(why), "download failed (HTTP %d)", httpStatus);
+        fail(why);
+        return;
+    }
+    s_nextAttemptMs = (now + s_backoffMs) | 1;
+    s_backoffMs = s_backoffMs * 2 > OTA_RETRY_MAX_MS ? OTA_RETRY_MAX_MS : s_backoffMs * 2;
+}
+
+void onOtaUrl(const SharedAttributes& attrs, uint32_t, void*) {
+    if (attrs.otaUrl[0] == '\0') return;
+    const uint32_t crc = urlCrc(attrs.otaUrl);
+    if (crc == s_urlCrc && s_status.state == OtaState::DOWNLOADING) return;
+    if (crc == installedCrc()) return;   // running it already
+    strlcpy(s_url, attrs.otaUrl, sizeof(s_url));
+    s_urlCrc = crc;
+    s_requested = true;
+}
+} // namespace
+
+void ota_client_begin() {
+    g_sharedAttributes.addListener(SHARED_ATTR_OTA_URL, onOtaUrl, nullptr);
+}
+
+void ota_client_poll(CatMGNSSModule* module, uint32_t now) {
+    if (!module) return;
+    if (!s_validated) {
+        // Reaching the network again is the new image's proof of health
+        s_validated = true;
+        esp_ota_img_states_t st;
+        const esp_partition_t* running = esp_ota_get_running_partition();
+        if (running && esp_ota_get_state_partition(running, &st) == ESP_OK && st == ESP_OTA_IMG_PENDING_VERIFY) {
+            esp_ota_mark_app_valid_cancel_rollback();
+            logbuf_printf("ota: %s marked valid", running->label);
+        }
+    }
+    if (s_requested) {
+        s_requested = false;
+        if (!start()) return;
+    }
+    if (s_status.state != OtaState::DOWNLOADING) return;
+    if (s_nextAttemptMs && (int32_t)(now - s_nextAttemptMs) < 0) return;
+    s_nextAttemptMs = 0;
+
+    const String url(s_url);
+    const uint32_t started = millis();
+    while (s_status.state == OtaState::DOWNLOADING && millis() - started < OTA_STEP_BUDGET_MS) {
+        size_t want = OTA_CHUNK_BYTES;
+        if (s_status.total && s_status.total - s_status.fetched < want) want = s_status.total - s_status.fetched;
+        int httpStatus = -1;
+        const int n = want ? module->httpGetRange(url, s_status.fetched, s_chunk, want, httpStatus) : 0;
+        if (n < 0) {
+            retryLater(now, httpStatus);
+            return;
+        }
+        s_consecutiveFailures = 0;
+        s_backoffMs = OTA_RETRY_MIN_MS;
+        if (n > 0) {
+            s_status.chunks++;
+            s_status.fetched += (uint32_t)n;
+            if (!feed(s_chunk, (size_t)n)) return;
+        }
+        // A plain image ends with a short read; a package at its stated length
+        const bool end = s_status.total ? s_status.fetched >= s_status.total : (size_t)n < want;
+        if (end) {
+            finish();
+            return;
+        }
+    }
+}
+
+bool ota_client_active() {
+    return s_status.state == OtaState::DOWNLOADING;
+}
+
+void ota_client_status(OtaStatus& out) {
+    out = s_status;
+}
+
+void ota_client_report(Print& out) {
+    static const char* const kStates[] = {"idle", "downloading", "restarting", "failed"};
+    const OtaStatus s = s_status;
+    if (s.state == OtaState::IDLE) return;
+    out.printf("OTA: %s, %s, %lu/%lu B fetched, %lu B written (%lu copied), %lu chunks, %lu retries%s%s\n",
+               kStates[(size_t)s.state], s.delta ? "delta" : "full", (unsigned long)s.fetched,
+               (unsigned long)s.total, (unsigned long)s.written, (unsigned long)s.copiedBytes,
+               (unsigned long)s.chunks, (unsigned long)s.retries, s.error[0] ? "; " : "", s.error);
+}
+
+#endif // OTA_CLIENT_ENABLE
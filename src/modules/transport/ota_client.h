@@ -0,0 +1,96 @@
+/*
+ * OTA Client
+ * Firmware updates from the ota_url shared attribute, streamed over the
+ * cellular HTTP stack straight into the inactive OTA partition.
+ *
+ *   - the image is fetched OTA_CHUNK_BYTES at a time with HTTP Range requests
+ *     and written as it arrives: no copy of the image in RAM or on the SD card
+ *   - a failed chunk is asked for again from the same offset, with backoff,
+ *     so a dropped link costs one chunk, not the download; OTA_MAX_RETRIES
+ *     failures in a row give up on that URL until the attribute changes.
+ *     A reboot starts over (the partition is erased again).
+ *   - the URL may name a plain application image (.bin, first byte 0xE9) or a
+ *     package below. A delta package is applied against the running image, so
+ *     an update that changes little downloads little.
+ *   - the written image is checked against the package SHA-256, then by
+ *     esp_ota_end() (image format and appended hash), before the boot
+ *     partition is switched and the device restarts into it
+ *   - an installed URL is remembered in NVS, so the attribute still pointing at
+ *     it after the restart doesn't start the download again
+ *
+ * Package (tools/mkota.py, little endian):
+ *   header  "GOT1", u8 kind (0 full, 1 delta), u8 reserved[3],
+ *           u32 image bytes, u32 payload bytes after the header,
+ *           u8 base SHA-256[32] (delta: the running image, esp_partition_get_sha256),
+ *           u8 image SHA-256[32]
+ *   full    payload is the image
+ *   delta   payload is ops building the image in order:
+ *           0x01 COPY   u32 base offset, u32 length: bytes from the running image
+ *           0x02 INSERT u32 length, then that many literal bytes
+ *
+ * Runs on the CatM task: ota_client_poll() from its connected loop, bounded by
+ * OTA_STEP_BUDGET_MS per call so telemetry keeps flowing during a download.
+ */
+
+#ifndef OTA_CLIENT_H
+#define OTA_CLIENT_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+
+#ifndef OTA_CHUNK_BYTES
+#define OTA_CHUNK_BYTES 4096               // per Range request
+#endif
+#ifndef OTA_STEP_BUDGET_MS
+#define OTA_STEP_BUDGET_MS 3000            // chunks per ota_client_poll() call stop here
+#endif
+#ifndef OTA_RETRY_MIN_MS
+#define OTA_RETRY_MIN_MS 5000UL
+#endif
+#ifndef OTA_RETRY_MAX_MS
+#define OTA_RETRY_MAX_MS 300000UL
+#endif
+#ifndef OTA_MAX_RETRIES
+#define OTA_MAX_RETRIES 12                 // consecutive failed chunks
+#endif
+#define OTA_PACKAGE_MAGIC 0x31544F47u      // "GOT1"
+#define OTA_PACKAGE_HEADER_BYTES 80
+#define OTA_IMAGE_MAGIC 0xE9
+
+class CatMGNSSModule;
+
+enum class OtaState : uint8_t { IDLE = 0, DOWNLOADING, RESTARTING, FAILED };
+
+struct OtaStatus {
+    OtaState state;
+    bool delta;
+    uint32_t fetched;        // package bytes so far
+    uint32_t total;          // package bytes, 0 = not known (plain image)
+    uint32_t written;        // image bytes in the partition
+    uint32_t chunks;
+    uint32_t retries;        // chunks asked for again
+    uint32_t copiedBytes;    // delta: taken from the running image
+    char error[40];
+};
+
+#if OTA_CLIENT_ENABLE
+
+// Registers the ota_url listener; call from the CatM task before it applies attributes
+void ota_client_begin();
+// Fetches and applies chunks while a download runs; call with the link up
+void ota_client_poll(CatMGNSSModule* module, uint32_t now);
+bool ota_client_active();
+void ota_client_status(OtaStatus& out);
+void ota_client_report(Print& out);
+
+#else
+
+inline void ota_client_begin() {}
+inline void ota_client_poll(CatMGNSSModule*, uint32_t) {}
+inline bool ota_client_active() { return false; }
+inline void ota_client_status(OtaStatus& out) { out = OtaStatus{}; }
+inline void ota_client_report(Print&) {}
+
+#endif // OTA_CLIENT_ENABLE
+
+#endif // OTA_CLIENT_H
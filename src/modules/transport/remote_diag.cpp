@@ -0,0 +1,313 @@
+/*
+ * Remote Diagnostics Implementation
+ */
+
+#include "remote_diag.h"
+
+#if REMOTE_DIAG_ENABLE
+
+#include "../catm_gnss/catm_gnss_module.h"
+#include "../logging/log_buffer.h"
+#include "../../../include/debug_system.h"
+#include "../../../include/transport.h"
+#include "../../system/core_affinity.h"
+#include "../../system/cpu_profiler.h"
+#include "../../system/dsp_kernels.h"
+#include "../../system/json_writer.h"
+#include "../../system/metrics.h"
+#include "../../system/stack_profiler.h"
+#include "../../system/task_heap.h"
+#include "../../system/trace_recorder.h"
+#include "../../system/work_queue.h"
+#include <ArduinoJson.h>
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+static_assert(REMOTE_DIAG_CHUNK_BYTES * 2 + 96 <= TRANSPORT_MAX_PACKET_BYTES,
+              "an escaped piece must fit one Diagnostic record");
+
+namespace {
+enum class State : uint8_t {
+    Idle = 0,
+    Pending,         // request copied, not yet answered
+    Running,         // on the worker
+    Streaming        // output captured, pieces going out
+};
+
+struct Command {
+    const char* name;
+    uint16_t capBytes;
+    bool needsArg;
+    bool worker;             // app-core worker instead of the CatM task
+    void (*run)(Print& out, const char* arg);
+};
+
+// Output of the running command, cut at its cap. Carriage returns are dropped and
+// other control characters replaced, so escaping at most doubles a piece.
+class Capture : public Print {
+public:
+    void reset(size_t cap) {
+        len_ = 0;
+        cut_ = 0;
+        cap_ = cap < sizeof(buf_) ? cap : sizeof(buf_);
+    }
+    size_t write(uint8_t c) override {
+        if (c == '\r') return 1;
+        if (c < 0x20 && c != '\n' && c != '\t') c = '?';
+        if (len_ < cap_) {
+            buf_[len_++] = (char)c;
+        } else {
+            cut_++;
+        }
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t n) override {
+        for (size_t i = 0; i < n; i++) write(data[i]);
+        return n;
+    }
+    const char* data() const { return buf_; }
+    size_t length() const { return len_; }
+    uint32_t cut() const { return cut_; }
+
+private:
+    char buf_[REMOTE_DIAG_BUFFER_BYTES];
+    size_t len_ = 0;
+    size_t cap_ = 0;
+    uint32_t cut_ = 0;
+};
+
+void runMetrics(Print& out, const char*) {
+    metrics_report(out);
+}
+
+void runTasks(Print& out, const char*) {
+    cpu_profile_report(out);
+    core_affinity_report(out);
+    task_heap_report(out);
+    work_report(out);
+}
+
+void runStacks(Print& out, const char*) {
+    stack_profile_report(out);
+}
+
+void runLogTail(Print& out, const char* arg) {
+    long lines = arg[0] ? strtol(arg, nullptr, 10) : 20;
+    if (lines < 1) lines = 1;
+    if (lines > REMOTE_DIAG_LOG_TAIL_MAX) lines = REMOTE_DIAG_LOG_TAIL_MAX;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    log_seq_range(begin, end);
+    const uint32_t from = end - begin > (uint32_t)lines ? end - (uint32_t)lines : begin;
+    char line[LOG_BUFFER_LINE_LEN];
+    for (uint32_t seq = from; seq != end; seq++) {
+        if (log_get_seq(seq, line, sizeof(line))) out.println(line);
+    }
+}
+
+void runTrace(Print& out, const char*) {
+    trace_recorder_dump(out);
+}
+
+void runLogLevel(Print& out, const char* arg) {
+    out.printf("%d tag levels set\n", log_tag_apply(arg));
+}
+
+void runBench(Print& out, const char*) {
+    dsp_benchmark(out);
+}
+
+const Command kCommands[] = {
+    {"metrics",   4096, false, false, runMetrics},
+    {"tasks",     3072, false, false, runTasks},
+    {"stacks",    2048, false, false, runStacks},
+    {"log_tail",  4096, false, false, runLogTail},
+    {"trace",     4096, false, false, runTrace},
+    {"log_level", 128,  true,  false, runLogLevel},
+    {"bench",     2048, false, true,  runBench},
+};
+
+std::atomic<uint8_t> s_state{(uint8_t)State::Idle};
+Capture s_capture;
+RemoteDiagStats s_stats = {};
+MetricCounter s_metricRequests("diag.requests", [] { return s_stats.requests; });
+
+// The request in hand; written by the MQTT callback while Idle, read by the poll
+const Command* s_command = nullptr;
+char s_method[16];
+char s_arg[48];
+char s_rpcId[12];
+uint32_t s_hourStartMs = 0;
+
+// A request that came in while another ran, answered by the next poll
+char s_busyId[12];
+
+// Streaming
+size_t s_sent = 0;
+uint16_t s_seq = 0;
+char s_piece[REMOTE_DIAG_CHUNK_BYTES + 1];
+char s_record[TRANSPORT_MAX_PACKET_BYTES];
+
+State state() {
+    return (State)s_state.load(std::memory_order_acquire);
+}
+
+void setState(State st) {
+    s_state.store((uint8_t)st, std::memory_order_release);
+}
+
+void reply(CatMGNSSModule* module, const char* id, const char* json) {
+    char topic[48];
+    snprintf(topic, sizeof(topic), "v1/devices/me/rpc/response/%s", id);
+    module->mqttPublish(String(topic), String(json), 0);
+}
+
+void benchJob(void*) {
+    s_command->run(s_capture, s_arg);
+    setState(State::Streaming);
+}
+
+// Answers the request and runs it, or refuses it
+void start(CatMGNSSModule* module, uint32_t now) {
+    const char* error = nullptr;
+    s_command = nullptr;
+    for (const Command& c : kCommands) {
+        if (strcmp(c.name, s_method) == 0) s_command = &c;
+    }
+    if (now - s_hourStartMs >= 3600000UL) {
+        s_hourStartMs = now;
+        s_stats.hourBytes = 0;
+    }
+    if (!s_command) {
+        error = "unknown command";
+    } else if (s_command->needsArg && !s_arg[0]) {
+        error = "params missing";
+    } else if (s_stats.hourBytes + s_command->capBytes > REMOTE_DIAG_BYTES_PER_HOUR) {
+        error = "hourly budget spent";
+    }
+
+    if (!error) {
+        s_capture.reset(s_command->capBytes);
+        s_sent = 0;
+        s_seq = 0;
+        if (s_command->worker) {
+            setState(State::Running);
+            if (work_submit("RemoteDiag", benchJob, nullptr, WorkPriority::Low, WORK_CORE_APP) == WORK_ID_NONE) {
+                error = "worker busy";
+            }
+        } else {
+            s_command->run(s_capture, s_arg);
+            setState(State::Streaming);
+        }
+    }
+
+    char json[64];
+    if (error) {
+        s_stats.refused++;
+        setState(State::Idle);
+        snprintf(json, sizeof(json), "{\"error\":\"%s\"}", error);
+        logbuf_printf("diag: '%s' refused (%s)", s_method, error);
+    } else {
+        s_stats.hourBytes += s_command->capBytes;
+        snprintf(json, sizeof(json), "{\"accepted\":true,\"cap\":%u}", (unsigned)s_command->capBytes);
+        logbuf_printf("diag: running '%s' for rpc %s", s_command->name, s_rpcId);
+    }
+    reply(module, s_rpcId, json);
+}
+
+// Queues the next piece; false when the transport refused it (retried next pass)
+bool sendPiece() {
+    const size_t left = s_capture.length() - s_sent;
+    const size_t n = left < REMOTE_DIAG_CHUNK_BYTES ? left : REMOTE_DIAG_CHUNK_BYTES;
+    memcpy(s_piece, s_capture.data() + s_sent, n);
+    s_piece[n] = '\0';
+    const bool last = s_sent + n == s_capture.length();
+
+    JsonWriter w(s_record, sizeof(s_record));
+    w.beginObject()
+        .field("diag", s_command->name)
+        .field("rpc", strtoul(s_rpcId, nullptr, 10))
+        .field("seq", (unsigned)s_seq)
+        .field("text", s_piece);
+    if (last) {
+        w.field("last", true);
+        if (s_capture.cut()) w.field("cut", (unsigned long)s_capture.cut());
+    }
+    w.endObject();
+    if (!w.ok() || !transport_sendDiagnostic(w.data(), w.length())) return false;
+    s_sent += n;
+    s_seq++;
+    s_stats.records++;
+    s_stats.bytes += n;
+    if (last) {
+        s_stats.completed++;
+        s_stats.cut += s_capture.cut();
+        setState(State::Idle);
+    }
+    return true;
+}
+} // namespace
+
+void remote_diag_request(const char* topic, const char* payload, size_t len) {
+    const size_t prefix = sizeof(REMOTE_DIAG_RPC_TOPIC) - 1;
+    if (!topic || strncmp(topic, REMOTE_DIAG_RPC_TOPIC, prefix) != 0) return;
+    const char* id = topic + prefix;
+    s_stats.requests++;
+    if (state() != State::Idle) {
+        s_stats.refused++;
+        strlcpy(s_busyId, id, sizeof(s_busyId));
+        return;
+    }
+
+    StaticJsonDocument<256> doc;
+    if (deserializeJson(doc, payload, len)) {
+        s_stats.refused++;
+        logbuf_printf("diag: rpc %s not valid JSON", id);
+        return;
+    }
+    strlcpy(s_rpcId, id, sizeof(s_rpcId));
+    strlcpy(s_method, doc["method"] | "", sizeof(s_method));
+    JsonVariant params = doc["params"];
+    s_arg[0] = '\0';
+    if (params.is<const char*>()) {
+        strlcpy(s_arg, params.as<const char*>(), sizeof(s_arg));
+    } else if (params.is<long>()) {
+        snprintf(s_arg, sizeof(s_arg), "%ld", params.as<long>());
+    }
+    setState(State::Pending);
+}
+
+void remote_diag_poll(CatMGNSSModule* module, uint32_t now) {
+    if (!module) return;
+    if (s_busyId[0]) {
+        reply(module, s_busyId, "{\"error\":\"busy\"}");
+        s_busyId[0] = '\0';
+    }
+    switch (state()) {
+        case State::Pending:
+            start(module, now);
+            break;
+        case State::Streaming:
+            sendPiece();
+            break;
+        default:
+            break;
+    }
+}
+
+void remote_diag_stats(RemoteDiagStats& out) {
+    out = s_stats;
+}
+
+void remote_diag_report(Print& out) {
+    const RemoteDiagStats s = s_stats;
+    if (!s.requests) return;
+    out.printf("Remote diag: %lu requests, %lu completed, %lu refused, %lu records, %lu bytes (%lu cut), "
+               "%lu of %lu bytes this hour\n",
+               (unsigned long)s.requests, (unsigned long)s.completed, (unsigned long)s.refused,
+               (unsigned long)s.records, (unsigned long)s.bytes, (unsigned long)s.cut,
+               (unsigned long)s.hourBytes, (unsigned long)REMOTE_DIAG_BYTES_PER_HOUR);
+}
+
+#endif // REMOTE_DIAG_ENABLE
@@ -0,0 +1,82 @@
+/*
+ * Remote Diagnostics
+ * A small command channel for performance triage without a serial cable:
+ *   - commands arrive as ThingsBoard server-side RPC on the MQTT session
+ *     (v1/devices/me/rpc/request/<id>, {"method":"metrics","params":...}).
+ *     The RPC is answered at once with {"accepted":true,"cap":<bytes>} or
+ *     {"error":"..."}; the output follows as Diagnostic records.
+ *   - one command at a time. Its output is captured into a fixed buffer, cut
+ *     at the command's byte cap. Reports run on the CatM task; benchmarks run
+ *     on the app-core worker.
+ *   - the capture goes out in REMOTE_DIAG_CHUNK_BYTES pieces, one per service
+ *     pass, in the transport's Diagnostic class, which only sends when nothing
+ *     else is due: {"diag":"metrics","rpc":7,"seq":0,"text":"..."}. The last
+ *     piece carries "last":true and the bytes cut by the cap as "cut".
+ *   - commands whose cap no longer fits REMOTE_DIAG_BYTES_PER_HOUR are refused
+ *     until the hour rolls over.
+ *
+ * Commands (params in brackets):
+ *   metrics            metrics registry
+ *   tasks              CPU, core affinity, per-task heap and work queue reports
+ *   stacks             stack watermark profile
+ *   log_tail [lines]   newest log buffer lines, default 20
+ *   trace              trace recorder image
+ *   log_level <spec>   per-tag log levels, e.g. "CATM=5,UI=1"
+ *   bench              DSP kernel benchmark
+ */
+
+#ifndef REMOTE_DIAG_H
+#define REMOTE_DIAG_H
+
+#include <Arduino.h>
+#include "../../config/system_config.h"
+
+#ifndef REMOTE_DIAG_BUFFER_BYTES
+#define REMOTE_DIAG_BUFFER_BYTES 4096       // largest cap of any command
+#endif
+#ifndef REMOTE_DIAG_CHUNK_BYTES
+#define REMOTE_DIAG_CHUNK_BYTES 320         // text per record; escaped it stays under TRANSPORT_MAX_PACKET_BYTES
+#endif
+#ifndef REMOTE_DIAG_BYTES_PER_HOUR
+#define REMOTE_DIAG_BYTES_PER_HOUR 32768UL
+#endif
+#ifndef REMOTE_DIAG_LOG_TAIL_MAX
+#define REMOTE_DIAG_LOG_TAIL_MAX 50
+#endif
+#define REMOTE_DIAG_RPC_TOPIC "v1/devices/me/rpc/request/"
+
+class CatMGNSSModule;
+
+struct RemoteDiagStats {
+    uint32_t requests;
+    uint32_t completed;
+    uint32_t refused;            // unknown, busy or over the hourly budget
+    uint32_t records;            // Diagnostic records queued
+    uint32_t bytes;              // output text sent
+    uint32_t cut;                // output bytes dropped by the caps
+    uint32_t hourBytes;          // caps charged in the current hour
+};
+
+#if REMOTE_DIAG_ENABLE
+
+// From the MQTT message callback: topic is REMOTE_DIAG_RPC_TOPIC<id>. Only
+// copies the request; it is run from remote_diag_poll().
+void remote_diag_request(const char* topic, const char* payload, size_t len);
+
+// CatM task, each service pass while connected: answers the RPC, runs the
+// command and queues the next piece of its output
+void remote_diag_poll(CatMGNSSModule* module, uint32_t now);
+
+void remote_diag_stats(RemoteDiagStats& out);
+void remote_diag_report(Print& out);
+
+#else
+
+inline void remote_diag_request(const char*, const char*, size_t) {}
+inline void remote_diag_poll(CatMGNSSModule*, uint32_t) {}
+inline void remote_diag_stats(RemoteDiagStats& out) { out = RemoteDiagStats{}; }
+inline void remote_diag_report(Print&) {}
+
+#endif // REMOTE_DIAG_ENABLE
+
+#endif // REMOTE_DIAG_H
@@ -0,0 +1,124 @@
+/*
+ * Adaptive Report Cadence Implementation
+ */
+
+#include "report_cadence.h"
+#include <string.h>
+
+namespace {
+constexpr uint8_t kNoField = 0xFF;
+constexpr uint8_t kMaxStretch = 6;     // 64x base at most, before the max-interval cap
+} // namespace
+
+ReportCadence::ReportCadence(uint32_t baseIntervalMs)
+    : baseIntervalMs_(baseIntervalMs ? baseIntervalMs : 1000), stretch_(0), poorLink_(false),
+      alarmPending_(false), reportedOnce_(false), changedField_(kNoField), lastReportMs_(0),
+      pending_(CadenceReason::None) {
+    memset(deadband_, 0, sizeof(deadband_));
+    memset(current_, 0, sizeof(current_));
+    memset(reported_, 0, sizeof(reported_));
+    stats_.intervalMs = intervalMs();
+}
+
+void ReportCadence::setBaseInterval(uint32_t ms) {
+    if (ms != 0 && ms != baseIntervalMs_) {
+        baseIntervalMs_ = ms;
+        stretch_ = 0;
+        stats_.intervalMs = intervalMs();
+    }
+}
+
+void ReportCadence::setDeadband(uint8_t field, int32_t deadband) {
+    if (field < REPORT_CADENCE_MAX_FIELDS) {
+        deadband_[field] = deadband < 0 ? -deadband : deadband;
+    }
+}
+
+void ReportCadence::observe(uint8_t field, int32_t value) {
+    if (field >= REPORT_CADENCE_MAX_FIELDS) {
+        return;
+    }
+    current_[field] = value;
+    // 64-bit so a full-range swing can't overflow
+    const int64_t diff = static_cast<int64_t>(value) - reported_[field];
+    if ((diff < 0 ? -diff : diff) > deadband_[field] && changedField_ == kNoField) {
+        changedField_ = field;
+    }
+}
+
+void ReportCadence::setLink(int8_t rssiDbm, bool registered) {
+    poorLink_ = !registered || rssiDbm <= REPORT_CADENCE_POOR_RSSI_DBM;
+    stats_.intervalMs = intervalMs();
+}
+
+uint32_t ReportCadence::intervalMs() const {
+    uint64_t interval = static_cast<uint64_t>(baseIntervalMs_) << (stretch_ + (poorLink_ ? 1 : 0));
+    if (interval > REPORT_CADENCE_MAX_INTERVAL_MS) {
+        interval = REPORT_CADENCE_MAX_INTERVAL_MS;
+    }
+    return interval < baseIntervalMs_ ? baseIntervalMs_ : static_cast<uint32_t>(interval);
+}
+
+uint32_t ReportCadence::minIntervalMs() const {
+    return poorLink_ ? REPORT_CADENCE_MIN_INTERVAL_MS * 2 : REPORT_CADENCE_MIN_INTERVAL_MS;
+}
+
+bool ReportCadence::shouldReport(uint32_t now) {
+    const uint32_t since = now - lastReportMs_;
+    if (!reportedOnce_) {
+        pending_ = CadenceReason::First;
+    } else if (alarmPending_) {
+        pending_ = CadenceReason::Alarm;
+    } else if (changedField_ != kNoField && since >= minIntervalMs()) {
+        pending_ = CadenceReason::Change;
+    } else if (since >= intervalMs()) {
+        pending_ = CadenceReason::Heartbeat;
+    } else {
+        pending_ = CadenceReason::None;
+    }
+    return pending_ != CadenceReason::None;
+}
+
+void ReportCadence::markReported(uint32_t now) {
+    if (reportedOnce_ && baseIntervalMs_ > 0) {
+        const uint32_t periods = (now - lastReportMs_) / baseIntervalMs_;
+        if (periods > 1) {
+            stats_.suppressed += periods - 1;
+        }
+    }
+
+    stats_.reports++;
+    stats_.lastReason = pending_;
+    if (poorLink_) {
+        stats_.poorLinkDecisions++;
+    }
+    switch (pending_) {
+        case CadenceReason::Change:
+            stats_.byChange++;
+            stats_.lastChangedField = changedField_;
+            stretch_ = 0;
+            break;
+        case CadenceReason::Alarm:
+            stats_.byAlarm++;
+            stretch_ = 0;
+            break;
+        case CadenceReason::Heartbeat:
+            stats_.byHeartbeat++;
+            if (changedField_ == kNoField && stretch_ < kMaxStretch) {
+                stretch_++;
+            } else if (changedField_ != kNoField) {
+                stretch_ = 0;
+            }
+            break;
+        default:
+            break;
+    }
+
+    memcpy(reported_, current_, sizeof(reported_));
+    changedField_ = kNoField;
+    alarmPending_ = false;
+    reportedOnce_ = true;
+    lastReportMs_ = now;
+    pending_ = CadenceReason::None;
+    stats_.intervalMs = intervalMs();
+}
@@ -0,0 +1,90 @@
+/*
+ * Adaptive Report Cadence
+ * Decides when a periodic telemetry report is worth its airtime.
+ *
+ * The producer feeds every sample through observe(); a field counts as changed
+ * once it moves past its deadband from the value in the last report. Reports go
+ * out early on a change (rate limited by the minimum interval) or an alarm, and
+ * otherwise as a heartbeat. Each heartbeat with nothing changed doubles the
+ * heartbeat interval up to the maximum; a weak or missing registration doubles
+ * both the heartbeat and the change rate limit. Any change or alarm returns to
+ * the base interval.
+ */
+
+#ifndef REPORT_CADENCE_H
+#define REPORT_CADENCE_H
+
+#include <Arduino.h>
+
+#ifndef REPORT_CADENCE_MAX_FIELDS
+#define REPORT_CADENCE_MAX_FIELDS 16
+#endif
+#ifndef REPORT_CADENCE_MIN_INTERVAL_MS
+#define REPORT_CADENCE_MIN_INTERVAL_MS 10000UL      // closest two change-driven reports
+#endif
+#ifndef REPORT_CADENCE_MAX_INTERVAL_MS
+#define REPORT_CADENCE_MAX_INTERVAL_MS 600000UL     // longest heartbeat
+#endif
+#ifndef REPORT_CADENCE_POOR_RSSI_DBM
+#define REPORT_CADENCE_POOR_RSSI_DBM (-105)         // at or below: link counts as poor
+#endif
+
+enum class CadenceReason : uint8_t {
+    None = 0,
+    First,          // no report since boot
+    Change,         // a field moved past its deadband
+    Alarm,
+    Heartbeat       // nothing changed, interval elapsed
+};
+
+struct ReportCadenceStats {
+    uint32_t reports = 0;
+    uint32_t byChange = 0;
+    uint32_t byAlarm = 0;
+    uint32_t byHeartbeat = 0;
+    uint32_t suppressed = 0;         // base periods that passed without a report
+    uint32_t poorLinkDecisions = 0;  // reports decided with the poor-link stretch applied
+    uint32_t intervalMs = 0;         // current heartbeat interval
+    CadenceReason lastReason = CadenceReason::None;
+    uint8_t lastChangedField = 0xFF; // field that triggered the last Change report
+};
+
+class ReportCadence {
+public:
+    explicit ReportCadence(uint32_t baseIntervalMs);
+
+    // Base cadence, e.g. the report_period_s shared attribute
+    void setBaseInterval(uint32_t ms);
+    // Smallest move of field that is worth a report; 0 = any change
+    void setDeadband(uint8_t field, int32_t deadband);
+    void observe(uint8_t field, int32_t value);
+    void setLink(int8_t rssiDbm, bool registered);
+    void alarm() { alarmPending_ = true; }
+
+    // True when a report should go out now; reason() says why
+    bool shouldReport(uint32_t now);
+    // The report went out with the values observed so far
+    void markReported(uint32_t now);
+
+    CadenceReason reason() const { return pending_; }
+    uint32_t intervalMs() const;
+    const ReportCadenceStats& stats() const { return stats_; }
+
+private:
+    uint32_t minIntervalMs() const;
+
+    uint32_t baseIntervalMs_;
+    uint8_t stretch_;                // heartbeat doublings since the last change
+    bool poorLink_;
+    bool alarmPending_;
+    bool reportedOnce_;
+    uint8_t changedField_;           // 0xFF = nothing past its deadband
+    uint32_t lastReportMs_;
+    CadenceReason pending_;
+    int32_t deadband_[REPORT_CADENCE_MAX_FIELDS];
+    int32_t current_[REPORT_CADENCE_MAX_FIELDS];
+    int32_t reported_[REPORT_CADENCE_MAX_FIELDS];
+    ReportCadenceStats stats_;
+};
+
+#endif // REPORT_CADENCE_H
@@ -0,0 +1,139 @@
+/*
+ * Shared Attribute Cache Implementation
+ */
+
+#include "shared_attributes.h"
+#include "live_config.h"
+#include "../logging/log_buffer.h"
+#include <ArduinoJson.h>
+#include <string.h>
+
+SharedAttributeCache g_sharedAttributes;
+
+SharedAttributeCache::SharedAttributeCache()
+    : version_(0), listenerCount_(0), fetchedOnce_(false), lastFetchOk_(false), lastFetchMs_(0) {
+    memset(&current_, 0, sizeof(current_));
+    memset(listeners_, 0, sizeof(listeners_));
+}
+
+bool SharedAttributeCache::addListener(uint32_t mask, SharedAttrListener fn, void* ctx) {
+    if (!fn || listenerCount_ >= SHARED_ATTR_MAX_LISTENERS) {
+        return false;
+    }
+    listeners_[listenerCount_++] = Listener{mask, fn, ctx};
+    return true;
+}
+
+bool SharedAttributeCache::apply(const char* json, size_t len) {
+    if (!json || len == 0) {
+        return false;
+    }
+    StaticJsonDocument<512> doc;
+    const DeserializationError err = deserializeJson(doc, json, len);
+    if (err) {
+        logbuf_printf("shared: attribute document rejected (%s)", err.c_str());
+        return false;
+    }
+
+    SharedAttributes next = current_;
+    uint32_t changed = 0;
+
+    // A fetch response wraps the values; a push carries them at the top level
+    JsonObject values = doc["shared"].is<JsonObject>() ? doc["shared"].as<JsonObject>() : doc.as<JsonObject>();
+    JsonVariant period = values["report_period_s"];
+    if (period.is<uint32_t>() &&
+        (period.as<uint32_t>() != next.reportPeriodS || !(next.present & SHARED_ATTR_REPORT_PERIOD))) {
+        next.reportPeriodS = period.as<uint32_t>();
+        changed |= SHARED_ATTR_REPORT_PERIOD;
+    }
+    JsonVariant rpm = values["rpm_alert"];
+    if (rpm.is<uint16_t>() && (rpm.as<uint16_t>() != next.rpmAlert || !(next.present & SHARED_ATTR_RPM_ALERT))) {
+        next.rpmAlert = rpm.as<uint16_t>();
+        changed |= SHARED_ATTR_RPM_ALERT;
+    }
+    JsonVariant url = values["ota_url"];
+    if (url.is<const char*>() &&
+        (strncmp(url.as<const char*>(), next.otaUrl, sizeof(next.otaUrl)) != 0 || !(next.present & SHARED_ATTR_OTA_URL))) {
+        strlcpy(next.otaUrl, url.as<const char*>(), sizeof(next.otaUrl));
+        changed |= SHARED_ATTR_OTA_URL;
+    }
+    JsonVariant levels = values["log_levels"];
+    if (levels.is<const char*>() &&
+        (strncmp(levels.as<const char*>(), next.logLevels, sizeof(next.logLevels)) != 0 ||
+         !(next.present & SHARED_ATTR_LOG_LEVELS))) {
+        strlcpy(next.logLevels, levels.as<const char*>(), sizeof(next.logLevels));
+        changed |= SHARED_ATTR_LOG_LEVELS;
+    }
+    JsonVariant uplink = values["log_uplink"];
+    if (uplink.is<const char*>() &&
+        (strncmp(uplink.as<const char*>(), next.logUplink, sizeof(next.logUplink)) != 0 ||
+         !(next.present & SHARED_ATTR_LOG_UPLINK))) {
+        strlcpy(next.logUplink, uplink.as<const char*>(), sizeof(next.logUplink));
+        changed |= SHARED_ATTR_LOG_UPLINK;
+    }
+    JsonVariant capture = values["can_capture"];
+    if (capture.is<const char*>() &&
+        (strncmp(capture.as<const char*>(), next.canCapture, sizeof(next.canCapture)) != 0 ||
+         !(next.present & SHARED_ATTR_CAN_CAPTURE))) {
+        strlcpy(next.canCapture, capture.as<const char*>(), sizeof(next.canCapture));
+        changed |= SHARED_ATTR_CAN_CAPTURE;
+    }
+    next.present |= changed;
+
+    JsonArray deleted = doc["deleted"].as<JsonArray>();
+    for (JsonVariant key : deleted) {
+        const char* name = key.as<const char*>();
+        if (!name) continue;
+        uint32_t bit = 0;
+        if (strcmp(name, "report_period_s") == 0) bit = SHARED_ATTR_REPORT_PERIOD;
+        else if (strcmp(name, "rpm_alert") == 0) bit = SHARED_ATTR_RPM_ALERT;
+        else if (strcmp(name, "ota_url") == 0) bit = SHARED_ATTR_OTA_URL;
+        else if (strcmp(name, "log_levels") == 0) bit = SHARED_ATTR_LOG_LEVELS;
+        else if (strcmp(name, "log_uplink") == 0) bit = SHARED_ATTR_LOG_UPLINK;
+        else if (strcmp(name, "can_capture") == 0) bit = SHARED_ATTR_CAN_CAPTURE;
+        if (next.present & bit) {
+            next.present &= ~bit;
+            changed |= bit;
+        }
+    }
+    if (!(next.present & SHARED_ATTR_REPORT_PERIOD)) next.reportPeriodS = 0;
+    if (!(next.present & SHARED_ATTR_RPM_ALERT)) next.rpmAlert = 0;
+    if (!(next.present & SHARED_ATTR_OTA_URL)) next.otaUrl[0] = '\0';
+    if (!(next.present & SHARED_ATTR_LOG_LEVELS)) next.logLevels[0] = '\0';
+    if (!(next.present & SHARED_ATTR_LOG_UPLINK)) next.logUplink[0] = '\0';
+    if (!(next.present & SHARED_ATTR_CAN_CAPTURE)) next.canCapture[0] = '\0';
+    // Keys the subsystems registered (live_config.h) are applied whether or not a typed field moved
+    live_config_apply(values, deleted);
+
+    if (changed == 0) {
+        return true;
+    }
+    next.version = current_.version + 1;
+    current_ = next;
+    snapshot_.write(current_);
+    version_ = current_.version;
+    logbuf_printf("shared: attributes v%lu (changed 0x%lx)", static_cast<unsigned long>(current_.version),
+                  static_cast<unsigned long>(changed));
+
+    for (uint8_t i = 0; i < listenerCount_; i++) {
+        if (listeners_[i].mask & changed) {
+            listeners_[i].fn(current_, listeners_[i].mask & changed, listeners_[i].ctx);
+        }
+    }
+    return true;
+}
+
+bool SharedAttributeCache::refreshDue(uint32_t now) const {
+    if (!fetchedOnce_) {
+        return lastFetchMs_ == 0 || lastFetchOk_ || (now - lastFetchMs_) >= SHARED_ATTR_RETRY_MS;
+    }
+    return (now - lastFetchMs_) >= (lastFetchOk_ ? SHARED_ATTR_REFRESH_MS : SHARED_ATTR_RETRY_MS);
+}
+
+void SharedAttributeCache::markFetched(uint32_t now, bool ok) {
+    lastFetchMs_ = now ? now : 1;
+    lastFetchOk_ = ok;
+    if (ok) {
+        fetchedOnce_ = true;
+    }
+}
@@ -0,0 +1,95 @@
+/*
+ * Shared Attribute Cache
+ * ThingsBoard shared attributes, parsed once into typed values.
+ *
+ * The CatM task is the only writer: it feeds every attribute document it gets
+ * (the HTTP fetch response {"shared":{...}}, MQTT pushes {...} and deletions
+ * {"deleted":[...]}) through apply(). Readers on any task take a consistent
+ * copy through a seqlock and never touch JSON. A change bumps the version and
+ * runs the listeners registered for the changed fields, on the writer task.
+ * Every document also goes to the live-configuration keys (live_config.h).
+ */
+
+#ifndef SHARED_ATTRIBUTES_H
+#define SHARED_ATTRIBUTES_H
+
+#include <Arduino.h>
+#include "../../system/seqlock.h"
+
+#ifndef SHARED_ATTR_REFRESH_MS
+#define SHARED_ATTR_REFRESH_MS 900000UL     // full re-fetch when no push arrived for this long
+#endif
+#ifndef SHARED_ATTR_RETRY_MS
+#define SHARED_ATTR_RETRY_MS 60000UL        // after a failed fetch
+#endif
+
+#define SHARED_ATTR_OTA_URL_LEN   160
+#define SHARED_ATTR_LOG_LEVELS_LEN 64
+#define SHARED_ATTR_LOG_UPLINK_LEN 24
+#define SHARED_ATTR_CAN_CAPTURE_LEN 24
+#define SHARED_ATTR_MAX_LISTENERS 6
+#define SHARED_ATTR_KEYS          "report_period_s,rpm_alert,ota_url,log_levels,log_uplink,can_capture"
+
+// Field bits for SharedAttributes::present and listener masks
+enum : uint32_t {
+    SHARED_ATTR_REPORT_PERIOD = 1UL << 0,
+    SHARED_ATTR_RPM_ALERT     = 1UL << 1,
+    SHARED_ATTR_OTA_URL       = 1UL << 2,
+    SHARED_ATTR_LOG_LEVELS    = 1UL << 3,
+    SHARED_ATTR_LOG_UPLINK    = 1UL << 4,
+    SHARED_ATTR_CAN_CAPTURE   = 1UL << 5,
+    SHARED_ATTR_ALL           = 0x3F
+};
+
+struct SharedAttributes {
+    uint32_t version;          // bumps on every change; 0 = nothing received yet
+    uint32_t present;          // SHARED_ATTR_* bits of the keys the server has set
+    uint32_t reportPeriodS;
+    uint16_t rpmAlert;
+    char otaUrl[SHARED_ATTR_OTA_URL_LEN];
+    char logLevels[SHARED_ATTR_LOG_LEVELS_LEN];   // per-tag spec, e.g. "CATM=5,UI=1"
+    char logUplink[SHARED_ATTR_LOG_UPLINK_LEN];   // remote log filter, e.g. "WARN" or "CATM"
+    char canCapture[SHARED_ATTR_CAN_CAPTURE_LEN]; // CAN capture to SD: "all", "off" or "<id>/<mask>"
+};
+
+typedef void (*SharedAttrListener)(const SharedAttributes& attrs, uint32_t changed, void* ctx);
+
+class SharedAttributeCache {
+public:
+    SharedAttributeCache();
+
+    // Register during setup, before the writer task starts applying documents
+    bool addListener(uint32_t mask, SharedAttrListener fn, void* ctx);
+
+    // Parses one attribute document; returns false if it is not valid JSON
+    bool apply(const char* json, size_t len);
+
+    void get(SharedAttributes& out) const { snapshot_.read(out); }
+    uint32_t version() const { return version_; }
+
+    // Fetch pacing for the writer task. A push counts as fresh data; invalidate()
+    // after a link loss, since pushes may have been missed meanwhile.
+    bool refreshDue(uint32_t now) const;
+    void markFetched(uint32_t now, bool ok);
+    void invalidate() { fetchedOnce_ = false; }
+
+private:
+    struct Listener {
+        uint32_t mask;
+        SharedAttrListener fn;
+        void* ctx;
+    };
+
+    SeqlockSnapshot<SharedAttributes> snapshot_;
+    SharedAttributes current_;           // writer's copy
+    volatile uint32_t version_;
+    Listener listeners_[SHARED_ATTR_MAX_LISTENERS];
+    uint8_t listenerCount_;
+    bool fetchedOnce_;
+    bool lastFetchOk_;
+    uint32_t lastFetchMs_;
+};
+
+extern SharedAttributeCache g_sharedAttributes;
+
+#endif // SHARED_ATTRIBUTES_H
@@ -0,0 +1,136 @@
+/*
+ * Binary Telemetry Codec Implementation
+ */
+
+#include "telemetry_codec.h"
+#include "../catm_gnss/catm_gnss_module.h"
+#include "../pwrcan/can_generator_protocol.h"
+#include <math.h>
+#include <string.h>
+
+const char* const kTelemetryGnssFields[] = {
+    "t", "lat", "lon", "alt", "spd", "crs", "sat", "valid", "hdop", nullptr
+};
+
+const char* const kTelemetryGeneratorFields[] = {
+    "t", "fuel", "fuel_flt", "oil", "oil_flt", "run_h", "svc", "relays", "di_lo", "di_hi",
+    "fuel_flt_h", "oil_flt_h", "oil_chg_h", nullptr
+};
+
+namespace {
+inline int32_t fixedPoint(double value, double scale) {
+    const double scaled = value * scale;
+    if (scaled >= 2147483647.0) return INT32_MAX;
+    if (scaled <= -2147483648.0) return INT32_MIN;
+    return static_cast<int32_t>(lround(scaled));
+}
+
+inline void putU16(uint8_t* out, uint16_t v) {
+    out[0] = static_cast<uint8_t>(v);
+    out[1] = static_cast<uint8_t>(v >> 8);
+}
+} // namespace
+
+TelemetryEncoder::TelemetryEncoder(uint8_t keyframeInterval)
+    : keyframeInterval_(keyframeInterval ? keyframeInterval : 1) {
+    memset(&gnss_, 0, sizeof(gnss_));
+    memset(&generator_, 0, sizeof(generator_));
+}
+
+void TelemetryEncoder::forceKeyframe() {
+    gnss_.haveKey = false;
+    generator_.haveKey = false;
+}
+
+size_t TelemetryEncoder::putVarint(uint8_t* out, size_t outSize, int32_t value) {
+    // Zigzag so small negative deltas stay one byte
+    uint32_t v = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    size_t n = 0;
+    do {
+        if (n >= outSize) return 0;
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        out[n++] = v ? (b | 0x80) : b;
+    } while (v);
+    return n;
+}
+
+size_t TelemetryEncoder::encode(TelemetrySchema schema, SchemaState& st, const int32_t* fields, size_t count,
+                                uint8_t* out, size_t outSize) {
+    if (!out || count > TELEMETRY_MAX_FIELDS || outSize < 7) {
+        return 0;
+    }
+
+    const bool keyframe = !st.haveKey || st.sinceKey >= keyframeInterval_;
+    const uint16_t seq = st.seq;
+
+    size_t n = 0;
+    out[n++] = TELEMETRY_MAGIC;
+    out[n++] = static_cast<uint8_t>((TELEMETRY_VERSION << 4) | (keyframe ? TELEMETRY_FLAG_KEYFRAME : 0));
+    out[n++] = static_cast<uint8_t>(schema);
+    putU16(out + n, seq);
+    n += 2;
+    if (!keyframe) {
+        putU16(out + n, st.keySeq);
+        n += 2;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        // Wrapping subtraction; the decoder adds back modulo 2^32
+        const int32_t v = keyframe ? fields[i]
+                                   : static_cast<int32_t>(static_cast<uint32_t>(fields[i]) - static_cast<uint32_t>(st.key[i]));
+        const size_t w = putVarint(out + n, outSize - n, v);
+        if (w == 0) {
+            return 0;
+        }
+        n += w;
+    }
+
+    // Commit state only once the frame is complete
+    st.seq++;
+    if (keyframe) {
+        memcpy(st.key, fields, count * sizeof(int32_t));
+        st.keySeq = seq;
+        st.haveKey = true;
+        st.sinceKey = 1;
+    } else {
+        st.sinceKey++;
+    }
+    return n;
+}
+
+size_t TelemetryEncoder::encodeGnss(const GNSSData& fix, uint32_t uptimeS, uint8_t* out, size_t outSize) {
+    const int32_t fields[] = {
+        static_cast<int32_t>(uptimeS),
+        fixedPoint(fix.latitude, 1e7),
+        fixedPoint(fix.longitude, 1e7),
+        fixedPoint(fix.altitude, 10.0),
+        fixedPoint(fix.speed, 10.0),
+        fixedPoint(fix.course, 10.0),
+        fix.satellites,
+        fix.isValid ? 1 : 0,
+        fixedPoint(fix.hdop, 10.0),
+    };
+    return encode(TelemetrySchema::Gnss, gnss_, fields, sizeof(fields) / sizeof(fields[0]), out, outSize);
+}
+
+size_t TelemetryEncoder::encodeGenerator(const CanGeneratorSensors& sensors, const CanGeneratorRuntime& runtime,
+                                         const CanGeneratorRelays& relays, const CanGeneratorFilterHours& filters,
+                                         uint32_t uptimeS, uint8_t* out, size_t outSize) {
+    const int32_t fields[] = {
+        static_cast<int32_t>(uptimeS),
+        sensors.fuelLevel,
+        sensors.fuelFilter,
+        sensors.oilLevel,
+        sensors.oilFilter,
+        static_cast<int32_t>(runtime.totalRunTimeHours),
+        static_cast<int32_t>(runtime.lastServiceTimestamp),
+        relays.relayStates,
+        relays.digitalInputsLow,
+        relays.digitalInputsHigh,
+        static_cast<int32_t>(filters.fuelFilterHours),
+        static_cast<int32_t>(filters.oilFilterHours),
+        static_cast<int32_t>(filters.oilChangeHours),
+    };
+    return encode(TelemetrySchema::Generator, generator_, fields, sizeof(fields) / sizeof(fields[0]), out, outSize);
+}
@@ -0,0 +1,88 @@
+/*
+ * Binary Telemetry Codec
+ * Compact alternative to JSON telemetry for the per-byte billed CatM link.
+ *
+ * Frame layout (little endian):
+ *   [0]    TELEMETRY_MAGIC (0xB7, never a valid first byte of JSON text)
+ *   [1]    version (high nibble) | flags (low nibble, bit0 = keyframe)
+ *   [2]    schema ID (TelemetrySchema)
+ *   [3..4] frame sequence, per schema
+ *   [5..6] sequence of the keyframe this delta is relative to (delta frames only)
+ *   then one zigzag LEB128 varint per schema field, in table order
+ *
+ * Every field is a fixed-point integer (see the schema tables below). A keyframe
+ * carries absolute values; a delta frame carries value minus the keyframe value,
+ * so a delta decodes from its keyframe alone and losing one delta loses nothing
+ * else. A decoder that has not seen the referenced keyframe drops the frame.
+ */
+
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <Arduino.h>
+
+#ifndef TELEMETRY_KEYFRAME_INTERVAL
+#define TELEMETRY_KEYFRAME_INTERVAL 10      // frames per keyframe, per schema
+#endif
+
+#define TELEMETRY_MAGIC          0xB7
+#define TELEMETRY_VERSION        1
+#define TELEMETRY_FLAG_KEYFRAME  0x01
+#define TELEMETRY_MAX_FIELDS     16
+// Header + base sequence + worst-case 5-byte varint per field
+#define TELEMETRY_MAX_FRAME_BYTES (7 + TELEMETRY_MAX_FIELDS * 5)
+
+enum class TelemetrySchema : uint8_t {
+    Gnss = 1,
+    Generator = 2
+};
+
+// Schema 1 (Gnss): uptime_s, lat_e7, lon_e7, alt_dm, speed_dkmh, course_ddeg,
+//                  satellites, valid, hdop_x10
+// Schema 2 (Generator): uptime_s, fuel_level, fuel_filter, oil_level, oil_filter (raw ADC),
+//                  run_hours, last_service, relays, di_low, di_high,
+//                  fuel_filter_h, oil_filter_h, oil_change_h
+extern const char* const kTelemetryGnssFields[];
+extern const char* const kTelemetryGeneratorFields[];
+
+struct GNSSData;
+struct CanGeneratorSensors;
+struct CanGeneratorRuntime;
+struct CanGeneratorRelays;
+struct CanGeneratorFilterHours;
+
+class TelemetryEncoder {
+public:
+    explicit TelemetryEncoder(uint8_t keyframeInterval = TELEMETRY_KEYFRAME_INTERVAL);
+
+    // Encode straight from the producer structs; return the frame length or 0 if out is too small.
+    // Each schema keeps its own state, so different producer tasks may encode concurrently as long
+    // as each schema has a single producer.
+    size_t encodeGnss(const GNSSData& fix, uint32_t uptimeS, uint8_t* out, size_t outSize);
+    size_t encodeGenerator(const CanGeneratorSensors& sensors, const CanGeneratorRuntime& runtime,
+                           const CanGeneratorRelays& relays, const CanGeneratorFilterHours& filters,
+                           uint32_t uptimeS, uint8_t* out, size_t outSize);
+
+    // Next frame of every schema is a keyframe (e.g. after the uplink queue dropped packets)
+    void forceKeyframe();
+
+    static size_t putVarint(uint8_t* out, size_t outSize, int32_t value);
+
+private:
+    struct SchemaState {
+        bool haveKey;
+        uint8_t sinceKey;
+        uint16_t seq;
+        uint16_t keySeq;
+        int32_t key[TELEMETRY_MAX_FIELDS];
+    };
+
+    size_t encode(TelemetrySchema schema, SchemaState& st, const int32_t* fields, size_t count,
+                  uint8_t* out, size_t outSize);
+
+    uint8_t keyframeInterval_;
+    SchemaState gnss_;
+    SchemaState generator_;
+};
+
+#endif // TELEMETRY_CODEC_H
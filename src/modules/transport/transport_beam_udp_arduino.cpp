@@ -1,8 +1,16 @@
 #include "transport.h"
+#include "transport_spill.h"
+#include "data_usage.h"
+#if TRANSPORT_COMPRESS_ENABLE
+#include "lzss.h"
+#endif
 #include "../logging/log_buffer.h"
+#include "../../system/kernel_objects.h"
+#include "../../system/metrics.h"
 
 #include <algorithm>
 #include <cstring>
+#include <new>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
@@ -22,24 +30,113 @@
 #define TRANSPORT_HAS_TINYGSM 0
 #endif
 
+#if __has_include(<M5_SIM7080G.h>)
+#include <M5_SIM7080G.h>
+#define TRANSPORT_HAS_MODEM_SOCKET 1
+#else
+#define TRANSPORT_HAS_MODEM_SOCKET 0
+#endif
+
 namespace {
+// Queue entries sit in a ring in allocation order; their payloads live in one byte arena
+// that is used as a ring as well. Entries finish out of order (coalescing, retries), so a
+// finished entry is only marked Done, and its bytes come back once every older entry has
+// finished too.
+enum class EntryState : uint8_t {
+    Free = 0,
+    Reserved,      // handed to a producer that is serializing in place
+    Queued,
+    InFlight,      // in the datagram being sent, or being spilled; pinned until it completes
+    AwaitingAck,   // sent with TRANSPORT_RELIABLE_ENABLE, pinned until the ACK settles it
+    Done
+};
+
 struct PendingPacket {
-    bool inUse = false;
+    EntryState state = EntryState::Free;
     TransportPacketKind kind = TransportPacketKind::Telemetry;
-    size_t length = 0;
+    TransportPriority priority = TransportPriority::Telemetry;
     uint8_t attempts = 0;          // completed attempts
+    uint16_t offset = 0;           // payload position in gArena
+    uint16_t reserved = 0;         // arena bytes held
+    uint16_t length = 0;
     uint32_t firstQueuedAtMs = 0;
     uint32_t nextSendAtMs = 0;
-    char payload[TRANSPORT_MAX_PACKET_BYTES];
+    uint32_t deadlineAtMs = 0;     // 0 = none
+    uint16_t ackSeq = 0;           // datagram sequence while AwaitingAck
 };
 
+static_assert(TRANSPORT_ARENA_BYTES <= 0xFFFF, "arena offsets are 16-bit");
+static_assert(TRANSPORT_MAX_PACKET_BYTES <= TRANSPORT_ARENA_BYTES, "a packet must fit the arena");
+
 constexpr uint32_t kMaxBackoffMs = 60000UL;
 
 TransportConfig gConfig = transport_makeDefaultConfig();
 TransportStats gStats;
 PendingPacket gQueue[TRANSPORT_QUEUE_DEPTH];
-size_t gQueueCount = 0;
+size_t gRingTail = 0;              // oldest entry not yet reclaimed
+size_t gRingCount = 0;
+uint8_t gArena[TRANSPORT_ARENA_BYTES];
+size_t gArenaHead = 0;             // where the next payload goes
 SemaphoreHandle_t gQueueMutex = nullptr;
+SemaphoreHandle_t gProcessMutex = nullptr;   // one task builds and sends datagrams at a time
+uint8_t gDatagram[TRANSPORT_MAX_DATAGRAM_BYTES];
+
+// gStats in the metrics registry; word-sized reads need no lock
+MetricCounter gMetricQueued("tx.queued", [] { return gStats.queued; });
+MetricCounter gMetricSent("tx.sent", [] { return gStats.sent; });
+MetricCounter gMetricRetries("tx.retries", [] { return gStats.retries; });
+MetricCounter gMetricDropped("tx.dropped", [] { return gStats.dropped; });
+MetricCounter gMetricFailed("tx.failed", [] { return gStats.failed; });
+MetricCounter gMetricDatagrams("tx.datagrams", [] { return gStats.datagrams; });
+MetricCounter gMetricSpilled("tx.spilled", [] { return gStats.spilled; });
+MetricCounter gMetricFailovers("tx.failovers", [] { return gStats.failovers; });
+MetricCounter gMetricAlarmLate("tx.alarm_late", [] {
+    return gStats.classes[static_cast<size_t>(TransportPriority::Alarm)].late;
+});
+MetricGauge gMetricPending("tx.pending_b", [] { return static_cast<int32_t>(transport_pendingBytes()); });
+
+#if TRANSPORT_SPILL_ENABLE
+TransportSpill gSpill;
+bool gLinkHealthy = true;          // result of the last datagram; spill drains only while it holds
+uint32_t gLastSpillDrainMs = 0;
+#endif
+
+#if TRANSPORT_RELIABLE_ENABLE
+constexpr uint8_t kReliableMagic = 0xA7;
+constexpr uint8_t kReliableFlagAckRequest = 0x01;
+constexpr uint8_t kReliableFlagSessionStart = 0x02;   // until the first ACK: receiver resets its window
+constexpr size_t kReliableHeaderBytes = 4;
+
+struct OutstandingDatagram {
+    bool used = false;
+    uint16_t seq = 0;
+    TransportPathId path = TransportPathId::ModemUdp;
+    uint32_t sentAtMs = 0;
+};
+
+// Touched only by the task holding gProcessMutex
+OutstandingDatagram gOutstanding[TRANSPORT_ACK_WINDOW];
+uint16_t gNextSeq = 0;
+bool gSessionAcked = false;
+MetricCounter gMetricAcked("tx.acked", [] { return gStats.acked; });
+MetricCounter gMetricAckTimeouts("tx.ack_timeouts", [] { return gStats.ackTimeouts; });
+MetricHistogram gMetricAckRtt("tx.ack_rtt_ms", MetricUnit::Ms);   // send to ACK
+
+size_t outstandingCount() {
+    size_t n = 0;
+    for (const auto& o : gOutstanding) {
+        n += o.used ? 1 : 0;
+    }
+    return n;
+}
+#endif
+
+#if TRANSPORT_COMPRESS_ENABLE
+constexpr uint8_t kCompressMagic = 0xC5;
+constexpr uint8_t kCompressVersionMethod = 0x10;       // version 1, method 0 = LZSS 10-bit window
+constexpr size_t kCompressHeaderBytes = 4;
+uint8_t gCompressed[TRANSPORT_MAX_DATAGRAM_BYTES];
+#endif
 
 #if TRANSPORT_HAS_WIFIUDP
 WiFiUDP* gWifiUdp = nullptr;
@@ -51,6 +148,36 @@ TinyGsm* gTinyGsm = nullptr;
 TinyGsmUDP* gTinyGsmUdp = nullptr;
 #endif
 
+#if TRANSPORT_HAS_MODEM_SOCKET
+// Constructed in place on attach; the socket wrapper needs the modem reference
+alignas(SIM7080G_Socket) uint8_t gModemSocketStorage[sizeof(SIM7080G_Socket)];
+SIM7080G_Socket* gModemSocket = nullptr;
+SemaphoreHandle_t gModemMutex = nullptr;
+bool gModemSocketStale = false;    // Beam host/port changed since the socket was opened
+// Beam host address cache; CAOPEN goes to the address so the modem does not resolve per open
+alignas(SIM7080G_Dns) uint8_t gDnsStorage[sizeof(SIM7080G_Dns)];
+SIM7080G_Dns* gDns = nullptr;
+#endif
+
+struct RouterPath {
+    TransportPathSendFn fn = nullptr;  // external paths only; UDP paths are built in
+    void* ctx = nullptr;
+    uint8_t kindMask = 0xFF;
+    uint16_t overheadBytes = TRANSPORT_UDP_OVERHEAD_BYTES;
+    uint32_t retryAtMs = 0;            // cooling down until then; 0 = usable
+};
+
+RouterPath gPaths[TRANSPORT_PATH_COUNT];
+TransportQueuedFn gQueuedFn = nullptr;
+void* gQueuedCtx = nullptr;
+
+void notifyQueued() {
+    const TransportQueuedFn fn = gQueuedFn;
+    if (fn) {
+        fn(gQueuedCtx);
+    }
+}
+
 inline void copyString(char* dest, size_t destSize, const char* src) {
     if (!dest || destSize == 0) {
         return;
@@ -67,15 +194,16 @@ inline void copyString(char* dest, size_t destSize, const char* src) {
     dest[len] = '\0';
 }
 
-uint32_t computeBackoffMs(uint8_t attemptNumber) {
+uint32_t computeBackoffMs(uint8_t attemptNumber, TransportPriority priority) {
     // attemptNumber starts at 1 for first retry
     if (attemptNumber == 0) {
         return 0;
     }
+    const uint32_t cap = priority == TransportPriority::Alarm ? TRANSPORT_ALARM_MAX_BACKOFF_MS : kMaxBackoffMs;
     uint32_t factor = 1UL << std::min<uint8_t>(attemptNumber - 1, 5);
     uint32_t base = gConfig.baseRetryDelayMs * factor;
-    if (base > kMaxBackoffMs) {
-        base = kMaxBackoffMs;
+    if (base > cap) {
+        base = cap;
     }
     long jitter = 0;
     if (gConfig.jitterMs > 0) {
@@ -89,108 +217,746 @@ uint32_t computeBackoffMs(uint8_t attemptNumber) {
     return static_cast<uint32_t>(result);
 }
 
-PendingPacket* findOldestPacketLocked() {
-    PendingPacket* oldest = nullptr;
-    for (auto& pkt : gQueue) {
-        if (!pkt.inUse) {
-            continue;
+inline PendingPacket& entryAt(size_t i) {
+    return gQueue[(gRingTail + i) % TRANSPORT_QUEUE_DEPTH];
+}
+
+inline uint8_t* entryData(const PendingPacket& pkt) {
+    return gArena + pkt.offset;
+}
+
+inline TransportPriority defaultPriority(TransportPacketKind kind) {
+    return kind == TransportPacketKind::Attributes ? TransportPriority::Attributes : TransportPriority::Telemetry;
+}
+
+inline TransportClassStats& classStats(TransportPriority priority) {
+    return gStats.classes[static_cast<size_t>(priority)];
+}
+
+inline bool isPending(const PendingPacket& pkt) {
+    return pkt.state == EntryState::Queued || pkt.state == EntryState::InFlight ||
+           pkt.state == EntryState::AwaitingAck;
+}
+
+void reclaimLocked() {
+    while (gRingCount > 0 && gQueue[gRingTail].state == EntryState::Done) {
+        gQueue[gRingTail] = PendingPacket();
+        gRingTail = (gRingTail + 1) % TRANSPORT_QUEUE_DEPTH;
+        gRingCount--;
+    }
+    if (gRingCount == 0) {
+        gArenaHead = 0;
+    }
+}
+
+inline void finishLocked(PendingPacket& pkt) {
+    pkt.state = EntryState::Done;
+    reclaimLocked();
+}
+
+size_t arenaFreeLocked() {
+    if (gRingCount == 0) {
+        return TRANSPORT_ARENA_BYTES;
+    }
+    const size_t tail = gQueue[gRingTail].offset;
+    return gArenaHead > tail ? (TRANSPORT_ARENA_BYTES - gArenaHead) + tail : tail - gArenaHead;
+}
+
+// Contiguous space for len bytes after the newest payload, wrapping to the start of the
+// arena when the end is too short. nullptr when the ring or the arena is full.
+PendingPacket* allocLocked(size_t len) {
+    reclaimLocked();
+    if (len == 0 || len > TRANSPORT_ARENA_BYTES || gRingCount >= TRANSPORT_QUEUE_DEPTH) {
+        return nullptr;
+    }
+    size_t offset = 0;
+    if (gRingCount > 0) {
+        const size_t tail = gQueue[gRingTail].offset;
+        if (gArenaHead > tail) {
+            if (TRANSPORT_ARENA_BYTES - gArenaHead >= len) {
+                offset = gArenaHead;
+            } else if (tail >= len) {
+                offset = 0;
+            } else {
+                return nullptr;
+            }
+        } else if (tail - gArenaHead >= len) {
+            // Wrapped: only [head, tail) is free, and head == tail means full
+            offset = gArenaHead;
+        } else {
+            return nullptr;
         }
-        if (!oldest || (int32_t)(pkt.firstQueuedAtMs - oldest->firstQueuedAtMs) < 0) {
+    }
+    PendingPacket& pkt = gQueue[(gRingTail + gRingCount) % TRANSPORT_QUEUE_DEPTH];
+    pkt = PendingPacket();
+    pkt.offset = static_cast<uint16_t>(offset);
+    pkt.reserved = static_cast<uint16_t>(len);
+    gArenaHead = offset + len;
+    gRingCount++;
+    return &pkt;
+}
+
+inline bool isNewestLocked(const PendingPacket& pkt) {
+    return gRingCount > 0 && &entryAt(gRingCount - 1) == &pkt;
+}
+
+void commitLocked(PendingPacket& pkt, size_t len, TransportPriority priority) {
+    // Give back the unused tail of the reservation if nothing was allocated after it
+    if (isNewestLocked(pkt) && gArenaHead == static_cast<size_t>(pkt.offset) + pkt.reserved) {
+        gArenaHead = pkt.offset + len;
+        pkt.reserved = static_cast<uint16_t>(len);
+    }
+    const uint32_t now = millis();
+    const uint32_t deadline = gConfig.deadlineMs[static_cast<size_t>(priority)];
+    pkt.length = static_cast<uint16_t>(len);
+    pkt.priority = priority;
+    pkt.attempts = 0;
+    pkt.firstQueuedAtMs = now;
+    pkt.nextSendAtMs = 0;
+    pkt.deadlineAtMs = deadline ? ((now + deadline) | 1) : 0;   // keep 0 meaning "none"
+    pkt.state = EntryState::Queued;
+}
+
+void abortLocked(PendingPacket& pkt) {
+    if (isNewestLocked(pkt)) {
+        gArenaHead = pkt.offset;
+        pkt = PendingPacket();
+        gRingCount--;
+        reclaimLocked();
+        return;
+    }
+    finishLocked(pkt);
+}
+
+// Moves the entry to the SD spill when possible, otherwise drops it. The entry is pinned
+// (InFlight) by the caller, so its payload stays valid with the queue unlocked.
+void evictEntry(PendingPacket& pkt) {
+    bool spilled = false;
+#if TRANSPORT_SPILL_ENABLE
+    spilled = pkt.priority != TransportPriority::Diagnostic && gSpill.ensureReady() &&
+              gSpill.push(pkt.kind, entryData(pkt), pkt.length);
+#endif
+    if (!spilled) {
+        LOGF("transport: dropping oldest packet after %lums", static_cast<unsigned long>(millis() - pkt.firstQueuedAtMs));
+    }
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    if (spilled) {
+        gStats.spilled++;
+    } else {
+        gStats.dropped++;
+        classStats(pkt.priority).lost++;
+    }
+    finishLocked(pkt);
+    xSemaphoreGive(gQueueMutex);
+}
+
+// Reserves len arena bytes. When full and allowEvict, the oldest queued entries are moved
+// out (spilled or dropped) until it fits; an in-flight or reserved oldest entry pins the
+// arena tail, and then the reservation fails instead. Only an alarm may push out an alarm,
+// and a diagnostic record only another diagnostic record.
+PendingPacket* reserveEntry(TransportPacketKind kind, size_t len, bool allowEvict, TransportPriority priority) {
+    if (!gQueueMutex || len == 0 || len > TRANSPORT_MAX_PACKET_BYTES) {
+        return nullptr;
+    }
+    for (;;) {
+        if (xSemaphoreTake(gQueueMutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+            return nullptr;
+        }
+        PendingPacket* pkt = allocLocked(len);
+        if (pkt) {
+            pkt->state = EntryState::Reserved;
+            pkt->kind = kind;
+            pkt->priority = priority;
+            xSemaphoreGive(gQueueMutex);
+            return pkt;
+        }
+        PendingPacket* victim = nullptr;
+        if (allowEvict && gRingCount > 0 && entryAt(0).state == EntryState::Queued &&
+            (entryAt(0).priority != TransportPriority::Alarm || priority == TransportPriority::Alarm) &&
+            (priority != TransportPriority::Diagnostic || entryAt(0).priority == TransportPriority::Diagnostic)) {
+            victim = &entryAt(0);
+            victim->state = EntryState::InFlight;
+        }
+        xSemaphoreGive(gQueueMutex);
+        if (!victim) {
+            return nullptr;
+        }
+        evictEntry(*victim);
+    }
+}
+
+PendingPacket* findOldestPendingLocked() {
+    PendingPacket* oldest = nullptr;
+    for (size_t i = 0; i < gRingCount; i++) {
+        PendingPacket& pkt = entryAt(i);
+        if (isPending(pkt) && (!oldest || (int32_t)(pkt.firstQueuedAtMs - oldest->firstQueuedAtMs) < 0)) {
             oldest = &pkt;
         }
     }
     return oldest;
 }
 
-bool enqueueInternal(const PendingPacket& packet, bool isRetry) {
+inline bool isDueLocked(const PendingPacket& pkt, uint32_t now) {
+    return pkt.state == EntryState::Queued && (pkt.nextSendAtMs == 0 || (int32_t)(now - pkt.nextSendAtMs) >= 0);
+}
+
+// Send order: alarms first, then earliest deadline, then records without a deadline,
+// then diagnostics; oldest first among equals. Only due records compete, so a record
+// backing off never holds up one behind it.
+bool sendsBefore(const PendingPacket& a, const PendingPacket& b) {
+    const bool aAlarm = a.priority == TransportPriority::Alarm;
+    if (aAlarm != (b.priority == TransportPriority::Alarm)) {
+        return aAlarm;
+    }
+    const bool aDiag = a.priority == TransportPriority::Diagnostic;
+    if (aDiag != (b.priority == TransportPriority::Diagnostic)) {
+        return !aDiag;
+    }
+    if ((a.deadlineAtMs != 0) != (b.deadlineAtMs != 0)) {
+        return a.deadlineAtMs != 0;
+    }
+    if (a.deadlineAtMs != b.deadlineAtMs) {
+        return (int32_t)(a.deadlineAtMs - b.deadlineAtMs) < 0;
+    }
+    return (int32_t)(a.firstQueuedAtMs - b.firstQueuedAtMs) < 0;
+}
+
+inline bool canShareDatagram(const PendingPacket& a, const PendingPacket& b) {
+    return a.kind == b.kind && a.priority == b.priority;
+}
+
+// Next due record, or with like set, the next one that may share like's datagram
+PendingPacket* findNextDueLocked(uint32_t now, const PendingPacket* like) {
+    PendingPacket* candidate = nullptr;
+    for (size_t i = 0; i < gRingCount; i++) {
+        PendingPacket& pkt = entryAt(i);
+        if (!isDueLocked(pkt, now) || (like && !canShareDatagram(pkt, *like))) {
+            continue;
+        }
+        if (!candidate || sendsBefore(pkt, *candidate)) {
+            candidate = &pkt;
+        }
+    }
+    return candidate;
+}
+
+inline bool isJsonObject(const uint8_t* data, size_t len) {
+    return len > 2 && data[0] == '{' && data[len - 1] == '}';
+}
+
+// Datagram length once pkt joins as record number `records` a datagram currently `used`
+// bytes long, or 0 if it can't join. JSON telemetry records form one array, attribute
+// objects merge into one object, and binary frames are self-delimiting, so they just
+// concatenate.
+size_t joinedLength(const PendingPacket& first, const PendingPacket& pkt, size_t records, size_t used) {
+    if (records == 0) {
+        return pkt.length;
+    }
+    switch (pkt.kind) {
+        case TransportPacketKind::Telemetry:
+            return used + pkt.length + (records == 1 ? 3 : 1);   // "[a,b]" then ",c"
+        case TransportPacketKind::Attributes:
+            if (!isJsonObject(entryData(first), first.length) || !isJsonObject(entryData(pkt), pkt.length)) {
+                return 0;
+            }
+            return used + pkt.length - 1;                        // '}' of the previous becomes ','
+        default:
+            return used + pkt.length;
+    }
+}
+
+size_t writeDatagram(PendingPacket* const* slots, size_t count) {
+    const TransportPacketKind kind = slots[0]->kind;
+    size_t n = 0;
+    if (kind == TransportPacketKind::Telemetry) {
+        gDatagram[n++] = '[';
+    }
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* src = entryData(*slots[i]);
+        size_t len = slots[i]->length;
+        if (kind == TransportPacketKind::Attributes) {
+            // {"a":1} + {"b":2} -> {"a":1,"b":2}; a repeated key resolves as it would across packets
+            if (i > 0) {
+                src++;
+                len--;
+            }
+            if (i + 1 < count) {
+                len--;
+            }
+        }
+        if (i > 0 && kind != TransportPacketKind::TelemetryBinary) {
+            gDatagram[n++] = ',';
+        }
+        memcpy(gDatagram + n, src, len);
+        n += len;
+    }
+    if (kind == TransportPacketKind::Telemetry) {
+        gDatagram[n++] = ']';
+    }
+    return n;
+}
+
+// Picks the first due record in send order plus the due records that may share its
+// datagram, and pins them in flight. A lone record is handed out straight from the arena;
+// only a coalesced datagram is assembled in gDatagram. Fresh records are held back while
+// everything due still fits in one datagram and the first has waited less than maxHoldMs,
+// unless it is an alarm or already past its deadline.
+size_t buildDatagram(PendingPacket** slots, const uint8_t*& data, size_t& length) {
     if (!gQueueMutex) {
-        return false;
+        return 0;
     }
     if (xSemaphoreTake(gQueueMutex, pdMS_TO_TICKS(5)) != pdTRUE) {
-        return false;
+        return 0;
+    }
+
+    const uint32_t now = millis();
+    PendingPacket* head = findNextDueLocked(now, nullptr);
+#if TRANSPORT_RELIABLE_ENABLE
+    if (outstandingCount() >= TRANSPORT_ACK_WINDOW) {
+        head = nullptr;
+    }
+    const size_t mtu = std::min<size_t>(gConfig.mtuBytes, TRANSPORT_MAX_DATAGRAM_BYTES) - kReliableHeaderBytes;
+#else
+    const size_t mtu = std::min<size_t>(gConfig.mtuBytes, TRANSPORT_MAX_DATAGRAM_BYTES);
+#endif
+    if (!head) {
+        xSemaphoreGive(gQueueMutex);
+        return 0;
+    }
+
+    const bool urgent = head->priority == TransportPriority::Alarm ||
+                        (head->deadlineAtMs != 0 && (int32_t)(now - head->deadlineAtMs) >= 0);
+    if (!urgent && gConfig.maxHoldMs > 0 && head->attempts == 0 && (now - head->firstQueuedAtMs) < gConfig.maxHoldMs) {
+        size_t bytes = 0;
+        for (size_t i = 0; i < gRingCount; i++) {
+            const PendingPacket& pkt = entryAt(i);
+            if (isDueLocked(pkt, now) && canShareDatagram(pkt, *head)) {
+                bytes += pkt.length + 1;
+            }
+        }
+        if (bytes < mtu) {
+            xSemaphoreGive(gQueueMutex);
+            return 0;
+        }
     }
 
-    PendingPacket* slot = nullptr;
-    for (auto& pkt : gQueue) {
-        if (!pkt.inUse) {
-            slot = &pkt;
+    size_t count = 0;
+    size_t used = 0;
+    PendingPacket* pkt = head;
+    while (pkt) {
+        const size_t next = joinedLength(*head, *pkt, count, used);
+        if (count > 0 && (next == 0 || next > mtu)) {
             break;
         }
+        used = next;
+        pkt->state = EntryState::InFlight;
+        slots[count++] = pkt;
+        pkt = findNextDueLocked(now, head);
     }
 
-    if (!slot) {
-        PendingPacket* oldest = findOldestPacketLocked();
-        if (oldest) {
-            logbuf_printf("transport: dropping oldest packet after %lums", static_cast<unsigned long>(millis() - oldest->firstQueuedAtMs));
-            gStats.dropped++;
-            *oldest = PendingPacket();
-            slot = oldest;
-            if (gQueueCount > 0) {
-                gQueueCount--;
+    if (count == 1) {
+        data = entryData(*head);
+        length = head->length;
+    } else {
+        length = writeDatagram(slots, count);
+        data = gDatagram;
+    }
+
+    xSemaphoreGive(gQueueMutex);
+    return count;
+}
+
+// Settles one attempt of each record. A failed record keeps its own attempt count and
+// backoff (none with retryNow, for a gap an ACK has already exposed); records out of
+// attempts stay pinned while they are spilled.
+void settleRecords(PendingPacket** slots, size_t count, bool delivered, bool retryNow) {
+    if (!gQueueMutex || xSemaphoreTake(gQueueMutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    PendingPacket* exhausted[TRANSPORT_QUEUE_DEPTH];
+    size_t exhaustedCount = 0;
+    const uint32_t now = millis();
+    for (size_t i = 0; i < count; i++) {
+        PendingPacket& pkt = *slots[i];
+        if (delivered) {
+            TransportClassStats& cls = classStats(pkt.priority);
+            const uint32_t latency = now - pkt.firstQueuedAtMs;
+            gStats.sent++;
+            cls.sent++;
+            if (latency > cls.maxLatencyMs) {
+                cls.maxLatencyMs = latency;
             }
+            if (pkt.deadlineAtMs != 0 && (int32_t)(now - pkt.deadlineAtMs) > 0) {
+                cls.late++;
+            }
+            pkt.state = EntryState::Done;
+            continue;
+        }
+        pkt.attempts++;
+        if (pkt.attempts < gConfig.maxAttempts) {
+            pkt.state = EntryState::Queued;
+            pkt.nextSendAtMs = retryNow ? 0 : now + computeBackoffMs(pkt.attempts, pkt.priority);
+            gStats.retries++;
         } else {
-            xSemaphoreGive(gQueueMutex);
+            exhausted[exhaustedCount++] = &pkt;
+        }
+    }
+    reclaimLocked();
+    xSemaphoreGive(gQueueMutex);
+
+    if (exhaustedCount == 0) {
+        return;
+    }
+    bool spilled[TRANSPORT_QUEUE_DEPTH] = {};
+#if TRANSPORT_SPILL_ENABLE
+    for (size_t i = 0; i < exhaustedCount; i++) {
+        spilled[i] = gSpill.push(exhausted[i]->kind, entryData(*exhausted[i]), exhausted[i]->length);
+    }
+#endif
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    for (size_t i = 0; i < exhaustedCount; i++) {
+        PendingPacket& pkt = *exhausted[i];
+        if (spilled[i]) {
+            gStats.spilled++;
+        } else {
+            gStats.failed++;
+            classStats(pkt.priority).lost++;
+            LOGF("transport: dropping packet after %u attempts", static_cast<unsigned>(pkt.attempts));
+        }
+        pkt.state = EntryState::Done;
+    }
+    reclaimLocked();
+    xSemaphoreGive(gQueueMutex);
+}
+
+inline bool isUdpPath(TransportPathId id) {
+    return id == TransportPathId::ModemUdp || id == TransportPathId::TinyGsmUdp || id == TransportPathId::WifiUdp;
+}
+
+bool pathAvailable(TransportPathId id, TransportPacketKind kind) {
+    const RouterPath& path = gPaths[static_cast<size_t>(id)];
+    if (!(path.kindMask & (1U << static_cast<uint8_t>(kind)))) {
+        return false;
+    }
+    switch (id) {
+#if TRANSPORT_HAS_MODEM_SOCKET
+        case TransportPathId::ModemUdp:
+            return gModemSocket != nullptr;
+#endif
+#if TRANSPORT_HAS_TINYGSM
+        case TransportPathId::TinyGsmUdp:
+            return gTinyGsmUdp != nullptr;
+#endif
+#if TRANSPORT_HAS_WIFIUDP
+        case TransportPathId::WifiUdp:
+            return gWifiUdp != nullptr;
+#endif
+        case TransportPathId::Mqtt:
+        case TransportPathId::Http:
+            return path.fn != nullptr;
+        default:
             return false;
+    }
+}
+
+uint32_t pathScore(TransportPathId id, TransportPriority priority, size_t len) {
+    const size_t i = static_cast<size_t>(id);
+    const TransportPathStats& st = gStats.paths[i];
+    const uint32_t success = st.successPermille < 50 ? 50 : st.successPermille;
+    uint64_t score = (static_cast<uint64_t>(len) + gPaths[i].overheadBytes) * 1000 / success;
+    score += static_cast<uint64_t>(st.latencyMs) * (priority == TransportPriority::Alarm ? 4 : 1) /
+             TRANSPORT_ROUTER_MS_PER_BYTE;
+    return score > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : static_cast<uint32_t>(score);
+}
+
+// Usable paths for this datagram, cheapest first; a cooling-down path is left out
+size_t rankPaths(TransportPacketKind kind, TransportPriority priority, size_t len, uint32_t now,
+                 TransportPathId* order) {
+    uint32_t scores[TRANSPORT_PATH_COUNT];
+    size_t n = 0;
+    for (size_t i = 0; i < TRANSPORT_PATH_COUNT; i++) {
+        const TransportPathId id = static_cast<TransportPathId>(i);
+        const RouterPath& path = gPaths[i];
+        if (!pathAvailable(id, kind) || (path.retryAtMs != 0 && (int32_t)(now - path.retryAtMs) < 0)) {
+            continue;
         }
+        const uint32_t score = pathScore(id, priority, len);
+        size_t at = n++;
+        while (at > 0 && scores[at - 1] > score) {
+            scores[at] = scores[at - 1];
+            order[at] = order[at - 1];
+            at--;
+        }
+        scores[at] = score;
+        order[at] = id;
     }
+    return n;
+}
 
-    *slot = packet;
-    slot->inUse = true;
-    gQueueCount++;
-    if (isRetry) {
-        gStats.retries++;
-    } else {
-        gStats.queued++;
+void notePathFailure(TransportPathId id) {
+    const size_t i = static_cast<size_t>(id);
+    TransportPathStats& st = gStats.paths[i];
+    st.failures++;
+    st.successPermille = static_cast<uint16_t>((st.successPermille * 7U) / 8U);
+    if (st.consecutiveFailures < 0xFF) {
+        st.consecutiveFailures++;
     }
+    if (st.consecutiveFailures >= TRANSPORT_PATH_FAIL_LIMIT) {
+        const uint8_t doublings = std::min<uint8_t>(st.consecutiveFailures - TRANSPORT_PATH_FAIL_LIMIT, 8);
+        const uint32_t cooldown = std::min<uint32_t>(TRANSPORT_PATH_COOLDOWN_MS << doublings, TRANSPORT_PATH_MAX_COOLDOWN_MS);
+        gPaths[i].retryAtMs = (millis() + cooldown) | 1;
+        if (st.healthy) {
+            LOGF("transport: path %u unhealthy after %u failures", static_cast<unsigned>(i),
+                          static_cast<unsigned>(st.consecutiveFailures));
+        }
+        st.healthy = false;
+    }
+}
 
+void recordPathResult(TransportPathId id, bool ok, uint32_t latencyMs, size_t len) {
+    const size_t i = static_cast<size_t>(id);
+    TransportPathStats& st = gStats.paths[i];
+    st.attempts++;
+    st.bytes += len + gPaths[i].overheadBytes;
+    if (!ok) {
+        notePathFailure(id);
+        return;
+    }
+    st.successes++;
+    st.successPermille = static_cast<uint16_t>((st.successPermille * 7U + 1000U) / 8U);
+    st.latencyMs = st.successes == 1 ? latencyMs : (st.latencyMs * 7U + latencyMs) / 8U;
+    st.consecutiveFailures = 0;
+    if (!st.healthy) {
+        LOGF("transport: path %u healthy again", static_cast<unsigned>(i));
+    }
+    st.healthy = true;
+    gPaths[i].retryAtMs = 0;
+}
+
+#if TRANSPORT_RELIABLE_ENABLE
+OutstandingDatagram* trackDatagram(uint16_t seq, TransportPathId path) {
+    for (auto& o : gOutstanding) {
+        if (!o.used) {
+            o.used = true;
+            o.seq = seq;
+            o.path = path;
+            o.sentAtMs = millis();
+            return &o;
+        }
+    }
+    return nullptr;
+}
+
+// Settles every record that went out in datagram seq
+void settleDatagram(OutstandingDatagram& o, bool delivered, bool retryNow) {
+    PendingPacket* slots[TRANSPORT_QUEUE_DEPTH];
+    size_t count = 0;
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    for (size_t i = 0; i < gRingCount; i++) {
+        PendingPacket& pkt = entryAt(i);
+        if (pkt.state == EntryState::AwaitingAck && pkt.ackSeq == o.seq) {
+            slots[count++] = &pkt;
+        }
+    }
     xSemaphoreGive(gQueueMutex);
-    return true;
+    o.used = false;
+    if (delivered) {
+        gStats.acked++;
+        gMetricAckRtt.record(millis() - o.sentAtMs);
+    }
+    settleRecords(slots, count, delivered, retryNow);
 }
 
-bool dequeueReadyPacket(PendingPacket& outPacket) {
-    if (!gQueueMutex) {
+// "#A<cum>:<mask>" in hex: every seq up to cum arrived, and mask bit i reports cum + 2 + i
+// (cum + 1 is missing by definition).
+bool parseAck(const char* text, uint16_t& cum, uint32_t& mask) {
+    if (text[0] != '#' || text[1] != 'A') {
         return false;
     }
-    if (xSemaphoreTake(gQueueMutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+    char* end = nullptr;
+    const unsigned long c = strtoul(text + 2, &end, 16);
+    if (!end || end == text + 2 || *end != ':' || c > 0xFFFF) {
+        return false;
+    }
+    const char* maskText = end + 1;
+    mask = static_cast<uint32_t>(strtoul(maskText, &end, 16));
+    if (end == maskText) {
         return false;
     }
+    cum = static_cast<uint16_t>(c);
+    return true;
+}
 
-    uint32_t now = millis();
-    PendingPacket* candidate = nullptr;
-    for (auto& pkt : gQueue) {
-        if (!pkt.inUse) {
-            continue;
+void handleAck(const char* text) {
+    uint16_t cum = 0;
+    uint32_t mask = 0;
+    if (!parseAck(text, cum, mask)) {
+        return;
+    }
+    // Ignore an ACK for sequence numbers not sent yet (e.g. a stale session)
+    if ((int16_t)(cum - static_cast<uint16_t>(gNextSeq - 1)) > 0) {
+        return;
+    }
+    gSessionAcked = true;
+
+    uint16_t highest = cum;
+    for (uint8_t bit = 0; bit < 32; bit++) {
+        if (mask & (1UL << bit)) {
+            highest = static_cast<uint16_t>(cum + 2 + bit);
         }
-        if (pkt.nextSendAtMs != 0 && (int32_t)(now - pkt.nextSendAtMs) < 0) {
+    }
+    for (auto& o : gOutstanding) {
+        if (!o.used) {
             continue;
         }
-        if (!candidate || (int32_t)(pkt.firstQueuedAtMs - candidate->firstQueuedAtMs) < 0) {
-            candidate = &pkt;
+        const int16_t past = (int16_t)(o.seq - cum);
+        const bool acked = past <= 0 || (past >= 2 && past < 34 && (mask & (1UL << (past - 2))));
+        if (acked) {
+            settleDatagram(o, true, false);
+        } else if ((int16_t)(highest - o.seq) > 0) {
+            // Something sent later arrived: this one was lost, resend it without waiting
+            gStats.ackGaps++;
+            settleDatagram(o, false, true);
         }
     }
+}
 
-    if (!candidate) {
-        xSemaphoreGive(gQueueMutex);
-        return false;
+int receiveAck(char* out, size_t outSize) {
+#if TRANSPORT_HAS_MODEM_SOCKET
+    if (gModemSocket && gModemSocket->isOpen() &&
+        (!gModemMutex || xSemaphoreTake(gModemMutex, pdMS_TO_TICKS(50)) == pdTRUE)) {
+        const int n = gModemSocket->recvText(out, outSize);
+        if (gModemMutex) {
+            xSemaphoreGive(gModemMutex);
+        }
+        if (n > 0) {
+            data_usage_rx(TransportPathId::ModemUdp, n + TRANSPORT_UDP_OVERHEAD_BYTES);
+            return n;
+        }
+    }
+#endif
+#if TRANSPORT_HAS_TINYGSM
+    if (gTinyGsmUdp && gTinyGsmUdp->parsePacket() > 0) {
+        const int n = gTinyGsmUdp->read(reinterpret_cast<uint8_t*>(out), outSize - 1);
+        if (n > 0) {
+            data_usage_rx(TransportPathId::TinyGsmUdp, n + TRANSPORT_UDP_OVERHEAD_BYTES);
+            out[n] = '\0';
+            return n;
+        }
+    }
+#endif
+#if TRANSPORT_HAS_WIFIUDP
+    if (gWifiUdp && gWifiUdpBegun && gWifiUdp->parsePacket() > 0) {
+        const int n = gWifiUdp->read(reinterpret_cast<uint8_t*>(out), outSize - 1);
+        if (n > 0) {
+            data_usage_rx(TransportPathId::WifiUdp, n + TRANSPORT_UDP_OVERHEAD_BYTES);
+            out[n] = '\0';
+            return n;
+        }
+    }
+#endif
+    (void)out;
+    (void)outSize;
+    return 0;
+}
+
+// Reads waiting ACKs on every attached path, then retries datagrams whose ACK is overdue
+void pollAcks() {
+    if (outstandingCount() == 0) {
+        return;
+    }
+    char text[48];
+    for (uint8_t i = 0; i < TRANSPORT_ACK_WINDOW && receiveAck(text, sizeof(text)) > 0; i++) {
+        handleAck(text);
+    }
+    const uint32_t now = millis();
+    for (auto& o : gOutstanding) {
+        if (o.used && (now - o.sentAtMs) >= TRANSPORT_ACK_TIMEOUT_MS) {
+            gStats.ackTimeouts++;
+            notePathFailure(o.path);
+            settleDatagram(o, false, false);
+        }
     }
+}
 
-    outPacket = *candidate;
-    *candidate = PendingPacket();
-    if (gQueueCount > 0) {
-        gQueueCount--;
+inline void writeReliableHeader(uint8_t* out, uint16_t seq) {
+    out[0] = kReliableMagic;
+    out[1] = kReliableFlagAckRequest | (gSessionAcked ? 0 : kReliableFlagSessionStart);
+    out[2] = static_cast<uint8_t>(seq);
+    out[3] = static_cast<uint8_t>(seq >> 8);
+}
+#endif
+
+#if TRANSPORT_COMPRESS_ENABLE
+// Points data at the compressed frame in gCompressed and returns its length when that is
+// smaller than the raw datagram; otherwise leaves data alone and returns length
+size_t compressDatagram(const uint8_t*& data, size_t length) {
+    if (length < TRANSPORT_COMPRESS_MIN_BYTES) {
+        return length;
+    }
+    const size_t packed = lzss_compress(data, length, gCompressed + kCompressHeaderBytes,
+                                        length - kCompressHeaderBytes - 1);
+    if (packed == 0) {
+        return length;
     }
+    gCompressed[0] = kCompressMagic;
+    gCompressed[1] = kCompressVersionMethod;
+    gCompressed[2] = static_cast<uint8_t>(length);
+    gCompressed[3] = static_cast<uint8_t>(length >> 8);
+    const size_t wire = packed + kCompressHeaderBytes;
 
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    gStats.compressed++;
+    gStats.compressRawBytes += length;
+    gStats.compressWireBytes += wire;
+    gStats.lastCompressPermille = static_cast<uint16_t>((wire * 1000) / length);
     xSemaphoreGive(gQueueMutex);
-    return true;
+
+    data = gCompressed;
+    return wire;
+}
+#endif
+
+// Send result of one datagram. With TRANSPORT_RELIABLE_ENABLE a datagram sent over UDP
+// keeps its records pinned until its ACK (or the lack of one) settles them.
+void completeDatagram(PendingPacket** slots, size_t count, bool ok, uint16_t seq, TransportPathId path) {
+    if (!gQueueMutex || xSemaphoreTake(gQueueMutex, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    if (ok) {
+        gStats.datagrams++;
+        gStats.lastRecordsPerDatagram = static_cast<uint8_t>(count);
+        if (count > gStats.maxRecordsPerDatagram) {
+            gStats.maxRecordsPerDatagram = static_cast<uint8_t>(count);
+        }
+    }
+#if TRANSPORT_SPILL_ENABLE
+    gLinkHealthy = ok;
+#endif
+#if TRANSPORT_RELIABLE_ENABLE
+    if (ok && isUdpPath(path) && trackDatagram(seq, path)) {
+        for (size_t i = 0; i < count; i++) {
+            slots[i]->state = EntryState::AwaitingAck;
+            slots[i]->ackSeq = seq;
+        }
+        xSemaphoreGive(gQueueMutex);
+        return;
+    }
+#else
+    (void)seq;
+    (void)path;
+#endif
+    xSemaphoreGive(gQueueMutex);
+    settleRecords(slots, count, ok, false);
 }
 
-bool sendViaWifi(const PendingPacket& pkt) {
+bool sendViaWifi(const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) {
 #if TRANSPORT_HAS_WIFIUDP
     if (!gWifiUdp) {
         return false;
     }
     if (WiFi.status() != WL_CONNECTED) {
-        logbuf_printf("transport: WiFi not connected, deferring packet");
+        LOGF("transport: WiFi not connected, deferring packet");
         return false;
     }
     if (!gWifiUdpBegun) {
@@ -198,103 +964,266 @@ bool sendViaWifi(const PendingPacket& pkt) {
         gWifiUdpBegun = true;
     }
     if (gWifiUdp->beginPacket(gConfig.beamHost, gConfig.beamPort) != 1) {
-        logbuf_printf("transport: WiFiUDP beginPacket failed");
+        LOGF("transport: WiFiUDP beginPacket failed");
         return false;
     }
-    size_t written = gWifiUdp->write(reinterpret_cast<const uint8_t*>(pkt.payload), pkt.length);
-    if (written != pkt.length) {
-        logbuf_printf("transport: WiFiUDP short write (%u/%u)", static_cast<unsigned>(written), static_cast<unsigned>(pkt.length));
+    size_t written = headLen ? gWifiUdp->write(head, headLen) : 0;
+    written += gWifiUdp->write(data, len);
+    if (written != headLen + len) {
+        LOGF("transport: WiFiUDP short write (%u/%u)", static_cast<unsigned>(written), static_cast<unsigned>(headLen + len));
         gWifiUdp->stop();
         gWifiUdpBegun = false;
         return false;
     }
     if (gWifiUdp->endPacket() != 1) {
-        logbuf_printf("transport: WiFiUDP endPacket failed");
+        LOGF("transport: WiFiUDP endPacket failed");
         return false;
     }
     return true;
 #else
-    (void)pkt;
+    (void)head;
+    (void)headLen;
+    (void)data;
+    (void)len;
     return false;
 #endif
 }
 
-bool sendViaTinyGsm(const PendingPacket& pkt) {
+bool sendViaTinyGsm(const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) {
 #if TRANSPORT_HAS_TINYGSM
     if (!gTinyGsmUdp) {
         return false;
     }
     if (gTinyGsm && !gTinyGsm->isGprsConnected()) {
-        logbuf_printf("transport: modem not attached, deferring packet");
+        LOGF("transport: modem not attached, deferring packet");
         return false;
     }
     if (!gTinyGsmUdp->beginPacket(gConfig.beamHost, gConfig.beamPort)) {
-        logbuf_printf("transport: TinyGsm beginPacket failed");
+        LOGF("transport: TinyGsm beginPacket failed");
         return false;
     }
-    size_t written = gTinyGsmUdp->write(reinterpret_cast<const uint8_t*>(pkt.payload), pkt.length);
-    if (written != pkt.length) {
-        logbuf_printf("transport: TinyGsm short write (%u/%u)", static_cast<unsigned>(written), static_cast<unsigned>(pkt.length));
+    size_t written = headLen ? gTinyGsmUdp->write(head, headLen) : 0;
+    written += gTinyGsmUdp->write(data, len);
+    if (written != headLen + len) {
+        LOGF("transport: TinyGsm short write (%u/%u)", static_cast<unsigned>(written), static_cast<unsigned>(headLen + len));
         gTinyGsmUdp->endPacket();
         return false;
     }
     if (!gTinyGsmUdp->endPacket()) {
-        logbuf_printf("transport: TinyGsm endPacket failed");
+        LOGF("transport: TinyGsm endPacket failed");
         return false;
     }
     return true;
 #else
-    (void)pkt;
+    (void)head;
+    (void)headLen;
+    (void)data;
+    (void)len;
     return false;
 #endif
 }
 
-bool transmitPacket(const PendingPacket& pkt) {
-    if (pkt.length == 0) {
-        return true;
+bool sendViaModemSocket(const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) {
+#if TRANSPORT_HAS_MODEM_SOCKET
+    if (!gModemSocket) {
+        return false;
     }
-    bool success = false;
-#if TRANSPORT_HAS_TINYGSM
-    if (gTinyGsmUdp) {
-        success = sendViaTinyGsm(pkt);
+    if (gModemMutex && xSemaphoreTake(gModemMutex, pdMS_TO_TICKS(TRANSPORT_MODEM_LOCK_MS)) != pdTRUE) {
+        LOGF("transport: modem busy, deferring packet");
+        return false;
     }
+
+    bool ok = false;
+    if (gModemSocketStale && gModemSocket->isOpen()) {
+        gModemSocket->close();
+    }
+    gModemSocketStale = false;
+    char addr[SIM7080G_DNS_ADDR_LEN];
+    // Without any address the modem resolves the name itself
+    const char* target = gModemSocket->isOpen() || !gDns->resolve(gConfig.beamHost, addr, sizeof(addr))
+                             ? gConfig.beamHost
+                             : addr;
+    if (!gModemSocket->isOpen() && !gModemSocket->openUdp(target, gConfig.beamPort)) {
+        LOGF("transport: CAOPEN %s:%u failed (%d)", target,
+                      static_cast<unsigned>(gConfig.beamPort), gModemSocket->lastResult());
+    } else {
+        // Straight from the datagram buffer; the library writes it after the CASEND prompt
+        ok = gModemSocket->send(head, headLen, data, len);
+        if (!ok) {
+            LOGF("transport: CASEND failed (%u bytes)", static_cast<unsigned>(headLen + len));
+        }
+    }
+
+    if (gModemMutex) {
+        xSemaphoreGive(gModemMutex);
+    }
+    return ok;
+#else
+    (void)head;
+    (void)headLen;
+    (void)data;
+    (void)len;
+    return false;
 #endif
-#if TRANSPORT_HAS_WIFIUDP
-    if (!success && gWifiUdp) {
-        success = sendViaWifi(pkt);
+}
+
+// head (optional) goes on the wire directly in front of data, in the same datagram
+bool sendViaUdpPath(TransportPathId id, const uint8_t* head, size_t headLen, const uint8_t* data, size_t len) {
+    switch (id) {
+        case TransportPathId::ModemUdp:
+            return sendViaModemSocket(head, headLen, data, len);
+        case TransportPathId::TinyGsmUdp:
+            return sendViaTinyGsm(head, headLen, data, len);
+        case TransportPathId::WifiUdp:
+            return sendViaWifi(head, headLen, data, len);
+        default:
+            return false;
     }
+}
+
+// Tries the usable paths cheapest first until one takes the datagram. UDP paths get the
+// compressed and sequence-framed form; external paths get the plain records.
+void routeDatagram(PendingPacket** slots, size_t count, const uint8_t* data, size_t length) {
+    const TransportPacketKind kind = slots[0]->kind;
+    TransportPathId order[TRANSPORT_PATH_COUNT];
+    const size_t paths = rankPaths(kind, slots[0]->priority, length, millis(), order);
+
+    const uint8_t* wire = data;
+    size_t wireLen = length;
+#if TRANSPORT_COMPRESS_ENABLE
+    bool compressed = false;
 #endif
-    if (!success) {
-        logbuf_printf("transport: no transport path available");
+    for (size_t i = 0; i < paths; i++) {
+        const TransportPathId id = order[i];
+        const uint32_t t0 = millis();
+        uint16_t seq = 0;
+        bool ok;
+        if (isUdpPath(id)) {
+#if TRANSPORT_COMPRESS_ENABLE
+            if (!compressed) {
+                wireLen = compressDatagram(wire, length);
+                compressed = true;
+            }
+#endif
+#if TRANSPORT_RELIABLE_ENABLE
+            uint8_t header[kReliableHeaderBytes];
+            seq = gNextSeq++;
+            writeReliableHeader(header, seq);
+            ok = sendViaUdpPath(id, header, sizeof(header), wire, wireLen);
+            if (ok) {
+                data_usage_tx(id, sizeof(header) + wireLen + TRANSPORT_UDP_OVERHEAD_BYTES);
+            }
+#else
+            ok = sendViaUdpPath(id, nullptr, 0, wire, wireLen);
+            if (ok) {
+                data_usage_tx(id, wireLen + TRANSPORT_UDP_OVERHEAD_BYTES);
+            }
+#endif
+        } else {
+            const RouterPath& path = gPaths[static_cast<size_t>(id)];
+            ok = path.fn(kind, data, length, path.ctx);
+        }
+        recordPathResult(id, ok, millis() - t0, isUdpPath(id) ? wireLen : length);
+        if (ok) {
+            if (i > 0) {
+                gStats.failovers++;
+            }
+            completeDatagram(slots, count, true, seq, id);
+            return;
+        }
+    }
+    if (paths == 0) {
+        LOGF("transport: no transport path available");
     }
-    return success;
+    completeDatagram(slots, count, false, 0, TransportPathId::ModemUdp);
 }
 
-bool enqueueNewPacket(TransportPacketKind kind, const char* json, size_t len) {
-    if (!json || len == 0) {
+bool enqueueNewPacket(TransportPacketKind kind, TransportPriority priority, const void* data, size_t len) {
+    if (!data || len == 0) {
         return false;
     }
-    if (len >= TRANSPORT_MAX_PACKET_BYTES) {
-        logbuf_printf("transport: payload too large (%u bytes)", static_cast<unsigned>(len));
+    if (len > TRANSPORT_MAX_PACKET_BYTES) {
+        LOGF("transport: payload too large (%u bytes)", static_cast<unsigned>(len));
         return false;
     }
-    PendingPacket pkt;
-    pkt.kind = kind;
-    pkt.length = len;
-    memcpy(pkt.payload, json, len);
-    if (len < TRANSPORT_MAX_PACKET_BYTES) {
-        pkt.payload[len] = '\0';
+    PendingPacket* pkt = reserveEntry(kind, len, true, priority);
+    if (!pkt) {
+#if TRANSPORT_SPILL_ENABLE
+        // Arena pinned by in-flight records: keep the new one on SD instead of losing it
+        if (priority != TransportPriority::Diagnostic && gQueueMutex && gSpill.ensureReady() &&
+            gSpill.push(kind, data, len)) {
+            gStats.spilled++;
+            classStats(priority).queued++;
+            notifyQueued();
+            return true;
+        }
+#endif
+        return false;
     }
-    pkt.firstQueuedAtMs = millis();
-    pkt.nextSendAtMs = 0;
-    pkt.attempts = 0;
-    return enqueueInternal(pkt, false);
+    memcpy(entryData(*pkt), data, len);
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    commitLocked(*pkt, len, priority);
+    gStats.queued++;
+    classStats(priority).queued++;
+    xSemaphoreGive(gQueueMutex);
+    notifyQueued();
+    return true;
 }
 
-bool enqueueRetryPacket(PendingPacket& pkt, uint8_t attemptNumber) {
-    pkt.nextSendAtMs = millis() + computeBackoffMs(attemptNumber);
-    return enqueueInternal(pkt, true);
+#if TRANSPORT_SPILL_ENABLE
+// Moves spilled records back into the arena, oldest first, in the Backfill class (a
+// spilled alarm comes back as backfill: it is late by then anyway). Paced by a token bucket at
+// TRANSPORT_SPILL_DRAIN_PER_S and never takes the last TRANSPORT_SPILL_RESERVE_SLOTS
+// entries (or the arena room for them) away from live data.
+void drainSpill() {
+    if (!gLinkHealthy || !gQueueMutex || !gSpill.ready() || gSpill.empty()) {
+        return;
+    }
+    const uint32_t now = millis();
+    uint32_t budget = ((now - gLastSpillDrainMs) * TRANSPORT_SPILL_DRAIN_PER_S) / 1000;
+    if (budget == 0) {
+        return;
+    }
+    if (budget > TRANSPORT_SPILL_DRAIN_PER_S) {
+        budget = TRANSPORT_SPILL_DRAIN_PER_S;
+    }
+    gLastSpillDrainMs = now;
+
+    while (budget-- > 0) {
+        if (xSemaphoreTake(gQueueMutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+            return;
+        }
+        const bool room = (TRANSPORT_QUEUE_DEPTH - gRingCount) > TRANSPORT_SPILL_RESERVE_SLOTS &&
+                          arenaFreeLocked() >= TRANSPORT_MAX_PACKET_BYTES * (TRANSPORT_SPILL_RESERVE_SLOTS + 1);
+        xSemaphoreGive(gQueueMutex);
+        if (!room) {
+            return;
+        }
+        PendingPacket* pkt = reserveEntry(TransportPacketKind::Telemetry, TRANSPORT_MAX_PACKET_BYTES, false,
+                                          TransportPriority::Backfill);
+        if (!pkt) {
+            return;
+        }
+        // Read straight into the reservation; commit trims it to the record length
+        TransportPacketKind kind = TransportPacketKind::Telemetry;
+        const size_t len = gSpill.pop(kind, entryData(*pkt), TRANSPORT_MAX_PACKET_BYTES);
+
+        xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+        if (len > 0) {
+            pkt->kind = kind;
+            commitLocked(*pkt, len, TransportPriority::Backfill);
+            gStats.spillDrained++;
+            classStats(TransportPriority::Backfill).queued++;
+        } else {
+            abortLocked(*pkt);
+        }
+        xSemaphoreGive(gQueueMutex);
+        if (len == 0) {
+            return;
+        }
+    }
 }
+#endif
 
 } // namespace
 
@@ -309,6 +1238,12 @@ TransportConfig transport_makeDefaultConfig() {
     cfg.maxAttempts = TRANSPORT_DEFAULT_MAX_ATTEMPTS;
     cfg.baseRetryDelayMs = TRANSPORT_DEFAULT_BASE_RETRY_MS;
     cfg.jitterMs = TRANSPORT_DEFAULT_JITTER_MS;
+    cfg.mtuBytes = TRANSPORT_DEFAULT_MTU_BYTES;
+    cfg.maxHoldMs = TRANSPORT_DEFAULT_MAX_HOLD_MS;
+    cfg.deadlineMs[static_cast<size_t>(TransportPriority::Alarm)] = TRANSPORT_DEFAULT_ALARM_DEADLINE_MS;
+    cfg.deadlineMs[static_cast<size_t>(TransportPriority::Telemetry)] = TRANSPORT_DEFAULT_TELEMETRY_DEADLINE_MS;
+    cfg.deadlineMs[static_cast<size_t>(TransportPriority::Attributes)] = TRANSPORT_DEFAULT_ATTRIBUTES_DEADLINE_MS;
+    cfg.deadlineMs[static_cast<size_t>(TransportPriority::Backfill)] = TRANSPORT_DEFAULT_BACKFILL_DEADLINE_MS;
     return cfg;
 }
 
@@ -322,14 +1257,27 @@ bool transport_configure(const TransportConfig& cfg) {
     gConfig.maxAttempts = cfg.maxAttempts ? cfg.maxAttempts : TRANSPORT_DEFAULT_MAX_ATTEMPTS;
     gConfig.baseRetryDelayMs = cfg.baseRetryDelayMs ? cfg.baseRetryDelayMs : TRANSPORT_DEFAULT_BASE_RETRY_MS;
     gConfig.jitterMs = cfg.jitterMs;
+    gConfig.mtuBytes = cfg.mtuBytes ? cfg.mtuBytes : TRANSPORT_DEFAULT_MTU_BYTES;
+    gConfig.maxHoldMs = cfg.maxHoldMs;
+    memcpy(gConfig.deadlineMs, cfg.deadlineMs, sizeof(gConfig.deadlineMs));
+#if TRANSPORT_HAS_MODEM_SOCKET
+    gModemSocketStale = true;
+#endif
     return true;
 }
 
 bool transport_init() {
     if (!gQueueMutex) {
-        gQueueMutex = xSemaphoreCreateMutex();
+        gQueueMutex = kernel_mutex_create(KernelMutex::TransportQueue);
         if (!gQueueMutex) {
-            logbuf_printf("transport: failed to create queue mutex");
+            LOGF("transport: failed to create queue mutex");
+            return false;
+        }
+    }
+    if (!gProcessMutex) {
+        gProcessMutex = kernel_mutex_create(KernelMutex::TransportProcess);
+        if (!gProcessMutex) {
+            LOGF("transport: failed to create process mutex");
             return false;
         }
     }
@@ -337,16 +1285,25 @@ bool transport_init() {
         for (auto& pkt : gQueue) {
             pkt = PendingPacket();
         }
-        gQueueCount = 0;
+        gRingTail = 0;
+        gRingCount = 0;
+        gArenaHead = 0;
         xSemaphoreGive(gQueueMutex);
     }
+#if TRANSPORT_RELIABLE_ENABLE
+    for (auto& o : gOutstanding) {
+        o = OutstandingDatagram();
+    }
+    gNextSeq = static_cast<uint16_t>(random(0, 0x10000));
+    gSessionAcked = false;
+#endif
     transport_resetStats();
-    logbuf_printf("transport: Beam UDP init host=%s port=%u", gConfig.beamHost, static_cast<unsigned>(gConfig.beamPort));
+    LOGF("transport: Beam UDP init host=%s port=%u", gConfig.beamHost, static_cast<unsigned>(gConfig.beamPort));
     return true;
 }
 
 bool transport_sendTelemetry(const char* json, size_t len) {
-    if (!enqueueNewPacket(TransportPacketKind::Telemetry, json, len)) {
+    if (!enqueueNewPacket(TransportPacketKind::Telemetry, defaultPriority(TransportPacketKind::Telemetry), json, len)) {
         return false;
     }
     transport_process();
@@ -354,57 +1311,215 @@ bool transport_sendTelemetry(const char* json, size_t len) {
 }
 
 bool transport_sendAttributes(const char* json, size_t len) {
-    if (!enqueueNewPacket(TransportPacketKind::Attributes, json, len)) {
+    if (!enqueueNewPacket(TransportPacketKind::Attributes, defaultPriority(TransportPacketKind::Attributes), json, len)) {
         return false;
     }
     transport_process();
     return true;
 }
 
-bool transport_fetchShared(char* out, size_t outSz) {
-    (void)out;
-    (void)outSz;
-    logbuf_printf("transport: fetchShared not implemented for Beam UDP");
-    return false;
+bool transport_sendTelemetryBinary(const uint8_t* frame, size_t len) {
+    if (!enqueueNewPacket(TransportPacketKind::TelemetryBinary, defaultPriority(TransportPacketKind::TelemetryBinary), frame, len)) {
+        return false;
+    }
+    transport_process();
+    return true;
 }
 
-void transport_process() {
-    PendingPacket pkt;
-    while (dequeueReadyPacket(pkt)) {
-        uint8_t attemptNumber = pkt.attempts + 1; // about to attempt send
-        bool ok = transmitPacket(pkt);
-        if (ok) {
-            gStats.sent++;
-            continue;
-        }
-        pkt.attempts = attemptNumber;
-        if (pkt.attempts >= gConfig.maxAttempts) {
-            gStats.failed++;
-            logbuf_printf("transport: dropping packet after %u attempts", static_cast<unsigned>(pkt.attempts));
-            continue;
-        }
-        if (!enqueueRetryPacket(pkt, pkt.attempts)) {
-            gStats.failed++;
-            logbuf_printf("transport: retry enqueue failed, dropping packet");
+bool transport_sendAlarm(const char* json, size_t len) {
+    if (!enqueueNewPacket(TransportPacketKind::Telemetry, TransportPriority::Alarm, json, len)) {
+        return false;
+    }
+    transport_process();
+    return true;
+}
+
+bool transport_sendDiagnostic(const char* json, size_t len) {
+    if (!enqueueNewPacket(TransportPacketKind::Telemetry, TransportPriority::Diagnostic, json, len)) {
+        return false;
+    }
+    transport_process();
+    return true;
+}
+
+bool transport_reserve(TransportPacketKind kind, size_t maxLen, TransportReservation& out) {
+    out = TransportReservation();
+    out.priority = defaultPriority(kind);
+    PendingPacket* pkt = reserveEntry(kind, maxLen, true, out.priority);
+    if (!pkt) {
+        return false;
+    }
+    out.data = entryData(*pkt);
+    out.capacity = maxLen;
+    out.slot = static_cast<int16_t>(pkt - gQueue);
+    return true;
+}
+
+bool transport_commit(TransportReservation& r, size_t len) {
+    if (!gQueueMutex || r.slot < 0 || r.slot >= static_cast<int16_t>(TRANSPORT_QUEUE_DEPTH)) {
+        return false;
+    }
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    PendingPacket& pkt = gQueue[r.slot];
+    bool ok = false;
+    if (static_cast<size_t>(r.priority) >= TRANSPORT_PRIORITY_COUNT) {
+        r.priority = defaultPriority(pkt.kind);
+    }
+    if (pkt.state == EntryState::Reserved) {
+        if (len > 0 && len <= pkt.reserved) {
+            commitLocked(pkt, len, r.priority);
+            gStats.queued++;
+            classStats(r.priority).queued++;
+            ok = true;
+        } else {
+            abortLocked(pkt);
         }
     }
+    xSemaphoreGive(gQueueMutex);
+    r = TransportReservation();
+    if (ok) {
+        notifyQueued();
+        transport_process();
+    }
+    return ok;
+}
+
+void transport_abort(TransportReservation& r) {
+    if (!gQueueMutex || r.slot < 0 || r.slot >= static_cast<int16_t>(TRANSPORT_QUEUE_DEPTH)) {
+        return;
+    }
+    xSemaphoreTake(gQueueMutex, portMAX_DELAY);
+    if (gQueue[r.slot].state == EntryState::Reserved) {
+        abortLocked(gQueue[r.slot]);
+    }
+    xSemaphoreGive(gQueueMutex);
+    r = TransportReservation();
+}
+
+void transport_process() {
+    // Whoever holds this is already draining the queue
+    if (!gProcessMutex || xSemaphoreTake(gProcessMutex, 0) != pdTRUE) {
+        return;
+    }
+    PendingPacket* slots[TRANSPORT_QUEUE_DEPTH];
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    size_t count;
+#if TRANSPORT_RELIABLE_ENABLE
+    pollAcks();
+#endif
+#if TRANSPORT_SPILL_ENABLE
+    drainSpill();
+#endif
+    while ((count = buildDatagram(slots, data, length)) > 0) {
+        routeDatagram(slots, count, data, length);
+    }
+    xSemaphoreGive(gProcessMutex);
 }
 
 TransportStats transport_getStats() {
-    return gStats;
+    TransportStats stats = gStats;
+#if TRANSPORT_SPILL_ENABLE
+    stats.spillLost = gSpill.lostRecords();
+    stats.spillPendingBytes = gSpill.pendingBytes();
+#endif
+#if TRANSPORT_HAS_MODEM_SOCKET
+    if (gDns) {
+        const SIM7080G_Dns::Stats& d = gDns->stats();
+        stats.dnsHits = d.hits;
+        stats.dnsLookups = d.lookups;
+        stats.dnsFailures = d.failures;
+        stats.dnsStale = d.staleServed;
+    }
+#endif
+    return stats;
+}
+
+size_t transport_pendingBytes(uint32_t* oldestAgeMs) {
+    if (oldestAgeMs) {
+        *oldestAgeMs = 0;
+    }
+    if (!gQueueMutex) {
+        return 0;
+    }
+    if (xSemaphoreTake(gQueueMutex, pdMS_TO_TICKS(5)) != pdTRUE) {
+        return 0;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < gRingCount; i++) {
+        const PendingPacket& pkt = entryAt(i);
+        if (isPending(pkt)) {
+            bytes += pkt.length;
+        }
+    }
+    if (oldestAgeMs) {
+        const PendingPacket* oldest = findOldestPendingLocked();
+        if (oldest) {
+            *oldestAgeMs = millis() - oldest->firstQueuedAtMs;
+        }
+    }
+    xSemaphoreGive(gQueueMutex);
+    return bytes;
 }
 
 void transport_resetStats() {
     gStats = TransportStats();
 }
 
+void transport_registerPath(TransportPathId id, TransportPathSendFn fn, void* ctx, uint8_t kindMask,
+                            uint16_t overheadBytes) {
+    if (isUdpPath(id) || static_cast<size_t>(id) >= TRANSPORT_PATH_COUNT) {
+        return;
+    }
+    RouterPath& path = gPaths[static_cast<size_t>(id)];
+    path.fn = fn;
+    path.ctx = ctx;
+    path.kindMask = kindMask;
+    path.overheadBytes = overheadBytes;
+    path.retryAtMs = 0;
+}
+
+void transport_setQueuedNotify(TransportQueuedFn fn, void* ctx) {
+    gQueuedFn = nullptr;
+    gQueuedCtx = ctx;
+    gQueuedFn = fn;
+}
+
+void transport_refreshDns() {
+#if TRANSPORT_HAS_MODEM_SOCKET
+    if (!gDns || !gDns->refreshDue()) {
+        return;
+    }
+    if (gModemMutex && xSemaphoreTake(gModemMutex, 0) != pdTRUE) {
+        return;
+    }
+    if (gDns->refresh()) {
+        LOGF("transport: %s moved, reopening the socket", gConfig.beamHost);
+        gModemSocketStale = true;
+    }
+    if (gModemMutex) {
+        xSemaphoreGive(gModemMutex);
+    }
+#endif
+}
+
+bool transport_thingsboardUrl(TransportPacketKind kind, char* out, size_t outSize) {
+    if (!out || outSize == 0 || gConfig.accessToken[0] == '\0' || gConfig.thingsboardHost[0] == '\0') {
+        return false;
+    }
+    const int n = snprintf(out, outSize, "%s://%s:%u/api/v1/%s/%s", gConfig.thingsboardPort == 443 ? "https" : "http",
+                           gConfig.thingsboardHost, static_cast<unsigned>(gConfig.thingsboardPort), gConfig.accessToken,
+                           kind == TransportPacketKind::Attributes ? "attributes" : "telemetry");
+    return n > 0 && static_cast<size_t>(n) < outSize;
+}
+
 void transport_attachWiFiUdp(WiFiUDP* udp) {
 #if TRANSPORT_HAS_WIFIUDP
     gWifiUdp = udp;
     gWifiUdpBegun = false;
 #else
     (void)udp;
-    logbuf_printf("transport: WiFiUDP support not compiled in");
+    LOGF("transport: WiFiUDP support not compiled in");
 #endif
 }
 
@@ -415,6 +1530,29 @@ void transport_attachTinyGsm(TinyGsm* modem, TinyGsmUDP* udp) {
 #else
     (void)modem;
     (void)udp;
-    logbuf_printf("transport: TinyGSM support not compiled in");
+    LOGF("transport: TinyGSM support not compiled in");
+#endif
+}
+
+void transport_attachModemSocket(M5_SIM7080G* modem, SemaphoreHandle_t serialMutex) {
+#if TRANSPORT_HAS_MODEM_SOCKET
+    if (gModemSocket) {
+        gModemSocket->~SIM7080G_Socket();
+        gModemSocket = nullptr;
+    }
+    if (gDns) {
+        gDns->~SIM7080G_Dns();
+        gDns = nullptr;
+    }
+    gModemMutex = serialMutex;
+    gModemSocketStale = false;
+    if (modem) {
+        gModemSocket = new (gModemSocketStorage) SIM7080G_Socket(*modem, TRANSPORT_MODEM_SOCKET_CID);
+        gDns = new (gDnsStorage) SIM7080G_Dns(*modem);
+    }
+#else
+    (void)modem;
+    (void)serialMutex;
+    LOGF("transport: SIM7080G socket support not compiled in");
 #endif
 }
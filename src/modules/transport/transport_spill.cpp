@@ -0,0 +1,288 @@
+/*
+ * Transport Spill Queue Implementation
+ */
+
+#include "transport_spill.h"
+#include "../storage/storage_task.h"
+#include "../logging/log_buffer.h"
+
+#include <SD.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+constexpr uint8_t kRecordMagic = 0xA5;
+constexpr uint32_t kCursorMagic = 0x31515053;   // "SPQ1"
+const char* const kCursorPath = TRANSPORT_SPILL_DIR "/cursor";
+
+struct SpillRecordHeader {
+    uint8_t magic;
+    uint8_t kind;
+    uint16_t length;
+    uint32_t check;
+};
+
+struct SpillCursor {
+    uint32_t magic;
+    uint32_t readSeg;
+    uint32_t readOff;
+    uint32_t writeSeg;
+    uint32_t check;
+};
+
+uint32_t fnv1a(const void* data, size_t len, uint32_t h = 2166136261u) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+inline uint32_t recordCheck(uint8_t kind, const void* data, uint16_t len) {
+    return fnv1a(data, len, fnv1a(&kind, 1) ^ len);
+}
+} // namespace
+
+TransportSpill::TransportSpill()
+    : ready_(false), lastProbeMs_(0), readSeg_(0), readOff_(0), writeSeg_(0), writeOff_(0),
+      sinceSave_(0), lost_(0) {}
+
+bool TransportSpill::lock() const {
+    return g_sdMutex && xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(TRANSPORT_SPILL_SD_LOCK_MS)) == pdTRUE;
+}
+
+void TransportSpill::unlock() const {
+    xSemaphoreGive(g_sdMutex);
+}
+
+void TransportSpill::segmentPath(uint32_t seg, char* out, size_t outSize) const {
+    snprintf(out, outSize, TRANSPORT_SPILL_DIR "/%08lu.seg", static_cast<unsigned long>(seg));
+}
+
+bool TransportSpill::ensureReady() {
+    if (ready_) {
+        return true;
+    }
+    const uint32_t now = millis();
+    if (lastProbeMs_ != 0 && (now - lastProbeMs_) < TRANSPORT_SPILL_RETRY_MS) {
+        return false;
+    }
+    lastProbeMs_ = now ? now : 1;
+    if (!g_sdMutex || SD.cardType() == CARD_NONE) {
+        return false;
+    }
+    if (!lock()) {
+        return false;
+    }
+    if (!SD.exists(TRANSPORT_SPILL_DIR) && !SD.mkdir(TRANSPORT_SPILL_DIR)) {
+        unlock();
+        logbuf_printf("transport: spill dir %s unavailable", TRANSPORT_SPILL_DIR);
+        return false;
+    }
+    if (!loadCursor()) {
+        recoverFromDirectory();
+    }
+    // Never append to a segment that may end in a torn record
+    writeSeg_++;
+    writeOff_ = 0;
+    enforceCapLocked();
+    ready_ = saveCursor();
+    unlock();
+    if (ready_) {
+        logbuf_printf("transport: spill ready (segments %lu..%lu)", static_cast<unsigned long>(readSeg_),
+                      static_cast<unsigned long>(writeSeg_));
+    }
+    return ready_;
+}
+
+bool TransportSpill::loadCursor() {
+    File f = SD.open(kCursorPath, "r");
+    if (!f) {
+        return false;
+    }
+    SpillCursor c{};
+    const size_t n = f.read(reinterpret_cast<uint8_t*>(&c), sizeof(c));
+    f.close();
+    if (n != sizeof(c) || c.magic != kCursorMagic || c.check != fnv1a(&c, offsetof(SpillCursor, check)) ||
+        (int32_t)(c.writeSeg - c.readSeg) < 0) {
+        logbuf_printf("transport: spill cursor invalid, recovering from directory");
+        return false;
+    }
+    readSeg_ = c.readSeg;
+    readOff_ = c.readOff;
+    writeSeg_ = c.writeSeg;
+    writeOff_ = 0;
+    return true;
+}
+
+// Fallback when the cursor is missing or corrupt: segment names only, no contents.
+// Restarting the oldest segment from offset 0 may resend some records.
+void TransportSpill::recoverFromDirectory() {
+    bool any = false;
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    File dir = SD.open(TRANSPORT_SPILL_DIR);
+    if (dir) {
+        File entry = dir.openNextFile();
+        while (entry) {
+            const char* name = entry.name();
+            const char* base = strrchr(name, '/');
+            base = base ? base + 1 : name;
+            char* end = nullptr;
+            const unsigned long seg = strtoul(base, &end, 10);
+            if (end && end != base && strcmp(end, ".seg") == 0) {
+                if (!any || seg < lo) lo = seg;
+                if (!any || seg > hi) hi = seg;
+                any = true;
+            }
+            entry.close();
+            entry = dir.openNextFile();
+        }
+        dir.close();
+    }
+    readSeg_ = any ? lo : 0;
+    readOff_ = 0;
+    writeSeg_ = any ? hi : 0;
+    writeOff_ = 0;
+}
+
+bool TransportSpill::saveCursor() {
+    SpillCursor c{};
+    c.magic = kCursorMagic;
+    c.readSeg = readSeg_;
+    c.readOff = readOff_;
+    c.writeSeg = writeSeg_;
+    c.check = fnv1a(&c, offsetof(SpillCursor, check));
+    File f = SD.open(kCursorPath, "w");
+    if (!f) {
+        return false;
+    }
+    const size_t n = f.write(reinterpret_cast<const uint8_t*>(&c), sizeof(c));
+    f.close();
+    sinceSave_ = 0;
+    return n == sizeof(c);
+}
+
+void TransportSpill::enforceCapLocked() {
+    char path[40];
+    while (writeSeg_ - readSeg_ >= TRANSPORT_SPILL_MAX_SEGMENTS) {
+        segmentPath(readSeg_, path, sizeof(path));
+        if (SD.remove(path)) {
+            lost_++;
+            logbuf_printf("transport: spill full, discarded segment %s", path);
+        }
+        readSeg_++;
+        readOff_ = 0;
+    }
+}
+
+bool TransportSpill::push(TransportPacketKind kind, const void* data, size_t len) {
+    if (!data || len == 0 || len > 0xFFFF || !ensureReady()) {
+        return false;
+    }
+    if (!lock()) {
+        return false;
+    }
+
+    const size_t recordBytes = sizeof(SpillRecordHeader) + len;
+    if (writeOff_ > 0 && writeOff_ + recordBytes > TRANSPORT_SPILL_SEGMENT_BYTES) {
+        writeSeg_++;
+        writeOff_ = 0;
+        enforceCapLocked();
+        saveCursor();
+    }
+
+    SpillRecordHeader hdr{};
+    hdr.magic = kRecordMagic;
+    hdr.kind = static_cast<uint8_t>(kind);
+    hdr.length = static_cast<uint16_t>(len);
+    hdr.check = recordCheck(hdr.kind, data, hdr.length);
+
+    char path[40];
+    segmentPath(writeSeg_, path, sizeof(path));
+    bool ok = false;
+    File f = SD.open(path, "a");
+    if (f) {
+        ok = f.write(reinterpret_cast<const uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr) &&
+             f.write(static_cast<const uint8_t*>(data), len) == len;
+        f.close();
+    }
+    if (ok) {
+        writeOff_ += recordBytes;
+    } else {
+        // A partial record would desync the reader; continue in a new segment
+        writeSeg_++;
+        writeOff_ = 0;
+        saveCursor();
+        logbuf_printf("transport: spill write failed (%s)", path);
+    }
+    unlock();
+    return ok;
+}
+
+size_t TransportSpill::pop(TransportPacketKind& kind, void* out, size_t outSize) {
+    if (!out || !ready_ || empty()) {
+        return 0;
+    }
+    if (!lock()) {
+        return 0;
+    }
+
+    char path[40];
+    size_t result = 0;
+    while (!empty()) {
+        segmentPath(readSeg_, path, sizeof(path));
+        File f = SD.open(path, "r");
+        const uint32_t size = f ? static_cast<uint32_t>(f.size()) : 0;
+        if (readOff_ >= size) {
+            if (f) f.close();
+            if (readSeg_ == writeSeg_) {
+                break;  // caught up with the writer
+            }
+            SD.remove(path);
+            readSeg_++;
+            readOff_ = 0;
+            saveCursor();
+            continue;
+        }
+
+        SpillRecordHeader hdr{};
+        bool valid = f.seek(readOff_) &&
+                     f.read(reinterpret_cast<uint8_t*>(&hdr), sizeof(hdr)) == sizeof(hdr) &&
+                     hdr.magic == kRecordMagic && hdr.length > 0 && hdr.length <= outSize &&
+                     readOff_ + sizeof(hdr) + hdr.length <= size &&
+                     f.read(static_cast<uint8_t*>(out), hdr.length) == hdr.length &&
+                     hdr.check == recordCheck(hdr.kind, out, hdr.length);
+        f.close();
+        if (!valid) {
+            // Torn or corrupt: nothing after it in this segment can be framed
+            lost_++;
+            logbuf_printf("transport: spill record at %s+%lu unreadable, skipping segment", path,
+                          static_cast<unsigned long>(readOff_));
+            readOff_ = size;
+            continue;
+        }
+
+        readOff_ += sizeof(hdr) + hdr.length;
+        kind = static_cast<TransportPacketKind>(hdr.kind);
+        result = hdr.length;
+        if (++sinceSave_ >= TRANSPORT_SPILL_CURSOR_SAVE_EVERY) {
+            saveCursor();
+        }
+        break;
+    }
+    unlock();
+    return result;
+}
+
+uint32_t TransportSpill::pendingBytes() const {
+    if (empty()) {
+        return 0;
+    }
+    if (readSeg_ == writeSeg_) {
+        return writeOff_ - readOff_;
+    }
+    const uint32_t head = readOff_ < TRANSPORT_SPILL_SEGMENT_BYTES ? TRANSPORT_SPILL_SEGMENT_BYTES - readOff_ : 0;
+    return head + (writeSeg_ - readSeg_ - 1) * TRANSPORT_SPILL_SEGMENT_BYTES + writeOff_;
+}
@@ -0,0 +1,80 @@
+/*
+ * Transport Spill Queue
+ * SD-backed store-and-forward overflow for the RAM transport queue.
+ *
+ * Records are appended to numbered segment files under TRANSPORT_SPILL_DIR and
+ * read back oldest-first through a (segment, offset) cursor. The cursor is kept
+ * in a small checksummed file, so a reboot resumes without reading segment
+ * contents; the first segment written after boot is always a fresh one, so a
+ * torn record from a power cut can only sit at the end of an older segment,
+ * where the reader skips it. Delivery is at-least-once: the cursor is saved
+ * every few records, and records read since the last save are resent after a
+ * reboot.
+ */
+
+#ifndef TRANSPORT_SPILL_H
+#define TRANSPORT_SPILL_H
+
+#include <Arduino.h>
+#include "transport.h"
+
+#ifndef TRANSPORT_SPILL_ENABLE
+#define TRANSPORT_SPILL_ENABLE 1
+#endif
+#ifndef TRANSPORT_SPILL_DIR
+#define TRANSPORT_SPILL_DIR "/spool"
+#endif
+#ifndef TRANSPORT_SPILL_SEGMENT_BYTES
+#define TRANSPORT_SPILL_SEGMENT_BYTES (64UL * 1024UL)
+#endif
+#ifndef TRANSPORT_SPILL_MAX_SEGMENTS
+#define TRANSPORT_SPILL_MAX_SEGMENTS 64         // oldest segment is discarded beyond this (4 MB)
+#endif
+#ifndef TRANSPORT_SPILL_DRAIN_PER_S
+#define TRANSPORT_SPILL_DRAIN_PER_S 4           // catch-up rate cap, records per second
+#endif
+#ifndef TRANSPORT_SPILL_RESERVE_SLOTS
+#define TRANSPORT_SPILL_RESERVE_SLOTS 2         // RAM slots kept free for live records while draining
+#endif
+
+#define TRANSPORT_SPILL_CURSOR_SAVE_EVERY 8
+#define TRANSPORT_SPILL_SD_LOCK_MS        500
+#define TRANSPORT_SPILL_RETRY_MS          10000 // re-probe interval while the card is missing
+
+class TransportSpill {
+public:
+    TransportSpill();
+
+    // Loads the cursor on first use; cheap to call repeatedly. False while no card/mutex.
+    bool ensureReady();
+    bool ready() const { return ready_; }
+    bool empty() const { return readSeg_ == writeSeg_ && readOff_ >= writeOff_; }
+
+    bool push(TransportPacketKind kind, const void* data, size_t len);
+    // Reads and consumes the oldest record; returns its length, 0 when empty or on error
+    size_t pop(TransportPacketKind& kind, void* out, size_t outSize);
+
+    // Approximate, from segment sizes; no file access
+    uint32_t pendingBytes() const;
+    uint32_t lostRecords() const { return lost_; }
+
+private:
+    bool lock() const;
+    void unlock() const;
+    void segmentPath(uint32_t seg, char* out, size_t outSize) const;
+    bool loadCursor();
+    void recoverFromDirectory();
+    bool saveCursor();
+    void enforceCapLocked();
+
+    bool ready_;
+    uint32_t lastProbeMs_;
+    uint32_t readSeg_;
+    uint32_t readOff_;
+    uint32_t writeSeg_;
+    uint32_t writeOff_;
+    uint8_t sinceSave_;
+    uint32_t lost_;           // records skipped as corrupt plus segments discarded by the cap
+};
+
+#endif // TRANSPORT_SPILL_H
@@ -1,6 +1,8 @@
 #include "stack_monitor.h"
 #include "config/system_config.h"
 #include "../modules/logging/log_buffer.h"
+#include "system/service_task.h"
+#include "system/event_bus.h"
 
 // ============================================================================
 // STACK MONITOR SINGLETON IMPLEMENTATION
@@ -20,6 +22,7 @@ StackMonitor::StackMonitor() {
     criticalEvents = 0;
     warningEvents = 0;
     lastCheckTime = 0;
+    serviceJob = SERVICE_JOB_NONE;
     
     // Initialize task tracking
     for (int i = 0; i < 16; i++) {
@@ -147,28 +150,43 @@ void StackMonitor::updateTask(TaskHandle_t taskHandle, const char* taskName) {
 // MONITORING
 // ============================================================================
 void StackMonitor::startMonitoring() {
+    if (serviceJob != SERVICE_JOB_NONE) return;
+    
+    serviceJob = service_job_add("StackMonitor", monitorJob, this,
+                                 STACK_MONITOR_CHECK_INTERVAL_MS, STACK_MONITOR_JOB_BUDGET_US);
     Serial.println("StackMonitor: Starting stack monitoring");
     log_add("Stack monitoring started for no-PSRAM optimization");
 }
 
 void StackMonitor::stopMonitoring() {
+    if (serviceJob == SERVICE_JOB_NONE) return;
+    
+    service_job_remove(serviceJob);
+    serviceJob = SERVICE_JOB_NONE;
     Serial.println("StackMonitor: Stopping stack monitoring");
     log_add("Stack monitoring stopped");
 }
 
+void StackMonitor::monitorJob(void* ctx) {
+    // The job period already spaces the checks; skip checkAllTasks' rate limit
+    static_cast<StackMonitor*>(ctx)->runChecks();
+}
+
 void StackMonitor::checkAllTasks() {
-    if (!monitorMutex) return;
-    
-    uint32_t currentTime = millis();
-    if (currentTime - lastCheckTime < STACK_MONITOR_CHECK_INTERVAL_MS) {
+    if (millis() - lastCheckTime < STACK_MONITOR_CHECK_INTERVAL_MS) {
         return;
     }
+    runChecks();
+}
+
+void StackMonitor::runChecks() {
+    if (!monitorMutex) return;
     
     if (xSemaphoreTake(monitorMutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
         return;
     }
     
-    lastCheckTime = currentTime;
+    lastCheckTime = millis();
     totalChecks++;
     
     // Check all tracked tasks
@@ -269,10 +287,13 @@ void StackMonitor::checkHeapUsage() {
     if (freeHeap < CRITICAL_HEAP_THRESHOLD) {
         Serial.printf("StackMonitor: CRITICAL - Heap low: %u bytes (min: %u)\n", freeHeap, minFreeHeap);
         
-        // Set heap low event
-        extern EventGroupHandle_t xEventGroupSystemStatus;
-        if (xEventGroupSystemStatus) {
-            xEventGroupSetBits(xEventGroupSystemStatus, EVENT_BIT_HEAP_LOW);
+        // Once per episode: the memory monitor publishes the way back to normal
+        HeapLowEvent last{};
+        if (!event_bus_latest<EventTopic::HeapLow>(last) || last.level != HeapLevel::Critical) {
+            HeapLowEvent e{};
+            e.level = HeapLevel::Critical;
+            e.freeBytes = freeHeap;
+            event_bus_publish<EventTopic::HeapLow>(e);
         }
         
         logbuf_printf("CRITICAL: Heap low: %u bytes (< %u threshold)", freeHeap, CRITICAL_HEAP_THRESHOLD);
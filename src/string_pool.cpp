@@ -1,27 +1,17 @@
 /*
  * String Pool Implementation
  * StampPLC CatM+GNSS FreeRTOS Modularization
- * 
+ *
  * Provides string pooling for frequently used strings to reduce heap fragmentation
  */
 
 #include "../include/string_pool.h"
-#include <freertos/FreeRTOS.h>
-#include <freertos/semphr.h>
 #include <string.h>
 
-// ============================================================================
-// COMMON STRING CONSTANTS
-// ============================================================================
-const char* STR_OK = "OK";
-const char* STR_ERROR = "ERROR";
-const char* STR_TIMEOUT = "TIMEOUT";
-const char* STR_CONNECTED = "CONNECTED";
-const char* STR_DISCONNECTED = "DISCONNECTED";
-const char* STR_INITIALIZING = "INITIALIZING";
-const char* STR_READY = "READY";
-const char* STR_FAILED = "FAILED";
-const char* STR_SUCCESS = "SUCCESS";
+namespace {
+constexpr uint32_t kSlotMask = STRING_POOL_SLOTS - 1;
+constexpr uint32_t kCleanupThresholdMs = 30000; // 30 seconds
+}
 
 // ============================================================================
 // GLOBAL STRING POOL INSTANCE
@@ -31,13 +21,10 @@ StringPool g_stringPool;
 // ============================================================================
 // CONSTRUCTOR/DESTRUCTOR
 // ============================================================================
-StringPool::StringPool() : mutex(nullptr), totalAllocations(0), totalHits(0) {
-    // Initialize pool entries
-    for (int i = 0; i < STRING_POOL_SIZE; i++) {
-        pool[i].string[0] = '\0';
-        pool[i].inUse = false;
-        pool[i].lastUsed = 0;
-    }
+StringPool::StringPool()
+    : arenaUsed(0), entryCount(0), mux(portMUX_INITIALIZER_UNLOCKED), ready(false),
+      totalAllocations(0), totalHits(0) {
+    memset(index, 0, sizeof(index));
 }
 
 StringPool::~StringPool() {
@@ -48,113 +35,202 @@ StringPool::~StringPool() {
 // POOL MANAGEMENT
 // ============================================================================
 bool StringPool::begin() {
-    mutex = xSemaphoreCreateMutex();
-    if (!mutex) {
-        Serial.println("StringPool: Failed to create mutex");
-        return false;
-    }
-    
+    ready = true;
     Serial.println("StringPool: Initialized successfully");
     return true;
 }
 
 void StringPool::shutdown() {
-    if (mutex) {
-        vSemaphoreDelete(mutex);
-        mutex = nullptr;
-    }
+    ready = false;
 }
 
 // ============================================================================
 // STRING OPERATIONS
 // ============================================================================
 const char* StringPool::getString(const char* str) {
-    if (!str || !mutex) return str;
-    
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return str; // Fallback to original string
-    }
-    
+    if (!str || !ready) return str;
+
+    size_t len = 0;
+    const uint32_t hash = hashOf(str, len);
+    if (len >= MAX_STRING_LENGTH) return str; // Too long to pool
+
+    portENTER_CRITICAL(&mux);
+
     // Check if string already exists in pool
-    int existingIndex = findExistingString(str);
-    if (existingIndex >= 0) {
-        pool[existingIndex].lastUsed = millis();
+    int slot = findExistingString(str, hash);
+    if (slot >= 0) {
+        index[slot].inUse = true;
+        index[slot].lastUsed = millis();
         totalHits++;
-        xSemaphoreGive(mutex);
-        return pool[existingIndex].string;
+        const char* pooled = arena + index[slot].offset;
+        portEXIT_CRITICAL(&mux);
+        return pooled;
     }
-    
-    // Find available slot
-    int slotIndex = findAvailableSlot();
-    if (slotIndex < 0) {
+
+    uint8_t cap = 0;
+    int offset = takeSpan(len + 1, cap);
+    if (offset < 0) {
         // Pool is full, cleanup and try again
         cleanupUnusedStrings();
-        slotIndex = findAvailableSlot();
+        offset = takeSpan(len + 1, cap);
     }
-    
-    if (slotIndex >= 0) {
-        // Copy string to pool
-        strncpy(pool[slotIndex].string, str, MAX_STRING_LENGTH - 1);
-        pool[slotIndex].string[MAX_STRING_LENGTH - 1] = '\0';
-        pool[slotIndex].inUse = true;
-        pool[slotIndex].lastUsed = millis();
-        totalAllocations++;
-        
-        xSemaphoreGive(mutex);
-        return pool[slotIndex].string;
+    if (offset < 0) {
+        portEXIT_CRITICAL(&mux);
+        return str; // Fallback to original string
     }
-    
-    xSemaphoreGive(mutex);
-    return str; // Fallback to original string
+
+    slot = findAvailableSlot(hash);
+    StringPoolEntry& e = index[slot];
+    e.hash = hash;
+    e.lastUsed = millis();
+    e.offset = static_cast<uint16_t>(offset);
+    e.cap = cap;
+    e.inUse = true;
+    entryCount++;
+    memcpy(arena + offset, str, len + 1);
+    totalAllocations++;
+    portEXIT_CRITICAL(&mux);
+    return arena + offset;
 }
 
 void StringPool::releaseString(const char* str) {
-    if (!str || !mutex) return;
-    
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        return;
-    }
-    
-    // Find and mark string as unused
-    for (int i = 0; i < STRING_POOL_SIZE; i++) {
-        if (pool[i].inUse && strcmp(pool[i].string, str) == 0) {
-            pool[i].inUse = false;
-            break;
-        }
+    if (!str || !ready) return;
+
+    size_t len = 0;
+    const uint32_t hash = hashOf(str, len);
+    if (len >= MAX_STRING_LENGTH) return;
+
+    portENTER_CRITICAL(&mux);
+    const int slot = findExistingString(str, hash);
+    if (slot >= 0) {
+        index[slot].inUse = false;
     }
-    
-    xSemaphoreGive(mutex);
+    portEXIT_CRITICAL(&mux);
 }
 
 // ============================================================================
 // PRIVATE METHODS
 // ============================================================================
-int StringPool::findAvailableSlot() {
-    for (int i = 0; i < STRING_POOL_SIZE; i++) {
-        if (!pool[i].inUse) {
-            return i;
+// FNV-1a; also measures the string, stopping once it is too long to pool
+uint32_t StringPool::hashOf(const char* str, size_t& len) {
+    uint32_t h = 2166136261u;
+    len = 0;
+    while (str[len] && len < MAX_STRING_LENGTH) {
+        h = (h ^ static_cast<uint8_t>(str[len])) * 16777619u;
+        len++;
+    }
+    return h;
+}
+
+int StringPool::findExistingString(const char* str, uint32_t hash) const {
+    for (uint32_t i = hash & kSlotMask, n = 0; n < STRING_POOL_SLOTS; i = (i + 1) & kSlotMask, n++) {
+        const StringPoolEntry& e = index[i];
+        if (e.cap == 0) {
+            return -1;
+        }
+        if (e.hash == hash && strcmp(arena + e.offset, str) == 0) {
+            return static_cast<int>(i);
         }
     }
     return -1;
 }
 
-int StringPool::findExistingString(const char* str) {
-    for (int i = 0; i < STRING_POOL_SIZE; i++) {
-        if (pool[i].inUse && strcmp(pool[i].string, str) == 0) {
-            return i;
+// The index is never more than 3/4 full, so an empty slot is always reachable
+int StringPool::findAvailableSlot(uint32_t hash) const {
+    uint32_t i = hash & kSlotMask;
+    while (index[i].cap != 0) {
+        i = (i + 1) & kSlotMask;
+    }
+    return static_cast<int>(i);
+}
+
+// Arena space for a new entry, with room in the index for it: fresh space from
+// the bump pointer, else the smallest released string that fits (its index slot
+// goes too), else, once the index is full, the oldest released string is evicted
+// to make room. -1 when only strings in use are left.
+int StringPool::takeSpan(size_t need, uint8_t& cap) {
+    const bool indexFull = entryCount >= STRING_POOL_SIZE;
+    if (!indexFull && arenaUsed + need <= STRING_POOL_ARENA_BYTES) {
+        const int offset = arenaUsed;
+        arenaUsed += need;
+        cap = static_cast<uint8_t>(need);
+        return offset;
+    }
+
+    int best = -1;
+    int oldest = -1;
+    uint32_t now = millis();
+    for (int i = 0; i < STRING_POOL_SLOTS; i++) {
+        const StringPoolEntry& e = index[i];
+        if (e.cap == 0 || e.inUse) continue;
+        if (e.cap >= need && (best < 0 || e.cap < index[best].cap)) best = i;
+        if (oldest < 0 || now - e.lastUsed > now - index[oldest].lastUsed) oldest = i;
+    }
+    if (best >= 0) {
+        const int offset = index[best].offset;
+        cap = index[best].cap;
+        removeEntry(best);
+        return offset;
+    }
+    if (!indexFull || oldest < 0) {
+        return -1;
+    }
+    const uint16_t oldOffset = index[oldest].offset;
+    const uint8_t oldCap = index[oldest].cap;
+    removeEntry(oldest);
+    freeSpan(oldOffset, oldCap);
+    if (arenaUsed + need > STRING_POOL_ARENA_BYTES) {
+        return -1;
+    }
+    const int offset = arenaUsed;
+    arenaUsed += need;
+    cap = static_cast<uint8_t>(need);
+    return offset;
+}
+
+// Gives a span back: to the bump pointer when it is the last one, else to the
+// entry just before it. Only a span at the very start of the arena is lost.
+void StringPool::freeSpan(uint16_t offset, uint8_t cap) {
+    if (offset + cap == arenaUsed) {
+        arenaUsed = offset;
+        return;
+    }
+    for (int i = 0; i < STRING_POOL_SLOTS; i++) {
+        StringPoolEntry& e = index[i];
+        if (e.cap != 0 && e.offset + e.cap == offset && e.cap + cap <= 255) {
+            e.cap = static_cast<uint8_t>(e.cap + cap);
+            return;
+        }
+    }
+}
+
+// Linear-probing delete: later entries of the same probe run shift back into the
+// hole, so lookups never need tombstones
+void StringPool::removeEntry(int slot) {
+    uint32_t hole = static_cast<uint32_t>(slot);
+    uint32_t j = hole;
+    for (;;) {
+        j = (j + 1) & kSlotMask;
+        if (index[j].cap == 0) break;
+        const uint32_t home = index[j].hash & kSlotMask;
+        // The entry at j may move back only if its home is not cyclically in (hole, j]
+        const bool stays = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            index[hole] = index[j];
+            hole = j;
         }
     }
-    return -1;
+    index[hole].cap = 0;
+    index[hole].inUse = false;
+    entryCount--;
 }
 
 void StringPool::cleanupUnusedStrings() {
     uint32_t currentTime = millis();
-    const uint32_t CLEANUP_THRESHOLD = 30000; // 30 seconds
-    
-    for (int i = 0; i < STRING_POOL_SIZE; i++) {
-        if (pool[i].inUse && (currentTime - pool[i].lastUsed) > CLEANUP_THRESHOLD) {
-            pool[i].inUse = false;
-            pool[i].string[0] = '\0';
+
+    for (int i = 0; i < STRING_POOL_SLOTS; i++) {
+        if (index[i].cap != 0 && index[i].inUse && (currentTime - index[i].lastUsed) > kCleanupThresholdMs) {
+            index[i].inUse = false;
         }
     }
 }
@@ -164,27 +240,31 @@ void StringPool::cleanupUnusedStrings() {
 // ============================================================================
 uint32_t StringPool::getUsedSlots() const {
     uint32_t count = 0;
-    for (int i = 0; i < STRING_POOL_SIZE; i++) {
-        if (pool[i].inUse) count++;
+    for (int i = 0; i < STRING_POOL_SLOTS; i++) {
+        if (index[i].cap != 0 && index[i].inUse) count++;
     }
     return count;
 }
 
 void StringPool::printStatistics() const {
-    if (!mutex) return;
-    
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        Serial.printf("StringPool Stats: Allocations=%u, Hits=%u, Used=%u/%d\n",
-                     totalAllocations, totalHits, getUsedSlots(), STRING_POOL_SIZE);
-        xSemaphoreGive(mutex);
-    }
+    if (!ready) return;
+
+    portENTER_CRITICAL(&mux);
+    const uint32_t allocations = totalAllocations;
+    const uint32_t hits = totalHits;
+    const uint32_t used = getUsedSlots();
+    const uint32_t indexed = entryCount;
+    const uint32_t bytes = arenaUsed;
+    portEXIT_CRITICAL(&mux);
+
+    Serial.printf("StringPool Stats: Allocations=%u, Hits=%u, Used=%u/%d (indexed %u), Arena=%u/%d bytes\n",
+                  allocations, hits, used, STRING_POOL_SIZE, indexed, bytes, STRING_POOL_ARENA_BYTES);
 }
 
 void StringPool::cleanup() {
-    if (!mutex) return;
-    
-    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        cleanupUnusedStrings();
-        xSemaphoreGive(mutex);
-    }
+    if (!ready) return;
+
+    portENTER_CRITICAL(&mux);
+    cleanupUnusedStrings();
+    portEXIT_CRITICAL(&mux);
 }
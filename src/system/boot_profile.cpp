@@ -0,0 +1,195 @@
+/*
+ * Boot Profile Implementation
+ */
+
+#include "boot_profile.h"
+#include "kernel_objects.h"
+#include "../modules/logging/log_buffer.h"
+#include "../../include/transport.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <esp_system.h>
+#include <stdio.h>
+
+namespace {
+constexpr size_t kStages = static_cast<size_t>(BootStage::Count);
+static_assert(kStages <= 24, "boot stages are event group bits");
+
+#define BOOT_STAGE_NAME(id, name, deps) name,
+#define BOOT_STAGE_DEPS(id, name, deps) static_cast<uint32_t>(deps),
+const char* const kNames[kStages] = {BOOT_STAGES(BOOT_STAGE_NAME)};
+const uint32_t kDeps[kStages] = {BOOT_STAGES(BOOT_STAGE_DEPS)};
+#undef BOOT_STAGE_NAME
+#undef BOOT_STAGE_DEPS
+
+struct Async {
+    BootStageFn fn;
+    void* ctx;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+EventGroupHandle_t s_done = nullptr;
+BootStageTimes s_times[kStages];
+Async s_async[kStages];
+bool s_uploaded = false;
+
+const char* resetName(esp_reset_reason_t r) {
+    switch (r) {
+        case ESP_RST_POWERON: return "poweron";
+        case ESP_RST_EXT: return "ext";
+        case ESP_RST_SW: return "sw";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "int_wdt";
+        case ESP_RST_TASK_WDT: return "task_wdt";
+        case ESP_RST_WDT: return "wdt";
+        case ESP_RST_DEEPSLEEP: return "deepsleep";
+        case ESP_RST_BROWNOUT: return "brownout";
+        default: return "other";
+    }
+}
+
+void asyncJob(void* ctx) {
+    const BootStage stage = static_cast<BootStage>(reinterpret_cast<uintptr_t>(ctx));
+    const Async& a = s_async[static_cast<size_t>(stage)];
+    boot_stage_begin(stage);
+    const bool ok = a.fn(a.ctx);
+    boot_stage_end(stage, ok);
+}
+
+void upload() {
+    static char json[TRANSPORT_MAX_PACKET_BYTES];   // modem task stack is tight
+    int len = snprintf(json, sizeof(json), "{\"boot_reset\":\"%s\",\"boot_ms\":{", resetName(esp_reset_reason()));
+    bool first = true;
+    for (size_t i = 0; i < kStages && len > 0 && (size_t)len < sizeof(json); i++) {
+        const BootStageTimes& t = s_times[i];
+        if (t.core < 0 || !t.endMs) continue;
+        len += snprintf(json + len, sizeof(json) - len, "%s\"%s\":[%lu,%lu%s]", first ? "" : ",", t.name,
+                        (unsigned long)t.startMs, (unsigned long)(t.endMs - t.startMs), t.ok ? "" : ",0");
+        first = false;
+    }
+    if (len > 0 && (size_t)len < sizeof(json)) {
+        const BootStageTimes& scan = s_times[static_cast<size_t>(BootStage::FirstPlcScan)];
+        const BootStageTimes& up = s_times[static_cast<size_t>(BootStage::FirstUplink)];
+        len += snprintf(json + len, sizeof(json) - len, "},\"boot_scan_ms\":%lu,\"boot_uplink_ms\":%lu}",
+                        (unsigned long)scan.endMs, (unsigned long)up.endMs);
+    }
+    if (len <= 0 || (size_t)len >= sizeof(json)) {
+        logbuf_printf("Boot: profile does not fit one record");
+        s_uploaded = true;
+        return;
+    }
+    s_uploaded = transport_sendDiagnostic(json, len);
+}
+} // namespace
+
+bool boot_profile_begin() {
+    if (s_done) return true;
+    for (size_t i = 0; i < kStages; i++) {
+        s_times[i] = BootStageTimes{kNames[i], 0, 0, -1, false};
+    }
+    s_done = kernel_event_group_create(KernelEventGroup::BootStages);
+    return s_done != nullptr;
+}
+
+void boot_stage_begin(BootStage stage) {
+    const size_t i = static_cast<size_t>(stage);
+    if (i >= kStages) return;
+    const uint32_t deps = kDeps[i];
+    if (deps && s_done) {
+        const EventBits_t have = xEventGroupWaitBits(s_done, deps, pdFALSE, pdTRUE, pdMS_TO_TICKS(BOOT_STAGE_DEP_WAIT_MS));
+        if ((have & deps) != deps) {
+            for (size_t d = 0; d < kStages; d++) {
+                if ((deps & ~have) & (1UL << d)) logbuf_printf("Boot: %s started without %s", kNames[i], kNames[d]);
+            }
+        }
+    }
+    portENTER_CRITICAL(&s_mux);
+    s_times[i].startMs = millis();
+    s_times[i].core = static_cast<int8_t>(xPortGetCoreID());
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void boot_stage_end(BootStage stage, bool ok) {
+    const size_t i = static_cast<size_t>(stage);
+    if (i >= kStages) return;
+    portENTER_CRITICAL(&s_mux);
+    s_times[i].endMs = millis();
+    if (!s_times[i].endMs) s_times[i].endMs = 1;
+    s_times[i].ok = ok;
+    portEXIT_CRITICAL(&s_mux);
+    if (s_done) xEventGroupSetBits(s_done, 1UL << i);
+}
+
+void boot_mark(BootStage stage) {
+    const size_t i = static_cast<size_t>(stage);
+    if (i >= kStages || s_times[i].endMs) return;
+    portENTER_CRITICAL(&s_mux);
+    const bool first = !s_times[i].endMs;
+    if (first) {
+        s_times[i].startMs = millis();
+        s_times[i].endMs = s_times[i].startMs ? s_times[i].startMs : 1;
+        s_times[i].core = static_cast<int8_t>(xPortGetCoreID());
+        s_times[i].ok = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (first && s_done) xEventGroupSetBits(s_done, 1UL << i);
+}
+
+bool boot_stage_done(BootStage stage) {
+    const size_t i = static_cast<size_t>(stage);
+    return i < kStages && s_times[i].endMs != 0;
+}
+
+bool boot_stage_wait(BootStage stage, uint32_t timeoutMs) {
+    const size_t i = static_cast<size_t>(stage);
+    if (i >= kStages) return false;
+    if (!s_done) return boot_stage_done(stage);
+    return (xEventGroupWaitBits(s_done, 1UL << i, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs)) & (1UL << i)) != 0;
+}
+
+bool boot_stage_async(BootStage stage, BootStageFn fn, void* ctx, uint8_t core) {
+    const size_t i = static_cast<size_t>(stage);
+    if (i >= kStages || !fn) return false;
+    s_async[i] = Async{fn, ctx};
+    if (work_submit(kNames[i], asyncJob, reinterpret_cast<void*>(static_cast<uintptr_t>(i)), WorkPriority::High,
+                    core) != WORK_ID_NONE) {
+        return true;
+    }
+    // No worker: run it here
+    asyncJob(reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+    return true;
+}
+
+bool boot_stage_times(BootStage stage, BootStageTimes& out) {
+    const size_t i = static_cast<size_t>(stage);
+    if (i >= kStages) return false;
+    portENTER_CRITICAL(&s_mux);
+    out = s_times[i];
+    portEXIT_CRITICAL(&s_mux);
+    return out.core >= 0;
+}
+
+void boot_profile_report(Print& out) {
+    out.printf("Boot profile (reset: %s)\n", resetName(esp_reset_reason()));
+    out.println("  stage   core  start ms    took ms");
+    for (size_t i = 0; i < kStages; i++) {
+        BootStageTimes t;
+        if (!boot_stage_times(static_cast<BootStage>(i), t)) continue;
+        if (t.endMs) {
+            out.printf("  %-7s %4d %9lu %10lu%s\n", t.name, t.core, (unsigned long)t.startMs,
+                       (unsigned long)(t.endMs - t.startMs), t.ok ? "" : "  FAILED");
+        } else {
+            out.printf("  %-7s %4d %9lu    running\n", t.name, t.core, (unsigned long)t.startMs);
+        }
+    }
+}
+
+void boot_profile_poll(uint32_t now) {
+    (void)now;
+    if (s_uploaded) return;
+    if (!boot_stage_done(BootStage::FirstUplink)) {
+        if (transport_getStats().sent == 0) return;
+        boot_mark(BootStage::FirstUplink);
+    }
+    upload();
+}
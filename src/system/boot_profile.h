@@ -0,0 +1,83 @@
+/*
+ * Boot Profile
+ * setup() as a small dependency graph of stages with a timestamp for each.
+ *   - every stage lists the stages it needs (BOOT_STAGES below);
+ *     boot_stage_begin() waits until those are done, so a stage moved to a
+ *     worker or reordered in setup() still starts after its inputs
+ *   - boot_stage_async() runs a stage on a work queue worker (work_queue.h)
+ *     while setup() carries on; the modem probe overlaps SD mount, icon
+ *     rendering and the I2C bring-up that way
+ *   - FirstPlcScan and FirstUplink are milestones marked where they happen
+ *     (first PLC I/O update, first record the transport delivered)
+ *   - once the first uplink is in, the stage table goes out once as a
+ *     Diagnostic record together with the reset reason, so time to first scan
+ *     and first uplink after a watchdog reset can be compared across the fleet
+ *
+ * Times are milliseconds since reset (millis()).
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <Arduino.h>
+#include "work_queue.h"
+
+#ifndef BOOT_STAGE_DEP_WAIT_MS
+#define BOOT_STAGE_DEP_WAIT_MS 30000      // a stage starts anyway after this, and says which input is late
+#endif
+
+#define BOOT_DEP(id) (1UL << static_cast<uint8_t>(BootStage::id))
+
+//   X(id, short name for the upload, stages it needs)
+#define BOOT_STAGES(X)                                                                   \
+    X(Hardware, "hw", 0)                                      /* M5StamPLC, display */  \
+    X(Memory, "mem", BOOT_DEP(Hardware))                      /* monitors, workers */   \
+    X(CrashRecovery, "crash", BOOT_DEP(Memory))                                         \
+    X(Settings, "nvs", BOOT_DEP(Memory))                                                \
+    X(Kernel, "kobj", BOOT_DEP(Memory))                       /* UI queue, log sink */  \
+    X(CatM, "catm", BOOT_DEP(Settings) | BOOT_DEP(Kernel))                              \
+    X(Sensors, "i2c", BOOT_DEP(Hardware))                     /* RTC, LM75B, INA226 */  \
+    X(Icons, "icons", BOOT_DEP(Hardware))                                               \
+    X(StampPlc, "plc", BOOT_DEP(Sensors))                     /* same I2C bus */        \
+    X(Sd, "sd", BOOT_DEP(Settings))                                                     \
+    X(Storage, "store", BOOT_DEP(Sd) | BOOT_DEP(Kernel))                                \
+    X(Pwrcan, "can", BOOT_DEP(Hardware))                                                \
+    X(Tasks, "tasks", BOOT_DEP(StampPlc) | BOOT_DEP(Icons) | BOOT_DEP(Storage) | BOOT_DEP(Kernel)) \
+    X(Ready, "ready", BOOT_DEP(Tasks))                                                  \
+    X(FirstPlcScan, "scan1", 0)                               /* milestone */           \
+    X(FirstUplink, "up1", 0)                                  /* milestone */
+
+#define BOOT_STAGE_ID(id, ...) id,
+enum class BootStage : uint8_t { BOOT_STAGES(BOOT_STAGE_ID) Count };
+#undef BOOT_STAGE_ID
+
+typedef bool (*BootStageFn)(void* ctx);
+
+struct BootStageTimes {
+    const char* name;
+    uint32_t startMs;
+    uint32_t endMs;          // 0 = not finished
+    int8_t core;             // -1 = not started
+    bool ok;
+};
+
+// Call first thing in setup()
+bool boot_profile_begin();
+
+// Waits for the stage's dependencies, then stamps its start
+void boot_stage_begin(BootStage stage);
+void boot_stage_end(BootStage stage, bool ok = true);
+// begin + end at once for milestones; only the first call counts
+void boot_mark(BootStage stage);
+bool boot_stage_done(BootStage stage);
+bool boot_stage_wait(BootStage stage, uint32_t timeoutMs);
+
+// Runs begin, fn(ctx), end on a work queue worker; fn's result is the stage's ok
+bool boot_stage_async(BootStage stage, BootStageFn fn, void* ctx, uint8_t core = WORK_CORE_MODEM);
+
+bool boot_stage_times(BootStage stage, BootStageTimes& out);
+void boot_profile_report(Print& out);
+// Watches for the first uplink and sends the profile once; call from the modem task
+void boot_profile_poll(uint32_t now);
+
+#endif // BOOT_PROFILE_H
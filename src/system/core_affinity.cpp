@@ -0,0 +1,410 @@
+/*
+ * Core Affinity Tuner Implementation
+ */
+
+#include "core_affinity.h"
+
+#if CORE_AFFINITY_ENABLE
+
+#include "cpu_profiler.h"
+#include "service_task.h"
+#include "trace_recorder.h"
+#include "../modules/logging/log_buffer.h"
+#include <Preferences.h>
+#include <freertos/task.h>
+#include <string.h>
+
+namespace {
+constexpr size_t kTasks = static_cast<size_t>(KernelTask::Count);
+constexpr uint32_t kMagic = 0x31464143;   // "CAF1"
+constexpr const char* kNamespace = "affinity";
+constexpr const char* kKey = "layout";
+constexpr uint8_t kUnset = 0xFF;
+constexpr uint8_t kAppCore = CORE_AFFINITY_RADIO_CORE ? 0 : 1;
+constexpr size_t kWakeups = 24;
+
+#define CORE_AFFINITY_NAME(id, name, stack) name,
+const char* const kNames[kTasks] = {KERNEL_TASKS(CORE_AFFINITY_NAME)};
+#undef CORE_AFFINITY_NAME
+
+AffinityRole roleOf(KernelTask id) {
+    switch (id) {
+        case KernelTask::CatMGNSS:
+        case KernelTask::ModemIO:
+            return AffinityRole::Radio;
+        case KernelTask::StampPLC:
+        case KernelTask::Display:
+        case KernelTask::Modbus:
+        case KernelTask::Rs485Rx:     // UART interrupt lives on the Modbus core
+            return AffinityRole::App;
+        case KernelTask::Work0:
+        case KernelTask::Work1:
+            return AffinityRole::Fixed;
+        default:
+            return AffinityRole::Float;
+    }
+}
+
+const char* roleName(AffinityRole role) {
+    switch (role) {
+        case AffinityRole::Radio: return "radio";
+        case AffinityRole::App: return "app";
+        case AffinityRole::Fixed: return "fixed";
+        default: return "float";
+    }
+}
+
+// NVS image; tableHash ties it to the task names it was planned for
+struct Saved {
+    uint32_t magic;
+    uint32_t tableHash;
+    uint16_t gen;                    // layouts applied so far, 0 = coded cores
+    uint16_t count;
+    uint8_t cores[kTasks];           // kUnset = as coded in setup()
+    AffinityJitter before[kTasks];   // jitter of the layout this one replaced
+};
+
+struct Jitter {
+    uint32_t lastUs;
+    uint32_t samples;
+    uint64_t sumUs;
+    uint32_t maxUs;
+};
+
+struct Pair {
+    int8_t a;                        // kernel task index, or -1 - core for a task outside the table
+    int8_t b;
+    uint16_t costPermille;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Saved s_saved;
+bool s_loaded = false;
+uint8_t s_created[kTasks];           // core each task was last created on
+Jitter s_jitter[kTasks];
+int s_job = SERVICE_JOB_NONE;
+
+// Last evaluation
+CpuTaskStats s_cpu[CPU_PROFILE_TASKS];
+TraceWakeup s_wake[kWakeups];
+Pair s_pairs[kWakeups];
+size_t s_pairCount = 0;
+uint16_t s_load[kTasks];             // permille of one core, long window
+uint8_t s_current[kTasks];
+uint8_t s_plan[kTasks];
+uint8_t s_lastPlan[kTasks];
+uint16_t s_base[2];                  // core load outside the movable tasks
+uint16_t s_costNow = 0;
+uint16_t s_costPlan = 0;
+uint32_t s_crossPerSec = 0;
+uint32_t s_spanMs = 0;
+bool s_evaluated = false;
+bool s_violation = false;
+bool s_recommend = false;
+uint8_t s_streak = 0;
+bool s_appliedThisBoot = false;
+
+uint32_t tableHash() {
+    uint32_t h = 2166136261u;   // FNV-1a over the names, in table order
+    for (size_t i = 0; i < kTasks; i++) {
+        for (const char* p = kNames[i]; *p; p++) h = (h ^ static_cast<uint8_t>(*p)) * 16777619u;
+        h = (h ^ 0xFF) * 16777619u;
+    }
+    return h;
+}
+
+void resetImage() {
+    memset(&s_saved, 0, sizeof(s_saved));
+    s_saved.magic = kMagic;
+    s_saved.tableHash = tableHash();
+    s_saved.count = kTasks;
+    memset(s_saved.cores, kUnset, sizeof(s_saved.cores));
+}
+
+void ensureLoaded() {
+    if (s_loaded) return;
+    s_loaded = true;
+    memset(s_created, kUnset, sizeof(s_created));
+    resetImage();
+    Preferences prefs;
+    if (prefs.begin(kNamespace, true)) {
+        Saved stored;
+        if (prefs.getBytes(kKey, &stored, sizeof(stored)) == sizeof(stored) && stored.magic == kMagic &&
+            stored.tableHash == s_saved.tableHash && stored.count == kTasks) {
+            s_saved = stored;
+        }
+        prefs.end();
+    }
+}
+
+bool save() {
+    Preferences prefs;
+    if (!prefs.begin(kNamespace, false)) return false;
+    const bool ok = prefs.putBytes(kKey, &s_saved, sizeof(s_saved)) == sizeof(s_saved);
+    prefs.end();
+    return ok;
+}
+
+AffinityJitter jitterNow(size_t i) {
+    portENTER_CRITICAL(&s_mux);
+    const Jitter j = s_jitter[i];
+    portEXIT_CRITICAL(&s_mux);
+    AffinityJitter out{};
+    out.samples = j.samples;
+    out.avgUs = j.samples ? static_cast<uint32_t>(j.sumUs / j.samples) : 0;
+    out.maxUs = j.maxUs;
+    return out;
+}
+
+// Kernel task index for a handle, or -1 - core for another pinned task, or INT8_MIN
+int8_t endpoint(TaskHandle_t h, const TaskHandle_t* handles, size_t cpuCount) {
+    if (!h) return INT8_MIN;
+    for (size_t i = 0; i < kTasks; i++) {
+        if (handles[i] == h) return static_cast<int8_t>(i);
+    }
+    for (size_t i = 0; i < cpuCount; i++) {
+        if (s_cpu[i].task == h) return s_cpu[i].core >= 0 ? static_cast<int8_t>(-1 - s_cpu[i].core) : INT8_MIN;
+    }
+    return INT8_MIN;
+}
+
+uint8_t coreOf(int8_t ep, const uint8_t* layout) {
+    return ep >= 0 ? layout[ep] : static_cast<uint8_t>(-1 - ep);
+}
+
+// Busier core's load plus the cross-core wakeups, in permille of one core
+uint32_t cost(const uint8_t* layout, const bool* present) {
+    uint32_t load[2] = {s_base[0], s_base[1]};
+    for (size_t i = 0; i < kTasks; i++) {
+        if (present[i] && layout[i] < 2) load[layout[i]] += s_load[i];
+    }
+    uint32_t c = load[0] > load[1] ? load[0] : load[1];
+    for (size_t p = 0; p < s_pairCount; p++) {
+        const Pair& pr = s_pairs[p];
+        if (pr.a >= 0 && !present[pr.a]) continue;
+        if (pr.b >= 0 && !present[pr.b]) continue;
+        if (coreOf(pr.a, layout) != coreOf(pr.b, layout)) c += pr.costPermille;
+    }
+    return c;
+}
+
+void evaluateJob(void*) {
+    if (millis() < CORE_AFFINITY_SETTLE_MS) return;
+    core_affinity_evaluate();
+}
+} // namespace
+
+bool core_affinity_begin() {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    ensureLoaded();
+    s_job = service_job_add("Affinity", evaluateJob, nullptr, CORE_AFFINITY_EVAL_MS, CORE_AFFINITY_JOB_BUDGET_US);
+    Serial.printf("Affinity: radio core %u, layout gen %u%s\n", (unsigned)CORE_AFFINITY_RADIO_CORE,
+                  (unsigned)s_saved.gen, CORE_AFFINITY_APPLY ? "" : " (recommend only)");
+    return s_job != SERVICE_JOB_NONE;
+}
+
+BaseType_t core_affinity_core(KernelTask id, BaseType_t requested) {
+    const size_t i = static_cast<size_t>(id);
+    if (i >= kTasks) return requested;
+    ensureLoaded();
+    BaseType_t core = requested;
+#if CORE_AFFINITY_APPLY
+    if (roleOf(id) != AffinityRole::Fixed && s_saved.cores[i] < portNUM_PROCESSORS) {
+        core = s_saved.cores[i];
+    }
+#endif
+    s_created[i] = core >= 0 && core < portNUM_PROCESSORS ? static_cast<uint8_t>(core) : kUnset;
+    return core;
+}
+
+void core_affinity_period(KernelTask id, uint32_t periodUs) {
+    const size_t i = static_cast<size_t>(id);
+    if (i >= kTasks) return;
+    const uint32_t now = micros();
+    Jitter& j = s_jitter[i];
+    if (j.lastUs) {
+        const uint32_t interval = now - j.lastUs;
+        const uint32_t dev = interval > periodUs ? interval - periodUs : periodUs - interval;
+        portENTER_CRITICAL(&s_mux);
+        j.samples++;
+        j.sumUs += dev;
+        if (dev > j.maxUs) j.maxUs = dev;
+        portEXIT_CRITICAL(&s_mux);
+    }
+    j.lastUs = now ? now : 1;
+}
+
+bool core_affinity_jitter(KernelTask id, AffinityJitter& now, AffinityJitter& before) {
+    const size_t i = static_cast<size_t>(id);
+    if (i >= kTasks) return false;
+    now = jitterNow(i);
+    before = s_saved.before[i];
+    return now.samples || before.samples;
+}
+
+bool core_affinity_evaluate() {
+#if portNUM_PROCESSORS < 2
+    return false;
+#else
+    ensureLoaded();
+    CpuCoreStats cs[2];
+    if (!cpu_profile_core(0, cs[0]) || !cpu_profile_core(1, cs[1])) return false;
+    const size_t cpuCount = cpu_profile_tasks(s_cpu, CPU_PROFILE_TASKS);
+    if (!cpuCount) return false;
+
+    TaskHandle_t handles[kTasks];
+    bool present[kTasks];
+    uint32_t movable[2] = {0, 0};
+    for (size_t i = 0; i < kTasks; i++) {
+        handles[i] = xTaskGetHandle(kNames[i]);
+        present[i] = handles[i] != nullptr;
+        s_load[i] = 0;
+        s_current[i] = s_created[i];
+        if (!present[i]) continue;
+        for (size_t k = 0; k < cpuCount; k++) {
+            if (s_cpu[k].task != handles[i]) continue;
+            s_load[i] = s_cpu[k].permille[CPU_WINDOW_LONG];
+            if (s_current[i] == kUnset && s_cpu[k].core >= 0) s_current[i] = static_cast<uint8_t>(s_cpu[k].core);
+            break;
+        }
+        if (s_current[i] >= 2) {
+            present[i] = false;   // unpinned: the scheduler already moves it
+            continue;
+        }
+        movable[s_current[i]] += s_load[i];
+    }
+    for (uint8_t c = 0; c < 2; c++) {
+        const uint32_t busy = cs[c].busyPermille[CPU_WINDOW_LONG];
+        s_base[c] = static_cast<uint16_t>(busy > movable[c] ? busy - movable[c] : 0);
+    }
+
+    // Wakeup pairs, priced per second of trace
+    uint32_t spanUs = 0;
+    const size_t wakeCount = trace_recorder_wakeups(s_wake, kWakeups, &spanUs);
+    s_pairCount = 0;
+    s_crossPerSec = 0;
+    s_spanMs = spanUs / 1000;
+    for (size_t w = 0; w < wakeCount && spanUs; w++) {
+        const int8_t a = endpoint(s_wake[w].waker, handles, cpuCount);
+        const int8_t b = endpoint(s_wake[w].woken, handles, cpuCount);
+        if (a == INT8_MIN || b == INT8_MIN || (a < 0 && b < 0)) continue;
+        const uint64_t perSec = (uint64_t)(s_wake[w].crossCore + s_wake[w].sameCore) * 1000000ULL / spanUs;
+        s_crossPerSec += static_cast<uint32_t>((uint64_t)s_wake[w].crossCore * 1000000ULL / spanUs);
+        const uint64_t permille = perSec * CORE_AFFINITY_WAKEUP_COST_US / 1000;
+        if (!permille) continue;
+        s_pairs[s_pairCount++] = Pair{a, b, static_cast<uint16_t>(permille > 1000 ? 1000 : permille)};
+    }
+
+    // Roles first, then every split of the floating tasks
+    uint8_t layout[kTasks];
+    size_t floats[kTasks];
+    size_t floatCount = 0;
+    s_violation = false;
+    for (size_t i = 0; i < kTasks; i++) {
+        layout[i] = s_current[i];
+        if (!present[i]) continue;
+        const AffinityRole role = roleOf(static_cast<KernelTask>(i));
+        if (role == AffinityRole::Radio) layout[i] = CORE_AFFINITY_RADIO_CORE;
+        else if (role == AffinityRole::App) layout[i] = kAppCore;
+        else if (role == AffinityRole::Float) floats[floatCount++] = i;
+        if (layout[i] != s_current[i]) s_violation = true;
+    }
+    s_costNow = static_cast<uint16_t>(cost(s_current, present));
+    uint32_t best = UINT32_MAX;
+    uint8_t bestLayout[kTasks];
+    memcpy(bestLayout, layout, sizeof(layout));
+    for (uint32_t mask = 0; mask < (1UL << floatCount); mask++) {
+        for (size_t f = 0; f < floatCount; f++) layout[floats[f]] = (mask >> f) & 1;
+        const uint32_t c = cost(layout, present);
+        if (c < best) {
+            best = c;
+            memcpy(bestLayout, layout, sizeof(layout));
+        }
+    }
+    s_costPlan = static_cast<uint16_t>(best);
+
+    s_recommend = s_violation || s_costNow >= s_costPlan + CORE_AFFINITY_MIN_GAIN_PERMILLE;
+    memcpy(s_plan, s_recommend ? bestLayout : s_current, sizeof(s_plan));
+    if (!s_recommend) {
+        s_streak = 0;
+    } else if (s_streak && memcmp(s_plan, s_lastPlan, sizeof(s_plan)) == 0) {
+        if (s_streak < UINT8_MAX) s_streak++;
+    } else {
+        s_streak = 1;
+    }
+    memcpy(s_lastPlan, s_plan, sizeof(s_plan));
+    s_evaluated = true;
+
+#if CORE_AFFINITY_APPLY
+    if (s_recommend && s_streak >= 2 && !s_appliedThisBoot) {
+        for (size_t i = 0; i < kTasks; i++) {
+            s_saved.before[i] = jitterNow(i);
+            if (present[i]) s_saved.cores[i] = s_plan[i];
+        }
+        s_saved.gen++;
+        s_appliedThisBoot = true;
+        if (save()) {
+            logbuf_printf("Affinity: layout gen %u saved (cost %u -> %u permille); applies on next boot",
+                          (unsigned)s_saved.gen, (unsigned)s_costNow, (unsigned)s_costPlan);
+        }
+    }
+#endif
+    return s_recommend;
+#endif
+}
+
+void core_affinity_report(Print& out) {
+    ensureLoaded();
+    out.printf("Core affinity: radio core %u, app core %u, layout gen %u%s\n", (unsigned)CORE_AFFINITY_RADIO_CORE,
+               (unsigned)kAppCore, (unsigned)s_saved.gen, CORE_AFFINITY_APPLY ? "" : " (recommend only)");
+    if (s_evaluated) {
+        out.printf("  base load core0 %u.%u%% core1 %u.%u%%, cost now %u permille, planned %u permille\n",
+                   s_base[0] / 10, s_base[0] % 10, s_base[1] / 10, s_base[1] % 10, (unsigned)s_costNow,
+                   (unsigned)s_costPlan);
+        if (s_spanMs) {
+            out.printf("  cross-core wakeups %lu/s over %lu ms of trace\n", (unsigned long)s_crossPerSec,
+                       (unsigned long)s_spanMs);
+        } else {
+            out.println("  no wakeup trace (kernel trace hooks not built in); load only");
+        }
+    } else {
+        out.println("  not evaluated yet");
+    }
+    out.println("  task         role    load  core  plan  jitter now avg/max us  before avg/max us");
+    for (size_t i = 0; i < kTasks; i++) {
+        const uint8_t cur = s_evaluated ? s_current[i] : s_created[i];
+        if (cur == kUnset) continue;
+        const AffinityJitter now = jitterNow(i);
+        const AffinityJitter& before = s_saved.before[i];
+        out.printf("  %-12s %-6s %3u.%u%% %5u %5u", kNames[i], roleName(roleOf(static_cast<KernelTask>(i))),
+                   s_load[i] / 10, s_load[i] % 10, (unsigned)cur, (unsigned)(s_evaluated ? s_plan[i] : cur));
+        if (now.samples) {
+            out.printf("  %8lu/%-10lu", (unsigned long)now.avgUs, (unsigned long)now.maxUs);
+        } else {
+            out.print("                     ");
+        }
+        if (before.samples) out.printf("  %8lu/%lu", (unsigned long)before.avgUs, (unsigned long)before.maxUs);
+        out.println();
+    }
+    if (s_recommend) {
+        out.print("  recommended:");
+        for (size_t i = 0; i < kTasks; i++) {
+            if (s_plan[i] != s_current[i]) out.printf(" %s %u->%u", kNames[i], (unsigned)s_current[i], (unsigned)s_plan[i]);
+        }
+        out.println(s_violation ? " (roles)" : "");
+    }
+}
+
+void core_affinity_reset() {
+    ensureLoaded();
+    resetImage();
+    s_appliedThisBoot = false;
+    s_streak = 0;
+    Preferences prefs;
+    if (prefs.begin(kNamespace, false)) {
+        prefs.remove(kKey);
+        prefs.end();
+    }
+}
+
+#endif // CORE_AFFINITY_ENABLE
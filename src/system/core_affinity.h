@@ -0,0 +1,95 @@
+/*
+ * Core Affinity Tuner
+ * Places the tasks of the kernel object table (KERNEL_TASKS in task_config.h) on
+ * the two cores from measurements instead of the hand-chosen cores in setup().
+ *   - roles keep modem I/O (CatMGNSS, ModemIO) on the core that runs the
+ *     Wi-Fi/BT stack and the PLC scan and UI (StampPLC, Display) on the
+ *     other one; the per-core work queue workers stay where they are
+ *   - the remaining tasks go where the cost is lowest: the busier core's load
+ *     from the CPU profiler (long window) plus CORE_AFFINITY_WAKEUP_COST_US for
+ *     each cross-core wakeup per second counted by the trace recorder
+ *   - StampPLC reports its period jitter; the report shows it for
+ *     the running layout and for the one before it
+ *
+ * The ESP-IDF kernel pins a task when it is created, so a layout cannot move
+ * running tasks. With CORE_AFFINITY_APPLY a recommendation that holds for two
+ * evaluations in a row is saved to NVS and kernel_task_create() uses it from
+ * then on: at the next boot, or when a task is recreated (CatM hot-attach).
+ * Without it the tuner only reports. Wakeup counts need the kernel trace hooks
+ * (trace_hooks.h); without them placement uses load alone.
+ */
+
+#ifndef CORE_AFFINITY_H
+#define CORE_AFFINITY_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "../config/system_config.h"
+#include "kernel_objects.h"
+
+#ifndef CORE_AFFINITY_EVAL_MS
+#define CORE_AFFINITY_EVAL_MS 60000          // evaluation period
+#endif
+#ifndef CORE_AFFINITY_SETTLE_MS
+#define CORE_AFFINITY_SETTLE_MS (5UL * 60UL * 1000UL)   // first evaluation; fills the profiler history
+#endif
+#ifndef CORE_AFFINITY_WAKEUP_COST_US
+#define CORE_AFFINITY_WAKEUP_COST_US 25      // IPI, cache misses and the lost slice per cross-core wakeup
+#endif
+#ifndef CORE_AFFINITY_MIN_GAIN_PERMILLE
+#define CORE_AFFINITY_MIN_GAIN_PERMILLE 30   // smaller gains keep the current layout
+#endif
+#ifndef CORE_AFFINITY_RADIO_CORE
+#if defined(CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1) || defined(CONFIG_ESP32_WIFI_TASK_PINNED_TO_CORE_1)
+#define CORE_AFFINITY_RADIO_CORE 1
+#else
+#define CORE_AFFINITY_RADIO_CORE 0           // Wi-Fi task core (BT controller defaults to the same)
+#endif
+#endif
+#define CORE_AFFINITY_JOB_BUDGET_US 8000
+
+enum class AffinityRole : uint8_t {
+    Radio,      // modem I/O: next to the Wi-Fi/BT stack
+    App,        // PLC scan and UI: away from it
+    Float,      // placed by cost
+    Fixed       // one per core by design; never moved
+};
+
+struct AffinityJitter {
+    uint32_t samples;
+    uint32_t avgUs;          // mean |period - interval|
+    uint32_t maxUs;
+};
+
+#if CORE_AFFINITY_ENABLE
+
+// Loads the saved layout and schedules the evaluation job. Call once from setup().
+bool core_affinity_begin();
+
+// Core a task should be created on: the saved layout's with CORE_AFFINITY_APPLY,
+// otherwise requested. kernel_task_create() calls this.
+BaseType_t core_affinity_core(KernelTask id, BaseType_t requested);
+
+// Called once per period from a periodic task's loop
+void core_affinity_period(KernelTask id, uint32_t periodUs);
+bool core_affinity_jitter(KernelTask id, AffinityJitter& now, AffinityJitter& before);
+
+// Measures and plans now; true when the plan differs from the running layout
+bool core_affinity_evaluate();
+void core_affinity_report(Print& out);
+// Back to the cores coded in setup(), in RAM and in NVS
+void core_affinity_reset();
+
+#else
+
+inline bool core_affinity_begin() { return false; }
+inline BaseType_t core_affinity_core(KernelTask, BaseType_t requested) { return requested; }
+inline void core_affinity_period(KernelTask, uint32_t) {}
+inline bool core_affinity_jitter(KernelTask, AffinityJitter&, AffinityJitter&) { return false; }
+inline bool core_affinity_evaluate() { return false; }
+inline void core_affinity_report(Print&) {}
+inline void core_affinity_reset() {}
+
+#endif // CORE_AFFINITY_ENABLE
+
+#endif // CORE_AFFINITY_H
@@ -0,0 +1,367 @@
+/*
+ * CPU Profiler Implementation
+ */
+
+#include "cpu_profiler.h"
+#include "metrics.h"
+
+#if CPU_PROFILE_ENABLE
+
+#include <esp_freertos_hooks.h>
+#include <esp_idf_version.h>
+#include <string.h>
+
+#if defined(configGENERATE_RUN_TIME_STATS) && configGENERATE_RUN_TIME_STATS
+#define CPU_PROFILE_RUNTIME 1
+#else
+#define CPU_PROFILE_RUNTIME 0
+#endif
+
+namespace {
+constexpr uint8_t kNoSlot = 0xFF;
+constexpr size_t kStatusMax = CPU_PROFILE_TASKS + 8;   // tasks beyond the table are skipped
+constexpr uint8_t kFull = 200;                         // history unit: half percent of one core
+
+struct Slot {
+    TaskHandle_t task;
+    char name[16];
+    int8_t core;
+    UBaseType_t priority;
+    uint32_t lastCounter;     // run-time counter (or sampled ticks) at the previous sample
+    uint32_t ticks;           // ticks the hook saw this task running
+    uint32_t switches;
+    uint32_t runs[CPU_PROFILE_RUN_BUCKETS];
+    uint32_t maxRunTicks;
+    uint8_t samples;          // valid history entries, up to CPU_PROFILE_HISTORY
+    bool based;               // lastCounter holds a reading
+    bool seen;                // present in the current poll
+    uint8_t history[CPU_PROFILE_HISTORY];
+};
+
+struct Core {
+    TaskHandle_t current;
+    uint8_t slot;
+    uint32_t runTicks;
+    uint32_t switches;
+    uint32_t runs[CPU_PROFILE_RUN_BUCKETS];
+    uint8_t history[CPU_PROFILE_HISTORY];
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Slot s_slots[CPU_PROFILE_TASKS];
+Core s_cores[CPU_PROFILE_CORES];
+bool s_started = false;
+
+// Poller only
+TaskStatus_t s_status[kStatusMax];
+uint32_t s_lastSampleMs = 0;
+uint32_t s_lastTotal = 0;
+bool s_haveBase = false;
+uint8_t s_histIndex = 0;      // next history entry
+uint8_t s_histCount = 0;
+
+uint8_t bucketFor(uint32_t ticks) {
+    if (ticks <= 1) return 0;
+    if (ticks < 5) return 1;
+    if (ticks < 20) return 2;
+    if (ticks < 100) return 3;
+    if (ticks < 500) return 4;
+    return 5;
+}
+
+// Under s_mux
+uint8_t findSlot(TaskHandle_t task) {
+    for (uint8_t i = 0; i < CPU_PROFILE_TASKS; i++) {
+        if (s_slots[i].task == task) return i;
+    }
+    return kNoSlot;
+}
+
+TaskHandle_t idleTaskFor(uint8_t core) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    return xTaskGetIdleTaskHandleForCore(core);
+#else
+    return xTaskGetIdleTaskHandleForCPU(core);
+#endif
+}
+
+TaskHandle_t currentTaskOn(uint8_t core) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    return xTaskGetCurrentTaskHandleForCore(core);
+#else
+    return xTaskGetCurrentTaskHandleForCPU(core);
+#endif
+}
+
+void onTick(uint8_t core) {
+    TaskHandle_t cur = currentTaskOn(core);
+    portENTER_CRITICAL_ISR(&s_mux);
+    Core& c = s_cores[core];
+    if (cur == c.current) {
+        c.runTicks++;
+    } else {
+        if (c.current) {
+            const uint8_t b = bucketFor(c.runTicks);
+            c.runs[b]++;
+            if (c.slot != kNoSlot && s_slots[c.slot].task == c.current) {
+                Slot& s = s_slots[c.slot];
+                s.runs[b]++;
+                if (c.runTicks > s.maxRunTicks) s.maxRunTicks = c.runTicks;
+            }
+        }
+        c.current = cur;
+        c.runTicks = 1;
+        c.switches++;
+        c.slot = findSlot(cur);
+        if (c.slot != kNoSlot) s_slots[c.slot].switches++;
+    }
+    if (c.slot != kNoSlot && s_slots[c.slot].task == cur) s_slots[c.slot].ticks++;
+    portEXIT_CRITICAL_ISR(&s_mux);
+}
+
+void tickCore0() { onTick(0); }
+#if CPU_PROFILE_CORES > 1
+void tickCore1() { onTick(1); }
+#endif
+
+// Average of the last n entries of a history ring that ends at s_histIndex
+uint16_t windowPermille(const uint8_t* history, uint8_t available, CpuProfileWindow window) {
+    uint8_t n = window == CPU_WINDOW_LAST ? 1 : window == CPU_WINDOW_MID ? CPU_PROFILE_WINDOW_MID : CPU_PROFILE_HISTORY;
+    if (n > available) n = available;
+    if (!n) return 0;
+    uint32_t sum = 0;
+    for (uint8_t k = 1; k <= n; k++) {
+        sum += history[(s_histIndex + CPU_PROFILE_HISTORY - k) % CPU_PROFILE_HISTORY];
+    }
+    return static_cast<uint16_t>(sum * 5 / n);
+}
+
+// Under s_mux. New tasks take a free slot; a task already running on a core
+// starts collecting ticks now rather than at its next switch.
+uint8_t claimSlot(const TaskStatus_t& st) {
+    uint8_t i = findSlot(st.xHandle);
+    if (i != kNoSlot) return i;
+    for (i = 0; i < CPU_PROFILE_TASKS; i++) {
+        if (!s_slots[i].task) break;
+    }
+    if (i == CPU_PROFILE_TASKS) return kNoSlot;
+    Slot& s = s_slots[i];
+    memset(&s, 0, sizeof(s));
+    s.task = st.xHandle;
+    strncpy(s.name, st.pcTaskName, sizeof(s.name) - 1);
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+        if (s_cores[c].current == st.xHandle) s_cores[c].slot = i;
+    }
+    return i;
+}
+
+// Under s_mux
+void fillStats(const Slot& s, CpuTaskStats& out) {
+    out.task = s.task;
+    memcpy(out.name, s.name, sizeof(out.name));
+    out.core = s.core;
+    out.priority = s.priority;
+    for (uint8_t w = 0; w < CPU_WINDOW_COUNT; w++) {
+        out.permille[w] = windowPermille(s.history, s.samples, static_cast<CpuProfileWindow>(w));
+    }
+    out.switches = s.switches;
+    memcpy(out.runs, s.runs, sizeof(out.runs));
+    out.maxRunTicks = s.maxRunTicks;
+}
+
+// Per-core load over the middle window in the metrics registry, permille; -1 before the first sample
+int32_t coreLoadPermille(uint8_t core) {
+    const float load = cpu_profile_core_load(core, CPU_WINDOW_MID);
+    return load < 0.0f ? -1 : static_cast<int32_t>(load * 1000.0f + 0.5f);
+}
+MetricGauge s_metricLoad0("cpu.load0_pm", [] { return coreLoadPermille(0); });
+#if CPU_PROFILE_CORES > 1
+MetricGauge s_metricLoad1("cpu.load1_pm", [] { return coreLoadPermille(1); });
+#endif
+} // namespace
+
+bool cpu_profile_begin() {
+    if (s_started) return true;
+    bool ok = esp_register_freertos_tick_hook_for_cpu(tickCore0, 0) == ESP_OK;
+#if CPU_PROFILE_CORES > 1
+    ok = ok && esp_register_freertos_tick_hook_for_cpu(tickCore1, 1) == ESP_OK;
+#endif
+    if (!ok) {
+        Serial.println("CpuProfiler: Failed to register tick hooks");
+        return false;
+    }
+    s_started = true;
+    Serial.printf("CpuProfiler: Started (%s)\n", CPU_PROFILE_RUNTIME ? "run-time counters" : "tick sampling");
+    return true;
+}
+
+void cpu_profile_poll(uint32_t now) {
+    if (!s_started) return;
+    if (s_haveBase && now - s_lastSampleMs < CPU_PROFILE_SAMPLE_MS) return;
+
+    uint32_t total = 0;
+    const UBaseType_t n = uxTaskGetSystemState(s_status, kStatusMax, &total);
+#if !CPU_PROFILE_RUNTIME
+    total = xTaskGetTickCount();
+#endif
+    const uint32_t totalDelta = total - s_lastTotal;
+    const bool valid = s_haveBase && totalDelta > 0 && now - s_lastSampleMs <= CPU_PROFILE_MAX_GAP_MS;
+    s_lastSampleMs = now;
+    s_lastTotal = total;
+    s_haveBase = true;
+
+    uint8_t idlePct[CPU_PROFILE_CORES];
+    TaskHandle_t idle[CPU_PROFILE_CORES];
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+        idle[c] = idleTaskFor(c);
+        idlePct[c] = kFull;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < CPU_PROFILE_TASKS; i++) s_slots[i].seen = false;
+    portEXIT_CRITICAL(&s_mux);
+
+    for (UBaseType_t k = 0; k < n; k++) {
+        const TaskStatus_t& st = s_status[k];
+        portENTER_CRITICAL(&s_mux);
+        const uint8_t i = claimSlot(st);
+        if (i == kNoSlot) {
+            portEXIT_CRITICAL(&s_mux);
+            continue;
+        }
+        Slot& s = s_slots[i];
+        s.seen = true;
+        s.priority = st.uxCurrentPriority;
+#if defined(configTASKLIST_INCLUDE_COREID) && configTASKLIST_INCLUDE_COREID
+        s.core = st.xCoreID < CPU_PROFILE_CORES ? static_cast<int8_t>(st.xCoreID) : -1;
+#else
+        s.core = -1;
+#endif
+#if CPU_PROFILE_RUNTIME
+        const uint32_t counter = st.ulRunTimeCounter;
+#else
+        const uint32_t counter = s.ticks;
+#endif
+        if (valid && s.based) {
+            const uint32_t delta = counter - s.lastCounter;
+            uint32_t pct = static_cast<uint32_t>((static_cast<uint64_t>(delta) * kFull) / totalDelta);
+            if (pct > kFull) pct = kFull;
+            s.history[s_histIndex] = static_cast<uint8_t>(pct);
+            if (s.samples < CPU_PROFILE_HISTORY) s.samples++;
+            for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+                if (st.xHandle == idle[c]) idlePct[c] = static_cast<uint8_t>(pct);
+            }
+        }
+        s.lastCounter = counter;
+        s.based = true;
+        portEXIT_CRITICAL(&s_mux);
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    // Deleted tasks give their slot back
+    for (uint8_t i = 0; i < CPU_PROFILE_TASKS; i++) {
+        if (s_slots[i].task && !s_slots[i].seen) {
+            for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+                if (s_cores[c].slot == i) s_cores[c].slot = kNoSlot;
+            }
+            s_slots[i].task = nullptr;
+        }
+    }
+    if (valid) {
+        for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+            s_cores[c].history[s_histIndex] = kFull - idlePct[c];
+        }
+        s_histIndex = (s_histIndex + 1) % CPU_PROFILE_HISTORY;
+        if (s_histCount < CPU_PROFILE_HISTORY) s_histCount++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+float cpu_profile_core_load(uint8_t core, CpuProfileWindow window) {
+    if (core >= CPU_PROFILE_CORES || !s_histCount) return -1.0f;
+    portENTER_CRITICAL(&s_mux);
+    const uint16_t p = windowPermille(s_cores[core].history, s_histCount, window);
+    portEXIT_CRITICAL(&s_mux);
+    return p / 1000.0f;
+}
+
+float cpu_profile_load(CpuProfileWindow window) {
+    if (!s_histCount) return -1.0f;
+    float sum = 0.0f;
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) sum += cpu_profile_core_load(c, window);
+    return sum / CPU_PROFILE_CORES;
+}
+
+float cpu_profile_task_load(TaskHandle_t task, CpuProfileWindow window) {
+    float load = -1.0f;
+    portENTER_CRITICAL(&s_mux);
+    const uint8_t i = task ? findSlot(task) : kNoSlot;
+    if (i != kNoSlot && s_slots[i].samples) {
+        load = windowPermille(s_slots[i].history, s_slots[i].samples, window) / 1000.0f;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return load;
+}
+
+size_t cpu_profile_tasks(CpuTaskStats* out, size_t max) {
+    if (!out) return 0;
+    size_t n = 0;
+    for (uint8_t i = 0; i < CPU_PROFILE_TASKS && n < max; i++) {
+        CpuTaskStats st;
+        portENTER_CRITICAL(&s_mux);
+        const bool used = s_slots[i].task != nullptr;
+        if (used) fillStats(s_slots[i], st);
+        portEXIT_CRITICAL(&s_mux);
+        if (!used) continue;
+        // Insertion by middle-window load, busiest first
+        size_t j = n++;
+        while (j > 0 && out[j - 1].permille[CPU_WINDOW_MID] < st.permille[CPU_WINDOW_MID]) {
+            out[j] = out[j - 1];
+            j--;
+        }
+        out[j] = st;
+    }
+    return n;
+}
+
+bool cpu_profile_core(uint8_t core, CpuCoreStats& out) {
+    if (core >= CPU_PROFILE_CORES) return false;
+    portENTER_CRITICAL(&s_mux);
+    const Core& c = s_cores[core];
+    for (uint8_t w = 0; w < CPU_WINDOW_COUNT; w++) {
+        out.busyPermille[w] = windowPermille(c.history, s_histCount, static_cast<CpuProfileWindow>(w));
+    }
+    out.switches = c.switches;
+    memcpy(out.runs, c.runs, sizeof(out.runs));
+    portEXIT_CRITICAL(&s_mux);
+    return true;
+}
+
+void cpu_profile_report(Print& out) {
+    if (!s_started) return;
+    out.printf("CPU profile (%s, %lu ms samples, windows 1/%u/%u):\n",
+               CPU_PROFILE_RUNTIME ? "run-time counters" : "tick sampling",
+               static_cast<unsigned long>(CPU_PROFILE_SAMPLE_MS), CPU_PROFILE_WINDOW_MID, CPU_PROFILE_HISTORY);
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+        CpuCoreStats cs;
+        cpu_profile_core(c, cs);
+        out.printf("  core%u busy %3u.%u%% %3u.%u%% %3u.%u%%, switches %lu\n", c,
+                   cs.busyPermille[0] / 10, cs.busyPermille[0] % 10, cs.busyPermille[1] / 10,
+                   cs.busyPermille[1] % 10, cs.busyPermille[2] / 10, cs.busyPermille[2] % 10,
+                   static_cast<unsigned long>(cs.switches));
+    }
+    CpuTaskStats tasks[CPU_PROFILE_TASKS];
+    const size_t n = cpu_profile_tasks(tasks, CPU_PROFILE_TASKS);
+    out.println("  task            core pri  last   mid  long  switches  runs 1/2-4/5-19/20-99/100-499/500+");
+    for (size_t i = 0; i < n; i++) {
+        const CpuTaskStats& t = tasks[i];
+        out.printf("  %-15s %4d %3u %5.1f %5.1f %5.1f %9lu  %lu/%lu/%lu/%lu/%lu/%lu\n", t.name, t.core,
+                   static_cast<unsigned>(t.priority), t.permille[0] / 10.0f, t.permille[1] / 10.0f,
+                   t.permille[2] / 10.0f, static_cast<unsigned long>(t.switches),
+                   static_cast<unsigned long>(t.runs[0]), static_cast<unsigned long>(t.runs[1]),
+                   static_cast<unsigned long>(t.runs[2]), static_cast<unsigned long>(t.runs[3]),
+                   static_cast<unsigned long>(t.runs[4]), static_cast<unsigned long>(t.runs[5]));
+    }
+}
+
+#endif // CPU_PROFILE_ENABLE
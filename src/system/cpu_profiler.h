@@ -0,0 +1,106 @@
+/*
+ * CPU Profiler
+ * Measured per-task and per-core CPU utilization, replacing the load estimates
+ * in TaskScheduler.
+ *   - load of every task and core over three sliding windows (last sample,
+ *     CPU_PROFILE_WINDOW_MID samples, the whole history), idle time per core
+ *   - context switches and a run-length histogram per task and per core, seen
+ *     from the FreeRTOS tick hook of each core
+ *
+ * Load comes from the FreeRTOS run-time counters (configGENERATE_RUN_TIME_STATS)
+ * when the framework has them; select
+ * CONFIG_FREERTOS_RUN_TIME_STATS_USING_CPU_CLK for cycle resolution (the counter
+ * is then CCOUNT and wraps every ~17 s at 240 MHz, so samples further apart
+ * than CPU_PROFILE_MAX_GAP_MS are dropped). Without run-time stats the tick hook
+ * samples the running task instead: tick resolution, same reports.
+ *
+ * Switches and run lengths are observed at tick granularity: a task that runs
+ * and blocks between two ticks is not seen. Everything lives in fixed tables;
+ * the tick hook never allocates.
+ */
+
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "../config/system_config.h"
+
+#ifndef CPU_PROFILE_TASKS
+#define CPU_PROFILE_TASKS 24               // tracked tasks, idle tasks included
+#endif
+#ifndef CPU_PROFILE_SAMPLE_MS
+#define CPU_PROFILE_SAMPLE_MS 5000         // one history sample per period
+#endif
+#ifndef CPU_PROFILE_HISTORY
+#define CPU_PROFILE_HISTORY 60             // samples kept: 5 min at 5 s
+#endif
+#ifndef CPU_PROFILE_WINDOW_MID
+#define CPU_PROFILE_WINDOW_MID 12          // samples in the middle window: 1 min at 5 s
+#endif
+#ifndef CPU_PROFILE_MAX_GAP_MS
+#define CPU_PROFILE_MAX_GAP_MS 15000       // longer gaps restart the sample instead of using it
+#endif
+#define CPU_PROFILE_CORES portNUM_PROCESSORS
+
+// Run-length buckets in ticks: 1, 2-4, 5-19, 20-99, 100-499, 500+
+#define CPU_PROFILE_RUN_BUCKETS 6
+
+enum CpuProfileWindow : uint8_t {
+    CPU_WINDOW_LAST = 0,   // last sample
+    CPU_WINDOW_MID,        // CPU_PROFILE_WINDOW_MID samples
+    CPU_WINDOW_LONG,       // whole history
+    CPU_WINDOW_COUNT
+};
+
+struct CpuTaskStats {
+    TaskHandle_t task;
+    char name[16];
+    int8_t core;                          // pinned core, -1 = either
+    UBaseType_t priority;
+    uint16_t permille[CPU_WINDOW_COUNT];  // share of one core, 0..1000
+    uint32_t switches;                    // times seen switched in
+    uint32_t runs[CPU_PROFILE_RUN_BUCKETS];
+    uint32_t maxRunTicks;                 // longest run seen, in ticks
+};
+
+struct CpuCoreStats {
+    uint16_t busyPermille[CPU_WINDOW_COUNT];   // 1000 - idle
+    uint32_t switches;
+    uint32_t runs[CPU_PROFILE_RUN_BUCKETS];
+};
+
+#if CPU_PROFILE_ENABLE
+
+// Installs the tick hooks. Call once from setup().
+bool cpu_profile_begin();
+
+// Takes a sample when CPU_PROFILE_SAMPLE_MS has passed. Call from one task.
+void cpu_profile_poll(uint32_t now);
+
+// Average busy fraction (0..1) of all cores, or of one core; -1 before the first sample
+float cpu_profile_load(CpuProfileWindow window = CPU_WINDOW_LAST);
+float cpu_profile_core_load(uint8_t core, CpuProfileWindow window = CPU_WINDOW_LAST);
+// Share of one core (0..1) used by task; -1 when it is not tracked
+float cpu_profile_task_load(TaskHandle_t task, CpuProfileWindow window = CPU_WINDOW_LAST);
+
+// Tracked tasks ordered by load over the middle window; returns how many were written
+size_t cpu_profile_tasks(CpuTaskStats* out, size_t max);
+bool cpu_profile_core(uint8_t core, CpuCoreStats& out);
+void cpu_profile_report(Print& out);
+
+#else
+
+inline bool cpu_profile_begin() { return false; }
+inline void cpu_profile_poll(uint32_t) {}
+inline float cpu_profile_load(CpuProfileWindow = CPU_WINDOW_LAST) { return -1.0f; }
+inline float cpu_profile_core_load(uint8_t, CpuProfileWindow = CPU_WINDOW_LAST) { return -1.0f; }
+inline float cpu_profile_task_load(TaskHandle_t, CpuProfileWindow = CPU_WINDOW_LAST) { return -1.0f; }
+inline size_t cpu_profile_tasks(CpuTaskStats*, size_t) { return 0; }
+inline bool cpu_profile_core(uint8_t, CpuCoreStats&) { return false; }
+inline void cpu_profile_report(Print&) {}
+
+#endif // CPU_PROFILE_ENABLE
+
+#endif // CPU_PROFILER_H
@@ -0,0 +1,332 @@
+/*
+ * Compact Crash Dump Implementation
+ */
+
+#include "crash_dump.h"
+
+#if CRASH_DUMP_ENABLE
+
+#include "../modules/logging/log_buffer.h"
+#include "../modules/transport/lzss.h"
+#include "../../include/transport.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_attr.h>
+#include <esp_debug_helpers.h>
+#include <esp_heap_caps.h>
+#include <esp_partition.h>
+#include <esp_private/panic_internal.h>
+#include <esp_rom_crc.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#if __has_include(<esp_private/freertos_debug.h>)
+#include <esp_private/freertos_debug.h>
+#else
+#include <freertos/task_snapshot.h>
+#endif
+#if __has_include(<xtensa_context.h>)
+#include <xtensa_context.h>
+#else
+#include <freertos/xtensa_context.h>
+#endif
+
+namespace {
+constexpr uint32_t kRecordMagic = 0x43524431;   // "CRD1"
+constexpr uint32_t kStoredMagic = 0x43525A31;   // "CRZ1"
+constexpr uint32_t kPendingUpload = 0xFFFFFFFF; // erased flash; cleared to 0 once uploaded
+constexpr size_t kZMax = sizeof(CrashDumpRecord) + sizeof(CrashDumpRecord) / 8 + 16;   // LZSS worst case
+
+// Partition image: header, then zLen bytes of LZSS stream
+struct StoredHeader {
+    uint32_t magic;
+    uint32_t id;                // counts crashes over the partition's life
+    uint16_t rawLen;
+    uint16_t zLen;
+    uint32_t crc;               // CRC-32 of the stream
+    uint32_t pending;
+};
+
+// Survives the panic reset; not initialised at boot
+RTC_NOINIT_ATTR CrashDumpRecord s_rtc;
+
+const esp_partition_t* s_part = nullptr;
+uint8_t* s_ram = nullptr;       // compressed record when there is no partition
+StoredHeader s_hdr{};
+bool s_pending = false;
+uint16_t s_nextPart = 0;
+uint32_t s_lastPartMs = 0;
+uint8_t s_chunk[CRASH_DUMP_PART_BYTES];
+char s_record[TRANSPORT_MAX_PACKET_BYTES];
+static_assert(CRASH_DUMP_PART_BYTES * 4 / 3 + 128 < TRANSPORT_MAX_PACKET_BYTES,
+              "a base64 part must fit one transport packet");
+
+uint32_t recordCrc(const CrashDumpRecord& r) {
+    const size_t off = offsetof(CrashDumpRecord, crc) + sizeof(r.crc);
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&r) + off, sizeof(r) - off);
+}
+
+// Return address of a windowed call: the top bits hold the window increment
+uint32_t callerPc(uint32_t pc) {
+    if (pc & 0x80000000) pc = (pc & 0x3FFFFFFF) | 0x40000000;
+    return pc - 3;
+}
+
+void walk(CrashDumpTask& t, uint32_t pc, uint32_t sp, uint32_t nextPc) {
+    esp_backtrace_frame_t frame = {};
+    frame.pc = pc;
+    frame.sp = sp;
+    frame.next_pc = nextPc;
+    t.pc[t.depth++] = pc;
+    while (t.depth < CRASH_DUMP_DEPTH && frame.next_pc) {
+        if (!esp_backtrace_get_next_frame(&frame)) {
+            t.flags |= CRASH_DUMP_TASK_CORRUPT;
+            break;
+        }
+        t.pc[t.depth++] = callerPc(frame.pc);
+    }
+}
+
+void nameTask(CrashDumpTask& t, TaskHandle_t h) {
+    const char* name = h ? pcTaskGetName(h) : nullptr;
+    size_t i = 0;
+    for (; name && name[i] && i + 1 < CRASH_DUMP_NAME_BYTES; i++) t.name[i] = name[i];
+    t.name[i] = '\0';
+    t.stackFree = h ? static_cast<uint16_t>(uxTaskGetStackHighWaterMark(h) * sizeof(StackType_t)) : 0;
+}
+
+TaskHandle_t currentTaskOn(int core) {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    return xTaskGetCurrentTaskHandleForCore(core);
+#else
+    return xTaskGetCurrentTaskHandleForCPU(core);
+#endif
+}
+
+// Panic context: the scheduler is stopped and the other core halted. No locks,
+// no heap, no printf (newlib may allocate); only reads and plain copies.
+void capture(const panic_info_t* info) {
+    CrashDumpRecord& r = s_rtc;
+    memset(&r, 0, sizeof(r));
+    r.version = CRASH_DUMP_VERSION;
+    r.bytes = sizeof(r);
+    r.uptimeMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+    r.heapFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    r.heapMinFree = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    r.logPending = log_ring_pending();
+    r.core = static_cast<uint8_t>(info->core);
+    const char* reason = info->reason ? info->reason : info->description;
+    for (size_t i = 0; reason && reason[i] && i + 1 < CRASH_DUMP_REASON_BYTES; i++) r.reason[i] = reason[i];
+
+    const XtExcFrame* exc = static_cast<const XtExcFrame*>(info->frame);
+    if (exc) {
+        r.pc = exc->pc;
+        r.ps = exc->ps;
+        r.sar = exc->sar;
+        r.exccause = exc->exccause;
+        r.excvaddr = exc->excvaddr;
+        const long* regs = &exc->a0;
+        for (int i = 0; i < 16; i++) r.a[i] = regs[i];
+    }
+
+    const TaskHandle_t crashed = currentTaskOn(info->core);
+    const TaskHandle_t other = portNUM_PROCESSORS > 1 ? currentTaskOn(info->core ? 0 : 1) : nullptr;
+    CrashDumpTask& first = r.tasks[r.taskCount++];
+    nameTask(first, crashed);
+    first.flags = CRASH_DUMP_TASK_CRASHED;
+    if (exc) walk(first, exc->pc, exc->a1, exc->a0);
+
+    TaskSnapshot_t snaps[CRASH_DUMP_TASKS + 8];
+    UBaseType_t tcbSize = 0;
+    const UBaseType_t n = uxTaskGetSnapshotAll(snaps, CRASH_DUMP_TASKS + 8, &tcbSize);
+    for (UBaseType_t i = 0; i < n && r.taskCount < CRASH_DUMP_TASKS; i++) {
+        const TaskHandle_t h = static_cast<TaskHandle_t>(snaps[i].pxTCB);
+        if (h == crashed) continue;
+        CrashDumpTask& t = r.tasks[r.taskCount++];
+        nameTask(t, h);
+        if (h == other) {
+            t.flags = CRASH_DUMP_TASK_RUNNING;
+            continue;
+        }
+        const XtExcFrame* f = reinterpret_cast<const XtExcFrame*>(snaps[i].pxTopOfStack);
+        if (f->exit) {
+            walk(t, f->pc, f->a1, f->a0);          // preempted: full interrupt frame
+        } else {
+            const XtSolFrame* s = reinterpret_cast<const XtSolFrame*>(f);
+            walk(t, s->pc, s->a1, s->a0);          // yielded: solicited frame
+        }
+    }
+
+    for (size_t i = 0; i < CRASH_DUMP_LOG_LINES; i++) {
+        if (!log_peek_line_unlocked(i, r.log[i], CRASH_DUMP_LINE_BYTES)) break;
+        r.logCount++;
+    }
+
+    r.crc = recordCrc(r);
+    r.magic = kRecordMagic;
+}
+
+bool loadStored() {
+    if (!s_part || esp_partition_read(s_part, 0, &s_hdr, sizeof(s_hdr)) != ESP_OK) return false;
+    return s_hdr.magic == kStoredMagic && s_hdr.zLen && s_hdr.zLen <= s_part->size - sizeof(s_hdr);
+}
+
+bool store(const uint8_t* z, size_t zLen, size_t rawLen) {
+    const uint32_t id = loadStored() ? s_hdr.id + 1 : 1;
+    s_hdr = {};
+    s_hdr.magic = kStoredMagic;
+    s_hdr.id = id;
+    s_hdr.rawLen = static_cast<uint16_t>(rawLen);
+    s_hdr.zLen = static_cast<uint16_t>(zLen);
+    s_hdr.crc = esp_rom_crc32_le(0, z, zLen);
+    s_hdr.pending = kPendingUpload;
+    if (!s_part) return false;
+    const size_t sector = 4096;
+    const size_t span = (sizeof(s_hdr) + zLen + sector - 1) / sector * sector;
+    if (span > s_part->size) return false;
+    return esp_partition_erase_range(s_part, 0, span) == ESP_OK &&
+           esp_partition_write(s_part, sizeof(s_hdr), z, zLen) == ESP_OK &&
+           esp_partition_write(s_part, 0, &s_hdr, sizeof(s_hdr)) == ESP_OK;
+}
+
+void markUploaded() {
+    s_pending = false;
+    if (s_part) {
+        const uint32_t done = 0;
+        esp_partition_write(s_part, offsetof(StoredHeader, pending), &done, sizeof(done));
+    }
+    free(s_ram);
+    s_ram = nullptr;
+}
+
+size_t base64(const uint8_t* in, size_t len, char* out, size_t outSize) {
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    if ((len + 2) / 3 * 4 >= outSize) return 0;
+    size_t n = 0;
+    for (size_t i = 0; i < len; i += 3) {
+        const uint32_t v = (in[i] << 16) | (i + 1 < len ? in[i + 1] << 8 : 0) | (i + 2 < len ? in[i + 2] : 0);
+        out[n++] = kAlphabet[(v >> 18) & 0x3F];
+        out[n++] = kAlphabet[(v >> 12) & 0x3F];
+        out[n++] = i + 1 < len ? kAlphabet[(v >> 6) & 0x3F] : '=';
+        out[n++] = i + 2 < len ? kAlphabet[v & 0x3F] : '=';
+    }
+    out[n] = '\0';
+    return n;
+}
+
+void printSummary(const CrashDumpRecord& r) {
+    Serial.printf("CrashDump: %s on core %u at %lu ms, heap %lu free (min %lu)\n", r.reason,
+                  (unsigned)r.core, (unsigned long)r.uptimeMs, (unsigned long)r.heapFree,
+                  (unsigned long)r.heapMinFree);
+    if (!r.taskCount) return;
+    const CrashDumpTask& t = r.tasks[0];
+    Serial.printf("CrashDump: task %s, EXCCAUSE %lu EXCVADDR 0x%08lx\nBacktrace:", t.name,
+                  (unsigned long)r.exccause, (unsigned long)r.excvaddr);
+    for (uint8_t i = 0; i < t.depth; i++) Serial.printf(" 0x%08lx", (unsigned long)t.pc[i]);
+    Serial.println(t.flags & CRASH_DUMP_TASK_CORRUPT ? " |<-CORRUPTED" : "");
+}
+} // namespace
+
+extern "C" void __real_esp_panic_handler(panic_info_t* info);
+
+extern "C" void __wrap_esp_panic_handler(panic_info_t* info) {
+    if (info) capture(info);
+    __real_esp_panic_handler(info);
+}
+
+bool crash_dump_begin(uint8_t resetReason) {
+    s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, CRASH_DUMP_PARTITION);
+    const bool fresh = s_rtc.magic == kRecordMagic && s_rtc.version == CRASH_DUMP_VERSION &&
+                       s_rtc.bytes == sizeof(CrashDumpRecord) && s_rtc.crc == recordCrc(s_rtc);
+    s_rtc.magic = 0;    // consumed either way
+
+    if (!fresh) {
+        // Nothing new; a record from an earlier boot may still be waiting
+        s_pending = loadStored() && s_hdr.pending == kPendingUpload;
+        if (s_pending) {
+            Serial.printf("CrashDump: crash %lu still to upload\n", (unsigned long)s_hdr.id);
+        }
+        return false;
+    }
+
+    s_rtc.resetReason = resetReason;
+    printSummary(s_rtc);
+    uint8_t* z = static_cast<uint8_t*>(malloc(kZMax));
+    if (!z) {
+        Serial.println("CrashDump: no memory to compress the record");
+        return true;
+    }
+    const size_t zLen = lzss_compress(reinterpret_cast<const uint8_t*>(&s_rtc), sizeof(s_rtc), z, kZMax);
+    if (!zLen) {
+        free(z);
+        return true;
+    }
+    if (store(z, zLen, sizeof(s_rtc))) {
+        free(z);
+    } else {
+        // No partition (or it failed): upload from RAM, lost if this boot resets too
+        Serial.printf("CrashDump: partition '%s' unavailable, record kept in RAM\n", CRASH_DUMP_PARTITION);
+        s_part = nullptr;
+        s_ram = z;
+    }
+    s_pending = true;
+    s_nextPart = 0;
+    Serial.printf("CrashDump: crash %lu stored, %u -> %u bytes\n", (unsigned long)s_hdr.id,
+                  (unsigned)s_hdr.rawLen, (unsigned)s_hdr.zLen);
+    return true;
+}
+
+void crash_dump_poll(uint32_t now) {
+    if (!s_pending) return;
+    if (s_nextPart && now - s_lastPartMs < CRASH_DUMP_PART_GAP_MS) return;
+    const uint16_t parts = (s_hdr.zLen + CRASH_DUMP_PART_BYTES - 1) / CRASH_DUMP_PART_BYTES;
+    const size_t off = static_cast<size_t>(s_nextPart) * CRASH_DUMP_PART_BYTES;
+    const size_t len = s_hdr.zLen - off < CRASH_DUMP_PART_BYTES ? s_hdr.zLen - off : CRASH_DUMP_PART_BYTES;
+    if (s_ram) {
+        memcpy(s_chunk, s_ram + off, len);
+    } else if (esp_partition_read(s_part, sizeof(StoredHeader) + off, s_chunk, len) != ESP_OK) {
+        return;
+    }
+
+    int n = snprintf(s_record, sizeof(s_record),
+                     "{\"crash_id\":%lu,\"crash_part\":%u,\"crash_parts\":%u,\"crash_raw\":%u,\"crash_z\":\"",
+                     (unsigned long)s_hdr.id, (unsigned)s_nextPart, (unsigned)parts, (unsigned)s_hdr.rawLen);
+    if (n <= 0) return;
+    const size_t b = base64(s_chunk, len, s_record + n, sizeof(s_record) - n - 3);
+    if (!b) return;
+    n += b;
+    s_record[n++] = '"';
+    s_record[n++] = '}';
+    s_record[n] = '\0';
+    if (!transport_sendDiagnostic(s_record, n)) return;   // queue full, same part next poll
+
+    s_lastPartMs = now;
+    if (++s_nextPart >= parts) {
+        markUploaded();
+        LOGF("crash dump %lu uploaded in %u parts", (unsigned long)s_hdr.id, (unsigned)parts);
+    }
+}
+
+bool crash_dump_resend() {
+    if (!s_ram && !loadStored()) return false;
+    s_pending = true;
+    s_nextPart = 0;
+    return true;
+}
+
+bool crash_dump_pending() {
+    return s_pending;
+}
+
+void crash_dump_report(Print& out) {
+    if (!s_hdr.magic) {
+        out.println("Crash dump: none stored");
+        return;
+    }
+    out.printf("Crash dump: crash %lu, %u -> %u bytes, %s\n", (unsigned long)s_hdr.id, (unsigned)s_hdr.rawLen,
+               (unsigned)s_hdr.zLen, s_pending ? "uploading" : "uploaded");
+}
+
+#endif // CRASH_DUMP_ENABLE
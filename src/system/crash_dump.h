@@ -0,0 +1,120 @@
+/*
+ * Compact Crash Dump
+ * A small crash record instead of a full core dump, captured from the panic
+ * handler and uploaded over the transport on the next boot.
+ *
+ *   - panic: a wrapper around the IDF panic handler fills a CrashDumpRecord in
+ *     RTC memory (survives the software reset, no flash or heap access in the
+ *     panic path): reason, exception registers, backtraces of every task, the
+ *     newest log lines and heap stats. The normal panic handler runs after it.
+ *   - next boot: crash_dump_begin() validates the record, LZSS-compresses it
+ *     (~2 KB raw) and writes it to the "crashlog" data partition, so it survives
+ *     further reboots until uploaded. Without the partition it is kept in RAM for
+ *     this boot only.
+ *   - upload: crash_dump_poll() sends the compressed record as base64 parts over
+ *     the diagnostic transport class, one part every CRASH_DUMP_PART_GAP_MS:
+ *       {"crash_id":N,"crash_part":i,"crash_parts":n,"crash_raw":bytes,"crash_z":"..."}
+ *     The server joins the parts in order, base64-decodes, lzss_decompress()es to
+ *     crash_raw bytes and reads a CrashDumpRecord. The diagnostic class drops
+ *     rather than spills, so a server missing parts asks again via crash_dump_resend().
+ *
+ * Needs the linker flag
+ *   -Wl,--wrap=esp_panic_handler
+ * and a partition table row such as
+ *   crashlog, data, 0x40, , 0x2000
+ * Backtrace PCs are raw return addresses; resolve them with addr2line against
+ * the firmware ELF. The task running on the other core when the panic hit only
+ * has its name recorded: its registers are live on that core.
+ */
+
+#ifndef CRASH_DUMP_H
+#define CRASH_DUMP_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef CRASH_DUMP_TASKS
+#define CRASH_DUMP_TASKS 16                 // tasks with a backtrace
+#endif
+#ifndef CRASH_DUMP_DEPTH
+#define CRASH_DUMP_DEPTH 12                 // frames per backtrace
+#endif
+#ifndef CRASH_DUMP_LOG_LINES
+#define CRASH_DUMP_LOG_LINES 8              // newest log buffer lines
+#endif
+#ifndef CRASH_DUMP_LINE_BYTES
+#define CRASH_DUMP_LINE_BYTES 96
+#endif
+#ifndef CRASH_DUMP_PARTITION
+#define CRASH_DUMP_PARTITION "crashlog"
+#endif
+#ifndef CRASH_DUMP_PART_BYTES
+#define CRASH_DUMP_PART_BYTES 384           // compressed bytes per upload part (512 as base64)
+#endif
+#ifndef CRASH_DUMP_PART_GAP_MS
+#define CRASH_DUMP_PART_GAP_MS 5000         // between parts, keeps the uplink for live traffic
+#endif
+#define CRASH_DUMP_REASON_BYTES 40
+#define CRASH_DUMP_NAME_BYTES 12
+#define CRASH_DUMP_VERSION 1
+
+// Task flags
+#define CRASH_DUMP_TASK_CRASHED   0x01      // the task that panicked
+#define CRASH_DUMP_TASK_RUNNING   0x02      // running on the other core, no backtrace
+#define CRASH_DUMP_TASK_CORRUPT   0x04      // walk stopped at an invalid frame
+
+struct CrashDumpTask {
+    char name[CRASH_DUMP_NAME_BYTES];
+    uint16_t stackFree;                     // bytes, high-water mark
+    uint8_t flags;
+    uint8_t depth;
+    uint32_t pc[CRASH_DUMP_DEPTH];
+};
+
+// Raw record as captured; the upload carries it byte for byte (little endian)
+struct CrashDumpRecord {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t bytes;                         // sizeof(CrashDumpRecord)
+    uint32_t crc;                           // CRC-32 of everything after this field
+    uint32_t uptimeMs;
+    uint32_t heapFree;
+    uint32_t heapMinFree;
+    uint32_t logPending;                    // deferred log entries lost with the crash
+    uint8_t core;
+    uint8_t resetReason;                    // esp_reset_reason_t, filled in on the next boot
+    uint8_t taskCount;
+    uint8_t logCount;
+    char reason[CRASH_DUMP_REASON_BYTES];
+    uint32_t pc, ps, sar, exccause, excvaddr;
+    uint32_t a[16];
+    CrashDumpTask tasks[CRASH_DUMP_TASKS];  // crashed task first
+    char log[CRASH_DUMP_LOG_LINES][CRASH_DUMP_LINE_BYTES];   // newest first
+};
+
+#if CRASH_DUMP_ENABLE
+
+// Stores a record captured before the reset and queues it for upload. Call once
+// at boot (CrashRecovery does), before the transport starts: it uses the LZSS
+// compressor's shared state. Returns true when a crash record was found.
+bool crash_dump_begin(uint8_t resetReason);
+
+// Sends the next upload part when one is due; call from the transport owner's loop
+void crash_dump_poll(uint32_t now);
+
+// Uploads the stored record again (server asked for missing parts)
+bool crash_dump_resend();
+bool crash_dump_pending();
+void crash_dump_report(Print& out);
+
+#else
+
+inline bool crash_dump_begin(uint8_t) { return false; }
+inline void crash_dump_poll(uint32_t) {}
+inline bool crash_dump_resend() { return false; }
+inline bool crash_dump_pending() { return false; }
+inline void crash_dump_report(Print&) {}
+
+#endif // CRASH_DUMP_ENABLE
+
+#endif // CRASH_DUMP_H
@@ -6,10 +6,16 @@
  */
 
 #include "crash_recovery.h"
+#include "kernel_objects.h"
+#include "service_task.h"
+#include "crash_dump.h"
+#include "reset_journal.h"
+#include "metrics.h"
 #include "../include/error_handler.h"
 #include "../include/memory_monitor.h"
 #include "../include/string_pool.h"
 #include "../modules/logging/log_buffer.h"
+#include "../modules/settings/hour_meter.h"
 #include "config/task_config.h"
 #include "config/system_config.h"
 
@@ -20,8 +26,18 @@
 #include <freertos/semphr.h>
 #include <esp_system.h>
 #include <esp_heap_trace.h>
+#include <esp_timer.h>
 #include <Preferences.h>
 
+// Stacks the integrity scanner watches, one scan unit each after the heap unit
+static const char* const kStackScanTasks[] = {
+    "Service",
+    "Display",
+    "CatMGNSS"
+};
+static constexpr uint16_t kScanUnits = 1 + sizeof(kStackScanTasks) / sizeof(kStackScanTasks[0]);
+static MetricHistogram s_metricScanUs("crash.scan_us");
+
 // ============================================================================
 // GLOBAL CRASH RECOVERY INSTANCE
 // ============================================================================
@@ -30,9 +46,13 @@ CrashRecovery* CrashRecovery::instance = nullptr;
 // ============================================================================
 // CONSTRUCTOR/DESTRUCTOR
 // ============================================================================
-CrashRecovery::CrashRecovery() : recoveryTaskHandle(nullptr), mutex(nullptr), isRunning(false) {
+CrashRecovery::CrashRecovery()
+    : serviceJob(SERVICE_JOB_NONE), scanJob(SERVICE_JOB_NONE), mutex(nullptr), isRunning(false),
+      scanCursor(0), scanCycleStartMs(0) {
     // Initialize crash statistics
     memset(&stats, 0, sizeof(CrashStats));
+    memset(&scanStats, 0, sizeof(IntegrityScanStats));
+    scanStats.units = kScanUnits;
     stats.lastCrashTime = 0;
     stats.totalResets = 0;
     stats.memCorruptionCount = 0;
@@ -61,7 +81,7 @@ CrashRecovery::~CrashRecovery() {
 bool CrashRecovery::begin() {
     Serial.println("CrashRecovery: Initializing crash recovery system");
     
-    mutex = xSemaphoreCreateMutex();
+    mutex = kernel_mutex_create(KernelMutex::CrashRecovery);
     if (!mutex) {
         Serial.println("CrashRecovery: Failed to create mutex");
         return false;
@@ -93,10 +113,8 @@ void CrashRecovery::shutdown() {
         disableHardwareWatchdog();
     }
     
-    if (mutex) {
-        vSemaphoreDelete(mutex);
-        mutex = nullptr;
-    }
+    kernel_mutex_delete(KernelMutex::CrashRecovery, mutex);
+    mutex = nullptr;
     
     Serial.println("CrashRecovery: Crash recovery system shutdown");
 }
@@ -109,23 +127,20 @@ void CrashRecovery::startRecovery() {
     
     Serial.println("CrashRecovery: Starting crash recovery monitoring");
     
-    isRunning = true;
-    
-    BaseType_t result = xTaskCreatePinnedToCore(
-        recoveryTask,
-        "CrashRecovery",
-        CRASH_RECOVERY_TASK_STACK_SIZE,
-        this,
-        CRASH_RECOVERY_TASK_PRIORITY,
-        &recoveryTaskHandle,
-        0  // Core 0 for system monitoring
-    );
-    
-    if (result == pdPASS) {
-        Serial.println("CrashRecovery: Recovery monitoring task started");
+    serviceJob = service_job_add("CrashRecovery", recoveryJob, this,
+                                 CRASH_RECOVERY_CHECK_INTERVAL_MS, CRASH_RECOVERY_JOB_BUDGET_US);
+    if (serviceJob != SERVICE_JOB_NONE) {
+        isRunning = true;
+        // Initial system assessment on the next service tick
+        service_job_trigger(serviceJob);
+        Serial.println("CrashRecovery: Recovery monitoring job scheduled");
     } else {
-        isRunning = false;
-        Serial.println("CrashRecovery: Failed to start recovery task");
+        Serial.println("CrashRecovery: Failed to schedule recovery job");
+    }
+    if (isRunning) {
+        scanJob = service_job_add("IntegrityScan", integrityScanJob, this,
+                                  CRASH_RECOVERY_SCAN_PERIOD_MS, CRASH_RECOVERY_SCAN_BUDGET_US * 2);
+        if (scanJob == SERVICE_JOB_NONE) Serial.println("CrashRecovery: Failed to schedule integrity scan job");
     }
 }
 
@@ -133,11 +148,10 @@ void CrashRecovery::stopRecovery() {
     if (!isRunning) return;
     
     isRunning = false;
-    
-    if (recoveryTaskHandle) {
-        vTaskDelete(recoveryTaskHandle);
-        recoveryTaskHandle = nullptr;
-    }
+    service_job_remove(serviceJob);
+    serviceJob = SERVICE_JOB_NONE;
+    if (scanJob != SERVICE_JOB_NONE) service_job_remove(scanJob);
+    scanJob = SERVICE_JOB_NONE;
     
     Serial.println("CrashRecovery: Recovery monitoring stopped");
 }
@@ -223,8 +237,8 @@ bool CrashRecovery::initializeHardwareWatchdog() {
     // Use FreeRTOS software watchdog timer instead of ESP-IDF hardware watchdog
     // This is PlatformIO/Arduino compatible and doesn't require ESP-IDF APIs
     
-    watchdogTimer = xTimerCreate(
-        "CrashRecoveryWDT",                    // Timer name
+    watchdogTimer = kernel_timer_create(
+        KernelTimer::CrashWatchdog,            // Timer slot (name from task_config.h)
         pdMS_TO_TICKS(HARDWARE_WATCHDOG_TIMEOUT_MS),  // Period in ticks
         pdTRUE,                                // Auto-reload
         this,                                   // Timer ID (pointer to this instance)
@@ -239,7 +253,7 @@ bool CrashRecovery::initializeHardwareWatchdog() {
     // Start the watchdog timer
     if (xTimerStart(watchdogTimer, 0) != pdPASS) {
         Serial.println("CrashRecovery: Failed to start watchdog timer");
-        xTimerDelete(watchdogTimer, 0);
+        kernel_timer_delete(KernelTimer::CrashWatchdog, watchdogTimer, 0);
         watchdogTimer = nullptr;
         return false;
     }
@@ -254,7 +268,7 @@ bool CrashRecovery::initializeHardwareWatchdog() {
 void CrashRecovery::disableHardwareWatchdog() {
     if (hardwareWatchdogEnabled && watchdogTimer) {
         xTimerStop(watchdogTimer, 0);
-        xTimerDelete(watchdogTimer, portMAX_DELAY);
+        kernel_timer_delete(KernelTimer::CrashWatchdog, watchdogTimer, portMAX_DELAY);
         watchdogTimer = nullptr;
         hardwareWatchdogEnabled = false;
         Serial.println("CrashRecovery: Software watchdog disabled");
@@ -318,6 +332,10 @@ void CrashRecovery::analyzeResetReason() {
     esp_reset_reason_t resetReason = esp_reset_reason();
     
     Serial.printf("CrashRecovery: Reset reason: %s\n", getResetReasonString(resetReason));
+    // Panics (watchdog ones included) leave a crash record for upload
+    crash_dump_begin(static_cast<uint8_t>(resetReason));
+    // Any reset: what the previous boot journalled in RTC memory
+    reset_journal_begin(static_cast<uint8_t>(resetReason));
     
     switch (resetReason) {
         case ESP_RST_UNKNOWN:
@@ -388,40 +406,26 @@ const char* CrashRecovery::getResetReasonString(esp_reset_reason_t reason) const
 }
 
 // ============================================================================
-// RECOVERY TASK
+// RECOVERY JOB
 // ============================================================================
-void CrashRecovery::recoveryTask(void* pvParameters) {
-    CrashRecovery* recovery = static_cast<CrashRecovery*>(pvParameters);
+void CrashRecovery::recoveryJob(void* ctx) {
+    CrashRecovery* recovery = static_cast<CrashRecovery*>(ctx);
     
-    Serial.println("CrashRecovery: Recovery monitoring task started");
+    // Kick hardware watchdog
+    recovery->kickHardwareWatchdog();
     
-    // Initial system assessment
+    // Perform periodic health checks; heap patterns and stacks are covered
+    // by the integrity scan job
     recovery->performSystemHealthCheck();
     
-    while (recovery->isRunning) {
-        // Kick hardware watchdog
-        recovery->kickHardwareWatchdog();
-        
-        // Perform periodic health checks
-        recovery->performSystemHealthCheck();
-        
-        // Check for memory corruption
-        recovery->checkMemoryCorruption();
-        
-        // Monitor task health
-        recovery->monitorTaskHealth();
-        
-        // Apply recovery strategies if needed
-        recovery->applyRecoveryStrategies();
-        
-        // Update system stability
-        recovery->updateSystemStability();
-        
-        vTaskDelay(pdMS_TO_TICKS(CRASH_RECOVERY_CHECK_INTERVAL_MS));
-    }
+    // Monitor task health
+    recovery->monitorTaskHealth();
+    
+    // Apply recovery strategies if needed
+    recovery->applyRecoveryStrategies();
     
-    Serial.println("CrashRecovery: Recovery monitoring task ended");
-    vTaskDelete(nullptr);
+    // Update system stability
+    recovery->updateSystemStability();
 }
 
 // ============================================================================
@@ -457,60 +461,83 @@ void CrashRecovery::performSystemHealthCheck() {
                      minFreeHeap, freeHeap);
     }
     
-    // Check stack health for critical tasks
-    checkCriticalTaskStacks();
-    
     xSemaphoreGive(mutex);
 }
 
-void CrashRecovery::checkCriticalTaskStacks() {
-    // List of critical tasks to monitor
-    const char* criticalTasks[] = {
-        "CrashRecovery",
-        "MemoryMonitor", 
-        "StatusBar",
-        "Display",
-        "CatMGNSS"
-    };
-    
-    for (const char* taskName : criticalTasks) {
-        TaskHandle_t taskHandle = xTaskGetHandle(taskName);
-        if (taskHandle) {
-            UBaseType_t highWaterMark = uxTaskGetStackHighWaterMark(taskHandle);
-            uint32_t stackSize = 0;
-            
-            // Check stack health using high water mark
-            // vTaskGetInfo is not available in all FreeRTOS configs, so we use a simpler approach
-            eTaskState state = eTaskGetState(taskHandle);
-            if (state != eDeleted && state != eInvalid) {
-                // Use high water mark as indicator - low values mean high usage
-                // Threshold: less than 512 bytes remaining = critical
-                // Threshold: less than 1024 bytes remaining = warning
-                uint32_t remainingBytes = highWaterMark * sizeof(StackType_t);
-                
-                if (remainingBytes < 512) {
-                    stats.stackOverflowCount++;
-                    Serial.printf("CrashRecovery: Critical stack overflow in task '%s': %u bytes remaining\n", 
-                                 taskName, remainingBytes);
-                    
-                    // Report stack overflow
-                    REPORT_ERROR(ERROR_MEMORY_FAULT, ErrorSeverity::CRITICAL, ErrorCategory::MEMORY,
-                                "Critical task stack overflow detected");
-                } else if (remainingBytes < 1024) {
-                    Serial.printf("CrashRecovery: High stack usage in task '%s': %u bytes remaining\n", 
-                                 taskName, remainingBytes);
-                }
-            }
+// ============================================================================
+// INCREMENTAL INTEGRITY SCAN
+// ============================================================================
+void CrashRecovery::integrityScanJob(void* ctx) {
+    static_cast<CrashRecovery*>(ctx)->integrityScanPass();
+}
+
+// Unit 0 is the heap, then one stack per unit; a round ends after the last stack
+void CrashRecovery::integrityScanPass() {
+    if (!mutex) return;
+    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        scanStats.skipped++;
+        return;
+    }
+
+    const int64_t startUs = esp_timer_get_time();
+    uint32_t elapsedUs = 0;
+    for (uint16_t done = 0; done < CRASH_RECOVERY_SCAN_UNITS; done++) {
+        if (done > 0 && elapsedUs >= CRASH_RECOVERY_SCAN_BUDGET_US) {
+            scanStats.budgetStops++;
+            break;
+        }
+        if (scanCursor == 0) {
+            scanCycleStartMs = millis();
+            checkMemoryCorruption();
+        } else {
+            checkTaskStack(kStackScanTasks[scanCursor - 1]);
         }
+        elapsedUs = (uint32_t)(esp_timer_get_time() - startUs);
+
+        if (++scanCursor == kScanUnits) {
+            scanCursor = 0;
+            scanStats.cycles++;
+            scanStats.lastCycleMs = millis() - scanCycleStartMs;
+            if (scanStats.lastCycleMs > scanStats.maxCycleMs) scanStats.maxCycleMs = scanStats.lastCycleMs;
+        }
+    }
+    scanStats.unitsDone = scanCursor;
+    scanStats.lastPassUs = elapsedUs;
+    if (elapsedUs > scanStats.maxPassUs) scanStats.maxPassUs = elapsedUs;
+    s_metricScanUs.record(elapsedUs);
+
+    xSemaphoreGive(mutex);
+}
+
+void CrashRecovery::checkTaskStack(const char* taskName) {
+    TaskHandle_t taskHandle = xTaskGetHandle(taskName);
+    if (!taskHandle) return;
+
+    // vTaskGetInfo is not available in all FreeRTOS configs, so the high water mark
+    // is the indicator: under 512 bytes left is critical, under 1024 a warning
+    eTaskState state = eTaskGetState(taskHandle);
+    if (state == eDeleted || state == eInvalid) return;
+    uint32_t remainingBytes = uxTaskGetStackHighWaterMark(taskHandle) * sizeof(StackType_t);
+
+    if (remainingBytes < 512) {
+        stats.stackOverflowCount++;
+        Serial.printf("CrashRecovery: Critical stack overflow in task '%s': %u bytes remaining\n", 
+                     taskName, remainingBytes);
+        
+        // Report stack overflow
+        REPORT_ERROR(ERROR_MEMORY_FAULT, ErrorSeverity::CRITICAL, ErrorCategory::MEMORY,
+                    "Critical task stack overflow detected");
+    } else if (remainingBytes < 1024) {
+        Serial.printf("CrashRecovery: High stack usage in task '%s': %u bytes remaining\n", 
+                     taskName, remainingBytes);
     }
 }
 
 void CrashRecovery::monitorTaskHealth() {
     // Check if critical tasks are still running
     const char* criticalTasks[] = {
-        "CrashRecovery",
-        "MemoryMonitor",
-        "StatusBar"
+        "Service",
+        "Display"
     };
     
     uint32_t currentTime = millis();
@@ -685,6 +712,7 @@ void CrashRecovery::applyEmergencyRecovery() {
     if (millis() - emergencyStartTime > 30000) { // 30 seconds
         if (!stats.systemStable) {
             Serial.println("CrashRecovery: Emergency recovery failed - initiating system restart");
+            hour_meter_flush();
             vTaskDelay(pdMS_TO_TICKS(1000));
             esp_restart();
         }
@@ -803,6 +831,15 @@ CrashStats CrashRecovery::getStats() const {
     return result;
 }
 
+IntegrityScanStats CrashRecovery::getScanStats() const {
+    IntegrityScanStats result{};
+    if (mutex && xSemaphoreTake(mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
+        result = scanStats;
+        xSemaphoreGive(mutex);
+    }
+    return result;
+}
+
 void CrashRecovery::printStats() const {
     if (!mutex) return;
     
@@ -820,6 +857,11 @@ void CrashRecovery::printStats() const {
     Serial.printf("Recovery Mode: %d\n", (int)stats.recoveryMode);
     Serial.printf("System Stable: %s\n", stats.systemStable ? "YES" : "NO");
     Serial.printf("Free Heap: %u bytes\n", ESP.getFreeHeap());
+    Serial.printf("Integrity Scan: %u rounds of %u units, at %u; round %u ms (max %u), pass %u us (max %u), "
+                  "%u budget stops, %u skipped\n",
+                  scanStats.cycles, scanStats.units, scanStats.unitsDone, scanStats.lastCycleMs,
+                  scanStats.maxCycleMs, scanStats.lastPassUs, scanStats.maxPassUs, scanStats.budgetStops,
+                  scanStats.skipped);
     Serial.println("===============================\n");
     
     xSemaphoreGive(mutex);
@@ -900,3 +942,11 @@ bool CrashRecovery::shouldPreventRestart() {
 // EXTERNAL GLOBAL INSTANCE
 // ============================================================================
 CrashRecovery* g_crashRecovery = nullptr;
+
+// CrashStats in the metrics registry
+static CrashStats crashStats() {
+    return g_crashRecovery ? g_crashRecovery->getStats() : CrashStats{};
+}
+static MetricCounter s_metricResets("crash.resets", [] { return crashStats().totalResets; });
+static MetricCounter s_metricStackOverflows("crash.stack_overflows", [] { return crashStats().stackOverflowCount; });
+static MetricCounter s_metricTaskFaults("crash.task_faults", [] { return crashStats().taskFaultCount; });
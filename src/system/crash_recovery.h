@@ -23,7 +23,19 @@
 // CRASH RECOVERY CONFIGURATION
 // ============================================================================
 #define CRASH_RECOVERY_CHECK_INTERVAL_MS 5000    // 5 seconds
-#define CRASH_RECOVERY_TASK_STACK_SIZE 4096      // 16KB stack
+#define CRASH_RECOVERY_JOB_BUDGET_US 50000       // service job run-time budget
+// Integrity scanner: the heap checks and each critical task's stack are one unit
+// each; a pass checks up to CRASH_RECOVERY_SCAN_UNITS units and stops early once
+// it has used CRASH_RECOVERY_SCAN_BUDGET_US (one unit always runs)
+#ifndef CRASH_RECOVERY_SCAN_PERIOD_MS
+#define CRASH_RECOVERY_SCAN_PERIOD_MS 1000
+#endif
+#ifndef CRASH_RECOVERY_SCAN_UNITS
+#define CRASH_RECOVERY_SCAN_UNITS 1
+#endif
+#ifndef CRASH_RECOVERY_SCAN_BUDGET_US
+#define CRASH_RECOVERY_SCAN_BUDGET_US 1000
+#endif
 #define HARDWARE_WATCHDOG_TIMEOUT_MS 60000       // 60 seconds
 #define HEAP_TRACE_RECORD_COUNT 100               // Number of heap trace records
 
@@ -54,18 +66,36 @@ struct CrashStats {
     bool systemStable;
 };
 
+struct IntegrityScanStats {
+    uint32_t cycles;             // complete rounds over every unit
+    uint16_t units;              // per round
+    uint16_t unitsDone;          // in the round under way
+    uint32_t lastCycleMs;        // first pass to last pass of the latest round
+    uint32_t maxCycleMs;
+    uint32_t lastPassUs;
+    uint32_t maxPassUs;
+    uint32_t budgetStops;        // passes cut short by CRASH_RECOVERY_SCAN_BUDGET_US
+    uint32_t skipped;            // passes that found the mutex held
+};
+
 // ============================================================================
 // CRASH RECOVERY CLASS
 // ============================================================================
 class CrashRecovery {
 private:
-    // Task management
-    TaskHandle_t recoveryTaskHandle;
+    // Service jobs (service_task.h)
+    int serviceJob;
+    int scanJob;
     SemaphoreHandle_t mutex;
     bool isRunning;
     
     // Statistics
     CrashStats stats;
+
+    // Integrity scanner position
+    uint16_t scanCursor;
+    uint32_t scanCycleStartMs;
+    IntegrityScanStats scanStats;
     
     // Watchdog state
     bool hardwareWatchdogEnabled;
@@ -83,7 +113,8 @@ private:
     bool memoryCorruptionDetected;
     
     // Private methods
-    static void recoveryTask(void* pvParameters);
+    static void recoveryJob(void* ctx);
+    static void integrityScanJob(void* ctx);
     
     // Initialization
     bool initializeCrashDetection();
@@ -99,8 +130,11 @@ private:
     
     // System health checks
     void performSystemHealthCheck();
-    void checkCriticalTaskStacks();
     void monitorTaskHealth();
+
+    // Incremental integrity scanner
+    void integrityScanPass();
+    void checkTaskStack(const char* taskName);
     
     // Memory corruption detection
     void checkMemoryCorruption();
@@ -148,6 +182,7 @@ public:
     
     // Statistics access
     CrashStats getStats() const;
+    IntegrityScanStats getScanStats() const;
     void printStats() const;
     
     // System status
@@ -182,11 +217,4 @@ extern CrashRecovery* g_crashRecovery;
 #define CRASH_RECOVERY_IS_STABLE() g_crashRecovery->isSystemStable()
 #define CRASH_RECOVERY_TRIGGER_MEMORY() g_crashRecovery->triggerMemoryRecovery()
 
-// ============================================================================
-// CRASH RECOVERY TASK CONFIGURATION
-// ============================================================================
-#ifndef CRASH_RECOVERY_TASK_PRIORITY
-#define CRASH_RECOVERY_TASK_PRIORITY TASK_PRIORITY_SYSTEM_MONITOR
-#endif
-
 #endif // CRASH_RECOVERY_H
@@ -0,0 +1,274 @@
+/*
+ * DSP Kernels Implementation
+ */
+
+#include "dsp_kernels.h"
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+#if DSP_USE_ESP_DSP
+bool s_fftReady = false;
+#endif
+
+bool powerOfTwo(size_t n) {
+    return n >= 2 && n <= DSP_FFT_MAX && (n & (n - 1)) == 0;
+}
+
+// Sum, min and max in four lanes; the square sum comes separately
+void sumMinMax(const float* x, size_t n, DspBlockSums& out) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    float lo = x[0], hi = x[0];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        s0 += x[i];
+        s1 += x[i + 1];
+        s2 += x[i + 2];
+        s3 += x[i + 3];
+        lo = fminf(lo, fminf(fminf(x[i], x[i + 1]), fminf(x[i + 2], x[i + 3])));
+        hi = fmaxf(hi, fmaxf(fmaxf(x[i], x[i + 1]), fmaxf(x[i + 2], x[i + 3])));
+    }
+    for (; i < n; i++) {
+        s0 += x[i];
+        lo = fminf(lo, x[i]);
+        hi = fmaxf(hi, x[i]);
+    }
+    out.sum = (s0 + s1) + (s2 + s3);
+    out.min = lo;
+    out.max = hi;
+}
+
+void powerFromComplex(const float* data, size_t n, float* power) {
+    for (size_t k = 0; k < n / 2; k++) {
+        const float re = data[2 * k];
+        const float im = data[2 * k + 1];
+        power[k] = re * re + im * im;
+    }
+}
+
+struct BenchTime {
+    uint32_t refUs;
+    uint32_t vecUs;
+    float maxError;
+};
+
+void printBench(Print& out, const char* name, const BenchTime& t, size_t samples) {
+    const float refNs = t.refUs * 1000.0f / samples;
+    const float vecNs = t.vecUs * 1000.0f / samples;
+    out.printf("  %-10s ref %7.1f ns/sample  %s %7.1f ns/sample  x%.2f  max err %.3g\n", name, refNs,
+               DSP_USE_ESP_DSP ? "esp-dsp" : "c", vecNs, vecNs > 0 ? refNs / vecNs : 0.0f, t.maxError);
+}
+
+float maxDiff(const float* a, const float* b, size_t n) {
+    float m = 0;
+    for (size_t i = 0; i < n; i++) m = fmaxf(m, fabsf(a[i] - b[i]));
+    return m;
+}
+} // namespace
+
+bool dsp_ref_block_sums(const float* x, size_t n, DspBlockSums& out) {
+    if (!x || !n) return false;
+    out = DspBlockSums{0, 0, x[0], x[0]};
+    for (size_t i = 0; i < n; i++) {
+        out.sum += x[i];
+        out.sumSq += x[i] * x[i];
+        if (x[i] < out.min) out.min = x[i];
+        if (x[i] > out.max) out.max = x[i];
+    }
+    return true;
+}
+
+bool dsp_block_sums(const float* x, size_t n, DspBlockSums& out) {
+    if (!x || !n) return false;
+    sumMinMax(x, n, out);
+#if DSP_USE_ESP_DSP
+    if (dsps_dotprod_f32(x, x, &out.sumSq, (int)n) == ESP_OK) return true;
+#endif
+    float q0 = 0, q1 = 0, q2 = 0, q3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        q0 += x[i] * x[i];
+        q1 += x[i + 1] * x[i + 1];
+        q2 += x[i + 2] * x[i + 2];
+        q3 += x[i + 3] * x[i + 3];
+    }
+    for (; i < n; i++) q0 += x[i] * x[i];
+    out.sumSq = (q0 + q1) + (q2 + q3);
+    return true;
+}
+
+bool dsp_stats(const float* x, size_t n, DspStats& out) {
+    DspBlockSums s;
+    if (!dsp_block_sums(x, n, s)) return false;
+    out.mean = s.sum / n;
+    const float meanSq = s.sumSq / n;
+    out.variance = fmaxf(meanSq - out.mean * out.mean, 0.0f);
+    out.rms = sqrtf(meanSq);
+    out.min = s.min;
+    out.max = s.max;
+    return true;
+}
+
+bool dsp_fir_init(DspFir& fir, const float* coeffs, float* delay, uint16_t taps) {
+    if (!coeffs || !delay || !taps || (taps & 3)) return false;
+    fir.coeffs = coeffs;
+    fir.delay = delay;
+    fir.taps = taps;
+    fir.pos = 0;
+    memset(delay, 0, taps * sizeof(float));
+#if DSP_USE_ESP_DSP
+    if (dsps_fir_init_f32(&fir.impl, const_cast<float*>(coeffs), delay, taps) != ESP_OK) return false;
+#endif
+    return true;
+}
+
+void dsp_ref_fir(DspFir& fir, const float* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        fir.delay[fir.pos] = in[i];
+        if (++fir.pos >= fir.taps) fir.pos = 0;
+        // Oldest sample first: delay[pos] .. delay[pos - 1]
+        float acc = 0;
+        uint16_t c = 0;
+        for (uint16_t k = fir.pos; k < fir.taps; k++) acc += fir.coeffs[c++] * fir.delay[k];
+        for (uint16_t k = 0; k < fir.pos; k++) acc += fir.coeffs[c++] * fir.delay[k];
+        out[i] = acc;
+    }
+}
+
+void dsp_fir(DspFir& fir, const float* in, float* out, size_t n) {
+#if DSP_USE_ESP_DSP
+    dsps_fir_f32(&fir.impl, in, out, (int)n);
+#else
+    dsp_ref_fir(fir, in, out, n);
+#endif
+}
+
+bool dsp_ref_fft_power(float* data, size_t n, float* power) {
+    if (!data || !power || !powerOfTwo(n)) return false;
+    // Bit-reversed order, then iterative radix-2 butterflies
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            float t = data[2 * i];
+            data[2 * i] = data[2 * j];
+            data[2 * j] = t;
+            t = data[2 * i + 1];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j + 1] = t;
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const float angle = -2.0f * (float)M_PI / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                const float wr = cosf(angle * k);
+                const float wi = sinf(angle * k);
+                float* a = &data[2 * (i + k)];
+                float* b = &data[2 * (i + k + len / 2)];
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+    powerFromComplex(data, n, power);
+    return true;
+}
+
+bool dsp_fft_power(float* data, size_t n, float* power) {
+#if DSP_USE_ESP_DSP
+    if (!data || !power || !powerOfTwo(n)) return false;
+    if (!s_fftReady) {
+        if (dsps_fft2r_init_fc32(nullptr, DSP_FFT_MAX) != ESP_OK) return false;
+        s_fftReady = true;
+    }
+    if (dsps_fft2r_fc32(data, (int)n) != ESP_OK || dsps_bit_rev_fc32(data, (int)n) != ESP_OK) return false;
+    powerFromComplex(data, n, power);
+    return true;
+#else
+    return dsp_ref_fft_power(data, n, power);
+#endif
+}
+
+bool dsp_benchmark(Print& out) {
+    constexpr size_t n = DSP_BENCH_SAMPLES;
+    constexpr uint16_t taps = 16;
+    static_assert(n >= 2 && n <= DSP_FFT_MAX && (n & (n - 1)) == 0, "DSP_BENCH_SAMPLES must be a power of two");
+    // x, two outputs, two complex FFT buffers, two spectra, coefficients and delays
+    const size_t floats = n * 3 + n * 4 + n + taps * 3;
+    float* mem = static_cast<float*>(heap_caps_aligned_alloc(16, floats * sizeof(float), MALLOC_CAP_8BIT));
+    if (!mem) {
+        out.println("DSP benchmark: out of memory");
+        return false;
+    }
+    float* x = mem;
+    float* yRef = x + n;
+    float* yVec = yRef + n;
+    float* fftRef = yVec + n;
+    float* fftVec = fftRef + 2 * n;
+    float* pRef = fftVec + 2 * n;
+    float* pVec = pRef + n / 2;
+    float* coeffs = pVec + n / 2;
+    float* delayRef = coeffs + taps;
+    float* delayVec = delayRef + taps;
+
+    // A slow level with a ripple and some noise, like a sloshing tank
+    for (size_t i = 0; i < n; i++) {
+        x[i] = 50.0f + 5.0f * sinf(2.0f * (float)M_PI * i * 7 / n) + (float)(rand() % 100) * 0.01f;
+    }
+    for (uint16_t k = 0; k < taps; k++) coeffs[k] = 1.0f / taps;
+    out.printf("DSP benchmark: %u samples, %u iterations, %s\n", (unsigned)n, (unsigned)DSP_BENCH_ITERATIONS,
+               DSP_USE_ESP_DSP ? "esp-dsp" : "no esp-dsp (both columns are C)");
+
+    BenchTime t = {};
+    DspBlockSums sRef = {}, sVec = {};
+    int64_t start = esp_timer_get_time();
+    for (int it = 0; it < DSP_BENCH_ITERATIONS; it++) dsp_ref_block_sums(x, n, sRef);
+    t.refUs = (uint32_t)(esp_timer_get_time() - start);
+    start = esp_timer_get_time();
+    for (int it = 0; it < DSP_BENCH_ITERATIONS; it++) dsp_block_sums(x, n, sVec);
+    t.vecUs = (uint32_t)(esp_timer_get_time() - start);
+    t.maxError = fmaxf(fabsf(sRef.sum - sVec.sum) / n, fabsf(sRef.sumSq - sVec.sumSq) / n);
+    printBench(out, "sums", t, n * DSP_BENCH_ITERATIONS);
+
+    DspFir firRef, firVec;
+    dsp_fir_init(firRef, coeffs, delayRef, taps);
+    dsp_fir_init(firVec, coeffs, delayVec, taps);
+    t = {};
+    start = esp_timer_get_time();
+    for (int it = 0; it < DSP_BENCH_ITERATIONS; it++) dsp_ref_fir(firRef, x, yRef, n);
+    t.refUs = (uint32_t)(esp_timer_get_time() - start);
+    start = esp_timer_get_time();
+    for (int it = 0; it < DSP_BENCH_ITERATIONS; it++) dsp_fir(firVec, x, yVec, n);
+    t.vecUs = (uint32_t)(esp_timer_get_time() - start);
+    t.maxError = maxDiff(yRef, yVec, n);
+    printBench(out, "fir16", t, n * DSP_BENCH_ITERATIONS);
+
+    t = {};
+    for (int it = 0; it < DSP_BENCH_ITERATIONS; it++) {
+        for (size_t i = 0; i < n; i++) {
+            fftRef[2 * i] = fftVec[2 * i] = x[i];
+            fftRef[2 * i + 1] = fftVec[2 * i + 1] = 0.0f;
+        }
+        start = esp_timer_get_time();
+        dsp_ref_fft_power(fftRef, n, pRef);
+        t.refUs += (uint32_t)(esp_timer_get_time() - start);
+        start = esp_timer_get_time();
+        dsp_fft_power(fftVec, n, pVec);
+        t.vecUs += (uint32_t)(esp_timer_get_time() - start);
+    }
+    // Relative to the DC bin, which dominates this signal
+    t.maxError = maxDiff(pRef, pVec, n / 2) / (pRef[0] > 0 ? pRef[0] : 1.0f);
+    printBench(out, "fft", t, n * DSP_BENCH_ITERATIONS);
+
+    heap_caps_free(mem);
+    return true;
+}
@@ -0,0 +1,84 @@
+/*
+ * DSP Kernels
+ * Float32 window math for the sampled analog signals (hardware/analog_sampler.h):
+ * block sums for mean/variance/RMS, FIR filtering and a radix-2 power
+ * spectrum. When esp-dsp is in the build (DSP_USE_ESP_DSP) the dot product,
+ * FIR and FFT run on its ESP32-S3 vector (PIE) routines; otherwise and as the
+ * reference they are plain C loops. dsp_ref_* are always the C versions, so
+ * dsp_benchmark() can time both and check the vector results against them.
+ */
+
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <Arduino.h>
+
+#ifndef DSP_USE_ESP_DSP
+#if __has_include(<esp_dsp.h>)
+#define DSP_USE_ESP_DSP 1
+#else
+#define DSP_USE_ESP_DSP 0
+#endif
+#endif
+#ifndef DSP_BENCH_SAMPLES
+#define DSP_BENCH_SAMPLES 256              // window (and FFT) length of the benchmark
+#endif
+#ifndef DSP_BENCH_AT_BOOT
+#define DSP_BENCH_AT_BOOT 0                // run dsp_benchmark() once from setup()
+#endif
+#ifndef DSP_BENCH_ITERATIONS
+#define DSP_BENCH_ITERATIONS 64
+#endif
+#define DSP_FFT_MAX 1024
+#define DSP_ALIGN alignas(16)              // PIE loads want 16-byte aligned buffers
+
+#if DSP_USE_ESP_DSP
+#include <esp_dsp.h>
+#endif
+
+struct DspBlockSums {
+    float sum;
+    float sumSq;
+    float min;
+    float max;
+};
+
+struct DspStats {
+    float mean;
+    float variance;          // population
+    float rms;
+    float min;
+    float max;
+};
+
+// FIR state; coefficients apply oldest sample first (esp-dsp order, the same
+// for the usual symmetric taps). coeffs and delay hold taps floats, a multiple
+// of 4, 16-byte aligned, owned by the caller. A state runs either dsp_fir or
+// dsp_ref_fir, not both.
+struct DspFir {
+    const float* coeffs;
+    float* delay;
+    uint16_t taps;
+    uint16_t pos;
+#if DSP_USE_ESP_DSP
+    fir_f32_t impl;
+#endif
+};
+
+bool dsp_block_sums(const float* x, size_t n, DspBlockSums& out);
+bool dsp_stats(const float* x, size_t n, DspStats& out);
+bool dsp_fir_init(DspFir& fir, const float* coeffs, float* delay, uint16_t taps);
+void dsp_fir(DspFir& fir, const float* in, float* out, size_t n);
+// data: n complex values (re, im interleaved), transformed in place; power gets
+// |X[k]|^2 for k < n/2. n a power of two up to DSP_FFT_MAX.
+bool dsp_fft_power(float* data, size_t n, float* power);
+
+bool dsp_ref_block_sums(const float* x, size_t n, DspBlockSums& out);
+void dsp_ref_fir(DspFir& fir, const float* in, float* out, size_t n);
+bool dsp_ref_fft_power(float* data, size_t n, float* power);
+
+// Times each kernel against its reference on a synthetic window; prints
+// ns/sample and the largest deviation. Allocates its buffers for the run.
+bool dsp_benchmark(Print& out);
+
+#endif // DSP_KERNELS_H
@@ -0,0 +1,253 @@
+/*
+ * Energy Accounting Implementation
+ */
+
+#include "energy_account.h"
+
+#if ENERGY_ACCOUNT_ENABLE
+
+#include "metrics.h"
+#include "time_service.h"
+#include <freertos/FreeRTOS.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+constexpr size_t kSubs = static_cast<size_t>(EnergySubsystem::Count);
+constexpr uint32_t kDayS = 86400;
+constexpr float kUaMsPerMah = 3.6e9f;        // 1 mAh = 1000 uA for 3.6e6 ms
+constexpr uint64_t kUaMsPerUah = 3600000ULL;
+
+const char* const kSubNames[kSubs] = {"base", "modem", "gnss", "display", "cpu"};
+const uint8_t kStateCount[kSubs] = {1, 4, 2, 2, static_cast<uint8_t>(PowerMode::Count)};
+const char* const kStateNames[kSubs][ENERGY_MAX_STATES] = {
+    {"on", nullptr, nullptr, nullptr},
+    {"off", "psm", "searching", "attached"},
+    {"off", "on", nullptr, nullptr},
+    {"asleep", "on", nullptr, nullptr},
+    {"full", "dfs", "light-sleep", nullptr},
+};
+const float kModelMa[kSubs][ENERGY_MAX_STATES] = {
+    {ENERGY_MA_BASE, 0, 0, 0},
+    {0, ENERGY_MA_MODEM_PSM, ENERGY_MA_MODEM_SEARCHING, ENERGY_MA_MODEM_ATTACHED},
+    {0, ENERGY_MA_GNSS_ON, 0, 0},
+    {ENERGY_MA_DISPLAY_ASLEEP, ENERGY_MA_DISPLAY_ON, 0, 0},
+    {ENERGY_MA_CPU_FULL, ENERGY_MA_CPU_DFS, ENERGY_MA_CPU_LIGHT_SLEEP, 0},
+};
+static_assert(static_cast<size_t>(PowerMode::Count) <= ENERGY_MAX_STATES, "CPU states are power modes");
+
+struct Day {
+    uint32_t index;
+    uint32_t measuredMs;
+    uint64_t uaMs[kSubs];
+};
+
+struct StateAcc {
+    uint64_t ms;
+    uint64_t measuredMs;
+    uint64_t uaMs;           // measured total while in the state
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+// Defaults until the first hook: modem off at reset, display on, full clock
+uint8_t s_state[kSubs] = {0, static_cast<uint8_t>(EnergyModem::Off), static_cast<uint8_t>(EnergyGnss::Off),
+                          static_cast<uint8_t>(EnergyDisplay::On), static_cast<uint8_t>(PowerMode::Full)};
+StateAcc s_states[kSubs][ENERGY_MAX_STATES] = {};
+Day s_days[ENERGY_DAYS] = {};
+uint8_t s_dayHead = 0;       // running day
+uint8_t s_dayCount = 0;
+uint64_t s_totalUaMs[kSubs] = {};    // since boot
+uint64_t s_modelUaMs = 0;    // what the model predicts over the measured time
+uint64_t s_measuredUaMs = 0;
+uint32_t s_unmeasuredMs = 0;
+uint32_t s_lastMs = 0;
+uint32_t s_lastUa = 0;
+bool s_started = false;
+bool s_haveReading = false;
+
+// Under s_mux
+Day& runningDay() {
+    const uint32_t index = time_uptime_s() / kDayS;
+    if (s_dayCount == 0) {
+        s_dayCount = 1;
+        s_days[s_dayHead] = Day{};
+        s_days[s_dayHead].index = index;
+    } else if (s_days[s_dayHead].index != index) {
+        s_dayHead = static_cast<uint8_t>((s_dayHead + 1) % ENERGY_DAYS);
+        if (s_dayCount < ENERGY_DAYS) s_dayCount++;
+        s_days[s_dayHead] = Day{};
+        s_days[s_dayHead].index = index;
+    }
+    return s_days[s_dayHead];
+}
+
+// Under s_mux. Charges (s_lastMs, now] at ua to the states in effect.
+void accrue(uint32_t now, uint32_t ua) {
+    if (!s_started) {
+        s_started = true;
+        s_lastMs = now;
+        return;
+    }
+    // A reading timestamped just before a state change already closed the interval
+    if (static_cast<int32_t>(now - s_lastMs) <= 0) return;
+    const uint32_t dt = now - s_lastMs;
+    s_lastMs = now;
+    const bool measured = s_haveReading && dt <= ENERGY_MAX_GAP_MS;
+    const uint64_t charge = measured ? static_cast<uint64_t>(ua) * dt : 0;
+    float weight[kSubs];
+    float total = 0.0f;
+    for (size_t i = 0; i < kSubs; i++) {
+        StateAcc& st = s_states[i][s_state[i]];
+        st.ms += dt;
+        if (measured) {
+            st.measuredMs += dt;
+            st.uaMs += charge;
+        }
+        weight[i] = kModelMa[i][s_state[i]];
+        total += weight[i];
+    }
+    if (!measured) {
+        s_unmeasuredMs += dt;
+        return;
+    }
+    Day& day = runningDay();
+    day.measuredMs += dt;
+    s_measuredUaMs += charge;
+    s_modelUaMs += static_cast<uint64_t>(total * 1000.0f) * dt;
+    for (size_t i = 0; i < kSubs; i++) {
+        const uint64_t share = total > 0.0f ? static_cast<uint64_t>(static_cast<float>(charge) * (weight[i] / total))
+                                            : (i == 0 ? charge : 0);
+        day.uaMs[i] += share;
+        s_totalUaMs[i] += share;
+    }
+}
+
+void setState(EnergySubsystem sub, uint8_t state) {
+    const size_t i = static_cast<size_t>(sub);
+    if (i >= kSubs || state >= kStateCount[i]) return;
+    portENTER_CRITICAL(&s_mux);
+    if (s_state[i] != state) {
+        accrue(millis(), s_lastUa);
+        s_state[i] = state;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+uint32_t totalUah(EnergySubsystem sub) {
+    portENTER_CRITICAL(&s_mux);
+    const uint64_t uaMs = s_totalUaMs[static_cast<size_t>(sub)];
+    portEXIT_CRITICAL(&s_mux);
+    return static_cast<uint32_t>(uaMs / kUaMsPerUah);
+}
+
+MetricCounter s_metricBase("energy.base_uah", [] { return totalUah(EnergySubsystem::Base); });
+MetricCounter s_metricModem("energy.modem_uah", [] { return totalUah(EnergySubsystem::Modem); });
+MetricCounter s_metricGnss("energy.gnss_uah", [] { return totalUah(EnergySubsystem::Gnss); });
+MetricCounter s_metricDisplay("energy.display_uah", [] { return totalUah(EnergySubsystem::Display); });
+MetricCounter s_metricCpu("energy.cpu_uah", [] { return totalUah(EnergySubsystem::Cpu); });
+} // namespace
+
+void energy_state(EnergyModem state) {
+    setState(EnergySubsystem::Modem, static_cast<uint8_t>(state));
+}
+
+void energy_state(EnergyGnss state) {
+    setState(EnergySubsystem::Gnss, static_cast<uint8_t>(state));
+}
+
+void energy_state(EnergyDisplay state) {
+    setState(EnergySubsystem::Display, static_cast<uint8_t>(state));
+}
+
+void energy_state(PowerMode state) {
+    setState(EnergySubsystem::Cpu, static_cast<uint8_t>(state));
+}
+
+void energy_current(float amps, uint32_t now) {
+    // The shunt sits in the supply path; a negative reading is offset noise
+    const uint32_t ua = amps > 0.0f ? static_cast<uint32_t>(amps * 1e6f) : 0;
+    portENTER_CRITICAL(&s_mux);
+    // The INA226 average describes the time just before it, so it pays for that interval
+    accrue(now, ua);
+    s_lastUa = ua;
+    s_haveReading = true;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+bool energy_day(uint8_t back, EnergyDay& out) {
+    memset(&out, 0, sizeof(out));
+    portENTER_CRITICAL(&s_mux);
+    const bool have = back < s_dayCount;
+    Day d = {};
+    if (have) d = s_days[(s_dayHead + ENERGY_DAYS - back) % ENERGY_DAYS];
+    portEXIT_CRITICAL(&s_mux);
+    if (!have) return false;
+    out.index = d.index;
+    out.measuredMs = d.measuredMs;
+    for (size_t i = 0; i < kSubs; i++) {
+        out.mAh[i] = static_cast<float>(d.uaMs[i]) / kUaMsPerMah;
+        out.totalMah += out.mAh[i];
+    }
+    return true;
+}
+
+bool energy_state_stats(EnergySubsystem sub, uint8_t state, EnergyStateStats& out) {
+    const size_t i = static_cast<size_t>(sub);
+    if (i >= kSubs || state >= kStateCount[i]) return false;
+    portENTER_CRITICAL(&s_mux);
+    const StateAcc st = s_states[i][state];
+    portEXIT_CRITICAL(&s_mux);
+    out.name = kStateNames[i][state];
+    out.seconds = static_cast<uint32_t>(st.ms / 1000);
+    out.measuredSeconds = static_cast<uint32_t>(st.measuredMs / 1000);
+    out.avgMa = st.measuredMs ? static_cast<float>(st.uaMs) / 1000.0f / static_cast<float>(st.measuredMs) : 0.0f;
+    return true;
+}
+
+const char* energy_subsystem_name(EnergySubsystem sub) {
+    const size_t i = static_cast<size_t>(sub);
+    return i < kSubs ? kSubNames[i] : "?";
+}
+
+void energy_report(Print& out) {
+    portENTER_CRITICAL(&s_mux);
+    const uint64_t model = s_modelUaMs;
+    const uint64_t measured = s_measuredUaMs;
+    const uint32_t unmeasuredMs = s_unmeasuredMs;
+    const uint8_t days = s_dayCount;
+    portEXIT_CRITICAL(&s_mux);
+    if (!days) {
+        out.println("Energy: no INA226 readings yet");
+        return;
+    }
+    out.printf("Energy: model %.0f%% of measured, %lu s unmeasured\n",
+               measured ? 100.0f * static_cast<float>(model) / static_cast<float>(measured) : 0.0f,
+               (unsigned long)(unmeasuredMs / 1000));
+    out.print("  mAh/day    ");
+    EnergyDay d[ENERGY_DAYS];
+    uint8_t n = 0;
+    for (; n < days && energy_day(n, d[n]); n++) {
+        char label[16];
+        snprintf(label, sizeof(label), "day %lu", (unsigned long)d[n].index);
+        out.printf(" %9s", label);
+    }
+    out.println();
+    for (size_t i = 0; i <= kSubs; i++) {
+        out.printf("  %-10s", i < kSubs ? kSubNames[i] : "total");
+        for (uint8_t k = 0; k < n; k++) out.printf(" %9.1f", i < kSubs ? d[k].mAh[i] : d[k].totalMah);
+        out.println();
+    }
+    out.printf("  %-10s", "hours");
+    for (uint8_t k = 0; k < n; k++) out.printf(" %9.1f", d[k].measuredMs / 3600000.0f);
+    out.println();
+    out.println("  state (measured total while in it)   time s   avg mA");
+    for (size_t i = 1; i < kSubs; i++) {
+        for (uint8_t s = 0; s < kStateCount[i]; s++) {
+            EnergyStateStats st;
+            if (!energy_state_stats(static_cast<EnergySubsystem>(i), s, st) || !st.seconds) continue;
+            out.printf("  %-8s %-27s %8lu %8.1f\n", kSubNames[i], st.name, (unsigned long)st.seconds, st.avgMa);
+        }
+    }
+}
+
+#endif // ENERGY_ACCOUNT_ENABLE
@@ -0,0 +1,122 @@
+/*
+ * Energy Accounting
+ * Splits the charge the INA226 measures between the subsystems that drew it:
+ *   - state hooks (energy_state) mark what each subsystem is doing: modem off,
+ *     in PSM, searching or attached; GNSS off or on; display on or asleep; CPU
+ *     in the power manager's Full, Dfs or LightSleep mode
+ *   - every INA226 reading (sensor_acquisition.h) adds its current times the
+ *     time since the previous reading; a state change closes the interval at
+ *     the change, at the last reading's current
+ *   - the charge is shared out in proportion to a per-state current model
+ *     (ENERGY_MA_* below) plus a Base share for the rest of the board, so the
+ *     shares always add up to what was measured
+ *   - the measured total is also kept per state: average mA with the display
+ *     asleep against with it on is what the display really costs, whatever the
+ *     model assumes; same for PSM and the power modes
+ *
+ * Days are 24 h periods since boot; the report shows the running day and up
+ * to ENERGY_DAYS - 1 before it. The metrics registry gets uAh per subsystem
+ * since boot (energy.<subsystem>_uah), so the backend can cut calendar days.
+ * Readings more than ENERGY_MAX_GAP_MS apart (sensor down) are not integrated.
+ */
+
+#ifndef ENERGY_ACCOUNT_H
+#define ENERGY_ACCOUNT_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+#include "power_manager.h"
+
+#ifndef ENERGY_DAYS
+#define ENERGY_DAYS 7
+#endif
+#ifndef ENERGY_MAX_GAP_MS
+#define ENERGY_MAX_GAP_MS 5000
+#endif
+// Current model, mA per state; only the ratios matter for the split
+#ifndef ENERGY_MA_BASE
+#define ENERGY_MA_BASE 30.0f               // PLC board, I/O expander, sensors
+#endif
+#ifndef ENERGY_MA_MODEM_PSM
+#define ENERGY_MA_MODEM_PSM 0.05f
+#endif
+#ifndef ENERGY_MA_MODEM_SEARCHING
+#define ENERGY_MA_MODEM_SEARCHING 60.0f
+#endif
+#ifndef ENERGY_MA_MODEM_ATTACHED
+#define ENERGY_MA_MODEM_ATTACHED 20.0f     // idle in connected mode, TX bursts averaged
+#endif
+#ifndef ENERGY_MA_GNSS_ON
+#define ENERGY_MA_GNSS_ON 30.0f
+#endif
+#ifndef ENERGY_MA_DISPLAY_ON
+#define ENERGY_MA_DISPLAY_ON 35.0f         // panel and backlight
+#endif
+#ifndef ENERGY_MA_DISPLAY_ASLEEP
+#define ENERGY_MA_DISPLAY_ASLEEP 0.5f
+#endif
+#ifndef ENERGY_MA_CPU_FULL
+#define ENERGY_MA_CPU_FULL 50.0f
+#endif
+#ifndef ENERGY_MA_CPU_DFS
+#define ENERGY_MA_CPU_DFS 25.0f
+#endif
+#ifndef ENERGY_MA_CPU_LIGHT_SLEEP
+#define ENERGY_MA_CPU_LIGHT_SLEEP 4.0f
+#endif
+
+enum class EnergySubsystem : uint8_t { Base, Modem, Gnss, Display, Cpu, Count };
+
+enum class EnergyModem : uint8_t { Off, Psm, Searching, Attached };
+enum class EnergyGnss : uint8_t { Off, On };
+enum class EnergyDisplay : uint8_t { Asleep, On };
+// CPU states are the PowerMode values
+
+#define ENERGY_MAX_STATES 4
+
+struct EnergyDay {
+    uint32_t index;                  // 24 h periods since boot
+    uint32_t measuredMs;             // time covered by readings
+    float totalMah;
+    float mAh[static_cast<size_t>(EnergySubsystem::Count)];
+};
+
+struct EnergyStateStats {
+    const char* name;
+    uint32_t seconds;                // time in the state since boot
+    uint32_t measuredSeconds;
+    float avgMa;                     // measured total current while in the state
+};
+
+#if ENERGY_ACCOUNT_ENABLE
+
+// State hooks; any task, cheap when the state is unchanged
+void energy_state(EnergyModem state);
+void energy_state(EnergyGnss state);
+void energy_state(EnergyDisplay state);
+void energy_state(PowerMode state);
+
+// Each new INA226 average (amps) from the sensor job
+void energy_current(float amps, uint32_t now);
+
+// back = 0 is the running day; false when that day is not kept
+bool energy_day(uint8_t back, EnergyDay& out);
+bool energy_state_stats(EnergySubsystem sub, uint8_t state, EnergyStateStats& out);
+const char* energy_subsystem_name(EnergySubsystem sub);
+void energy_report(Print& out);
+
+#else
+
+inline void energy_state(EnergyModem) {}
+inline void energy_state(EnergyGnss) {}
+inline void energy_state(EnergyDisplay) {}
+inline void energy_state(PowerMode) {}
+inline void energy_current(float, uint32_t) {}
+inline bool energy_day(uint8_t, EnergyDay&) { return false; }
+inline bool energy_state_stats(EnergySubsystem, uint8_t, EnergyStateStats&) { return false; }
+inline const char* energy_subsystem_name(EnergySubsystem) { return "?"; }
+inline void energy_report(Print&) {}
+
+#endif // ENERGY_ACCOUNT_ENABLE
+
+#endif // ENERGY_ACCOUNT_H
@@ -4,6 +4,7 @@
  */
 
 #include "../include/error_handler.h"
+#include "error_ring.h"
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -17,21 +18,12 @@ ErrorHandler* ErrorHandler::instance = nullptr;
 // CONSTRUCTOR/DESTRUCTOR
 // ============================================================================
 ErrorHandler::ErrorHandler() {
-    errorCount = 0;
-    currentIndex = 0;
-    totalErrors = 0;
-    criticalErrors = 0;
     recoveryAttempts = 0;
     successfulRecoveries = 0;
-    errorMutex = xSemaphoreCreateMutex();
-    memset(errorLog, 0, sizeof(errorLog));
+    error_ring_begin();
 }
 
 ErrorHandler::~ErrorHandler() {
-    if (errorMutex) {
-        vSemaphoreDelete(errorMutex);
-        errorMutex = nullptr;
-    }
 }
 
 // ============================================================================
@@ -49,50 +41,8 @@ ErrorHandler* ErrorHandler::getInstance() {
 // ============================================================================
 void ErrorHandler::reportError(ErrorCode code, ErrorSeverity severity, ErrorCategory category,
                               const char* description, const char* context) {
-    // Simple logging implementation - just log to Serial
-    const char* severityStr = severityToString(severity);
-    const char* categoryStr = categoryToString(category);
-    
-    Serial.printf("[ERROR] %s/%s: %s", severityStr, categoryStr, description);
-    if (context) {
-        Serial.printf(" (Context: %s)", context);
-    }
-    Serial.println();
-    
-    // Update statistics
-    totalErrors++;
-    if (severity == ErrorSeverity::CRITICAL || severity == ErrorSeverity::FATAL) {
-        criticalErrors++;
-    }
-    
-    // Store in log (simple circular buffer)
-    if (errorMutex && xSemaphoreTake(errorMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        ErrorEvent& event = errorLog[currentIndex];
-        event.timestamp = millis();
-        event.code = code;
-        event.severity = severity;
-        event.category = category;
-        event.taskHandle = xTaskGetCurrentTaskHandle();
-        strncpy(event.description, description, sizeof(event.description) - 1);
-        event.description[sizeof(event.description) - 1] = '\0';
-        if (context) {
-            strncpy(event.context, context, sizeof(event.context) - 1);
-            event.context[sizeof(event.context) - 1] = '\0';
-        } else {
-            event.context[0] = '\0';
-        }
-        event.count = 1;
-        event.firstOccurrence = event.timestamp;
-        event.recoveryAttempted = false;
-        event.recoverySuccessful = false;
-        
-        currentIndex = (currentIndex + 1) % 50;
-        if (errorCount < 50) {
-            errorCount++;
-        }
-        
-        xSemaphoreGive(errorMutex);
-    }
+    // Counted and stored lock-free; the console line comes from the ring's drain job
+    error_ring_record(code, severity, category, description, context);
 }
 
 void ErrorHandler::reportErrorWithTask(ErrorCode code, ErrorSeverity severity, ErrorCategory category,
@@ -118,19 +68,36 @@ bool ErrorHandler::attemptAutomaticRecovery(ErrorCode code, ErrorCategory catego
 // ============================================================================
 // ERROR QUERYING
 // ============================================================================
-ErrorEvent* ErrorHandler::getLastError() {
-    if (errorCount == 0) return nullptr;
-    uint8_t lastIndex = (currentIndex == 0) ? 49 : (currentIndex - 1);
-    return &errorLog[lastIndex];
+bool ErrorHandler::getLastError(ErrorEvent& out) const {
+    return error_ring_last(out);
 }
 
-ErrorEvent* ErrorHandler::getErrorByCode(ErrorCode code) {
-    for (uint8_t i = 0; i < errorCount; i++) {
-        if (errorLog[i].code == code) {
-            return &errorLog[i];
-        }
-    }
-    return nullptr;
+// Most recently seen category for the code
+bool ErrorHandler::getErrorByCode(ErrorCode code, ErrorEvent& out) const {
+    struct Find {
+        ErrorCode code;
+        ErrorEvent* out;
+        bool found;
+    } find{code, &out, false};
+    error_ring_foreach([](const ErrorEvent& e, void* ctx) {
+        Find& f = *static_cast<Find*>(ctx);
+        if (e.code != f.code) return;
+        if (!f.found || static_cast<int32_t>(e.timestamp - f.out->timestamp) > 0) *f.out = e;
+        f.found = true;
+    }, &find);
+    return find.found;
+}
+
+uint8_t ErrorHandler::getErrorCount() const {
+    return static_cast<uint8_t>(error_ring_keys());
+}
+
+uint32_t ErrorHandler::getTotalErrors() const {
+    return error_ring_total();
+}
+
+uint32_t ErrorHandler::getCriticalErrors() const {
+    return error_ring_critical();
 }
 
 uint32_t ErrorHandler::getRecoverySuccessRate() const {
@@ -142,20 +109,15 @@ uint32_t ErrorHandler::getRecoverySuccessRate() const {
 // ERROR MANAGEMENT
 // ============================================================================
 void ErrorHandler::clearErrors() {
-    if (errorMutex && xSemaphoreTake(errorMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-        errorCount = 0;
-        currentIndex = 0;
-        memset(errorLog, 0, sizeof(errorLog));
-        xSemaphoreGive(errorMutex);
-    }
+    error_ring_clear();
 }
 
 void ErrorHandler::clearErrorsByCategory(ErrorCategory category) {
-    // Stub implementation
+    error_ring_clear_category(category);
 }
 
 void ErrorHandler::clearOldErrors(uint32_t olderThanMs) {
-    // Stub implementation
+    error_ring_clear_older(olderThanMs);
 }
 
 // ============================================================================
@@ -163,21 +125,14 @@ void ErrorHandler::clearOldErrors(uint32_t olderThanMs) {
 // ============================================================================
 void ErrorHandler::printErrorLog() const {
     Serial.println("\n=== Error Log ===");
-    for (uint8_t i = 0; i < errorCount; i++) {
-        const ErrorEvent& event = errorLog[i];
-        Serial.printf("[%lu] %s/%s: %s\n", 
-                     event.timestamp, 
-                     severityToString(event.severity),
-                     categoryToString(event.category),
-                     event.description);
-    }
+    error_ring_report(Serial);
     Serial.println("================\n");
 }
 
 void ErrorHandler::printStatistics() const {
     Serial.println("\n=== Error Statistics ===");
-    Serial.printf("Total Errors: %lu\n", totalErrors);
-    Serial.printf("Critical Errors: %lu\n", criticalErrors);
+    Serial.printf("Total Errors: %lu\n", error_ring_total());
+    Serial.printf("Critical Errors: %lu\n", error_ring_critical());
     Serial.printf("Recovery Attempts: %lu\n", recoveryAttempts);
     Serial.printf("Successful Recoveries: %lu\n", successfulRecoveries);
     Serial.println("========================\n");
@@ -192,28 +147,35 @@ void ErrorHandler::dumpErrorToFile(const char* filename) const {
 // SYSTEM HEALTH
 // ============================================================================
 bool ErrorHandler::isSystemHealthy() const {
-    return (criticalErrors == 0);
+    return error_ring_critical() == 0;
 }
 
 ErrorSeverity ErrorHandler::getHighestSeverity() const {
     ErrorSeverity highest = ErrorSeverity::INFO;
-    for (uint8_t i = 0; i < errorCount; i++) {
-        if (errorLog[i].severity > highest) {
-            highest = errorLog[i].severity;
-        }
-    }
+    error_ring_foreach([](const ErrorEvent& e, void* ctx) {
+        ErrorSeverity& h = *static_cast<ErrorSeverity*>(ctx);
+        if (e.severity > h) h = e.severity;
+    }, &highest);
     return highest;
 }
 
 ErrorCategory ErrorHandler::getMostProblematicCategory() const {
-    // Stub implementation
-    return ErrorCategory::SYSTEM;
+    uint32_t counts[static_cast<uint8_t>(ErrorCategory::POWER) + 1] = {};
+    error_ring_foreach([](const ErrorEvent& e, void* ctx) {
+        const uint8_t c = static_cast<uint8_t>(e.category);
+        if (c <= static_cast<uint8_t>(ErrorCategory::POWER)) static_cast<uint32_t*>(ctx)[c] += e.count;
+    }, counts);
+    uint8_t worst = 0;
+    for (uint8_t c = 1; c <= static_cast<uint8_t>(ErrorCategory::POWER); c++) {
+        if (counts[c] > counts[worst]) worst = c;
+    }
+    return static_cast<ErrorCategory>(worst);
 }
 
 // ============================================================================
 // PRIVATE HELPER METHODS
 // ============================================================================
-const char* ErrorHandler::severityToString(ErrorSeverity severity) const {
+const char* ErrorHandler::severityToString(ErrorSeverity severity) {
     switch (severity) {
         case ErrorSeverity::INFO: return "INFO";
         case ErrorSeverity::WARNING: return "WARNING";
@@ -224,7 +186,7 @@ const char* ErrorHandler::severityToString(ErrorSeverity severity) const {
     }
 }
 
-const char* ErrorHandler::categoryToString(ErrorCategory category) const {
+const char* ErrorHandler::categoryToString(ErrorCategory category) {
     switch (category) {
         case ErrorCategory::SYSTEM: return "SYSTEM";
         case ErrorCategory::HARDWARE: return "HARDWARE";
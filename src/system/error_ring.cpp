@@ -0,0 +1,308 @@
+/*
+ * Error Ring Implementation
+ */
+
+#include "error_ring.h"
+#include "service_task.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <string.h>
+
+namespace {
+constexpr uint32_t kFree = 0;
+constexpr uint32_t kIdleMs = static_cast<uint32_t>(ERROR_RING_BURST) * ERROR_RING_REFILL_MS;
+constexpr uint32_t kMaxAheadMs = static_cast<uint32_t>(ERROR_RING_BURST - 1) * ERROR_RING_REFILL_MS;
+static_assert(ERROR_RING_BURST >= 1, "a key needs at least one emit");
+
+struct Slot {
+    std::atomic<uint32_t> key;           // kFree, or (code << 8 | category) + 1
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> emitted;
+    std::atomic<uint32_t> firstMs;
+    std::atomic<uint32_t> lastMs;
+    std::atomic<uint32_t> tat;           // GCRA: time the bucket is empty
+    std::atomic<uint8_t> worst;
+    std::atomic<TaskHandle_t> task;      // last reporter; null from an ISR
+    std::atomic<uint32_t> textSeq;       // odd while a reporter writes the text
+    char description[ERROR_TEXT_BYTES];
+    char context[ERROR_CONTEXT_BYTES];
+    // Drain only
+    uint32_t printedCount;
+    uint32_t printedEmitted;
+};
+
+Slot s_slots[ERROR_RING_SLOTS];
+std::atomic<uint32_t> s_total{0};
+std::atomic<uint32_t> s_critical{0};
+std::atomic<uint32_t> s_overflow{0};
+int s_job = SERVICE_JOB_NONE;
+
+uint32_t makeKey(ErrorCode code, ErrorCategory category) {
+    return ((static_cast<uint32_t>(code) << 8) | (static_cast<uint32_t>(category) & 0xFF)) + 1;
+}
+
+// Open addressing, never removed while running: the probe stops at the first free slot
+Slot* claim(uint32_t key, uint32_t now) {
+    const uint32_t start = (key * 2654435761UL) % ERROR_RING_SLOTS;
+    for (uint32_t n = 0; n < ERROR_RING_SLOTS; n++) {
+        Slot& s = s_slots[(start + n) % ERROR_RING_SLOTS];
+        uint32_t k = s.key.load(std::memory_order_acquire);
+        if (k == kFree) {
+            if (s.key.compare_exchange_strong(k, key, std::memory_order_acq_rel)) {
+                s.lastMs.store(now, std::memory_order_relaxed);
+                s.tat.store(now, std::memory_order_relaxed);
+                return &s;
+            }
+            // Lost the race; k now holds the winner's key
+        }
+        if (k == key) return &s;
+    }
+    return nullptr;
+}
+
+bool allow(Slot& s, uint32_t now, uint32_t prevMs) {
+    // A key quiet for a full bucket starts over; also keeps a stale tat from wrapping
+    const bool idle = now - prevMs > kIdleMs;
+    uint32_t tat = s.tat.load(std::memory_order_relaxed);
+    for (;;) {
+        const int32_t ahead = idle ? 0 : static_cast<int32_t>(tat - now);
+        if (ahead > static_cast<int32_t>(kMaxAheadMs)) return false;
+        const uint32_t next = (ahead > 0 ? tat : now) + ERROR_RING_REFILL_MS;
+        if (s.tat.compare_exchange_weak(tat, next, std::memory_order_relaxed)) return true;
+    }
+}
+
+void copyText(char* out, size_t size, const char* in) {
+    if (!in) {
+        out[0] = '\0';
+        return;
+    }
+    strncpy(out, in, size - 1);
+    out[size - 1] = '\0';
+}
+
+// Skipped when another reporter is mid-write: that text is as fresh
+void writeText(Slot& s, const char* description, const char* context) {
+    uint32_t seq = s.textSeq.load(std::memory_order_relaxed);
+    if ((seq & 1u) || !s.textSeq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) return;
+    copyText(s.description, sizeof(s.description), description);
+    copyText(s.context, sizeof(s.context), context);
+    s.textSeq.store(seq + 2, std::memory_order_release);
+}
+
+// Task context only
+void readText(const Slot& s, char* description, char* context) {
+    for (uint32_t attempt = 0; attempt < 32; attempt++) {
+        const uint32_t s1 = s.textSeq.load(std::memory_order_acquire);
+        if ((s1 & 1u) == 0) {
+            memcpy(description, s.description, ERROR_TEXT_BYTES);
+            memcpy(context, s.context, ERROR_CONTEXT_BYTES);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.textSeq.load(std::memory_order_relaxed) == s1) return;
+        }
+        if ((attempt & 7) == 7) vTaskDelay(1);
+    }
+    copyText(description, ERROR_TEXT_BYTES, "(busy)");
+    context[0] = '\0';
+}
+
+bool fill(const Slot& s, ErrorEvent& out) {
+    const uint32_t key = s.key.load(std::memory_order_acquire);
+    const uint32_t count = s.count.load(std::memory_order_relaxed);
+    if (key == kFree || !count) return false;
+    memset(&out, 0, sizeof(out));
+    out.code = static_cast<ErrorCode>((key - 1) >> 8);
+    out.category = static_cast<ErrorCategory>((key - 1) & 0xFF);
+    out.severity = static_cast<ErrorSeverity>(s.worst.load(std::memory_order_relaxed));
+    out.count = count;
+    out.suppressed = count - s.emitted.load(std::memory_order_relaxed);
+    out.timestamp = s.lastMs.load(std::memory_order_relaxed);
+    out.firstOccurrence = s.firstMs.load(std::memory_order_relaxed);
+    out.taskHandle = s.task.load(std::memory_order_relaxed);
+    readText(s, out.description, out.context);
+    return true;
+}
+
+void clearSlot(Slot& s) {
+    s.count.store(0, std::memory_order_relaxed);
+    s.emitted.store(0, std::memory_order_relaxed);
+    s.worst.store(0, std::memory_order_relaxed);
+    s.task.store(nullptr, std::memory_order_relaxed);
+    s.printedCount = 0;
+    s.printedEmitted = 0;
+}
+
+// Keys stay claimed (the probe chain relies on it); only the counts go
+template <typename Pred>
+void clearIf(Pred pred) {
+    for (Slot& s : s_slots) {
+        const uint32_t key = s.key.load(std::memory_order_acquire);
+        if (key != kFree && pred(s, key)) clearSlot(s);
+    }
+}
+
+void drainJob(void*) {
+    error_ring_drain(Serial);
+}
+} // namespace
+
+bool error_ring_begin() {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    s_job = service_job_add("ErrorDrain", drainJob, nullptr, ERROR_RING_DRAIN_MS, ERROR_RING_DRAIN_BUDGET_US);
+    return s_job != SERVICE_JOB_NONE;
+}
+
+bool error_ring_record(ErrorCode code, ErrorSeverity severity, ErrorCategory category, const char* description,
+                       const char* context) {
+    const uint32_t now = millis();
+    s_total.fetch_add(1, std::memory_order_relaxed);
+    if (severity >= ErrorSeverity::CRITICAL) s_critical.fetch_add(1, std::memory_order_relaxed);
+
+    Slot* s = claim(makeKey(code, category), now);
+    if (!s) {
+        s_overflow.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const uint32_t prevMs = s->lastMs.exchange(now, std::memory_order_relaxed);
+    const uint8_t sev = static_cast<uint8_t>(severity);
+    uint8_t worst = s->worst.load(std::memory_order_relaxed);
+    while (sev > worst && !s->worst.compare_exchange_weak(worst, sev, std::memory_order_relaxed)) {
+    }
+    s->task.store(xPortInIsrContext() ? nullptr : xTaskGetCurrentTaskHandle(), std::memory_order_relaxed);
+
+    // First occurrence always emits, so the slot never shows an empty text
+    const bool first = s->count.fetch_add(1, std::memory_order_relaxed) == 0;
+    if (first) s->firstMs.store(now, std::memory_order_relaxed);
+    if (!allow(*s, now, prevMs) && !first) return false;
+    writeText(*s, description ? description : "", context);
+    s->emitted.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+size_t error_ring_snapshot(ErrorEvent* out, size_t max) {
+    if (!out) return 0;
+    size_t n = 0;
+    for (const Slot& s : s_slots) {
+        if (n >= max) break;
+        if (fill(s, out[n])) n++;
+    }
+    // Oldest key first; the table is small
+    for (size_t i = 1; i < n; i++) {
+        for (size_t j = i; j > 0 && static_cast<int32_t>(out[j].firstOccurrence - out[j - 1].firstOccurrence) < 0; j--) {
+            const ErrorEvent t = out[j];
+            out[j] = out[j - 1];
+            out[j - 1] = t;
+        }
+    }
+    return n;
+}
+
+bool error_ring_find(ErrorCode code, ErrorCategory category, ErrorEvent& out) {
+    const uint32_t key = makeKey(code, category);
+    for (const Slot& s : s_slots) {
+        if (s.key.load(std::memory_order_acquire) == key) return fill(s, out);
+    }
+    return false;
+}
+
+bool error_ring_last(ErrorEvent& out) {
+    const Slot* last = nullptr;
+    for (const Slot& s : s_slots) {
+        if (s.key.load(std::memory_order_acquire) == kFree || !s.count.load(std::memory_order_relaxed)) continue;
+        if (!last || static_cast<int32_t>(s.lastMs.load(std::memory_order_relaxed) -
+                                          last->lastMs.load(std::memory_order_relaxed)) > 0) {
+            last = &s;
+        }
+    }
+    return last && fill(*last, out);
+}
+
+void error_ring_foreach(void (*fn)(const ErrorEvent& e, void* ctx), void* ctx) {
+    if (!fn) return;
+    ErrorEvent e;
+    for (const Slot& s : s_slots) {
+        if (fill(s, e)) fn(e, ctx);
+    }
+}
+
+size_t error_ring_keys() {
+    size_t n = 0;
+    for (const Slot& s : s_slots) {
+        if (s.key.load(std::memory_order_relaxed) != kFree && s.count.load(std::memory_order_relaxed)) n++;
+    }
+    return n;
+}
+
+uint32_t error_ring_total() {
+    return s_total.load(std::memory_order_relaxed);
+}
+
+uint32_t error_ring_critical() {
+    return s_critical.load(std::memory_order_relaxed);
+}
+
+uint32_t error_ring_overflow() {
+    return s_overflow.load(std::memory_order_relaxed);
+}
+
+void error_ring_clear() {
+    clearIf([](const Slot&, uint32_t) { return true; });
+    s_total.store(0, std::memory_order_relaxed);
+    s_critical.store(0, std::memory_order_relaxed);
+    s_overflow.store(0, std::memory_order_relaxed);
+}
+
+void error_ring_clear_category(ErrorCategory category) {
+    const uint32_t cat = static_cast<uint32_t>(category) & 0xFF;
+    clearIf([cat](const Slot&, uint32_t key) { return ((key - 1) & 0xFF) == cat; });
+}
+
+void error_ring_clear_older(uint32_t olderThanMs) {
+    const uint32_t now = millis();
+    clearIf([now, olderThanMs](const Slot& s, uint32_t) {
+        return now - s.lastMs.load(std::memory_order_relaxed) > olderThanMs;
+    });
+}
+
+size_t error_ring_drain(Print& out) {
+    size_t lines = 0;
+    for (Slot& s : s_slots) {
+        if (s.key.load(std::memory_order_acquire) == kFree) continue;
+        const uint32_t emitted = s.emitted.load(std::memory_order_acquire);
+        if (emitted == s.printedEmitted) continue;
+        ErrorEvent e;
+        if (!fill(s, e)) continue;
+        const uint32_t repeats = e.count - s.printedCount;
+        const uint32_t dropped = repeats - (emitted - s.printedEmitted);
+        s.printedCount = e.count;
+        s.printedEmitted = emitted;
+
+        out.printf("[ERROR] %s/%s: %s", ErrorHandler::severityToString(e.severity),
+                   ErrorHandler::categoryToString(e.category), e.description);
+        if (e.context[0]) out.printf(" (Context: %s)", e.context);
+        if (repeats > 1) out.printf(" x%lu", (unsigned long)repeats);
+        if (dropped) out.printf(", %lu suppressed", (unsigned long)dropped);
+        out.println();
+        lines++;
+    }
+    return lines;
+}
+
+void error_ring_report(Print& out) {
+    const size_t n = error_ring_keys();
+    out.printf("Errors: %lu total, %lu critical, %u keys", (unsigned long)error_ring_total(),
+               (unsigned long)error_ring_critical(), (unsigned)n);
+    if (error_ring_overflow()) out.printf(", %lu lost to a full table", (unsigned long)error_ring_overflow());
+    out.println();
+    if (!n) return;
+    // Slot order; ErrorEvent is too big to snapshot the whole table on a task stack
+    out.println("  severity cat            count  suppr  first s   last s  text");
+    error_ring_foreach([](const ErrorEvent& e, void* ctx) {
+        static_cast<Print*>(ctx)->printf("  %-8s %-13s %6lu %6lu %8lu %8lu  %s\n",
+                                         ErrorHandler::severityToString(e.severity),
+                                         ErrorHandler::categoryToString(e.category), (unsigned long)e.count,
+                                         (unsigned long)e.suppressed, (unsigned long)(e.firstOccurrence / 1000),
+                                         (unsigned long)(e.timestamp / 1000), e.description);
+    }, &out);
+}
@@ -0,0 +1,71 @@
+/*
+ * Error Ring
+ * Lock-free store behind ErrorHandler::reportError() and the REPORT_* macros:
+ * one slot per (code, category) instead of one entry per occurrence.
+ *   - a repeat bumps the slot's counter, last-seen time and worst severity with
+ *     atomics; no mutex, no formatting, no Serial output on the caller's path
+ *   - per key, ERROR_RING_BURST occurrences are emitted back to back and then one
+ *     per ERROR_RING_REFILL_MS (a GCRA token bucket in one atomic); emitted ones
+ *     refresh the slot's text, the rest are only counted as suppressed
+ *   - a service job prints emitted occurrences to the console, with the repeats
+ *     and suppressions since the last line, so a flapping sensor costs one line
+ *     per interval rather than one per reading
+ *
+ * error_ring_record() (and REPORT_ERROR_ISR) is safe from ISRs that run with the
+ * flash cache on. Slots are claimed by compare-and-swap; a new key with the table
+ * full is counted in the overflow total. Clearing is for task context; a report
+ * racing a clear may be lost.
+ */
+
+#ifndef ERROR_RING_H
+#define ERROR_RING_H
+
+#include <Arduino.h>
+#include "../../include/error_handler.h"
+
+#ifndef ERROR_RING_SLOTS
+#define ERROR_RING_SLOTS 32                // distinct (code, category) keys
+#endif
+#ifndef ERROR_RING_BURST
+#define ERROR_RING_BURST 3                 // emitted back to back per key
+#endif
+#ifndef ERROR_RING_REFILL_MS
+#define ERROR_RING_REFILL_MS 10000         // then one more per key per interval
+#endif
+#ifndef ERROR_RING_DRAIN_MS
+#define ERROR_RING_DRAIN_MS 500
+#endif
+#define ERROR_RING_DRAIN_BUDGET_US 5000
+
+// Reports from an ISR: no singleton, no task handle
+#define REPORT_ERROR_ISR(code, severity, category, desc) \
+    error_ring_record(code, severity, category, desc, nullptr)
+
+// Schedules the console drain; idempotent
+bool error_ring_begin();
+
+// True when this occurrence was emitted, false when it was only counted
+bool error_ring_record(ErrorCode code, ErrorSeverity severity, ErrorCategory category, const char* description,
+                       const char* context);
+
+// Slots in use, oldest key first; severity is the worst seen, timestamp the last
+size_t error_ring_snapshot(ErrorEvent* out, size_t max);
+bool error_ring_find(ErrorCode code, ErrorCategory category, ErrorEvent& out);
+// Most recently seen key
+bool error_ring_last(ErrorEvent& out);
+// Calls fn for each key in use, in slot order; the event is on the caller's stack
+void error_ring_foreach(void (*fn)(const ErrorEvent& e, void* ctx), void* ctx);
+size_t error_ring_keys();
+uint32_t error_ring_total();              // every occurrence, suppressed ones included
+uint32_t error_ring_critical();           // CRITICAL and FATAL occurrences
+uint32_t error_ring_overflow();           // occurrences of keys that found no slot
+
+void error_ring_clear();
+void error_ring_clear_category(ErrorCategory category);
+void error_ring_clear_older(uint32_t olderThanMs);
+
+// Prints emitted occurrences not printed yet; returns the lines printed
+size_t error_ring_drain(Print& out);
+void error_ring_report(Print& out);
+
+#endif // ERROR_RING_H
@@ -0,0 +1,163 @@
+/*
+ * Event Bus Implementation
+ */
+
+#include "event_bus.h"
+
+namespace {
+static_assert((EVENT_BUS_RING & (EVENT_BUS_RING - 1)) == 0, "EVENT_BUS_RING must be a power of two");
+static_assert(static_cast<size_t>(EventTopic::Count) <= 32, "topic masks are 32 bits");
+constexpr size_t kTopics = static_cast<size_t>(EventTopic::Count);
+
+const char* const kTopicNames[kTopics] = {
+#define EVENT_TOPIC_NAME(topic, type) #topic,
+    EVENT_TOPICS(EVENT_TOPIC_NAME)
+#undef EVENT_TOPIC_NAME
+};
+
+struct Subscriber {
+    const char* name;
+    uint32_t mask;
+    TaskHandle_t task;
+    EventBusWakeFn wake;
+    void* ctx;
+    uint32_t head;               // next write
+    uint32_t tail;               // next read
+    uint32_t delivered;
+    uint32_t dropped;
+    BusEvent ring[EVENT_BUS_RING];
+};
+
+// Everything below under s_mux; publish copies a few dozen bytes per subscriber inside it
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Subscriber s_subs[EVENT_BUS_SUBSCRIBERS];
+uint8_t s_subCount = 0;
+BusEvent s_latest[kTopics];
+uint16_t s_seq[kTopics] = {};
+bool s_have[kTopics] = {};
+} // namespace
+
+size_t event_bus_publish_raw(EventTopic topic, const void* payload, size_t size) {
+    const size_t t = static_cast<size_t>(topic);
+    if (t >= kTopics || size > EVENT_BUS_PAYLOAD_BYTES || (size && !payload)) return 0;
+    BusEvent e;
+    e.topic = topic;
+    e.size = static_cast<uint8_t>(size);
+    e.ms = millis();
+    memset(e.payload, 0, sizeof(e.payload));
+    if (size) memcpy(e.payload, payload, size);
+
+    const uint32_t bit = 1UL << t;
+    uint32_t wake = 0;           // bit per subscriber
+    portENTER_CRITICAL(&s_mux);
+    e.seq = ++s_seq[t];
+    s_latest[t] = e;
+    s_have[t] = true;
+    for (uint8_t i = 0; i < s_subCount; i++) {
+        Subscriber& s = s_subs[i];
+        if (!(s.mask & bit)) continue;
+        if (s.head - s.tail >= EVENT_BUS_RING) {
+            s.tail++;
+            s.dropped++;
+        }
+        // Woken once per batch: a ring that already held events has a wake on its way
+        if (s.head == s.tail) wake |= 1UL << i;
+        s.ring[s.head & (EVENT_BUS_RING - 1)] = e;
+        s.head++;
+        s.delivered++;
+    }
+    const uint8_t count = s_subCount;
+    portEXIT_CRITICAL(&s_mux);
+
+    size_t reached = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (s_subs[i].mask & bit) reached++;
+        if (!(wake & (1UL << i))) continue;
+        const Subscriber& s = s_subs[i];
+        if (s.wake) {
+            s.wake(s.ctx);
+        } else if (s.task) {
+            xTaskNotifyGive(s.task);
+        }
+    }
+    return reached;
+}
+
+int event_bus_subscribe(const char* name, uint32_t topicMask, TaskHandle_t task, EventBusWakeFn wake, void* ctx) {
+    if (!topicMask) return EVENT_BUS_NONE;
+    if (!task && !wake) task = xTaskGetCurrentTaskHandle();
+    int id = EVENT_BUS_NONE;
+    portENTER_CRITICAL(&s_mux);
+    if (s_subCount < EVENT_BUS_SUBSCRIBERS) {
+        Subscriber& s = s_subs[s_subCount];
+        memset(&s, 0, sizeof(s));
+        s.name = name;
+        s.mask = topicMask;
+        s.task = task;
+        s.wake = wake;
+        s.ctx = ctx;
+        id = s_subCount++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return id;
+}
+
+bool event_bus_take(int id, BusEvent& out) {
+    if (id < 0 || id >= EVENT_BUS_SUBSCRIBERS) return false;
+    bool any = false;
+    portENTER_CRITICAL(&s_mux);
+    Subscriber& s = s_subs[id];
+    if (id < s_subCount && s.head != s.tail) {
+        out = s.ring[s.tail & (EVENT_BUS_RING - 1)];
+        s.tail++;
+        any = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return any;
+}
+
+bool event_bus_latest_raw(EventTopic topic, BusEvent& out) {
+    const size_t t = static_cast<size_t>(topic);
+    if (t >= kTopics) return false;
+    portENTER_CRITICAL(&s_mux);
+    const bool have = s_have[t];
+    if (have) out = s_latest[t];
+    portEXIT_CRITICAL(&s_mux);
+    return have;
+}
+
+const char* event_topic_name(EventTopic topic) {
+    const size_t t = static_cast<size_t>(topic);
+    return t < kTopics ? kTopicNames[t] : "?";
+}
+
+size_t event_bus_stats(EventBusSubscriberStats* out, size_t max) {
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < s_subCount && n < max; i++) {
+        const Subscriber& s = s_subs[i];
+        out[n++] = EventBusSubscriberStats{s.name, s.mask, s.delivered, s.dropped,
+                                           static_cast<uint8_t>(s.head - s.tail)};
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+void event_bus_report(Print& out) {
+    EventBusSubscriberStats subs[EVENT_BUS_SUBSCRIBERS];
+    const size_t n = event_bus_stats(subs, EVENT_BUS_SUBSCRIBERS);
+    out.printf("Event bus: %u subscribers, published", (unsigned)n);
+    for (size_t t = 0; t < kTopics; t++) {
+        portENTER_CRITICAL(&s_mux);
+        const uint16_t seq = s_seq[t];
+        portEXIT_CRITICAL(&s_mux);
+        out.printf(" %s %u", kTopicNames[t], (unsigned)seq);
+    }
+    out.println();
+    for (size_t i = 0; i < n; i++) {
+        const EventBusSubscriberStats& s = subs[i];
+        out.printf("  %-12s mask 0x%02lx, %lu delivered, %lu dropped, %u pending\n", s.name ? s.name : "?",
+                   (unsigned long)s.mask, (unsigned long)s.delivered, (unsigned long)s.dropped,
+                   (unsigned)s.pending);
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * Event Bus
+ * Typed publish/subscribe for cross-module signals, in place of volatile
+ * flags, event group bits nobody waits on and calls into the module that
+ * happens to know:
+ *   - topics and their payload types are one table (EVENT_TOPICS); a payload
+ *     is a small POD of at most EVENT_BUS_PAYLOAD_BYTES, copied by value, so
+ *     publishing never allocates
+ *   - each subscriber has its own ring of EVENT_BUS_RING events and a topic
+ *     mask; a publish copies the event into every matching ring and wakes the
+ *     subscriber once (task notification, or its own wake function for tasks
+ *     that sleep on something else). A full ring drops its oldest event and
+ *     counts it.
+ *   - the newest event of each topic is retained, so a module that only needs
+ *     the current state (is the link up?) reads it without subscribing
+ * Bulk data stays where it is: UI events, storage lines and the modem's
+ * seqlock snapshots keep their queues; the bus says that something changed
+ * and carries the few values a consumer decides on.
+ */
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#include <type_traits>
+
+#ifndef EVENT_BUS_SUBSCRIBERS
+#define EVENT_BUS_SUBSCRIBERS 8
+#endif
+#ifndef EVENT_BUS_RING
+#define EVENT_BUS_RING 8                 // events per subscriber; power of two
+#endif
+#define EVENT_BUS_PAYLOAD_BYTES 12
+#define EVENT_BUS_NONE (-1)
+
+// Heap state, from the memory monitor's thresholds
+enum class HeapLevel : uint8_t { Normal, Low, Critical };
+
+struct CellularLinkEvent {
+    bool up;                     // attached with a PDP context
+};
+
+struct CellularStatusEvent {
+    bool connected;
+    int8_t rssiDbm;              // 0 when not connected
+};
+
+struct GnssEvent {
+    int32_t latE7;               // degrees x 1e7
+    int32_t lonE7;
+    uint8_t satellites;
+    bool fix;
+    bool newFix;                 // a fix not published before
+};
+
+struct HeapLowEvent {
+    HeapLevel level;
+    uint32_t freeBytes;
+};
+
+// Topic, payload type
+#define EVENT_TOPICS(X)                           \
+    X(CellularLink, CellularLinkEvent)            \
+    X(CellularStatus, CellularStatusEvent)        \
+    X(Gnss, GnssEvent)                            \
+    X(HeapLow, HeapLowEvent)
+
+enum class EventTopic : uint8_t {
+#define EVENT_TOPIC_ID(topic, type) topic,
+    EVENT_TOPICS(EVENT_TOPIC_ID)
+#undef EVENT_TOPIC_ID
+    Count
+};
+
+#define EVENT_TOPIC_BIT(t) (1UL << static_cast<uint8_t>(EventTopic::t))
+
+struct BusEvent {
+    EventTopic topic;
+    uint8_t size;
+    uint16_t seq;                // per topic, wraps
+    uint32_t ms;                 // millis() at publish
+    uint8_t payload[EVENT_BUS_PAYLOAD_BYTES];
+};
+
+template <EventTopic T>
+struct EventPayload;
+#define EVENT_TOPIC_TYPE(topic, type)                                                              \
+    template <>                                                                                    \
+    struct EventPayload<EventTopic::topic> {                                                       \
+        typedef type Type;                                                                         \
+        static_assert(sizeof(type) <= EVENT_BUS_PAYLOAD_BYTES, #type " is too large for the bus"); \
+        static_assert(std::is_trivially_copyable<type>::value, #type " must be POD");              \
+    };
+EVENT_TOPICS(EVENT_TOPIC_TYPE)
+#undef EVENT_TOPIC_TYPE
+
+// Wakes a subscriber that does not sleep on its task notification; any task
+typedef void (*EventBusWakeFn)(void* ctx);
+
+struct EventBusSubscriberStats {
+    const char* name;
+    uint32_t mask;
+    uint32_t delivered;
+    uint32_t dropped;            // ring full, oldest overwritten
+    uint8_t pending;
+};
+
+// Publishes to every subscriber of the topic; any task, not from ISRs.
+// Returns the number of subscribers it reached.
+size_t event_bus_publish_raw(EventTopic topic, const void* payload, size_t size);
+
+template <EventTopic T>
+inline size_t event_bus_publish(const typename EventPayload<T>::Type& payload) {
+    return event_bus_publish_raw(T, &payload, sizeof(payload));
+}
+
+// task is woken with xTaskNotifyGive() (nullptr: the calling task), or wake is
+// called instead when given. name must be a string literal. Returns the
+// subscriber id, EVENT_BUS_NONE when the table is full.
+int event_bus_subscribe(const char* name, uint32_t topicMask, TaskHandle_t task = nullptr,
+                        EventBusWakeFn wake = nullptr, void* ctx = nullptr);
+// The subscriber's owner only: the oldest pending event, false when there is
+// none. Drain until false after each wake: no new wake comes while events wait.
+bool event_bus_take(int id, BusEvent& out);
+
+// The newest event published on the topic; false before the first
+bool event_bus_latest_raw(EventTopic topic, BusEvent& out);
+
+template <EventTopic T>
+inline bool event_payload(const BusEvent& e, typename EventPayload<T>::Type& out) {
+    if (e.topic != T || e.size != sizeof(out)) return false;
+    memcpy(&out, e.payload, sizeof(out));
+    return true;
+}
+
+template <EventTopic T>
+inline bool event_bus_latest(typename EventPayload<T>::Type& out) {
+    BusEvent e;
+    return event_bus_latest_raw(T, e) && event_payload<T>(e, out);
+}
+
+const char* event_topic_name(EventTopic topic);
+size_t event_bus_stats(EventBusSubscriberStats* out, size_t max);
+void event_bus_report(Print& out);
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,527 @@
+/*
+ * Heap Allocation Profiler Implementation
+ */
+
+#include "heap_profiler.h"
+
+#if HEAP_PROFILE_ENABLE
+
+#include "task_heap.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#if ENABLE_SD
+#include <SD.h>
+#include "../modules/storage/storage_task.h"
+#endif
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+void* __real_heap_caps_malloc(size_t size, uint32_t caps);
+void* __real_heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void* __real_heap_caps_realloc(void* ptr, size_t size, uint32_t caps);
+void __real_heap_caps_free(void* ptr);
+}
+
+namespace {
+static_assert((HEAP_PROFILE_SITES & (HEAP_PROFILE_SITES - 1)) == 0 && HEAP_PROFILE_SITES <= 256,
+              "HEAP_PROFILE_SITES must be a power of two up to 256");
+static_assert(TASK_HEAP_SLOTS <= 16, "Live::task holds 4 bits");
+static_assert((HEAP_PROFILE_LIVE_SLOTS & (HEAP_PROFILE_LIVE_SLOTS - 1)) == 0,
+              "HEAP_PROFILE_LIVE_SLOTS must be a power of two");
+
+constexpr uint8_t kOtherSite = 0;   // slot 0 collects what the site table cannot hold
+constexpr uint32_t kLiveMask = HEAP_PROFILE_LIVE_SLOTS - 1;
+constexpr uint32_t kLifetimeLimitMs[HEAP_PROFILE_LIFETIME_BUCKETS - 1] = {
+    100, 1000, 10000, 60000, 600000, 3600000};
+const char* const kLifetimeLabels[HEAP_PROFILE_LIFETIME_BUCKETS] = {
+    "<100ms", "<1s", "<10s", "<1m", "<10m", "<1h", ">=1h"};
+
+struct Site {
+    uint32_t pc;              // caller; 0 = unused slot
+    const void* owner;        // task handle or scope tag
+    char name[12];
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+    uint32_t liveBlocks;
+    uint32_t liveBytes;
+    uint32_t peakLiveBytes;
+    uint32_t maxRequest;
+    uint32_t lifetime[HEAP_PROFILE_LIFETIME_BUCKETS];
+};
+
+struct Live {
+    uintptr_t ptr;            // 0 = empty slot
+    uint32_t bornMs;
+    uint32_t size : 20;
+    uint32_t site : 8;
+    uint32_t task : 4;        // task_heap.h slot charged for the block
+};
+
+struct Scope {
+    TaskHandle_t task;
+    const char* tag;
+};
+
+struct Owner {
+    const void* key;
+    const char* name;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Site s_sites[HEAP_PROFILE_SITES];
+Live s_live[HEAP_PROFILE_LIVE_SLOTS];
+Scope s_scopes[HEAP_PROFILE_SCOPE_TASKS];
+HeapProfileTotals s_totals;
+HeapProfileSample s_timeline[HEAP_PROFILE_TIMELINE];
+uint8_t s_timelineHead = 0;    // next sample slot
+uint8_t s_timelineCount = 0;
+uint32_t s_lastSampleMs = 0;
+uint32_t s_lastSaveMs = 0;
+bool s_sampled = false;
+
+// Report scratch, used by one reporting task at a time
+uint8_t s_order[HEAP_PROFILE_SITES];
+uint32_t s_oldestMs[HEAP_PROFILE_SITES];
+
+// Xtensa return addresses carry the window size in the top two bits
+inline uint32_t callerPc(void* ra) {
+    return (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ra)) & 0x3FFFFFFFu) | 0x40000000u;
+}
+
+inline uint32_t liveHome(uintptr_t ptr) {
+    return static_cast<uint32_t>((ptr >> 3) * 2654435761u) >> 8 & kLiveMask;
+}
+
+Owner currentOwner() {
+    if (xPortInIsrContext()) {
+        return Owner{"isr", "isr"};
+    }
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return Owner{"boot", "boot"};
+    }
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (const Scope& s : s_scopes) {
+        if (s.task == task && s.tag) {
+            return Owner{s.tag, s.tag};
+        }
+    }
+    return Owner{task, pcTaskGetName(task)};
+}
+
+// Under s_mux
+uint8_t findSite(uint32_t pc, const Owner& owner) {
+    const uint32_t h = (pc ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(owner.key))) * 2654435761u;
+    uint32_t i = h % (HEAP_PROFILE_SITES - 1) + 1;
+    for (uint32_t n = 1; n < HEAP_PROFILE_SITES; n++) {
+        Site& s = s_sites[i];
+        if (s.pc == pc && s.owner == owner.key) {
+            return static_cast<uint8_t>(i);
+        }
+        if (s.pc == 0) {
+            s.pc = pc;
+            s.owner = owner.key;
+            strncpy(s.name, owner.name ? owner.name : "?", sizeof(s.name) - 1);
+            s.name[sizeof(s.name) - 1] = '\0';
+            return static_cast<uint8_t>(i);
+        }
+        i = i + 1 < HEAP_PROFILE_SITES ? i + 1 : 1;
+    }
+    s_totals.siteOverflow++;
+    return kOtherSite;
+}
+
+// Under s_mux
+int findLive(uintptr_t ptr) {
+    for (uint32_t i = liveHome(ptr), n = 0; n < HEAP_PROFILE_LIVE_SLOTS; i = (i + 1) & kLiveMask, n++) {
+        if (s_live[i].ptr == ptr) return static_cast<int>(i);
+        if (s_live[i].ptr == 0) return -1;
+    }
+    return -1;
+}
+
+// Under s_mux. Linear-probing delete: later entries of the run shift into the hole.
+void removeLive(int slot) {
+    uint32_t hole = static_cast<uint32_t>(slot);
+    uint32_t j = hole;
+    for (;;) {
+        j = (j + 1) & kLiveMask;
+        if (s_live[j].ptr == 0) break;
+        const uint32_t home = liveHome(s_live[j].ptr);
+        const bool stays = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+        if (!stays) {
+            s_live[hole] = s_live[j];
+            hole = j;
+        }
+    }
+    s_live[hole].ptr = 0;
+}
+
+// Under s_mux; keeps one slot empty so probes terminate
+bool insertLive(const Live& rec) {
+    if (s_totals.liveBlocks + 1 >= HEAP_PROFILE_LIVE_SLOTS) {
+        return false;
+    }
+    uint32_t i = liveHome(rec.ptr);
+    while (s_live[i].ptr != 0) {
+        i = (i + 1) & kLiveMask;
+    }
+    s_live[i] = rec;
+    return true;
+}
+
+uint8_t lifetimeBucket(uint32_t ageMs) {
+    uint8_t b = 0;
+    while (b < HEAP_PROFILE_LIFETIME_BUCKETS - 1 && ageMs >= kLifetimeLimitMs[b]) b++;
+    return b;
+}
+
+// Under s_mux
+void chargeLive(const Live& rec) {
+    Site& s = s_sites[rec.site];
+    s.liveBlocks++;
+    s.liveBytes += rec.size;
+    if (s.liveBytes > s.peakLiveBytes) s.peakLiveBytes = s.liveBytes;
+    s_totals.liveBlocks++;
+    s_totals.liveBytes += rec.size;
+}
+
+// taskSlot is what task_heap_admit() returned; the task's reservation is dropped
+// when the allocation failed or the block cannot be tracked
+void recordAlloc(void* ptr, size_t size, uint32_t pc, uint8_t taskSlot) {
+    const Owner owner = currentOwner();
+    bool tracked = false;
+    const uint32_t now = millis();
+    portENTER_CRITICAL_SAFE(&s_mux);
+    const uint8_t site = findSite(pc, owner);
+    Site& s = s_sites[site];
+    s.allocs++;
+    s_totals.allocs++;
+    if (size > s.maxRequest) s.maxRequest = size;
+    if (!ptr) {
+        s.failures++;
+        s_totals.failures++;
+    } else {
+        Live rec;
+        rec.ptr = reinterpret_cast<uintptr_t>(ptr);
+        rec.bornMs = now;
+        rec.size = size > 0xFFFFFu ? 0xFFFFFu : size;
+        rec.site = site;
+        rec.task = taskSlot;
+        tracked = insertLive(rec);
+        if (tracked) {
+            chargeLive(rec);
+        } else {
+            s_totals.untracked++;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&s_mux);
+    if (!tracked && taskSlot != TASK_HEAP_DENIED) {
+        task_heap_release(taskSlot, size);
+    }
+}
+
+// Removes ptr's record (before the block goes back to the heap); false when untracked
+bool takeLive(void* ptr, Live& out) {
+    if (!ptr) return false;
+    const uint32_t now = millis();
+    portENTER_CRITICAL_SAFE(&s_mux);
+    const int slot = findLive(reinterpret_cast<uintptr_t>(ptr));
+    if (slot < 0) {
+        portEXIT_CRITICAL_SAFE(&s_mux);
+        return false;
+    }
+    out = s_live[slot];
+    removeLive(slot);
+    Site& s = s_sites[out.site];
+    s.frees++;
+    s.liveBlocks--;
+    s.liveBytes -= out.size;
+    s_totals.frees++;
+    s_totals.liveBlocks--;
+    s_totals.liveBytes -= out.size;
+    s.lifetime[lifetimeBucket(now - out.bornMs)]++;
+    portEXIT_CRITICAL_SAFE(&s_mux);
+    task_heap_release(out.task, out.size);
+    return true;
+}
+
+// A failed realloc leaves the old block in place: put its record back
+void restoreLive(const Live& rec) {
+    const uint32_t now = millis();
+    portENTER_CRITICAL_SAFE(&s_mux);
+    Site& s = s_sites[rec.site];
+    s.frees--;
+    s.lifetime[lifetimeBucket(now - rec.bornMs)]--;
+    s_totals.frees--;
+    const bool tracked = insertLive(rec);
+    if (tracked) {
+        chargeLive(rec);
+    }
+    portEXIT_CRITICAL_SAFE(&s_mux);
+    if (tracked) {
+        task_heap_charge(rec.task, rec.size);
+    }
+}
+
+// Budget check, allocation and bookkeeping around one allocator call
+template <typename Alloc>
+void* profiledAlloc(size_t size, uint32_t pc, Alloc alloc) {
+    const uint8_t taskSlot = task_heap_admit(size);
+    void* p = taskSlot == TASK_HEAP_DENIED ? nullptr : alloc();
+    recordAlloc(p, size, pc, taskSlot);
+    return p;
+}
+
+// The old block is credited first so a task can shrink or regrow within budget;
+// on failure it stays where it was and is charged again
+template <typename Resize>
+void* profiledRealloc(void* ptr, size_t size, uint32_t pc, Resize resize) {
+    Live old;
+    const bool had = takeLive(ptr, old);
+    if (ptr && size == 0) {
+        return resize();   // frees
+    }
+    const uint8_t taskSlot = task_heap_admit(size);
+    void* p = taskSlot == TASK_HEAP_DENIED ? nullptr : resize();
+    if (!p && had) {
+        restoreLive(old);
+    }
+    recordAlloc(p, size, pc, taskSlot);
+    return p;
+}
+
+void printSite(Print& out, const Site& s, uint32_t oldestAgeS) {
+    out.printf("%-11s 0x%08lx %7lu %7lu %4lu %5lu %7lu %7lu %6lu",
+               s.name, static_cast<unsigned long>(s.pc), static_cast<unsigned long>(s.allocs),
+               static_cast<unsigned long>(s.frees), static_cast<unsigned long>(s.failures),
+               static_cast<unsigned long>(s.liveBlocks), static_cast<unsigned long>(s.liveBytes),
+               static_cast<unsigned long>(s.peakLiveBytes), static_cast<unsigned long>(s.maxRequest));
+    for (uint32_t n : s.lifetime) {
+        out.printf(" %6lu", static_cast<unsigned long>(n));
+    }
+    out.printf(" %7lu\n", static_cast<unsigned long>(oldestAgeS));
+}
+} // namespace
+
+// ============================================================================
+// LINKER WRAPPERS
+// ============================================================================
+extern "C" {
+
+void* __wrap_malloc(size_t size) {
+    return profiledAlloc(size, callerPc(__builtin_return_address(0)), [&] { return __real_malloc(size); });
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    return profiledAlloc(n * size, callerPc(__builtin_return_address(0)), [&] { return __real_calloc(n, size); });
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    return profiledRealloc(ptr, size, callerPc(__builtin_return_address(0)),
+                           [&] { return __real_realloc(ptr, size); });
+}
+
+void __wrap_free(void* ptr) {
+    Live old;
+    takeLive(ptr, old);
+    __real_free(ptr);
+}
+
+void* __wrap_heap_caps_malloc(size_t size, uint32_t caps) {
+    return profiledAlloc(size, callerPc(__builtin_return_address(0)),
+                         [&] { return __real_heap_caps_malloc(size, caps); });
+}
+
+void* __wrap_heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return profiledAlloc(n * size, callerPc(__builtin_return_address(0)),
+                         [&] { return __real_heap_caps_calloc(n, size, caps); });
+}
+
+void* __wrap_heap_caps_realloc(void* ptr, size_t size, uint32_t caps) {
+    return profiledRealloc(ptr, size, callerPc(__builtin_return_address(0)),
+                           [&] { return __real_heap_caps_realloc(ptr, size, caps); });
+}
+
+void __wrap_heap_caps_free(void* ptr) {
+    Live old;
+    takeLive(ptr, old);
+    __real_heap_caps_free(ptr);
+}
+
+} // extern "C"
+
+// ============================================================================
+// SCOPES
+// ============================================================================
+HeapProfileScope::HeapProfileScope(const char* tag) : prev_(nullptr) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&s_mux);
+    Scope* freeSlot = nullptr;
+    Scope* mine = nullptr;
+    for (Scope& s : s_scopes) {
+        if (s.task == task) mine = &s;
+        if (!s.task && !freeSlot) freeSlot = &s;
+    }
+    if (mine) {
+        prev_ = mine->tag;
+        mine->tag = tag;
+    } else if (freeSlot) {
+        freeSlot->task = task;
+        freeSlot->tag = tag;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+HeapProfileScope::~HeapProfileScope() {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    portENTER_CRITICAL(&s_mux);
+    for (Scope& s : s_scopes) {
+        if (s.task == task) {
+            s.tag = prev_;
+            if (!prev_) s.task = nullptr;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// ============================================================================
+// TIMELINE AND REPORTS
+// ============================================================================
+void heap_profile_poll(uint32_t now) {
+    if (!s_sampled || now - s_lastSampleMs >= HEAP_PROFILE_SAMPLE_MS) {
+        HeapProfileSample sample;
+        sample.uptimeS = now / 1000;
+        sample.freeBytes = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+        sample.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+        sample.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+        sample.fragPercent = sample.freeBytes
+            ? static_cast<uint8_t>(100 - static_cast<uint64_t>(sample.largestBlock) * 100 / sample.freeBytes)
+            : 0;
+        portENTER_CRITICAL(&s_mux);
+        sample.liveBlocks = static_cast<uint16_t>(s_totals.liveBlocks);
+        s_timeline[s_timelineHead] = sample;
+        s_timelineHead = (s_timelineHead + 1) % HEAP_PROFILE_TIMELINE;
+        if (s_timelineCount < HEAP_PROFILE_TIMELINE) s_timelineCount++;
+        portEXIT_CRITICAL(&s_mux);
+        s_lastSampleMs = now;
+        if (!s_sampled) s_lastSaveMs = now;
+        s_sampled = true;
+    }
+    if (HEAP_PROFILE_SAVE_MS > 0 && now - s_lastSaveMs >= HEAP_PROFILE_SAVE_MS) {
+        s_lastSaveMs = now;
+        heap_profile_save();
+    }
+}
+
+void heap_profile_report(Print& out, size_t maxSites) {
+    const uint32_t now = millis();
+
+    // Order sites by live bytes and find each site's oldest live block
+    portENTER_CRITICAL(&s_mux);
+    const HeapProfileTotals totals = s_totals;
+    size_t count = 0;
+    for (size_t i = 0; i < HEAP_PROFILE_SITES; i++) {
+        s_oldestMs[i] = now;
+        if (!s_sites[i].allocs && !s_sites[i].liveBlocks) continue;
+        size_t j = count++;
+        while (j > 0 && s_sites[s_order[j - 1]].liveBytes < s_sites[i].liveBytes) {
+            s_order[j] = s_order[j - 1];
+            j--;
+        }
+        s_order[j] = static_cast<uint8_t>(i);
+    }
+    for (const Live& l : s_live) {
+        if (l.ptr && now - l.bornMs > now - s_oldestMs[l.site]) s_oldestMs[l.site] = l.bornMs;
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    out.printf("heap profile: up %lus, allocs %lu, frees %lu, failures %lu, live %lu blocks / %lu B, untracked %lu, site overflow %lu\n",
+               static_cast<unsigned long>(now / 1000), static_cast<unsigned long>(totals.allocs),
+               static_cast<unsigned long>(totals.frees), static_cast<unsigned long>(totals.failures),
+               static_cast<unsigned long>(totals.liveBlocks), static_cast<unsigned long>(totals.liveBytes),
+               static_cast<unsigned long>(totals.untracked), static_cast<unsigned long>(totals.siteOverflow));
+    out.printf("%-11s %-10s %7s %7s %4s %5s %7s %7s %6s", "owner", "pc", "allocs", "frees", "fail",
+               "live", "liveB", "peakB", "maxReq");
+    for (const char* label : kLifetimeLabels) {
+        out.printf(" %6s", label);
+    }
+    out.printf(" %7s\n", "oldestS");
+
+    if (maxSites == 0 || maxSites > count) maxSites = count;
+    for (size_t n = 0; n < maxSites; n++) {
+        const uint8_t i = s_order[n];
+        portENTER_CRITICAL(&s_mux);
+        Site site = s_sites[i];
+        portEXIT_CRITICAL(&s_mux);
+        if (i == kOtherSite) strcpy(site.name, "other");
+        printSite(out, site, (now - s_oldestMs[i]) / 1000);
+    }
+    if (maxSites < count) {
+        out.printf("(%u more sites)\n", static_cast<unsigned>(count - maxSites));
+    }
+
+    out.printf("timeline: uptimeS freeB largestB minFreeB frag%% liveBlocks\n");
+    for (uint8_t n = 0; n < s_timelineCount; n++) {
+        portENTER_CRITICAL(&s_mux);
+        const uint8_t idx = (s_timelineHead + HEAP_PROFILE_TIMELINE - s_timelineCount + n) % HEAP_PROFILE_TIMELINE;
+        const HeapProfileSample s = s_timeline[idx];
+        portEXIT_CRITICAL(&s_mux);
+        out.printf("%lu %lu %lu %lu %u %u\n", static_cast<unsigned long>(s.uptimeS),
+                   static_cast<unsigned long>(s.freeBytes), static_cast<unsigned long>(s.largestBlock),
+                   static_cast<unsigned long>(s.minFreeBytes), static_cast<unsigned>(s.fragPercent),
+                   static_cast<unsigned>(s.liveBlocks));
+    }
+}
+
+bool heap_profile_save(const char* path) {
+#if ENABLE_SD
+    if (!path) return false;
+    // Null until the storage task starts
+    if (g_sdMutex && xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS)) != pdTRUE) {
+        return false;
+    }
+    File f = SD.open(path, FILE_WRITE);
+    const bool ok = static_cast<bool>(f);
+    if (ok) {
+        heap_profile_report(f);
+        f.close();
+    }
+    if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+HeapProfileTotals heap_profile_totals() {
+    portENTER_CRITICAL(&s_mux);
+    const HeapProfileTotals out = s_totals;
+    portEXIT_CRITICAL(&s_mux);
+    return out;
+}
+
+void heap_profile_reset() {
+    portENTER_CRITICAL(&s_mux);
+    for (Site& s : s_sites) {
+        s.allocs = s.frees = s.failures = 0;
+        s.peakLiveBytes = s.liveBytes;
+        s.maxRequest = 0;
+        memset(s.lifetime, 0, sizeof(s.lifetime));
+    }
+    s_totals.allocs = s_totals.frees = s_totals.failures = 0;
+    s_totals.untracked = s_totals.siteOverflow = 0;
+    s_timelineHead = 0;
+    s_timelineCount = 0;
+    portEXIT_CRITICAL(&s_mux);
+    s_sampled = false;
+}
+
+#endif // HEAP_PROFILE_ENABLE
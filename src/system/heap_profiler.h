@@ -0,0 +1,119 @@
+/*
+ * Heap Allocation Profiler
+ * Opt-in accounting of every heap allocation, for finding what fragments the
+ * heap on units that run for weeks.
+ *   - per call site (caller PC plus owner: the task, or a HEAP_PROFILE_SCOPE tag):
+ *     allocations, frees, failures, live and peak bytes, largest request, and a
+ *     lifetime histogram filled when blocks are freed
+ *   - a timeline of free heap, largest free block and fragmentation, sampled
+ *     every HEAP_PROFILE_SAMPLE_MS
+ *   - a compact text report to any Print (Serial, an SD File)
+ * Everything lives in fixed tables; the hooks never allocate and never log.
+ *
+ * Build with HEAP_PROFILE_ENABLE=1 and these linker flags, which route the
+ * malloc family and the heap_caps_* entry points through the hooks:
+ *   -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc -Wl,--wrap=free
+ *   -Wl,--wrap=heap_caps_malloc -Wl,--wrap=heap_caps_calloc
+ *   -Wl,--wrap=heap_caps_realloc -Wl,--wrap=heap_caps_free
+ * operator new and Arduino String reach malloc from inside the libraries, so
+ * their sites share one PC; the owner column tells them apart, and
+ * HEAP_PROFILE_SCOPE narrows it further.
+ *
+ * The same hooks enforce the per-task heap budgets (task_heap.h).
+ *
+ * Decode a site with: xtensa-esp32s3-elf-addr2line -pfiaC -e firmware.elf <pc>
+ */
+
+#ifndef HEAP_PROFILER_H
+#define HEAP_PROFILER_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef HEAP_PROFILE_SITES
+#define HEAP_PROFILE_SITES 64              // distinct call sites (power of two); extra sites pool in "other"
+#endif
+#ifndef HEAP_PROFILE_LIVE_SLOTS
+#define HEAP_PROFILE_LIVE_SLOTS 512        // tracked live blocks (power of two), 12 bytes each
+#endif
+#ifndef HEAP_PROFILE_TIMELINE
+#define HEAP_PROFILE_TIMELINE 48           // fragmentation samples kept
+#endif
+#ifndef HEAP_PROFILE_SAMPLE_MS
+#define HEAP_PROFILE_SAMPLE_MS (30UL * 60UL * 1000UL)   // 48 samples = one day
+#endif
+#ifndef HEAP_PROFILE_SAVE_MS
+#define HEAP_PROFILE_SAVE_MS (60UL * 60UL * 1000UL)     // SD report period; 0 = never
+#endif
+#ifndef HEAP_PROFILE_REPORT_PATH
+#define HEAP_PROFILE_REPORT_PATH "/data/heap_profile.txt"
+#endif
+#define HEAP_PROFILE_SCOPE_TASKS 8         // tasks with a scope tag active at once
+
+// Lifetime buckets: <100 ms, <1 s, <10 s, <1 min, <10 min, <1 h, longer
+#define HEAP_PROFILE_LIFETIME_BUCKETS 7
+
+struct HeapProfileSample {
+    uint32_t uptimeS;
+    uint32_t freeBytes;
+    uint32_t largestBlock;
+    uint32_t minFreeBytes;
+    uint16_t liveBlocks;     // tracked blocks at the sample
+    uint8_t fragPercent;     // 100 - largest * 100 / free
+};
+
+struct HeapProfileTotals {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;
+    uint32_t liveBlocks;
+    uint32_t liveBytes;
+    uint32_t untracked;      // live table full; these blocks are not attributed
+    uint32_t siteOverflow;   // allocations charged to "other"
+};
+
+#if HEAP_PROFILE_ENABLE
+
+// Attributes allocations by the calling task to tag while in scope. tag must be
+// a string literal (or otherwise outlive the profile).
+class HeapProfileScope {
+public:
+    explicit HeapProfileScope(const char* tag);
+    ~HeapProfileScope();
+    HeapProfileScope(const HeapProfileScope&) = delete;
+    HeapProfileScope& operator=(const HeapProfileScope&) = delete;
+
+private:
+    const char* prev_;
+};
+
+#define HEAP_PROFILE_SCOPE_CAT2(a, b) a##b
+#define HEAP_PROFILE_SCOPE_CAT(a, b) HEAP_PROFILE_SCOPE_CAT2(a, b)
+#define HEAP_PROFILE_SCOPE(tag) HeapProfileScope HEAP_PROFILE_SCOPE_CAT(heapScope_, __LINE__)(tag)
+
+// Takes a timeline sample when HEAP_PROFILE_SAMPLE_MS has passed and writes the
+// SD report every HEAP_PROFILE_SAVE_MS. Call periodically from one task.
+void heap_profile_poll(uint32_t now);
+
+// Sites ordered by live bytes, then the timeline. maxSites 0 = all.
+void heap_profile_report(Print& out, size_t maxSites = 0);
+// Writes the full report to path; takes g_sdMutex when the storage task is up
+bool heap_profile_save(const char* path = HEAP_PROFILE_REPORT_PATH);
+
+HeapProfileTotals heap_profile_totals();
+// Clears the site counters and the timeline; live blocks stay tracked
+void heap_profile_reset();
+
+#else
+
+#define HEAP_PROFILE_SCOPE(tag) do {} while (0)
+
+inline void heap_profile_poll(uint32_t) {}
+inline void heap_profile_report(Print&, size_t = 0) {}
+inline bool heap_profile_save(const char* = nullptr) { return false; }
+inline HeapProfileTotals heap_profile_totals() { return HeapProfileTotals{}; }
+inline void heap_profile_reset() {}
+
+#endif // HEAP_PROFILE_ENABLE
+
+#endif // HEAP_PROFILER_H
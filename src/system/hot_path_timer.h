@@ -0,0 +1,58 @@
+/*
+ * Hot Path Timers
+ * HOT_PATH_TIMER("name") times the rest of the enclosing scope with the CPU
+ * cycle counter (CCOUNT, one register read at each end) and records it in us
+ * into a MetricHistogram of that name (metrics.h): count, total, max and the
+ * log4 buckets, exported with the rest of the registry.
+ *   - one histogram per call site, a function static that registers the
+ *     first time the site runs; give every site its own name
+ *   - CCOUNT is per core: a region that ends on the other core than it began
+ *     on is not recorded. The counter also stops in light sleep, and a DFS
+ *     frequency change inside the region skews that sample (power_manager.h)
+ *   - with HOT_PATH_TIMER_ENABLE 0 (or METRICS_ENABLE 0) the macro expands
+ *     to nothing
+ */
+
+#ifndef HOT_PATH_TIMER_H
+#define HOT_PATH_TIMER_H
+
+#include "../config/system_config.h"
+
+#if HOT_PATH_TIMER_ENABLE && METRICS_ENABLE
+
+#include "metrics.h"
+#include <esp_cpu.h>
+#include <esp_rom_sys.h>
+
+class HotPathTimer {
+public:
+    explicit HotPathTimer(MetricHistogram& site)
+        : site_(site), start_(esp_cpu_get_cycle_count()), core_(xPortGetCoreID()) {}
+    ~HotPathTimer() {
+        const uint32_t cycles = static_cast<uint32_t>(esp_cpu_get_cycle_count()) - start_;
+        if (xPortGetCoreID() != core_) return;
+        site_.record(cycles / esp_rom_get_cpu_ticks_per_us());
+    }
+
+private:
+    HotPathTimer(const HotPathTimer&);
+    HotPathTimer& operator=(const HotPathTimer&);
+
+    MetricHistogram& site_;
+    uint32_t start_;
+    BaseType_t core_;
+};
+
+#define HOT_PATH_TIMER_CAT2(a, b) a##b
+#define HOT_PATH_TIMER_CAT(a, b) HOT_PATH_TIMER_CAT2(a, b)
+#define HOT_PATH_TIMER(name)                                                              \
+    static MetricHistogram HOT_PATH_TIMER_CAT(hotPathSite_, __LINE__)(name);              \
+    HotPathTimer HOT_PATH_TIMER_CAT(hotPathTimer_, __LINE__)(HOT_PATH_TIMER_CAT(hotPathSite_, __LINE__))
+
+#else
+
+#define HOT_PATH_TIMER(name) do {} while (0)
+
+#endif // HOT_PATH_TIMER_ENABLE && METRICS_ENABLE
+
+#endif // HOT_PATH_TIMER_H
@@ -0,0 +1,296 @@
+/*
+ * Streaming JSON Writer Implementation
+ */
+
+#include "json_writer.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+const uint64_t kPow10[JSON_WRITER_MAX_DECIMALS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+};
+constexpr double kMaxScaled = 9.0e18;    // below INT64_MAX
+
+const char kHex[] = "0123456789abcdef";
+} // namespace
+
+JsonWriter::JsonWriter(char* buf, size_t capacity) : buf_(buf), cap_(buf ? capacity : 0) {}
+
+JsonWriter::JsonWriter(Print& out, char* chunk, size_t chunkSize)
+    : buf_(chunk), cap_(chunk ? chunkSize : 0), out_(&out) {}
+
+void JsonWriter::drain() {
+    if (out_ && len_) {
+        out_->write(reinterpret_cast<const uint8_t*>(buf_), len_);
+        drained_ += len_;
+        len_ = 0;
+    }
+}
+
+void JsonWriter::put(char c) {
+    if (failed_) return;
+    if (len_ == cap_) {
+        drain();
+        if (len_ == cap_) {
+            failed_ = true;
+            return;
+        }
+    }
+    buf_[len_++] = c;
+}
+
+void JsonWriter::put(const char* s, size_t n) {
+    while (n && !failed_) {
+        if (len_ == cap_) {
+            drain();
+            if (len_ == cap_) {
+                failed_ = true;
+                return;
+            }
+        }
+        const size_t room = cap_ - len_;
+        const size_t k = n < room ? n : room;
+        memcpy(buf_ + len_, s, k);
+        len_ += k;
+        s += k;
+        n -= k;
+    }
+}
+
+void JsonWriter::putString(const char* s) {
+    put('"');
+    const char* run = s;
+    for (; *s; s++) {
+        const unsigned char c = static_cast<unsigned char>(*s);
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        put(run, s - run);
+        run = s + 1;
+        char esc[6] = {'\\', 0, 0, 0, 0, 0};
+        size_t n = 2;
+        switch (c) {
+            case '"': esc[1] = '"'; break;
+            case '\\': esc[1] = '\\'; break;
+            case '\n': esc[1] = 'n'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\t': esc[1] = 't'; break;
+            default:
+                esc[1] = 'u';
+                esc[2] = '0';
+                esc[3] = '0';
+                esc[4] = kHex[c >> 4];
+                esc[5] = kHex[c & 0xF];
+                n = 6;
+                break;
+        }
+        put(esc, n);
+    }
+    put(run, s - run);
+    put('"');
+}
+
+void JsonWriter::putUnsigned(unsigned long long v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[sizeof(tmp) - ++n] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v);
+    put(tmp + sizeof(tmp) - n, n);
+}
+
+void JsonWriter::putSigned(long long v) {
+    if (v < 0) {
+        put('-');
+        // Negate in unsigned: -LLONG_MIN overflows
+        putUnsigned(0ULL - static_cast<unsigned long long>(v));
+    } else {
+        putUnsigned(static_cast<unsigned long long>(v));
+    }
+}
+
+void JsonWriter::putFixed(double v, uint8_t decimals) {
+    if (decimals > JSON_WRITER_MAX_DECIMALS) decimals = JSON_WRITER_MAX_DECIMALS;
+    const double scaled = v * static_cast<double>(kPow10[decimals]);
+    if (!isfinite(scaled) || fabs(scaled) >= kMaxScaled) {
+        put("null", 4);
+        return;
+    }
+    const long long r = llround(scaled);
+    const unsigned long long mag = r < 0 ? 0ULL - static_cast<unsigned long long>(r) : static_cast<unsigned long long>(r);
+    if (r < 0) put('-');
+    putUnsigned(mag / kPow10[decimals]);
+    if (!decimals) return;
+    char frac[JSON_WRITER_MAX_DECIMALS + 1];
+    frac[0] = '.';
+    unsigned long long f = mag % kPow10[decimals];
+    for (uint8_t i = decimals; i > 0; i--) {
+        frac[i] = static_cast<char>('0' + f % 10);
+        f /= 10;
+    }
+    put(frac, decimals + 1);
+}
+
+void JsonWriter::separator() {
+    const uint32_t bit = 1UL << depth_;
+    if (first_ & bit) {
+        first_ &= ~bit;
+    } else if (depth_) {
+        put(',');
+    }
+}
+
+void JsonWriter::key(const char* k) {
+    separator();
+    putString(k ? k : "");
+    put(':');
+}
+
+void JsonWriter::open(char c) {
+    if (depth_ >= JSON_WRITER_MAX_DEPTH) {
+        failed_ = true;
+        return;
+    }
+    put(c);
+    depth_++;
+    first_ |= 1UL << depth_;
+}
+
+void JsonWriter::close(char c) {
+    if (!depth_) {
+        failed_ = true;
+        return;
+    }
+    first_ &= ~(1UL << depth_);
+    depth_--;
+    put(c);
+}
+
+JsonWriter& JsonWriter::beginObject() {
+    separator();
+    open('{');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject(const char* k) {
+    key(k);
+    open('{');
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+    close('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+    separator();
+    open('[');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray(const char* k) {
+    key(k);
+    open('[');
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+    close(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* k, const char* v) {
+    key(k);
+    if (v) {
+        putString(v);
+    } else {
+        put("null", 4);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* k, bool v) {
+    key(k);
+    if (v) {
+        put("true", 4);
+    } else {
+        put("false", 5);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::field(const char* k, double v, uint8_t decimals) {
+    key(k);
+    putFixed(v, decimals);
+    return *this;
+}
+
+JsonWriter& JsonWriter::fieldRaw(const char* k, const char* json, size_t len) {
+    key(k);
+    put(json, len);
+    return *this;
+}
+
+JsonWriter& JsonWriter::fieldSigned(const char* k, long long v) {
+    key(k);
+    putSigned(v);
+    return *this;
+}
+
+JsonWriter& JsonWriter::fieldUnsigned(const char* k, unsigned long long v) {
+    key(k);
+    putUnsigned(v);
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(const char* v) {
+    separator();
+    if (v) {
+        putString(v);
+    } else {
+        put("null", 4);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool v) {
+    separator();
+    if (v) {
+        put("true", 4);
+    } else {
+        put("false", 5);
+    }
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(double v, uint8_t decimals) {
+    separator();
+    putFixed(v, decimals);
+    return *this;
+}
+
+JsonWriter& JsonWriter::valueSigned(long long v) {
+    separator();
+    putSigned(v);
+    return *this;
+}
+
+JsonWriter& JsonWriter::valueUnsigned(unsigned long long v) {
+    separator();
+    putUnsigned(v);
+    return *this;
+}
+
+void JsonWriter::rewind(const Mark& m) {
+    if (out_ || m.len > cap_) return;
+    len_ = m.len;
+    first_ = m.first;
+    depth_ = m.depth;
+    failed_ = false;
+}
+
+size_t JsonWriter::finish() {
+    drain();
+    return ok() ? drained_ + len_ : 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Streaming JSON Writer
+ * Serializes in one pass straight into the caller's bytes: a transport arena
+ * reservation, a StorageLine, or a small chunk buffer drained into a Print
+ * (UART) each time it fills. No heap and no document tree; the only state is
+ * the write position and one "first member" bit per nesting level.
+ *
+ * A value that does not fit fails the writer: everything after it is skipped
+ * and ok() / finish() say so, so a fixed buffer holds a whole record or is
+ * discarded. mark() / rewind() drop a trailing part instead ("the channels
+ * that fit"). A Print sink cannot take back what it was given; its output is
+ * only cut short.
+ *
+ * Floats are written fixed point with the given decimals (no printf, whose
+ * float conversion allocates in newlib); NaN, infinity and values too large
+ * for the decimals are null.
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <Arduino.h>
+
+#define JSON_WRITER_MAX_DEPTH 31
+#define JSON_WRITER_MAX_DECIMALS 9
+
+class JsonWriter {
+public:
+    struct Mark {
+        size_t len;
+        uint32_t first;
+        uint8_t depth;
+    };
+
+    // Fixed buffer; length() bytes of it are the JSON, not NUL-terminated
+    JsonWriter(char* buf, size_t capacity);
+    // Streamed to out through chunk
+    JsonWriter(Print& out, char* chunk, size_t chunkSize);
+
+    JsonWriter& beginObject();
+    JsonWriter& beginObject(const char* key);
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& beginArray(const char* key);
+    JsonWriter& endArray();
+
+    // Object members; a nullptr string is null
+    JsonWriter& field(const char* key, const char* value);
+    JsonWriter& field(const char* key, bool value);
+    JsonWriter& field(const char* key, int value) { return fieldSigned(key, value); }
+    JsonWriter& field(const char* key, long value) { return fieldSigned(key, value); }
+    JsonWriter& field(const char* key, long long value) { return fieldSigned(key, value); }
+    JsonWriter& field(const char* key, unsigned value) { return fieldUnsigned(key, value); }
+    JsonWriter& field(const char* key, unsigned long value) { return fieldUnsigned(key, value); }
+    JsonWriter& field(const char* key, unsigned long long value) { return fieldUnsigned(key, value); }
+    JsonWriter& field(const char* key, double value, uint8_t decimals);
+    // json is already serialized
+    JsonWriter& fieldRaw(const char* key, const char* json, size_t len);
+
+    // Array elements
+    JsonWriter& value(const char* v);
+    JsonWriter& value(bool v);
+    JsonWriter& value(int v) { return valueSigned(v); }
+    JsonWriter& value(long v) { return valueSigned(v); }
+    JsonWriter& value(long long v) { return valueSigned(v); }
+    JsonWriter& value(unsigned v) { return valueUnsigned(v); }
+    JsonWriter& value(unsigned long v) { return valueUnsigned(v); }
+    JsonWriter& value(unsigned long long v) { return valueUnsigned(v); }
+    JsonWriter& value(double v, uint8_t decimals);
+
+    // Fixed buffer only: rewind() forgets everything written after mark() and clears a failure
+    Mark mark() const { return Mark{len_, first_, depth_}; }
+    void rewind(const Mark& m);
+
+    bool ok() const { return !failed_ && depth_ == 0; }
+    bool failed() const { return failed_; }
+    const char* data() const { return buf_; }
+    size_t length() const { return len_; }
+    // Drains a Print sink; the total byte count, 0 when the writer failed or nesting is open
+    size_t finish();
+
+private:
+    JsonWriter& fieldSigned(const char* key, long long v);
+    JsonWriter& fieldUnsigned(const char* key, unsigned long long v);
+    JsonWriter& valueSigned(long long v);
+    JsonWriter& valueUnsigned(unsigned long long v);
+
+    void put(char c);
+    void put(const char* s, size_t n);
+    void putString(const char* s);
+    void putUnsigned(unsigned long long v);
+    void putSigned(long long v);
+    void putFixed(double v, uint8_t decimals);
+    void separator();
+    void key(const char* k);
+    void open(char c);
+    void close(char c);
+    void drain();
+
+    char* buf_;
+    size_t cap_;
+    size_t len_ = 0;
+    size_t drained_ = 0;         // bytes already given to out_
+    Print* out_ = nullptr;
+    uint32_t first_ = 0;         // bit n: level n has no member yet
+    uint8_t depth_ = 0;
+    bool failed_ = false;
+};
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,296 @@
+/*
+ * Kernel Object Allocation Implementation
+ */
+
+#include "kernel_objects.h"
+#include "../modules/storage/storage_task.h"
+#include "trace_recorder.h"
+#include "mutex_profiler.h"
+#include "core_affinity.h"
+
+namespace {
+struct TaskSlot {
+    const char* name;
+    uint32_t stackSize;
+    StackType_t* stack;
+    StaticTask_t* tcb;
+};
+
+struct QueueSlot {
+    UBaseType_t length;
+    UBaseType_t itemBytes;
+    uint8_t* storage;
+    StaticQueue_t* control;
+};
+
+struct MessageBufferSlot {
+    size_t bytes;
+    uint8_t* storage;
+    StaticMessageBuffer_t* control;
+};
+
+struct TimerSlot {
+    const char* name;
+    StaticTimer_t* control;
+};
+
+#if STATIC_KERNEL_ALLOC_ENABLE
+
+// A task the build profile leaves out has stack 0 in the table and no buffers
+template <uint32_t Words>
+struct TaskStorage {
+    StackType_t stack[Words];
+    StaticTask_t tcb;
+};
+template <>
+struct TaskStorage<0> {};
+
+template <uint32_t Words>
+constexpr StackType_t* stackOf(TaskStorage<Words>& s) { return s.stack; }
+template <uint32_t Words>
+constexpr StaticTask_t* tcbOf(TaskStorage<Words>& s) { return &s.tcb; }
+constexpr StackType_t* stackOf(TaskStorage<0>&) { return nullptr; }
+constexpr StaticTask_t* tcbOf(TaskStorage<0>&) { return nullptr; }
+
+#define KERNEL_TASK_STORAGE(id, name, stack) TaskStorage<(stack)> s_task##id;
+#define KERNEL_QUEUE_STORAGE(id, length, itemBytes) \
+    uint8_t s_queue##id[(length) * (itemBytes)];    \
+    StaticQueue_t s_queueCb##id;
+// A message buffer of N bytes needs N + 1 bytes of storage
+#define KERNEL_MESSAGE_BUFFER_STORAGE(id, bytes) \
+    uint8_t s_msgbuf##id[(bytes) + 1];           \
+    StaticMessageBuffer_t s_msgbufCb##id;
+#define KERNEL_MUTEX_STORAGE(id) StaticSemaphore_t s_mutex##id;
+#define KERNEL_EVENT_GROUP_STORAGE(id) StaticEventGroup_t s_events##id;
+#define KERNEL_TIMER_STORAGE(id, name) StaticTimer_t s_timer##id;
+
+KERNEL_TASKS(KERNEL_TASK_STORAGE)
+KERNEL_QUEUES(KERNEL_QUEUE_STORAGE)
+KERNEL_MESSAGE_BUFFERS(KERNEL_MESSAGE_BUFFER_STORAGE)
+KERNEL_MUTEXES(KERNEL_MUTEX_STORAGE)
+KERNEL_EVENT_GROUPS(KERNEL_EVENT_GROUP_STORAGE)
+KERNEL_TIMERS(KERNEL_TIMER_STORAGE)
+
+#define KERNEL_TASK_SLOT(id, name, stack) {name, stack, stackOf(s_task##id), tcbOf(s_task##id)},
+#define KERNEL_QUEUE_SLOT(id, length, itemBytes) {length, itemBytes, s_queue##id, &s_queueCb##id},
+#define KERNEL_MESSAGE_BUFFER_SLOT(id, bytes) {bytes, s_msgbuf##id, &s_msgbufCb##id},
+#define KERNEL_MUTEX_SLOT(id) &s_mutex##id,
+#define KERNEL_EVENT_GROUP_SLOT(id) &s_events##id,
+#define KERNEL_TIMER_SLOT(id, name) {name, &s_timer##id},
+
+StaticSemaphore_t* const kMutexes[] = {KERNEL_MUTEXES(KERNEL_MUTEX_SLOT)};
+StaticEventGroup_t* const kEventGroups[] = {KERNEL_EVENT_GROUPS(KERNEL_EVENT_GROUP_SLOT)};
+
+#else
+
+#define KERNEL_TASK_SLOT(id, name, stack) {name, stack, nullptr, nullptr},
+#define KERNEL_QUEUE_SLOT(id, length, itemBytes) {length, itemBytes, nullptr, nullptr},
+#define KERNEL_MESSAGE_BUFFER_SLOT(id, bytes) {bytes, nullptr, nullptr},
+#define KERNEL_TIMER_SLOT(id, name) {name, nullptr},
+
+#endif // STATIC_KERNEL_ALLOC_ENABLE
+
+const TaskSlot kTasks[] = {KERNEL_TASKS(KERNEL_TASK_SLOT)};
+const QueueSlot kQueues[] = {KERNEL_QUEUES(KERNEL_QUEUE_SLOT)};
+const MessageBufferSlot kMessageBuffers[] = {KERNEL_MESSAGE_BUFFERS(KERNEL_MESSAGE_BUFFER_SLOT)};
+const TimerSlot kTimers[] = {KERNEL_TIMERS(KERNEL_TIMER_SLOT)};
+
+// Names for the trace recorder and mutex profiler
+#define KERNEL_QUEUE_NAME(id, length, itemBytes) #id,
+#define KERNEL_MUTEX_NAME(id) #id,
+const char* const kQueueNames[] = {KERNEL_QUEUES(KERNEL_QUEUE_NAME)};
+const char* const kMutexNames[] = {KERNEL_MUTEXES(KERNEL_MUTEX_NAME)};
+#undef KERNEL_QUEUE_NAME
+#undef KERNEL_MUTEX_NAME
+
+#if STATIC_KERNEL_ALLOC_ENABLE
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t s_tasks[static_cast<size_t>(KernelTask::Count)];
+bool s_queueUsed[static_cast<size_t>(KernelQueue::Count)];
+bool s_messageBufferUsed[static_cast<size_t>(KernelMessageBuffer::Count)];
+bool s_mutexUsed[static_cast<size_t>(KernelMutex::Count)];
+bool s_eventGroupUsed[static_cast<size_t>(KernelEventGroup::Count)];
+bool s_timerUsed[static_cast<size_t>(KernelTimer::Count)];
+
+// Claims a one-shot or delete-tracked slot; false when it already holds an object
+bool claim(bool* used, size_t i) {
+    portENTER_CRITICAL(&s_mux);
+    const bool wasUsed = used[i];
+    used[i] = true;
+    portEXIT_CRITICAL(&s_mux);
+    return !wasUsed;
+}
+
+void release(bool* used, size_t i) {
+    portENTER_CRITICAL(&s_mux);
+    used[i] = false;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+// The previous task in this slot must be gone from every kernel list, including
+// the termination list the idle task drains, before its TCB and stack are reused
+bool taskSlotFree(size_t i) {
+    TaskHandle_t prev = s_tasks[i];
+    if (!prev) return true;
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(KERNEL_TASK_REAP_WAIT_MS);
+    while (xTaskGetHandle(kTasks[i].name) == prev) {
+        if (eTaskGetState(prev) != eDeleted || static_cast<int32_t>(xTaskGetTickCount() - deadline) >= 0) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return true;
+}
+#endif // STATIC_KERNEL_ALLOC_ENABLE
+} // namespace
+
+BaseType_t kernel_task_create(KernelTask id, TaskFunction_t fn, void* arg, UBaseType_t priority,
+                              TaskHandle_t* handle, BaseType_t core) {
+    const size_t i = static_cast<size_t>(id);
+    const TaskSlot& slot = kTasks[i];
+    if (!slot.stackSize) {
+        Serial.printf("Kernel: task %s is not in this build profile\n", slot.name);
+        if (handle) *handle = nullptr;
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    core = core_affinity_core(id, core);
+#if STATIC_KERNEL_ALLOC_ENABLE
+    if (!taskSlotFree(i)) {
+        Serial.printf("Kernel: task %s is still running; static slot busy\n", slot.name);
+        if (handle) *handle = nullptr;
+        return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+    }
+    TaskHandle_t task = xTaskCreateStaticPinnedToCore(fn, slot.name, slot.stackSize, arg, priority, slot.stack,
+                                                      slot.tcb, core);
+    s_tasks[i] = task;
+    if (handle) *handle = task;
+    return task ? pdPASS : errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+#else
+    return xTaskCreatePinnedToCore(fn, slot.name, slot.stackSize, arg, priority, handle, core);
+#endif
+}
+
+QueueHandle_t kernel_queue_create(KernelQueue id, UBaseType_t itemSize) {
+    const size_t i = static_cast<size_t>(id);
+    const QueueSlot& slot = kQueues[i];
+    if (itemSize > slot.itemBytes) {
+        Serial.printf("Kernel: queue %u item %u B exceeds table size %u B\n", static_cast<unsigned>(i),
+                      static_cast<unsigned>(itemSize), static_cast<unsigned>(slot.itemBytes));
+        return nullptr;
+    }
+#if STATIC_KERNEL_ALLOC_ENABLE
+    if (!claim(s_queueUsed, i)) return nullptr;
+    QueueHandle_t queue = xQueueCreateStatic(slot.length, itemSize, slot.storage, slot.control);
+#else
+    QueueHandle_t queue = xQueueCreate(slot.length, itemSize);
+#endif
+    trace_recorder_name(queue, kQueueNames[i]);
+    return queue;
+}
+
+MessageBufferHandle_t kernel_message_buffer_create(KernelMessageBuffer id) {
+    const size_t i = static_cast<size_t>(id);
+    const MessageBufferSlot& slot = kMessageBuffers[i];
+#if STATIC_KERNEL_ALLOC_ENABLE
+    if (!claim(s_messageBufferUsed, i)) return nullptr;
+    return xMessageBufferCreateStatic(slot.bytes, slot.storage, slot.control);
+#else
+    return xMessageBufferCreate(slot.bytes);
+#endif
+}
+
+SemaphoreHandle_t kernel_mutex_create(KernelMutex id) {
+    const size_t i = static_cast<size_t>(id);
+#if STATIC_KERNEL_ALLOC_ENABLE
+    if (!claim(s_mutexUsed, i)) {
+        Serial.printf("Kernel: mutex %u already created\n", static_cast<unsigned>(i));
+        return nullptr;
+    }
+    SemaphoreHandle_t mutex = xSemaphoreCreateMutexStatic(kMutexes[i]);
+#else
+    SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+#endif
+    trace_recorder_name(mutex, kMutexNames[i]);
+    mutex_profile_name(mutex, kMutexNames[i]);
+    return mutex;
+}
+
+void kernel_mutex_delete(KernelMutex id, SemaphoreHandle_t mutex) {
+    if (!mutex) return;
+    vSemaphoreDelete(mutex);
+#if STATIC_KERNEL_ALLOC_ENABLE
+    release(s_mutexUsed, static_cast<size_t>(id));
+#else
+    (void)id;
+#endif
+}
+
+EventGroupHandle_t kernel_event_group_create(KernelEventGroup id) {
+#if STATIC_KERNEL_ALLOC_ENABLE
+    const size_t i = static_cast<size_t>(id);
+    if (!claim(s_eventGroupUsed, i)) return nullptr;
+    return xEventGroupCreateStatic(kEventGroups[i]);
+#else
+    (void)id;
+    return xEventGroupCreate();
+#endif
+}
+
+TimerHandle_t kernel_timer_create(KernelTimer id, TickType_t period, UBaseType_t autoReload, void* timerId,
+                                  TimerCallbackFunction_t callback) {
+    const size_t i = static_cast<size_t>(id);
+    const TimerSlot& slot = kTimers[i];
+#if STATIC_KERNEL_ALLOC_ENABLE
+    if (!claim(s_timerUsed, i)) return nullptr;
+    return xTimerCreateStatic(slot.name, period, autoReload, timerId, callback, slot.control);
+#else
+    return xTimerCreate(slot.name, period, autoReload, timerId, callback);
+#endif
+}
+
+BaseType_t kernel_timer_delete(KernelTimer id, TimerHandle_t timer, TickType_t wait) {
+    if (!timer) return pdFAIL;
+    const BaseType_t result = xTimerDelete(timer, wait);
+#if STATIC_KERNEL_ALLOC_ENABLE
+    // With wait 0 the delete may still be queued to the timer task; the slot is
+    // handed back only once the command is accepted
+    if (result == pdPASS) release(s_timerUsed, static_cast<size_t>(id));
+#else
+    (void)id;
+#endif
+    return result;
+}
+
+size_t kernel_objects_static_bytes() {
+#if STATIC_KERNEL_ALLOC_ENABLE
+    size_t total = 0;
+    for (const TaskSlot& t : kTasks) {
+        if (t.stackSize) total += t.stackSize * sizeof(StackType_t) + sizeof(StaticTask_t);
+    }
+    for (const QueueSlot& q : kQueues) total += q.length * q.itemBytes + sizeof(StaticQueue_t);
+    for (const MessageBufferSlot& m : kMessageBuffers) total += m.bytes + 1 + sizeof(StaticMessageBuffer_t);
+    total += static_cast<size_t>(KernelMutex::Count) * sizeof(StaticSemaphore_t);
+    total += static_cast<size_t>(KernelEventGroup::Count) * sizeof(StaticEventGroup_t);
+    total += static_cast<size_t>(KernelTimer::Count) * sizeof(StaticTimer_t);
+    return total;
+#else
+    return 0;
+#endif
+}
+
+void kernel_objects_report(Print& out) {
+#if STATIC_KERNEL_ALLOC_ENABLE
+    out.printf("Kernel objects: %u B static (%u tasks, %u queues, %u mutexes)\n",
+               static_cast<unsigned>(kernel_objects_static_bytes()), static_cast<unsigned>(KernelTask::Count),
+               static_cast<unsigned>(KernelQueue::Count), static_cast<unsigned>(KernelMutex::Count));
+    for (size_t i = 0; i < static_cast<size_t>(KernelTask::Count); i++) {
+        const TaskHandle_t task = s_tasks[i];
+        if (!task || eTaskGetState(task) == eDeleted) continue;
+        out.printf("  %-14s stack %5lu B, min free %5u B\n", kTasks[i].name,
+                   static_cast<unsigned long>(kTasks[i].stackSize * sizeof(StackType_t)),
+                   static_cast<unsigned>(uxTaskGetStackHighWaterMark(task) * sizeof(StackType_t)));
+    }
+#else
+    (void)out;
+#endif
+}
@@ -0,0 +1,62 @@
+/*
+ * Kernel Object Allocation
+ * One creation point for the tasks, queues, message buffers, mutexes, event
+ * groups and timers listed in task_config.h (KERNEL_TASKS and friends).
+ *
+ * With STATIC_KERNEL_ALLOC_ENABLE every entry owns a buffer set in .bss
+ * (s_stack<Id>, s_tcb<Id>, s_queue<Id>, ...), so the map file shows the whole
+ * kernel footprint and boot takes nothing from the heap for them. Without it the
+ * calls forward to the ordinary heap-backed FreeRTOS APIs.
+ *
+ * Each buffer set holds one live object at a time. A task slot is free again
+ * once the previous task has been deleted and the idle task has reaped it
+ * (creation waits up to KERNEL_TASK_REAP_WAIT_MS for that); mutex and timer
+ * slots are freed with kernel_mutex_delete() / kernel_timer_delete().
+ */
+
+#ifndef KERNEL_OBJECTS_H
+#define KERNEL_OBJECTS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/event_groups.h>
+#include <freertos/message_buffer.h>
+#include <freertos/timers.h>
+#include "../config/task_config.h"
+
+#ifndef KERNEL_TASK_REAP_WAIT_MS
+#define KERNEL_TASK_REAP_WAIT_MS 200
+#endif
+
+#define KERNEL_OBJECT_ID(id, ...) id,
+
+enum class KernelTask : uint8_t { KERNEL_TASKS(KERNEL_OBJECT_ID) Count };
+enum class KernelQueue : uint8_t { KERNEL_QUEUES(KERNEL_OBJECT_ID) Count };
+enum class KernelMessageBuffer : uint8_t { KERNEL_MESSAGE_BUFFERS(KERNEL_OBJECT_ID) Count };
+enum class KernelMutex : uint8_t { KERNEL_MUTEXES(KERNEL_OBJECT_ID) Count };
+enum class KernelEventGroup : uint8_t { KERNEL_EVENT_GROUPS(KERNEL_OBJECT_ID) Count };
+enum class KernelTimer : uint8_t { KERNEL_TIMERS(KERNEL_OBJECT_ID) Count };
+
+// Same contract as xTaskCreatePinnedToCore; name and stack size come from the table.
+// core is the default; a layout saved by the affinity tuner (core_affinity.h) overrides it.
+BaseType_t kernel_task_create(KernelTask id, TaskFunction_t fn, void* arg, UBaseType_t priority,
+                              TaskHandle_t* handle, BaseType_t core);
+
+// itemSize must not exceed the table's item bytes
+QueueHandle_t kernel_queue_create(KernelQueue id, UBaseType_t itemSize);
+MessageBufferHandle_t kernel_message_buffer_create(KernelMessageBuffer id);
+SemaphoreHandle_t kernel_mutex_create(KernelMutex id);
+void kernel_mutex_delete(KernelMutex id, SemaphoreHandle_t mutex);
+EventGroupHandle_t kernel_event_group_create(KernelEventGroup id);
+TimerHandle_t kernel_timer_create(KernelTimer id, TickType_t period, UBaseType_t autoReload, void* timerId,
+                                  TimerCallbackFunction_t callback);
+BaseType_t kernel_timer_delete(KernelTimer id, TimerHandle_t timer, TickType_t wait);
+
+// Bytes reserved for kernel objects at link time (0 without static allocation)
+size_t kernel_objects_static_bytes();
+void kernel_objects_report(Print& out);
+
+#endif // KERNEL_OBJECTS_H
@@ -0,0 +1,342 @@
+/*
+ * Load Shedding Implementation
+ */
+
+#include "load_shed.h"
+
+#if LOAD_SHED_ENABLE
+
+#include "cpu_profiler.h"
+#include "metrics.h"
+#include "service_task.h"
+#include "task_heap.h"
+#include "../include/debug_system.h"
+#include "../modules/logging/log_buffer.h"
+#include "../modules/storage/storage_task.h"
+#include "../modules/transport/live_config.h"
+#include <atomic>
+#include <string.h>
+
+namespace {
+constexpr size_t kSteps = (size_t)ShedStep::Count;
+constexpr const char* kStepNames[kSteps] = {"display", "logs", "gnss", "backfill"};
+// The task each step relieves, for the freed CPU and heap
+constexpr const char* kStepTasks[kSteps] = {"Display", "DebugSink", "CatMGNSS", "Work1"};
+
+std::atomic<uint8_t> s_activeMask{0};        // bit per ShedStep
+std::atomic<uint32_t> s_order{0};            // ShedStep per byte, first to go lowest
+std::atomic<uint8_t> s_floor{0};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+LoadShedStats s_stats;                       // under s_mux; written by the job
+
+// Sampling job only
+ShedStep s_taken[kSteps];                    // steps held, oldest first
+uint8_t s_depth = 0;
+uint8_t s_raiseRun = 0;
+uint8_t s_clearRun = 0;
+uint32_t s_settledAtMs = 0;
+uint8_t s_prevPressure = 0;
+int64_t s_prevOverruns = -1;                 // -1 = no baseline yet
+int64_t s_prevLate = -1;
+uint8_t s_logSaved[LOG_TAG_COUNT];
+LogLevel s_logSavedGlobal = DEBUG_LOG_LEVEL_INFO;
+// Measurement of the last step taken, finished once it settled
+bool s_measuring = false;
+ShedStep s_measureStep = ShedStep::Display;
+int32_t s_beforeCpuPm = -1;
+uint32_t s_beforeHeap = 0;
+int64_t s_beforeTaskHeap = -1;
+
+uint32_t packOrder(const ShedStep* order) {
+    uint32_t packed = 0;
+    for (size_t i = 0; i < kSteps; i++) packed |= (uint32_t)order[i] << (8 * i);
+    return packed;
+}
+
+ShedStep orderAt(uint32_t packed, size_t i) {
+    return (ShedStep)((packed >> (8 * i)) & 0xFF);
+}
+
+bool parseOrder(const char* spec, ShedStep* out) {
+    if (!spec) return false;
+    uint8_t seen = 0;
+    size_t n = 0;
+    const char* p = spec;
+    while (*p) {
+        const char* end = strchr(p, ',');
+        const size_t len = end ? (size_t)(end - p) : strlen(p);
+        size_t k = 0;
+        while (k < kSteps && !(strlen(kStepNames[k]) == len && strncmp(kStepNames[k], p, len) == 0)) k++;
+        if (k == kSteps || (seen & (1U << k)) || n == kSteps) return false;
+        seen |= (uint8_t)(1U << k);
+        out[n++] = (ShedStep)k;
+        if (!end) break;
+        p = end + 1;
+    }
+    return n == kSteps;
+}
+
+// Metric value, or fallback when the metric isn't registered in this build
+int64_t metric(const char* name, int64_t fallback) {
+    int64_t v = 0;
+    return metrics_value(name, v) ? v : fallback;
+}
+
+// Counter delta since the previous sample; the first sample sets the baseline
+uint32_t counterDelta(const char* name, int64_t& prev) {
+    int64_t v = 0;
+    if (!metrics_value(name, v)) return 0;
+    const int64_t d = prev >= 0 && v >= prev ? v - prev : 0;
+    prev = v;
+    return (uint32_t)d;
+}
+
+LoadShedSample takeSample() {
+    LoadShedSample s{};
+    const int64_t load0 = metric("cpu.load0_pm", -1);
+    const int64_t load1 = metric("cpu.load1_pm", -1);
+    const int64_t cpu = load0 > load1 ? load0 : load1;
+    s.cpuPermille = cpu > 0 ? (uint16_t)cpu : 0;
+    s.freeHeap = (uint32_t)metric("mem.free", ESP.getFreeHeap());
+    s.largestBlock = (uint32_t)metric("mem.largest", ESP.getMaxAllocHeap());
+    s.storagePressure = (int32_t)metric("storage.pressure", 0);
+    s.pendingBytes = (uint32_t)metric("tx.pending_b", 0);
+    s.scanOverruns = counterDelta("plc.overruns", s_prevOverruns);
+    s.alarmsLate = counterDelta("tx.alarm_late", s_prevLate);
+
+    // Under pressure a source has to come back past its release threshold
+    const uint8_t prev = s_prevPressure;
+    if (cpu >= 0 && cpu > ((prev & LOAD_SHED_CPU) ? LOAD_SHED_CPU_CLEAR_PM : LOAD_SHED_CPU_HIGH_PM)) {
+        s.pressure |= LOAD_SHED_CPU;
+    }
+    const bool heapHeld = prev & LOAD_SHED_HEAP;
+    if (s.freeHeap < (heapHeld ? LOAD_SHED_HEAP_CLEAR : LOAD_SHED_HEAP_LOW) ||
+        s.largestBlock < (heapHeld ? LOAD_SHED_LARGEST_CLEAR : LOAD_SHED_LARGEST_LOW)) {
+        s.pressure |= LOAD_SHED_HEAP;
+    }
+    if (s.storagePressure >= (int32_t)StoragePressure::Shed) s.pressure |= LOAD_SHED_STORAGE;
+    if (s.pendingBytes > ((prev & LOAD_SHED_QUEUE) ? LOAD_SHED_QUEUE_CLEAR : LOAD_SHED_QUEUE_HIGH)) {
+        s.pressure |= LOAD_SHED_QUEUE;
+    }
+    if (s.scanOverruns || s.alarmsLate) s.pressure |= LOAD_SHED_GUARD;
+    s_prevPressure = s.pressure;
+    return s;
+}
+
+int32_t taskCpuPm(ShedStep step) {
+    const TaskHandle_t task = xTaskGetHandle(kStepTasks[(size_t)step]);
+    const float load = task ? cpu_profile_task_load(task, CPU_WINDOW_LAST) : -1.0f;
+    return load < 0.0f ? -1 : (int32_t)(load * 1000.0f + 0.5f);
+}
+
+int64_t taskHeapLive(ShedStep step) {
+    const TaskHandle_t task = xTaskGetHandle(kStepTasks[(size_t)step]);
+    TaskHeapUsage u;
+    return task && task_heap_usage(task, u) ? (int64_t)u.liveBytes : -1;
+}
+
+// Tags above WARN are held there; the ones still at WARN get their level back
+void shedLogs(bool shed) {
+    if (shed) {
+        memcpy(s_logSaved, g_logTagLevel, sizeof(s_logSaved));
+        s_logSavedGlobal = get_log_level();
+        for (uint8_t t = 0; t < LOG_TAG_COUNT; t++) {
+            if (g_logTagLevel[t] > DEBUG_LOG_LEVEL_WARN) log_tag_set_level((LogTag)t, DEBUG_LOG_LEVEL_WARN);
+        }
+        if (s_logSavedGlobal > DEBUG_LOG_LEVEL_WARN) set_log_level(DEBUG_LOG_LEVEL_WARN);
+        return;
+    }
+    // A level changed by hand while shed stays as it was set
+    for (uint8_t t = 0; t < LOG_TAG_COUNT; t++) {
+        if (s_logSaved[t] > DEBUG_LOG_LEVEL_WARN && g_logTagLevel[t] == DEBUG_LOG_LEVEL_WARN) {
+            log_tag_set_level((LogTag)t, (LogLevel)s_logSaved[t]);
+        }
+    }
+    if (s_logSavedGlobal > DEBUG_LOG_LEVEL_WARN && get_log_level() == DEBUG_LOG_LEVEL_WARN) {
+        set_log_level(s_logSavedGlobal);
+    }
+}
+
+void setActive(ShedStep step, bool shed) {
+    const uint8_t bit = (uint8_t)(1U << (size_t)step);
+    if (shed) {
+        s_activeMask.fetch_or(bit, std::memory_order_relaxed);
+    } else {
+        s_activeMask.fetch_and((uint8_t)~bit, std::memory_order_relaxed);
+    }
+    if (step == ShedStep::Logs) shedLogs(shed);
+}
+
+void take(const LoadShedSample& s, bool forced, uint32_t now) {
+    const uint32_t order = s_order.load(std::memory_order_relaxed);
+    const uint8_t mask = s_activeMask.load(std::memory_order_relaxed);
+    size_t i = 0;
+    while (i < kSteps && (mask & (1U << (size_t)orderAt(order, i)))) i++;
+    if (i == kSteps) return;
+    const ShedStep step = orderAt(order, i);
+
+    s_measuring = true;
+    s_measureStep = step;
+    s_beforeCpuPm = taskCpuPm(step);
+    s_beforeHeap = ESP.getFreeHeap();
+    s_beforeTaskHeap = taskHeapLive(step);
+    setActive(step, true);
+    s_taken[s_depth++] = step;
+    s_settledAtMs = now + LOAD_SHED_SETTLE_MS;
+
+    portENTER_CRITICAL(&s_mux);
+    LoadShedStepStats& st = s_stats.steps[(size_t)step];
+    st.taken++;
+    st.lastTakenMs = now ? now : 1;
+    st.lastPressure = s.pressure;
+    s_stats.active = s_depth;
+    portEXIT_CRITICAL(&s_mux);
+    logbuf_printf("Load shed: %s shed (%s, cpu %u pm, heap %lu, pending %lu B)", kStepNames[(size_t)step],
+                  forced ? "floor" : "pressure", (unsigned)s.cpuPermille, (unsigned long)s.freeHeap,
+                  (unsigned long)s.pendingBytes);
+}
+
+void restore(uint32_t now) {
+    if (!s_depth) return;
+    const ShedStep step = s_taken[--s_depth];
+    if (s_measuring && s_measureStep == step) s_measuring = false;
+    setActive(step, false);
+    s_settledAtMs = now + LOAD_SHED_SETTLE_MS;
+
+    portENTER_CRITICAL(&s_mux);
+    s_stats.steps[(size_t)step].restored++;
+    s_stats.active = s_depth;
+    portEXIT_CRITICAL(&s_mux);
+    logbuf_printf("Load shed: %s restored", kStepNames[(size_t)step]);
+}
+
+// What the last step freed, once the profiler has sampled past it
+void finishMeasure() {
+    s_measuring = false;
+    const ShedStep step = s_measureStep;
+    const int32_t cpuPm = taskCpuPm(step);
+    const int64_t taskHeap = taskHeapLive(step);
+    const int32_t cpuFreed = s_beforeCpuPm >= 0 && cpuPm >= 0 ? s_beforeCpuPm - cpuPm : 0;
+    const int32_t heapFreed = (int32_t)(ESP.getFreeHeap() - s_beforeHeap);
+    const int32_t taskHeapFreed = s_beforeTaskHeap >= 0 && taskHeap >= 0 ? (int32_t)(s_beforeTaskHeap - taskHeap) : 0;
+
+    portENTER_CRITICAL(&s_mux);
+    LoadShedStepStats& st = s_stats.steps[(size_t)step];
+    st.cpuFreedPm = (int16_t)cpuFreed;
+    st.heapFreed = heapFreed;
+    st.taskHeapFreed = taskHeapFreed;
+    st.measured = true;
+    portEXIT_CRITICAL(&s_mux);
+    logbuf_printf("Load shed: %s freed %d pm CPU (%s), %ld B heap, %ld B task heap", kStepNames[(size_t)step],
+                  (int)cpuFreed, kStepTasks[(size_t)step], (long)heapFreed, (long)taskHeapFreed);
+}
+
+void sampleJob(void*) {
+    const uint32_t now = millis();
+    const LoadShedSample s = takeSample();
+    const bool settled = (int32_t)(now - s_settledAtMs) >= 0;
+    if (s_measuring && settled) finishMeasure();
+
+    if (s.pressure) {
+        s_clearRun = 0;
+        if (s_raiseRun < 0xFF) s_raiseRun++;
+    } else {
+        s_raiseRun = 0;
+        if (s_clearRun < 0xFF) s_clearRun++;
+    }
+
+    const uint8_t floor = s_floor.load(std::memory_order_relaxed);
+    if (s_depth < floor) {
+        take(s, true, now);
+    } else if (s_raiseRun >= LOAD_SHED_RAISE_SAMPLES && settled && s_depth < kSteps) {
+        take(s, false, now);
+        s_raiseRun = 0;
+    } else if (s_depth > floor && s_clearRun >= LOAD_SHED_CLEAR_SAMPLES && settled) {
+        restore(now);
+        s_clearRun = 0;
+    }
+
+    portENTER_CRITICAL(&s_mux);
+    s_stats.last = s;
+    s_stats.samples++;
+    if (s.pressure) s_stats.pressuredSamples++;
+    portEXIT_CRITICAL(&s_mux);
+}
+} // namespace
+
+bool load_shed_begin() {
+    ShedStep order[kSteps];
+    if (!parseOrder(LOAD_SHED_ORDER, order)) {
+        for (size_t i = 0; i < kSteps; i++) order[i] = (ShedStep)i;
+    }
+    s_order.store(packOrder(order), std::memory_order_relaxed);
+    live_config_register("load_shed_order", LiveConfigType::String, 0, LIVE_CONFIG_STRING_LEN - 1,
+                         [](const LiveConfigValue& v, void*) -> bool {
+        return load_shed_set_order(v.present && v.text[0] ? v.text : LOAD_SHED_ORDER);
+    }, nullptr);
+    return service_job_add("LoadShed", sampleJob, nullptr, LOAD_SHED_SAMPLE_MS, 2000) != SERVICE_JOB_NONE;
+}
+
+bool load_shed_active(ShedStep step) {
+    return s_activeMask.load(std::memory_order_relaxed) & (1U << (size_t)step);
+}
+
+void load_shed_set_floor(uint8_t steps) {
+    s_floor.store(steps < kSteps ? steps : (uint8_t)kSteps, std::memory_order_relaxed);
+}
+
+// Steps held keep their place; the new order decides what goes next
+bool load_shed_set_order(const char* spec) {
+    ShedStep order[kSteps];
+    if (!parseOrder(spec, order)) return false;
+    s_order.store(packOrder(order), std::memory_order_relaxed);
+    return true;
+}
+
+const char* load_shed_step_name(ShedStep step) {
+    return step < ShedStep::Count ? kStepNames[(size_t)step] : "?";
+}
+
+void load_shed_stats(LoadShedStats& out) {
+    portENTER_CRITICAL(&s_mux);
+    out = s_stats;
+    portEXIT_CRITICAL(&s_mux);
+    out.floor = s_floor.load(std::memory_order_relaxed);
+    const uint32_t order = s_order.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < kSteps; i++) out.order[i] = orderAt(order, i);
+}
+
+void load_shed_report(Print& out) {
+    LoadShedStats s;
+    load_shed_stats(s);
+    const LoadShedSample& l = s.last;
+    out.printf("Load shed: %u steps held (floor %u), %lu of %lu samples pressured; now", (unsigned)s.active,
+               (unsigned)s.floor, (unsigned long)s.pressuredSamples, (unsigned long)s.samples);
+    static const char* const kPressureNames[] = {"cpu", "heap", "storage", "queue", "guard"};
+    bool any = false;
+    for (size_t b = 0; b < sizeof(kPressureNames) / sizeof(kPressureNames[0]); b++) {
+        if (!(l.pressure & (1U << b))) continue;
+        out.printf("%s%s", any ? "," : " ", kPressureNames[b]);
+        any = true;
+    }
+    out.printf("%s; cpu %u pm, heap %lu (largest %lu), storage %ld, pending %lu B\n", any ? "" : " clear",
+               (unsigned)l.cpuPermille, (unsigned long)l.freeHeap, (unsigned long)l.largestBlock,
+               (long)l.storagePressure, (unsigned long)l.pendingBytes);
+    out.print("  order");
+    for (size_t i = 0; i < kSteps; i++) out.printf("%s%s", i ? "," : " ", load_shed_step_name(s.order[i]));
+    out.println();
+    for (size_t i = 0; i < kSteps; i++) {
+        const ShedStep step = s.order[i];
+        const LoadShedStepStats& st = s.steps[(size_t)step];
+        out.printf("  %-8s %-4s taken %lu, restored %lu", load_shed_step_name(step),
+                   load_shed_active(step) ? "shed" : "on", (unsigned long)st.taken, (unsigned long)st.restored);
+        if (st.measured) {
+            out.printf("; freed %d pm CPU, %ld B heap, %ld B task heap", (int)st.cpuFreedPm, (long)st.heapFreed,
+                       (long)st.taskHeapFreed);
+        }
+        out.println();
+    }
+}
+
+#endif // LOAD_SHED_ENABLE
@@ -0,0 +1,160 @@
+/*
+ * Load Shedding
+ * Gives up optional work, one step at a time in a configured order, while the
+ * metrics registry (system/metrics.h) says the unit is short of CPU, heap or
+ * queue room, and takes it back once the pressure has cleared:
+ *   - pressure, sampled every LOAD_SHED_SAMPLE_MS by a service job, is any of
+ *       cpu      busiest core above LOAD_SHED_CPU_HIGH_PM (cpu.load0_pm, cpu.load1_pm)
+ *       heap     mem.free below LOAD_SHED_HEAP_LOW or mem.largest below
+ *                LOAD_SHED_LARGEST_LOW
+ *       storage  storage.pressure at Shed or above
+ *       queue    tx.pending_b above LOAD_SHED_QUEUE_HIGH
+ *       guard    plc.overruns or tx.alarm_late moved since the last sample: the
+ *                latencies shedding is there to protect
+ *     Each level has a lower release threshold, so a value at the edge does
+ *     not flap.
+ *   - LOAD_SHED_RAISE_SAMPLES pressured samples in a row take the next step;
+ *     it then settles for LOAD_SHED_SETTLE_MS (two CPU profile samples) before
+ *     another may follow, and what it freed is measured over that time: CPU of
+ *     the task it relieves, free heap, and that task's heap with the per-task
+ *     accounting (task_heap.h).
+ *   - LOAD_SHED_CLEAR_SAMPLES clear samples in a row give back the last step
+ *     taken; steps come back in the reverse order they went.
+ *   - steps, in LOAD_SHED_ORDER unless the load_shed_order live setting says
+ *     otherwise:
+ *       display   page polls and frame caps x LOAD_SHED_DISPLAY_SLOWDOWN
+ *       logs      tags above WARN held at WARN, their levels put back after
+ *       gnss      fix refresh and fix polling x LOAD_SHED_GNSS_SLOWDOWN
+ *       backfill  no new backfill batches
+ *     The PLC scan and the alarm class are never shed.
+ * Owners read their step with load_shed_active(), one atomic load, where they
+ * already take run-time changes. A floor (the WatchdogManager degradation
+ * level) holds at least that many steps whatever the pressure.
+ */
+
+#ifndef LOAD_SHED_H
+#define LOAD_SHED_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef LOAD_SHED_SAMPLE_MS
+#define LOAD_SHED_SAMPLE_MS 1000
+#endif
+#ifndef LOAD_SHED_RAISE_SAMPLES
+#define LOAD_SHED_RAISE_SAMPLES 3
+#endif
+#ifndef LOAD_SHED_CLEAR_SAMPLES
+#define LOAD_SHED_CLEAR_SAMPLES 30
+#endif
+#ifndef LOAD_SHED_SETTLE_MS
+#define LOAD_SHED_SETTLE_MS 12000          // CPU_PROFILE_SAMPLE_MS x 2 and a bit
+#endif
+#ifndef LOAD_SHED_CPU_HIGH_PM
+#define LOAD_SHED_CPU_HIGH_PM 850
+#endif
+#ifndef LOAD_SHED_CPU_CLEAR_PM
+#define LOAD_SHED_CPU_CLEAR_PM 700
+#endif
+#ifndef LOAD_SHED_HEAP_LOW
+#define LOAD_SHED_HEAP_LOW 40000
+#endif
+#ifndef LOAD_SHED_HEAP_CLEAR
+#define LOAD_SHED_HEAP_CLEAR 60000
+#endif
+#ifndef LOAD_SHED_LARGEST_LOW
+#define LOAD_SHED_LARGEST_LOW 16384        // largest free block
+#endif
+#ifndef LOAD_SHED_LARGEST_CLEAR
+#define LOAD_SHED_LARGEST_CLEAR 24576
+#endif
+#ifndef LOAD_SHED_QUEUE_HIGH
+#define LOAD_SHED_QUEUE_HIGH 12288         // transport bytes waiting
+#endif
+#ifndef LOAD_SHED_QUEUE_CLEAR
+#define LOAD_SHED_QUEUE_CLEAR 4096
+#endif
+#ifndef LOAD_SHED_DISPLAY_SLOWDOWN
+#define LOAD_SHED_DISPLAY_SLOWDOWN 4
+#endif
+#ifndef LOAD_SHED_GNSS_SLOWDOWN
+#define LOAD_SHED_GNSS_SLOWDOWN 5
+#endif
+#ifndef LOAD_SHED_ORDER
+#define LOAD_SHED_ORDER "display,logs,gnss,backfill"
+#endif
+
+enum class ShedStep : uint8_t { Display = 0, Logs, Gnss, Backfill, Count };
+
+// Pressure sources, bits of LoadShedSample::pressure
+enum LoadShedPressure : uint8_t {
+    LOAD_SHED_CPU = 1 << 0,
+    LOAD_SHED_HEAP = 1 << 1,
+    LOAD_SHED_STORAGE = 1 << 2,
+    LOAD_SHED_QUEUE = 1 << 3,
+    LOAD_SHED_GUARD = 1 << 4,
+};
+
+struct LoadShedSample {
+    uint8_t pressure;            // LoadShedPressure bits, release thresholds applied
+    uint16_t cpuPermille;        // busiest core
+    uint32_t freeHeap;
+    uint32_t largestBlock;
+    int32_t storagePressure;     // StoragePressure
+    uint32_t pendingBytes;
+    uint32_t scanOverruns;       // since the previous sample
+    uint32_t alarmsLate;
+};
+
+// What a step freed, measured LOAD_SHED_SETTLE_MS after it was taken
+struct LoadShedStepStats {
+    uint32_t taken;
+    uint32_t restored;
+    uint32_t lastTakenMs;        // millis(), 0 = never
+    uint8_t lastPressure;        // what took it
+    int16_t cpuFreedPm;          // the relieved task's load, before minus after
+    int32_t heapFreed;           // free heap after minus before
+    int32_t taskHeapFreed;       // the relieved task's live heap, before minus after
+    bool measured;
+};
+
+struct LoadShedStats {
+    uint8_t active;              // steps held
+    uint8_t floor;
+    ShedStep order[(size_t)ShedStep::Count];
+    LoadShedSample last;
+    uint32_t samples;
+    uint32_t pressuredSamples;
+    LoadShedStepStats steps[(size_t)ShedStep::Count];   // by ShedStep
+};
+
+#if LOAD_SHED_ENABLE
+
+// Starts the sampling job and registers load_shed_order; once, after the service task
+bool load_shed_begin();
+
+// Any task, cheap enough for every loop pass: whether the step is being shed
+bool load_shed_active(ShedStep step);
+
+// Holds at least steps steps taken while set (0 releases); any task
+void load_shed_set_floor(uint8_t steps);
+// "display,logs,gnss,backfill": every step once; false leaves the order as it was
+bool load_shed_set_order(const char* spec);
+
+const char* load_shed_step_name(ShedStep step);
+void load_shed_stats(LoadShedStats& out);
+void load_shed_report(Print& out);
+
+#else
+
+inline bool load_shed_begin() { return false; }
+inline bool load_shed_active(ShedStep) { return false; }
+inline void load_shed_set_floor(uint8_t) {}
+inline bool load_shed_set_order(const char*) { return false; }
+inline const char* load_shed_step_name(ShedStep) { return "?"; }
+inline void load_shed_stats(LoadShedStats& out) { out = LoadShedStats{}; }
+inline void load_shed_report(Print&) {}
+
+#endif // LOAD_SHED_ENABLE
+
+#endif // LOAD_SHED_H
@@ -0,0 +1,272 @@
+/*
+ * Metrics Registry Implementation
+ */
+
+#include "metrics.h"
+
+#if METRICS_ENABLE
+
+#include "time_service.h"
+#include "../modules/logging/log_buffer.h"
+#include "../../include/transport.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+constexpr size_t kReportLine = 96;
+
+// Zero-initialized before any constructor runs, whichever translation unit comes first
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;   // appends; readers walk the list without it
+Metric* s_head = nullptr;
+Metric* s_tail = nullptr;
+size_t s_count = 0;
+
+size_t s_cursor = 0;         // next metric of the upload in progress
+bool s_uploading = false;
+uint32_t s_nextUploadMs = 0;
+
+// Log4 buckets from 16 units
+uint8_t bucket(uint32_t value) {
+    uint8_t b = 0;
+    for (uint32_t v = value >> 4; v && b < METRICS_HIST_BUCKETS - 1; v >>= 2) b++;
+    return b;
+}
+
+int64_t valueOf(const Metric& m) {
+    switch (m.kind()) {
+        case MetricKind::Counter: return static_cast<const MetricCounter&>(m).value();
+        case MetricKind::Gauge: return static_cast<const MetricGauge&>(m).value();
+        case MetricKind::Histogram: {
+            MetricHistogramSnapshot h;
+            static_cast<const MetricHistogram&>(m).snapshot(h);
+            return h.count;
+        }
+    }
+    return 0;
+}
+
+// One "name":value member; its length, or 0 when it does not fit
+size_t member(const Metric& m, char* buf, size_t size) {
+    int len;
+    if (m.kind() == MetricKind::Histogram) {
+        MetricHistogramSnapshot h;
+        static_cast<const MetricHistogram&>(m).snapshot(h);
+        len = snprintf(buf, size, "\"%s\":[", m.name());
+        for (uint8_t b = 0; b < METRICS_HIST_BUCKETS && len > 0 && (size_t)len < size; b++) {
+            len += snprintf(buf + len, size - len, "%lu,", (unsigned long)h.buckets[b]);
+        }
+        if (len > 0 && (size_t)len < size) {
+            len += snprintf(buf + len, size - len, "%lu,%llu]", (unsigned long)h.max, (unsigned long long)h.sum);
+        }
+    } else {
+        len = snprintf(buf, size, "\"%s\":%lld", m.name(), (long long)valueOf(m));
+    }
+    return (len > 0 && (size_t)len < size) ? (size_t)len : 0;
+}
+
+void printTime(Print& out, uint64_t value, MetricUnit unit) {
+    if (value >= 1000) {
+        out.printf("%llu%s", (unsigned long long)(value / 1000), unit == MetricUnit::Us ? "ms" : "s");
+    } else {
+        out.printf("%llu%s", (unsigned long long)value, unit == MetricUnit::Us ? "us" : "ms");
+    }
+}
+} // namespace
+
+Metric::Metric(const char* name, MetricKind kind) : name_(name), kind_(kind), next_(nullptr) {
+    portENTER_CRITICAL(&s_mux);
+    if (s_tail) {
+        s_tail->next_ = this;
+    } else {
+        s_head = this;
+    }
+    s_tail = this;
+    s_count++;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+MetricCounter::MetricCounter(const char* name, MetricCounterFn read) : Metric(name, MetricKind::Counter), read_(read) {
+    for (size_t i = 0; i < METRICS_CORES; i++) slots_[i].store(0, std::memory_order_relaxed);
+}
+
+uint32_t MetricCounter::value() const {
+    if (read_) return read_();
+    uint32_t total = 0;
+    for (size_t i = 0; i < METRICS_CORES; i++) total += slots_[i].load(std::memory_order_relaxed);
+    return total;
+}
+
+MetricGauge::MetricGauge(const char* name, MetricGaugeFn read) : Metric(name, MetricKind::Gauge), read_(read) {
+    value_.store(0, std::memory_order_relaxed);
+}
+
+MetricHistogram::MetricHistogram(const char* name, MetricUnit unit)
+    : Metric(name, MetricKind::Histogram), unit_(unit) {
+    for (size_t c = 0; c < METRICS_CORES; c++) {
+        for (size_t b = 0; b < METRICS_HIST_BUCKETS; b++) counts_[c][b].store(0, std::memory_order_relaxed);
+        sumLow_[c].store(0, std::memory_order_relaxed);
+        sumHigh_[c].store(0, std::memory_order_relaxed);
+    }
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void MetricHistogram::record(uint32_t value) {
+    const uint8_t c = core();
+    counts_[c][bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    const uint32_t low = sumLow_[c].fetch_add(value, std::memory_order_relaxed);
+    if (low + value < low) sumHigh_[c].fetch_add(1, std::memory_order_relaxed);
+    uint32_t seen = max_.load(std::memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void MetricHistogram::snapshot(MetricHistogramSnapshot& out) const {
+    out.count = 0;
+    for (size_t b = 0; b < METRICS_HIST_BUCKETS; b++) {
+        uint32_t n = 0;
+        for (size_t c = 0; c < METRICS_CORES; c++) n += counts_[c][b].load(std::memory_order_relaxed);
+        out.buckets[b] = n;
+        out.count += n;
+    }
+    out.max = max_.load(std::memory_order_relaxed);
+    out.sum = 0;
+    for (size_t c = 0; c < METRICS_CORES; c++) {
+        // Reread when a carry landed in between
+        uint32_t high;
+        uint32_t low;
+        do {
+            high = sumHigh_[c].load(std::memory_order_relaxed);
+            low = sumLow_[c].load(std::memory_order_relaxed);
+        } while (high != sumHigh_[c].load(std::memory_order_relaxed));
+        out.sum += (static_cast<uint64_t>(high) << 32) | low;
+    }
+}
+
+uint32_t metrics_bucket_limit(uint8_t b) {
+    return b < METRICS_HIST_BUCKETS - 1 ? 16UL << (2 * b) : 0;
+}
+
+uint32_t metrics_percentile(const MetricHistogramSnapshot& h, uint16_t permille) {
+    if (!h.count) return 0;
+    const uint32_t want = static_cast<uint32_t>((static_cast<uint64_t>(h.count) * permille + 999) / 1000);
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < METRICS_HIST_BUCKETS - 1; b++) {
+        seen += h.buckets[b];
+        if (seen >= want) {
+            const uint32_t limit = metrics_bucket_limit(b);
+            return h.max < limit ? h.max : limit;
+        }
+    }
+    return h.max;
+}
+
+const Metric* metrics_first() {
+    return s_head;
+}
+
+size_t metrics_count() {
+    return s_count;
+}
+
+const Metric* metrics_find(const char* name) {
+    for (const Metric* m = s_head; m; m = m->next()) {
+        if (strcmp(m->name(), name) == 0) return m;
+    }
+    return nullptr;
+}
+
+bool metrics_value(const char* name, int64_t& out) {
+    const Metric* m = metrics_find(name);
+    if (!m) return false;
+    out = valueOf(*m);
+    return true;
+}
+
+size_t metrics_export(char* buf, size_t size, size_t& cursor) {
+    int head = snprintf(buf, size, "{\"metrics\":{\"up\":%lu", (unsigned long)time_uptime_s());
+    if (head <= 0 || (size_t)head + 2 >= size) return 0;
+    size_t len = (size_t)head;
+    const Metric* m = s_head;
+    for (size_t i = 0; m && i < cursor; i++) m = m->next();
+    size_t written = 0;
+    for (; m; m = m->next()) {
+        // Room for the comma and the closing "}}"
+        if (len + 3 >= size) break;
+        const size_t n = member(*m, buf + len + 1, size - len - 3);
+        if (!n) break;
+        buf[len] = ',';
+        len += 1 + n;
+        written++;
+    }
+    if (!written && m) return 0;
+    buf[len++] = '}';
+    buf[len++] = '}';
+    buf[len] = '\0';
+    cursor += written;
+    return len;
+}
+
+void metrics_report(Print& out) {
+    out.printf("Metrics: %u registered\n", (unsigned)s_count);
+    char line[kReportLine];
+    size_t len = 0;
+    for (const Metric* m = s_head; m; m = m->next()) {
+        if (m->kind() == MetricKind::Histogram) continue;
+        char item[48];
+        const int n = snprintf(item, sizeof(item), " %s=%lld", m->name(), (long long)valueOf(*m));
+        if (n <= 0 || (size_t)n >= sizeof(item)) continue;
+        if (len && len + n >= sizeof(line)) {
+            out.printf(" %s\n", line);
+            len = 0;
+        }
+        memcpy(line + len, item, n + 1);
+        len += n;
+    }
+    if (len) out.printf(" %s\n", line);
+    for (const Metric* m = s_head; m; m = m->next()) {
+        if (m->kind() != MetricKind::Histogram) continue;
+        const MetricHistogram& hist = *static_cast<const MetricHistogram*>(m);
+        MetricHistogramSnapshot h;
+        hist.snapshot(h);
+        if (!h.count) continue;
+        out.printf("  %-14s n=%lu p50<=", m->name(), (unsigned long)h.count);
+        printTime(out, metrics_percentile(h, 500), hist.unit());
+        out.print(" p99<=");
+        printTime(out, metrics_percentile(h, 990), hist.unit());
+        out.print(" max ");
+        printTime(out, h.max, hist.unit());
+        out.print(" total ");
+        printTime(out, h.sum, hist.unit());
+        out.println();
+    }
+}
+
+void metrics_poll(uint32_t now) {
+    if (METRICS_UPLINK_MS == 0 || !s_count) return;
+    if (!s_uploading) {
+        if (s_nextUploadMs == 0) {
+            s_nextUploadMs = (now + METRICS_UPLINK_MS) | 1;
+            return;
+        }
+        if ((int32_t)(now - s_nextUploadMs) < 0) return;
+        s_uploading = true;
+        s_cursor = 0;
+    }
+    // One record per call, so a long registry does not crowd out the other traffic
+    static char json[TRANSPORT_MAX_PACKET_BYTES];   // modem task stack is tight
+    size_t cursor = s_cursor;
+    const size_t len = metrics_export(json, sizeof(json), cursor);
+    if (!len) {
+        logbuf_printf("Metrics: metric %u does not fit one record", (unsigned)s_cursor);
+        cursor = s_cursor + 1;
+    } else if (!transport_sendDiagnostic(json, len)) {
+        return;                                     // queue full; same record next time
+    }
+    s_cursor = cursor;
+    if (s_cursor >= s_count) {
+        s_uploading = false;
+        s_nextUploadMs = (now + METRICS_UPLINK_MS) | 1;
+    }
+}
+
+#endif // METRICS_ENABLE
@@ -0,0 +1,174 @@
+/*
+ * Metrics Registry
+ * Named counters, gauges and latency histograms in one list, so everything a
+ * module counts is exported the same way whichever struct it lives in:
+ *   - MetricCounter: monotonic count with one relaxed atomic slot per core;
+ *     inc() takes no lock and is safe from ISRs. Given a read function it
+ *     publishes a counter a module already keeps (TransportStats, CrashStats,
+ *     PWRCANModule) instead.
+ *   - MetricGauge: current value, set by its owner or read on export
+ *   - MetricHistogram: METRICS_HIST_BUCKETS log4 buckets from 16 us (the
+ *     mutex profiler's ladder) or from 16 ms for round trips, per core, plus
+ *     the largest sample and the sum of all of them
+ *
+ * Metrics register themselves from their constructors: define them at
+ * namespace scope next to the data they describe. Function statics (the
+ * hot_path_timer.h sites) join the list the first time their code runs;
+ * metrics are only ever added, never removed.
+ *
+ * One export: metrics_report() prints it on Serial, the system page looks
+ * values up by name, and every METRICS_UPLINK_MS the modem task sends it as
+ * Diagnostic records, as many metrics per record as fit:
+ *   {"metrics":{"up":s,"tx.sent":n,...,"can.tx_us":[b0,..,b7,max,sum]}}
+ * Values are totals since boot; "up" tells a reboot from a quiet interval.
+ * Histogram names end in their unit, _us or _ms.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include "../config/system_config.h"
+
+#ifndef METRICS_UPLINK_MS
+#define METRICS_UPLINK_MS 900000UL        // 0 = Serial and the system page only
+#endif
+#define METRICS_CORES portNUM_PROCESSORS
+#define METRICS_HIST_BUCKETS 8            // <16 <64 <256 <1k <4k <16k <65k >=65k units
+
+enum class MetricKind : uint8_t { Counter, Gauge, Histogram };
+enum class MetricUnit : uint8_t { Us, Ms };
+
+typedef uint32_t (*MetricCounterFn)();
+typedef int32_t (*MetricGaugeFn)();
+
+struct MetricHistogramSnapshot {
+    uint32_t buckets[METRICS_HIST_BUCKETS];
+    uint32_t count;
+    uint32_t max;
+    uint64_t sum;
+};
+
+#if METRICS_ENABLE
+
+class Metric {
+public:
+    const char* name() const { return name_; }
+    MetricKind kind() const { return kind_; }
+    const Metric* next() const { return next_; }
+
+protected:
+    Metric(const char* name, MetricKind kind);
+    static uint8_t core() { return static_cast<uint8_t>(xPortGetCoreID()); }
+
+private:
+    Metric(const Metric&);
+    Metric& operator=(const Metric&);
+
+    const char* name_;
+    MetricKind kind_;
+    Metric* next_;
+};
+
+class MetricCounter : public Metric {
+public:
+    explicit MetricCounter(const char* name, MetricCounterFn read = nullptr);
+
+    void inc(uint32_t n = 1) { slots_[core()].fetch_add(n, std::memory_order_relaxed); }
+    uint32_t value() const;
+
+private:
+    MetricCounterFn read_;
+    std::atomic<uint32_t> slots_[METRICS_CORES];
+};
+
+class MetricGauge : public Metric {
+public:
+    explicit MetricGauge(const char* name, MetricGaugeFn read = nullptr);
+
+    void set(int32_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(int32_t d) { value_.fetch_add(d, std::memory_order_relaxed); }
+    int32_t value() const { return read_ ? read_() : value_.load(std::memory_order_relaxed); }
+
+private:
+    MetricGaugeFn read_;
+    std::atomic<int32_t> value_;
+};
+
+class MetricHistogram : public Metric {
+public:
+    explicit MetricHistogram(const char* name, MetricUnit unit = MetricUnit::Us);
+
+    MetricUnit unit() const { return unit_; }
+    // Any task or ISR; value in the histogram's unit
+    void record(uint32_t value);
+    void snapshot(MetricHistogramSnapshot& out) const;
+
+private:
+    MetricUnit unit_;
+    std::atomic<uint32_t> counts_[METRICS_CORES][METRICS_HIST_BUCKETS];
+    std::atomic<uint32_t> max_;
+    std::atomic<uint32_t> sumLow_[METRICS_CORES];    // a carry out of the low word bumps the high one
+    std::atomic<uint32_t> sumHigh_[METRICS_CORES];
+};
+
+// Upper bound of bucket b in the histogram's unit; 0 for the last, open-ended one
+uint32_t metrics_bucket_limit(uint8_t b);
+// Upper bound of the bucket holding the given permille of the samples (500 = median)
+uint32_t metrics_percentile(const MetricHistogramSnapshot& h, uint16_t permille);
+
+const Metric* metrics_first();
+size_t metrics_count();
+const Metric* metrics_find(const char* name);
+// Counter or gauge value, histogram sample count; false when there is no such metric
+bool metrics_value(const char* name, int64_t& out);
+
+// {"metrics":{...}} with the metrics from index cursor on, as many as fit in size;
+// cursor moves past those written (== metrics_count() when all are in). 0 when
+// buf cannot hold even the next one.
+size_t metrics_export(char* buf, size_t size, size_t& cursor);
+void metrics_report(Print& out);
+// Sends the export as Diagnostic records every METRICS_UPLINK_MS; call from the modem task
+void metrics_poll(uint32_t now);
+
+#else
+
+class Metric;
+
+class MetricCounter {
+public:
+    explicit MetricCounter(const char*, MetricCounterFn = nullptr) {}
+    void inc(uint32_t = 1) {}
+    uint32_t value() const { return 0; }
+};
+
+class MetricGauge {
+public:
+    explicit MetricGauge(const char*, MetricGaugeFn = nullptr) {}
+    void set(int32_t) {}
+    void add(int32_t) {}
+    int32_t value() const { return 0; }
+};
+
+class MetricHistogram {
+public:
+    explicit MetricHistogram(const char*, MetricUnit = MetricUnit::Us) {}
+    void record(uint32_t) {}
+    void snapshot(MetricHistogramSnapshot& out) const { out = MetricHistogramSnapshot(); }
+};
+
+inline uint32_t metrics_bucket_limit(uint8_t) { return 0; }
+inline uint32_t metrics_percentile(const MetricHistogramSnapshot&, uint16_t) { return 0; }
+inline const Metric* metrics_first() { return nullptr; }
+inline size_t metrics_count() { return 0; }
+inline const Metric* metrics_find(const char*) { return nullptr; }
+inline bool metrics_value(const char*, int64_t&) { return false; }
+inline size_t metrics_export(char*, size_t, size_t&) { return 0; }
+inline void metrics_report(Print&) {}
+inline void metrics_poll(uint32_t) {}
+
+#endif // METRICS_ENABLE
+
+#endif // METRICS_H
@@ -0,0 +1,335 @@
+/*
+ * Mutex Contention Profiler Implementation
+ */
+
+#include "mutex_profiler.h"
+
+#if MUTEX_PROFILE_ENABLE
+
+#include <freertos/task.h>
+#include <string.h>
+
+namespace {
+constexpr int8_t kNone = -1;
+
+struct Site {
+    const char* file;
+    uint16_t line;
+    int8_t mutex;
+    uint32_t takes;
+    uint32_t contended;
+    uint32_t timeouts;
+    uint32_t waitMaxUs;
+    uint32_t holdMaxUs;
+};
+
+struct Mutex {
+    SemaphoreHandle_t handle;
+    const char* name;
+    int8_t firstSite;
+    int8_t holderSite;
+    uint32_t heldSinceUs;
+    uint32_t takes;
+    uint32_t contended;
+    uint32_t timeouts;
+    uint32_t waitMaxUs;
+    uint32_t holdMaxUs;
+    uint64_t waitTotalUs;
+    uint64_t holdTotalUs;
+    uint32_t holds;
+    uint32_t windowStartMs;
+    uint32_t windowMaxUs;
+    uint32_t prevWindowMaxUs;
+    uint32_t waitHist[MUTEX_PROFILE_BUCKETS];
+    uint32_t holdHist[MUTEX_PROFILE_BUCKETS];
+    uint32_t timeoutAtMs;
+    char timeoutWaiter[MUTEX_PROFILE_NAME_BYTES];
+    char timeoutOwner[MUTEX_PROFILE_NAME_BYTES];
+    int8_t timeoutOwnerSite;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Mutex s_mutexes[MUTEX_PROFILE_MUTEXES];
+Site s_sites[MUTEX_PROFILE_SITES];
+uint32_t s_overflow = 0;     // takes not recorded: a table was full
+
+// Log4 buckets from 16 us
+uint8_t bucket(uint32_t us) {
+    uint8_t b = 0;
+    for (uint32_t v = us >> 4; v && b < MUTEX_PROFILE_BUCKETS - 1; v >>= 2) b++;
+    return b;
+}
+
+// Under s_mux
+int8_t findMutex(SemaphoreHandle_t handle, bool create) {
+    int8_t empty = kNone;
+    for (int8_t i = 0; i < MUTEX_PROFILE_MUTEXES; i++) {
+        if (s_mutexes[i].handle == handle) return i;
+        if (!s_mutexes[i].handle && empty == kNone) empty = i;
+    }
+    if (!create || empty == kNone) return kNone;
+    Mutex& m = s_mutexes[empty];
+    memset(&m, 0, sizeof(m));
+    m.handle = handle;
+    m.firstSite = kNone;
+    m.holderSite = kNone;
+    m.timeoutOwnerSite = kNone;
+    m.windowStartMs = millis();
+    return empty;
+}
+
+// Under s_mux
+int8_t findSite(const char* file, uint16_t line, int8_t mutex) {
+    for (int8_t i = 0; i < MUTEX_PROFILE_SITES; i++) {
+        Site& s = s_sites[i];
+        if (!s.file) {
+            memset(&s, 0, sizeof(s));
+            s.file = file;
+            s.line = line;
+            s.mutex = mutex;
+            return i;
+        }
+        if (s.line == line && s.mutex == mutex && s.file == file) return i;
+    }
+    return kNone;
+}
+
+const char* baseName(const char* path) {
+    const char* slash = path ? strrchr(path, '/') : nullptr;
+    return slash ? slash + 1 : (path ? path : "?");
+}
+
+void copyName(char* out, TaskHandle_t task) {
+    const char* name = task ? pcTaskGetName(task) : "-";
+    strncpy(out, name ? name : "?", MUTEX_PROFILE_NAME_BYTES - 1);
+    out[MUTEX_PROFILE_NAME_BYTES - 1] = '\0';
+}
+
+// Under s_mux
+void rollWindow(Mutex& m, uint32_t nowMs) {
+    if (nowMs - m.windowStartMs < MUTEX_PROFILE_WINDOW_MS) return;
+    // A window with no takes at all clears both
+    m.prevWindowMaxUs = nowMs - m.windowStartMs < 2 * MUTEX_PROFILE_WINDOW_MS ? m.windowMaxUs : 0;
+    m.windowMaxUs = 0;
+    m.windowStartMs = nowMs;
+}
+
+// Under s_mux
+void fill(MutexProfileStats& out, Mutex& m) {
+    memset(&out, 0, sizeof(out));
+    out.name = m.name ? m.name : (m.firstSite != kNone ? baseName(s_sites[m.firstSite].file) : "?");
+    out.takes = m.takes;
+    out.contended = m.contended;
+    out.timeouts = m.timeouts;
+    out.waitMaxUs = m.waitMaxUs;
+    out.holdMaxUs = m.holdMaxUs;
+    out.waitAvgUs = m.takes ? static_cast<uint32_t>(m.waitTotalUs / m.takes) : 0;
+    out.holdAvgUs = m.holds ? static_cast<uint32_t>(m.holdTotalUs / m.holds) : 0;
+    rollWindow(m, millis());
+    out.recentWaitMaxUs = max(m.windowMaxUs, m.prevWindowMaxUs);
+    memcpy(out.waitHist, m.waitHist, sizeof(out.waitHist));
+    memcpy(out.holdHist, m.holdHist, sizeof(out.holdHist));
+    out.timeoutAtMs = m.timeoutAtMs;
+    memcpy(out.timeoutWaiter, m.timeoutWaiter, sizeof(out.timeoutWaiter));
+    memcpy(out.timeoutOwner, m.timeoutOwner, sizeof(out.timeoutOwner));
+    if (m.timeoutOwnerSite != kNone) {
+        out.timeoutOwnerFile = s_sites[m.timeoutOwnerSite].file;
+        out.timeoutOwnerLine = s_sites[m.timeoutOwnerSite].line;
+    }
+}
+
+void printHist(Print& out, const char* label, const uint32_t* hist) {
+    out.printf("    %s:", label);
+    for (uint8_t b = 0; b < MUTEX_PROFILE_BUCKETS; b++) out.printf(" %lu", (unsigned long)hist[b]);
+    out.println();
+}
+} // namespace
+
+bool mutex_take(SemaphoreHandle_t mutex, TickType_t timeout, const char* file, int line) {
+    if (!mutex) return false;
+    const uint32_t start = micros();
+    const bool ok = xSemaphoreTake(mutex, timeout) == pdTRUE;
+    if (ok) power_mutex_taken(mutex);
+    const uint32_t now = micros();
+    const uint32_t waitUs = now - start;
+
+    // Owner names are read outside the spinlock; the holder query takes the queue lock
+    char waiter[MUTEX_PROFILE_NAME_BYTES] = {};
+    char owner[MUTEX_PROFILE_NAME_BYTES] = {};
+    const bool timedOut = !ok && timeout > 0;
+    if (timedOut) {
+        copyName(waiter, xTaskGetCurrentTaskHandle());
+        copyName(owner, static_cast<TaskHandle_t>(xSemaphoreGetMutexHolder(mutex)));
+    }
+
+    const uint32_t nowMs = millis();
+    portENTER_CRITICAL(&s_mux);
+    const int8_t m = findMutex(mutex, true);
+    const int8_t s = m != kNone ? findSite(file, static_cast<uint16_t>(line), m) : kNone;
+    if (m == kNone || s == kNone) {
+        s_overflow++;
+        portEXIT_CRITICAL(&s_mux);
+        return ok;
+    }
+    Mutex& mx = s_mutexes[m];
+    Site& site = s_sites[s];
+    if (mx.firstSite == kNone) mx.firstSite = s;
+    const bool contended = !ok || waitUs > MUTEX_PROFILE_CONTENDED_US;
+    mx.takes++;
+    site.takes++;
+    if (contended) {
+        mx.contended++;
+        site.contended++;
+    }
+    mx.waitTotalUs += waitUs;
+    mx.waitHist[bucket(waitUs)]++;
+    if (waitUs > mx.waitMaxUs) mx.waitMaxUs = waitUs;
+    if (waitUs > site.waitMaxUs) site.waitMaxUs = waitUs;
+    rollWindow(mx, nowMs);
+    if (waitUs > mx.windowMaxUs) mx.windowMaxUs = waitUs;
+    if (ok) {
+        mx.heldSinceUs = now;
+        mx.holderSite = s;
+    } else if (timedOut) {
+        mx.timeouts++;
+        site.timeouts++;
+        mx.timeoutAtMs = nowMs;
+        memcpy(mx.timeoutWaiter, waiter, sizeof(waiter));
+        memcpy(mx.timeoutOwner, owner, sizeof(owner));
+        mx.timeoutOwnerSite = mx.holderSite;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+void mutex_give(SemaphoreHandle_t mutex) {
+    if (!mutex) return;
+    portENTER_CRITICAL(&s_mux);
+    const int8_t m = findMutex(mutex, false);
+    if (m != kNone && s_mutexes[m].holderSite != kNone) {
+        Mutex& mx = s_mutexes[m];
+        const uint32_t holdUs = micros() - mx.heldSinceUs;
+        Site& site = s_sites[mx.holderSite];
+        mx.holds++;
+        mx.holdTotalUs += holdUs;
+        mx.holdHist[bucket(holdUs)]++;
+        if (holdUs > mx.holdMaxUs) mx.holdMaxUs = holdUs;
+        if (holdUs > site.holdMaxUs) site.holdMaxUs = holdUs;
+        mx.holderSite = kNone;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    xSemaphoreGive(mutex);
+    power_mutex_given(mutex);
+}
+
+void mutex_profile_name(SemaphoreHandle_t mutex, const char* name) {
+    if (!mutex) return;
+    portENTER_CRITICAL(&s_mux);
+    const int8_t m = findMutex(mutex, true);
+    if (m != kNone) s_mutexes[m].name = name;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+size_t mutex_profile_stats(MutexProfileStats* out, size_t max) {
+    if (!out) return 0;
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (int8_t i = 0; i < MUTEX_PROFILE_MUTEXES && n < max; i++) {
+        if (!s_mutexes[i].handle || !s_mutexes[i].takes) continue;
+        fill(out[n++], s_mutexes[i]);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+bool mutex_profile_worst(MutexProfileStats& out) {
+    int8_t worst = kNone;
+    uint32_t worstUs = 0;
+    const uint32_t nowMs = millis();
+    portENTER_CRITICAL(&s_mux);
+    for (int8_t i = 0; i < MUTEX_PROFILE_MUTEXES; i++) {
+        Mutex& m = s_mutexes[i];
+        if (!m.handle) continue;
+        rollWindow(m, nowMs);
+        const uint32_t us = max(m.windowMaxUs, m.prevWindowMaxUs);
+        if (us > worstUs) {
+            worstUs = us;
+            worst = i;
+        }
+    }
+    if (worst != kNone) fill(out, s_mutexes[worst]);
+    portEXIT_CRITICAL(&s_mux);
+    return worst != kNone && worstUs > MUTEX_PROFILE_CONTENDED_US;
+}
+
+void mutex_profile_report(Print& out) {
+    // One entry copied at a time: the report runs on small stacks (service task)
+    bool header = false;
+    for (int8_t i = 0; i < MUTEX_PROFILE_MUTEXES; i++) {
+        MutexProfileStats m;
+        portENTER_CRITICAL(&s_mux);
+        const bool used = s_mutexes[i].handle && s_mutexes[i].takes;
+        if (used) fill(m, s_mutexes[i]);
+        portEXIT_CRITICAL(&s_mux);
+        if (!used) continue;
+        if (!header) {
+            out.println("Mutexes: name takes contended timeouts wait avg/max us hold avg/max us");
+            header = true;
+        }
+        out.printf("  %-16s %7lu %6lu %4lu %6lu/%-8lu %6lu/%lu\n", m.name, (unsigned long)m.takes,
+                   (unsigned long)m.contended, (unsigned long)m.timeouts, (unsigned long)m.waitAvgUs,
+                   (unsigned long)m.waitMaxUs, (unsigned long)m.holdAvgUs, (unsigned long)m.holdMaxUs);
+        if (m.contended) {
+            printHist(out, "wait <16u/64u/256u/1m/4m/16m/65m/more", m.waitHist);
+            printHist(out, "hold <16u/64u/256u/1m/4m/16m/65m/more", m.holdHist);
+        }
+        if (m.timeouts) {
+            out.printf("    last timeout at %lu ms: %s waited, %s held it from %s:%u\n",
+                       (unsigned long)m.timeoutAtMs, m.timeoutWaiter, m.timeoutOwner,
+                       baseName(m.timeoutOwnerFile), (unsigned)m.timeoutOwnerLine);
+        }
+    }
+    if (!header) return;
+
+    out.println("Mutex call sites: site mutex takes contended timeouts wait/hold max us");
+    for (int8_t i = 0; i < MUTEX_PROFILE_SITES; i++) {
+        portENTER_CRITICAL(&s_mux);
+        const Site s = s_sites[i];
+        const Mutex& mx = s_mutexes[s.mutex];
+        const char* name = !s.file ? nullptr : mx.name ? mx.name : mx.firstSite != kNone ? baseName(s_sites[mx.firstSite].file) : "?";
+        portEXIT_CRITICAL(&s_mux);
+        if (!s.file) break;
+        if (!s.takes) continue;
+        out.printf("  %s:%u %s %lu %lu %lu %lu/%lu\n", baseName(s.file), (unsigned)s.line, name,
+                   (unsigned long)s.takes, (unsigned long)s.contended, (unsigned long)s.timeouts,
+                   (unsigned long)s.waitMaxUs, (unsigned long)s.holdMaxUs);
+    }
+    if (s_overflow) out.printf("  %lu takes not recorded (tables full)\n", (unsigned long)s_overflow);
+}
+
+void mutex_profile_reset() {
+    portENTER_CRITICAL(&s_mux);
+    const uint32_t nowMs = millis();
+    for (Mutex& m : s_mutexes) {
+        if (!m.handle) continue;
+        const SemaphoreHandle_t handle = m.handle;
+        const char* name = m.name;
+        const int8_t holder = m.holderSite;
+        const uint32_t heldSince = m.heldSinceUs;
+        memset(&m, 0, sizeof(m));
+        m.handle = handle;
+        m.name = name;
+        m.firstSite = kNone;
+        m.holderSite = holder;     // a hold in progress still ends with a give
+        m.heldSinceUs = heldSince;
+        m.timeoutOwnerSite = kNone;
+        m.windowStartMs = nowMs;
+    }
+    for (Site& s : s_sites) {
+        s.takes = s.contended = s.timeouts = s.waitMaxUs = s.holdMaxUs = 0;
+    }
+    s_overflow = 0;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+#endif // MUTEX_PROFILE_ENABLE
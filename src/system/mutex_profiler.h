@@ -0,0 +1,98 @@
+/*
+ * Mutex Contention Profiler
+ * mutex_take()/mutex_give() are drop-ins for xSemaphoreTake/xSemaphoreGive on
+ * mutexes (MutexGuard uses them) that measure, per mutex:
+ *   - wait and hold time histograms (MUTEX_PROFILE_BUCKETS log4 buckets from 16 us)
+ *   - contended takes (waited longer than MUTEX_PROFILE_CONTENDED_US) and timeouts
+ *   - at the last timeout: the waiting task, the owning task and the call site
+ *     the owner took the mutex from
+ * and per call site (file:line, captured with __builtin_FILE/LINE defaults):
+ * takes, contended takes, timeouts, longest wait and longest hold.
+ *
+ * Mutexes from the kernel object table are named after their task_config.h row;
+ * others show up as the first call site that took them. Takes from code that
+ * still calls xSemaphoreTake directly are not seen, but their hold time shows up
+ * as other sites' waits.
+ *
+ * Both also hold the PM lock of mutexes bound in power_manager.h while they are held.
+ */
+
+#ifndef MUTEX_PROFILER_H
+#define MUTEX_PROFILER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "../config/system_config.h"
+#include "power_manager.h"
+
+#ifndef MUTEX_PROFILE_MUTEXES
+#define MUTEX_PROFILE_MUTEXES 16
+#endif
+#ifndef MUTEX_PROFILE_SITES
+#define MUTEX_PROFILE_SITES 64
+#endif
+#ifndef MUTEX_PROFILE_CONTENDED_US
+#define MUTEX_PROFILE_CONTENDED_US 100
+#endif
+#ifndef MUTEX_PROFILE_WINDOW_MS
+#define MUTEX_PROFILE_WINDOW_MS 60000      // "recent" worst wait on the system page
+#endif
+#define MUTEX_PROFILE_BUCKETS 8            // <16us <64us <256us <1ms <4ms <16ms <65ms >=65ms
+#define MUTEX_PROFILE_NAME_BYTES 12
+
+struct MutexProfileStats {
+    const char* name;
+    uint32_t takes;
+    uint32_t contended;
+    uint32_t timeouts;
+    uint32_t waitMaxUs;
+    uint32_t holdMaxUs;
+    uint32_t waitAvgUs;
+    uint32_t holdAvgUs;
+    uint32_t recentWaitMaxUs;          // worst wait over the last one to two windows
+    uint32_t waitHist[MUTEX_PROFILE_BUCKETS];
+    uint32_t holdHist[MUTEX_PROFILE_BUCKETS];
+    // Last timeout
+    uint32_t timeoutAtMs;
+    char timeoutWaiter[MUTEX_PROFILE_NAME_BYTES];
+    char timeoutOwner[MUTEX_PROFILE_NAME_BYTES];
+    const char* timeoutOwnerFile;      // where the owner took it; null if not via mutex_take
+    uint16_t timeoutOwnerLine;
+};
+
+#if MUTEX_PROFILE_ENABLE
+
+bool mutex_take(SemaphoreHandle_t mutex, TickType_t timeout, const char* file = __builtin_FILE(),
+                int line = __builtin_LINE());
+void mutex_give(SemaphoreHandle_t mutex);
+
+// Names a mutex in the report (kernel_objects names the task_config.h mutexes)
+void mutex_profile_name(SemaphoreHandle_t mutex, const char* name);
+
+size_t mutex_profile_stats(MutexProfileStats* out, size_t max);
+// Mutex with the worst recent wait; false when nothing was contended
+bool mutex_profile_worst(MutexProfileStats& out);
+void mutex_profile_report(Print& out);
+void mutex_profile_reset();
+
+#else
+
+inline bool mutex_take(SemaphoreHandle_t mutex, TickType_t timeout, const char* = nullptr, int = 0) {
+    const bool ok = xSemaphoreTake(mutex, timeout) == pdTRUE;
+    if (ok) power_mutex_taken(mutex);
+    return ok;
+}
+inline void mutex_give(SemaphoreHandle_t mutex) {
+    xSemaphoreGive(mutex);
+    power_mutex_given(mutex);
+}
+inline void mutex_profile_name(SemaphoreHandle_t, const char*) {}
+inline size_t mutex_profile_stats(MutexProfileStats*, size_t) { return 0; }
+inline bool mutex_profile_worst(MutexProfileStats&) { return false; }
+inline void mutex_profile_report(Print&) {}
+inline void mutex_profile_reset() {}
+
+#endif // MUTEX_PROFILE_ENABLE
+
+#endif // MUTEX_PROFILER_H
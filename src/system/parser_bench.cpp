@@ -0,0 +1,180 @@
+#include "parser_bench.h"
+#include "heap_profiler.h"
+#include "../config/system_config.h"
+#include "../modules/catm_gnss/attach_cache.h"
+#include "../modules/catm_gnss/catm_gnss_module.h"
+#include "../modules/settings/settings_store.h"
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <stdlib.h>
+#include <string.h>
+#if ENABLE_PWRCAN
+#include "../modules/pwrcan/can_dispatch.h"
+#include "../modules/pwrcan/can_generator_protocol.h"
+#endif
+
+namespace {
+const char kCgnsinf[] =
+    "+CGNSINF: 1,1,20250617120000.000,35.681236,139.767125,40.500,0.00,0.0,1,,1.1,1.4,0.9,,12,8,,,42,,\r\n"
+    "\r\nOK\r\n";
+const char kCnact[] =
+    "+CNACT: 0,1,\"10.123.45.67\"\r\n+CNACT: 1,0,\"0.0.0.0\"\r\n+CNACT: 2,0,\"0.0.0.0\"\r\n"
+    "+CNACT: 3,0,\"0.0.0.0\"\r\n\r\nOK\r\n";
+const char kNetDevStatus[] = "+NETDEVSTATUS: 0,1,18234,92817,12,40\r\n\r\nOK\r\n";
+const char kCpsi[] = "+CPSI: LTE CAT-M1,Online,440-10,0x1A2B,26543617,210,EUTRAN-BAND19,6200,5,5,-11,-95,-67,14\r\n\r\nOK\r\n";
+const char kUgnsinf[] = "+UGNSINF: 1,1,20250617120000.000,35.681236,139.767125,40.500,0.00,0.0,1,,1.1,1.4,0.9,,12,8,,,42,,";
+const char kGnssUtc[] = "20250617120000.000";
+const char kUrl[] = "https://thingsboard.cloud/api/v1/ACCESS_TOKEN/telemetry";
+const char kConnectionJson[] =
+    "{\"apn\":\"soracom.io\",\"apnUser\":\"sora\",\"apnPass\":\"sora\","
+    "\"httpHost\":\"thingsboard.cloud\",\"httpPort\":443,\"httpToken\":\"A1B2C3D4E5F6G7H8I9J0\"}";
+
+// The field conversion GNSS parsing used before the in-place parser: copy each
+// field out and strtod it. Kept as the baseline the parseInfo numbers are read against.
+bool strtodCgnsinf(const char* p, sim7080g::GNSSFix& fix) {
+    p = strchr(p, ':');
+    if (!p) return false;
+    double v[15] = {};
+    for (size_t i = 0; i < 15 && p; i++) {
+        const char* s = p + 1;
+        p = strchr(s, ',');
+        const size_t len = p ? (size_t)(p - s) : strlen(s);
+        char tmp[32];
+        if (len >= sizeof(tmp)) return false;
+        memcpy(tmp, s, len);
+        tmp[len] = '\0';
+        v[i] = strtod(tmp, nullptr);
+    }
+    fix.latitude = v[3];
+    fix.longitude = v[4];
+    fix.altitude_m = v[5];
+    fix.speed_kph = v[6];
+    fix.course_deg = v[7];
+    fix.hdop = (float)v[10];
+    fix.pdop = (float)v[11];
+    fix.vdop = (float)v[12];
+    fix.satellites = (uint8_t)v[14];
+    fix.valid = v[0] != 0 && v[1] != 0;
+    return fix.valid;
+}
+
+uint64_t allocCount() {
+    return heap_profile_totals().allocs;
+}
+} // namespace
+
+// Friend of CatMGNSSModule, for its private parsers
+class ParserBench {
+public:
+    explicit ParserBench(ParserBenchResult& r) : r_(r) {}
+
+    template <typename F>
+    void measure(const char* name, uint32_t iterations, F fn) {
+        if (r_.count >= PARSER_BENCH_MAX_CASES) return;
+        ParserBenchCase& c = r_.cases[r_.count++];
+        c.name = name;
+        c.iterations = iterations;
+        c.ok = fn();   // warm-up; first-call allocations are not the steady state
+        const uint64_t allocs0 = allocCount();
+        const int64_t t0 = esp_timer_get_time();
+        for (uint32_t i = 0; i < iterations; i++) fn();
+        const int64_t us = esp_timer_get_time() - t0;
+        const uint64_t allocs = allocCount() - allocs0;
+        c.nsPerOp = (uint32_t)(us * 1000 / iterations);
+        c.allocsPerOp = HEAP_PROFILE_ENABLE ? (int32_t)(allocs * 100 / iterations) : -1;
+    }
+
+    void modemCases() {
+        const String cnact(kCnact);
+        const String netdev(kNetDevStatus);
+        const String cpsi(kCpsi);
+        const String url(kUrl);
+        GNSSData gnss = {};
+        measure("parseCgnsinf", PARSER_BENCH_ITERATIONS, [&]() { return CatMGNSSModule::parseCgnsinf(kCgnsinf, gnss); });
+        measure("GNSS parseInfo", PARSER_BENCH_ITERATIONS, [&]() {
+            sim7080g::GNSSFix fix;
+            char utc[24];
+            return SIM7080G_GNSS::parseInfo(kUgnsinf + 10, sizeof(kUgnsinf) - 11, fix, utc, sizeof(utc)) && fix.valid;
+        });
+        measure("GNSS strtod (ref)", PARSER_BENCH_ITERATIONS, [&]() {
+            sim7080g::GNSSFix fix;
+            return strtodCgnsinf(kUgnsinf, fix);
+        });
+        measure("parseGnssUtc", PARSER_BENCH_ITERATIONS, [&]() { return CatMGNSSModule::parseGnssUtc(kGnssUtc, gnss); });
+        measure("parseCNACTResponse", PARSER_BENCH_ITERATIONS, [&]() {
+            bool active = false;
+            String ip;
+            return CatMGNSSModule::parseCNACTResponse(cnact, active, ip);
+        });
+        measure("parseNetDevStatus", PARSER_BENCH_ITERATIONS, [&]() {
+            uint64_t tx = 0;
+            uint64_t rx = 0;
+            uint32_t txBps = 0;
+            uint32_t rxBps = 0;
+            return CatMGNSSModule::parseNetDevStatus(netdev, tx, rx, txBps, rxBps);
+        });
+        measure("parseHttpUrl", PARSER_BENCH_ITERATIONS, [&]() {
+            SIM7080G_String base;
+            SIM7080G_String path;
+            return CatMGNSSModule::parseHttpUrl(url, base, path);
+        });
+        measure("attach_parse_cpsi", PARSER_BENCH_ITERATIONS, [&]() {
+            char plmn[8];
+            uint8_t band = 0;
+            return attach_parse_cpsi(cpsi, plmn, sizeof(plmn), band);
+        });
+    }
+
+private:
+    ParserBenchResult& r_;
+};
+
+void parserBench_run(Print& out, ParserBenchResult* result) {
+    ParserBenchResult local;
+    ParserBenchResult& r = result ? *result : local;
+    memset(&r, 0, sizeof(r));
+    const uint32_t start = millis();
+    ParserBench bench(r);
+
+    bench.modemCases();
+
+    // Same document size and fields as the connection.json import
+    bench.measure("settings json", PARSER_BENCH_ITERATIONS, []() {
+        StaticJsonDocument<512> doc;
+        if (deserializeJson(doc, kConnectionJson, sizeof(kConnectionJson) - 1)) return false;
+        AppSettings s;
+        strlcpy(s.apn, doc["apn"] | "", sizeof(s.apn));
+        strlcpy(s.httpHost, doc["httpHost"] | "", sizeof(s.httpHost));
+        strlcpy(s.httpToken, doc["httpToken"] | "", sizeof(s.httpToken));
+        s.httpPort = doc["httpPort"] | 443;
+        return s.httpPort != 0;
+    });
+
+#if ENABLE_PWRCAN
+    CanDispatcher* dispatcher = new CanDispatcher();
+    CanGeneratorProtocol* generator = new CanGeneratorProtocol();
+    if (dispatcher && generator && generator->registerRoutes(*dispatcher)) {
+        // Runtime frames only touch the protocol object; sensor frames feed the analog sampler
+        static const uint8_t kRuntime[8] = {0x10, 0x27, 0x00, 0x00, 0x80, 0x3E, 0x52, 0x68};
+        bench.measure("CAN generator frame", PARSER_BENCH_ITERATIONS, [&]() {
+            return dispatcher->dispatch(CAN_ID_GENERATOR_RUNTIME, false, kRuntime, sizeof(kRuntime));
+        });
+    }
+    delete generator;
+    delete dispatcher;
+#endif
+
+    r.totalMs = millis() - start;
+    out.printf("Parser benchmark (%lu ms):\n", (unsigned long)r.totalMs);
+    for (size_t i = 0; i < r.count; i++) {
+        const ParserBenchCase& c = r.cases[i];
+        if (c.allocsPerOp >= 0) {
+            out.printf("  %-20s %7lu ns/op %3ld.%02ld allocs/op x%lu%s\n", c.name, (unsigned long)c.nsPerOp,
+                       (long)(c.allocsPerOp / 100), (long)(c.allocsPerOp % 100), (unsigned long)c.iterations,
+                       c.ok ? "" : " (rejected)");
+        } else {
+            out.printf("  %-20s %7lu ns/op x%lu%s\n", c.name, (unsigned long)c.nsPerOp,
+                       (unsigned long)c.iterations, c.ok ? "" : " (rejected)");
+        }
+    }
+}
@@ -0,0 +1,43 @@
+/*
+ * Parser Benchmark
+ * Runs the firmware's text and frame parsers over canned modem replies, a
+ * connection.json and a generator CAN frame, and prints ns per parse and heap
+ * allocations per parse, so a parser change can be compared against the
+ * numbers of the build before it. The GNSS fields also run through the strtod
+ * conversion they replaced, as a baseline in the same table. Parsers write
+ * into scratch objects; nothing the tasks read is touched.
+ *
+ * Allocation counts come from the heap profiler (HEAP_PROFILE_ENABLE); without
+ * it only the timings are reported.
+ */
+
+#ifndef PARSER_BENCH_H
+#define PARSER_BENCH_H
+
+#include <Arduino.h>
+
+#ifndef PARSER_BENCH_ITERATIONS
+#define PARSER_BENCH_ITERATIONS 1000
+#endif
+
+#define PARSER_BENCH_MAX_CASES 12
+
+struct ParserBenchCase {
+    const char* name;
+    uint32_t iterations;
+    uint32_t nsPerOp;
+    int32_t allocsPerOp;     // x100; -1 without the heap profiler
+    bool ok;                 // the parser accepted the sample
+};
+
+struct ParserBenchResult {
+    ParserBenchCase cases[PARSER_BENCH_MAX_CASES];
+    size_t count;
+    uint32_t totalMs;
+};
+
+// Blocks for the whole run (well under a second at the defaults); call before
+// the tasks start. Prints the table on out and fills result when given.
+void parserBench_run(Print& out, ParserBenchResult* result = nullptr);
+
+#endif // PARSER_BENCH_H
@@ -0,0 +1,385 @@
+/*
+ * Power Manager Implementation
+ */
+
+#include "power_manager.h"
+
+#if POWER_PM_ENABLE
+
+#include "service_task.h"
+#include "energy_account.h"
+#include "../modules/logging/log_buffer.h"
+#include <esp_idf_version.h>
+#include <esp_timer.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <math.h>
+#include <stdio.h>
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+
+namespace {
+constexpr size_t kModes = static_cast<size_t>(PowerMode::Count);
+constexpr size_t kLocks = static_cast<size_t>(PowerLock::Count);
+constexpr size_t kBindings = 4;
+
+const char* const kModeNames[kModes] = {"full", "dfs", "light-sleep"};
+const char* const kLockNames[kLocks] = {"uart", "sd", "display"};
+
+struct Lock {
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t handle;     // APB_FREQ_MAX: keeps the clock and blocks light sleep
+#endif
+    uint16_t depth;
+    uint32_t sinceMs;
+    uint32_t holds;
+    uint32_t heldMs;
+    uint32_t maxHeldMs;
+};
+
+struct Binding {
+    SemaphoreHandle_t mutex;
+    PowerLock lock;
+};
+
+struct ModeAcc {
+    uint32_t ms;
+    uint32_t samples;
+    double sumMa;
+    float minMa;
+    float maxMa;
+};
+
+struct Survey {
+    bool active;
+    PowerMode restore;
+    PowerMode step;
+    uint32_t stepMs;
+    uint32_t dwellMs;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Lock s_locks[kLocks];
+Binding s_bindings[kBindings];
+ModeAcc s_modes[kModes];
+Survey s_survey;
+PowerMode s_mode = PowerMode::Full;
+uint32_t s_modeSinceMs = 0;
+bool s_skipSample = false;          // the INA226 window after a switch spans both modes
+PowerCurrentFn s_current = nullptr;
+esp_timer_handle_t s_linger = nullptr;
+bool s_lingering = false;
+int s_job = SERVICE_JOB_NONE;
+
+void take(PowerLock lock) {
+    Lock& l = s_locks[static_cast<size_t>(lock)];
+#if CONFIG_PM_ENABLE
+    if (l.handle) esp_pm_lock_acquire(l.handle);
+#endif
+    portENTER_CRITICAL(&s_mux);
+    if (l.depth++ == 0) {
+        l.sinceMs = millis();
+        l.holds++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void drop(PowerLock lock) {
+    Lock& l = s_locks[static_cast<size_t>(lock)];
+    portENTER_CRITICAL(&s_mux);
+    if (l.depth && --l.depth == 0) {
+        const uint32_t held = millis() - l.sinceMs;
+        l.heldMs += held;
+        if (held > l.maxHeldMs) l.maxHeldMs = held;
+    }
+    portEXIT_CRITICAL(&s_mux);
+#if CONFIG_PM_ENABLE
+    if (l.handle) esp_pm_lock_release(l.handle);
+#endif
+}
+
+void lingerDone(void*) {
+    portENTER_CRITICAL(&s_mux);
+    const bool was = s_lingering;
+    s_lingering = false;
+    portEXIT_CRITICAL(&s_mux);
+    if (was) drop(PowerLock::Uart);
+}
+
+// Under s_mux
+void closeMode(uint32_t now) {
+    s_modes[static_cast<size_t>(s_mode)].ms += now - s_modeSinceMs;
+    s_modeSinceMs = now;
+}
+
+bool apply(PowerMode mode) {
+    if (!power_mode_available(mode)) return false;
+#if CONFIG_PM_ENABLE
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t cfg = {};
+#else
+    esp_pm_config_esp32s3_t cfg = {};
+#endif
+    cfg.max_freq_mhz = POWER_MAX_MHZ;
+    cfg.min_freq_mhz = mode == PowerMode::Full ? POWER_MAX_MHZ : POWER_MIN_MHZ;
+    cfg.light_sleep_enable = mode == PowerMode::LightSleep;
+    const esp_err_t err = esp_pm_configure(&cfg);
+    if (err != ESP_OK) {
+        logbuf_printf("Power: %s mode failed (%d)", kModeNames[static_cast<size_t>(mode)], (int)err);
+        return false;
+    }
+#endif
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&s_mux);
+    closeMode(now);
+    s_mode = mode;
+    s_skipSample = true;
+    portEXIT_CRITICAL(&s_mux);
+    energy_state(mode);
+    return true;
+}
+
+// Next mode this build can run after from, or Count
+PowerMode nextAvailable(PowerMode from) {
+    for (size_t m = static_cast<size_t>(from) + 1; m < kModes; m++) {
+        if (power_mode_available(static_cast<PowerMode>(m))) return static_cast<PowerMode>(m);
+    }
+    return PowerMode::Count;
+}
+
+void enterSurveyStep(PowerMode mode, uint32_t now) {
+    portENTER_CRITICAL(&s_mux);
+    s_modes[static_cast<size_t>(mode)] = ModeAcc{0, 0, 0.0, 0.0f, 0.0f};
+    s_survey.step = mode;
+    s_survey.stepMs = now;
+    portEXIT_CRITICAL(&s_mux);
+    apply(mode);
+}
+
+void sampleJob(void*) {
+    const uint32_t now = millis();
+    if (s_survey.active && now - s_survey.stepMs >= s_survey.dwellMs) {
+        const PowerMode next = nextAvailable(s_survey.step);
+        if (next != PowerMode::Count) {
+            enterSurveyStep(next, now);
+        } else {
+            s_survey.active = false;
+            apply(s_survey.restore);
+            logbuf_printf("Power: survey done, back to %s", kModeNames[static_cast<size_t>(s_survey.restore)]);
+        }
+    }
+    if (!s_current) return;
+    const float amps = s_current();
+    if (isnan(amps)) return;
+    const float ma = amps * 1000.0f;
+
+    portENTER_CRITICAL(&s_mux);
+    if (s_skipSample) {
+        s_skipSample = false;
+    } else {
+        ModeAcc& m = s_modes[static_cast<size_t>(s_mode)];
+        if (!m.samples || ma < m.minMa) m.minMa = ma;
+        if (!m.samples || ma > m.maxMa) m.maxMa = ma;
+        m.sumMa += ma;
+        m.samples++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+} // namespace
+
+bool power_begin(PowerCurrentFn current) {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    s_current = current;
+    s_modeSinceMs = millis();
+#if CONFIG_PM_ENABLE
+    for (size_t i = 0; i < kLocks; i++) {
+        if (esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, kLockNames[i], &s_locks[i].handle) != ESP_OK) {
+            s_locks[i].handle = nullptr;
+            logbuf_printf("Power: no PM lock for %s", kLockNames[i]);
+        }
+    }
+#endif
+    const esp_timer_create_args_t args = {lingerDone, nullptr, ESP_TIMER_TASK, "pm_linger"};
+    if (esp_timer_create(&args, &s_linger) != ESP_OK) s_linger = nullptr;
+
+    const PowerMode boot = static_cast<PowerMode>(POWER_PM_MODE < kModes ? POWER_PM_MODE : 0);
+    if (!apply(boot) && boot != PowerMode::Full) {
+        logbuf_printf("Power: %s unavailable in this build, running full clock", kModeNames[static_cast<size_t>(boot)]);
+    }
+    s_job = service_job_add("Power", sampleJob, nullptr, POWER_SAMPLE_MS, POWER_JOB_BUDGET_US);
+    return s_job != SERVICE_JOB_NONE;
+}
+
+bool power_set_mode(PowerMode mode) {
+    if (mode >= PowerMode::Count) return false;
+    s_survey.active = false;
+    return apply(mode);
+}
+
+PowerMode power_mode() {
+    return s_mode;
+}
+
+bool power_mode_available(PowerMode mode) {
+    switch (mode) {
+        case PowerMode::Full:
+            return true;
+#if CONFIG_PM_ENABLE
+        case PowerMode::Dfs:
+            return true;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        case PowerMode::LightSleep:
+            return true;
+#endif
+#endif
+        default:
+            return false;
+    }
+}
+
+void power_lock_bind_mutex(SemaphoreHandle_t mutex, PowerLock lock) {
+    if (!mutex || lock >= PowerLock::Count) return;
+    portENTER_CRITICAL(&s_mux);
+    for (Binding& b : s_bindings) {
+        if (!b.mutex || b.mutex == mutex) {
+            b.mutex = mutex;
+            b.lock = lock;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void power_lock_unbind_mutex(SemaphoreHandle_t mutex) {
+    portENTER_CRITICAL(&s_mux);
+    for (Binding& b : s_bindings) {
+        if (b.mutex == mutex) b.mutex = nullptr;
+    }
+    portEXIT_CRITICAL(&s_mux);
+}
+
+void power_mutex_taken(SemaphoreHandle_t mutex) {
+    for (const Binding& b : s_bindings) {
+        if (b.mutex == mutex) {
+            power_lock_acquire(b.lock);
+            return;
+        }
+    }
+}
+
+void power_mutex_given(SemaphoreHandle_t mutex) {
+    for (const Binding& b : s_bindings) {
+        if (b.mutex == mutex) {
+            power_lock_release(b.lock);
+            return;
+        }
+    }
+}
+
+void power_lock_acquire(PowerLock lock) {
+    if (lock >= PowerLock::Count) return;
+    take(lock);
+}
+
+void power_lock_release(PowerLock lock) {
+    if (lock >= PowerLock::Count) return;
+    if (lock == PowerLock::Uart && s_linger && POWER_UART_LINGER_MS > 0) {
+        // The linger hold is taken before this transaction's hold goes, so the lock never drops in between
+        portENTER_CRITICAL(&s_mux);
+        const bool start = !s_lingering;
+        s_lingering = true;
+        portEXIT_CRITICAL(&s_mux);
+        if (start) take(lock);
+        esp_timer_stop(s_linger);
+        esp_timer_start_once(s_linger, static_cast<uint64_t>(POWER_UART_LINGER_MS) * 1000ULL);
+    }
+    drop(lock);
+}
+
+void power_wake_on_uart_rx(int pin) {
+#if CONFIG_PM_ENABLE
+    if (pin < 0) return;
+    // UART2 has no UART wakeup on the S3; the start bit's low level does it, and that byte is lost
+    gpio_wakeup_enable(static_cast<gpio_num_t>(pin), GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+#else
+    (void)pin;
+#endif
+}
+
+bool power_survey_start(uint32_t dwellMs) {
+    if (s_job == SERVICE_JOB_NONE || s_survey.active || !dwellMs) return false;
+    if (nextAvailable(PowerMode::Full) == PowerMode::Count) {
+        logbuf_printf("Power: survey needs CONFIG_PM_ENABLE");
+        return false;
+    }
+    s_survey.restore = s_mode;
+    s_survey.dwellMs = dwellMs;
+    s_survey.active = true;
+    enterSurveyStep(PowerMode::Full, millis());
+    return true;
+}
+
+bool power_survey_active() {
+    return s_survey.active;
+}
+
+bool power_mode_stats(PowerMode mode, PowerModeStats& out) {
+    if (mode >= PowerMode::Count) return false;
+    const uint32_t now = millis();
+    portENTER_CRITICAL(&s_mux);
+    const ModeAcc m = s_modes[static_cast<size_t>(mode)];
+    const uint32_t running = mode == s_mode ? now - s_modeSinceMs : 0;
+    portEXIT_CRITICAL(&s_mux);
+    out.ms = m.ms + running;
+    out.samples = m.samples;
+    out.avgMa = m.samples ? static_cast<float>(m.sumMa / m.samples) : 0.0f;
+    out.minMa = m.minMa;
+    out.maxMa = m.maxMa;
+    return out.ms > 0 || out.samples > 0;
+}
+
+size_t power_lock_stats(PowerLockStats* out, size_t max) {
+    if (!out) return 0;
+    const uint32_t now = millis();
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (size_t i = 0; i < kLocks && n < max; i++) {
+        const Lock& l = s_locks[i];
+        const uint32_t running = l.depth ? now - l.sinceMs : 0;
+        out[n++] = PowerLockStats{kLockNames[i], l.holds, l.heldMs + running,
+                                  running > l.maxHeldMs ? running : l.maxHeldMs};
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+void power_report(Print& out) {
+    const PowerMode mode = power_mode();
+    out.printf("Power: %s mode", kModeNames[static_cast<size_t>(mode)]);
+    if (mode != PowerMode::Full) out.printf(" (%d-%d MHz)", POWER_MIN_MHZ, POWER_MAX_MHZ);
+    if (s_survey.active) out.printf(", survey at %s", kModeNames[static_cast<size_t>(s_survey.step)]);
+    out.println();
+    out.println("  mode          time s  samples   avg mA   min mA   max mA");
+    for (size_t i = 0; i < kModes; i++) {
+        PowerModeStats m;
+        if (!power_mode_stats(static_cast<PowerMode>(i), m)) continue;
+        out.printf("  %-12s %7lu %8lu %8.1f %8.1f %8.1f\n", kModeNames[i], (unsigned long)(m.ms / 1000),
+                   (unsigned long)m.samples, m.avgMa, m.minMa, m.maxMa);
+    }
+    PowerLockStats locks[kLocks];
+    const size_t n = power_lock_stats(locks, kLocks);
+    const uint32_t upMs = millis();
+    out.println("  lock      holds   held s  held %   max ms");
+    for (size_t i = 0; i < n; i++) {
+        const PowerLockStats& l = locks[i];
+        out.printf("  %-8s %6lu %8lu %7.1f %8lu\n", l.name, (unsigned long)l.holds, (unsigned long)(l.heldMs / 1000),
+                   upMs ? 100.0f * l.heldMs / upMs : 0.0f, (unsigned long)l.maxHeldMs);
+    }
+#if CONFIG_PM_ENABLE && CONFIG_PM_PROFILING
+    esp_pm_dump_locks(stdout);
+#endif
+}
+
+#endif // POWER_PM_ENABLE
@@ -0,0 +1,141 @@
+/*
+ * Power Manager
+ * ESP-IDF power management for battery-backed sites:
+ *   - modes: Full (fixed top clock, the old behaviour), Dfs (clock scales down
+ *     to POWER_MIN_MHZ when every task is idle) and LightSleep (Dfs plus
+ *     automatic light sleep from tickless idle)
+ *   - PM locks are held only while a bus transfer is in flight: the modem UART
+ *     and the SD card while their kernel mutexes are held (mutex_take/give do it
+ *     for mutexes bound with power_lock_bind_mutex()), the display SPI around a
+ *     page draw (PowerLockGuard). The UART lock lingers POWER_UART_LINGER_MS after
+ *     the last transaction for responses and URCs that trail a command; later
+ *     URCs wake the chip through a GPIO wakeup on the RX pin
+ *   - a service job samples the INA226 every POWER_SAMPLE_MS and keeps current
+ *     per mode; power_survey_start() steps through all modes so one report
+ *     compares them on the same site. The INA226 converts continuously, so each
+ *     reading averages over its conversion window, sleep included
+ *
+ * DFS and light sleep need CONFIG_PM_ENABLE, light sleep also
+ * CONFIG_FREERTOS_USE_TICKLESS_IDLE, in the sdkconfig. Without them only Full is
+ * available; lock hold times are still measured, so the report shows how much of
+ * the time the chip could sleep. Under DFS the trace recorder's cycle timestamps
+ * and the CPU profiler's tick-based idle share are only meaningful in Full mode.
+ */
+
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "../config/system_config.h"
+
+#ifndef POWER_PM_MODE
+#define POWER_PM_MODE 2                    // mode at boot: 0 Full, 1 Dfs, 2 LightSleep
+#endif
+#ifndef POWER_MAX_MHZ
+#define POWER_MAX_MHZ 240
+#endif
+#ifndef POWER_MIN_MHZ
+#define POWER_MIN_MHZ 40                   // XTAL; APB follows below 80 MHz
+#endif
+#ifndef POWER_SAMPLE_MS
+#define POWER_SAMPLE_MS 1000
+#endif
+#ifndef POWER_UART_LINGER_MS
+#define POWER_UART_LINGER_MS 2000
+#endif
+#ifndef POWER_SURVEY_DWELL_MS
+#define POWER_SURVEY_DWELL_MS (5UL * 60UL * 1000UL)   // per mode
+#endif
+#define POWER_JOB_BUDGET_US 2000
+
+enum class PowerMode : uint8_t { Full, Dfs, LightSleep, Count };
+
+enum class PowerLock : uint8_t {
+    Uart,       // modem UART: APB clock and no light sleep
+    Sd,         // SD card SPI
+    Display,    // LCD SPI
+    Count
+};
+
+struct PowerModeStats {
+    uint32_t ms;             // time spent in the mode
+    uint32_t samples;
+    float avgMa;
+    float minMa;
+    float maxMa;
+};
+
+struct PowerLockStats {
+    const char* name;
+    uint32_t holds;          // times it went from free to held
+    uint32_t heldMs;         // total, linger included
+    uint32_t maxHeldMs;
+};
+
+typedef float (*PowerCurrentFn)();       // amps; NAN when the sensor is absent
+
+#if POWER_PM_ENABLE
+
+// Creates the PM locks, applies POWER_PM_MODE and schedules the current sampler.
+// Call once from setup(); current may be null.
+bool power_begin(PowerCurrentFn current);
+
+// False when the mode needs sdkconfig options this build lacks
+bool power_set_mode(PowerMode mode);
+PowerMode power_mode();
+bool power_mode_available(PowerMode mode);
+
+// Mutexes whose holders drive a bus; mutex_take()/mutex_give() hold the lock for them
+void power_lock_bind_mutex(SemaphoreHandle_t mutex, PowerLock lock);
+void power_lock_unbind_mutex(SemaphoreHandle_t mutex);
+void power_mutex_taken(SemaphoreHandle_t mutex);
+void power_mutex_given(SemaphoreHandle_t mutex);
+
+void power_lock_acquire(PowerLock lock);
+void power_lock_release(PowerLock lock);
+// GPIO wakeup from light sleep on a UART RX pin (idles high)
+void power_wake_on_uart_rx(int pin);
+
+// Runs every mode for dwellMs, then returns to the mode before the survey
+bool power_survey_start(uint32_t dwellMs = POWER_SURVEY_DWELL_MS);
+bool power_survey_active();
+
+bool power_mode_stats(PowerMode mode, PowerModeStats& out);
+size_t power_lock_stats(PowerLockStats* out, size_t max);
+void power_report(Print& out);
+
+#else
+
+inline bool power_begin(PowerCurrentFn) { return false; }
+inline bool power_set_mode(PowerMode mode) { return mode == PowerMode::Full; }
+inline PowerMode power_mode() { return PowerMode::Full; }
+inline bool power_mode_available(PowerMode mode) { return mode == PowerMode::Full; }
+inline void power_lock_bind_mutex(SemaphoreHandle_t, PowerLock) {}
+inline void power_lock_unbind_mutex(SemaphoreHandle_t) {}
+inline void power_mutex_taken(SemaphoreHandle_t) {}
+inline void power_mutex_given(SemaphoreHandle_t) {}
+inline void power_lock_acquire(PowerLock) {}
+inline void power_lock_release(PowerLock) {}
+inline void power_wake_on_uart_rx(int) {}
+inline bool power_survey_start(uint32_t = 0) { return false; }
+inline bool power_survey_active() { return false; }
+inline bool power_mode_stats(PowerMode, PowerModeStats&) { return false; }
+inline size_t power_lock_stats(PowerLockStats*, size_t) { return 0; }
+inline void power_report(Print&) {}
+
+#endif // POWER_PM_ENABLE
+
+class PowerLockGuard {
+public:
+    explicit PowerLockGuard(PowerLock lock) : lock_(lock) { power_lock_acquire(lock_); }
+    ~PowerLockGuard() { power_lock_release(lock_); }
+    PowerLockGuard(const PowerLockGuard&) = delete;
+    PowerLockGuard& operator=(const PowerLockGuard&) = delete;
+
+private:
+    PowerLock lock_;
+};
+
+#endif // POWER_MANAGER_H
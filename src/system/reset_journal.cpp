@@ -0,0 +1,402 @@
+/*
+ * Reset Journal Implementation
+ */
+
+#include "reset_journal.h"
+
+#if RESET_JOURNAL_ENABLE
+
+#include "json_writer.h"
+#include "metrics.h"
+#include "service_task.h"
+#include "trace_recorder.h"
+#include "../../include/transport.h"
+#include "../modules/logging/log_buffer.h"
+#include <atomic>
+#include <esp_attr.h>
+#include <esp_heap_caps.h>
+#include <esp_rom_crc.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+constexpr uint32_t kMagic = 0x314A5352;     // "RSJ1"
+constexpr uint16_t kVersion = 1;
+constexpr size_t kClose = 8;                // room kept for the closing brackets
+constexpr size_t kNameBytes = 12;
+
+struct JournalMetric {
+    uint32_t hash;
+    int32_t value;
+};
+
+struct JournalTrace {
+    uint32_t ageUs;                         // before the newest event
+    uint8_t type;
+    uint8_t core;
+    uint16_t obj;
+    char name[kNameBytes];
+};
+
+// seq is written last and cleared first: 0 = being written or never written
+struct Snapshot {
+    uint32_t seq;
+    uint32_t crc;                           // CRC-32 of everything after this field
+    uint32_t uptimeMs;
+    uint32_t heapFree;
+    uint32_t heapMin;
+    uint8_t metricCount;
+    uint8_t reserved[3];
+    JournalMetric metrics[RESET_JOURNAL_METRICS];
+};
+
+struct TraceBlock {
+    uint32_t seq;
+    uint32_t crc;
+    uint8_t count;
+    uint8_t reserved[3];
+    JournalTrace events[RESET_JOURNAL_TRACE_EVENTS];
+};
+
+struct Line {
+    uint32_t seq;
+    uint32_t crc;
+    uint32_t ms;
+    char text[RESET_JOURNAL_LINE_BYTES];
+};
+
+struct Journal {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t bytes;
+    uint32_t boot;
+    Snapshot slots[2];
+    TraceBlock trace;
+    Line lines[RESET_JOURNAL_LINES];
+};
+
+// The previous boot's journal, until uploaded
+struct Restored {
+    Snapshot snap;
+    TraceBlock trace;
+    Line lines[RESET_JOURNAL_LINES];        // oldest first
+    uint8_t lineCount;
+};
+
+enum class Section : uint8_t { Metrics, Log, Trace, Done };
+
+// Survives every reset but power loss; not initialised at boot
+RTC_NOINIT_ATTR Journal s_rtc;
+
+std::atomic<bool> s_live{false};
+uint32_t s_snapSeq = 0;                     // service task only
+uint32_t s_lineSeq = 0;                     // log buffer mutex holders only
+ResetJournalStats s_stats = {};
+Restored* s_prev = nullptr;
+Section s_section = Section::Done;
+uint8_t s_index = 0;
+uint32_t s_lastPartMs = 0;
+char s_record[TRANSPORT_MAX_PACKET_BYTES];
+TraceRecentEvent s_recent[RESET_JOURNAL_TRACE_EVENTS];
+
+template <typename T>
+uint32_t bodyCrc(const T& block) {
+    const size_t off = offsetof(T, crc) + sizeof(block.crc);
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&block) + off, sizeof(block) - off);
+}
+
+template <typename T>
+bool intact(const T& block) {
+    return block.seq != 0 && block.crc == bodyCrc(block);
+}
+
+uint32_t nameHash(const char* s) {
+    uint32_t h = 2166136261UL;              // FNV-1a
+    while (*s) {
+        h ^= static_cast<uint8_t>(*s++);
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+const char* metricName(uint32_t hash) {
+#if METRICS_ENABLE
+    for (const Metric* m = metrics_first(); m; m = m->next()) {
+        if (nameHash(m->name()) == hash) return m->name();
+    }
+#endif
+    (void)hash;
+    return nullptr;
+}
+
+#if METRICS_ENABLE
+int32_t metricValue(const Metric* m) {
+    switch (m->kind()) {
+        case MetricKind::Counter:
+            return static_cast<int32_t>(static_cast<const MetricCounter*>(m)->value());
+        case MetricKind::Gauge:
+            return static_cast<const MetricGauge*>(m)->value();
+        case MetricKind::Histogram: {
+            MetricHistogramSnapshot h;
+            static_cast<const MetricHistogram*>(m)->snapshot(h);
+            return static_cast<int32_t>(h.count);
+        }
+    }
+    return 0;
+}
+#endif
+
+void snapshotTrace() {
+    const size_t n = trace_recorder_latest(s_recent, RESET_JOURNAL_TRACE_EVENTS);
+    if (!n) return;
+    TraceBlock& t = s_rtc.trace;
+    t.seq = 0;
+    const uint32_t mhz = getCpuFrequencyMhz() ? getCpuFrequencyMhz() : 1;
+    const uint32_t newest = s_recent[n - 1].cycles;
+    for (size_t i = 0; i < n; i++) {
+        const TraceRecentEvent& e = s_recent[i];
+        JournalTrace& j = t.events[i];
+        j.ageUs = (newest - e.cycles) / mhz;
+        j.type = e.type;
+        j.core = e.core;
+        j.obj = e.obj;
+        strncpy(j.name, e.name ? e.name : "", kNameBytes - 1);
+        j.name[kNameBytes - 1] = '\0';
+    }
+    t.count = static_cast<uint8_t>(n);
+    t.crc = bodyCrc(t);
+    t.seq = s_snapSeq;
+}
+
+// Into the slot the newest snapshot is not in
+void snapshotJob(void*) {
+    s_snapSeq++;
+    Snapshot& s = s_rtc.slots[s_snapSeq & 1];
+    s.seq = 0;
+    s.uptimeMs = millis();
+    s.heapFree = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    s.heapMin = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    uint8_t n = 0;
+#if METRICS_ENABLE
+    for (const Metric* m = metrics_first(); m && n < RESET_JOURNAL_METRICS; m = m->next()) {
+        s.metrics[n++] = JournalMetric{nameHash(m->name()), metricValue(m)};
+    }
+#endif
+    s.metricCount = n;
+    s.crc = bodyCrc(s);
+    s.seq = s_snapSeq;
+    snapshotTrace();
+    s_stats.snapshots++;
+}
+
+void restore() {
+    const Snapshot* snap = nullptr;
+    for (const Snapshot& s : s_rtc.slots) {
+        if (intact(s) && s.metricCount <= RESET_JOURNAL_METRICS && (!snap || s.seq > snap->seq)) snap = &s;
+    }
+    if (!snap) return;
+    s_prev = static_cast<Restored*>(malloc(sizeof(Restored)));
+    if (!s_prev) return;
+    memset(s_prev, 0, sizeof(Restored));
+    s_prev->snap = *snap;
+    if (intact(s_rtc.trace) && s_rtc.trace.count <= RESET_JOURNAL_TRACE_EVENTS) s_prev->trace = s_rtc.trace;
+
+    for (const Line& l : s_rtc.lines) {
+        if (!intact(l)) continue;
+        uint8_t j = s_prev->lineCount++;
+        for (; j > 0 && s_prev->lines[j - 1].seq > l.seq; j--) s_prev->lines[j] = s_prev->lines[j - 1];
+        s_prev->lines[j] = l;
+        s_prev->lines[j].text[RESET_JOURNAL_LINE_BYTES - 1] = '\0';
+    }
+    for (uint8_t i = 0; i < RESET_JOURNAL_TRACE_EVENTS; i++) s_prev->trace.events[i].name[kNameBytes - 1] = '\0';
+
+    s_stats.restored = true;
+    s_stats.prevUptimeMs = snap->uptimeMs;
+    s_stats.prevMetrics = snap->metricCount;
+    s_stats.prevLines = s_prev->lineCount;
+    s_stats.prevTrace = s_prev->trace.seq ? s_prev->trace.count : 0;
+    s_section = Section::Metrics;
+}
+
+// One part's entries from the current section on, as many as fit; false when none did
+bool writeEntries(JsonWriter& w) {
+    const Restored& p = *s_prev;
+    bool any = false;
+    auto fits = [&w](const JsonWriter::Mark& m) -> bool {
+        if (!w.failed() && w.length() + kClose < sizeof(s_record)) return true;
+        w.rewind(m);
+        return false;
+    };
+    switch (s_section) {
+        case Section::Metrics:
+            w.beginObject("metrics");
+            for (; s_index < p.snap.metricCount; s_index++) {
+                const JournalMetric& m = p.snap.metrics[s_index];
+                const char* name = metricName(m.hash);
+                char unknown[12];
+                if (!name) {
+                    snprintf(unknown, sizeof(unknown), "#%08lx", (unsigned long)m.hash);
+                    name = unknown;
+                }
+                const JsonWriter::Mark mk = w.mark();
+                w.field(name, (long)m.value);
+                if (!fits(mk)) break;
+                any = true;
+            }
+            w.endObject();
+            return any || s_index >= p.snap.metricCount;
+        case Section::Log:
+            w.beginArray("log");
+            for (; s_index < p.lineCount; s_index++) {
+                const Line& l = p.lines[s_index];
+                char text[RESET_JOURNAL_LINE_BYTES + 16];
+                snprintf(text, sizeof(text), "[%lu] %s", (unsigned long)l.ms, l.text);
+                const JsonWriter::Mark mk = w.mark();
+                w.value(text);
+                if (!fits(mk)) break;
+                any = true;
+            }
+            w.endArray();
+            return any || s_index >= p.lineCount;
+        case Section::Trace: {
+            const uint8_t count = p.trace.seq ? p.trace.count : 0;
+            w.beginArray("trace");
+            for (; s_index < count; s_index++) {
+                const JournalTrace& e = p.trace.events[s_index];
+                const JsonWriter::Mark mk = w.mark();
+                w.beginArray()
+                    .value((unsigned long)e.ageUs)
+                    .value((unsigned)e.type)
+                    .value((unsigned)e.core)
+                    .value(e.name[0] ? e.name : nullptr)
+                    .endArray();
+                if (!fits(mk)) break;
+                any = true;
+            }
+            w.endArray();
+            return any || s_index >= count;
+        }
+        case Section::Done:
+            break;
+    }
+    return false;
+}
+
+void nextSection() {
+    const Restored& p = *s_prev;
+    for (;;) {
+        const uint8_t size = s_section == Section::Metrics ? p.snap.metricCount
+                             : s_section == Section::Log   ? p.lineCount
+                             : s_section == Section::Trace ? (p.trace.seq ? p.trace.count : 0)
+                                                           : 0;
+        if (s_section == Section::Done || s_index < size) return;
+        s_section = static_cast<Section>(static_cast<uint8_t>(s_section) + 1);
+        s_index = 0;
+    }
+}
+} // namespace
+
+bool reset_journal_begin(uint8_t resetReason) {
+    if (s_live.load()) return s_stats.restored;
+    const bool known = s_rtc.magic == kMagic && s_rtc.version == kVersion && s_rtc.bytes == sizeof(Journal);
+    s_stats.boot = known ? s_rtc.boot + 1 : 1;
+    s_stats.prevReason = resetReason;
+    if (known) restore();
+
+    memset(&s_rtc, 0, sizeof(s_rtc));
+    s_rtc.magic = kMagic;
+    s_rtc.version = kVersion;
+    s_rtc.bytes = sizeof(Journal);
+    s_rtc.boot = s_stats.boot;
+    s_live.store(true);
+
+    if (s_stats.restored) {
+        s_stats.uploading = true;
+        Serial.printf("ResetJournal: boot %lu, previous boot ended by reset %u at %lu ms: %u metrics, "
+                      "%u log lines, %u trace events\n",
+                      (unsigned long)s_stats.boot, (unsigned)resetReason, (unsigned long)s_stats.prevUptimeMs,
+                      (unsigned)s_stats.prevMetrics, (unsigned)s_stats.prevLines, (unsigned)s_stats.prevTrace);
+    }
+    if (service_job_add("ResetJournal", snapshotJob, nullptr, RESET_JOURNAL_SNAPSHOT_MS, 500) ==
+        SERVICE_JOB_NONE) {
+        Serial.println("ResetJournal: no service job slot, metrics not journalled");
+    }
+    return s_stats.restored;
+}
+
+void reset_journal_line(uint32_t timestampMs, const char* line) {
+    if (!line || !s_live.load(std::memory_order_relaxed)) return;
+    Line& l = s_rtc.lines[s_lineSeq % RESET_JOURNAL_LINES];
+    l.seq = 0;
+    l.ms = timestampMs;
+    strncpy(l.text, line, RESET_JOURNAL_LINE_BYTES - 1);
+    l.text[RESET_JOURNAL_LINE_BYTES - 1] = '\0';
+    l.crc = bodyCrc(l);
+    l.seq = ++s_lineSeq;
+    s_stats.lines++;
+}
+
+void reset_journal_poll(uint32_t now) {
+    if (!s_stats.uploading) return;
+    if (s_stats.partsSent && now - s_lastPartMs < RESET_JOURNAL_PART_GAP_MS) return;
+    nextSection();
+    const Section section = s_section;
+    const uint8_t index = s_index;
+
+    JsonWriter w(s_record, sizeof(s_record));
+    w.beginObject()
+        .beginObject("reset_journal")
+        .field("boot", (unsigned long)(s_stats.boot - 1))
+        .field("reason", (unsigned)s_stats.prevReason)
+        .field("part", (unsigned)s_stats.partsSent);
+    if (!s_stats.partsSent) {
+        w.field("up", (unsigned long)s_prev->snap.uptimeMs)
+            .field("heap", (unsigned long)s_prev->snap.heapFree)
+            .field("heap_min", (unsigned long)s_prev->snap.heapMin);
+    }
+    if (!writeEntries(w)) {
+        // One entry alone does not fit: skip it rather than stall
+        s_index++;
+    }
+    nextSection();
+    const bool last = s_section == Section::Done;
+    if (last) w.field("last", true);
+    w.endObject().endObject();
+    if (!w.ok() || !transport_sendDiagnostic(s_record, w.length())) {
+        s_section = section;                // queue full, same part next poll
+        s_index = index;
+        return;
+    }
+
+    s_lastPartMs = now;
+    s_stats.partsSent++;
+    if (last) {
+        s_stats.uploading = false;
+        free(s_prev);
+        s_prev = nullptr;
+        LOGF("reset journal of boot %lu uploaded in %u parts", (unsigned long)(s_stats.boot - 1),
+             (unsigned)s_stats.partsSent);
+    }
+}
+
+void reset_journal_stats(ResetJournalStats& out) {
+    out = s_stats;
+}
+
+void reset_journal_report(Print& out) {
+    const ResetJournalStats& s = s_stats;
+    out.printf("Reset journal: boot %lu, %lu snapshots, %lu lines, %u bytes RTC", (unsigned long)s.boot,
+               (unsigned long)s.snapshots, (unsigned long)s.lines, (unsigned)sizeof(Journal));
+    if (!s.restored) {
+        out.println(", nothing from the previous boot");
+        return;
+    }
+    out.printf("; previous boot ended by reset %u at %lu ms, %u metrics, %u lines, %u trace events, %s "
+               "(%u parts)\n",
+               (unsigned)s.prevReason, (unsigned long)s.prevUptimeMs, (unsigned)s.prevMetrics,
+               (unsigned)s.prevLines, (unsigned)s.prevTrace, s.uploading ? "uploading" : "uploaded",
+               (unsigned)s.partsSent);
+}
+
+#endif // RESET_JOURNAL_ENABLE
@@ -0,0 +1,93 @@
+/*
+ * Reset Journal
+ * What the device was doing before a reset of any kind (watchdog, brownout,
+ * panic, software) in RTC memory that the reset does not clear, restored and
+ * uploaded on the next boot. No flash writes.
+ *   - metrics: every RESET_JOURNAL_SNAPSHOT_MS the service task copies the
+ *     counter and gauge values of the metrics registry (TransportStats,
+ *     CrashStats and the module counters are all in it; histograms give their
+ *     sample count), uptime and heap into the older of two checksummed slots,
+ *     so a reset mid-copy leaves the other one whole
+ *   - log: every log buffer line also goes into a ring of the newest
+ *     RESET_JOURNAL_LINES, cut to RESET_JOURNAL_LINE_BYTES, each line with its
+ *     own checksum; a line torn by the reset is skipped
+ *   - trace: with the trace recorder on, each snapshot also copies its newest
+ *     RESET_JOURNAL_TRACE_EVENTS events with their object names
+ * Metrics are kept by name hash; the next boot names them again from its own
+ * registry, so a metric renamed by an update comes out as "#<hash>".
+ *
+ * The next boot sends it as Diagnostic records, one every
+ * RESET_JOURNAL_PART_GAP_MS, as many entries per record as fit:
+ *   {"reset_journal":{"boot":n,"reason":r,"part":i,"up":ms,"heap":b,"heap_min":b,
+ *    "metrics":{...}|"log":["[ms] line",...]|"trace":[[age_us,type,core,"name"],...],
+ *    "last":true}}
+ * "boot" counts boots since power-on; "reason" is the esp_reset_reason_t that
+ * ended the journalled boot. It is kept in RAM until sent, so a second reset
+ * before then loses it.
+ */
+
+#ifndef RESET_JOURNAL_H
+#define RESET_JOURNAL_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef RESET_JOURNAL_SNAPSHOT_MS
+#define RESET_JOURNAL_SNAPSHOT_MS 1000UL
+#endif
+#ifndef RESET_JOURNAL_METRICS
+#define RESET_JOURNAL_METRICS 48            // 8 bytes each, in both slots
+#endif
+#ifndef RESET_JOURNAL_LINES
+#define RESET_JOURNAL_LINES 16
+#endif
+#ifndef RESET_JOURNAL_LINE_BYTES
+#define RESET_JOURNAL_LINE_BYTES 80
+#endif
+#ifndef RESET_JOURNAL_TRACE_EVENTS
+#define RESET_JOURNAL_TRACE_EVENTS 24       // 20 bytes each
+#endif
+#ifndef RESET_JOURNAL_PART_GAP_MS
+#define RESET_JOURNAL_PART_GAP_MS 2000UL
+#endif
+
+struct ResetJournalStats {
+    uint32_t boot;               // boots since power-on, this one included
+    uint32_t snapshots;          // this boot
+    uint32_t lines;
+    bool restored;               // the previous boot left a journal
+    uint8_t prevReason;          // esp_reset_reason_t that ended it
+    uint32_t prevUptimeMs;       // at its newest snapshot
+    uint8_t prevMetrics;
+    uint8_t prevLines;
+    uint8_t prevTrace;
+    uint16_t partsSent;
+    bool uploading;
+};
+
+#if RESET_JOURNAL_ENABLE
+
+// Takes over the previous boot's journal, starts this boot's and the snapshot
+// job. Call once at boot (CrashRecovery does); log lines before it are not kept.
+bool reset_journal_begin(uint8_t resetReason);
+
+// Log buffer writer, under its mutex; line is without the timestamp prefix
+void reset_journal_line(uint32_t timestampMs, const char* line);
+
+// Sends the next upload part when one is due; call from the transport owner's loop
+void reset_journal_poll(uint32_t now);
+
+void reset_journal_stats(ResetJournalStats& out);
+void reset_journal_report(Print& out);
+
+#else
+
+inline bool reset_journal_begin(uint8_t) { return false; }
+inline void reset_journal_line(uint32_t, const char*) {}
+inline void reset_journal_poll(uint32_t) {}
+inline void reset_journal_stats(ResetJournalStats& out) { out = ResetJournalStats(); }
+inline void reset_journal_report(Print&) {}
+
+#endif // RESET_JOURNAL_ENABLE
+
+#endif // RESET_JOURNAL_H
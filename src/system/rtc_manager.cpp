@@ -4,8 +4,8 @@
  */
 
 #include "rtc_manager.h"
+#include "time_service.h"
 #include "../modules/catm_gnss/catm_gnss_module.h"
-#include "../modules/catm_gnss/gnss_status.h"
 #include "../config/system_config.h"
 #include <M5StamPLC.h>
 #include <sys/time.h>
@@ -13,8 +13,6 @@
 
 // External globals (declared in main.cpp)
 extern CatMGNSSModule* catmGnssModule;
-extern bool g_cntpSyncedThisSession;
-extern bool g_lastCellularNtpUsedCntp;
 
 bool setRTCFromCellular() {
     if (!catmGnssModule || !catmGnssModule->isModuleInitialized()) return false;
@@ -24,17 +22,13 @@ bool setRTCFromCellular() {
         Serial.println("RTC: Cellular data session not active; attempting to read network clock anyway");
     }
     
-    // Get network time from cellular module, trigger CNTP if clock not ready
+    // Modem clock, set by NITZ or the last CNTP; CNTP itself is up to the sync scheduler
     struct tm networkTime;
     if (!catmGnssModule->getNetworkTime(networkTime)) {
-        Serial.println("RTC: +CCLK? did not return time, attempting CNTP sync...");
-        if (!catmGnssModule->syncNetworkTime(networkTime, 65000)) {
-            Serial.printf("RTC: CNTP sync failed: %s\n", catmGnssModule->getLastError().c_str());
-            return false;
-        }
-        g_cntpSyncedThisSession = true;
-        g_lastCellularNtpUsedCntp = true;
+        Serial.println("RTC: +CCLK? did not return time");
+        return false;
     }
+    time_discipline_tm(TimeSource::CELLULAR, networkTime, time_mono_us(), TIME_UNCERTAINTY_CELLULAR_MS);
     
     // Set RTC time (UTC)
     if (M5StamPLC.RX8130.begin()) {
@@ -91,6 +85,7 @@ bool setRTCFromBuildTimestamp() {
     tv.tv_sec = epoch;
     tv.tv_usec = 0;
     settimeofday(&tv, nullptr);
+    time_discipline(TimeSource::BUILD, epoch, time_mono_us(), TIME_UNCERTAINTY_BUILD_MS);
 
     if (M5StamPLC.RX8130.begin()) {
         M5StamPLC.RX8130.setTime(&tmUtc);
@@ -122,6 +117,10 @@ bool setRTCFromGPS(const GNSSData& gnssData) {
     }
     int dayOfWeek = (gnssData.day + (13 * (m + 1)) / 5 + y + y / 4 - y / 100 + y / 400) % 7;
     rtcTime.tm_wday = (dayOfWeek + 5) % 7; // Adjust to 0=Sunday
+
+    // The fix time is as of when the report was parsed
+    const uint32_t ageMs = millis() - gnssData.lastUpdate;
+    time_discipline_tm(TimeSource::GNSS, rtcTime, time_mono_us() - (int64_t)ageMs * 1000, TIME_UNCERTAINTY_GNSS_MS);
     
     // Set RTC time (UTC)
     if (M5StamPLC.RX8130.begin()) {
@@ -7,7 +7,7 @@
 #define RTC_MANAGER_H
 
 #include <time.h>
-#include "../modules/catm_gnss/gnss_status.h"
+struct GNSSData;
 
 // RTC synchronization functions
 bool setRTCFromCellular();
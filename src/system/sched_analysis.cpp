@@ -0,0 +1,249 @@
+/*
+ * Schedulability Analysis Implementation
+ */
+
+#include "sched_analysis.h"
+
+#if SCHED_ANALYSIS_ENABLE
+
+#include <string.h>
+
+namespace {
+constexpr uint32_t kTickUs = portTICK_PERIOD_MS * 1000UL;
+constexpr uint8_t kMaxIterations = 64;
+
+struct Source {
+    const char* task;
+    SchedSourceFn fn;
+};
+
+// Switch count at the previous run, for the period estimate
+struct Prev {
+    TaskHandle_t task;
+    uint32_t switches;
+    uint32_t ms;
+    uint32_t periodUs;
+    bool seen;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Source s_sources[SCHED_ANALYSIS_SOURCES];
+
+// sched_analysis_run() only
+Prev s_prev[SCHED_ANALYSIS_TASKS];
+CpuTaskStats s_tasks[SCHED_ANALYSIS_TASKS];
+UBaseType_t s_prio[SCHED_ANALYSIS_TASKS];
+SchedAnalysis s_result;
+
+SchedSourceFn sourceFor(const char* name) {
+    SchedSourceFn fn = nullptr;
+    portENTER_CRITICAL(&s_mux);
+    for (const Source& s : s_sources) {
+        if (s.task && strncmp(s.task, name, sizeof(CpuTaskStats::name)) == 0) {
+            fn = s.fn;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return fn;
+}
+
+Prev* prevFor(TaskHandle_t task) {
+    Prev* slot = nullptr;
+    for (Prev& p : s_prev) {
+        if (p.task == task) return &p;
+        if (!p.task && !slot) slot = &p;
+    }
+    if (slot) *slot = Prev{task, 0, 0, 0, false};
+    return slot;
+}
+
+// Activations are the switches the tick hook saw since the previous run
+uint32_t estimatePeriodUs(const CpuTaskStats& t, uint32_t now) {
+    Prev* p = prevFor(t.task);
+    if (!p) return t.switches ? (uint32_t)((uint64_t)now * 1000ULL / t.switches) : 0;
+    p->seen = true;
+    if (!p->ms) {
+        p->periodUs = t.switches ? (uint32_t)((uint64_t)now * 1000ULL / t.switches) : 0;
+    } else if (now - p->ms >= SCHED_ANALYSIS_MIN_WINDOW_MS) {
+        const uint32_t n = t.switches - p->switches;
+        p->periodUs = n ? (uint32_t)((uint64_t)(now - p->ms) * 1000ULL / n) : 0;
+    } else {
+        return p->periodUs;
+    }
+    p->switches = t.switches;
+    p->ms = now;
+    return p->periodUs;
+}
+
+bool canRunOn(const SchedTaskResult& t, uint8_t core) {
+    return t.core < 0 || t.core == (int8_t)core;
+}
+
+// Fixed point of R = C + sum ceil(R / Tj) * Cj over j at the same or higher priority
+uint32_t respond(const SchedAnalysis& a, uint8_t i, uint8_t core, const UBaseType_t* prio) {
+    const SchedTaskResult& t = a.tasks[i];
+    uint64_t r = t.wcetUs;
+    for (uint8_t iter = 0; iter < kMaxIterations; iter++) {
+        uint64_t next = t.wcetUs;
+        for (uint8_t j = 0; j < a.count; j++) {
+            const SchedTaskResult& o = a.tasks[j];
+            if (j == i || prio[j] < prio[i] || !canRunOn(o, core)) continue;
+            next += (r + o.periodUs - 1) / o.periodUs * o.wcetUs;
+        }
+        if (next > t.periodUs) return SCHED_RESPONSE_UNBOUNDED;
+        if (next == r) return (uint32_t)r;
+        r = next;
+    }
+    return SCHED_RESPONSE_UNBOUNDED;
+}
+
+uint32_t bestResponse(const SchedAnalysis& a, uint8_t i, const UBaseType_t* prio, uint8_t* coreUsed) {
+    uint32_t best = SCHED_RESPONSE_UNBOUNDED;
+    int8_t bestCore = -1;
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+        if (!canRunOn(a.tasks[i], c)) continue;
+        const uint32_t r = respond(a, i, c, prio);
+        if (bestCore < 0 || r < best) {
+            best = r;
+            bestCore = (int8_t)c;
+        }
+    }
+    if (coreUsed) *coreUsed = bestCore < 0 ? 0xFF : (uint8_t)bestCore;
+    return best;
+}
+
+// The priority levels in use, highest first, go to the tasks by period, shortest first
+void suggest(SchedAnalysis& a) {
+    uint8_t order[SCHED_ANALYSIS_TASKS];
+    UBaseType_t levels[SCHED_ANALYSIS_TASKS];
+    for (uint8_t i = 0; i < a.count; i++) {
+        uint8_t j = i;
+        while (j > 0 && a.tasks[order[j - 1]].periodUs > a.tasks[i].periodUs) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+        j = i;
+        while (j > 0 && levels[j - 1] < a.tasks[i].priority) {
+            levels[j] = levels[j - 1];
+            j--;
+        }
+        levels[j] = a.tasks[i].priority;
+    }
+    for (uint8_t k = 0; k < a.count; k++) a.tasks[order[k]].suggested = levels[k];
+}
+} // namespace
+
+bool sched_analysis_source(const char* task, SchedSourceFn fn) {
+    if (!task || !fn) return false;
+    bool ok = false;
+    portENTER_CRITICAL(&s_mux);
+    for (Source& s : s_sources) {
+        if (!s.task || strcmp(s.task, task) == 0) {
+            s = Source{task, fn};
+            ok = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return ok;
+}
+
+bool sched_analysis_run(SchedAnalysis& out) {
+    out = SchedAnalysis();
+    if (cpu_profile_load(CPU_WINDOW_MID) < 0.0f) return false;
+    const uint32_t now = millis();
+    out.atMs = now;
+
+    for (Prev& p : s_prev) p.seen = false;
+    const size_t n = cpu_profile_tasks(s_tasks, SCHED_ANALYSIS_TASKS);
+    for (size_t k = 0; k < n; k++) {
+        const CpuTaskStats& t = s_tasks[k];
+        if (t.priority == 0) continue;
+        SchedTaskResult& r = out.tasks[out.count];
+        memset(&r, 0, sizeof(r));
+        memcpy(r.name, t.name, sizeof(r.name));
+        r.core = t.core;
+        r.coreUsed = 0xFF;
+        r.priority = t.priority;
+
+        const SchedSourceFn fn = sourceFor(t.name);
+        if (fn && fn(r.periodUs, r.wcetUs) && r.periodUs) {
+            r.measured = true;
+            estimatePeriodUs(t, now);      // keeps the switch baseline current
+        } else {
+            r.periodUs = estimatePeriodUs(t, now);
+            if (!r.periodUs) continue;     // not seen running since the last run
+            const uint32_t mean = (uint32_t)((uint64_t)t.permille[CPU_WINDOW_MID] * r.periodUs / 1000);
+            const uint32_t longest = t.maxRunTicks > 1 ? (t.maxRunTicks - 1) * kTickUs : 0;
+            r.wcetUs = mean > longest ? mean : longest;
+        }
+        if (!r.wcetUs) r.wcetUs = 1;
+        out.count++;
+    }
+    // Deleted tasks give their baseline back
+    for (Prev& p : s_prev) {
+        if (p.task && !p.seen) p.task = nullptr;
+    }
+
+    for (uint8_t i = 0; i < out.count; i++) {
+        const SchedTaskResult& t = out.tasks[i];
+        const uint16_t u = (uint16_t)((uint64_t)t.wcetUs * 1000 / t.periodUs);
+        if (t.core >= 0 && t.core < CPU_PROFILE_CORES) {
+            out.utilPermille[t.core] += u;
+        } else {
+            out.utilFreePermille += u;
+        }
+        for (uint8_t j = 0; j < out.count; j++) {
+            const SchedTaskResult& o = out.tasks[j];
+            const bool share = t.core < 0 || o.core < 0 || t.core == o.core;
+            if (share && t.periodUs < o.periodUs && t.priority < o.priority) out.inversions++;
+        }
+    }
+
+    suggest(out);
+    for (uint8_t i = 0; i < out.count; i++) s_prio[i] = out.tasks[i].priority;
+    for (uint8_t i = 0; i < out.count; i++) {
+        out.tasks[i].responseUs = bestResponse(out, i, s_prio, &out.tasks[i].coreUsed);
+        if (out.tasks[i].responseUs == SCHED_RESPONSE_UNBOUNDED) out.misses++;
+    }
+    for (uint8_t i = 0; i < out.count; i++) s_prio[i] = out.tasks[i].suggested;
+    for (uint8_t i = 0; i < out.count; i++) {
+        out.tasks[i].responseRmUs = bestResponse(out, i, s_prio, nullptr);
+        if (out.tasks[i].responseRmUs == SCHED_RESPONSE_UNBOUNDED) out.missesRm++;
+    }
+    return true;
+}
+
+void sched_analysis_report(Print& out) {
+    SchedAnalysis& a = s_result;
+    if (!sched_analysis_run(a)) return;
+    out.printf("Sched analysis: %u tasks, %u past deadline (%u rate-monotonic), %u priority inversions; "
+               "util", (unsigned)a.count, (unsigned)a.misses, (unsigned)a.missesRm, (unsigned)a.inversions);
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+        out.printf(" core%u %u.%u%%", c, a.utilPermille[c] / 10, a.utilPermille[c] % 10);
+    }
+    out.printf(", either %u.%u%%\n", a.utilFreePermille / 10, a.utilFreePermille % 10);
+    out.println("  task            core pri  rm   period_us    wcet_us    resp_us resp_rm_us");
+    for (uint8_t i = 0; i < a.count; i++) {
+        const SchedTaskResult& t = a.tasks[i];
+        char resp[12];
+        char respRm[12];
+        if (t.responseUs == SCHED_RESPONSE_UNBOUNDED) {
+            strcpy(resp, "MISS");
+        } else {
+            snprintf(resp, sizeof(resp), "%lu", (unsigned long)t.responseUs);
+        }
+        if (t.responseRmUs == SCHED_RESPONSE_UNBOUNDED) {
+            strcpy(respRm, "MISS");
+        } else {
+            snprintf(respRm, sizeof(respRm), "%lu", (unsigned long)t.responseRmUs);
+        }
+        out.printf("  %-15s %4d %3u %3u %11lu %10lu %10s %10s%s\n", t.name, t.core, (unsigned)t.priority,
+                   (unsigned)t.suggested, (unsigned long)t.periodUs, (unsigned long)t.wcetUs, resp, respRm,
+                   t.measured ? "  measured" : "");
+    }
+}
+
+#endif // SCHED_ANALYSIS_ENABLE
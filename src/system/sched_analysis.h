@@ -0,0 +1,86 @@
+/*
+ * Schedulability Analysis
+ * Response-time analysis of the running tasks under their current priorities
+ * and core affinities, from measured timings, and the rate-monotonic priority
+ * order for comparison:
+ *   - period T and worst-case execution C of a task come from its own timing
+ *     when it registers a source (the PLC scan: configured period, longest
+ *     scan), else from the CPU profiler: T is the time between the switches
+ *     the tick hook saw since the previous run, C the longer of load x T and
+ *     the longest run it saw. Both are lower bounds at tick resolution, so a
+ *     flagged task is at risk for certain; an unflagged one is not proven safe.
+ *   - the deadline is the period. Per core, R = C + sum over the other tasks
+ *     of at least equal priority that can run there of ceil(R / Tj) * Cj
+ *     (equal priorities time-slice, so they count). A task free to run on
+ *     either core takes the better core; other tasks count on both.
+ *   - priority 0 tasks (the idle tasks and anything below the service task)
+ *     are background: no deadline, no interference.
+ * The suggestion keeps the priority levels in use and hands them out again by
+ * period, shortest first, then reruns the analysis under it.
+ */
+
+#ifndef SCHED_ANALYSIS_H
+#define SCHED_ANALYSIS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "../config/system_config.h"
+#include "cpu_profiler.h"
+
+#ifndef SCHED_ANALYSIS_SOURCES
+#define SCHED_ANALYSIS_SOURCES 4
+#endif
+#ifndef SCHED_ANALYSIS_MIN_WINDOW_MS
+#define SCHED_ANALYSIS_MIN_WINDOW_MS 10000UL   // shorter gaps keep the previous period estimate
+#endif
+#define SCHED_ANALYSIS_TASKS CPU_PROFILE_TASKS
+#define SCHED_RESPONSE_UNBOUNDED UINT32_MAX
+
+// A task's own timing; false when it has none yet
+typedef bool (*SchedSourceFn)(uint32_t& periodUs, uint32_t& wcetUs);
+
+struct SchedTaskResult {
+    char name[16];
+    int8_t core;                 // -1 = either
+    uint8_t coreUsed;            // where the response bound was found
+    UBaseType_t priority;
+    UBaseType_t suggested;       // rate-monotonic
+    uint32_t periodUs;
+    uint32_t wcetUs;
+    uint32_t responseUs;         // SCHED_RESPONSE_UNBOUNDED past the deadline
+    uint32_t responseRmUs;       // under the suggested priorities
+    bool measured;               // from a registered source
+};
+
+struct SchedAnalysis {
+    SchedTaskResult tasks[SCHED_ANALYSIS_TASKS];
+    uint8_t count;
+    uint8_t misses;              // responses past the deadline, current priorities
+    uint8_t missesRm;            // the same under the suggestion
+    uint8_t inversions;          // pairs able to share a core whose priorities run against their periods
+    uint16_t utilPermille[CPU_PROFILE_CORES];   // pinned tasks only
+    uint16_t utilFreePermille;   // tasks that run on either core
+    uint32_t atMs;
+};
+
+#if SCHED_ANALYSIS_ENABLE
+
+// Any task, before or after the tasks start; task is the FreeRTOS task name
+bool sched_analysis_source(const char* task, SchedSourceFn fn);
+// At most one caller at a time (the memory report); fills out, false before
+// the profiler has a sample
+bool sched_analysis_run(SchedAnalysis& out);
+void sched_analysis_report(Print& out);
+
+#else
+
+inline bool sched_analysis_source(const char*, SchedSourceFn) { return false; }
+inline bool sched_analysis_run(SchedAnalysis& out) {
+    out = SchedAnalysis();
+    return false;
+}
+inline void sched_analysis_report(Print&) {}
+
+#endif // SCHED_ANALYSIS_ENABLE
+
+#endif // SCHED_ANALYSIS_H
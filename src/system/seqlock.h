@@ -0,0 +1,69 @@
+/*
+ * Seqlock Snapshot
+ * Single-writer, many-reader publication of small POD state without a mutex.
+ *
+ * The writer bumps the sequence to odd, copies the value and bumps it back to
+ * even. Readers copy the value and retry if the sequence was odd or changed
+ * underneath them. Writers must be serialized externally (one producer task or
+ * a lock the producer already holds); readers never block the writer.
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+template <typename T>
+class SeqlockSnapshot {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqlockSnapshot requires a POD payload");
+
+public:
+    SeqlockSnapshot() : seq_(0) { memset(&data_, 0, sizeof(data_)); }
+
+    void write(const T& value) {
+        const uint32_t s = seq_.load(std::memory_order_relaxed);
+        seq_.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&data_, &value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_release);
+        seq_.store(s + 2, std::memory_order_release);
+    }
+
+    // Copies the latest value. A reader that keeps colliding with the writer
+    // (e.g. it preempted the writer mid-copy on the same core) yields a tick
+    // so the writer can finish.
+    void read(T& out) const {
+        for (uint32_t attempt = 0;; ++attempt) {
+            const uint32_t s1 = seq_.load(std::memory_order_acquire);
+            if ((s1 & 1u) == 0) {
+                memcpy(&out, &data_, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq_.load(std::memory_order_relaxed) == s1) return;
+            }
+            if (attempt >= 8) {
+                vTaskDelay(1);
+                attempt = 0;
+            }
+        }
+    }
+
+    T read() const {
+        T out;
+        read(out);
+        return out;
+    }
+
+    // Even, monotonically increasing; changes on every publish
+    uint32_t version() const { return seq_.load(std::memory_order_acquire) & ~1u; }
+
+private:
+    std::atomic<uint32_t> seq_;
+    T data_;
+};
+
+#endif // SEQLOCK_H
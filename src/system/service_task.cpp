@@ -0,0 +1,308 @@
+/*
+ * Service Task Implementation
+ */
+
+#include "service_task.h"
+#include "kernel_objects.h"
+#include "../modules/logging/log_buffer.h"
+#include <string.h>
+
+namespace {
+constexpr uint8_t kNone = 0xFF;
+constexpr uint32_t kSlots = 1UL << SERVICE_WHEEL_BITS;
+constexpr uint32_t kMask = kSlots - 1;
+static_assert(SERVICE_MAX_JOBS <= 32, "pending jobs are tracked in a 32-bit mask");
+
+struct Job {
+    const char* name;
+    ServiceJobFn fn;
+    void* ctx;
+    uint32_t periodTicks;
+    uint32_t budgetUs;
+    uint32_t due;          // service tick of the next run
+    uint8_t next;          // wheel list link
+    uint8_t level;         // 0 near, 1 far, kNone while unlinked
+    uint8_t slot;
+    bool used;
+    bool removed;          // removed while pending or running
+    ServiceJobStats stats;
+    uint64_t totalUs;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Job s_jobs[SERVICE_MAX_JOBS];
+uint8_t s_near[kSlots];
+uint8_t s_far[kSlots];
+uint32_t s_now = 0;                 // current service tick
+TaskHandle_t s_task = nullptr;
+volatile int s_running = SERVICE_JOB_NONE;
+
+// Under s_mux. due must not be behind s_now.
+void link(uint8_t j) {
+    Job& job = s_jobs[j];
+    const uint32_t delta = job.due - s_now;
+    uint8_t* list;
+    if (delta < kSlots) {
+        job.level = 0;
+        job.slot = job.due & kMask;
+        list = s_near;
+    } else if (delta < kSlots * kSlots) {
+        job.level = 1;
+        job.slot = (job.due >> SERVICE_WHEEL_BITS) & kMask;
+        list = s_far;
+    } else {
+        // Beyond the far level: park in the last far slot and cascade again
+        job.level = 1;
+        job.slot = ((s_now >> SERVICE_WHEEL_BITS) + kSlots - 1) & kMask;
+        list = s_far;
+    }
+    job.next = list[job.slot];
+    list[job.slot] = j;
+}
+
+// Under s_mux
+void unlink(uint8_t j) {
+    Job& job = s_jobs[j];
+    if (job.level == kNone) return;
+    uint8_t* p = job.level == 0 ? &s_near[job.slot] : &s_far[job.slot];
+    while (*p != kNone && *p != j) p = &s_jobs[*p].next;
+    if (*p == j) *p = job.next;
+    job.level = kNone;
+}
+
+// Under s_mux. Moves the wheel one tick on; due jobs are unlinked and added to pending.
+void advance(uint32_t& pending) {
+    s_now++;
+    if ((s_now & kMask) == 0) {
+        const uint32_t k = (s_now >> SERVICE_WHEEL_BITS) & kMask;
+        uint8_t j = s_far[k];
+        s_far[k] = kNone;
+        while (j != kNone) {
+            const uint8_t next = s_jobs[j].next;
+            s_jobs[j].level = kNone;
+            link(j);
+            j = next;
+        }
+    }
+    uint8_t& head = s_near[s_now & kMask];
+    uint8_t j = head;
+    head = kNone;
+    while (j != kNone) {
+        const uint8_t next = s_jobs[j].next;
+        s_jobs[j].level = kNone;
+        if (s_jobs[j].due == s_now) {
+            pending |= 1UL << j;
+        } else {
+            link(j);
+        }
+        j = next;
+    }
+}
+
+// Under s_mux. Ticks until the next occupied near slot or far cascade.
+uint32_t nextWait() {
+    const uint32_t toCascade = kSlots - (s_now & kMask);
+    for (uint32_t i = 1; i < toCascade; i++) {
+        if (s_near[(s_now + i) & kMask] != kNone) return i;
+    }
+    return toCascade;
+}
+
+uint32_t periodTicksFor(uint32_t periodMs) {
+    const uint32_t t = (periodMs + SERVICE_TICK_MS / 2) / SERVICE_TICK_MS;
+    return t ? t : 1;
+}
+
+void runJob(uint8_t j) {
+    portENTER_CRITICAL(&s_mux);
+    Job& job = s_jobs[j];
+    if (job.removed) {
+        job.used = false;
+        portEXIT_CRITICAL(&s_mux);
+        return;
+    }
+    const uint32_t lateMs = (s_now - job.due) * SERVICE_TICK_MS;
+    s_running = j;
+    portEXIT_CRITICAL(&s_mux);
+
+    const uint32_t start = micros();
+    job.fn(job.ctx);
+    const uint32_t us = micros() - start;
+
+    portENTER_CRITICAL(&s_mux);
+    ServiceJobStats& st = job.stats;
+    st.runs++;
+    st.lastUs = us;
+    if (us > st.maxUs) st.maxUs = us;
+    if (lateMs > st.maxLateMs) st.maxLateMs = lateMs;
+    job.totalUs += us;
+    const bool over = job.budgetUs && us > job.budgetUs;
+    if (over) st.overruns++;
+    const uint32_t overruns = st.overruns;
+    if (job.removed) {
+        job.used = false;
+    } else {
+        // Keep the phase; periods missed while late are skipped, not replayed
+        const uint32_t behind = s_now - job.due;
+        job.due += (behind / job.periodTicks + 1) * job.periodTicks;
+        link(j);
+    }
+    s_running = SERVICE_JOB_NONE;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (over && (overruns & (overruns - 1)) == 0) {
+        LOGF("service: %s took %lu us (budget %lu us), %lu overruns", job.name, (unsigned long)us,
+             (unsigned long)job.budgetUs, (unsigned long)overruns);
+    }
+}
+
+void serviceTask(void* pvParameters) {
+    (void)pvParameters;
+    uint32_t lastMs = millis();
+    for (;;) {
+        portENTER_CRITICAL(&s_mux);
+        const uint32_t waitMs = nextWait() * SERVICE_TICK_MS;
+        portEXIT_CRITICAL(&s_mux);
+        // Time already spent in the current tick (wake latency, job run time) is not waited again
+        const uint32_t into = millis() - lastMs;
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs > into ? waitMs - into : 0));
+
+        uint32_t ticks = (millis() - lastMs) / SERVICE_TICK_MS;
+        lastMs += ticks * SERVICE_TICK_MS;
+        // Catch the wheel up first, then run what fell due once each
+        uint32_t pending = 0;
+        portENTER_CRITICAL(&s_mux);
+        while (ticks--) advance(pending);
+        portEXIT_CRITICAL(&s_mux);
+        for (uint8_t j = 0; pending; j++, pending >>= 1) {
+            if (pending & 1) runJob(j);
+        }
+    }
+}
+} // namespace
+
+bool service_begin() {
+    if (s_task) return true;
+    memset(s_near, kNone, sizeof(s_near));
+    memset(s_far, kNone, sizeof(s_far));
+    if (kernel_task_create(KernelTask::Service, serviceTask, nullptr, TASK_PRIORITY_SERVICE, &s_task, 0) != pdPASS) {
+        s_task = nullptr;
+        Serial.println("Service: Failed to start service task");
+        return false;
+    }
+    Serial.println("Service: Task started");
+    return true;
+}
+
+int service_job_add(const char* name, ServiceJobFn fn, void* ctx, uint32_t periodMs, uint32_t budgetUs) {
+    if (!fn || !service_begin()) return SERVICE_JOB_NONE;
+    int id = SERVICE_JOB_NONE;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t j = 0; j < SERVICE_MAX_JOBS; j++) {
+        if (s_jobs[j].used) continue;
+        Job& job = s_jobs[j];
+        memset(&job, 0, sizeof(job));
+        job.name = name;
+        job.fn = fn;
+        job.ctx = ctx;
+        job.periodTicks = periodTicksFor(periodMs);
+        job.budgetUs = budgetUs;
+        job.used = true;
+        job.level = kNone;
+        job.stats.name = name;
+        job.stats.periodMs = periodMs;
+        job.stats.budgetUs = budgetUs;
+        job.due = s_now + job.periodTicks;
+        link(j);
+        id = j;
+        break;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (id == SERVICE_JOB_NONE) {
+        Serial.printf("Service: Job table full, %s not scheduled\n", name);
+    } else {
+        xTaskNotifyGive(s_task);
+    }
+    return id;
+}
+
+void service_job_remove(int id) {
+    if (id < 0 || id >= SERVICE_MAX_JOBS) return;
+    portENTER_CRITICAL(&s_mux);
+    Job& job = s_jobs[id];
+    const bool busy = job.used && (s_running == id || job.level == kNone);
+    if (job.used) {
+        unlink(id);
+        if (busy) {
+            job.removed = true;     // the service loop frees it after (or instead of) the run
+        } else {
+            job.used = false;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (busy && xTaskGetCurrentTaskHandle() != s_task) {
+        while (s_running == id) vTaskDelay(1);
+    }
+}
+
+void service_job_trigger(int id) {
+    if (id < 0 || id >= SERVICE_MAX_JOBS) return;
+    portENTER_CRITICAL(&s_mux);
+    Job& job = s_jobs[id];
+    const bool linked = job.used && !job.removed && job.level != kNone;
+    if (linked) {
+        unlink(id);
+        job.due = s_now + 1;
+        link(id);
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (linked) xTaskNotifyGive(s_task);
+}
+
+bool service_job_set_period(int id, uint32_t periodMs) {
+    if (id < 0 || id >= SERVICE_MAX_JOBS) return false;
+    portENTER_CRITICAL(&s_mux);
+    Job& job = s_jobs[id];
+    const bool ok = job.used && !job.removed;
+    if (ok) {
+        job.periodTicks = periodTicksFor(periodMs);
+        job.stats.periodMs = periodMs;
+        if (job.level != kNone) {
+            unlink(id);
+            job.due = s_now + job.periodTicks;
+            link(id);
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (ok) xTaskNotifyGive(s_task);
+    return ok;
+}
+
+size_t service_job_stats(ServiceJobStats* out, size_t max) {
+    if (!out) return 0;
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t j = 0; j < SERVICE_MAX_JOBS && n < max; j++) {
+        const Job& job = s_jobs[j];
+        if (!job.used || job.removed) continue;
+        out[n] = job.stats;
+        out[n].avgUs = job.stats.runs ? (uint32_t)(job.totalUs / job.stats.runs) : 0;
+        n++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+void service_report(Print& out) {
+    ServiceJobStats jobs[SERVICE_MAX_JOBS];
+    const size_t n = service_job_stats(jobs, SERVICE_MAX_JOBS);
+    if (!n) return;
+    out.println("Service jobs: name period budget runs last/avg/max us overruns late");
+    for (size_t i = 0; i < n; i++) {
+        const ServiceJobStats& j = jobs[i];
+        out.printf("  %-14s %6lu ms %6lu us %7lu %lu/%lu/%lu %lu %lu ms\n", j.name,
+                   (unsigned long)j.periodMs, (unsigned long)j.budgetUs, (unsigned long)j.runs,
+                   (unsigned long)j.lastUs, (unsigned long)j.avgUs, (unsigned long)j.maxUs,
+                   (unsigned long)j.overruns, (unsigned long)j.maxLateMs);
+    }
+}
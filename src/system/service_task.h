@@ -0,0 +1,62 @@
+/*
+ * Service Task
+ * One low-priority task that runs the periodic monitors (memory and stack
+ * monitors, crash recovery checks, watchdog supervision, scheduler statistics)
+ * as jobs, instead of each owning a stack and waking on its own.
+ *
+ * Jobs sit in a two-level hierarchical timer wheel of SERVICE_TICK_MS slots:
+ * 64 near slots cover 6.4 s, 64 far slots cover ~7 min and cascade into the near
+ * level; longer periods re-cascade. The task sleeps until the next occupied slot,
+ * so an idle wheel costs no wakeups. Every run is timed against the job's budget;
+ * overruns are counted and logged (deferred) at 1, 2, 4, 8, ... occurrences.
+ *
+ * Jobs run one after another on the service stack (TASK_STACK_SIZE_SERVICE) and
+ * must not block for long: a slow job delays every other job.
+ */
+
+#ifndef SERVICE_TASK_H
+#define SERVICE_TASK_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#ifndef SERVICE_TICK_MS
+#define SERVICE_TICK_MS 100                // wheel resolution
+#endif
+#ifndef SERVICE_MAX_JOBS
+#define SERVICE_MAX_JOBS 20
+#endif
+#define SERVICE_WHEEL_BITS 6               // 64 slots per level
+#define SERVICE_JOB_NONE (-1)
+
+typedef void (*ServiceJobFn)(void* ctx);
+
+struct ServiceJobStats {
+    const char* name;
+    uint32_t periodMs;
+    uint32_t budgetUs;     // 0 = unbudgeted
+    uint32_t runs;
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint32_t avgUs;
+    uint32_t overruns;     // runs longer than budgetUs
+    uint32_t maxLateMs;    // latest start after the due time
+};
+
+// Starts the service task (idempotent)
+bool service_begin();
+
+// Schedules fn every periodMs (rounded to SERVICE_TICK_MS), first run one period
+// from now. name must be a string literal. Returns the job id or SERVICE_JOB_NONE when the table is full.
+int service_job_add(const char* name, ServiceJobFn fn, void* ctx, uint32_t periodMs, uint32_t budgetUs);
+// Unschedules a job; when called from another task, waits for a run in progress
+void service_job_remove(int id);
+// Runs the job on the next service tick, then keeps its period
+void service_job_trigger(int id);
+bool service_job_set_period(int id, uint32_t periodMs);
+
+size_t service_job_stats(ServiceJobStats* out, size_t max);
+void service_report(Print& out);
+
+#endif // SERVICE_TASK_H
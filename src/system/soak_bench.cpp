@@ -0,0 +1,254 @@
+/*
+ * Soak Bench Implementation
+ */
+
+#include "soak_bench.h"
+
+#if SOAK_BENCH_ENABLE
+
+#include "cpu_profiler.h"
+#include "heap_profiler.h"
+#include "json_writer.h"
+#include "metrics.h"
+#include "mutex_profiler.h"
+#include "service_task.h"
+#include "../modules/logging/log_buffer.h"
+#include "../modules/storage/storage_task.h"
+#include <SD.h>
+
+namespace {
+// Left for the sections after a list and the closing braces
+constexpr size_t kReserve = 512;
+
+SoakBenchStats s_stats = {};
+SoakBenchPageFn s_page = nullptr;
+uint32_t s_sensorSeq = 0;
+uint32_t s_sensorCarry = 0;      // record-milliseconds not yet a whole record
+uint32_t s_nextStormMs = 0;
+uint32_t s_nextPageMs = 0;
+
+char s_report[SOAK_BENCH_REPORT_BYTES];
+CpuTaskStats s_tasks[CPU_PROFILE_TASKS];
+MutexProfileStats s_mutexes[MUTEX_PROFILE_MUTEXES];
+
+bool room(const JsonWriter& w) {
+    return w.length() + kReserve < sizeof(s_report);
+}
+
+// Same sequence every run: a sawtooth per channel, phase-shifted
+void pushSensor(uint32_t seq) {
+    const uint32_t ch = seq % SOAK_BENCH_SENSOR_CHANNELS;
+    StorageLine line;
+    JsonWriter j(line.text(), STORAGE_MAX_LINE_BYTES);
+    j.beginObject()
+        .field("soak", (unsigned long)seq)
+        .field("ch", (unsigned long)ch)
+        .field("v", (double)((seq * 37 + ch * 101) % 1000) / 100.0, 2)
+        .endObject();
+    if (j.ok() && storage_push_line(StorageStreamId::Analog, line, j.length())) {
+        s_stats.sensorRecords++;
+    } else {
+        s_stats.sensorRefused++;
+    }
+}
+
+void loadJob(void*) {
+    const uint32_t now = millis();
+
+    s_sensorCarry += SOAK_BENCH_SENSOR_HZ * SOAK_BENCH_TICK_MS;
+    while (s_sensorCarry >= 1000) {
+        s_sensorCarry -= 1000;
+        pushSensor(s_sensorSeq++);
+    }
+
+    if ((int32_t)(now - s_nextStormMs) >= 0) {
+        s_nextStormMs = now + SOAK_BENCH_STORM_MS;
+        for (uint32_t i = 0; i < SOAK_BENCH_STORM_LINES; i++) {
+            logbuf_printf("soak: storm line %lu/%u at %lu ms, filler to a typical log line length",
+                          (unsigned long)i, (unsigned)SOAK_BENCH_STORM_LINES, (unsigned long)now);
+        }
+        s_stats.stormLines += SOAK_BENCH_STORM_LINES;
+    }
+
+    if (s_page && (int32_t)(now - s_nextPageMs) >= 0) {
+        s_nextPageMs = now + SOAK_BENCH_PAGE_MS;
+        s_page(s_stats.pageSteps++);
+    }
+}
+
+void writeMetrics(JsonWriter& w, bool& cut) {
+    w.beginObject("metrics");
+#if METRICS_ENABLE
+    for (const Metric* m = metrics_first(); m; m = m->next()) {
+        if (!room(w)) {
+            cut = true;
+            break;
+        }
+        switch (m->kind()) {
+            case MetricKind::Counter:
+                w.field(m->name(), (unsigned long)static_cast<const MetricCounter*>(m)->value());
+                break;
+            case MetricKind::Gauge:
+                w.field(m->name(), (long)static_cast<const MetricGauge*>(m)->value());
+                break;
+            case MetricKind::Histogram: {
+                MetricHistogramSnapshot h;
+                static_cast<const MetricHistogram*>(m)->snapshot(h);
+                w.beginArray(m->name());
+                for (uint8_t b = 0; b < METRICS_HIST_BUCKETS; b++) w.value((unsigned long)h.buckets[b]);
+                w.value((unsigned long)h.max).value((unsigned long long)h.sum).endArray();
+                break;
+            }
+        }
+    }
+#endif
+    w.endObject();
+}
+
+void writeCpu(JsonWriter& w, bool& cut) {
+    w.beginObject("cpu").beginArray("cores");
+    for (uint8_t c = 0; c < CPU_PROFILE_CORES; c++) {
+        CpuCoreStats core;
+        if (cpu_profile_core(c, core)) w.value((unsigned)core.busyPermille[CPU_WINDOW_MID]);
+    }
+    w.endArray().beginArray("tasks");
+    const size_t n = cpu_profile_tasks(s_tasks, CPU_PROFILE_TASKS);
+    for (size_t i = 0; i < n; i++) {
+        if (!room(w)) {
+            cut = true;
+            break;
+        }
+        const CpuTaskStats& t = s_tasks[i];
+        w.beginObject()
+            .field("n", t.name)
+            .field("core", (int)t.core)
+            .field("pm", (unsigned)t.permille[CPU_WINDOW_MID])
+            .field("sw", (unsigned long)t.switches)
+            .endObject();
+    }
+    w.endArray().endObject();
+}
+
+void writeMutexes(JsonWriter& w, bool& cut) {
+    w.beginArray("mutex");
+    const size_t n = mutex_profile_stats(s_mutexes, MUTEX_PROFILE_MUTEXES);
+    for (size_t i = 0; i < n; i++) {
+        if (!room(w)) {
+            cut = true;
+            break;
+        }
+        const MutexProfileStats& m = s_mutexes[i];
+        w.beginObject()
+            .field("n", m.name ? m.name : "?")
+            .field("takes", (unsigned long)m.takes)
+            .field("contended", (unsigned long)m.contended)
+            .field("timeouts", (unsigned long)m.timeouts)
+            .field("wait_avg_us", (unsigned long)m.waitAvgUs)
+            .field("wait_max_us", (unsigned long)m.waitMaxUs)
+            .field("hold_avg_us", (unsigned long)m.holdAvgUs)
+            .field("hold_max_us", (unsigned long)m.holdMaxUs)
+            .endObject();
+    }
+    w.endArray();
+}
+
+void writeHeap(JsonWriter& w) {
+    const uint32_t freeBytes = ESP.getFreeHeap();
+    const uint32_t largest = ESP.getMaxAllocHeap();
+    w.beginObject("heap")
+        .field("free", (unsigned long)freeBytes)
+        .field("largest", (unsigned long)largest)
+        .field("min", (unsigned long)ESP.getMinFreeHeap())
+        .field("frag", (unsigned)(freeBytes ? 100 - (uint64_t)largest * 100 / freeBytes : 0));
+#if HEAP_PROFILE_ENABLE
+    const HeapProfileTotals t = heap_profile_totals();
+    w.field("allocs", (unsigned long)t.allocs)
+        .field("frees", (unsigned long)t.frees)
+        .field("failures", (unsigned long)t.failures)
+        .field("live_blocks", (unsigned long)t.liveBlocks)
+        .field("live_bytes", (unsigned long)t.liveBytes);
+#endif
+    w.endObject();
+}
+
+bool appendToCard(const char* data, size_t len) {
+#if ENABLE_SD
+    if (!storage_ready()) return false;
+    if (g_sdMutex && xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS)) != pdTRUE) return false;
+    File f = SD.open(SOAK_BENCH_REPORT_PATH, "a");
+    bool ok = static_cast<bool>(f);
+    if (ok) {
+        ok = f.write(reinterpret_cast<const uint8_t*>(data), len) == len && f.write('\n') == 1;
+        f.close();
+    }
+    if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+    return ok;
+#else
+    (void)data;
+    (void)len;
+    return false;
+#endif
+}
+
+void reportJob(void*) {
+    bool cut = false;
+    JsonWriter w(s_report, sizeof(s_report));
+    w.beginObject()
+        .field("soak", (unsigned long)s_stats.reports)
+        .field("up", (unsigned long)(millis() / 1000))
+        .beginObject("load")
+        .field("sensor", (unsigned long)s_stats.sensorRecords)
+        .field("refused", (unsigned long)s_stats.sensorRefused)
+        .field("storm", (unsigned long)s_stats.stormLines)
+        .field("pages", (unsigned long)s_stats.pageSteps)
+        .field("dropped", (unsigned long)storage_droppedLines())
+        .endObject();
+    writeMetrics(w, cut);
+    writeCpu(w, cut);
+    writeMutexes(w, cut);
+    writeHeap(w);
+    w.endObject();
+    if (!w.ok()) {
+        s_stats.reportsCut++;
+        logbuf_printf("soak: report %lu did not fit %u bytes", (unsigned long)s_stats.reports,
+                      (unsigned)sizeof(s_report));
+        s_stats.reports++;
+        return;
+    }
+    if (cut) s_stats.reportsCut++;
+    s_stats.reports++;
+
+    Serial.write(reinterpret_cast<const uint8_t*>(s_report), w.length());
+    Serial.write('\n');
+    if (!appendToCard(s_report, w.length())) s_stats.sdFailures++;
+}
+} // namespace
+
+bool soak_bench_begin(SoakBenchPageFn page) {
+    s_page = page;
+    const uint32_t now = millis();
+    s_nextStormMs = now + SOAK_BENCH_STORM_MS;
+    s_nextPageMs = now + SOAK_BENCH_PAGE_MS;
+    const bool ok = service_job_add("SoakLoad", loadJob, nullptr, SOAK_BENCH_TICK_MS, 0) != SERVICE_JOB_NONE &&
+                    service_job_add("SoakReport", reportJob, nullptr, SOAK_BENCH_REPORT_MS, 0) != SERVICE_JOB_NONE;
+    logbuf_printf("soak: %s, %u records/s, storm %u lines every %lu ms, report every %lu ms",
+                  ok ? "running" : "no service job slot", (unsigned)SOAK_BENCH_SENSOR_HZ,
+                  (unsigned)SOAK_BENCH_STORM_LINES, (unsigned long)SOAK_BENCH_STORM_MS,
+                  (unsigned long)SOAK_BENCH_REPORT_MS);
+    return ok;
+}
+
+void soak_bench_stats(SoakBenchStats& out) {
+    out = s_stats;
+}
+
+void soak_bench_report(Print& out) {
+    const SoakBenchStats& s = s_stats;
+    out.printf("Soak: %lu sensor records (%lu refused), %lu storm lines, %lu page steps, %lu reports "
+               "(%lu cut, %lu not on SD)\n",
+               (unsigned long)s.sensorRecords, (unsigned long)s.sensorRefused, (unsigned long)s.stormLines,
+               (unsigned long)s.pageSteps, (unsigned long)s.reports, (unsigned long)s.reportsCut,
+               (unsigned long)s.sdFailures);
+}
+
+#endif // SOAK_BENCH_ENABLE
@@ -0,0 +1,90 @@
+/*
+ * Soak Bench
+ * A scripted load scenario for a bench unit, so two firmware revisions can be
+ * compared on the same workload before rollout:
+ *   - the modem is a recording: SOAK_BENCH_ENABLE selects MODEM_TRANSCRIPT_MODE
+ *     replay (modules/catm_gnss/modem_transcript.h), so copy a field recording
+ *     to MODEM_TRANSCRIPT_REPLAY_PATH first; without one the modem runs live
+ *   - SOAK_BENCH_SENSOR_HZ synthetic analog records go to the storage task,
+ *     Normal priority, so the pressure and shedding paths see them
+ *   - every SOAK_BENCH_STORM_MS a burst of SOAK_BENCH_STORM_LINES log lines goes
+ *     through the log buffer onto the card
+ *   - every SOAK_BENCH_PAGE_MS the panel moves to the next page, as a button
+ *     press would
+ * Every SOAK_BENCH_REPORT_MS one JSON line goes to Serial and is appended to
+ * SOAK_BENCH_REPORT_PATH:
+ *   {"soak":n,"up":s,"load":{...},"metrics":{...},"cpu":{...},"mutex":[...],"heap":{...}}
+ * with the metrics registry, per-core and per-task CPU load over the middle
+ * window, per-mutex contention and the heap sample of that minute; the lines of
+ * one run are the heap timeline. Counts are totals since boot, as in the
+ * metrics export.
+ *
+ * Build with `make bench` (SOAK_BENCH_ENABLE=1 on the command line).
+ */
+
+#ifndef SOAK_BENCH_H
+#define SOAK_BENCH_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef SOAK_BENCH_TICK_MS
+#define SOAK_BENCH_TICK_MS 100                 // load generator period
+#endif
+#ifndef SOAK_BENCH_SENSOR_HZ
+#define SOAK_BENCH_SENSOR_HZ 200               // synthetic analog records per second
+#endif
+#ifndef SOAK_BENCH_SENSOR_CHANNELS
+#define SOAK_BENCH_SENSOR_CHANNELS 8
+#endif
+#ifndef SOAK_BENCH_STORM_MS
+#define SOAK_BENCH_STORM_MS 15000UL
+#endif
+#ifndef SOAK_BENCH_STORM_LINES
+#define SOAK_BENCH_STORM_LINES 64
+#endif
+#ifndef SOAK_BENCH_PAGE_MS
+#define SOAK_BENCH_PAGE_MS 3000UL
+#endif
+#ifndef SOAK_BENCH_REPORT_MS
+#define SOAK_BENCH_REPORT_MS 60000UL
+#endif
+#ifndef SOAK_BENCH_REPORT_PATH
+#define SOAK_BENCH_REPORT_PATH "/data/soak.jsonl"
+#endif
+#ifndef SOAK_BENCH_REPORT_BYTES
+#define SOAK_BENCH_REPORT_BYTES 6144           // one report line; lists are cut to fit
+#endif
+#define SOAK_BENCH_PAGES 6                     // landing, GNSS, cellular, system, settings, scroll
+
+struct SoakBenchStats {
+    uint32_t sensorRecords;      // queued on the storage task
+    uint32_t sensorRefused;      // storage full or shedding
+    uint32_t stormLines;
+    uint32_t pageSteps;
+    uint32_t reports;
+    uint32_t reportsCut;         // did not fit SOAK_BENCH_REPORT_BYTES whole
+    uint32_t sdFailures;         // reports that did not reach the card
+};
+
+// Display owner: moves the panel to step % SOAK_BENCH_PAGES; runs on the
+// service task
+typedef void (*SoakBenchPageFn)(uint32_t step);
+
+#if SOAK_BENCH_ENABLE
+
+// setup(), after the storage task and the service task are up; page may be null
+// (no panel)
+bool soak_bench_begin(SoakBenchPageFn page);
+void soak_bench_stats(SoakBenchStats& out);
+void soak_bench_report(Print& out);
+
+#else
+
+inline bool soak_bench_begin(SoakBenchPageFn) { return false; }
+inline void soak_bench_stats(SoakBenchStats& out) { out = SoakBenchStats{}; }
+inline void soak_bench_report(Print&) {}
+
+#endif // SOAK_BENCH_ENABLE
+
+#endif // SOAK_BENCH_H
@@ -0,0 +1,208 @@
+/*
+ * Stack Watermark Profiler Implementation
+ */
+
+#include "stack_profiler.h"
+
+#if STACK_PROFILE_ENABLE
+
+#include "kernel_objects.h"
+#include "service_task.h"
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+#if ENABLE_SD
+#include <SD.h>
+#include "../modules/storage/storage_task.h"
+#endif
+
+namespace {
+constexpr size_t kTasks = static_cast<size_t>(KernelTask::Count);
+constexpr uint32_t kMagic = 0x53504B31;   // "SPK1"
+constexpr const char* kNamespace = "stack_prof";
+constexpr const char* kKey = "peaks";
+
+#define STACK_PROFILE_NAME(id, name, stack) name,
+#define STACK_PROFILE_SIZE(id, name, stack) static_cast<uint32_t>(stack),
+#define STACK_PROFILE_MACRO(id, name, stack) #stack,
+const char* const kNames[kTasks] = {KERNEL_TASKS(STACK_PROFILE_NAME)};
+const uint32_t kSizes[kTasks] = {KERNEL_TASKS(STACK_PROFILE_SIZE)};
+const char* const kMacros[kTasks] = {KERNEL_TASKS(STACK_PROFILE_MACRO)};
+#undef STACK_PROFILE_NAME
+#undef STACK_PROFILE_SIZE
+#undef STACK_PROFILE_MACRO
+
+// NVS image; tableHash ties it to the task names it was recorded for
+struct Saved {
+    uint32_t magic;
+    uint32_t tableHash;
+    uint32_t soakS;          // uptime summed over the boots before this one
+    uint16_t boots;
+    uint16_t count;
+    uint16_t peak[kTasks];   // deepest use in bytes, 0 = never seen
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Saved s_saved;               // peaks include this boot
+bool s_dirty = false;        // a peak grew since the last save
+uint32_t s_lastSaveMs = 0;
+uint32_t s_startS = 0;       // uptime when this boot's soak started (moves on reset)
+int s_job = SERVICE_JOB_NONE;
+
+uint32_t tableHash() {
+    uint32_t h = 2166136261u;   // FNV-1a over the names, in table order
+    for (size_t i = 0; i < kTasks; i++) {
+        for (const char* p = kNames[i]; *p; p++) h = (h ^ static_cast<uint8_t>(*p)) * 16777619u;
+        h = (h ^ 0xFF) * 16777619u;
+    }
+    return h;
+}
+
+void resetImage() {
+    memset(&s_saved, 0, sizeof(s_saved));
+    s_saved.magic = kMagic;
+    s_saved.tableHash = tableHash();
+    s_saved.count = kTasks;
+}
+
+uint32_t recommend(uint32_t peak) {
+    uint32_t headroom = peak * STACK_PROFILE_MARGIN_PERCENT / 100;
+    if (headroom < STACK_PROFILE_MIN_HEADROOM) headroom = STACK_PROFILE_MIN_HEADROOM;
+    const uint32_t size = peak + headroom;
+    return (size + STACK_PROFILE_ROUND - 1) / STACK_PROFILE_ROUND * STACK_PROFILE_ROUND;
+}
+
+void profileJob(void*) {
+    stack_profile_sample();
+    const uint32_t now = millis();
+    if (s_dirty && now - s_lastSaveMs >= STACK_PROFILE_SAVE_MS) {
+        stack_profile_save();
+    }
+}
+} // namespace
+
+bool stack_profile_begin() {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    resetImage();
+    Preferences prefs;
+    if (prefs.begin(kNamespace, true)) {
+        Saved stored;
+        if (prefs.getBytes(kKey, &stored, sizeof(stored)) == sizeof(stored) && stored.magic == kMagic &&
+            stored.tableHash == s_saved.tableHash && stored.count == kTasks) {
+            s_saved = stored;
+        }
+        prefs.end();
+    }
+    s_saved.boots++;
+    s_lastSaveMs = millis();
+    s_job = service_job_add("StackProfile", profileJob, nullptr, STACK_PROFILE_SAMPLE_MS,
+                            STACK_PROFILE_JOB_BUDGET_US);
+    Serial.printf("StackProfile: %u tasks, boot %u, %lu s soaked so far\n", (unsigned)kTasks,
+                  (unsigned)s_saved.boots, (unsigned long)s_saved.soakS);
+    return s_job != SERVICE_JOB_NONE;
+}
+
+void stack_profile_sample() {
+    for (size_t i = 0; i < kTasks; i++) {
+        TaskHandle_t h = xTaskGetHandle(kNames[i]);
+        if (!h) continue;
+        const uint32_t freeBytes = uxTaskGetStackHighWaterMark(h) * sizeof(StackType_t);
+        const uint32_t used = freeBytes < kSizes[i] ? kSizes[i] - freeBytes : 0;
+        portENTER_CRITICAL(&s_mux);
+        if (used > s_saved.peak[i]) {
+            s_saved.peak[i] = used > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(used);
+            s_dirty = true;
+        }
+        portEXIT_CRITICAL(&s_mux);
+    }
+}
+
+void stack_profile_report(Print& out) {
+    portENTER_CRITICAL(&s_mux);
+    const Saved snap = s_saved;
+    portEXIT_CRITICAL(&s_mux);
+    const uint32_t soakS = snap.soakS + millis() / 1000 - s_startS;
+
+    out.printf("Stack profile: %lu s over %u boots\n", (unsigned long)soakS, (unsigned)snap.boots);
+    out.println("  task          stack   peak   free  recommended");
+    int32_t reclaim = 0;
+    for (size_t i = 0; i < kTasks; i++) {
+        if (!snap.peak[i]) {
+            out.printf("  %-12s %6lu      -      -  (not seen)\n", kNames[i], (unsigned long)kSizes[i]);
+            continue;
+        }
+        const uint32_t rec = recommend(snap.peak[i]);
+        reclaim += static_cast<int32_t>(kSizes[i]) - static_cast<int32_t>(rec);
+        out.printf("  %-12s %6lu %6u %6lu %6lu\n", kNames[i], (unsigned long)kSizes[i], (unsigned)snap.peak[i],
+                   (unsigned long)(kSizes[i] - snap.peak[i]), (unsigned long)rec);
+    }
+    out.printf("  recommended sizes free %ld bytes of stack\n", (long)reclaim);
+
+    out.printf("// task_config.h: peak + %u%%, >= %u B headroom, %u B steps, %lu s soak\n",
+               (unsigned)STACK_PROFILE_MARGIN_PERCENT, (unsigned)STACK_PROFILE_MIN_HEADROOM,
+               (unsigned)STACK_PROFILE_ROUND, (unsigned long)soakS);
+    for (size_t i = 0; i < kTasks; i++) {
+        if (!snap.peak[i]) {
+            out.printf("// %s: not seen, keep %lu\n", kMacros[i], (unsigned long)kSizes[i]);
+            continue;
+        }
+        out.printf("#define %-31s %5lu  // %s: peak %u of %lu\n", kMacros[i],
+                   (unsigned long)recommend(snap.peak[i]), kNames[i], (unsigned)snap.peak[i],
+                   (unsigned long)kSizes[i]);
+    }
+}
+
+bool stack_profile_save(const char* path) {
+    portENTER_CRITICAL(&s_mux);
+    Saved image = s_saved;
+    s_dirty = false;
+    portEXIT_CRITICAL(&s_mux);
+    s_lastSaveMs = millis();
+    // NVS holds the time of the boots before this one plus this uptime
+    image.soakS += s_lastSaveMs / 1000 - s_startS;
+
+    bool ok = false;
+    Preferences prefs;
+    if (prefs.begin(kNamespace, false)) {
+        ok = prefs.putBytes(kKey, &image, sizeof(image)) == sizeof(image);
+        prefs.end();
+    }
+    if (!ok) {
+        Serial.println("StackProfile: NVS save failed");
+    }
+
+#if ENABLE_SD
+    if (path) {
+        // Null until the storage task starts
+        if (!g_sdMutex || xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS)) == pdTRUE) {
+            File f = SD.open(path, FILE_WRITE);
+            if (f) {
+                stack_profile_report(f);
+                f.close();
+            }
+            if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+        }
+    }
+#else
+    (void)path;
+#endif
+    return ok;
+}
+
+void stack_profile_reset() {
+    portENTER_CRITICAL(&s_mux);
+    const uint16_t boots = s_saved.boots;
+    resetImage();
+    s_saved.boots = boots ? 1 : 0;
+    s_dirty = false;
+    s_startS = millis() / 1000;
+    portEXIT_CRITICAL(&s_mux);
+    Preferences prefs;
+    if (prefs.begin(kNamespace, false)) {
+        prefs.remove(kKey);
+        prefs.end();
+    }
+}
+
+#endif // STACK_PROFILE_ENABLE
@@ -0,0 +1,72 @@
+/*
+ * Stack Watermark Profiler
+ * Soak-run profiling of the stack depth of every task in the kernel object table
+ * (KERNEL_TASKS in task_config.h), to size the stacks from evidence instead of
+ * guesses.
+ *   - a service job (service_task.h) reads each task's high-water mark and keeps
+ *     the deepest use seen
+ *   - peaks, soak time and boot count persist in NVS and accumulate across
+ *     reboots, so a soak can span power cycles and firmware updates; renaming a
+ *     task or changing the table starts the profile over
+ *   - the report ends in a ready-to-paste task_config.h stack table: peak plus
+ *     STACK_PROFILE_MARGIN_PERCENT, at least STACK_PROFILE_MIN_HEADROOM bytes of
+ *     headroom, rounded up to STACK_PROFILE_ROUND bytes
+ *
+ * Run a soak with STACK_PROFILE_ENABLE=1 and every feature the field build uses,
+ * exercise every page and modem state, then read the report (Serial via
+ * MemoryMonitor::printStats, or STACK_PROFILE_REPORT_PATH on the SD card).
+ * Peaks only reflect code paths that actually ran.
+ */
+
+#ifndef STACK_PROFILER_H
+#define STACK_PROFILER_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+
+#ifndef STACK_PROFILE_SAMPLE_MS
+#define STACK_PROFILE_SAMPLE_MS 5000            // high-water mark poll period
+#endif
+#ifndef STACK_PROFILE_SAVE_MS
+#define STACK_PROFILE_SAVE_MS (10UL * 60UL * 1000UL)   // NVS/SD save period, only when a peak grew
+#endif
+#ifndef STACK_PROFILE_MARGIN_PERCENT
+#define STACK_PROFILE_MARGIN_PERCENT 25
+#endif
+#ifndef STACK_PROFILE_MIN_HEADROOM
+#define STACK_PROFILE_MIN_HEADROOM 512          // bytes kept free above the peak at least
+#endif
+#ifndef STACK_PROFILE_ROUND
+#define STACK_PROFILE_ROUND 256
+#endif
+#ifndef STACK_PROFILE_REPORT_PATH
+#define STACK_PROFILE_REPORT_PATH "/data/stack_profile.txt"
+#endif
+#define STACK_PROFILE_JOB_BUDGET_US 2000        // per sample; saves run longer and are rare
+
+#if STACK_PROFILE_ENABLE
+
+// Loads the persisted profile and schedules the sampling job. Call once from setup().
+bool stack_profile_begin();
+
+// Polls every task now (the job does this every STACK_PROFILE_SAMPLE_MS)
+void stack_profile_sample();
+
+// Per-task table, then the recommended task_config.h stack sizes
+void stack_profile_report(Print& out);
+// Persists the peaks to NVS and writes the report to path (SD, when present)
+bool stack_profile_save(const char* path = STACK_PROFILE_REPORT_PATH);
+// Forgets all peaks, in RAM and in NVS
+void stack_profile_reset();
+
+#else
+
+inline bool stack_profile_begin() { return false; }
+inline void stack_profile_sample() {}
+inline void stack_profile_report(Print&) {}
+inline bool stack_profile_save(const char* = nullptr) { return false; }
+inline void stack_profile_reset() {}
+
+#endif // STACK_PROFILE_ENABLE
+
+#endif // STACK_PROFILER_H
@@ -0,0 +1,149 @@
+/*
+ * Per-Task Heap Accounting Implementation
+ */
+
+#include "task_heap.h"
+
+#if HEAP_PROFILE_ENABLE
+
+#include "../config/task_config.h"
+#include "../include/error_handler.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+struct BudgetEntry {
+    const char* name;
+    uint32_t budget;
+};
+
+#define TASK_HEAP_BUDGET_ENTRY(taskName, bytes) {taskName, bytes},
+const BudgetEntry kBudgets[] = {TASK_HEAP_BUDGETS(TASK_HEAP_BUDGET_ENTRY)};
+#undef TASK_HEAP_BUDGET_ENTRY
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+TaskHeapUsage s_accounts[TASK_HEAP_SLOTS] = {{nullptr, "other", 0, 0, 0, 0, 0}};
+uint32_t s_reportedDenied[TASK_HEAP_SLOTS];   // poller only
+
+uint32_t budgetFor(const char* name) {
+    for (const BudgetEntry& b : kBudgets) {
+        if (strcmp(b.name, name) == 0) return b.budget;
+    }
+    return 0;
+}
+
+// Under s_mux. Tasks claim a slot on their first allocation.
+uint8_t slotFor(TaskHandle_t task) {
+    for (uint8_t i = 1; i < TASK_HEAP_SLOTS; i++) {
+        if (s_accounts[i].task == task) return i;
+    }
+    for (uint8_t i = 1; i < TASK_HEAP_SLOTS; i++) {
+        TaskHeapUsage& a = s_accounts[i];
+        if (!a.task) {
+            a.task = task;
+            strncpy(a.name, pcTaskGetName(task), sizeof(a.name) - 1);
+            a.name[sizeof(a.name) - 1] = '\0';
+            a.budget = budgetFor(a.name);
+            return i;
+        }
+    }
+    return 0;
+}
+} // namespace
+
+uint8_t task_heap_admit(size_t size) {
+    TaskHandle_t task = nullptr;
+    if (!xPortInIsrContext() && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        task = xTaskGetCurrentTaskHandle();
+    }
+    portENTER_CRITICAL_SAFE(&s_mux);
+    const uint8_t slot = task ? slotFor(task) : 0;
+    TaskHeapUsage& a = s_accounts[slot];
+    a.allocs++;
+    if (a.budget && a.liveBytes + size > a.budget) {
+        a.denied++;
+#if TASK_HEAP_BUDGET_ENFORCE
+        portEXIT_CRITICAL_SAFE(&s_mux);
+        return TASK_HEAP_DENIED;
+#endif
+    }
+    a.liveBytes += size;
+    if (a.liveBytes > a.peakBytes) a.peakBytes = a.liveBytes;
+    portEXIT_CRITICAL_SAFE(&s_mux);
+    return slot;
+}
+
+void task_heap_charge(uint8_t slot, size_t size) {
+    if (slot >= TASK_HEAP_SLOTS) return;
+    portENTER_CRITICAL_SAFE(&s_mux);
+    TaskHeapUsage& a = s_accounts[slot];
+    a.liveBytes += size;
+    if (a.liveBytes > a.peakBytes) a.peakBytes = a.liveBytes;
+    portEXIT_CRITICAL_SAFE(&s_mux);
+}
+
+void task_heap_release(uint8_t slot, size_t size) {
+    if (slot >= TASK_HEAP_SLOTS) return;
+    portENTER_CRITICAL_SAFE(&s_mux);
+    TaskHeapUsage& a = s_accounts[slot];
+    a.liveBytes -= size < a.liveBytes ? size : a.liveBytes;
+    portEXIT_CRITICAL_SAFE(&s_mux);
+}
+
+void task_heap_poll() {
+    for (uint8_t i = 0; i < TASK_HEAP_SLOTS; i++) {
+        portENTER_CRITICAL(&s_mux);
+        const TaskHeapUsage a = s_accounts[i];
+        portEXIT_CRITICAL(&s_mux);
+        if (a.denied == s_reportedDenied[i]) continue;
+
+        const uint32_t fresh = a.denied - s_reportedDenied[i];
+        s_reportedDenied[i] = a.denied;
+        char desc[96];
+        snprintf(desc, sizeof(desc), "Heap budget exceeded: %lu allocation(s) %s, %lu/%lu B live",
+                 static_cast<unsigned long>(fresh), TASK_HEAP_BUDGET_ENFORCE ? "refused" : "over",
+                 static_cast<unsigned long>(a.liveBytes), static_cast<unsigned long>(a.budget));
+        ErrorHandler::getInstance()->reportError(ERROR_MEMORY_FAULT, ErrorSeverity::WARNING,
+                                                 ErrorCategory::MEMORY, desc, a.name);
+    }
+}
+
+size_t task_heap_snapshot(TaskHeapUsage* out, size_t max) {
+    if (!out) return 0;
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 0; i < TASK_HEAP_SLOTS && n < max; i++) {
+        if (i == 0 || s_accounts[i].task) out[n++] = s_accounts[i];
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+bool task_heap_usage(TaskHandle_t task, TaskHeapUsage& out) {
+    bool found = false;
+    portENTER_CRITICAL(&s_mux);
+    for (uint8_t i = 1; i < TASK_HEAP_SLOTS; i++) {
+        if (s_accounts[i].task == task) {
+            out = s_accounts[i];
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return found;
+}
+
+void task_heap_report(Print& out) {
+    TaskHeapUsage usage[TASK_HEAP_SLOTS];
+    const size_t n = task_heap_snapshot(usage, TASK_HEAP_SLOTS);
+    for (size_t i = 0; i < n; i++) {
+        const TaskHeapUsage& a = usage[i];
+        if (!a.allocs) continue;
+        out.printf("Task heap %s: %lu B live, peak %lu, budget %lu, allocs %lu, denied %lu\n", a.name,
+                   static_cast<unsigned long>(a.liveBytes), static_cast<unsigned long>(a.peakBytes),
+                   static_cast<unsigned long>(a.budget), static_cast<unsigned long>(a.allocs),
+                   static_cast<unsigned long>(a.denied));
+    }
+}
+
+#endif // HEAP_PROFILE_ENABLE
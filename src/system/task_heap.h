@@ -0,0 +1,70 @@
+/*
+ * Per-Task Heap Accounting
+ * Charges every heap block to the task that allocated it (the block is credited
+ * back when freed, by whichever task frees it) and enforces the per-task
+ * budgets from task_config.h, so one runaway task cannot starve the others.
+ *
+ * Rides on the heap profiler's allocation hooks (heap_profiler.h): built in with
+ * HEAP_PROFILE_ENABLE and its linker flags. A task over budget gets nullptr
+ * immediately, before the heap is touched; with TASK_HEAP_BUDGET_ENFORCE 0 the
+ * allocation goes through and is only counted. Denials are reported through
+ * ErrorHandler from task_heap_poll(), never from inside the allocator.
+ *
+ * operator new aborts on nullptr unless it is the nothrow form, so budgets suit
+ * tasks whose growth comes from malloc/String/ArduinoJson; give a task that
+ * relies on plain new a budget of 0 (accounted only).
+ */
+
+#ifndef TASK_HEAP_H
+#define TASK_HEAP_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "../config/system_config.h"
+
+#ifndef TASK_HEAP_BUDGET_ENFORCE
+#define TASK_HEAP_BUDGET_ENFORCE 1
+#endif
+#define TASK_HEAP_SLOTS 16             // slot 0 = ISR, boot and unlisted tasks once the table is full
+
+#define TASK_HEAP_DENIED 0xFF          // task_heap_admit(): over budget
+
+struct TaskHeapUsage {
+    TaskHandle_t task;
+    char name[16];
+    uint32_t budget;       // 0 = unlimited
+    uint32_t liveBytes;    // requested bytes, not heap block sizes
+    uint32_t peakBytes;
+    uint32_t allocs;
+    uint32_t denied;       // refused (or, without enforcement, over budget)
+};
+
+#if HEAP_PROFILE_ENABLE
+
+// Called by the allocation hooks. admit() attributes size to the current task and
+// reserves it: a slot index, or TASK_HEAP_DENIED. release() returns bytes to a slot
+// (failed or untracked allocations, and frees); charge() puts them back unchecked
+// (the old block of a failed realloc).
+uint8_t task_heap_admit(size_t size);
+void task_heap_charge(uint8_t slot, size_t size);
+void task_heap_release(uint8_t slot, size_t size);
+
+// Reports new denials through ErrorHandler. Call periodically from one task.
+void task_heap_poll();
+
+// Copies the accounts; returns how many were written
+size_t task_heap_snapshot(TaskHeapUsage* out, size_t max);
+bool task_heap_usage(TaskHandle_t task, TaskHeapUsage& out);
+void task_heap_report(Print& out);
+
+#else
+
+inline void task_heap_poll() {}
+inline size_t task_heap_snapshot(TaskHeapUsage*, size_t) { return 0; }
+inline bool task_heap_usage(TaskHandle_t, TaskHeapUsage&) { return false; }
+inline void task_heap_report(Print&) {}
+
+#endif // HEAP_PROFILE_ENABLE
+
+#endif // TASK_HEAP_H
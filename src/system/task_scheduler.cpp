@@ -7,6 +7,10 @@
 #include "../include/memory_pool.h"
 #include "../include/error_handler.h"
 #include "../modules/logging/log_buffer.h"
+#include "task_heap.h"
+#include "cpu_profiler.h"
+#include "core_affinity.h"
+#include "service_task.h"
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -36,6 +40,7 @@ TaskScheduler::TaskScheduler() {
     // Initialize synchronization
     schedulerMutex = xSemaphoreCreateMutex();
     loadBalancerMutex = xSemaphoreCreateMutex();
+    taskMonitorJob = SERVICE_JOB_NONE;
     
     // Initialize performance metrics
     memset(&performanceMetrics, 0, sizeof(performanceMetrics));
@@ -292,6 +297,15 @@ void TaskScheduler::balanceAdaptive(float cpuLoad) {
     for (uint8_t i = 0; i < taskCount; i++) {
         TaskInfo& task = taskRegistry[i];
         
+        // A non-critical task measured above its CPU allowance yields first
+        if (!task.is_critical && task.max_cpu_percentage > 0.0f &&
+            task.cpu_percentage > task.max_cpu_percentage) {
+            UBaseType_t newPriority = (UBaseType_t)max((int)1, (int)(task.base_priority - 1));
+            vTaskPrioritySet(task.handle, newPriority);
+            task.dynamic_priority = newPriority;
+            continue;
+        }
+        
         // Calculate efficiency score
         float efficiency = calculateTaskEfficiency(task);
         
@@ -387,26 +401,11 @@ void TaskScheduler::checkTaskHealth(TaskInfo& task, uint32_t currentTime) {
 // PERFORMANCE ANALYSIS
 // ============================================================================
 float TaskScheduler::measureCpuLoad() {
-    // Use FreeRTOS runtime stats if available
-    #if (configGENERATE_RUN_TIME_STATS == 1)
-        static uint32_t previousTotalRunTime = 0;
-        static uint32_t previousIdleTime = 0;
-        
-        uint32_t totalRunTime, idleTime;
-        vTaskGetRunTimeStats(&totalRunTime, &idleTime);
-        
-        uint32_t totalDelta = totalRunTime - previousTotalRunTime;
-        uint32_t idleDelta = idleTime - previousIdleTime;
-        
-        if (totalDelta > 0) {
-            float cpuLoad = 1.0f - ((float)idleDelta / totalDelta);
-            
-            previousTotalRunTime = totalRunTime;
-            previousIdleTime = idleTime;
-            
-            return cpuLoad;
-        }
-    #endif
+    // Measured busy time of both cores, once the CPU profiler has a sample
+    float measured = cpu_profile_load(CPU_WINDOW_LAST);
+    if (measured >= 0.0f) {
+        return measured;
+    }
     
     // Fallback: estimate based on task activity
     return estimateCpuLoadFromTasks();
@@ -511,6 +510,15 @@ void TaskScheduler::updateCpuMetrics() {
     }
     
     performanceMetrics.average_cpu_load = getAverageCpuLoad();
+    
+    // Per-task share of one core over the profiler's middle window
+    for (uint8_t i = 0; i < taskCount; i++) {
+        TaskInfo& task = taskRegistry[i];
+        float load = cpu_profile_task_load(task.handle, CPU_WINDOW_MID);
+        if (load >= 0.0f) {
+            task.cpu_percentage = load * 100.0f;
+        }
+    }
 }
 
 void TaskScheduler::updateMemoryMetrics() {
@@ -521,10 +529,14 @@ void TaskScheduler::updateMemoryMetrics() {
     performanceMetrics.total_stack_used = 0;
     performanceMetrics.total_memory_allocated = performanceMetrics.total_heap_used;
     
-    // Calculate stack usage
+    // Calculate stack usage, and heap held per task when accounting is built in
     for (uint8_t i = 0; i < taskCount; i++) {
         TaskInfo& task = taskRegistry[i];
         performanceMetrics.total_stack_used += task.stack_peak;
+        TaskHeapUsage usage;
+        if (task_heap_usage(task.handle, usage)) {
+            task.memory_allocated = usage.liveBytes;
+        }
     }
 }
 
@@ -548,14 +560,9 @@ void TaskScheduler::startSchedulerTasks() {
 
 // Additional public methods
 void TaskScheduler::stopAllScheduledTasks() {
-    if (taskMonitorTask) {
-        vTaskDelete(taskMonitorTask);
-        taskMonitorTask = nullptr;
-    }
-    
-    if (loadBalancerTask) {
-        vTaskDelete(loadBalancerTask);
-        loadBalancerTask = nullptr;
+    if (taskMonitorJob != SERVICE_JOB_NONE) {
+        service_job_remove(taskMonitorJob);
+        taskMonitorJob = SERVICE_JOB_NONE;
     }
 }
 
@@ -669,8 +676,26 @@ void TaskScheduler::optimizeForPower() {
 }
 
 void TaskScheduler::optimizeForMemory() {
-    // Memory optimization would involve garbage collection and buffer cleanup
     logbuf_printf("Optimizing for memory usage");
+
+    // Slow down non-critical tasks holding most of their heap budget, so they
+    // allocate less often while the rest of the system keeps running
+    for (uint8_t i = 0; i < taskCount; i++) {
+        TaskInfo& task = taskRegistry[i];
+        TaskHeapUsage usage;
+        if (!task_heap_usage(task.handle, usage) || usage.budget == 0) continue;
+        task.memory_allocated = usage.liveBytes;
+
+        const bool nearBudget = usage.liveBytes > usage.budget / 4 * 3;
+        if (nearBudget && !task.is_critical && task.dynamic_priority >= task.base_priority) {
+            logbuf_printf("Task %s holds %lu/%lu B heap; lowering priority", task.name,
+                          (unsigned long)usage.liveBytes, (unsigned long)usage.budget);
+            reduceTaskPriority(task.handle, 1);
+        } else if (!nearBudget && task.dynamic_priority < task.base_priority &&
+                   usage.liveBytes < usage.budget / 2) {
+            adjustTaskPriority(task.handle, task.base_priority);
+        }
+    }
 }
 
 void TaskScheduler::optimizeOverall() {
@@ -679,7 +704,7 @@ void TaskScheduler::optimizeOverall() {
 }
 
 bool TaskScheduler::enableTaskAffinity() {
-    #if (configNUM_CORES > 1)
+    #if (portNUM_PROCESSORS > 1) && CORE_AFFINITY_ENABLE
         optimizeTaskAffinity();
         return true;
     #else
@@ -687,9 +712,11 @@ bool TaskScheduler::enableTaskAffinity() {
     #endif
 }
 
+// Re-pinning a running task needs the SMP kernel; the ESP-IDF kernel pins at
+// creation, where kernel_task_create() applies the tuner's layout instead
 bool TaskScheduler::disableTaskAffinity() {
     // Remove core affinity restrictions
-    #if (configNUM_CORES > 1)
+    #if CONFIG_FREERTOS_SMP
         for (uint8_t i = 0; i < taskCount; i++) {
             TaskInfo& task = taskRegistry[i];
             vTaskCoreAffinitySet(task.handle, tskNO_AFFINITY);
@@ -701,13 +728,16 @@ bool TaskScheduler::disableTaskAffinity() {
 }
 
 void TaskScheduler::setTaskCoreAffinity(TaskHandle_t handle, uint32_t coreMask) {
-    #if (configNUM_CORES > 1)
+    #if CONFIG_FREERTOS_SMP
         vTaskCoreAffinitySet(handle, coreMask);
+    #else
+        logbuf_printf("TaskScheduler: %s stays pinned; affinity applies when it is created",
+                      handle ? pcTaskGetName(handle) : "?");
     #endif
 }
 
 void TaskScheduler::migrateTaskToCore(TaskHandle_t handle, uint32_t targetCore) {
-    #if (configNUM_CORES > 1)
+    #if (portNUM_PROCESSORS > 1)
         setTaskCoreAffinity(handle, 1 << targetCore);
     #endif
 }
@@ -748,28 +778,42 @@ void TaskScheduler::printLoadBalanceStatus() const {
 void TaskScheduler::exportTaskStatistics(char* buffer, size_t bufferSize) {
     if (!buffer || bufferSize == 0) return;
     
-    snprintf(buffer, bufferSize,
+    int len = snprintf(buffer, bufferSize,
              "TaskStats: total=%u,active=%u,cpu=%.1f%%,health=%.1f%%,restarts=%u",
              performanceMetrics.total_tasks,
              performanceMetrics.active_tasks,
              performanceMetrics.current_cpu_load * 100.0f,
              performanceMetrics.overall_health_score,
              performanceMetrics.task_restarts);
+    
+    // Measured per-core load (last/mid/long windows) and the busiest tasks
+    for (uint8_t core = 0; core < CPU_PROFILE_CORES; core++) {
+        if (len < 0 || (size_t)len >= bufferSize) return;
+        CpuCoreStats cs;
+        if (!cpu_profile_core(core, cs)) break;
+        len += snprintf(buffer + len, bufferSize - len, ",core%u=%u/%u/%u",
+                        core, cs.busyPermille[CPU_WINDOW_LAST] / 10, cs.busyPermille[CPU_WINDOW_MID] / 10,
+                        cs.busyPermille[CPU_WINDOW_LONG] / 10);
+    }
+    CpuTaskStats top[3 + CPU_PROFILE_CORES];
+    size_t n = cpu_profile_tasks(top, 3 + CPU_PROFILE_CORES);
+    uint8_t shown = 0;
+    for (size_t i = 0; i < n && shown < 3; i++) {
+        if (strncmp(top[i].name, "IDLE", 4) == 0) continue;
+        if (len < 0 || (size_t)len >= bufferSize) return;
+        len += snprintf(buffer + len, bufferSize - len, "%s%s=%.1f%%",
+                        shown == 0 ? ",top=" : ";", top[i].name, top[i].permille[CPU_WINDOW_MID] / 10.0f);
+        shown++;
+    }
 }
 
 // ============================================================================
 // TASK MANAGEMENT
 // ============================================================================
 void TaskScheduler::startTaskMonitoring() {
-    if (!taskMonitorTask) {
-        xTaskCreate(
-            vTaskSchedulerMonitor,
-            "TaskMonitor",
-            TASK_SCHEDULER_STACK_SIZE,
-            nullptr,
-            TASK_SCHEDULER_PRIORITY,
-            &taskMonitorTask
-        );
+    if (taskMonitorJob == SERVICE_JOB_NONE) {
+        taskMonitorJob = service_job_add("TaskMonitor", schedulerMonitorJob, this,
+                                         TASK_MONITOR_INTERVAL_MS, TASK_MONITOR_JOB_BUDGET_US);
     }
 }
 
@@ -782,29 +826,11 @@ void TaskScheduler::restartTask(TaskInfo& task) {
 }
 
 void TaskScheduler::optimizeTaskAffinity() {
-    #if (configNUM_CORES > 1)
-        // Distribute tasks across cores for ESP32-S3
-        uint32_t core0Tasks = 0;
-        uint32_t core1Tasks = 0;
-        
-        for (uint8_t i = 0; i < taskCount; i++) {
-            TaskInfo& task = taskRegistry[i];
-            
-            eTaskState state = eTaskGetState(task.handle);
-            if (state != eDeleted && state != eInvalid) {
-                if (core0Tasks <= core1Tasks) {
-                    vTaskCoreAffinitySet(task.handle, 0);
-                    core0Tasks++;
-                } else {
-                    vTaskCoreAffinitySet(task.handle, 1);
-                    core1Tasks++;
-                }
-            }
-        }
-        
-        logbuf_printf("TaskScheduler: Distributed tasks - Core0: %u, Core1: %u",
-                     core0Tasks, core1Tasks);
-    #endif
+    // Measured placement (core_affinity.h): roles, per-core load and cross-core wakeups
+    if (core_affinity_evaluate()) {
+        logbuf_printf("TaskScheduler: core affinity tuner recommends a new layout%s",
+                      CORE_AFFINITY_APPLY ? "" : " (report only)");
+    }
 }
 
 // ============================================================================
@@ -833,38 +859,23 @@ void TaskScheduler::giveLoadBalancerMutex() {
 }
 
 // ============================================================================
-// TASK FUNCTIONS
+// SERVICE JOB FUNCTIONS
 // ============================================================================
-void vTaskSchedulerMonitor(void* pvParameters) {
-    TaskScheduler* scheduler = TaskScheduler::getInstance();
+void schedulerMonitorJob(void* ctx) {
+    TaskScheduler* scheduler = static_cast<TaskScheduler*>(ctx);
     
-    while (true) {
-        // Monitor task performance
-        scheduler->monitorTaskPerformance();
-        
-        // Balance CPU load
-        scheduler->balanceCpuLoad();
-        
-        // Update performance metrics
-        scheduler->updatePerformanceMetrics();
-        
-        // Check for optimizations
-        if (millis() - scheduler->performanceMetrics.last_optimization > OPTIMIZATION_INTERVAL_MS) {
-            scheduler->optimizeTaskAffinity();
-            scheduler->performanceMetrics.last_optimization = millis();
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(TASK_MONITOR_INTERVAL_MS));
-    }
-}
-
-void vTaskLoadBalancer(void* pvParameters) {
-    TaskScheduler* scheduler = TaskScheduler::getInstance();
+    // Monitor task performance
+    scheduler->monitorTaskPerformance();
     
-    while (true) {
-        // Perform load balancing
-        scheduler->balanceCpuLoad();
-        
-        vTaskDelay(pdMS_TO_TICKS(LOAD_BALANCER_INTERVAL_MS));
+    // Balance CPU load
+    scheduler->balanceCpuLoad();
+    
+    // Update performance metrics
+    scheduler->updatePerformanceMetrics();
+    
+    // Check for optimizations
+    if (millis() - scheduler->performanceMetrics.last_optimization > OPTIMIZATION_INTERVAL_MS) {
+        scheduler->optimizeTaskAffinity();
+        scheduler->performanceMetrics.last_optimization = millis();
     }
 }
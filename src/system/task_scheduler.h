@@ -20,10 +20,8 @@
 #define STACK_USAGE_WARNING_THRESHOLD 1024  // 1KB minimum free stack
 #define PERFORMANCE_PRIORITY_BOOST 2
 
-#define TASK_SCHEDULER_STACK_SIZE 4096
-#define TASK_SCHEDULER_PRIORITY 3
 #define TASK_MONITOR_INTERVAL_MS 5000
-#define LOAD_BALANCER_INTERVAL_MS 10000
+#define TASK_MONITOR_JOB_BUDGET_US 20000    // service job run-time budget
 #define OPTIMIZATION_INTERVAL_MS 60000
 
 // ============================================================================
@@ -141,9 +139,8 @@ private:
     SemaphoreHandle_t schedulerMutex;
     SemaphoreHandle_t loadBalancerMutex;
     
-    // Task handles
-    TaskHandle_t taskMonitorTask;
-    TaskHandle_t loadBalancerTask;
+    // Service job (service_task.h)
+    int taskMonitorJob;
     
     // Internal methods
     void startSchedulerTasks();
@@ -297,10 +294,10 @@ inline bool isTaskHealthy(const TaskInfo& task) {
 }
 
 // ============================================================================
-// TASK FUNCTION DECLARATIONS
+// SERVICE JOB FUNCTIONS
 // ============================================================================
-void vTaskSchedulerMonitor(void* pvParameters);
-void vTaskLoadBalancer(void* pvParameters);
+// One monitoring pass: performance, load balancing, metrics, affinity optimization
+void schedulerMonitorJob(void* ctx);
 
 // ============================================================================
 // CONVENIENCE MACROS
@@ -0,0 +1,54 @@
+/*
+ * Text Buffer
+ * printf-style appends into a caller's char buffer, for status text formatted
+ * when a page or a console command asks for it rather than kept as Strings.
+ * The text is always NUL-terminated; what does not fit is cut and truncated()
+ * says so.
+ */
+
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+class TextBuffer {
+public:
+    TextBuffer(char* out, size_t size) : out_(out), size_(out ? size : 0), len_(0), truncated_(false) {
+        if (size_) out_[0] = '\0';
+    }
+
+    TextBuffer& print(const char* s) { return printf("%s", s ? s : ""); }
+
+    TextBuffer& printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (len_ + 1 >= size_) {
+            truncated_ = truncated_ || size_ == 0 || fmt[0] != '\0';
+            return *this;
+        }
+        va_list ap;
+        va_start(ap, fmt);
+        const int n = vsnprintf(out_ + len_, size_ - len_, fmt, ap);
+        va_end(ap);
+        if (n < 0) return *this;
+        if ((size_t)n >= size_ - len_) {
+            len_ = size_ - 1;
+            truncated_ = true;
+        } else {
+            len_ += (size_t)n;
+        }
+        return *this;
+    }
+
+    const char* c_str() const { return size_ ? out_ : ""; }
+    size_t length() const { return len_; }
+    bool truncated() const { return truncated_; }
+
+private:
+    char* out_;
+    size_t size_;
+    size_t len_;
+    bool truncated_;
+};
+
+#endif // TEXT_BUFFER_H
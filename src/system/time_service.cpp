@@ -0,0 +1,254 @@
+/*
+ * Time Service Implementation
+ */
+
+#include "time_service.h"
+#include "rtc_manager.h"
+#include "seqlock.h"
+#include <stdlib.h>
+#include <sys/time.h>
+
+namespace {
+struct Reference {
+    int64_t monoUs;
+    int64_t utcUs;
+    int32_t driftPpb;
+    uint32_t residualPpb;    // error left after the drift correction
+    uint32_t uncertaintyMs;
+    TimeSource source;
+    bool valid;
+};
+
+// Start of the current drift baseline
+struct Anchor {
+    int64_t monoUs;
+    int64_t utcUs;
+    uint32_t uncertaintyMs;
+    bool valid;
+};
+
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+SeqlockSnapshot<Reference> s_published;      // written under s_mux
+Reference s_ref = {};                        // under s_mux
+Anchor s_anchor = {};
+int32_t s_lastErrorMs = 0;
+uint32_t s_samples = 0;
+uint32_t s_accepted = 0;
+uint32_t s_systemSteps = 0;
+
+int64_t predict(const Reference& r, int64_t monoUs) {
+    const int64_t dt = monoUs - r.monoUs;
+    // A fast monotonic clock (positive drift) runs ahead of UTC
+    return r.utcUs + dt - (dt / 1000) * r.driftPpb / 1000000;
+}
+
+uint32_t uncertaintyAt(const Reference& r, int64_t monoUs) {
+    const int64_t ageS = (monoUs - r.monoUs) / 1000000;
+    const int64_t ms = (int64_t)r.uncertaintyMs + ageS * r.residualPpb / 1000000;
+    return ms > 0xFFFFFFFFLL ? 0xFFFFFFFFUL : (uint32_t)ms;
+}
+
+// Under s_mux. Measured over the whole baseline once it is long enough for the
+// two samples' uncertainty to resolve a tenth of the drift bound.
+bool refineDrift(int64_t utcUs, int64_t monoUs, uint32_t uncertaintyMs, int32_t& driftPpb, uint32_t& residualPpb) {
+    if (!s_anchor.valid) return false;
+    const int64_t spanUs = monoUs - s_anchor.monoUs;
+    if (spanUs < (int64_t)TIME_DRIFT_MIN_SPAN_S * 1000000) return false;
+    const int64_t spanS = spanUs / 1000000;
+    // us per s is ppm, x1000 ppb
+    const int64_t noisePpb = ((int64_t)uncertaintyMs + s_anchor.uncertaintyMs) * 1000 * 1000 / spanS;
+    if (noisePpb * 10 > TIME_DRIFT_MAX_PPB) return false;
+    const int64_t aheadUs = spanUs - (utcUs - s_anchor.utcUs);
+    const int64_t ppb = aheadUs * 1000 / spanS;
+    if (ppb > TIME_DRIFT_MAX_PPB || ppb < -TIME_DRIFT_MAX_PPB) return false;   // a clock was stepped
+    driftPpb = (int32_t)ppb;
+    residualPpb = noisePpb > TIME_RESIDUAL_MIN_PPB ? (uint32_t)noisePpb : TIME_RESIDUAL_MIN_PPB;
+    return true;
+}
+
+void setAnchor(int64_t utcUs, int64_t monoUs, uint32_t uncertaintyMs) {
+    s_anchor.monoUs = monoUs;
+    s_anchor.utcUs = utcUs;
+    s_anchor.uncertaintyMs = uncertaintyMs;
+    s_anchor.valid = true;
+}
+
+void stepSystemClock() {
+    const int64_t utcUs = time_utc_us();
+    if (utcUs == 0) return;
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    const int64_t systemUs = (int64_t)now.tv_sec * 1000000 + now.tv_usec;
+    if (llabs(systemUs - utcUs) < (int64_t)TIME_SYSTEM_STEP_MS * 1000) return;
+    struct timeval tv;
+    tv.tv_sec = (time_t)(utcUs / 1000000);
+    tv.tv_usec = (suseconds_t)(utcUs % 1000000);
+    settimeofday(&tv, nullptr);
+    portENTER_CRITICAL(&s_mux);
+    s_systemSteps++;
+    portEXIT_CRITICAL(&s_mux);
+}
+} // namespace
+
+int64_t time_epoch_from_utc(const struct tm& utc) {
+    int64_t y = utc.tm_year + 1900LL;
+    int64_t m = utc.tm_mon;
+    y += m / 12;
+    m %= 12;
+    if (m < 0) {
+        m += 12;
+        y--;
+    }
+    // Days from the civil date, years starting in March (H. Hinnant)
+    const int64_t month = m + 1;
+    if (month <= 2) y--;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + utc.tm_mday - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    const int64_t days = era * 146097 + doe - 719468;
+    return days * 86400 + utc.tm_hour * 3600LL + utc.tm_min * 60LL + utc.tm_sec;
+}
+
+bool time_discipline(TimeSource source, int64_t utcS, int64_t monoUs, uint32_t uncertaintyMs) {
+    if (utcS < TIME_MIN_VALID_EPOCH || source == TimeSource::NONE || source >= TimeSource::COUNT) return false;
+    const int64_t utcUs = utcS * 1000000;
+
+    portENTER_CRITICAL(&s_mux);
+    s_samples++;
+    const bool accept = !s_ref.valid || uncertaintyMs <= uncertaintyAt(s_ref, monoUs);
+    int32_t drift = s_ref.driftPpb;
+    uint32_t residual = s_ref.valid ? s_ref.residualPpb : TIME_HOLDOVER_PPM * 1000UL;
+    int64_t errorUs = 0;
+    if (!s_ref.valid || !s_anchor.valid) {
+        setAnchor(utcUs, monoUs, uncertaintyMs);
+    } else {
+        errorUs = utcUs - predict(s_ref, monoUs);
+        const int64_t boundUs = ((int64_t)uncertaintyMs + uncertaintyAt(s_ref, monoUs)) * 1000;
+        const bool shortBaseline = monoUs - s_anchor.monoUs < (int64_t)TIME_DRIFT_MIN_SPAN_S * 1000000;
+        if (accept && llabs(errorUs) > 4 * boundUs) {
+            // Far outside both uncertainties: the old baseline is wrong, start over
+            setAnchor(utcUs, monoUs, uncertaintyMs);
+        } else if (!shortBaseline) {
+            refineDrift(utcUs, monoUs, uncertaintyMs, drift, residual);
+        } else if (uncertaintyMs * 4 <= s_anchor.uncertaintyMs) {
+            // Much better sample while the baseline is still short: start it here instead
+            setAnchor(utcUs, monoUs, uncertaintyMs);
+        }
+    }
+
+    bool changed = false;
+    if (accept) {
+        s_ref.monoUs = monoUs;
+        s_ref.utcUs = utcUs;
+        s_ref.uncertaintyMs = uncertaintyMs;
+        s_ref.source = source;
+        s_ref.driftPpb = drift;
+        s_ref.residualPpb = residual;
+        s_ref.valid = true;
+        s_lastErrorMs = (int32_t)(errorUs / 1000);
+        s_accepted++;
+        changed = true;
+    } else if (drift != s_ref.driftPpb || residual != s_ref.residualPpb) {
+        // Keep the better reference, re-based so the new rate doesn't step the clock
+        const int64_t nowUs = time_mono_us();
+        s_ref.utcUs = predict(s_ref, nowUs);
+        s_ref.uncertaintyMs = uncertaintyAt(s_ref, nowUs);
+        s_ref.monoUs = nowUs;
+        s_ref.driftPpb = drift;
+        s_ref.residualPpb = residual;
+        changed = true;
+    }
+    if (changed) s_published.write(s_ref);
+    portEXIT_CRITICAL(&s_mux);
+
+    if (changed) stepSystemClock();
+    return accept;
+}
+
+bool time_discipline_tm(TimeSource source, const struct tm& utc, int64_t monoUs, uint32_t uncertaintyMs) {
+    return time_discipline(source, time_epoch_from_utc(utc), monoUs, uncertaintyMs);
+}
+
+bool time_service_begin() {
+    struct tm rtc;
+    const int64_t monoUs = time_mono_us();
+    if (!getRTCTime(rtc)) return false;
+    return time_discipline_tm(TimeSource::RTC, rtc, monoUs, TIME_UNCERTAINTY_RTC_MS);
+}
+
+bool time_utc_valid() {
+    return s_published.read().valid;
+}
+
+int64_t time_utc_us() {
+    Reference r;
+    s_published.read(r);
+    return r.valid ? predict(r, time_mono_us()) : 0;
+}
+
+int64_t time_utc_s() {
+    return time_utc_us() / 1000000;
+}
+
+int64_t time_utc_at(int64_t monoUs) {
+    Reference r;
+    s_published.read(r);
+    return r.valid ? predict(r, monoUs) : 0;
+}
+
+void time_service_status(TimeServiceStatus& out) {
+    const int64_t now = time_mono_us();
+    portENTER_CRITICAL(&s_mux);
+    out.source = s_ref.valid ? s_ref.source : TimeSource::NONE;
+    out.valid = s_ref.valid;
+    out.driftPpb = s_ref.driftPpb;
+    out.residualPpb = s_ref.valid ? s_ref.residualPpb : TIME_HOLDOVER_PPM * 1000UL;
+    out.uncertaintyMs = s_ref.valid ? uncertaintyAt(s_ref, now) : 0;
+    out.referenceAgeS = s_ref.valid ? (uint32_t)((now - s_ref.monoUs) / 1000000) : 0;
+    out.lastErrorMs = s_lastErrorMs;
+    out.samples = s_samples;
+    out.accepted = s_accepted;
+    out.systemSteps = s_systemSteps;
+    portEXIT_CRITICAL(&s_mux);
+}
+
+uint32_t time_holdover_s(uint32_t uncertaintyMs) {
+    const int64_t now = time_mono_us();
+    portENTER_CRITICAL(&s_mux);
+    const bool valid = s_ref.valid;
+    const uint32_t current = valid ? uncertaintyAt(s_ref, now) : 0;
+    const uint32_t residual = s_ref.residualPpb;
+    portEXIT_CRITICAL(&s_mux);
+    if (!valid || current >= uncertaintyMs || residual == 0) return 0;
+    // ms over ppb is 1e6 s
+    const uint64_t s = (uint64_t)(uncertaintyMs - current) * 1000000ULL / residual;
+    return s > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)s;
+}
+
+const char* time_source_name(TimeSource source) {
+    switch (source) {
+        case TimeSource::BUILD: return "build";
+        case TimeSource::RTC: return "rtc";
+        case TimeSource::HTTP: return "http";
+        case TimeSource::CELLULAR: return "cellular";
+        case TimeSource::GNSS: return "gnss";
+        case TimeSource::NTP: return "ntp";
+        default: return "none";
+    }
+}
+
+void time_service_report(Print& out) {
+    TimeServiceStatus s;
+    time_service_status(s);
+    if (!s.valid) {
+        out.printf("Time: not set (%lu samples)\n", (unsigned long)s.samples);
+        return;
+    }
+    out.printf("Time: %lld UTC from %s, +/-%lu ms, %lu s old; drift %ld +/-%lu ppb; last error %ld ms; "
+               "%lu/%lu samples used, %lu system clock steps\n",
+               (long long)time_utc_s(), time_source_name(s.source), (unsigned long)s.uncertaintyMs,
+               (unsigned long)s.referenceAgeS, (long)s.driftPpb, (unsigned long)s.residualPpb,
+               (long)s.lastErrorMs, (unsigned long)s.accepted,
+               (unsigned long)s.samples, (unsigned long)s.systemSteps);
+}
@@ -0,0 +1,96 @@
+/*
+ * Time Service
+ * One clock for timestamps: esp_timer's 64-bit microseconds since boot, which
+ * does not wrap, and UTC derived from it. Either costs one call, no I2C.
+ *
+ * UTC is a reference pair (monotonic, UTC) plus a drift rate. Each source
+ * sample carries its uncertainty, and replaces the reference only when it is
+ * better than what the reference has decayed to: its uncertainty plus the
+ * residual drift over its age. The residual is TIME_HOLDOVER_PPM until samples
+ * TIME_DRIFT_MIN_SPAN_S apart have measured the drift (clamped to
+ * TIME_DRIFT_MAX_PPB), then what that measurement could not resolve, at least
+ * TIME_RESIDUAL_MIN_PPB.
+ * The system clock (time(), localtime()) is stepped to follow once it is off
+ * by more than TIME_SYSTEM_STEP_MS.
+ */
+
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <time.h>
+
+#ifndef TIME_HOLDOVER_PPM
+#define TIME_HOLDOVER_PPM 20                // residual drift assumed for the uncertainty
+#endif
+#ifndef TIME_RESIDUAL_MIN_PPB
+#define TIME_RESIDUAL_MIN_PPB 2000          // crystal wander with temperature
+#endif
+#ifndef TIME_DRIFT_MIN_SPAN_S
+#define TIME_DRIFT_MIN_SPAN_S 3600
+#endif
+#ifndef TIME_DRIFT_MAX_PPB
+#define TIME_DRIFT_MAX_PPB 200000           // 200 ppm, well past any crystal in spec
+#endif
+#ifndef TIME_SYSTEM_STEP_MS
+#define TIME_SYSTEM_STEP_MS 250
+#endif
+#ifndef TIME_MIN_VALID_EPOCH
+#define TIME_MIN_VALID_EPOCH 1704067200LL   // 2024-01-01; anything earlier is an unset clock
+#endif
+
+// Sample uncertainties by source, ms
+#define TIME_UNCERTAINTY_NTP_MS 50
+#define TIME_UNCERTAINTY_CNTP_MS 1000       // modem NTP, read back in whole seconds
+#define TIME_UNCERTAINTY_HTTP_MS 2000
+#define TIME_UNCERTAINTY_CELLULAR_MS 1000   // network time (NITZ)
+#define TIME_UNCERTAINTY_GNSS_MS 1000       // whole seconds, reported up to a second late
+#define TIME_UNCERTAINTY_RTC_MS 2000
+#define TIME_UNCERTAINTY_BUILD_MS 86400000UL
+
+enum class TimeSource : uint8_t { NONE = 0, BUILD, RTC, HTTP, CELLULAR, GNSS, NTP, COUNT };
+
+struct TimeServiceStatus {
+    TimeSource source;       // of the current reference
+    bool valid;
+    int32_t driftPpb;        // monotonic clock fast (+) or slow (-) against UTC
+    uint32_t residualPpb;    // uncertainty growth rate
+    uint32_t uncertaintyMs;  // of the reference now, holdover included
+    uint32_t referenceAgeS;
+    int32_t lastErrorMs;     // last accepted sample minus the prediction
+    uint32_t samples;
+    uint32_t accepted;
+    uint32_t systemSteps;
+};
+
+// Monotonic since boot
+inline int64_t time_mono_us() { return esp_timer_get_time(); }
+inline uint64_t time_mono_ms() { return static_cast<uint64_t>(esp_timer_get_time()) / 1000ULL; }
+inline uint32_t time_uptime_s() { return static_cast<uint32_t>(static_cast<uint64_t>(esp_timer_get_time()) / 1000000ULL); }
+
+// Seeds UTC from the RX8130 (one I2C read) when it holds a plausible time
+bool time_service_begin();
+
+// A source read UTC utcS at monotonic monoUs (when the reading was taken, not
+// when it is reported). Returns true when it became the reference.
+bool time_discipline(TimeSource source, int64_t utcS, int64_t monoUs, uint32_t uncertaintyMs);
+bool time_discipline_tm(TimeSource source, const struct tm& utc, int64_t monoUs, uint32_t uncertaintyMs);
+
+bool time_utc_valid();
+// 0 until a source has set it
+int64_t time_utc_us();
+int64_t time_utc_s();
+// UTC of a monotonic timestamp captured earlier (0 while invalid)
+int64_t time_utc_at(int64_t monoUs);
+
+// struct tm (UTC, fields normalized or not) to seconds since the epoch, no TZ involved
+int64_t time_epoch_from_utc(const struct tm& utc);
+
+void time_service_status(TimeServiceStatus& out);
+// Seconds until UTC is less certain than uncertaintyMs (0: already, or not set)
+uint32_t time_holdover_s(uint32_t uncertaintyMs);
+const char* time_source_name(TimeSource source);
+void time_service_report(Print& out);
+
+#endif // TIME_SERVICE_H
@@ -5,14 +5,17 @@
 
 #include "time_utils.h"
 #include "rtc_manager.h"
+#include "time_service.h"
+#include "service_task.h"
+#include "work_queue.h"
 #include "../modules/catm_gnss/catm_gnss_module.h"
-#include "../modules/catm_gnss/gnss_status.h"
 #include "../config/system_config.h"
 #include <WiFi.h>
 #include <time.h>
 #include <sys/time.h>
 #include <string.h>
 #include <M5StamPLC.h>
+#include <esp_sntp.h>
 
 // External globals (declared in main.cpp)
 extern CatMGNSSModule* catmGnssModule;
@@ -22,31 +25,24 @@ extern bool g_lastCellularNtpUsedCntp;
 // Internal state
 static bool g_ntpConfigured = false;
 static uint32_t g_lastTZUpdateMs = 0;
+static int g_rtcSyncJob = SERVICE_JOB_NONE;
+static volatile bool g_wifiNtpFresh = false;   // SNTP synced since the RTC was last written from it
+// Sync scheduler, run only from the RtcSync work job
+static uint32_t g_lastSyncAttemptMs = 0;
+static uint32_t g_lastNtpAttemptMs = 0;
+static uint32_t g_syncAttempts[(size_t)TimeSource::COUNT] = {};
+static uint32_t g_syncSuccesses[(size_t)TimeSource::COUNT] = {};
 
-bool fetchNtpTimeViaCellular(struct tm& timeInfo) {
-    if (!catmGnssModule || !catmGnssModule->isModuleInitialized()) return false;
-
-    CellularData cd = catmGnssModule->getCellularData();
-    if (!cd.isConnected) return false;
-
-    g_lastCellularNtpUsedCntp = false;
-
-    // Try CNTP (AT+CNTPSTART) first - fast and efficient
-    Serial.println("NTP: Attempting CNTP sync via Soracom NTP...");
-    if (catmGnssModule->syncNetworkTime(timeInfo, 65000)) {
-        int year = timeInfo.tm_year + 1900;
-        int month = timeInfo.tm_mon + 1;
-        Serial.printf("NTP: CNTP sync success - %04d-%02d-%02d %02d:%02d:%02d UTC\n",
-                      year, month, timeInfo.tm_mday, timeInfo.tm_hour, 
-                      timeInfo.tm_min, timeInfo.tm_sec);
-        g_cntpSyncedThisSession = true;
-        g_lastCellularNtpUsedCntp = true;
-        return true;
-    }
-    
-    Serial.printf("NTP: CNTP sync failed (%s), falling back to HTTP...\n", 
-                  catmGnssModule->getLastError().c_str());
+// SNTP has already set the system clock when this runs
+static void onSntpSync(struct timeval* tv) {
+    if (!tv) return;
+    // UTC was tv_sec exactly tv_usec ago
+    time_discipline(TimeSource::NTP, tv->tv_sec, time_mono_us() - tv->tv_usec, TIME_UNCERTAINTY_NTP_MS);
+    g_wifiNtpFresh = true;
+}
 
+// Last resort when CNTP fails: worldtimeapi.org over the cellular HTTP stack
+static bool fetchHttpTimeViaCellular(struct tm& timeInfo) {
     // Fallback: HTTP-based time fetch via worldtimeapi.org
     String url = "http://worldtimeapi.org/api/timezone/Etc/UTC";
     String response;
@@ -55,6 +51,7 @@ bool fetchNtpTimeViaCellular(struct tm& timeInfo) {
         Serial.println("NTP: Failed to fetch time from cellular HTTP fallback");
         return false;
     }
+    const int64_t receivedUs = time_mono_us();
 
     // Parse JSON response
     // Expected format: {"datetime": "2024-01-15T19:30:25.123456+00:00", ...}
@@ -104,6 +101,7 @@ bool fetchNtpTimeViaCellular(struct tm& timeInfo) {
     timeInfo.tm_min = minute;
     timeInfo.tm_sec = second;
     timeInfo.tm_isdst = 0; // UTC doesn't observe DST
+    time_discipline_tm(TimeSource::HTTP, timeInfo, receivedUs, TIME_UNCERTAINTY_HTTP_MS);
 
     Serial.printf("NTP: Fetched UTC time via HTTP fallback: %04d-%02d-%02d %02d:%02d:%02d\n",
                   year, month, day, hour, minute, second);
@@ -120,6 +118,7 @@ void ensureNtpConfigured() {
     if ((WiFi.getMode() & WIFI_MODE_STA) && WiFi.status() == WL_CONNECTED) {
         hasConnectivity = true;
         Serial.println("NTP: Configuring via WiFi connection");
+        sntp_set_time_sync_notification_cb(onSntpSync);
         // Timezone: Eastern with DST auto rules (EST/EDT). Adjust as needed.
         // Use multiple NTP servers for reliability
         configTzTime("EST5EDT,M3.2.0/2,M11.1.0/2",
@@ -136,7 +135,7 @@ void ensureNtpConfigured() {
             hasConnectivity = true;
             Serial.println("NTP: Cellular connection available (NTP via HTTP)");
             // For cellular, we don't configure standard NTP since it won't work
-            // Instead, we'll use fetchNtpTimeViaCellular() in syncRTCFromAvailableSources()
+            // Instead the sync scheduler runs CNTP, HTTP as its fallback
             g_ntpConfigured = true; // Mark as configured so we don't keep checking
             Serial.println("NTP: HTTP-based NTP will be used via cellular");
         }
@@ -175,14 +174,7 @@ void maybeUpdateTimeZoneFromCellular() {
 }
 
 void formatLocalFromUTC(const struct tm& utcIn, char* timeStr, char* dateStr) {
-    char prevTZ[64] = {0};
-    const char* cur = getenv("TZ");
-    if (cur) { strncpy(prevTZ, cur, sizeof(prevTZ) - 1); prevTZ[sizeof(prevTZ) - 1] = '\0'; }
-    setenv("TZ", "UTC0", 1); tzset();
-    struct tm tmp = utcIn; // mktime() normalizes
-    time_t epoch = mktime(&tmp);
-    if (prevTZ[0]) setenv("TZ", prevTZ, 1); else unsetenv("TZ");
-    tzset();
+    const time_t epoch = (time_t)time_epoch_from_utc(utcIn);
     struct tm lt;
     localtime_r(&epoch, &lt);
     char tbuf[16]; snprintf(tbuf, sizeof(tbuf), "%02d:%02d", lt.tm_hour, lt.tm_min);
@@ -191,71 +183,130 @@ void formatLocalFromUTC(const struct tm& utcIn, char* timeStr, char* dateStr) {
     strncpy(dateStr, dbuf, 15); dateStr[15] = '\0';
 }
 
+static bool writeRtc(const struct tm& utc) {
+    if (!M5StamPLC.RX8130.begin()) return false;
+    struct tm t = utc;
+    M5StamPLC.RX8130.setTime(&t);
+    return true;
+}
+
+static bool recordSync(TimeSource source, bool ok) {
+    g_syncAttempts[(size_t)source]++;
+    if (ok) g_syncSuccesses[(size_t)source]++;
+    return ok;
+}
+
+// Due once UTC has decayed past the target, which measured drift stretches
+// towards TIME_SYNC_MAX_INTERVAL_S
+static bool syncDue() {
+    TimeServiceStatus st;
+    time_service_status(st);
+    if (!st.valid || st.source <= TimeSource::RTC) return true;
+    return st.referenceAgeS >= TIME_SYNC_MAX_INTERVAL_S || time_holdover_s(TIME_SYNC_TARGET_MS) == 0;
+}
+
+static void finishCellularNtp() {
+    struct tm utc;
+    int64_t receivedUs = 0;
+    const NetworkTimeSyncState state = catmGnssModule->pollNetworkTimeSync(utc, &receivedUs);
+    if (state == NetworkTimeSyncState::PENDING) return;
+    g_syncAttempts[(size_t)TimeSource::NTP]++;
+    if (state == NetworkTimeSyncState::DONE) {
+        g_syncSuccesses[(size_t)TimeSource::NTP]++;
+        time_discipline_tm(TimeSource::NTP, utc, receivedUs, TIME_UNCERTAINTY_CNTP_MS);
+        g_cntpSyncedThisSession = true;
+        g_lastCellularNtpUsedCntp = true;
+        if (writeRtc(utc)) Serial.println("RTC synchronized from CNTP (Cellular)");
+        maybeUpdateTimeZoneFromCellular();
+        return;
+    }
+
+    Serial.printf("NTP: CNTP sync failed (%s), falling back to HTTP...\n", catmGnssModule->getLastError().c_str());
+    if (recordSync(TimeSource::HTTP, fetchHttpTimeViaCellular(utc)) && writeRtc(utc)) {
+        Serial.println("RTC synchronized from HTTP (Cellular)");
+    }
+}
+
 void syncRTCFromAvailableSources() {
-    static uint32_t lastNtpSync = 0;
-    static uint32_t lastCellularSync = 0;
-    static uint32_t lastGpsSync = 0;
-    uint32_t now = millis();
+    const uint32_t now = millis();
 
     // Ensure NTP is configured if we have connectivity
     ensureNtpConfigured();
 
-    // 1. Try NTP sync (every 1 hour)
-    if (now - lastNtpSync > 3600000UL) {
-        // First try standard NTP (WiFi)
-        struct tm lt;
-        if (getLocalTime(&lt, 50)) { // NTP available via WiFi
-            time_t now_time = time(nullptr);
-            struct tm utc;
-            gmtime_r(&now_time, &utc);
-            if (M5StamPLC.RX8130.begin()) {
-                M5StamPLC.RX8130.setTime(&utc);
-                Serial.println("RTC synchronized from NTP (WiFi)");
-                lastNtpSync = now;
-                return; // Success, no need to try others
-            }
-        }
-        // If WiFi NTP failed, try HTTP-based NTP via cellular
-        else if (catmGnssModule && catmGnssModule->isModuleInitialized()) {
-            CellularData cd = catmGnssModule->getCellularData();
-            if (cd.isConnected) {
-                struct tm ntpTime;
-                if (fetchNtpTimeViaCellular(ntpTime)) {
-                    if (M5StamPLC.RX8130.begin()) {
-                        M5StamPLC.RX8130.setTime(&ntpTime);
-                        if (g_lastCellularNtpUsedCntp) {
-                            Serial.println("RTC synchronized from CNTP (Cellular)");
-                        } else {
-                            Serial.println("RTC synchronized from HTTP (Cellular)");
-                        }
-                        lastNtpSync = now;
-                        return; // Success, no need to try others
-                    }
-                }
-            }
+    // SNTP (WiFi) disciplines the time service from its callback; the RTC follows
+    if (g_wifiNtpFresh) {
+        time_t now_time = time(nullptr);
+        struct tm utc;
+        gmtime_r(&now_time, &utc);
+        if (writeRtc(utc)) {
+            Serial.println("RTC synchronized from NTP (WiFi)");
+            g_wifiNtpFresh = false;
         }
+        return;
     }
 
-    // 2. Try cellular network time (every 30 minutes)
-    if (now - lastCellularSync > 1800000UL) {
-        if (catmGnssModule && catmGnssModule->isModuleInitialized()) {
-            CellularData cd = catmGnssModule->getCellularData();
-            if (cd.isConnected && setRTCFromCellular()) {
-                Serial.println("RTC synchronized from cellular network time");
-                lastCellularSync = now;
-                return; // Success, no need to try GPS
-            }
-        }
+    if (!catmGnssModule || !catmGnssModule->isModuleInitialized()) return;
+    // A CNTP exchange started by an earlier check
+    if (catmGnssModule->isNetworkTimeSyncPending()) {
+        finishCellularNtp();
+        return;
+    }
+
+    if (!syncDue()) return;
+    if (g_lastSyncAttemptMs != 0 && now - g_lastSyncAttemptMs < TIME_SYNC_RETRY_MS) return;
+    g_lastSyncAttemptMs = now | 1;
+
+    // Cheapest first. 1. GNSS: free while a fix is already being tracked
+    GNSSData gnssData = catmGnssModule->getGNSSData();
+    if (gnssData.isValid && gnssData.year > 2020 && now - gnssData.lastUpdate < TIME_SYNC_GNSS_MAX_AGE_MS) {
+        if (recordSync(TimeSource::GNSS, setRTCFromGPS(gnssData))) return;
     }
 
-    // 3. Try GPS time (every 15 minutes)
-    if (now - lastGpsSync > 900000UL) {
-        if (catmGnssModule && catmGnssModule->isModuleInitialized()) {
-            GNSSData gnssData = catmGnssModule->getGNSSData();
-            if (gnssData.isValid && gnssData.year > 2020 && setRTCFromGPS(gnssData)) {
-                Serial.println("RTC synchronized from GPS");
-                lastGpsSync = now;
-            }
+    // 2. Network time (NITZ) held by the modem: one AT command, no data
+    CellularData cd = catmGnssModule->getCellularData();
+    if (cd.isRegistered) {
+        if (recordSync(TimeSource::CELLULAR, setRTCFromCellular())) {
+            maybeUpdateTimeZoneFromCellular();
+            return;
         }
     }
+
+    // 3. NTP over cellular: data, and up to a minute for the answer. SNTP covers
+    // it while WiFi is up.
+    if (!cd.isConnected) return;
+    if ((WiFi.getMode() & WIFI_MODE_STA) && WiFi.status() == WL_CONNECTED) return;
+    if (g_lastNtpAttemptMs != 0 && now - g_lastNtpAttemptMs < TIME_SYNC_NTP_RETRY_MS) return;
+    g_lastNtpAttemptMs = now | 1;
+    g_lastCellularNtpUsedCntp = false;
+    Serial.println("NTP: Attempting CNTP sync via Soracom NTP...");
+    if (!catmGnssModule->startNetworkTimeSync()) {
+        g_syncAttempts[(size_t)TimeSource::NTP]++;
+        Serial.printf("NTP: CNTP start failed (%s)\n", catmGnssModule->getLastError().c_str());
+    }
+}
+
+void time_sync_report(Print& out) {
+    out.printf("Time sync: next in %lu s;", (unsigned long)time_holdover_s(TIME_SYNC_TARGET_MS));
+    for (size_t i = (size_t)TimeSource::HTTP; i < (size_t)TimeSource::COUNT; i++) {
+        out.printf(" %s %lu/%lu", time_source_name((TimeSource)i), (unsigned long)g_syncSuccesses[i],
+                   (unsigned long)g_syncAttempts[i]);
+    }
+    out.println(catmGnssModule && catmGnssModule->isNetworkTimeSyncPending() ? "; CNTP pending" : "");
+}
+
+static void rtcSyncWork(void*) {
+    syncRTCFromAvailableSources();
+}
+
+static void rtcSyncJob(void*) {
+    // Coalesced: a slow check (HTTP fallback) isn't queued twice
+    work_submit("RtcSync", rtcSyncWork, nullptr, WorkPriority::Low, WORK_CORE_MODEM, WORK_COALESCE);
+}
+
+bool rtc_sync_begin() {
+    if (g_rtcSyncJob != SERVICE_JOB_NONE) return true;
+    // UTC from the RTC until a better source reports
+    time_service_begin();
+    g_rtcSyncJob = service_job_add("RtcSync", rtcSyncJob, nullptr, RTC_SYNC_CHECK_MS, 200);
+    return g_rtcSyncJob != SERVICE_JOB_NONE;
 }
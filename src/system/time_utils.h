@@ -8,11 +8,40 @@
 
 #include <time.h>
 
+class Print;
+
+#ifndef RTC_SYNC_CHECK_MS
+#define RTC_SYNC_CHECK_MS 10000            // also how often a pending CNTP is polled
+#endif
+// Resync once the time service is less certain than this
+#ifndef TIME_SYNC_TARGET_MS
+#define TIME_SYNC_TARGET_MS 2000
+#endif
+#ifndef TIME_SYNC_MAX_INTERVAL_S
+#define TIME_SYNC_MAX_INTERVAL_S 86400UL
+#endif
+#ifndef TIME_SYNC_RETRY_MS
+#define TIME_SYNC_RETRY_MS 60000UL         // after a due sync found no source
+#endif
+#ifndef TIME_SYNC_NTP_RETRY_MS
+#define TIME_SYNC_NTP_RETRY_MS 900000UL    // between CNTP attempts
+#endif
+#ifndef TIME_SYNC_GNSS_MAX_AGE_MS
+#define TIME_SYNC_GNSS_MAX_AGE_MS 5000UL   // fix report still tracking
+#endif
+
 // NTP and time synchronization
-bool fetchNtpTimeViaCellular(struct tm& timeInfo);
 void ensureNtpConfigured();
 void maybeUpdateTimeZoneFromCellular();
+// One scheduler step: when the time service is due (its uncertainty past
+// TIME_SYNC_TARGET_MS at the measured drift), tries the cheapest source up:
+// a GNSS fix already tracked, the modem's network time, then CNTP. CNTP is
+// started here and collected by later steps, so nothing waits on the modem.
 void syncRTCFromAvailableSources();
+// Schedules syncRTCFromAvailableSources() from the service task every
+// RTC_SYNC_CHECK_MS, as a work job on the modem core.
+bool rtc_sync_begin();
+void time_sync_report(Print& out);
 
 // Time formatting
 void formatLocalFromUTC(const struct tm& utcIn, char* timeStr, char* dateStr);
@@ -0,0 +1,48 @@
+/*
+ * FreeRTOS Trace Hooks
+ * Maps the kernel trace macros onto the event recorder (trace_recorder.h).
+ * Plain C: it is force-included into the kernel sources, which must then be
+ * built from source (PlatformIO framework = arduino, espidf), with
+ *   build_flags = -include src/system/trace_hooks.h
+ * The prebuilt Arduino kernel ignores it; only the TRACE_USER markers and the
+ * explicit ISR markers record then.
+ */
+
+#ifndef TRACE_HOOKS_H
+#define TRACE_HOOKS_H
+
+#include <stdint.h>
+
+// Event types, shared with trace_recorder.h and tools/trace2chrome.py
+#define TRACE_EV_TASK_IN     1      // obj = task now running on this core
+#define TRACE_EV_QUEUE_SEND  2      // obj = queue
+#define TRACE_EV_QUEUE_RECV  3
+#define TRACE_EV_QUEUE_BLOCK 4      // receiver blocks on an empty queue or a taken semaphore
+#define TRACE_EV_SEM_GIVE    5      // semaphores and mutexes are queues of another type
+#define TRACE_EV_SEM_TAKE    6
+#define TRACE_EV_ISR_ENTER   7      // obj = ISR id
+#define TRACE_EV_ISR_EXIT    8
+#define TRACE_EV_USER        9      // obj = (TraceUser << 8) | arg
+#define TRACE_EV_SYNC        10     // keeps the cycle counter unwrappable on a quiet core
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void trace_hook_task_in(void);
+void trace_hook_queue(uint8_t type, void* queue);
+void trace_hook_isr(uint8_t type, uint16_t id);
+#ifdef __cplusplus
+}
+#endif
+
+#define traceTASK_SWITCHED_IN() trace_hook_task_in()
+#define traceQUEUE_SEND(q) trace_hook_queue(TRACE_EV_QUEUE_SEND, (q))
+#define traceQUEUE_SEND_FROM_ISR(q) trace_hook_queue(TRACE_EV_QUEUE_SEND, (q))
+#define traceQUEUE_RECEIVE(q) trace_hook_queue(TRACE_EV_QUEUE_RECV, (q))
+#define traceQUEUE_RECEIVE_FROM_ISR(q) trace_hook_queue(TRACE_EV_QUEUE_RECV, (q))
+#define traceBLOCKING_ON_QUEUE_RECEIVE(q) trace_hook_queue(TRACE_EV_QUEUE_BLOCK, (q))
+
+#define TRACE_ISR_ENTER(id) trace_hook_isr(TRACE_EV_ISR_ENTER, (id))
+#define TRACE_ISR_EXIT(id) trace_hook_isr(TRACE_EV_ISR_EXIT, (id))
+
+#endif // TRACE_HOOKS_H
@@ -0,0 +1,403 @@
+/*
+ * Trace Event Recorder Implementation
+ */
+
+#include "trace_recorder.h"
+
+#if TRACE_RECORDER_ENABLE
+
+#include "service_task.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_attr.h>
+#include <esp_ipc.h>
+#include <esp_timer.h>
+#include <xtensa/hal.h>
+#include <atomic>
+#include <string.h>
+#if ENABLE_SD
+#include <SD.h>
+#include "../modules/storage/storage_task.h"
+#endif
+
+namespace {
+static_assert((TRACE_RECORDER_EVENTS & (TRACE_RECORDER_EVENTS - 1)) == 0,
+              "TRACE_RECORDER_EVENTS must be a power of two");
+constexpr uint32_t kMagic = 0x31435254;   // "TRC1"
+constexpr uint16_t kVersion = 1;
+
+enum : uint8_t { kKindTask = 1, kKindQueue = 2, kKindMutex = 3 };
+
+struct TraceEvent {
+    uint32_t cycles;        // cycle count on the common timeline (see s_offset)
+    uint8_t type;
+    uint8_t core;
+    uint16_t obj;
+};
+static_assert(sizeof(TraceEvent) == 8, "trace events are 8 bytes");
+
+// Image layout, little endian: header, objects, then events oldest first
+struct ImageHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t objects;
+    uint32_t events;
+    uint32_t lost;          // overwritten before the dump
+    uint32_t cpuHz;
+};
+
+struct ImageObject {
+    uint16_t id;
+    uint8_t kind;
+    uint8_t reserved;
+    char name[TRACE_RECORDER_NAME_BYTES];
+};
+
+TraceEvent s_ring[TRACE_RECORDER_EVENTS];
+std::atomic<uint32_t> s_head{0};
+std::atomic<bool> s_on{false};
+// Per-core ccount minus esp_timer cycles, so both cores share one timeline
+uint32_t s_offset[portNUM_PROCESSORS];
+
+std::atomic<const void*> s_objs[TRACE_RECORDER_OBJECTS];
+uint8_t s_kinds[TRACE_RECORDER_OBJECTS];
+char s_names[TRACE_RECORDER_OBJECTS][TRACE_RECORDER_NAME_BYTES];
+int s_job = SERVICE_JOB_NONE;
+
+char s_line[24];
+uint8_t s_lineLen = 0;
+
+// Object id (table index + 1), or 0 once the table is full
+IRAM_ATTR uint16_t intern(const void* h, uint8_t kind) {
+    if (!h) return 0;
+    uint32_t i = (reinterpret_cast<uintptr_t>(h) >> 3) % TRACE_RECORDER_OBJECTS;
+    for (uint32_t probe = 0; probe < TRACE_RECORDER_OBJECTS; probe++) {
+        const void* cur = s_objs[i].load(std::memory_order_acquire);
+        if (cur == h) return i + 1;
+        if (!cur) {
+            const void* expected = nullptr;
+            if (s_objs[i].compare_exchange_strong(expected, h, std::memory_order_acq_rel)) {
+                s_kinds[i] = kind;
+                if (kind == kKindTask) {
+                    const char* name = pcTaskGetName(static_cast<TaskHandle_t>(const_cast<void*>(h)));
+                    strncpy(s_names[i], name ? name : "", TRACE_RECORDER_NAME_BYTES - 1);
+                }
+                return i + 1;
+            }
+            if (expected == h) return i + 1;
+        }
+        i = (i + 1) % TRACE_RECORDER_OBJECTS;
+    }
+    return 0;
+}
+
+void calibrate(void*) {
+    const uint32_t core = xPortGetCoreID();
+    const uint32_t ccount = xthal_get_ccount();
+    const uint64_t us = esp_timer_get_time();
+    s_offset[core] = ccount - static_cast<uint32_t>(us * getCpuFrequencyMhz());
+}
+
+void syncJob(void*) {
+    trace_record(TRACE_EV_SYNC, 0);
+}
+
+// Writes raw bytes, or base64 in 76-column lines
+class ImageWriter {
+public:
+    ImageWriter(Print& out, bool base64) : out_(out), base64_(base64) {}
+
+    void put(const void* data, size_t len) {
+        const uint8_t* p = static_cast<const uint8_t*>(data);
+        if (!base64_) {
+            out_.write(p, len);
+            return;
+        }
+        for (size_t i = 0; i < len; i++) {
+            pending_[pendingLen_++] = p[i];
+            if (pendingLen_ == 3) flushGroup();
+        }
+    }
+
+    void finish() {
+        if (!base64_) return;
+        if (pendingLen_) flushGroup();
+        if (column_) out_.println();
+    }
+
+private:
+    void flushGroup() {
+        static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        const uint32_t v = (pending_[0] << 16) | (pendingLen_ > 1 ? pending_[1] << 8 : 0) |
+                           (pendingLen_ > 2 ? pending_[2] : 0);
+        char group[4] = {kAlphabet[(v >> 18) & 0x3F], kAlphabet[(v >> 12) & 0x3F],
+                         pendingLen_ > 1 ? kAlphabet[(v >> 6) & 0x3F] : '=',
+                         pendingLen_ > 2 ? kAlphabet[v & 0x3F] : '='};
+        out_.write(reinterpret_cast<const uint8_t*>(group), 4);
+        pendingLen_ = 0;
+        column_ += 4;
+        if (column_ >= 76) {
+            out_.println();
+            column_ = 0;
+        }
+    }
+
+    Print& out_;
+    bool base64_;
+    uint8_t pending_[3] = {};
+    uint8_t pendingLen_ = 0;
+    uint8_t column_ = 0;
+};
+
+void writeImage(Print& out, bool base64) {
+    const bool wasOn = s_on.exchange(false);
+    vTaskDelay(1);   // lets writers that already claimed a slot finish
+    const uint32_t head = s_head.load(std::memory_order_acquire);
+    const uint32_t count = head < TRACE_RECORDER_EVENTS ? head : TRACE_RECORDER_EVENTS;
+
+    ImageHeader hdr{};
+    hdr.magic = kMagic;
+    hdr.version = kVersion;
+    for (uint32_t i = 0; i < TRACE_RECORDER_OBJECTS; i++) {
+        if (s_objs[i].load(std::memory_order_relaxed)) hdr.objects++;
+    }
+    hdr.events = count;
+    hdr.lost = head - count;
+    hdr.cpuHz = getCpuFrequencyMhz() * 1000000UL;
+
+    ImageWriter w(out, base64);
+    w.put(&hdr, sizeof(hdr));
+    for (uint32_t i = 0; i < TRACE_RECORDER_OBJECTS; i++) {
+        if (!s_objs[i].load(std::memory_order_relaxed)) continue;
+        ImageObject o{};
+        o.id = i + 1;
+        o.kind = s_kinds[i];
+        memcpy(o.name, s_names[i], TRACE_RECORDER_NAME_BYTES);
+        w.put(&o, sizeof(o));
+    }
+    for (uint32_t n = head - count; n != head; n++) {
+        w.put(&s_ring[n & (TRACE_RECORDER_EVENTS - 1)], sizeof(TraceEvent));
+        if ((n & 255) == 255) vTaskDelay(1);   // Serial drains; keeps the watchdog fed
+    }
+    w.finish();
+    if (wasOn) s_on.store(true);
+}
+} // namespace
+
+extern "C" IRAM_ATTR void trace_hook_task_in(void) {
+    if (!s_on.load(std::memory_order_relaxed)) return;
+    trace_record(TRACE_EV_TASK_IN, intern(xTaskGetCurrentTaskHandle(), kKindTask));
+}
+
+extern "C" IRAM_ATTR void trace_hook_queue(uint8_t type, void* queue) {
+    if (!s_on.load(std::memory_order_relaxed)) return;
+    uint8_t kind = kKindQueue;
+#if configUSE_TRACE_FACILITY
+    if (ucQueueGetQueueType(static_cast<QueueHandle_t>(queue)) != queueQUEUE_TYPE_BASE) {
+        kind = kKindMutex;
+        if (type == TRACE_EV_QUEUE_SEND) type = TRACE_EV_SEM_GIVE;
+        else if (type == TRACE_EV_QUEUE_RECV) type = TRACE_EV_SEM_TAKE;
+    }
+#endif
+    trace_record(type, intern(queue, kind));
+}
+
+extern "C" IRAM_ATTR void trace_hook_isr(uint8_t type, uint16_t id) {
+    trace_record(type, id);
+}
+
+bool trace_recorder_begin() {
+    if (s_job != SERVICE_JOB_NONE) return true;
+    calibrate(nullptr);
+#if portNUM_PROCESSORS > 1
+    esp_ipc_call_blocking(xPortGetCoreID() ? 0 : 1, calibrate, nullptr);
+#endif
+    s_job = service_job_add("TraceSync", syncJob, nullptr, TRACE_RECORDER_SYNC_MS, 100);
+    s_on.store(true);
+    Serial.printf("Trace: recording %u events (%u bytes)\n", (unsigned)TRACE_RECORDER_EVENTS,
+                  (unsigned)sizeof(s_ring));
+    return true;
+}
+
+void trace_recorder_pause() {
+    s_on.store(false);
+}
+
+void trace_recorder_resume() {
+    s_on.store(true);
+}
+
+void trace_recorder_clear() {
+    const bool wasOn = s_on.exchange(false);
+    vTaskDelay(1);
+    s_head.store(0);
+    if (wasOn) s_on.store(true);
+}
+
+IRAM_ATTR void trace_record(uint8_t type, uint16_t obj) {
+    if (!s_on.load(std::memory_order_relaxed)) return;
+    const uint32_t core = xPortGetCoreID();
+    const uint32_t idx = s_head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& e = s_ring[idx & (TRACE_RECORDER_EVENTS - 1)];
+    e.cycles = xthal_get_ccount() - s_offset[core];
+    e.type = type;
+    e.core = static_cast<uint8_t>(core);
+    e.obj = obj;
+}
+
+void trace_user(TraceUser id, uint8_t arg) {
+    trace_record(TRACE_EV_USER, static_cast<uint16_t>((static_cast<uint8_t>(id) << 8) | arg));
+}
+
+void trace_recorder_name(const void* handle, const char* name) {
+    uint8_t kind = kKindQueue;
+#if configUSE_TRACE_FACILITY
+    if (handle && ucQueueGetQueueType(static_cast<QueueHandle_t>(const_cast<void*>(handle))) != queueQUEUE_TYPE_BASE) {
+        kind = kKindMutex;
+    }
+#endif
+    const uint16_t id = intern(handle, kind);
+    if (!id || !name) return;
+    strncpy(s_names[id - 1], name, TRACE_RECORDER_NAME_BYTES - 1);
+}
+
+size_t trace_recorder_wakeups(TraceWakeup* out, size_t max, uint32_t* spanUs) {
+    if (spanUs) *spanUs = 0;
+    if (!out || !max) return 0;
+    const bool wasOn = s_on.exchange(false);
+    vTaskDelay(1);
+    const uint32_t head = s_head.load(std::memory_order_acquire);
+    const uint32_t count = head < TRACE_RECORDER_EVENTS ? head : TRACE_RECORDER_EVENTS;
+
+    // Per object: last task that sent or gave it, and the task blocked on it
+    uint16_t giver[TRACE_RECORDER_OBJECTS] = {};
+    uint8_t giverCore[TRACE_RECORDER_OBJECTS] = {};
+    uint16_t waiter[TRACE_RECORDER_OBJECTS] = {};
+    uint16_t running[portNUM_PROCESSORS] = {};
+    size_t n = 0;
+    int64_t spanCycles = 0;
+    uint32_t last = 0;
+    for (uint32_t i = head - count; i != head; i++) {
+        const TraceEvent e = s_ring[i & (TRACE_RECORDER_EVENTS - 1)];
+        if (i != head - count) {
+            const int32_t step = static_cast<int32_t>(e.cycles - last);
+            spanCycles += step;
+        }
+        last = e.cycles;
+        if (e.core >= portNUM_PROCESSORS) continue;
+        const uint16_t obj = e.obj;
+        const bool known = obj && obj <= TRACE_RECORDER_OBJECTS;
+        switch (e.type) {
+            case TRACE_EV_TASK_IN:
+                running[e.core] = obj;
+                break;
+            case TRACE_EV_QUEUE_BLOCK:
+                if (known) waiter[obj - 1] = running[e.core];
+                break;
+            case TRACE_EV_QUEUE_SEND:
+            case TRACE_EV_SEM_GIVE:
+                if (known) {
+                    giver[obj - 1] = running[e.core];
+                    giverCore[obj - 1] = e.core;
+                }
+                break;
+            case TRACE_EV_QUEUE_RECV:
+            case TRACE_EV_SEM_TAKE: {
+                if (!known) break;
+                const uint16_t woken = waiter[obj - 1];
+                const uint16_t waker = giver[obj - 1];
+                if (!woken || woken != running[e.core] || !waker || waker == woken) break;
+                waiter[obj - 1] = 0;
+                const TaskHandle_t wakerTask =
+                    static_cast<TaskHandle_t>(const_cast<void*>(s_objs[waker - 1].load(std::memory_order_relaxed)));
+                const TaskHandle_t wokenTask =
+                    static_cast<TaskHandle_t>(const_cast<void*>(s_objs[woken - 1].load(std::memory_order_relaxed)));
+                size_t k = 0;
+                while (k < n && !(out[k].waker == wakerTask && out[k].woken == wokenTask)) k++;
+                if (k == n) {
+                    if (n == max) break;
+                    out[n++] = TraceWakeup{wakerTask, wokenTask, 0, 0};
+                }
+                uint16_t& c = giverCore[obj - 1] != e.core ? out[k].crossCore : out[k].sameCore;
+                if (c < UINT16_MAX) c++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    if (wasOn) s_on.store(true);
+
+    for (size_t i = 1; i < n; i++) {
+        const TraceWakeup w = out[i];
+        size_t j = i;
+        for (; j > 0 && out[j - 1].crossCore < w.crossCore; j--) out[j] = out[j - 1];
+        out[j] = w;
+    }
+    if (spanUs && spanCycles > 0) *spanUs = static_cast<uint32_t>(spanCycles / getCpuFrequencyMhz());
+    return n;
+}
+
+size_t trace_recorder_latest(TraceRecentEvent* out, size_t max) {
+    if (!out || !max) return 0;
+    const uint32_t head = s_head.load(std::memory_order_acquire);
+    uint32_t count = head < TRACE_RECORDER_EVENTS ? head : TRACE_RECORDER_EVENTS;
+    if (count > max) count = max;
+    size_t n = 0;
+    for (uint32_t i = head - count; i != head; i++) {
+        const TraceEvent e = s_ring[i & (TRACE_RECORDER_EVENTS - 1)];
+        const bool named = e.type >= TRACE_EV_TASK_IN && e.type <= TRACE_EV_SEM_TAKE && e.obj &&
+                           e.obj <= TRACE_RECORDER_OBJECTS;
+        out[n++] = TraceRecentEvent{e.cycles, e.type, e.core, e.obj, named ? s_names[e.obj - 1] : ""};
+    }
+    return n;
+}
+
+void trace_recorder_dump(Print& out) {
+    out.println("TRACE BEGIN");
+    writeImage(out, true);
+    out.println("TRACE END");
+}
+
+bool trace_recorder_save(const char* path) {
+#if ENABLE_SD
+    bool ok = false;
+    if (!g_sdMutex || xSemaphoreTake(g_sdMutex, pdMS_TO_TICKS(STORAGE_SD_LOCK_MS)) == pdTRUE) {
+        File f = SD.open(path, FILE_WRITE);
+        if (f) {
+            writeImage(f, false);
+            f.close();
+            ok = true;
+        }
+        if (g_sdMutex) xSemaphoreGive(g_sdMutex);
+    }
+    Serial.printf("Trace: %s %s\n", ok ? "saved to" : "could not write", path);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void trace_recorder_poll_serial() {
+    while (Serial.available()) {
+        const int c = Serial.read();
+        if (c != '\n' && c != '\r') {
+            if (s_lineLen < sizeof(s_line) - 1) s_line[s_lineLen++] = static_cast<char>(c);
+            continue;
+        }
+        s_line[s_lineLen] = '\0';
+        s_lineLen = 0;
+        if (strcmp(s_line, "trace") == 0) {
+            trace_recorder_dump(Serial);
+        } else if (strcmp(s_line, "trace save") == 0) {
+            trace_recorder_save();
+        } else if (strcmp(s_line, "trace clear") == 0) {
+            trace_recorder_clear();
+            Serial.println("Trace: cleared");
+        }
+    }
+}
+
+#endif // TRACE_RECORDER_ENABLE
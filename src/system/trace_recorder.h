@@ -0,0 +1,120 @@
+/*
+ * Trace Event Recorder
+ * Binary ring of scheduling events for latency analysis: task switches, queue
+ * and semaphore traffic, ISR entry/exit and app markers, each stamped with the
+ * core's cycle counter.
+ *   - 8 bytes per event; one atomic claim per event, no lock, usable from ISRs
+ *     and from inside the kernel (trace_hooks.h shows how to wire the kernel
+ *     trace macros)
+ *   - tasks, queues and mutexes are interned into a small object table; the
+ *     kernel object table (task_config.h) names its queues and mutexes
+ *   - the ring overwrites its oldest events; a dump freezes it first
+ *
+ * Dump over Serial with the "trace" command (base64 between TRACE BEGIN/END
+ * lines) or to TRACE_RECORDER_PATH on the SD card with "trace save", then run
+ *   python3 tools/trace2chrome.py capture.txt -o trace.json
+ * and open the result in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * trace_recorder_wakeups() summarizes the ring on the device: which task woke
+ * which (a send or give that a blocked receiver then took), and whether the two
+ * ran on different cores; the core affinity tuner weighs placements with it.
+ */
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <Arduino.h>
+#include "../config/system_config.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "trace_hooks.h"
+
+#ifndef TRACE_RECORDER_EVENTS
+#define TRACE_RECORDER_EVENTS 1024          // 8 KB; power of two
+#endif
+#ifndef TRACE_RECORDER_OBJECTS
+#define TRACE_RECORDER_OBJECTS 64           // distinct tasks/queues/mutexes
+#endif
+#ifndef TRACE_RECORDER_SYNC_MS
+#define TRACE_RECORDER_SYNC_MS 4000         // below the 17.9 s cycle counter wrap at 240 MHz
+#endif
+#ifndef TRACE_RECORDER_PATH
+#define TRACE_RECORDER_PATH "/data/trace.bin"
+#endif
+#define TRACE_RECORDER_NAME_BYTES 16
+
+// App markers, recorded as TRACE_EV_USER with an 8-bit argument
+enum class TraceUser : uint8_t {
+    ButtonPress = 1,
+    UiEventSend,        // arg = UIEventType
+    UiEventHandled,     // arg = UIEventType
+    PageDrawn,
+};
+
+// One waker -> woken task pair seen in the ring
+struct TraceWakeup {
+    TaskHandle_t waker;
+    TaskHandle_t woken;
+    uint16_t crossCore;     // waker and woken on different cores
+    uint16_t sameCore;
+};
+
+// One of the newest events, its object named ("" for ISRs, markers and syncs)
+struct TraceRecentEvent {
+    uint32_t cycles;
+    uint8_t type;
+    uint8_t core;
+    uint16_t obj;
+    const char* name;
+};
+
+#if TRACE_RECORDER_ENABLE
+
+// Calibrates the per-core cycle counters and starts recording. Call once from setup().
+bool trace_recorder_begin();
+void trace_recorder_pause();
+void trace_recorder_resume();
+void trace_recorder_clear();
+
+void trace_record(uint8_t type, uint16_t obj);
+void trace_user(TraceUser id, uint8_t arg = 0);
+// Names a queue or mutex handle in the object table (kernel_objects does this)
+void trace_recorder_name(const void* handle, const char* name);
+
+// Wakeup pairs over the events in the ring, most cross-core first; spanUs gets
+// the time the ring covers. Pauses recording while it scans.
+size_t trace_recorder_wakeups(TraceWakeup* out, size_t max, uint32_t* spanUs);
+// The newest max events, oldest first, without pausing: an event written
+// meanwhile may come out torn. Any task; the reset journal snapshots these.
+size_t trace_recorder_latest(TraceRecentEvent* out, size_t max);
+
+// Base64 image between TRACE BEGIN / TRACE END lines; pauses while it writes
+void trace_recorder_dump(Print& out);
+// Binary image to the SD card
+bool trace_recorder_save(const char* path = TRACE_RECORDER_PATH);
+// Reads "trace", "trace save" and "trace clear" from Serial; call from loop()
+void trace_recorder_poll_serial();
+
+#define TRACE_USER(id, arg) trace_user(TraceUser::id, static_cast<uint8_t>(arg))
+
+#else
+
+inline bool trace_recorder_begin() { return false; }
+inline void trace_recorder_pause() {}
+inline void trace_recorder_resume() {}
+inline void trace_recorder_clear() {}
+inline void trace_recorder_name(const void*, const char*) {}
+inline size_t trace_recorder_wakeups(TraceWakeup*, size_t, uint32_t* spanUs) {
+    if (spanUs) *spanUs = 0;
+    return 0;
+}
+inline size_t trace_recorder_latest(TraceRecentEvent*, size_t) { return 0; }
+inline void trace_recorder_dump(Print&) {}
+inline bool trace_recorder_save(const char* = nullptr) { return false; }
+inline void trace_recorder_poll_serial() {}
+
+#define TRACE_USER(id, arg) do { } while (0)
+
+#endif // TRACE_RECORDER_ENABLE
+
+#endif // TRACE_RECORDER_H
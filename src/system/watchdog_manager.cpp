@@ -8,6 +8,9 @@
 #include "../include/recovery_actions.h"
 #include "../include/error_handler.h"
 #include "../modules/logging/log_buffer.h"
+#include "load_shed.h"
+#include "metrics.h"
+#include "service_task.h"
 #include <Arduino.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -27,6 +30,10 @@ WatchdogManager::WatchdogManager() {
     // Initialize watchdog registry
     memset(watchdogRegistry, 0, sizeof(watchdogRegistry));
     watchdogCount = 0;
+    for (uint8_t i = 0; i < MAX_WATCHDOGS; i++) {
+        heartbeat[i].store(0, std::memory_order_relaxed);
+        heartbeatSeen[i] = 0;
+    }
     
     // Initialize system health metrics
     memset(&systemHealth, 0, sizeof(systemHealth));
@@ -43,18 +50,21 @@ WatchdogManager::WatchdogManager() {
     degradationManager.level = DegradationLevel::NORMAL;
     degradationManager.reason = DegradationReason::NONE;
     degradationManager.start_time = 0;
+    degradationManager.duration = 0;
+    degradationManager.shed_floor = 0;
     
     // Initialize synchronization
     watchdogMutex = xSemaphoreCreateMutex();
     recoveryMutex = xSemaphoreCreateMutex();
     healthMutex = xSemaphoreCreateMutex();
+    watchdogJob = SERVICE_JOB_NONE;
     
     // Initialize hardware watchdog
     if (!initHardwareWatchdog()) {
         Serial.println("WatchdogManager: Hardware watchdog initialization failed");
     }
     
-    // Start watchdog monitoring task
+    // Schedule watchdog monitoring on the service task
     startWatchdogTask();
     
     Serial.println("WatchdogManager: Advanced fault tolerance system initialized");
@@ -86,123 +96,97 @@ WatchdogManager::~WatchdogManager() {
 // WATCHDOG MANAGEMENT
 // ============================================================================
 bool WatchdogManager::registerWatchdog(const WatchdogInfo& info) {
-    if (!takeWatchdogMutex()) return false;
+    return registerWatchdogSlot(info) != WATCHDOG_SLOT_NONE;
+}
+
+WatchdogSlot WatchdogManager::registerWatchdogSlot(const WatchdogInfo& info) {
+    if (!takeWatchdogMutex()) return WATCHDOG_SLOT_NONE;
     
-    if (watchdogCount >= MAX_WATCHDOGS) {
+    // Check for duplicate names
+    if (findWatchdog(info.name) != WATCHDOG_SLOT_NONE) {
         giveWatchdogMutex();
-        REPORT_ERROR(ERROR_SYSTEM_FAULT, ErrorSeverity::ERROR, ErrorCategory::SYSTEM,
-                      "Watchdog registry full");
-        return false;
+        return WATCHDOG_SLOT_NONE; // Already registered
     }
     
-    // Check for duplicate names
-    for (uint8_t i = 0; i < watchdogCount; i++) {
-        if (strcmp(watchdogRegistry[i].name, info.name) == 0) {
-            giveWatchdogMutex();
-            return false; // Already registered
+    int8_t slot = WATCHDOG_SLOT_NONE;
+    for (uint8_t i = 0; i < MAX_WATCHDOGS; i++) {
+        if (!watchdogRegistry[i].is_active) {
+            slot = i;
+            break;
         }
     }
     
-    // Add new watchdog
-    WatchdogInfo& watchdog = watchdogRegistry[watchdogCount];
+    if (slot == WATCHDOG_SLOT_NONE) {
+        giveWatchdogMutex();
+        REPORT_ERROR(ERROR_SYSTEM_FAULT, ErrorSeverity::ERROR, ErrorCategory::SYSTEM,
+                      "Watchdog registry full");
+        return WATCHDOG_SLOT_NONE;
+    }
+    
+    // Add new watchdog; the heartbeat starts as if kicked now
+    WatchdogInfo& watchdog = watchdogRegistry[slot];
     watchdog = info;
     watchdog.last_kick = millis();
     watchdog.trigger_count = 0;
-    watchdog.is_active = true;
     watchdog.health_score = 100.0f;
-    
-    // Create software watchdog timer
-    if (info.timeout_ms > 0) {
-        watchdog.timer_handle = xTimerCreate(
-            info.name,
-            pdMS_TO_TICKS(info.timeout_ms),
-            pdFALSE, // One-shot
-            this,
-            watchdogTimerCallback
-        );
-        
-        if (!watchdog.timer_handle) {
-            giveWatchdogMutex();
-            REPORT_ERROR(ERROR_SYSTEM_FAULT, ErrorSeverity::ERROR, ErrorCategory::SYSTEM,
-                          "Failed to create watchdog timer");
-            return false;
-        }
-    }
-    
+    const uint32_t now = xTaskGetTickCount();
+    heartbeat[slot].store(now, std::memory_order_relaxed);
+    heartbeatSeen[slot] = now;
+    watchdog.is_active = true;
     watchdogCount++;
     
     giveWatchdogMutex();
     
-    logbuf_printf("WatchdogManager: Registered watchdog '%s' (timeout: %ums, priority: %u)",
-                 info.name, info.timeout_ms, info.priority);
+    logbuf_printf("WatchdogManager: Registered watchdog '%s' in slot %d (timeout: %ums, priority: %u)",
+                 info.name, slot, info.timeout_ms, info.priority);
     
-    return true;
+    return slot;
+}
+
+int8_t WatchdogManager::findWatchdog(const char* name) const {
+    for (uint8_t i = 0; i < MAX_WATCHDOGS; i++) {
+        if (watchdogRegistry[i].is_active && strcmp(watchdogRegistry[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return WATCHDOG_SLOT_NONE;
 }
 
 bool WatchdogManager::kickWatchdog(const char* name) {
     if (!takeWatchdogMutex()) return false;
     
-    bool found = false;
-    for (uint8_t i = 0; i < watchdogCount; i++) {
-        WatchdogInfo& watchdog = watchdogRegistry[i];
-        
-        if (strcmp(watchdog.name, name) == 0 && watchdog.is_active) {
-            // Reset timer
-            if (watchdog.timer_handle) {
-                xTimerChangePeriod(watchdog.timer_handle, pdMS_TO_TICKS(watchdog.timeout_ms), 0);
-                xTimerStart(watchdog.timer_handle, 0);
-            }
-            
-            watchdog.last_kick = millis();
-            watchdog.health_score = min(100.0f, watchdog.health_score + 5.0f);
-            found = true;
-            break;
-        }
+    const int8_t slot = findWatchdog(name);
+    if (slot != WATCHDOG_SLOT_NONE) {
+        kick(slot);
     }
     
     giveWatchdogMutex();
     
-    if (!found) {
+    if (slot == WATCHDOG_SLOT_NONE) {
         REPORT_ERROR(ERROR_SYSTEM_FAULT, ErrorSeverity::WARNING, ErrorCategory::SYSTEM,
                       "Attempted to kick unknown watchdog");
     }
     
-    return found;
+    return slot != WATCHDOG_SLOT_NONE;
 }
 
 bool WatchdogManager::unregisterWatchdog(const char* name) {
     if (!takeWatchdogMutex()) return false;
     
-    bool found = false;
-    for (uint8_t i = 0; i < watchdogCount; i++) {
-        WatchdogInfo& watchdog = watchdogRegistry[i];
-        
-        if (strcmp(watchdog.name, name) == 0) {
-            // Stop and delete timer
-            if (watchdog.timer_handle) {
-                xTimerStop(watchdog.timer_handle, 0);
-                xTimerDelete(watchdog.timer_handle, 0);
-            }
-            
-            watchdog.is_active = false;
-            
-            // Shift remaining watchdogs
-            for (uint8_t j = i; j < watchdogCount - 1; j++) {
-                watchdogRegistry[j] = watchdogRegistry[j + 1];
-            }
-            watchdogCount--;
-            found = true;
-            break;
-        }
+    // Slots are not compacted: handles held by other watchdogs stay valid
+    const int8_t slot = findWatchdog(name);
+    if (slot != WATCHDOG_SLOT_NONE) {
+        watchdogRegistry[slot].is_active = false;
+        watchdogCount--;
     }
     
     giveWatchdogMutex();
     
-    if (found) {
+    if (slot != WATCHDOG_SLOT_NONE) {
         logbuf_printf("WatchdogManager: Unregistered watchdog '%s'", name);
     }
     
-    return found;
+    return slot != WATCHDOG_SLOT_NONE;
 }
 
 // ============================================================================
@@ -278,10 +262,10 @@ bool WatchdogManager::performRecovery(const char* watchdogName, RecoveryAction a
 
 bool WatchdogManager::restartWatchdogTask(const char* watchdogName) {
     // Find the watchdog and associated task
-    for (uint8_t i = 0; i < watchdogCount; i++) {
+    for (uint8_t i = 0; i < MAX_WATCHDOGS; i++) {
         WatchdogInfo& watchdog = watchdogRegistry[i];
         
-        if (strcmp(watchdog.name, watchdogName) == 0 && watchdog.task_handle) {
+        if (watchdog.is_active && strcmp(watchdog.name, watchdogName) == 0 && watchdog.task_handle) {
             // Attempt graceful task restart
             logbuf_printf("Restarting task associated with watchdog '%s'", watchdogName);
             
@@ -330,23 +314,7 @@ bool WatchdogManager::initiateSystemDegradation() {
     degradationManager.start_time = millis();
     
     // Apply degradation measures
-    switch (level) {
-        case DegradationLevel::MINOR:
-            applyMinorDegradation();
-            break;
-            
-        case DegradationLevel::MODERATE:
-            applyModerateDegradation();
-            break;
-            
-        case DegradationLevel::SEVERE:
-            applySevereDegradation();
-            break;
-            
-        case DegradationLevel::CRITICAL:
-            applyCriticalDegradation();
-            break;
-    }
+    applyDegradation(level);
     
     systemHealth.degraded = true;
     
@@ -364,20 +332,26 @@ void WatchdogManager::performHealthCheck() {
     uint32_t currentTime = millis();
     systemHealth.last_health_check = currentTime;
     
-    // Check individual watchdogs
+    // Check every heartbeat against its deadline in one sweep
     uint8_t healthyWatchdogs = 0;
     uint8_t totalWatchdogs = 0;
+    const uint32_t nowTicks = xTaskGetTickCount();
     
-    for (uint8_t i = 0; i < watchdogCount; i++) {
+    for (uint8_t i = 0; i < MAX_WATCHDOGS; i++) {
         WatchdogInfo& watchdog = watchdogRegistry[i];
         
         if (watchdog.is_active) {
             totalWatchdogs++;
             
-            // Check timeout
-            uint32_t timeSinceKick = currentTime - watchdog.last_kick;
+            const uint32_t beat = heartbeat[i].load(std::memory_order_relaxed);
+            uint32_t timeSinceKick = (nowTicks - beat) * portTICK_PERIOD_MS;
+            watchdog.last_kick = currentTime - timeSinceKick;
+            if (beat != heartbeatSeen[i]) {
+                heartbeatSeen[i] = beat;
+                watchdog.health_score = min(100.0f, watchdog.health_score + WATCHDOG_KICK_HEALTH_BONUS);
+            }
             
-            if (timeSinceKick > watchdog.timeout_ms) {
+            if (watchdog.timeout_ms > 0 && timeSinceKick > watchdog.timeout_ms) {
                 // Watchdog timeout
                 handleWatchdogTimeout(watchdog);
                 watchdog.health_score = max(0.0f, watchdog.health_score - 20.0f);
@@ -398,8 +372,11 @@ void WatchdogManager::performHealthCheck() {
     uint32_t totalHeap = ESP.getHeapSize();
     float memoryHealth = (float)freeHeap / totalHeap * 100.0f;
     
-    // Calculate CPU health (would integrate with task scheduler)
-    float cpuHealth = 85.0f; // Placeholder
+    // Calculate CPU health from the busiest core in the metrics registry
+    float cpuHealth = 100.0f;
+    int64_t load = 0;
+    if (metrics_value("cpu.load0_pm", load) && load >= 0) cpuHealth = min(cpuHealth, 100.0f - load / 10.0f);
+    if (metrics_value("cpu.load1_pm", load) && load >= 0) cpuHealth = min(cpuHealth, 100.0f - load / 10.0f);
     
     // Combine health metrics
     systemHealth.watchdog_health = watchdogHealth;
@@ -483,36 +460,96 @@ DegradationReason WatchdogManager::determineDegradationReason() const {
     }
 }
 
+void WatchdogManager::applyDegradation(DegradationLevel level) {
+    switch (level) {
+        case DegradationLevel::MINOR:
+            applyMinorDegradation();
+            break;
+            
+        case DegradationLevel::MODERATE:
+            applyModerateDegradation();
+            break;
+            
+        case DegradationLevel::SEVERE:
+            applySevereDegradation();
+            break;
+            
+        case DegradationLevel::CRITICAL:
+            applyCriticalDegradation();
+            break;
+            
+        default:
+            break;
+    }
+}
+
+// Each level holds one more load shedding step, in the shedder's order; the
+// shedder measures what each step frees and gives them back above the floor
 void WatchdogManager::applyMinorDegradation() {
     logbuf_printf("Applying minor system degradation");
-    
-    // Reduce non-critical task priorities
-    // Disable optional features
-    // Increase monitoring frequency
+    degradationManager.shed_floor = 1;
+    load_shed_set_floor(degradationManager.shed_floor);
 }
 
 void WatchdogManager::applyModerateDegradation() {
     logbuf_printf("Applying moderate system degradation");
-    
-    // Pause non-essential tasks
-    // Reduce data collection rates
-    // Clear non-critical buffers
+    degradationManager.shed_floor = 2;
+    load_shed_set_floor(degradationManager.shed_floor);
 }
 
 void WatchdogManager::applySevereDegradation() {
     logbuf_printf("Applying severe system degradation");
-    
-    // Stop all non-critical tasks
-    // Maintain only essential functions
-    // Maximize memory recovery
+    degradationManager.shed_floor = 3;
+    load_shed_set_floor(degradationManager.shed_floor);
 }
 
 void WatchdogManager::applyCriticalDegradation() {
     logbuf_printf("Applying critical system degradation");
     
-    // Enter safe mode
-    // Minimal operation only
-    // Prepare for possible restart
+    // Everything optional goes; the PLC scan and alarms are never shed
+    degradationManager.shed_floor = (uint8_t)ShedStep::Count;
+    load_shed_set_floor(degradationManager.shed_floor);
+}
+
+void WatchdogManager::liftSystemDegradation() {
+    if (!degradationManager.active) {
+        return;
+    }
+    
+    degradationManager.duration = millis() - degradationManager.start_time;
+    logbuf_printf("System degradation lifted after %lu ms (level %d)",
+                 (unsigned long)degradationManager.duration, (int)degradationManager.level);
+    
+    // Shed steps come back one at a time as the shedder sees the pressure clear
+    degradationManager.active = false;
+    degradationManager.level = DegradationLevel::NORMAL;
+    degradationManager.reason = DegradationReason::NONE;
+    degradationManager.shed_floor = 0;
+    load_shed_set_floor(0);
+    systemHealth.degraded = false;
+}
+
+void WatchdogManager::handleCriticalHealth() {
+    if (!degradationManager.active) {
+        initiateSystemDegradation();
+        return;
+    }
+    
+    // Already degraded: go deeper if the health now calls for it
+    const DegradationLevel level = calculateDegradationLevel();
+    if (level > degradationManager.level) {
+        logbuf_printf("System degradation raised from level %d to %d",
+                     (int)degradationManager.level, (int)level);
+        degradationManager.level = level;
+        applyDegradation(level);
+    }
+}
+
+void WatchdogManager::handleWarningHealth() {
+    // Warning range: degrade to the level the score gives, unless already degraded
+    if (!degradationManager.active) {
+        initiateSystemDegradation();
+    }
 }
 
 // ============================================================================
@@ -552,51 +589,22 @@ void WatchdogManager::disableHardwareWatchdog() {
 // TASK MANAGEMENT
 // ============================================================================
 void WatchdogManager::startWatchdogTask() {
-    xTaskCreate(
-        vWatchdogMonitorTask,
-        "WatchdogMonitor",
-        WATCHDOG_TASK_STACK_SIZE,
-        nullptr,
-        WATCHDOG_TASK_PRIORITY,
-        &watchdogTask
-    );
+    if (watchdogJob == SERVICE_JOB_NONE) {
+        watchdogJob = service_job_add("WatchdogMonitor", watchdogMonitorJob, this,
+                                      WATCHDOG_CHECK_INTERVAL_MS, WATCHDOG_JOB_BUDGET_US);
+    }
 }
 
 void WatchdogManager::stopAllWatchdogs() {
-    if (watchdogTask) {
-        vTaskDelete(watchdogTask);
-        watchdogTask = nullptr;
+    if (watchdogJob != SERVICE_JOB_NONE) {
+        service_job_remove(watchdogJob);
+        watchdogJob = SERVICE_JOB_NONE;
     }
     
-    // Stop all watchdog timers
-    for (uint8_t i = 0; i < watchdogCount; i++) {
-        WatchdogInfo& watchdog = watchdogRegistry[i];
-        
-        if (watchdog.timer_handle) {
-            xTimerStop(watchdog.timer_handle, 0);
-            xTimerDelete(watchdog.timer_handle, 0);
-            watchdog.timer_handle = nullptr;
-        }
-        watchdog.is_active = false;
-    }
-}
-
-// ============================================================================
-// TIMER CALLBACK
-// ============================================================================
-void WatchdogManager::watchdogTimerCallback(TimerHandle_t xTimer) {
-    WatchdogManager* manager = static_cast<WatchdogManager*>(pvTimerGetTimerID(xTimer));
-    
-    if (manager) {
-        // Find the watchdog associated with this timer
-        const char* timerName = pcTimerGetName(xTimer);
-        for (uint8_t i = 0; i < manager->watchdogCount; i++) {
-            if (strcmp(manager->watchdogRegistry[i].name, timerName) == 0) {
-                manager->handleWatchdogTimeout(manager->watchdogRegistry[i]);
-                break;
-            }
-        }
+    for (uint8_t i = 0; i < MAX_WATCHDOGS; i++) {
+        watchdogRegistry[i].is_active = false;
     }
+    watchdogCount = 0;
 }
 
 // ============================================================================
@@ -636,26 +644,22 @@ void WatchdogManager::giveHealthMutex() {
 }
 
 // ============================================================================
-// WATCHDOG MONITOR TASK
+// WATCHDOG MONITOR JOB
 // ============================================================================
-void vWatchdogMonitorTask(void* pvParameters) {
-    WatchdogManager* manager = WatchdogManager::getInstance();
+void watchdogMonitorJob(void* ctx) {
+    WatchdogManager* manager = static_cast<WatchdogManager*>(ctx);
     
-    while (true) {
-        // Perform health check
-        manager->performHealthCheck();
-        
-        // Kick hardware watchdog
-        manager->kickHardwareWatchdog();
-        
-        // Update degradation status
-        if (manager->degradationManager.active) {
-            // Check if degradation can be lifted
-            if (manager->systemHealth.overall_score > HEALTH_RECOVERY_THRESHOLD) {
-                manager->liftSystemDegradation();
-            }
+    // Perform health check
+    manager->performHealthCheck();
+    
+    // Kick hardware watchdog
+    manager->kickHardwareWatchdog();
+    
+    // Update degradation status
+    if (manager->degradationManager.active) {
+        // Check if degradation can be lifted
+        if (manager->systemHealth.overall_score > HEALTH_RECOVERY_THRESHOLD) {
+            manager->liftSystemDegradation();
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(WATCHDOG_CHECK_INTERVAL_MS));
     }
 }
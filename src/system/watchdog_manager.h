@@ -11,6 +11,7 @@
 #include <freertos/task.h>
 #include <freertos/timers.h>
 #include <freertos/semphr.h>
+#include <atomic>
 
 // ============================================================================
 // WATCHDOG CONFIGURATION
@@ -22,8 +23,12 @@
 #define HEALTH_WARNING_THRESHOLD 60.0f
 #define HEALTH_RECOVERY_THRESHOLD 80.0f
 
-#define WATCHDOG_TASK_STACK_SIZE 4096
-#define WATCHDOG_TASK_PRIORITY 2
+#define WATCHDOG_JOB_BUDGET_US 10000       // service job run-time budget
+#define WATCHDOG_KICK_HEALTH_BONUS 5.0f    // health regained once per check when kicked
+
+// Registry slot returned by registerWatchdogSlot(); stays valid until unregistered
+typedef int8_t WatchdogSlot;
+#define WATCHDOG_SLOT_NONE (-1)
 
 // ============================================================================
 // RECOVERY ACTIONS
@@ -58,13 +63,12 @@ struct WatchdogInfo {
     TaskHandle_t task_handle;
     UBaseType_t priority;
     uint32_t timeout_ms;
-    TimerHandle_t timer_handle;
     
     // Callbacks
     void (*restart_callback)(void);
     void (*task_create_function)(void);
     
-    // Runtime information
+    // Runtime information (last_kick is refreshed from the heartbeat by each check)
     uint32_t last_kick;
     uint32_t trigger_count;
     bool is_active;
@@ -128,11 +132,8 @@ struct DegradationManager {
     uint32_t start_time;
     uint32_t duration;
     
-    // Degradation actions
-    bool tasks_paused;
-    bool features_disabled;
-    bool data_reduced;
-    bool monitoring_increased;
+    // Load shedding steps held whatever the pressure (load_shed.h), one per level
+    uint8_t shed_floor;
 };
 
 // ============================================================================
@@ -140,10 +141,14 @@ struct DegradationManager {
 // ============================================================================
 class WatchdogManager {
 private:
-    // Watchdog registry
+    // Watchdog registry: slots stay put for their lifetime, is_active marks use
     WatchdogInfo watchdogRegistry[MAX_WATCHDOGS];
     uint8_t watchdogCount;
     
+    // Heartbeats: tick count of the last kick per slot, written without locking
+    std::atomic<uint32_t> heartbeat[MAX_WATCHDOGS];
+    uint32_t heartbeatSeen[MAX_WATCHDOGS];    // heartbeat at the previous check
+    
     // Recovery statistics
     RecoveryStatistics recoveryStats;
     
@@ -155,8 +160,8 @@ private:
     SemaphoreHandle_t recoveryMutex;
     SemaphoreHandle_t healthMutex;
     
-    // Task handle
-    TaskHandle_t watchdogTask;
+    // Service job (service_task.h)
+    int watchdogJob;
     
     // Internal methods
     bool initHardwareWatchdog();
@@ -181,6 +186,7 @@ private:
     // Degradation management
     DegradationLevel calculateDegradationLevel() const;
     DegradationReason determineDegradationReason() const;
+    void applyDegradation(DegradationLevel level);
     void applyMinorDegradation();
     void applyModerateDegradation();
     void applySevereDegradation();
@@ -198,8 +204,7 @@ private:
     void giveRecoveryMutex();
     void giveHealthMutex();
     
-    // Timer callback
-    static void watchdogTimerCallback(TimerHandle_t xTimer);
+    int8_t findWatchdog(const char* name) const;
     
 public:
     static WatchdogManager* instance;
@@ -218,7 +223,15 @@ public:
     
     // Watchdog management
     bool registerWatchdog(const WatchdogInfo& info);
+    WatchdogSlot registerWatchdogSlot(const WatchdogInfo& info);
     bool kickWatchdog(const char* name);
+    // One relaxed store from task context; cheap enough to call every loop cycle.
+    // The check job compares it against timeout_ms every WATCHDOG_CHECK_INTERVAL_MS.
+    void kick(WatchdogSlot slot) {
+        if (slot >= 0 && slot < MAX_WATCHDOGS) {
+            heartbeat[slot].store(xTaskGetTickCount(), std::memory_order_relaxed);
+        }
+    }
     bool unregisterWatchdog(const char* name);
     WatchdogInfo* getWatchdogInfo(const char* name);
     uint8_t getWatchdogCount() const { return watchdogCount; }
@@ -299,15 +312,17 @@ inline const char* degradationReasonToString(DegradationReason reason) {
 }
 
 // ============================================================================
-// TASK FUNCTION DECLARATIONS
+// SERVICE JOB FUNCTIONS
 // ============================================================================
-void vWatchdogMonitorTask(void* pvParameters);
+// One supervision pass: health check, hardware watchdog kick, degradation lift
+void watchdogMonitorJob(void* ctx);
 
 // ============================================================================
 // CONVENIENCE MACROS
 // ============================================================================
 #define WATCHDOG_REGISTER(info) watchdogManager->registerWatchdog(info)
 #define WATCHDOG_KICK(name) watchdogManager->kickWatchdog(name)
+#define WATCHDOG_KICK_SLOT(slot) watchdogManager->kick(slot)
 #define WATCHDOG_UNREGISTER(name) watchdogManager->unregisterWatchdog(name)
 #define WATCHDOG_IS_HEALTHY() watchdogManager->isSystemHealthy()
 #define WATCHDOG_HEALTH_SCORE() watchdogManager->getHealthScore()
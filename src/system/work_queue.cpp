@@ -0,0 +1,266 @@
+/*
+ * Work Queue Implementation
+ */
+
+#include "work_queue.h"
+#include "kernel_objects.h"
+#include "../../include/memory_monitor.h"
+#include "../../include/object_pool.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <string.h>
+
+namespace {
+constexpr size_t kPriorities = static_cast<size_t>(WorkPriority::Count);
+constexpr uint8_t kWorkers = 2;
+
+struct WorkJob {
+    WorkJob* next;
+    const char* name;
+    WorkFn fn;
+    void* ctx;
+    WorkId id;
+    uint32_t submittedUs;
+};
+
+struct Worker {
+    WorkJob* head[kPriorities];
+    WorkJob* tail[kPriorities];
+    TaskHandle_t task;
+    WorkId running;
+    volatile bool cancelRunning;
+};
+
+struct NameStats {
+    WorkJobStats s;
+    uint64_t waitTotalUs;
+    uint64_t runTotalUs;
+};
+
+ObjectPool<WorkJob, WORK_QUEUE_JOBS> s_pool("work jobs");
+portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+Worker s_workers[kWorkers];
+NameStats s_stats[WORK_QUEUE_STAT_SLOTS];
+WorkId s_nextId = 1;
+bool s_started = false;
+
+// Under s_mux; null when the table is full
+NameStats* statsFor(const char* name) {
+    for (NameStats& n : s_stats) {
+        if (n.s.name == name) return &n;
+        if (!n.s.name) {
+            n.s.name = name;
+            return &n;
+        }
+    }
+    return nullptr;
+}
+
+// Under s_mux
+WorkJob* pop(Worker& w) {
+    for (size_t p = 0; p < kPriorities; p++) {
+        WorkJob* job = w.head[p];
+        if (!job) continue;
+        w.head[p] = job->next;
+        if (!w.head[p]) w.tail[p] = nullptr;
+        return job;
+    }
+    return nullptr;
+}
+
+// Under s_mux. Finds a queued job; prev is its predecessor in list p.
+WorkJob* findQueued(WorkId id, Worker*& worker, size_t& prio, WorkJob*& prev) {
+    for (Worker& w : s_workers) {
+        for (size_t p = 0; p < kPriorities; p++) {
+            prev = nullptr;
+            for (WorkJob* j = w.head[p]; j; prev = j, j = j->next) {
+                if (j->id == id) {
+                    worker = &w;
+                    prio = p;
+                    return j;
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+void workerTask(void* pvParameters) {
+    Worker& w = *static_cast<Worker*>(pvParameters);
+    for (;;) {
+        portENTER_CRITICAL(&s_mux);
+        WorkJob* job = pop(w);
+        if (job) {
+            w.running = job->id;
+            w.cancelRunning = false;
+        }
+        portEXIT_CRITICAL(&s_mux);
+        if (!job) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        const uint32_t start = micros();
+        job->fn(job->ctx);
+        const uint32_t runUs = micros() - start;
+        const uint32_t waitUs = start - job->submittedUs;
+
+        portENTER_CRITICAL(&s_mux);
+        w.running = WORK_ID_NONE;
+        NameStats* n = statsFor(job->name);
+        if (n) {
+            n->s.runs++;
+            n->waitTotalUs += waitUs;
+            n->runTotalUs += runUs;
+            if (waitUs > n->s.waitMaxUs) n->s.waitMaxUs = waitUs;
+            if (runUs > n->s.runMaxUs) n->s.runMaxUs = runUs;
+        }
+        portEXIT_CRITICAL(&s_mux);
+        s_pool.destroy(job);
+    }
+}
+} // namespace
+
+bool work_queue_begin() {
+    if (s_started) return true;
+    static const KernelTask kTasks[kWorkers] = {KernelTask::Work0, KernelTask::Work1};
+    bool ok = true;
+    for (uint8_t core = 0; core < kWorkers; core++) {
+        if (kernel_task_create(kTasks[core], workerTask, &s_workers[core], TASK_PRIORITY_WORK,
+                               &s_workers[core].task, core) != pdPASS) {
+            s_workers[core].task = nullptr;
+            Serial.printf("WorkQueue: Failed to start worker on core %u\n", (unsigned)core);
+            ok = false;
+        }
+    }
+    MemoryMonitor::registerPool(s_pool.stats());
+    s_started = true;
+    return ok;
+}
+
+WorkId work_submit(const char* name, WorkFn fn, void* ctx, WorkPriority priority, uint8_t core, uint8_t flags) {
+    if (!fn || priority >= WorkPriority::Count) return WORK_ID_NONE;
+    if (!s_started) work_queue_begin();
+    Worker& w = s_workers[core < kWorkers ? core : WORK_CORE_APP];
+    const size_t p = static_cast<size_t>(priority);
+
+    if (flags & WORK_COALESCE) {
+        WorkId queued = WORK_ID_NONE;
+        portENTER_CRITICAL(&s_mux);
+        for (size_t q = 0; q < kPriorities && !queued; q++) {
+            for (WorkJob* j = w.head[q]; j; j = j->next) {
+                if (j->fn == fn && j->ctx == ctx) {
+                    queued = j->id;
+                    break;
+                }
+            }
+        }
+        portEXIT_CRITICAL(&s_mux);
+        if (queued) return queued;
+    }
+
+    WorkJob* job = s_pool.create();
+    if (!job) {
+        portENTER_CRITICAL(&s_mux);
+        NameStats* n = statsFor(name);
+        if (n) n->s.dropped++;
+        portEXIT_CRITICAL(&s_mux);
+        return WORK_ID_NONE;
+    }
+    job->next = nullptr;
+    job->name = name;
+    job->fn = fn;
+    job->ctx = ctx;
+    job->submittedUs = micros();
+
+    portENTER_CRITICAL(&s_mux);
+    job->id = s_nextId++;
+    if (!s_nextId) s_nextId = 1;
+    if (w.tail[p]) {
+        w.tail[p]->next = job;
+    } else {
+        w.head[p] = job;
+    }
+    w.tail[p] = job;
+    const WorkId id = job->id;
+    portEXIT_CRITICAL(&s_mux);
+    if (w.task) xTaskNotifyGive(w.task);
+    return id;
+}
+
+bool work_cancel(WorkId id) {
+    if (id == WORK_ID_NONE) return false;
+    Worker* w = nullptr;
+    size_t p = 0;
+    WorkJob* prev = nullptr;
+    portENTER_CRITICAL(&s_mux);
+    WorkJob* job = findQueued(id, w, p, prev);
+    if (job) {
+        if (prev) {
+            prev->next = job->next;
+        } else {
+            w->head[p] = job->next;
+        }
+        if (w->tail[p] == job) w->tail[p] = prev;
+        NameStats* n = statsFor(job->name);
+        if (n) n->s.cancelled++;
+    } else {
+        for (Worker& r : s_workers) {
+            if (r.running == id) r.cancelRunning = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (job) s_pool.destroy(job);
+    return job != nullptr;
+}
+
+bool work_cancel_requested() {
+    const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (const Worker& w : s_workers) {
+        if (w.task == self) return w.cancelRunning;
+    }
+    return false;
+}
+
+bool work_pending(WorkId id) {
+    if (id == WORK_ID_NONE) return false;
+    Worker* w = nullptr;
+    size_t p = 0;
+    WorkJob* prev = nullptr;
+    portENTER_CRITICAL(&s_mux);
+    bool pending = findQueued(id, w, p, prev) != nullptr;
+    for (const Worker& r : s_workers) {
+        if (r.running == id) pending = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return pending;
+}
+
+size_t work_stats(WorkJobStats* out, size_t max) {
+    if (!out) return 0;
+    size_t n = 0;
+    portENTER_CRITICAL(&s_mux);
+    for (const NameStats& s : s_stats) {
+        if (!s.s.name || n >= max) break;
+        out[n] = s.s;
+        out[n].waitAvgUs = s.s.runs ? static_cast<uint32_t>(s.waitTotalUs / s.s.runs) : 0;
+        out[n].runAvgUs = s.s.runs ? static_cast<uint32_t>(s.runTotalUs / s.s.runs) : 0;
+        n++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return n;
+}
+
+void work_report(Print& out) {
+    WorkJobStats jobs[WORK_QUEUE_STAT_SLOTS];
+    const size_t n = work_stats(jobs, WORK_QUEUE_STAT_SLOTS);
+    if (!n) return;
+    out.printf("Work queue: %u/%u jobs in use\n", (unsigned)s_pool.inUse(), (unsigned)WORK_QUEUE_JOBS);
+    out.println("  name           runs cancel drop  wait avg/max us   run avg/max us");
+    for (size_t i = 0; i < n; i++) {
+        const WorkJobStats& j = jobs[i];
+        out.printf("  %-14s %5lu %6lu %4lu %7lu/%-8lu %7lu/%lu\n", j.name, (unsigned long)j.runs,
+                   (unsigned long)j.cancelled, (unsigned long)j.dropped, (unsigned long)j.waitAvgUs,
+                   (unsigned long)j.waitMaxUs, (unsigned long)j.runAvgUs, (unsigned long)j.runMaxUs);
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ * Work Queue
+ * Deferred one-shot jobs for slow work that used to run inline on the UI tasks
+ * or on a short-lived task of its own (CatM re-probe, settings saves, network
+ * speed test). One worker per core with a fixed stack from the kernel object
+ * table (Work0, Work1); jobs come from an ObjectPool, so submitting never
+ * touches the heap.
+ *
+ *   - three priorities, FIFO within a priority; a worker always takes the
+ *     highest queued priority next
+ *   - WORK_COALESCE: a job whose fn/ctx is already queued is not queued again
+ *   - work_cancel() drops a queued job, or flags a running one; long jobs poll
+ *     work_cancel_requested()
+ *   - per job name: runs, cancels, pool-full drops, queue latency
+ *     (submit to start) and run time
+ *
+ * Workers run below the display task, so the UI stays responsive while a slow
+ * job runs; a slow job still delays the jobs queued behind it on that core.
+ */
+
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <Arduino.h>
+
+#ifndef WORK_QUEUE_JOBS
+#define WORK_QUEUE_JOBS 16                 // queued + running, both cores
+#endif
+#ifndef WORK_QUEUE_STAT_SLOTS
+#define WORK_QUEUE_STAT_SLOTS 12           // distinct job names in the stats
+#endif
+#define WORK_CORE_MODEM 0                  // worker next to the modem and radio stacks
+#define WORK_CORE_APP 1                    // worker next to the UI and PLC scan
+#define WORK_ID_NONE 0U
+
+// Flags
+#define WORK_COALESCE 0x01
+
+enum class WorkPriority : uint8_t {
+    High,
+    Normal,
+    Low,
+    Count
+};
+
+typedef void (*WorkFn)(void* ctx);
+typedef uint32_t WorkId;
+
+struct WorkJobStats {
+    const char* name;
+    uint32_t runs;
+    uint32_t cancelled;
+    uint32_t dropped;          // pool full at submit
+    uint32_t waitAvgUs;
+    uint32_t waitMaxUs;
+    uint32_t runAvgUs;
+    uint32_t runMaxUs;
+};
+
+// Starts both workers (idempotent)
+bool work_queue_begin();
+
+// Queues fn(ctx) on the given core's worker. name must be a string literal.
+// Returns the job id (the queued one's when it coalesced), or WORK_ID_NONE when the pool is full.
+WorkId work_submit(const char* name, WorkFn fn, void* ctx, WorkPriority priority = WorkPriority::Normal,
+                   uint8_t core = WORK_CORE_APP, uint8_t flags = 0);
+// True if the job was still queued and is now dropped; a running job is only flagged
+bool work_cancel(WorkId id);
+// For the running job: was it cancelled?
+bool work_cancel_requested();
+bool work_pending(WorkId id);
+
+size_t work_stats(WorkJobStats* out, size_t max);
+void work_report(Print& out);
+
+#endif // WORK_QUEUE_H
@@ -15,6 +15,11 @@ struct BootLogEntry {
 };
 
 void drawBootScreen(const char* status, int progress, bool passed) {
+    if (!kBuildFeatures.display) {
+        // No panel in this build profile: the POST steps go to the serial log
+        if (status && status[0]) Serial.printf("POST %3d%% %s%s\n", progress, status, passed ? "" : " FAILED");
+        return;
+    }
     constexpr size_t BOOT_LOG_CAPACITY = 8;
     static BootLogEntry logEntries[BOOT_LOG_CAPACITY];
     static size_t logCount = 0;
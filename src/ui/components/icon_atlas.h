@@ -0,0 +1,75 @@
+/*
+ * Icon Atlas
+ * Generated by tools/gen_icon_atlas.py - do not edit. 1-bit masks in flash,
+ * drawn with drawBitmap(): mask in the caller's colour, hole in the theme bg.
+ */
+
+#ifndef ICON_ATLAS_H
+#define ICON_ATLAS_H
+
+#include <stdint.h>
+
+enum class AtlasIcon : uint8_t { Satellite, Gps, Cellular, Gear, Log };
+
+#define ICON_ATLAS_NO_HOLE 0xFFFF
+
+struct IconAtlasEntry {
+    AtlasIcon icon;
+    uint8_t size;            // size argument of the *Direct function
+    int8_t dx, dy;           // top-left of the bitmap from the icon's x, y
+    uint8_t w, h;
+    uint16_t mask;           // offsets into kIconAtlasBits
+    uint16_t hole;
+};
+
+static const uint8_t kIconAtlasBits[458] = {
+    0x08, 0x1c, 0x08, 0x18, 0xdb, 0x08, 0x1c, 0x08, 0x18, 0xdb, 0x00, 0x80, 0x01, 0xc0, 0x00, 0x80,
+    0x00, 0x80, 0x03, 0xc0, 0xf3, 0xcf, 0xf3, 0xcf, 0x03, 0xc0, 0x70, 0xd8, 0x88, 0xf8, 0xf8, 0xf8,
+    0xf8, 0x70, 0x70, 0x70, 0x20, 0x00, 0x20, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x70, 0xd8, 0x88, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0x70, 0x70, 0x70, 0x70, 0x20, 0x00, 0x20, 0x70,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x7f, 0x00, 0x63, 0x00,
+    0xc1, 0x80, 0xc1, 0x80, 0xc1, 0x80, 0xff, 0x80, 0xff, 0x80, 0x7f, 0x00, 0x3e, 0x00, 0x3e, 0x00,
+    0x1c, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x3e, 0x00, 0x3e, 0x00, 0x3e, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40,
+    0x02, 0x40, 0x12, 0x40, 0x92, 0x40, 0x92, 0x40, 0x00, 0x40, 0x02, 0x40, 0x12, 0x40, 0x92, 0x40,
+    0x92, 0x40, 0x00, 0x0c, 0x00, 0x0c, 0x00, 0xcc, 0x00, 0xcc, 0x0c, 0xcc, 0x0c, 0xcc, 0xcc, 0xcc,
+    0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0xcc, 0x1c, 0xe0, 0x3f, 0xf0, 0x3f, 0xf0, 0x3f, 0xf0, 0x1f, 0xe0,
+    0x7c, 0x6e, 0xf8, 0x3f, 0xf8, 0x3f, 0xf8, 0x3f, 0x7c, 0x6e, 0x0f, 0xf0, 0x1f, 0xf8, 0x1f, 0xf8,
+    0x1f, 0xf8, 0x0e, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x80,
+    0x07, 0xc0, 0x07, 0xc0, 0x07, 0xc0, 0x03, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x1c, 0xe0, 0x3f, 0xf0, 0x3f, 0xf0, 0x3f, 0xf0, 0x1f, 0xe0, 0x7c, 0x6e, 0xf8, 0x3f,
+    0xf8, 0x3f, 0xf8, 0x3f, 0x7c, 0x6e, 0x0f, 0xf0, 0x1f, 0xf8, 0x1f, 0xf8, 0x1f, 0xf8, 0x0e, 0x70,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x80, 0x07, 0xc0, 0x07, 0xc0,
+    0x07, 0xc0, 0x03, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x38,
+    0x00, 0x1f, 0x7c, 0x00, 0x1f, 0x7c, 0x00, 0x1f, 0xfc, 0x00, 0x0f, 0xf8, 0x00, 0x0f, 0xf8, 0x00,
+    0x7e, 0x3f, 0x80, 0xfc, 0x1f, 0xc0, 0xfc, 0x1f, 0xc0, 0xfc, 0x1f, 0xc0, 0x7e, 0x3f, 0x80, 0x0f,
+    0xf8, 0x00, 0x0f, 0xf8, 0x00, 0x1f, 0xfc, 0x00, 0x1f, 0x7c, 0x00, 0x1f, 0x7c, 0x00, 0x0e, 0x38,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x01, 0xc0, 0x00, 0x03, 0xe0, 0x00, 0x03, 0xe0, 0x00, 0x03, 0xe0, 0x00, 0x01,
+    0xc0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xff, 0xc0, 0x80, 0x40, 0xff, 0x40, 0x80, 0x40, 0xff, 0x40, 0x80, 0x40,
+    0xff, 0x40, 0x80, 0x40, 0x80, 0x40, 0xff, 0xc0, 0xff, 0xf0, 0x80, 0x10, 0xff, 0xd0, 0x80, 0x10,
+    0xff, 0xd0, 0x80, 0x10, 0xff, 0xd0, 0x80, 0x10, 0x80, 0x10, 0x80, 0x10, 0x80, 0x10, 0xff, 0xf0,
+    0xff, 0xf0, 0x80, 0x10, 0x80, 0x10, 0x80, 0x10, 0xbf, 0x10, 0x80, 0x10, 0x80, 0x10, 0x80, 0x10,
+    0xbf, 0x10, 0x80, 0x10, 0x80, 0x10, 0xff, 0xf0, 0x3f, 0x00,
+};
+
+static const IconAtlasEntry kIconAtlas[15] = {
+    {AtlasIcon::Satellite, 12, 2, 2, 8, 5, 0, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Satellite, 14, 3, 3, 8, 5, 5, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Satellite, 16, 0, 2, 16, 8, 10, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Gps, 12, 4, 1, 5, 11, 26, 37},
+    {AtlasIcon::Gps, 14, 5, 1, 5, 13, 48, 61},
+    {AtlasIcon::Gps, 16, 4, 2, 9, 13, 74, 100},
+    {AtlasIcon::Cellular, 12, 1, 6, 10, 5, 126, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Cellular, 14, 1, 8, 10, 5, 136, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Cellular, 16, 2, 4, 14, 10, 146, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Gear, 12, -1, -1, 16, 15, 166, 196},
+    {AtlasIcon::Gear, 14, 0, 0, 16, 15, 226, 256},
+    {AtlasIcon::Gear, 16, 0, 0, 18, 17, 286, 337},
+    {AtlasIcon::Log, 12, 1, 1, 10, 10, 388, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Log, 14, 1, 1, 12, 12, 408, ICON_ATLAS_NO_HOLE},
+    {AtlasIcon::Log, 16, 2, 2, 12, 13, 432, ICON_ATLAS_NO_HOLE},
+};
+
+#endif // ICON_ATLAS_H
@@ -1,6 +1,6 @@
 /*
  * Icon Management Header
- * Vector-style icons drawn with LGFX primitives
+ * Vector-style icons from a flash atlas, LGFX primitives as the fallback
  */
 
 #ifndef ICON_MANAGER_H
@@ -8,18 +8,16 @@
 
 #include <stdint.h>
 
-// Icon sprite initialization (draws icons into pre-allocated sprites)
+// Reports the flash atlas; nothing is allocated
 void initializeIcons();
 
-// Sprite cleanup functions
-void cleanupContentSprite();
-void cleanupStatusSprite();
-void cleanupIconSprites();
+// Memory alerts: hands the render strips back to the heap (ui_release_strips)
 void cleanupAllSprites();
 
 // ═══════════════════════════════════════════════════════════════════════════
-// Direct icon drawing functions (draw directly to display, no sprites needed)
-// Use these for inline icons in page headers or status displays
+// Direct icon drawing functions (draw to ui_gfx(), no sprites needed)
+// Sizes in the atlas are blitted from flash; others are drawn with primitives.
+// Keep the shapes in step with tools/gen_icon_atlas.py.
 // ═══════════════════════════════════════════════════════════════════════════
 
 // Draw satellite icon (GNSS) - satellite with solar panels
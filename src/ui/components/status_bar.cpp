@@ -0,0 +1,77 @@
+/*
+ * Status Bar Implementation
+ */
+
+#include "status_bar.h"
+#include "icon_manager.h"
+#include "ui_text.h"
+#include "ui_widgets.h"
+#include "../theme.h"
+#include "../ui_constants.h"
+#include "../ui_state.h"
+#include <time.h>
+
+namespace {
+constexpr int16_t kIcon = 12;
+constexpr int16_t kIconY = 1;
+constexpr int16_t kTextY = 3;
+constexpr int16_t kHeapX = 96;
+constexpr int16_t kGnssX = 150;
+constexpr int16_t kCellX = 186;
+constexpr int16_t kBarsX = kCellX + kIcon + 4;
+constexpr int16_t kBars = 5;
+
+void drawSignalBars(int16_t x, int bars, uint16_t color) {
+    const auto& th = ui::theme();
+    auto& d = ui_gfx();
+    for (int i = 0; i < kBars; i++) {
+        const int16_t h = 2 + i * 2;
+        d.fillRect(x + i * 4, kIconY + kIcon - h, 3, h, i < bars ? color : th.barBg);
+    }
+}
+} // namespace
+
+void drawStatusBar() {
+    const auto& th = ui::theme();
+    auto& d = ui_gfx();
+    const UiState& state = ui_state();
+    char buf[8];
+
+    d.setTextSize(1);
+    d.drawFastHLine(0, STATUS_BAR_H - 1, UI_DISPLAY_W, th.borderSubtle);
+
+    // ─── Clock (system time, set from the RTC) ───
+    struct tm lt {};
+    const time_t now = state.wallClock;
+    if (localtime_r(&now, &lt) && lt.tm_year + 1900 >= 2020) {
+        snprintf(buf, sizeof(buf), "%02d:%02d", lt.tm_hour, lt.tm_min);
+    } else {
+        strcpy(buf, "--:--");
+    }
+    ui_text_cells(COL1_X, kTextY, buf, th.textSecondary, th.bg);
+
+    // ─── Heap warning ───
+    ui_text_cells(kHeapX, kTextY, state.freeHeap < STATUS_BAR_HEAP_WARN_BYTES ? "MEM" : "", th.red, th.bg);
+
+    // ─── GNSS: fix colour and satellites in view ───
+    const GNSSData& gnss = state.gnss;
+    const uint16_t gnssColor = !state.catmReady ? th.textMuted
+                             : gnss.isValid     ? th.green
+                             : gnss.satellites  ? th.yellow
+                                                : th.red;
+    ui_track(kGnssX, kIconY, kIcon, kIcon, gnssColor);
+    drawIconSatelliteDirect(kGnssX, kIconY, kIcon, gnssColor);
+    snprintf(buf, sizeof(buf), "%2u", state.catmReady ? (unsigned)gnss.satellites : 0u);
+    ui_text_cells(kGnssX + kIcon + 2, kTextY, buf, gnssColor, th.bg);
+
+    // ─── Cellular: link colour and signal bars ───
+    const CellularSnapshot& cell = state.cell;
+    const uint16_t cellColor = !state.catmReady   ? th.textMuted
+                             : cell.isConnected   ? th.green
+                             : cell.isRegistered  ? th.yellow
+                                                  : th.red;
+    const int bars = state.catmReady ? constrain(map(cell.signalStrength, -120, -50, 0, kBars), 0, kBars) : 0;
+    ui_track(kCellX, kIconY, kBarsX + kBars * 4 - kCellX, kIcon, ((uint32_t)cellColor << 8) | (uint32_t)bars);
+    drawIconCellularDirect(kCellX, kIconY, kIcon, cellColor);
+    drawSignalBars(kBarsX, bars, cellColor);
+}
@@ -0,0 +1,26 @@
+/*
+ * Status Bar
+ * The top STATUS_BAR_H rows: clock, GNSS satellites, cellular signal and a
+ * low-heap flag. It is a region of the display compositor rather than a task of
+ * its own: full frames draw it with the page, and the display task refreshes it
+ * alone every STATUS_BAR_REFRESH_MS through the dirty-rect renderer, so only the
+ * cells that changed are pushed and nothing else draws to the panel meanwhile.
+ * Everything it shows comes from ui_state().
+ */
+
+#ifndef STATUS_BAR_H
+#define STATUS_BAR_H
+
+#include <stdint.h>
+
+#ifndef STATUS_BAR_REFRESH_MS
+#define STATUS_BAR_REFRESH_MS 5000         // the clock shows minutes
+#endif
+#ifndef STATUS_BAR_HEAP_WARN_BYTES
+#define STATUS_BAR_HEAP_WARN_BYTES (24 * 1024)
+#endif
+
+// Draws to ui_gfx(); a UiDrawFn
+void drawStatusBar();
+
+#endif // STATUS_BAR_H
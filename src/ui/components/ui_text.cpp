@@ -0,0 +1,152 @@
+/*
+ * UI Text Implementation
+ */
+
+#include "ui_text.h"
+#include "ui_widgets.h"
+
+namespace {
+constexpr size_t kSets = UI_GLYPH_CACHE / UI_GLYPH_WAYS;
+constexpr size_t kGlyphBytes = ((UI_GLYPH_MAX_W + 7) / 8) * UI_GLYPH_MAX_H;
+
+static_assert(UI_GLYPH_CACHE % UI_GLYPH_WAYS == 0, "UI_GLYPH_CACHE must be a multiple of UI_GLYPH_WAYS");
+
+struct Glyph {
+    const lgfx::IFont* font;     // null while the slot is free
+    uint32_t used;
+    uint8_t code;
+    uint8_t size;
+    uint8_t w;                   // advance
+    uint8_t h;                   // font height
+    uint8_t bits[kGlyphBytes];   // drawBitmap() layout, rows of (w + 7) / 8 bytes
+};
+
+Glyph s_glyphs[kSets][UI_GLYPH_WAYS];
+uint32_t s_tick = 0;
+UiTextStats s_stats = {};
+lgfx::LGFX_Sprite s_raster;      // 1-bit, aimed at one glyph slot at a time
+
+// 1-bit fonts only; a mask would lose the edges of anti-aliased ones
+bool cacheable(const lgfx::IFont* font) {
+    if (!font) return false;
+    switch (font->getType()) {
+        case lgfx::IFont::ft_glcd:
+        case lgfx::IFont::ft_bmp:
+        case lgfx::IFont::ft_rle:
+        case lgfx::IFont::ft_gfx:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool printable(const char* s) {
+    for (; *s; s++) {
+        if ((uint8_t)*s < 0x20 || (uint8_t)*s > 0x7E) return false;
+    }
+    return true;
+}
+
+// Cache key of the target's current font and size, or false when it can't be cached
+bool fontKey(lgfx::LovyanGFX& d, const lgfx::IFont*& font, uint8_t& size) {
+    font = d.getFont();
+    const float sx = d.getTextSizeX();
+    size = (uint8_t)sx;
+    return cacheable(font) && size > 0 && sx == (float)size && d.getTextSizeY() == sx;
+}
+
+const Glyph* glyph(lgfx::LovyanGFX& d, const lgfx::IFont* font, uint8_t size, char c) {
+    const uint8_t code = (uint8_t)c;
+    Glyph* set = s_glyphs[(code + size * 31u + ((uintptr_t)font >> 2)) % kSets];
+    Glyph* victim = &set[0];
+    for (size_t i = 0; i < UI_GLYPH_WAYS; i++) {
+        Glyph& g = set[i];
+        if (g.font == font && g.code == code && g.size == size) {
+            g.used = ++s_tick;
+            s_stats.hits++;
+            return &g;
+        }
+        if (g.used < victim->used) victim = &g;
+    }
+
+    const char str[2] = {c, '\0'};
+    const int32_t w = d.textWidth(str);
+    const int32_t h = d.fontHeight();
+    if (w <= 0 || w > UI_GLYPH_MAX_W || h <= 0 || h > UI_GLYPH_MAX_H) return nullptr;
+
+    Glyph& g = *victim;
+    g = Glyph{font, ++s_tick, code, size, (uint8_t)w, (uint8_t)h, {}};
+    s_raster.setBuffer(g.bits, w, h, lgfx::palette_1bit);
+    s_raster.setFont(font);
+    s_raster.setTextSize(size);
+    s_raster.fillScreen(0);
+    s_raster.setTextColor(1);
+    s_raster.setCursor(0, 0);
+    s_raster.print(str);
+    s_stats.misses++;
+    return &g;
+}
+
+int16_t fallback(lgfx::LovyanGFX& d, int16_t x, int16_t y, const char* s, uint16_t fg, uint16_t bg) {
+    s_stats.fallbacks++;
+    d.setTextColor(fg, bg);
+    d.setCursor(x, y);
+    d.print(s);
+    return d.textWidth(s);
+}
+} // namespace
+
+int16_t ui_text(int16_t x, int16_t y, const char* s, uint16_t fg, uint16_t bg) {
+    auto& d = ui_gfx();
+    if (!s) return 0;
+    const lgfx::IFont* font;
+    uint8_t size;
+    if (!fontKey(d, font, size) || !printable(s)) return fallback(d, x, y, s, fg, bg);
+
+    int32_t cx, cy, cw, ch;
+    d.getClipRect(&cx, &cy, &cw, &ch);
+    int16_t pen = x;
+    for (const char* p = s; *p; p++) {
+        const Glyph* g = glyph(d, font, size, *p);
+        if (!g) return (int16_t)(pen - x + fallback(d, pen, y, p, fg, bg));
+        if (cw > 0 && ch > 0 && pen < cx + cw && pen + g->w > cx && y < cy + ch && y + g->h > cy) {
+            d.drawBitmap(pen, y, g->bits, g->w, g->h, fg, bg);
+        } else {
+            s_stats.clipped++;
+        }
+        pen += g->w;
+    }
+    d.setCursor(pen, y);   // where print() would leave it
+    return (int16_t)(pen - x);
+}
+
+int16_t ui_text_width(const char* s) {
+    auto& d = ui_gfx();
+    if (!s) return 0;
+    const lgfx::IFont* font;
+    uint8_t size;
+    if (!fontKey(d, font, size) || !printable(s)) return d.textWidth(s);
+    int16_t w = 0;
+    for (const char* p = s; *p; p++) {
+        const Glyph* g = glyph(d, font, size, *p);
+        if (!g) return (int16_t)(w + d.textWidth(p));
+        w += g->w;
+    }
+    return w;
+}
+
+int16_t ui_text_cells(int16_t x, int16_t y, const char* s, uint16_t fg, uint16_t bg) {
+    auto& d = ui_gfx();
+    ui_track_cells(x, y, ui_text_width("0"), d.fontHeight(), s, fg);
+    return ui_text(x, y, s, fg, bg);
+}
+
+void ui_text_stats(UiTextStats& out) { out = s_stats; }
+
+void ui_text_report(Print& out) {
+    const UiTextStats s = s_stats;
+    const uint32_t lookups = s.hits + s.misses;
+    out.printf("UI text: %lu glyph lookups, %.1f%% cached, %lu rasterized, %lu clipped, %lu print fallbacks\n",
+               (unsigned long)lookups, lookups ? 100.0 * s.hits / lookups : 0.0, (unsigned long)s.misses,
+               (unsigned long)s.clipped, (unsigned long)s.fallbacks);
+}
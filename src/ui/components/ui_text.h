@@ -0,0 +1,47 @@
+/*
+ * UI Text
+ * Cached glyphs and label metrics for the bitmap fonts the pages draw with.
+ *   - a glyph is rasterized once per (font, size, character) into a 1-bit mask
+ *     in a small set-associative LRU; drawing a label is then one drawBitmap()
+ *     per glyph instead of the font renderer's run-by-run fills, and glyphs
+ *     outside the clip (the measure pass, other strips) cost nothing
+ *   - widths are sums of cached advances, so measuring a label rasterizes nothing
+ *   - ui_text_cells() tracks a value per character cell (ui_track_cells), so a
+ *     column-aligned number repaints only the digits that changed
+ *
+ * Text uses the target's current font and text size and is drawn opaque.
+ * Anti-aliased fonts (VLW loaded from SD), glyphs larger than the cache slots
+ * and non-ASCII text go through print() unchanged.
+ */
+
+#ifndef UI_TEXT_H
+#define UI_TEXT_H
+
+#include <M5GFX.h>
+#include <stdint.h>
+
+#ifndef UI_GLYPH_CACHE
+#define UI_GLYPH_CACHE 64                  // glyphs kept, UI_GLYPH_WAYS per set
+#endif
+#define UI_GLYPH_WAYS 4
+#define UI_GLYPH_MAX_W 16                  // font 0 at size 2 is 12 x 16
+#define UI_GLYPH_MAX_H 16
+
+struct UiTextStats {
+    uint32_t hits;
+    uint32_t misses;                       // glyphs rasterized
+    uint32_t fallbacks;                    // labels drawn with print()
+    uint32_t clipped;                      // glyphs skipped outside the clip
+};
+
+// Draws s with its top-left at x, y; returns its width
+int16_t ui_text(int16_t x, int16_t y, const char* s, uint16_t fg, uint16_t bg);
+// Width of s in the target's current font and size
+int16_t ui_text_width(const char* s);
+// ui_text() with each character tracked as its own cell (monospaced fonts)
+int16_t ui_text_cells(int16_t x, int16_t y, const char* s, uint16_t fg, uint16_t bg);
+
+void ui_text_stats(UiTextStats& out);
+void ui_text_report(Print& out);
+
+#endif // UI_TEXT_H
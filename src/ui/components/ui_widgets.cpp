@@ -6,8 +6,12 @@
 #include "ui_widgets.h"
 #include "../ui_constants.h"
 #include "../ui_types.h"
+#include "../ui_perf.h"
 #include "../../modules/storage/sd_card_module.h"
+#include "../../modules/logging/log_buffer.h"
 #include <WiFi.h>
+#include <atomic>
+#include <esp_heap_caps.h>
 
 // External globals accessed by widgets
 extern SDCardModule* sdModule;
@@ -17,36 +21,39 @@ extern volatile DisplayPage currentPage;
 
 void drawSignalBar(int16_t x, int16_t y, int16_t w, int16_t h, int8_t signalDbm) {
     const auto& th = ui::theme();
+    auto& d = ui_gfx();
     
     // Draw signal strength bar (dBm to percentage)
     int16_t signalPercent = map(signalDbm, -120, -50, 0, 100);
     signalPercent = constrain(signalPercent, 0, 100);
+    ui_track(x, y, w + 5 + 42, max(h, (int16_t)8), (uint8_t)signalDbm);
     
     // Background with theme colors
-    M5StamPLC.Display.fillRect(x, y, w, h, th.card);
-    M5StamPLC.Display.drawRect(x, y, w, h, th.border);
+    d.fillRect(x, y, w, h, th.card);
+    d.drawRect(x, y, w, h, th.border);
     
     // Signal level with theme colors
     uint16_t signalColor = (signalPercent > 70) ? th.green : 
                           (signalPercent > 40) ? th.yellow : th.red;
     int16_t fillWidth = (w - 2) * signalPercent / 100;
     if (fillWidth > 0) {
-        M5StamPLC.Display.fillRect(x + 1, y + 1, fillWidth, h - 2, signalColor);
+        d.fillRect(x + 1, y + 1, fillWidth, h - 2, signalColor);
     }
     
     // Text label with theme colors
-    M5StamPLC.Display.setTextSize(1);
-    M5StamPLC.Display.setTextColor(th.text, th.bg);
-    M5StamPLC.Display.setCursor(x + w + 5, y);
-    M5StamPLC.Display.printf("%ddBm", signalDbm);
+    d.setTextSize(1);
+    d.setTextColor(th.text, th.bg);
+    d.setCursor(x + w + 5, y);
+    d.printf("%ddBm", signalDbm);
 }
 
 void drawWiFiBar(int16_t x, int16_t y, int16_t w, int16_t h) {
     const auto& th = ui::theme();
+    auto& d = ui_gfx();
     
     // Background with theme colors
-    M5StamPLC.Display.fillRect(x, y, w, h, th.card);
-    M5StamPLC.Display.drawRect(x, y, w, h, th.border);
+    d.fillRect(x, y, w, h, th.card);
+    d.drawRect(x, y, w, h, th.border);
 
     wifi_mode_t mode = WIFI_MODE_NULL;
     // Guard against older cores without getMode signature
@@ -58,6 +65,12 @@ void drawWiFiBar(int16_t x, int16_t y, int16_t w, int16_t h) {
 
     bool isSta = (mode & WIFI_MODE_STA) != 0;
     bool isAp  = (mode & WIFI_MODE_AP) != 0;
+    uint32_t shown = (uint32_t)mode << 24;
+    if (isSta && WiFi.status() == WL_CONNECTED) shown |= 0x100u | (uint8_t)WiFi.RSSI();
+    #ifdef ARDUINO_ARCH_ESP32
+    else if (isAp) shown |= WiFi.softAPgetStationNum();
+    #endif
+    ui_track(x, y, w + 5 + 60, max(h, (int16_t)8), shown);
 
     if (isSta && WiFi.status() == WL_CONNECTED) {
         int8_t wifiRSSI = WiFi.RSSI();
@@ -66,83 +79,505 @@ void drawWiFiBar(int16_t x, int16_t y, int16_t w, int16_t h) {
         uint16_t wifiColor = (wifiPercent > 70) ? th.green : (wifiPercent > 40) ? th.yellow : th.red;
         int16_t fillWidth = (w - 2) * wifiPercent / 100;
         if (fillWidth > 0) {
-            M5StamPLC.Display.fillRect(x + 1, y + 1, fillWidth, h - 2, wifiColor);
+            d.fillRect(x + 1, y + 1, fillWidth, h - 2, wifiColor);
         }
-        M5StamPLC.Display.setTextSize(1);
-        M5StamPLC.Display.setTextColor(th.text, th.bg);
-        M5StamPLC.Display.setCursor(x + w + 5, y);
-        M5StamPLC.Display.printf("STA:%ddBm", wifiRSSI);
+        d.setTextSize(1);
+        d.setTextColor(th.text, th.bg);
+        d.setCursor(x + w + 5, y);
+        d.printf("STA:%ddBm", wifiRSSI);
         return;
     }
 
     if (isAp) {
         // Show AP active; client count if available
         uint16_t color = th.yellow;
-        M5StamPLC.Display.fillRect(x + 1, y + 1, w - 2, h - 2, color);
-        M5StamPLC.Display.setTextSize(1);
-        M5StamPLC.Display.setTextColor(th.text, th.bg);
-        M5StamPLC.Display.setCursor(x + w + 5, y);
+        d.fillRect(x + 1, y + 1, w - 2, h - 2, color);
+        d.setTextSize(1);
+        d.setTextColor(th.text, th.bg);
+        d.setCursor(x + w + 5, y);
         // softAPgetStationNum may not exist on all cores; guard with weak behavior
         #ifdef ARDUINO_ARCH_ESP32
-        M5StamPLC.Display.printf("AP:%d", WiFi.softAPgetStationNum());
+        d.printf("AP:%d", WiFi.softAPgetStationNum());
         #else
-        M5StamPLC.Display.print("AP:ON");
+        d.print("AP:ON");
         #endif
         return;
     }
 
     // No WiFi with theme colors
-    M5StamPLC.Display.setTextSize(1);
-    M5StamPLC.Display.setTextColor(th.red, th.bg);
-    M5StamPLC.Display.setCursor(x + w + 5, y);
-    M5StamPLC.Display.print("WiFi:OFF");
+    d.setTextSize(1);
+    d.setTextColor(th.red, th.bg);
+    d.setCursor(x + w + 5, y);
+    d.print("WiFi:OFF");
 }
 
 void drawSDInfo(int x, int y) {
     const auto& th = ui::theme();
     if (!sdModule || !sdModule->isMounted()) return;
-    M5StamPLC.Display.setTextSize(1);
-    M5StamPLC.Display.setTextColor(th.accent, th.bg);
-    M5StamPLC.Display.setCursor(x, y);
+    auto& d = ui_gfx();
+    d.setTextSize(1);
+    d.setTextColor(th.accent, th.bg);
+    d.setCursor(x, y);
     uint64_t total = sdModule->totalBytes();
     uint64_t used = sdModule->usedBytes();
-    M5StamPLC.Display.printf("SD Total: %.1f MB", total ? (double)total / (1024.0 * 1024.0) : 0.0);
-    M5StamPLC.Display.setCursor(x, y + 20);
-    M5StamPLC.Display.printf("SD Used:  %.1f MB", used ? (double)used / (1024.0 * 1024.0) : 0.0);
+    ui_track(x, y, 120, 28, (uint32_t)(total >> 16) ^ ((uint32_t)(used >> 16) * 16777619u));
+    d.printf("SD Total: %.1f MB", total ? (double)total / (1024.0 * 1024.0) : 0.0);
+    d.setCursor(x, y + 20);
+    d.printf("SD Used:  %.1f MB", used ? (double)used / (1024.0 * 1024.0) : 0.0);
 }
 
 void drawButtonIndicators() {
     const auto& th = ui::theme();
-    M5StamPLC.Display.setTextSize(1);
-    M5StamPLC.Display.setTextColor(th.text, th.bg);
+    auto& d = ui_gfx();
+    d.setTextSize(1);
+    d.setTextColor(th.text, th.bg);
 
     bool onLanding = (currentPage == DisplayPage::LANDING_PAGE);
     if (onLanding) {
-        M5StamPLC.Display.setCursor(10, BUTTON_BAR_Y + 2);
-        M5StamPLC.Display.print("A: CELL");
-        M5StamPLC.Display.setCursor(95, BUTTON_BAR_Y + 2);
-        M5StamPLC.Display.print("B: GPS");
-        M5StamPLC.Display.setCursor(165, BUTTON_BAR_Y + 2);
-        M5StamPLC.Display.print("C: SYSTEM");
+        d.setCursor(10, BUTTON_BAR_Y + 2);
+        d.print("A: CELL");
+        d.setCursor(95, BUTTON_BAR_Y + 2);
+        d.print("B: GPS");
+        d.setCursor(165, BUTTON_BAR_Y + 2);
+        d.print("C: SYSTEM");
         return;
     }
 
     // Special handling for settings page
     if (currentPage == DisplayPage::SETTINGS_PAGE) {
-        M5StamPLC.Display.setCursor(10, BUTTON_BAR_Y + 2);
-        M5StamPLC.Display.print("A: HOME");
-        M5StamPLC.Display.setCursor(100, BUTTON_BAR_Y + 2);
-        M5StamPLC.Display.print("B: UP");
-        M5StamPLC.Display.setCursor(180, BUTTON_BAR_Y + 2);
-        M5StamPLC.Display.print("C: DOWN");
+        d.setCursor(10, BUTTON_BAR_Y + 2);
+        d.print("A: HOME");
+        d.setCursor(100, BUTTON_BAR_Y + 2);
+        d.print("B: UP");
+        d.setCursor(180, BUTTON_BAR_Y + 2);
+        d.print("C: DOWN");
         return;
     }
 
     // Global controls: A=HOME, B=PREV, C=NEXT
-    M5StamPLC.Display.setCursor(10, BUTTON_BAR_Y + 2);
-    M5StamPLC.Display.print("A: HOME");
-    M5StamPLC.Display.setCursor(100, BUTTON_BAR_Y + 2);
-    M5StamPLC.Display.print("B: PREV");
-    M5StamPLC.Display.setCursor(185, BUTTON_BAR_Y + 2);
-    M5StamPLC.Display.print("C: NEXT");
+    d.setCursor(10, BUTTON_BAR_Y + 2);
+    d.print("A: HOME");
+    d.setCursor(100, BUTTON_BAR_Y + 2);
+    d.print("B: PREV");
+    d.setCursor(185, BUTTON_BAR_Y + 2);
+    d.print("C: NEXT");
+}
+
+// ---------------------------------------------------------------------------
+// Incremental rendering
+// ---------------------------------------------------------------------------
+
+namespace {
+enum class TrackMode : uint8_t { Off, Record, Measure, Paint };
+
+struct Rect {
+    int16_t x, y, w, h;
+};
+
+struct Field {
+    Rect r;
+    uint32_t value;
+};
+
+// Text tracked per character; a zero char is an empty cell
+struct CellField {
+    int16_t x, y, cellW, h;
+    uint16_t color;
+    char text[UI_TRACK_CELL_CHARS];
+};
+
+TrackMode s_mode = TrackMode::Off;
+Field s_fields[UI_TRACK_SLOTS];
+uint8_t s_fieldCount = 0;
+CellField s_cells[UI_TRACK_CELL_FIELDS];
+uint8_t s_cellCount = 0;
+Rect s_dirty[UI_DIRTY_RECTS];
+uint8_t s_dirtyCount = 0;
+Rect s_paint = {0, 0, 0, 0};
+UiRenderStats s_stats = {};
+uint32_t s_pushUs = 0;           // this frame's wait on the panel push
+lgfx::LovyanGFX* s_target = &M5StamPLC.Display;
+#if UI_DMA_STRIPS_ENABLE
+lgfx::LGFX_Sprite s_strip(&M5StamPLC.Display);
+uint16_t* s_stripBuf[2] = {nullptr, nullptr};   // the same buffer twice with UI_STRIP_BUFFERS 1
+uint16_t s_stripRows = UI_STRIP_ROWS;
+bool s_stripsFailed = false;
+std::atomic<bool> s_stripRelease{false};
+#endif
+
+int32_t area(const Rect& r) { return (int32_t)r.w * r.h; }
+
+Rect unite(const Rect& a, const Rect& b) {
+    const int16_t x0 = min(a.x, b.x);
+    const int16_t y0 = min(a.y, b.y);
+    const int16_t x1 = max((int16_t)(a.x + a.w), (int16_t)(b.x + b.w));
+    const int16_t y1 = max((int16_t)(a.y + a.h), (int16_t)(b.y + b.h));
+    return Rect{x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0)};
+}
+
+bool contains(const Rect& outer, const Rect& in) {
+    return in.x >= outer.x && in.y >= outer.y && in.x + in.w <= outer.x + outer.w &&
+           in.y + in.h <= outer.y + outer.h;
+}
+
+// Extra pixels pushed when a and b go out as one rectangle
+int32_t mergeCost(const Rect& a, const Rect& b) { return area(unite(a, b)) - area(a) - area(b); }
+
+bool clampToScreen(Rect& r) {
+    const int16_t x1 = min((int16_t)(r.x + r.w), (int16_t)UI_DISPLAY_W);
+    const int16_t y1 = min((int16_t)(r.y + r.h), (int16_t)UI_DISPLAY_H);
+    r.x = max(r.x, (int16_t)0);
+    r.y = max(r.y, (int16_t)0);
+    r.w = x1 - r.x;
+    r.h = y1 - r.y;
+    return r.w > 0 && r.h > 0;
+}
+
+void addDirty(Rect r) {
+    if (!clampToScreen(r)) return;
+    for (uint8_t i = 0; i < s_dirtyCount; i++) {
+        if (mergeCost(s_dirty[i], r) <= UI_DIRTY_MERGE_SLACK_PX) {
+            s_dirty[i] = unite(s_dirty[i], r);
+            return;
+        }
+    }
+    if (s_dirtyCount < UI_DIRTY_RECTS) {
+        s_dirty[s_dirtyCount++] = r;
+        return;
+    }
+    uint8_t best = 0;
+    for (uint8_t i = 1; i < s_dirtyCount; i++) {
+        if (mergeCost(s_dirty[i], r) < mergeCost(s_dirty[best], r)) best = i;
+    }
+    s_dirty[best] = unite(s_dirty[best], r);
+}
+
+// A union can grow into a neighbour; fold until no pair is worth merging
+void mergeDirty() {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (uint8_t i = 0; i < s_dirtyCount && !merged; i++) {
+            for (uint8_t j = i + 1; j < s_dirtyCount; j++) {
+                if (mergeCost(s_dirty[i], s_dirty[j]) > UI_DIRTY_MERGE_SLACK_PX) continue;
+                s_dirty[i] = unite(s_dirty[i], s_dirty[j]);
+                s_dirty[j] = s_dirty[--s_dirtyCount];
+                merged = true;
+                break;
+            }
+        }
+    }
+}
+
+Field* findField(int16_t x, int16_t y) {
+    for (uint8_t i = 0; i < s_fieldCount; i++) {
+        if (s_fields[i].r.x == x && s_fields[i].r.y == y) return &s_fields[i];
+    }
+    return nullptr;
+}
+
+CellField* findCells(int16_t x, int16_t y) {
+    for (uint8_t i = 0; i < s_cellCount; i++) {
+        if (s_cells[i].x == x && s_cells[i].y == y) return &s_cells[i];
+    }
+    return nullptr;
+}
+
+Rect cellRect(const CellField& f, int i) { return Rect{(int16_t)(f.x + i * f.cellW), f.y, f.cellW, f.h}; }
+} // namespace
+
+uint32_t ui_hash(const char* s, uint32_t seed) {
+    uint32_t h = seed;
+    while (s && *s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+bool ui_track(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t value) {
+    const Rect r{x, y, w, h};
+    switch (s_mode) {
+        case TrackMode::Record: {
+            Field* f = findField(x, y);
+            if (!f) {
+                if (s_fieldCount >= UI_TRACK_SLOTS) {
+                    s_stats.untracked++;
+                    return false;
+                }
+                f = &s_fields[s_fieldCount++];
+            }
+            *f = Field{r, value};
+            return false;
+        }
+        case TrackMode::Measure: {
+            Field* f = findField(x, y);
+            if (!f) return false;   // appeared since the full frame; it waits for the next one
+            if (f->value == value && f->r.w == w && f->r.h == h) return false;
+            // Cover the old extent too so a shorter value clears the longer one
+            addDirty(unite(f->r, r));
+            *f = Field{unite(f->r, r), value};
+            return true;
+        }
+        case TrackMode::Paint: {
+            // The value may have moved on since the measure pass; remember what was painted
+            Field* f = findField(x, y);
+            if (f && contains(s_paint, f->r)) {
+                f->value = value;
+                f->r = r;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+bool ui_track_cells(int16_t x, int16_t y, int16_t cellW, int16_t h, const char* text, uint16_t color) {
+    const size_t len = text ? strlen(text) : 0;
+    if (len > UI_TRACK_CELL_CHARS || cellW <= 0) {
+        return ui_track(x, y, (int16_t)(len * cellW), h, ui_hash(text, color));
+    }
+    char cells[UI_TRACK_CELL_CHARS] = {};
+    memcpy(cells, text, len);
+
+    switch (s_mode) {
+        case TrackMode::Record: {
+            CellField* f = findCells(x, y);
+            if (!f) {
+                if (s_cellCount >= UI_TRACK_CELL_FIELDS) {
+                    return ui_track(x, y, (int16_t)(len * cellW), h, ui_hash(text, color));
+                }
+                f = &s_cells[s_cellCount++];
+            }
+            *f = CellField{x, y, cellW, h, color, {}};
+            memcpy(f->text, cells, sizeof(cells));
+            return false;
+        }
+        case TrackMode::Measure: {
+            CellField* f = findCells(x, y);
+            if (!f) return ui_track(x, y, (int16_t)(len * cellW), h, ui_hash(text, color));
+            int first = -1, last = -1;
+            for (int i = 0; i < UI_TRACK_CELL_CHARS; i++) {
+                if (f->text[i] == cells[i] && (f->color == color || !cells[i])) continue;
+                if (first < 0) first = i;
+                last = i;
+            }
+            if (first < 0) return false;
+            addDirty(unite(cellRect(*f, first), cellRect(*f, last)));
+            return true;
+        }
+        case TrackMode::Paint: {
+            CellField* f = findCells(x, y);
+            if (!f) return ui_track(x, y, (int16_t)(len * cellW), h, ui_hash(text, color));
+            bool all = true;
+            for (int i = 0; i < UI_TRACK_CELL_CHARS; i++) {
+                if (contains(s_paint, cellRect(*f, i))) f->text[i] = cells[i];
+                else if (f->text[i] != cells[i] || cells[i]) all = false;
+            }
+            if (all) f->color = color;
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+bool ui_track_text(int16_t x, int16_t y, const char* text, uint16_t color) {
+    auto& d = ui_gfx();
+    return ui_track(x, y, d.textWidth(text), d.fontHeight(), ui_hash(text, color));
+}
+
+lgfx::LovyanGFX& ui_gfx() { return *s_target; }
+
+namespace {
+#if UI_DMA_STRIPS_ENABLE
+static_assert(UI_STRIP_BUFFERS == 1 || UI_STRIP_BUFFERS == 2, "UI_STRIP_BUFFERS is 1 or 2");
+
+void freeStrips() {
+    M5StamPLC.Display.waitDMA();   // a strip may still be going out
+    if (s_stripBuf[1] != s_stripBuf[0]) heap_caps_free(s_stripBuf[1]);
+    heap_caps_free(s_stripBuf[0]);
+    s_stripBuf[0] = s_stripBuf[1] = nullptr;
+}
+
+bool stripsReady() {
+    if (s_stripRelease.exchange(false, std::memory_order_acquire) && s_stripBuf[0]) {
+        freeStrips();
+        if (s_stripRows / 2 >= UI_STRIP_MIN_ROWS) s_stripRows /= 2;
+        s_stats.stripReleases++;
+    }
+    if (s_stripBuf[0]) return true;
+    if (s_stripsFailed) return false;
+    // Smaller strips before no strips: each halving costs a push per strip, not a flicker
+    for (uint16_t rows = s_stripRows; rows >= UI_STRIP_MIN_ROWS; rows /= 2) {
+        const size_t bytes = (size_t)UI_DISPLAY_W * rows * sizeof(uint16_t);
+        bool ok = true;
+        for (int i = 0; i < UI_STRIP_BUFFERS && ok; i++) {
+            s_stripBuf[i] = static_cast<uint16_t*>(heap_caps_malloc(bytes, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL));
+            ok = s_stripBuf[i] != nullptr;
+        }
+        if (ok) {
+            if (UI_STRIP_BUFFERS == 1) s_stripBuf[1] = s_stripBuf[0];
+            if (rows != UI_STRIP_ROWS) {
+                logbuf_printf("UI: strips cut to %u rows (%u bytes each)", (unsigned)rows, (unsigned)bytes);
+            }
+            s_stripRows = rows;
+            s_stats.stripRows = rows;
+            return true;
+        }
+        heap_caps_free(s_stripBuf[0]);
+        s_stripBuf[0] = s_stripBuf[1] = nullptr;
+    }
+    s_stripsFailed = true;
+    s_stats.direct = true;
+    s_stats.stripRows = 0;
+    logbuf_printf("UI: no DMA memory for %u row strips, drawing direct", (unsigned)UI_STRIP_MIN_ROWS);
+    return false;
+}
+
+// Points the strip sprite at buf as if it were the whole screen with row y0 at
+// buf[0]. Only rows y0..y0+rows-1 are inside the clip, so nothing is written
+// outside the buffer.
+void aimStrip(uint16_t* buf, int16_t y0) {
+    s_strip.setBuffer(buf - (int32_t)y0 * UI_DISPLAY_W, UI_DISPLAY_W, UI_DISPLAY_H, lgfx::rgb565_2Byte);
+}
+
+// Draws r strip by strip. The panel's clip keeps the push to r's columns; the
+// push returns once the previous strip has gone out, so the other buffer is free.
+void paintStrips(const Rect& r, uint16_t bg, UiDrawFn draw) {
+    auto& d = M5StamPLC.Display;
+    for (int16_t y0 = r.y; y0 < r.y + r.h; y0 += s_stripRows) {
+        const int16_t rows = min((int16_t)s_stripRows, (int16_t)(r.y + r.h - y0));
+        uint16_t* buf = s_stripBuf[s_stats.strips & 1];
+        if (UI_STRIP_BUFFERS == 1) d.waitDMA();   // the only strip is the one going out
+        aimStrip(buf, y0);
+        s_strip.setClipRect(r.x, y0, r.w, rows);
+        s_strip.fillRect(r.x, y0, r.w, rows, bg);
+        draw();
+        d.setClipRect(r.x, y0, r.w, rows);
+        const uint32_t t = micros();   // returns once the previous strip is out
+        d.pushImageDMA(0, y0, UI_DISPLAY_W, rows, reinterpret_cast<const lgfx::swap565_t*>(buf));
+        s_pushUs += micros() - t;
+        s_stats.strips++;
+    }
+    d.clearClipRect();
+}
+#endif
+
+// Runs the page with its output clipped away so it only reports its values
+void measure(UiDrawFn draw) {
+#if UI_DMA_STRIPS_ENABLE
+    if (stripsReady()) {
+        aimStrip(s_stripBuf[0], 0);
+        s_strip.setClipRect(0, 0, 0, 0);
+        s_target = &s_strip;
+        draw();
+        s_target = &M5StamPLC.Display;
+        return;
+    }
+#endif
+    auto& d = M5StamPLC.Display;
+    d.setClipRect(0, 0, 0, 0);
+    draw();
+    d.clearClipRect();
+}
+
+void paint(const Rect& r, uint16_t bg, UiDrawFn draw) {
+#if UI_DMA_STRIPS_ENABLE
+    if (stripsReady()) {
+        s_target = &s_strip;
+        paintStrips(r, bg, draw);
+        s_target = &M5StamPLC.Display;
+        return;
+    }
+#endif
+    auto& d = M5StamPLC.Display;
+    d.setClipRect(r.x, r.y, r.w, r.h);
+    d.fillRect(r.x, r.y, r.w, r.h, bg);
+    draw();
+    d.clearClipRect();
+}
+} // namespace
+
+void ui_render_full(UiDrawFn draw, uint16_t bg) {
+    auto& d = M5StamPLC.Display;
+    const uint32_t start = micros();
+    s_fieldCount = 0;
+    s_cellCount = 0;
+    s_pushUs = 0;
+    s_mode = TrackMode::Record;
+    d.startWrite();
+    paint(Rect{0, 0, UI_DISPLAY_W, UI_DISPLAY_H}, bg, draw);
+    const uint32_t t = micros();
+    d.waitDMA();
+    s_pushUs += micros() - t;
+    d.endWrite();
+    s_mode = TrackMode::Off;
+    s_stats.fullFrames++;
+    s_stats.fullUs = micros() - start;
+    ui_perf_frame(s_stats.fullUs - s_pushUs, s_pushUs, (uint32_t)UI_DISPLAY_W * UI_DISPLAY_H * sizeof(uint16_t));
+}
+
+uint32_t ui_render_refresh(UiDrawFn draw, uint16_t bg) {
+    auto& d = M5StamPLC.Display;
+    const uint32_t start = micros();
+    s_dirtyCount = 0;
+    s_pushUs = 0;
+
+    s_mode = TrackMode::Measure;
+    measure(draw);
+    mergeDirty();
+
+    uint32_t pixels = 0;
+    s_mode = TrackMode::Paint;
+    if (s_dirtyCount) d.startWrite();
+    for (uint8_t i = 0; i < s_dirtyCount; i++) {
+        s_paint = s_dirty[i];
+        paint(s_paint, bg, draw);
+        pixels += area(s_paint);
+    }
+    if (s_dirtyCount) {
+        const uint32_t t = micros();
+        d.waitDMA();
+        s_pushUs += micros() - t;
+        d.endWrite();
+    }
+    s_mode = TrackMode::Off;
+
+    s_stats.refreshFrames++;
+    if (!s_dirtyCount) s_stats.idleRefreshes++;
+    s_stats.rects += s_dirtyCount;
+    s_stats.pixels += pixels;
+    s_stats.refreshUs = micros() - start;
+    if (s_stats.refreshUs > s_stats.maxRefreshUs) s_stats.maxRefreshUs = s_stats.refreshUs;
+    if (s_dirtyCount) ui_perf_frame(s_stats.refreshUs - s_pushUs, s_pushUs, pixels * sizeof(uint16_t));
+    else ui_perf_idle();
+    return pixels;
+}
+
+void ui_release_strips() {
+#if UI_DMA_STRIPS_ENABLE
+    s_stripRelease.store(true, std::memory_order_release);
+#endif
+}
+
+void ui_render_stats(UiRenderStats& out) { out = s_stats; }
+
+void ui_render_report(Print& out) {
+    const UiRenderStats s = s_stats;
+    const uint32_t pushed = s.refreshFrames - s.idleRefreshes;
+    out.printf("UI render: %lu full (last %lu us), %lu refresh (%lu idle, last %lu us, max %lu us)\n",
+               (unsigned long)s.fullFrames, (unsigned long)s.fullUs, (unsigned long)s.refreshFrames,
+               (unsigned long)s.idleRefreshes, (unsigned long)s.refreshUs, (unsigned long)s.maxRefreshUs);
+    if (pushed) {
+        out.printf("  per refresh: %.1f rects, %lu px of %lu\n", (double)s.rects / pushed,
+                   (unsigned long)(s.pixels / pushed), (unsigned long)(UI_DISPLAY_W * UI_DISPLAY_H));
+    }
+    if (s.untracked) out.printf("  %lu values over UI_TRACK_SLOTS\n", (unsigned long)s.untracked);
+#if UI_DMA_STRIPS_ENABLE
+    if (s.direct) out.println("  strips: not allocated, drawing direct");
+    else out.printf("  strips: %lu pushed, %u x %u rows, %u released\n", (unsigned long)s.strips,
+                    (unsigned)UI_STRIP_BUFFERS, (unsigned)s.stripRows, (unsigned)s.stripReleases);
+#endif
 }
@@ -9,6 +9,7 @@
 #include <M5StamPLC.h>  // Includes M5GFX automatically
 #include <M5GFX.h>      // For lgfx::LGFX_Sprite
 #include <stdint.h>
+#include "../../config/system_config.h"
 
 // Signal strength bar (full display)
 void drawSignalBar(int16_t x, int16_t y, int16_t w, int16_t h, int8_t signalDbm);
@@ -22,5 +23,94 @@ void drawSDInfo(int x, int y);
 // Button indicators
 void drawButtonIndicators();
 
+// ---------------------------------------------------------------------------
+// Incremental rendering
+// Live values register their bounds and a hash of what they show with
+// ui_track() while a page draws. A full frame clears the screen and records
+// them. A refresh frame runs the page once with all drawing clipped away to
+// find the values that changed, merges their rectangles and runs the page again
+// clipped to each merged rectangle, so only those pixels go out over SPI.
+// Untracked content changes only on a full frame.
+//
+// With UI_DMA_STRIPS_ENABLE each rectangle is drawn UI_STRIP_ROWS rows at a
+// time into one of two DMA-capable strips. A strip is queued to the panel and
+// the next one is drawn while it streams out, so a frame costs about
+// max(draw, transfer) instead of their sum. The page runs once per strip, its
+// drawing clipped to the strip's rows. When the heap can't hold the strips the
+// rows are halved down to UI_STRIP_MIN_ROWS before the page falls back to
+// drawing straight to the panel; UI_STRIP_BUFFERS 1 keeps a single strip and
+// waits for each transfer before drawing the next.
+// ---------------------------------------------------------------------------
+#ifndef UI_TRACK_SLOTS
+#define UI_TRACK_SLOTS 40                  // tracked values per page
+#endif
+#ifndef UI_TRACK_CELL_FIELDS
+#define UI_TRACK_CELL_FIELDS 16            // per-character values per page
+#endif
+#ifndef UI_TRACK_CELL_CHARS
+#define UI_TRACK_CELL_CHARS 24             // longer text is tracked as one value
+#endif
+#ifndef UI_DIRTY_RECTS
+#define UI_DIRTY_RECTS 6                   // more are folded into the nearest
+#endif
+#ifndef UI_DIRTY_MERGE_SLACK_PX
+#define UI_DIRTY_MERGE_SLACK_PX 256        // merge when the union costs at most this much extra
+#endif
+#ifndef UI_REFRESH_MS
+#define UI_REFRESH_MS 1000                 // poll for pages showing time-driven values
+#endif
+#ifndef UI_STRIP_ROWS
+#define UI_STRIP_ROWS 16                   // 240 x 16 RGB565 = 7.5 KB per strip, two strips
+#endif
+#ifndef UI_STRIP_MIN_ROWS
+#define UI_STRIP_MIN_ROWS 4                // smallest strip worth the per-push overhead
+#endif
+#ifndef UI_STRIP_BUFFERS
+#define UI_STRIP_BUFFERS 2                 // 1 halves the RAM; drawing then waits on the transfer
+#endif
+
+typedef void (*UiDrawFn)();
+
+// Where pages and widgets draw: the panel, or the strip being rendered
+lgfx::LovyanGFX& ui_gfx();
+
+struct UiRenderStats {
+    uint32_t fullFrames;
+    uint32_t refreshFrames;
+    uint32_t idleRefreshes;      // refreshes where nothing had changed
+    uint32_t rects;              // merged rectangles pushed by refreshes
+    uint64_t pixels;             // pixels pushed by refreshes
+    uint32_t fullUs;             // last full frame
+    uint32_t refreshUs;          // last refresh
+    uint32_t maxRefreshUs;
+    uint32_t untracked;          // values dropped because the page has more than UI_TRACK_SLOTS
+    uint32_t strips;             // strips pushed with DMA, full frames included
+    uint16_t stripRows;          // rows per strip as allocated
+    uint16_t stripReleases;      // strips given back to the heap on request
+    bool direct;                 // no strip buffers: drawing goes straight to the panel
+};
+
+// Fills the screen with bg and draws the page, recording its tracked values
+void ui_render_full(UiDrawFn draw, uint16_t bg);
+// Redraws only what changed since the last frame; returns the pixels pushed
+uint32_t ui_render_refresh(UiDrawFn draw, uint16_t bg);
+
+// Call from widgets for content that changes while a page is shown.
+// Returns true when a refresh will repaint it.
+bool ui_track(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t value);
+// Text at the cursor position with the current font
+bool ui_track_text(int16_t x, int16_t y, const char* text, uint16_t color);
+// Monospaced text at x, y with one cell of cellW per character: a refresh
+// repaints only the cells whose character changed (all of them on a colour change)
+bool ui_track_cells(int16_t x, int16_t y, int16_t cellW, int16_t h, const char* text, uint16_t color);
+uint32_t ui_hash(const char* s, uint32_t seed = 2166136261u);
+
+// Any task, e.g. on a memory alert: the display task frees the strips before its
+// next draw and allocates them again at half the rows
+void ui_release_strips();
+
+void ui_render_stats(UiRenderStats& out);
+void ui_render_report(Print& out);
+
 #endif // UI_WIDGETS_H
 
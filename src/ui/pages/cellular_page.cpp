@@ -9,10 +9,12 @@
 #include "../theme.h"
 #include "../components/icon_manager.h"
 #include "../../modules/catm_gnss/catm_gnss_module.h"
+#include "../../system/hot_path_timer.h"
 #include "../components/ui_widgets.h"
+#include "../components/ui_text.h"
+#include "../ui_state.h"
 
 // External globals
-extern CatMGNSSModule* catmGnssModule;
 extern volatile int16_t scrollCELL;
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -31,7 +33,7 @@ int16_t cellularPageContentHeight() {
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t width) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     d.setTextColor(th.sectionHeader, th.bg);
     d.setTextSize(1);
@@ -48,15 +50,8 @@ static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t w
 static void drawDataRow(const char* label, const char* value, int16_t x, int16_t y,
                         uint16_t valueColor) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
-
-    d.setTextColor(th.textSecondary, th.bg);
-    d.setCursor(x, y);
-    d.print(label);
-
-    d.setTextColor(valueColor, th.bg);
-    d.setCursor(x + 70, y);
-    d.print(value);
+    ui_text(x, y, label, th.textSecondary, th.bg);
+    ui_text_cells(x + 70, y, value, valueColor, th.bg);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -64,11 +59,12 @@ static void drawDataRow(const char* label, const char* value, int16_t x, int16_t
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawSignalIndicator(int16_t x, int16_t y, int8_t dbm, bool connected) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     // Calculate signal percentage and bars
     int percent = constrain(map(dbm, -120, -50, 0, 100), 0, 100);
     int bars = (percent + 19) / 20;  // 0-5 bars
+    ui_track(x, y, 60, 14, (uint8_t)dbm | (connected ? 0x100u : 0u));
 
     // Background pill
     d.fillRoundRect(x, y, 60, 14, 4, th.cardAlt);
@@ -97,8 +93,9 @@ static void drawSignalIndicator(int16_t x, int16_t y, int8_t dbm, bool connected
 // MAIN: Draw Cellular Page
 // ═══════════════════════════════════════════════════════════════════════════
 void drawCellularPage() {
+    HOT_PATH_TIMER("ui.cellular");
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
     int16_t yOff = scrollCELL;
 
     // ─── Page Title with Icon ───
@@ -109,7 +106,8 @@ void drawCellularPage() {
     d.print("Cellular");
 
     // Check module status
-    bool hasData = catmGnssModule && catmGnssModule->isModuleInitialized();
+    const UiState& state = ui_state();
+    bool hasData = state.catmReady;
 
     if (!hasData) {
         // Module not initialized - show error state
@@ -126,7 +124,7 @@ void drawCellularPage() {
         return;
     }
 
-    CellularData data = catmGnssModule->getCellularData();
+    const CellularSnapshot& data = state.cell;
 
     // Status badge next to title
     const char* statusText = data.isConnected ? "ONLINE" : "OFFLINE";
@@ -151,7 +149,7 @@ void drawCellularPage() {
     y += LINE_H1 + 2;
 
     // Operator
-    drawDataRow("Operator", data.operatorName.c_str(), COL1_X, y, th.text);
+    drawDataRow("Operator", data.operatorName, COL1_X, y, th.text);
     y += LINE_H1;
 
     // Signal strength
@@ -171,17 +169,17 @@ void drawCellularPage() {
     y += LINE_H1 + 2;
 
     // IMEI
-    drawDataRow("IMEI", data.imei.c_str(), COL1_X, y, th.textSecondary);
+    drawDataRow("IMEI", data.imei, COL1_X, y, th.textSecondary);
     y += LINE_H1;
 
     // Errors
-    snprintf(buf, sizeof(buf), "%d", data.errorCount);
+    snprintf(buf, sizeof(buf), "%u", (unsigned)data.errorCount);
     drawDataRow("Errors", buf, COL1_X, y, data.errorCount > 0 ? th.red : th.textSecondary);
     y += LINE_H1;
 
     // Last update
-    uint32_t updateAge = (millis() - data.lastUpdate) / 1000;
-    snprintf(buf, sizeof(buf), "%us ago", updateAge);
+    uint32_t updateAge = (state.capturedMs - data.lastUpdate) / 1000;
+    snprintf(buf, sizeof(buf), "%us ago", (unsigned)updateAge);
     drawDataRow("Updated", buf, COL1_X, y, updateAge < 10 ? th.green : th.yellow);
     y += LINE_H1 + 4;
 
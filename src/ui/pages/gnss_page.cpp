@@ -9,9 +9,12 @@
 #include "../theme.h"
 #include "../components/icon_manager.h"
 #include "../../modules/catm_gnss/catm_gnss_module.h"
+#include "../../system/hot_path_timer.h"
+#include "../components/ui_widgets.h"
+#include "../components/ui_text.h"
+#include "../ui_state.h"
 
 // External globals
-extern CatMGNSSModule* catmGnssModule;
 extern volatile int16_t scrollGNSS;
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -30,7 +33,7 @@ int16_t gnssPageContentHeight() {
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t width) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     // Section label
     d.setTextColor(th.sectionHeader, th.bg);
@@ -49,23 +52,21 @@ static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t w
 static void drawDataRow(const char* label, const char* value, int16_t x, int16_t y,
                         uint16_t valueColor, bool highlight = false) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     // Optional highlight background for important values
     if (highlight) {
-        int w = d.textWidth(label) + d.textWidth(value) + 8;
+        int w = ui_text_width(label) + ui_text_width(value) + 8;
+        ui_track(x - 2, y - 1, w + 4, 10, ui_hash(value, valueColor));
         d.fillRoundRect(x - 2, y - 1, w + 4, 10, th.radiusSmall, th.cardAlt);
     }
 
     // Label (muted)
-    d.setTextColor(th.textSecondary, th.bg);
-    d.setCursor(x, y);
-    d.print(label);
+    ui_text(x, y, label, th.textSecondary, th.bg);
 
-    // Value (colored)
-    d.setTextColor(valueColor, th.bg);
-    d.setCursor(x + 56, y);  // Fixed column for alignment
-    d.print(value);
+    // Value (colored), in a fixed column for alignment
+    if (highlight) ui_text(x + 56, y, value, valueColor, th.bg);
+    else ui_text_cells(x + 56, y, value, valueColor, th.bg);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -73,9 +74,10 @@ static void drawDataRow(const char* label, const char* value, int16_t x, int16_t
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawSatIndicator(int16_t x, int16_t y, uint8_t sats, bool hasLock) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     // Background pill
+    ui_track(x, y, 44, 14, sats | (hasLock ? 0x100u : 0u));
     d.fillRoundRect(x, y, 44, 14, 4, th.cardAlt);
 
     // Satellite count
@@ -102,8 +104,9 @@ static void drawSatIndicator(int16_t x, int16_t y, uint8_t sats, bool hasLock) {
 // MAIN: Draw GNSS Page
 // ═══════════════════════════════════════════════════════════════════════════
 void drawGNSSPage() {
+    HOT_PATH_TIMER("ui.gnss");
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
     int16_t yOff = scrollGNSS;
 
     // ─── Page Title with Icon ───
@@ -114,11 +117,9 @@ void drawGNSSPage() {
     d.print("GNSS");
 
     // Lock status indicator (inline with title)
-    bool hasData = catmGnssModule && catmGnssModule->isModuleInitialized();
-    GNSSData data = {};
-    if (hasData) {
-        data = catmGnssModule->getGNSSData();
-    }
+    const UiState& state = ui_state();
+    bool hasData = state.catmReady;
+    const GNSSData& data = state.gnss;
 
     // Status badge next to title
     const char* statusText = !hasData ? "OFFLINE" : (data.isValid ? "LOCK" : "SEARCH");
@@ -223,7 +224,7 @@ void drawGNSSPage() {
         // Fix age
         uint32_t fixAgeSec = 0;
         if (data.lastUpdate != 0) {
-            fixAgeSec = (millis() - data.lastUpdate) / 1000U;
+            fixAgeSec = (state.capturedMs - data.lastUpdate) / 1000U;
         }
         snprintf(buf, sizeof(buf), "%us ago", fixAgeSec);
         d.setTextColor(fixAgeSec < 5 ? th.green : th.yellow, th.bg);
@@ -11,11 +11,15 @@
 #include "../components/icon_manager.h"
 #include "../../modules/catm_gnss/catm_gnss_module.h"
 #include "../../modules/storage/sd_card_module.h"
+#include "../components/ui_widgets.h"
+#include "../components/ui_text.h"
+#include "../ui_state.h"
+#include "../../system/time_service.h"
+#include "../../system/hot_path_timer.h"
 #include <Esp.h>
 #include <cstring>
 
 // External globals
-extern CatMGNSSModule* catmGnssModule;
 extern SDCardModule* sdModule;
 
 // Layout constants
@@ -24,8 +28,9 @@ static constexpr int16_t ROW_H = 14;
 static constexpr int16_t TEXT_OFFSET = ICON_SIZE + 4;
 
 void drawLandingPage() {
+    HOT_PATH_TIMER("ui.landing");
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     // ─── Page Title ───
     d.setTextSize(2);
@@ -38,14 +43,17 @@ void drawLandingPage() {
     char buf[64];
 
     // ─── Time row (no icon, just clock symbol) ───
-    struct tm rtcTime {};
-    M5StamPLC.RX8130.getTime(&rtcTime);
-    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d",
-             rtcTime.tm_year + 1900, rtcTime.tm_mon + 1, rtcTime.tm_mday,
-             rtcTime.tm_hour, rtcTime.tm_min);
-    d.setTextColor(th.textSecondary, th.bg);
-    d.setCursor(COL1_X, y);
-    d.print(buf);
+    if (time_utc_valid()) {
+        const time_t utc = (time_t)time_utc_s();
+        struct tm utcTime;
+        gmtime_r(&utc, &utcTime);
+        snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d",
+                 utcTime.tm_year + 1900, utcTime.tm_mon + 1, utcTime.tm_mday,
+                 utcTime.tm_hour, utcTime.tm_min);
+    } else {
+        snprintf(buf, sizeof(buf), "Time not set");
+    }
+    ui_text_cells(COL1_X, y, buf, th.textSecondary, th.bg);
     y += ROW_H;
 
     // ─── Cellular status with icon ───
@@ -53,23 +61,25 @@ void drawLandingPage() {
     strncpy(carrier, "Offline", sizeof(carrier));
     int signalDbm = -120;
     bool cellConnected = false;
-    if (catmGnssModule && catmGnssModule->isModuleInitialized()) {
-        CellularData cd = catmGnssModule->getCellularData();
-        if (cd.operatorName.length() > 0) {
-            strncpy(carrier, cd.operatorName.c_str(), sizeof(carrier) - 1);
+    const UiState& state = ui_state();
+    if (state.catmReady) {
+        const CellularSnapshot& cd = state.cell;
+        if (cd.operatorName[0] != '\0') {
+            strncpy(carrier, cd.operatorName, sizeof(carrier) - 1);
             carrier[sizeof(carrier) - 1] = '\0';
         }
         signalDbm = cd.signalStrength;
         cellConnected = cd.isConnected;
     }
 
-    // Draw cellular icon
-    uint16_t cellColor = cellConnected ? th.green : th.red;
-    drawIconCellularDirect(COL1_X, y, ICON_SIZE, cellColor);
-
     // Cell text
+    uint16_t cellColor = cellConnected ? th.green : th.red;
     int bars = constrain(map(signalDbm, -120, -50, 0, 5), 0, 5);
     snprintf(buf, sizeof(buf), "%s %ddBm", carrier, signalDbm);
+    ui_track(COL1_X, y, UI_DISPLAY_W - 2 * COL1_X, ROW_H, ui_hash(buf, cellColor) + bars);
+
+    // Draw cellular icon
+    drawIconCellularDirect(COL1_X, y, ICON_SIZE, cellColor);
     d.setTextColor(cellColor, th.bg);
     d.setCursor(COL1_X + TEXT_OFFSET, y + 2);
     d.print(buf);
@@ -86,18 +96,19 @@ void drawLandingPage() {
     // ─── GNSS status with icon ───
     bool gnssLocked = false;
     uint8_t sats = 0;
-    if (catmGnssModule && catmGnssModule->isModuleInitialized()) {
-        GNSSData gnss = catmGnssModule->getGNSSData();
+    if (state.catmReady) {
+        const GNSSData& gnss = state.gnss;
         gnssLocked = gnss.isValid;
         sats = gnss.satellites;
     }
 
-    // Draw GPS icon
-    uint16_t gnssColor = gnssLocked ? th.green : th.yellow;
-    drawIconGPSDirect(COL1_X, y, ICON_SIZE, gnssColor);
-
     // GPS text
+    uint16_t gnssColor = gnssLocked ? th.green : th.yellow;
     snprintf(buf, sizeof(buf), "%s | %u sats", gnssLocked ? "FIX" : "Searching", sats);
+    ui_track(COL1_X, y, UI_DISPLAY_W - 2 * COL1_X, ROW_H, ui_hash(buf, gnssColor));
+
+    // Draw GPS icon
+    drawIconGPSDirect(COL1_X, y, ICON_SIZE, gnssColor);
     d.setTextColor(gnssColor, th.bg);
     d.setCursor(COL1_X + TEXT_OFFSET, y + 2);
     d.print(buf);
@@ -116,6 +127,8 @@ void drawLandingPage() {
 
     // Draw log/storage icon
     uint16_t sdColor = sdMounted ? th.green : th.red;
+    ui_track(COL1_X, y, UI_DISPLAY_W - 2 * COL1_X, ROW_H,
+             sdFreeMB >= 0.0f ? (uint32_t)(sdFreeMB * 10.0f) : (sdMounted ? 0xFFFFFFFEu : 0xFFFFFFFFu));
     drawIconLogDirect(COL1_X, y, ICON_SIZE, sdColor);
 
     // SD text
@@ -131,7 +144,7 @@ void drawLandingPage() {
     y += ROW_H;
 
     // ─── Memory status with icon ───
-    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t freeHeap = state.freeHeap;
     uint16_t memColor = (freeHeap > 50000) ? th.green :
                         (freeHeap > 20000) ? th.yellow : th.red;
 
@@ -142,6 +155,7 @@ void drawLandingPage() {
     snprintf(buf, sizeof(buf), "Heap: %.1f KB", freeHeap / 1024.0f);
     d.setTextColor(memColor, th.bg);
     d.setCursor(COL1_X + TEXT_OFFSET, y + 2);
+    ui_track_text(COL1_X + TEXT_OFFSET, y + 2, buf, memColor);
     d.print(buf);
 
     // ─── Navigation hint ───
@@ -1,35 +1,83 @@
 /*
  * Logs Page Implementation
  * Modern themed system log viewer with severity coloring
+ *
+ * The list is virtual: only the rows in the viewport are fetched, by sequence
+ * number, and each is rasterized once into a 1-bit row cache. Frames, strips
+ * and scrolling then only blit cached rows, so scrolling while the modem is
+ * chatty costs no mutex copies and no glyph rendering. Scrolling up past the
+ * oldest buffered line pages back through the SD time log (log_history.h).
  */
 
 #include <M5StamPLC.h>
 #include "logs_page.h"
 #include "../ui_constants.h"
 #include "../theme.h"
+#include "../components/ui_widgets.h"
 #include "../components/icon_manager.h"
 #include "../../modules/logging/log_buffer.h"
+#include "../../modules/storage/log_history.h"
+#include "../../system/hot_path_timer.h"
 #include <cstring>
+#include <time.h>
 
 // External globals
 extern volatile int16_t scrollLOGS;
 
 // ═══════════════════════════════════════════════════════════════════════════
-// Content height for scroll calculations
-// This is dynamic based on log_count()
+// HELPER: Detect log severity from line content
+// ═══════════════════════════════════════════════════════════════════════════
+enum class LogSeverity : uint8_t { INFO, WARNING, ERROR, DEBUG };
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Layout and view state
+// The title stays put; the list scrolls in whole rows below it
 // ═══════════════════════════════════════════════════════════════════════════
 static constexpr int16_t LOGS_PAD = 8;
+static constexpr int16_t LOGS_LIST_TOP = CONTENT_TOP + LINE_H2;
+static constexpr int16_t LOGS_SLOTS = (CONTENT_BOTTOM - LOGS_LIST_TOP) / LINE_H1;
+static constexpr int16_t LOGS_TEXT_X = COL1_X + 8;                      // after the severity dot
+static constexpr int16_t LOGS_TEXT_W = UI_DISPLAY_W - 2 * COL1_X - 8;
+static constexpr int16_t LOGS_GLYPH_H = 8;                              // font 0, size 1
+static constexpr size_t LOGS_ROW_BYTES = ((LOGS_TEXT_W + 7) / 8) * LOGS_GLYPH_H;
+static constexpr uint32_t LOGS_NO_ROW = 0xFFFFFFFFu;
+static constexpr uint32_t LOGS_EMPTY_ROW = 0xFFFFFFFEu;
+static constexpr uint32_t LOGS_HISTORY_ROW = 0x80000000u;              // live ids are sequence numbers
 
-int16_t logsPageContentHeight() {
-    size_t cnt = log_count();
-    // Title + log lines + padding
-    return LINE_H2 + (int16_t)(cnt * LINE_H1) + LOGS_PAD;
+static_assert(LOGS_ROW_CACHE >= LOGS_SLOTS, "LOGS_ROW_CACHE must cover the viewport");
+
+struct LogsRow {
+    uint32_t id;                 // sequence number, history id or LOGS_NO_ROW
+    uint32_t usedFrame;
+    LogSeverity sev;
+    uint8_t bits[LOGS_ROW_BYTES];   // text mask, drawBitmap() layout
+};
+
+struct LogsView {
+    bool history;                // showing s_hist rather than the RAM buffer
+    bool pendingOlder;           // direction of the history load in flight
+    uint32_t seqBegin;           // live lines [seqBegin, seqEnd) this frame
+    uint32_t seqEnd;
+    uint16_t rows;
+    uint32_t frame;
+};
+
+static LogsRow s_rows[LOGS_ROW_CACHE];
+static LogsView s_view;
+static LogHistoryPage s_hist;
+static lgfx::LGFX_Sprite s_rowSprite;   // 1-bit, aimed at one cache row at a time
+
+static int16_t contentHeight(uint16_t rows) {
+    return LINE_H2 + (int16_t)(rows * LINE_H1) + LOGS_PAD;
 }
 
-// ═══════════════════════════════════════════════════════════════════════════
-// HELPER: Detect log severity from line content
-// ═══════════════════════════════════════════════════════════════════════════
-enum class LogSeverity { INFO, WARNING, ERROR, DEBUG };
+static int16_t maxScroll(uint16_t rows) {
+    return clampScroll(INT16_MAX, contentHeight(rows));
+}
+
+int16_t logsPageContentHeight() {
+    return contentHeight(s_view.history ? s_hist.count : (uint16_t)log_count());
+}
 
 static LogSeverity detectSeverity(const char* line) {
     // Check for common severity patterns
@@ -82,19 +130,18 @@ static void drawSeverityDot(int16_t x, int16_t y, LogSeverity sev) {
 
     // Small filled circle for errors/warnings
     if (sev == LogSeverity::ERROR || sev == LogSeverity::WARNING) {
-        M5StamPLC.Display.fillCircle(x + 2, y + 3, 2, col);
+        ui_gfx().fillCircle(x + 2, y + 3, 2, col);
     } else {
         // Subtle dot for info/debug
-        M5StamPLC.Display.drawPixel(x + 2, y + 3, th.textMuted);
+        ui_gfx().drawPixel(x + 2, y + 3, th.textMuted);
     }
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
 // HELPER: Truncate line with ellipsis if too long
 // ═══════════════════════════════════════════════════════════════════════════
-static void drawTruncatedLine(const char* line, int16_t x, int16_t y, int16_t maxWidth,
+static void drawTruncatedLine(lgfx::LovyanGFX& d, const char* line, int16_t x, int16_t y, int16_t maxWidth,
                               uint16_t color, uint16_t bgColor) {
-    auto& d = M5StamPLC.Display;
     d.setTextColor(color, bgColor);
 
     int lineLen = strlen(line);
@@ -121,90 +168,214 @@ static void drawTruncatedLine(const char* line, int16_t x, int16_t y, int16_t ma
     }
 }
 
+// ═══════════════════════════════════════════════════════════════════════════
+// HELPER: Row cache
+// A row is rasterized the first time it is painted and then only blitted
+// ═══════════════════════════════════════════════════════════════════════════
+static_assert(LOG_HISTORY_LINES <= 64, "history row ids keep the line in 6 bits");
+
+static uint32_t rowId(uint16_t r) {
+    if (!s_view.history) return s_view.seqBegin + r;
+    return LOGS_HISTORY_ROW | ((s_hist.id & 0x00FFFFFFu) << 6) | r;
+}
+
+static const LogsRow& fetchRow(uint32_t id, uint16_t r) {
+    LogsRow* victim = &s_rows[0];
+    for (auto& row : s_rows) {
+        if (row.id == id) {
+            row.usedFrame = s_view.frame;
+            return row;
+        }
+        if (row.usedFrame < victim->usedFrame) victim = &row;
+    }
+
+    char line[LOG_BUFFER_LINE_LEN];
+    if (!s_view.history) {
+        log_get_seq(id, line, sizeof(line));   // empty once pushed out of the buffer
+    } else {
+        const LogHistoryLine& h = s_hist.lines[r];
+        const time_t t = h.time;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        snprintf(line, sizeof(line), "%02d:%02d:%02d %s", tm.tm_hour, tm.tm_min, tm.tm_sec, h.text);
+    }
+
+    LogsRow& row = *victim;
+    row.id = id;
+    row.usedFrame = s_view.frame;
+    row.sev = detectSeverity(line);
+    s_rowSprite.setBuffer(row.bits, LOGS_TEXT_W, LOGS_GLYPH_H, lgfx::palette_1bit);
+    s_rowSprite.fillScreen(0);
+    s_rowSprite.setTextSize(1);
+    drawTruncatedLine(s_rowSprite, line, 0, 0, LOGS_TEXT_W, 1, 0);
+    return row;
+}
+
+// False for slots outside the clip: the measure pass and other strips skip them
+static bool slotPainted(lgfx::LovyanGFX& d, int16_t y) {
+    int32_t cx, cy, cw, ch;
+    d.getClipRect(&cx, &cy, &cw, &ch);
+    return cw > 0 && ch > 0 && y < cy + ch && y + LINE_H1 > cy;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// HELPER: History paging
+// ═══════════════════════════════════════════════════════════════════════════
+static void loadOlder() {
+    if (s_view.history) {
+        if (!s_hist.atOldest &&
+            log_history_request(LogHistoryDir::Older, s_hist.lines[0].time, s_hist.firstSkip)) {
+            s_view.pendingOlder = true;
+        }
+        return;
+    }
+    // Wall time of the oldest buffered line, from its [ms] stamp
+    uint32_t t = (uint32_t)time(nullptr);
+    char line[LOG_BUFFER_LINE_LEN];
+    unsigned long ms = 0;
+    if (log_get_seq(s_view.seqBegin, line, sizeof(line)) && sscanf(line, "[%lu]", &ms) == 1) {
+        t -= (millis() - ms) / 1000;
+    }
+    if (log_history_request(LogHistoryDir::Older, t, 0)) {
+        s_view.pendingOlder = true;
+    }
+}
+
+static void loadNewer() {
+    if (log_history_request(LogHistoryDir::Newer, s_hist.lines[s_hist.count - 1].time, s_hist.lastSkip)) {
+        s_view.pendingOlder = false;
+    }
+}
+
+void logsPageScroll(int16_t delta) {
+    const int16_t h = logsPageContentHeight();
+    if (delta < 0 && scrollLOGS <= 0) {
+        loadOlder();
+    } else if (delta > 0 && s_view.history && scrollLOGS >= clampScroll(INT16_MAX, h)) {
+        loadNewer();
+    } else {
+        scrollLOGS = clampScroll(scrollLOGS + delta, h);
+    }
+}
+
+void logsPageBeginFrame() {
+    if (s_view.frame++ == 0) {
+        for (auto& row : s_rows) row.id = LOGS_NO_ROW;
+    }
+    const bool wasLive = !s_view.history;
+    const bool atBottom = scrollLOGS >= maxScroll(s_view.rows);
+
+    if (const LogHistoryPage* page = log_history_result()) {
+        if (page->count) {
+            memcpy(&s_hist, page, sizeof(s_hist));
+            s_view.history = true;
+            scrollLOGS = s_view.pendingOlder ? maxScroll(s_hist.count) : 0;
+        } else if (s_view.history && !s_view.pendingOlder) {
+            s_view.history = false;   // caught up: back to the RAM buffer, oldest line first
+            scrollLOGS = 0;
+        } else if (s_view.history) {
+            s_hist.atOldest = true;
+        }
+        log_history_release();
+    }
+    if (s_view.history) {
+        s_view.rows = s_hist.count;
+        return;
+    }
+
+    uint32_t begin, end;
+    log_seq_range(begin, end);
+    const uint16_t rows = (uint16_t)(end - begin);
+    if (wasLive && atBottom) {
+        scrollLOGS = maxScroll(rows);   // follow the newest line
+    } else if (wasLive && begin != s_view.seqBegin) {
+        // Lines pushed out at the top: keep the same lines in view
+        const uint32_t gone = begin - s_view.seqBegin;
+        const int16_t up = gone < rows ? (int16_t)(gone * LINE_H1) : scrollLOGS;
+        scrollLOGS = clampScroll(scrollLOGS - up, contentHeight(rows));
+    }
+    s_view.seqBegin = begin;
+    s_view.seqEnd = end;
+    s_view.rows = rows;
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // MAIN: Draw Logs Page
 // ═══════════════════════════════════════════════════════════════════════════
 void drawLogsPage() {
+    HOT_PATH_TIMER("ui.logs");
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
-    int16_t yOff = scrollLOGS;
+    auto& d = ui_gfx();
+    const uint16_t rows = s_view.rows;
+    const int16_t scroll = scrollLOGS;
 
     // ─── Page Title with Icon ───
-    drawIconLogDirect(COL1_X, CONTENT_TOP - yOff + 2, 14, th.accent);
+    const char* title = s_view.history ? "History" : "Logs";
+    char badge[16];
+    if (log_history_busy()) {
+        snprintf(badge, sizeof(badge), "...");
+    } else if (s_view.history) {
+        const time_t t = s_hist.lines[0].time;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        snprintf(badge, sizeof(badge), "%02d:%02d", tm.tm_hour, tm.tm_min);
+    } else {
+        snprintf(badge, sizeof(badge), "%u", (unsigned)rows);
+    }
+    ui_track(0, CONTENT_TOP, UI_DISPLAY_W, LINE_H2, ui_hash(badge, ui_hash(title)));
+
+    drawIconLogDirect(COL1_X, CONTENT_TOP + 2, 14, th.accent);
     d.setTextColor(th.accent, th.bg);
     d.setTextSize(2);
-    d.setCursor(COL1_X + 18, CONTENT_TOP - yOff);
-    d.print("Logs");
-
-    // Log count badge
-    size_t cnt = log_count();
-    char cntBuf[16];
-    snprintf(cntBuf, sizeof(cntBuf), "%u", (unsigned)cnt);
-    int titleW = 18 + d.textWidth("Logs");  // Account for icon
-    d.fillRoundRect(COL1_X + titleW + 8, CONTENT_TOP - yOff + 2, 32, 14, 4, th.cardAlt);
+    d.setCursor(COL1_X + 18, CONTENT_TOP);
+    d.print(title);
+
+    // Line count badge, or the time of the first history line
+    int titleW = 18 + d.textWidth(title);  // Account for icon
+    d.fillRoundRect(COL1_X + titleW + 8, CONTENT_TOP + 2, 34, 14, 4, th.cardAlt);
     d.setTextSize(1);
     d.setTextColor(th.textSecondary, th.cardAlt);
-    d.setCursor(COL1_X + titleW + 12, CONTENT_TOP - yOff + 5);
-    d.print(cntBuf);
-
-    // Calculate scroll bounds
-    const int pad = 2;
-    int contentH = (int)cnt * LINE_H1 + pad * 2;
-    scrollLOGS = clampScroll(scrollLOGS, contentH);
-
-    // Content area bounds
-    const int contentLeft = COL1_X;
-    const int contentRight = UI_DISPLAY_W - COL1_X;
-    const int contentWidth = contentRight - contentLeft - 8;  // Account for severity dot
-
-    // Empty state
-    if (cnt == 0) {
-        int centerY = CONTENT_TOP + 40 - yOff;
-        d.setTextColor(th.textMuted, th.bg);
-        d.setCursor(COL1_X, centerY);
-        d.print("No log entries");
-        return;
-    }
+    d.setCursor(COL1_X + titleW + 12, CONTENT_TOP + 5);
+    d.print(badge);
 
-    d.setTextSize(1);
+    // ─── Visible rows ───
+    const int16_t rowX = COL1_X - 2;
+    const int16_t rowW = LOGS_TEXT_W + 12;
+    const uint16_t first = scroll / LINE_H1;
+    for (int16_t k = 0; k < LOGS_SLOTS; ++k) {
+        const int16_t y = LOGS_LIST_TOP + k * LINE_H1;
+        const uint16_t r = first + k;
+        const uint32_t id = rows == 0 ? (k == 2 ? LOGS_EMPTY_ROW : LOGS_NO_ROW) : r < rows ? rowId(r) : LOGS_NO_ROW;
+        ui_track(rowX, y, rowW, LINE_H1, id);
+        if (id == LOGS_NO_ROW || !slotPainted(d, y)) continue;
 
-    // Draw log lines
-    int y = CONTENT_TOP + LINE_H2 - yOff;
-    char line[160];
-
-    for (size_t i = 0; i < cnt; ++i) {
-        // Only draw visible lines
-        if (y > CONTENT_TOP - LINE_H1 && y < CONTENT_BOTTOM) {
-            if (log_get_line(i, line, sizeof(line))) {
-                LogSeverity sev = detectSeverity(line);
-
-                // Background highlight for errors/warnings
-                uint16_t bgCol = getSeverityBg(sev);
-                if (sev == LogSeverity::ERROR || sev == LogSeverity::WARNING) {
-                    d.fillRect(contentLeft - 2, y - 1, contentWidth + 12, LINE_H1, bgCol);
-                }
-
-                // Severity indicator
-                drawSeverityDot(contentLeft, y, sev);
-
-                // Log text (truncated if needed)
-                uint16_t textCol = getSeverityColor(sev);
-                drawTruncatedLine(line, contentLeft + 8, y, contentWidth, textCol, bgCol);
-            }
+        if (id == LOGS_EMPTY_ROW) {
+            d.setTextColor(th.textMuted, th.bg);
+            d.setCursor(COL1_X, y + 1);
+            d.print("No log entries");
+            continue;
         }
-        y += LINE_H1;
-    }
 
-    // Scroll indicator (if content overflows)
-    if (contentH > (CONTENT_BOTTOM - CONTENT_TOP)) {
-        // Draw scroll track on right edge
-        int trackH = CONTENT_BOTTOM - CONTENT_TOP - LINE_H2;
-        int trackY = CONTENT_TOP + LINE_H2;
-        int thumbH = max(10, (trackH * trackH) / contentH);
-        int thumbY = trackY + ((trackH - thumbH) * scrollLOGS) / (contentH - trackH);
+        const LogsRow& row = fetchRow(id, r);
+        const uint16_t bgCol = getSeverityBg(row.sev);
+        if (row.sev == LogSeverity::ERROR || row.sev == LogSeverity::WARNING) {
+            d.fillRect(rowX, y, rowW, LINE_H1, bgCol);
+        }
+        drawSeverityDot(COL1_X, y + 1, row.sev);
+        d.drawBitmap(LOGS_TEXT_X, y + 1, row.bits, LOGS_TEXT_W, LOGS_GLYPH_H, getSeverityColor(row.sev), bgCol);
+    }
 
+    // ─── Scroll indicator (if content overflows) ───
+    const int16_t maxS = maxScroll(rows);
+    const int trackH = CONTENT_BOTTOM - LOGS_LIST_TOP;
+    const int listH = (int)rows * LINE_H1 + LOGS_PAD;
+    const int thumbH = maxS > 0 ? max(10, (trackH * trackH) / listH) : 0;
+    const int thumbPos = scroll < maxS ? scroll : maxS;
+    const int thumbY = maxS > 0 ? LOGS_LIST_TOP + ((trackH - thumbH) * thumbPos) / maxS : 0;
+    ui_track(UI_DISPLAY_W - 5, LOGS_LIST_TOP, 4, trackH, ((uint32_t)thumbH << 16) | (uint32_t)thumbY);
+    if (maxS > 0) {
         // Track
-        d.fillRect(UI_DISPLAY_W - 4, trackY, 2, trackH, th.borderSubtle);
+        d.fillRect(UI_DISPLAY_W - 4, LOGS_LIST_TOP, 2, trackH, th.borderSubtle);
 
         // Thumb
         d.fillRoundRect(UI_DISPLAY_W - 5, thumbY, 4, thumbH, 2, th.accent);
@@ -8,9 +8,21 @@
 
 #include <stdint.h>
 
+#ifndef LOGS_ROW_CACHE
+#define LOGS_ROW_CACHE 16          // rasterized rows kept; 224 bytes each
+#endif
+
 // Draw the logs page
 void drawLogsPage();
 
+// Display task, once before each frame of the page: pins the lines the frame
+// shows and picks up a finished history page
+void logsPageBeginFrame();
+
+// Scrolls the list by delta pixels; past the top (or the bottom of a history
+// page) it loads the adjacent history page instead
+void logsPageScroll(int16_t delta);
+
 // Get the content height for scroll calculations
 // This is dynamic based on log_count()
 // Returns the total height of page content in pixels
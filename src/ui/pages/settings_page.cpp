@@ -10,8 +10,12 @@
 #include "../components/icon_manager.h"
 #include "../../modules/storage/sd_card_module.h"
 #include "../../modules/settings/settings_store.h"
+#include "../../system/work_queue.h"
 #include "../../config/system_config.h"
+#include "../../../include/debug_system.h"
 #include "../components/ui_widgets.h"
+#include "../../system/time_service.h"
+#include "../../system/hot_path_timer.h"
 #include <Esp.h>
 
 // External globals
@@ -26,6 +30,25 @@ extern uint32_t displaySleepTimeoutMs;
 // Currently selected settings item
 static SettingsItem s_selectedItem = SettingsItem::BRIGHTNESS;
 
+// Log tag shown in the Diagnostics section
+static LogTag s_logTag = LOG_TAG_CATM;
+static const char* const kLogLevelNames[] = {"NONE", "ERROR", "WARN", "INFO", "DEBUG", "VERBOSE"};
+
+// Persists the display globals through the settings service, off the button
+// task; presses while a save is queued coalesce into it
+static void saveDisplaySettingsJob(void*) {
+    AppSettings s;
+    g_settings.get(s);
+    s.displayBrightness = displayBrightness;
+    s.displaySleepEnabled = displaySleepEnabled;
+    s.displaySleepSec = (uint16_t)(displaySleepTimeoutMs / 1000);
+    g_settings.update(s);
+}
+
+static void saveDisplaySettings() {
+    work_submit("SettingsSave", saveDisplaySettingsJob, nullptr, WorkPriority::Low, WORK_CORE_APP, WORK_COALESCE);
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 // Settings item selection
 // ═══════════════════════════════════════════════════════════════════════════
@@ -51,16 +74,13 @@ void settingsAdjustValue(int8_t direction) {
             if (newBright > 255) newBright = 255;
             displayBrightness = (uint8_t)newBright;
             M5StamPLC.Display.setBrightness(displayBrightness);
-            // Save to NVS
-            displaySettingsSave(displayBrightness, displaySleepEnabled,
-                               (uint16_t)(displaySleepTimeoutMs / 1000));
+            saveDisplaySettings();
             break;
         }
         case SettingsItem::SLEEP_TOGGLE: {
             // Toggle sleep enable
             displaySleepEnabled = !displaySleepEnabled;
-            displaySettingsSave(displayBrightness, displaySleepEnabled,
-                               (uint16_t)(displaySleepTimeoutMs / 1000));
+            saveDisplaySettings();
             break;
         }
         case SettingsItem::SLEEP_TIMEOUT: {
@@ -69,8 +89,22 @@ void settingsAdjustValue(int8_t direction) {
             if (newTimeout < 30000) newTimeout = 30000;      // Min 30s
             if (newTimeout > 600000) newTimeout = 600000;    // Max 10min
             displaySleepTimeoutMs = (uint32_t)newTimeout;
-            displaySettingsSave(displayBrightness, displaySleepEnabled,
-                               (uint16_t)(displaySleepTimeoutMs / 1000));
+            saveDisplaySettings();
+            break;
+        }
+        case SettingsItem::LOG_TAG: {
+            int8_t t = (int8_t)s_logTag + direction;
+            if (t < 0) t = LOG_TAG_COUNT - 1;
+            if (t >= LOG_TAG_COUNT) t = 0;
+            s_logTag = (LogTag)t;
+            break;
+        }
+        case SettingsItem::LOG_LEVEL: {
+            // Runtime only; a reboot restores the defaults
+            int8_t level = (int8_t)log_tag_get_level(s_logTag) + direction;
+            if (level < DEBUG_LOG_LEVEL_NONE) level = DEBUG_LOG_LEVEL_NONE;
+            if (level > DEBUG_LOG_LEVEL_VERBOSE) level = DEBUG_LOG_LEVEL_VERBOSE;
+            log_tag_set_level(s_logTag, (LogLevel)level);
             break;
         }
         default:
@@ -85,8 +119,8 @@ static constexpr int16_t SETTINGS_ROW_H = 18;
 static constexpr int16_t SETTINGS_SECTION_GAP = 6;
 
 int16_t settingsPageContentHeight() {
-    // Title + Display section (3 items) + System section (4 items) + padding
-    return LINE_H2 + 4 + (SETTINGS_ROW_H * 7) + (SETTINGS_SECTION_GAP * 2) + 12;
+    // Title + Display section (3 items) + Diagnostics (2 items) + System section (4 items) + padding
+    return LINE_H2 + 4 + (SETTINGS_ROW_H * 9) + (SETTINGS_SECTION_GAP * 3) + 12;
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -94,7 +128,7 @@ int16_t settingsPageContentHeight() {
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t width) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     d.setTextColor(th.sectionHeader, th.bg);
     d.setTextSize(1);
@@ -111,7 +145,7 @@ static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t w
 static void drawSettingsRow(const char* label, const char* value, int16_t x, int16_t y,
                             int16_t width, bool selected, uint16_t valueColor = 0) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     if (valueColor == 0) valueColor = th.text;
 
@@ -149,7 +183,7 @@ static void drawSettingsRow(const char* label, const char* value, int16_t x, int
 static void drawInfoRow(const char* label, const char* value, int16_t x, int16_t y,
                         int16_t width, uint16_t valueColor = 0) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     if (valueColor == 0) valueColor = th.textSecondary;
 
@@ -168,8 +202,9 @@ static void drawInfoRow(const char* label, const char* value, int16_t x, int16_t
 // MAIN: Draw Settings Page
 // ═══════════════════════════════════════════════════════════════════════════
 void drawSettingsPage() {
+    HOT_PATH_TIMER("ui.settings");
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
     int16_t yOff = scrollSETTINGS;
 
     const int16_t contentWidth = UI_DISPLAY_W - 2 * COL1_X;
@@ -213,6 +248,22 @@ void drawSettingsPage() {
                     s_selectedItem == SettingsItem::SLEEP_TIMEOUT, th.textSecondary);
     y += SETTINGS_ROW_H + SETTINGS_SECTION_GAP;
 
+    // ═══════════════════════════════════════════════════════════════════════
+    // Diagnostics Section
+    // ═══════════════════════════════════════════════════════════════════════
+    drawSectionHeader("Diagnostics", COL1_X, y, contentWidth);
+    y += LINE_H1 + 2;
+
+    drawSettingsRow("Log Module", log_tag_name(s_logTag), COL1_X, y, contentWidth,
+                    s_selectedItem == SettingsItem::LOG_TAG, th.cyan);
+    y += SETTINGS_ROW_H;
+
+    LogLevel tagLevel = log_tag_get_level(s_logTag);
+    drawSettingsRow("Log Level", kLogLevelNames[tagLevel], COL1_X, y, contentWidth,
+                    s_selectedItem == SettingsItem::LOG_LEVEL,
+                    tagLevel >= DEBUG_LOG_LEVEL_DEBUG ? th.yellow : th.textSecondary);
+    y += SETTINGS_ROW_H + SETTINGS_SECTION_GAP;
+
     // ═══════════════════════════════════════════════════════════════════════
     // System Info Section
     // ═══════════════════════════════════════════════════════════════════════
@@ -245,7 +296,7 @@ void drawSettingsPage() {
     y += SETTINGS_ROW_H;
 
     // Uptime
-    uint32_t uptimeSec = millis() / 1000;
+    uint32_t uptimeSec = time_uptime_s();
     uint32_t hours = uptimeSec / 3600;
     uint32_t mins = (uptimeSec % 3600) / 60;
     snprintf(buf, sizeof(buf), "%uh %um", hours, mins);
@@ -13,6 +13,8 @@ enum class SettingsItem : uint8_t {
     BRIGHTNESS = 0,
     SLEEP_TOGGLE,
     SLEEP_TIMEOUT,
+    LOG_TAG,        // which module's log threshold the next row edits
+    LOG_LEVEL,
     ITEM_COUNT
 };
 
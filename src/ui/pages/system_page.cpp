@@ -12,21 +12,27 @@
 #include "../../hardware/basic_stamplc.h"
 #include "../../modules/catm_gnss/catm_gnss_module.h"
 #include "../../modules/storage/sd_card_module.h"
+#include "../../system/cpu_profiler.h"
+#include "../../system/mutex_profiler.h"
+#include "../../system/metrics.h"
+#include "../../system/hot_path_timer.h"
 #include "../components/ui_widgets.h"
+#include "../components/ui_text.h"
+#include "../ui_state.h"
+#include "../ui_perf.h"
 #include <Esp.h>
 
 // External globals
-extern BasicStampPLC* stampPLC;
-extern CatMGNSSModule* catmGnssModule;
 extern SDCardModule* sdModule;
 extern volatile int16_t scrollSYS;
 
 // ═══════════════════════════════════════════════════════════════════════════
 // Content height for scroll calculations
-// Layout: Title + Memory(4 rows) + Modules(4 rows) + Sensors(4 rows)
+// Layout: Title + Memory(7 rows) + Display(4 rows) + Modules(4 rows) + Sensors(4 rows)
+//         + Generator(4 rows)
 // ═══════════════════════════════════════════════════════════════════════════
-static constexpr int16_t SYS_CONTENT_ROWS = 16;
-static constexpr int16_t SYS_CONTENT_PAD = 12;
+static constexpr int16_t SYS_CONTENT_ROWS = 27;
+static constexpr int16_t SYS_CONTENT_PAD = 24;
 
 int16_t systemPageContentHeight() {
     return LINE_H2 + (LINE_H1 * SYS_CONTENT_ROWS) + SYS_CONTENT_PAD;
@@ -37,7 +43,7 @@ int16_t systemPageContentHeight() {
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t width) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     d.setTextColor(th.sectionHeader, th.bg);
     d.setTextSize(1);
@@ -54,15 +60,8 @@ static void drawSectionHeader(const char* label, int16_t x, int16_t y, int16_t w
 static void drawDataRow(const char* label, const char* value, int16_t x, int16_t y,
                         uint16_t valueColor) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
-
-    d.setTextColor(th.textSecondary, th.bg);
-    d.setCursor(x, y);
-    d.print(label);
-
-    d.setTextColor(valueColor, th.bg);
-    d.setCursor(x + 70, y);
-    d.print(value);
+    ui_text(x, y, label, th.textSecondary, th.bg);
+    ui_text_cells(x + 70, y, value, valueColor, th.bg);
 }
 
 // ═══════════════════════════════════════════════════════════════════════════
@@ -71,7 +70,11 @@ static void drawDataRow(const char* label, const char* value, int16_t x, int16_t
 static void drawMemoryBar(int16_t x, int16_t y, int16_t w, int16_t h,
                           uint32_t used, uint32_t total) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
+
+    // Bar plus the percentage to its right
+    uint32_t shown = total ? (uint32_t)constrain((int)((used * 100ULL) / total), 0, 100) : 0xFFFFu;
+    ui_track(x, y, w + 4 + 24, h, shown);
 
     // Background
     d.fillRoundRect(x, y, w, h, 3, th.barBg);
@@ -106,12 +109,13 @@ static void drawMemoryBar(int16_t x, int16_t y, int16_t w, int16_t h,
 // ═══════════════════════════════════════════════════════════════════════════
 static void drawStatusPill(int16_t x, int16_t y, const char* text, bool ok) {
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
 
     uint16_t bgColor = ok ? th.greenDim : th.redDim;
     uint16_t textColor = ok ? th.green : th.red;
 
     int textW = d.textWidth(text);
+    ui_track(x, y, textW + 8, 12, ui_hash(text, ok));
     d.fillRoundRect(x, y, textW + 8, 12, 3, bgColor);
     d.setTextColor(textColor, bgColor);
     d.setCursor(x + 4, y + 2);
@@ -122,8 +126,9 @@ static void drawStatusPill(int16_t x, int16_t y, const char* text, bool ok) {
 // MAIN: Draw System Page
 // ═══════════════════════════════════════════════════════════════════════════
 void drawSystemPage() {
+    HOT_PATH_TIMER("ui.system");
     const auto& th = ui::theme();
-    auto& d = M5StamPLC.Display;
+    auto& d = ui_gfx();
     int16_t yOff = scrollSYS;
 
     // ─── Page Title with Icon ───
@@ -141,8 +146,9 @@ void drawSystemPage() {
     drawSectionHeader("Memory", COL1_X, y, 120);
     y += LINE_H1 + 2;
 
-    uint32_t freeHeap = ESP.getFreeHeap();
-    uint32_t totalHeap = ESP.getHeapSize();
+    const UiState& state = ui_state();
+    uint32_t freeHeap = state.freeHeap;
+    uint32_t totalHeap = state.heapSize;
     uint32_t usedHeap = totalHeap - freeHeap;
 
     // Memory bar
@@ -157,8 +163,89 @@ void drawSystemPage() {
     y += LINE_H1;
 
     // CPU frequency
-    snprintf(buf, sizeof(buf), "%d MHz", ESP.getCpuFreqMHz());
+    snprintf(buf, sizeof(buf), "%u MHz", (unsigned)state.cpuMHz);
     drawDataRow("CPU", buf, COL1_X, y, th.textSecondary);
+    y += LINE_H1;
+
+    // Measured load per core (last sample) and the busiest task over the last minute
+    float load0 = cpu_profile_core_load(0);
+    if (load0 >= 0.0f) {
+        float load1 = CPU_PROFILE_CORES > 1 ? cpu_profile_core_load(1) : load0;
+        float peak = max(load0, load1);
+        snprintf(buf, sizeof(buf), "%.0f%%/%.0f%%", load0 * 100.0f, load1 * 100.0f);
+        drawDataRow("Load", buf, COL1_X, y, (peak < 0.6f) ? th.green : (peak < 0.85f) ? th.yellow : th.red);
+
+        CpuTaskStats top[1 + CPU_PROFILE_CORES];
+        size_t n = cpu_profile_tasks(top, 1 + CPU_PROFILE_CORES);
+        for (size_t i = 0; i < n; i++) {
+            if (strncmp(top[i].name, "IDLE", 4) == 0) continue;
+            snprintf(buf, sizeof(buf), "%.10s %u%%", top[i].name, top[i].permille[CPU_WINDOW_MID] / 10);
+            d.setTextColor(th.textSecondary, th.bg);
+            d.setCursor(COL2_X, y);
+            d.print(buf);
+            break;
+        }
+    } else {
+        drawDataRow("Load", "--", COL1_X, y, th.textSecondary);
+    }
+    y += LINE_H1;
+
+    // Most contended mutex over the last minute and its timeouts
+    MutexProfileStats lock;
+    if (mutex_profile_worst(lock)) {
+        const uint32_t waitMs = lock.recentWaitMaxUs / 1000;
+        snprintf(buf, sizeof(buf), "%.8s %lums", lock.name, (unsigned long)waitMs);
+        drawDataRow("Lock", buf, COL1_X, y, (waitMs < 10) ? th.green : (waitMs < 100) ? th.yellow : th.red);
+        if (lock.timeouts) {
+            snprintf(buf, sizeof(buf), "%lu timeouts", (unsigned long)lock.timeouts);
+            d.setTextColor(th.red, th.bg);
+            d.setCursor(COL2_X, y);
+            d.print(buf);
+        }
+    } else {
+        drawDataRow("Lock", "ok", COL1_X, y, th.green);
+    }
+    y += LINE_H1;
+
+    // Uplink records delivered and lost, from the metrics registry
+    int64_t sent = 0;
+    int64_t dropped = 0;
+    int64_t failed = 0;
+    if (metrics_value("tx.sent", sent) && metrics_value("tx.dropped", dropped) && metrics_value("tx.failed", failed)) {
+        const int64_t lost = dropped + failed;
+        snprintf(buf, sizeof(buf), "%lu sent", (unsigned long)sent);
+        drawDataRow("Uplink", buf, COL1_X, y, th.textSecondary);
+        snprintf(buf, sizeof(buf), "%lu lost", (unsigned long)lost);
+        d.setTextColor(lost ? th.yellow : th.textSecondary, th.bg);
+        d.setCursor(COL2_X, y);
+        d.print(buf);
+    } else {
+        drawDataRow("Uplink", "--", COL1_X, y, th.textSecondary);
+    }
+    y += LINE_H1 + 4;
+
+    // ─── Display Section: frame cost over the last UI_PERF_SAMPLES frames ───
+    drawSectionHeader("Display", COL1_X, y, 120);
+    y += LINE_H1 + 2;
+
+    const UiPerfSummary& perf = ui_perf_summary();
+    if (perf.samples) {
+        const uint32_t p99Ms = perf.renderUs.p99 / 1000;
+        snprintf(buf, sizeof(buf), "%.1f/%.1f/%.1f ms", perf.renderUs.p50 / 1000.0f, perf.renderUs.p90 / 1000.0f,
+                 perf.renderUs.p99 / 1000.0f);
+        drawDataRow("Render", buf, COL1_X, y, (p99Ms < 16) ? th.green : (p99Ms < 50) ? th.yellow : th.red);
+        y += LINE_H1;
+        snprintf(buf, sizeof(buf), "%.1f/%.1f ms %luKB", perf.pushUs.p50 / 1000.0f, perf.pushUs.p99 / 1000.0f,
+                 (unsigned long)(perf.bytes.p50 >> 10));
+        drawDataRow("SPI", buf, COL1_X, y, th.textSecondary);
+    } else {
+        drawDataRow("Render", "--", COL1_X, y, th.textSecondary);
+        y += LINE_H1;
+        drawDataRow("SPI", "--", COL1_X, y, th.textSecondary);
+    }
+    y += LINE_H1;
+    snprintf(buf, sizeof(buf), "%lu skip %lu idle", (unsigned long)perf.skipped, (unsigned long)perf.idle);
+    drawDataRow("Frames", buf, COL1_X, y, perf.skipped ? th.yellow : th.textSecondary);
     y += LINE_H1 + 4;
 
     // ─── Module Status Section ───
@@ -166,7 +253,7 @@ void drawSystemPage() {
     y += LINE_H1 + 2;
 
     // StampPLC
-    bool stampReady = stampPLC && stampPLC->isReady();
+    bool stampReady = state.plcReady;
     d.setTextColor(th.textSecondary, th.bg);
     d.setCursor(COL1_X, y);
     d.print("PLC");
@@ -174,7 +261,7 @@ void drawSystemPage() {
     y += LINE_H1;
 
     // CatM+GNSS
-    bool catmReady = catmGnssModule && catmGnssModule->isModuleInitialized();
+    bool catmReady = state.catmReady;
     d.setTextColor(th.textSecondary, th.bg);
     d.setCursor(COL1_X, y);
     d.print("CatM");
@@ -205,22 +292,31 @@ void drawSystemPage() {
     y += LINE_H1 + 2;
 
     // Temperature
-    float temperature = M5StamPLC.getTemp();
-    bool tempWarning = (temperature < -10.0f || temperature > 60.0f);
-    snprintf(buf, sizeof(buf), "%.1f C", temperature);
+    const PlcSensorSnapshot& sensors = state.sensors;
+    float temperature = sensors.temperature;
+    bool tempWarning = !sensors.tempOk || (temperature < -10.0f || temperature > 60.0f);
+    if (sensors.tempOk) {
+        snprintf(buf, sizeof(buf), "%.1f C", temperature);
+    } else {
+        snprintf(buf, sizeof(buf), "--");
+    }
     drawDataRow("Temp", buf, COL1_X, y, tempWarning ? th.red : th.text);
     y += LINE_H1;
 
     // Power monitoring
-    float voltage = M5StamPLC.INA226.getBusVoltage();
-    float current = M5StamPLC.INA226.getShuntCurrent();
-    bool powerWarning = (voltage < 3.0f || voltage > 5.5f);
-
-    snprintf(buf, sizeof(buf), "%.2fV", voltage);
+    float voltage = sensors.busVoltage;
+    float current = sensors.current;
+    bool powerWarning = !sensors.powerOk || (voltage < 3.0f || voltage > 5.5f);
+
+    if (sensors.powerOk) {
+        snprintf(buf, sizeof(buf), "%.2fV", voltage);
+    } else {
+        snprintf(buf, sizeof(buf), "--");
+    }
     drawDataRow("Volt", buf, COL1_X, y, powerWarning ? th.yellow : th.textSecondary);
 
     // Current on right side
-    snprintf(buf, sizeof(buf), "%.0fmA", current * 1000);
+    snprintf(buf, sizeof(buf), "%.0fmA", sensors.powerOk ? current * 1000 : 0.0f);
     d.setTextColor(th.textSecondary, th.bg);
     d.setCursor(COL2_X, y);
     d.print(buf);
@@ -246,4 +342,51 @@ void drawSystemPage() {
         d.setCursor(COL2_X, y);
         d.print(buf);
     }
+    y += LINE_H1 + 4;
+
+    // ─── Generator Section: derived on the unit, memoized between frames ───
+    drawSectionHeader("Generator", COL1_X, y, 120);
+    y += LINE_H1 + 2;
+
+    const GeneratorDerived& gen = state.generatorDerived;
+    if (gen.fuelValid) {
+        snprintf(buf, sizeof(buf), "%.0f%%", gen.fuelPercent);
+        drawDataRow("Fuel", buf, COL1_X, y,
+                    (gen.fuelPercent > 25.0f) ? th.text : (gen.fuelPercent > 10.0f) ? th.yellow : th.red);
+        snprintf(buf, sizeof(buf), "%.1f%%/h", gen.burnPctPerHour);
+        d.setTextColor(th.textSecondary, th.bg);
+        d.setCursor(COL2_X, y);
+        d.print(buf);
+    } else {
+        drawDataRow("Fuel", "--", COL1_X, y, th.textSecondary);
+    }
+    y += LINE_H1;
+
+    if (gen.fuelValid && gen.hoursToEmpty >= 0.0f) {
+        snprintf(buf, sizeof(buf), "%.1f run h", gen.hoursToEmpty);
+        drawDataRow("Empty", buf, COL1_X, y, (gen.hoursToEmpty > 8.0f) ? th.textSecondary : th.yellow);
+    } else {
+        drawDataRow("Empty", "--", COL1_X, y, th.textSecondary);
+    }
+    y += LINE_H1;
+
+    // Run hours to the interval due first, which one, and the days that is at the learned duty
+    const GenServiceProjection& svc = gen.service[gen.nextService];
+    if (gen.serviceValid && svc.remainingS != INT32_MAX) {
+        const bool overdue = svc.remainingS <= 0;
+        snprintf(buf, sizeof(buf), "%ldh", (long)(svc.remainingS / 3600));
+        drawDataRow("Service", buf, COL1_X, y,
+                    overdue ? th.red : (svc.remainingS < 24 * 3600) ? th.yellow : th.textSecondary);
+        const char* name = generator_service_name((GenService)gen.nextService);
+        if (!overdue && svc.daysToDue >= 0.0f) {
+            snprintf(buf, sizeof(buf), "%s %.0fd", name, svc.daysToDue);
+        } else {
+            snprintf(buf, sizeof(buf), "%s", name);
+        }
+        d.setTextColor(th.textSecondary, th.bg);
+        d.setCursor(COL2_X, y);
+        d.print(buf);
+    } else {
+        drawDataRow("Service", "--", COL1_X, y, th.textSecondary);
+    }
 }
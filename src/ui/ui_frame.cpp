@@ -0,0 +1,91 @@
+/*
+ * UI Frame Scheduling Implementation
+ */
+
+#include "ui_frame.h"
+#include "components/ui_widgets.h"
+#include "../system/event_bus.h"
+#include "../system/load_shed.h"
+#include <atomic>
+
+namespace {
+constexpr size_t kData = static_cast<size_t>(UiData::Count);
+
+TaskHandle_t s_display = nullptr;
+int s_bus = EVENT_BUS_NONE;
+std::atomic<uint32_t> s_version[kData];
+uint32_t s_seen[kData] = {};   // display task only
+std::atomic<uint8_t> s_slowdown{1};
+
+void bump(UiData data) {
+    s_version[static_cast<size_t>(data)].fetch_add(1, std::memory_order_release);
+}
+
+// Bus events the pages show, and the heap alert the strips give way to
+void drainBus() {
+    BusEvent e;
+    while (event_bus_take(s_bus, e)) {
+        switch (e.topic) {
+            case EventTopic::CellularLink:
+            case EventTopic::CellularStatus:
+                bump(UiData::Cellular);
+                break;
+            case EventTopic::Gnss:
+                bump(UiData::Gnss);
+                break;
+            case EventTopic::HeapLow: {
+                HeapLowEvent h;
+                if (event_payload<EventTopic::HeapLow>(e, h) && h.level == HeapLevel::Critical) ui_release_strips();
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+} // namespace
+
+void ui_frame_begin(TaskHandle_t display) {
+    s_display = display;
+    if (display && s_bus == EVENT_BUS_NONE) {
+        s_bus = event_bus_subscribe("Display", EVENT_TOPIC_BIT(CellularLink) | EVENT_TOPIC_BIT(CellularStatus) |
+                                                   EVENT_TOPIC_BIT(Gnss) | EVENT_TOPIC_BIT(HeapLow),
+                                    display);
+    }
+}
+
+void ui_data_changed(UiData data) {
+    const size_t i = static_cast<size_t>(data);
+    if (i >= kData) return;
+    bump(data);
+    ui_frame_request();
+}
+
+void ui_frame_request() {
+    if (s_display) xTaskNotifyGive(s_display);
+}
+
+bool ui_data_consume(uint32_t mask) {
+    drainBus();
+    bool changed = false;
+    for (size_t i = 0; i < kData; i++) {
+        if (!(mask & (1UL << i))) continue;
+        const uint32_t v = s_version[i].load(std::memory_order_acquire);
+        if (v != s_seen[i]) {
+            s_seen[i] = v;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+void ui_frame_set_slowdown(uint8_t factor) {
+    s_slowdown.store(factor ? factor : 1, std::memory_order_relaxed);
+}
+
+// The larger of the set factor and the load shedder's
+uint8_t ui_frame_slowdown() {
+    const uint8_t slow = s_slowdown.load(std::memory_order_relaxed);
+    if (load_shed_active(ShedStep::Display) && slow < LOAD_SHED_DISPLAY_SLOWDOWN) return LOAD_SHED_DISPLAY_SLOWDOWN;
+    return slow;
+}
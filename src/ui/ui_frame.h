@@ -0,0 +1,45 @@
+/*
+ * UI Frame Scheduling
+ * The display task sleeps until there is something to draw: a UI event, new
+ * data for the page on screen, or the page's own poll timer for values that
+ * change with time (clock, heap). Producers call ui_data_changed() after they
+ * update what a page shows, or publish on the event bus (system/event_bus.h),
+ * which the display task subscribes to for the cellular and GNSS pages;
+ * repeats between frames cost one task notification.
+ * Each page caps its frame rate, so a chatty producer can't keep the display
+ * task busy, and a page with no poll timer and no new data costs no CPU.
+ */
+
+#ifndef UI_FRAME_H
+#define UI_FRAME_H
+
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+enum class UiData : uint8_t { Cellular, Gnss, Logs, Count };
+
+#define UI_DATA_BIT(d) (1UL << static_cast<uint8_t>(UiData::d))
+
+// Per page: which data it shows, how often it redraws on its own (0 = never)
+// and the shortest gap between frames
+struct UiFrameSchedule {
+    uint32_t dataMask;
+    uint16_t pollMs;
+    uint16_t minFrameMs;
+};
+
+// The task ui_data_changed() and ui_frame_request() wake
+void ui_frame_begin(TaskHandle_t display);
+// Any task; not from ISRs
+void ui_data_changed(UiData data);
+// Wakes the display task (UI events, modal changes)
+void ui_frame_request();
+// Display task: true when data in mask changed since the last call
+bool ui_data_consume(uint32_t mask);
+
+// Stretches every page's poll and frame cap (crash recovery); 1 = as configured
+void ui_frame_set_slowdown(uint8_t factor);
+uint8_t ui_frame_slowdown();
+
+#endif // UI_FRAME_H
@@ -0,0 +1,128 @@
+/*
+ * UI Frame Timing Implementation
+ */
+
+#include "ui_perf.h"
+#include "ui_state.h"
+#include <algorithm>
+
+namespace {
+struct Sample {
+    uint32_t renderUs;
+    uint32_t pushUs;
+    uint32_t bytes;
+};
+
+Sample s_samples[UI_PERF_SAMPLES];
+uint32_t s_frames = 0;
+uint32_t s_skipped = 0;
+uint32_t s_idle = 0;
+uint64_t s_totalBytes = 0;
+UiPerfSummary s_summary = {};
+bool s_stale = true;
+uint32_t s_sorted[UI_PERF_SAMPLES];
+
+UiPerfPercentiles percentiles(size_t n, uint32_t Sample::*field) {
+    UiPerfPercentiles p{};
+    if (n == 0) return p;
+    for (size_t i = 0; i < n; i++) s_sorted[i] = s_samples[i].*field;
+    std::sort(s_sorted, s_sorted + n);
+    auto pct = [&](size_t q) { return s_sorted[std::min(n - 1, n * q / 100)]; };
+    p.p50 = pct(50);
+    p.p90 = pct(90);
+    p.p99 = pct(99);
+    p.max = s_sorted[n - 1];
+    return p;
+}
+
+void printRow(Print& out, const char* name, const UiPerfPercentiles& p) {
+    out.printf("  %-7s %7lu %7lu %7lu %7lu\n", name, (unsigned long)p.p50, (unsigned long)p.p90,
+               (unsigned long)p.p99, (unsigned long)p.max);
+}
+} // namespace
+
+void ui_perf_frame(uint32_t renderUs, uint32_t pushUs, uint32_t bytes) {
+    s_samples[s_frames % UI_PERF_SAMPLES] = Sample{renderUs, pushUs, bytes};
+    s_frames++;
+    s_totalBytes += bytes;
+    s_stale = true;
+}
+
+void ui_perf_idle() {
+    s_idle++;
+    s_stale = true;
+}
+
+void ui_perf_skip() {
+    s_skipped++;
+    s_stale = true;
+}
+
+void ui_perf_reset() {
+    s_frames = 0;
+    s_skipped = 0;
+    s_idle = 0;
+    s_totalBytes = 0;
+    s_stale = true;
+}
+
+const UiPerfSummary& ui_perf_summary() {
+    if (!s_stale) return s_summary;
+    UiPerfSummary& s = s_summary;
+    const size_t n = s_frames < UI_PERF_SAMPLES ? s_frames : UI_PERF_SAMPLES;
+    s.frames = s_frames;
+    s.samples = n;
+    s.skipped = s_skipped;
+    s.idle = s_idle;
+    s.renderUs = percentiles(n, &Sample::renderUs);
+    s.pushUs = percentiles(n, &Sample::pushUs);
+    s.bytes = percentiles(n, &Sample::bytes);
+    s.totalBytes = s_totalBytes;
+    s_stale = false;
+    return s;
+}
+
+void ui_perf_report(Print& out) {
+    const UiPerfSummary& s = ui_perf_summary();
+    out.printf("UI frames: %lu pushed, %lu idle, %lu skipped by the frame cap, %llu KB total\n",
+               (unsigned long)s.frames, (unsigned long)s.idle, (unsigned long)s.skipped,
+               (unsigned long long)(s.totalBytes >> 10));
+    if (!s.samples) return;
+    out.printf("  last %lu      p50     p90     p99     max\n", (unsigned long)s.samples);
+    printRow(out, "render", s.renderUs);
+    printRow(out, "push", s.pushUs);
+    printRow(out, "bytes", s.bytes);
+}
+
+void ui_bench_run(const UiBenchPage* pages, size_t count, Print& out) {
+    out.printf("UI benchmark: %u pages, 1 full frame + %u refreshes each, synthetic data\n", (unsigned)count,
+               (unsigned)UI_BENCH_FRAMES);
+    out.printf("%-10s %8s %11s %4s %4s %9s %4s %11s %5s\n", "page", "full_us", "render_p50", "p90", "p99",
+               "push_p50", "p99", "bytes_p50", "idle");
+    uint32_t frame = 0;
+    const uint32_t start = millis();
+    for (size_t i = 0; i < count; i++) {
+        const UiBenchPage& page = pages[i];
+        ui_state_synthesize(frame++);
+        if (page.begin) page.begin();
+        ui_render_full(page.draw, BLACK);
+        UiRenderStats rs;
+        ui_render_stats(rs);
+        const uint32_t fullUs = rs.fullUs;
+
+        ui_perf_reset();
+        for (uint32_t f = 0; f < UI_BENCH_FRAMES; f++) {
+            ui_state_synthesize(frame++);
+            if (page.begin) page.begin();
+            ui_render_refresh(page.draw, BLACK);
+            vTaskDelay(1);   // let the lower-priority tasks and the watchdog feeders run
+        }
+        const UiPerfSummary& s = ui_perf_summary();
+        out.printf("%-10s %8lu %11lu %4lu %4lu %9lu %4lu %11lu %5lu\n", page.name, (unsigned long)fullUs,
+                   (unsigned long)s.renderUs.p50, (unsigned long)s.renderUs.p90, (unsigned long)s.renderUs.p99,
+                   (unsigned long)s.pushUs.p50, (unsigned long)s.pushUs.p99, (unsigned long)s.bytes.p50,
+                   (unsigned long)s.idle);
+    }
+    out.printf("UI benchmark: done in %lu ms\n", (unsigned long)(millis() - start));
+    ui_perf_reset();
+}
@@ -0,0 +1,70 @@
+/*
+ * UI Frame Timing
+ * Per-frame cost of the display task, so UI changes can be judged on numbers:
+ *   - every frame that pushes pixels records its render time (drawing, measure
+ *     pass included), the time spent waiting on the SPI/DMA push and the bytes
+ *     pushed, into a ring of the last UI_PERF_SAMPLES frames; the summary gives
+ *     their percentiles
+ *   - frames skipped: data changes that arrived inside a page's frame cap and
+ *     were folded into a later frame, and refreshes that found nothing to push
+ *   - ui_bench_run() drives each page through a full frame and UI_BENCH_FRAMES
+ *     refreshes under synthetic data (ui_state_synthesize()) and prints a
+ *     per-page report; ENABLE_UI_BENCHMARK runs it when the display task starts
+ *
+ * Without DMA strips drawing goes straight to the panel, so push time is part
+ * of render time and reads zero.
+ */
+
+#ifndef UI_PERF_H
+#define UI_PERF_H
+
+#include <Arduino.h>
+#include "components/ui_widgets.h"
+
+#ifndef UI_PERF_SAMPLES
+#define UI_PERF_SAMPLES 64                 // frames kept for the percentiles
+#endif
+#ifndef UI_BENCH_FRAMES
+#define UI_BENCH_FRAMES 40                 // refreshes per page
+#endif
+
+struct UiPerfPercentiles {
+    uint32_t p50;
+    uint32_t p90;
+    uint32_t p99;
+    uint32_t max;
+};
+
+struct UiPerfSummary {
+    uint32_t frames;             // frames recorded since the last reset
+    uint32_t samples;            // of those, in the percentiles
+    uint32_t skipped;            // data changes folded by the frame cap
+    uint32_t idle;               // refreshes with nothing to push
+    UiPerfPercentiles renderUs;
+    UiPerfPercentiles pushUs;
+    UiPerfPercentiles bytes;
+    uint64_t totalBytes;
+};
+
+// ui_widgets, once per frame: one that pushed pixels, or a refresh that found none
+void ui_perf_frame(uint32_t renderUs, uint32_t pushUs, uint32_t bytes);
+void ui_perf_idle();
+// Display task, when the frame cap defers a data change
+void ui_perf_skip();
+void ui_perf_reset();
+
+// Display task; recomputed only when frames were recorded since the last call
+const UiPerfSummary& ui_perf_summary();
+void ui_perf_report(Print& out);
+
+struct UiBenchPage {
+    const char* name;
+    UiDrawFn draw;
+    UiDrawFn begin;              // per frame before the passes; may be null
+};
+
+// Display task, with the panel to itself. Leaves the last page drawn on screen
+// and the frame statistics reset.
+void ui_bench_run(const UiBenchPage* pages, size_t count, Print& out);
+
+#endif // UI_PERF_H
@@ -0,0 +1,128 @@
+/*
+ * UI State Implementation
+ */
+
+#include "ui_state.h"
+#include "../config/system_config.h"
+#include "../modules/pwrcan/pwrcan_module.h"
+
+extern CatMGNSSModule* catmGnssModule;
+extern BasicStampPLC* stampPLC;
+extern PWRCANModule* pwrcanModule;
+
+namespace {
+UiState s_state = {};
+} // namespace
+
+void ui_state_capture() {
+    UiState& s = s_state;
+
+    s.catmReady = catmGnssModule && catmGnssModule->isModuleInitialized();
+    if (s.catmReady) {
+        s.cell = catmGnssModule->getCellularSnapshot();
+        s.gnss = catmGnssModule->getGNSSData();
+    } else {
+        s.cell = CellularSnapshot{};
+        s.gnss = GNSSData{};
+    }
+
+    s.plcReady = stampPLC && stampPLC->isReady();
+    s.plc = s.plcReady ? stampPLC->getIoSnapshot() : PlcIoSnapshot{};
+    s.sensors = sensor_acq_snapshot();
+
+#if ENABLE_PWRCAN
+    s.generatorReady = pwrcanModule && pwrcanModule->isStarted();
+    s.generator = s.generatorReady ? pwrcanModule->getGeneratorProtocol().snapshot() : CanGeneratorSnapshot{};
+#else
+    s.generatorReady = false;
+#endif
+    generator_derived_get(s.generatorDerived);
+
+    s.freeHeap = ESP.getFreeHeap();
+    s.heapSize = ESP.getHeapSize();
+    s.minFreeHeap = ESP.getMinFreeHeap();
+    s.cpuMHz = ESP.getCpuFreqMHz();
+    s.wallClock = time(nullptr);
+    s.capturedMs = millis();
+}
+
+const UiState& ui_state() {
+    return s_state;
+}
+
+void ui_state_synthesize(uint32_t frame) {
+    UiState& s = s_state;
+    const uint32_t now = millis();
+
+    s.catmReady = true;
+    CellularSnapshot& c = s.cell;
+    c = CellularSnapshot{};
+    c.isConnected = (frame % 16) != 15;
+    c.isRegistered = true;
+    c.isValid = true;
+    c.hasIpAddress = c.isConnected;
+    c.signalStrength = (int8_t)(-110 + (int)(frame * 7 % 60));
+    c.registrationState = 1;
+    c.lastUpdate = now;
+    c.errorCount = frame / 8;
+    c.txBytes = (uint64_t)frame * 1337;
+    c.rxBytes = (uint64_t)frame * 4242;
+    c.txBps = 200 + frame * 13 % 900;
+    c.rxBps = 800 + frame * 29 % 4000;
+    strcpy(c.operatorName, "BENCH");
+    strcpy(c.imei, "000000000000000");
+    strcpy(c.ipAddress, "10.0.0.1");
+    strcpy(c.apn, "bench");
+
+    GNSSData& g = s.gnss;
+    g = GNSSData{};
+    g.isValid = (frame % 10) != 9;
+    g.latitude = 35.6 + frame * 0.00013;
+    g.longitude = 139.7 - frame * 0.00011;
+    g.altitude = 40.0 + (frame % 20) * 0.5;
+    g.speed = (frame % 30) * 0.7f;
+    g.course = (float)(frame * 11 % 360);
+    g.satellites = 4 + frame % 9;
+    g.year = 2026;
+    g.month = 1;
+    g.day = 1 + frame / 86400 % 28;
+    g.hour = frame / 3600 % 24;
+    g.minute = frame / 60 % 60;
+    g.second = frame % 60;
+    g.hdop = 0.8f + (frame % 5) * 0.1f;
+    g.lastUpdate = now;
+
+    s.plcReady = true;
+    for (int i = 0; i < 8; i++) s.plc.digitalInputs[i] = ((frame >> i) & 1) != 0;
+    for (int i = 0; i < 4; i++) s.plc.analogInputs[i] = (uint16_t)((frame * (i + 3) * 97) % 4096);
+    s.plc.relayOutputs[0] = (frame & 4) != 0;
+    s.plc.relayOutputs[1] = (frame & 8) != 0;
+    s.plc.updatedMs = now;
+    s.sensors.powerOk = true;
+    s.sensors.tempOk = true;
+    s.sensors.busVoltage = 4.9f + (frame % 8) * 0.03f;
+    s.sensors.current = 0.12f + (frame % 13) * 0.011f;
+    s.sensors.temperature = 30.0f + (frame % 40) * 0.5f;
+    s.sensors.powerMs = now;
+    s.sensors.tempMs = now;
+
+    s.generatorReady = false;
+    s.generatorDerived = GeneratorDerived{};
+    s.generatorDerived.fuelValid = true;
+    s.generatorDerived.fuelPercent = 80.0f - (frame % 600) * 0.1f;
+    s.generatorDerived.burnPctPerHour = 2.5f;
+    s.generatorDerived.hoursToEmpty = s.generatorDerived.fuelPercent / 2.5f;
+    s.generatorDerived.duty = 0.25f;
+    s.generatorDerived.serviceValid = true;
+    s.generatorDerived.service[0] = GenServiceProjection{(int32_t)(120 * 3600 - frame % 3600), 20.0f};
+    s.generatorDerived.service[1] = GenServiceProjection{48 * 3600, 8.0f};
+    s.generatorDerived.service[2] = GenServiceProjection{(int32_t)(-2 * 3600), 0.0f};
+    s.generatorDerived.nextService = (uint8_t)GenService::OilChange;
+
+    s.heapSize = ESP.getHeapSize();
+    s.freeHeap = s.heapSize / 3 + (frame * 4099) % (s.heapSize / 3);
+    s.minFreeHeap = s.heapSize / 4;
+    s.cpuMHz = ESP.getCpuFreqMHz();
+    s.wallClock = 1767225600 + (time_t)frame * 60;   // 2026-01-01, a minute per frame
+    s.capturedMs = now;
+}
@@ -0,0 +1,49 @@
+/*
+ * UI State
+ * The display task's per-frame copy of everything the pages show. Each producer
+ * publishes a versioned POD snapshot (SeqlockSnapshot); ui_state_capture() copies
+ * them once per frame without taking a lock, so a slow producer never stalls a
+ * frame and the measure and paint passes of one frame see the same values.
+ * System metrics (heap, CPU clock) are sampled here rather than published.
+ */
+
+#ifndef UI_STATE_H
+#define UI_STATE_H
+
+#include <Arduino.h>
+#include <time.h>
+#include "../modules/catm_gnss/catm_gnss_module.h"
+#include "../modules/pwrcan/can_generator_protocol.h"
+#include "../hardware/basic_stamplc.h"
+#include "../hardware/sensor_acquisition.h"
+#include "../hardware/generator_derived.h"
+
+struct UiState {
+    bool catmReady;
+    CellularSnapshot cell;
+    GNSSData gnss;
+
+    bool plcReady;
+    PlcIoSnapshot plc;
+    PlcSensorSnapshot sensors;     // INA226 and LM75B, from the acquisition job
+
+    bool generatorReady;
+    CanGeneratorSnapshot generator;
+    GeneratorDerived generatorDerived;   // memoized, a copy unless an input moved
+
+    uint32_t freeHeap;
+    uint32_t heapSize;
+    uint32_t minFreeHeap;
+    uint32_t cpuMHz;
+    time_t wallClock;              // system time, kept on the RTC by syncRTCFromAvailableSources()
+    uint32_t capturedMs;
+};
+
+// Display task, once before each frame
+void ui_state_capture();
+// Display task only; valid until the next capture
+const UiState& ui_state();
+// Fills the state with plausible values that change every frame (ui_bench_run)
+void ui_state_synthesize(uint32_t frame);
+
+#endif // UI_STATE_H
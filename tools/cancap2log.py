@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Convert CAN capture files (src/modules/pwrcan/can_capture.h) to candump or ASC.
+
+Input is one or more /can/<seq>.can files copied off the SD card; they are
+read in the order given, so pass a rotated capture in sequence order. The
+candump log format replays with can-utils (canplayer -I out.log); ASC opens in
+CANalyzer/CANoe and most trace viewers. Records flagged as following a loss
+are counted on stderr and marked with a comment in ASC output.
+
+    python3 tools/cancap2log.py /media/sd/can/*.can -o bus.log
+    python3 tools/cancap2log.py 00000007.can --format asc -o bus.asc
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+MAGIC = 0x4E414347  # "GCAN"
+HEADER = struct.Struct("<IHHHHIIQQ")
+RECORD = struct.Struct("<IIB")
+INFO_LOST = 0x80
+INFO_TIME = 0x40
+EXTENDED = 0x80000000
+REMOTE = 0x40000000
+
+
+def read_frames(path):
+    """Yields (seconds, id, extended, remote, data, lost) for one capture file."""
+    with open(path, "rb") as f:
+        blob = f.read()
+    if len(blob) < HEADER.size:
+        raise ValueError("%s: too short for a capture header" % path)
+    magic, version, header_bytes, _kbps, _res, _fid, _fmask, timer_us, wall_us = HEADER.unpack_from(blob)
+    if magic != MAGIC or version != 1:
+        raise ValueError("%s: not a CAN capture (magic %08x, version %d)" % (path, magic, version))
+    # Without a wall clock at capture time, times are seconds since boot
+    base = (wall_us - timer_us) if wall_us else 0
+    pos = header_bytes
+    high = None
+    last_low = 0
+    while pos + RECORD.size <= len(blob):
+        low, ident, info = RECORD.unpack_from(blob, pos)
+        length = info & 0x0F
+        data = blob[pos + RECORD.size:pos + RECORD.size + length]
+        if len(data) < length:
+            break  # torn tail from a power loss
+        pos += RECORD.size + length
+        if info & INFO_TIME:
+            high = struct.unpack("<I", data[:4])[0]
+            last_low = low
+            continue
+        if high is None:
+            high = timer_us >> 32
+        if low < last_low:
+            high += 1  # low word wrapped inside a block
+        last_low = low
+        us = (high << 32) | low
+        yield ((base + us) / 1e6, ident & 0x1FFFFFFF, bool(ident & EXTENDED), bool(ident & REMOTE), data,
+               bool(info & INFO_LOST))
+
+
+def candump_line(t, ident, ext, rtr, data, iface):
+    name = ("%08X" if ext else "%03X") % ident
+    payload = "R" if rtr else data.hex().upper()
+    return "(%.6f) %s %s#%s" % (t, iface, name, payload)
+
+
+def asc_line(t, ident, ext, rtr, data, channel):
+    name = ("%Xx" if ext else "%X") % ident
+    if rtr:
+        return "%11.6f %d  %-15s Rx   r" % (t, channel, name)
+    body = " ".join("%02X" % b for b in data)
+    return "%11.6f %d  %-15s Rx   d %d %s" % (t, channel, name, len(data), body)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("files", nargs="+")
+    ap.add_argument("-o", "--output", help="output file (default stdout)")
+    ap.add_argument("--format", choices=("candump", "asc"), default="candump")
+    ap.add_argument("--iface", default="can0", help="candump interface name")
+    ap.add_argument("--channel", type=int, default=1, help="ASC channel number")
+    args = ap.parse_args()
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    frames = 0
+    losses = 0
+    start = None
+    try:
+        for path in args.files:
+            for t, ident, ext, rtr, data, lost in read_frames(path):
+                if args.format == "candump":
+                    out.write(candump_line(t, ident, ext, rtr, data, args.iface) + "\n")
+                else:
+                    if start is None:
+                        start = t
+                        stamp = time.strftime("%a %b %d %H:%M:%S.000 %Y", time.gmtime(t))
+                        out.write("date %s\nbase hex  timestamps absolute\nno internal events logged\n" % stamp)
+                        out.write("Begin Triggerblock %s\n" % stamp)
+                    if lost:
+                        out.write("// frames lost before this one\n")
+                    out.write(asc_line(t - start, ident, ext, rtr, data, args.channel) + "\n")
+                frames += 1
+                losses += lost
+        if args.format == "asc" and start is not None:
+            out.write("End TriggerBlock\n")
+    except ValueError as e:
+        sys.exit(str(e))
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    print("%d frames, %d gaps with lost frames" % (frames, losses), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
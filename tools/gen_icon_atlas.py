@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+"""Rasterize the UI icons into a 1-bit atlas header kept in flash.
+
+Re-draws the shapes of the *Direct functions in src/ui/components/icon_manager.cpp
+with the same primitives (LovyanGFX/Adafruit GFX rasterization) at each size the
+pages use, and writes src/ui/components/icon_atlas.h. Every icon has a mask drawn
+in the caller's colour and, where the vector icon punches a hole in the theme
+background colour, a second hole mask. Run it after changing an icon shape or
+adding a size, and commit the header:
+
+    python3 tools/gen_icon_atlas.py            # or: make icons
+"""
+
+import argparse
+import math
+import os
+import sys
+
+SIZES = (12, 14, 16)
+ICONS = ("Satellite", "Gps", "Cellular", "Gear", "Log")
+
+FG, HOLE = 1, 2
+
+
+class Canvas:
+    """Unbounded pixel map; the last primitive to touch a pixel wins."""
+
+    def __init__(self):
+        self.px = {}
+
+    def pixel(self, x, y, c):
+        self.px[(x, y)] = c
+
+    def fill_rect(self, x, y, w, h, c):
+        if w < 0:
+            x, w = x + w + 1, -w
+        if h < 0:
+            y, h = y + h + 1, -h
+        for yy in range(y, y + h):
+            for xx in range(x, x + w):
+                self.pixel(xx, yy, c)
+
+    def hline(self, x, y, w, c):
+        self.fill_rect(x, y, w, 1, c)
+
+    def vline(self, x, y, h, c):
+        self.fill_rect(x, y, 1, h, c)
+
+    def rect(self, x, y, w, h, c):
+        self.hline(x, y, w, c)
+        self.hline(x, y + h - 1, w, c)
+        self.vline(x, y, h, c)
+        self.vline(x + w - 1, y, h, c)
+
+    def line(self, x0, y0, x1, y1, c):
+        steep = abs(y1 - y0) > abs(x1 - x0)
+        if steep:
+            x0, y0, x1, y1 = y0, x0, y1, x1
+        if x0 > x1:
+            x0, x1, y0, y1 = x1, x0, y1, y0
+        dx, dy = x1 - x0, abs(y1 - y0)
+        err = dx // 2
+        ystep = 1 if y0 < y1 else -1
+        y = y0
+        for x in range(x0, x1 + 1):
+            self.pixel(y if steep else x, x if steep else y, c)
+            err -= dy
+            if err < 0:
+                y += ystep
+                err += dx
+
+    def fill_circle(self, x0, y0, r, c):
+        self.vline(x0, y0 - r, 2 * r + 1, c)
+        f, ddx, ddy, x, y = 1 - r, 1, -2 * r, 0, r
+        while x < y:
+            if f >= 0:
+                y -= 1
+                ddy += 2
+                f += ddy
+            x += 1
+            ddx += 2
+            f += ddx
+            self.vline(x0 + x, y0 - y, 2 * y + 1, c)
+            self.vline(x0 - x, y0 - y, 2 * y + 1, c)
+            self.vline(x0 + y, y0 - x, 2 * x + 1, c)
+            self.vline(x0 - y, y0 - x, 2 * x + 1, c)
+
+    def fill_triangle(self, x0, y0, x1, y1, x2, y2, c):
+        pts = sorted(((y0, x0), (y1, x1), (y2, x2)))
+        (y0, x0), (y1, x1), (y2, x2) = pts
+        if y0 == y2:
+            lo, hi = min(x0, x1, x2), max(x0, x1, x2)
+            self.hline(lo, y0, hi - lo + 1, c)
+            return
+        dx01, dy01 = x1 - x0, y1 - y0
+        dx02, dy02 = x2 - x0, y2 - y0
+        dx12, dy12 = x2 - x1, y2 - y1
+        sa = sb = 0
+        last = y1 if y1 == y2 else y1 - 1
+        y = y0
+        while y <= last:
+            a = x0 + int(sa / dy01) if dy01 else x0
+            b = x0 + int(sb / dy02)
+            sa += dx01
+            sb += dx02
+            a, b = min(a, b), max(a, b)
+            self.hline(a, y, b - a + 1, c)
+            y += 1
+        sa = dx12 * (y - y1)
+        sb = dx02 * (y - y0)
+        while y <= y2:
+            a = x1 + int(sa / dy12)
+            b = x0 + int(sb / dy02)
+            sa += dx12
+            sb += dx02
+            a, b = min(a, b), max(a, b)
+            self.hline(a, y, b - a + 1, c)
+            y += 1
+
+
+# Shapes at x = y = 0; keep in step with the *Direct functions
+
+def satellite(d, size):
+    cx = cy = size // 2
+    unit = size // 8
+    d.fill_rect(cx - unit, cy - unit, unit * 2, unit * 2, FG)
+    d.fill_rect(cx - unit * 4, cy - unit // 2, unit * 2, unit, FG)
+    d.fill_rect(cx + unit * 2, cy - unit // 2, unit * 2, unit, FG)
+    d.line(cx, cy - unit, cx, cy - unit * 2, FG)
+    d.fill_circle(cx, cy - unit * 2 - 1, 1, FG)
+
+
+def gps(d, size):
+    cx = size // 2
+    unit = size // 8
+    d.fill_circle(cx, unit * 3, unit * 2, FG)
+    d.fill_circle(cx, unit * 3, unit, HOLE)
+    d.fill_triangle(cx - unit * 2, unit * 4, cx + unit * 2, unit * 4, cx, size - unit, FG)
+
+
+def cellular(d, size):
+    unit = size // 8
+    for i in range(4):
+        bar_h = unit * (i + 1) + unit
+        d.fill_rect(unit + i * (unit + 2), size - unit - bar_h, unit, bar_h, FG)
+
+
+def gear(d, size):
+    cx = cy = size // 2
+    r = size // 3
+    d.fill_circle(cx, cy, r, FG)
+    d.fill_circle(cx, cy, r // 2, HOLE)
+    for i in range(6):
+        angle = i * 3.14159 / 3.0
+        tx = cx + int((r + 2) * math.cos(angle))
+        ty = cy + int((r + 2) * math.sin(angle))
+        d.fill_circle(tx, ty, 2, FG)
+
+
+def log(d, size):
+    unit = size // 8
+    d.rect(unit, unit, size - unit * 2, size - unit * 2, FG)
+    for i in range(3):
+        d.hline(unit * 2, unit * 3 + i * unit * 2, size - unit * 5, FG)
+
+
+SHAPES = {"Satellite": satellite, "Gps": gps, "Cellular": cellular, "Gear": gear, "Log": log}
+
+
+def pack(px, colour, x0, y0, w, h):
+    """Adafruit GFX bitmap: rows padded to a byte, MSB is the leftmost pixel."""
+    out = bytearray()
+    for y in range(y0, y0 + h):
+        row = 0
+        for x in range(x0, x0 + ((w + 7) // 8) * 8):
+            row = (row << 1) | (1 if px.get((x, y)) == colour else 0)
+            if (x - x0) % 8 == 7:
+                out.append(row)
+                row = 0
+    return bytes(out)
+
+
+def build():
+    bits = bytearray()
+    entries = []
+    for name in ICONS:
+        for size in SIZES:
+            d = Canvas()
+            SHAPES[name](d, size)
+            xs = [p[0] for p in d.px]
+            ys = [p[1] for p in d.px]
+            x0, y0 = min(xs), min(ys)
+            w, h = max(xs) - x0 + 1, max(ys) - y0 + 1
+            mask = pack(d.px, FG, x0, y0, w, h)
+            entry = {"icon": name, "size": size, "dx": x0, "dy": y0, "w": w, "h": h,
+                     "mask": len(bits), "hole": None}
+            bits += mask
+            if HOLE in d.px.values():
+                entry["hole"] = len(bits)
+                bits += pack(d.px, HOLE, x0, y0, w, h)
+            entries.append(entry)
+    return entries, bytes(bits)
+
+
+def render(entries, bits):
+    lines = [
+        "/*",
+        " * Icon Atlas",
+        " * Generated by tools/gen_icon_atlas.py - do not edit. 1-bit masks in flash,",
+        " * drawn with drawBitmap(): mask in the caller's colour, hole in the theme bg.",
+        " */",
+        "",
+        "#ifndef ICON_ATLAS_H",
+        "#define ICON_ATLAS_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        "enum class AtlasIcon : uint8_t { %s };" % ", ".join(ICONS),
+        "",
+        "#define ICON_ATLAS_NO_HOLE 0xFFFF",
+        "",
+        "struct IconAtlasEntry {",
+        "    AtlasIcon icon;",
+        "    uint8_t size;            // size argument of the *Direct function",
+        "    int8_t dx, dy;           // top-left of the bitmap from the icon's x, y",
+        "    uint8_t w, h;",
+        "    uint16_t mask;           // offsets into kIconAtlasBits",
+        "    uint16_t hole;",
+        "};",
+        "",
+        "static const uint8_t kIconAtlasBits[%d] = {" % len(bits),
+    ]
+    for i in range(0, len(bits), 16):
+        lines.append("    " + " ".join("0x%02x," % b for b in bits[i:i + 16]))
+    lines += ["};", "", "static const IconAtlasEntry kIconAtlas[%d] = {" % len(entries)]
+    for e in entries:
+        hole = "ICON_ATLAS_NO_HOLE" if e["hole"] is None else str(e["hole"])
+        lines.append("    {AtlasIcon::%s, %d, %d, %d, %d, %d, %d, %s}," %
+                     (e["icon"], e["size"], e["dx"], e["dy"], e["w"], e["h"], e["mask"], hole))
+    lines += ["};", "", "#endif // ICON_ATLAS_H", ""]
+    return "\n".join(lines)
+
+
+def main():
+    root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("-o", "--output", default=os.path.join(root, "src", "ui", "components", "icon_atlas.h"))
+    args = ap.parse_args()
+    entries, bits = build()
+    with open(args.output, "w") as f:
+        f.write(render(entries, bits))
+    print("%d icons, %d bytes -> %s" % (len(entries), len(bits), args.output), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Build OTA packages for the ota_url shared attribute (src/modules/transport/ota_client.h).
+
+A full package wraps an application image with its SHA-256. A delta package
+rebuilds the new image from the one running on the device: spans found in the
+old image become COPY ops, the rest is sent literally. Relinked code shifts
+addresses throughout, so deltas only pay off between close builds; the script
+reports the size next to the full image.
+
+    python3 tools/mkota.py .pio/build/m5stack-stamps3/firmware.bin -o fw.ota
+    python3 tools/mkota.py new.bin --base old.bin -o fw-delta.ota
+
+The base must be the exact image the device runs: the device checks its
+SHA-256 and refuses a delta built for another one. Serve the file over HTTP
+with Range support and set ota_url to it; a plain .bin works as well.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = 0x31544F47  # "GOT1"
+HEADER = struct.Struct("<IB3xII32s32s")
+OP_COPY = 0x01
+OP_INSERT = 0x02
+IMAGE_MAGIC = 0xE9
+KEY = 32            # bytes a match must share to be found
+STRIDE = 4          # base offsets indexed
+MIN_COPY = 24       # shorter matches cost more as an op than as literals
+
+
+def image_sha(image):
+    """SHA-256 the device reports for an app image (esp_partition_get_sha256)."""
+    # Byte 23 of the extended header: a SHA-256 of everything before it is appended
+    if len(image) > 56 and image[23] == 1:
+        return image[-32:]
+    return hashlib.sha256(image).digest()
+
+
+def delta_ops(base, target):
+    """Yields (op, offset, data) covering target in order."""
+    index = {}
+    for off in range(0, len(base) - KEY + 1, STRIDE):
+        index.setdefault(base[off:off + KEY], off)
+
+    literal = bytearray()
+    i = 0
+    n = len(target)
+    while i < n:
+        src = index.get(target[i:i + KEY]) if i + KEY <= n else None
+        if src is None:
+            literal.append(target[i])
+            i += 1
+            continue
+        # Extend backwards into the pending literal, then forwards
+        back = 0
+        while back < len(literal) and src - back > 0 and base[src - back - 1] == literal[-back - 1]:
+            back += 1
+        length = KEY
+        while i + length < n and src + length < len(base) and base[src + length] == target[i + length]:
+            length += 1
+        if back + length < MIN_COPY:
+            literal.append(target[i])
+            i += 1
+            continue
+        if back:
+            del literal[-back:]
+        if literal:
+            yield OP_INSERT, 0, bytes(literal)
+            literal.clear()
+        yield OP_COPY, src - back, back + length
+        i += length
+    if literal:
+        yield OP_INSERT, 0, bytes(literal)
+
+
+def encode_delta(base, target):
+    out = bytearray()
+    copied = 0
+    for op, off, data in delta_ops(base, target):
+        if op == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, off, data)
+            copied += data
+        else:
+            out += struct.pack("<BI", OP_INSERT, len(data)) + data
+    return bytes(out), copied
+
+
+def apply_delta(base, payload):
+    """Reference decoder, the same walk as the device's."""
+    out = bytearray()
+    pos = 0
+    while pos < len(payload):
+        op = payload[pos]
+        if op == OP_COPY:
+            off, length = struct.unpack_from("<II", payload, pos + 1)
+            out += base[off:off + length]
+            pos += 9
+        elif op == OP_INSERT:
+            (length,) = struct.unpack_from("<I", payload, pos + 1)
+            out += payload[pos + 5:pos + 5 + length]
+            pos += 5 + length
+        else:
+            raise ValueError("bad op %#x at %d" % (op, pos))
+    return bytes(out)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("image", help="new application image (.bin)")
+    ap.add_argument("--base", help="image running on the devices; builds a delta")
+    ap.add_argument("-o", "--output", required=True)
+    args = ap.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    if not image or image[0] != IMAGE_MAGIC:
+        sys.exit("%s: not an ESP application image" % args.image)
+    sha = hashlib.sha256(image).digest()
+
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+        payload, copied = encode_delta(base, image)
+        if apply_delta(base, payload) != image:
+            sys.exit("delta does not rebuild the image")
+        header = HEADER.pack(MAGIC, 1, len(image), len(payload), image_sha(base), sha)
+        print("delta: %d bytes for a %d byte image (%.1f%%), %d bytes copied from the base"
+              % (len(header) + len(payload), len(image), 100.0 * (len(header) + len(payload)) / len(image), copied))
+    else:
+        payload = image
+        header = HEADER.pack(MAGIC, 0, len(image), len(payload), b"\0" * 32, sha)
+        print("full: %d bytes" % (len(header) + len(payload)))
+
+    with open(args.output, "wb") as f:
+        f.write(header)
+        f.write(payload)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Print a modem transcript (src/modules/catm_gnss/modem_transcript.h) as text.
+
+One line per recorded chunk: milliseconds since the recording started, the
+gap since the previous chunk, direction and the bytes with CR/LF and other
+control bytes escaped. --lines joins received chunks into whole lines, which
+is easier to read but hides how the UART split them. --trim cuts a recording
+to a time window (ms) and writes it as a new transcript, e.g. to replay only
+the attach.
+
+    python3 tools/mtr2txt.py record.mtr
+    python3 tools/mtr2txt.py record.mtr --lines | grep -B2 ERROR
+    python3 tools/mtr2txt.py record.mtr --trim 0 45000 -o replay.mtr
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x52544D47  # "GMTR"
+HEADER = struct.Struct("<IHHIQ")
+RECORD = struct.Struct("<IH")
+TX = 0x8000
+LOST = 0x4000
+LEN_MASK = 0x3FFF
+
+
+def read_records(path):
+    """Returns (header bytes, [(us, tx, lost, data)]) with the 32-bit times unwrapped."""
+    with open(path, "rb") as f:
+        blob = f.read()
+    if len(blob) < HEADER.size:
+        raise ValueError("%s: too short for a transcript header" % path)
+    magic, version, header_bytes, _baud, _wall = HEADER.unpack_from(blob)
+    if magic != MAGIC or version != 1:
+        raise ValueError("%s: not a modem transcript (magic %08x, version %d)" % (path, magic, version))
+    records = []
+    pos = header_bytes
+    wrap = 0
+    last = 0
+    while pos + RECORD.size <= len(blob):
+        low, flags = RECORD.unpack_from(blob, pos)
+        length = flags & LEN_MASK
+        data = blob[pos + RECORD.size:pos + RECORD.size + length]
+        if len(data) < length:
+            break  # torn tail from a power loss
+        pos += RECORD.size + length
+        if low < last:
+            wrap += 1 << 32
+        last = low
+        records.append((wrap + low, bool(flags & TX), bool(flags & LOST), data))
+    return blob[:header_bytes], records
+
+
+def escape(data):
+    out = []
+    for b in data:
+        if b == 0x0D:
+            out.append("\\r")
+        elif b == 0x0A:
+            out.append("\\n")
+        elif 0x20 <= b < 0x7F and b != 0x5C:
+            out.append(chr(b))
+        else:
+            out.append("\\x%02x" % b)
+    return "".join(out)
+
+
+def write_trimmed(header, records, start_ms, end_ms, path):
+    start_us = start_ms * 1000
+    with open(path, "wb") as f:
+        f.write(header)
+        kept = 0
+        for us, tx, lost, data in records:
+            if us < start_us or us > end_ms * 1000:
+                continue
+            flags = len(data) | (TX if tx else 0) | (LOST if lost else 0)
+            f.write(RECORD.pack((us - start_us) & 0xFFFFFFFF, flags))
+            f.write(data)
+            kept += 1
+    return kept
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("file")
+    ap.add_argument("--lines", action="store_true", help="join received chunks into lines")
+    ap.add_argument("--trim", nargs=2, type=int, metavar=("START_MS", "END_MS"))
+    ap.add_argument("-o", "--output", help="output file (default stdout; required with --trim)")
+    args = ap.parse_args()
+
+    try:
+        header, records = read_records(args.file)
+    except ValueError as e:
+        sys.exit(str(e))
+
+    if args.trim:
+        if not args.output:
+            sys.exit("--trim needs -o")
+        kept = write_trimmed(header, records, args.trim[0], args.trim[1], args.output)
+        print("%d of %d records kept" % (kept, len(records)), file=sys.stderr)
+        return
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    prev = 0
+    pending = b""
+    pending_us = 0
+    try:
+        for us, tx, lost, data in records:
+            if lost:
+                out.write("-- bytes lost before this record\n")
+            if args.lines and not tx:
+                if not pending:
+                    pending_us = us
+                pending += data
+                while b"\n" in pending:
+                    line, pending = pending.split(b"\n", 1)
+                    line = line.rstrip(b"\r")
+                    if line:
+                        out.write("%10.1f %+9.1f  < %s\n" % (pending_us / 1000.0, (pending_us - prev) / 1000.0,
+                                                             escape(line)))
+                        prev = pending_us
+                    pending_us = us
+                continue
+            out.write("%10.1f %+9.1f  %s %s\n" % (us / 1000.0, (us - prev) / 1000.0, ">" if tx else "<",
+                                                  escape(data)))
+            prev = us
+    finally:
+        if out is not sys.stdout:
+            out.close()
+    print("%d records, %d TX / %d RX bytes" % (len(records), sum(len(r[3]) for r in records if r[1]),
+                                              sum(len(r[3]) for r in records if not r[1])), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
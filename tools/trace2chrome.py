@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Convert a trace recorder image (src/system/trace_recorder.h) to Chrome trace JSON.
+
+Input is either the binary file saved with "trace save" (/data/trace.bin on the
+SD card) or a serial capture containing the base64 block printed by "trace"
+between the TRACE BEGIN / TRACE END lines. Open the output in ui.perfetto.dev
+or chrome://tracing. A latency summary for the UI path goes to stderr.
+
+    python3 tools/trace2chrome.py capture.txt -o trace.json
+"""
+
+import argparse
+import base64
+import json
+import struct
+import sys
+
+MAGIC = 0x31435254  # "TRC1"
+HEADER = struct.Struct("<IHHIII")
+OBJECT = struct.Struct("<HBB16s")
+EVENT = struct.Struct("<IBBH")
+
+TASK_IN, QUEUE_SEND, QUEUE_RECV, QUEUE_BLOCK, SEM_GIVE, SEM_TAKE, ISR_ENTER, ISR_EXIT, USER, SYNC = range(1, 11)
+EVENT_NAMES = {
+    QUEUE_SEND: "send",
+    QUEUE_RECV: "receive",
+    QUEUE_BLOCK: "block",
+    SEM_GIVE: "give",
+    SEM_TAKE: "take",
+}
+# Mirrors enum class TraceUser
+USER_NAMES = {1: "ButtonPress", 2: "UiEventSend", 3: "UiEventHandled", 4: "PageDrawn"}
+
+
+def load_image(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+    text = data.decode("utf-8", errors="replace").splitlines()
+    try:
+        start = next(i for i, line in enumerate(text) if line.strip() == "TRACE BEGIN")
+        end = next(i for i in range(start, len(text)) if text[i].strip() == "TRACE END")
+    except StopIteration:
+        sys.exit(f"{path}: no trace image (binary or TRACE BEGIN/END block)")
+    return base64.b64decode("".join(line.strip() for line in text[start + 1:end]))
+
+
+def parse(data):
+    magic, version, nobjects, nevents, lost, cpu_hz = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 1:
+        sys.exit("unsupported trace image")
+    off = HEADER.size
+    objects = {}
+    for _ in range(nobjects):
+        oid, kind, _, name = OBJECT.unpack_from(data, off)
+        objects[oid] = name.split(b"\0", 1)[0].decode("ascii", errors="replace") or f"obj{oid}"
+        off += OBJECT.size
+    events = []
+    last = None
+    base = 0
+    for _ in range(nevents):
+        cycles, etype, core, obj = EVENT.unpack_from(data, off)
+        off += EVENT.size
+        # Both cores share one 32-bit timeline; claims can land slightly out of
+        # order across cores, so only a large backwards step is a wrap
+        if last is not None:
+            delta = (cycles - last) & 0xFFFFFFFF
+            base += delta if delta < 0x80000000 else delta - 0x100000000
+        last = cycles
+        events.append((base * 1e6 / cpu_hz, etype, core, obj))
+    return objects, events, lost
+
+
+def convert(objects, events):
+    out = []
+    for core in (0, 1):
+        out.append({"ph": "M", "name": "process_name", "pid": core, "args": {"name": f"Core {core}"}})
+        out.append({"ph": "M", "name": "thread_name", "pid": core, "tid": 0, "args": {"name": "CPU"}})
+        out.append({"ph": "M", "name": "thread_name", "pid": core, "tid": 1, "args": {"name": "ISR"}})
+        out.append({"ph": "M", "name": "thread_name", "pid": core, "tid": 2, "args": {"name": "Events"}})
+    running = {}
+    for ts, etype, core, obj in events:
+        if etype == TASK_IN:
+            prev = running.get(core)
+            if prev:
+                out.append({"ph": "X", "name": prev[1], "pid": core, "tid": 0, "ts": prev[0], "dur": ts - prev[0]})
+            running[core] = (ts, objects.get(obj, f"task{obj}"))
+        elif etype in EVENT_NAMES:
+            task = running.get(core, (0, "?"))[1]
+            out.append({"ph": "i", "s": "t", "name": f"{EVENT_NAMES[etype]} {objects.get(obj, f'obj{obj}')}",
+                        "pid": core, "tid": 2, "ts": ts, "args": {"task": task}})
+        elif etype in (ISR_ENTER, ISR_EXIT):
+            out.append({"ph": "B" if etype == ISR_ENTER else "E", "name": f"isr{obj}", "pid": core, "tid": 1, "ts": ts})
+        elif etype == USER:
+            name = USER_NAMES.get(obj >> 8, f"user{obj >> 8}")
+            out.append({"ph": "i", "s": "p", "name": name, "pid": core, "tid": 2, "ts": ts,
+                        "args": {"arg": obj & 0xFF}})
+    for core, (ts, name) in running.items():
+        if events:
+            out.append({"ph": "X", "name": name, "pid": core, "tid": 0, "ts": ts, "dur": events[-1][0] - ts})
+    return out
+
+
+def summarize(label, samples):
+    if samples:
+        print(f"{label}: n={len(samples)} min={min(samples):.0f} us avg={sum(samples) / len(samples):.0f} us "
+              f"max={max(samples):.0f} us", file=sys.stderr)
+
+
+def latency(events):
+    press_to_send, send_to_handled, press_to_drawn = [], [], []
+    press = None
+    sent = {}
+    for ts, etype, _, obj in events:
+        if etype != USER:
+            continue
+        uid, arg = obj >> 8, obj & 0xFF
+        if uid == 1:
+            press = ts
+        elif uid == 2:
+            sent.setdefault(arg, []).append(ts)
+            if press is not None:
+                press_to_send.append(ts - press)
+        elif uid == 3 and sent.get(arg):
+            send_to_handled.append(ts - sent[arg].pop(0))
+        elif uid == 4 and press is not None:
+            press_to_drawn.append(ts - press)
+            press = None
+    summarize("press -> UiEvent sent", press_to_send)
+    summarize("UiEvent sent -> handled", send_to_handled)
+    summarize("press -> page drawn", press_to_drawn)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", help="trace.bin or a serial capture")
+    parser.add_argument("-o", "--output", default="trace.json")
+    args = parser.parse_args()
+
+    objects, events, lost = parse(load_image(args.input))
+    with open(args.output, "w") as f:
+        json.dump({"traceEvents": convert(objects, events), "displayTimeUnit": "ns"}, f)
+    span = events[-1][0] - events[0][0] if events else 0
+    print(f"{len(events)} events over {span / 1000:.1f} ms ({lost} overwritten), {len(objects)} objects -> {args.output}",
+          file=sys.stderr)
+    latency(events)
+
+
+if __name__ == "__main__":
+    main()